@@ -44,6 +44,10 @@ public:
     // Capturers should sample at a 44.1 or 48 kHz sampling rate, in uncompressed PCM stereo format.
     // Capturers may choose the number of frames per packet. Returns true on success.
     virtual bool start(const PacketCapturedCallback& callback) = 0;
+
+    // In the low latency mode the packets are captured more often. Capturers that deliver the
+    // packets at the pace of the device ignore it.
+    virtual void setLowLatency(bool /* enable */) {}
 };
 
 } // namespace base
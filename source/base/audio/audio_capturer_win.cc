@@ -52,6 +52,10 @@ const int kSilenceThreshold = 2;
 // Lower bound for timer intervals, in milliseconds.
 const std::chrono::milliseconds kMinTimerInterval { 30 };
 
+// Lower bound for timer intervals in the low latency mode. The packets of this size match the
+// frames of the encoder.
+const std::chrono::milliseconds kMinLowLatencyTimerInterval { 10 };
+
 // Upper bound for the timer precision error, in milliseconds.
 // Timers are supposed to be accurate to 20ms, so we use 30ms to be safe.
 const int kMaxExpectedTimerLag = 30;
@@ -85,12 +89,25 @@ bool AudioCapturerWin::start(const PacketCapturedCallback& callback)
     // Initialize the capture timer and start capturing. Note, this timer won't be reset or
     // restarted in resetAndInitialize() function. Which means we expect the audio_device_period_
     // is a system wide configuration, it would not be changed with the default audio device.
-    capture_timer_.expires_after(audio_device_period_);
+    capture_timer_.expires_after(captureInterval());
     capture_timer_.async_wait(
         std::bind(&AudioCapturerWin::onCaptureTimeout, this, std::placeholders::_1));
     return true;
 }
 
+void AudioCapturerWin::setLowLatency(bool enable)
+{
+    DCHECK(thread_checker_.calledOnValidThread());
+
+    if (low_latency_ == enable)
+        return;
+
+    LOG(LS_INFO) << "Low latency capture: " << enable;
+
+    // The new interval is used starting from the next capture.
+    low_latency_ = enable;
+}
+
 bool AudioCapturerWin::resetAndInitialize()
 {
     deinitialize();
@@ -165,7 +182,7 @@ bool AudioCapturerWin::initialize()
     std::chrono::milliseconds device_period_in_milliseconds(
         1 + ((device_period - 1) / k100nsPerMillisecond));
 
-    audio_device_period_ = std::max(device_period_in_milliseconds, kMinTimerInterval);
+    audio_device_period_ = device_period_in_milliseconds;
 
     // Get the wave format.
     hr = audio_client_->GetMixFormat(&wave_format_ex_);
@@ -231,7 +248,10 @@ bool AudioCapturerWin::initialize()
     hr = audio_client_->Initialize(
         AUDCLNT_SHAREMODE_SHARED,
         AUDCLNT_STREAMFLAGS_LOOPBACK,
-        (kMaxExpectedTimerLag + audio_device_period_.count()) * k100nsPerMillisecond,
+        // The buffer must hold the data for the longest interval, because the mode can be changed
+        // without initialization.
+        (kMaxExpectedTimerLag + std::max(audio_device_period_, kMinTimerInterval).count()) *
+            k100nsPerMillisecond,
         0,
         wave_format_ex_,
         nullptr);
@@ -348,11 +368,17 @@ void AudioCapturerWin::onCaptureTimeout(const std::error_code& error_code)
 
     doCapture();
 
-    capture_timer_.expires_after(audio_device_period_);
+    capture_timer_.expires_after(captureInterval());
     capture_timer_.async_wait(
         std::bind(&AudioCapturerWin::onCaptureTimeout, this, std::placeholders::_1));
 }
 
+std::chrono::milliseconds AudioCapturerWin::captureInterval() const
+{
+    return std::max(audio_device_period_,
+                    low_latency_ ? kMinLowLatencyTimerInterval : kMinTimerInterval);
+}
+
 bool AudioCapturer::isSupported()
 {
     return true;
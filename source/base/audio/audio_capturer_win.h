@@ -47,6 +47,7 @@ public:
 
     // AudioCapturer interface.
     bool start(const PacketCapturedCallback& callback) override;
+    void setLowLatency(bool enable) override;
 
 private:
     // Executes deinitialize() and initialize(). If initialize() function call returns false,
@@ -68,12 +69,14 @@ private:
     void doCapture();
 
     void onCaptureTimeout(const std::error_code& error_code);
+    std::chrono::milliseconds captureInterval() const;
 
     PacketCapturedCallback callback_;
 
     proto::AudioPacket::SamplingRate sampling_rate_;
     asio::high_resolution_timer capture_timer_;
     std::chrono::milliseconds audio_device_period_;
+    bool low_latency_ = false;
     AudioVolumeFilterWin volume_filter_;
 
     base::win::ScopedCoMem<WAVEFORMATEX> wave_format_ex_;
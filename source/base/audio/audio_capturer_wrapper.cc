@@ -41,6 +41,19 @@ void AudioCapturerWrapper::start()
     thread_->start(MessageLoop::Type::ASIO, this);
 }
 
+void AudioCapturerWrapper::setLowLatency(bool enable)
+{
+    std::shared_ptr<TaskRunner> task_runner = thread_->taskRunner();
+    if (!task_runner)
+        return;
+
+    task_runner->postTask([this, enable]()
+    {
+        if (capturer_)
+            capturer_->setLowLatency(enable);
+    });
+}
+
 void AudioCapturerWrapper::onBeforeThreadRunning()
 {
 #if defined(OS_WIN)
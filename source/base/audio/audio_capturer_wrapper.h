@@ -35,6 +35,9 @@ public:
 
     void start();
 
+    // Can be called after start() from any thread.
+    void setLowLatency(bool enable);
+
 protected:
     // Thread::Delegate implementation.
     void onBeforeThreadRunning() override;
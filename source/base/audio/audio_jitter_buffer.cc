@@ -0,0 +1,284 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/audio/audio_jitter_buffer.h"
+
+#include "base/logging.h"
+#include "base/codec/audio_bus.h"
+#include "base/codec/audio_sample_types.h"
+#include "base/codec/multi_channel_resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace base {
+
+namespace {
+
+constexpr size_t kFramesPerMs = AudioJitterBuffer::kSampleRate / 1000;
+
+constexpr size_t framesFromMs(size_t ms)
+{
+    return ms * kFramesPerMs;
+}
+
+const size_t kInitialTargetFrames = framesFromMs(80);
+const size_t kMinTargetFrames = framesFromMs(40);
+const size_t kLowLatencyInitialTargetFrames = framesFromMs(30);
+const size_t kLowLatencyMinTargetFrames = framesFromMs(20);
+const size_t kMaxTargetFrames = framesFromMs(400);
+
+// The target delay is increased after each underrun and decreased after a period of smooth
+// playback.
+const size_t kTargetIncreaseFrames = framesFromMs(20);
+const size_t kTargetDecreaseFrames = framesFromMs(10);
+const size_t kSmoothPlaybackFrames = framesFromMs(10000);
+
+// If there is more data than the target plus this value, then the oldest data is dropped.
+const size_t kMaxExcessFrames = framesFromMs(200);
+
+// Opus can conceal the loss in multiples of 2.5 ms, so 10 ms is requested at a time. After the
+// concealment of 100 ms in a row, the stream is considered paused and the buffer is filled again
+// from the beginning.
+const size_t kConcealFrames = framesFromMs(10);
+const size_t kMaxConcealedRunFrames = framesFromMs(100);
+
+// The drift correction speeds up or slows down the playback by at most 0.5% which is not audible.
+// The average level of the buffer is estimated over about one second.
+const double kMaxRateCorrection = 0.005;
+const double kMinRateChange = 0.0002;
+const size_t kAverageFrames = framesFromMs(1000);
+const size_t kRateUpdateFrames = framesFromMs(500);
+
+const size_t kResamplerRequestFrames = 512;
+
+// The played samples are removed from the buffer when there are at least this number of them.
+const size_t kCompactSamples = framesFromMs(100) * AudioJitterBuffer::kChannels;
+
+} // namespace
+
+AudioJitterBuffer::AudioJitterBuffer(const ConcealCallback& conceal_callback)
+    : conceal_callback_(conceal_callback),
+      target_frames_(kInitialTargetFrames),
+      min_target_frames_(kMinTargetFrames),
+      resampler_(std::make_unique<MultiChannelResampler>(
+          kChannels, 1.0, kResamplerRequestFrames,
+          std::bind(&AudioJitterBuffer::onResamplerRead, this,
+                    std::placeholders::_1, std::placeholders::_2)))
+{
+    // Nothing
+}
+
+AudioJitterBuffer::~AudioJitterBuffer() = default;
+
+void AudioJitterBuffer::addSamples(const int16_t* samples, size_t frames)
+{
+    if (!frames)
+        return;
+
+    if (read_pos_ == buffer_.size())
+    {
+        buffer_.clear();
+        read_pos_ = 0;
+    }
+    else if (read_pos_ >= kCompactSamples)
+    {
+        buffer_.erase(buffer_.begin(), buffer_.begin() + static_cast<ptrdiff_t>(read_pos_));
+        read_pos_ = 0;
+    }
+
+    if (concealed_run_frames_ && is_playing_)
+    {
+        // The data is late. The delay is increased so that the next time the data arrives in time.
+        ++underrun_count_;
+        smooth_frames_ = 0;
+        target_frames_ = std::min(target_frames_ + kTargetIncreaseFrames, kMaxTargetFrames);
+    }
+
+    buffer_.insert(buffer_.end(), samples, samples + frames * kChannels);
+    concealed_run_frames_ = 0;
+}
+
+void AudioJitterBuffer::read(int16_t* samples, size_t frames)
+{
+    if (!is_playing_)
+    {
+        if (bufferedFrames() < target_frames_)
+        {
+            memset(samples, 0, frames * kChannels * sizeof(int16_t));
+            return;
+        }
+
+        is_playing_ = true;
+        smooth_frames_ = 0;
+        average_frames_ = static_cast<double>(bufferedFrames());
+        rate_update_frames_ = 0;
+        resampler_->Flush();
+    }
+
+    dropExcess();
+    updatePlaybackRate(frames);
+
+    if (!output_bus_ || output_bus_->frames() != static_cast<int>(frames))
+        output_bus_ = AudioBus::Create(kChannels, static_cast<int>(frames));
+
+    resampler_->Resample(static_cast<int>(frames), output_bus_.get());
+    output_bus_->ToInterleaved<SignedInt16SampleTypeTraits>(static_cast<int>(frames), samples);
+
+    if (!is_playing_)
+        return;
+
+    smooth_frames_ += frames;
+    if (smooth_frames_ >= kSmoothPlaybackFrames)
+    {
+        smooth_frames_ = 0;
+
+        if (target_frames_ > min_target_frames_)
+        {
+            target_frames_ =
+                std::max(target_frames_ - kTargetDecreaseFrames, min_target_frames_);
+        }
+    }
+}
+
+void AudioJitterBuffer::setLowLatency(bool enable)
+{
+    min_target_frames_ = enable ? kLowLatencyMinTargetFrames : kMinTargetFrames;
+    target_frames_ = enable ? kLowLatencyInitialTargetFrames : kInitialTargetFrames;
+    smooth_frames_ = 0;
+}
+
+size_t AudioJitterBuffer::bufferedFrames() const
+{
+    return (buffer_.size() - read_pos_) / kChannels;
+}
+
+std::chrono::milliseconds AudioJitterBuffer::targetDelay() const
+{
+    return std::chrono::milliseconds(target_frames_ / kFramesPerMs);
+}
+
+void AudioJitterBuffer::readBuffered(int16_t* samples, size_t frames)
+{
+    if (is_playing_ && bufferedFrames() < frames)
+        onUnderrun(frames);
+
+    size_t copied = 0;
+
+    if (is_playing_)
+    {
+        copied = std::min(bufferedFrames(), frames);
+        memcpy(samples, buffer_.data() + read_pos_, copied * kChannels * sizeof(int16_t));
+        read_pos_ += copied * kChannels;
+    }
+
+    memset(samples + copied * kChannels, 0, (frames - copied) * kChannels * sizeof(int16_t));
+}
+
+void AudioJitterBuffer::onResamplerRead(int /* frame_delay */, AudioBus* audio_bus)
+{
+    const size_t frames = static_cast<size_t>(audio_bus->frames());
+
+    resampler_input_.resize(frames * kChannels);
+    readBuffered(resampler_input_.data(), frames);
+
+    audio_bus->FromInterleaved<SignedInt16SampleTypeTraits>(
+        resampler_input_.data(), static_cast<int>(frames));
+}
+
+void AudioJitterBuffer::onUnderrun(size_t frames)
+{
+    while (bufferedFrames() < frames)
+    {
+        if (concealed_run_frames_ >= kMaxConcealedRunFrames)
+        {
+            // The host does not send the audio while it is silent, so a long gap is most likely
+            // a pause and not the network jitter. The target delay is not changed.
+            LOG(LS_INFO) << "Audio stream paused (target delay: " << targetDelay().count()
+                         << " ms)";
+            is_playing_ = false;
+            return;
+        }
+
+        const size_t old_size = buffer_.size();
+        size_t concealed = 0;
+
+        buffer_.resize(old_size + kConcealFrames * kChannels);
+
+        if (conceal_callback_)
+        {
+            concealed = std::min(conceal_callback_(buffer_.data() + old_size, kConcealFrames),
+                                 kConcealFrames);
+        }
+
+        // Silence is inserted if the loss cannot be concealed.
+        if (!concealed)
+        {
+            memset(buffer_.data() + old_size, 0, kConcealFrames * kChannels * sizeof(int16_t));
+            concealed = kConcealFrames;
+        }
+
+        buffer_.resize(old_size + concealed * kChannels);
+
+        concealed_run_frames_ += concealed;
+        concealed_frames_ += static_cast<int64_t>(concealed);
+    }
+}
+
+void AudioJitterBuffer::updatePlaybackRate(size_t frames)
+{
+    const double weight = std::min(static_cast<double>(frames) / kAverageFrames, 1.0);
+    average_frames_ += (static_cast<double>(bufferedFrames()) - average_frames_) * weight;
+
+    rate_update_frames_ += frames;
+    if (rate_update_frames_ < kRateUpdateFrames)
+        return;
+
+    rate_update_frames_ = 0;
+
+    // If the host clock is faster, then the buffer grows and the playback is sped up. If it is
+    // slower, then the buffer shrinks and the playback is slowed down.
+    const double target = static_cast<double>(target_frames_);
+    const double correction = std::clamp(
+        kMaxRateCorrection * (average_frames_ - target) / target,
+        -kMaxRateCorrection, kMaxRateCorrection);
+    const double rate = 1.0 + correction;
+
+    if (std::abs(rate - playback_rate_) < kMinRateChange)
+        return;
+
+    playback_rate_ = rate;
+    resampler_->SetRatio(playback_rate_);
+}
+
+void AudioJitterBuffer::dropExcess()
+{
+    const size_t buffered = bufferedFrames();
+    if (buffered <= target_frames_ + kMaxExcessFrames)
+        return;
+
+    const size_t dropped = buffered - target_frames_;
+
+    read_pos_ += dropped * kChannels;
+    dropped_frames_ += static_cast<int64_t>(dropped);
+    average_frames_ = static_cast<double>(target_frames_);
+
+    LOG(LS_INFO) << "Dropped " << dropped / kFramesPerMs << " ms of audio";
+}
+
+} // namespace base
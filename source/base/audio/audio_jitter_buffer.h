@@ -0,0 +1,118 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef BASE_AUDIO_AUDIO_JITTER_BUFFER_H
+#define BASE_AUDIO_AUDIO_JITTER_BUFFER_H
+
+#include "base/macros_magic.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace base {
+
+class AudioBus;
+class MultiChannelResampler;
+
+// Buffers the decoded audio between the network and the audio output.
+//
+// The delay of the buffer follows the network jitter: it grows each time the data arrives too
+// late and slowly decreases while the playback is smooth. The difference between the clocks of the
+// host and the client is compensated by playing the audio slightly faster or slower with the
+// resampler, so the delay stays near the target without audible gaps. Missing data is replaced by
+// the audio from the concealment callback. If no data arrives for a longer time, then the host is
+// silent and the buffer plays silence until the next data.
+//
+// The samples are interleaved 16-bit stereo at 48 kHz, as AudioOutput expects. The class is not
+// thread-safe.
+class AudioJitterBuffer
+{
+public:
+    // Writes up to |frames| of audio in place of the missing data to |samples|. Returns the number
+    // of frames written.
+    using ConcealCallback = std::function<size_t(int16_t* samples, size_t frames)>;
+
+    explicit AudioJitterBuffer(const ConcealCallback& conceal_callback = nullptr);
+    ~AudioJitterBuffer();
+
+    static constexpr size_t kChannels = 2;
+    static const size_t kSampleRate = 48000;
+
+    void addSamples(const int16_t* samples, size_t frames);
+
+    // Writes exactly |frames| of audio to |samples|. Silence is written while the buffer is filled.
+    void read(int16_t* samples, size_t frames);
+
+    // Starts from a smaller target delay and allows it to go lower. The data that is already
+    // buffered is played with the drift correction.
+    void setLowLatency(bool enable);
+
+    bool isPlaying() const { return is_playing_; }
+    size_t bufferedFrames() const;
+    std::chrono::milliseconds targetDelay() const;
+
+    // The ratio of the input and output rates. Greater than 1 if the buffer is played faster.
+    double playbackRate() const { return playback_rate_; }
+
+    // The number of times the data arrived after the buffer ran out of it.
+    int64_t underrunCount() const { return underrun_count_; }
+    int64_t concealedFrames() const { return concealed_frames_; }
+    int64_t droppedFrames() const { return dropped_frames_; }
+
+private:
+    void readBuffered(int16_t* samples, size_t frames);
+    void onResamplerRead(int frame_delay, AudioBus* audio_bus);
+    void onUnderrun(size_t frames);
+    void updatePlaybackRate(size_t frames);
+    void dropExcess();
+
+    ConcealCallback conceal_callback_;
+
+    // Interleaved samples. The samples before |read_pos_| are already played.
+    std::vector<int16_t> buffer_;
+    size_t read_pos_ = 0;
+
+    size_t target_frames_;
+    size_t min_target_frames_;
+    bool is_playing_ = false;
+
+    // Frames played since the last underrun or decrease of the target delay.
+    size_t smooth_frames_ = 0;
+
+    // Frames concealed since the last real data.
+    size_t concealed_run_frames_ = 0;
+
+    std::unique_ptr<MultiChannelResampler> resampler_;
+    std::unique_ptr<AudioBus> output_bus_;
+    std::vector<int16_t> resampler_input_;
+    double playback_rate_ = 1.0;
+    double average_frames_ = 0;
+    size_t rate_update_frames_ = 0;
+
+    int64_t underrun_count_ = 0;
+    int64_t concealed_frames_ = 0;
+    int64_t dropped_frames_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(AudioJitterBuffer);
+};
+
+} // namespace base
+
+#endif // BASE_AUDIO_AUDIO_JITTER_BUFFER_H
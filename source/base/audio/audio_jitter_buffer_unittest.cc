@@ -0,0 +1,194 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/audio/audio_jitter_buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace base {
+
+namespace {
+
+const size_t kFramesPerMs = AudioJitterBuffer::kSampleRate / 1000;
+const size_t kReadFrames = 10 * kFramesPerMs;
+const int16_t kSampleValue = 1000;
+
+void addSamples(AudioJitterBuffer* buffer, size_t frames)
+{
+    std::vector<int16_t> samples(frames * AudioJitterBuffer::kChannels, kSampleValue);
+    buffer->addSamples(samples.data(), frames);
+}
+
+bool readSamples(AudioJitterBuffer* buffer, size_t frames)
+{
+    std::vector<int16_t> samples(frames * AudioJitterBuffer::kChannels, 1);
+    bool has_sound = false;
+
+    for (size_t pos = 0; pos < frames; pos += kReadFrames)
+    {
+        buffer->read(samples.data() + pos * AudioJitterBuffer::kChannels, kReadFrames);
+    }
+
+    for (int16_t sample : samples)
+    {
+        if (sample != 0)
+            has_sound = true;
+    }
+
+    return has_sound;
+}
+
+size_t targetFrames(const AudioJitterBuffer& buffer)
+{
+    return static_cast<size_t>(buffer.targetDelay().count()) * kFramesPerMs;
+}
+
+} // namespace
+
+TEST(AudioJitterBufferTest, SilenceWhilePrebuffering)
+{
+    AudioJitterBuffer buffer;
+
+    addSamples(&buffer, targetFrames(buffer) / 2);
+    EXPECT_FALSE(readSamples(&buffer, kReadFrames * 4));
+    EXPECT_FALSE(buffer.isPlaying());
+    EXPECT_EQ(buffer.bufferedFrames(), targetFrames(buffer) / 2);
+}
+
+TEST(AudioJitterBufferTest, StartsAtTargetDelay)
+{
+    AudioJitterBuffer buffer;
+
+    addSamples(&buffer, targetFrames(buffer));
+    EXPECT_TRUE(readSamples(&buffer, kReadFrames * 4));
+    EXPECT_TRUE(buffer.isPlaying());
+    EXPECT_EQ(buffer.underrunCount(), 0);
+    EXPECT_DOUBLE_EQ(buffer.playbackRate(), 1.0);
+}
+
+TEST(AudioJitterBufferTest, LateDataIsConcealed)
+{
+    size_t conceal_calls = 0;
+
+    AudioJitterBuffer buffer([&](int16_t* samples, size_t frames)
+    {
+        ++conceal_calls;
+        std::fill(samples, samples + frames * AudioJitterBuffer::kChannels, kSampleValue);
+        return frames;
+    });
+
+    const std::chrono::milliseconds initial_delay = buffer.targetDelay();
+
+    addSamples(&buffer, targetFrames(buffer));
+    EXPECT_TRUE(readSamples(&buffer, targetFrames(buffer) + kReadFrames * 4));
+
+    EXPECT_TRUE(buffer.isPlaying());
+    EXPECT_GT(conceal_calls, 0u);
+    EXPECT_GT(buffer.concealedFrames(), 0);
+
+    // The data arrives while the loss is concealed.
+    addSamples(&buffer, kReadFrames);
+
+    EXPECT_EQ(buffer.underrunCount(), 1);
+    EXPECT_GT(buffer.targetDelay(), initial_delay);
+}
+
+TEST(AudioJitterBufferTest, PauseKeepsTargetDelay)
+{
+    AudioJitterBuffer buffer;
+
+    const std::chrono::milliseconds initial_delay = buffer.targetDelay();
+
+    addSamples(&buffer, targetFrames(buffer));
+    readSamples(&buffer, targetFrames(buffer) + 500 * kFramesPerMs);
+
+    EXPECT_FALSE(buffer.isPlaying());
+    EXPECT_LE(buffer.concealedFrames(), static_cast<int64_t>(100 * kFramesPerMs));
+
+    // The data after a long gap starts the playback again with the same delay.
+    addSamples(&buffer, kReadFrames);
+
+    EXPECT_EQ(buffer.underrunCount(), 0);
+    EXPECT_EQ(buffer.targetDelay(), initial_delay);
+    EXPECT_FALSE(readSamples(&buffer, kReadFrames));
+}
+
+TEST(AudioJitterBufferTest, LowLatency)
+{
+    AudioJitterBuffer buffer;
+
+    const std::chrono::milliseconds default_delay = buffer.targetDelay();
+
+    buffer.setLowLatency(true);
+    EXPECT_LT(buffer.targetDelay(), default_delay);
+
+    addSamples(&buffer, targetFrames(buffer));
+    EXPECT_TRUE(readSamples(&buffer, kReadFrames * 2));
+
+    buffer.setLowLatency(false);
+    EXPECT_EQ(buffer.targetDelay(), default_delay);
+}
+
+TEST(AudioJitterBufferTest, DropsExcess)
+{
+    AudioJitterBuffer buffer;
+
+    addSamples(&buffer, targetFrames(buffer) + 1000 * kFramesPerMs);
+    readSamples(&buffer, kReadFrames);
+
+    EXPECT_GT(buffer.droppedFrames(), 0);
+    EXPECT_LE(buffer.bufferedFrames(), targetFrames(buffer));
+}
+
+TEST(AudioJitterBufferTest, SpeedsUpWhenOverfilled)
+{
+    AudioJitterBuffer buffer;
+
+    // The buffer is kept above the target, but not enough to drop the data.
+    addSamples(&buffer, targetFrames(buffer) + 150 * kFramesPerMs);
+
+    for (int i = 0; i < 100; ++i)
+    {
+        readSamples(&buffer, kReadFrames);
+        addSamples(&buffer, kReadFrames);
+    }
+
+    EXPECT_GT(buffer.playbackRate(), 1.0);
+    EXPECT_EQ(buffer.droppedFrames(), 0);
+}
+
+TEST(AudioJitterBufferTest, SlowsDownWhenUnderfilled)
+{
+    AudioJitterBuffer buffer;
+
+    addSamples(&buffer, targetFrames(buffer));
+    readSamples(&buffer, 40 * kFramesPerMs);
+
+    for (int i = 0; i < 100; ++i)
+    {
+        readSamples(&buffer, kReadFrames);
+        addSamples(&buffer, kReadFrames);
+    }
+
+    EXPECT_LT(buffer.playbackRate(), 1.0);
+    EXPECT_EQ(buffer.underrunCount(), 0);
+}
+
+} // namespace base
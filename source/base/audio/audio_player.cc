@@ -20,11 +20,32 @@
 
 #include "base/logging.h"
 #include "base/audio/audio_output.h"
-#include "proto/desktop.pb.h"
+#include "base/codec/audio_decoder.h"
+
+#include <cstring>
 
 namespace base {
 
+namespace {
+
+const size_t kFrameSize = AudioOutput::kChannels * AudioOutput::kBytesPerSample;
+const size_t kFramesPerMs = AudioOutput::kSampleRate / 1000;
+
+// The decoding thread keeps this amount of audio in the ring buffer ahead of the output. It is
+// refilled in 10 ms chunks at least every |kRefillInterval|.
+const size_t kRingBufferFrames = 200 * kFramesPerMs;
+const size_t kRingBufferLevelFrames = 40 * kFramesPerMs;
+const size_t kLowLatencyRingBufferLevelFrames = 20 * kFramesPerMs;
+const size_t kChunkFrames = 10 * kFramesPerMs;
+const std::chrono::milliseconds kRefillInterval { 5 };
+
+} // namespace
+
 AudioPlayer::AudioPlayer()
+    : ring_buffer_(AudioOutput::kChannels, kRingBufferFrames),
+      jitter_buffer_(std::bind(&AudioPlayer::onConceal, this,
+                               std::placeholders::_1, std::placeholders::_2)),
+      ring_buffer_level_(kRingBufferLevelFrames)
 {
     LOG(LS_INFO) << "Ctor";
 }
@@ -32,6 +53,22 @@ AudioPlayer::AudioPlayer()
 AudioPlayer::~AudioPlayer()
 {
     LOG(LS_INFO) << "Dtor";
+
+    // The output must be stopped before the buffers are destroyed.
+    output_.reset();
+
+    {
+        std::scoped_lock lock(incoming_queue_lock_);
+        is_stopping_ = true;
+    }
+
+    incoming_queue_event_.notify_one();
+    thread_.stop();
+
+    LOG(LS_INFO) << "Underruns: " << jitter_buffer_.underrunCount()
+                 << " (concealed: " << jitter_buffer_.concealedFrames()
+                 << " frames, dropped: " << jitter_buffer_.droppedFrames()
+                 << " frames, output: " << ring_underrun_count_.load() << ")";
 }
 
 // static
@@ -48,59 +85,149 @@ std::unique_ptr<AudioPlayer> AudioPlayer::create()
 }
 
 void AudioPlayer::addPacket(std::unique_ptr<proto::AudioPacket> packet)
+{
+    {
+        std::scoped_lock lock(incoming_queue_lock_);
+        incoming_queue_.emplace(std::move(packet));
+    }
+
+    incoming_queue_event_.notify_one();
+}
+
+void AudioPlayer::setLowLatency(bool enable)
 {
     std::scoped_lock lock(incoming_queue_lock_);
-    incoming_queue_.emplace(std::move(packet));
+    low_latency_ = enable;
 }
 
 size_t AudioPlayer::onMoreDataRequired(void* data, size_t size)
 {
-    if (work_queue_.empty())
+    // Called on the real-time audio thread. Must not lock or allocate.
+    int16_t* samples = reinterpret_cast<int16_t*>(data);
+    const size_t frames = size / kFrameSize;
+
+    const size_t read_frames = ring_buffer_.read(samples, frames);
+    if (read_frames < frames)
+    {
+        memset(samples + read_frames * AudioOutput::kChannels, 0,
+               (frames - read_frames) * kFrameSize);
+        ring_underrun_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return size;
+}
+
+void AudioPlayer::run()
+{
+    while (true)
     {
         {
-            std::scoped_lock lock(incoming_queue_lock_);
+            std::unique_lock lock(incoming_queue_lock_);
+
+            incoming_queue_event_.wait_for(lock, kRefillInterval, [this]()
+            {
+                return is_stopping_ || !incoming_queue_.empty();
+            });
+
+            if (is_stopping_)
+                return;
+
             work_queue_.swap(incoming_queue_);
+
+            if (low_latency_ != jitter_buffer_low_latency_)
+            {
+                LOG(LS_INFO) << "Low latency playback: " << low_latency_;
+
+                jitter_buffer_low_latency_ = low_latency_;
+                jitter_buffer_.setLowLatency(low_latency_);
+                ring_buffer_level_ =
+                    low_latency_ ? kLowLatencyRingBufferLevelFrames : kRingBufferLevelFrames;
+            }
         }
 
-        if (work_queue_.empty())
-            return 0;
+        while (!work_queue_.empty())
+        {
+            decodePacket(*work_queue_.front());
+            work_queue_.pop();
+        }
+
+        fillRingBuffer();
     }
+}
 
-    size_t target_pos = 0;
+void AudioPlayer::fillRingBuffer()
+{
+    int16_t chunk[kChunkFrames * AudioOutput::kChannels];
 
-    while (!work_queue_.empty())
+    // The jitter buffer is read at the pace of the output, so its delay and drift correction work
+    // as if it was read by the output directly.
+    while (ring_buffer_.readAvailable() < ring_buffer_level_ &&
+           ring_buffer_.writeAvailable() >= kChunkFrames)
     {
-        const std::string& packet_data = work_queue_.front()->data(0);
-
-        size_t source_size = packet_data.size() - source_pos_;
-        size_t target_size = size - target_pos;
-        size_t num_bytes = std::min(target_size, source_size);
+        jitter_buffer_.read(chunk, kChunkFrames);
+        ring_buffer_.write(chunk, kChunkFrames);
+    }
+}
 
-        memcpy(reinterpret_cast<uint8_t*>(data) + target_pos,
-               packet_data.data() + source_pos_,
-               num_bytes);
-        target_pos += num_bytes;
+void AudioPlayer::decodePacket(const proto::AudioPacket& packet)
+{
+    if (packet.encoding() != encoding_)
+    {
+        encoding_ = packet.encoding();
 
-        if (target_size < source_size)
-        {
-            source_pos_ += num_bytes;
-            break;
-        }
+        if (encoding_ == proto::AUDIO_ENCODING_RAW)
+            decoder_.reset();
         else
-        {
-            work_queue_.pop();
-            source_pos_ = 0;
+            decoder_ = AudioDecoder::create(encoding_);
 
-            if (target_size == source_size)
-                break;
-        }
+        LOG(LS_INFO) << "Audio encoding changed to: " << encoding_;
+    }
+
+    std::unique_ptr<proto::AudioPacket> decoded_packet;
+    const proto::AudioPacket* raw_packet = &packet;
+
+    if (encoding_ != proto::AUDIO_ENCODING_RAW)
+    {
+        if (!decoder_)
+            return;
+
+        decoded_packet = decoder_->decode(packet);
+        if (!decoded_packet)
+            return;
+
+        raw_packet = decoded_packet.get();
+    }
+
+    if (static_cast<size_t>(raw_packet->channels()) != AudioOutput::kChannels ||
+        static_cast<size_t>(raw_packet->bytes_per_sample()) != AudioOutput::kBytesPerSample ||
+        static_cast<size_t>(raw_packet->sampling_rate()) != AudioOutput::kSampleRate)
+    {
+        LOG(LS_WARNING) << "Unsupported audio format: " << raw_packet->channels()
+                        << " channels with " << raw_packet->sampling_rate()
+                        << " samples per second";
+        return;
     }
 
-    return target_pos;
+    for (int i = 0; i < raw_packet->data_size(); ++i)
+    {
+        const std::string& data = raw_packet->data(i);
+        jitter_buffer_.addSamples(
+            reinterpret_cast<const int16_t*>(data.data()), data.size() / kFrameSize);
+    }
+}
+
+size_t AudioPlayer::onConceal(int16_t* samples, size_t frames)
+{
+    if (!decoder_)
+        return 0;
+
+    return decoder_->conceal(samples, frames);
 }
 
 bool AudioPlayer::init()
 {
+    thread_.start(std::bind(&AudioPlayer::run, this));
+
     output_ = AudioOutput::create(std::bind(
         &AudioPlayer::onMoreDataRequired, this, std::placeholders::_1, std::placeholders::_2));
     if (!output_)
@@ -20,39 +20,68 @@
 #define BASE_AUDIO_AUDIO_PLAYER_H
 
 #include "base/macros_magic.h"
+#include "base/audio/audio_jitter_buffer.h"
+#include "base/audio/audio_ring_buffer.h"
+#include "base/threading/simple_thread.h"
+#include "proto/desktop.pb.h"
 
+#include <condition_variable>
 #include <memory>
 #include <mutex>
 #include <queue>
 
-namespace proto {
-class AudioPacket;
-} // namespace proto
-
 namespace base {
 
+class AudioDecoder;
 class AudioOutput;
 
+// Plays the audio packets received from the host. The packets are decoded on a separate thread
+// and pass through the jitter buffer, so that the loss is concealed by the decoder. The audio
+// output callback only reads the prepared samples from a ring buffer, so it does not wait for
+// locks or allocate memory.
 class AudioPlayer
 {
 public:
     ~AudioPlayer();
 
     static std::unique_ptr<AudioPlayer> create();
+
+    // Adds an encoded packet. Can be called from any thread.
     void addPacket(std::unique_ptr<proto::AudioPacket> packet);
 
+    // Uses smaller buffers for voice communication. Can be called from any thread.
+    void setLowLatency(bool enable);
+
 private:
     AudioPlayer();
     bool init();
     size_t onMoreDataRequired(void* data, size_t size);
+    void run();
+    void fillRingBuffer();
+    void decodePacket(const proto::AudioPacket& packet);
+    size_t onConceal(int16_t* samples, size_t frames);
 
     std::unique_ptr<AudioOutput> output_;
 
+    // Written by the decoding thread and read by the audio output callback.
+    AudioRingBuffer ring_buffer_;
+    std::atomic<int64_t> ring_underrun_count_ { 0 };
+
+    SimpleThread thread_;
+
     std::queue<std::unique_ptr<proto::AudioPacket>> incoming_queue_;
     std::mutex incoming_queue_lock_;
+    std::condition_variable incoming_queue_event_;
+    bool is_stopping_ = false;
+    bool low_latency_ = false;
 
+    // Used only on the decoding thread.
     std::queue<std::unique_ptr<proto::AudioPacket>> work_queue_;
-    size_t source_pos_ = 0;
+    std::unique_ptr<AudioDecoder> decoder_;
+    proto::AudioEncoding encoding_ = proto::AUDIO_ENCODING_UNKNOWN;
+    AudioJitterBuffer jitter_buffer_;
+    bool jitter_buffer_low_latency_ = false;
+    size_t ring_buffer_level_;
 
     DISALLOW_COPY_AND_ASSIGN(AudioPlayer);
 };
@@ -0,0 +1,103 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/audio/audio_ring_buffer.h"
+
+#include "base/logging.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace base {
+
+namespace {
+
+size_t roundUpToPowerOfTwo(size_t value)
+{
+    size_t result = 1;
+    while (result < value)
+        result <<= 1;
+    return result;
+}
+
+} // namespace
+
+AudioRingBuffer::AudioRingBuffer(size_t channels, size_t capacity_frames)
+    : channels_(channels),
+      capacity_(roundUpToPowerOfTwo(capacity_frames)),
+      mask_(capacity_ - 1),
+      samples_(std::make_unique<int16_t[]>(capacity_ * channels))
+{
+    DCHECK_GT(channels_, 0u);
+}
+
+AudioRingBuffer::~AudioRingBuffer() = default;
+
+size_t AudioRingBuffer::write(const int16_t* samples, size_t frames)
+{
+    const size_t write_pos = write_pos_.load(std::memory_order_relaxed);
+    const size_t read_pos = read_pos_.load(std::memory_order_acquire);
+
+    frames = std::min(frames, capacity_ - (write_pos - read_pos));
+    if (!frames)
+        return 0;
+
+    // The data may wrap around the end of the buffer.
+    const size_t offset = write_pos & mask_;
+    const size_t first_part = std::min(frames, capacity_ - offset);
+
+    memcpy(samples_.get() + offset * channels_, samples,
+           first_part * channels_ * sizeof(int16_t));
+    memcpy(samples_.get(), samples + first_part * channels_,
+           (frames - first_part) * channels_ * sizeof(int16_t));
+
+    write_pos_.store(write_pos + frames, std::memory_order_release);
+    return frames;
+}
+
+size_t AudioRingBuffer::read(int16_t* samples, size_t frames)
+{
+    const size_t read_pos = read_pos_.load(std::memory_order_relaxed);
+    const size_t write_pos = write_pos_.load(std::memory_order_acquire);
+
+    frames = std::min(frames, write_pos - read_pos);
+    if (!frames)
+        return 0;
+
+    const size_t offset = read_pos & mask_;
+    const size_t first_part = std::min(frames, capacity_ - offset);
+
+    memcpy(samples, samples_.get() + offset * channels_,
+           first_part * channels_ * sizeof(int16_t));
+    memcpy(samples + first_part * channels_, samples_.get(),
+           (frames - first_part) * channels_ * sizeof(int16_t));
+
+    read_pos_.store(read_pos + frames, std::memory_order_release);
+    return frames;
+}
+
+size_t AudioRingBuffer::readAvailable() const
+{
+    return write_pos_.load(std::memory_order_acquire) - read_pos_.load(std::memory_order_acquire);
+}
+
+size_t AudioRingBuffer::writeAvailable() const
+{
+    return capacity_ - readAvailable();
+}
+
+} // namespace base
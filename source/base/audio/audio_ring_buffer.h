@@ -0,0 +1,70 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef BASE_AUDIO_AUDIO_RING_BUFFER_H
+#define BASE_AUDIO_AUDIO_RING_BUFFER_H
+
+#include "base/macros_magic.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace base {
+
+// Lock-free ring buffer of interleaved 16-bit samples for one producer thread and one consumer
+// thread. The memory is allocated in the constructor, so reading and writing never allocate and
+// can be done on a real-time audio thread.
+class AudioRingBuffer
+{
+public:
+    // The capacity is rounded up to a power of two.
+    AudioRingBuffer(size_t channels, size_t capacity_frames);
+    ~AudioRingBuffer();
+
+    // Writes up to |frames| from |samples|. Returns the number of written frames. Must be called
+    // only from the producer thread.
+    size_t write(const int16_t* samples, size_t frames);
+
+    // Reads up to |frames| to |samples|. Returns the number of read frames. Must be called only
+    // from the consumer thread.
+    size_t read(int16_t* samples, size_t frames);
+
+    // The values may be outdated already when they are returned. The producer can rely on
+    // writeAvailable() and the consumer on readAvailable() as lower bounds.
+    size_t readAvailable() const;
+    size_t writeAvailable() const;
+
+    size_t capacity() const { return capacity_; }
+
+private:
+    const size_t channels_;
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<int16_t[]> samples_;
+
+    // The positions are counted in frames and only grow, so that a full buffer can be told from an
+    // empty one. They are kept in separate cache lines to avoid false sharing between the threads.
+    alignas(64) std::atomic<size_t> write_pos_ { 0 };
+    alignas(64) std::atomic<size_t> read_pos_ { 0 };
+
+    DISALLOW_COPY_AND_ASSIGN(AudioRingBuffer);
+};
+
+} // namespace base
+
+#endif // BASE_AUDIO_AUDIO_RING_BUFFER_H
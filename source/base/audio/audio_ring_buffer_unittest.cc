@@ -0,0 +1,140 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/audio/audio_ring_buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace base {
+
+namespace {
+
+const size_t kChannels = 2;
+
+std::vector<int16_t> makeSamples(size_t frames, int16_t first_value)
+{
+    std::vector<int16_t> samples(frames * kChannels);
+    for (size_t i = 0; i < samples.size(); ++i)
+        samples[i] = static_cast<int16_t>(first_value + i);
+    return samples;
+}
+
+} // namespace
+
+TEST(AudioRingBufferTest, CapacityIsPowerOfTwo)
+{
+    AudioRingBuffer buffer(kChannels, 100);
+
+    EXPECT_EQ(buffer.capacity(), 128u);
+    EXPECT_EQ(buffer.readAvailable(), 0u);
+    EXPECT_EQ(buffer.writeAvailable(), 128u);
+}
+
+TEST(AudioRingBufferTest, ReadEmpty)
+{
+    AudioRingBuffer buffer(kChannels, 16);
+    std::vector<int16_t> samples(16 * kChannels);
+
+    EXPECT_EQ(buffer.read(samples.data(), 16), 0u);
+}
+
+TEST(AudioRingBufferTest, WriteFull)
+{
+    AudioRingBuffer buffer(kChannels, 16);
+    std::vector<int16_t> samples = makeSamples(20, 0);
+
+    EXPECT_EQ(buffer.write(samples.data(), 20), 16u);
+    EXPECT_EQ(buffer.writeAvailable(), 0u);
+    EXPECT_EQ(buffer.write(samples.data(), 1), 0u);
+    EXPECT_EQ(buffer.readAvailable(), 16u);
+}
+
+TEST(AudioRingBufferTest, WrapAround)
+{
+    AudioRingBuffer buffer(kChannels, 16);
+    std::vector<int16_t> output(16 * kChannels);
+
+    for (int16_t round = 0; round < 10; ++round)
+    {
+        // 12 frames do not divide the capacity, so the data wraps at a different place each time.
+        std::vector<int16_t> input = makeSamples(12, round * 100);
+
+        ASSERT_EQ(buffer.write(input.data(), 12), 12u);
+        ASSERT_EQ(buffer.read(output.data(), 16), 12u);
+
+        for (size_t i = 0; i < input.size(); ++i)
+            ASSERT_EQ(output[i], input[i]);
+    }
+}
+
+TEST(AudioRingBufferTest, ProducerAndConsumerThreads)
+{
+    const size_t kTotalFrames = 100000;
+    const size_t kChunkFrames = 97;
+
+    AudioRingBuffer buffer(1, 1024);
+
+    std::thread producer([&]()
+    {
+        std::vector<int16_t> chunk(kChunkFrames);
+        size_t frame = 0;
+
+        while (frame < kTotalFrames)
+        {
+            const size_t frames = std::min(kChunkFrames, kTotalFrames - frame);
+            for (size_t i = 0; i < frames; ++i)
+                chunk[i] = static_cast<int16_t>(frame + i);
+
+            size_t written = 0;
+            while (written < frames)
+            {
+                written += buffer.write(chunk.data() + written, frames - written);
+                std::this_thread::yield();
+            }
+
+            frame += frames;
+        }
+    });
+
+    std::vector<int16_t> chunk(kChunkFrames);
+    size_t frame = 0;
+    bool is_valid = true;
+
+    while (frame < kTotalFrames)
+    {
+        const size_t frames = buffer.read(chunk.data(), kChunkFrames);
+        for (size_t i = 0; i < frames; ++i)
+        {
+            if (chunk[i] != static_cast<int16_t>(frame + i))
+                is_valid = false;
+        }
+
+        frame += frames;
+        std::this_thread::yield();
+    }
+
+    producer.join();
+
+    EXPECT_TRUE(is_valid);
+    EXPECT_EQ(buffer.readAvailable(), 0u);
+}
+
+} // namespace base
@@ -24,7 +24,7 @@
 
 namespace base {
 
-// Helper used in audio capturers to detect and drop silent audio packets.
+// Helper used in audio capturers and encoders to detect and drop silent audio packets.
 class AudioSilenceDetector
 {
 public:
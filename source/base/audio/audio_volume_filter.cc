@@ -18,6 +18,10 @@
 
 #include "base/audio/audio_volume_filter.h"
 
+#include "base/codec/vector_math.h"
+
+#include <algorithm>
+
 namespace base {
 
 AudioVolumeFilter::AudioVolumeFilter(int silence_threshold)
@@ -44,12 +48,9 @@ bool AudioVolumeFilter::apply(int16_t* data, size_t frames)
         return true;
 
     const int sample_count = static_cast<int>(frames) * silence_detector_.channels();
-    const int32_t level_int = static_cast<int32_t>(level * 65536);
+    const int32_t level_int = std::clamp(static_cast<int32_t>(level * 65536), 0, 65535);
 
-    for (int i = 0; i < sample_count; i++)
-    {
-        data[i] = (static_cast<int32_t>(data[i]) * level_int) >> 16;
-    }
+    applyGainInt16(data, sample_count, level_int);
 
     return true;
 }
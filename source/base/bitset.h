@@ -19,14 +19,24 @@
 #ifndef BASE_BITSET_H
 #define BASE_BITSET_H
 
-#include <limits>
+#include "build/build_config.h"
+
 #include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#if defined(CC_MSVC)
+#include <intrin.h>
+#endif // defined(CC_MSVC)
 
 namespace base {
 
 template<typename NumericType>
 class BitSet
 {
+    static_assert(sizeof(NumericType) <= sizeof(uint64_t));
+
 public:
     BitSet() = default;
     BitSet(NumericType value) : value_(value) { /* Nothing */ }
@@ -117,15 +127,41 @@ public:
     // Returns the number of bits that are set to true.
     size_t count() const
     {
-        size_t counter = 0;
+        uint64_t value = static_cast<UnsignedType>(value_);
+
+#if defined(CC_GCC)
+        return static_cast<size_t>(__builtin_popcountll(value));
+#else
+        // The bits are counted in pairs, nibbles and bytes in parallel, then the bytes are summed.
+        value = value - ((value >> 1) & 0x5555555555555555ULL);
+        value = (value & 0x3333333333333333ULL) + ((value >> 2) & 0x3333333333333333ULL);
+        value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        return static_cast<size_t>((value * 0x0101010101010101ULL) >> 56);
+#endif
+    }
 
-        for (size_t pos = 0; pos < size(); ++pos)
+    // Returns the position of the lowest bit that is set to true or size() if there is none.
+    size_t findFirst() const
+    {
+        uint64_t value = static_cast<UnsignedType>(value_);
+        if (!value)
+            return size();
+
+#if defined(CC_GCC)
+        return static_cast<size_t>(__builtin_ctzll(value));
+#elif defined(CC_MSVC) && defined(ARCH_CPU_64_BITS)
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return static_cast<size_t>(index);
+#else
+        size_t index = 0;
+        while (!(value & 1))
         {
-            if (test(pos))
-                ++counter;
+            value >>= 1;
+            ++index;
         }
-
-        return counter;
+        return index;
+#endif
     }
 
     // Returns numberic value of bitset.
@@ -151,6 +187,8 @@ public:
     }
 
 private:
+    using UnsignedType = std::make_unsigned_t<NumericType>;
+
     NumericType value_ = 0;
 };
 
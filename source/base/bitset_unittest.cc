@@ -210,4 +210,24 @@ TEST(BitSetTest, Range8)
     }
 }
 
+TEST(BitSetTest, Count)
+{
+    EXPECT_EQ(BitSet<uint64_t>(0).count(), 0);
+    EXPECT_EQ(BitSet<uint64_t>(0xFFFFFFFFFFFFFFFF).count(), 64);
+    EXPECT_EQ(BitSet<uint64_t>(0x8000000000000001).count(), 2);
+    EXPECT_EQ(BitSet<uint32_t>(0xAAAAAAAA).count(), 16);
+    EXPECT_EQ(BitSet<uint16_t>(0xF00F).count(), 8);
+    EXPECT_EQ(BitSet<uint8_t>(0x81).count(), 2);
+}
+
+TEST(BitSetTest, FindFirst)
+{
+    EXPECT_EQ(BitSet<uint64_t>(0).findFirst(), 64);
+    EXPECT_EQ(BitSet<uint64_t>(1).findFirst(), 0);
+    EXPECT_EQ(BitSet<uint64_t>(0x8000000000000000).findFirst(), 63);
+    EXPECT_EQ(BitSet<uint32_t>(0xAAAAAAA0).findFirst(), 5);
+    EXPECT_EQ(BitSet<uint16_t>(0).findFirst(), 16);
+    EXPECT_EQ(BitSet<uint8_t>(0x80).findFirst(), 7);
+}
+
 } // namespace base
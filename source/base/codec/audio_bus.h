@@ -21,10 +21,12 @@
 
 #include "base/macros_magic.h"
 #include "base/codec/audio_sample_types.h"
+#include "base/codec/vector_math.h"
 #include "base/memory/aligned_memory.h"
 
 #include <cstdint>
 #include <memory>
+#include <type_traits>
 #include <vector>
 
 namespace base {
@@ -264,8 +266,8 @@ void AudioBus::ToInterleavedPartial(
         this, read_offset_in_frames, num_frames_to_read, dest);
 }
 
-// TODO(chfremer): Consider using vector instructions to speed this up,
-//                 https://crbug.com/619628
+// 16-bit mono and stereo are the formats of the audio streams, so they are converted with vector
+// instructions. Other formats use the generic loop.
 template <class SourceSampleTypeTraits>
 void AudioBus::CopyConvertFromInterleavedSourceToAudioBus(
     const typename SourceSampleTypeTraits::ValueType* source_buffer,
@@ -274,6 +276,25 @@ void AudioBus::CopyConvertFromInterleavedSourceToAudioBus(
     AudioBus* dest)
 {
     const int channels = dest->channels();
+
+    if constexpr (std::is_same_v<SourceSampleTypeTraits, SignedInt16SampleTypeTraits>)
+    {
+        if (channels == 1)
+        {
+            convertInt16ToFloat(source_buffer, num_frames_to_write,
+                                dest->channel(0) + write_offset_in_frames);
+            return;
+        }
+
+        if (channels == 2)
+        {
+            deinterleaveInt16Stereo(source_buffer, num_frames_to_write,
+                                    dest->channel(0) + write_offset_in_frames,
+                                    dest->channel(1) + write_offset_in_frames);
+            return;
+        }
+    }
+
     for (int ch = 0; ch < channels; ++ch)
     {
         float* channel_data = dest->channel(ch);
@@ -287,8 +308,6 @@ void AudioBus::CopyConvertFromInterleavedSourceToAudioBus(
     }
 }
 
-// TODO(chfremer): Consider using vector instructions to speed this up,
-//                 https://crbug.com/619628
 template <class TargetSampleTypeTraits>
 void AudioBus::CopyConvertFromAudioBusToInterleavedTarget(
     const AudioBus* source,
@@ -297,6 +316,25 @@ void AudioBus::CopyConvertFromAudioBusToInterleavedTarget(
     typename TargetSampleTypeTraits::ValueType* dest_buffer)
 {
     const int channels = source->channels();
+
+    if constexpr (std::is_same_v<TargetSampleTypeTraits, SignedInt16SampleTypeTraits>)
+    {
+        if (channels == 1)
+        {
+            convertFloatToInt16(source->channel(0) + read_offset_in_frames, num_frames_to_read,
+                                dest_buffer);
+            return;
+        }
+
+        if (channels == 2)
+        {
+            interleaveInt16Stereo(source->channel(0) + read_offset_in_frames,
+                                  source->channel(1) + read_offset_in_frames,
+                                  num_frames_to_read, dest_buffer);
+            return;
+        }
+    }
+
     for (int ch = 0; ch < channels; ++ch)
     {
         const float* channel_data = source->channel(ch);
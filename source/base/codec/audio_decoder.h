@@ -21,6 +21,7 @@
 
 #include "proto/desktop.pb.h"
 
+#include <cstdint>
 #include <memory>
 
 namespace proto {
@@ -39,6 +40,10 @@ public:
     // Returns the decoded packet. If the packet is invalid, then a NULL
     // std::unique_ptr is returned.
     virtual std::unique_ptr<proto::AudioPacket> decode(const proto::AudioPacket& packet) = 0;
+
+    // Writes up to |frames| of interleaved 16-bit stereo samples to |samples| in place of lost
+    // data. Returns the number of frames written or 0 if the decoder cannot conceal the loss.
+    virtual size_t conceal(int16_t* /* samples */, size_t /* frames */) { return 0; }
 };
 
 } // namespace base
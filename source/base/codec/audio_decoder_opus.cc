@@ -37,6 +37,9 @@ const int kMaxFramesPerPacket = 100;
 const proto::AudioPacket::SamplingRate kSamplingRate =
     proto::AudioPacket::SAMPLING_RATE_48000;
 
+// The loss can be concealed only in multiples of 2.5 ms.
+const size_t kConcealFrameAlignment = 120;
+
 } // namespace
 
 AudioDecoderOpus::AudioDecoderOpus() = default;
@@ -149,4 +152,24 @@ std::unique_ptr<proto::AudioPacket> AudioDecoderOpus::decode(const proto::AudioP
     return decoded_packet;
 }
 
+size_t AudioDecoderOpus::conceal(int16_t* samples, size_t frames)
+{
+    if (!decoder_ || channels_ != 2)
+        return 0;
+
+    frames -= frames % kConcealFrameAlignment;
+    if (!frames)
+        return 0;
+
+    // Without the data the decoder extrapolates the previous frames.
+    int result = opus_decode(decoder_, nullptr, 0, samples, static_cast<int>(frames), 0);
+    if (result < 0)
+    {
+        LOG(LS_ERROR) << "Failed concealing Opus frame. Error code: " << result;
+        return 0;
+    }
+
+    return static_cast<size_t>(result);
+}
+
 } // namespace base
@@ -34,6 +34,7 @@ public:
 
     // AudioDecoder interface.
     std::unique_ptr<proto::AudioPacket> decode(const proto::AudioPacket& packet) override;
+    size_t conceal(int16_t* samples, size_t frames) override;
 
 private:
     void initDecoder();
@@ -38,6 +38,9 @@ public:
     // Returns average bitrate for the stream in bits per second.
     virtual int bitrate() = 0;
     virtual bool setBitrate(int bitrate) = 0;
+
+    // Sets the computational complexity in the range of 0 (the fastest) to 10 (the best quality).
+    virtual bool setComplexity(int complexity) = 0;
 };
 
 } // namespace base
@@ -33,16 +33,16 @@ const proto::AudioPacket::SamplingRate kOpusSamplingRate =
     proto::AudioPacket::SAMPLING_RATE_48000;
 
 // Opus supports frame sizes of 2.5, 5, 10, 20, 40 and 60 ms. We use 20 ms
-// frames to balance latency and efficiency.
+// frames to balance latency and efficiency. In the low latency mode 10 ms frames are used.
 const std::chrono::milliseconds kFrameSizeMs { 20 };
-
-// Number of samples per frame when using default sampling rate.
-const int kFrameSamples = static_cast<const int>(
-    kOpusSamplingRate * kFrameSizeMs / std::chrono::milliseconds(1000));
+const std::chrono::milliseconds kLowLatencyFrameSizeMs { 10 };
 
 const proto::AudioPacket::BytesPerSample kBytesPerSample =
     proto::AudioPacket::BYTES_PER_SAMPLE_2;
 
+// Maximum absolute sample value that is still considered as silence.
+const int kSilenceThreshold = 2;
+
 bool isSupportedSampleRate(int rate)
 {
     return rate == 44100 || rate == 48000 || rate == 96000 || rate == 192000;
@@ -50,11 +50,18 @@ bool isSupportedSampleRate(int rate)
 
 } // namespace
 
-AudioEncoderOpus::AudioEncoderOpus() = default;
+AudioEncoderOpus::AudioEncoderOpus()
+    : silence_detector_(kSilenceThreshold)
+{
+    // Nothing
+}
 
 AudioEncoderOpus::~AudioEncoderOpus()
 {
     destroyEncoder();
+
+    if (silent_packet_count_)
+        LOG(LS_INFO) << "Silent packets not sent: " << silent_packet_count_;
 }
 
 void AudioEncoderOpus::initEncoder()
@@ -62,7 +69,12 @@ void AudioEncoderOpus::initEncoder()
     DCHECK(!encoder_);
 
     int error;
-    encoder_ = opus_encoder_create(kOpusSamplingRate, channels_, OPUS_APPLICATION_AUDIO, &error);
+    // The restricted low delay application does not use the speech mode and saves 4 ms of the
+    // algorithmic delay.
+    const int application =
+        low_latency_ ? OPUS_APPLICATION_RESTRICTED_LOWDELAY : OPUS_APPLICATION_AUDIO;
+
+    encoder_ = opus_encoder_create(kOpusSamplingRate, channels_, application, &error);
     if (!encoder_)
     {
         LOG(LS_ERROR) << "Failed to create OPUS encoder. Error code: " << error;
@@ -70,12 +82,22 @@ void AudioEncoderOpus::initEncoder()
     }
 
     opus_encoder_ctl(encoder_, OPUS_SET_BITRATE(bitrate_));
+    opus_encoder_ctl(encoder_, OPUS_SET_COMPLEXITY(complexity_));
+
+    // The short pauses are encoded with the comfort noise, which takes much less traffic.
+    opus_encoder_ctl(encoder_, OPUS_SET_DTX(1));
+
+    silence_detector_.reset(sampling_rate_, channels_);
 
-    frame_size_ = int(sampling_rate_ * kFrameSizeMs / std::chrono::milliseconds(1000));
+    const std::chrono::milliseconds frame_duration =
+        low_latency_ ? kLowLatencyFrameSizeMs : kFrameSizeMs;
+
+    frame_size_ = int(sampling_rate_ * frame_duration / std::chrono::milliseconds(1000));
+    frame_samples_ = int(kOpusSamplingRate * frame_duration / std::chrono::milliseconds(1000));
 
     if (sampling_rate_ != kOpusSamplingRate)
     {
-        resample_buffer_.reset(new char[kFrameSamples * kBytesPerSample * size_t(channels_)]);
+        resample_buffer_.reset(new char[frame_samples_ * kBytesPerSample * size_t(channels_)]);
         // TODO(sergeyu): Figure out the right buffer size to use per packet instead
         // of using SincResampler::kDefaultRequestSize.
         resampler_.reset(new MultiChannelResampler(
@@ -84,7 +106,7 @@ void AudioEncoderOpus::initEncoder()
             SincResampler::kDefaultRequestSize,
             std::bind(&AudioEncoderOpus::fetchBytesToResample,
                 this, std::placeholders::_1, std::placeholders::_2)));
-        resampler_bus_ = AudioBus::Create(channels_, kFrameSamples);
+        resampler_bus_ = AudioBus::Create(channels_, frame_samples_);
     }
 
     // Drop leftover data because it's for different sampling rate.
@@ -143,6 +165,20 @@ void AudioEncoderOpus::fetchBytesToResample(int /* resampler_frame_delay */, Aud
     DCHECK_LE(resampling_data_pos_, int(resampling_data_size_));
 }
 
+void AudioEncoderOpus::setLowLatency(bool enable)
+{
+    if (low_latency_ == enable)
+        return;
+
+    LOG(LS_INFO) << "Low latency changed from " << low_latency_ << " to " << enable;
+    low_latency_ = enable;
+
+    // The application of the encoder cannot be changed after the first frame, so the encoder is
+    // created again for the next packet.
+    destroyEncoder();
+    sampling_rate_ = 0;
+}
+
 int AudioEncoderOpus::bitrate()
 {
     return bitrate_;
@@ -150,28 +186,41 @@ int AudioEncoderOpus::bitrate()
 
 bool AudioEncoderOpus::setBitrate(int bitrate)
 {
-    if (!encoder_)
-        return false;
-
-    switch (bitrate)
+    // The range supported by Opus.
+    if (bitrate < 6000 || bitrate > 510000)
     {
-        case 128 * 1024:
-        case 96 * 1024:
-        case 64 * 1024:
-        case 32 * 1024:
-        case 24 * 1024:
-        case 10 * 1024:
-            break;
-
-        default:
-            LOG(LS_WARNING) << "Invalid bitrate value: " << bitrate;
-            return false;
+        LOG(LS_WARNING) << "Invalid bitrate value: " << bitrate;
+        return false;
     }
 
+    if (bitrate == bitrate_)
+        return true;
+
     LOG(LS_INFO) << "Bitrate changed from " << bitrate_ << " to " << bitrate;
     bitrate_ = bitrate;
 
-    opus_encoder_ctl(encoder_, OPUS_SET_BITRATE(bitrate));
+    // The encoder is created with the current value on the first packet.
+    if (encoder_)
+        opus_encoder_ctl(encoder_, OPUS_SET_BITRATE(bitrate));
+    return true;
+}
+
+bool AudioEncoderOpus::setComplexity(int complexity)
+{
+    if (complexity < 0 || complexity > 10)
+    {
+        LOG(LS_WARNING) << "Invalid complexity value: " << complexity;
+        return false;
+    }
+
+    if (complexity == complexity_)
+        return true;
+
+    LOG(LS_INFO) << "Complexity changed from " << complexity_ << " to " << complexity;
+    complexity_ = complexity;
+
+    if (encoder_)
+        opus_encoder_ctl(encoder_, OPUS_SET_COMPLEXITY(complexity));
     return true;
 }
 
@@ -191,6 +240,15 @@ bool AudioEncoderOpus::encode(
     int samples_in_packet = input_packet.data(0).size() / kBytesPerSample / uint32_t(channels_);
     const int16_t* next_sample = reinterpret_cast<const int16_t*>(input_packet.data(0).data());
 
+    if (silence_detector_.isSilence(next_sample, size_t(samples_in_packet)))
+    {
+        // Nothing is sent during the silence. The client conceals the end of the stream and plays
+        // silence until the next packet. The leftover samples are silent too.
+        leftover_samples_ = 0;
+        ++silent_packet_count_;
+        return false;
+    }
+
     // Create a new packet of encoded data.
     output_packet->set_encoding(proto::AUDIO_ENCODING_OPUS);
     output_packet->set_sampling_rate(kOpusSamplingRate);
@@ -224,12 +282,12 @@ bool AudioEncoderOpus::encode(
             resampling_data_ = reinterpret_cast<const char*>(pcm_buffer);
             resampling_data_pos_ = 0;
             resampling_data_size_ = samples_wanted * channels_ * kBytesPerSample;
-            resampler_->Resample(kFrameSamples, resampler_bus_.get());
+            resampler_->Resample(frame_samples_, resampler_bus_.get());
             resampling_data_ = nullptr;
             samples_consumed = resampling_data_pos_ / channels_ / kBytesPerSample;
 
             resampler_bus_->ToInterleaved<SignedInt16SampleTypeTraits>(
-                kFrameSamples, reinterpret_cast<int16_t*>(resample_buffer_.get()));
+                frame_samples_, reinterpret_cast<int16_t*>(resample_buffer_.get()));
             pcm_buffer = reinterpret_cast<int16_t*>(resample_buffer_.get());
         }
         else
@@ -239,11 +297,11 @@ bool AudioEncoderOpus::encode(
 
         // Initialize output buffer.
         std::string* data = output_packet->add_data();
-        data->resize(kFrameSamples * kBytesPerSample * size_t(channels_));
+        data->resize(frame_samples_ * kBytesPerSample * size_t(channels_));
 
         // Encode.
         unsigned char* buffer = reinterpret_cast<unsigned char*>(std::data(*data));
-        int result = opus_encode(encoder_, pcm_buffer, kFrameSamples, buffer,
+        int result = opus_encode(encoder_, pcm_buffer, frame_samples_, buffer,
                                  opus_int32(data->length()));
         if (result < 0)
         {
@@ -20,6 +20,7 @@
 #define BASE_CODEC_AUDIO_ENCODER_OPUS_H
 
 #include "base/macros_magic.h"
+#include "base/audio/audio_silence_detector.h"
 #include "base/codec/audio_encoder.h"
 #include "proto/desktop.pb.h"
 
@@ -30,6 +31,9 @@ namespace base {
 class AudioBus;
 class MultiChannelResampler;
 
+// Encodes the audio with Opus. Quiet audio is encoded in the discontinuous transmission mode, so
+// the frames are only one byte long. When the audio is silent for a longer time, nothing is encoded
+// at all and the client plays silence.
 class AudioEncoderOpus : public AudioEncoder
 {
 public:
@@ -40,6 +44,10 @@ public:
     bool encode(const proto::AudioPacket& input_packet, proto::AudioPacket* output_packet) override;
     int bitrate() override;
     bool setBitrate(int bitrate) override;
+    bool setComplexity(int complexity) override;
+
+    // Uses 10 ms frames and the restricted low delay mode of Opus for voice communication.
+    void setLowLatency(bool enable);
 
 private:
     void initEncoder();
@@ -48,11 +56,16 @@ private:
     void fetchBytesToResample(int resampler_frame_delay, AudioBus* audio_bus);
 
     int bitrate_ = 96 * 1024; // Output 96 kb/s bitrate.
+    int complexity_ = 10;
     int sampling_rate_ = 0;
     proto::AudioPacket::Channels channels_ = proto::AudioPacket::CHANNELS_STEREO;
     OpusEncoder* encoder_ = nullptr;
 
+    bool low_latency_ = false;
+
+    // Frame size in samples of the input and of the encoder.
     int frame_size_ = 0;
+    int frame_samples_ = 0;
     std::unique_ptr<MultiChannelResampler> resampler_;
     std::unique_ptr<char[]> resample_buffer_;
     std::unique_ptr<AudioBus> resampler_bus_;
@@ -67,6 +80,9 @@ private:
     int leftover_buffer_size_ = 0;
     int leftover_samples_ = 0;
 
+    AudioSilenceDetector silence_detector_;
+    int64_t silent_packet_count_ = 0;
+
     DISALLOW_COPY_AND_ASSIGN(AudioEncoderOpus);
 };
 
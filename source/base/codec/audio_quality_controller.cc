@@ -0,0 +1,115 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/audio_quality_controller.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace base {
+
+namespace {
+
+// Share of the bandwidth of the path which is given to the audio, in percent.
+const int64_t kBandwidthShare = 10;
+
+// The bitrate is changed only if it differs from the current one by more than 10%, so that the
+// encoder is not reconfigured on each update.
+const int kBitrateHysteresis = 10;
+
+// The bitrate is rounded to this step.
+const int kBitrateStep = 1024;
+
+// The complexity starts to fall at kLowCpuUsage and reaches the minimum at kHighCpuUsage.
+const double kLowCpuUsage = 50;
+const double kHighCpuUsage = 90;
+
+// Up to this number of sessions the maximum complexity is used. For each doubling of the number of
+// sessions the complexity is lowered by kSessionComplexityStep.
+const size_t kFullQualitySessions = 4;
+const int kSessionComplexityStep = 2;
+
+// Weight of a new sample of the processor load in the moving average.
+const double kCpuUsageWeight = 0.3;
+
+} // namespace
+
+bool AudioQualityController::updateBitrate(int64_t pacing_rate)
+{
+    const int64_t available = std::max(pacing_rate, int64_t(0)) * 8 * kBandwidthShare / 100;
+
+    int bitrate = static_cast<int>(
+        std::clamp(available, int64_t(kMinBitrate), int64_t(kMaxBitrate)));
+    if (bitrate != kMinBitrate && bitrate != kMaxBitrate)
+        bitrate = bitrate / kBitrateStep * kBitrateStep;
+
+    if (bitrate == bitrate_)
+        return false;
+
+    // The limits are always reached, so that the quality does not stay a bit below the maximum.
+    const bool is_limit = bitrate == kMinBitrate || bitrate == kMaxBitrate;
+    if (!is_limit && std::abs(bitrate - bitrate_) * 100 <= bitrate_ * kBitrateHysteresis)
+        return false;
+
+    bitrate_ = bitrate;
+    return true;
+}
+
+bool AudioQualityController::updateComplexity(int cpu_usage, size_t session_count)
+{
+    const double usage = std::clamp(cpu_usage, 0, 100);
+    if (cpu_usage_ < 0)
+        cpu_usage_ = usage;
+    else
+        cpu_usage_ += (usage - cpu_usage_) * kCpuUsageWeight;
+
+    int load_complexity = kMaxComplexity;
+    if (cpu_usage_ >= kHighCpuUsage)
+    {
+        load_complexity = kMinComplexity;
+    }
+    else if (cpu_usage_ > kLowCpuUsage)
+    {
+        const double fraction = (cpu_usage_ - kLowCpuUsage) / (kHighCpuUsage - kLowCpuUsage);
+        load_complexity =
+            kMaxComplexity - static_cast<int>(fraction * (kMaxComplexity - kMinComplexity));
+    }
+
+    int session_complexity = kMaxComplexity;
+    for (size_t count = kFullQualitySessions;
+         count < session_count && session_complexity > kMinComplexity; count *= 2)
+    {
+        session_complexity -= kSessionComplexityStep;
+    }
+
+    int complexity =
+        std::max(std::min(load_complexity, session_complexity), int(kMinComplexity));
+
+    // A lower complexity lowers the load, so the complexity is raised one step at a time to avoid
+    // the oscillation.
+    if (complexity > complexity_)
+        complexity = complexity_ + 1;
+
+    if (complexity == complexity_)
+        return false;
+
+    complexity_ = complexity;
+    return true;
+}
+
+} // namespace base
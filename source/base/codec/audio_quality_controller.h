@@ -0,0 +1,71 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_CODEC_AUDIO_QUALITY_CONTROLLER_H
+#define BASE_CODEC_AUDIO_QUALITY_CONTROLLER_H
+
+#include "base/macros_magic.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace base {
+
+// Selects the bitrate and the complexity of the audio encoder.
+// The bitrate follows the bandwidth estimate of the path: the audio takes a small share of it,
+// but not more than is needed for the transparent quality. The complexity is lowered when the
+// processors of the host are busy and when many sessions encode the audio at the same time, as on
+// terminal servers.
+class AudioQualityController
+{
+public:
+    // Limits of the bitrate in bits per second.
+    static constexpr int kMinBitrate = 16 * 1024;
+    static constexpr int kMaxBitrate = 128 * 1024;
+    static constexpr int kDefaultBitrate = 96 * 1024;
+
+    static constexpr int kMinComplexity = 3;
+    static constexpr int kMaxComplexity = 10;
+
+    AudioQualityController() = default;
+    ~AudioQualityController() = default;
+
+    // Must be called with the pacing rate of the path in bytes per second. Returns true if the
+    // target bitrate has been changed.
+    bool updateBitrate(int64_t pacing_rate);
+
+    // Must be called periodically. |cpu_usage| is the load of the processors in percent (0 if not
+    // known), |session_count| is the number of the desktop sessions of the host.
+    // Returns true if the target complexity has been changed.
+    bool updateComplexity(int cpu_usage, size_t session_count);
+
+    int bitrate() const { return bitrate_; }
+    int complexity() const { return complexity_; }
+
+private:
+    int bitrate_ = kDefaultBitrate;
+    int complexity_ = kMaxComplexity;
+
+    double cpu_usage_ = -1; // Moving average in percent.
+
+    DISALLOW_COPY_AND_ASSIGN(AudioQualityController);
+};
+
+} // namespace base
+
+#endif // BASE_CODEC_AUDIO_QUALITY_CONTROLLER_H
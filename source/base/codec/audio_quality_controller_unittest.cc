@@ -0,0 +1,102 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/audio_quality_controller.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+TEST(AudioQualityControllerTest, BitrateFollowsBandwidth)
+{
+    AudioQualityController controller;
+    EXPECT_EQ(controller.bitrate(), AudioQualityController::kDefaultBitrate);
+
+    // 1 MB/s is far above the need of the audio.
+    EXPECT_TRUE(controller.updateBitrate(1024 * 1024));
+    EXPECT_EQ(controller.bitrate(), AudioQualityController::kMaxBitrate);
+
+    // 50 KB/s gives 40 kbps to the audio.
+    EXPECT_TRUE(controller.updateBitrate(50 * 1024));
+    EXPECT_EQ(controller.bitrate(), 40 * 1024);
+
+    // Small changes are ignored.
+    EXPECT_FALSE(controller.updateBitrate(52 * 1024));
+    EXPECT_EQ(controller.bitrate(), 40 * 1024);
+
+    EXPECT_TRUE(controller.updateBitrate(60 * 1024));
+    EXPECT_EQ(controller.bitrate(), 48 * 1024);
+
+    EXPECT_TRUE(controller.updateBitrate(22 * 1024));
+    EXPECT_EQ(controller.bitrate(), 17 * 1024);
+
+    // The limits are reached even from the nearby values.
+    EXPECT_TRUE(controller.updateBitrate(21 * 1024));
+    EXPECT_EQ(controller.bitrate(), AudioQualityController::kMinBitrate);
+    EXPECT_FALSE(controller.updateBitrate(0));
+}
+
+TEST(AudioQualityControllerTest, ComplexityFollowsLoad)
+{
+    AudioQualityController controller;
+    EXPECT_EQ(controller.complexity(), AudioQualityController::kMaxComplexity);
+
+    EXPECT_FALSE(controller.updateComplexity(20, 1));
+    EXPECT_EQ(controller.complexity(), AudioQualityController::kMaxComplexity);
+
+    // The average grows slowly, but the complexity is lowered on each update.
+    int complexity = controller.complexity();
+    for (int i = 0; i < 20; ++i)
+    {
+        controller.updateComplexity(100, 1);
+        EXPECT_LE(controller.complexity(), complexity);
+        complexity = controller.complexity();
+    }
+    EXPECT_EQ(controller.complexity(), AudioQualityController::kMinComplexity);
+
+    // The complexity is raised one step at a time.
+    EXPECT_TRUE(controller.updateComplexity(0, 1));
+    EXPECT_EQ(controller.complexity(), AudioQualityController::kMinComplexity + 1);
+
+    for (int i = 0; i < 20; ++i)
+        controller.updateComplexity(0, 1);
+    EXPECT_EQ(controller.complexity(), AudioQualityController::kMaxComplexity);
+}
+
+TEST(AudioQualityControllerTest, ComplexityFollowsSessionCount)
+{
+    AudioQualityController controller;
+
+    EXPECT_FALSE(controller.updateComplexity(0, 4));
+    EXPECT_EQ(controller.complexity(), 10);
+
+    EXPECT_TRUE(controller.updateComplexity(0, 5));
+    EXPECT_EQ(controller.complexity(), 8);
+
+    EXPECT_TRUE(controller.updateComplexity(0, 20));
+    EXPECT_EQ(controller.complexity(), 4);
+
+    EXPECT_TRUE(controller.updateComplexity(0, 40));
+    EXPECT_EQ(controller.complexity(), AudioQualityController::kMinComplexity);
+
+    // The complexity is raised when the sessions are finished.
+    EXPECT_TRUE(controller.updateComplexity(0, 2));
+    EXPECT_EQ(controller.complexity(), AudioQualityController::kMinComplexity + 1);
+}
+
+} // namespace base
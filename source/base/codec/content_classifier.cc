@@ -0,0 +1,162 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/codec/content_classifier.h"
+
+#include "base/logging.h"
+#include "base/desktop/frame.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace base {
+
+namespace {
+
+// Anti-aliased text on a plain background has up to a few dozens of shades in a block. A block of
+// a photo or a video has almost as many colors as pixels.
+const int kMaxTextColors = 48;
+
+// The alpha channel of the captured frames is undefined.
+const uint32_t kColorMask = 0x00FFFFFF;
+
+int alignDown(int value)
+{
+    return value & ~(ContentClassifier::kBlockSize - 1);
+}
+
+int alignUp(int value)
+{
+    return alignDown(value + ContentClassifier::kBlockSize - 1);
+}
+
+} // namespace
+
+ContentClassifier::ContentClassifier()
+{
+    static_assert(kColorTableSize >= kMaxTextColors * 2);
+    static_assert((kColorTableSize & (kColorTableSize - 1)) == 0);
+
+    stamps_.fill(0);
+}
+
+ContentClassifier::~ContentClassifier() = default;
+
+void ContentClassifier::classify(const Frame& frame, const Region& region,
+                                 Region* text_region, Region* video_region)
+{
+    DCHECK(text_region);
+    DCHECK(video_region);
+    DCHECK_EQ(frame.format().bytesPerPixel(), 4);
+
+    text_region->clear();
+    video_region->clear();
+
+    const Rect frame_rect = Rect::makeSize(frame.size());
+    Region blocks;
+
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+        blocks.addRect(Rect::makeLTRB(alignDown(rect.left()), alignDown(rect.top()),
+                                      alignUp(rect.right()), alignUp(rect.bottom())));
+    }
+
+    blocks.intersectWith(frame_rect);
+
+    for (Region::Iterator it(blocks); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+
+        for (int top = rect.top(); top < rect.bottom(); top += kBlockSize)
+        {
+            const int bottom = std::min(top + kBlockSize, rect.bottom());
+
+            // The neighboring blocks of the same kind are joined into one rectangle.
+            int run_left = rect.left();
+            bool run_is_text = false;
+
+            for (int left = rect.left(); left < rect.right(); left += kBlockSize)
+            {
+                const Rect block =
+                    Rect::makeLTRB(left, top, std::min(left + kBlockSize, rect.right()), bottom);
+                const bool is_text = isTextBlock(frame, block);
+
+                if (left != rect.left() && is_text != run_is_text)
+                {
+                    Region* target = run_is_text ? text_region : video_region;
+                    target->addRect(Rect::makeLTRB(run_left, top, left, bottom));
+                    run_left = left;
+                }
+
+                run_is_text = is_text;
+            }
+
+            Region* target = run_is_text ? text_region : video_region;
+            target->addRect(Rect::makeLTRB(run_left, top, rect.right(), bottom));
+        }
+    }
+}
+
+bool ContentClassifier::isTextBlock(const Frame& frame, const Rect& block)
+{
+    if (++stamp_ == 0)
+    {
+        stamps_.fill(0);
+        stamp_ = 1;
+    }
+
+    int color_count = 0;
+    const uint8_t* row = frame.frameDataAtPos(block.topLeft());
+
+    for (int y = 0; y < block.height(); ++y)
+    {
+        uint32_t previous = 0;
+
+        for (int x = 0; x < block.width(); ++x)
+        {
+            uint32_t color;
+            memcpy(&color, row + x * sizeof(uint32_t), sizeof(color));
+            color &= kColorMask;
+
+            // Runs of the same color are common in text and cost only one lookup.
+            if (x != 0 && color == previous)
+                continue;
+
+            previous = color;
+
+            size_t index = ((color * 0x9E3779B1u) >> 24) & (kColorTableSize - 1);
+            while (stamps_[index] == stamp_ && colors_[index] != color)
+                index = (index + 1) & (kColorTableSize - 1);
+
+            if (stamps_[index] == stamp_)
+                continue;
+
+            if (++color_count > kMaxTextColors)
+                return false;
+
+            stamps_[index] = stamp_;
+            colors_[index] = color;
+        }
+
+        row += frame.stride();
+    }
+
+    return true;
+}
+
+} // namespace base
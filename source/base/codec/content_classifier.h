@@ -0,0 +1,62 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef BASE_CODEC_CONTENT_CLASSIFIER_H
+#define BASE_CODEC_CONTENT_CLASSIFIER_H
+
+#include "base/macros_magic.h"
+#include "base/desktop/region.h"
+
+#include <array>
+
+namespace base {
+
+class Frame;
+
+// Splits the updated area of a frame into blocks of synthetic content (text, user interface) and
+// natural content (photos, video). Synthetic blocks have few colors, so they stay small when they
+// are compressed losslessly and are blurred by the lossy codecs. The blocks are aligned to the
+// macroblocks of the VPX active map.
+class ContentClassifier
+{
+public:
+    static const int kBlockSize = 16;
+
+    ContentClassifier();
+    ~ContentClassifier();
+
+    // Classifies the blocks of |frame| that intersect |region|. The frame must be packed with 32
+    // bits per pixel. Both output regions consist of whole blocks clipped to the frame.
+    void classify(const Frame& frame, const Region& region,
+                  Region* text_region, Region* video_region);
+
+private:
+    bool isTextBlock(const Frame& frame, const Rect& block);
+
+    // Open addressing set of the colors of the current block. An entry is used only if its stamp
+    // matches the stamp of the block, so the set is not cleared between blocks.
+    static const size_t kColorTableSize = 256;
+    std::array<uint32_t, kColorTableSize> colors_;
+    std::array<uint32_t, kColorTableSize> stamps_;
+    uint32_t stamp_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(ContentClassifier);
+};
+
+} // namespace base
+
+#endif // BASE_CODEC_CONTENT_CLASSIFIER_H
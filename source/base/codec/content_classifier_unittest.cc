@@ -0,0 +1,107 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/codec/content_classifier.h"
+
+#include "base/desktop/frame_simple.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <random>
+
+namespace base {
+
+namespace {
+
+void fillRect(Frame* frame, const Rect& rect, uint32_t color)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        for (int x = rect.left(); x < rect.right(); ++x)
+            memcpy(frame->frameDataAtPos(x, y), &color, sizeof(color));
+    }
+}
+
+void fillNoise(Frame* frame, const Rect& rect)
+{
+    std::mt19937 engine(1234);
+
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        for (int x = rect.left(); x < rect.right(); ++x)
+        {
+            const uint32_t color = engine();
+            memcpy(frame->frameDataAtPos(x, y), &color, sizeof(color));
+        }
+    }
+}
+
+} // namespace
+
+TEST(ContentClassifierTest, SplitsTextAndVideo)
+{
+    std::unique_ptr<Frame> frame = FrameSimple::create(Size(100, 50), PixelFormat::ARGB());
+    ASSERT_TRUE(frame);
+
+    // A "document" with a few colors and a "video" of random pixels at a block boundary.
+    fillRect(frame.get(), Rect::makeWH(100, 50), 0xFFFFFFFF);
+    fillRect(frame.get(), Rect::makeXYWH(2, 2, 20, 3), 0xFF000000);
+    fillNoise(frame.get(), Rect::makeXYWH(48, 16, 32, 16));
+
+    ContentClassifier classifier;
+    Region text_region;
+    Region video_region;
+
+    classifier.classify(*frame, Region(Rect::makeWH(100, 50)), &text_region, &video_region);
+
+    EXPECT_TRUE(video_region.equals(Region(Rect::makeXYWH(48, 16, 32, 16))));
+
+    Region expected_text(Rect::makeWH(100, 50));
+    expected_text.subtract(Rect::makeXYWH(48, 16, 32, 16));
+    EXPECT_TRUE(text_region.equals(expected_text));
+}
+
+TEST(ContentClassifierTest, AlignsToBlocks)
+{
+    std::unique_ptr<Frame> frame = FrameSimple::create(Size(40, 40), PixelFormat::ARGB());
+    ASSERT_TRUE(frame);
+
+    fillNoise(frame.get(), Rect::makeWH(40, 40));
+
+    ContentClassifier classifier;
+    Region text_region;
+    Region video_region;
+
+    // The blocks are expanded to the macroblocks and clipped to the frame.
+    classifier.classify(*frame, Region(Rect::makeXYWH(20, 20, 3, 3)), &text_region, &video_region);
+
+    EXPECT_TRUE(text_region.isEmpty());
+    EXPECT_TRUE(video_region.equals(Region(Rect::makeXYWH(16, 16, 16, 16))));
+
+    classifier.classify(*frame, Region(Rect::makeXYWH(35, 35, 5, 5)), &text_region, &video_region);
+
+    EXPECT_TRUE(text_region.isEmpty());
+    EXPECT_TRUE(video_region.equals(Region(Rect::makeXYWH(32, 32, 8, 8))));
+
+    classifier.classify(*frame, Region(), &text_region, &video_region);
+
+    EXPECT_TRUE(text_region.isEmpty());
+    EXPECT_TRUE(video_region.isEmpty());
+}
+
+} // namespace base
@@ -0,0 +1,124 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/cursor_decoder.h"
+#include "base/codec/cursor_encoder.h"
+#include "base/desktop/mouse_cursor.h"
+#include "proto/desktop.pb.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+MouseCursor makeCursor(int seed, const Point& hotspot = Point(1, 1))
+{
+    const Size size(16, 16);
+
+    ByteArray image;
+    image.resize(static_cast<size_t>(size.width() * size.height() * MouseCursor::kBytesPerPixel));
+
+    for (size_t i = 0; i < image.size(); ++i)
+        image[i] = static_cast<uint8_t>((i * 7 + static_cast<size_t>(seed) * 131) >> 2);
+
+    return MouseCursor(std::move(image), size, hotspot);
+}
+
+// Encodes |cursor|, decodes the result and checks that the decoded cursor is the same.
+bool roundTrip(CursorEncoder* encoder, CursorDecoder* decoder, const MouseCursor& cursor)
+{
+    proto::CursorShape cursor_shape;
+    if (!encoder->encode(cursor, &cursor_shape))
+        return false;
+
+    std::shared_ptr<MouseCursor> decoded = decoder->decode(cursor_shape);
+    if (!decoded)
+        return false;
+
+    MouseCursor expected(cursor);
+    return expected.equals(*decoded) && decoded->hotSpot() == cursor.hotSpot();
+}
+
+} // namespace
+
+TEST(CursorCodecTest, AnimatedCursorStaysCached)
+{
+    for (bool large_cache : { false, true })
+    {
+        CursorEncoder encoder(large_cache);
+        CursorDecoder decoder;
+
+        // More frames than the cache of the old clients can hold.
+        const int kFrameCount = 40;
+
+        for (int cycle = 0; cycle < 3; ++cycle)
+        {
+            for (int frame = 0; frame < kFrameCount; ++frame)
+                ASSERT_TRUE(roundTrip(&encoder, &decoder, makeCursor(frame)));
+        }
+
+        if (large_cache)
+            EXPECT_EQ(decoder.takenCursorsFromCache(), 2 * kFrameCount);
+        else
+            EXPECT_EQ(decoder.takenCursorsFromCache(), 0);
+    }
+}
+
+TEST(CursorCodecTest, LeastRecentlyUsedIsEvicted)
+{
+    CursorEncoder encoder(true);
+    CursorDecoder decoder;
+
+    const int kCacheSize = static_cast<int>(CursorEncoder::kLargeCacheSize);
+
+    for (int i = 0; i < kCacheSize; ++i)
+        ASSERT_TRUE(roundTrip(&encoder, &decoder, makeCursor(i)));
+
+    // The first cursor becomes the most recently used one.
+    ASSERT_TRUE(roundTrip(&encoder, &decoder, makeCursor(0)));
+    EXPECT_EQ(decoder.takenCursorsFromCache(), 1);
+
+    // The new cursor replaces the second one.
+    ASSERT_TRUE(roundTrip(&encoder, &decoder, makeCursor(kCacheSize)));
+    EXPECT_EQ(decoder.cachedCursors(), kCacheSize);
+
+    ASSERT_TRUE(roundTrip(&encoder, &decoder, makeCursor(0)));
+    EXPECT_EQ(decoder.takenCursorsFromCache(), 2);
+
+    ASSERT_TRUE(roundTrip(&encoder, &decoder, makeCursor(1)));
+    EXPECT_EQ(decoder.takenCursorsFromCache(), 2);
+
+    for (int i = 2; i <= kCacheSize; ++i)
+        ASSERT_TRUE(roundTrip(&encoder, &decoder, makeCursor(i)));
+}
+
+TEST(CursorCodecTest, HotspotIsPartOfKey)
+{
+    CursorEncoder encoder(true);
+    CursorDecoder decoder;
+
+    ASSERT_TRUE(roundTrip(&encoder, &decoder, makeCursor(5, Point(0, 0))));
+    ASSERT_TRUE(roundTrip(&encoder, &decoder, makeCursor(5, Point(8, 8))));
+    EXPECT_EQ(decoder.takenCursorsFromCache(), 0);
+
+    ASSERT_TRUE(roundTrip(&encoder, &decoder, makeCursor(5, Point(0, 0))));
+    EXPECT_EQ(decoder.takenCursorsFromCache(), 1);
+}
+
+} // namespace base
@@ -29,6 +29,9 @@ namespace {
 constexpr size_t kMinCacheSize = 2;
 constexpr size_t kMaxCacheSize = 30;
 
+// Limit for the clients that announce LARGE_CURSOR_CACHE.
+constexpr size_t kMaxLargeCacheSize = 256;
+
 } // namespace
 
 CursorDecoder::CursorDecoder()
@@ -101,8 +104,8 @@ std::shared_ptr<MouseCursor> CursorDecoder::decode(const proto::CursorShape& cur
             return nullptr;
         }
 
-        // Bits 0-4 contain the cursor position in the cache.
-        cache_index = cursor_shape.flags() & 0x1F;
+        // Bits 0-4 contain the cursor position in the cache if the index has no separate field.
+        cache_index = large_cache_ ? cursor_shape.cache_index() : (cursor_shape.flags() & 0x1F);
         ++taken_from_cache_;
     }
     else
@@ -137,15 +140,19 @@ std::shared_ptr<MouseCursor> CursorDecoder::decode(const proto::CursorShape& cur
 
         if (cursor_shape.flags() & proto::CursorShape::RESET_CACHE)
         {
-            size_t cache_size = cursor_shape.flags() & 0x1F;
+            const bool large_cache = cursor_shape.cache_size() != 0;
+            const size_t cache_size =
+                large_cache ? cursor_shape.cache_size() : (cursor_shape.flags() & 0x1F);
 
-            if (cache_size < kMinCacheSize || cache_size > kMaxCacheSize)
+            if (cache_size < kMinCacheSize ||
+                cache_size > (large_cache ? kMaxLargeCacheSize : kMaxCacheSize))
             {
                 LOG(LS_WARNING) << "Invalid cache size: " << cache_size;
                 return nullptr;
             }
 
             cache_size_.emplace(cache_size);
+            large_cache_ = large_cache;
             cache_.reserve(cache_size);
             cache_.clear();
         }
@@ -156,6 +163,24 @@ std::shared_ptr<MouseCursor> CursorDecoder::decode(const proto::CursorShape& cur
             return nullptr;
         }
 
+        if (large_cache_)
+        {
+            cache_index = cursor_shape.cache_index();
+            if (cache_index >= cache_size_.value() || cache_index > cache_.size())
+            {
+                LOG(LS_ERROR) << "Invalid cache index: " << cache_index;
+                return nullptr;
+            }
+
+            // The host fills the cache in order and then replaces the least recently used cursors.
+            if (cache_index == cache_.size())
+                cache_.emplace_back(std::move(mouse_cursor));
+            else
+                cache_[cache_index] = std::move(mouse_cursor);
+
+            return cache_[cache_index];
+        }
+
         // Add the cursor to the end of the list.
         cache_.emplace_back(std::move(mouse_cursor));
 
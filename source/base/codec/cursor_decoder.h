@@ -24,6 +24,7 @@
 #include "base/memory/byte_array.h"
 
 #include <optional>
+#include <vector>
 
 namespace proto {
 class CursorShape;
@@ -49,6 +50,10 @@ private:
 
     std::vector<std::shared_ptr<MouseCursor>> cache_;
     std::optional<size_t> cache_size_;
+
+    // If set, the host passes the cache index in a separate field and new cursors replace the
+    // entries at this index.
+    bool large_cache_ = false;
     ScopedZstdDStream stream_;
     int taken_from_cache_ = 0;
 
@@ -45,16 +45,21 @@ uint8_t* outputBuffer(proto::CursorShape* cursor_shape, size_t size)
 
 } // namespace
 
-CursorEncoder::CursorEncoder()
-    : stream_(ZSTD_createCStream())
+CursorEncoder::CursorEncoder(bool large_cache)
+    : stream_(ZSTD_createCStream()),
+      large_cache_(large_cache)
 {
-    LOG(LS_INFO) << "Ctor";
+    LOG(LS_INFO) << "Ctor (large cache: " << large_cache_ << ")";
 
     static_assert(kCacheSize >= 2 && kCacheSize <= 30);
+    static_assert(kLargeCacheSize >= 2 && kLargeCacheSize <= 256);
     static_assert(kCompressionRatio >= 1 && kCompressionRatio <= 22);
 
     // Reserve memory for the maximum number of elements in the cache.
-    cache_.reserve(kCacheSize);
+    if (large_cache_)
+        lru_index_.reserve(kLargeCacheSize);
+    else
+        cache_.reserve(kCacheSize);
 }
 
 CursorEncoder::~CursorEncoder()
@@ -143,15 +148,19 @@ bool CursorEncoder::encode(const MouseCursor& mouse_cursor, proto::CursorShape*
                                      mouse_cursor.constImage().size(),
                                      kHashingSeed);
 
-    // Trying to find cursor in cache.
-    for (size_t index = 0; index < cache_.size(); ++index)
+    // The same image with another hotspot is a different cursor.
+    const uint64_t key = (static_cast<uint64_t>(hash) << 32) |
+        (static_cast<uint64_t>(mouse_cursor.hotSpotX() & 0xFFFF) << 16) |
+        static_cast<uint64_t>(mouse_cursor.hotSpotY() & 0xFFFF);
+
+    if (large_cache_)
     {
-        if (cache_[index] == hash)
-        {
-            // Cursor found in cache.
-            cursor_shape->set_flags(proto::CursorShape::CACHE | (index & 0x1F));
+        if (findInLargeCache(key, cursor_shape))
             return true;
-        }
+    }
+    else if (findInCache(hash, cursor_shape))
+    {
+        return true;
     }
 
     Point dpi = mouse_cursor.constDpi();
@@ -173,6 +182,12 @@ bool CursorEncoder::encode(const MouseCursor& mouse_cursor, proto::CursorShape*
         return false;
     }
 
+    if (large_cache_)
+    {
+        addToLargeCache(key, cursor_shape);
+        return true;
+    }
+
     if (cache_.empty())
     {
         LOG(LS_INFO) << "Empty cursor cache";
@@ -195,4 +210,63 @@ bool CursorEncoder::encode(const MouseCursor& mouse_cursor, proto::CursorShape*
     return true;
 }
 
+bool CursorEncoder::findInLargeCache(uint64_t key, proto::CursorShape* cursor_shape)
+{
+    auto found = lru_index_.find(key);
+    if (found != lru_index_.end())
+    {
+        // Cursor found in cache.
+        lru_list_.splice(lru_list_.begin(), lru_list_, found->second);
+
+        cursor_shape->set_flags(proto::CursorShape::CACHE);
+        cursor_shape->set_cache_index(found->second->index);
+        return true;
+    }
+
+    return false;
+}
+
+void CursorEncoder::addToLargeCache(uint64_t key, proto::CursorShape* cursor_shape)
+{
+    if (lru_list_.empty())
+    {
+        LOG(LS_INFO) << "Empty cursor cache";
+
+        // The client allocates the cache of the given size.
+        cursor_shape->set_flags(proto::CursorShape::RESET_CACHE);
+        cursor_shape->set_cache_size(kLargeCacheSize);
+    }
+
+    uint32_t index = static_cast<uint32_t>(lru_list_.size());
+
+    if (lru_list_.size() >= kLargeCacheSize)
+    {
+        // The least recently used cursor is replaced on the client side.
+        index = lru_list_.back().index;
+        lru_index_.erase(lru_list_.back().key);
+        lru_list_.pop_back();
+    }
+
+    lru_list_.push_front({ key, index });
+    lru_index_.emplace(key, lru_list_.begin());
+
+    cursor_shape->set_cache_index(index);
+}
+
+bool CursorEncoder::findInCache(uint32_t hash, proto::CursorShape* cursor_shape)
+{
+    // Trying to find cursor in cache.
+    for (size_t index = 0; index < cache_.size(); ++index)
+    {
+        if (cache_[index] == hash)
+        {
+            // Cursor found in cache.
+            cursor_shape->set_flags(proto::CursorShape::CACHE | (index & 0x1F));
+            return true;
+        }
+    }
+
+    return false;
+}
+
 } // namespace base
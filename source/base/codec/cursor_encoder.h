@@ -22,6 +22,8 @@
 #include "base/macros_magic.h"
 #include "base/codec/scoped_zstd_stream.h"
 
+#include <list>
+#include <unordered_map>
 #include <vector>
 
 namespace proto {
@@ -35,17 +37,43 @@ class MouseCursor;
 class CursorEncoder
 {
 public:
-    CursorEncoder();
+    // Number of cursors cached by the clients that support LARGE_CURSOR_CACHE. The frames of an
+    // animated cursor stay in the cache after the first cycle.
+    static const size_t kLargeCacheSize = 128;
+
+    explicit CursorEncoder(bool large_cache = false);
     ~CursorEncoder();
 
     bool encode(const MouseCursor& mouse_cursor, proto::CursorShape* cursor_shape);
 
 private:
+    struct CacheEntry
+    {
+        uint64_t key;
+        uint32_t index;
+    };
+
+    using CacheList = std::list<CacheEntry>;
+
     bool compressCursor(const MouseCursor& mouse_cursor, proto::CursorShape* cursor_shape) const;
 
+    // Return true and set the cache index in |cursor_shape| if the cursor is cached.
+    bool findInLargeCache(uint64_t key, proto::CursorShape* cursor_shape);
+    bool findInCache(uint32_t hash, proto::CursorShape* cursor_shape);
+
+    // Selects the index for a new cursor and evicts the least recently used one if needed.
+    void addToLargeCache(uint64_t key, proto::CursorShape* cursor_shape);
+
     ScopedZstdCStream stream_;
+    const bool large_cache_;
+
+    // The oldest cursor is replaced when the cache of the client is full.
     std::vector<uint32_t> cache_;
 
+    // The most recently used cursor is at the front of the list.
+    CacheList lru_list_;
+    std::unordered_map<uint64_t, CacheList::iterator> lru_index_;
+
     DISALLOW_COPY_AND_ASSIGN(CursorEncoder);
 };
 
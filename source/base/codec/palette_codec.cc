@@ -0,0 +1,490 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/codec/palette_codec.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+
+namespace base {
+
+namespace {
+
+const uint8_t kRawTile = 0;
+const uint8_t kSolidTile = 1;
+const uint8_t kRunTile = 128;
+
+const int kMaxPackedPaletteSize = 16;
+const int kMaxPaletteSize = 127;
+
+// Open addressing set of the colors of the current tile. An entry is used only if its stamp
+// matches the stamp of the tile, so the set is not cleared between tiles.
+class Palette
+{
+public:
+    Palette()
+    {
+        stamps_.fill(0);
+    }
+
+    void clear()
+    {
+        if (++stamp_ == 0)
+        {
+            stamps_.fill(0);
+            stamp_ = 1;
+        }
+
+        size_ = 0;
+    }
+
+    // Returns the index of |color| in the palette. The color is added if it is not in the palette
+    // yet. Returns -1 if the palette is full.
+    int add(uint32_t color)
+    {
+        size_t slot = ((color * 0x9E3779B1u) >> 24) & (kTableSize - 1);
+
+        while (stamps_[slot] == stamp_)
+        {
+            if (colors_[slot] == color)
+                return indices_[slot];
+
+            slot = (slot + 1) & (kTableSize - 1);
+        }
+
+        if (size_ == kMaxPaletteSize)
+            return -1;
+
+        stamps_[slot] = stamp_;
+        colors_[slot] = color;
+        indices_[slot] = static_cast<uint8_t>(size_);
+        palette_[static_cast<size_t>(size_)] = color;
+        return size_++;
+    }
+
+    int size() const { return size_; }
+    uint32_t color(int index) const { return palette_[static_cast<size_t>(index)]; }
+
+private:
+    static const size_t kTableSize = 256;
+    static_assert(kTableSize >= kMaxPaletteSize * 2);
+
+    std::array<uint32_t, kTableSize> colors_;
+    std::array<uint32_t, kTableSize> stamps_;
+    std::array<uint8_t, kTableSize> indices_;
+    std::array<uint32_t, kMaxPaletteSize> palette_;
+    uint32_t stamp_ = 0;
+    int size_ = 0;
+};
+
+uint32_t readPixel(const uint8_t* data, int bytes_per_pixel)
+{
+    uint32_t pixel = 0;
+    memcpy(&pixel, data, static_cast<size_t>(bytes_per_pixel));
+    return pixel;
+}
+
+void writePixel(uint32_t pixel, int bytes_per_pixel, uint8_t* data)
+{
+    memcpy(data, &pixel, static_cast<size_t>(bytes_per_pixel));
+}
+
+int indexBits(int palette_size)
+{
+    if (palette_size <= 2)
+        return 1;
+
+    if (palette_size <= 4)
+        return 2;
+
+    return 4;
+}
+
+size_t runSize(int length)
+{
+    if (length == 1)
+        return 1;
+
+    return 1 + static_cast<size_t>(length - 1) / 255 + 1;
+}
+
+uint8_t* writeRun(int index, int length, uint8_t* output)
+{
+    if (length == 1)
+    {
+        *output++ = static_cast<uint8_t>(index);
+        return output;
+    }
+
+    *output++ = static_cast<uint8_t>(index | 0x80);
+
+    int remaining = length - 1;
+    while (remaining >= 255)
+    {
+        *output++ = 255;
+        remaining -= 255;
+    }
+
+    *output++ = static_cast<uint8_t>(remaining);
+    return output;
+}
+
+size_t encodeRawTile(const uint8_t* data, int stride, int width, int height, int bytes_per_pixel,
+                     uint8_t* output)
+{
+    const size_t row_size = static_cast<size_t>(width * bytes_per_pixel);
+
+    *output++ = kRawTile;
+
+    for (int y = 0; y < height; ++y)
+    {
+        memcpy(output, data, row_size);
+        output += row_size;
+        data += stride;
+    }
+
+    return 1 + row_size * static_cast<size_t>(height);
+}
+
+size_t encodeTile(const uint8_t* data, int stride, int width, int height, int bytes_per_pixel,
+                  Palette* palette, uint8_t* output)
+{
+    palette->clear();
+
+    // The first pass collects the palette and the size of the runs.
+    size_t run_size = 0;
+    int run_index = -1;
+    int run_length = 0;
+
+    for (int y = 0; y < height; ++y)
+    {
+        const uint8_t* row = data + y * stride;
+
+        for (int x = 0; x < width; ++x)
+        {
+            const int index = palette->add(readPixel(row + x * bytes_per_pixel, bytes_per_pixel));
+            if (index < 0)
+                return encodeRawTile(data, stride, width, height, bytes_per_pixel, output);
+
+            if (index == run_index)
+            {
+                ++run_length;
+                continue;
+            }
+
+            if (run_length)
+                run_size += runSize(run_length);
+
+            run_index = index;
+            run_length = 1;
+        }
+    }
+
+    run_size += runSize(run_length);
+
+    const int palette_size = palette->size();
+
+    if (palette_size == 1)
+    {
+        output[0] = kSolidTile;
+        writePixel(palette->color(0), bytes_per_pixel, output + 1);
+        return 1 + static_cast<size_t>(bytes_per_pixel);
+    }
+
+    const size_t raw_size = static_cast<size_t>(width * height * bytes_per_pixel);
+    const size_t palette_bytes = static_cast<size_t>(palette_size * bytes_per_pixel);
+    const int bits = indexBits(palette_size);
+
+    size_t packed_size = std::numeric_limits<size_t>::max();
+    if (palette_size <= kMaxPackedPaletteSize)
+        packed_size = static_cast<size_t>(height) * static_cast<size_t>((width * bits + 7) / 8);
+
+    const bool use_runs = run_size < packed_size;
+    const size_t indices_size = use_runs ? run_size : packed_size;
+
+    if (palette_bytes + indices_size >= raw_size)
+        return encodeRawTile(data, stride, width, height, bytes_per_pixel, output);
+
+    uint8_t* out = output;
+
+    *out++ = static_cast<uint8_t>(use_runs ? kRunTile + palette_size : palette_size);
+
+    for (int i = 0; i < palette_size; ++i)
+    {
+        writePixel(palette->color(i), bytes_per_pixel, out);
+        out += bytes_per_pixel;
+    }
+
+    // The second pass writes the indices. All colors are in the palette already.
+    run_index = -1;
+    run_length = 0;
+
+    for (int y = 0; y < height; ++y)
+    {
+        const uint8_t* row = data + y * stride;
+        int bit_count = 0;
+        uint8_t value = 0;
+
+        for (int x = 0; x < width; ++x)
+        {
+            const int index = palette->add(readPixel(row + x * bytes_per_pixel, bytes_per_pixel));
+
+            if (use_runs)
+            {
+                if (index == run_index)
+                {
+                    ++run_length;
+                    continue;
+                }
+
+                if (run_length)
+                    out = writeRun(run_index, run_length, out);
+
+                run_index = index;
+                run_length = 1;
+                continue;
+            }
+
+            value = static_cast<uint8_t>((value << bits) | index);
+            bit_count += bits;
+
+            if (bit_count == 8)
+            {
+                *out++ = value;
+                bit_count = 0;
+                value = 0;
+            }
+        }
+
+        if (bit_count)
+            *out++ = static_cast<uint8_t>(value << (8 - bit_count));
+    }
+
+    if (use_runs)
+        out = writeRun(run_index, run_length, out);
+
+    return static_cast<size_t>(out - output);
+}
+
+bool decodeTile(const uint8_t** input, const uint8_t* end, int width, int height,
+                int bytes_per_pixel, uint8_t* data, int stride)
+{
+    const uint8_t* in = *input;
+    if (in == end)
+        return false;
+
+    const uint8_t type = *in++;
+    const size_t row_size = static_cast<size_t>(width * bytes_per_pixel);
+
+    if (type == kRawTile)
+    {
+        if (static_cast<size_t>(end - in) < row_size * static_cast<size_t>(height))
+            return false;
+
+        for (int y = 0; y < height; ++y)
+        {
+            memcpy(data + y * stride, in, row_size);
+            in += row_size;
+        }
+
+        *input = in;
+        return true;
+    }
+
+    int palette_size;
+
+    if (type == kSolidTile)
+        palette_size = 1;
+    else if (type <= kMaxPackedPaletteSize)
+        palette_size = type;
+    else if (type > kRunTile + 1)
+        palette_size = type - kRunTile;
+    else
+        return false;
+
+    if (static_cast<size_t>(end - in) < static_cast<size_t>(palette_size * bytes_per_pixel))
+        return false;
+
+    std::array<uint32_t, kMaxPaletteSize> palette;
+    for (int i = 0; i < palette_size; ++i)
+    {
+        palette[static_cast<size_t>(i)] = readPixel(in, bytes_per_pixel);
+        in += bytes_per_pixel;
+    }
+
+    if (type == kSolidTile)
+    {
+        for (int y = 0; y < height; ++y)
+        {
+            uint8_t* row = data + y * stride;
+
+            for (int x = 0; x < width; ++x)
+                writePixel(palette[0], bytes_per_pixel, row + x * bytes_per_pixel);
+        }
+    }
+    else if (type <= kMaxPackedPaletteSize)
+    {
+        const int bits = indexBits(palette_size);
+        const int mask = (1 << bits) - 1;
+        const size_t packed_row_size = static_cast<size_t>((width * bits + 7) / 8);
+
+        if (static_cast<size_t>(end - in) < packed_row_size * static_cast<size_t>(height))
+            return false;
+
+        for (int y = 0; y < height; ++y)
+        {
+            uint8_t* row = data + y * stride;
+
+            for (int x = 0; x < width; ++x)
+            {
+                const int bit_offset = x * bits;
+                const int index = (in[bit_offset / 8] >> (8 - bits - bit_offset % 8)) & mask;
+                if (index >= palette_size)
+                    return false;
+
+                writePixel(palette[static_cast<size_t>(index)], bytes_per_pixel,
+                           row + x * bytes_per_pixel);
+            }
+
+            in += packed_row_size;
+        }
+    }
+    else
+    {
+        int remaining = width * height;
+        int x = 0;
+        int y = 0;
+
+        while (remaining)
+        {
+            if (in == end)
+                return false;
+
+            const uint8_t value = *in++;
+            const int index = value & 0x7F;
+            int length = 1;
+
+            if (value & 0x80)
+            {
+                uint8_t extra;
+                do
+                {
+                    if (in == end)
+                        return false;
+
+                    extra = *in++;
+                    length += extra;
+
+                    if (length > remaining)
+                        return false;
+                }
+                while (extra == 255);
+            }
+
+            if (index >= palette_size || length > remaining)
+                return false;
+
+            remaining -= length;
+
+            const uint32_t color = palette[static_cast<size_t>(index)];
+
+            while (length--)
+            {
+                writePixel(color, bytes_per_pixel, data + y * stride + x * bytes_per_pixel);
+
+                if (++x == width)
+                {
+                    x = 0;
+                    ++y;
+                }
+            }
+        }
+    }
+
+    *input = in;
+    return true;
+}
+
+} // namespace
+
+// static
+size_t PaletteCodec::maxEncodedSize(const Size& size, int bytes_per_pixel)
+{
+    const size_t tile_count =
+        static_cast<size_t>((size.width() + kTileSize - 1) / kTileSize) *
+        static_cast<size_t>((size.height() + kTileSize - 1) / kTileSize);
+
+    // The raw tiles only add their type.
+    return static_cast<size_t>(size.width()) * static_cast<size_t>(size.height()) *
+        static_cast<size_t>(bytes_per_pixel) + tile_count;
+}
+
+// static
+size_t PaletteCodec::encode(const uint8_t* data, int stride, const Size& size,
+                            int bytes_per_pixel, uint8_t* output)
+{
+    Palette palette;
+    uint8_t* out = output;
+
+    for (int y = 0; y < size.height(); y += kTileSize)
+    {
+        const int height = std::min(kTileSize, size.height() - y);
+
+        for (int x = 0; x < size.width(); x += kTileSize)
+        {
+            const int width = std::min(kTileSize, size.width() - x);
+
+            out += encodeTile(data + y * stride + x * bytes_per_pixel, stride, width, height,
+                              bytes_per_pixel, &palette, out);
+        }
+    }
+
+    return static_cast<size_t>(out - output);
+}
+
+// static
+bool PaletteCodec::decode(const uint8_t* input, size_t input_size, const Size& size,
+                          int bytes_per_pixel, uint8_t* data, int stride)
+{
+    if (bytes_per_pixel < 1 || bytes_per_pixel > 4)
+        return false;
+
+    const uint8_t* end = input + input_size;
+
+    for (int y = 0; y < size.height(); y += kTileSize)
+    {
+        const int height = std::min(kTileSize, size.height() - y);
+
+        for (int x = 0; x < size.width(); x += kTileSize)
+        {
+            const int width = std::min(kTileSize, size.width() - x);
+
+            if (!decodeTile(&input, end, width, height, bytes_per_pixel,
+                            data + y * stride + x * bytes_per_pixel, stride))
+            {
+                return false;
+            }
+        }
+    }
+
+    // The coded rectangles follow each other, so the size must match exactly.
+    return input == end;
+}
+
+} // namespace base
@@ -0,0 +1,64 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef BASE_CODEC_PALETTE_CODEC_H
+#define BASE_CODEC_PALETTE_CODEC_H
+
+#include "base/macros_magic.h"
+#include "base/desktop/geometry.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace base {
+
+// Codes a rectangle of pixels in tiles before ZSTD compression, like ZRLE in RFB. A tile of a
+// few colors is sent as a palette followed by packed indices or by runs of indices, other tiles
+// are sent as is. Each tile starts with a byte of its type:
+//   0          raw pixels;
+//   1          one color;
+//   2..16      palette of N = type colors and packed indices of 1, 2 or 4 bits (rows are padded
+//              to a byte);
+//   130..255   palette of N = type - 128 colors and runs in the order of rows. A run of one pixel
+//              is its index, a longer run is the index with the high bit set followed by the
+//              length minus one as a sum of bytes that ends with a byte less than 255.
+// The colors are stored in |bytes_per_pixel| bytes as they are in the frame.
+class PaletteCodec
+{
+public:
+    static constexpr int kTileSize = 64;
+
+    // Returns the maximum size of the coded rectangle.
+    static size_t maxEncodedSize(const Size& size, int bytes_per_pixel);
+
+    // Codes |size| pixels at |data| into |output|, which must have at least maxEncodedSize()
+    // bytes. Returns the size of the coded data.
+    static size_t encode(const uint8_t* data, int stride, const Size& size, int bytes_per_pixel,
+                         uint8_t* output);
+
+    // Restores |size| pixels into |data| from the coded |input|. Returns false if the input is
+    // damaged or does not match the size exactly.
+    static bool decode(const uint8_t* input, size_t input_size, const Size& size,
+                       int bytes_per_pixel, uint8_t* data, int stride);
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(PaletteCodec);
+};
+
+} // namespace base
+
+#endif // BASE_CODEC_PALETTE_CODEC_H
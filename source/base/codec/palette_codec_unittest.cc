@@ -0,0 +1,183 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/codec/palette_codec.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace base {
+
+namespace {
+
+struct Image
+{
+    Image(const Size& size, int bytes_per_pixel)
+        : size(size),
+          bytes_per_pixel(bytes_per_pixel),
+          stride(size.width() * bytes_per_pixel + 3),
+          data(static_cast<size_t>(stride * size.height()), 0)
+    {
+        // Nothing
+    }
+
+    uint8_t* pixel(int x, int y) { return data.data() + y * stride + x * bytes_per_pixel; }
+
+    void setPixel(int x, int y, uint32_t color)
+    {
+        memcpy(pixel(x, y), &color, static_cast<size_t>(bytes_per_pixel));
+    }
+
+    bool equals(Image& other)
+    {
+        for (int y = 0; y < size.height(); ++y)
+        {
+            if (memcmp(pixel(0, y), other.pixel(0, y),
+                       static_cast<size_t>(size.width() * bytes_per_pixel)) != 0)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    Size size;
+    int bytes_per_pixel;
+    int stride;
+    std::vector<uint8_t> data;
+};
+
+// Codes and decodes |image|. Returns the size of the coded data or zero on failure.
+size_t roundTrip(Image& image)
+{
+    std::vector<uint8_t> coded(PaletteCodec::maxEncodedSize(image.size, image.bytes_per_pixel));
+
+    const size_t coded_size = PaletteCodec::encode(
+        image.data.data(), image.stride, image.size, image.bytes_per_pixel, coded.data());
+    EXPECT_LE(coded_size, coded.size());
+
+    Image decoded(image.size, image.bytes_per_pixel);
+    if (!PaletteCodec::decode(coded.data(), coded_size, decoded.size, decoded.bytes_per_pixel,
+                              decoded.data.data(), decoded.stride))
+    {
+        return 0;
+    }
+
+    return image.equals(decoded) ? coded_size : 0;
+}
+
+} // namespace
+
+TEST(PaletteCodecTest, SolidTiles)
+{
+    Image image(Size(130, 70), 4);
+
+    for (int y = 0; y < image.size.height(); ++y)
+    {
+        for (int x = 0; x < image.size.width(); ++x)
+            image.setPixel(x, y, 0x00336699);
+    }
+
+    // Six tiles of the type and one color each.
+    EXPECT_EQ(roundTrip(image), 6u * 5u);
+}
+
+TEST(PaletteCodecTest, FewColors)
+{
+    for (int bytes_per_pixel : { 1, 2, 4 })
+    {
+        for (int color_count : { 2, 3, 5, 16, 17, 100, 127 })
+        {
+            Image image(Size(77, 65), bytes_per_pixel);
+
+            // Text-like content: short horizontal strokes of a few colors.
+            for (int y = 0; y < image.size.height(); ++y)
+            {
+                for (int x = 0; x < image.size.width(); ++x)
+                    image.setPixel(x, y, static_cast<uint32_t>(((x / 3) * 7 + y) % color_count));
+            }
+
+            const size_t coded_size = roundTrip(image);
+            EXPECT_NE(coded_size, 0u) << bytes_per_pixel << " " << color_count;
+            EXPECT_LT(coded_size, static_cast<size_t>(77 * 65 * bytes_per_pixel));
+        }
+    }
+}
+
+TEST(PaletteCodecTest, LongRuns)
+{
+    Image image(Size(64, 64), 2);
+
+    // Runs longer than 255 pixels cross the rows.
+    for (int y = 0; y < image.size.height(); ++y)
+    {
+        for (int x = 0; x < image.size.width(); ++x)
+            image.setPixel(x, y, y < 20 ? 1 : (y < 40 ? 2 : 3));
+    }
+
+    const size_t coded_size = roundTrip(image);
+    EXPECT_NE(coded_size, 0u);
+    EXPECT_LT(coded_size, 32u);
+}
+
+TEST(PaletteCodecTest, NoiseIsRaw)
+{
+    Image image(Size(100, 10), 4);
+    std::mt19937 engine(1234);
+
+    for (int y = 0; y < image.size.height(); ++y)
+    {
+        for (int x = 0; x < image.size.width(); ++x)
+            image.setPixel(x, y, engine());
+    }
+
+    EXPECT_EQ(roundTrip(image), PaletteCodec::maxEncodedSize(image.size, 4));
+}
+
+TEST(PaletteCodecTest, DamagedInput)
+{
+    Image image(Size(20, 20), 4);
+    for (int y = 0; y < image.size.height(); ++y)
+    {
+        for (int x = 0; x < image.size.width(); ++x)
+            image.setPixel(x, y, static_cast<uint32_t>(x % 3));
+    }
+
+    std::vector<uint8_t> coded(PaletteCodec::maxEncodedSize(image.size, 4));
+    const size_t coded_size =
+        PaletteCodec::encode(image.data.data(), image.stride, image.size, 4, coded.data());
+
+    Image decoded(image.size, 4);
+
+    // Truncated data, extra data and an unknown tile type are rejected.
+    EXPECT_FALSE(PaletteCodec::decode(coded.data(), coded_size - 1, image.size, 4,
+                                      decoded.data.data(), decoded.stride));
+
+    coded.resize(coded_size + 1);
+    EXPECT_FALSE(PaletteCodec::decode(coded.data(), coded_size + 1, image.size, 4,
+                                      decoded.data.data(), decoded.stride));
+
+    coded[0] = 129;
+    EXPECT_FALSE(PaletteCodec::decode(coded.data(), coded_size, image.size, 4,
+                                      decoded.data.data(), decoded.stride));
+}
+
+} // namespace base
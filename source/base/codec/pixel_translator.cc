@@ -18,17 +18,127 @@
 
 #include "base/codec/pixel_translator.h"
 
+#include "base/logging.h"
 #include "base/macros_magic.h"
+#include "base/codec/pixel_translator_avx2.h"
+#include "base/codec/pixel_translator_neon.h"
+#include "base/codec/pixel_translator_sse2.h"
 #include "build/build_config.h"
 
 #include <limits>
 
+#include <libyuv/cpu_id.h>
+
 namespace base {
 
 namespace {
 
 const int kBlockSize = 16;
 
+bool isVectorSourceFormat(const PixelFormat& format)
+{
+    const uint8_t shifts[] = { format.redShift(), format.greenShift(), format.blueShift() };
+
+    for (const uint8_t shift : shifts)
+    {
+        if (shift % 8 != 0 || shift > 24)
+            return false;
+    }
+
+    return format.bytesPerPixel() == 4 && format.redMax() == 255 && format.greenMax() == 255 &&
+           format.blueMax() == 255;
+}
+
+bool isVectorTargetFormat(const PixelFormat& format)
+{
+    const uint32_t target_mask = (1U << (format.bytesPerPixel() * 8)) - 1;
+    const uint32_t maxes[] = { format.redMax(), format.greenMax(), format.blueMax() };
+    const uint8_t shifts[] = { format.redShift(), format.greenShift(), format.blueShift() };
+
+    // Vectorized code calculates channels in 16 bit lanes and saturates them when packing.
+    for (int i = 0; i < 3; ++i)
+    {
+        if (maxes[i] == 0 || maxes[i] > 255 || ((maxes[i] << shifts[i]) & ~target_mask) != 0)
+            return false;
+    }
+
+    return format.bytesPerPixel() == 2 || format.bytesPerPixel() == 1;
+}
+
+// Selects the vectorized translation of rows for the processor. Returns nullptr if the pair of
+// formats is not supported by the vectorized code.
+PixelTranslator::RowFunc rowFunction(const PixelFormat& source_format,
+                                     const PixelFormat& target_format,
+                                     PixelTranslator::Params* params)
+{
+    if (!isVectorSourceFormat(source_format))
+        return nullptr;
+
+    const int target_bytes_per_pixel = target_format.bytesPerPixel();
+
+    if (target_bytes_per_pixel == 4)
+    {
+        if (!source_format.isEqual(target_format))
+            return nullptr;
+    }
+    else if (!isVectorTargetFormat(target_format))
+    {
+        return nullptr;
+    }
+
+    params->source_shift[0] = source_format.redShift();
+    params->source_shift[1] = source_format.greenShift();
+    params->source_shift[2] = source_format.blueShift();
+    params->target_max[0] = target_format.redMax();
+    params->target_max[1] = target_format.greenMax();
+    params->target_max[2] = target_format.blueMax();
+    params->target_shift[0] = target_format.redShift();
+    params->target_shift[1] = target_format.greenShift();
+    params->target_shift[2] = target_format.blueShift();
+
+#if defined(ARCH_CPU_X86_FAMILY)
+    if (libyuv::TestCpuFlag(libyuv::kCpuHasAVX2))
+    {
+        LOG(LS_INFO) << "AVX2 pixel translator loaded";
+
+        if (target_bytes_per_pixel == 4)
+            return translateRow_32bpp_32bpp_AVX2;
+        else if (target_bytes_per_pixel == 2)
+            return translateRow_32bpp_16bpp_AVX2;
+        else
+            return translateRow_32bpp_8bpp_AVX2;
+    }
+
+    if (libyuv::TestCpuFlag(libyuv::kCpuHasSSE2))
+    {
+        LOG(LS_INFO) << "SSE2 pixel translator loaded";
+
+        if (target_bytes_per_pixel == 4)
+            return translateRow_32bpp_32bpp_SSE2;
+        else if (target_bytes_per_pixel == 2)
+            return translateRow_32bpp_16bpp_SSE2;
+        else
+            return translateRow_32bpp_8bpp_SSE2;
+    }
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+#if defined(HAS_PIXEL_TRANSLATOR_NEON)
+    if (libyuv::TestCpuFlag(libyuv::kCpuHasNEON))
+    {
+        LOG(LS_INFO) << "NEON pixel translator loaded";
+
+        if (target_bytes_per_pixel == 4)
+            return translateRow_32bpp_32bpp_NEON;
+        else if (target_bytes_per_pixel == 2)
+            return translateRow_32bpp_16bpp_NEON;
+        else
+            return translateRow_32bpp_8bpp_NEON;
+    }
+#endif // defined(HAS_PIXEL_TRANSLATOR_NEON)
+
+    return nullptr;
+}
+
 template<typename SourceT, typename TargetT>
 class PixelTranslatorT : public PixelTranslator
 {
@@ -59,6 +169,9 @@ public:
             blue_table_[i] = ((i * target_format_.blueMax() + source_format_.blueMax() / 2) /
                               source_format_.blueMax()) << target_format_.blueShift();
         }
+
+        if constexpr (sizeof(SourceT) == sizeof(uint32_t))
+            row_func_ = rowFunction(source_format_, target_format_, &params_);
     }
 
     ~PixelTranslatorT() override = default;
@@ -79,6 +192,25 @@ public:
                    uint8_t* dst, int dst_stride,
                    int width, int height) override
     {
+        if (row_func_)
+        {
+            for (int y = 0; y < height; ++y)
+            {
+                const int count = row_func_(src, dst, width, params_);
+
+                const SourceT* src_ptr = reinterpret_cast<const SourceT*>(src) + count;
+                TargetT* dst_ptr = reinterpret_cast<TargetT*>(dst) + count;
+
+                for (int x = count; x < width; ++x)
+                    translatePixel(src_ptr++, dst_ptr++);
+
+                src += src_stride;
+                dst += dst_stride;
+            }
+
+            return;
+        }
+
         const int block_count = width / kBlockSize;
         const int partial_width = width - (block_count * kBlockSize);
 
@@ -123,6 +255,9 @@ private:
     PixelFormat source_format_;
     PixelFormat target_format_;
 
+    RowFunc row_func_ = nullptr;
+    Params params_;
+
     DISALLOW_COPY_AND_ASSIGN(PixelTranslatorT);
 };
 
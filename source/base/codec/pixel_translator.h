@@ -33,6 +33,19 @@ public:
     static std::unique_ptr<PixelTranslator> create(const PixelFormat& source_format,
                                                    const PixelFormat& target_format);
 
+    // Parameters of the vectorized translation from a 32bpp format with 8 bit channels. Arrays
+    // are indexed in the order red, green, blue.
+    struct Params
+    {
+        int source_shift[3];
+        int target_max[3];
+        int target_shift[3];
+    };
+
+    // Translates the beginning of the row of |width| pixels. Returns the number of translated
+    // pixels, the rest of the row is translated by the scalar code.
+    using RowFunc = int(*)(const uint8_t* src, uint8_t* dst, int width, const Params& params);
+
     virtual void translate(const uint8_t* src,
                            int src_stride,
                            uint8_t* dst,
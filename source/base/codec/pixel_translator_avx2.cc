@@ -0,0 +1,147 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/pixel_translator_avx2.h"
+
+#if defined(ARCH_CPU_X86_FAMILY)
+#if defined(CC_MSVC)
+#include <intrin.h>
+#else
+#include <immintrin.h>
+#endif // defined(CC_*)
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+namespace base {
+
+#if defined(ARCH_CPU_X86_FAMILY)
+
+namespace {
+
+struct Channels
+{
+    explicit Channels(const PixelTranslator::Params& params)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            source_shift[i] = _mm_cvtsi32_si128(params.source_shift[i]);
+            target_max[i] = _mm256_set1_epi16(static_cast<int16_t>(params.target_max[i]));
+            target_shift[i] = _mm_cvtsi32_si128(params.target_shift[i]);
+        }
+    }
+
+    __m128i source_shift[3];
+    __m256i target_max[3];
+    __m128i target_shift[3];
+};
+
+// Scales the 8 bit channel value to the range [0, max] the same way as the scalar translator:
+// (value * max + 127) / 255. The division by 255 is exact for all 16 bit values used here.
+__m256i scaleChannel(__m256i value, __m256i max, __m128i shift)
+{
+    __m256i temp = _mm256_add_epi16(_mm256_mullo_epi16(value, max), _mm256_set1_epi16(127));
+    temp = _mm256_add_epi16(
+        _mm256_add_epi16(temp, _mm256_set1_epi16(1)), _mm256_srli_epi16(temp, 8));
+    return _mm256_sll_epi16(_mm256_srli_epi16(temp, 8), shift);
+}
+
+// Translates 16 pixels. Each 16 bit lane of the result contains one target pixel.
+__m256i translate16(const uint8_t* src, const Channels& channels)
+{
+    const __m256i pixels_lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+    const __m256i pixels_hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 32));
+    const __m256i mask = _mm256_set1_epi32(0xFF);
+
+    __m256i result = _mm256_setzero_si256();
+
+    for (int i = 0; i < 3; ++i)
+    {
+        const __m256i lo =
+            _mm256_and_si256(_mm256_srl_epi32(pixels_lo, channels.source_shift[i]), mask);
+        const __m256i hi =
+            _mm256_and_si256(_mm256_srl_epi32(pixels_hi, channels.source_shift[i]), mask);
+
+        result = _mm256_or_si256(result, scaleChannel(
+            _mm256_packs_epi32(lo, hi), channels.target_max[i], channels.target_shift[i]));
+    }
+
+    // The packing works inside 128 bit lanes. Restore the order of pixels.
+    return _mm256_permute4x64_epi64(result, 0xD8);
+}
+
+} // namespace
+
+int translateRow_32bpp_32bpp_AVX2(
+    const uint8_t* src, uint8_t* dst, int width, const PixelTranslator::Params& /* params */)
+{
+    const int count = width & ~7;
+    const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+
+    for (int x = 0; x < count; x += 8)
+    {
+        const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_or_si256(pixels, alpha));
+
+        src += 32;
+        dst += 32;
+    }
+
+    return count;
+}
+
+int translateRow_32bpp_16bpp_AVX2(
+    const uint8_t* src, uint8_t* dst, int width, const PixelTranslator::Params& params)
+{
+    const Channels channels(params);
+    const int count = width & ~15;
+
+    for (int x = 0; x < count; x += 16)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), translate16(src, channels));
+
+        src += 64;
+        dst += 32;
+    }
+
+    return count;
+}
+
+int translateRow_32bpp_8bpp_AVX2(
+    const uint8_t* src, uint8_t* dst, int width, const PixelTranslator::Params& params)
+{
+    const Channels channels(params);
+    const int count = width & ~31;
+
+    for (int x = 0; x < count; x += 32)
+    {
+        const __m256i lo = translate16(src, channels);
+        const __m256i hi = translate16(src + 64, channels);
+
+        // As above, the packing works inside 128 bit lanes.
+        const __m256i result = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), result);
+
+        src += 128;
+        dst += 32;
+    }
+
+    return count;
+}
+
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+} // namespace base
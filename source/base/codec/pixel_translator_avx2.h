@@ -0,0 +1,45 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_CODEC_PIXEL_TRANSLATOR_AVX2_H
+#define BASE_CODEC_PIXEL_TRANSLATOR_AVX2_H
+
+#include "base/codec/pixel_translator.h"
+#include "build/build_config.h"
+
+namespace base {
+
+#if defined(ARCH_CPU_X86_FAMILY)
+
+// The source format is 32bpp with 8 bit channels, the target format is the same.
+int translateRow_32bpp_32bpp_AVX2(
+    const uint8_t* src, uint8_t* dst, int width, const PixelTranslator::Params& params);
+
+// The source format is 32bpp with 8 bit channels, the target format is 16bpp.
+int translateRow_32bpp_16bpp_AVX2(
+    const uint8_t* src, uint8_t* dst, int width, const PixelTranslator::Params& params);
+
+// The source format is 32bpp with 8 bit channels, the target format is 8bpp.
+int translateRow_32bpp_8bpp_AVX2(
+    const uint8_t* src, uint8_t* dst, int width, const PixelTranslator::Params& params);
+
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+} // namespace base
+
+#endif // BASE_CODEC_PIXEL_TRANSLATOR_AVX2_H
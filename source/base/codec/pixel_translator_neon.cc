@@ -0,0 +1,122 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/pixel_translator_neon.h"
+
+#if defined(HAS_PIXEL_TRANSLATOR_NEON)
+#include <arm_neon.h>
+#endif // defined(HAS_PIXEL_TRANSLATOR_NEON)
+
+namespace base {
+
+#if defined(HAS_PIXEL_TRANSLATOR_NEON)
+
+namespace {
+
+// Scales the 8 bit channel value to the range [0, max] the same way as the scalar translator:
+// (value * max + 127) / 255. The division by 255 is exact for all 16 bit values used here.
+uint16x8_t scaleChannel(uint8x8_t value, uint8x8_t max, int16x8_t shift)
+{
+    uint16x8_t temp = vaddq_u16(vmull_u8(value, max), vdupq_n_u16(127));
+    temp = vaddq_u16(vaddq_u16(temp, vdupq_n_u16(1)), vshrq_n_u16(temp, 8));
+    return vshlq_u16(vshrq_n_u16(temp, 8), shift);
+}
+
+// Translates 16 pixels. Each 16 bit lane of the result contains one target pixel.
+uint16x8x2_t translate16(const uint8_t* src, const PixelTranslator::Params& params)
+{
+    // Each register contains one byte of every pixel.
+    const uint8x16x4_t pixels = vld4q_u8(src);
+
+    uint16x8x2_t result;
+    result.val[0] = vdupq_n_u16(0);
+    result.val[1] = vdupq_n_u16(0);
+
+    for (int i = 0; i < 3; ++i)
+    {
+        const uint8x16_t value = pixels.val[params.source_shift[i] / 8];
+        const uint8x8_t max = vdup_n_u8(static_cast<uint8_t>(params.target_max[i]));
+        const int16x8_t shift = vdupq_n_s16(static_cast<int16_t>(params.target_shift[i]));
+
+        result.val[0] = vorrq_u16(result.val[0], scaleChannel(vget_low_u8(value), max, shift));
+        result.val[1] = vorrq_u16(result.val[1], scaleChannel(vget_high_u8(value), max, shift));
+    }
+
+    return result;
+}
+
+} // namespace
+
+int translateRow_32bpp_32bpp_NEON(
+    const uint8_t* src, uint8_t* dst, int width, const PixelTranslator::Params& /* params */)
+{
+    const int count = width & ~3;
+    const uint32x4_t alpha = vdupq_n_u32(0xFF000000);
+
+    for (int x = 0; x < count; x += 4)
+    {
+        const uint32x4_t pixels = vld1q_u32(reinterpret_cast<const uint32_t*>(src));
+        vst1q_u32(reinterpret_cast<uint32_t*>(dst), vorrq_u32(pixels, alpha));
+
+        src += 16;
+        dst += 16;
+    }
+
+    return count;
+}
+
+int translateRow_32bpp_16bpp_NEON(
+    const uint8_t* src, uint8_t* dst, int width, const PixelTranslator::Params& params)
+{
+    const int count = width & ~15;
+
+    for (int x = 0; x < count; x += 16)
+    {
+        const uint16x8x2_t result = translate16(src, params);
+
+        vst1q_u16(reinterpret_cast<uint16_t*>(dst), result.val[0]);
+        vst1q_u16(reinterpret_cast<uint16_t*>(dst + 16), result.val[1]);
+
+        src += 64;
+        dst += 32;
+    }
+
+    return count;
+}
+
+int translateRow_32bpp_8bpp_NEON(
+    const uint8_t* src, uint8_t* dst, int width, const PixelTranslator::Params& params)
+{
+    const int count = width & ~15;
+
+    for (int x = 0; x < count; x += 16)
+    {
+        const uint16x8x2_t result = translate16(src, params);
+
+        vst1q_u8(dst, vcombine_u8(vmovn_u16(result.val[0]), vmovn_u16(result.val[1])));
+
+        src += 64;
+        dst += 16;
+    }
+
+    return count;
+}
+
+#endif // defined(HAS_PIXEL_TRANSLATOR_NEON)
+
+} // namespace base
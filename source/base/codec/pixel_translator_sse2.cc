@@ -0,0 +1,141 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/pixel_translator_sse2.h"
+
+#if defined(ARCH_CPU_X86_FAMILY)
+#if defined(CC_MSVC)
+#include <intrin.h>
+#else
+#include <emmintrin.h>
+#endif // defined(CC_*)
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+namespace base {
+
+#if defined(ARCH_CPU_X86_FAMILY)
+
+namespace {
+
+struct Channels
+{
+    explicit Channels(const PixelTranslator::Params& params)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            source_shift[i] = _mm_cvtsi32_si128(params.source_shift[i]);
+            target_max[i] = _mm_set1_epi16(static_cast<int16_t>(params.target_max[i]));
+            target_shift[i] = _mm_cvtsi32_si128(params.target_shift[i]);
+        }
+    }
+
+    __m128i source_shift[3];
+    __m128i target_max[3];
+    __m128i target_shift[3];
+};
+
+// Scales the 8 bit channel value to the range [0, max] the same way as the scalar translator:
+// (value * max + 127) / 255. The division by 255 is exact for all 16 bit values used here.
+__m128i scaleChannel(__m128i value, __m128i max, __m128i shift)
+{
+    __m128i temp = _mm_add_epi16(_mm_mullo_epi16(value, max), _mm_set1_epi16(127));
+    temp = _mm_add_epi16(_mm_add_epi16(temp, _mm_set1_epi16(1)), _mm_srli_epi16(temp, 8));
+    return _mm_sll_epi16(_mm_srli_epi16(temp, 8), shift);
+}
+
+// Translates 8 pixels. Each 16 bit lane of the result contains one target pixel.
+__m128i translate8(const uint8_t* src, const Channels& channels)
+{
+    const __m128i pixels_lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    const __m128i pixels_hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+    const __m128i mask = _mm_set1_epi32(0xFF);
+
+    __m128i result = _mm_setzero_si128();
+
+    for (int i = 0; i < 3; ++i)
+    {
+        const __m128i lo = _mm_and_si128(_mm_srl_epi32(pixels_lo, channels.source_shift[i]), mask);
+        const __m128i hi = _mm_and_si128(_mm_srl_epi32(pixels_hi, channels.source_shift[i]), mask);
+
+        result = _mm_or_si128(result, scaleChannel(
+            _mm_packs_epi32(lo, hi), channels.target_max[i], channels.target_shift[i]));
+    }
+
+    return result;
+}
+
+} // namespace
+
+int translateRow_32bpp_32bpp_SSE2(
+    const uint8_t* src, uint8_t* dst, int width, const PixelTranslator::Params& /* params */)
+{
+    const int count = width & ~3;
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+
+    for (int x = 0; x < count; x += 4)
+    {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_or_si128(pixels, alpha));
+
+        src += 16;
+        dst += 16;
+    }
+
+    return count;
+}
+
+int translateRow_32bpp_16bpp_SSE2(
+    const uint8_t* src, uint8_t* dst, int width, const PixelTranslator::Params& params)
+{
+    const Channels channels(params);
+    const int count = width & ~7;
+
+    for (int x = 0; x < count; x += 8)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), translate8(src, channels));
+
+        src += 32;
+        dst += 16;
+    }
+
+    return count;
+}
+
+int translateRow_32bpp_8bpp_SSE2(
+    const uint8_t* src, uint8_t* dst, int width, const PixelTranslator::Params& params)
+{
+    const Channels channels(params);
+    const int count = width & ~15;
+
+    for (int x = 0; x < count; x += 16)
+    {
+        const __m128i lo = translate8(src, channels);
+        const __m128i hi = translate8(src + 32, channels);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(lo, hi));
+
+        src += 64;
+        dst += 16;
+    }
+
+    return count;
+}
+
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+} // namespace base
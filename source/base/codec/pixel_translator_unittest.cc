@@ -0,0 +1,263 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/pixel_translator.h"
+#include "base/codec/pixel_translator_avx2.h"
+#include "base/codec/pixel_translator_neon.h"
+#include "base/codec/pixel_translator_sse2.h"
+
+#include <gtest/gtest.h>
+#include <libyuv/cpu_id.h>
+
+#include <random>
+#include <vector>
+
+namespace base {
+
+namespace {
+
+// The width is not a multiple of the vector size to check the processing of the row tail.
+const int kWidth = 101;
+const int kHeight = 7;
+const int kSourceStride = kWidth * 4 + 12;
+
+// Run 100 times to mimic 100 full frames.
+const int kBenchmarkWidth = 1920;
+const int kBenchmarkHeight = 1080;
+const int kTimesToRun = 100;
+
+std::vector<uint8_t> generateSource(int stride, int height)
+{
+    std::mt19937 engine(1234);
+    std::uniform_int_distribution<int> distribution(0, 255);
+
+    std::vector<uint8_t> source(static_cast<size_t>(stride * height));
+    for (auto& value : source)
+        value = static_cast<uint8_t>(distribution(engine));
+
+    return source;
+}
+
+uint32_t scaleChannel(uint32_t value, uint32_t source_max, uint32_t target_max)
+{
+    return (value * target_max + source_max / 2) / source_max;
+}
+
+// Reference implementation of the translation from ARGB.
+void translateReference(const uint8_t* src, uint8_t* dst, int width, const PixelFormat& target)
+{
+    const PixelFormat source = PixelFormat::ARGB();
+
+    for (int x = 0; x < width; ++x)
+    {
+        uint32_t pixel;
+        memcpy(&pixel, src + x * 4, sizeof(pixel));
+
+        const uint32_t red = scaleChannel(
+            pixel >> source.redShift() & source.redMax(), source.redMax(), target.redMax());
+        const uint32_t green = scaleChannel(
+            pixel >> source.greenShift() & source.greenMax(), source.greenMax(), target.greenMax());
+        const uint32_t blue = scaleChannel(
+            pixel >> source.blueShift() & source.blueMax(), source.blueMax(), target.blueMax());
+
+        const uint32_t result = (red << target.redShift()) | (green << target.greenShift()) |
+                                (blue << target.blueShift()) | 0xFF000000;
+
+        memcpy(dst + x * target.bytesPerPixel(), &result, target.bytesPerPixel());
+    }
+}
+
+std::vector<PixelFormat> targetFormats()
+{
+    return { PixelFormat::ARGB(), PixelFormat::RGB565(), PixelFormat::RGB332(),
+             PixelFormat::RGB222(), PixelFormat::RGB111() };
+}
+
+PixelTranslator::Params makeParams(const PixelFormat& target)
+{
+    const PixelFormat source = PixelFormat::ARGB();
+
+    PixelTranslator::Params params;
+    params.source_shift[0] = source.redShift();
+    params.source_shift[1] = source.greenShift();
+    params.source_shift[2] = source.blueShift();
+    params.target_max[0] = target.redMax();
+    params.target_max[1] = target.greenMax();
+    params.target_max[2] = target.blueMax();
+    params.target_shift[0] = target.redShift();
+    params.target_shift[1] = target.greenShift();
+    params.target_shift[2] = target.blueShift();
+    return params;
+}
+
+struct RowFuncs
+{
+    PixelTranslator::RowFunc func_32bpp;
+    PixelTranslator::RowFunc func_16bpp;
+    PixelTranslator::RowFunc func_8bpp;
+
+    PixelTranslator::RowFunc select(const PixelFormat& target) const
+    {
+        switch (target.bytesPerPixel())
+        {
+            case 4: return func_32bpp;
+            case 2: return func_16bpp;
+            default: return func_8bpp;
+        }
+    }
+};
+
+void testRowFuncs(const RowFuncs& funcs)
+{
+    const std::vector<uint8_t> source = generateSource(kWidth * 4, 1);
+
+    for (const auto& target : targetFormats())
+    {
+        const int bytes_per_pixel = target.bytesPerPixel();
+
+        std::vector<uint8_t> expected(static_cast<size_t>(kWidth * bytes_per_pixel));
+        std::vector<uint8_t> actual(expected.size());
+
+        translateReference(source.data(), expected.data(), kWidth, target);
+
+        const int count =
+            funcs.select(target)(source.data(), actual.data(), kWidth, makeParams(target));
+        ASSERT_GT(count, 0);
+        ASSERT_LE(count, kWidth);
+
+        const size_t size = static_cast<size_t>(count * bytes_per_pixel);
+        EXPECT_EQ(0, memcmp(expected.data(), actual.data(), size))
+            << "Target bits per pixel: " << static_cast<int>(target.bitsPerPixel());
+    }
+}
+
+} // namespace
+
+TEST(pixel_translator_test, translate_from_argb)
+{
+    const std::vector<uint8_t> source = generateSource(kSourceStride, kHeight);
+
+    for (const auto& target : targetFormats())
+    {
+        std::unique_ptr<PixelTranslator> translator =
+            PixelTranslator::create(PixelFormat::ARGB(), target);
+        ASSERT_TRUE(translator);
+
+        const int target_stride = kWidth * target.bytesPerPixel();
+
+        std::vector<uint8_t> expected(static_cast<size_t>(target_stride * kHeight));
+        std::vector<uint8_t> actual(expected.size());
+
+        for (int y = 0; y < kHeight; ++y)
+        {
+            translateReference(source.data() + y * kSourceStride,
+                               expected.data() + y * target_stride,
+                               kWidth, target);
+        }
+
+        translator->translate(source.data(), kSourceStride, actual.data(), target_stride,
+                              kWidth, kHeight);
+
+        EXPECT_EQ(expected, actual)
+            << "Target bits per pixel: " << static_cast<int>(target.bitsPerPixel());
+    }
+}
+
+#if defined(ARCH_CPU_X86_FAMILY)
+
+TEST(pixel_translator_test, sse2)
+{
+    if (!libyuv::TestCpuFlag(libyuv::kCpuHasSSE2))
+        return;
+
+    testRowFuncs({ translateRow_32bpp_32bpp_SSE2,
+                   translateRow_32bpp_16bpp_SSE2,
+                   translateRow_32bpp_8bpp_SSE2 });
+}
+
+TEST(pixel_translator_test, avx2)
+{
+    if (!libyuv::TestCpuFlag(libyuv::kCpuHasAVX2))
+        return;
+
+    testRowFuncs({ translateRow_32bpp_32bpp_AVX2,
+                   translateRow_32bpp_16bpp_AVX2,
+                   translateRow_32bpp_8bpp_AVX2 });
+}
+
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+#if defined(HAS_PIXEL_TRANSLATOR_NEON)
+
+TEST(pixel_translator_test, neon)
+{
+    if (!libyuv::TestCpuFlag(libyuv::kCpuHasNEON))
+        return;
+
+    testRowFuncs({ translateRow_32bpp_32bpp_NEON,
+                   translateRow_32bpp_16bpp_NEON,
+                   translateRow_32bpp_8bpp_NEON });
+}
+
+#endif // defined(HAS_PIXEL_TRANSLATOR_NEON)
+
+TEST(pixel_translator_test, DISABLED_benchmark)
+{
+    const int source_stride = kBenchmarkWidth * 4;
+    const std::vector<uint8_t> source = generateSource(source_stride, kBenchmarkHeight);
+
+    for (const auto& target : targetFormats())
+    {
+        std::unique_ptr<PixelTranslator> translator =
+            PixelTranslator::create(PixelFormat::ARGB(), target);
+        ASSERT_TRUE(translator);
+
+        const int target_stride = kBenchmarkWidth * target.bytesPerPixel();
+        std::vector<uint8_t> target_data(static_cast<size_t>(target_stride * kBenchmarkHeight));
+
+        for (int i = 0; i < kTimesToRun; ++i)
+        {
+            translator->translate(source.data(), source_stride, target_data.data(),
+                                  target_stride, kBenchmarkWidth, kBenchmarkHeight);
+        }
+    }
+}
+
+TEST(pixel_translator_test, DISABLED_benchmark_reference)
+{
+    const int source_stride = kBenchmarkWidth * 4;
+    const std::vector<uint8_t> source = generateSource(source_stride, kBenchmarkHeight);
+
+    for (const auto& target : targetFormats())
+    {
+        const int target_stride = kBenchmarkWidth * target.bytesPerPixel();
+        std::vector<uint8_t> target_data(static_cast<size_t>(target_stride * kBenchmarkHeight));
+
+        for (int i = 0; i < kTimesToRun; ++i)
+        {
+            for (int y = 0; y < kBenchmarkHeight; ++y)
+            {
+                translateReference(source.data() + y * source_stride,
+                                   target_data.data() + y * target_stride,
+                                   kBenchmarkWidth, target);
+            }
+        }
+    }
+}
+
+} // namespace base
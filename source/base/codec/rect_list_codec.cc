@@ -0,0 +1,187 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/rect_list_codec.h"
+
+#include "base/logging.h"
+#include "base/desktop/region.h"
+
+#include <iterator>
+#include <limits>
+
+namespace base {
+
+namespace {
+
+// The zigzag differences of 32-bit coordinates take up to 34 bits, so a varint takes up to 5
+// bytes.
+const size_t kMaxVarintSize = 5;
+const size_t kMaxRectSize = 4 * kMaxVarintSize;
+
+uint64_t zigzagEncode(int64_t value)
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t zigzagDecode(uint64_t value)
+{
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+void writeVarint(uint64_t value, std::string* output)
+{
+    while (value >= 0x80)
+    {
+        output->push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+
+    output->push_back(static_cast<char>(value));
+}
+
+bool readVarint(std::string_view* input, uint64_t* value)
+{
+    uint64_t result = 0;
+
+    for (size_t i = 0; i < kMaxVarintSize && i < input->size(); ++i)
+    {
+        const uint8_t byte = static_cast<uint8_t>((*input)[i]);
+        result |= static_cast<uint64_t>(byte & 0x7F) << (7 * i);
+
+        if (!(byte & 0x80))
+        {
+            input->remove_prefix(i + 1);
+            *value = result;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// The state of the coding, which the encoder and the decoder change in the same way.
+struct Previous
+{
+    void update(const Rect& rect)
+    {
+        if (is_first || rect.y() != y)
+            row_x = rect.x();
+
+        is_first = false;
+        y = rect.y();
+        right = rect.right();
+        height = rect.height();
+    }
+
+    bool is_first = true;
+    int32_t y = 0;
+    int32_t row_x = 0;
+    int32_t right = 0;
+    int32_t height = 0;
+};
+
+void encodeRect(const Rect& rect, Previous* previous, std::string* output)
+{
+    DCHECK_GE(rect.width(), 0);
+
+    const int64_t base_x = (rect.y() == previous->y) ? previous->right : previous->row_x;
+
+    writeVarint(zigzagEncode(static_cast<int64_t>(rect.y()) - previous->y), output);
+    writeVarint(zigzagEncode(static_cast<int64_t>(rect.x()) - base_x), output);
+    writeVarint(static_cast<uint64_t>(rect.width()), output);
+    writeVarint(zigzagEncode(static_cast<int64_t>(rect.height()) - previous->height), output);
+
+    previous->update(rect);
+}
+
+bool isValidCoordinate(int64_t value)
+{
+    return value >= std::numeric_limits<int32_t>::min() &&
+           value <= std::numeric_limits<int32_t>::max();
+}
+
+} // namespace
+
+// static
+void RectListCodec::encode(const std::vector<Rect>& rects, std::string* output)
+{
+    DCHECK(output);
+
+    output->clear();
+    output->reserve(rects.size() * kMaxRectSize);
+
+    Previous previous;
+    for (const auto& rect : rects)
+        encodeRect(rect, &previous, output);
+}
+
+// static
+void RectListCodec::encode(const Region& region, std::string* output)
+{
+    DCHECK(output);
+
+    output->clear();
+
+    Previous previous;
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+        encodeRect(it.rect(), &previous, output);
+}
+
+// static
+bool RectListCodec::decode(std::string_view input, std::vector<Rect>* rects)
+{
+    DCHECK(rects);
+
+    rects->clear();
+
+    Previous previous;
+    while (!input.empty())
+    {
+        uint64_t values[4];
+
+        for (size_t i = 0; i < std::size(values); ++i)
+        {
+            if (!readVarint(&input, &values[i]))
+                return false;
+        }
+
+        const int64_t y = previous.y + zigzagDecode(values[0]);
+        const int64_t base_x = (y == previous.y) ? previous.right : previous.row_x;
+        const int64_t x = base_x + zigzagDecode(values[1]);
+        if (values[2] > static_cast<uint64_t>(std::numeric_limits<int32_t>::max()))
+            return false;
+
+        const int64_t width = static_cast<int64_t>(values[2]);
+        const int64_t height = previous.height + zigzagDecode(values[3]);
+
+        if (!isValidCoordinate(x) || !isValidCoordinate(y) || height < 0 ||
+            !isValidCoordinate(x + width) || !isValidCoordinate(y + height))
+        {
+            return false;
+        }
+
+        const Rect rect = Rect::makeXYWH(static_cast<int32_t>(x), static_cast<int32_t>(y),
+                                         static_cast<int32_t>(width), static_cast<int32_t>(height));
+        rects->emplace_back(rect);
+        previous.update(rect);
+    }
+
+    return true;
+}
+
+} // namespace base
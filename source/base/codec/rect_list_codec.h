@@ -0,0 +1,58 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_CODEC_RECT_LIST_CODEC_H
+#define BASE_CODEC_RECT_LIST_CODEC_H
+
+#include "base/macros_magic.h"
+#include "base/desktop/geometry.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace base {
+
+class Region;
+
+// Codes a list of rectangles as varints of the differences from the previous rectangle, which is
+// much smaller than repeated proto::Rect messages for the many small rectangles of a region. Each
+// rectangle is coded as:
+//   y - previous y (zigzag);
+//   x - previous right edge if y has not changed, otherwise x - x of the first rectangle of the
+//   previous row (zigzag);
+//   width;
+//   height - previous height (zigzag).
+// The rectangles of a region go in rows of the same height, so most of them take 4 bytes.
+class RectListCodec
+{
+public:
+    // Codes |rects| into |output|. The previous content of |output| is replaced.
+    static void encode(const std::vector<Rect>& rects, std::string* output);
+    static void encode(const Region& region, std::string* output);
+
+    // Restores the rectangles from |input| into |rects|. Returns false if the input is damaged.
+    static bool decode(std::string_view input, std::vector<Rect>* rects);
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(RectListCodec);
+};
+
+} // namespace base
+
+#endif // BASE_CODEC_RECT_LIST_CODEC_H
@@ -0,0 +1,148 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/rect_list_codec.h"
+
+#include "base/desktop/region.h"
+
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <random>
+
+namespace base {
+
+namespace {
+
+void expectRectsEqual(const std::vector<Rect>& expected, const std::vector<Rect>& actual)
+{
+    ASSERT_EQ(expected.size(), actual.size());
+
+    for (size_t i = 0; i < expected.size(); ++i)
+        EXPECT_TRUE(expected[i].equals(actual[i])) << "Rectangle " << i;
+}
+
+} // namespace
+
+TEST(RectListCodecTest, Empty)
+{
+    std::string data;
+    RectListCodec::encode(std::vector<Rect>(), &data);
+    EXPECT_TRUE(data.empty());
+
+    std::vector<Rect> rects = { Rect::makeXYWH(1, 2, 3, 4) };
+    EXPECT_TRUE(RectListCodec::decode(data, &rects));
+    EXPECT_TRUE(rects.empty());
+}
+
+TEST(RectListCodecTest, RandomRects)
+{
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int32_t> coordinate(-5000, 5000);
+    std::uniform_int_distribution<int32_t> extent(0, 3000);
+
+    std::vector<Rect> rects;
+    for (int i = 0; i < 1000; ++i)
+    {
+        rects.emplace_back(Rect::makeXYWH(
+            coordinate(random), coordinate(random), extent(random), extent(random)));
+    }
+
+    std::string data;
+    RectListCodec::encode(rects, &data);
+
+    std::vector<Rect> decoded;
+    ASSERT_TRUE(RectListCodec::decode(data, &decoded));
+    expectRectsEqual(rects, decoded);
+}
+
+TEST(RectListCodecTest, ExtremeCoordinates)
+{
+    const int32_t kMin = std::numeric_limits<int32_t>::min();
+    const int32_t kMax = std::numeric_limits<int32_t>::max();
+
+    const std::vector<Rect> rects =
+    {
+        Rect::makeXYWH(kMin, kMin, 0, 0),
+        Rect::makeXYWH(kMax, kMax, 0, 0),
+        Rect::makeXYWH(kMin, kMax, kMax, 0),
+        Rect::makeXYWH(0, kMin, 0, kMax)
+    };
+
+    std::string data;
+    RectListCodec::encode(rects, &data);
+
+    std::vector<Rect> decoded;
+    ASSERT_TRUE(RectListCodec::decode(data, &decoded));
+    expectRectsEqual(rects, decoded);
+}
+
+TEST(RectListCodecTest, Region)
+{
+    Region region;
+    for (int y = 0; y < 1080; y += 32)
+    {
+        for (int x = (y / 32) % 2 * 16; x < 1920; x += 48)
+            region.addRect(Rect::makeXYWH(x, y, 16, 16));
+    }
+
+    std::vector<Rect> expected;
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+        expected.emplace_back(it.rect());
+
+    std::string data;
+    RectListCodec::encode(region, &data);
+
+    // The rectangles of a row differ only in their position.
+    EXPECT_EQ(data.size(), expected.size() * 4);
+
+    std::vector<Rect> decoded;
+    ASSERT_TRUE(RectListCodec::decode(data, &decoded));
+    expectRectsEqual(expected, decoded);
+}
+
+TEST(RectListCodecTest, DamagedInput)
+{
+    const std::vector<Rect> rects =
+    {
+        Rect::makeXYWH(10, 20, 300, 400),
+        Rect::makeXYWH(320, 20, 300, 400),
+        Rect::makeXYWH(10, 500, 300, 40)
+    };
+
+    std::string data;
+    RectListCodec::encode(rects, &data);
+
+    std::vector<Rect> decoded;
+
+    // A rectangle is cut off.
+    EXPECT_FALSE(RectListCodec::decode(std::string_view(data.data(), data.size() - 1), &decoded));
+
+    // A varint does not end.
+    EXPECT_FALSE(RectListCodec::decode(std::string(6, '\xFF'), &decoded));
+
+    // The width does not fit into 32 bits.
+    EXPECT_FALSE(RectListCodec::decode(std::string("\x00\x00\xFF\xFF\xFF\xFF\x0F\x00", 8),
+                                       &decoded));
+
+    // The rectangle is outside of the coordinate range.
+    EXPECT_FALSE(RectListCodec::decode(std::string("\x00\xFE\xFF\xFF\xFF\x0F\x01\x00", 8),
+                                       &decoded));
+}
+
+} // namespace base
@@ -19,12 +19,35 @@
 #include "base/codec/scale_reducer.h"
 
 #include "base/logging.h"
+#include "base/trace_event.h"
 #include "base/desktop/frame_simple.h"
+#include "base/threading/worker_pool.h"
 
+#include <libyuv/scale.h>
 #include <libyuv/scale_argb.h>
 
+#include <algorithm>
+#include <thread>
+
 namespace base {
 
+namespace {
+
+// Smaller updates are scaled on the encoder thread. The pool is not worth waking up for them.
+const int64_t kMinThreadedArea = 256 * 256;
+
+// Minimum number of target pixels in one band.
+const int64_t kMinBandArea = 128 * 128;
+
+const int kMaxThreadCount = 4;
+
+libyuv::FilterMode filterMode(ScaleReducer::Filter filter)
+{
+    return filter == ScaleReducer::Filter::BILINEAR ? libyuv::kFilterBilinear : libyuv::kFilterBox;
+}
+
+} // namespace
+
 ScaleReducer::ScaleReducer()
 {
     LOG(LS_INFO) << "Ctor";
@@ -35,8 +58,28 @@ ScaleReducer::~ScaleReducer()
     LOG(LS_INFO) << "Dtor";
 }
 
+void ScaleReducer::setFilter(Filter filter)
+{
+    if (filter_ == filter)
+        return;
+
+    LOG(LS_INFO) << "Scale filter changed: " << static_cast<int>(filter);
+
+    filter_ = filter;
+
+    // The scale mode is reset, so the whole frame is scaled again.
+    source_size_ = Size();
+}
+
+size_t ScaleReducer::memoryUsage() const
+{
+    return target_frame_ ? target_frame_->memorySize() : 0;
+}
+
 const Frame* ScaleReducer::scaleFrame(const Frame* source_frame, const Size& target_size)
 {
+    TRACE_EVENT("scale");
+
     DCHECK(source_frame);
     DCHECK(!source_frame->constUpdatedRegion().isEmpty());
     DCHECK(source_frame->format() == PixelFormat::ARGB());
@@ -49,7 +92,9 @@ const Frame* ScaleReducer::scaleFrame(const Frame* source_frame, const Size& tar
         return nullptr;
     }
 
-    if (source_size_ != source_size || target_size_ != target_size)
+    const Size& screen_size = source_frame->screenSize();
+
+    if (source_size_ != source_size || target_size_ != target_size || screen_size_ != screen_size)
     {
         const_cast<Frame*>(source_frame)->updatedRegion()->addRect(Rect::makeSize(source_size));
 
@@ -57,7 +102,12 @@ const Frame* ScaleReducer::scaleFrame(const Frame* source_frame, const Size& tar
             static_cast<double>(source_size.width());
         scale_y_ = static_cast<double>(target_size.height() * 100.0) /
             static_cast<double>(source_size.height());
+        screen_scale_x_ = static_cast<double>(target_size.width() * 100.0) /
+            static_cast<double>(screen_size.width());
+        screen_scale_y_ = static_cast<double>(target_size.height() * 100.0) /
+            static_cast<double>(screen_size.height());
         source_size_ = source_size;
+        screen_size_ = screen_size;
         target_size_ = target_size;
         target_frame_.reset();
 
@@ -70,6 +120,12 @@ const Frame* ScaleReducer::scaleFrame(const Frame* source_frame, const Size& tar
 
     Rect target_frame_rect = Rect::makeSize(target_size);
 
+    if (target_frame_ && target_frame_->layout() != source_frame->layout())
+        target_frame_.reset();
+
+    if (source_frame->layout() == Frame::Layout::I420)
+        return scaleI420Frame(source_frame);
+
     if (!target_frame_)
     {
         target_frame_ = FrameSimple::create(target_size, PixelFormat::ARGB());
@@ -80,49 +136,205 @@ const Frame* ScaleReducer::scaleFrame(const Frame* source_frame, const Size& tar
         }
 
         target_frame_->updatedRegion()->addRect(target_frame_rect);
-
-        libyuv::ARGBScale(source_frame->frameData(),
-                          source_frame->stride(),
-                          source_size.width(),
-                          source_size.height(),
-                          target_frame_->frameData(),
-                          target_frame_->stride(),
-                          target_size.width(),
-                          target_size.height(),
-                          libyuv::kFilterBox);
     }
     else
     {
         Region* updated_region = target_frame_->updatedRegion();
         updated_region->clear();
 
+        // The scaled rectangles of neighbouring updates overlap. They are merged in the region,
+        // so each target pixel is scaled only once.
         for (Region::Iterator it(source_frame->constUpdatedRegion());
              !it.isAtEnd(); it.advance())
         {
             Rect target_rect = scaledRect(it.rect());
             target_rect.intersectWith(target_frame_rect);
+            updated_region->addRect(target_rect);
+        }
+    }
+
+    scaleRegion(source_frame, target_frame_->constUpdatedRegion());
+    return target_frame_.get();
+}
+
+const Frame* ScaleReducer::scaleI420Frame(const Frame* source_frame)
+{
+    Region* updated_region;
+
+    if (!target_frame_)
+    {
+        target_frame_ = FrameSimple::create(target_size_, PixelFormat::ARGB());
+        if (!target_frame_)
+        {
+            LOG(LS_ERROR) << "Unable to create target frame";
+            return nullptr;
+        }
+
+        target_frame_->setLayout(Frame::Layout::I420);
+
+        updated_region = target_frame_->updatedRegion();
+        updated_region->addRect(Rect::makeSize(target_size_));
+    }
+    else
+    {
+        const Rect target_frame_rect = Rect::makeSize(target_size_);
 
-            libyuv::ARGBScaleClip(source_frame->frameData(),
-                                  source_frame->stride(),
-                                  source_size.width(),
-                                  source_size.height(),
-                                  target_frame_->frameData(),
-                                  target_frame_->stride(),
-                                  target_size.width(),
-                                  target_size.height(),
-                                  target_rect.x(),
-                                  target_rect.y(),
-                                  target_rect.width(),
-                                  target_rect.height(),
-                                  libyuv::kFilterBox);
+        updated_region = target_frame_->updatedRegion();
+        updated_region->clear();
 
+        for (Region::Iterator it(source_frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
+        {
+            Rect target_rect = scaledRect(it.rect());
+            target_rect.intersectWith(target_frame_rect);
             updated_region->addRect(target_rect);
         }
     }
 
+    // libyuv has no clipped version of I420Scale, so the planes are scaled entirely. Pixels
+    // outside of the updated region are not changed by this.
+    const libyuv::FilterMode filter_mode = filterMode(filter_);
+
+    const int source_uv_width = (source_size_.width() + 1) / 2;
+    const int source_uv_height = (source_size_.height() + 1) / 2;
+    const int target_uv_width = (target_size_.width() + 1) / 2;
+    const int target_uv_height = (target_size_.height() + 1) / 2;
+
+    auto scale_plane = [&](int plane)
+    {
+        switch (plane)
+        {
+            case 0:
+                libyuv::ScalePlane(source_frame->yPlane(), source_frame->yStride(),
+                                   source_size_.width(), source_size_.height(),
+                                   target_frame_->yPlane(), target_frame_->yStride(),
+                                   target_size_.width(), target_size_.height(),
+                                   filter_mode);
+                break;
+
+            case 1:
+                libyuv::ScalePlane(source_frame->uPlane(), source_frame->uvStride(),
+                                   source_uv_width, source_uv_height,
+                                   target_frame_->uPlane(), target_frame_->uvStride(),
+                                   target_uv_width, target_uv_height,
+                                   filter_mode);
+                break;
+
+            default:
+                libyuv::ScalePlane(source_frame->vPlane(), source_frame->uvStride(),
+                                   source_uv_width, source_uv_height,
+                                   target_frame_->vPlane(), target_frame_->uvStride(),
+                                   target_uv_width, target_uv_height,
+                                   filter_mode);
+                break;
+        }
+    };
+
+    // The planes are independent. The luma plane takes two thirds of the time.
+    WorkerPool* worker_pool = workerPool(
+        static_cast<int64_t>(target_size_.width()) * target_size_.height());
+    if (worker_pool)
+    {
+        const int thread_count = worker_pool->threadCount();
+
+        worker_pool->run([&](int index)
+        {
+            for (int plane = index; plane < 3; plane += thread_count)
+                scale_plane(plane);
+        });
+    }
+    else
+    {
+        for (int plane = 0; plane < 3; ++plane)
+            scale_plane(plane);
+    }
+
     return target_frame_.get();
 }
 
+void ScaleReducer::scaleRegion(const Frame* source_frame, const Region& target_region)
+{
+    int64_t total_area = 0;
+    for (Region::Iterator it(target_region); !it.isAtEnd(); it.advance())
+        total_area += static_cast<int64_t>(it.rect().width()) * it.rect().height();
+
+    WorkerPool* worker_pool = workerPool(total_area);
+    const int thread_count = worker_pool ? worker_pool->threadCount() : 1;
+
+    bands_.clear();
+
+    for (Region::Iterator it(target_region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+        const int64_t area = static_cast<int64_t>(rect.width()) * rect.height();
+
+        // Each band writes its own rows of the target frame. The source rows they read overlap.
+        const int64_t max_band_count = std::min(thread_count, rect.height());
+        const int band_count =
+            static_cast<int>(std::clamp(area / kMinBandArea, int64_t(1), max_band_count));
+        const int band_height = (rect.height() + band_count - 1) / band_count;
+
+        for (int top = rect.top(); top < rect.bottom(); top += band_height)
+        {
+            bands_.emplace_back(Rect::makeLTRB(
+                rect.left(), top, rect.right(), std::min(top + band_height, rect.bottom())));
+        }
+    }
+
+    const libyuv::FilterMode filter_mode = filterMode(filter_);
+
+    auto scale_band = [&](const Rect& band)
+    {
+        libyuv::ARGBScaleClip(source_frame->frameData(),
+                              source_frame->stride(),
+                              source_size_.width(),
+                              source_size_.height(),
+                              target_frame_->frameData(),
+                              target_frame_->stride(),
+                              target_size_.width(),
+                              target_size_.height(),
+                              band.x(),
+                              band.y(),
+                              band.width(),
+                              band.height(),
+                              filter_mode);
+    };
+
+    if (!worker_pool || bands_.size() < 2)
+    {
+        for (const auto& band : bands_)
+            scale_band(band);
+        return;
+    }
+
+    const size_t band_count = bands_.size();
+    const size_t step = static_cast<size_t>(thread_count);
+
+    worker_pool->run([&](int index)
+    {
+        for (size_t i = static_cast<size_t>(index); i < band_count; i += step)
+            scale_band(bands_[i]);
+    });
+}
+
+WorkerPool* ScaleReducer::workerPool(int64_t area)
+{
+    if (area < kMinThreadedArea)
+        return nullptr;
+
+    if (!worker_pool_)
+    {
+        const int thread_count = std::clamp(
+            static_cast<int>(std::thread::hardware_concurrency()), 1, kMaxThreadCount);
+        if (thread_count < 2)
+            return nullptr;
+
+        LOG(LS_INFO) << "Scaling threads: " << thread_count;
+        worker_pool_ = std::make_unique<WorkerPool>(thread_count);
+    }
+
+    return worker_pool_.get();
+}
+
 Rect ScaleReducer::scaledRect(const Rect& source_rect)
 {
     int left = static_cast<int>(
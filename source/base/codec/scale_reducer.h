@@ -23,30 +23,60 @@
 #include "base/desktop/geometry.h"
 
 #include <memory>
+#include <vector>
 
 namespace base {
 
 class Frame;
+class Region;
+class WorkerPool;
 
 class ScaleReducer
 {
 public:
+    enum class Filter
+    {
+        BOX,     // Averages all source pixels, the text stays readable at small sizes.
+        BILINEAR // Several times faster, but thin lines can disappear.
+    };
+
     ScaleReducer();
     ~ScaleReducer();
 
+    // The next frame is scaled entirely with the new filter.
+    void setFilter(Filter filter);
+    Filter filter() const { return filter_; }
+
     const Frame* scaleFrame(const Frame* source_frame, const Size& target_size);
 
-    double scaleFactorX() const { return scale_x_; }
-    double scaleFactorY() const { return scale_y_; }
+    // Size of the buffer of the scaled frame in bytes.
+    size_t memoryUsage() const;
+
+    // Scale factors of the target frame relative to the screen in percent. They differ from the
+    // scale of the frame if the capturer has already scaled it down.
+    double scaleFactorX() const { return screen_scale_x_; }
+    double scaleFactorY() const { return screen_scale_y_; }
 
 private:
+    const Frame* scaleI420Frame(const Frame* source_frame);
     Rect scaledRect(const Rect& source_rect);
 
+    // Scales the rectangles of |target_region| from |source_frame|. Large rectangles are split
+    // into bands of rows that are scaled in parallel.
+    void scaleRegion(const Frame* source_frame, const Region& target_region);
+    WorkerPool* workerPool(int64_t area);
+
     std::unique_ptr<Frame> target_frame_;
+    std::unique_ptr<WorkerPool> worker_pool_;
+    std::vector<Rect> bands_;
+    Filter filter_ = Filter::BOX;
     Size source_size_;
+    Size screen_size_;
     Size target_size_;
     double scale_x_ = 0;
     double scale_y_ = 0;
+    double screen_scale_x_ = 0;
+    double screen_scale_y_ = 0;
 
     DISALLOW_COPY_AND_ASSIGN(ScaleReducer);
 };
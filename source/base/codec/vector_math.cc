@@ -19,12 +19,14 @@
 #include "base/codec/vector_math.h"
 
 #include "base/logging.h"
+#include "base/codec/audio_sample_types.h"
 #include "build/build_config.h"
 
 #include <algorithm>
 
 // NaCl does not allow intrinsics.
 #if defined(ARCH_CPU_X86_FAMILY)
+#include <emmintrin.h>
 #include <xmmintrin.h>
 // Don't use custom SSE versions where the auto-vectorized C version performs better, which is
 // anywhere clang is used.
@@ -38,15 +40,30 @@
 #define FMUL_FUNC FMUL_C
 #endif
 #define EWMAAndMaxPower_FUNC EWMAAndMaxPower_SSE
+#define CONVERT_INT16_TO_FLOAT_FUNC convertInt16ToFloat_SSE2
+#define CONVERT_FLOAT_TO_INT16_FUNC convertFloatToInt16_SSE2
+#define DEINTERLEAVE_INT16_STEREO_FUNC deinterleaveInt16Stereo_SSE2
+#define INTERLEAVE_INT16_STEREO_FUNC interleaveInt16Stereo_SSE2
+#define APPLY_GAIN_INT16_FUNC applyGainInt16_SSE2
 #elif defined(ARCH_CPU_ARM_FAMILY) && defined(USE_NEON)
 #include <arm_neon.h>
 #define FMAC_FUNC FMAC_NEON
 #define FMUL_FUNC FMUL_NEON
 #define EWMAAndMaxPower_FUNC EWMAAndMaxPower_NEON
+#define CONVERT_INT16_TO_FLOAT_FUNC convertInt16ToFloat_NEON
+#define CONVERT_FLOAT_TO_INT16_FUNC convertFloatToInt16_NEON
+#define DEINTERLEAVE_INT16_STEREO_FUNC deinterleaveInt16Stereo_NEON
+#define INTERLEAVE_INT16_STEREO_FUNC interleaveInt16Stereo_NEON
+#define APPLY_GAIN_INT16_FUNC applyGainInt16_NEON
 #else
 #define FMAC_FUNC FMAC_C
 #define FMUL_FUNC FMUL_C
 #define EWMAAndMaxPower_FUNC EWMAAndMaxPower_C
+#define CONVERT_INT16_TO_FLOAT_FUNC convertInt16ToFloat_C
+#define CONVERT_FLOAT_TO_INT16_FUNC convertFloatToInt16_C
+#define DEINTERLEAVE_INT16_STEREO_FUNC deinterleaveInt16Stereo_C
+#define INTERLEAVE_INT16_STEREO_FUNC interleaveInt16Stereo_C
+#define APPLY_GAIN_INT16_FUNC applyGainInt16_C
 #endif
 
 namespace base {
@@ -79,7 +96,159 @@ std::pair<float, float> EWMAAndMaxPower_C(
     return result;
 }
 
+void convertInt16ToFloat_C(const int16_t src[], int len, float dest[])
+{
+    for (int i = 0; i < len; ++i)
+        dest[i] = SignedInt16SampleTypeTraits::ToFloat(src[i]);
+}
+
+void convertFloatToInt16_C(const float src[], int len, int16_t dest[])
+{
+    for (int i = 0; i < len; ++i)
+        dest[i] = SignedInt16SampleTypeTraits::FromFloat(src[i]);
+}
+
+void deinterleaveInt16Stereo_C(const int16_t src[], int frames, float left[], float right[])
+{
+    for (int i = 0; i < frames; ++i)
+    {
+        left[i] = SignedInt16SampleTypeTraits::ToFloat(src[i * 2]);
+        right[i] = SignedInt16SampleTypeTraits::ToFloat(src[i * 2 + 1]);
+    }
+}
+
+void interleaveInt16Stereo_C(const float left[], const float right[], int frames, int16_t dest[])
+{
+    for (int i = 0; i < frames; ++i)
+    {
+        dest[i * 2] = SignedInt16SampleTypeTraits::FromFloat(left[i]);
+        dest[i * 2 + 1] = SignedInt16SampleTypeTraits::FromFloat(right[i]);
+    }
+}
+
+void applyGainInt16_C(int16_t data[], int len, int32_t gain)
+{
+    for (int i = 0; i < len; ++i)
+        data[i] = static_cast<int16_t>((static_cast<int32_t>(data[i]) * gain) >> 16);
+}
+
 #if defined(ARCH_CPU_X86_FAMILY) && !defined(OS_NACL)
+namespace {
+
+// Converts four 32-bit integers in the 16-bit range to floats like
+// SignedInt16SampleTypeTraits::ToFloat. Negative and positive values have different scales.
+__m128 int32ToSampleFloat_SSE2(__m128i value)
+{
+    const __m128 value_f = _mm_cvtepi32_ps(value);
+    const __m128 negative = _mm_cmplt_ps(value_f, _mm_setzero_ps());
+    const __m128 scale = _mm_or_ps(_mm_and_ps(negative, _mm_set_ps1(1.0f / 32768.0f)),
+                                   _mm_andnot_ps(negative, _mm_set_ps1(1.0f / 32767.0f)));
+    return _mm_mul_ps(value_f, scale);
+}
+
+// Converts four floats to 32-bit integers in the 16-bit range like
+// SignedInt16SampleTypeTraits::FromFloat.
+__m128i sampleFloatToInt32_SSE2(__m128 value)
+{
+    value = _mm_min_ps(_mm_max_ps(value, _mm_set_ps1(-1.0f)), _mm_set_ps1(1.0f));
+    const __m128 negative = _mm_cmplt_ps(value, _mm_setzero_ps());
+    const __m128 scale = _mm_or_ps(_mm_and_ps(negative, _mm_set_ps1(32768.0f)),
+                                   _mm_andnot_ps(negative, _mm_set_ps1(32767.0f)));
+    return _mm_cvttps_epi32(_mm_mul_ps(value, scale));
+}
+
+} // namespace
+
+void convertInt16ToFloat_SSE2(const int16_t src[], int len, float dest[])
+{
+    const int last_index = len - len % 8;
+
+    for (int i = 0; i < last_index; i += 8)
+    {
+        const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+
+        // Sign-extend the samples to 32 bits.
+        _mm_storeu_ps(dest + i, int32ToSampleFloat_SSE2(
+            _mm_srai_epi32(_mm_unpacklo_epi16(value, value), 16)));
+        _mm_storeu_ps(dest + i + 4, int32ToSampleFloat_SSE2(
+            _mm_srai_epi32(_mm_unpackhi_epi16(value, value), 16)));
+    }
+
+    convertInt16ToFloat_C(src + last_index, len - last_index, dest + last_index);
+}
+
+void convertFloatToInt16_SSE2(const float src[], int len, int16_t dest[])
+{
+    const int last_index = len - len % 8;
+
+    for (int i = 0; i < last_index; i += 8)
+    {
+        const __m128i low = sampleFloatToInt32_SSE2(_mm_loadu_ps(src + i));
+        const __m128i high = sampleFloatToInt32_SSE2(_mm_loadu_ps(src + i + 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), _mm_packs_epi32(low, high));
+    }
+
+    convertFloatToInt16_C(src + last_index, len - last_index, dest + last_index);
+}
+
+void deinterleaveInt16Stereo_SSE2(const int16_t src[], int frames, float left[], float right[])
+{
+    const int last_index = frames - frames % 4;
+
+    for (int i = 0; i < last_index; i += 4)
+    {
+        // Each 32-bit lane holds one frame: the left sample in the low half and the right sample
+        // in the high half.
+        const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+
+        _mm_storeu_ps(left + i, int32ToSampleFloat_SSE2(
+            _mm_srai_epi32(_mm_slli_epi32(value, 16), 16)));
+        _mm_storeu_ps(right + i, int32ToSampleFloat_SSE2(_mm_srai_epi32(value, 16)));
+    }
+
+    deinterleaveInt16Stereo_C(src + last_index * 2, frames - last_index,
+                              left + last_index, right + last_index);
+}
+
+void interleaveInt16Stereo_SSE2(const float left[], const float right[], int frames, int16_t dest[])
+{
+    const int last_index = frames - frames % 4;
+
+    for (int i = 0; i < last_index; i += 4)
+    {
+        const __m128i left_value = sampleFloatToInt32_SSE2(_mm_loadu_ps(left + i));
+        const __m128i right_value = sampleFloatToInt32_SSE2(_mm_loadu_ps(right + i));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i * 2),
+                         _mm_packs_epi32(_mm_unpacklo_epi32(left_value, right_value),
+                                         _mm_unpackhi_epi32(left_value, right_value)));
+    }
+
+    interleaveInt16Stereo_C(left + last_index, right + last_index, frames - last_index,
+                            dest + last_index * 2);
+}
+
+void applyGainInt16_SSE2(int16_t data[], int len, int32_t gain)
+{
+    const int last_index = len - len % 8;
+
+    // _mm_mulhi_epi16 multiplies signed values only. A gain of 32768 or more becomes negative
+    // (gain - 65536), and the sample is added to the product to compensate for this.
+    const __m128i gain_x8 = _mm_set1_epi16(static_cast<int16_t>(gain));
+    const __m128i correction_mask = _mm_set1_epi16(gain >= 32768 ? -1 : 0);
+
+    for (int i = 0; i < last_index; i += 8)
+    {
+        __m128i* ptr = reinterpret_cast<__m128i*>(data + i);
+        const __m128i value = _mm_loadu_si128(ptr);
+
+        _mm_storeu_si128(ptr, _mm_add_epi16(_mm_mulhi_epi16(value, gain_x8),
+                                            _mm_and_si128(value, correction_mask)));
+    }
+
+    applyGainInt16_C(data + last_index, len - last_index, gain);
+}
+
 void FMUL_SSE(const float src[], float scale, int len, float dest[])
 {
     const int rem = len % 4;
@@ -284,6 +453,108 @@ std::pair<float, float> EWMAAndMaxPower_NEON(
 
     return result;
 }
+
+namespace {
+
+float32x4_t int32ToSampleFloat_NEON(int32x4_t value)
+{
+    const float32x4_t value_f = vcvtq_f32_s32(value);
+    const float32x4_t scale = vbslq_f32(vcltq_f32(value_f, vdupq_n_f32(0.0f)),
+                                        vdupq_n_f32(1.0f / 32768.0f),
+                                        vdupq_n_f32(1.0f / 32767.0f));
+    return vmulq_f32(value_f, scale);
+}
+
+int32x4_t sampleFloatToInt32_NEON(float32x4_t value)
+{
+    value = vminq_f32(vmaxq_f32(value, vdupq_n_f32(-1.0f)), vdupq_n_f32(1.0f));
+    const float32x4_t scale = vbslq_f32(vcltq_f32(value, vdupq_n_f32(0.0f)),
+                                        vdupq_n_f32(32768.0f),
+                                        vdupq_n_f32(32767.0f));
+    // The conversion rounds toward zero like static_cast.
+    return vcvtq_s32_f32(vmulq_f32(value, scale));
+}
+
+} // namespace
+
+void convertInt16ToFloat_NEON(const int16_t src[], int len, float dest[])
+{
+    const int last_index = len - len % 8;
+
+    for (int i = 0; i < last_index; i += 8)
+    {
+        const int16x8_t value = vld1q_s16(src + i);
+        vst1q_f32(dest + i, int32ToSampleFloat_NEON(vmovl_s16(vget_low_s16(value))));
+        vst1q_f32(dest + i + 4, int32ToSampleFloat_NEON(vmovl_s16(vget_high_s16(value))));
+    }
+
+    convertInt16ToFloat_C(src + last_index, len - last_index, dest + last_index);
+}
+
+void convertFloatToInt16_NEON(const float src[], int len, int16_t dest[])
+{
+    const int last_index = len - len % 8;
+
+    for (int i = 0; i < last_index; i += 8)
+    {
+        const int16x4_t low = vqmovn_s32(sampleFloatToInt32_NEON(vld1q_f32(src + i)));
+        const int16x4_t high = vqmovn_s32(sampleFloatToInt32_NEON(vld1q_f32(src + i + 4)));
+        vst1q_s16(dest + i, vcombine_s16(low, high));
+    }
+
+    convertFloatToInt16_C(src + last_index, len - last_index, dest + last_index);
+}
+
+void deinterleaveInt16Stereo_NEON(const int16_t src[], int frames, float left[], float right[])
+{
+    const int last_index = frames - frames % 8;
+
+    for (int i = 0; i < last_index; i += 8)
+    {
+        const int16x8x2_t value = vld2q_s16(src + i * 2);
+
+        vst1q_f32(left + i, int32ToSampleFloat_NEON(vmovl_s16(vget_low_s16(value.val[0]))));
+        vst1q_f32(left + i + 4, int32ToSampleFloat_NEON(vmovl_s16(vget_high_s16(value.val[0]))));
+        vst1q_f32(right + i, int32ToSampleFloat_NEON(vmovl_s16(vget_low_s16(value.val[1]))));
+        vst1q_f32(right + i + 4, int32ToSampleFloat_NEON(vmovl_s16(vget_high_s16(value.val[1]))));
+    }
+
+    deinterleaveInt16Stereo_C(src + last_index * 2, frames - last_index,
+                              left + last_index, right + last_index);
+}
+
+void interleaveInt16Stereo_NEON(const float left[], const float right[], int frames, int16_t dest[])
+{
+    const int last_index = frames - frames % 8;
+
+    for (int i = 0; i < last_index; i += 8)
+    {
+        int16x8x2_t value;
+        value.val[0] = vcombine_s16(vqmovn_s32(sampleFloatToInt32_NEON(vld1q_f32(left + i))),
+                                    vqmovn_s32(sampleFloatToInt32_NEON(vld1q_f32(left + i + 4))));
+        value.val[1] = vcombine_s16(vqmovn_s32(sampleFloatToInt32_NEON(vld1q_f32(right + i))),
+                                    vqmovn_s32(sampleFloatToInt32_NEON(vld1q_f32(right + i + 4))));
+        vst2q_s16(dest + i * 2, value);
+    }
+
+    interleaveInt16Stereo_C(left + last_index, right + last_index, frames - last_index,
+                            dest + last_index * 2);
+}
+
+void applyGainInt16_NEON(int16_t data[], int len, int32_t gain)
+{
+    const int last_index = len - len % 8;
+
+    for (int i = 0; i < last_index; i += 8)
+    {
+        const int16x8_t value = vld1q_s16(data + i);
+        const int32x4_t low = vmulq_n_s32(vmovl_s16(vget_low_s16(value)), gain);
+        const int32x4_t high = vmulq_n_s32(vmovl_s16(vget_high_s16(value)), gain);
+        vst1q_s16(data + i, vcombine_s16(vshrn_n_s32(low, 16), vshrn_n_s32(high, 16)));
+    }
+
+    applyGainInt16_C(data + last_index, len - last_index, gain);
+}
 #endif
 
 void FMAC(const float src[], float scale, int len, float dest[])
@@ -318,4 +589,31 @@ void crossfade(const float src[], int len, float dest[])
         dest[i] = (1.0f - cf_ratio) * src[i] + cf_ratio * dest[i];
 }
 
+void convertInt16ToFloat(const int16_t src[], int len, float dest[])
+{
+    CONVERT_INT16_TO_FLOAT_FUNC(src, len, dest);
+}
+
+void convertFloatToInt16(const float src[], int len, int16_t dest[])
+{
+    CONVERT_FLOAT_TO_INT16_FUNC(src, len, dest);
+}
+
+void deinterleaveInt16Stereo(const int16_t src[], int frames, float left[], float right[])
+{
+    DEINTERLEAVE_INT16_STEREO_FUNC(src, frames, left, right);
+}
+
+void interleaveInt16Stereo(const float left[], const float right[], int frames, int16_t dest[])
+{
+    INTERLEAVE_INT16_STEREO_FUNC(left, right, frames, dest);
+}
+
+void applyGainInt16(int16_t data[], int len, int32_t gain)
+{
+    DCHECK_GE(gain, 0);
+    DCHECK_LT(gain, 65536);
+    APPLY_GAIN_INT16_FUNC(data, len, gain);
+}
+
 } // namespace base
@@ -19,6 +19,7 @@
 #ifndef BASE_CODEC_VECTOR_MATH_H
 #define BASE_CODEC_VECTOR_MATH_H
 
+#include <cstdint>
 #include <utility>
 
 namespace base {
@@ -46,6 +47,25 @@ std::pair<float, float> EWMAAndMaxPower(
 
 void crossfade(const float src[], int len, float dest[]);
 
+// The functions below work with 16-bit samples and give the same results as
+// SignedInt16SampleTypeTraits. They have no alignment requirements.
+
+// Converts |len| samples of |src| to floats in the range [-1, 1] and stores them in |dest|.
+void convertInt16ToFloat(const int16_t src[], int len, float dest[]);
+
+// Converts |len| floats of |src| to 16-bit samples with clipping and stores them in |dest|.
+void convertFloatToInt16(const float src[], int len, int16_t dest[]);
+
+// Splits |frames| interleaved stereo frames of |src| into the floats of |left| and |right|.
+void deinterleaveInt16Stereo(const int16_t src[], int frames, float left[], float right[]);
+
+// Converts |frames| floats of |left| and |right| to interleaved stereo frames in |dest|.
+void interleaveInt16Stereo(const float left[], const float right[], int frames, int16_t dest[]);
+
+// Multiplies each sample of |data| by |gain| in the Q16 format (65536 is 1.0). |gain| must be in
+// the range [0, 65536).
+void applyGainInt16(int16_t data[], int len, int32_t gain);
+
 } // namespace base
 
 #endif // BASE_CODEC_VECTOR_MATH_H
@@ -0,0 +1,132 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/codec/vector_math.h"
+
+#include "base/codec/audio_sample_types.h"
+
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace base {
+
+namespace {
+
+// Not a multiple of the vector width, so that the scalar tail is tested too.
+const int kFrames = 1027;
+
+std::vector<float> randomFloats(int count)
+{
+    std::mt19937 generator(count);
+    std::uniform_real_distribution<float> distribution(-1.25f, 1.25f);
+
+    std::vector<float> result(count);
+    for (int i = 0; i < count; ++i)
+        result[i] = distribution(generator);
+
+    // The boundary values.
+    result[0] = -1.0f;
+    result[1] = 1.0f;
+    result[2] = 0.0f;
+    result[3] = -0.0f;
+    result[4] = -1.0f / 32768.0f;
+    result[5] = 1.0f / 32767.0f;
+    return result;
+}
+
+} // namespace
+
+TEST(VectorMathTest, Int16ToFloat)
+{
+    std::vector<int16_t> src;
+    for (int value = std::numeric_limits<int16_t>::min();
+         value <= std::numeric_limits<int16_t>::max(); ++value)
+    {
+        src.emplace_back(static_cast<int16_t>(value));
+    }
+    src.emplace_back(0);
+
+    std::vector<float> dest(src.size());
+    convertInt16ToFloat(src.data(), static_cast<int>(src.size()), dest.data());
+
+    for (size_t i = 0; i < src.size(); ++i)
+        ASSERT_EQ(SignedInt16SampleTypeTraits::ToFloat(src[i]), dest[i]) << src[i];
+}
+
+TEST(VectorMathTest, FloatToInt16)
+{
+    const std::vector<float> src = randomFloats(kFrames);
+
+    std::vector<int16_t> dest(src.size());
+    convertFloatToInt16(src.data(), kFrames, dest.data());
+
+    for (int i = 0; i < kFrames; ++i)
+        ASSERT_EQ(SignedInt16SampleTypeTraits::FromFloat(src[i]), dest[i]) << src[i];
+}
+
+TEST(VectorMathTest, Stereo)
+{
+    const std::vector<float> left = randomFloats(kFrames);
+    std::vector<float> right = randomFloats(kFrames + 1);
+    right.erase(right.begin());
+
+    std::vector<int16_t> interleaved(kFrames * 2);
+    interleaveInt16Stereo(left.data(), right.data(), kFrames, interleaved.data());
+
+    for (int i = 0; i < kFrames; ++i)
+    {
+        ASSERT_EQ(SignedInt16SampleTypeTraits::FromFloat(left[i]), interleaved[i * 2]);
+        ASSERT_EQ(SignedInt16SampleTypeTraits::FromFloat(right[i]), interleaved[i * 2 + 1]);
+    }
+
+    std::vector<float> left_result(kFrames);
+    std::vector<float> right_result(kFrames);
+    deinterleaveInt16Stereo(interleaved.data(), kFrames, left_result.data(), right_result.data());
+
+    for (int i = 0; i < kFrames; ++i)
+    {
+        ASSERT_EQ(SignedInt16SampleTypeTraits::ToFloat(interleaved[i * 2]), left_result[i]);
+        ASSERT_EQ(SignedInt16SampleTypeTraits::ToFloat(interleaved[i * 2 + 1]), right_result[i]);
+    }
+}
+
+TEST(VectorMathTest, ApplyGain)
+{
+    std::vector<int16_t> src;
+    for (int value = std::numeric_limits<int16_t>::min();
+         value <= std::numeric_limits<int16_t>::max(); ++value)
+    {
+        src.emplace_back(static_cast<int16_t>(value));
+    }
+
+    for (int32_t gain : { 0, 1, 16384, 32767, 32768, 49152, 65535 })
+    {
+        std::vector<int16_t> data = src;
+        applyGainInt16(data.data(), static_cast<int>(data.size()), gain);
+
+        for (size_t i = 0; i < src.size(); ++i)
+        {
+            ASSERT_EQ(static_cast<int16_t>((static_cast<int32_t>(src[i]) * gain) >> 16), data[i])
+                << "sample: " << src[i] << ", gain: " << gain;
+        }
+    }
+}
+
+} // namespace base
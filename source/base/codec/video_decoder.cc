@@ -18,28 +18,80 @@
 
 #include "base/codec/video_decoder.h"
 
+#include "base/logging.h"
+#include "base/codec/rect_list_codec.h"
 #include "base/codec/video_decoder_vpx.h"
 #include "base/codec/video_decoder_zstd.h"
+#include "build/build_config.h"
+
+#if defined(OS_WIN)
+#include "base/codec/video_decoder_mf.h"
+#endif // defined(OS_WIN)
 
 namespace base {
 
 // static
-std::unique_ptr<VideoDecoder> VideoDecoder::create(proto::VideoEncoding encoding)
+std::unique_ptr<VideoDecoder> VideoDecoder::create(proto::VideoEncoding encoding,
+                                                   int thread_count)
 {
     switch (encoding)
     {
         case proto::VIDEO_ENCODING_VP8:
-            return VideoDecoderVPX::createVP8();
+            return VideoDecoderVPX::createVP8(thread_count);
 
         case proto::VIDEO_ENCODING_VP9:
-            return VideoDecoderVPX::createVP9();
+            return VideoDecoderVPX::createVP9(thread_count);
 
         case proto::VIDEO_ENCODING_ZSTD:
             return VideoDecoderZstd::create();
 
+#if defined(OS_WIN)
+        case proto::VIDEO_ENCODING_H264:
+        case proto::VIDEO_ENCODING_HEVC:
+            return VideoDecoderMF::create(encoding);
+#endif // defined(OS_WIN)
+
         default:
             return nullptr;
     }
 }
 
+// static
+uint32_t VideoDecoder::supportedEncodings()
+{
+    uint32_t encodings =
+        proto::VIDEO_ENCODING_VP8 | proto::VIDEO_ENCODING_VP9 | proto::VIDEO_ENCODING_ZSTD;
+
+#if defined(OS_WIN)
+    encodings |= VideoDecoderMF::supportedEncodings();
+#endif // defined(OS_WIN)
+
+    return encodings;
+}
+
+// static
+bool VideoDecoder::parseDirtyRects(const proto::VideoPacket& packet, std::vector<Rect>* rects)
+{
+    if (!packet.packed_dirty_rect().empty())
+    {
+        if (!RectListCodec::decode(packet.packed_dirty_rect(), rects))
+        {
+            LOG(LS_WARNING) << "The packed rectangles are damaged";
+            return false;
+        }
+
+        return true;
+    }
+
+    rects->clear();
+
+    for (int i = 0; i < packet.dirty_rect_size(); ++i)
+    {
+        const proto::Rect& rect = packet.dirty_rect(i);
+        rects->emplace_back(Rect::makeXYWH(rect.x(), rect.y(), rect.width(), rect.height()));
+    }
+
+    return true;
+}
+
 } // namespace base
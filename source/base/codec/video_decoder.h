@@ -19,9 +19,11 @@
 #ifndef BASE_CODEC_VIDEO_DECODER_H
 #define BASE_CODEC_VIDEO_DECODER_H
 
+#include "base/desktop/geometry.h"
 #include "proto/desktop.pb.h"
 
 #include <memory>
+#include <vector>
 
 namespace base {
 
@@ -32,9 +34,23 @@ class VideoDecoder
 public:
     virtual ~VideoDecoder() = default;
 
-    static std::unique_ptr<VideoDecoder> create(proto::VideoEncoding encoding);
+    // |thread_count| is used by the decoders that support multi-threading. Zero means the number of
+    // threads depends on the number of processors.
+    static std::unique_ptr<VideoDecoder> create(proto::VideoEncoding encoding,
+                                                int thread_count = 2);
 
+    // Returns a bit mask of proto::VideoEncoding values that can be decoded on this computer.
+    // H.264 and HEVC are included only if the system has decoders for them.
+    static uint32_t supportedEncodings();
+
+    // Decodes |packet| into |frame|. On success the updated region of |frame| contains the areas
+    // changed by the packet.
     virtual bool decode(const proto::VideoPacket& packet, Frame* frame) = 0;
+
+protected:
+    // Reads the dirty rectangles of |packet| in any of their forms. Returns false if the packed
+    // rectangles are damaged.
+    static bool parseDirtyRects(const proto::VideoPacket& packet, std::vector<Rect>* rects);
 };
 
 } // namespace base
@@ -0,0 +1,363 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/video_decoder_mf.h"
+
+#include "base/logging.h"
+#include "base/desktop/frame.h"
+#include "base/win/media_foundation_util.h"
+
+#include <libyuv/convert_argb.h>
+
+#include <comdef.h>
+#include <mfapi.h>
+#include <mferror.h>
+
+using Microsoft::WRL::ComPtr;
+
+namespace base {
+
+namespace {
+
+const GUID& subtypeForEncoding(proto::VideoEncoding encoding)
+{
+    if (encoding == proto::VIDEO_ENCODING_HEVC)
+        return MFVideoFormat_HEVC;
+
+    DCHECK_EQ(encoding, proto::VIDEO_ENCODING_H264);
+    return MFVideoFormat_H264;
+}
+
+} // namespace
+
+VideoDecoderMF::VideoDecoderMF(ComPtr<IMFTransform> transform)
+    : transform_(std::move(transform))
+{
+    LOG(LS_INFO) << "Ctor";
+}
+
+VideoDecoderMF::~VideoDecoderMF()
+{
+    LOG(LS_INFO) << "Dtor";
+
+    transform_->ProcessMessage(MFT_MESSAGE_NOTIFY_END_OF_STREAM, 0);
+    transform_->ProcessMessage(MFT_MESSAGE_NOTIFY_END_STREAMING, 0);
+}
+
+// static
+std::unique_ptr<VideoDecoderMF> VideoDecoderMF::create(proto::VideoEncoding encoding)
+{
+    if (encoding != proto::VIDEO_ENCODING_H264 && encoding != proto::VIDEO_ENCODING_HEVC)
+    {
+        LOG(LS_WARNING) << "Unsupported encoding: " << encoding;
+        return nullptr;
+    }
+
+    ComPtr<IMFTransform> transform =
+        win::createTransform(MFT_CATEGORY_VIDEO_DECODER,
+                             MFT_ENUM_FLAG_SYNCMFT | MFT_ENUM_FLAG_SORTANDFILTER,
+                             subtypeForEncoding(encoding),
+                             MFVideoFormat_NV12);
+    if (!transform)
+    {
+        LOG(LS_WARNING) << "No decoder for encoding: " << encoding;
+        return nullptr;
+    }
+
+    std::unique_ptr<VideoDecoderMF> decoder(new VideoDecoderMF(std::move(transform)));
+    if (!decoder->initialize(encoding))
+        return nullptr;
+
+    return decoder;
+}
+
+// static
+uint32_t VideoDecoderMF::supportedEncodings()
+{
+    static const uint32_t encodings = []()
+    {
+        uint32_t result = 0;
+
+        if (create(proto::VIDEO_ENCODING_H264))
+            result |= proto::VIDEO_ENCODING_H264;
+
+        if (create(proto::VIDEO_ENCODING_HEVC))
+            result |= proto::VIDEO_ENCODING_HEVC;
+
+        LOG(LS_INFO) << "System video decodings: " << result;
+        return result;
+    }();
+
+    return encodings;
+}
+
+bool VideoDecoderMF::decode(const proto::VideoPacket& packet, Frame* frame)
+{
+    const DWORD data_size = static_cast<DWORD>(packet.data().size());
+
+    ComPtr<IMFMediaBuffer> buffer;
+    _com_error error = MFCreateMemoryBuffer(data_size, buffer.GetAddressOf());
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "MFCreateMemoryBuffer failed: " << error.ErrorMessage();
+        return false;
+    }
+
+    BYTE* data = nullptr;
+
+    error = buffer->Lock(&data, nullptr, nullptr);
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "IMFMediaBuffer::Lock failed: " << error.ErrorMessage();
+        return false;
+    }
+
+    memcpy(data, packet.data().data(), data_size);
+    buffer->Unlock();
+    buffer->SetCurrentLength(data_size);
+
+    ComPtr<IMFSample> sample;
+    error = MFCreateSample(sample.GetAddressOf());
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "MFCreateSample failed: " << error.ErrorMessage();
+        return false;
+    }
+
+    sample->AddBuffer(buffer.Get());
+
+    error = transform_->ProcessInput(0, sample.Get(), 0);
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "ProcessInput failed: " << error.ErrorMessage();
+        return false;
+    }
+
+    bool frame_ready = false;
+
+    // The decoder is in low latency mode and returns the frame for each input sample. The loop
+    // also handles format changes which are reported before the first frame of a new stream.
+    while (true)
+    {
+        bool has_output = false;
+
+        if (!processOutput(frame, &has_output))
+            return false;
+
+        if (!has_output)
+            break;
+
+        frame_ready = true;
+    }
+
+    if (!frame_ready)
+    {
+        LOG(LS_WARNING) << "No video frame decoded";
+        return false;
+    }
+
+    // The decoder always outputs the whole frame.
+    frame->updatedRegion()->setRect(Rect::makeSize(frame->size()));
+    return true;
+}
+
+bool VideoDecoderMF::initialize(proto::VideoEncoding encoding)
+{
+    ComPtr<IMFAttributes> attributes;
+    if (SUCCEEDED(transform_->GetAttributes(attributes.GetAddressOf())))
+        attributes->SetUINT32(MF_LOW_LATENCY, TRUE);
+
+    ComPtr<IMFMediaType> input_type;
+    _com_error error = MFCreateMediaType(input_type.GetAddressOf());
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "MFCreateMediaType failed: " << error.ErrorMessage();
+        return false;
+    }
+
+    input_type->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video);
+    input_type->SetGUID(MF_MT_SUBTYPE, subtypeForEncoding(encoding));
+    input_type->SetUINT32(MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive);
+
+    error = transform_->SetInputType(0, input_type.Get(), 0);
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "SetInputType failed: " << error.ErrorMessage();
+        return false;
+    }
+
+    if (!updateOutputType())
+        return false;
+
+    transform_->ProcessMessage(MFT_MESSAGE_NOTIFY_BEGIN_STREAMING, 0);
+    transform_->ProcessMessage(MFT_MESSAGE_NOTIFY_START_OF_STREAM, 0);
+    return true;
+}
+
+bool VideoDecoderMF::updateOutputType()
+{
+    for (DWORD index = 0;; ++index)
+    {
+        ComPtr<IMFMediaType> output_type;
+
+        HRESULT hr = transform_->GetOutputAvailableType(0, index, output_type.GetAddressOf());
+        if (FAILED(hr))
+        {
+            LOG(LS_ERROR) << "No NV12 output type: " << _com_error(hr).ErrorMessage();
+            return false;
+        }
+
+        GUID subtype;
+        if (FAILED(output_type->GetGUID(MF_MT_SUBTYPE, &subtype)) || subtype != MFVideoFormat_NV12)
+            continue;
+
+        hr = transform_->SetOutputType(0, output_type.Get(), 0);
+        if (FAILED(hr))
+        {
+            LOG(LS_ERROR) << "SetOutputType failed: " << _com_error(hr).ErrorMessage();
+            return false;
+        }
+
+        UINT32 width = 0;
+        UINT32 height = 0;
+
+        // The frame size is unknown until the decoder parses the first parameter sets.
+        MFGetAttributeSize(output_type.Get(), MF_MT_FRAME_SIZE, &width, &height);
+        output_size_ = Size(static_cast<int32_t>(width), static_cast<int32_t>(height));
+        break;
+    }
+
+    MFT_OUTPUT_STREAM_INFO stream_info;
+    memset(&stream_info, 0, sizeof(stream_info));
+
+    _com_error error = transform_->GetOutputStreamInfo(0, &stream_info);
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "GetOutputStreamInfo failed: " << error.ErrorMessage();
+        return false;
+    }
+
+    provides_samples_ = (stream_info.dwFlags & MFT_OUTPUT_STREAM_PROVIDES_SAMPLES) != 0;
+
+    if (!provides_samples_ && stream_info.cbSize != output_buffer_size_)
+    {
+        output_buffer_size_ = stream_info.cbSize;
+        output_sample_.Reset();
+
+        ComPtr<IMFMediaBuffer> buffer;
+        if (FAILED(MFCreateMemoryBuffer(output_buffer_size_, buffer.GetAddressOf())) ||
+            FAILED(MFCreateSample(output_sample_.GetAddressOf())))
+        {
+            LOG(LS_ERROR) << "Unable to create output sample";
+            output_buffer_size_ = 0;
+            return false;
+        }
+
+        output_sample_->AddBuffer(buffer.Get());
+    }
+
+    LOG(LS_INFO) << "Output type: " << output_size_
+                 << " (provides samples: " << provides_samples_ << ")";
+    return true;
+}
+
+bool VideoDecoderMF::processOutput(Frame* frame, bool* frame_ready)
+{
+    *frame_ready = false;
+
+    MFT_OUTPUT_DATA_BUFFER output;
+    memset(&output, 0, sizeof(output));
+
+    if (!provides_samples_)
+        output.pSample = output_sample_.Get();
+
+    DWORD status = 0;
+    HRESULT hr = transform_->ProcessOutput(0, 1, &output, &status);
+
+    if (output.pEvents)
+        output.pEvents->Release();
+
+    ComPtr<IMFSample> sample;
+    if (provides_samples_)
+        sample.Attach(output.pSample);
+    else
+        sample = output_sample_;
+
+    if (hr == MF_E_TRANSFORM_NEED_MORE_INPUT)
+        return true;
+
+    if (hr == MF_E_TRANSFORM_STREAM_CHANGE)
+    {
+        // The frame size became known or changed. After a new output type is set, the caller
+        // repeats the call.
+        if (!updateOutputType())
+            return false;
+
+        *frame_ready = false;
+        return processOutput(frame, frame_ready);
+    }
+
+    if (FAILED(hr))
+    {
+        LOG(LS_ERROR) << "ProcessOutput failed: " << _com_error(hr).ErrorMessage();
+        return false;
+    }
+
+    ComPtr<IMFMediaBuffer> buffer;
+    hr = sample->ConvertToContiguousBuffer(buffer.GetAddressOf());
+    if (FAILED(hr))
+    {
+        LOG(LS_ERROR) << "ConvertToContiguousBuffer failed: " << _com_error(hr).ErrorMessage();
+        return false;
+    }
+
+    BYTE* data = nullptr;
+    DWORD length = 0;
+
+    hr = buffer->Lock(&data, nullptr, &length);
+    if (FAILED(hr))
+    {
+        LOG(LS_ERROR) << "IMFMediaBuffer::Lock failed: " << _com_error(hr).ErrorMessage();
+        return false;
+    }
+
+    // The decoder output is aligned to the macroblock size and may be larger than the frame.
+    const int y_stride = output_size_.width();
+    const int plane_height = output_size_.height();
+
+    if (frame->size().width() > output_size_.width() ||
+        frame->size().height() > output_size_.height() ||
+        static_cast<DWORD>(y_stride * plane_height * 3 / 2) > length)
+    {
+        LOG(LS_WARNING) << "Size of the decoded frame doesn't match size in the header";
+        buffer->Unlock();
+        return false;
+    }
+
+    libyuv::NV12ToARGB(data, y_stride,
+                       data + y_stride * plane_height, y_stride,
+                       frame->frameData(), frame->stride(),
+                       frame->size().width(), frame->size().height());
+
+    buffer->Unlock();
+
+    *frame_ready = true;
+    return true;
+}
+
+} // namespace base
@@ -0,0 +1,66 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_CODEC_VIDEO_DECODER_MF_H
+#define BASE_CODEC_VIDEO_DECODER_MF_H
+
+#include "base/macros_magic.h"
+#include "base/codec/video_decoder.h"
+#include "base/desktop/geometry.h"
+
+#include <mfidl.h>
+#include <mftransform.h>
+#include <wrl/client.h>
+
+namespace base {
+
+// H.264 and HEVC decoder that uses Media Foundation transforms. The system decoders use DXVA
+// acceleration when it is available and fall back to software decoding otherwise.
+class VideoDecoderMF : public VideoDecoder
+{
+public:
+    ~VideoDecoderMF() override;
+
+    // Returns nullptr if there is no decoder for |encoding| in the system.
+    static std::unique_ptr<VideoDecoderMF> create(proto::VideoEncoding encoding);
+
+    // Returns a bit mask of proto::VideoEncoding values supported by the system decoders.
+    static uint32_t supportedEncodings();
+
+    bool decode(const proto::VideoPacket& packet, Frame* frame) override;
+
+private:
+    explicit VideoDecoderMF(Microsoft::WRL::ComPtr<IMFTransform> transform);
+
+    bool initialize(proto::VideoEncoding encoding);
+    bool updateOutputType();
+    bool processOutput(Frame* frame, bool* frame_ready);
+
+    Microsoft::WRL::ComPtr<IMFTransform> transform_;
+    Microsoft::WRL::ComPtr<IMFSample> output_sample_;
+
+    Size output_size_;
+    DWORD output_buffer_size_ = 0;
+    bool provides_samples_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoDecoderMF);
+};
+
+} // namespace base
+
+#endif // BASE_CODEC_VIDEO_DECODER_MF_H
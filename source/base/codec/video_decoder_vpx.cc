@@ -20,6 +20,10 @@
 
 #include "base/logging.h"
 #include "base/desktop/frame.h"
+#include "base/threading/worker_pool.h"
+
+#include <algorithm>
+#include <thread>
 
 #include <libyuv/convert_from.h>
 #include <libyuv/convert_argb.h>
@@ -32,71 +36,51 @@ namespace base {
 
 namespace {
 
-bool convertImage(const proto::VideoPacket& packet, vpx_image_t* image, Frame* frame)
-{
-    if (image->fmt != VPX_IMG_FMT_I420)
-        return false;
-
-    Rect frame_rect = Rect::makeSize(frame->size());
-
-    uint8_t* y_data = image->planes[0];
-    uint8_t* u_data = image->planes[1];
-    uint8_t* v_data = image->planes[2];
-
-    int y_stride = image->stride[0];
-    int uv_stride = image->stride[1];
-
-    for (int i = 0; i < packet.dirty_rect_size(); ++i)
-    {
-        const proto::Rect& dirty_rect = packet.dirty_rect(i);
-        Rect rect = Rect::makeXYWH(
-            dirty_rect.x(), dirty_rect.y(), dirty_rect.width(), dirty_rect.height());
-
-        if (!frame_rect.containsRect(rect))
-        {
-            LOG(LS_WARNING) << "The rectangle is outside the screen area";
-            return false;
-        }
+// More threads do not help, because VP9 frames have no more than 8 tile columns up to 4K.
+const int kMaxThreadCount = 8;
 
-        int y_offset = y_stride * rect.y() + rect.x();
-        int uv_offset = uv_stride * rect.y() / 2 + rect.x() / 2;
+// The conversion of the dirty rectangles to ARGB is split into bands of at least kMinBandArea
+// pixels between threads if the updated area is larger than kMinThreadedArea.
+const int64_t kMinThreadedArea = 256 * 256;
+const int64_t kMinBandArea = 128 * 128;
+const int kMaxConvertThreadCount = 4;
 
-        libyuv::I420ToARGB(y_data + y_offset, y_stride,
-                           u_data + uv_offset, uv_stride,
-                           v_data + uv_offset, uv_stride,
-                           frame->frameDataAtPos(rect.topLeft()),
-                           frame->stride(),
-                           rect.width(),
-                           rect.height());
-    }
-
-    return true;
+int roundToTwosMultiple(int x)
+{
+    return x & (~1);
 }
 
 } // namespace
 
 // static
-std::unique_ptr<VideoDecoderVPX> VideoDecoderVPX::createVP8()
+std::unique_ptr<VideoDecoderVPX> VideoDecoderVPX::createVP8(int thread_count)
 {
-    return std::unique_ptr<VideoDecoderVPX>(new VideoDecoderVPX(proto::VIDEO_ENCODING_VP8));
+    return std::unique_ptr<VideoDecoderVPX>(
+        new VideoDecoderVPX(proto::VIDEO_ENCODING_VP8, thread_count));
 }
 
 // static
-std::unique_ptr<VideoDecoderVPX> VideoDecoderVPX::createVP9()
+std::unique_ptr<VideoDecoderVPX> VideoDecoderVPX::createVP9(int thread_count)
 {
-    return std::unique_ptr<VideoDecoderVPX>(new VideoDecoderVPX(proto::VIDEO_ENCODING_VP9));
+    return std::unique_ptr<VideoDecoderVPX>(
+        new VideoDecoderVPX(proto::VIDEO_ENCODING_VP9, thread_count));
 }
 
-VideoDecoderVPX::VideoDecoderVPX(proto::VideoEncoding encoding)
+VideoDecoderVPX::VideoDecoderVPX(proto::VideoEncoding encoding, int thread_count)
 {
-    LOG(LS_INFO) << "VPX(" << encoding << ") Ctor";
+    if (thread_count <= 0)
+        thread_count = static_cast<int>(std::thread::hardware_concurrency());
+
+    thread_count = std::clamp(thread_count, 1, kMaxThreadCount);
+
+    LOG(LS_INFO) << "VPX(" << encoding << ") Ctor (threads: " << thread_count << ")";
     codec_.reset(new vpx_codec_ctx_t());
 
     vpx_codec_dec_cfg_t config;
 
     config.w = 0;
     config.h = 0;
-    config.threads = 2;
+    config.threads = static_cast<unsigned int>(thread_count);
 
     vpx_codec_iface_t* algo;
 
@@ -117,6 +101,16 @@ VideoDecoderVPX::VideoDecoderVPX(proto::VideoEncoding encoding)
 
     int ret = vpx_codec_dec_init(codec_.get(), algo, &config, 0);
     CHECK_EQ(ret, VPX_CODEC_OK);
+
+#if defined(VPX_CTRL_VP9D_SET_ROW_MT)
+    // Without tile columns VP9 frames can still be decoded in parallel by superblock rows.
+    if (encoding == proto::VIDEO_ENCODING_VP9 && thread_count > 1)
+    {
+        ret = vpx_codec_control(codec_.get(), VP9D_SET_ROW_MT, 1);
+        if (ret != VPX_CODEC_OK)
+            LOG(LS_WARNING) << "vpx_codec_control(VP9D_SET_ROW_MT) failed: " << ret;
+    }
+#endif // defined(VPX_CTRL_VP9D_SET_ROW_MT)
 }
 
 VideoDecoderVPX::~VideoDecoderVPX()
@@ -162,4 +156,123 @@ bool VideoDecoderVPX::decode(const proto::VideoPacket& packet, Frame* frame)
     return convertImage(packet, image, frame);
 }
 
+bool VideoDecoderVPX::convertImage(
+    const proto::VideoPacket& packet, const vpx_image_t* image, Frame* frame)
+{
+    // VP9 profile 1 streams have the chroma in the full resolution.
+    if (image->fmt != VPX_IMG_FMT_I420 && image->fmt != VPX_IMG_FMT_I444)
+    {
+        LOG(LS_WARNING) << "Unsupported image format: " << image->fmt;
+        return false;
+    }
+
+    const Rect frame_rect = Rect::makeSize(frame->size());
+
+    Region* updated_region = frame->updatedRegion();
+    updated_region->clear();
+
+    if (!parseDirtyRects(packet, &dirty_rects_))
+        return false;
+
+    for (const auto& rect : dirty_rects_)
+    {
+        if (!frame_rect.containsRect(rect))
+        {
+            LOG(LS_WARNING) << "The rectangle is outside the screen area";
+            return false;
+        }
+
+        updated_region->addRect(rect);
+    }
+
+    // The bands are made from the region, so they do not overlap even if the rectangles of the
+    // packet do.
+    int64_t total_area = 0;
+    for (Region::Iterator it(*updated_region); !it.isAtEnd(); it.advance())
+        total_area += static_cast<int64_t>(it.rect().width()) * it.rect().height();
+
+    WorkerPool* worker_pool = workerPool(total_area);
+    const int thread_count = worker_pool ? worker_pool->threadCount() : 1;
+
+    bands_.clear();
+
+    for (Region::Iterator it(*updated_region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+        const int64_t area = static_cast<int64_t>(rect.width()) * rect.height();
+
+        // The bands start at even rows for the I420 chroma.
+        const int64_t max_band_count = std::min(thread_count, rect.height());
+        const int band_count =
+            static_cast<int>(std::clamp(area / kMinBandArea, int64_t(1), max_band_count));
+        const int band_height =
+            roundToTwosMultiple((rect.height() + band_count - 1) / band_count + 1);
+
+        for (int top = rect.top(); top < rect.bottom(); top += band_height)
+        {
+            bands_.emplace_back(Rect::makeLTRB(
+                rect.left(), top, rect.right(), std::min(top + band_height, rect.bottom())));
+        }
+    }
+
+    if (!worker_pool || bands_.size() < 2)
+    {
+        for (const auto& band : bands_)
+            convertRect(image, band, frame);
+        return true;
+    }
+
+    const size_t band_count = bands_.size();
+    const size_t step = static_cast<size_t>(thread_count);
+
+    // Each band writes only its own rows of the frame.
+    worker_pool->run([&](int index)
+    {
+        for (size_t i = static_cast<size_t>(index); i < band_count; i += step)
+            convertRect(image, bands_[i], frame);
+    });
+
+    return true;
+}
+
+void VideoDecoderVPX::convertRect(const vpx_image_t* image, const Rect& rect, Frame* frame)
+{
+    const int y_stride = image->stride[0];
+    const int uv_stride = image->stride[1];
+
+    const int y_offset = y_stride * rect.y() + rect.x();
+    const int uv_offset = uv_stride * (rect.y() >> image->y_chroma_shift) +
+        (rect.x() >> image->x_chroma_shift);
+
+    auto convert_function =
+        image->fmt == VPX_IMG_FMT_I444 ? libyuv::I444ToARGB : libyuv::I420ToARGB;
+
+    convert_function(image->planes[0] + y_offset, y_stride,
+                     image->planes[1] + uv_offset, uv_stride,
+                     image->planes[2] + uv_offset, uv_stride,
+                     frame->frameDataAtPos(rect.topLeft()),
+                     frame->stride(),
+                     rect.width(),
+                     rect.height());
+}
+
+WorkerPool* VideoDecoderVPX::workerPool(int64_t area)
+{
+    if (area < kMinThreadedArea)
+        return nullptr;
+
+    if (!worker_pool_)
+    {
+        const int thread_count = std::clamp(
+            static_cast<int>(std::thread::hardware_concurrency()), 1, kMaxConvertThreadCount);
+        if (thread_count < 2)
+            return nullptr;
+
+        LOG(LS_INFO) << "Conversion threads: " << thread_count;
+        worker_pool_ = std::make_unique<WorkerPool>(thread_count);
+    }
+
+    return worker_pool_.get();
+}
+
 } // namespace base
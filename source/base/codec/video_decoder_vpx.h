@@ -22,24 +22,44 @@
 #include "base/macros_magic.h"
 #include "base/codec/scoped_vpx_codec.h"
 #include "base/codec/video_decoder.h"
+#include "base/desktop/geometry.h"
+
+#include <vector>
+
+#include <vpx/vpx_image.h>
 
 namespace base {
 
+class WorkerPool;
+
 class VideoDecoderVPX : public VideoDecoder
 {
 public:
     ~VideoDecoderVPX() override;
 
-    static std::unique_ptr<VideoDecoderVPX> createVP8();
-    static std::unique_ptr<VideoDecoderVPX> createVP9();
+    // Zero |thread_count| means one thread per processor.
+    static std::unique_ptr<VideoDecoderVPX> createVP8(int thread_count = 2);
+    static std::unique_ptr<VideoDecoderVPX> createVP9(int thread_count = 2);
 
     bool decode(const proto::VideoPacket& packet, Frame* frame) override;
 
 private:
-    explicit VideoDecoderVPX(proto::VideoEncoding encoding);
+    VideoDecoderVPX(proto::VideoEncoding encoding, int thread_count);
+
+    // Converts the dirty rectangles of |packet| to ARGB. Large updates are split into bands that
+    // are converted in parallel.
+    bool convertImage(const proto::VideoPacket& packet, const vpx_image_t* image, Frame* frame);
+    void convertRect(const vpx_image_t* image, const Rect& rect, Frame* frame);
+
+    // Returns nullptr if the area is too small to split the conversion between threads.
+    WorkerPool* workerPool(int64_t area);
 
     ScopedVpxCodec codec_;
 
+    std::vector<Rect> dirty_rects_;
+    std::vector<Rect> bands_;
+    std::unique_ptr<WorkerPool> worker_pool_;
+
     DISALLOW_COPY_AND_ASSIGN(VideoDecoderVPX);
 };
 
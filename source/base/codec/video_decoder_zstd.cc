@@ -18,14 +18,23 @@
 
 #include "base/codec/video_decoder_zstd.h"
 
+#include "base/endian_util.h"
 #include "base/logging.h"
+#include "base/codec/palette_codec.h"
 #include "base/codec/pixel_translator.h"
-#include "base/desktop/frame_aligned.h"
+#include "base/desktop/frame.h"
+#include "base/threading/worker_pool.h"
+
+#include <algorithm>
+#include <thread>
 
 namespace base {
 
 namespace {
 
+// Maximum number of threads to decode slices.
+const int kMaxThreadCount = 8;
+
 PixelFormat parsePixelFormat(const proto::PixelFormat& format)
 {
     return PixelFormat(
@@ -43,6 +52,33 @@ Rect parseRect(const proto::Rect& rect)
     return Rect::makeXYWH(rect.x(), rect.y(), rect.width(), rect.height());
 }
 
+// Decompresses exactly |size| bytes from |input|.
+bool decompressExact(ZSTD_DStream* stream, ZSTD_inBuffer* input, void* data, size_t size)
+{
+    ZSTD_outBuffer output = { data, size, 0 };
+
+    while (output.pos < output.size)
+    {
+        const size_t input_pos = input->pos;
+        const size_t output_pos = output.pos;
+
+        const size_t ret = ZSTD_decompressStream(stream, &output, input);
+        if (ZSTD_isError(ret))
+        {
+            LOG(LS_WARNING) << "ZSTD_decompressStream failed: " << ZSTD_getErrorName(ret);
+            return false;
+        }
+
+        if (input->pos == input_pos && output.pos == output_pos)
+        {
+            LOG(LS_WARNING) << "Unexpected end of the compressed data";
+            return false;
+        }
+    }
+
+    return true;
+}
+
 } // namespace
 
 VideoDecoderZstd::VideoDecoderZstd()
@@ -68,76 +104,293 @@ bool VideoDecoderZstd::decode(const proto::VideoPacket& packet, Frame* target_fr
     {
         const proto::VideoPacketFormat& format = packet.format();
 
-        source_frame_ = FrameAligned::create(
-            Size(format.video_rect().width(), format.video_rect().height()),
-            parsePixelFormat(format.pixel_format()), 32);
+        frame_size_ = Size(format.video_rect().width(), format.video_rect().height());
+        source_format_ = parsePixelFormat(format.pixel_format());
 
-        translator_ = PixelTranslator::create(source_frame_->format(), PixelFormat::ARGB());
-    }
+        // The pixels of the same format are decompressed straight into the target frame.
+        translator_.reset();
+        has_format_ = false;
+        if (source_format_ != PixelFormat::ARGB())
+        {
+            translator_ = PixelTranslator::create(source_format_, PixelFormat::ARGB());
+            if (!translator_)
+            {
+                LOG(LS_WARNING) << "Unsupported pixel format";
+                return false;
+            }
+        }
 
-    DCHECK(source_frame_->size() == target_frame->size());
+        has_format_ = true;
+    }
 
-    if (!source_frame_ || !translator_)
+    if (!has_format_)
     {
         LOG(LS_WARNING) << "A packet with image information was not received";
         return false;
     }
 
-    size_t ret = ZSTD_initDStream(stream_.get());
-    if (ZSTD_isError(ret))
+    DCHECK(frame_size_ == target_frame->size());
+
+    if (!parseDirtyRects(packet, &dirty_rects_))
+        return false;
+
+    if (!applyCopyRects(packet, target_frame))
+        return false;
+
+    bool result;
+    if (packet.slice_data_size())
+    {
+        result = decodeSlices(packet, target_frame);
+    }
+    else
     {
-        LOG(LS_ERROR) << "ZSTD_initDStream failed: " << ZSTD_getErrorName(ret);
+        result = decodeRects(stream_.get(), packet.continues_stream(), packet.data(), packet, 0,
+                             static_cast<int>(dirty_rects_.size()), target_frame);
+    }
+
+    if (!result)
         return false;
+
+    // The slices are decoded in parallel, so the region is filled after all of them are ready.
+    Region* updated_region = target_frame->updatedRegion();
+    updated_region->clear();
+
+    for (int i = 0; i < packet.copy_rect_size(); ++i)
+    {
+        const proto::VideoCopyRect& copy_rect = packet.copy_rect(i);
+        const Size size(copy_rect.source_rect().width(), copy_rect.source_rect().height());
+
+        updated_region->addRect(
+            Rect::makeXYWH(Point(copy_rect.dest_x(), copy_rect.dest_y()), size));
     }
 
-    Rect frame_rect = Rect::makeSize(source_frame_->size());
-    ZSTD_inBuffer input = { packet.data().data(), packet.data().size(), 0 };
+    for (const auto& rect : dirty_rects_)
+        updated_region->addRect(rect);
+
+    return true;
+}
+
+bool VideoDecoderZstd::applyCopyRects(const proto::VideoPacket& packet, Frame* target_frame)
+{
+    const Rect frame_rect = Rect::makeSize(frame_size_);
 
-    for (int i = 0; i < packet.dirty_rect_size(); ++i)
+    for (int i = 0; i < packet.copy_rect_size(); ++i)
     {
-        Rect rect = parseRect(packet.dirty_rect(i));
+        const proto::VideoCopyRect& copy_rect = packet.copy_rect(i);
+        const Rect source_rect = parseRect(copy_rect.source_rect());
+        const Point dest_pos(copy_rect.dest_x(), copy_rect.dest_y());
 
-        if (!frame_rect.containsRect(rect))
+        if (!frame_rect.containsRect(source_rect) ||
+            !frame_rect.containsRect(Rect::makeXYWH(dest_pos, source_rect.size())))
         {
-            LOG(LS_WARNING) << "The rectangle is outside the screen area";
+            LOG(LS_WARNING) << "The copy rectangle is outside the screen area";
+            return false;
+        }
+
+        target_frame->movePixels(source_rect, dest_pos);
+    }
+
+    return true;
+}
+
+bool VideoDecoderZstd::decodeRects(ZSTD_DStream* stream,
+                                   bool continues_stream,
+                                   const std::string& data,
+                                   const proto::VideoPacket& packet,
+                                   int first_rect,
+                                   int rect_count,
+                                   Frame* target_frame)
+{
+    // In the stream mode the window of the previous packets is used to decode this one.
+    if (!continues_stream)
+    {
+        const size_t ret = ZSTD_initDStream(stream);
+        if (ZSTD_isError(ret))
+        {
+            LOG(LS_ERROR) << "ZSTD_initDStream failed: " << ZSTD_getErrorName(ret);
             return false;
         }
+    }
 
-        uint8_t* output_data = source_frame_->frameDataAtPos(rect.x(), rect.y());
-        const size_t output_size =
-            static_cast<size_t>(rect.width() * source_frame_->format().bytesPerPixel());
+    const Rect frame_rect = Rect::makeSize(frame_size_);
+    const int bytes_per_pixel = source_format_.bytesPerPixel();
+    const int target_stride = target_frame->stride();
 
-        ZSTD_outBuffer output = { output_data, output_size, 0 };
-        int row_y = 0;
+    ZSTD_inBuffer input = { data.data(), data.size(), 0 };
+    std::vector<uint8_t> coded_buffer;
+    std::vector<uint8_t> pixel_buffer;
+
+    for (int i = first_rect; i < first_rect + rect_count; ++i)
+    {
+        const Rect& rect = dirty_rects_[static_cast<size_t>(i)];
+
+        if (!frame_rect.containsRect(rect))
+        {
+            LOG(LS_WARNING) << "The rectangle is outside the screen area";
+            return false;
+        }
 
-        while (row_y < rect.height())
+        if (packet.palette_coding())
         {
-            ret = ZSTD_decompressStream(stream_.get(), &output, &input);
-            if (ZSTD_isError(ret))
+            if (!decodePaletteRect(stream, &input, rect, target_frame, &coded_buffer,
+                                   &pixel_buffer))
             {
-                LOG(LS_WARNING) << "ZSTD_decompressStream failed: " << ZSTD_getErrorName(ret);
                 return false;
             }
+            continue;
+        }
+
+        uint8_t* target_data = target_frame->frameDataAtPos(rect.topLeft());
+        const size_t row_size = static_cast<size_t>(rect.width() * bytes_per_pixel);
 
-            // If we completely unpacked the row in the rectangle.
-            if (output.pos == output.size)
+        if (!translator_)
+        {
+            // The pixels are already in the format of the target frame.
+            for (int y = 0; y < rect.height(); ++y)
             {
-                ++row_y;
-                output_data += source_frame_->stride();
-                output.dst = output_data;
-                output.pos = 0;
+                if (!decompressExact(stream, &input, target_data, row_size))
+                    return false;
+
+                target_data += target_stride;
             }
+            continue;
         }
 
-        translator_->translate(source_frame_->frameDataAtPos(rect.topLeft()),
-                               source_frame_->stride(),
-                               target_frame->frameDataAtPos(rect.topLeft()),
-                               target_frame->stride(),
-                               rect.width(),
-                               rect.height());
+        // Each row is translated while it is still in the cache after the decompression.
+        pixel_buffer.resize(row_size);
+
+        for (int y = 0; y < rect.height(); ++y)
+        {
+            if (!decompressExact(stream, &input, pixel_buffer.data(), row_size))
+                return false;
+
+            translator_->translate(pixel_buffer.data(), static_cast<int>(row_size),
+                                   target_data, target_stride, rect.width(), 1);
+            target_data += target_stride;
+        }
     }
 
     return true;
 }
 
+bool VideoDecoderZstd::decodePaletteRect(ZSTD_DStream* stream,
+                                         ZSTD_inBuffer* input,
+                                         const Rect& rect,
+                                         Frame* target_frame,
+                                         std::vector<uint8_t>* coded_buffer,
+                                         std::vector<uint8_t>* pixel_buffer)
+{
+    const int bytes_per_pixel = source_format_.bytesPerPixel();
+
+    uint32_t coded_size;
+    if (!decompressExact(stream, input, &coded_size, sizeof(coded_size)))
+        return false;
+
+    coded_size = EndianUtil::fromLittle(coded_size);
+    if (coded_size > PaletteCodec::maxEncodedSize(rect.size(), bytes_per_pixel))
+    {
+        LOG(LS_WARNING) << "Invalid size of the coded rectangle: " << coded_size;
+        return false;
+    }
+
+    coded_buffer->resize(coded_size);
+    if (!decompressExact(stream, input, coded_buffer->data(), coded_size))
+        return false;
+
+    uint8_t* target_data = target_frame->frameDataAtPos(rect.topLeft());
+    const int target_stride = target_frame->stride();
+
+    // The pixels of other formats are restored into a buffer of the rectangle and translated.
+    uint8_t* data = target_data;
+    int stride = target_stride;
+
+    if (translator_)
+    {
+        stride = rect.width() * bytes_per_pixel;
+        pixel_buffer->resize(static_cast<size_t>(stride * rect.height()));
+        data = pixel_buffer->data();
+    }
+
+    if (!PaletteCodec::decode(coded_buffer->data(), coded_size, rect.size(), bytes_per_pixel,
+                              data, stride))
+    {
+        LOG(LS_WARNING) << "The coded rectangle is damaged";
+        return false;
+    }
+
+    if (translator_)
+    {
+        translator_->translate(data, stride, target_data, target_stride,
+                               rect.width(), rect.height());
+    }
+
+    return true;
+}
+
+bool VideoDecoderZstd::decodeSlices(const proto::VideoPacket& packet, Frame* target_frame)
+{
+    const int slice_count = packet.slice_data_size();
+    if (slice_count != packet.slice_rect_count_size())
+    {
+        LOG(LS_WARNING) << "Invalid slice count";
+        return false;
+    }
+
+    const int dirty_rect_count = static_cast<int>(dirty_rects_.size());
+    std::vector<int> first_rects(static_cast<size_t>(slice_count));
+    int rect_count = 0;
+
+    for (int i = 0; i < slice_count; ++i)
+    {
+        first_rects[static_cast<size_t>(i)] = rect_count;
+
+        // The count comes from the host and is checked before it is added, so that the sum can
+        // not overflow.
+        const uint32_t slice_rect_count = packet.slice_rect_count(i);
+        if (slice_rect_count > static_cast<uint32_t>(dirty_rect_count - rect_count))
+        {
+            LOG(LS_WARNING) << "Invalid number of rectangles in slice";
+            return false;
+        }
+
+        rect_count += static_cast<int>(slice_rect_count);
+    }
+
+    if (rect_count != dirty_rect_count)
+    {
+        LOG(LS_WARNING) << "Rectangles do not match slices";
+        return false;
+    }
+
+    if (!worker_pool_)
+    {
+        const int thread_count = std::clamp(
+            static_cast<int>(std::thread::hardware_concurrency()), 1, kMaxThreadCount);
+
+        LOG(LS_INFO) << "Slice decoding threads: " << thread_count;
+
+        worker_pool_ = std::make_unique<WorkerPool>(thread_count);
+        for (int i = 0; i < thread_count; ++i)
+            slice_streams_.emplace_back(ZSTD_createDStream());
+    }
+
+    const int thread_count = worker_pool_->threadCount();
+    std::vector<uint8_t> results(static_cast<size_t>(slice_count), 0);
+
+    // The rectangles do not overlap, so the slices write to different parts of the frames.
+    worker_pool_->run([&](int index)
+    {
+        ZSTD_DStream* stream = slice_streams_[static_cast<size_t>(index)].get();
+
+        for (int i = index; i < slice_count; i += thread_count)
+        {
+            results[static_cast<size_t>(i)] = decodeRects(
+                stream, false, packet.slice_data(i), packet, first_rects[static_cast<size_t>(i)],
+                static_cast<int>(packet.slice_rect_count(i)), target_frame);
+        }
+    });
+
+    return std::all_of(results.begin(), results.end(), [](uint8_t result) { return result != 0; });
+}
+
 } // namespace base
@@ -22,10 +22,15 @@
 #include "base/macros_magic.h"
 #include "base/codec/scoped_zstd_stream.h"
 #include "base/codec/video_decoder.h"
+#include "base/desktop/geometry.h"
+#include "base/desktop/pixel_format.h"
+
+#include <vector>
 
 namespace base {
 
 class PixelTranslator;
+class WorkerPool;
 
 class VideoDecoderZstd : public VideoDecoder
 {
@@ -39,9 +44,35 @@ public:
 private:
     VideoDecoderZstd();
 
+    bool decodeRects(ZSTD_DStream* stream,
+                     bool continues_stream,
+                     const std::string& data,
+                     const proto::VideoPacket& packet,
+                     int first_rect,
+                     int rect_count,
+                     Frame* target_frame);
+    bool decodePaletteRect(ZSTD_DStream* stream,
+                           ZSTD_inBuffer* input,
+                           const Rect& rect,
+                           Frame* target_frame,
+                           std::vector<uint8_t>* coded_buffer,
+                           std::vector<uint8_t>* pixel_buffer);
+    bool applyCopyRects(const proto::VideoPacket& packet, Frame* target_frame);
+    bool decodeSlices(const proto::VideoPacket& packet, Frame* target_frame);
+
     ScopedZstdDStream stream_;
+
+    // The decoded pixels are written straight into the target frame. The translator is created
+    // only if the format of the packets differs from the format of the frame.
     std::unique_ptr<PixelTranslator> translator_;
-    std::unique_ptr<Frame> source_frame_;
+    PixelFormat source_format_;
+    Size frame_size_;
+    bool has_format_ = false;
+    std::vector<Rect> dirty_rects_;
+
+    // Used only for packets with slices.
+    std::unique_ptr<WorkerPool> worker_pool_;
+    std::vector<ScopedZstdDStream> slice_streams_;
 
     DISALLOW_COPY_AND_ASSIGN(VideoDecoderZstd);
 };
@@ -18,7 +18,9 @@
 
 #include "base/codec/video_encoder.h"
 
+#include "base/codec/rect_list_codec.h"
 #include "base/desktop/frame.h"
+#include "base/desktop/region.h"
 
 namespace base {
 
@@ -42,4 +44,50 @@ void VideoEncoder::fillPacketInfo(const Frame* frame, proto::VideoPacket* packet
     }
 }
 
+void VideoEncoder::setDirtyRects(const std::vector<Rect>& rects, proto::VideoPacket* packet) const
+{
+    packet->clear_dirty_rect();
+
+    if (packed_rects_)
+    {
+        RectListCodec::encode(rects, packet->mutable_packed_dirty_rect());
+        return;
+    }
+
+    packet->clear_packed_dirty_rect();
+
+    for (const auto& rect : rects)
+    {
+        proto::Rect* dirty_rect = packet->add_dirty_rect();
+        dirty_rect->set_x(rect.x());
+        dirty_rect->set_y(rect.y());
+        dirty_rect->set_width(rect.width());
+        dirty_rect->set_height(rect.height());
+    }
+}
+
+void VideoEncoder::setDirtyRects(const Region& region, proto::VideoPacket* packet) const
+{
+    packet->clear_dirty_rect();
+
+    if (packed_rects_)
+    {
+        RectListCodec::encode(region, packet->mutable_packed_dirty_rect());
+        return;
+    }
+
+    packet->clear_packed_dirty_rect();
+
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+
+        proto::Rect* dirty_rect = packet->add_dirty_rect();
+        dirty_rect->set_x(rect.x());
+        dirty_rect->set_y(rect.y());
+        dirty_rect->set_width(rect.width());
+        dirty_rect->set_height(rect.height());
+    }
+}
+
 } // namespace base
@@ -22,9 +22,12 @@
 #include "base/desktop/geometry.h"
 #include "proto/desktop.pb.h"
 
+#include <vector>
+
 namespace base {
 
 class Frame;
+class Region;
 
 class VideoEncoder
 {
@@ -34,18 +37,31 @@ public:
 
     virtual bool encode(const Frame* frame, proto::VideoPacket* packet) = 0;
 
+    // Approximate amount of memory used by the encoder in bytes. The internal buffers of the
+    // codec libraries are estimated. Zero if unknown.
+    virtual size_t memoryUsage() const { return 0; }
+
     void setKeyFrameRequired(bool enable) { key_frame_required_ = enable; }
     bool isKeyFrameRequired() const { return key_frame_required_; }
 
     proto::VideoEncoding encoding() const { return encoding_; }
 
+    // If enabled, the dirty rectangles are sent in VideoPacket::packed_dirty_rect.
+    void setPackedRects(bool enable) { packed_rects_ = enable; }
+    bool isPackedRects() const { return packed_rects_; }
+
 protected:
     void fillPacketInfo(const Frame* frame, proto::VideoPacket* packet);
 
+    // Replaces the dirty rectangles of |packet| in the form that the client supports.
+    void setDirtyRects(const std::vector<Rect>& rects, proto::VideoPacket* packet) const;
+    void setDirtyRects(const Region& region, proto::VideoPacket* packet) const;
+
 private:
     const proto::VideoEncoding encoding_;
     Size last_size_;
     bool key_frame_required_ = false;
+    bool packed_rects_ = false;
 };
 
 } // namespace base
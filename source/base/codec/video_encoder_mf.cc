@@ -0,0 +1,525 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/video_encoder_mf.h"
+
+#include "base/logging.h"
+#include "base/desktop/frame.h"
+#include "base/win/media_foundation_util.h"
+
+#include <libyuv/convert_from_argb.h>
+#include <libyuv/convert_from.h>
+
+#include <comdef.h>
+#include <mfapi.h>
+#include <mferror.h>
+
+#include <algorithm>
+#include <thread>
+
+using Microsoft::WRL::ComPtr;
+
+namespace base {
+
+namespace {
+
+// Frame rate reported to the encoder. Actual frame rate is variable, the encoder uses it only to
+// distribute the bitrate.
+const UINT32 kFrameRate = 30;
+
+// Target bitrate for 1920x1080. The value is scaled by the frame area.
+const UINT32 kBitrateFor1080p = 8 * 1000 * 1000;
+
+// Maximum time to wait for an encoded frame. Hardware encoders in low latency mode return the
+// frame within a few milliseconds.
+const std::chrono::milliseconds kEncodeTimeout(1000);
+
+const GUID& subtypeForEncoding(proto::VideoEncoding encoding)
+{
+    if (encoding == proto::VIDEO_ENCODING_HEVC)
+        return MFVideoFormat_HEVC;
+
+    DCHECK_EQ(encoding, proto::VIDEO_ENCODING_H264);
+    return MFVideoFormat_H264;
+}
+
+ComPtr<IMFTransform> createHardwareEncoder(proto::VideoEncoding encoding)
+{
+    return win::createTransform(MFT_CATEGORY_VIDEO_ENCODER,
+                                MFT_ENUM_FLAG_HARDWARE | MFT_ENUM_FLAG_SORTANDFILTER,
+                                MFVideoFormat_NV12,
+                                subtypeForEncoding(encoding));
+}
+
+// NV12 requires even dimensions.
+Size alignedSize(const Size& size)
+{
+    return Size((size.width() + 1) & ~1, (size.height() + 1) & ~1);
+}
+
+} // namespace
+
+VideoEncoderMF::VideoEncoderMF(proto::VideoEncoding encoding, ComPtr<IMFTransform> transform)
+    : VideoEncoder(encoding),
+      transform_(std::move(transform))
+{
+    LOG(LS_INFO) << "Ctor";
+}
+
+VideoEncoderMF::~VideoEncoderMF()
+{
+    LOG(LS_INFO) << "Dtor";
+    destroyEncoder();
+}
+
+// static
+std::unique_ptr<VideoEncoderMF> VideoEncoderMF::create(proto::VideoEncoding encoding)
+{
+    if (encoding != proto::VIDEO_ENCODING_H264 && encoding != proto::VIDEO_ENCODING_HEVC)
+    {
+        LOG(LS_WARNING) << "Unsupported encoding: " << encoding;
+        return nullptr;
+    }
+
+    ComPtr<IMFTransform> transform = createHardwareEncoder(encoding);
+    if (!transform)
+    {
+        LOG(LS_INFO) << "No hardware encoder for encoding: " << encoding;
+        return nullptr;
+    }
+
+    return std::unique_ptr<VideoEncoderMF>(new VideoEncoderMF(encoding, std::move(transform)));
+}
+
+// static
+uint32_t VideoEncoderMF::supportedEncodings()
+{
+    static const uint32_t encodings = []()
+    {
+        uint32_t result = 0;
+
+        if (createHardwareEncoder(proto::VIDEO_ENCODING_H264))
+            result |= proto::VIDEO_ENCODING_H264;
+
+        if (createHardwareEncoder(proto::VIDEO_ENCODING_HEVC))
+            result |= proto::VIDEO_ENCODING_HEVC;
+
+        LOG(LS_INFO) << "Hardware video encodings: " << result;
+        return result;
+    }();
+
+    return encodings;
+}
+
+bool VideoEncoderMF::encode(const Frame* frame, proto::VideoPacket* packet)
+{
+    fillPacketInfo(frame, packet);
+
+    bool is_key_frame = isKeyFrameRequired();
+
+    if (packet->has_format() || !event_generator_)
+    {
+        if (!createEncoder(frame->size()))
+        {
+            LOG(LS_ERROR) << "Unable to create encoder";
+            destroyEncoder();
+            return false;
+        }
+
+        is_key_frame = true;
+    }
+
+    if (!prepareSample(frame))
+        return false;
+
+    if (is_key_frame)
+    {
+        VARIANT value;
+        VariantInit(&value);
+        value.vt = VT_UI4;
+        value.ulVal = 1;
+
+        codec_api_->SetValue(&CODECAPI_AVEncVideoForceKeyFrame, &value);
+    }
+
+    bool input_sent = false;
+
+    if (pending_input_requests_ > 0)
+    {
+        _com_error error = transform_->ProcessInput(0, input_sample_.Get(), 0);
+        if (error.Error() != S_OK)
+        {
+            LOG(LS_ERROR) << "ProcessInput failed: " << error.ErrorMessage();
+            return false;
+        }
+
+        --pending_input_requests_;
+        input_sent = true;
+    }
+
+    while (true)
+    {
+        MediaEventType type;
+        if (!waitForEvent(&type))
+            return false;
+
+        if (type == METransformNeedInput)
+        {
+            if (input_sent)
+            {
+                // The encoder is ready for the next frame.
+                ++pending_input_requests_;
+                continue;
+            }
+
+            _com_error error = transform_->ProcessInput(0, input_sample_.Get(), 0);
+            if (error.Error() != S_OK)
+            {
+                LOG(LS_ERROR) << "ProcessInput failed: " << error.ErrorMessage();
+                return false;
+            }
+
+            input_sent = true;
+        }
+        else if (type == METransformHaveOutput)
+        {
+            if (!processOutput(packet))
+                return false;
+            break;
+        }
+    }
+
+    // The encoder always produces the entire frame.
+    proto::Rect* dirty_rect = packet->add_dirty_rect();
+    dirty_rect->set_width(frame->size().width());
+    dirty_rect->set_height(frame->size().height());
+
+    packet->set_key_frame(is_key_frame);
+    setKeyFrameRequired(false);
+    return true;
+}
+
+bool VideoEncoderMF::createEncoder(const Size& size)
+{
+    destroyEncoder();
+
+    if (!transform_)
+    {
+        transform_ = createHardwareEncoder(encoding());
+        if (!transform_)
+            return false;
+    }
+
+    size_ = alignedSize(size);
+
+    ComPtr<IMFAttributes> attributes;
+    _com_error error = transform_->GetAttributes(attributes.GetAddressOf());
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "GetAttributes failed: " << error.ErrorMessage();
+        return false;
+    }
+
+    // Hardware encoders are asynchronous and must be unlocked before use.
+    attributes->SetUINT32(MF_TRANSFORM_ASYNC_UNLOCK, TRUE);
+    attributes->SetUINT32(MF_LOW_LATENCY, TRUE);
+
+    error = transform_.As(&event_generator_);
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "Encoder has no event generator: " << error.ErrorMessage();
+        return false;
+    }
+
+    error = transform_.As(&codec_api_);
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "Encoder has no ICodecAPI: " << error.ErrorMessage();
+        return false;
+    }
+
+    // The output type must be set before the input type.
+    ComPtr<IMFMediaType> output_type =
+        win::createVideoMediaType(subtypeForEncoding(encoding()), size_, kFrameRate);
+    if (!output_type)
+        return false;
+
+    const double frame_area = static_cast<double>(size_.width()) * size_.height();
+    const UINT32 bitrate = std::max(static_cast<UINT32>(
+        kBitrateFor1080p * (frame_area / (1920.0 * 1080.0))), 1000000u);
+
+    output_type->SetUINT32(MF_MT_AVG_BITRATE, bitrate);
+
+    if (encoding() == proto::VIDEO_ENCODING_H264)
+        output_type->SetUINT32(MF_MT_MPEG2_PROFILE, eAVEncH264VProfile_Main);
+
+    error = transform_->SetOutputType(0, output_type.Get(), 0);
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "SetOutputType failed: " << error.ErrorMessage();
+        return false;
+    }
+
+    ComPtr<IMFMediaType> input_type =
+        win::createVideoMediaType(MFVideoFormat_NV12, size_, kFrameRate);
+    if (!input_type)
+        return false;
+
+    error = transform_->SetInputType(0, input_type.Get(), 0);
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "SetInputType failed: " << error.ErrorMessage();
+        return false;
+    }
+
+    VARIANT value;
+    VariantInit(&value);
+
+    value.vt = VT_BOOL;
+    value.boolVal = VARIANT_TRUE;
+    codec_api_->SetValue(&CODECAPI_AVLowLatencyMode, &value);
+
+    value.vt = VT_UI4;
+    value.ulVal = eAVEncCommonRateControlMode_LowDelayVBR;
+    if (FAILED(codec_api_->SetValue(&CODECAPI_AVEncCommonRateControlMode, &value)))
+    {
+        value.ulVal = eAVEncCommonRateControlMode_CBR;
+        codec_api_->SetValue(&CODECAPI_AVEncCommonRateControlMode, &value);
+    }
+
+    // Since the transport layer is reliable, key frames are sent only on request.
+    value.vt = VT_UI4;
+    value.ulVal = 0;
+    codec_api_->SetValue(&CODECAPI_AVEncMPVGOPSize, &value);
+
+    value.vt = VT_UI4;
+    value.ulVal = 0;
+    codec_api_->SetValue(&CODECAPI_AVEncMPVDefaultBPictureCount, &value);
+
+    MFT_OUTPUT_STREAM_INFO stream_info;
+    memset(&stream_info, 0, sizeof(stream_info));
+
+    error = transform_->GetOutputStreamInfo(0, &stream_info);
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "GetOutputStreamInfo failed: " << error.ErrorMessage();
+        return false;
+    }
+
+    provides_samples_ = (stream_info.dwFlags & MFT_OUTPUT_STREAM_PROVIDES_SAMPLES) != 0;
+
+    const DWORD buffer_size = static_cast<DWORD>(size_.width() * size_.height() * 3 / 2);
+
+    error = MFCreateMemoryBuffer(buffer_size, input_buffer_.GetAddressOf());
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "MFCreateMemoryBuffer failed: " << error.ErrorMessage();
+        return false;
+    }
+
+    input_buffer_->SetCurrentLength(buffer_size);
+
+    error = MFCreateSample(input_sample_.GetAddressOf());
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "MFCreateSample failed: " << error.ErrorMessage();
+        return false;
+    }
+
+    input_sample_->AddBuffer(input_buffer_.Get());
+
+    transform_->ProcessMessage(MFT_MESSAGE_NOTIFY_BEGIN_STREAMING, 0);
+    transform_->ProcessMessage(MFT_MESSAGE_NOTIFY_START_OF_STREAM, 0);
+
+    LOG(LS_INFO) << "Encoder created for " << size_ << " (bitrate: " << bitrate
+                 << ", provides samples: " << provides_samples_ << ")";
+    return true;
+}
+
+void VideoEncoderMF::destroyEncoder()
+{
+    if (transform_ && event_generator_)
+    {
+        transform_->ProcessMessage(MFT_MESSAGE_NOTIFY_END_OF_STREAM, 0);
+        transform_->ProcessMessage(MFT_MESSAGE_NOTIFY_END_STREAMING, 0);
+        transform_->ProcessMessage(MFT_MESSAGE_COMMAND_FLUSH, 0);
+
+        // A transform cannot change types after streaming, so a new instance is created for the
+        // next size.
+        transform_.Reset();
+    }
+
+    event_generator_.Reset();
+    codec_api_.Reset();
+    input_sample_.Reset();
+    input_buffer_.Reset();
+
+    pending_input_requests_ = 0;
+}
+
+bool VideoEncoderMF::prepareSample(const Frame* frame)
+{
+    BYTE* data = nullptr;
+
+    _com_error error = input_buffer_->Lock(&data, nullptr, nullptr);
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "IMFMediaBuffer::Lock failed: " << error.ErrorMessage();
+        return false;
+    }
+
+    const int y_stride = size_.width();
+    uint8_t* y_plane = data;
+    uint8_t* uv_plane = data + y_stride * size_.height();
+
+    if (frame->layout() == Frame::Layout::I420)
+    {
+        libyuv::I420ToNV12(frame->yPlane(), frame->yStride(),
+                           frame->uPlane(), frame->uvStride(),
+                           frame->vPlane(), frame->uvStride(),
+                           y_plane, y_stride,
+                           uv_plane, y_stride,
+                           frame->size().width(), frame->size().height());
+    }
+    else
+    {
+        libyuv::ARGBToNV12(frame->frameData(), frame->stride(),
+                           y_plane, y_stride,
+                           uv_plane, y_stride,
+                           frame->size().width(), frame->size().height());
+    }
+
+    input_buffer_->Unlock();
+
+    const std::chrono::microseconds duration(std::chrono::seconds(1));
+    const LONGLONG frame_duration = (duration.count() * 10) / kFrameRate;
+
+    // Media Foundation uses 100-nanosecond units.
+    input_sample_->SetSampleTime(timestamp_.count() * 10);
+    input_sample_->SetSampleDuration(frame_duration);
+
+    timestamp_ += duration / kFrameRate;
+    return true;
+}
+
+bool VideoEncoderMF::waitForEvent(MediaEventType* type)
+{
+    const auto deadline = std::chrono::steady_clock::now() + kEncodeTimeout;
+
+    while (true)
+    {
+        ComPtr<IMFMediaEvent> event;
+
+        HRESULT hr = event_generator_->GetEvent(MF_EVENT_FLAG_NO_WAIT, event.GetAddressOf());
+        if (hr == MF_E_NO_EVENTS_AVAILABLE)
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+            {
+                LOG(LS_ERROR) << "Timeout while waiting for the encoder";
+                return false;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        if (FAILED(hr))
+        {
+            LOG(LS_ERROR) << "GetEvent failed: " << _com_error(hr).ErrorMessage();
+            return false;
+        }
+
+        hr = event->GetType(type);
+        if (FAILED(hr))
+        {
+            LOG(LS_ERROR) << "GetType failed: " << _com_error(hr).ErrorMessage();
+            return false;
+        }
+
+        return true;
+    }
+}
+
+bool VideoEncoderMF::processOutput(proto::VideoPacket* packet)
+{
+    MFT_OUTPUT_DATA_BUFFER output;
+    memset(&output, 0, sizeof(output));
+
+    ComPtr<IMFSample> sample;
+
+    if (!provides_samples_)
+    {
+        MFT_OUTPUT_STREAM_INFO stream_info;
+        memset(&stream_info, 0, sizeof(stream_info));
+        transform_->GetOutputStreamInfo(0, &stream_info);
+
+        ComPtr<IMFMediaBuffer> buffer;
+        const DWORD buffer_size =
+            std::max(stream_info.cbSize, static_cast<DWORD>(size_.width() * size_.height()));
+
+        if (FAILED(MFCreateMemoryBuffer(buffer_size, buffer.GetAddressOf())) ||
+            FAILED(MFCreateSample(sample.GetAddressOf())))
+        {
+            LOG(LS_ERROR) << "Unable to create output sample";
+            return false;
+        }
+
+        sample->AddBuffer(buffer.Get());
+        output.pSample = sample.Get();
+    }
+
+    DWORD status = 0;
+    HRESULT hr = transform_->ProcessOutput(0, 1, &output, &status);
+
+    if (output.pEvents)
+        output.pEvents->Release();
+
+    if (provides_samples_ && output.pSample)
+        sample.Attach(output.pSample);
+
+    if (FAILED(hr))
+    {
+        LOG(LS_ERROR) << "ProcessOutput failed: " << _com_error(hr).ErrorMessage();
+        return false;
+    }
+
+    ComPtr<IMFMediaBuffer> buffer;
+    hr = sample->ConvertToContiguousBuffer(buffer.GetAddressOf());
+    if (FAILED(hr))
+    {
+        LOG(LS_ERROR) << "ConvertToContiguousBuffer failed: " << _com_error(hr).ErrorMessage();
+        return false;
+    }
+
+    BYTE* data = nullptr;
+    DWORD length = 0;
+
+    hr = buffer->Lock(&data, nullptr, &length);
+    if (FAILED(hr))
+    {
+        LOG(LS_ERROR) << "IMFMediaBuffer::Lock failed: " << _com_error(hr).ErrorMessage();
+        return false;
+    }
+
+    packet->set_data(data, length);
+    buffer->Unlock();
+
+    return true;
+}
+
+} // namespace base
@@ -0,0 +1,77 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_CODEC_VIDEO_ENCODER_MF_H
+#define BASE_CODEC_VIDEO_ENCODER_MF_H
+
+#include "base/macros_magic.h"
+#include "base/codec/video_encoder.h"
+
+#include <chrono>
+
+#include <codecapi.h>
+#include <mfidl.h>
+#include <mftransform.h>
+#include <strmif.h>
+#include <wrl/client.h>
+
+namespace base {
+
+// H.264 and HEVC encoder that uses hardware Media Foundation transforms. The transforms are
+// provided by the video card drivers (NVENC, Quick Sync Video, AMF), so the encoder is available
+// only if the system has a suitable video adapter.
+class VideoEncoderMF : public VideoEncoder
+{
+public:
+    ~VideoEncoderMF() override;
+
+    // Returns nullptr if there is no hardware encoder for |encoding| in the system.
+    static std::unique_ptr<VideoEncoderMF> create(proto::VideoEncoding encoding);
+
+    // Returns a bit mask of proto::VideoEncoding values supported by hardware encoders.
+    static uint32_t supportedEncodings();
+
+    bool encode(const Frame* frame, proto::VideoPacket* packet) override;
+
+private:
+    VideoEncoderMF(proto::VideoEncoding encoding,
+                   Microsoft::WRL::ComPtr<IMFTransform> transform);
+
+    bool createEncoder(const Size& size);
+    void destroyEncoder();
+    bool prepareSample(const Frame* frame);
+    bool waitForEvent(MediaEventType* type);
+    bool processOutput(proto::VideoPacket* packet);
+
+    Microsoft::WRL::ComPtr<IMFTransform> transform_;
+    Microsoft::WRL::ComPtr<IMFMediaEventGenerator> event_generator_;
+    Microsoft::WRL::ComPtr<ICodecAPI> codec_api_;
+    Microsoft::WRL::ComPtr<IMFSample> input_sample_;
+    Microsoft::WRL::ComPtr<IMFMediaBuffer> input_buffer_;
+
+    Size size_;
+    bool provides_samples_ = false;
+    int pending_input_requests_ = 0;
+    std::chrono::microseconds timestamp_ { 0 };
+
+    DISALLOW_COPY_AND_ASSIGN(VideoEncoderMF);
+};
+
+} // namespace base
+
+#endif // BASE_CODEC_VIDEO_ENCODER_MF_H
@@ -19,11 +19,18 @@
 #include "base/codec/video_encoder_vpx.h"
 
 #include "base/logging.h"
+#include "base/codec/video_encoder_zstd.h"
 #include "base/desktop/frame.h"
+#include "base/desktop/frame_view.h"
+#include "base/threading/worker_pool.h"
 
 #include <libyuv/convert.h>
+#include <libyuv/convert_from_argb.h>
 #include <libyuv/cpu_id.h>
+#include <libyuv/planar_functions.h>
 
+#include <algorithm>
+#include <iterator>
 #include <thread>
 
 namespace base {
@@ -35,12 +42,108 @@ const std::chrono::milliseconds kTargetFrameInterval{ 80 };
 // Defines the dimension of a macro block. This is used to compute the active map for the encoder.
 const int kMacroBlockSize = 16;
 
-// Magic encoder profile numbers for I420 input formats.
+// The conversion of the updated region to YUV is split into bands of at least kMinBandArea pixels
+// between threads if the region is larger than kMinThreadedArea.
+const int64_t kMinThreadedArea = 256 * 256;
+const int64_t kMinBandArea = 128 * 128;
+const int kMaxConvertThreadCount = 4;
+
+// Magic encoder profile numbers for I420 and I444 input formats.
 const int kVp9I420ProfileNumber = 0;
+const int kVp9I444ProfileNumber = 1;
 
 // Magic encoder constant for adaptive quantization strategy.
 const int kVp9AqModeCyclicRefresh = 3;
 
+// VP9 regions of interest are set for blocks of 8x8 pixels.
+const int kVp9RoiBlockSize = 8;
+
+// The segments of the VP9 regions of interest and their quantizer deltas. The blocks around the
+// cursor and the blocks that were changed recently but not continuously (for example, typed text)
+// get a better quality. The blocks that were not changed for a long time get a worse one, which
+// reduces the size of the key frames.
+enum RoiSegment : uint8_t
+{
+    kRoiSegmentNormal = 0,
+    kRoiSegmentInterest = 1,
+    kRoiSegmentStatic = 2
+};
+
+const int kRoiInterestDeltaQ = -12;
+const int kRoiStaticDeltaQ = 12;
+
+// The age of a macroblock is the number of frames since its last change (up to 255). A block of
+// interest was changed during the last half a second.
+const uint8_t kRecentBlockAge = 15;
+const uint8_t kStaticBlockAge = 255;
+
+// The heat of a macroblock grows with each change and decays by 1/8 each frame. Continuously
+// changed blocks (video, animations) are hotter than the limit and are left to the rate control.
+const int kHeatStep = 32;
+const int kVideoBlockHeat = 192;
+
+// Distance from the cursor in pixels.
+const int kCursorRoiRadius = 64;
+
+// The golden and altref buffers keep the last states of the screen (for example, the windows
+// between which the user switches). If at least a quarter of the macroblocks is changed, the frame
+// is compared with the states. If at least a half of the changed blocks matches one of them, the
+// frame is predicted from it, otherwise it becomes a new state in the least recently used buffer.
+// The current state is refreshed every kReferenceRefreshInterval changed frames.
+const size_t kSwitchAreaDivider = 4;
+const size_t kReferenceRefreshInterval = 30;
+
+struct ReferenceFlags
+{
+    vpx_enc_frame_flags_t no_ref;
+    vpx_enc_frame_flags_t no_update;
+    vpx_enc_frame_flags_t force_update;
+};
+
+const ReferenceFlags kReferenceFlags[] =
+{
+    { VP8_EFLAG_NO_REF_GF, VP8_EFLAG_NO_UPD_GF, VP8_EFLAG_FORCE_GF },
+    { VP8_EFLAG_NO_REF_ARF, VP8_EFLAG_NO_UPD_ARF, VP8_EFLAG_FORCE_ARF }
+};
+
+static_assert(std::size(kReferenceFlags) == VideoEncoderVPX::kReferenceCount);
+
+// The hash of a macroblock of the luma plane. The planes are padded to whole macroblocks.
+uint32_t blockHash(const uint8_t* data, int stride)
+{
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (int y = 0; y < kMacroBlockSize; ++y)
+    {
+        uint64_t values[2];
+        memcpy(values, data, sizeof(values));
+
+        hash = (hash ^ values[0]) * 1099511628211ULL;
+        hash = (hash ^ values[1]) * 1099511628211ULL;
+
+        data += stride;
+    }
+
+    return static_cast<uint32_t>(hash ^ (hash >> 32));
+}
+
+// VP9 tile columns are at least 256 pixels wide. The value is the log2 of the column count.
+const int kVp9MinTileWidth = 256;
+const int kVp9MaxTileColumnsLog2 = 3;
+
+int vp9TileColumnsLog2(int width)
+{
+    int tile_columns_log2 = 0;
+
+    while (tile_columns_log2 < kVp9MaxTileColumnsLog2 &&
+           (kVp9MinTileWidth << (tile_columns_log2 + 1)) <= width)
+    {
+        ++tile_columns_log2;
+    }
+
+    return tile_columns_log2;
+}
+
 void setCommonCodecParameters(vpx_codec_enc_cfg_t* config, const Size& size)
 {
     // Use millisecond granularity time base.
@@ -76,20 +179,45 @@ void setCommonCodecParameters(vpx_codec_enc_cfg_t* config, const Size& size)
     config->rc_overshoot_pct = 15;
 }
 
+// Sets the padding of a plane beyond |width| x |height| to 128. The image itself is converted
+// entirely for the key frame, which follows each format change.
+void fillPlanePadding(uint8_t* plane, int stride, int width, int height, int rows)
+{
+    for (int y = 0; y < height; ++y)
+        memset(plane + y * stride + width, 128, static_cast<size_t>(stride - width));
+
+    memset(plane + height * stride, 128, static_cast<size_t>((rows - height) * stride));
+}
+
+// The image and its buffer are reused if the buffer is large enough, so that changes of the
+// resolution do not cause allocations.
 void createImage(const Size& size,
+                 bool i444,
                  std::unique_ptr<vpx_image_t>* out_image,
-                 ByteArray* out_image_buffer)
+                 ByteArray* image_buffer)
 {
-    std::unique_ptr<vpx_image_t> image = std::make_unique<vpx_image_t>();
+    if (!*out_image)
+        *out_image = std::make_unique<vpx_image_t>();
 
-    memset(image.get(), 0, sizeof(vpx_image_t));
+    vpx_image_t* image = out_image->get();
+    memset(image, 0, sizeof(vpx_image_t));
 
     image->d_w = image->w = static_cast<unsigned int>(size.width());
     image->d_h = image->h = static_cast<unsigned int>(size.height());
 
-    image->fmt = VPX_IMG_FMT_YV12;
-    image->x_chroma_shift = 1;
-    image->y_chroma_shift = 1;
+    if (i444)
+    {
+        // The chroma planes have the full resolution.
+        image->fmt = VPX_IMG_FMT_I444;
+        image->x_chroma_shift = 0;
+        image->y_chroma_shift = 0;
+    }
+    else
+    {
+        image->fmt = VPX_IMG_FMT_YV12;
+        image->x_chroma_shift = 1;
+        image->y_chroma_shift = 1;
+    }
 
     // libyuv's fast-path requires 16-byte aligned pointers and strides, so pad the Y, U and V
     // planes' strides to multiples of 16 bytes.
@@ -105,24 +233,32 @@ void createImage(const Size& size,
     const int y_rows = ((image->h - 1) & ~(kMacroBlockSize - 1)) + kMacroBlockSize;
     const int uv_rows = y_rows >> image->y_chroma_shift;
 
-    ByteArray image_buffer;
-
     // Allocate a YUV buffer large enough for the aligned data & padding.
-    image_buffer.resize(y_stride * y_rows + (2 * uv_stride) * uv_rows);
-
-    // Reset image value to 128 so we just need to fill in the y plane.
-    memset(image_buffer.data(), 128, image_buffer.size());
+    const size_t buffer_size = static_cast<size_t>(y_stride * y_rows + (2 * uv_stride) * uv_rows);
+    if (image_buffer->size() < buffer_size)
+    {
+        // The old content is not needed, so it is not copied.
+        image_buffer->clear();
+        image_buffer->resize(buffer_size);
+    }
 
     // Fill in the information.
-    image->planes[0] = image_buffer.data();
+    image->planes[0] = image_buffer->data();
     image->planes[1] = image->planes[0] + y_stride * y_rows;
     image->planes[2] = image->planes[1] + uv_stride * uv_rows;
 
     image->stride[0] = y_stride;
     image->stride[1] = image->stride[2] = uv_stride;
 
-    *out_image = std::move(image);
-    *out_image_buffer = std::move(image_buffer);
+    const int width = static_cast<int>(image->w);
+    const int height = static_cast<int>(image->h);
+    const int uv_width = (width + static_cast<int>(image->x_chroma_shift)) >> image->x_chroma_shift;
+    const int uv_height =
+        (height + static_cast<int>(image->y_chroma_shift)) >> image->y_chroma_shift;
+
+    fillPlanePadding(image->planes[0], y_stride, width, height, y_rows);
+    fillPlanePadding(image->planes[1], uv_stride, uv_width, uv_height, uv_rows);
+    fillPlanePadding(image->planes[2], uv_stride, uv_width, uv_height, uv_rows);
 }
 
 int roundToTwosMultiple(int x)
@@ -155,10 +291,48 @@ std::unique_ptr<VideoEncoderVPX> VideoEncoderVPX::createVP9()
 }
 
 VideoEncoderVPX::VideoEncoderVPX(proto::VideoEncoding encoding)
-    : VideoEncoder(encoding)
+    : VideoEncoder(encoding),
+      active_blocks_(Size(), kMacroBlockSize)
 {
     memset(&config_, 0, sizeof(config_));
     memset(&active_map_, 0, sizeof(active_map_));
+    memset(&roi_map_, 0, sizeof(roi_map_));
+}
+
+VideoEncoderVPX::~VideoEncoderVPX() = default;
+
+void VideoEncoderVPX::setLosslessEncoder(std::unique_ptr<VideoEncoderZstd> encoder)
+{
+    DCHECK_EQ(encoding(), proto::VIDEO_ENCODING_VP9);
+
+    lossless_encoder_ = std::move(encoder);
+    if (lossless_encoder_)
+        lossless_encoder_->setOverlayMode(true);
+}
+
+void VideoEncoderVPX::setI444Mode(bool enable)
+{
+    DCHECK_EQ(encoding(), proto::VIDEO_ENCODING_VP9);
+    i444_ = enable;
+}
+
+size_t VideoEncoderVPX::memoryUsage() const
+{
+    // The buffers of libvpx are not visible. They are estimated as the last frame and the
+    // long-term references in the format of the input image.
+    size_t usage = image_buffer_.size() * (kReferenceCount + 2);
+
+    usage += active_map_buffer_.size() + block_age_.size() + block_heat_.size() +
+             roi_map_buffer_.size();
+    usage += block_hashes_.size() * sizeof(uint32_t);
+
+    for (const ReferenceState& reference : references_)
+        usage += reference.block_hashes.size() * sizeof(uint32_t);
+
+    if (lossless_encoder_)
+        usage += lossless_encoder_->memoryUsage();
+
+    return usage;
 }
 
 bool VideoEncoderVPX::encode(const Frame* frame, proto::VideoPacket* packet)
@@ -171,8 +345,9 @@ bool VideoEncoderVPX::encode(const Frame* frame, proto::VideoPacket* packet)
     {
         const Size& frame_size = frame->size();
 
-        createImage(frame_size, &image_, &image_buffer_);
+        createImage(frame_size, i444_, &image_, &image_buffer_);
         createActiveMap(frame_size);
+        createRoiMap(frame_size);
 
         if (encoding() == proto::VIDEO_ENCODING_VP8)
         {
@@ -196,9 +371,28 @@ bool VideoEncoderVPX::encode(const Frame* frame, proto::VideoPacket* packet)
         is_key_frame = true;
     }
 
+    // The blocks of text are not encoded by VP9 unless it is a key frame. The client decodes the
+    // lossless packet after the VP9 data, so the blurred text of a key frame is replaced.
+    const bool is_hybrid = lossless_encoder_ && frame->layout() == Frame::Layout::PACKED;
+    Region video_region;
+
+    if (is_hybrid && !encodeLosslessBlocks(is_key_frame, frame, &video_region, packet))
+    {
+        LOG(LS_ERROR) << "Unable to encode lossless blocks";
+        return false;
+    }
+
     // Convert the updated capture data ready for encode.
     // Update active map based on updated region.
-    prepareImageAndActiveMap(is_key_frame, frame, packet);
+    prepareImageAndActiveMap(
+        is_key_frame, frame, is_hybrid ? video_region : frame->constUpdatedRegion(), packet);
+
+    if (is_hybrid && !is_key_frame)
+    {
+        // The padding around the blocks of video is encoded, but must not be drawn over the
+        // lossless blocks next to them.
+        setDirtyRects(video_region, packet);
+    }
 
     // Apply active map to the encoder.
     vpx_codec_err_t ret = vpx_codec_control(codec_.get(), VP8E_SET_ACTIVEMAP, &active_map_);
@@ -208,13 +402,18 @@ bool VideoEncoderVPX::encode(const Frame* frame, proto::VideoPacket* packet)
         return false;
     }
 
+    if (encoding() == proto::VIDEO_ENCODING_VP9)
+        updateRoiMap(is_key_frame);
+
+    const vpx_enc_frame_flags_t flags = updateReferences(is_key_frame);
+
     // Do the actual encoding.
     ret = vpx_codec_encode(codec_.get(),
                            image_.get(),
                            0, // pts
                            static_cast<unsigned long>(
                                std::chrono::microseconds(kTargetFrameInterval).count()),
-                           0, // flags
+                           flags,
                            VPX_DL_REALTIME);
     if (ret != VPX_CODEC_OK)
     {
@@ -238,6 +437,7 @@ bool VideoEncoderVPX::encode(const Frame* frame, proto::VideoPacket* packet)
         }
     }
 
+    packet->set_key_frame(is_key_frame);
     setKeyFrameRequired(false);
     return true;
 }
@@ -298,6 +498,35 @@ uint32_t VideoEncoderVPX::maxQuantizer() const
     return config_.rc_max_quantizer;
 }
 
+bool VideoEncoderVPX::setTargetBitrate(uint32_t kbps)
+{
+    if (!kbps)
+    {
+        LOG(LS_WARNING) << "Invalid bitrate value: " << kbps;
+        return false;
+    }
+
+    if (target_bitrate_ == kbps)
+        return true;
+
+    target_bitrate_ = kbps;
+
+    // The codec is created with the first frame and gets the bitrate then.
+    if (!codec_)
+        return true;
+
+    config_.rc_target_bitrate = kbps;
+
+    vpx_codec_err_t ret = vpx_codec_enc_config_set(codec_.get(), &config_);
+    if (ret != VPX_CODEC_OK)
+    {
+        LOG(LS_WARNING) << "vpx_codec_enc_config_set failed: " << ret;
+        return false;
+    }
+
+    return true;
+}
+
 void VideoEncoderVPX::createActiveMap(const Size& size)
 {
     active_map_.cols = static_cast<unsigned int>(
@@ -307,8 +536,9 @@ void VideoEncoderVPX::createActiveMap(const Size& size)
 
     active_map_buffer_.resize(active_map_.cols * active_map_.rows);
     active_map_.active_map = active_map_buffer_.data();
+    memset(active_map_buffer_.data(), 0, active_map_buffer_.size());
 
-    clearActiveMap();
+    active_blocks_ = BlockRegion(size, kMacroBlockSize);
 }
 
 bool VideoEncoderVPX::createVp8Codec(const Size& size)
@@ -335,10 +565,7 @@ bool VideoEncoderVPX::createVp8Codec(const Size& size)
     // the max quantizer. The quality will get topped-off in subsequent frames.
     config_.rc_min_quantizer = 10;
     config_.rc_max_quantizer = 30;
-
-    // In the absence of a good bandwidth estimator set the target bitrate to a
-    // conservative default.
-    config_.rc_target_bitrate = 1000;
+    config_.rc_target_bitrate = target_bitrate_;
 
     ret = vpx_codec_enc_init(codec_.get(), algo, &config_, 0);
     if (ret != VPX_CODEC_OK)
@@ -390,14 +617,11 @@ bool VideoEncoderVPX::createVp9Codec(const Size& size)
 
     setCommonCodecParameters(&config_, size);
 
-    // Configure VP9 for I420 source frames.
-    config_.g_profile = kVp9I420ProfileNumber;
+    // Configure VP9 for I420 or I444 source frames.
+    config_.g_profile = i444_ ? kVp9I444ProfileNumber : kVp9I420ProfileNumber;
     config_.rc_min_quantizer = 10;
     config_.rc_max_quantizer = 30;
-
-    // In the absence of a good bandwidth estimator set the target bitrate to a
-    // conservative default.
-    config_.rc_target_bitrate = 1000;
+    config_.rc_target_bitrate = target_bitrate_;
 
     ret = vpx_codec_enc_init(codec_.get(), algo, &config_, 0);
     if (ret != VPX_CODEC_OK)
@@ -415,7 +639,8 @@ bool VideoEncoderVPX::createVp9Codec(const Size& size)
         return false;
     }
 
-    ret = vpx_codec_control(codec_.get(), VP9E_SET_TUNE_CONTENT, VP9E_CONTENT_SCREEN);
+    ret = vpx_codec_control(codec_.get(), VP9E_SET_TUNE_CONTENT,
+                            screen_content_mode_ ? VP9E_CONTENT_SCREEN : VP9E_CONTENT_DEFAULT);
     if (ret != VPX_CODEC_OK)
     {
         LOG(LS_WARNING) << "vpx_codec_control(VP9E_SET_TUNE_CONTENT) failed: " << ret;
@@ -439,11 +664,47 @@ bool VideoEncoderVPX::createVp9Codec(const Size& size)
         return false;
     }
 
+    if (tile_columns_enabled_)
+    {
+        const int tile_columns_log2 = vp9TileColumnsLog2(size.width());
+
+        LOG(LS_INFO) << "VP9 tile columns: " << (1 << tile_columns_log2);
+
+        ret = vpx_codec_control(codec_.get(), VP9E_SET_TILE_COLUMNS, tile_columns_log2);
+        if (ret != VPX_CODEC_OK)
+        {
+            LOG(LS_WARNING) << "vpx_codec_control(VP9E_SET_TILE_COLUMNS) failed: " << ret;
+            return false;
+        }
+    }
+
     return true;
 }
 
-void VideoEncoderVPX::prepareImageAndActiveMap(
-    bool is_key_frame, const Frame* frame, proto::VideoPacket* packet)
+bool VideoEncoderVPX::encodeLosslessBlocks(
+    bool is_key_frame, const Frame* frame, Region* video_region, proto::VideoPacket* packet)
+{
+    // Lossless packets dropped by the client are restored by the text of the whole key frame.
+    const Region updated_region =
+        is_key_frame ? Region(Rect::makeSize(frame->size())) : frame->constUpdatedRegion();
+
+    Region text_region;
+    classifier_.classify(*frame, updated_region, &text_region, video_region);
+
+    // The first packet of the lossless stream is always sent, because it has the format.
+    if (text_region.isEmpty() && !is_key_frame)
+        return true;
+
+    FrameView view(*frame, Rect::makeSize(frame->size()));
+    view.copyFrameInfoFrom(*frame);
+    *view.updatedRegion() = std::move(text_region);
+
+    return lossless_encoder_->encode(&view, packet->mutable_lossless_packet());
+}
+
+void VideoEncoderVPX::prepareImageAndActiveMap(bool is_key_frame, const Frame* frame,
+                                               const Region& frame_region,
+                                               proto::VideoPacket* packet)
 {
     Rect image_rect = Rect::makeWH(static_cast<int32_t>(image_->w), static_cast<int32_t>(image_->h));
     Region updated_region;
@@ -452,7 +713,7 @@ void VideoEncoderVPX::prepareImageAndActiveMap(
     {
         const int padding = ((encoding() == proto::VIDEO_ENCODING_VP9) ? 8 : 3);
 
-        for (Region::Iterator it(frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
+        for (Region::Iterator it(frame_region); !it.isAtEnd(); it.advance())
         {
             Rect rect = it.rect();
 
@@ -478,62 +739,373 @@ void VideoEncoderVPX::prepareImageAndActiveMap(
         updated_region = Region(image_rect);
     }
 
-    clearActiveMap();
+    active_blocks_.clear();
+
+    int64_t total_area = 0;
+    for (Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
+        total_area += static_cast<int64_t>(it.rect().width()) * it.rect().height();
+
+    WorkerPool* worker_pool = workerPool(total_area);
+    const int thread_count = worker_pool ? worker_pool->threadCount() : 1;
+
+    bands_.clear();
+
+    for (Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+        const int64_t area = static_cast<int64_t>(rect.width()) * rect.height();
+
+        // Each band converts its own rows. The bands start at even rows for the I420 chroma.
+        const int64_t max_band_count = std::min(thread_count, rect.height());
+        const int band_count =
+            static_cast<int>(std::clamp(area / kMinBandArea, int64_t(1), max_band_count));
+        const int band_height =
+            roundToTwosMultiple((rect.height() + band_count - 1) / band_count + 1);
+
+        for (int top = rect.top(); top < rect.bottom(); top += band_height)
+        {
+            bands_.emplace_back(Rect::makeLTRB(
+                rect.left(), top, rect.right(), std::min(top + band_height, rect.bottom())));
+        }
+
+        active_blocks_.addRect(rect);
+    }
+
+    for (unsigned int y = 0; y < active_map_.rows; ++y)
+    {
+        active_blocks_.getRow(static_cast<int>(y), active_map_.active_map + y * active_map_.cols,
+                              static_cast<int>(active_map_.cols));
+    }
+
+    setDirtyRects(updated_region, packet);
 
+    if (!worker_pool || bands_.size() < 2)
+    {
+        for (const auto& band : bands_)
+            convertRect(frame, band);
+        return;
+    }
+
+    const size_t band_count = bands_.size();
+    const size_t step = static_cast<size_t>(thread_count);
+
+    worker_pool->run([&](int index)
+    {
+        for (size_t i = static_cast<size_t>(index); i < band_count; i += step)
+            convertRect(frame, bands_[i]);
+    });
+}
+
+void VideoEncoderVPX::convertRect(const Frame* frame, const Rect& rect)
+{
     const int y_stride = image_->stride[0];
     const int uv_stride = image_->stride[1];
+    const unsigned int x_shift = image_->x_chroma_shift;
+    const unsigned int y_shift = image_->y_chroma_shift;
     uint8_t* y_data = image_->planes[0];
     uint8_t* u_data = image_->planes[1];
     uint8_t* v_data = image_->planes[2];
 
-    for (Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
+    const int y_offset = y_stride * rect.y() + rect.x();
+    const int uv_offset = uv_stride * (rect.y() >> y_shift) + (rect.x() >> x_shift);
+    const int width = rect.width();
+    const int height = rect.height();
+
+    if (frame->layout() == Frame::Layout::I420)
+    {
+        // The capturer has already converted the frame.
+        const int src_y_offset = frame->yStride() * rect.y() + rect.x();
+        const int src_uv_offset = frame->uvStride() * rect.y() / 2 + rect.x() / 2;
+
+        // The chroma of the I420 frames is only upsampled, the capturer should not be asked for
+        // them in the I444 mode.
+        auto copy_function = i444_ ? libyuv::I420ToI444 : libyuv::I420Copy;
+
+        copy_function(frame->yPlane() + src_y_offset, frame->yStride(),
+                      frame->uPlane() + src_uv_offset, frame->uvStride(),
+                      frame->vPlane() + src_uv_offset, frame->uvStride(),
+                      y_data + y_offset, y_stride,
+                      u_data + uv_offset, uv_stride,
+                      v_data + uv_offset, uv_stride,
+                      width,
+                      height);
+    }
+    else
+    {
+        auto convert_function = i444_ ? libyuv::ARGBToI444 : libyuv::ARGBToI420;
+
+        convert_function(frame->frameDataAtPos(rect.topLeft()),
+                         frame->stride(),
+                         y_data + y_offset, y_stride,
+                         u_data + uv_offset, uv_stride,
+                         v_data + uv_offset, uv_stride,
+                         width,
+                         height);
+    }
+}
+
+vpx_enc_frame_flags_t VideoEncoderVPX::updateReferences(bool is_key_frame)
+{
+    ++frame_number_;
+
+    if (is_key_frame)
+    {
+        // The key frame refreshes all buffers.
+        computeBlockHashes(&block_hashes_);
+
+        for (auto& reference : references_)
+        {
+            reference.block_hashes = block_hashes_;
+            reference.last_used = frame_number_;
+        }
+
+        current_reference_ = 0;
+        frames_since_refresh_ = 0;
+        return VPX_EFLAG_FORCE_KF;
+    }
+
+    const size_t block_count = active_map_buffer_.size();
+    const size_t active_count = active_blocks_.count();
+
+    int reference_index = current_reference_;
+    int refresh_index = -1;
+
+    if (active_count && active_count * kSwitchAreaDivider >= block_count)
+    {
+        computeBlockHashes(&block_hashes_);
+
+        int best_index = -1;
+        size_t best_matches = 0;
+
+        for (int i = 0; i < kReferenceCount; ++i)
+        {
+            if (i == current_reference_)
+                continue;
+
+            const std::vector<uint32_t>& hashes = references_[i].block_hashes;
+            size_t matches = 0;
+
+            for (size_t j = 0; j < block_count; ++j)
+            {
+                if (active_map_.active_map[j] && hashes[j] == block_hashes_[j])
+                    ++matches;
+            }
+
+            if (matches > best_matches)
+            {
+                best_index = i;
+                best_matches = matches;
+            }
+        }
+
+        if (best_index != -1 && best_matches * 2 >= active_count)
+        {
+            // The screen is switched back to a known state.
+            current_reference_ = best_index;
+            reference_index = best_index;
+        }
+        else
+        {
+            // A new state replaces the least recently used one. The frame is predicted only from
+            // the previous frame.
+            int oldest_index = -1;
+
+            for (int i = 0; i < kReferenceCount; ++i)
+            {
+                if (i != current_reference_ &&
+                    (oldest_index == -1 ||
+                     references_[i].last_used < references_[oldest_index].last_used))
+                {
+                    oldest_index = i;
+                }
+            }
+
+            current_reference_ = oldest_index;
+            reference_index = -1;
+            refresh_index = oldest_index;
+        }
+    }
+    else if (active_count && ++frames_since_refresh_ >= kReferenceRefreshInterval)
     {
-        Rect rect = it.rect();
+        computeBlockHashes(&block_hashes_);
+        refresh_index = current_reference_;
+    }
+
+    references_[current_reference_].last_used = frame_number_;
 
-        const int y_offset = y_stride * rect.y() + rect.x();
-        const int uv_offset = uv_stride * rect.y() / 2 + rect.x() / 2;
-        const int width = rect.width();
-        const int height = rect.height();
+    vpx_enc_frame_flags_t flags = 0;
 
-        libyuv::ARGBToI420(frame->frameDataAtPos(rect.topLeft()),
-                           frame->stride(),
-                           y_data + y_offset, y_stride,
-                           u_data + uv_offset, uv_stride,
-                           v_data + uv_offset, uv_stride,
-                           width,
-                           height);
+    for (int i = 0; i < kReferenceCount; ++i)
+    {
+        if (i != reference_index)
+            flags |= kReferenceFlags[i].no_ref;
 
-        addRectToActiveMap(rect);
+        if (i == refresh_index)
+            flags |= kReferenceFlags[i].force_update;
+        else
+            flags |= kReferenceFlags[i].no_update;
+    }
 
-        proto::Rect* dirty_rect = packet->add_dirty_rect();
-        dirty_rect->set_x(rect.x());
-        dirty_rect->set_y(rect.y());
-        dirty_rect->set_width(width);
-        dirty_rect->set_height(height);
+    if (refresh_index != -1)
+    {
+        references_[refresh_index].block_hashes = block_hashes_;
+        frames_since_refresh_ = 0;
     }
+
+    return flags;
 }
 
-void VideoEncoderVPX::addRectToActiveMap(const Rect& rect)
+void VideoEncoderVPX::computeBlockHashes(std::vector<uint32_t>* hashes) const
 {
-    int left = rect.left() / kMacroBlockSize;
-    int top = rect.top() / kMacroBlockSize;
-    int right = (rect.right() - 1) / kMacroBlockSize;
-    int bottom = (rect.bottom() - 1) / kMacroBlockSize;
+    const unsigned int cols = active_map_.cols;
+    const unsigned int rows = active_map_.rows;
+    const int stride = image_->stride[0];
 
-    uint8_t* map = active_map_.active_map + static_cast<uint32_t>(top) * active_map_.cols;
+    hashes->resize(static_cast<size_t>(cols) * rows);
+    uint32_t* hash = hashes->data();
 
-    for (int y = top; y <= bottom; ++y)
+    for (unsigned int y = 0; y < rows; ++y)
     {
-        for (int x = left; x <= right; ++x)
-            map[x] = 1;
+        const uint8_t* row = image_->planes[0] + y * kMacroBlockSize * stride;
 
-        map += active_map_.cols;
+        for (unsigned int x = 0; x < cols; ++x)
+            *hash++ = blockHash(row + x * kMacroBlockSize, stride);
     }
 }
 
-void VideoEncoderVPX::clearActiveMap()
+WorkerPool* VideoEncoderVPX::workerPool(int64_t area)
 {
-    memset(active_map_buffer_.data(), 0, active_map_buffer_.size());
+    if (area < kMinThreadedArea)
+        return nullptr;
+
+    if (!worker_pool_)
+    {
+        const int thread_count = std::clamp(
+            static_cast<int>(std::thread::hardware_concurrency()), 1, kMaxConvertThreadCount);
+        if (thread_count < 2)
+            return nullptr;
+
+        LOG(LS_INFO) << "Conversion threads: " << thread_count;
+        worker_pool_ = std::make_unique<WorkerPool>(thread_count);
+    }
+
+    return worker_pool_.get();
+}
+
+void VideoEncoderVPX::createRoiMap(const Size& size)
+{
+    const size_t block_count = active_map_buffer_.size();
+
+    // The content of the new frame is unknown, so it is neither static nor recently changed.
+    block_age_.resize(block_count);
+    memset(block_age_.data(), kRecentBlockAge, block_age_.size());
+    block_heat_.resize(block_count);
+    memset(block_heat_.data(), 0, block_heat_.size());
+
+    roi_map_.cols = static_cast<unsigned int>(
+        (size.width() + kVp9RoiBlockSize - 1) / kVp9RoiBlockSize);
+    roi_map_.rows = static_cast<unsigned int>(
+        (size.height() + kVp9RoiBlockSize - 1) / kVp9RoiBlockSize);
+
+    roi_map_buffer_.resize(roi_map_.cols * roi_map_.rows);
+    roi_map_.roi_map = roi_map_buffer_.data();
+
+    for (int i = 0; i < 8; ++i)
+        roi_map_.ref_frame[i] = -1;
+
+    // The codec is created again with the map, so the map is not applied.
+    roi_enabled_ = false;
+}
+
+void VideoEncoderVPX::updateRoiMap(bool is_key_frame)
+{
+    if (!roi_supported_)
+        return;
+
+    const unsigned int cols = active_map_.cols;
+    const unsigned int rows = active_map_.rows;
+
+    // The active map of a key frame contains all blocks, so it does not tell what was changed.
+    for (size_t i = 0; i < block_age_.size(); ++i)
+    {
+        int heat = block_heat_[i];
+        heat -= heat / 8;
+
+        if (!is_key_frame && active_map_.active_map[i])
+        {
+            block_age_[i] = 0;
+            heat = std::min(heat + kHeatStep, 255);
+        }
+        else if (block_age_[i] < kStaticBlockAge)
+        {
+            ++block_age_[i];
+        }
+
+        block_heat_[i] = static_cast<uint8_t>(heat);
+    }
+
+    const int cursor_left = (cursor_position_.x() - kCursorRoiRadius) / kMacroBlockSize;
+    const int cursor_top = (cursor_position_.y() - kCursorRoiRadius) / kMacroBlockSize;
+    const int cursor_right = (cursor_position_.x() + kCursorRoiRadius) / kMacroBlockSize;
+    const int cursor_bottom = (cursor_position_.y() + kCursorRoiRadius) / kMacroBlockSize;
+    const bool has_cursor = cursor_position_.x() >= 0 && cursor_position_.y() >= 0 &&
+        cursor_position_.x() < static_cast<int>(image_->w) &&
+        cursor_position_.y() < static_cast<int>(image_->h);
+
+    bool has_interest = false;
+
+    // Each macroblock covers 2x2 blocks of the map.
+    for (unsigned int y = 0; y < roi_map_.rows; ++y)
+    {
+        const unsigned int block_y = std::min(y / 2, rows - 1);
+        uint8_t* map = roi_map_.roi_map + y * roi_map_.cols;
+
+        for (unsigned int x = 0; x < roi_map_.cols; ++x)
+        {
+            const unsigned int block_x = std::min(x / 2, cols - 1);
+            const size_t index = block_y * cols + block_x;
+
+            const bool near_cursor = has_cursor &&
+                static_cast<int>(block_x) >= cursor_left &&
+                static_cast<int>(block_x) <= cursor_right &&
+                static_cast<int>(block_y) >= cursor_top &&
+                static_cast<int>(block_y) <= cursor_bottom;
+
+            uint8_t segment = kRoiSegmentNormal;
+
+            if (near_cursor ||
+                (block_age_[index] < kRecentBlockAge && block_heat_[index] < kVideoBlockHeat))
+            {
+                segment = kRoiSegmentInterest;
+                has_interest = true;
+            }
+            else if (block_age_[index] >= kStaticBlockAge)
+            {
+                segment = kRoiSegmentStatic;
+            }
+
+            map[x] = segment;
+        }
+    }
+
+    // The segments replace the cyclic refresh of the encoder, so they are used only while there
+    // are blocks of interest. The map without deltas disables them.
+    if (!has_interest && !roi_enabled_)
+        return;
+
+    roi_map_.delta_q[kRoiSegmentInterest] = has_interest ? kRoiInterestDeltaQ : 0;
+    roi_map_.delta_q[kRoiSegmentStatic] = has_interest ? kRoiStaticDeltaQ : 0;
+
+    vpx_codec_err_t ret = vpx_codec_control(codec_.get(), VP9E_SET_ROI_MAP, &roi_map_);
+    if (ret != VPX_CODEC_OK)
+    {
+        LOG(LS_WARNING) << "vpx_codec_control(VP9E_SET_ROI_MAP) failed: " << ret
+                        << ". Regions of interest disabled";
+        roi_supported_ = false;
+        return;
+    }
+
+    roi_enabled_ = has_interest;
 }
 
 } // namespace base
@@ -20,8 +20,10 @@
 #define BASE_CODEC_VIDEO_ENCODER_VPX_H
 
 #include "base/macros_magic.h"
+#include "base/codec/content_classifier.h"
 #include "base/codec/scoped_vpx_codec.h"
 #include "base/codec/video_encoder.h"
+#include "base/desktop/block_region.h"
 #include "base/desktop/region.h"
 #include "base/memory/byte_array.h"
 
@@ -31,30 +33,72 @@
 
 namespace base {
 
+class VideoEncoderZstd;
+class WorkerPool;
+
 class VideoEncoderVPX : public VideoEncoder
 {
 public:
-    ~VideoEncoderVPX() override = default;
+    ~VideoEncoderVPX() override;
+
+    // Number of the long-term reference buffers (golden and altref).
+    static const int kReferenceCount = 2;
 
     static std::unique_ptr<VideoEncoderVPX> createVP8();
     static std::unique_ptr<VideoEncoderVPX> createVP9();
 
     bool encode(const Frame* frame, proto::VideoPacket* packet) override;
+    size_t memoryUsage() const override;
 
     bool setMinQuantizer(uint32_t min_quantizer);
     uint32_t minQuantizer() const;
     bool setMaxQuantizer(uint32_t max_quantizer);
     uint32_t maxQuantizer() const;
 
+    // Target bitrate of the encoder in kilobits per second. Can be called before the first frame.
+    bool setTargetBitrate(uint32_t kbps);
+    uint32_t targetBitrate() const { return target_bitrate_; }
+
+    // VP9 only. Splits the frames into tile columns, so that the client can decode them in
+    // parallel. Must be called before the first frame.
+    void setTileColumnsEnabled(bool enable) { tile_columns_enabled_ = enable; }
+
+    // VP9 only. If set, the blocks of text and user interface of the packed frames are encoded
+    // losslessly by |encoder| into VideoPacket::lossless_packet and only the other blocks are
+    // encoded by VP9. The decoder on the other side must support hybrid encoding.
+    void setLosslessEncoder(std::unique_ptr<VideoEncoderZstd> encoder);
+
+    // VP9 only. If set, the chroma is encoded in the full resolution (I444, profile 1), so that
+    // colored text stays readable. The decoder must support VP9 profile 1. Must be called before
+    // the first frame.
+    void setI444Mode(bool enable);
+
+    // VP9 only. If disabled, the encoder is tuned for natural content (video) instead of the
+    // screen content. Must be called before the first frame.
+    void setScreenContentMode(bool enable) { screen_content_mode_ = enable; }
+
+    // VP9 only. The blocks around |position| get a better quality. The position is in the
+    // coordinates of the frame, the position outside the frame means that it is not known.
+    void setCursorPosition(const Point& position) { cursor_position_ = position; }
+
 private:
     explicit VideoEncoderVPX(proto::VideoEncoding encoding);
 
     void createActiveMap(const Size& size);
     bool createVp8Codec(const Size& size);
     bool createVp9Codec(const Size& size);
-    void prepareImageAndActiveMap(bool is_key_frame, const Frame* frame, proto::VideoPacket* packet);
-    void addRectToActiveMap(const Rect& rect);
-    void clearActiveMap();
+    bool encodeLosslessBlocks(
+        bool is_key_frame, const Frame* frame, Region* video_region, proto::VideoPacket* packet);
+    void prepareImageAndActiveMap(bool is_key_frame, const Frame* frame,
+                                  const Region& frame_region, proto::VideoPacket* packet);
+    void convertRect(const Frame* frame, const Rect& rect);
+    WorkerPool* workerPool(int64_t area);
+    void createRoiMap(const Size& size);
+    void updateRoiMap(bool is_key_frame);
+
+    // Chooses the long-term references for the frame and returns the flags for the encoder.
+    vpx_enc_frame_flags_t updateReferences(bool is_key_frame);
+    void computeBlockHashes(std::vector<uint32_t>* hashes) const;
 
     vpx_codec_enc_cfg_t config_;
     ScopedVpxCodec codec_;
@@ -62,10 +106,52 @@ private:
     ByteArray active_map_buffer_;
     vpx_active_map_t active_map_;
 
-    // VPX image and buffer to hold the actual YUV planes.
+    // The macroblocks of the active map are collected as bits and then expanded to its bytes.
+    BlockRegion active_blocks_;
+
+    // VPX image and buffer to hold the actual YUV planes. The buffer is kept when the resolution
+    // changes.
     std::unique_ptr<vpx_image_t> image_;
     ByteArray image_buffer_;
 
+    // Bands of the updated region, which are converted to YUV in parallel.
+    std::vector<Rect> bands_;
+    std::unique_ptr<WorkerPool> worker_pool_;
+
+    bool tile_columns_enabled_ = false;
+    bool screen_content_mode_ = true;
+    bool i444_ = false;
+
+    // VP9 only. The history of the updates of each macroblock and the map of the segments with
+    // their own quantizers, which is built from it for each frame.
+    ByteArray block_age_;
+    ByteArray block_heat_;
+    ByteArray roi_map_buffer_;
+    vpx_roi_map_t roi_map_;
+    bool roi_enabled_ = false;
+    bool roi_supported_ = true;
+    Point cursor_position_ { -1, -1 };
+
+    // The states of the screen in the golden and altref buffers, as hashes of the macroblocks of
+    // the luma plane.
+    struct ReferenceState
+    {
+        std::vector<uint32_t> block_hashes;
+        int64_t last_used = 0;
+    };
+
+    ReferenceState references_[kReferenceCount];
+    std::vector<uint32_t> block_hashes_;
+    int current_reference_ = 0;
+    size_t frames_since_refresh_ = 0;
+    int64_t frame_number_ = 0;
+
+    std::unique_ptr<VideoEncoderZstd> lossless_encoder_;
+    ContentClassifier classifier_;
+
+    // Conservative default until the bitrate is set from a bandwidth estimate.
+    uint32_t target_bitrate_ = 1000;
+
     DISALLOW_COPY_AND_ASSIGN(VideoEncoderVPX);
 };
 
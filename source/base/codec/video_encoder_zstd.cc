@@ -18,21 +18,31 @@
 
 #include "base/codec/video_encoder_zstd.h"
 
+#include "base/endian_util.h"
 #include "base/logging.h"
+#include "base/codec/palette_codec.h"
 #include "base/codec/pixel_translator.h"
-#include "base/desktop/frame.h"
+#include "base/desktop/frame_simple.h"
+#include "base/threading/worker_pool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
 
 namespace base {
 
 namespace {
 
-// Retrieves a pointer to the output buffer in |update| used for storing the
-// encoded rectangle data. Will resize the buffer to |size|.
-uint8_t* outputBuffer(proto::VideoPacket* packet, size_t size)
-{
-    packet->mutable_data()->resize(size);
-    return reinterpret_cast<uint8_t*>(packet->mutable_data()->data());
-}
+// Minimum size of the translated data in one slice. Smaller slices compress worse and the
+// synchronization overhead becomes noticeable.
+const size_t kMinSliceSize = 256 * 1024;
+
+// Maximum number of slices (and threads) for one frame.
+const int kMaxSliceCount = 8;
+
+// Window size for the stream mode (64 MB). It holds about two 4K frames in 32bpp and does not
+// exceed the default window limit of the decoder (128 MB).
+const int kStreamWindowLog = 26;
 
 void serializePixelFormat(const PixelFormat& from, proto::PixelFormat* to)
 {
@@ -47,6 +57,9 @@ void serializePixelFormat(const PixelFormat& from, proto::PixelFormat* to)
     to->set_blue_shift(from.blueShift());
 }
 
+// Smaller updates are not searched for moved content.
+const int kMinCopyRectUpdateHeight = 64;
+
 void serializeRect(const Rect& from, proto::Rect* to)
 {
     to->set_x(from.x());
@@ -68,6 +81,32 @@ VideoEncoderZstd::VideoEncoderZstd(const PixelFormat& target_format, int compres
 
 VideoEncoderZstd::~VideoEncoderZstd() = default;
 
+void VideoEncoderZstd::setSliceEncoding(bool enable)
+{
+    LOG(LS_INFO) << "Slice encoding: " << enable;
+    slice_encoding_ = enable;
+}
+
+void VideoEncoderZstd::setStreamMode(bool enable)
+{
+    LOG(LS_INFO) << "Stream mode: " << enable;
+    stream_mode_ = enable;
+    stream_started_ = false;
+}
+
+void VideoEncoderZstd::setPaletteCoding(bool enable)
+{
+    LOG(LS_INFO) << "Palette coding: " << enable;
+    palette_coding_ = enable;
+}
+
+void VideoEncoderZstd::setCopyRects(bool enable)
+{
+    LOG(LS_INFO) << "Copy rects: " << enable;
+    copy_rects_ = enable;
+    previous_frame_.reset();
+}
+
 // static
 std::unique_ptr<VideoEncoderZstd> VideoEncoderZstd::create(
     const PixelFormat& target_format, int compression_ratio)
@@ -85,7 +124,15 @@ bool VideoEncoderZstd::compressPacket(proto::VideoPacket* packet,
                                       const uint8_t* input_data,
                                       size_t input_size)
 {
-    size_t ret = ZSTD_initCStream(stream_.get(), compress_ratio_);
+    return compressData(stream_.get(), input_data, input_size, packet->mutable_data());
+}
+
+bool VideoEncoderZstd::compressData(ZSTD_CStream* stream,
+                                    const uint8_t* input_data,
+                                    size_t input_size,
+                                    std::string* output_buffer)
+{
+    size_t ret = ZSTD_initCStream(stream, compress_ratio_);
     if (ZSTD_isError(ret))
     {
         LOG(LS_ERROR) << "ZSTD_initCStream failed: " << ZSTD_getErrorName(ret);
@@ -93,14 +140,14 @@ bool VideoEncoderZstd::compressPacket(proto::VideoPacket* packet,
     }
 
     const size_t output_size = ZSTD_compressBound(input_size);
-    uint8_t* output_data = outputBuffer(packet, output_size);
+    output_buffer->resize(output_size);
 
     ZSTD_inBuffer input = { input_data, input_size, 0 };
-    ZSTD_outBuffer output = { output_data, output_size, 0 };
+    ZSTD_outBuffer output = { output_buffer->data(), output_size, 0 };
 
     while (input.pos < input.size)
     {
-        ret = ZSTD_compressStream(stream_.get(), &output, &input);
+        ret = ZSTD_compressStream(stream, &output, &input);
         if (ZSTD_isError(ret))
         {
             LOG(LS_ERROR) << "ZSTD_compressStream failed: " << ZSTD_getErrorName(ret);
@@ -108,27 +155,343 @@ bool VideoEncoderZstd::compressPacket(proto::VideoPacket* packet,
         }
     }
 
-    ret = ZSTD_endStream(stream_.get(), &output);
+    ret = ZSTD_endStream(stream, &output);
     if (ZSTD_isError(ret))
     {
         LOG(LS_ERROR) << "ZSTD_endStream failed: " << ZSTD_getErrorName(ret);
         return false;
     }
 
-    packet->mutable_data()->resize(output.pos);
+    output_buffer->resize(output.pos);
     return true;
 }
 
+bool VideoEncoderZstd::compressStream(proto::VideoPacket* packet,
+                                      const uint8_t* input_data,
+                                      size_t input_size)
+{
+    ZSTD_CStream* stream = stream_.get();
+    size_t ret;
+
+    if (!stream_started_)
+    {
+        ZSTD_CCtx_reset(stream, ZSTD_reset_session_and_parameters);
+
+        ret = ZSTD_CCtx_setParameter(stream, ZSTD_c_compressionLevel, compress_ratio_);
+        if (!ZSTD_isError(ret))
+            ret = ZSTD_CCtx_setParameter(stream, ZSTD_c_windowLog, kStreamWindowLog);
+        if (!ZSTD_isError(ret))
+            ret = ZSTD_CCtx_setParameter(stream, ZSTD_c_enableLongDistanceMatching, 1);
+
+        if (ZSTD_isError(ret))
+        {
+            LOG(LS_ERROR) << "ZSTD_CCtx_setParameter failed: " << ZSTD_getErrorName(ret);
+            return false;
+        }
+    }
+
+    std::string* output_buffer = packet->mutable_data();
+
+    const size_t output_size = ZSTD_compressBound(input_size);
+    output_buffer->resize(output_size);
+
+    ZSTD_inBuffer input = { input_data, input_size, 0 };
+    ZSTD_outBuffer output = { output_buffer->data(), output_size, 0 };
+
+    // The data is flushed, so the decoder can restore the frame from this packet. The context and
+    // the window are kept for the next packet.
+    do
+    {
+        ret = ZSTD_compressStream2(stream, &output, &input, ZSTD_e_flush);
+        if (ZSTD_isError(ret))
+        {
+            LOG(LS_ERROR) << "ZSTD_compressStream2 failed: " << ZSTD_getErrorName(ret);
+            stream_started_ = false;
+            return false;
+        }
+
+        if (ret && output.pos == output.size)
+        {
+            output_buffer->resize(output.size * 2);
+            output.dst = output_buffer->data();
+            output.size = output_buffer->size();
+        }
+    }
+    while (ret != 0);
+
+    output_buffer->resize(output.pos);
+
+    packet->set_continues_stream(stream_started_);
+    stream_started_ = true;
+    return true;
+}
+
+void VideoEncoderZstd::detectCopyRect(
+    const Frame* frame, bool is_key_frame, proto::VideoPacket* packet)
+{
+    // The previous frame must be equal to the frame of the decoder, so it is created with the key
+    // frame that updates it entirely.
+    if (!previous_frame_ || previous_frame_->size() != frame->size())
+    {
+        if (!is_key_frame)
+            return;
+
+        previous_frame_ = FrameSimple::create(frame->size(), PixelFormat::ARGB());
+    }
+
+    const Region changed_region = updated_region_;
+
+    if (!is_key_frame)
+    {
+        Rect bounds;
+        for (Region::Iterator it(updated_region_); !it.isAtEnd(); it.advance())
+            bounds.unionWith(it.rect());
+
+        Rect source_rect;
+        Point dest_pos;
+
+        if (bounds.height() >= kMinCopyRectUpdateHeight &&
+            scroll_detector_.detect(*previous_frame_, *frame, bounds, &source_rect, &dest_pos))
+        {
+            proto::VideoCopyRect* copy_rect = packet->add_copy_rect();
+            serializeRect(source_rect, copy_rect->mutable_source_rect());
+            copy_rect->set_dest_x(dest_pos.x());
+            copy_rect->set_dest_y(dest_pos.y());
+
+            // The rows of the destination match the current frame entirely.
+            updated_region_.subtract(Rect::makeXYWH(dest_pos, source_rect.size()));
+        }
+    }
+
+    for (Region::Iterator it(changed_region); !it.isAtEnd(); it.advance())
+        previous_frame_->copyPixelsFrom(*frame, it.rect().topLeft(), it.rect());
+}
+
+void VideoEncoderZstd::translateRects(
+    const Frame* frame, int first_rect, int rect_count, uint8_t* output)
+{
+    for (int i = first_rect; i < first_rect + rect_count; ++i)
+    {
+        const Rect& rect = rects_[static_cast<size_t>(i)];
+        const int stride = rect.width() * target_format_.bytesPerPixel();
+
+        translator_->translate(frame->frameDataAtPos(rect.topLeft()),
+                               frame->stride(),
+                               output,
+                               stride,
+                               rect.width(),
+                               rect.height());
+
+        output += rect.height() * stride;
+    }
+}
+
+size_t VideoEncoderZstd::paletteCodeRects(
+    int first_rect, int rect_count, const uint8_t* input, uint8_t* output)
+{
+    const int bytes_per_pixel = target_format_.bytesPerPixel();
+    uint8_t* out = output;
+
+    // Each rectangle is preceded by the size of its coded data, so the decoder can read it from the
+    // compression stream exactly.
+    for (int i = first_rect; i < first_rect + rect_count; ++i)
+    {
+        const Rect& rect = rects_[static_cast<size_t>(i)];
+        const int stride = rect.width() * bytes_per_pixel;
+
+        const uint32_t coded_size = static_cast<uint32_t>(PaletteCodec::encode(
+            input, stride, rect.size(), bytes_per_pixel, out + sizeof(uint32_t)));
+
+        const uint32_t size_value = EndianUtil::toLittle(coded_size);
+        memcpy(out, &size_value, sizeof(size_value));
+
+        out += sizeof(uint32_t) + coded_size;
+        input += rect.height() * stride;
+    }
+
+    return static_cast<size_t>(out - output);
+}
+
+size_t VideoEncoderZstd::maxPaletteCodedSize(int first_rect, int rect_count) const
+{
+    size_t size = 0;
+
+    for (int i = first_rect; i < first_rect + rect_count; ++i)
+    {
+        size += sizeof(uint32_t) + PaletteCodec::maxEncodedSize(
+            rects_[static_cast<size_t>(i)].size(), target_format_.bytesPerPixel());
+    }
+
+    return size;
+}
+
+int VideoEncoderZstd::prepareSlices(size_t data_size)
+{
+    if (!slice_encoding_ || data_size < kMinSliceSize * 2)
+        return 1;
+
+    if (!worker_pool_)
+    {
+        const int thread_count = std::clamp(
+            static_cast<int>(std::thread::hardware_concurrency()), 1, kMaxSliceCount);
+        if (thread_count < 2)
+        {
+            LOG(LS_INFO) << "Single core system. Slice encoding disabled";
+            slice_encoding_ = false;
+            return 1;
+        }
+
+        LOG(LS_INFO) << "Slice encoding threads: " << thread_count;
+
+        worker_pool_ = std::make_unique<WorkerPool>(thread_count);
+        for (int i = 0; i < thread_count; ++i)
+            slice_streams_.emplace_back(ZSTD_createCStream());
+    }
+
+    const int slice_count = static_cast<int>(std::min(
+        static_cast<size_t>(worker_pool_->threadCount()), data_size / kMinSliceSize));
+    const size_t slice_size = (data_size + static_cast<size_t>(slice_count) - 1) /
+        static_cast<size_t>(slice_count);
+    const int bytes_per_pixel = target_format_.bytesPerPixel();
+
+    // A single rectangle (for example, the entire screen) is split into bands, so it can be
+    // spread over several slices.
+    std::vector<Rect> bands;
+
+    for (const auto& rect : rects_)
+    {
+        const size_t row_size = static_cast<size_t>(rect.width() * bytes_per_pixel);
+        const int band_height = std::max(static_cast<int>(slice_size / row_size), 1);
+
+        for (int y = rect.top(); y < rect.bottom(); y += band_height)
+        {
+            bands.emplace_back(Rect::makeLTRB(
+                rect.left(), y, rect.right(), std::min(y + band_height, rect.bottom())));
+        }
+    }
+
+    rects_.swap(bands);
+    slices_.clear();
+
+    Slice slice;
+    size_t offset = 0;
+
+    for (size_t i = 0; i < rects_.size(); ++i)
+    {
+        const Rect& rect = rects_[i];
+        const size_t size = static_cast<size_t>(rect.width() * rect.height() * bytes_per_pixel);
+
+        if (slice.rect_count && slice.input_size + size > slice_size &&
+            static_cast<int>(slices_.size()) + 1 < slice_count)
+        {
+            slices_.emplace_back(slice);
+
+            slice = Slice();
+            slice.first_rect = static_cast<int>(i);
+            slice.input_offset = offset;
+        }
+
+        ++slice.rect_count;
+        slice.input_size += size;
+        offset += size;
+    }
+
+    slices_.emplace_back(slice);
+    return static_cast<int>(slices_.size());
+}
+
+bool VideoEncoderZstd::encodeSlices(const Frame* frame, int slice_count, proto::VideoPacket* packet)
+{
+    for (int i = 0; i < slice_count; ++i)
+    {
+        const Slice& slice = slices_[static_cast<size_t>(i)];
+
+        packet->add_slice_data();
+        packet->add_slice_rect_count(static_cast<uint32_t>(slice.rect_count));
+    }
+
+    if (palette_coding_)
+    {
+        size_t coded_offset = 0;
+
+        for (auto& slice : slices_)
+        {
+            slice.coded_offset = coded_offset;
+            coded_offset += maxPaletteCodedSize(slice.first_rect, slice.rect_count);
+        }
+    }
+
+    std::vector<uint8_t> results(static_cast<size_t>(slice_count), 0);
+    const int thread_count = worker_pool_->threadCount();
+    uint8_t* translate_buffer = translate_buffer_.get();
+    uint8_t* palette_buffer = palette_buffer_.get();
+
+    // Each slice has its own part of the translate buffer and its own output string. Each thread
+    // has its own compression stream.
+    worker_pool_->run([&](int index)
+    {
+        ZSTD_CStream* stream = slice_streams_[static_cast<size_t>(index)].get();
+
+        for (int i = index; i < slice_count; i += thread_count)
+        {
+            const Slice& slice = slices_[static_cast<size_t>(i)];
+            uint8_t* input = translate_buffer + slice.input_offset;
+
+            translateRects(frame, slice.first_rect, slice.rect_count, input);
+
+            size_t input_size = slice.input_size;
+
+            if (palette_coding_)
+            {
+                uint8_t* coded = palette_buffer + slice.coded_offset;
+                input_size = paletteCodeRects(slice.first_rect, slice.rect_count, input, coded);
+                input = coded;
+            }
+
+            results[static_cast<size_t>(i)] = compressData(
+                stream, input, input_size, packet->mutable_slice_data(i));
+        }
+    });
+
+    return std::all_of(results.begin(), results.end(), [](uint8_t result) { return result != 0; });
+}
+
+size_t VideoEncoderZstd::memoryUsage() const
+{
+    size_t usage = translate_buffer_size_ + palette_buffer_size_;
+
+    if (stream_)
+        usage += ZSTD_sizeof_CStream(stream_.get());
+
+    for (const ScopedZstdCStream& stream : slice_streams_)
+        usage += ZSTD_sizeof_CStream(stream.get());
+
+    if (previous_frame_)
+        usage += previous_frame_->memorySize();
+
+    return usage;
+}
+
 bool VideoEncoderZstd::encode(const Frame* frame, proto::VideoPacket* packet)
 {
     fillPacketInfo(frame, packet);
 
+    const bool is_key_frame = packet->has_format() || isKeyFrameRequired();
+
+    // The decoder starts a new stream with a key frame.
+    if (is_key_frame)
+        stream_started_ = false;
+
     if (packet->has_format())
     {
         LOG(LS_INFO) << "Has packet format";
 
         serializePixelFormat(target_format_, packet->mutable_format()->mutable_pixel_format());
-        updated_region_ = Region(Rect::makeSize(frame->size()));
+
+        if (overlay_mode_)
+            updated_region_ = frame->constUpdatedRegion();
+        else
+            updated_region_ = Region(Rect::makeSize(frame->size()));
     }
     else
     {
@@ -154,15 +517,23 @@ bool VideoEncoderZstd::encode(const Frame* frame, proto::VideoPacket* packet)
         }
     }
 
+    if (copy_rects_)
+        detectCopyRect(frame, is_key_frame, packet);
+
     size_t data_size = 0;
+    rects_.clear();
 
     for (Region::Iterator it(updated_region_); !it.isAtEnd(); it.advance())
     {
         const Rect& rect = it.rect();
         data_size += static_cast<size_t>(rect.width() * rect.height() * target_format_.bytesPerPixel());
-        serializeRect(rect, packet->add_dirty_rect());
+        rects_.emplace_back(rect);
     }
 
+    const int slice_count = stream_mode_ ? 1 : prepareSlices(data_size);
+
+    setDirtyRects(rects_, packet);
+
     if (translate_buffer_size_ < data_size)
     {
         LOG(LS_INFO) << "Translate buffer too small. Resize from " << translate_buffer_size_
@@ -172,30 +543,53 @@ bool VideoEncoderZstd::encode(const Frame* frame, proto::VideoPacket* packet)
         translate_buffer_size_ = data_size;
     }
 
-    uint8_t* translate_pos = translate_buffer_.get();
-
-    for (Region::Iterator it(updated_region_); !it.isAtEnd(); it.advance())
+    if (palette_coding_)
     {
-        const Rect& rect = it.rect();
-        const int stride = rect.width() * target_format_.bytesPerPixel();
+        const size_t coded_size = maxPaletteCodedSize(0, static_cast<int>(rects_.size()));
 
-        translator_->translate(frame->frameDataAtPos(rect.topLeft()),
-                               frame->stride(),
-                               translate_pos,
-                               stride,
-                               rect.width(),
-                               rect.height());
+        if (palette_buffer_size_ < coded_size)
+        {
+            palette_buffer_.reset(static_cast<uint8_t*>(base::alignedAlloc(coded_size, 32)));
+            palette_buffer_size_ = coded_size;
+        }
 
-        translate_pos += rect.height() * stride;
+        packet->set_palette_coding(true);
     }
 
-    // Compress data with using Zstd compressor.
-    if (!compressPacket(packet, translate_buffer_.get(), data_size))
+    if (slice_count > 1)
     {
-        LOG(LS_ERROR) << "compressPacket failed";
-        return false;
+        if (!encodeSlices(frame, slice_count, packet))
+        {
+            LOG(LS_ERROR) << "encodeSlices failed";
+            return false;
+        }
     }
+    else
+    {
+        translateRects(frame, 0, static_cast<int>(rects_.size()), translate_buffer_.get());
+
+        const uint8_t* input_data = translate_buffer_.get();
+        size_t input_size = data_size;
+
+        if (palette_coding_)
+        {
+            input_size = paletteCodeRects(0, static_cast<int>(rects_.size()), input_data,
+                                          palette_buffer_.get());
+            input_data = palette_buffer_.get();
+        }
 
+        // Compress data with using Zstd compressor.
+        const bool result = stream_mode_ ?
+            compressStream(packet, input_data, input_size) :
+            compressPacket(packet, input_data, input_size);
+        if (!result)
+        {
+            LOG(LS_ERROR) << "Compression failed";
+            return false;
+        }
+    }
+
+    packet->set_key_frame(is_key_frame);
     setKeyFrameRequired(false);
 
     return true;
@@ -210,6 +604,9 @@ bool VideoEncoderZstd::setCompressRatio(int compression_ratio)
     }
 
     compress_ratio_ = compression_ratio;
+
+    // The compression level is applied when the stream starts.
+    stream_started_ = false;
     return true;
 }
 
@@ -25,10 +25,14 @@
 #include "base/codec/video_encoder.h"
 #include "base/desktop/region.h"
 #include "base/desktop/pixel_format.h"
+#include "base/desktop/scroll_detector.h"
+
+#include <vector>
 
 namespace base {
 
 class PixelTranslator;
+class WorkerPool;
 
 class VideoEncoderZstd : public VideoEncoder
 {
@@ -39,15 +43,63 @@ public:
         const PixelFormat& target_format, int compression_ratio);
 
     bool encode(const Frame* frame, proto::VideoPacket* packet) override;
+    size_t memoryUsage() const override;
 
     bool setCompressRatio(int compression_ratio);
     int compressRatio() const;
 
+    // If enabled, large updates are split into slices that are translated and compressed in
+    // parallel. The decoder on the other side must support VideoPacket::slice_data.
+    void setSliceEncoding(bool enable);
+
+    // If enabled, the compression context is kept between frames (the stream is flushed instead
+    // of ended) and long distance matching is used, so repeated content of the previous frames is
+    // referenced instead of being compressed again. The stream is restarted on key frames. Slices
+    // are not used in this mode, because each of them would need its own persistent context.
+    // The decoder on the other side must support VideoPacket::continues_stream.
+    void setStreamMode(bool enable);
+
+    // If enabled, content moved vertically since the previous frame (for example, a scrolled page)
+    // is sent as VideoPacket::copy_rect instead of its pixels. The encoder keeps a copy of the
+    // previous frame for this. The decoder on the other side must support copy rectangles.
+    void setCopyRects(bool enable);
+
+    // If enabled, a packet with a new format contains only the updated region instead of the
+    // whole frame. Used when the rest of the frame is sent by another encoder.
+    void setOverlayMode(bool enable) { overlay_mode_ = enable; }
+
+    // If enabled, the translated rectangles are coded in tiles with palettes and runs (see
+    // PaletteCodec) before the compression. The decoder on the other side must support
+    // VideoPacket::palette_coding.
+    void setPaletteCoding(bool enable);
+
 private:
+    struct Slice
+    {
+        int first_rect = 0;
+        int rect_count = 0;
+        size_t input_offset = 0;
+        size_t input_size = 0;
+        size_t coded_offset = 0;
+    };
+
     VideoEncoderZstd(const PixelFormat& target_format, int compression_ratio);
     bool compressPacket(proto::VideoPacket* packet,
                         const uint8_t* input_data,
                         size_t input_size);
+    bool compressStream(proto::VideoPacket* packet,
+                        const uint8_t* input_data,
+                        size_t input_size);
+    bool compressData(ZSTD_CStream* stream,
+                      const uint8_t* input_data,
+                      size_t input_size,
+                      std::string* output_buffer);
+    void translateRects(const Frame* frame, int first_rect, int rect_count, uint8_t* output);
+    size_t paletteCodeRects(int first_rect, int rect_count, const uint8_t* input, uint8_t* output);
+    size_t maxPaletteCodedSize(int first_rect, int rect_count) const;
+    void detectCopyRect(const Frame* frame, bool is_key_frame, proto::VideoPacket* packet);
+    int prepareSlices(size_t data_size);
+    bool encodeSlices(const Frame* frame, int slice_count, proto::VideoPacket* packet);
 
     Region updated_region_;
     PixelFormat target_format_;
@@ -57,6 +109,27 @@ private:
     std::unique_ptr<uint8_t[], base::AlignedFreeDeleter> translate_buffer_;
     size_t translate_buffer_size_ = 0;
 
+    // Rectangles to encode. With slice encoding, large rectangles are split into bands.
+    std::vector<Rect> rects_;
+
+    bool slice_encoding_ = false;
+    std::unique_ptr<WorkerPool> worker_pool_;
+    std::vector<ScopedZstdCStream> slice_streams_;
+    std::vector<Slice> slices_;
+
+    bool stream_mode_ = false;
+    bool stream_started_ = false;
+
+    bool overlay_mode_ = false;
+
+    bool palette_coding_ = false;
+    std::unique_ptr<uint8_t[], base::AlignedFreeDeleter> palette_buffer_;
+    size_t palette_buffer_size_ = 0;
+
+    bool copy_rects_ = false;
+    ScrollDetector scroll_detector_;
+    std::unique_ptr<Frame> previous_frame_;
+
     DISALLOW_COPY_AND_ASSIGN(VideoEncoderZstd);
 };
 
@@ -41,10 +41,20 @@ WebmFileWriter::~WebmFileWriter()
     close();
 }
 
-void WebmFileWriter::addVideoPacket(const proto::VideoPacket& packet)
+void WebmFileWriter::addVideoPacket(const proto::VideoPacket& packet, const TimePoint& time)
 {
-    if (packet.encoding() != last_video_encoding_ || packet.has_format())
+    // The key frames without a format are sent by the host on request.
+    bool is_key_frame = packet.key_frame();
+
+    // A full file is continued in a new one from a key frame.
+    const bool rotate = !packet.has_format() && is_key_frame && muxer_ && isRotationPending() &&
+        packet.encoding() == last_video_encoding_;
+
+    if (packet.encoding() != last_video_encoding_ || packet.has_format() || rotate)
     {
+        if (rotate)
+            LOG(LS_INFO) << "Maximum file size reached (" << file_size_ << " bytes)";
+
         close();
 
         switch (packet.encoding())
@@ -60,13 +70,18 @@ void WebmFileWriter::addVideoPacket(const proto::VideoPacket& packet)
 
         last_video_encoding_ = packet.encoding();
 
-        if (!packet.has_format())
+        if (packet.has_format())
+        {
+            video_size_ = Size(packet.format().video_rect().width(),
+                               packet.format().video_rect().height());
+        }
+        else if (!rotate)
+        {
             return;
+        }
     }
 
-    bool is_key_frame = false;
-
-    if (packet.has_format())
+    if (packet.has_format() || rotate)
     {
         if (!init())
             return;
@@ -75,9 +90,7 @@ void WebmFileWriter::addVideoPacket(const proto::VideoPacket& packet)
         if (packet.encoding() == proto::VIDEO_ENCODING_VP9)
             video_codec_id = mkvmuxer::Tracks::kVp9CodecId;
 
-        if (!muxer_->addVideoTrack(packet.format().video_rect().width(),
-                                   packet.format().video_rect().height(),
-                                   video_codec_id))
+        if (!muxer_->addVideoTrack(video_size_.width(), video_size_.height(), video_codec_id))
         {
             LOG(LS_ERROR) << "WebmFileMuxer::addVideoTrack failed";
             return;
@@ -100,23 +113,23 @@ void WebmFileWriter::addVideoPacket(const proto::VideoPacket& packet)
     DCHECK(muxer_->hasVideoTrack());
     DCHECK(muxer_->hasAudioTrack());
 
-    TimePoint current = Clock::now();
     NanoSeconds timestamp;
 
     if (video_start_time_.has_value())
     {
-        timestamp = std::chrono::duration_cast<NanoSeconds>(current - *video_start_time_);
+        timestamp = std::chrono::duration_cast<NanoSeconds>(time - *video_start_time_);
     }
     else
     {
-        video_start_time_.emplace(current);
+        video_start_time_.emplace(time);
         timestamp = NanoSeconds(0);
     }
 
     muxer_->writeVideoFrame(packet.data(), timestamp, is_key_frame);
+    file_size_ += static_cast<int64_t>(packet.data().size());
 }
 
-void WebmFileWriter::addAudioPacket(const proto::AudioPacket& packet)
+void WebmFileWriter::addAudioPacket(const proto::AudioPacket& packet, const TimePoint& time)
 {
     if (packet.encoding() != proto::AUDIO_ENCODING_OPUS ||
         packet.channels() != proto::AudioPacket::CHANNELS_STEREO ||
@@ -131,24 +144,28 @@ void WebmFileWriter::addAudioPacket(const proto::AudioPacket& packet)
 
     for (int i = 0; i < packet.data_size(); ++i)
     {
-        TimePoint current = Clock::now();
         NanoSeconds timestamp;
 
         if (video_start_time_.has_value())
         {
-            timestamp = std::chrono::duration_cast<NanoSeconds>(
-                current - *video_start_time_);
+            timestamp = std::chrono::duration_cast<NanoSeconds>(time - *video_start_time_);
         }
         else
         {
-            video_start_time_.emplace(current);
+            video_start_time_.emplace(time);
             timestamp = NanoSeconds(0);
         }
 
         muxer_->writeAudioFrame(packet.data(i), timestamp);
+        file_size_ += static_cast<int64_t>(packet.data(i).size());
     }
 }
 
+bool WebmFileWriter::isRotationPending() const
+{
+    return max_file_size_ > 0 && file_size_ >= max_file_size_;
+}
+
 bool WebmFileWriter::init()
 {
     std::error_code error_code;
@@ -214,6 +231,7 @@ bool WebmFileWriter::init()
     }
 
     ++file_counter_;
+    file_size_ = 0;
     return true;
 }
 
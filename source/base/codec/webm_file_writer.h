@@ -37,11 +37,22 @@ class WebmFileMuxer;
 class WebmFileWriter
 {
 public:
+    using Clock = std::chrono::high_resolution_clock;
+    using TimePoint = std::chrono::time_point<Clock>;
+
     WebmFileWriter(const std::filesystem::path& path, std::u16string_view name);
     ~WebmFileWriter();
 
-    void addVideoPacket(const proto::VideoPacket& packet);
-    void addAudioPacket(const proto::AudioPacket& packet);
+    // |time| is the time when the packet was received. The packets can be written later.
+    void addVideoPacket(const proto::VideoPacket& packet, const TimePoint& time = Clock::now());
+    void addAudioPacket(const proto::AudioPacket& packet, const TimePoint& time = Clock::now());
+
+    // If the size of the current file exceeds |size| bytes, the recording is continued in a new
+    // file from the next key frame. Zero means no limit.
+    void setMaxFileSize(int64_t size) { max_file_size_ = size; }
+
+    // Returns true if the file is full and waits for a key frame.
+    bool isRotationPending() const;
 
 private:
     bool init();
@@ -52,8 +63,6 @@ private:
     int file_counter_ = 0;
     FILE* file_ = nullptr;
 
-    using Clock = std::chrono::high_resolution_clock;
-    using TimePoint = std::chrono::time_point<Clock>;
     using NanoSeconds = std::chrono::nanoseconds;
 
     std::unique_ptr<WebmFileMuxer> muxer_;
@@ -61,6 +70,10 @@ private:
     std::optional<TimePoint> audio_start_time_;
 
     proto::VideoEncoding last_video_encoding_ = proto::VIDEO_ENCODING_UNKNOWN;
+    Size video_size_;
+
+    int64_t max_file_size_ = 0;
+    int64_t file_size_ = 0;
 
     DISALLOW_COPY_AND_ASSIGN(WebmFileWriter);
 };
@@ -0,0 +1,226 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/codec/webm_recorder.h"
+
+#include "base/logging.h"
+#include "base/codec/webm_video_encoder.h"
+#include "base/desktop/frame.h"
+
+namespace base {
+
+namespace {
+
+// The queue holds a few seconds of a typical session.
+const size_t kMaxQueueSize = 256;
+const size_t kMaxQueuedBytes = 16 * 1024 * 1024; // 16 MB
+
+} // namespace
+
+WebmRecorder::WebmRecorder(const std::filesystem::path& path, std::u16string_view name,
+                           int64_t max_file_size)
+    : file_writer_(std::make_unique<WebmFileWriter>(path, name))
+{
+    LOG(LS_INFO) << "Ctor (max file size: " << max_file_size << ")";
+
+    file_writer_->setMaxFileSize(max_file_size);
+    thread_.start(std::bind(&WebmRecorder::run, this));
+}
+
+WebmRecorder::~WebmRecorder()
+{
+    LOG(LS_INFO) << "Dtor";
+
+    {
+        std::scoped_lock lock(queue_lock_);
+        is_stopping_ = true;
+    }
+
+    // The queued packets are written before the thread exits.
+    queue_event_.notify_one();
+    thread_.stop();
+}
+
+// static
+bool WebmRecorder::isPassthroughPacket(const proto::VideoPacket& packet)
+{
+    if (packet.encoding() != proto::VIDEO_ENCODING_VP8 &&
+        packet.encoding() != proto::VIDEO_ENCODING_VP9)
+    {
+        return false;
+    }
+
+    return packet.screen_packet_size() == 0 && !packet.has_lossless_packet();
+}
+
+bool WebmRecorder::addVideoPacket(const proto::VideoPacket& packet, const Size& video_size)
+{
+    DCHECK(isPassthroughPacket(packet));
+
+    std::scoped_lock lock(queue_lock_);
+
+    if (waiting_key_frame_ && !packet.key_frame() && !packet.has_format())
+    {
+        if (key_frame_requested_)
+            return false;
+
+        key_frame_requested_ = true;
+        return true;
+    }
+
+    Task task;
+    task.video_packet = std::make_unique<proto::VideoPacket>(packet);
+    task.time = WebmFileWriter::Clock::now();
+    task.size = packet.data().size();
+
+    // The writer starts a new file with the format. The key frame after the skipped packets gets
+    // the format of the stream.
+    if (waiting_key_frame_ && !packet.has_format())
+    {
+        proto::Rect* video_rect = task.video_packet->mutable_format()->mutable_video_rect();
+        video_rect->set_width(video_size.width());
+        video_rect->set_height(video_size.height());
+    }
+
+    if (!addTask(std::move(task)))
+    {
+        LOG(LS_WARNING) << "Recording queue is full, waiting for a key frame";
+        waiting_key_frame_ = true;
+        key_frame_requested_ = true;
+        return true;
+    }
+
+    waiting_key_frame_ = false;
+
+    if (packet.key_frame() || packet.has_format())
+    {
+        key_frame_requested_ = false;
+        return false;
+    }
+
+    if (rotation_pending_)
+    {
+        // The writer starts the next file with a key frame.
+        rotation_pending_ = false;
+        key_frame_requested_ = true;
+        return true;
+    }
+
+    return false;
+}
+
+void WebmRecorder::addFrame(std::shared_ptr<Frame> frame)
+{
+    Task task;
+    task.frame = std::move(frame);
+    task.time = WebmFileWriter::Clock::now();
+
+    std::scoped_lock lock(queue_lock_);
+
+    // The passthrough video is started again from a key frame.
+    waiting_key_frame_ = true;
+    key_frame_requested_ = false;
+
+    if (frame_queued_)
+        return;
+
+    if (addTask(std::move(task)))
+        frame_queued_ = true;
+}
+
+void WebmRecorder::addAudioPacket(const proto::AudioPacket& packet)
+{
+    Task task;
+    task.audio_packet = std::make_unique<proto::AudioPacket>(packet);
+    task.time = WebmFileWriter::Clock::now();
+    task.size = packet.ByteSizeLong();
+
+    std::scoped_lock lock(queue_lock_);
+    addTask(std::move(task));
+}
+
+bool WebmRecorder::addTask(Task&& task)
+{
+    if (queue_.size() >= kMaxQueueSize || queued_bytes_ + task.size > kMaxQueuedBytes)
+        return false;
+
+    queued_bytes_ += task.size;
+    queue_.emplace_back(std::move(task));
+    queue_event_.notify_one();
+    return true;
+}
+
+void WebmRecorder::run()
+{
+    bool rotation_signalled = false;
+
+    while (true)
+    {
+        Task task;
+
+        {
+            std::unique_lock lock(queue_lock_);
+            queue_event_.wait(lock, [this]() { return is_stopping_ || !queue_.empty(); });
+
+            if (queue_.empty())
+                break;
+
+            task = std::move(queue_.front());
+            queue_.pop_front();
+            queued_bytes_ -= task.size;
+        }
+
+        if (task.video_packet)
+        {
+            file_writer_->addVideoPacket(*task.video_packet, task.time);
+
+            // The encoder of the frames starts a new file with the format after the passthrough.
+            video_encoder_.reset();
+
+            // The key frame is requested once for each file.
+            const bool rotation_pending = file_writer_->isRotationPending();
+            if (rotation_pending && !rotation_signalled)
+            {
+                std::scoped_lock lock(queue_lock_);
+                rotation_pending_ = true;
+            }
+
+            rotation_signalled = rotation_pending;
+        }
+        else if (task.audio_packet)
+        {
+            file_writer_->addAudioPacket(*task.audio_packet, task.time);
+        }
+        else if (task.frame)
+        {
+            if (!video_encoder_)
+                video_encoder_ = std::make_unique<WebmVideoEncoder>();
+
+            proto::VideoPacket packet;
+            if (video_encoder_->encode(*task.frame, &packet))
+                file_writer_->addVideoPacket(packet, task.time);
+
+            std::scoped_lock lock(queue_lock_);
+            frame_queued_ = false;
+        }
+    }
+
+    // The file is finalized on the recording thread.
+    file_writer_.reset();
+}
+
+} // namespace base
@@ -0,0 +1,102 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef BASE_CODEC_WEBM_RECORDER_H
+#define BASE_CODEC_WEBM_RECORDER_H
+
+#include "base/macros_magic.h"
+#include "base/codec/webm_file_writer.h"
+#include "base/desktop/geometry.h"
+#include "base/threading/simple_thread.h"
+
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+
+namespace base {
+
+class Frame;
+class WebmVideoEncoder;
+
+// Writes the session to WebM files on a separate thread, so that the muxing, the file writes and
+// the encoding of the decoded frames do not delay the decoding and displaying. The VP8 and VP9
+// packets of the session are written as they are, without decoding. The queue between the threads
+// is bounded. If the thread falls behind, the frames and the audio are dropped and the passthrough
+// video waits for the next key frame.
+class WebmRecorder
+{
+public:
+    // The recording is continued in a new file if the current one exceeds |max_file_size| bytes.
+    // Zero means no limit.
+    WebmRecorder(const std::filesystem::path& path, std::u16string_view name,
+                 int64_t max_file_size = 0);
+    ~WebmRecorder();
+
+    // Returns true if |packet| can be written without decoding: VP8 or VP9 of one stream without
+    // the lossless blocks of the hybrid encoding.
+    static bool isPassthroughPacket(const proto::VideoPacket& packet);
+
+    // Adds a passthrough |packet|. The packets are skipped until a key frame. |video_size| is
+    // written as the format of the key frames without one. Returns true if a key frame should be
+    // requested from the encoder: to start the recording, after an overflow of the queue or to
+    // start a new file.
+    bool addVideoPacket(const proto::VideoPacket& packet, const Size& video_size);
+
+    // Encodes |frame| on the recording thread, its content is read there. The frame is skipped if
+    // the previous one is not encoded yet.
+    void addFrame(std::shared_ptr<Frame> frame);
+
+    void addAudioPacket(const proto::AudioPacket& packet);
+
+private:
+    struct Task
+    {
+        std::unique_ptr<proto::VideoPacket> video_packet;
+        std::unique_ptr<proto::AudioPacket> audio_packet;
+        std::shared_ptr<Frame> frame;
+        WebmFileWriter::TimePoint time;
+        size_t size = 0;
+    };
+
+    // Returns false if the queue is full.
+    bool addTask(Task&& task);
+    void run();
+
+    SimpleThread thread_;
+
+    std::mutex queue_lock_;
+    std::condition_variable queue_event_;
+    std::deque<Task> queue_;
+    size_t queued_bytes_ = 0;
+    bool frame_queued_ = false;
+    bool waiting_key_frame_ = true;
+    bool key_frame_requested_ = false;
+    bool rotation_pending_ = false;
+    bool is_stopping_ = false;
+
+    // Used only on the recording thread.
+    std::unique_ptr<WebmFileWriter> file_writer_;
+    std::unique_ptr<WebmVideoEncoder> video_encoder_;
+
+    DISALLOW_COPY_AND_ASSIGN(WebmRecorder);
+};
+
+} // namespace base
+
+#endif // BASE_CODEC_WEBM_RECORDER_H
@@ -0,0 +1,660 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/command_line.h"
+#include "base/logging.h"
+#include "base/codec/pixel_translator.h"
+#include "base/codec/scale_reducer.h"
+#include "base/codec/video_decoder.h"
+#include "base/codec/video_encoder_vpx.h"
+#include "base/codec/video_encoder_zstd.h"
+#include "base/desktop/differ.h"
+#include "base/desktop/frame_corpus.h"
+#include "base/desktop/frame_rotation.h"
+#include "base/desktop/frame_simple.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/unicode.h"
+#include "build/build_config.h"
+
+#if defined(OS_WIN)
+#include "base/codec/video_encoder_mf.h"
+#endif // defined(OS_WIN)
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+const int kDefaultFrameCount = 300;
+
+// The default compression ratio of the client.
+const int kCompressRatio = 8;
+const base::Size kDefaultScreenSize(1920, 1080);
+
+// Glyph size of the simulated typing.
+const int kGlyphWidth = 8;
+const int kGlyphHeight = 16;
+
+using Clock = std::chrono::steady_clock;
+
+int64_t elapsedNs(const Clock::time_point& start_time)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_time).count();
+}
+
+class FrameSource
+{
+public:
+    virtual ~FrameSource() = default;
+
+    virtual const base::Size& screenSize() const = 0;
+
+    // Writes the next frame into |frame|, which contains the previous frame of the source.
+    virtual bool nextFrame(base::Frame* frame) = 0;
+    virtual bool rewind() = 0;
+};
+
+class CorpusFrameSource : public FrameSource
+{
+public:
+    bool open(const std::filesystem::path& file_path) { return reader_.open(file_path); }
+
+    const base::Size& screenSize() const override { return reader_.screenSize(); }
+    bool nextFrame(base::Frame* frame) override { return reader_.readFrame(frame); }
+    bool rewind() override { return reader_.rewind(); }
+
+private:
+    base::FrameCorpusReader reader_;
+};
+
+// Generates typical desktop activity: typing of text, scrolling of a document and a small video.
+class SyntheticFrameSource : public FrameSource
+{
+public:
+    explicit SyntheticFrameSource(const base::Size& screen_size)
+        : screen_size_(screen_size),
+          window_rect_(base::Rect::makeXYWH(screen_size.width() / 8, screen_size.height() / 8,
+                                            screen_size.width() / 2, screen_size.height() / 2)),
+          video_rect_(base::Rect::makeXYWH(screen_size.width() * 3 / 4 - 160,
+                                           screen_size.height() * 3 / 4 - 120, 320, 240))
+    {
+        video_rect_.intersectWith(base::Rect::makeSize(screen_size_));
+    }
+
+    const base::Size& screenSize() const override { return screen_size_; }
+
+    bool nextFrame(base::Frame* frame) override
+    {
+        base::Region* updated_region = frame->updatedRegion();
+        updated_region->clear();
+
+        if (!frame_index_)
+        {
+            const base::Rect screen_rect = base::Rect::makeSize(screen_size_);
+
+            fillGradient(frame, screen_rect);
+            fillSolid(frame, window_rect_, 0xFFFFFFFF);
+            updated_region->addRect(screen_rect);
+        }
+        else
+        {
+            typeGlyph(frame, updated_region);
+
+            if (frame_index_ % 4 == 0)
+                scrollWindow(frame, updated_region);
+
+            if (frame_index_ % 2 == 0)
+                playVideo(frame, updated_region);
+        }
+
+        ++frame_index_;
+        return true;
+    }
+
+    bool rewind() override
+    {
+        frame_index_ = 0;
+        cursor_ = base::Point();
+        engine_.seed(1);
+        return true;
+    }
+
+private:
+    static void fillSolid(base::Frame* frame, const base::Rect& rect, uint32_t color)
+    {
+        for (int y = rect.top(); y < rect.bottom(); ++y)
+        {
+            uint32_t* row = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(rect.left(), y));
+            std::fill(row, row + rect.width(), color);
+        }
+    }
+
+    static void fillGradient(base::Frame* frame, const base::Rect& rect)
+    {
+        for (int y = rect.top(); y < rect.bottom(); ++y)
+        {
+            uint32_t* row = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(rect.left(), y));
+
+            for (int x = 0; x < rect.width(); ++x)
+            {
+                row[x] = 0xFF000000 | static_cast<uint32_t>(((x + rect.left()) & 0xFF) << 16) |
+                         static_cast<uint32_t>((y & 0xFF) << 8) | 0x80;
+            }
+        }
+    }
+
+    void fillGlyph(base::Frame* frame, const base::Rect& rect)
+    {
+        for (int y = rect.top(); y < rect.bottom(); ++y)
+        {
+            uint32_t* row = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(rect.left(), y));
+
+            for (int x = 0; x < rect.width(); ++x)
+                row[x] = (engine_() & 3) ? 0xFFFFFFFF : 0xFF202020;
+        }
+    }
+
+    void typeGlyph(base::Frame* frame, base::Region* updated_region)
+    {
+        const int columns = window_rect_.width() / kGlyphWidth;
+        const int rows = window_rect_.height() / kGlyphHeight;
+        if (!columns || !rows)
+            return;
+
+        const base::Rect rect = base::Rect::makeXYWH(
+            window_rect_.left() + cursor_.x() * kGlyphWidth,
+            window_rect_.top() + cursor_.y() * kGlyphHeight,
+            kGlyphWidth, kGlyphHeight);
+
+        fillGlyph(frame, rect);
+        updated_region->addRect(rect);
+
+        cursor_.setX(cursor_.x() + 1);
+        if (cursor_.x() >= columns)
+            cursor_ = base::Point(0, (cursor_.y() + 1) % rows);
+    }
+
+    void scrollWindow(base::Frame* frame, base::Region* updated_region)
+    {
+        if (window_rect_.height() <= kGlyphHeight)
+            return;
+
+        const size_t row_size = static_cast<size_t>(window_rect_.width()) * sizeof(uint32_t);
+
+        for (int y = window_rect_.top(); y < window_rect_.bottom() - kGlyphHeight; ++y)
+        {
+            memmove(frame->frameDataAtPos(window_rect_.left(), y),
+                    frame->frameDataAtPos(window_rect_.left(), y + kGlyphHeight), row_size);
+        }
+
+        fillSolid(frame, base::Rect::makeLTRB(window_rect_.left(),
+                                              window_rect_.bottom() - kGlyphHeight,
+                                              window_rect_.right(),
+                                              window_rect_.bottom()), 0xFFFFFFFF);
+        updated_region->addRect(window_rect_);
+    }
+
+    void playVideo(base::Frame* frame, base::Region* updated_region)
+    {
+        for (int y = video_rect_.top(); y < video_rect_.bottom(); ++y)
+        {
+            uint32_t* row = reinterpret_cast<uint32_t*>(
+                frame->frameDataAtPos(video_rect_.left(), y));
+
+            // Smooth content with a small amount of noise, similar to decoded video.
+            const uint32_t base_value = static_cast<uint32_t>(y + frame_index_ * 3) & 0xFF;
+            for (int x = 0; x < video_rect_.width(); ++x)
+            {
+                const uint32_t value = (base_value + static_cast<uint32_t>(x / 4) +
+                                        (engine_() & 7)) & 0xFF;
+                row[x] = 0xFF000000 | (value << 16) | (value << 8) | (255 - value);
+            }
+        }
+
+        updated_region->addRect(video_rect_);
+    }
+
+    const base::Size screen_size_;
+    const base::Rect window_rect_;
+    base::Rect video_rect_;
+
+    int frame_index_ = 0;
+    base::Point cursor_;
+    std::mt19937 engine_{ 1 };
+};
+
+struct Result
+{
+    std::string name;
+    std::vector<int64_t> times_ns;
+    std::vector<int64_t> decode_times_ns;
+    size_t total_bytes = 0;
+};
+
+int64_t percentile(std::vector<int64_t> values, int percent)
+{
+    if (values.empty())
+        return 0;
+
+    const size_t index = std::min(values.size() - 1, values.size() * percent / 100);
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+int64_t average(const std::vector<int64_t>& values)
+{
+    if (values.empty())
+        return 0;
+
+    int64_t sum = 0;
+    for (const auto& value : values)
+        sum += value;
+
+    return sum / static_cast<int64_t>(values.size());
+}
+
+void printHeader()
+{
+    std::cout << std::left << std::setw(24) << "stage"
+              << std::right << std::setw(8) << "frames"
+              << std::setw(14) << "ns/frame"
+              << std::setw(14) << "p50 ns"
+              << std::setw(14) << "p99 ns"
+              << std::setw(14) << "bytes/frame"
+              << std::setw(14) << "decode ns" << std::endl;
+}
+
+void printResult(const Result& result)
+{
+    const size_t frames = result.times_ns.size();
+
+    std::cout << std::left << std::setw(24) << result.name
+              << std::right << std::setw(8) << frames
+              << std::setw(14) << average(result.times_ns)
+              << std::setw(14) << percentile(result.times_ns, 50)
+              << std::setw(14) << percentile(result.times_ns, 99)
+              << std::setw(14) << (frames ? result.total_bytes / frames : 0)
+              << std::setw(14) << average(result.decode_times_ns) << std::endl;
+}
+
+class Benchmark
+{
+public:
+    Benchmark(FrameSource* source, int frame_count)
+        : source_(source),
+          frame_count_(frame_count)
+    {
+        frame_ = base::FrameSimple::create(source_->screenSize(), base::PixelFormat::ARGB());
+        prev_frame_ = base::FrameSimple::create(source_->screenSize(), base::PixelFormat::ARGB());
+    }
+
+    using StageFunc = std::function<void(const base::Frame* frame, const base::Frame* prev_frame,
+                                         Result* result)>;
+
+    // Replays the source and calls |stage| for each frame with a non-empty updated region.
+    bool run(const std::string& name, const StageFunc& stage)
+    {
+        if (!source_->rewind())
+            return false;
+
+        Result result;
+        result.name = name;
+
+        const size_t frame_size =
+            static_cast<size_t>(frame_->stride()) * static_cast<size_t>(frame_->size().height());
+
+        for (int i = 0; i < frame_count_; ++i)
+        {
+            memcpy(prev_frame_->frameData(), frame_->frameData(), frame_size);
+
+            if (!source_->nextFrame(frame_.get()))
+                break;
+
+            if (frame_->constUpdatedRegion().isEmpty())
+                continue;
+
+            stage(frame_.get(), prev_frame_.get(), &result);
+        }
+
+        printResult(result);
+        return true;
+    }
+
+private:
+    FrameSource* source_;
+    const int frame_count_;
+
+    std::unique_ptr<base::Frame> frame_;
+    std::unique_ptr<base::Frame> prev_frame_;
+};
+
+void runDiffer(Benchmark* benchmark, const base::Size& screen_size, int thread_count,
+               const std::string& name)
+{
+    base::Differ differ(screen_size, thread_count);
+    base::Region region;
+
+    benchmark->run(name, [&](const base::Frame* frame, const base::Frame* prev_frame,
+                             Result* result)
+    {
+        Clock::time_point start_time = Clock::now();
+        differ.calcDirtyRegion(prev_frame->frameData(), frame->frameData(), &region);
+        result->times_ns.emplace_back(elapsedNs(start_time));
+    });
+}
+
+void runScaleReducer(Benchmark* benchmark, const base::Size& screen_size)
+{
+    base::ScaleReducer scale_reducer;
+    const base::Size target_size(screen_size.width() / 2, screen_size.height() / 2);
+
+    benchmark->run("scale_reducer 50%", [&](const base::Frame* frame,
+                                            const base::Frame* /* prev_frame */,
+                                            Result* result)
+    {
+        Clock::time_point start_time = Clock::now();
+        scale_reducer.scaleFrame(frame, target_size);
+        result->times_ns.emplace_back(elapsedNs(start_time));
+    });
+}
+
+// Rotates the updated region of each frame like the DXGI capturer does for portrait monitors. With
+// |full_frame| the entire frame is rotated for comparison.
+void runFrameRotation(Benchmark* benchmark, const base::Size& screen_size,
+                      base::Rotation rotation, bool full_frame, const std::string& name)
+{
+    std::unique_ptr<base::Frame> target = base::FrameSimple::create(
+        base::rotateSize(screen_size, rotation), base::PixelFormat::ARGB());
+    const base::Region full_region(base::Rect::makeSize(screen_size));
+
+    benchmark->run(name, [&](const base::Frame* frame, const base::Frame* /* prev_frame */,
+                             Result* result)
+    {
+        Clock::time_point start_time = Clock::now();
+        base::rotateDesktopFrame(*frame, full_frame ? full_region : frame->constUpdatedRegion(),
+                                 rotation, base::Point(), target.get());
+        result->times_ns.emplace_back(elapsedNs(start_time));
+    });
+}
+
+void runPixelTranslator(Benchmark* benchmark, const base::Size& screen_size,
+                        const base::PixelFormat& target_format, const std::string& name)
+{
+    std::unique_ptr<base::PixelTranslator> translator =
+        base::PixelTranslator::create(base::PixelFormat::ARGB(), target_format);
+    if (!translator)
+        return;
+
+    const int bytes_per_pixel = target_format.bytesPerPixel();
+    std::vector<uint8_t> buffer(static_cast<size_t>(
+        screen_size.width() * screen_size.height() * bytes_per_pixel));
+
+    benchmark->run(name, [&](const base::Frame* frame, const base::Frame* /* prev_frame */,
+                             Result* result)
+    {
+        Clock::time_point start_time = Clock::now();
+        uint8_t* target = buffer.data();
+
+        for (base::Region::Iterator it(frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
+        {
+            const base::Rect& rect = it.rect();
+            const int stride = rect.width() * bytes_per_pixel;
+
+            translator->translate(frame->frameDataAtPos(rect.topLeft()), frame->stride(),
+                                  target, stride, rect.width(), rect.height());
+            target += stride * rect.height();
+        }
+
+        result->times_ns.emplace_back(elapsedNs(start_time));
+    });
+}
+
+void runEncoder(Benchmark* benchmark, const base::Size& screen_size,
+                std::unique_ptr<base::VideoEncoder> encoder, const std::string& name,
+                int decoder_thread_count = 2)
+{
+    if (!encoder)
+    {
+        std::cout << name << ": encoder is not available" << std::endl;
+        return;
+    }
+
+    std::unique_ptr<base::VideoDecoder> decoder =
+        base::VideoDecoder::create(encoder->encoding(), decoder_thread_count);
+    std::unique_ptr<base::Frame> decoded_frame =
+        base::FrameSimple::create(screen_size, base::PixelFormat::ARGB());
+    proto::VideoPacket packet;
+
+    benchmark->run(name, [&](const base::Frame* frame, const base::Frame* /* prev_frame */,
+                             Result* result)
+    {
+        packet.Clear();
+
+        Clock::time_point start_time = Clock::now();
+        if (!encoder->encode(frame, &packet))
+            return;
+
+        result->times_ns.emplace_back(elapsedNs(start_time));
+        result->total_bytes += packet.ByteSizeLong();
+
+        if (!decoder)
+            return;
+
+        start_time = Clock::now();
+        if (decoder->decode(packet, decoded_frame.get()))
+            result->decode_times_ns.emplace_back(elapsedNs(start_time));
+    });
+}
+
+std::unique_ptr<base::VideoEncoder> createVp9Tiles()
+{
+    std::unique_ptr<base::VideoEncoderVPX> encoder = base::VideoEncoderVPX::createVP9();
+    encoder->setTileColumnsEnabled(true);
+    return encoder;
+}
+
+std::unique_ptr<base::VideoEncoder> createZstd(const base::PixelFormat& format, int ratio,
+                                               bool slices, bool stream)
+{
+    std::unique_ptr<base::VideoEncoderZstd> encoder =
+        base::VideoEncoderZstd::create(format, ratio);
+    if (encoder)
+    {
+        encoder->setSliceEncoding(slices);
+        encoder->setStreamMode(stream);
+    }
+
+    return encoder;
+}
+
+std::unique_ptr<base::VideoEncoder> createZstdPalette(const base::PixelFormat& format, int ratio)
+{
+    std::unique_ptr<base::VideoEncoderZstd> encoder =
+        base::VideoEncoderZstd::create(format, ratio);
+    if (encoder)
+        encoder->setPaletteCoding(true);
+
+    return encoder;
+}
+
+std::unique_ptr<base::VideoEncoder> createZstdCopyRects(const base::PixelFormat& format, int ratio)
+{
+    std::unique_ptr<base::VideoEncoderZstd> encoder =
+        base::VideoEncoderZstd::create(format, ratio);
+    if (encoder)
+        encoder->setCopyRects(true);
+
+    return encoder;
+}
+
+void printUsage()
+{
+    std::cout << "Usage: aspia_codec_bench [--corpus=<file>] [--frames=<count>]"
+                 " [--width=<width> --height=<height>] [--write-corpus=<file>]" << std::endl
+              << "  --corpus        Replay the frames of the corpus file." << std::endl
+              << "  --frames        Maximum number of frames for each stage." << std::endl
+              << "  --width/height  Screen size for synthetic frames." << std::endl
+              << "  --write-corpus  Write synthetic frames to the corpus file and exit."
+              << std::endl;
+}
+
+int intSwitch(const base::CommandLine& command_line, std::u16string_view name, int default_value)
+{
+    if (!command_line.hasSwitch(name))
+        return default_value;
+
+    int value;
+    if (!base::stringToInt(command_line.switchValue(name), &value) || value <= 0)
+        return -1;
+
+    return value;
+}
+
+int writeCorpus(FrameSource* source, const std::filesystem::path& file_path, int frame_count)
+{
+    base::FrameCorpusWriter writer;
+    if (!writer.open(file_path, source->screenSize()))
+        return 1;
+
+    std::unique_ptr<base::Frame> frame =
+        base::FrameSimple::create(source->screenSize(), base::PixelFormat::ARGB());
+
+    for (int i = 0; i < frame_count; ++i)
+    {
+        if (!source->nextFrame(frame.get()) || !writer.writeFrame(*frame))
+            return 1;
+    }
+
+    std::cout << "Written " << writer.frameCount() << " frames" << std::endl;
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, const char* const* argv)
+{
+    base::LoggingSettings logging_settings;
+    logging_settings.min_log_level = base::LOG_LS_WARNING;
+    base::initLogging(logging_settings);
+
+    base::CommandLine::init(argc, argv);
+    const base::CommandLine& command_line = *base::CommandLine::forCurrentProcess();
+
+    if (command_line.hasSwitch(u"help"))
+    {
+        printUsage();
+        return 0;
+    }
+
+    const int frame_count = intSwitch(command_line, u"frames", kDefaultFrameCount);
+    const int width = intSwitch(command_line, u"width", kDefaultScreenSize.width());
+    const int height = intSwitch(command_line, u"height", kDefaultScreenSize.height());
+
+    if (frame_count <= 0 || width <= 0 || height <= 0)
+    {
+        printUsage();
+        return 1;
+    }
+
+    std::unique_ptr<FrameSource> source;
+
+    if (command_line.hasSwitch(u"corpus"))
+    {
+        std::unique_ptr<CorpusFrameSource> corpus_source = std::make_unique<CorpusFrameSource>();
+        if (!corpus_source->open(command_line.switchValuePath(u"corpus")))
+        {
+            std::cout << "Unable to open corpus" << std::endl;
+            return 1;
+        }
+
+        source = std::move(corpus_source);
+    }
+    else
+    {
+        source = std::make_unique<SyntheticFrameSource>(base::Size(width, height));
+    }
+
+    if (command_line.hasSwitch(u"write-corpus"))
+        return writeCorpus(source.get(), command_line.switchValuePath(u"write-corpus"), frame_count);
+
+    const base::Size screen_size = source->screenSize();
+    std::cout << "Screen size: " << screen_size << ", frames: " << frame_count << std::endl;
+
+    Benchmark benchmark(source.get(), frame_count);
+    printHeader();
+
+    runDiffer(&benchmark, screen_size, 1, "differ");
+    runDiffer(&benchmark, screen_size, base::Differ::kAutoThreadCount, "differ auto threads");
+    runScaleReducer(&benchmark, screen_size);
+
+    runFrameRotation(&benchmark, screen_size, base::Rotation::CLOCK_WISE_90, false, "rotate 90");
+    runFrameRotation(&benchmark, screen_size, base::Rotation::CLOCK_WISE_90, true,
+                     "rotate 90 full frame");
+    runFrameRotation(&benchmark, screen_size, base::Rotation::CLOCK_WISE_180, false, "rotate 180");
+
+    runPixelTranslator(&benchmark, screen_size, base::PixelFormat::RGB565(), "translate rgb565");
+    runPixelTranslator(&benchmark, screen_size, base::PixelFormat::RGB332(), "translate rgb332");
+
+    runEncoder(&benchmark, screen_size, base::VideoEncoderVPX::createVP8(), "vp8");
+    runEncoder(&benchmark, screen_size, base::VideoEncoderVPX::createVP9(), "vp9");
+    runEncoder(&benchmark, screen_size, createVp9Tiles(), "vp9 tiles auto threads", 0);
+
+    runEncoder(&benchmark, screen_size,
+               createZstd(base::PixelFormat::ARGB(), kCompressRatio, false, false), "zstd argb");
+    runEncoder(&benchmark, screen_size,
+               createZstd(base::PixelFormat::ARGB(), kCompressRatio, true, false), "zstd argb slices");
+    runEncoder(&benchmark, screen_size,
+               createZstd(base::PixelFormat::ARGB(), kCompressRatio, false, true), "zstd argb stream");
+    runEncoder(&benchmark, screen_size,
+               createZstdCopyRects(base::PixelFormat::ARGB(), kCompressRatio),
+               "zstd argb copy rects");
+    runEncoder(&benchmark, screen_size,
+               createZstdPalette(base::PixelFormat::ARGB(), kCompressRatio), "zstd argb palette");
+    runEncoder(&benchmark, screen_size,
+               createZstd(base::PixelFormat::RGB565(), kCompressRatio, false, false), "zstd rgb565");
+    runEncoder(&benchmark, screen_size,
+               createZstdPalette(base::PixelFormat::RGB565(), kCompressRatio),
+               "zstd rgb565 palette");
+    runEncoder(&benchmark, screen_size,
+               createZstd(base::PixelFormat::RGB332(), kCompressRatio, false, false), "zstd rgb332");
+
+#if defined(OS_WIN)
+    const uint32_t mf_encodings = base::VideoEncoderMF::supportedEncodings();
+
+    if (mf_encodings & proto::VIDEO_ENCODING_H264)
+    {
+        runEncoder(&benchmark, screen_size,
+                   base::VideoEncoderMF::create(proto::VIDEO_ENCODING_H264), "h264 mf");
+    }
+
+    if (mf_encodings & proto::VIDEO_ENCODING_HEVC)
+    {
+        runEncoder(&benchmark, screen_size,
+                   base::VideoEncoderMF::create(proto::VIDEO_ENCODING_HEVC), "hevc mf");
+    }
+#endif // defined(OS_WIN)
+
+    base::shutdownLogging();
+    return 0;
+}
@@ -0,0 +1,115 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef BASE_COROUTINE_ASYNC_QUEUE_H
+#define BASE_COROUTINE_ASYNC_QUEUE_H
+
+#include "base/logging.h"
+#include "base/macros_magic.h"
+
+#include <coroutine>
+#include <deque>
+#include <optional>
+
+namespace base {
+
+// Queue with one consumer coroutine. The values are pushed and awaited on the same thread. The
+// waiting consumer is resumed inside push() or close().
+template <typename T>
+class AsyncQueue
+{
+public:
+    class PopAwaiter
+    {
+    public:
+        explicit PopAwaiter(AsyncQueue* queue)
+            : queue_(queue)
+        {
+            // Nothing
+        }
+
+        bool await_ready() const noexcept
+        {
+            return !queue_->values_.empty() || queue_->is_closed_;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle) noexcept
+        {
+            DCHECK(!queue_->waiter_);
+            queue_->waiter_ = handle;
+        }
+
+        std::optional<T> await_resume()
+        {
+            if (queue_->values_.empty())
+                return std::nullopt;
+
+            std::optional<T> value(std::move(queue_->values_.front()));
+            queue_->values_.pop_front();
+            return value;
+        }
+
+    private:
+        AsyncQueue* queue_;
+    };
+
+    AsyncQueue() = default;
+    ~AsyncQueue() = default;
+
+    // The values pushed after close() are dropped.
+    void push(T value)
+    {
+        if (is_closed_)
+            return;
+
+        values_.emplace_back(std::move(value));
+        resumeWaiter();
+    }
+
+    // The consumer receives the queued values and then std::nullopt.
+    void close()
+    {
+        is_closed_ = true;
+        resumeWaiter();
+    }
+
+    // co_await pop() returns the next value or std::nullopt if the queue is closed and empty.
+    PopAwaiter pop() { return PopAwaiter(this); }
+
+    bool isClosed() const { return is_closed_; }
+    size_t size() const { return values_.size(); }
+
+private:
+    void resumeWaiter()
+    {
+        if (!waiter_)
+            return;
+
+        std::coroutine_handle<> waiter = std::exchange(waiter_, nullptr);
+        waiter.resume();
+    }
+
+    std::deque<T> values_;
+    std::coroutine_handle<> waiter_;
+    bool is_closed_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(AsyncQueue);
+};
+
+} // namespace base
+
+#endif // BASE_COROUTINE_ASYNC_QUEUE_H
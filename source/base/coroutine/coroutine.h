@@ -0,0 +1,226 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef BASE_COROUTINE_COROUTINE_H
+#define BASE_COROUTINE_COROUTINE_H
+
+#include "base/macros_magic.h"
+#include "base/task_runner.h"
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace base {
+
+template <typename T>
+class Coroutine;
+
+namespace internal {
+
+class PromiseBase
+{
+public:
+    // The coroutine starts only when it is awaited.
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    auto final_suspend() noexcept { return FinalAwaiter(); }
+
+    // The project is built without the exception handling in the coroutines.
+    void unhandled_exception() noexcept { std::terminate(); }
+
+    void setCaller(std::coroutine_handle<> caller) { caller_ = caller; }
+
+private:
+    struct FinalAwaiter
+    {
+        bool await_ready() const noexcept { return false; }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+        {
+            // The caller is resumed without growing the stack.
+            std::coroutine_handle<> caller = handle.promise().caller_;
+            if (caller)
+                return caller;
+            return std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    std::coroutine_handle<> caller_;
+};
+
+template <typename T>
+class PromiseResult : public PromiseBase
+{
+public:
+    void return_value(T value) { value_.emplace(std::move(value)); }
+    T takeResult() { return std::move(*value_); }
+
+private:
+    std::optional<T> value_;
+};
+
+template <>
+class PromiseResult<void> : public PromiseBase
+{
+public:
+    void return_void() {}
+    void takeResult() {}
+};
+
+struct DetachedCoroutine
+{
+    struct promise_type
+    {
+        DetachedCoroutine get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+class TaskRunnerAwaiter
+{
+public:
+    TaskRunnerAwaiter(TaskRunner* task_runner, const TaskRunner::Milliseconds& delay)
+        : task_runner_(task_runner),
+          delay_(delay)
+    {
+        // Nothing
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        // The handle fits into the small buffer of std::function, so posting does not allocate
+        // memory for the callback.
+        if (delay_ == TaskRunner::Milliseconds::zero())
+            task_runner_->postTask([handle]() { handle.resume(); });
+        else
+            task_runner_->postDelayedTask([handle]() { handle.resume(); }, delay_);
+    }
+
+    void await_resume() noexcept {}
+
+private:
+    TaskRunner* task_runner_;
+    const TaskRunner::Milliseconds delay_;
+};
+
+} // namespace internal
+
+// The result of a coroutine. The coroutine starts when it is awaited with co_await and the awaiting
+// coroutine continues when it is finished. A coroutine that is not awaited is started with
+// spawn(). The frame of the coroutine is destroyed with this object.
+template <typename T = void>
+class [[nodiscard]] Coroutine
+{
+public:
+    struct promise_type : public internal::PromiseResult<T>
+    {
+        Coroutine get_return_object()
+        {
+            return Coroutine(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+    };
+
+    Coroutine(Coroutine&& other) noexcept
+        : handle_(std::exchange(other.handle_, nullptr))
+    {
+        // Nothing
+    }
+
+    Coroutine& operator=(Coroutine&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (handle_)
+                handle_.destroy();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+
+    ~Coroutine()
+    {
+        if (handle_)
+            handle_.destroy();
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept
+    {
+        handle_.promise().setCaller(caller);
+        return handle_;
+    }
+
+    T await_resume() { return handle_.promise().takeResult(); }
+
+private:
+    explicit Coroutine(std::coroutine_handle<promise_type> handle)
+        : handle_(handle)
+    {
+        // Nothing
+    }
+
+    std::coroutine_handle<promise_type> handle_;
+
+    DISALLOW_COPY_AND_ASSIGN(Coroutine);
+};
+
+namespace internal {
+
+inline DetachedCoroutine runDetached(Coroutine<void> coroutine)
+{
+    co_await std::move(coroutine);
+}
+
+} // namespace internal
+
+// Starts the coroutine that is not awaited by another coroutine. The frame is destroyed when the
+// coroutine is finished. The objects used by the coroutine must live until then.
+inline void spawn(Coroutine<void> coroutine)
+{
+    internal::runDetached(std::move(coroutine));
+}
+
+// co_await resumeOn(task_runner) continues the coroutine in a task of |task_runner|. If the task
+// runner is destroyed before the task is run, then the coroutine is never resumed and its frame is
+// not destroyed.
+inline internal::TaskRunnerAwaiter resumeOn(const std::shared_ptr<TaskRunner>& task_runner)
+{
+    return internal::TaskRunnerAwaiter(task_runner.get(), TaskRunner::Milliseconds::zero());
+}
+
+// co_await sleepFor(task_runner, delay) continues the coroutine in a delayed task of
+// |task_runner|.
+inline internal::TaskRunnerAwaiter sleepFor(const std::shared_ptr<TaskRunner>& task_runner,
+                                            const TaskRunner::Milliseconds& delay)
+{
+    return internal::TaskRunnerAwaiter(task_runner.get(), delay);
+}
+
+} // namespace base
+
+#endif // BASE_COROUTINE_COROUTINE_H
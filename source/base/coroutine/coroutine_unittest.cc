@@ -0,0 +1,180 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/coroutine/async_queue.h"
+#include "base/coroutine/coroutine.h"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+class FakeTaskRunner : public TaskRunner
+{
+public:
+    bool belongsToCurrentThread() const override { return true; }
+    void postTask(Callback task) override { tasks.emplace_back(std::move(task)); }
+
+    void postDelayedTask(Callback callback, const Milliseconds& delay) override
+    {
+        delays.emplace_back(delay);
+        tasks.emplace_back(std::move(callback));
+    }
+
+    void postNonNestableTask(Callback callback) override { postTask(std::move(callback)); }
+
+    void postNonNestableDelayedTask(Callback callback, const Milliseconds& delay) override
+    {
+        postDelayedTask(std::move(callback), delay);
+    }
+
+    void postQuit() override {}
+
+    void runAll()
+    {
+        while (!tasks.empty())
+        {
+            Callback task = std::move(tasks.front());
+            tasks.erase(tasks.begin());
+            task();
+        }
+    }
+
+    std::vector<Callback> tasks;
+    std::vector<Milliseconds> delays;
+};
+
+Coroutine<int> square(int value)
+{
+    co_return value * value;
+}
+
+Coroutine<int> sumOfSquares(int a, int b)
+{
+    const int first = co_await square(a);
+    const int second = co_await square(b);
+    co_return first + second;
+}
+
+Coroutine<void> storeSum(int a, int b, int* result)
+{
+    *result = co_await sumOfSquares(a, b);
+}
+
+} // namespace
+
+TEST(CoroutineTest, Chain)
+{
+    int result = 0;
+    spawn(storeSum(3, 4, &result));
+    EXPECT_EQ(result, 25);
+}
+
+TEST(CoroutineTest, NotStartedUntilAwaited)
+{
+    int result = 0;
+
+    {
+        Coroutine<void> coroutine = storeSum(1, 1, &result);
+        EXPECT_EQ(result, 0);
+    }
+
+    // The frame is destroyed without running the coroutine.
+    EXPECT_EQ(result, 0);
+}
+
+TEST(CoroutineTest, ResumeOn)
+{
+    std::shared_ptr<FakeTaskRunner> task_runner = std::make_shared<FakeTaskRunner>();
+    std::vector<std::string> steps;
+
+    auto coroutine = [](std::shared_ptr<TaskRunner> task_runner,
+                        std::vector<std::string>* steps) -> Coroutine<void>
+    {
+        steps->emplace_back("start");
+        co_await resumeOn(task_runner);
+        steps->emplace_back("posted");
+        co_await sleepFor(task_runner, std::chrono::milliseconds(50));
+        steps->emplace_back("delayed");
+    };
+
+    spawn(coroutine(task_runner, &steps));
+    EXPECT_EQ(steps, std::vector<std::string>({ "start" }));
+    ASSERT_EQ(task_runner->tasks.size(), 1U);
+
+    task_runner->runAll();
+    EXPECT_EQ(steps, std::vector<std::string>({ "start", "posted", "delayed" }));
+    ASSERT_EQ(task_runner->delays.size(), 1U);
+    EXPECT_EQ(task_runner->delays[0], std::chrono::milliseconds(50));
+}
+
+TEST(AsyncQueueTest, PushAndClose)
+{
+    AsyncQueue<int> queue;
+    std::vector<int> values;
+    bool finished = false;
+
+    auto consumer = [](AsyncQueue<int>* queue, std::vector<int>* values,
+                       bool* finished) -> Coroutine<void>
+    {
+        while (std::optional<int> value = co_await queue->pop())
+            values->emplace_back(*value);
+
+        *finished = true;
+    };
+
+    queue.push(1);
+    spawn(consumer(&queue, &values, &finished));
+    EXPECT_EQ(values, std::vector<int>({ 1 }));
+
+    queue.push(2);
+    queue.push(3);
+    EXPECT_EQ(values, std::vector<int>({ 1, 2, 3 }));
+    EXPECT_FALSE(finished);
+
+    queue.close();
+    EXPECT_TRUE(finished);
+
+    // The values pushed after closing are dropped.
+    queue.push(4);
+    EXPECT_EQ(queue.size(), 0U);
+}
+
+TEST(AsyncQueueTest, QueuedValuesBeforeClose)
+{
+    AsyncQueue<int> queue;
+    queue.push(1);
+    queue.push(2);
+    queue.close();
+
+    std::vector<int> values;
+
+    auto consumer = [](AsyncQueue<int>* queue, std::vector<int>* values) -> Coroutine<void>
+    {
+        while (std::optional<int> value = co_await queue->pop())
+            values->emplace_back(*value);
+    };
+
+    spawn(consumer(&queue, &values));
+    EXPECT_EQ(values, std::vector<int>({ 1, 2 }));
+}
+
+} // namespace base
@@ -0,0 +1,81 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/coroutine/ipc_channel_reader.h"
+
+#include "base/logging.h"
+
+namespace base {
+
+namespace {
+
+// When this number of messages is queued, the channel is paused. It is resumed when half of them
+// are read.
+const size_t kMaxQueuedMessages = 16;
+
+} // namespace
+
+IpcChannelReader::ReadAwaiter::ReadAwaiter(IpcChannelReader* reader)
+    : AsyncQueue<ByteArray>::PopAwaiter(&reader->queue_),
+      reader_(reader)
+{
+    // Nothing
+}
+
+std::optional<ByteArray> IpcChannelReader::ReadAwaiter::await_resume()
+{
+    std::optional<ByteArray> message = AsyncQueue<ByteArray>::PopAwaiter::await_resume();
+
+    if (reader_->is_paused_ && reader_->queue_.size() <= kMaxQueuedMessages / 2)
+    {
+        reader_->is_paused_ = false;
+        reader_->channel_->resume();
+    }
+
+    return message;
+}
+
+IpcChannelReader::IpcChannelReader(IpcChannel* channel)
+    : channel_(channel)
+{
+    DCHECK(channel_);
+    channel_->setListener(this);
+}
+
+IpcChannelReader::~IpcChannelReader()
+{
+    channel_->setListener(nullptr);
+}
+
+void IpcChannelReader::onDisconnected()
+{
+    LOG(LS_INFO) << "Channel disconnected";
+    queue_.close();
+}
+
+void IpcChannelReader::onMessageReceived(const ByteArray& buffer)
+{
+    queue_.push(buffer);
+
+    if (!is_paused_ && queue_.size() >= kMaxQueuedMessages)
+    {
+        is_paused_ = true;
+        channel_->pause();
+    }
+}
+
+} // namespace base
@@ -0,0 +1,63 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef BASE_COROUTINE_IPC_CHANNEL_READER_H
+#define BASE_COROUTINE_IPC_CHANNEL_READER_H
+
+#include "base/coroutine/async_queue.h"
+#include "base/ipc/ipc_channel.h"
+
+namespace base {
+
+// Receives the messages of the channel for a coroutine. The reader becomes the listener of the
+// channel. If the coroutine does not keep up, then the channel is paused until the queued messages
+// are read.
+class IpcChannelReader : public IpcChannel::Listener
+{
+public:
+    class ReadAwaiter : public AsyncQueue<ByteArray>::PopAwaiter
+    {
+    public:
+        explicit ReadAwaiter(IpcChannelReader* reader);
+        std::optional<ByteArray> await_resume();
+
+    private:
+        IpcChannelReader* reader_;
+    };
+
+    explicit IpcChannelReader(IpcChannel* channel);
+    ~IpcChannelReader() override;
+
+    // co_await read() returns the next message or std::nullopt if the channel is disconnected.
+    ReadAwaiter read() { return ReadAwaiter(this); }
+
+protected:
+    // IpcChannel::Listener implementation.
+    void onDisconnected() override;
+    void onMessageReceived(const ByteArray& buffer) override;
+
+private:
+    IpcChannel* channel_;
+    AsyncQueue<ByteArray> queue_;
+    bool is_paused_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(IpcChannelReader);
+};
+
+} // namespace base
+
+#endif // BASE_COROUTINE_IPC_CHANNEL_READER_H
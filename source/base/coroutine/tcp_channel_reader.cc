@@ -0,0 +1,93 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/coroutine/tcp_channel_reader.h"
+
+#include "base/logging.h"
+
+namespace base {
+
+namespace {
+
+// When this number of messages is queued, the channel is paused. It is resumed when half of them
+// are read.
+const size_t kMaxQueuedMessages = 16;
+
+} // namespace
+
+TcpChannelReader::ReadAwaiter::ReadAwaiter(TcpChannelReader* reader)
+    : AsyncQueue<Message>::PopAwaiter(&reader->queue_),
+      reader_(reader)
+{
+    // Nothing
+}
+
+std::optional<TcpChannelReader::Message> TcpChannelReader::ReadAwaiter::await_resume()
+{
+    std::optional<Message> message = AsyncQueue<Message>::PopAwaiter::await_resume();
+
+    if (reader_->is_paused_ && reader_->queue_.size() <= kMaxQueuedMessages / 2)
+    {
+        reader_->is_paused_ = false;
+        reader_->channel_->resume();
+    }
+
+    return message;
+}
+
+TcpChannelReader::TcpChannelReader(TcpChannel* channel)
+    : channel_(channel)
+{
+    DCHECK(channel_);
+    channel_->setListener(this);
+}
+
+TcpChannelReader::~TcpChannelReader()
+{
+    channel_->setListener(nullptr);
+}
+
+void TcpChannelReader::onTcpConnected()
+{
+    // Nothing
+}
+
+void TcpChannelReader::onTcpDisconnected(TcpChannel::ErrorCode error_code)
+{
+    LOG(LS_INFO) << "Channel disconnected: " << NetworkChannel::errorToString(error_code);
+
+    error_code_ = error_code;
+    queue_.close();
+}
+
+void TcpChannelReader::onTcpMessageReceived(uint8_t channel_id, const ByteArray& buffer)
+{
+    queue_.push(Message{ channel_id, buffer });
+
+    if (!is_paused_ && queue_.size() >= kMaxQueuedMessages)
+    {
+        is_paused_ = true;
+        channel_->pause();
+    }
+}
+
+void TcpChannelReader::onTcpMessageWritten(uint8_t /* channel_id */, size_t /* pending */)
+{
+    // Nothing
+}
+
+} // namespace base
@@ -0,0 +1,76 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef BASE_COROUTINE_TCP_CHANNEL_READER_H
+#define BASE_COROUTINE_TCP_CHANNEL_READER_H
+
+#include "base/coroutine/async_queue.h"
+#include "base/net/tcp_channel.h"
+
+namespace base {
+
+// Receives the messages of the channel for a coroutine:
+//   while (std::optional<TcpChannelReader::Message> message = co_await reader.read())
+//       ...
+// The reader becomes the listener of the channel. If the coroutine does not keep up, then the
+// channel is paused until the queued messages are read.
+class TcpChannelReader : public TcpChannel::Listener
+{
+public:
+    struct Message
+    {
+        uint8_t channel_id;
+        ByteArray buffer;
+    };
+
+    class ReadAwaiter : public AsyncQueue<Message>::PopAwaiter
+    {
+    public:
+        explicit ReadAwaiter(TcpChannelReader* reader);
+        std::optional<Message> await_resume();
+
+    private:
+        TcpChannelReader* reader_;
+    };
+
+    explicit TcpChannelReader(TcpChannel* channel);
+    ~TcpChannelReader() override;
+
+    // co_await read() returns the next message or std::nullopt if the channel is disconnected.
+    ReadAwaiter read() { return ReadAwaiter(this); }
+
+    TcpChannel::ErrorCode errorCode() const { return error_code_; }
+
+protected:
+    // TcpChannel::Listener implementation.
+    void onTcpConnected() override;
+    void onTcpDisconnected(TcpChannel::ErrorCode error_code) override;
+    void onTcpMessageReceived(uint8_t channel_id, const ByteArray& buffer) override;
+    void onTcpMessageWritten(uint8_t channel_id, size_t pending) override;
+
+private:
+    TcpChannel* channel_;
+    AsyncQueue<Message> queue_;
+    TcpChannel::ErrorCode error_code_ = TcpChannel::ErrorCode::SUCCESS;
+    bool is_paused_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(TcpChannelReader);
+};
+
+} // namespace base
+
+#endif // BASE_COROUTINE_TCP_CHANNEL_READER_H
@@ -79,6 +79,17 @@ bool CpuidUtil::hasAesNi()
     return BitSet<uint32_t>(CpuidUtil(1).ecx()).test(25);
 }
 
+// static
+bool CpuidUtil::hasSse42()
+{
+    // Check if function 1 is supported.
+    if (CpuidUtil(0).eax() < 1)
+        return false;
+
+    // Bit 20 of register ECX set to 1 indicates the support of SSE 4.2 instructions.
+    return BitSet<uint32_t>(CpuidUtil(1).ecx()).test(20);
+}
+
 } // namespace base
 
 #endif // defined(ARCH_CPU_X86_FAMILY)
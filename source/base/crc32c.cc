@@ -0,0 +1,201 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/crc32c.h"
+
+#include "build/build_config.h"
+
+#if defined(ARCH_CPU_X86_FAMILY)
+#include "base/cpuid_util.h"
+
+#if defined(CC_MSVC)
+#include <intrin.h>
+#else
+#include <nmmintrin.h>
+#endif // defined(CC_*)
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+#if defined(ARCH_CPU_ARM64)
+#if defined(CC_MSVC)
+#include <intrin.h>
+#else
+#include <arm_acle.h>
+#endif // defined(CC_*)
+
+#if defined(OS_LINUX)
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#endif // defined(OS_LINUX)
+#endif // defined(ARCH_CPU_ARM64)
+
+#include <array>
+#include <cstring>
+
+namespace base {
+
+namespace {
+
+using Crc32cFunc = uint32_t(*)(uint32_t, const uint8_t*, size_t);
+
+// Reversed Castagnoli polynomial.
+const uint32_t kCrc32cPolynomial = 0x82F63B78;
+
+constexpr std::array<uint32_t, 256> makeTable()
+{
+    std::array<uint32_t, 256> table = {};
+
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        uint32_t checksum = i;
+
+        for (int j = 0; j < 8; ++j)
+            checksum = (checksum & 1) ? (kCrc32cPolynomial ^ (checksum >> 1)) : (checksum >> 1);
+
+        table[i] = checksum;
+    }
+
+    return table;
+}
+
+constexpr std::array<uint32_t, 256> kCrc32cTable = makeTable();
+
+uint32_t crc32c_C(uint32_t sum, const uint8_t* data, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+        sum = kCrc32cTable[(sum & 0x000000FF) ^ data[i]] ^ (sum >> 8);
+
+    return sum;
+}
+
+#if defined(ARCH_CPU_X86_FAMILY)
+
+#if defined(CC_GCC)
+__attribute__((target("sse4.2")))
+#endif
+uint32_t crc32c_SSE42(uint32_t sum, const uint8_t* data, size_t size)
+{
+#if defined(ARCH_CPU_X86_64)
+    uint64_t sum64 = sum;
+
+    while (size >= sizeof(uint64_t))
+    {
+        uint64_t value;
+        memcpy(&value, data, sizeof(value));
+
+        sum64 = _mm_crc32_u64(sum64, value);
+
+        data += sizeof(uint64_t);
+        size -= sizeof(uint64_t);
+    }
+
+    sum = static_cast<uint32_t>(sum64);
+#endif // defined(ARCH_CPU_X86_64)
+
+    while (size >= sizeof(uint32_t))
+    {
+        uint32_t value;
+        memcpy(&value, data, sizeof(value));
+
+        sum = _mm_crc32_u32(sum, value);
+
+        data += sizeof(uint32_t);
+        size -= sizeof(uint32_t);
+    }
+
+    while (size > 0)
+    {
+        sum = _mm_crc32_u8(sum, *data);
+
+        ++data;
+        --size;
+    }
+
+    return sum;
+}
+
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+#if defined(ARCH_CPU_ARM64)
+
+#if defined(CC_GCC) && !defined(__ARM_FEATURE_CRC32)
+#if defined(__clang__)
+__attribute__((target("crc")))
+#else
+__attribute__((target("+crc")))
+#endif
+#endif
+uint32_t crc32c_ARMV8(uint32_t sum, const uint8_t* data, size_t size)
+{
+    while (size >= sizeof(uint64_t))
+    {
+        uint64_t value;
+        memcpy(&value, data, sizeof(value));
+
+        sum = __crc32cd(sum, value);
+
+        data += sizeof(uint64_t);
+        size -= sizeof(uint64_t);
+    }
+
+    while (size > 0)
+    {
+        sum = __crc32cb(sum, *data);
+
+        ++data;
+        --size;
+    }
+
+    return sum;
+}
+
+bool hasArmCrc32()
+{
+#if defined(OS_LINUX)
+    return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+#else
+    // The CRC extension is mandatory for all ARM64 processors supported by Windows and macOS.
+    return true;
+#endif // defined(OS_LINUX)
+}
+
+#endif // defined(ARCH_CPU_ARM64)
+
+Crc32cFunc crc32cFunction()
+{
+#if defined(ARCH_CPU_X86_FAMILY)
+    if (CpuidUtil::hasSse42())
+        return crc32c_SSE42;
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+#if defined(ARCH_CPU_ARM64)
+    if (hasArmCrc32())
+        return crc32c_ARMV8;
+#endif // defined(ARCH_CPU_ARM64)
+
+    return crc32c_C;
+}
+
+} // namespace
+
+uint32_t crc32c(uint32_t sum, const void* data, size_t size)
+{
+    static const Crc32cFunc func = crc32cFunction();
+    return func(sum, reinterpret_cast<const uint8_t*>(data), size);
+}
+
+} // namespace base
@@ -0,0 +1,34 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_CRC32C_H
+#define BASE_CRC32C_H
+
+#include <cstdint>
+#include <cstddef>
+
+namespace base {
+
+// Calculates CRC-32C (Castagnoli polynomial). If the processor supports SSE 4.2 or the ARMv8 CRC
+// extension, then the hardware instruction is used. As with crc32(), |sum| can start with any seed
+// or be used to continue an operation began with previous data. It is not a "secure" calculation!
+uint32_t crc32c(uint32_t sum, const void* data, size_t size);
+
+} // namespace base
+
+#endif // BASE_CRC32C_H
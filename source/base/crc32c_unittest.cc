@@ -0,0 +1,58 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/crc32c.h"
+
+#include <cstring>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+// A CRC of nothing should always be zero.
+TEST(Crc32cTest, ZeroTest)
+{
+    EXPECT_EQ(0U, crc32c(0, nullptr, 0));
+}
+
+TEST(Crc32cTest, CheckValue)
+{
+    // The check value for CRC-32C from the catalogue of parametrised CRC algorithms.
+    const char kData[] = "123456789";
+    EXPECT_EQ(0xE3069283U, crc32c(0xFFFFFFFF, kData, strlen(kData)) ^ 0xFFFFFFFF);
+}
+
+TEST(Crc32cTest, Continuation)
+{
+    std::vector<uint8_t> data(1031);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>(i * 7);
+
+    const uint32_t full = crc32c(0, data.data(), data.size());
+
+    // The result must not depend on how the data is split.
+    for (size_t split : { 1, 3, 8, 15, 512, 1030 })
+    {
+        uint32_t sum = crc32c(0, data.data(), split);
+        sum = crc32c(sum, data.data() + split, data.size() - split);
+        EXPECT_EQ(full, sum);
+    }
+}
+
+} // namespace base
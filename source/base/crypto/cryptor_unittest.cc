@@ -106,6 +106,89 @@ void wrongKey(MessageEncryptor* client_encryptor, MessageDecryptor* host_decrypt
     ASSERT_FALSE(ret);
 }
 
+// Checks that the in-place operations produce the same messages as the regular ones.
+void inPlace(MessageEncryptor* encryptor, MessageEncryptor* encryptor_in_place,
+             MessageDecryptor* decryptor, MessageDecryptor* decryptor_in_place)
+{
+    const ByteArray message = fromHex(
+        "6006ee8029610876ec2facd5fc9ce6bd6dc03d4a5ddb4d6c28f2ff048d4f7eb7bcf5048c901a4adaa7fd");
+
+    ByteArray encrypted_msg;
+    encrypted_msg.resize(encryptor->encryptedDataSize(message.size()));
+    ASSERT_TRUE(encryptor->encrypt(message.data(), message.size(), encrypted_msg.data()));
+
+    const size_t prefix_size = encrypted_msg.size() - message.size();
+    ASSERT_EQ(prefix_size, 16);
+
+    ByteArray prefix(prefix_size);
+    ByteArray data = message;
+    ASSERT_TRUE(encryptor_in_place->encryptInPlace(prefix.data(), data.data(), data.size()));
+
+    prefix.insert(prefix.end(), data.begin(), data.end());
+    ASSERT_EQ(prefix, encrypted_msg);
+
+    data.assign(encrypted_msg.begin() + static_cast<ptrdiff_t>(prefix_size), encrypted_msg.end());
+    ASSERT_TRUE(decryptor_in_place->decryptInPlace(encrypted_msg.data(), data.data(), data.size()));
+    ASSERT_EQ(data, message);
+
+    // The regular decryptor still has the previous IV.
+    ByteArray decrypted_msg;
+    decrypted_msg.resize(decryptor->decryptedDataSize(encrypted_msg.size()));
+    ASSERT_TRUE(decryptor->decrypt(
+        encrypted_msg.data(), encrypted_msg.size(), decrypted_msg.data()));
+    ASSERT_EQ(decrypted_msg, message);
+
+    // A modified message is rejected.
+    data.assign(encrypted_msg.begin() + static_cast<ptrdiff_t>(prefix_size), encrypted_msg.end());
+    data[0] ^= 1;
+    ASSERT_FALSE(decryptor_in_place->decryptInPlace(
+        encrypted_msg.data(), data.data(), data.size()));
+}
+
+// Checks that the messages with a sequence can be decrypted in any order and do not affect the
+// ordered messages.
+void withSequence(MessageEncryptor* encryptor, MessageDecryptor* decryptor)
+{
+    const ByteArray message = fromHex("6006ee8029610876ec2facd5fc9ce6bd6dc03d4a5ddb4d6c");
+
+    std::vector<ByteArray> encrypted_msgs;
+    for (uint64_t sequence = 0; sequence < 3; ++sequence)
+    {
+        ByteArray encrypted_msg;
+        encrypted_msg.resize(encryptor->encryptedDataSize(message.size()));
+        ASSERT_TRUE(encryptor->encryptWithSequence(
+            sequence, message.data(), message.size(), encrypted_msg.data()));
+        encrypted_msgs.emplace_back(std::move(encrypted_msg));
+    }
+
+    // Different sequences give different messages.
+    ASSERT_NE(encrypted_msgs[0], encrypted_msgs[1]);
+
+    ByteArray ordered_msg;
+    ordered_msg.resize(encryptor->encryptedDataSize(message.size()));
+    ASSERT_TRUE(encryptor->encrypt(message.data(), message.size(), ordered_msg.data()));
+    ASSERT_NE(ordered_msg, encrypted_msgs[0]);
+
+    ByteArray decrypted_msg;
+    decrypted_msg.resize(decryptor->decryptedDataSize(ordered_msg.size()));
+
+    // The first message is lost, the others are reordered.
+    ASSERT_TRUE(decryptor->decryptWithSequence(
+        2, encrypted_msgs[2].data(), encrypted_msgs[2].size(), decrypted_msg.data()));
+    ASSERT_EQ(decrypted_msg, message);
+
+    ASSERT_TRUE(decryptor->decryptWithSequence(
+        1, encrypted_msgs[1].data(), encrypted_msgs[1].size(), decrypted_msg.data()));
+    ASSERT_EQ(decrypted_msg, message);
+
+    // A wrong sequence is rejected.
+    ASSERT_FALSE(decryptor->decryptWithSequence(
+        1, encrypted_msgs[0].data(), encrypted_msgs[0].size(), decrypted_msg.data()));
+
+    ASSERT_TRUE(decryptor->decrypt(ordered_msg.data(), ordered_msg.size(), decrypted_msg.data()));
+    ASSERT_EQ(decrypted_msg, message);
+}
+
 TEST(CryptorAes256GcmTest, TestVector)
 {
     const ByteArray key =
@@ -162,6 +245,48 @@ TEST(CryptorAes256GcmTest, WrongKey)
     wrongKey(client_encryptor.get(), host_decryptor.get());
 }
 
+TEST(CryptorAes256GcmTest, InPlace)
+{
+    const ByteArray key =
+        fromHex("5ce26794165a808ec425684e9384c27c22499512a513da8b455bd39746dc5014");
+    const ByteArray iv = fromHex("ee7eb0e6fb24d445597f3e6f");
+
+    std::unique_ptr<MessageEncryptor> encryptor =
+        MessageEncryptorOpenssl::createForAes256Gcm(key, iv);
+    ASSERT_NE(encryptor, nullptr);
+
+    std::unique_ptr<MessageEncryptor> encryptor_in_place =
+        MessageEncryptorOpenssl::createForAes256Gcm(key, iv);
+    ASSERT_NE(encryptor_in_place, nullptr);
+
+    std::unique_ptr<MessageDecryptor> decryptor =
+        MessageDecryptorOpenssl::createForAes256Gcm(key, iv);
+    ASSERT_NE(decryptor, nullptr);
+
+    std::unique_ptr<MessageDecryptor> decryptor_in_place =
+        MessageDecryptorOpenssl::createForAes256Gcm(key, iv);
+    ASSERT_NE(decryptor_in_place, nullptr);
+
+    inPlace(encryptor.get(), encryptor_in_place.get(), decryptor.get(), decryptor_in_place.get());
+}
+
+TEST(CryptorAes256GcmTest, WithSequence)
+{
+    const ByteArray key =
+        fromHex("5ce26794165a808ec425684e9384c27c22499512a513da8b455bd39746dc5014");
+    const ByteArray iv = fromHex("ee7eb0e6fb24d445597f3e6f");
+
+    std::unique_ptr<MessageEncryptor> encryptor =
+        MessageEncryptorOpenssl::createForAes256Gcm(key, iv);
+    ASSERT_NE(encryptor, nullptr);
+
+    std::unique_ptr<MessageDecryptor> decryptor =
+        MessageDecryptorOpenssl::createForAes256Gcm(key, iv);
+    ASSERT_NE(decryptor, nullptr);
+
+    withSequence(encryptor.get(), decryptor.get());
+}
+
 TEST(CryptorChaCha20Poly1305Test, TestVector)
 {
     const ByteArray key =
@@ -218,4 +343,46 @@ TEST(CryptorChaCha20Poly1305Test, WrongKey)
     wrongKey(client_encryptor.get(), host_decryptor.get());
 }
 
+TEST(CryptorChaCha20Poly1305Test, InPlace)
+{
+    const ByteArray key =
+        fromHex("5ce26794165a808ec425684e9384c27c22499512a513da8b455bd39746dc5014");
+    const ByteArray iv = fromHex("ee7eb0e6fb24d445597f3e6f");
+
+    std::unique_ptr<MessageEncryptor> encryptor =
+        MessageEncryptorOpenssl::createForChaCha20Poly1305(key, iv);
+    ASSERT_NE(encryptor, nullptr);
+
+    std::unique_ptr<MessageEncryptor> encryptor_in_place =
+        MessageEncryptorOpenssl::createForChaCha20Poly1305(key, iv);
+    ASSERT_NE(encryptor_in_place, nullptr);
+
+    std::unique_ptr<MessageDecryptor> decryptor =
+        MessageDecryptorOpenssl::createForChaCha20Poly1305(key, iv);
+    ASSERT_NE(decryptor, nullptr);
+
+    std::unique_ptr<MessageDecryptor> decryptor_in_place =
+        MessageDecryptorOpenssl::createForChaCha20Poly1305(key, iv);
+    ASSERT_NE(decryptor_in_place, nullptr);
+
+    inPlace(encryptor.get(), encryptor_in_place.get(), decryptor.get(), decryptor_in_place.get());
+}
+
+TEST(CryptorChaCha20Poly1305Test, WithSequence)
+{
+    const ByteArray key =
+        fromHex("5ce26794165a808ec425684e9384c27c22499512a513da8b455bd39746dc5014");
+    const ByteArray iv = fromHex("ee7eb0e6fb24d445597f3e6f");
+
+    std::unique_ptr<MessageEncryptor> encryptor =
+        MessageEncryptorOpenssl::createForChaCha20Poly1305(key, iv);
+    ASSERT_NE(encryptor, nullptr);
+
+    std::unique_ptr<MessageDecryptor> decryptor =
+        MessageDecryptorOpenssl::createForChaCha20Poly1305(key, iv);
+    ASSERT_NE(decryptor, nullptr);
+
+    withSequence(encryptor.get(), decryptor.get());
+}
+
 } // namespace base
@@ -20,6 +20,7 @@
 #define BASE_CRYPTO_MESSAGE_DECRYPTOR_H
 
 #include <cstddef>
+#include <cstdint>
 
 namespace base {
 
@@ -30,6 +31,16 @@ public:
 
     virtual size_t decryptedDataSize(size_t in_size) = 0;
     virtual bool decrypt(const void* in, size_t in_size, void* out) = 0;
+
+    // Decrypts |size| bytes of |data| in place. |prefix| contains the first
+    // in_size - decryptedDataSize(in_size) bytes of the encrypted message and |data| contains the
+    // rest of it.
+    virtual bool decryptInPlace(const void* prefix, void* data, size_t size) = 0;
+
+    // Decrypts a message encrypted by MessageEncryptor::encryptWithSequence. The counter of the
+    // ordered messages does not change.
+    virtual bool decryptWithSequence(
+        uint64_t sequence, const void* in, size_t in_size, void* out) = 0;
 };
 
 } // namespace base
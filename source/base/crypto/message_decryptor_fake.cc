@@ -37,4 +37,18 @@ bool MessageDecryptorFake::decrypt(const void* in, size_t in_size, void* out)
     return true;
 }
 
+bool MessageDecryptorFake::decryptInPlace(const void* /* prefix */, void* /* data */,
+                                          size_t /* size */)
+{
+    // The data is not encrypted.
+    return true;
+}
+
+bool MessageDecryptorFake::decryptWithSequence(
+    uint64_t /* sequence */, const void* in, size_t in_size, void* out)
+{
+    memcpy(out, in, in_size);
+    return true;
+}
+
 } // namespace base
@@ -33,6 +33,9 @@ public:
     // MessageDecryptor implementation.
     size_t decryptedDataSize(size_t in_size) override;
     bool decrypt(const void* in, size_t in_size, void* out) override;
+    bool decryptInPlace(const void* prefix, void* data, size_t size) override;
+    bool decryptWithSequence(
+        uint64_t sequence, const void* in, size_t in_size, void* out) override;
 
 private:
     DISALLOW_COPY_AND_ASSIGN(MessageDecryptorFake);
@@ -35,6 +35,7 @@ const int kTagSize = 16; // 128 bits, 16 bytes.
 
 MessageDecryptorOpenssl::MessageDecryptorOpenssl(EVP_CIPHER_CTX_ptr ctx, const ByteArray& iv)
     : ctx_(std::move(ctx)),
+      initial_iv_(iv),
       iv_(iv)
 {
     DCHECK_EQ(EVP_CIPHER_CTX_key_length(ctx_.get()), kKeySize);
@@ -92,7 +93,49 @@ size_t MessageDecryptorOpenssl::decryptedDataSize(size_t in_size)
 
 bool MessageDecryptorOpenssl::decrypt(const void* in, size_t in_size, void* out)
 {
-    if (EVP_DecryptInit_ex(ctx_.get(), nullptr, nullptr, nullptr, iv_.data()) != 1)
+    if (in_size < static_cast<size_t>(kTagSize))
+    {
+        LOG(LS_WARNING) << "Too small message: " << in_size;
+        return false;
+    }
+
+    if (!decryptImpl(iv_.data(), reinterpret_cast<const uint8_t*>(in) + kTagSize,
+                     in_size - kTagSize, out, in))
+    {
+        return false;
+    }
+
+    largeNumberIncrement(&iv_);
+    return true;
+}
+
+bool MessageDecryptorOpenssl::decryptInPlace(const void* prefix, void* data, size_t size)
+{
+    if (!decryptImpl(iv_.data(), data, size, data, prefix))
+        return false;
+
+    largeNumberIncrement(&iv_);
+    return true;
+}
+
+bool MessageDecryptorOpenssl::decryptWithSequence(
+    uint64_t sequence, const void* in, size_t in_size, void* out)
+{
+    if (in_size < static_cast<size_t>(kTagSize))
+    {
+        LOG(LS_WARNING) << "Too small message: " << in_size;
+        return false;
+    }
+
+    const ByteArray iv = sequenceIV(initial_iv_, sequence);
+    return decryptImpl(iv.data(), reinterpret_cast<const uint8_t*>(in) + kTagSize,
+                       in_size - kTagSize, out, in);
+}
+
+bool MessageDecryptorOpenssl::decryptImpl(
+    const uint8_t* iv, const void* in, size_t in_size, void* out, const void* tag)
+{
+    if (EVP_DecryptInit_ex(ctx_.get(), nullptr, nullptr, nullptr, iv) != 1)
     {
         LOG(LS_WARNING) << "EVP_DecryptInit_ex failed";
         return false;
@@ -102,15 +145,14 @@ bool MessageDecryptorOpenssl::decrypt(const void* in, size_t in_size, void* out)
 
     if (EVP_DecryptUpdate(ctx_.get(),
                           reinterpret_cast<uint8_t*>(out), &length,
-                          reinterpret_cast<const uint8_t*>(in) + kTagSize,
-                          static_cast<int>(in_size) - kTagSize) != 1)
+                          reinterpret_cast<const uint8_t*>(in), static_cast<int>(in_size)) != 1)
     {
         LOG(LS_WARNING) << "EVP_DecryptUpdate failed";
         return false;
     }
 
     if (EVP_CIPHER_CTX_ctrl(ctx_.get(), EVP_CTRL_AEAD_SET_TAG, kTagSize,
-                            const_cast<void*>(in)) != 1)
+                            const_cast<void*>(tag)) != 1)
     {
         LOG(LS_WARNING) << "EVP_CIPHER_CTX_ctrl failed";
         return false;
@@ -122,7 +164,6 @@ bool MessageDecryptorOpenssl::decrypt(const void* in, size_t in_size, void* out)
         return false;
     }
 
-    largeNumberIncrement(&iv_);
     return true;
 }
 
@@ -40,11 +40,20 @@ public:
     // MessageDecryptor implementation.
     size_t decryptedDataSize(size_t in_size) override;
     bool decrypt(const void* in, size_t in_size, void* out) override;
+    bool decryptInPlace(const void* prefix, void* data, size_t size) override;
+    bool decryptWithSequence(
+        uint64_t sequence, const void* in, size_t in_size, void* out) override;
 
 private:
     MessageDecryptorOpenssl(EVP_CIPHER_CTX_ptr ctx, const ByteArray& iv);
 
+    // Decrypts |in_size| bytes of |in| to |out| with |iv| and verifies them with the
+    // authentication tag |tag|. |in| and |out| may point to the same buffer.
+    bool decryptImpl(
+        const uint8_t* iv, const void* in, size_t in_size, void* out, const void* tag);
+
     EVP_CIPHER_CTX_ptr ctx_;
+    const ByteArray initial_iv_;
     ByteArray iv_;
 
     DISALLOW_COPY_AND_ASSIGN(MessageDecryptorOpenssl);
@@ -20,6 +20,7 @@
 #define BASE_CRYPTO_MESSAGE_ENCRYPTOR_H
 
 #include <cstddef>
+#include <cstdint>
 
 namespace base {
 
@@ -30,6 +31,15 @@ public:
 
     virtual size_t encryptedDataSize(size_t in_size) = 0;
     virtual bool encrypt(const void* in, size_t in_size, void* out) = 0;
+
+    // Encrypts |size| bytes of |data| in place. The encrypted message consists of a prefix of
+    // encryptedDataSize(size) - size bytes, which is written to |prefix|, followed by |data|.
+    virtual bool encryptInPlace(void* prefix, void* data, size_t size) = 0;
+
+    // Encrypts a message which can be lost or reordered on the way. The IV is derived from
+    // |sequence| instead of the counter of the ordered messages, so |sequence| must be unique.
+    virtual bool encryptWithSequence(
+        uint64_t sequence, const void* in, size_t in_size, void* out) = 0;
 };
 
 } // namespace base
@@ -37,4 +37,18 @@ bool MessageEncryptorFake::encrypt(const void* in, size_t in_size, void* out)
     return true;
 }
 
+bool MessageEncryptorFake::encryptInPlace(void* /* prefix */, void* /* data */,
+                                          size_t /* size */)
+{
+    // The data is not encrypted.
+    return true;
+}
+
+bool MessageEncryptorFake::encryptWithSequence(
+    uint64_t /* sequence */, const void* in, size_t in_size, void* out)
+{
+    memcpy(out, in, in_size);
+    return true;
+}
+
 } // namespace base
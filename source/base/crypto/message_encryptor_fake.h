@@ -33,6 +33,9 @@ public:
     // MessageEncryptor implementation.
     size_t encryptedDataSize(size_t in_size) override;
     bool encrypt(const void* in, size_t in_size, void* out) override;
+    bool encryptInPlace(void* prefix, void* data, size_t size) override;
+    bool encryptWithSequence(
+        uint64_t sequence, const void* in, size_t in_size, void* out) override;
 
 private:
     DISALLOW_COPY_AND_ASSIGN(MessageEncryptorFake);
@@ -19,6 +19,7 @@
 #include "base/crypto/message_encryptor_openssl.h"
 
 #include "base/logging.h"
+#include "base/trace_event.h"
 #include "base/crypto/large_number_increment.h"
 
 #include <openssl/evp.h>
@@ -35,6 +36,7 @@ const int kTagSize = 16; // 128 bits, 16 bytes.
 
 MessageEncryptorOpenssl::MessageEncryptorOpenssl(EVP_CIPHER_CTX_ptr ctx, const ByteArray& iv)
     : ctx_(std::move(ctx)),
+      initial_iv_(iv),
       iv_(iv)
 {
     DCHECK_EQ(EVP_CIPHER_CTX_key_length(ctx_.get()), kKeySize);
@@ -92,7 +94,35 @@ size_t MessageEncryptorOpenssl::encryptedDataSize(size_t in_size)
 
 bool MessageEncryptorOpenssl::encrypt(const void* in, size_t in_size, void* out)
 {
-    if (EVP_EncryptInit_ex(ctx_.get(), nullptr, nullptr, nullptr, iv_.data()) != 1)
+    if (!encryptImpl(iv_.data(), in, in_size, reinterpret_cast<uint8_t*>(out) + kTagSize, out))
+        return false;
+
+    largeNumberIncrement(&iv_);
+    return true;
+}
+
+bool MessageEncryptorOpenssl::encryptInPlace(void* prefix, void* data, size_t size)
+{
+    if (!encryptImpl(iv_.data(), data, size, data, prefix))
+        return false;
+
+    largeNumberIncrement(&iv_);
+    return true;
+}
+
+bool MessageEncryptorOpenssl::encryptWithSequence(
+    uint64_t sequence, const void* in, size_t in_size, void* out)
+{
+    const ByteArray iv = sequenceIV(initial_iv_, sequence);
+    return encryptImpl(iv.data(), in, in_size, reinterpret_cast<uint8_t*>(out) + kTagSize, out);
+}
+
+bool MessageEncryptorOpenssl::encryptImpl(
+    const uint8_t* iv, const void* in, size_t in_size, void* out, void* tag)
+{
+    TRACE_EVENT("encrypt");
+
+    if (EVP_EncryptInit_ex(ctx_.get(), nullptr, nullptr, nullptr, iv) != 1)
     {
         LOG(LS_WARNING) << "EVP_EncryptInit_ex failed";
         return false;
@@ -101,7 +131,7 @@ bool MessageEncryptorOpenssl::encrypt(const void* in, size_t in_size, void* out)
     int length;
 
     if (EVP_EncryptUpdate(ctx_.get(),
-                          reinterpret_cast<uint8_t*>(out) + kTagSize, &length,
+                          reinterpret_cast<uint8_t*>(out), &length,
                           reinterpret_cast<const uint8_t*>(in), static_cast<int>(in_size)) != 1)
     {
         LOG(LS_WARNING) << "EVP_EncryptUpdate failed";
@@ -109,20 +139,19 @@ bool MessageEncryptorOpenssl::encrypt(const void* in, size_t in_size, void* out)
     }
 
     if (EVP_EncryptFinal_ex(ctx_.get(),
-                            reinterpret_cast<uint8_t*>(out) + kTagSize + length,
+                            reinterpret_cast<uint8_t*>(out) + length,
                             &length) != 1)
     {
         LOG(LS_WARNING) << "EVP_EncryptFinal_ex failed";
         return false;
     }
 
-    if (EVP_CIPHER_CTX_ctrl(ctx_.get(), EVP_CTRL_AEAD_GET_TAG, kTagSize, out) != 1)
+    if (EVP_CIPHER_CTX_ctrl(ctx_.get(), EVP_CTRL_AEAD_GET_TAG, kTagSize, tag) != 1)
     {
         LOG(LS_WARNING) << "EVP_CIPHER_CTX_ctrl failed";
         return false;
     }
 
-    largeNumberIncrement(&iv_);
     return true;
 }
 
@@ -40,11 +40,19 @@ public:
     // MessageEncryptor implementation.
     size_t encryptedDataSize(size_t in_size) override;
     bool encrypt(const void* in, size_t in_size, void* out) override;
+    bool encryptInPlace(void* prefix, void* data, size_t size) override;
+    bool encryptWithSequence(
+        uint64_t sequence, const void* in, size_t in_size, void* out) override;
 
 private:
     MessageEncryptorOpenssl(EVP_CIPHER_CTX_ptr ctx, const ByteArray& iv);
 
+    // Encrypts |in_size| bytes of |in| to |out| with |iv| and writes the authentication tag to
+    // |tag|. |in| and |out| may point to the same buffer.
+    bool encryptImpl(const uint8_t* iv, const void* in, size_t in_size, void* out, void* tag);
+
     EVP_CIPHER_CTX_ptr ctx_;
+    const ByteArray initial_iv_;
     ByteArray iv_;
 
     DISALLOW_COPY_AND_ASSIGN(MessageEncryptorOpenssl);
@@ -125,4 +125,17 @@ EVP_CIPHER_CTX_ptr createCipher(CipherType type, CipherMode mode, const ByteArra
     return ctx;
 }
 
+ByteArray sequenceIV(const ByteArray& iv, uint64_t sequence)
+{
+    DCHECK_GE(iv.size(), sizeof(sequence));
+
+    ByteArray result = iv;
+    result[0] ^= 0x80;
+
+    for (size_t i = 0; i < sizeof(sequence); ++i)
+        result[result.size() - 1 - i] ^= static_cast<uint8_t>(sequence >> (i * 8));
+
+    return result;
+}
+
 } // namespace base
@@ -76,6 +76,11 @@ enum class CipherMode
 
 EVP_CIPHER_CTX_ptr createCipher(CipherType type, CipherMode mode, const ByteArray& key, int iv_size);
 
+// Returns the IV of the message with |sequence| for a stream with the initial IV |iv|. The highest
+// bit is inverted and the sequence is XORed into the lower 64 bits, so the IVs do not overlap with
+// the IVs of the ordered messages, which are incremented starting from |iv|.
+ByteArray sequenceIV(const ByteArray& iv, uint64_t sequence);
+
 } // namespace base
 
 #endif // BASE_CRYPTO_OPENSSL_UTIL_H
@@ -0,0 +1,312 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/desktop/block_region.h"
+
+#include "base/bitset.h"
+#include "base/logging.h"
+#include "build/build_config.h"
+
+#include <algorithm>
+
+#if defined(ARCH_CPU_X86_FAMILY)
+#include <emmintrin.h>
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+namespace base {
+
+BlockRegion::BlockRegion(const Size& size, int block_size)
+    : size_(size),
+      block_size_(block_size)
+{
+    DCHECK_GT(block_size_, 0);
+    DCHECK_GE(size_.width(), 0);
+    DCHECK_GE(size_.height(), 0);
+
+    columns_ = (size_.width() + block_size_ - 1) / block_size_;
+    rows_ = (size_.height() + block_size_ - 1) / block_size_;
+    words_per_row_ = (columns_ + kBitsPerWord - 1) / kBitsPerWord;
+
+    bits_.resize(static_cast<size_t>(words_per_row_ * rows_));
+}
+
+bool BlockRegion::isEmpty() const
+{
+    return std::all_of(bits_.cbegin(), bits_.cend(), [](Word word) { return word == 0; });
+}
+
+void BlockRegion::clear()
+{
+    std::fill(bits_.begin(), bits_.end(), 0);
+}
+
+bool BlockRegion::isBlockSet(int column, int row) const
+{
+    DCHECK(column >= 0 && column < columns_);
+    DCHECK(row >= 0 && row < rows_);
+
+    const Word word = rowBits(row)[column / kBitsPerWord];
+    return (word >> (column % kBitsPerWord)) & 1;
+}
+
+void BlockRegion::setBlock(int column, int row)
+{
+    DCHECK(column >= 0 && column < columns_);
+    DCHECK(row >= 0 && row < rows_);
+
+    rowBits(row)[column / kBitsPerWord] |= Word(1) << (column % kBitsPerWord);
+}
+
+void BlockRegion::clearBlock(int column, int row)
+{
+    DCHECK(column >= 0 && column < columns_);
+    DCHECK(row >= 0 && row < rows_);
+
+    rowBits(row)[column / kBitsPerWord] &= ~(Word(1) << (column % kBitsPerWord));
+}
+
+void BlockRegion::setRow(int row, const uint8_t* blocks, int count)
+{
+    DCHECK(row >= 0 && row < rows_);
+    DCHECK(count >= 0 && count <= columns_);
+
+    Word* bits = rowBits(row);
+    std::fill(bits, bits + words_per_row_, 0);
+
+    int column = 0;
+
+#if defined(ARCH_CPU_X86_FAMILY)
+    const __m128i zero = _mm_setzero_si128();
+
+    // Sixteen blocks at once. The mask of the comparison has one bit for each byte.
+    for (; column + 16 <= count; column += 16)
+    {
+        const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks + column));
+        const int zero_mask = _mm_movemask_epi8(_mm_cmpeq_epi8(values, zero));
+
+        bits[column / kBitsPerWord] |= Word(~zero_mask & 0xFFFF) << (column % kBitsPerWord);
+    }
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+    while (column < count)
+    {
+        const int index = column / kBitsPerWord;
+        const int last = std::min((index + 1) * kBitsPerWord, count);
+
+        // The loop has no branches, so the compiler is able to vectorize it.
+        Word word = 0;
+        for (int i = column; i < last; ++i)
+            word |= Word(blocks[i] != 0) << (i % kBitsPerWord);
+
+        bits[index] |= word;
+        column = last;
+    }
+}
+
+void BlockRegion::getRow(int row, uint8_t* blocks, int count) const
+{
+    DCHECK(row >= 0 && row < rows_);
+    DCHECK(count >= 0 && count <= columns_);
+
+    const Word* bits = rowBits(row);
+    int column = 0;
+
+#if defined(ARCH_CPU_X86_FAMILY)
+    const __m128i bit_mask = _mm_set_epi8(
+        -128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+    const __m128i one = _mm_set1_epi8(1);
+
+    // Sixteen blocks at once. The low byte of the bits is copied to the first eight bytes and the
+    // high byte to the last eight, then each byte tests its own bit.
+    for (; column + 16 <= count; column += 16)
+    {
+        const int value =
+            static_cast<int>((bits[column / kBitsPerWord] >> (column % kBitsPerWord)) & 0xFFFF);
+
+        __m128i spread = _mm_cvtsi32_si128(value);
+        spread = _mm_unpacklo_epi8(spread, spread);
+        spread = _mm_unpacklo_epi16(spread, spread);
+        spread = _mm_unpacklo_epi32(spread, spread);
+
+        const __m128i is_set = _mm_cmpeq_epi8(_mm_and_si128(spread, bit_mask), bit_mask);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(blocks + column), _mm_and_si128(is_set, one));
+    }
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+    for (; column < count; ++column)
+    {
+        blocks[column] =
+            static_cast<uint8_t>((bits[column / kBitsPerWord] >> (column % kBitsPerWord)) & 1);
+    }
+}
+
+size_t BlockRegion::count() const
+{
+    size_t result = 0;
+
+    for (Word word : bits_)
+        result += BitSet<Word>(word).count();
+
+    return result;
+}
+
+void BlockRegion::addRect(const Rect& rect)
+{
+    Rect clipped = rect;
+    clipped.intersectWith(Rect::makeSize(size_));
+    if (clipped.isEmpty())
+        return;
+
+    const int first_column = clipped.left() / block_size_;
+    const int last_column = (clipped.right() + block_size_ - 1) / block_size_;
+    const int first_row = clipped.top() / block_size_;
+    const int last_row = (clipped.bottom() + block_size_ - 1) / block_size_;
+
+    for (int row = first_row; row < last_row; ++row)
+        setRange(rowBits(row), first_column, last_column);
+}
+
+void BlockRegion::addRegion(const BlockRegion& region)
+{
+    if (!isCompatible(region))
+        return;
+
+    for (size_t i = 0; i < bits_.size(); ++i)
+        bits_[i] |= region.bits_[i];
+}
+
+void BlockRegion::intersectWith(const BlockRegion& region)
+{
+    if (!isCompatible(region))
+        return;
+
+    for (size_t i = 0; i < bits_.size(); ++i)
+        bits_[i] &= region.bits_[i];
+}
+
+void BlockRegion::subtract(const BlockRegion& region)
+{
+    if (!isCompatible(region))
+        return;
+
+    for (size_t i = 0; i < bits_.size(); ++i)
+        bits_[i] &= ~region.bits_[i];
+}
+
+bool BlockRegion::equals(const BlockRegion& region) const
+{
+    return size_.equals(region.size_) && block_size_ == region.block_size_ &&
+           bits_ == region.bits_;
+}
+
+void BlockRegion::toRegion(Region* region) const
+{
+    DCHECK(region);
+
+    std::vector<BoxRec> boxes;
+    int row = 0;
+
+    while (row < rows_)
+    {
+        const Word* bits = rowBits(row);
+
+        if (std::all_of(bits, bits + words_per_row_, [](Word word) { return word == 0; }))
+        {
+            ++row;
+            continue;
+        }
+
+        // Rows with the same blocks have the same rectangles and are merged into one band like
+        // Region does it.
+        int last_row = row + 1;
+        while (last_row < rows_ && std::equal(bits, bits + words_per_row_, rowBits(last_row)))
+            ++last_row;
+
+        const short y1 = static_cast<short>(row * block_size_);
+        const short y2 = static_cast<short>(std::min(last_row * block_size_, size_.height()));
+
+        int column = findBlock(bits, 0, true);
+        while (column < columns_)
+        {
+            const int end = findBlock(bits, column, false);
+
+            BoxRec box;
+            box.x1 = static_cast<short>(column * block_size_);
+            box.y1 = y1;
+            box.x2 = static_cast<short>(std::min(end * block_size_, size_.width()));
+            box.y2 = y2;
+            boxes.push_back(box);
+
+            column = findBlock(bits, end, true);
+        }
+
+        row = last_row;
+    }
+
+    region->setBandedBoxes(boxes.data(), static_cast<long>(boxes.size()));
+}
+
+bool BlockRegion::isCompatible(const BlockRegion& region) const
+{
+    if (!size_.equals(region.size_) || block_size_ != region.block_size_)
+    {
+        NOTREACHED();
+        return false;
+    }
+
+    return true;
+}
+
+int BlockRegion::findBlock(const Word* bits, int from, bool value) const
+{
+    if (from >= columns_)
+        return columns_;
+
+    int index = from / kBitsPerWord;
+
+    // The bits before |from| are masked out.
+    Word word = (value ? bits[index] : ~bits[index]) & (~Word(0) << (from % kBitsPerWord));
+
+    while (!word)
+    {
+        if (++index >= words_per_row_)
+            return columns_;
+
+        word = value ? bits[index] : ~bits[index];
+    }
+
+    // Bits beyond the last column are zero, so the search for a cleared block can stop there.
+    return std::min(index * kBitsPerWord + static_cast<int>(BitSet<Word>(word).findFirst()),
+                    columns_);
+}
+
+void BlockRegion::setRange(Word* bits, int first, int last)
+{
+    while (first < last)
+    {
+        const int index = first / kBitsPerWord;
+        const int offset = first % kBitsPerWord;
+        const int count = std::min(kBitsPerWord - offset, last - first);
+
+        const Word mask = (count == kBitsPerWord) ? ~Word(0) : ((Word(1) << count) - 1) << offset;
+        bits[index] |= mask;
+
+        first += count;
+    }
+}
+
+} // namespace base
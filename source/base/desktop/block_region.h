@@ -0,0 +1,112 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef BASE_DESKTOP_BLOCK_REGION_H
+#define BASE_DESKTOP_BLOCK_REGION_H
+
+#include "base/desktop/region.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace base {
+
+// BlockRegion represents a region made of square blocks aligned to a grid, like the changed blocks
+// found by Differ.
+//
+// The blocks are stored as a bitmap with one bit per block, so adding, intersecting and
+// subtracting regions are plain operations on machine words. Unlike Region, the cost of the
+// operations does not depend on the number of rectangles. The conversion to Region builds the
+// y-x banded rectangles directly from the rows of the bitmap.
+class BlockRegion
+{
+public:
+    BlockRegion(const Size& size, int block_size);
+    ~BlockRegion() = default;
+
+    BlockRegion(const BlockRegion& other) = default;
+    BlockRegion& operator=(const BlockRegion& other) = default;
+
+    const Size& size() const { return size_; }
+    int blockSize() const { return block_size_; }
+
+    // Number of blocks in a row and number of rows. The last column and the last row may be
+    // partially outside of the region size.
+    int columns() const { return columns_; }
+    int rows() const { return rows_; }
+
+    bool isEmpty() const;
+
+    // Reset the region to be empty.
+    void clear();
+
+    bool isBlockSet(int column, int row) const;
+    void setBlock(int column, int row);
+    void clearBlock(int column, int row);
+
+    // Sets the blocks of |row| from |count| bytes (one per block) where non-zero means that the
+    // block belongs to the region. The remaining blocks of the row are cleared.
+    void setRow(int row, const uint8_t* blocks, int count);
+
+    // Stores the first |count| blocks of |row| in |count| bytes: 1 for the blocks of the region
+    // and 0 for the others.
+    void getRow(int row, uint8_t* blocks, int count) const;
+
+    // Returns the number of blocks in the region.
+    size_t count() const;
+
+    // Adds all blocks that intersect with |rect|.
+    void addRect(const Rect& rect);
+
+    // The following operations require regions with the same size and block size.
+    void addRegion(const BlockRegion& region);
+    void intersectWith(const BlockRegion& region);
+    void subtract(const BlockRegion& region);
+
+    bool equals(const BlockRegion& region) const;
+
+    // Stores the blocks in |region|. The rectangles are clipped by the region size.
+    void toRegion(Region* region) const;
+
+private:
+    using Word = uint64_t;
+    static const int kBitsPerWord = 64;
+
+    bool isCompatible(const BlockRegion& region) const;
+
+    Word* rowBits(int row) { return bits_.data() + row * words_per_row_; }
+    const Word* rowBits(int row) const { return bits_.data() + row * words_per_row_; }
+
+    // Returns the index of the first block starting from |from| which is set (or cleared if
+    // |value| is false) or |columns_| if there is no such block.
+    int findBlock(const Word* bits, int from, bool value) const;
+
+    void setRange(Word* bits, int first, int last);
+
+    Size size_;
+    int block_size_;
+    int columns_;
+    int rows_;
+    int words_per_row_;
+
+    // Bits beyond the last column are always zero.
+    std::vector<Word> bits_;
+};
+
+} // namespace base
+
+#endif // BASE_DESKTOP_BLOCK_REGION_H
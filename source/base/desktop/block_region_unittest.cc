@@ -0,0 +1,381 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/desktop/block_region.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+namespace base {
+
+namespace {
+
+const int kBlockSize = 16;
+
+// Builds the same region from the rects of the blocks with Region::addRect.
+Region referenceRegion(const BlockRegion& blocks)
+{
+    const Rect bounds = Rect::makeSize(blocks.size());
+    Region region;
+
+    for (int row = 0; row < blocks.rows(); ++row)
+    {
+        for (int column = 0; column < blocks.columns(); ++column)
+        {
+            if (!blocks.isBlockSet(column, row))
+                continue;
+
+            Rect rect = Rect::makeXYWH(column * kBlockSize, row * kBlockSize,
+                                       kBlockSize, kBlockSize);
+            rect.intersectWith(bounds);
+            region.addRect(rect);
+        }
+    }
+
+    return region;
+}
+
+void expectSameRegion(const BlockRegion& blocks)
+{
+    Region region;
+    blocks.toRegion(&region);
+
+    Region expected = referenceRegion(blocks);
+    EXPECT_TRUE(region.equals(expected));
+
+    // The rects must be the same and in the same order.
+    Region::Iterator it(region);
+    Region::Iterator expected_it(expected);
+
+    while (!expected_it.isAtEnd())
+    {
+        ASSERT_FALSE(it.isAtEnd());
+        EXPECT_TRUE(it.rect().equals(expected_it.rect()));
+
+        it.advance();
+        expected_it.advance();
+    }
+
+    EXPECT_TRUE(it.isAtEnd());
+}
+
+std::vector<std::vector<Rect>> benchmarkCases()
+{
+    const int kTimesToRun = 1000;
+
+    std::mt19937 generator(1234);
+    auto randomInt = [&](int max) { return static_cast<int>(generator() % max); };
+
+    std::vector<std::vector<Rect>> cases;
+    for (int c = 0; c < kTimesToRun; ++c)
+    {
+        std::vector<Rect> rects;
+
+        for (int i = 0; i < 10; ++i)
+            rects.emplace_back(Rect::makeXYWH(randomInt(1000), randomInt(1000), 200, 200));
+
+        for (int i = 0; i < 1000; ++i)
+        {
+            rects.emplace_back(Rect::makeXYWH(randomInt(1000), randomInt(1000),
+                                              5 + randomInt(10) * 5, 5 + randomInt(10) * 5));
+        }
+
+        cases.emplace_back(std::move(rects));
+    }
+
+    return cases;
+}
+
+} // namespace
+
+TEST(block_region_test, empty)
+{
+    BlockRegion blocks(Size(100, 50), kBlockSize);
+
+    EXPECT_EQ(blocks.columns(), 7);
+    EXPECT_EQ(blocks.rows(), 4);
+    EXPECT_TRUE(blocks.isEmpty());
+
+    Region region(Rect::makeXYWH(0, 0, 10, 10));
+    blocks.toRegion(&region);
+    EXPECT_TRUE(region.isEmpty());
+}
+
+TEST(block_region_test, set_and_clear_blocks)
+{
+    BlockRegion blocks(Size(2000, 100), kBlockSize);
+
+    blocks.setBlock(0, 0);
+    blocks.setBlock(64, 1);
+    blocks.setBlock(124, 6);
+
+    EXPECT_FALSE(blocks.isEmpty());
+    EXPECT_TRUE(blocks.isBlockSet(0, 0));
+    EXPECT_TRUE(blocks.isBlockSet(64, 1));
+    EXPECT_TRUE(blocks.isBlockSet(124, 6));
+    EXPECT_FALSE(blocks.isBlockSet(1, 0));
+    EXPECT_FALSE(blocks.isBlockSet(63, 1));
+
+    blocks.clearBlock(64, 1);
+    EXPECT_FALSE(blocks.isBlockSet(64, 1));
+
+    blocks.clear();
+    EXPECT_TRUE(blocks.isEmpty());
+}
+
+TEST(block_region_test, single_block)
+{
+    BlockRegion blocks(Size(100, 100), kBlockSize);
+    blocks.setBlock(2, 3);
+
+    Region region;
+    blocks.toRegion(&region);
+
+    Region::Iterator it(region);
+    ASSERT_FALSE(it.isAtEnd());
+    EXPECT_TRUE(it.rect().equals(Rect::makeXYWH(32, 48, 16, 16)));
+    it.advance();
+    EXPECT_TRUE(it.isAtEnd());
+}
+
+TEST(block_region_test, add_rect)
+{
+    BlockRegion blocks(Size(100, 100), kBlockSize);
+
+    // The rect is rounded out to the blocks.
+    blocks.addRect(Rect::makeLTRB(20, 10, 33, 16));
+
+    Region region;
+    blocks.toRegion(&region);
+    EXPECT_TRUE(region.equals(Region(Rect::makeLTRB(16, 0, 48, 16))));
+
+    // The rects outside of the size are ignored.
+    blocks.clear();
+    blocks.addRect(Rect::makeXYWH(200, 200, 10, 10));
+    EXPECT_TRUE(blocks.isEmpty());
+}
+
+TEST(block_region_test, partial_blocks)
+{
+    // The last column and the last row are clipped by the size.
+    BlockRegion blocks(Size(40, 20), kBlockSize);
+    blocks.addRect(Rect::makeSize(Size(40, 20)));
+
+    Region region;
+    blocks.toRegion(&region);
+    EXPECT_TRUE(region.equals(Region(Rect::makeXYWH(0, 0, 40, 20))));
+
+    expectSameRegion(blocks);
+}
+
+TEST(block_region_test, set_row)
+{
+    BlockRegion blocks(Size(80, 32), kBlockSize);
+
+    const uint8_t row0[] = { 1, 1, 0, 0, 1 };
+    const uint8_t row1[] = { 1, 1, 0 };
+
+    blocks.setRow(0, row0, 5);
+    blocks.setRow(1, row1, 3);
+
+    EXPECT_TRUE(blocks.isBlockSet(0, 0));
+    EXPECT_TRUE(blocks.isBlockSet(4, 0));
+    EXPECT_FALSE(blocks.isBlockSet(2, 0));
+    EXPECT_FALSE(blocks.isBlockSet(4, 1));
+
+    const Rect expected[] =
+    {
+        Rect::makeLTRB(0, 0, 32, 16),
+        Rect::makeLTRB(64, 0, 80, 16),
+        Rect::makeLTRB(0, 16, 32, 32)
+    };
+
+    Region region;
+    blocks.toRegion(&region);
+
+    Region::Iterator it(region);
+    for (const Rect& rect : expected)
+    {
+        ASSERT_FALSE(it.isAtEnd());
+        EXPECT_TRUE(it.rect().equals(rect));
+        it.advance();
+    }
+    EXPECT_TRUE(it.isAtEnd());
+}
+
+TEST(block_region_test, get_row)
+{
+    std::mt19937 generator(4321);
+
+    // The rows are longer than one word and are not a multiple of the vector size.
+    BlockRegion blocks(Size(150 * kBlockSize, 3 * kBlockSize), kBlockSize);
+    std::vector<uint8_t> row(static_cast<size_t>(blocks.columns()));
+    size_t count = 0;
+
+    for (int y = 0; y < blocks.rows(); ++y)
+    {
+        for (auto& block : row)
+        {
+            block = static_cast<uint8_t>(generator() % 3);
+            count += block != 0;
+        }
+
+        blocks.setRow(y, row.data(), blocks.columns());
+
+        std::vector<uint8_t> result(row.size(), 0xFF);
+        blocks.getRow(y, result.data(), blocks.columns());
+
+        for (int x = 0; x < blocks.columns(); ++x)
+        {
+            EXPECT_EQ(blocks.isBlockSet(x, y), row[x] != 0);
+            EXPECT_EQ(result[x], row[x] != 0 ? 1 : 0);
+        }
+    }
+
+    EXPECT_EQ(blocks.count(), count);
+
+    // The blocks beyond |count| are cleared.
+    blocks.setRow(0, row.data(), 17);
+    for (int x = 17; x < blocks.columns(); ++x)
+        EXPECT_FALSE(blocks.isBlockSet(x, 0));
+}
+
+TEST(block_region_test, region_operations)
+{
+    const Size size(300, 200);
+
+    BlockRegion first(size, kBlockSize);
+    first.addRect(Rect::makeXYWH(0, 0, 160, 160));
+
+    BlockRegion second(size, kBlockSize);
+    second.addRect(Rect::makeXYWH(80, 80, 160, 160));
+
+    BlockRegion result = first;
+    result.addRegion(second);
+
+    Region expected(Rect::makeXYWH(0, 0, 160, 160));
+    expected.addRect(Rect::makeLTRB(80, 80, 240, 200));
+
+    Region region;
+    result.toRegion(&region);
+    EXPECT_TRUE(region.equals(expected));
+
+    result = first;
+    result.intersectWith(second);
+    result.toRegion(&region);
+    EXPECT_TRUE(region.equals(Region(Rect::makeLTRB(80, 80, 160, 160))));
+
+    result = first;
+    result.subtract(second);
+
+    expected = Region(Rect::makeXYWH(0, 0, 160, 160));
+    expected.subtract(Rect::makeLTRB(80, 80, 160, 160));
+
+    result.toRegion(&region);
+    EXPECT_TRUE(region.equals(expected));
+
+    EXPECT_TRUE(first.equals(first));
+    EXPECT_FALSE(first.equals(second));
+}
+
+TEST(block_region_test, random_blocks)
+{
+    std::mt19937 generator(1234);
+
+    const Size sizes[] = { Size(1920, 1080), Size(1366, 768), Size(100, 7), Size(1029, 1) };
+
+    for (const Size& size : sizes)
+    {
+        BlockRegion blocks(size, kBlockSize);
+
+        for (int density : { 2, 10, 50, 90 })
+        {
+            SCOPED_TRACE(density);
+
+            blocks.clear();
+
+            for (int row = 0; row < blocks.rows(); ++row)
+            {
+                for (int column = 0; column < blocks.columns(); ++column)
+                {
+                    if (static_cast<int>(generator() % 100) < density)
+                        blocks.setBlock(column, row);
+                }
+
+                // Repeat some of the rows to get bands of several rows.
+                if (row + 1 < blocks.rows() && generator() % 4 == 0)
+                {
+                    ++row;
+                    for (int column = 0; column < blocks.columns(); ++column)
+                    {
+                        if (blocks.isBlockSet(column, row - 1))
+                            blocks.setBlock(column, row);
+                    }
+                }
+            }
+
+            expectSameRegion(blocks);
+        }
+    }
+}
+
+// Same case as desktop_region_test.performance, but the rects are added to the blocks.
+TEST(block_region_test, DISABLED_benchmark)
+{
+    const std::vector<std::vector<Rect>> cases = benchmarkCases();
+    BlockRegion blocks(Size(1920, 1080), kBlockSize);
+
+    for (const auto& rects : cases)
+    {
+        blocks.clear();
+        for (const Rect& rect : rects)
+            blocks.addRect(rect);
+
+        Region region;
+        blocks.toRegion(&region);
+
+        for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+        {
+        }
+    }
+}
+
+// The same rects rounded out to the blocks and added to Region.
+TEST(block_region_test, DISABLED_benchmark_reference)
+{
+    const std::vector<std::vector<Rect>> cases = benchmarkCases();
+
+    for (const auto& rects : cases)
+    {
+        Region region;
+        for (const Rect& rect : rects)
+        {
+            region.addRect(Rect::makeLTRB(
+                rect.left() / kBlockSize * kBlockSize,
+                rect.top() / kBlockSize * kBlockSize,
+                (rect.right() + kBlockSize - 1) / kBlockSize * kBlockSize,
+                (rect.bottom() + kBlockSize - 1) / kBlockSize * kBlockSize));
+        }
+
+        for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+        {
+        }
+    }
+}
+
+} // namespace base
@@ -0,0 +1,207 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/capture_rate_controller.h"
+
+#include "base/logging.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace base {
+
+namespace {
+
+// Smoothing factor of moving averages for frame statistics.
+const double kFrameAlpha = 0.25;
+
+// Smoothing factor of moving average for throughput.
+const double kThroughputAlpha = 0.5;
+
+// Fraction of the changed area starting from which the screen is considered active.
+const double kActiveDirtyFraction = 0.01;
+
+// The share of the capture interval that the encoder is allowed to take.
+const double kMaxEncoderLoad = 0.8;
+
+// The share of the throughput that video is allowed to take.
+const double kMaxNetworkLoad = 0.9;
+
+// Queue delay at which the rate starts to decrease.
+const double kTargetQueueDelay = 0.1;
+
+// Queue delay at which the congested state is entered.
+const double kCriticalQueueDelay = 1.0;
+
+// Number of messages in the queue at which the congested state is entered (used while the
+// throughput is not yet known).
+const size_t kCriticalPendingMessages = 12;
+
+// Multiplicative decrease factor.
+const double kDecreaseFactor = 0.8;
+
+// Additive increase in FPS per second.
+const double kIncreasePerSecond = 4.0;
+
+double movingAverage(double average, double value, double alpha)
+{
+    return alpha * value + (1.0 - alpha) * average;
+}
+
+} // namespace
+
+CaptureRateController::CaptureRateController(int min_fps, int max_fps, int initial_fps)
+    : min_fps_(min_fps),
+      max_fps_(std::max(min_fps, max_fps)),
+      fps_(std::clamp(initial_fps, min_fps_, max_fps_))
+{
+    // Nothing
+}
+
+void CaptureRateController::onFrameEncoded(double dirty_fraction,
+                                           const std::chrono::microseconds& encode_time,
+                                           size_t encoded_bytes)
+{
+    const double encode_seconds = static_cast<double>(encode_time.count()) / 1000000.0;
+
+    dirty_fraction_ = movingAverage(dirty_fraction_, std::clamp(dirty_fraction, 0.0, 1.0),
+                                    kFrameAlpha);
+    encode_time_ = movingAverage(encode_time_, encode_seconds, kFrameAlpha);
+    frame_bytes_ = movingAverage(frame_bytes_, static_cast<double>(encoded_bytes), kFrameAlpha);
+}
+
+bool CaptureRateController::update(const TimePoint& now,
+                                   size_t pending_messages,
+                                   size_t pending_bytes,
+                                   int64_t total_tx)
+{
+    if (!has_update_)
+    {
+        has_update_ = true;
+        last_update_time_ = now;
+        last_total_tx_ = total_tx;
+        last_pending_bytes_ = pending_bytes;
+        return false;
+    }
+
+    const double elapsed = std::chrono::duration<double>(now - last_update_time_).count();
+    if (elapsed <= 0)
+        return false;
+
+    const double sent_rate = static_cast<double>(total_tx - last_total_tx_) / elapsed;
+    const bool was_backlogged = last_pending_bytes_ != 0;
+
+    if (was_backlogged)
+    {
+        // During the interval the channel always had data to send, so the rate of sending is
+        // limited by the network.
+        throughput_ = (throughput_ == 0) ?
+            sent_rate : movingAverage(throughput_, sent_rate, kThroughputAlpha);
+    }
+    else
+    {
+        // The rate of sending is limited by the application. The network can send at least
+        // as much.
+        throughput_ = std::max(throughput_, sent_rate);
+    }
+
+    double queue_delay = 0;
+    if (pending_bytes != 0)
+    {
+        queue_delay = (throughput_ > 0) ?
+            static_cast<double>(pending_bytes) / throughput_ : kCriticalQueueDelay;
+    }
+
+    const int old_fps = targetFps();
+    const double min_fps = static_cast<double>(min_fps_);
+
+    if (congested_)
+    {
+        // Leave the congested state only after the queue is completely drained.
+        if (pending_messages == 0)
+        {
+            LOG(LS_INFO) << "Congestion finished (FPS: " << targetFps() << ")";
+            congested_ = false;
+        }
+    }
+    else if (pending_messages > kCriticalPendingMessages || queue_delay >= kCriticalQueueDelay)
+    {
+        congested_ = true;
+        fps_ = std::max(fps_ / 2, min_fps);
+
+        LOG(LS_INFO) << "Congestion detected (pending: " << pending_messages << "/"
+                     << pending_bytes << " bytes, delay: " << queue_delay << "s)";
+    }
+    else if (queue_delay > kTargetQueueDelay)
+    {
+        // The queue is growing or is not drained fast enough.
+        if (queue_delay >= last_queue_delay_ * kDecreaseFactor)
+            fps_ = std::max(fps_ * kDecreaseFactor, min_fps);
+    }
+    else
+    {
+        const double ceiling = ceilingFps();
+
+        if (dirty_fraction_ >= kActiveDirtyFraction && queue_delay < kTargetQueueDelay / 2)
+        {
+            // Activity burst while the network is free. Go to the maximum possible rate.
+            fps_ = std::max(fps_, ceiling);
+        }
+        else
+        {
+            fps_ = std::min(fps_ + kIncreasePerSecond * elapsed, std::max(ceiling, fps_));
+        }
+
+        // The ceiling can be lowered (for example, the encoding has become slower).
+        fps_ = std::max(std::min(fps_, ceiling), min_fps);
+    }
+
+    last_update_time_ = now;
+    last_total_tx_ = total_tx;
+    last_pending_bytes_ = pending_bytes;
+    last_queue_delay_ = queue_delay;
+
+    return targetFps() != old_fps;
+}
+
+int CaptureRateController::targetFps() const
+{
+    return std::clamp(static_cast<int>(std::lround(fps_)), min_fps_, max_fps_);
+}
+
+std::chrono::milliseconds CaptureRateController::queueDelay() const
+{
+    return std::chrono::milliseconds(static_cast<int64_t>(last_queue_delay_ * 1000.0));
+}
+
+double CaptureRateController::ceilingFps() const
+{
+    double ceiling = static_cast<double>(max_fps_);
+
+    // The encoder must have time to process frames.
+    if (encode_time_ > 0)
+        ceiling = std::min(ceiling, kMaxEncoderLoad / encode_time_);
+
+    // Encoded frames must fit into the network throughput.
+    if (throughput_ > 0 && frame_bytes_ > 0)
+        ceiling = std::min(ceiling, kMaxNetworkLoad * throughput_ / frame_bytes_);
+
+    return std::max(ceiling, static_cast<double>(min_fps_));
+}
+
+} // namespace base
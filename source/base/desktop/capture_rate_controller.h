@@ -0,0 +1,95 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_DESKTOP_CAPTURE_RATE_CONTROLLER_H
+#define BASE_DESKTOP_CAPTURE_RATE_CONTROLLER_H
+
+#include "base/macros_magic.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace base {
+
+// Selects the screen capture rate based on the activity on the screen, the encoding time and the
+// state of the outgoing network queue.
+// The rate is raised immediately when there is activity on the screen and the network is not
+// congested. If the queue delay grows, the rate is reduced multiplicatively. If the queue is
+// overflowed, the controller enters the congested state in which new frames should not be sent
+// until the queue is drained.
+class CaptureRateController
+{
+public:
+    using Clock = std::chrono::high_resolution_clock;
+    using TimePoint = std::chrono::time_point<Clock>;
+
+    CaptureRateController(int min_fps, int max_fps, int initial_fps);
+    ~CaptureRateController() = default;
+
+    // Must be called after each encoded frame. |dirty_fraction| is the fraction of the frame area
+    // which has been changed (from 0.0 to 1.0).
+    void onFrameEncoded(double dirty_fraction,
+                        const std::chrono::microseconds& encode_time,
+                        size_t encoded_bytes);
+
+    // Must be called periodically with the current state of the outgoing queue. |total_tx| is the
+    // total number of bytes sent by the channel. Returns true if the target FPS has been changed.
+    bool update(const TimePoint& now,
+                size_t pending_messages,
+                size_t pending_bytes,
+                int64_t total_tx);
+
+    int targetFps() const;
+    bool isCongested() const { return congested_; }
+
+    int minFps() const { return min_fps_; }
+    int maxFps() const { return max_fps_; }
+
+    // Estimated network throughput in bytes per second or 0 if not yet known.
+    int64_t throughput() const { return static_cast<int64_t>(throughput_); }
+
+    // Estimated queue delay at the last update.
+    std::chrono::milliseconds queueDelay() const;
+
+private:
+    double ceilingFps() const;
+
+    const int min_fps_;
+    const int max_fps_;
+    double fps_;
+
+    bool congested_ = false;
+    bool has_update_ = false;
+
+    TimePoint last_update_time_;
+    int64_t last_total_tx_ = 0;
+    size_t last_pending_bytes_ = 0;
+    double last_queue_delay_ = 0; // In seconds.
+    double throughput_ = 0;       // In bytes per second.
+
+    double dirty_fraction_ = 0;   // Moving average.
+    double encode_time_ = 0;      // Moving average in seconds.
+    double frame_bytes_ = 0;      // Moving average.
+
+    DISALLOW_COPY_AND_ASSIGN(CaptureRateController);
+};
+
+} // namespace base
+
+#endif // BASE_DESKTOP_CAPTURE_RATE_CONTROLLER_H
@@ -0,0 +1,138 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/capture_rate_controller.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+using Clock = CaptureRateController::Clock;
+using Milliseconds = std::chrono::milliseconds;
+
+const Milliseconds kTick(250);
+
+} // namespace
+
+TEST(CaptureRateControllerTest, RaiseOnActivity)
+{
+    CaptureRateController controller(1, 30, 10);
+    Clock::time_point time = Clock::now();
+
+    EXPECT_FALSE(controller.update(time, 0, 0, 0));
+
+    controller.onFrameEncoded(0.5, std::chrono::microseconds(1000), 1000);
+
+    time += kTick;
+    EXPECT_TRUE(controller.update(time, 0, 0, 0));
+
+    // The rate must be raised to the maximum right away.
+    EXPECT_EQ(controller.targetFps(), 30);
+    EXPECT_FALSE(controller.isCongested());
+}
+
+TEST(CaptureRateControllerTest, SmoothIncreaseWithoutActivity)
+{
+    CaptureRateController controller(1, 30, 10);
+    Clock::time_point time = Clock::now();
+
+    controller.update(time, 0, 0, 0);
+
+    time += kTick;
+    controller.update(time, 0, 0, 0);
+    EXPECT_EQ(controller.targetFps(), 11);
+
+    for (int i = 0; i < 100; ++i)
+    {
+        time += kTick;
+        controller.update(time, 0, 0, 0);
+    }
+
+    EXPECT_EQ(controller.targetFps(), 30);
+}
+
+TEST(CaptureRateControllerTest, EncoderLimit)
+{
+    CaptureRateController controller(1, 30, 30);
+    Clock::time_point time = Clock::now();
+
+    controller.update(time, 0, 0, 0);
+
+    // 80 ms per frame allows to encode only 10 frames per second.
+    for (int i = 0; i < 20; ++i)
+        controller.onFrameEncoded(0.5, std::chrono::microseconds(80000), 1000);
+
+    time += kTick;
+    controller.update(time, 0, 0, 0);
+
+    EXPECT_LE(controller.targetFps(), 11);
+}
+
+TEST(CaptureRateControllerTest, CongestionAndRecovery)
+{
+    CaptureRateController controller(1, 30, 30);
+    Clock::time_point time = Clock::now();
+    int64_t total_tx = 0;
+
+    controller.update(time, 0, 0, total_tx);
+
+    // The channel sends 100 KB per second, but the queue contains 200 KB.
+    time += Milliseconds(1000);
+    total_tx += 100000;
+    EXPECT_TRUE(controller.update(time, 3, 200000, total_tx));
+
+    EXPECT_TRUE(controller.isCongested());
+    EXPECT_EQ(controller.targetFps(), 15);
+    EXPECT_EQ(controller.throughput(), 100000);
+
+    // The queue is drained.
+    time += kTick;
+    total_tx += 25000;
+    controller.update(time, 0, 0, total_tx);
+    EXPECT_FALSE(controller.isCongested());
+
+    // Frames of 10 KB allow to send only 9 frames per second.
+    for (int i = 0; i < 20; ++i)
+        controller.onFrameEncoded(0.5, std::chrono::microseconds(1000), 10000);
+
+    time += kTick;
+    total_tx += 20000;
+    controller.update(time, 0, 0, total_tx);
+    EXPECT_EQ(controller.targetFps(), 9);
+}
+
+TEST(CaptureRateControllerTest, SmoothDecrease)
+{
+    CaptureRateController controller(1, 30, 30);
+    Clock::time_point time = Clock::now();
+    int64_t total_tx = 0;
+
+    controller.update(time, 0, 10000, total_tx);
+
+    // Throughput is 100 KB per second, queue delay is 200 ms.
+    time += Milliseconds(1000);
+    total_tx += 100000;
+    EXPECT_TRUE(controller.update(time, 2, 20000, total_tx));
+
+    EXPECT_FALSE(controller.isCongested());
+    EXPECT_EQ(controller.targetFps(), 24);
+}
+
+} // namespace base
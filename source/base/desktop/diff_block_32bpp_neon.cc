@@ -0,0 +1,89 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/diff_block_32bpp_neon.h"
+
+#if defined(HAS_DIFF_BLOCK_NEON)
+#include <arm_neon.h>
+#endif // defined(HAS_DIFF_BLOCK_NEON)
+
+namespace base {
+
+#if defined(HAS_DIFF_BLOCK_NEON)
+
+namespace {
+
+bool hasDifferences(uint8x16_t acc)
+{
+    const uint64x2_t value = vreinterpretq_u64_u8(acc);
+    return (vgetq_lane_u64(value, 0) | vgetq_lane_u64(value, 1)) != 0;
+}
+
+} // namespace
+
+uint8_t diffFullBlock_32bpp_32x32_NEON(
+    const uint8_t* image1, const uint8_t* image2, int bytes_per_row)
+{
+    for (int i = 0; i < 32; ++i)
+    {
+        // The row of the block is 128 bytes (8 x 128 bit).
+        uint8x16_t acc = veorq_u8(vld1q_u8(image1 + 0), vld1q_u8(image2 + 0));
+        acc = vorrq_u8(acc, veorq_u8(vld1q_u8(image1 + 16), vld1q_u8(image2 + 16)));
+        acc = vorrq_u8(acc, veorq_u8(vld1q_u8(image1 + 32), vld1q_u8(image2 + 32)));
+        acc = vorrq_u8(acc, veorq_u8(vld1q_u8(image1 + 48), vld1q_u8(image2 + 48)));
+        acc = vorrq_u8(acc, veorq_u8(vld1q_u8(image1 + 64), vld1q_u8(image2 + 64)));
+        acc = vorrq_u8(acc, veorq_u8(vld1q_u8(image1 + 80), vld1q_u8(image2 + 80)));
+        acc = vorrq_u8(acc, veorq_u8(vld1q_u8(image1 + 96), vld1q_u8(image2 + 96)));
+        acc = vorrq_u8(acc, veorq_u8(vld1q_u8(image1 + 112), vld1q_u8(image2 + 112)));
+
+        // If the row has differences.
+        if (hasDifferences(acc))
+            return 1U;
+
+        image1 += bytes_per_row;
+        image2 += bytes_per_row;
+    }
+
+    return 0U;
+}
+
+uint8_t diffFullBlock_32bpp_16x16_NEON(
+    const uint8_t* image1, const uint8_t* image2, int bytes_per_row)
+{
+    for (int i = 0; i < 16; ++i)
+    {
+        // The row of the block is 64 bytes (4 x 128 bit).
+        uint8x16_t acc = veorq_u8(vld1q_u8(image1 + 0), vld1q_u8(image2 + 0));
+        acc = vorrq_u8(acc, veorq_u8(vld1q_u8(image1 + 16), vld1q_u8(image2 + 16)));
+        acc = vorrq_u8(acc, veorq_u8(vld1q_u8(image1 + 32), vld1q_u8(image2 + 32)));
+        acc = vorrq_u8(acc, veorq_u8(vld1q_u8(image1 + 48), vld1q_u8(image2 + 48)));
+
+        // If the row has differences.
+        if (hasDifferences(acc))
+            return 1U;
+
+        image1 += bytes_per_row;
+        image2 += bytes_per_row;
+    }
+
+    return 0U;
+}
+
+#endif // defined(HAS_DIFF_BLOCK_NEON)
+
+} // namespace base
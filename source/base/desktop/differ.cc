@@ -18,11 +18,19 @@
 
 #include "base/desktop/differ.h"
 
+#include "base/crc32c.h"
 #include "base/logging.h"
-#include "base/desktop/diff_block_32bpp_sse2.h"
+#include "base/trace_event.h"
+#include "base/desktop/diff_block_32bpp_avx2.h"
 #include "base/desktop/diff_block_32bpp_c.h"
+#include "base/desktop/diff_block_32bpp_neon.h"
+#include "base/desktop/diff_block_32bpp_sse2.h"
+#include "base/threading/worker_pool.h"
 
+#include <algorithm>
 #include <cstring>
+#include <thread>
+
 #include <libyuv/cpu_id.h>
 
 namespace base {
@@ -33,6 +41,14 @@ const int kBlockSize = 16;
 const int kBytesPerPixel = 4;
 const int kBytesPerBlock = kBlockSize * kBytesPerPixel;
 
+// Maximum number of threads used to search for changed blocks. Memory bandwidth becomes the
+// bottleneck faster than the number of cores ends.
+const int kMaxThreadCount = 4;
+
+// Minimum number of block rows processed by one thread. For small screens the synchronization
+// overhead is higher than the gain from parallel processing.
+const int kMinBlockRowsPerThread = 32;
+
 // Check for diffs in upper-left portion of the block. The size of the portion to check is
 // specified by the |width| and |height| values.
 // Note that if we force the capturer to always return images whose width and height are multiples
@@ -55,17 +71,16 @@ uint8_t diffPartialBlock(const uint8_t* prev_image,
     return 0U;
 }
 
-
-
 } // namespace
 
-Differ::Differ(const Size& size)
+Differ::Differ(const Size& size, int thread_count)
     : screen_rect_(Rect::makeSize(size)),
       bytes_per_row_(size.width() * kBytesPerPixel),
       diff_width_(((size.width() + kBlockSize - 1) / kBlockSize) + 1),
       diff_height_(((size.height() + kBlockSize - 1) / kBlockSize) + 1),
       full_blocks_x_(size.width() / kBlockSize),
-      full_blocks_y_(size.height() / kBlockSize)
+      full_blocks_y_(size.height() / kBlockSize),
+      dirty_blocks_(size, kBlockSize)
 {
     LOG(LS_INFO) << "Screen size: " << size;
     LOG(LS_INFO) << "Bytes per row: " << bytes_per_row_;
@@ -77,6 +92,8 @@ Differ::Differ(const Size& size)
     diff_info_ = std::make_unique<uint8_t[]>(diff_info_size);
     memset(diff_info_.get(), 0, diff_info_size);
 
+    row_hashes_ = std::make_unique<uint32_t[]>(static_cast<size_t>(size.height()));
+
     // Calc size of partial blocks which may be present on right and bottom edge.
     partial_column_width_ = size.width() - (full_blocks_x_ * kBlockSize);
     partial_row_height_ = size.height() - (full_blocks_y_ * kBlockSize);
@@ -91,73 +108,164 @@ Differ::Differ(const Size& size)
 
     diff_full_block_func_ = diffFunction();
     CHECK(diff_full_block_func_);
+
+    thread_count = threadCount(thread_count, full_blocks_y_);
+    if (thread_count > 1)
+        worker_pool_ = std::make_unique<WorkerPool>(thread_count);
+
+    LOG(LS_INFO) << "Differ threads: " << thread_count;
 }
 
+Differ::~Differ() = default;
+
 // static
 Differ::DiffFullBlockFunc Differ::diffFunction()
 {
+#if defined(ARCH_CPU_X86_FAMILY)
+    if (libyuv::TestCpuFlag(libyuv::kCpuHasAVX2))
+    {
+        LOG(LS_INFO) << "AVX2 differ loaded";
+
+        if constexpr (kBlockSize == 16)
+            return diffFullBlock_32bpp_16x16_AVX2;
+        else if constexpr (kBlockSize == 32)
+            return diffFullBlock_32bpp_32x32_AVX2;
+    }
+
     if (libyuv::TestCpuFlag(libyuv::kCpuHasSSE2))
     {
-#if defined(ARCH_CPU_X86_FAMILY)
         LOG(LS_INFO) << "SSE2 differ loaded";
 
         if constexpr (kBlockSize == 16)
             return diffFullBlock_32bpp_16x16_SSE2;
         else if constexpr (kBlockSize == 32)
             return diffFullBlock_32bpp_32x32_SSE2;
-#endif // defined(ARCH_CPU_X86_FAMILY)
     }
-    else
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+#if defined(HAS_DIFF_BLOCK_NEON)
+    if (libyuv::TestCpuFlag(libyuv::kCpuHasNEON))
     {
-        LOG(LS_INFO) << "C differ loaded";
+        LOG(LS_INFO) << "NEON differ loaded";
 
         if constexpr (kBlockSize == 16)
-            return diffFullBlock_32bpp_16x16_C;
+            return diffFullBlock_32bpp_16x16_NEON;
         else if constexpr (kBlockSize == 32)
-            return diffFullBlock_32bpp_32x32_C;
+            return diffFullBlock_32bpp_32x32_NEON;
     }
+#endif // defined(HAS_DIFF_BLOCK_NEON)
+
+    LOG(LS_INFO) << "C differ loaded";
+
+    if constexpr (kBlockSize == 16)
+        return diffFullBlock_32bpp_16x16_C;
+    else if constexpr (kBlockSize == 32)
+        return diffFullBlock_32bpp_32x32_C;
 
     return nullptr;
 }
 
+// static
+int Differ::threadCount(int requested, int block_rows)
+{
+    const int max_by_size = std::max(block_rows / kMinBlockRowsPerThread, 1);
+
+    if (requested == kAutoThreadCount)
+    {
+        const int cores = static_cast<int>(std::thread::hardware_concurrency());
+
+        // Leave half of the cores for the encoder and other threads.
+        requested = std::clamp(cores / 2, 1, kMaxThreadCount);
+    }
+
+    return std::clamp(requested, 1, max_by_size);
+}
+
 // Identify all of the blocks that contain changed pixels.
 void Differ::markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_image)
 {
-    const uint8_t* prev_block_row_start = prev_image;
-    const uint8_t* curr_block_row_start = curr_image;
+    // The hashes of the rows of |prev_image| were calculated in the previous call.
+    const bool use_hashes = (prev_image == last_image_);
+
+    if (!worker_pool_)
+    {
+        markDirtyBlockRows(prev_image, curr_image, 0, full_blocks_y_, use_hashes);
+    }
+    else
+    {
+        const int thread_count = worker_pool_->threadCount();
+        const int rows_per_thread = (full_blocks_y_ + thread_count - 1) / thread_count;
+
+        // Each thread writes only to its own rows of |diff_info_| and |row_hashes_|, so no
+        // synchronization is required for the results.
+        worker_pool_->run([&](int index)
+        {
+            const int first_row = std::min(index * rows_per_thread, full_blocks_y_);
+            const int last_row = std::min(first_row + rows_per_thread, full_blocks_y_);
+
+            markDirtyBlockRows(prev_image, curr_image, first_row, last_row, use_hashes);
+        });
+    }
+
+    // If the screen height is not a multiple of the block size, then this handles the last partial
+    // row. This situation is far more common than the 'partial column' case.
+    if (partial_row_height_ != 0)
+        markDirtyPartialRow(prev_image, curr_image, use_hashes);
+
+    last_image_ = curr_image;
+}
+
+// Identify the changed blocks in full block rows [|first_row|; |last_row|).
+void Differ::markDirtyBlockRows(const uint8_t* prev_image, const uint8_t* curr_image,
+                                int first_row, int last_row, bool use_hashes)
+{
+    const uint8_t* prev_block_row_start = prev_image + first_row * block_stride_y_;
+    const uint8_t* curr_block_row_start = curr_image + first_row * block_stride_y_;
 
     // Offset from the start of one diff_info row to the next.
     const int diff_stride = diff_width_;
 
-    uint8_t* is_diff_row_start = diff_info_.get();
+    uint8_t* is_diff_row_start = diff_info_.get() + first_row * diff_stride;
 
-    for (int y = 0; y < full_blocks_y_; ++y)
+    for (int y = first_row; y < last_row; ++y)
     {
-        const uint8_t* prev_block = prev_block_row_start;
-        const uint8_t* curr_block = curr_block_row_start;
+        // Hashes must be updated for each block row, even if they are not used in this call.
+        const bool rows_changed = updateRowHashes(curr_image, y * kBlockSize, kBlockSize);
 
-        uint8_t* is_different = is_diff_row_start;
-
-        for (int x = 0; x < full_blocks_x_; ++x)
+        if (use_hashes && !rows_changed)
+        {
+            // None of the rows of the block row has changed. Skip the block comparison.
+            clearBlockRow(y);
+        }
+        else
         {
-            // Mark this block as being modified so that it gets incorporated into a dirty rect.
-            *is_different = diff_full_block_func_(prev_block, curr_block, bytes_per_row_);
+            const uint8_t* prev_block = prev_block_row_start;
+            const uint8_t* curr_block = curr_block_row_start;
 
-            prev_block += kBytesPerBlock;
-            curr_block += kBytesPerBlock;
+            uint8_t* is_different = is_diff_row_start;
 
-            ++is_different;
-        }
+            for (int x = 0; x < full_blocks_x_; ++x)
+            {
+                // Mark this block as being modified so that it gets incorporated into a dirty
+                // rect.
+                *is_different = diff_full_block_func_(prev_block, curr_block, bytes_per_row_);
 
-        // If there is a partial column at the end, handle it. This condition should rarely, if
-        // ever, occur.
-        if (partial_column_width_ != 0)
-        {
-            *is_different = diffPartialBlock(prev_block,
-                                             curr_block,
-                                             bytes_per_row_,
-                                             partial_column_width_ * kBytesPerPixel,
-                                             kBlockSize);
+                prev_block += kBytesPerBlock;
+                curr_block += kBytesPerBlock;
+
+                ++is_different;
+            }
+
+            // If there is a partial column at the end, handle it. This condition should rarely,
+            // if ever, occur.
+            if (partial_column_width_ != 0)
+            {
+                *is_different = diffPartialBlock(prev_block,
+                                                 curr_block,
+                                                 bytes_per_row_,
+                                                 partial_column_width_ * kBytesPerPixel,
+                                                 kBlockSize);
+            }
         }
 
         // Update pointers for next row.
@@ -166,135 +274,109 @@ void Differ::markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_imag
 
         is_diff_row_start += diff_stride;
     }
+}
 
-    // If the screen height is not a multiple of the block size, then this handles the last partial
-    // row. This situation is far more common than the 'partial column' case.
-    if (partial_row_height_ != 0)
+void Differ::markDirtyPartialRow(const uint8_t* prev_image, const uint8_t* curr_image,
+                                 bool use_hashes)
+{
+    const bool rows_changed =
+        updateRowHashes(curr_image, full_blocks_y_ * kBlockSize, partial_row_height_);
+
+    if (use_hashes && !rows_changed)
     {
-        const uint8_t* prev_block = prev_block_row_start;
-        const uint8_t* curr_block = curr_block_row_start;
+        clearBlockRow(full_blocks_y_);
+        return;
+    }
 
-        uint8_t* is_different = is_diff_row_start;
+    const uint8_t* prev_block = prev_image + full_blocks_y_ * block_stride_y_;
+    const uint8_t* curr_block = curr_image + full_blocks_y_ * block_stride_y_;
 
-        for (int x = 0; x < full_blocks_x_; ++x)
-        {
-            *is_different = diffPartialBlock(prev_block,
-                                             curr_block,
-                                             bytes_per_row_,
-                                             kBytesPerBlock,
-                                             partial_row_height_);
-
-            prev_block += kBytesPerBlock;
-            curr_block += kBytesPerBlock;
-            ++is_different;
-        }
+    uint8_t* is_different = diff_info_.get() + full_blocks_y_ * diff_width_;
 
-        if (partial_column_width_ != 0)
-        {
-            *is_different =
-                diffPartialBlock(prev_block,
-                                 curr_block,
-                                 bytes_per_row_,
-                                 partial_column_width_ * kBytesPerPixel,
-                                 partial_row_height_);
-        }
+    for (int x = 0; x < full_blocks_x_; ++x)
+    {
+        *is_different = diffPartialBlock(prev_block,
+                                         curr_block,
+                                         bytes_per_row_,
+                                         kBytesPerBlock,
+                                         partial_row_height_);
+
+        prev_block += kBytesPerBlock;
+        curr_block += kBytesPerBlock;
+        ++is_different;
+    }
+
+    if (partial_column_width_ != 0)
+    {
+        *is_different =
+            diffPartialBlock(prev_block,
+                             curr_block,
+                             bytes_per_row_,
+                             partial_column_width_ * kBytesPerPixel,
+                             partial_row_height_);
     }
 }
 
-// After the dirty blocks have been identified, this routine merges adjacent blocks into a region.
-// The goal is to minimize the region that covers the dirty blocks.
-void Differ::mergeBlocks(Region* dirty_region)
+// Calculates the hashes of |line_count| rows starting from |first_line| and stores them. Returns
+// true if at least one of the hashes differs from the stored one.
+bool Differ::updateRowHashes(const uint8_t* curr_image, int first_line, int line_count)
 {
-    uint8_t* is_diff_row_start = diff_info_.get();
-    const int diff_stride = diff_width_;
+    const uint8_t* line = curr_image + first_line * bytes_per_row_;
+    uint32_t* hash = row_hashes_.get() + first_line;
+    bool changed = false;
 
-    for (int y = 0; y < diff_height_; ++y)
+    for (int i = 0; i < line_count; ++i)
     {
-        uint8_t* is_different = is_diff_row_start;
+        const uint32_t new_hash =
+            crc32c(0xFFFFFFFF, line, static_cast<size_t>(bytes_per_row_));
 
-        for (int x = 0; x < diff_width_; ++x)
+        if (*hash != new_hash)
         {
-            // We've found a modified block. Look at blocks to the right and below to group this
-            // block with as many others as we can.
-            if (*is_different != 0)
-            {
-                // Width and height of the rectangle in blocks.
-                int width  = 1;
-                int height = 1;
-
-                *is_different = 0;
-
-                // Group with blocks to the right. We can keep looking until we find an unchanged
-                // block because we have a boundary block which is never marked as having diffs.
-                uint8_t* right = is_different + 1;
-
-                while (*right != 0)
-                {
-                    *right++ = 0;
-                    ++width;
-                }
-
-                // Group with blocks below. The entire width of blocks that we matched above much
-                // match for each row that we add.
-                uint8_t* bottom = is_different;
-                bool found_new_row;
-
-                do
-                {
-                    found_new_row = true;
-                    bottom += diff_stride;
-                    right = bottom;
-
-                    for (int x2 = 0; x2 < width; ++x2)
-                    {
-                        if (*right++ == 0)
-                            found_new_row = false;
-                    }
-
-                    if (found_new_row)
-                    {
-                        ++height;
-
-                        // We need to go back and erase the diff markers so that we don't try to
-                        // add these blocks a second time.
-                        right = bottom;
-
-                        for (int x2 = 0; x2 < width; ++x2)
-                        {
-                            *right++ = 0;
-                        }
-                    }
-                } while (found_new_row);
-
-                Rect dirty_rect = Rect::makeXYWH(x * kBlockSize, y * kBlockSize,
-                                                 width * kBlockSize, height * kBlockSize);
-
-                dirty_rect.intersectWith(screen_rect_);
-
-                // Add rect to region.
-                dirty_region->addRect(dirty_rect);
-            }
-
-            // Increment to next block in this row.
-            ++is_different;
+            *hash = new_hash;
+            changed = true;
         }
 
-        // Go to start of next row.
-        is_diff_row_start += diff_stride;
+        line += bytes_per_row_;
+        ++hash;
     }
+
+    return changed;
+}
+
+void Differ::clearBlockRow(int block_row)
+{
+    const size_t count = static_cast<size_t>(full_blocks_x_ + (partial_column_width_ ? 1 : 0));
+    memset(diff_info_.get() + block_row * diff_width_, 0, count);
+}
+
+// After the dirty blocks have been identified, this routine converts them into a region. The rows
+// with the same blocks are merged into one band, so the region is built without any unions.
+void Differ::mergeBlocks(Region* dirty_region)
+{
+    const uint8_t* is_diff_row_start = diff_info_.get();
+    const int columns = dirty_blocks_.columns();
+
+    for (int y = 0; y < dirty_blocks_.rows(); ++y)
+    {
+        dirty_blocks_.setRow(y, is_diff_row_start, columns);
+        is_diff_row_start += diff_width_;
+    }
+
+    // The rects of the partial column and the partial row are clipped by the screen size.
+    dirty_blocks_.toRegion(dirty_region);
 }
 
 void Differ::calcDirtyRegion(const uint8_t* prev_image,
                              const uint8_t* curr_image,
                              Region* dirty_region)
 {
-    dirty_region->clear();
+    TRACE_EVENT("diff");
 
     // Identify all the blocks that contain changed pixels.
     markDirtyBlocks(prev_image, curr_image);
 
     // Now that we've identified the blocks that have changed, merge adjacent blocks to minimize
-    // the number of rects that we return.
+    // the number of rects that we return. The previous content of |dirty_region| is replaced.
     mergeBlocks(dirty_region);
 }
 
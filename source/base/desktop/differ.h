@@ -20,19 +20,29 @@
 #define BASE_DESKTOP_DIFFER_H
 
 #include "base/macros_magic.h"
-#include "base/desktop/region.h"
+#include "base/desktop/block_region.h"
 
 #include <memory>
 
 namespace base {
 
+class WorkerPool;
+
 // Class to search for changed regions of the screen.
 class Differ
 {
 public:
-    explicit Differ(const Size& size);
-    ~Differ() = default;
+    // If |thread_count| is kAutoThreadCount, then the number of threads is selected based on the
+    // number of processor cores and the size of the screen.
+    static const int kAutoThreadCount = 0;
+
+    explicit Differ(const Size& size, int thread_count = 1);
+    ~Differ();
 
+    // Before comparing the blocks, the hashes of the rows of |curr_image| are compared with the
+    // hashes calculated in the previous call. Block rows without changed rows are skipped. Hashes
+    // are used only if |prev_image| is the |curr_image| of the previous call (it must not be
+    // modified between calls), otherwise all blocks are compared.
     void calcDirtyRegion(const uint8_t* prev_image,
                          const uint8_t* curr_image,
                          Region* changed_region);
@@ -41,8 +51,15 @@ private:
     typedef uint8_t(*DiffFullBlockFunc)(const uint8_t*, const uint8_t*, int);
 
     static DiffFullBlockFunc diffFunction();
+    static int threadCount(int requested, int block_rows);
 
     void markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_image);
+    void markDirtyBlockRows(const uint8_t* prev_image, const uint8_t* curr_image,
+                            int first_row, int last_row, bool use_hashes);
+    void markDirtyPartialRow(const uint8_t* prev_image, const uint8_t* curr_image,
+                             bool use_hashes);
+    bool updateRowHashes(const uint8_t* curr_image, int first_line, int line_count);
+    void clearBlockRow(int block_row);
     void mergeBlocks(Region* dirty_region);
 
     const Rect screen_rect_;
@@ -57,8 +74,15 @@ private:
     int block_stride_y_;
 
     std::unique_ptr<uint8_t[]> diff_info_;
+    BlockRegion dirty_blocks_;
     DiffFullBlockFunc diff_full_block_func_;
 
+    // Hash for each row of the last |curr_image|.
+    std::unique_ptr<uint32_t[]> row_hashes_;
+    const uint8_t* last_image_ = nullptr;
+
+    std::unique_ptr<WorkerPool> worker_pool_;
+
     DISALLOW_COPY_AND_ASSIGN(Differ);
 };
 
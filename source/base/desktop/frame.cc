@@ -20,6 +20,8 @@
 
 #include "base/logging.h"
 
+#include <libyuv/planar_functions.h>
+
 #include <cstring>
 
 namespace base {
@@ -61,9 +63,66 @@ void Frame::copyPixelsFrom(const uint8_t* src_buffer, int src_stride, const Rect
 
 void Frame::copyPixelsFrom(const Frame& src_frame, const Point& src_pos, const Rect& dest_rect)
 {
+    if (layout_ == Layout::I420 && src_frame.layout() == Layout::I420)
+    {
+        DCHECK(Rect::makeSize(size()).containsRect(dest_rect));
+        DCHECK_EQ(src_pos.x() & 1, 0);
+        DCHECK_EQ(src_pos.y() & 1, 0);
+        DCHECK_EQ(dest_rect.x() & 1, 0);
+        DCHECK_EQ(dest_rect.y() & 1, 0);
+
+        const int src_y_offset = src_frame.yStride() * src_pos.y() + src_pos.x();
+        const int src_uv_offset = src_frame.uvStride() * (src_pos.y() / 2) + (src_pos.x() / 2);
+        const int dst_y_offset = yStride() * dest_rect.y() + dest_rect.x();
+        const int dst_uv_offset = uvStride() * (dest_rect.y() / 2) + (dest_rect.x() / 2);
+
+        libyuv::I420Copy(src_frame.yPlane() + src_y_offset, src_frame.yStride(),
+                         src_frame.uPlane() + src_uv_offset, src_frame.uvStride(),
+                         src_frame.vPlane() + src_uv_offset, src_frame.uvStride(),
+                         yPlane() + dst_y_offset, yStride(),
+                         uPlane() + dst_uv_offset, uvStride(),
+                         vPlane() + dst_uv_offset, uvStride(),
+                         dest_rect.width(), dest_rect.height());
+        return;
+    }
+
+    DCHECK(layout_ == Layout::PACKED && src_frame.layout() == Layout::PACKED);
     copyPixelsFrom(src_frame.frameDataAtPos(src_pos), src_frame.stride(), dest_rect);
 }
 
+void Frame::movePixels(const Rect& src_rect, const Point& dest_pos)
+{
+    DCHECK(layout_ == Layout::PACKED);
+    DCHECK(Rect::makeSize(size()).containsRect(src_rect));
+    DCHECK(Rect::makeSize(size()).containsRect(Rect::makeXYWH(dest_pos, src_rect.size())));
+
+    const size_t bytes_per_row = static_cast<size_t>(format_.bytesPerPixel() * src_rect.width());
+    const int height = src_rect.height();
+
+    // When moving down, the rows are copied from the bottom, so that the source rows are not
+    // overwritten before they are copied.
+    const bool bottom_up = dest_pos.y() > src_rect.y();
+
+    for (int i = 0; i < height; ++i)
+    {
+        const int row = bottom_up ? height - 1 - i : i;
+
+        memmove(frameDataAtPos(dest_pos.x(), dest_pos.y() + row),
+                frameDataAtPos(src_rect.x(), src_rect.y() + row),
+                bytes_per_row);
+    }
+}
+
+uint8_t* Frame::uPlane() const
+{
+    return data_ + static_cast<size_t>(yStride()) * size_.height();
+}
+
+uint8_t* Frame::vPlane() const
+{
+    return uPlane() + static_cast<size_t>(uvStride()) * ((size_.height() + 1) / 2);
+}
+
 uint8_t* Frame::frameDataAtPos(const Point& pos) const
 {
     return frameDataAtPos(pos.x(), pos.y());
@@ -79,7 +138,11 @@ void Frame::copyFrameInfoFrom(const Frame& other)
     updated_region_ = other.updated_region_;
     top_left_ = other.top_left_;
     dpi_ = other.dpi_;
+    screen_size_ = other.screen_size_;
     capturer_type_ = other.capturer_type_;
+    layout_ = other.layout_;
+    capture_start_time_ = other.capture_start_time_;
+    capture_time_ = other.capture_time_;
 }
 
 // static
@@ -23,6 +23,8 @@
 #include "base/desktop/pixel_format.h"
 #include "base/desktop/region.h"
 
+#include <chrono>
+
 namespace base {
 
 class SharedMemoryBase;
@@ -32,6 +34,16 @@ class Frame
 public:
     virtual ~Frame() = default;
 
+    enum class Layout
+    {
+        // Pixels are stored in format().
+        PACKED = 0,
+
+        // The buffer holds planar YUV 4:2:0 data. The Y plane starts at frameData() and is
+        // followed by the U and V planes. The resolution of the chroma planes is rounded up.
+        I420 = 1
+    };
+
     SharedMemoryBase* sharedMemory() const { return shared_memory_; }
 
     uint8_t* frameDataAtPos(const Point& pos) const;
@@ -42,9 +54,18 @@ public:
     int stride() const { return stride_; }
     bool contains(int x, int y) const;
 
+    // Size of the buffer of the frame in bytes. The shared memory frames use the same amount.
+    size_t memorySize() const { return calcMemorySize(size_, format_.bytesPerPixel()); }
+
     void copyPixelsFrom(const uint8_t* src_buffer, int src_stride, const Rect& dest_rect);
+    // If both frames are in the I420 layout, the planes are copied. |src_pos| and |dest_rect|
+    // must be aligned to even coordinates in this case.
     void copyPixelsFrom(const Frame& src_frame, const Point& src_pos, const Rect& dest_rect);
 
+    // Copies |src_rect| of this frame to |dest_pos| of the same frame. The source and destination
+    // areas may overlap. The frame must be in the packed layout.
+    void movePixels(const Rect& src_rect, const Point& dest_pos);
+
     const Region& constUpdatedRegion() const { return updated_region_; }
     Region* updatedRegion() { return &updated_region_; }
 
@@ -54,6 +75,37 @@ public:
     void setCapturerType(uint32_t capturer_type) { capturer_type_ = capturer_type; }
     uint32_t capturerType() const { return capturer_type_; }
 
+    void setLayout(Layout layout) { layout_ = layout; }
+    Layout layout() const { return layout_; }
+
+    // Size of the screen the frame was captured from. It differs from size() if the capturer has
+    // scaled the image down.
+    void setScreenSize(const Size& screen_size) { screen_size_ = screen_size; }
+    const Size& screenSize() const { return screen_size_.isEmpty() ? size_ : screen_size_; }
+
+    // The start of the capture is a point of the steady clock, which is the same in all processes
+    // of the host. Zero values mean that the capture time is unknown.
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    void setCaptureStartTime(const TimePoint& capture_start_time)
+    {
+        capture_start_time_ = capture_start_time;
+    }
+    const TimePoint& captureStartTime() const { return capture_start_time_; }
+
+    void setCaptureTime(const std::chrono::microseconds& capture_time)
+    {
+        capture_time_ = capture_time;
+    }
+    const std::chrono::microseconds& captureTime() const { return capture_time_; }
+
+    // Plane accessors for frames in the I420 layout.
+    int yStride() const { return size_.width(); }
+    int uvStride() const { return (size_.width() + 1) / 2; }
+    uint8_t* yPlane() const { return data_; }
+    uint8_t* uPlane() const;
+    uint8_t* vPlane() const;
+
     // Copies various information from |other|. Anything initialized in constructor are not copied.
     // This function is usually used when sharing a source Frame with several clients: the original
     // Frame should be kept unchanged. For example and SharedFrame::share().
@@ -81,7 +133,11 @@ private:
     Region updated_region_;
     Point top_left_;
     Point dpi_;
+    Size screen_size_;
     uint32_t capturer_type_ = 0;
+    Layout layout_ = Layout::PACKED;
+    TimePoint capture_start_time_;
+    std::chrono::microseconds capture_time_ { 0 };
 
     DISALLOW_COPY_AND_ASSIGN(Frame);
 };
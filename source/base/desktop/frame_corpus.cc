@@ -0,0 +1,287 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/frame_corpus.h"
+
+#include "base/endian_util.h"
+#include "base/logging.h"
+#include "base/desktop/frame.h"
+
+namespace base {
+
+namespace {
+
+// "ACFC" - Aspia Captured Frame Corpus.
+const uint32_t kMagic = 0x43464341;
+const uint32_t kVersion = 1;
+const int kBytesPerPixel = 4;
+
+// Limits protect from allocating memory for a damaged file.
+const uint32_t kMaxScreenSize = 16384;
+const uint32_t kMaxRectCount = 65536;
+
+void writeValue(std::ofstream& stream, uint32_t value)
+{
+    value = EndianUtil::toLittle(value);
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+bool readValue(std::ifstream& stream, uint32_t* value)
+{
+    stream.read(reinterpret_cast<char*>(value), sizeof(*value));
+    if (stream.fail())
+        return false;
+
+    *value = EndianUtil::fromLittle(*value);
+    return true;
+}
+
+} // namespace
+
+FrameCorpusWriter::FrameCorpusWriter() = default;
+
+FrameCorpusWriter::~FrameCorpusWriter()
+{
+    close();
+}
+
+bool FrameCorpusWriter::open(const std::filesystem::path& file_path, const Size& screen_size)
+{
+    close();
+
+    if (screen_size.isEmpty())
+    {
+        LOG(LS_ERROR) << "Invalid screen size: " << screen_size;
+        return false;
+    }
+
+    stream_.open(file_path, std::ofstream::binary | std::ofstream::out | std::ofstream::trunc);
+    if (!stream_.is_open())
+    {
+        LOG(LS_ERROR) << "Unable to open file: " << file_path;
+        return false;
+    }
+
+    writeValue(stream_, kMagic);
+    writeValue(stream_, kVersion);
+    writeValue(stream_, static_cast<uint32_t>(screen_size.width()));
+    writeValue(stream_, static_cast<uint32_t>(screen_size.height()));
+
+    screen_rect_ = Rect::makeSize(screen_size);
+    frame_count_ = 0;
+    return !stream_.fail();
+}
+
+void FrameCorpusWriter::close()
+{
+    if (stream_.is_open())
+        stream_.close();
+}
+
+bool FrameCorpusWriter::writeFrame(const Frame& frame)
+{
+    if (!stream_.is_open())
+        return false;
+
+    if (frame.size() != screen_rect_.size() || frame.format().bytesPerPixel() != kBytesPerPixel)
+    {
+        LOG(LS_ERROR) << "Frame does not match the corpus";
+        return false;
+    }
+
+    // The first frame always contains the whole screen.
+    Region region;
+    if (!frame_count_)
+        region.addRect(screen_rect_);
+    else
+        region = frame.constUpdatedRegion();
+
+    region.intersectWith(screen_rect_);
+
+    uint32_t rect_count = 0;
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+        ++rect_count;
+
+    writeValue(stream_, rect_count);
+
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+
+        writeValue(stream_, static_cast<uint32_t>(rect.x()));
+        writeValue(stream_, static_cast<uint32_t>(rect.y()));
+        writeValue(stream_, static_cast<uint32_t>(rect.width()));
+        writeValue(stream_, static_cast<uint32_t>(rect.height()));
+
+        const std::streamsize row_size = rect.width() * kBytesPerPixel;
+        const uint8_t* row = frame.frameDataAtPos(rect.topLeft());
+
+        for (int y = 0; y < rect.height(); ++y)
+        {
+            stream_.write(reinterpret_cast<const char*>(row), row_size);
+            row += frame.stride();
+        }
+    }
+
+    if (stream_.fail())
+    {
+        LOG(LS_ERROR) << "Unable to write frame";
+        return false;
+    }
+
+    ++frame_count_;
+    return true;
+}
+
+FrameCorpusReader::FrameCorpusReader() = default;
+
+FrameCorpusReader::~FrameCorpusReader()
+{
+    close();
+}
+
+bool FrameCorpusReader::open(const std::filesystem::path& file_path)
+{
+    close();
+
+    stream_.open(file_path, std::ifstream::binary | std::ifstream::in);
+    if (!stream_.is_open())
+    {
+        LOG(LS_ERROR) << "Unable to open file: " << file_path;
+        return false;
+    }
+
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    if (!readValue(stream_, &magic) || !readValue(stream_, &version) ||
+        !readValue(stream_, &width) || !readValue(stream_, &height))
+    {
+        LOG(LS_ERROR) << "Unable to read corpus header";
+        close();
+        return false;
+    }
+
+    if (magic != kMagic || version != kVersion)
+    {
+        LOG(LS_ERROR) << "Unsupported corpus format";
+        close();
+        return false;
+    }
+
+    if (!width || !height || width > kMaxScreenSize || height > kMaxScreenSize)
+    {
+        LOG(LS_ERROR) << "Invalid screen size: " << width << "x" << height;
+        close();
+        return false;
+    }
+
+    screen_size_ = Size(static_cast<int32_t>(width), static_cast<int32_t>(height));
+    first_frame_pos_ = stream_.tellg();
+    return true;
+}
+
+void FrameCorpusReader::close()
+{
+    if (stream_.is_open())
+        stream_.close();
+}
+
+bool FrameCorpusReader::readFrame(Frame* frame)
+{
+    DCHECK(frame);
+
+    if (!stream_.is_open())
+        return false;
+
+    if (frame->size() != screen_size_ || frame->format().bytesPerPixel() != kBytesPerPixel)
+    {
+        LOG(LS_ERROR) << "Frame does not match the corpus";
+        return false;
+    }
+
+    uint32_t rect_count = 0;
+
+    // The end of the file is the normal end of the corpus.
+    if (!readValue(stream_, &rect_count))
+        return false;
+
+    if (rect_count > kMaxRectCount)
+    {
+        LOG(LS_ERROR) << "Invalid rect count: " << rect_count;
+        return false;
+    }
+
+    const Rect screen_rect = Rect::makeSize(screen_size_);
+    Region* updated_region = frame->updatedRegion();
+
+    updated_region->clear();
+
+    for (uint32_t i = 0; i < rect_count; ++i)
+    {
+        uint32_t x, y, width, height;
+
+        if (!readValue(stream_, &x) || !readValue(stream_, &y) ||
+            !readValue(stream_, &width) || !readValue(stream_, &height))
+        {
+            LOG(LS_ERROR) << "Unable to read rect";
+            return false;
+        }
+
+        const Rect rect = Rect::makeXYWH(static_cast<int32_t>(x), static_cast<int32_t>(y),
+                                         static_cast<int32_t>(width), static_cast<int32_t>(height));
+        if (!screen_rect.containsRect(rect))
+        {
+            LOG(LS_ERROR) << "Invalid rect: " << rect;
+            return false;
+        }
+
+        const std::streamsize row_size = rect.width() * kBytesPerPixel;
+        uint8_t* row = frame->frameDataAtPos(rect.topLeft());
+
+        for (int32_t row_index = 0; row_index < rect.height(); ++row_index)
+        {
+            stream_.read(reinterpret_cast<char*>(row), row_size);
+            row += frame->stride();
+        }
+
+        if (stream_.fail())
+        {
+            LOG(LS_ERROR) << "Unable to read rect pixels";
+            return false;
+        }
+
+        updated_region->addRect(rect);
+    }
+
+    return true;
+}
+
+bool FrameCorpusReader::rewind()
+{
+    if (!stream_.is_open())
+        return false;
+
+    stream_.clear();
+    stream_.seekg(first_frame_pos_);
+    return !stream_.fail();
+}
+
+} // namespace base
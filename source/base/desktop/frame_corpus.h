@@ -0,0 +1,86 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_DESKTOP_FRAME_CORPUS_H
+#define BASE_DESKTOP_FRAME_CORPUS_H
+
+#include "base/macros_magic.h"
+#include "base/desktop/geometry.h"
+
+#include <filesystem>
+#include <fstream>
+
+namespace base {
+
+class Frame;
+
+// The corpus is a file with a sequence of captured 32bpp frames. The first frame contains the
+// whole screen, each next frame contains only the pixels of its updated region. The corpus is used
+// to replay real desktop content in benchmarks.
+class FrameCorpusWriter
+{
+public:
+    FrameCorpusWriter();
+    ~FrameCorpusWriter();
+
+    bool open(const std::filesystem::path& file_path, const Size& screen_size);
+    void close();
+
+    // Writes the pixels of the updated region of |frame|.
+    bool writeFrame(const Frame& frame);
+
+    int frameCount() const { return frame_count_; }
+
+private:
+    std::ofstream stream_;
+    Rect screen_rect_;
+    int frame_count_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(FrameCorpusWriter);
+};
+
+class FrameCorpusReader
+{
+public:
+    FrameCorpusReader();
+    ~FrameCorpusReader();
+
+    bool open(const std::filesystem::path& file_path);
+    void close();
+
+    const Size& screenSize() const { return screen_size_; }
+
+    // Reads the next frame into |frame| and sets its updated region. The frame must have the size
+    // of the screen and must contain the previous frame of the corpus. Returns false at the end of
+    // the corpus or on error.
+    bool readFrame(Frame* frame);
+
+    // Starts reading from the first frame.
+    bool rewind();
+
+private:
+    std::ifstream stream_;
+    Size screen_size_;
+    std::streampos first_frame_pos_;
+
+    DISALLOW_COPY_AND_ASSIGN(FrameCorpusReader);
+};
+
+} // namespace base
+
+#endif // BASE_DESKTOP_FRAME_CORPUS_H
@@ -0,0 +1,133 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/frame_corpus.h"
+
+#include "base/desktop/frame_simple.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+const Size kScreenSize(67, 41);
+
+std::filesystem::path corpusPath()
+{
+    return std::filesystem::temp_directory_path() / "aspia_frame_corpus_test.bin";
+}
+
+void fillRect(Frame* frame, const Rect& rect, uint8_t value)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint8_t* row = frame->frameDataAtPos(rect.left(), y);
+
+        for (int x = 0; x < rect.width() * frame->format().bytesPerPixel(); ++x)
+            row[x] = static_cast<uint8_t>(value + x + y);
+    }
+}
+
+bool isEqualPixels(const Frame& frame1, const Frame& frame2)
+{
+    const size_t row_size =
+        static_cast<size_t>(frame1.size().width() * frame1.format().bytesPerPixel());
+
+    for (int y = 0; y < frame1.size().height(); ++y)
+    {
+        if (memcmp(frame1.frameDataAtPos(0, y), frame2.frameDataAtPos(0, y), row_size) != 0)
+            return false;
+    }
+
+    return true;
+}
+
+} // namespace
+
+TEST(frame_corpus_test, write_and_read)
+{
+    const std::filesystem::path file_path = corpusPath();
+
+    std::unique_ptr<Frame> source_frame = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+    std::unique_ptr<Frame> target_frame = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+
+    const Rect rects[] = { Rect::makeXYWH(3, 5, 10, 7), Rect::makeXYWH(40, 20, 27, 21) };
+
+    {
+        FrameCorpusWriter writer;
+        ASSERT_TRUE(writer.open(file_path, kScreenSize));
+
+        fillRect(source_frame.get(), Rect::makeSize(kScreenSize), 1);
+        ASSERT_TRUE(writer.writeFrame(*source_frame));
+
+        for (size_t i = 0; i < std::size(rects); ++i)
+        {
+            fillRect(source_frame.get(), rects[i], static_cast<uint8_t>(i * 50));
+
+            source_frame->updatedRegion()->clear();
+            source_frame->updatedRegion()->addRect(rects[i]);
+            ASSERT_TRUE(writer.writeFrame(*source_frame));
+        }
+
+        EXPECT_EQ(writer.frameCount(), 3);
+    }
+
+    FrameCorpusReader reader;
+    ASSERT_TRUE(reader.open(file_path));
+    EXPECT_EQ(reader.screenSize(), kScreenSize);
+
+    ASSERT_TRUE(reader.readFrame(target_frame.get()));
+    EXPECT_TRUE(target_frame->constUpdatedRegion().equals(
+        Region(Rect::makeSize(kScreenSize))));
+
+    for (size_t i = 0; i < std::size(rects); ++i)
+    {
+        ASSERT_TRUE(reader.readFrame(target_frame.get()));
+        EXPECT_TRUE(target_frame->constUpdatedRegion().equals(Region(rects[i])));
+    }
+
+    EXPECT_TRUE(isEqualPixels(*source_frame, *target_frame));
+    EXPECT_FALSE(reader.readFrame(target_frame.get()));
+
+    // After rewind the whole corpus is available again.
+    ASSERT_TRUE(reader.rewind());
+    ASSERT_TRUE(reader.readFrame(target_frame.get()));
+    EXPECT_TRUE(target_frame->constUpdatedRegion().equals(
+        Region(Rect::makeSize(kScreenSize))));
+
+    reader.close();
+    std::filesystem::remove(file_path);
+}
+
+TEST(frame_corpus_test, invalid_file)
+{
+    const std::filesystem::path file_path = corpusPath();
+
+    {
+        std::ofstream stream(file_path, std::ofstream::binary | std::ofstream::trunc);
+        stream << "not a corpus";
+    }
+
+    FrameCorpusReader reader;
+    EXPECT_FALSE(reader.open(file_path));
+
+    std::filesystem::remove(file_path);
+}
+
+} // namespace base
@@ -29,7 +29,7 @@ FrameDib::FrameDib(const Size& size,
                    const PixelFormat& format,
                    int stride,
                    uint8_t* data,
-                   std::unique_ptr<SharedMemory> shared_memory,
+                   std::unique_ptr<SharedMemoryBase> shared_memory,
                    HBITMAP bitmap)
     : Frame(size, format, stride, data, shared_memory.get()),
       bitmap_(bitmap),
@@ -81,12 +81,18 @@ std::unique_ptr<FrameDib> FrameDib::create(const Size& size,
         }
     }
 
-    std::unique_ptr<SharedMemory> shared_memory;
+    std::unique_ptr<SharedMemoryBase> shared_memory;
     HANDLE section_handle = nullptr;
 
     if (shared_memory_factory)
     {
-        shared_memory = shared_memory_factory->create(buffer_size);
+        shared_memory = shared_memory_factory->acquire(buffer_size);
+        if (!shared_memory)
+        {
+            LOG(LS_WARNING) << "SharedMemoryFactory::acquire failed for size: " << buffer_size;
+            return nullptr;
+        }
+
         section_handle = shared_memory->handle();
     }
 
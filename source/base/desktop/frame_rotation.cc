@@ -108,6 +108,19 @@ Rect rotateRect(const Rect& rect, const Size& size, Rotation rotation)
     return Rect();
 }
 
+Region rotateRegion(const Region& region, const Size& size, Rotation rotation)
+{
+    if (rotation == Rotation::CLOCK_WISE_0)
+        return region;
+
+    Region result;
+
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+        result.addRect(rotateRect(it.rect(), size, rotation));
+
+    return result;
+}
+
 void rotateDesktopFrame(const Frame& source,
                         const Rect& source_rect,
                         const Rotation& rotation,
@@ -134,4 +147,24 @@ void rotateDesktopFrame(const Frame& source,
     DCHECK_EQ(result, 0);
 }
 
+void rotateDesktopFrame(const Frame& source,
+                        const Region& source_region,
+                        const Rotation& rotation,
+                        const Point& target_offset,
+                        Frame* target)
+{
+    DCHECK(target);
+
+    const Rect source_rect = Rect::makeSize(source.size());
+
+    for (Region::Iterator it(source_region); !it.isAtEnd(); it.advance())
+    {
+        Rect rect = it.rect();
+        rect.intersectWith(source_rect);
+
+        if (!rect.isEmpty())
+            rotateDesktopFrame(source, rect, rotation, target_offset, target);
+    }
+}
+
 } // namespace base
@@ -20,6 +20,7 @@
 #define BASE_DESKTOP_FRAME_ROTATION_H
 
 #include "base/desktop/frame.h"
+#include "base/desktop/region.h"
 
 namespace base {
 
@@ -45,6 +46,15 @@ void rotateDesktopFrame(const Frame& source,
                         const Point& target_offset,
                         Frame* target);
 
+// Rotates only the rectangles of |source_region| of |source|, so the cost depends on the updated
+// area instead of the frame size. |source_region| is clipped by the |source| frame. The updated
+// region of |target| is not changed, use rotateRegion() to get the rotated area.
+void rotateDesktopFrame(const Frame& source,
+                        const Region& source_region,
+                        const Rotation& rotation,
+                        const Point& target_offset,
+                        Frame* target);
+
 // Returns a reverse rotation of |rotation|.
 Rotation reverseRotation(Rotation rotation);
 
@@ -55,6 +65,10 @@ Size rotateSize(const Size& size, Rotation rotation);
 // belongs in.
 Rect rotateRect(const Rect& rect, const Size& size, Rotation rotation);
 
+// Returns a rotated Region of |region|. The |size| represents the size of the Frame which
+// |region| belongs in.
+Region rotateRegion(const Region& region, const Size& size, Rotation rotation);
+
 } // namespace base
 
 #endif // BASE_DESKTOP_FRAME_ROTATION_H
@@ -0,0 +1,140 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/desktop/frame_rotation.h"
+#include "base/desktop/frame_simple.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+const Rotation kRotations[] =
+{
+    Rotation::CLOCK_WISE_0,
+    Rotation::CLOCK_WISE_90,
+    Rotation::CLOCK_WISE_180,
+    Rotation::CLOCK_WISE_270
+};
+
+uint32_t pixelAt(const Frame& frame, int x, int y)
+{
+    uint32_t pixel;
+    memcpy(&pixel, frame.frameDataAtPos(x, y), sizeof(pixel));
+    return pixel;
+}
+
+bool containsPoint(const Region& region, int x, int y)
+{
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+    {
+        if (it.rect().contains(x, y))
+            return true;
+    }
+
+    return false;
+}
+
+// Each pixel holds its own coordinates.
+std::unique_ptr<Frame> createTestFrame(const Size& size)
+{
+    std::unique_ptr<Frame> frame = FrameSimple::create(size, PixelFormat::ARGB());
+
+    for (int y = 0; y < size.height(); ++y)
+    {
+        for (int x = 0; x < size.width(); ++x)
+        {
+            const uint32_t pixel = static_cast<uint32_t>((y << 16) | x);
+            memcpy(frame->frameDataAtPos(x, y), &pixel, sizeof(pixel));
+        }
+    }
+
+    return frame;
+}
+
+} // namespace
+
+TEST(FrameRotationTest, RotateRegionRoundTrip)
+{
+    const Size size(64, 48);
+
+    Region region;
+    region.addRect(Rect::makeXYWH(0, 0, 10, 5));
+    region.addRect(Rect::makeXYWH(20, 30, 44, 18));
+    region.addRect(Rect::makeXYWH(5, 12, 3, 3));
+
+    for (Rotation rotation : kRotations)
+    {
+        const Region rotated = rotateRegion(region, size, rotation);
+        const Region restored =
+            rotateRegion(rotated, rotateSize(size, rotation), reverseRotation(rotation));
+
+        EXPECT_TRUE(restored.equals(region)) << static_cast<int>(rotation);
+
+        // The rotated region lies inside of the rotated frame.
+        Region bounds(Rect::makeSize(rotateSize(size, rotation)));
+        bounds.intersectWith(rotated);
+        EXPECT_TRUE(bounds.equals(rotated)) << static_cast<int>(rotation);
+    }
+}
+
+TEST(FrameRotationTest, RotateOnlyUpdatedRegion)
+{
+    const Size size(37, 21);
+    std::unique_ptr<Frame> source = createTestFrame(size);
+
+    Region region;
+    region.addRect(Rect::makeXYWH(3, 2, 9, 7));
+    region.addRect(Rect::makeXYWH(30, 15, 20, 20)); // Partially outside of the frame.
+
+    Region clipped = region;
+    clipped.intersectWith(Rect::makeSize(size));
+
+    for (Rotation rotation : kRotations)
+    {
+        const Size target_size = rotateSize(size, rotation);
+        std::unique_ptr<Frame> target = FrameSimple::create(target_size, PixelFormat::ARGB());
+        memset(target->frameData(), 0xFF,
+               static_cast<size_t>(target->stride()) * static_cast<size_t>(target_size.height()));
+
+        rotateDesktopFrame(*source, region, rotation, Point(), target.get());
+
+        const Region rotated = rotateRegion(clipped, size, rotation);
+
+        for (int y = 0; y < target_size.height(); ++y)
+        {
+            for (int x = 0; x < target_size.width(); ++x)
+            {
+                if (!containsPoint(rotated, x, y))
+                {
+                    ASSERT_EQ(pixelAt(*target, x, y), 0xFFFFFFFF);
+                    continue;
+                }
+
+                // The pixel is taken from the source position of the reverse rotation.
+                const Rect source_rect = rotateRect(
+                    Rect::makeXYWH(x, y, 1, 1), target_size, reverseRotation(rotation));
+                ASSERT_EQ(pixelAt(*target, x, y),
+                          pixelAt(*source, source_rect.x(), source_rect.y()))
+                    << static_cast<int>(rotation) << " at " << x << "x" << y;
+            }
+        }
+    }
+}
+
+} // namespace base
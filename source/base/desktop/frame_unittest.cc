@@ -35,8 +35,113 @@ std::unique_ptr<Frame> createTestFrame(const Rect& rect, int pixels_value)
     return std::move(frame);
 }
 
+std::unique_ptr<Frame> createI420TestFrame(const Size& size)
+{
+    auto frame = FrameSimple::create(size, PixelFormat::ARGB());
+    frame->setLayout(Frame::Layout::I420);
+
+    const int uv_height = (size.height() + 1) / 2;
+
+    for (int y = 0; y < size.height(); ++y)
+    {
+        for (int x = 0; x < frame->yStride(); ++x)
+            frame->yPlane()[y * frame->yStride() + x] = static_cast<uint8_t>(x + y * 3);
+    }
+
+    for (int y = 0; y < uv_height; ++y)
+    {
+        for (int x = 0; x < frame->uvStride(); ++x)
+        {
+            frame->uPlane()[y * frame->uvStride() + x] = static_cast<uint8_t>(x * 5 + y);
+            frame->vPlane()[y * frame->uvStride() + x] = static_cast<uint8_t>(x + y * 7);
+        }
+    }
+
+    return frame;
+}
+
 } // namespace
 
+TEST(FrameTest, CopyI420Planes)
+{
+    const Size size(66, 38);
+
+    auto src = createI420TestFrame(size);
+    auto dst = FrameSimple::create(size, PixelFormat::ARGB());
+    dst->setLayout(Frame::Layout::I420);
+    memset(dst->frameData(), 0, static_cast<size_t>(dst->stride()) * size.height());
+
+    const Point src_pos(4, 8);
+    const Rect dst_rect = Rect::makeXYWH(10, 6, 20, 12);
+
+    dst->copyPixelsFrom(*src, src_pos, dst_rect);
+
+    for (int y = 0; y < size.height(); ++y)
+    {
+        for (int x = 0; x < size.width(); ++x)
+        {
+            uint8_t expected = 0;
+            if (dst_rect.contains(x, y))
+            {
+                expected = src->yPlane()[(y - dst_rect.y() + src_pos.y()) * src->yStride() +
+                                         (x - dst_rect.x() + src_pos.x())];
+            }
+
+            ASSERT_EQ(dst->yPlane()[y * dst->yStride() + x], expected) << x << "x" << y;
+        }
+    }
+
+    for (int y = 0; y < (size.height() + 1) / 2; ++y)
+    {
+        for (int x = 0; x < dst->uvStride(); ++x)
+        {
+            uint8_t expected_u = 0;
+            uint8_t expected_v = 0;
+
+            if (Rect::makeXYWH(dst_rect.x() / 2, dst_rect.y() / 2,
+                               dst_rect.width() / 2, dst_rect.height() / 2).contains(x, y))
+            {
+                const int offset = (y - dst_rect.y() / 2 + src_pos.y() / 2) * src->uvStride() +
+                                   (x - dst_rect.x() / 2 + src_pos.x() / 2);
+                expected_u = src->uPlane()[offset];
+                expected_v = src->vPlane()[offset];
+            }
+
+            ASSERT_EQ(dst->uPlane()[y * dst->uvStride() + x], expected_u) << x << "x" << y;
+            ASSERT_EQ(dst->vPlane()[y * dst->uvStride() + x], expected_v) << x << "x" << y;
+        }
+    }
+}
+
+TEST(FrameTest, MoveOverlappingPixels)
+{
+    const Size size(16, 32);
+
+    for (int offset : { -5, 5 })
+    {
+        auto frame = FrameSimple::create(size, PixelFormat::ARGB());
+        uint32_t* pixels = reinterpret_cast<uint32_t*>(frame->frameData());
+
+        for (int i = 0; i < size.width() * size.height(); ++i)
+            pixels[i] = static_cast<uint32_t>(i);
+
+        const Rect src_rect = Rect::makeXYWH(2, 8, 10, 16);
+        frame->movePixels(src_rect, Point(src_rect.x(), src_rect.y() + offset));
+
+        for (int y = 0; y < size.height(); ++y)
+        {
+            for (int x = 0; x < size.width(); ++x)
+            {
+                uint32_t expected = static_cast<uint32_t>(y * size.width() + x);
+                if (src_rect.translated(0, offset).contains(x, y))
+                    expected = static_cast<uint32_t>((y - offset) * size.width() + x);
+
+                ASSERT_EQ(pixels[y * size.width() + x], expected) << x << "x" << y;
+            }
+        }
+    }
+}
+
 TEST(FrameTest, Performance)
 {
     Rect frame_rect = Rect::makeWH(1024, 768);
@@ -0,0 +1,34 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/desktop/frame_view.h"
+
+#include "base/logging.h"
+
+namespace base {
+
+FrameView::FrameView(const Frame& frame, const Rect& rect)
+    : Frame(rect.size(), frame.format(), frame.stride(), frame.frameDataAtPos(rect.topLeft()),
+            nullptr)
+{
+    DCHECK(frame.layout() == Layout::PACKED);
+    DCHECK(Rect::makeSize(frame.size()).containsRect(rect));
+}
+
+FrameView::~FrameView() = default;
+
+} // namespace base
@@ -0,0 +1,40 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef BASE_DESKTOP_FRAME_VIEW_H
+#define BASE_DESKTOP_FRAME_VIEW_H
+
+#include "base/desktop/frame.h"
+
+namespace base {
+
+// A frame that refers to a rectangle of the buffer of another frame, for example one monitor of
+// the whole desktop. The other frame must outlive the view and must be in the packed layout. The
+// updated region of the view is independent of the other frame.
+class FrameView : public Frame
+{
+public:
+    FrameView(const Frame& frame, const Rect& rect);
+    ~FrameView() override;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(FrameView);
+};
+
+} // namespace base
+
+#endif // BASE_DESKTOP_FRAME_VIEW_H
@@ -0,0 +1,383 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/desktop/linux/screen_cast_portal.h"
+
+#include "base/logging.h"
+#include "base/crypto/random.h"
+
+#include <gio/gunixfdlist.h>
+
+namespace base {
+
+namespace {
+
+const char kPortalBusName[] = "org.freedesktop.portal.Desktop";
+const char kPortalObjectPath[] = "/org/freedesktop/portal/desktop";
+const char kScreenCastInterface[] = "org.freedesktop.portal.ScreenCast";
+const char kRequestInterface[] = "org.freedesktop.portal.Request";
+const char kSessionInterface[] = "org.freedesktop.portal.Session";
+
+// Values of the ScreenCast interface.
+const uint32_t kSourceTypeMonitor = 1;
+const uint32_t kCursorModeEmbedded = 2;
+const uint32_t kPersistModePersistent = 2;
+
+// Response codes of the Request interface.
+const uint32_t kResponseSuccess = 0;
+const uint32_t kResponseCancelled = 1;
+
+// The user may take some time to answer the dialog of the portal.
+const guint kResponseTimeoutSeconds = 120;
+
+// Token to restore the permission given by the user. The portal returns it after the user has
+// selected a monitor, so that the dialog is not shown again when the capturer is recreated. The
+// token is used only on the thread of the screen capturer.
+std::string g_restore_token;
+
+} // namespace
+
+ScreenCastPortal::ScreenCastPortal()
+    : context_(g_main_context_new())
+{
+    // Nothing
+}
+
+ScreenCastPortal::~ScreenCastPortal()
+{
+    closeSession();
+
+    if (connection_)
+        g_object_unref(connection_);
+
+    g_main_context_unref(context_);
+}
+
+bool ScreenCastPortal::start()
+{
+    GError* error = nullptr;
+
+    connection_ = g_bus_get_sync(G_BUS_TYPE_SESSION, nullptr, &error);
+    if (!connection_)
+    {
+        LOG(LS_ERROR) << "Unable to connect to the session bus: " << error->message;
+        g_error_free(error);
+        return false;
+    }
+
+    // The signals of the requests are delivered to the context which is the thread default at the
+    // time of the subscription.
+    g_main_context_push_thread_default(context_);
+
+    const bool result = createSession() && selectSources() && startStream();
+
+    g_main_context_pop_thread_default(context_);
+    return result;
+}
+
+int ScreenCastPortal::openPipeWireRemote()
+{
+    DCHECK(connection_);
+    DCHECK(!session_handle_.empty());
+
+    GVariantBuilder builder;
+    g_variant_builder_init(&builder, G_VARIANT_TYPE_VARDICT);
+
+    GUnixFDList* fd_list = nullptr;
+    GError* error = nullptr;
+
+    GVariant* reply = g_dbus_connection_call_with_unix_fd_list_sync(
+        connection_, kPortalBusName, kPortalObjectPath, kScreenCastInterface,
+        "OpenPipeWireRemote", g_variant_new("(oa{sv})", session_handle_.c_str(), &builder),
+        G_VARIANT_TYPE("(h)"), G_DBUS_CALL_FLAGS_NONE, -1, nullptr, &fd_list, nullptr, &error);
+    if (!reply)
+    {
+        LOG(LS_ERROR) << "OpenPipeWireRemote failed: " << error->message;
+        g_error_free(error);
+        return -1;
+    }
+
+    gint32 index = 0;
+    g_variant_get(reply, "(h)", &index);
+    g_variant_unref(reply);
+
+    int fd = g_unix_fd_list_get(fd_list, index, &error);
+    g_object_unref(fd_list);
+
+    if (fd == -1)
+    {
+        LOG(LS_ERROR) << "Unable to get the PipeWire file descriptor: " << error->message;
+        g_error_free(error);
+        return -1;
+    }
+
+    return fd;
+}
+
+bool ScreenCastPortal::createSession()
+{
+    const std::string token = newToken();
+    const std::string session_token = newToken();
+
+    GVariantBuilder builder;
+    g_variant_builder_init(&builder, G_VARIANT_TYPE_VARDICT);
+    g_variant_builder_add(&builder, "{sv}", "handle_token", g_variant_new_string(token.c_str()));
+    g_variant_builder_add(&builder, "{sv}", "session_handle_token",
+                          g_variant_new_string(session_token.c_str()));
+
+    GVariant* results = nullptr;
+    if (!callRequest("CreateSession", g_variant_new("(a{sv})", &builder), token, &results))
+        return false;
+
+    const char* session_handle = nullptr;
+    if (g_variant_lookup(results, "session_handle", "&s", &session_handle))
+        session_handle_ = session_handle;
+
+    g_variant_unref(results);
+
+    if (session_handle_.empty())
+    {
+        LOG(LS_ERROR) << "No session handle in the portal response";
+        return false;
+    }
+
+    LOG(LS_INFO) << "Portal session created: " << session_handle_;
+    return true;
+}
+
+bool ScreenCastPortal::selectSources()
+{
+    const std::string token = newToken();
+
+    GVariantBuilder builder;
+    g_variant_builder_init(&builder, G_VARIANT_TYPE_VARDICT);
+    g_variant_builder_add(&builder, "{sv}", "handle_token", g_variant_new_string(token.c_str()));
+    g_variant_builder_add(&builder, "{sv}", "types", g_variant_new_uint32(kSourceTypeMonitor));
+    g_variant_builder_add(&builder, "{sv}", "multiple", g_variant_new_boolean(FALSE));
+    g_variant_builder_add(&builder, "{sv}", "cursor_mode",
+                          g_variant_new_uint32(kCursorModeEmbedded));
+
+    // Older versions of the portal ignore the options they do not know.
+    g_variant_builder_add(&builder, "{sv}", "persist_mode",
+                          g_variant_new_uint32(kPersistModePersistent));
+    if (!g_restore_token.empty())
+    {
+        g_variant_builder_add(&builder, "{sv}", "restore_token",
+                              g_variant_new_string(g_restore_token.c_str()));
+    }
+
+    GVariant* results = nullptr;
+    if (!callRequest("SelectSources",
+                     g_variant_new("(oa{sv})", session_handle_.c_str(), &builder),
+                     token, &results))
+    {
+        return false;
+    }
+
+    g_variant_unref(results);
+    return true;
+}
+
+bool ScreenCastPortal::startStream()
+{
+    const std::string token = newToken();
+
+    GVariantBuilder builder;
+    g_variant_builder_init(&builder, G_VARIANT_TYPE_VARDICT);
+    g_variant_builder_add(&builder, "{sv}", "handle_token", g_variant_new_string(token.c_str()));
+
+    GVariant* results = nullptr;
+    if (!callRequest("Start",
+                     g_variant_new("(osa{sv})", session_handle_.c_str(), "", &builder),
+                     token, &results))
+    {
+        return false;
+    }
+
+    bool has_stream = false;
+
+    GVariant* streams = g_variant_lookup_value(results, "streams", G_VARIANT_TYPE("a(ua{sv})"));
+    if (streams)
+    {
+        GVariantIter iter;
+        g_variant_iter_init(&iter, streams);
+
+        guint32 node_id = 0;
+        GVariant* properties = nullptr;
+
+        // Only one monitor can be selected.
+        if (g_variant_iter_next(&iter, "(u@a{sv})", &node_id, &properties))
+        {
+            has_stream = true;
+            node_id_ = node_id;
+
+            gint32 width = 0;
+            gint32 height = 0;
+            if (g_variant_lookup(properties, "size", "(ii)", &width, &height))
+                stream_size_ = Size(width, height);
+
+            g_variant_unref(properties);
+        }
+
+        g_variant_unref(streams);
+    }
+
+    const char* restore_token = nullptr;
+    if (g_variant_lookup(results, "restore_token", "&s", &restore_token))
+        g_restore_token = restore_token;
+
+    g_variant_unref(results);
+
+    if (!has_stream)
+    {
+        LOG(LS_ERROR) << "No streams in the portal response";
+        return false;
+    }
+
+    LOG(LS_INFO) << "Screen cast started (node: " << node_id_ << ", size: " << stream_size_
+                 << ")";
+    return true;
+}
+
+void ScreenCastPortal::closeSession()
+{
+    if (session_handle_.empty() || !connection_)
+        return;
+
+    GError* error = nullptr;
+    GVariant* reply = g_dbus_connection_call_sync(
+        connection_, kPortalBusName, session_handle_.c_str(), kSessionInterface, "Close",
+        nullptr, nullptr, G_DBUS_CALL_FLAGS_NONE, -1, nullptr, &error);
+    if (!reply)
+    {
+        LOG(LS_WARNING) << "Unable to close the portal session: " << error->message;
+        g_error_free(error);
+    }
+    else
+    {
+        g_variant_unref(reply);
+    }
+
+    session_handle_.clear();
+}
+
+bool ScreenCastPortal::callRequest(const char* method, GVariant* parameters,
+                                   const std::string& token, GVariant** results)
+{
+    Response response;
+
+    // The path of the request object is known in advance. The subscription is made before the
+    // call, so that the response cannot be missed.
+    const std::string request_path = requestPath(token);
+    const guint subscription = g_dbus_connection_signal_subscribe(
+        connection_, kPortalBusName, kRequestInterface, "Response", request_path.c_str(),
+        nullptr, G_DBUS_SIGNAL_FLAGS_NO_MATCH_RULE, &ScreenCastPortal::onResponse, &response,
+        nullptr);
+
+    GError* error = nullptr;
+    GVariant* reply = g_dbus_connection_call_sync(
+        connection_, kPortalBusName, kPortalObjectPath, kScreenCastInterface, method, parameters,
+        G_VARIANT_TYPE("(o)"), G_DBUS_CALL_FLAGS_NONE, -1, nullptr, &error);
+    if (!reply)
+    {
+        LOG(LS_ERROR) << method << " failed: " << error->message;
+        g_error_free(error);
+        g_dbus_connection_signal_unsubscribe(connection_, subscription);
+        return false;
+    }
+
+    g_variant_unref(reply);
+
+    bool timed_out = false;
+
+    GSource* timeout = g_timeout_source_new_seconds(kResponseTimeoutSeconds);
+    g_source_set_callback(timeout, &ScreenCastPortal::onResponseTimeout, &timed_out, nullptr);
+    g_source_attach(timeout, context_);
+
+    while (!response.received && !timed_out)
+        g_main_context_iteration(context_, TRUE);
+
+    g_source_destroy(timeout);
+    g_source_unref(timeout);
+    g_dbus_connection_signal_unsubscribe(connection_, subscription);
+
+    if (!response.received)
+    {
+        LOG(LS_ERROR) << "No response to " << method;
+        return false;
+    }
+
+    if (response.code != kResponseSuccess)
+    {
+        if (response.code == kResponseCancelled)
+            LOG(LS_WARNING) << method << " cancelled by the user";
+        else
+            LOG(LS_ERROR) << method << " failed with code " << response.code;
+
+        if (response.results)
+            g_variant_unref(response.results);
+        return false;
+    }
+
+    *results = response.results;
+    return true;
+}
+
+std::string ScreenCastPortal::requestPath(const std::string& token) const
+{
+    // The unique name of the connection without the leading ':' and with '.' replaced by '_'.
+    std::string sender = g_dbus_connection_get_unique_name(connection_) + 1;
+    for (char& ch : sender)
+    {
+        if (ch == '.')
+            ch = '_';
+    }
+
+    return std::string(kPortalObjectPath) + "/request/" + sender + '/' + token;
+}
+
+// static
+std::string ScreenCastPortal::newToken()
+{
+    return "aspia" + std::to_string(Random::number32());
+}
+
+// static
+void ScreenCastPortal::onResponse(GDBusConnection* /* connection */,
+                                  const gchar* /* sender_name */,
+                                  const gchar* /* object_path */,
+                                  const gchar* /* interface_name */,
+                                  const gchar* /* signal_name */,
+                                  GVariant* parameters,
+                                  gpointer user_data)
+{
+    Response* response = static_cast<Response*>(user_data);
+    if (response->received)
+        return;
+
+    response->received = true;
+    g_variant_get(parameters, "(u@a{sv})", &response->code, &response->results);
+}
+
+// static
+gboolean ScreenCastPortal::onResponseTimeout(gpointer user_data)
+{
+    *static_cast<bool*>(user_data) = true;
+    return G_SOURCE_REMOVE;
+}
+
+} // namespace base
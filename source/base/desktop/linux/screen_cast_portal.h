@@ -0,0 +1,95 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef BASE_DESKTOP_LINUX_SCREEN_CAST_PORTAL_H
+#define BASE_DESKTOP_LINUX_SCREEN_CAST_PORTAL_H
+
+#include "base/macros_magic.h"
+#include "base/desktop/geometry.h"
+
+#include <gio/gio.h>
+
+#include <string>
+
+namespace base {
+
+// Client of the ScreenCast interface of xdg-desktop-portal. The portal asks the user which monitor
+// to share and gives access to a PipeWire stream with the image of the monitor.
+class ScreenCastPortal
+{
+public:
+    ScreenCastPortal();
+    ~ScreenCastPortal();
+
+    // Creates a portal session and starts the screen cast. Blocks until the user has answered the
+    // dialog of the portal. If the user has already allowed the capture in this process, then the
+    // dialog is not shown again.
+    bool start();
+
+    // Opens the PipeWire remote of the session. Returns the file descriptor of the connection to
+    // PipeWire, which is owned by the caller, or -1 on failure.
+    int openPipeWireRemote();
+
+    // PipeWire node of the stream.
+    uint32_t nodeId() const { return node_id_; }
+
+    // Size of the stream reported by the portal. Can be empty.
+    const Size& streamSize() const { return stream_size_; }
+
+private:
+    struct Response
+    {
+        bool received = false;
+        uint32_t code = 0;
+        GVariant* results = nullptr;
+    };
+
+    bool createSession();
+    bool selectSources();
+    bool startStream();
+    void closeSession();
+
+    // Calls a method of the portal which answers with a Response signal of a request object.
+    // |results| must be released with g_variant_unref().
+    bool callRequest(const char* method, GVariant* parameters, const std::string& token,
+                     GVariant** results);
+
+    std::string requestPath(const std::string& token) const;
+    static std::string newToken();
+
+    static void onResponse(GDBusConnection* connection,
+                           const gchar* sender_name,
+                           const gchar* object_path,
+                           const gchar* interface_name,
+                           const gchar* signal_name,
+                           GVariant* parameters,
+                           gpointer user_data);
+    static gboolean onResponseTimeout(gpointer user_data);
+
+    GDBusConnection* connection_ = nullptr;
+    GMainContext* context_ = nullptr;
+
+    std::string session_handle_;
+    uint32_t node_id_ = 0;
+    Size stream_size_;
+
+    DISALLOW_COPY_AND_ASSIGN(ScreenCastPortal);
+};
+
+} // namespace base
+
+#endif // BASE_DESKTOP_LINUX_SCREEN_CAST_PORTAL_H
@@ -19,6 +19,10 @@
 #include "base/desktop/region.h"
 
 #include "base/compiler_specific.h"
+#include "base/logging.h"
+
+#include <algorithm>
+#include <cstring>
 
 namespace base {
 
@@ -67,6 +71,8 @@ Region::Region(const Region& other)
 
 Region::Region(Region&& other) noexcept
 {
+    // The move assignment releases the current data, so it must be initialized first.
+    miRegionInit(&x11reg_, NullBox, 0);
     *this = std::move(other);
 }
 
@@ -183,6 +189,49 @@ void Region::swap(Region* region)
     std::swap(x11reg_.data, region->x11reg_.data);
 }
 
+void Region::setBandedBoxes(const BoxRec* boxes, long count)
+{
+    if (count <= 1)
+    {
+        miRegionUninit(&x11reg_);
+
+        if (count == 1)
+            miRegionInit(&x11reg_, const_cast<BoxRec*>(boxes), 0);
+        else
+            miRegionInit(&x11reg_, NullBox, 0);
+        return;
+    }
+
+    // The buffer of the previous content is reused if it is large enough.
+    if (REGION_SIZE(&x11reg_) < count)
+    {
+        miRegionUninit(&x11reg_);
+        miRegionInit(&x11reg_, NullBox, static_cast<int>(count));
+
+        if (REGION_SIZE(&x11reg_) < count)
+        {
+            LOG(LS_ERROR) << "Unable to allocate memory for " << count << " rects";
+            return;
+        }
+    }
+
+    memcpy(REGION_BOXPTR(&x11reg_), boxes, static_cast<size_t>(count) * sizeof(BoxRec));
+    x11reg_.data->numRects = count;
+
+    // The first band has the smallest y1 and the last band has the largest y2.
+    BoxRec& extents = x11reg_.extents;
+    extents.x1 = boxes[0].x1;
+    extents.y1 = boxes[0].y1;
+    extents.x2 = boxes[count - 1].x2;
+    extents.y2 = boxes[count - 1].y2;
+
+    for (long i = 0; i < count; ++i)
+    {
+        extents.x1 = std::min(extents.x1, boxes[i].x1);
+        extents.x2 = std::max(extents.x2, boxes[i].x2);
+    }
+}
+
 Region::Iterator::Iterator(const Region& region)
     : rects_(REGION_RECTS(&region.x11reg_)),
       count_(REGION_NUM_RECTS(&region.x11reg_)),
@@ -103,6 +103,12 @@ public:
     void swap(Region* region);
 
 private:
+    friend class BlockRegion;
+
+    // Replaces the content of the region with |count| rectangles which are already y-x banded
+    // (sorted into rows, without overlaps and with coalesced rows).
+    void setBandedBoxes(const BoxRec* boxes, long count);
+
     RegionRec x11reg_;
 };
 
@@ -38,6 +38,21 @@ SharedMemoryFactory* ScreenCapturer::sharedMemoryFactory() const
     return shared_memory_factory_;
 }
 
+void ScreenCapturer::setPreferredLayout(Frame::Layout /* layout */)
+{
+    // Nothing
+}
+
+void ScreenCapturer::setPreferredSize(const Size& /* size */)
+{
+    // Nothing
+}
+
+int ScreenCapturer::frameBufferCount() const
+{
+    return 1;
+}
+
 const char* ScreenCapturer::typeToString(Type type)
 {
     switch (type)
@@ -60,6 +75,9 @@ const char* ScreenCapturer::typeToString(Type type)
         case Type::LINUX_X11:
             return "LINUX_X11";
 
+        case Type::LINUX_PIPEWIRE:
+            return "LINUX_PIPEWIRE";
+
         case Type::MACOSX:
             return "MACOSX";
 
@@ -44,7 +44,8 @@ public:
         WIN_DXGI   = 3,
         LINUX_X11  = 4,
         MACOSX     = 5,
-        WIN_MIRROR = 6
+        WIN_MIRROR = 6,
+        LINUX_PIPEWIRE = 7
     };
 
     enum class Error
@@ -86,6 +87,19 @@ public:
     void setSharedMemoryFactory(SharedMemoryFactory* shared_memory_factory);
     SharedMemoryFactory* sharedMemoryFactory() const;
 
+    // Asks the capturer to produce frames in the specified layout. Capturers that cannot convert
+    // the image ignore the request, so consumers must always check Frame::layout().
+    virtual void setPreferredLayout(Frame::Layout layout);
+
+    // Asks the capturer to scale frames down to the specified size. An empty size means the
+    // original size. Capturers that cannot scale ignore the request, so consumers must compare
+    // Frame::size() with Frame::screenSize().
+    virtual void setPreferredSize(const Size& size);
+
+    // Number of frame buffers the capturer rotates through. A frame returned by captureFrame() is
+    // not modified until this number of further captureFrame() calls is made.
+    virtual int frameBufferCount() const;
+
     static const char* typeToString(Type type);
     Type type() const;
 
@@ -111,11 +125,12 @@ protected:
         FrameType* currentFrame() const;
         FrameType* previousFrame() const;
 
+        static const int kQueueLength = 2;
+
     private:
         // Index of the current frame.
         int current_ = 0;
 
-        static const int kQueueLength = 2;
         std::unique_ptr<FrameType> frames_[kQueueLength];
 
         DISALLOW_COPY_AND_ASSIGN(FrameQueue);
@@ -212,6 +212,9 @@ const Frame* ScreenCapturerDxgi::captureFrame(Error* error)
             std::make_unique<DxgiFrame>(controller_, sharedMemoryFactory()));
     }
 
+    queue_.currentFrame()->setLayout(layout_);
+    queue_.currentFrame()->setPreferredSize(preferred_size_);
+
     DxgiDuplicatorController::Result result;
 
     if (current_screen_index_ == -1)
@@ -298,9 +301,41 @@ const MouseCursor* ScreenCapturerDxgi::captureCursor()
 
 Point ScreenCapturerDxgi::cursorPosition()
 {
+    // Desktop Duplication reports the pointer only together with the frames. Between them the
+    // position is read directly and translated in the same way as the last reported one.
+    POINT cursor_pos;
+    if (cursor_->isVisible() && GetCursorPos(&cursor_pos))
+    {
+        const Point origin = cursor_->nativePosition().subtract(cursor_->position());
+        return Point(cursor_pos.x, cursor_pos.y).subtract(origin);
+    }
+
     return cursor_->position();
 }
 
+void ScreenCapturerDxgi::setPreferredLayout(Frame::Layout layout)
+{
+    if (layout_ == layout)
+        return;
+
+    LOG(LS_INFO) << "Frame layout changed: " << static_cast<int>(layout);
+    layout_ = layout;
+}
+
+void ScreenCapturerDxgi::setPreferredSize(const Size& size)
+{
+    if (preferred_size_ == size)
+        return;
+
+    LOG(LS_INFO) << "Preferred size changed: " << size;
+    preferred_size_ = size;
+}
+
+int ScreenCapturerDxgi::frameBufferCount() const
+{
+    return FrameQueue<DxgiFrame>::kQueueLength;
+}
+
 void ScreenCapturerDxgi::reset()
 {
     queue_.reset();
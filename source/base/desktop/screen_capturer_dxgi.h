@@ -49,6 +49,9 @@ public:
     const Frame* captureFrame(Error* error) override;
     const MouseCursor* captureCursor() override;
     Point cursorPosition() override;
+    void setPreferredLayout(Frame::Layout layout) override;
+    void setPreferredSize(const Size& size) override;
+    int frameBufferCount() const override;
 
 protected:
     // ScreenCapturer implementation.
@@ -59,6 +62,8 @@ private:
 
     int current_screen_index_ = -1;
     ScreenId current_screen_id_ = kFullDesktopScreenId;
+    Frame::Layout layout_ = Frame::Layout::PACKED;
+    Size preferred_size_;
     FrameQueue<DxgiFrame> queue_;
     std::unique_ptr<DxgiCursor> cursor_;
     std::vector<std::pair<Rect, Point>> dpi_for_rect_;
@@ -192,6 +192,11 @@ Point ScreenCapturerGdi::cursorPosition()
     return cursor_pos;
 }
 
+int ScreenCapturerGdi::frameBufferCount() const
+{
+    return FrameQueue<Frame>::kQueueLength;
+}
+
 void ScreenCapturerGdi::reset()
 {
     // Release GDI resources otherwise SetThreadDesktop will fail.
@@ -262,7 +267,7 @@ const Frame* ScreenCapturerGdi::captureImage()
 
     if (!previous || previous->size() != current->size())
     {
-        differ_ = std::make_unique<Differ>(screen_rect_.size());
+        differ_ = std::make_unique<Differ>(screen_rect_.size(), Differ::kAutoThreadCount);
         current->updatedRegion()->addRect(Rect::makeSize(screen_rect_.size()));
     }
     else
@@ -42,6 +42,7 @@ public:
     const Frame* captureFrame(Error* error) override;
     const MouseCursor* captureCursor() override;
     Point cursorPosition() override;
+    int frameBufferCount() const override;
 
 protected:
     // ScreenCapturer implementation.
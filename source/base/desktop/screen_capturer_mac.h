@@ -15,20 +15,34 @@
 // You should have received a copy of the GNU General Public License
 // along with this program. If not, see <https://www.gnu.org/licenses/>.
 //
-
 #ifndef BASE_DESKTOP_SCREEN_CAPTURER_MAC_H
 #define BASE_DESKTOP_SCREEN_CAPTURER_MAC_H
 
 #include "base/desktop/screen_capturer.h"
+#include "base/desktop/region.h"
+
+#include <CoreMedia/CoreMedia.h>
+#include <CoreVideo/CoreVideo.h>
+
+#include <atomic>
+#include <mutex>
 
 namespace base {
 
+// Captures a display with ScreenCaptureKit (macOS 12.3 or later). The system sends the frames in
+// IOSurfaces together with the dirty rectangles, so only the changed parts of the newest surface
+// are copied into the frame. Each display is captured by its own stream in the pixel resolution
+// of the display.
 class ScreenCapturerMac : public ScreenCapturer
 {
 public:
     ScreenCapturerMac();
     ~ScreenCapturerMac() override;
 
+    // Returns nullptr if ScreenCaptureKit is not available or the screen recording permission is
+    // not granted.
+    static std::unique_ptr<ScreenCapturerMac> create();
+
     // ScreenCapturer implementation.
     int screenCount() override;
     bool screenList(ScreenList* screens) override;
@@ -37,12 +51,43 @@ public:
     const Frame* captureFrame(Error* error) override;
     const MouseCursor* captureCursor() override;
     Point cursorPosition() override;
+    int frameBufferCount() const override;
+
+    // Called on the queue of the stream.
+    void onStreamFrame(CMSampleBufferRef sample_buffer);
+    void onStreamError();
 
 protected:
     // ScreenCapturer implementation.
     void reset() override;
 
 private:
+    bool startStream(uint32_t display_id);
+    void stopStream();
+
+    // SCStream, the output of the stream and its queue. The objects are retained.
+    void* stream_ = nullptr;
+    void* stream_output_ = nullptr;
+    void* stream_queue_ = nullptr;
+
+    ScreenId current_screen_id_ = kInvalidScreenId;
+    uint32_t display_id_ = 0;
+
+    std::atomic<bool> has_error_ { false };
+
+    // The newest image of the stream and the area changed since the last capture. Written on the
+    // queue of the stream and read by the capturer.
+    std::mutex frame_lock_;
+    CVPixelBufferRef pixel_buffer_ = nullptr;
+    Region pending_region_;
+
+    // Queue of the frame buffers.
+    FrameQueue<Frame> queue_;
+
+    // The region updated by the previous capture. The current frame of the queue was last written
+    // two captures ago, so it is updated with both regions.
+    Region last_updated_region_;
+
     DISALLOW_COPY_AND_ASSIGN(ScreenCapturerMac);
 };
 
@@ -15,68 +15,565 @@
 // You should have received a copy of the GNU General Public License
 // along with this program. If not, see <https://www.gnu.org/licenses/>.
 //
-
 #include "base/desktop/screen_capturer_mac.h"
 
 #include "base/logging.h"
+#include "base/desktop/frame_simple.h"
+
+#include <ApplicationServices/ApplicationServices.h>
+#include <ScreenCaptureKit/ScreenCaptureKit.h>
+
+#include <string>
+#include <vector>
+
+// Receives the frames and the errors of the stream and passes them to the capturer. The capturer
+// stops the stream and drains its queue before it is destroyed.
+API_AVAILABLE(macos(12.3))
+@interface AspiaStreamOutput : NSObject <SCStreamOutput, SCStreamDelegate>
+{
+    base::ScreenCapturerMac* capturer_;
+}
+
+- (instancetype)initWithCapturer:(base::ScreenCapturerMac*)capturer;
+
+@end
+
+@implementation AspiaStreamOutput
+
+- (instancetype)initWithCapturer:(base::ScreenCapturerMac*)capturer
+{
+    self = [super init];
+    if (self)
+        capturer_ = capturer;
+    return self;
+}
+
+- (void)stream:(SCStream*)stream
+    didOutputSampleBuffer:(CMSampleBufferRef)sample_buffer
+                   ofType:(SCStreamOutputType)type
+{
+    if (type == SCStreamOutputTypeScreen)
+        capturer_->onStreamFrame(sample_buffer);
+}
+
+- (void)stream:(SCStream*)stream didStopWithError:(NSError*)error
+{
+    LOG(LS_ERROR) << "Stream stopped with error: " << [[error description] UTF8String];
+    capturer_->onStreamError();
+}
+
+@end
 
 namespace base {
 
+namespace {
+
+const int kMaxFrameRate = 60;
+const int kQueueDepth = 3;
+const int kBytesPerPixel = 4;
+
+// The calls of ScreenCaptureKit are asynchronous, the capturer waits for them.
+const int64_t kStreamTimeout = 5 * NSEC_PER_SEC;
+
+bool waitFor(dispatch_semaphore_t semaphore)
+{
+    return dispatch_semaphore_wait(
+        semaphore, dispatch_time(DISPATCH_TIME_NOW, kStreamTimeout)) == 0;
+}
+
+std::vector<CGDirectDisplayID> activeDisplays()
+{
+    uint32_t count = 0;
+    if (CGGetActiveDisplayList(0, nullptr, &count) != kCGErrorSuccess || !count)
+        return std::vector<CGDirectDisplayID>();
+
+    std::vector<CGDirectDisplayID> displays(count);
+    if (CGGetActiveDisplayList(count, displays.data(), &count) != kCGErrorSuccess)
+        return std::vector<CGDirectDisplayID>();
+
+    displays.resize(count);
+    return displays;
+}
+
+// Size of the display in pixels. On Retina displays it differs from the size in points.
+Size displayPixelSize(CGDirectDisplayID display_id)
+{
+    CGDisplayModeRef mode = CGDisplayCopyDisplayMode(display_id);
+    if (!mode)
+        return Size();
+
+    Size size(static_cast<int32_t>(CGDisplayModeGetPixelWidth(mode)),
+              static_cast<int32_t>(CGDisplayModeGetPixelHeight(mode)));
+    CGDisplayModeRelease(mode);
+    return size;
+}
+
+Rect pixelBufferRect(CVPixelBufferRef pixel_buffer)
+{
+    return Rect::makeWH(static_cast<int32_t>(CVPixelBufferGetWidth(pixel_buffer)),
+                        static_cast<int32_t>(CVPixelBufferGetHeight(pixel_buffer)));
+}
+
+std::string errorString(NSError* error)
+{
+    return [[error description] UTF8String];
+}
+
+} // namespace
+
 ScreenCapturerMac::ScreenCapturerMac()
     : ScreenCapturer(ScreenCapturer::Type::MACOSX)
 {
-    // Nothing
+    LOG(LS_INFO) << "Ctor";
 }
 
-ScreenCapturerMac::~ScreenCapturerMac() = default;
+ScreenCapturerMac::~ScreenCapturerMac()
+{
+    LOG(LS_INFO) << "Dtor";
+    stopStream();
+}
+
+// static
+std::unique_ptr<ScreenCapturerMac> ScreenCapturerMac::create()
+{
+    if (@available(macOS 12.3, *))
+    {
+        if (!CGPreflightScreenCaptureAccess())
+        {
+            LOG(LS_ERROR) << "No permission for screen recording";
+            CGRequestScreenCaptureAccess();
+            return nullptr;
+        }
+
+        std::unique_ptr<ScreenCapturerMac> instance = std::make_unique<ScreenCapturerMac>();
+        if (!instance->selectScreen(kFullDesktopScreenId))
+        {
+            LOG(LS_ERROR) << "Unable to start the stream of the main display";
+            return nullptr;
+        }
+
+        return instance;
+    }
+
+    LOG(LS_INFO) << "ScreenCaptureKit is not available";
+    return nullptr;
+}
 
 int ScreenCapturerMac::screenCount()
 {
-    NOTIMPLEMENTED();
-    return 0;
+    return static_cast<int>(activeDisplays().size());
 }
 
-bool ScreenCapturerMac::screenList(ScreenList* /* screens */)
+bool ScreenCapturerMac::screenList(ScreenList* screens)
 {
-    NOTIMPLEMENTED();
-    return false;
+    DCHECK(screens->screens.size() == 0);
+
+    int index = 0;
+
+    for (CGDirectDisplayID display_id : activeDisplays())
+    {
+        const CGRect bounds = CGDisplayBounds(display_id);
+        const Size pixel_size = displayPixelSize(display_id);
+        const int scale = bounds.size.width > 0 ?
+            static_cast<int>(pixel_size.width() / bounds.size.width) : 1;
+
+        Screen screen;
+        screen.id = static_cast<ScreenId>(display_id);
+        screen.title = "Display " + std::to_string(++index);
+        screen.position = Point(static_cast<int32_t>(bounds.origin.x),
+                                static_cast<int32_t>(bounds.origin.y));
+        screen.resolution = pixel_size;
+        screen.dpi = Point(96 * std::max(scale, 1), 96 * std::max(scale, 1));
+        screen.is_primary = CGDisplayIsMain(display_id);
+
+        screens->screens.emplace_back(std::move(screen));
+    }
+
+    return !screens->screens.empty();
 }
 
-bool ScreenCapturerMac::selectScreen(ScreenId /* screen_id */)
+bool ScreenCapturerMac::selectScreen(ScreenId screen_id)
 {
-    NOTIMPLEMENTED();
-    return false;
+    // A stream captures one display, so the whole desktop is the main display.
+    CGDirectDisplayID display_id = screen_id == kFullDesktopScreenId ?
+        CGMainDisplayID() : static_cast<CGDirectDisplayID>(screen_id);
+
+    if (screen_id == current_screen_id_ && stream_)
+        return true;
+
+    bool is_valid = false;
+    for (CGDirectDisplayID display : activeDisplays())
+    {
+        if (display == display_id)
+        {
+            is_valid = true;
+            break;
+        }
+    }
+
+    if (!is_valid)
+    {
+        LOG(LS_ERROR) << "Invalid screen id passed: " << screen_id;
+        return false;
+    }
+
+    stopStream();
+    queue_.reset();
+
+    if (!startStream(display_id))
+        return false;
+
+    current_screen_id_ = screen_id;
+    return true;
 }
 
 ScreenCapturer::ScreenId ScreenCapturerMac::currentScreen() const
 {
-    NOTIMPLEMENTED();
-    return kInvalidScreenId;
+    return current_screen_id_;
 }
 
 const Frame* ScreenCapturerMac::captureFrame(Error* error)
 {
     DCHECK(error);
-    NOTIMPLEMENTED();
-    *error = Error::PERMANENT;
-    return nullptr;
+
+    if (has_error_.load(std::memory_order_acquire))
+    {
+        LOG(LS_ERROR) << "ScreenCaptureKit stream failed";
+        *error = Error::PERMANENT;
+        return nullptr;
+    }
+
+    std::scoped_lock lock(frame_lock_);
+
+    if (!pixel_buffer_)
+    {
+        *error = Error::TEMPORARY;
+        return nullptr;
+    }
+
+    const Size size = pixelBufferRect(pixel_buffer_).size();
+
+    Frame* frame = queue_.currentFrame();
+
+    // The system sends frames only when the screen changes.
+    if (frame && frame->size() == size && pending_region_.isEmpty())
+    {
+        frame->updatedRegion()->clear();
+        *error = Error::SUCCEEDED;
+        return frame;
+    }
+
+    queue_.moveToNextFrame();
+    frame = queue_.currentFrame();
+
+    Region copy_region;
+
+    if (!frame || frame->size() != size)
+    {
+        if (frame)
+            queue_.reset();
+
+        queue_.replaceCurrentFrame(FrameSimple::create(size, PixelFormat::ARGB()));
+        frame = queue_.currentFrame();
+        frame->setCapturerType(static_cast<uint32_t>(type()));
+
+        pending_region_.setRect(Rect::makeSize(size));
+        copy_region = pending_region_;
+    }
+    else
+    {
+        copy_region = pending_region_;
+        copy_region.addRegion(last_updated_region_);
+    }
+
+    // The memory of the surface is read directly, without a copy of the whole frame.
+    CVReturn ret = CVPixelBufferLockBaseAddress(pixel_buffer_, kCVPixelBufferLock_ReadOnly);
+    if (ret != kCVReturnSuccess)
+    {
+        LOG(LS_ERROR) << "CVPixelBufferLockBaseAddress failed";
+        *error = Error::TEMPORARY;
+        return nullptr;
+    }
+
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(
+        CVPixelBufferGetBaseAddress(pixel_buffer_));
+    const int stride = static_cast<int>(CVPixelBufferGetBytesPerRow(pixel_buffer_));
+
+    for (Region::Iterator it(copy_region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+        frame->copyPixelsFrom(data + stride * rect.y() + kBytesPerPixel * rect.x(), stride, rect);
+    }
+
+    CVPixelBufferUnlockBaseAddress(pixel_buffer_, kCVPixelBufferLock_ReadOnly);
+
+    *frame->updatedRegion() = pending_region_;
+    last_updated_region_.swap(&pending_region_);
+    pending_region_.clear();
+
+    *error = Error::SUCCEEDED;
+    return frame;
 }
 
 const MouseCursor* ScreenCapturerMac::captureCursor()
 {
-    NOTIMPLEMENTED();
+    // The cursor is drawn into the frames by the system.
     return nullptr;
 }
 
 Point ScreenCapturerMac::cursorPosition()
 {
-    NOTIMPLEMENTED();
-    return Point();
+    CGEventRef event = CGEventCreate(nullptr);
+    if (!event)
+        return Point();
+
+    const CGPoint location = CGEventGetLocation(event);
+    CFRelease(event);
+
+    // The location is in points of the global display space.
+    const CGRect bounds = CGDisplayBounds(display_id_);
+    const Size pixel_size = displayPixelSize(display_id_);
+    const double scale = bounds.size.width > 0 ? pixel_size.width() / bounds.size.width : 1.0;
+
+    return Point(static_cast<int32_t>((location.x - bounds.origin.x) * scale),
+                 static_cast<int32_t>((location.y - bounds.origin.y) * scale));
+}
+
+int ScreenCapturerMac::frameBufferCount() const
+{
+    return FrameQueue<Frame>::kQueueLength;
+}
+
+void ScreenCapturerMac::onStreamFrame(CMSampleBufferRef sample_buffer)
+{
+    if (@available(macOS 12.3, *))
+    {
+        CFArrayRef attachments = CMSampleBufferGetSampleAttachmentsArray(sample_buffer, false);
+        if (!attachments || CFArrayGetCount(attachments) < 1)
+            return;
+
+        NSDictionary* info =
+            reinterpret_cast<NSDictionary*>(CFArrayGetValueAtIndex(attachments, 0));
+
+        // Idle frames, which are sent when nothing has changed, have no image.
+        NSNumber* status = info[SCStreamFrameInfoStatus];
+        if (!status || [status integerValue] != SCFrameStatusComplete)
+            return;
+
+        CVPixelBufferRef pixel_buffer = CMSampleBufferGetImageBuffer(sample_buffer);
+        if (!pixel_buffer)
+            return;
+
+        const Rect frame_rect = pixelBufferRect(pixel_buffer);
+        Region dirty_region;
+
+        NSArray* dirty_rects = info[SCStreamFrameInfoDirtyRects];
+        if (dirty_rects)
+        {
+            for (NSDictionary* value in dirty_rects)
+            {
+                CGRect rect;
+                if (!CGRectMakeWithDictionaryRepresentation(
+                        reinterpret_cast<CFDictionaryRef>(value), &rect))
+                {
+                    continue;
+                }
+
+                rect = CGRectIntegral(rect);
+                dirty_region.addRect(Rect::makeXYWH(static_cast<int32_t>(rect.origin.x),
+                                                    static_cast<int32_t>(rect.origin.y),
+                                                    static_cast<int32_t>(rect.size.width),
+                                                    static_cast<int32_t>(rect.size.height)));
+            }
+
+            dirty_region.intersectWith(frame_rect);
+        }
+        else
+        {
+            dirty_region.addRect(frame_rect);
+        }
+
+        std::scoped_lock lock(frame_lock_);
+
+        // Only the newest surface is kept, the others return to the pool of the stream.
+        CVPixelBufferRetain(pixel_buffer);
+        if (pixel_buffer_)
+            CVPixelBufferRelease(pixel_buffer_);
+        pixel_buffer_ = pixel_buffer;
+
+        pending_region_.addRegion(dirty_region);
+    }
+}
+
+void ScreenCapturerMac::onStreamError()
+{
+    has_error_.store(true, std::memory_order_release);
 }
 
 void ScreenCapturerMac::reset()
 {
-    NOTIMPLEMENTED();
+    queue_.reset();
+
+    // The next capture copies the whole frame.
+    std::scoped_lock lock(frame_lock_);
+    if (pixel_buffer_)
+    {
+        pending_region_.setRect(pixelBufferRect(pixel_buffer_));
+    }
+}
+
+bool ScreenCapturerMac::startStream(uint32_t display_id)
+{
+    if (@available(macOS 12.3, *))
+    {
+        // The content is requested every time, because the displays may be changed.
+        __block SCDisplay* display = nil;
+        dispatch_semaphore_t done = dispatch_semaphore_create(0);
+
+        [SCShareableContent getShareableContentWithCompletionHandler:
+            ^(SCShareableContent* content, NSError* error)
+        {
+            if (error)
+                LOG(LS_ERROR) << "Unable to get shareable content: " << errorString(error);
+
+            for (SCDisplay* item in content.displays)
+            {
+                if (item.displayID == display_id)
+                {
+                    display = [item retain];
+                    break;
+                }
+            }
+
+            dispatch_semaphore_signal(done);
+        }];
+
+        const bool has_content = waitFor(done);
+        dispatch_release(done);
+
+        if (!has_content || !display)
+        {
+            LOG(LS_ERROR) << "Display " << display_id << " is not found in the shareable content";
+            return false;
+        }
+
+        const Size pixel_size = displayPixelSize(display_id);
+
+        SCContentFilter* filter =
+            [[SCContentFilter alloc] initWithDisplay:display excludingWindows:@[]];
+        [display release];
+
+        SCStreamConfiguration* config = [[SCStreamConfiguration alloc] init];
+        config.width = static_cast<size_t>(pixel_size.width());
+        config.height = static_cast<size_t>(pixel_size.height());
+        config.pixelFormat = kCVPixelFormatType_32BGRA;
+        config.minimumFrameInterval = CMTimeMake(1, kMaxFrameRate);
+        config.queueDepth = kQueueDepth;
+        config.showsCursor = YES;
+
+        AspiaStreamOutput* output = [[AspiaStreamOutput alloc] initWithCapturer:this];
+        SCStream* stream =
+            [[SCStream alloc] initWithFilter:filter configuration:config delegate:output];
+        dispatch_queue_t queue =
+            dispatch_queue_create("aspia.screen_capturer", DISPATCH_QUEUE_SERIAL);
+
+        [filter release];
+        [config release];
+
+        stream_ = stream;
+        stream_output_ = output;
+        stream_queue_ = queue;
+        display_id_ = display_id;
+        has_error_.store(false, std::memory_order_release);
+
+        NSError* add_error = nil;
+        if (![stream addStreamOutput:output
+                                type:SCStreamOutputTypeScreen
+                  sampleHandlerQueue:queue
+                               error:&add_error])
+        {
+            LOG(LS_ERROR) << "Unable to add stream output: " << errorString(add_error);
+            stopStream();
+            return false;
+        }
+
+        __block bool is_started = false;
+        done = dispatch_semaphore_create(0);
+
+        [stream startCaptureWithCompletionHandler:^(NSError* error)
+        {
+            if (error)
+                LOG(LS_ERROR) << "Unable to start capture: " << errorString(error);
+            else
+                is_started = true;
+
+            dispatch_semaphore_signal(done);
+        }];
+
+        const bool has_result = waitFor(done);
+        dispatch_release(done);
+
+        if (!has_result || !is_started)
+        {
+            stopStream();
+            return false;
+        }
+
+        LOG(LS_INFO) << "Stream started for display " << display_id << " (" << pixel_size << ")";
+        return true;
+    }
+
+    return false;
+}
+
+void ScreenCapturerMac::stopStream()
+{
+    if (@available(macOS 12.3, *))
+    {
+        if (stream_)
+        {
+            SCStream* stream = reinterpret_cast<SCStream*>(stream_);
+            dispatch_semaphore_t done = dispatch_semaphore_create(0);
+
+            [stream stopCaptureWithCompletionHandler:^(NSError* /* error */)
+            {
+                dispatch_semaphore_signal(done);
+            }];
+
+            if (!waitFor(done))
+                LOG(LS_WARNING) << "Timeout while stopping the stream";
+            dispatch_release(done);
+
+            // The stream does not call the output after the queue is drained.
+            if (stream_queue_)
+                dispatch_sync(reinterpret_cast<dispatch_queue_t>(stream_queue_), ^{});
+
+            [stream release];
+            stream_ = nullptr;
+        }
+
+        if (stream_output_)
+        {
+            [reinterpret_cast<AspiaStreamOutput*>(stream_output_) release];
+            stream_output_ = nullptr;
+        }
+
+        if (stream_queue_)
+        {
+            dispatch_release(reinterpret_cast<dispatch_queue_t>(stream_queue_));
+            stream_queue_ = nullptr;
+        }
+    }
+
+    std::scoped_lock lock(frame_lock_);
+    if (pixel_buffer_)
+    {
+        CVPixelBufferRelease(pixel_buffer_);
+        pixel_buffer_ = nullptr;
+    }
+
+    pending_region_.clear();
+    last_updated_region_.clear();
 }
 
 } // namespace base
@@ -19,6 +19,7 @@
 #include "base/desktop/screen_capturer_mirror.h"
 
 #include "base/logging.h"
+#include "base/desktop/block_region.h"
 #include "base/desktop/mouse_cursor.h"
 #include "base/desktop/win/cursor.h"
 #include "base/desktop/win/dfmirage_helper.h"
@@ -33,6 +34,8 @@ namespace base {
 
 namespace {
 
+const int kBlockSize = 16;
+
 std::unique_ptr<MirrorHelper> createHelper(const Rect& screen_rect)
 {
     std::unique_ptr<MirrorHelper> helper = Mv2Helper::create(screen_rect);
@@ -129,8 +132,20 @@ const Frame* ScreenCapturerMirror::captureFrame(Error* error)
     // Clearing the region from previous changes.
     updated_region->clear();
 
-    // Update the list of changed areas.
-    helper_->addUpdatedRects(updated_region);
+    // Update the list of changed areas. The records are read even for a full update, so that the
+    // next frame starts from the current record.
+    block_region_->clear();
+    helper_->addUpdatedRects(block_region_.get());
+
+    if (is_full_update_)
+    {
+        updated_region->addRect(Rect::makeSize(frame_->size()));
+        is_full_update_ = false;
+    }
+    else
+    {
+        block_region_->toRegion(updated_region);
+    }
 
     // Exclude a region that should not be captured.
     updated_region->subtract(exclude_region_);
@@ -212,6 +227,7 @@ void ScreenCapturerMirror::reset()
     desktop_dc_.close();
     helper_.reset();
     frame_.reset();
+    block_region_.reset();
 }
 
 void ScreenCapturerMirror::updateExcludeRegion()
@@ -307,6 +323,9 @@ ScreenCapturerMirror::Error ScreenCapturerMirror::prepareCaptureResources()
         }
 
         frame_->setCapturerType(static_cast<uint32_t>(type()));
+
+        block_region_ = std::make_unique<BlockRegion>(screen_rect.size(), kBlockSize);
+        is_full_update_ = true;
     }
 
     return Error::SUCCEEDED;
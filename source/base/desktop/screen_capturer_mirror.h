@@ -24,6 +24,7 @@
 
 namespace base {
 
+class BlockRegion;
 class MirrorHelper;
 class SharedMemoryFactory;
 
@@ -55,6 +56,13 @@ private:
     std::unique_ptr<MirrorHelper> helper_;
     std::unique_ptr<Frame> frame_;
 
+    // The change records of the driver are collected into blocks, so that thousands of small
+    // rectangles per frame do not make the region operations quadratic.
+    std::unique_ptr<BlockRegion> block_region_;
+
+    // The first capture into a new frame copies the whole screen.
+    bool is_full_update_ = true;
+
     ScreenId current_screen_id_ = kFullDesktopScreenId;
     std::wstring current_device_key_;
 
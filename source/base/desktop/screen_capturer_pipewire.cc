@@ -0,0 +1,609 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/desktop/screen_capturer_pipewire.h"
+
+#include "base/logging.h"
+#include "base/desktop/frame_simple.h"
+#include "base/desktop/linux/screen_cast_portal.h"
+
+#include <spa/buffer/meta.h>
+#include <spa/pod/builder.h>
+
+#include <linux/dma-buf.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace base {
+
+namespace {
+
+// Layout of DMA-BUF frames which can be read by the CPU without an import into the GPU (the value
+// of DRM_FORMAT_MOD_LINEAR).
+const int64_t kDrmFormatModLinear = 0;
+
+const int kMaxDamageRects = 16;
+const int kMaxStreamSize = 16384;
+
+// The first frame arrives after the format negotiation.
+const std::chrono::seconds kFirstFrameTimeout { 5 };
+
+void syncDmaBuf(int fd, uint64_t flags)
+{
+    dma_buf_sync sync;
+    sync.flags = flags | DMA_BUF_SYNC_READ;
+
+    while (ioctl(fd, DMA_BUF_IOCTL_SYNC, &sync) == -1 && (errno == EINTR || errno == EAGAIN))
+    {
+        // Repeat the call.
+    }
+}
+
+} // namespace
+
+ScreenCapturerPipeWire::ScreenCapturerPipeWire()
+    : ScreenCapturer(ScreenCapturer::Type::LINUX_PIPEWIRE)
+{
+    LOG(LS_INFO) << "Ctor";
+
+    memset(&stream_listener_, 0, sizeof(stream_listener_));
+    memset(&stream_events_, 0, sizeof(stream_events_));
+    memset(&video_format_, 0, sizeof(video_format_));
+
+    stream_events_.version = PW_VERSION_STREAM_EVENTS;
+    stream_events_.state_changed = &ScreenCapturerPipeWire::onStreamStateChanged;
+    stream_events_.param_changed = &ScreenCapturerPipeWire::onStreamParamChanged;
+    stream_events_.process = &ScreenCapturerPipeWire::onStreamProcess;
+}
+
+ScreenCapturerPipeWire::~ScreenCapturerPipeWire()
+{
+    LOG(LS_INFO) << "Dtor";
+    deinit();
+}
+
+// static
+std::unique_ptr<ScreenCapturerPipeWire> ScreenCapturerPipeWire::create()
+{
+    std::unique_ptr<ScreenCapturerPipeWire> instance = std::make_unique<ScreenCapturerPipeWire>();
+    if (!instance->init())
+    {
+        LOG(LS_ERROR) << "Unable to initialize PipeWire screen capturer";
+        return nullptr;
+    }
+
+    return instance;
+}
+
+int ScreenCapturerPipeWire::screenCount()
+{
+    // The user selects one monitor in the dialog of the portal.
+    return 1;
+}
+
+bool ScreenCapturerPipeWire::screenList(ScreenList* screens)
+{
+    DCHECK(screens->screens.size() == 0);
+
+    Screen screen;
+    screen.id = 0;
+    screen.title = "Screen cast";
+    screen.dpi = Point(96, 96);
+    screen.is_primary = true;
+
+    {
+        std::scoped_lock lock(frame_lock_);
+        if (stream_frame_)
+            screen.resolution = stream_frame_->size();
+    }
+
+    screens->screens.emplace_back(std::move(screen));
+    return true;
+}
+
+bool ScreenCapturerPipeWire::selectScreen(ScreenId screen_id)
+{
+    return screen_id == 0 || screen_id == kFullDesktopScreenId;
+}
+
+ScreenCapturer::ScreenId ScreenCapturerPipeWire::currentScreen() const
+{
+    return 0;
+}
+
+const Frame* ScreenCapturerPipeWire::captureFrame(Error* error)
+{
+    if (has_error_.load(std::memory_order_acquire))
+    {
+        LOG(LS_ERROR) << "PipeWire stream failed";
+        *error = Error::PERMANENT;
+        return nullptr;
+    }
+
+    std::scoped_lock lock(frame_lock_);
+
+    if (!stream_frame_)
+    {
+        *error = Error::TEMPORARY;
+        return nullptr;
+    }
+
+    Frame* frame = queue_.currentFrame();
+
+    // The compositor sends frames only when the screen changes.
+    if (frame && frame->size() == stream_frame_->size() && pending_region_.isEmpty())
+    {
+        frame->updatedRegion()->clear();
+        *error = Error::SUCCEEDED;
+        return frame;
+    }
+
+    queue_.moveToNextFrame();
+    frame = queue_.currentFrame();
+
+    Region copy_region;
+
+    if (!frame || frame->size() != stream_frame_->size())
+    {
+        if (frame)
+            queue_.reset();
+
+        queue_.replaceCurrentFrame(FrameSimple::create(stream_frame_->size(), PixelFormat::ARGB()));
+        frame = queue_.currentFrame();
+
+        pending_region_.setRect(Rect::makeSize(stream_frame_->size()));
+        copy_region = pending_region_;
+    }
+    else
+    {
+        copy_region = pending_region_;
+        copy_region.addRegion(last_updated_region_);
+    }
+
+    for (Region::Iterator it(copy_region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+        frame->copyPixelsFrom(*stream_frame_, rect.topLeft(), rect);
+    }
+
+    *frame->updatedRegion() = pending_region_;
+    last_updated_region_.swap(&pending_region_);
+    pending_region_.clear();
+
+    *error = Error::SUCCEEDED;
+    return frame;
+}
+
+const MouseCursor* ScreenCapturerPipeWire::captureCursor()
+{
+    // The cursor is drawn into the frames by the compositor.
+    return nullptr;
+}
+
+Point ScreenCapturerPipeWire::cursorPosition()
+{
+    return Point(0, 0);
+}
+
+int ScreenCapturerPipeWire::frameBufferCount() const
+{
+    return FrameQueue<Frame>::kQueueLength;
+}
+
+void ScreenCapturerPipeWire::reset()
+{
+    queue_.reset();
+
+    // The next capture copies the whole frame.
+    std::scoped_lock lock(frame_lock_);
+    if (stream_frame_)
+        pending_region_.setRect(Rect::makeSize(stream_frame_->size()));
+}
+
+bool ScreenCapturerPipeWire::init()
+{
+    portal_ = std::make_unique<ScreenCastPortal>();
+    if (!portal_->start())
+        return false;
+
+    int fd = portal_->openPipeWireRemote();
+    if (fd == -1)
+        return false;
+
+    pw_init(nullptr, nullptr);
+
+    loop_ = pw_thread_loop_new("aspia-pipewire", nullptr);
+    if (!loop_)
+    {
+        LOG(LS_ERROR) << "pw_thread_loop_new failed";
+        close(fd);
+        return false;
+    }
+
+    context_ = pw_context_new(pw_thread_loop_get_loop(loop_), nullptr, 0);
+    if (!context_)
+    {
+        LOG(LS_ERROR) << "pw_context_new failed";
+        close(fd);
+        return false;
+    }
+
+    if (pw_thread_loop_start(loop_) < 0)
+    {
+        LOG(LS_ERROR) << "pw_thread_loop_start failed";
+        close(fd);
+        return false;
+    }
+
+    pw_thread_loop_lock(loop_);
+
+    // The core owns the file descriptor from now on.
+    core_ = pw_context_connect_fd(context_, fd, nullptr, 0);
+    if (!core_)
+    {
+        LOG(LS_ERROR) << "pw_context_connect_fd failed";
+        pw_thread_loop_unlock(loop_);
+        return false;
+    }
+
+    stream_ = pw_stream_new(core_, "aspia-screen-capturer",
+                            pw_properties_new(PW_KEY_MEDIA_TYPE, "Video",
+                                              PW_KEY_MEDIA_CATEGORY, "Capture",
+                                              PW_KEY_MEDIA_ROLE, "Screen",
+                                              nullptr));
+    if (!stream_)
+    {
+        LOG(LS_ERROR) << "pw_stream_new failed";
+        pw_thread_loop_unlock(loop_);
+        return false;
+    }
+
+    pw_stream_add_listener(stream_, &stream_listener_, &stream_events_, this);
+
+    uint8_t buffer[4096];
+    spa_pod_builder builder = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+
+    const spa_pod* params[4];
+    const int param_count = buildFormatParams(&builder, params);
+
+    int ret = pw_stream_connect(stream_, PW_DIRECTION_INPUT, portal_->nodeId(),
+        static_cast<pw_stream_flags>(PW_STREAM_FLAG_AUTOCONNECT | PW_STREAM_FLAG_MAP_BUFFERS),
+        params, static_cast<uint32_t>(param_count));
+
+    pw_thread_loop_unlock(loop_);
+
+    if (ret != 0)
+    {
+        LOG(LS_ERROR) << "pw_stream_connect failed: " << ret;
+        return false;
+    }
+
+    // Wait for the first frame, so that the size of the screen is known.
+    std::unique_lock lock(frame_lock_);
+    if (!first_frame_event_.wait_for(lock, kFirstFrameTimeout, [this]()
+        {
+            return stream_frame_ != nullptr || has_error_.load(std::memory_order_acquire);
+        }))
+    {
+        LOG(LS_ERROR) << "No frames from the PipeWire stream";
+        return false;
+    }
+
+    return !has_error_.load(std::memory_order_acquire);
+}
+
+void ScreenCapturerPipeWire::deinit()
+{
+    // After the loop is stopped, the callbacks are not called anymore.
+    if (loop_)
+        pw_thread_loop_stop(loop_);
+
+    if (stream_)
+    {
+        pw_stream_destroy(stream_);
+        stream_ = nullptr;
+    }
+
+    if (core_)
+    {
+        pw_core_disconnect(core_);
+        core_ = nullptr;
+    }
+
+    if (context_)
+    {
+        pw_context_destroy(context_);
+        context_ = nullptr;
+    }
+
+    if (loop_)
+    {
+        pw_thread_loop_destroy(loop_);
+        loop_ = nullptr;
+    }
+
+    portal_.reset();
+}
+
+int ScreenCapturerPipeWire::buildFormatParams(spa_pod_builder* builder, const spa_pod** params)
+{
+    // Both formats have the memory layout of PixelFormat::ARGB().
+    static const uint32_t kFormats[] = { SPA_VIDEO_FORMAT_BGRx, SPA_VIDEO_FORMAT_BGRA };
+
+    Size stream_size = portal_->streamSize();
+    if (stream_size.isEmpty())
+        stream_size = Size(1920, 1080);
+
+    spa_rectangle default_size = { static_cast<uint32_t>(stream_size.width()),
+                                   static_cast<uint32_t>(stream_size.height()) };
+    spa_rectangle min_size = { 1, 1 };
+    spa_rectangle max_size = { kMaxStreamSize, kMaxStreamSize };
+
+    // Zero means a variable frame rate: the compositor sends frames when the screen changes.
+    spa_fraction default_rate = { 0, 1 };
+    spa_fraction min_rate = { 0, 1 };
+    spa_fraction max_rate = { 60, 1 };
+
+    int count = 0;
+
+    // DMA-BUF formats go first, so that they are preferred.
+    for (bool with_modifier : { true, false })
+    {
+        for (uint32_t format : kFormats)
+        {
+            spa_pod_frame frames[2];
+            spa_pod_builder_push_object(
+                builder, &frames[0], SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat);
+
+            spa_pod_builder_add(builder,
+                SPA_FORMAT_mediaType, SPA_POD_Id(SPA_MEDIA_TYPE_video),
+                SPA_FORMAT_mediaSubtype, SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw),
+                SPA_FORMAT_VIDEO_format, SPA_POD_Id(format),
+                SPA_FORMAT_VIDEO_size,
+                SPA_POD_CHOICE_RANGE_Rectangle(&default_size, &min_size, &max_size),
+                SPA_FORMAT_VIDEO_framerate,
+                SPA_POD_CHOICE_RANGE_Fraction(&default_rate, &min_rate, &max_rate),
+                0);
+
+            if (with_modifier)
+            {
+                spa_pod_builder_prop(builder, SPA_FORMAT_VIDEO_modifier,
+                                     SPA_POD_PROP_FLAG_MANDATORY | SPA_POD_PROP_FLAG_DONT_FIXATE);
+                spa_pod_builder_push_choice(builder, &frames[1], SPA_CHOICE_Enum, 0);
+
+                // The first value is the default one.
+                spa_pod_builder_long(builder, kDrmFormatModLinear);
+                spa_pod_builder_long(builder, kDrmFormatModLinear);
+                spa_pod_builder_pop(builder, &frames[1]);
+            }
+
+            params[count++] = static_cast<const spa_pod*>(spa_pod_builder_pop(builder, &frames[0]));
+        }
+    }
+
+    return count;
+}
+
+// static
+void ScreenCapturerPipeWire::onStreamStateChanged(void* data, pw_stream_state /* old_state */,
+                                                  pw_stream_state state, const char* error)
+{
+    ScreenCapturerPipeWire* self = static_cast<ScreenCapturerPipeWire*>(data);
+
+    LOG(LS_INFO) << "PipeWire stream state: " << pw_stream_state_as_string(state);
+
+    if (state == PW_STREAM_STATE_ERROR || state == PW_STREAM_STATE_UNCONNECTED)
+    {
+        if (error)
+            LOG(LS_ERROR) << "PipeWire stream error: " << error;
+
+        std::scoped_lock lock(self->frame_lock_);
+        self->has_error_.store(true, std::memory_order_release);
+        self->first_frame_event_.notify_all();
+    }
+}
+
+// static
+void ScreenCapturerPipeWire::onStreamParamChanged(void* data, uint32_t id, const spa_pod* param)
+{
+    ScreenCapturerPipeWire* self = static_cast<ScreenCapturerPipeWire*>(data);
+
+    if (!param || id != SPA_PARAM_Format)
+        return;
+
+    spa_video_info_raw video_format;
+    memset(&video_format, 0, sizeof(video_format));
+
+    if (spa_format_video_raw_parse(param, &video_format) < 0)
+    {
+        LOG(LS_ERROR) << "Unable to parse the video format";
+        return;
+    }
+
+    self->video_format_ = video_format;
+    self->use_dma_buf_ = spa_pod_find_prop(param, nullptr, SPA_FORMAT_VIDEO_modifier) != nullptr;
+
+    LOG(LS_INFO) << "PipeWire stream format: " << video_format.size.width << "x"
+                 << video_format.size.height << " (DMA-BUF: " << self->use_dma_buf_ << ")";
+
+    const int data_types = self->use_dma_buf_ ?
+        (1 << SPA_DATA_DmaBuf) : ((1 << SPA_DATA_MemFd) | (1 << SPA_DATA_MemPtr));
+    const int region_size = static_cast<int>(sizeof(spa_meta_region));
+
+    uint8_t buffer[1024];
+    spa_pod_builder builder = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+
+    const spa_pod* params[3];
+
+    params[0] = static_cast<const spa_pod*>(spa_pod_builder_add_object(&builder,
+        SPA_TYPE_OBJECT_ParamBuffers, SPA_PARAM_Buffers,
+        SPA_PARAM_BUFFERS_dataType, SPA_POD_CHOICE_FLAGS_Int(data_types)));
+
+    params[1] = static_cast<const spa_pod*>(spa_pod_builder_add_object(&builder,
+        SPA_TYPE_OBJECT_ParamMeta, SPA_PARAM_Meta,
+        SPA_PARAM_META_type, SPA_POD_Id(SPA_META_Header),
+        SPA_PARAM_META_size, SPA_POD_Int(static_cast<int>(sizeof(spa_meta_header)))));
+
+    // The compositor reports the changed areas of each frame.
+    params[2] = static_cast<const spa_pod*>(spa_pod_builder_add_object(&builder,
+        SPA_TYPE_OBJECT_ParamMeta, SPA_PARAM_Meta,
+        SPA_PARAM_META_type, SPA_POD_Id(SPA_META_VideoDamage),
+        SPA_PARAM_META_size, SPA_POD_CHOICE_RANGE_Int(
+            region_size * kMaxDamageRects, region_size, region_size * kMaxDamageRects)));
+
+    pw_stream_update_params(self->stream_, params, 3);
+}
+
+// static
+void ScreenCapturerPipeWire::onStreamProcess(void* data)
+{
+    ScreenCapturerPipeWire* self = static_cast<ScreenCapturerPipeWire*>(data);
+
+    // Only the newest buffer is used. The older ones are returned to the stream.
+    pw_buffer* buffer = nullptr;
+    while (pw_buffer* next = pw_stream_dequeue_buffer(self->stream_))
+    {
+        if (buffer)
+            pw_stream_queue_buffer(self->stream_, buffer);
+        buffer = next;
+    }
+
+    if (!buffer)
+        return;
+
+    self->processBuffer(buffer->buffer);
+    pw_stream_queue_buffer(self->stream_, buffer);
+}
+
+void ScreenCapturerPipeWire::processBuffer(spa_buffer* buffer)
+{
+    spa_data& data = buffer->datas[0];
+
+    // Buffers without data only update the cursor.
+    if (!data.chunk || !data.chunk->size || (data.chunk->flags & SPA_CHUNK_FLAG_CORRUPTED))
+        return;
+
+    spa_meta_header* header = static_cast<spa_meta_header*>(
+        spa_buffer_find_meta_data(buffer, SPA_META_Header, sizeof(spa_meta_header)));
+    if (header && (header->flags & SPA_META_HEADER_FLAG_CORRUPTED))
+        return;
+
+    const Size size(static_cast<int32_t>(video_format_.size.width),
+                    static_cast<int32_t>(video_format_.size.height));
+    if (size.isEmpty())
+        return;
+
+    const uint8_t* source = nullptr;
+    uint8_t* map = nullptr;
+    size_t map_size = 0;
+
+    if (data.type == SPA_DATA_DmaBuf)
+    {
+        if (data.data)
+        {
+            source = static_cast<const uint8_t*>(data.data);
+        }
+        else
+        {
+            map_size = data.maxsize + data.mapoffset;
+            void* address = mmap(nullptr, map_size, PROT_READ, MAP_SHARED, data.fd, 0);
+            if (address == MAP_FAILED)
+            {
+                LOG(LS_ERROR) << "Unable to map DMA-BUF: " << errno;
+                return;
+            }
+
+            map = static_cast<uint8_t*>(address);
+            source = map + data.mapoffset;
+        }
+
+        // The GPU may still be writing the buffer.
+        syncDmaBuf(data.fd, DMA_BUF_SYNC_START);
+    }
+    else if (data.type == SPA_DATA_MemFd || data.type == SPA_DATA_MemPtr)
+    {
+        source = static_cast<const uint8_t*>(data.data);
+    }
+
+    if (!source)
+        return;
+
+    source += data.chunk->offset;
+
+    int stride = data.chunk->stride;
+    if (stride <= 0)
+        stride = size.width() * PixelFormat::ARGB().bytesPerPixel();
+
+    const Rect frame_rect = Rect::makeSize(size);
+    Region damage;
+
+    spa_meta* damage_meta = spa_buffer_find_meta(buffer, SPA_META_VideoDamage);
+    if (damage_meta)
+    {
+        spa_meta_region* region;
+        spa_meta_for_each(region, damage_meta)
+        {
+            if (!spa_meta_region_is_valid(region))
+                break;
+
+            damage.addRect(Rect::makeXYWH(region->region.position.x,
+                                          region->region.position.y,
+                                          static_cast<int32_t>(region->region.size.width),
+                                          static_cast<int32_t>(region->region.size.height)));
+        }
+
+        damage.intersectWith(frame_rect);
+    }
+
+    // Without the damage information the whole frame is updated.
+    if (damage.isEmpty())
+        damage.setRect(frame_rect);
+
+    {
+        std::scoped_lock lock(frame_lock_);
+
+        if (!stream_frame_ || stream_frame_->size() != size)
+        {
+            stream_frame_ = FrameSimple::create(size, PixelFormat::ARGB());
+            damage.setRect(frame_rect);
+        }
+
+        const int bytes_per_pixel = stream_frame_->format().bytesPerPixel();
+
+        for (Region::Iterator it(damage); !it.isAtEnd(); it.advance())
+        {
+            const Rect& rect = it.rect();
+            stream_frame_->copyPixelsFrom(
+                source + rect.top() * stride + rect.left() * bytes_per_pixel, stride, rect);
+        }
+
+        pending_region_.addRegion(damage);
+        first_frame_event_.notify_all();
+    }
+
+    if (data.type == SPA_DATA_DmaBuf)
+        syncDmaBuf(data.fd, DMA_BUF_SYNC_END);
+
+    if (map)
+        munmap(map, map_size);
+}
+
+} // namespace base
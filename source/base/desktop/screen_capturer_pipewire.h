@@ -0,0 +1,112 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef BASE_DESKTOP_SCREEN_CAPTURER_PIPEWIRE_H
+#define BASE_DESKTOP_SCREEN_CAPTURER_PIPEWIRE_H
+
+#include "base/desktop/screen_capturer.h"
+#include "base/desktop/frame.h"
+#include "base/desktop/region.h"
+
+#include <pipewire/pipewire.h>
+#include <spa/param/video/format-utils.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+namespace base {
+
+class ScreenCastPortal;
+
+// Captures the screen on Wayland through the ScreenCast portal and PipeWire. The compositor
+// sends the frames with the damaged areas, so only the changed parts of the screen are copied.
+// DMA-BUF frames with the linear layout are mapped directly, other frames are received in shared
+// memory.
+class ScreenCapturerPipeWire : public ScreenCapturer
+{
+public:
+    ScreenCapturerPipeWire();
+    ~ScreenCapturerPipeWire() override;
+
+    // Returns nullptr if the portal or PipeWire is not available or the user has refused the
+    // capture.
+    static std::unique_ptr<ScreenCapturerPipeWire> create();
+
+    // ScreenCapturer implementation.
+    int screenCount() override;
+    bool screenList(ScreenList* screens) override;
+    bool selectScreen(ScreenId screen_id) override;
+    ScreenId currentScreen() const override;
+    const Frame* captureFrame(Error* error) override;
+    const MouseCursor* captureCursor() override;
+    Point cursorPosition() override;
+    int frameBufferCount() const override;
+
+protected:
+    // ScreenCapturer implementation.
+    void reset() override;
+
+private:
+    bool init();
+    void deinit();
+
+    // Sends the formats which the capturer accepts to the stream.
+    int buildFormatParams(spa_pod_builder* builder, const spa_pod** params);
+
+    // Called on the thread of the PipeWire loop.
+    static void onStreamStateChanged(void* data, pw_stream_state old_state,
+                                     pw_stream_state state, const char* error);
+    static void onStreamParamChanged(void* data, uint32_t id, const spa_pod* param);
+    static void onStreamProcess(void* data);
+    void processBuffer(spa_buffer* buffer);
+
+    std::unique_ptr<ScreenCastPortal> portal_;
+
+    pw_thread_loop* loop_ = nullptr;
+    pw_context* context_ = nullptr;
+    pw_core* core_ = nullptr;
+    pw_stream* stream_ = nullptr;
+    spa_hook stream_listener_;
+    pw_stream_events stream_events_;
+
+    // Negotiated format of the stream. Accessed on the thread of the PipeWire loop.
+    spa_video_info_raw video_format_;
+    bool use_dma_buf_ = false;
+
+    std::atomic<bool> has_error_ { false };
+
+    // The newest image of the stream and the area changed since the last capture. Written on the
+    // thread of the PipeWire loop and read by the capturer.
+    std::mutex frame_lock_;
+    std::condition_variable first_frame_event_;
+    std::unique_ptr<Frame> stream_frame_;
+    Region pending_region_;
+
+    // Queue of the frame buffers.
+    FrameQueue<Frame> queue_;
+
+    // The region updated by the previous capture. The current frame of the queue was last written
+    // two captures ago, so it is updated with both regions.
+    Region last_updated_region_;
+
+    DISALLOW_COPY_AND_ASSIGN(ScreenCapturerPipeWire);
+};
+
+} // namespace base
+
+#endif // BASE_DESKTOP_SCREEN_CAPTURER_PIPEWIRE_H
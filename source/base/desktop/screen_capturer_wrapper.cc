@@ -19,6 +19,7 @@
 #include "base/desktop/screen_capturer_wrapper.h"
 
 #include "base/logging.h"
+#include "base/trace_event.h"
 #include "base/desktop/desktop_environment.h"
 #include "base/desktop/desktop_resizer.h"
 #include "base/desktop/mouse_cursor.h"
@@ -31,77 +32,97 @@
 #include "base/desktop/screen_capturer_mirror.h"
 #include "base/win/windows_version.h"
 #elif defined(OS_LINUX)
-// TODO
+#include "base/environment.h"
+#include "base/desktop/screen_capturer_x11.h"
+#if defined(USE_PIPEWIRE)
+#include "base/desktop/screen_capturer_pipewire.h"
+#endif // defined(USE_PIPEWIRE)
 #elif defined(OS_MAC)
-// TODO
+#include "base/desktop/screen_capturer_mac.h"
 #else
 #error Platform support not implemented
 #endif
 
 namespace base {
 
+#if defined(OS_WIN)
+namespace {
+
+// A frame captured from the wrong desktop is black, so the interval should stay short.
+constexpr std::chrono::milliseconds kInputDesktopCheckInterval { 200 };
+
+} // namespace
+#endif // defined(OS_WIN)
+
 ScreenCapturerWrapper::ScreenCapturerWrapper(ScreenCapturer::Type preferred_type,
                                              Delegate* delegate)
     : preferred_type_(preferred_type),
-      delegate_(delegate),
-      power_save_blocker_(std::make_unique<PowerSaveBlocker>()),
-      environment_(DesktopEnvironment::create())
+      delegate_(delegate)
 {
     LOG(LS_INFO) << "Ctor";
 
     switchToInputDesktop();
+    selectCapturer();
+}
 
-#if defined(OS_WIN)
-    // If the monitor is turned off, this call will turn it on.
-    if (!SetThreadExecutionState(ES_DISPLAY_REQUIRED))
-    {
-        PLOG(LS_WARNING) << "SetThreadExecutionState failed";
-    }
+ScreenCapturerWrapper::~ScreenCapturerWrapper()
+{
+    LOG(LS_INFO) << "Dtor";
+}
 
-    wchar_t desktop[100] = { 0 };
-    if (desktop_.assignedDesktop().name(desktop, sizeof(desktop)))
-    {
-        if (_wcsicmp(desktop, L"Screen-saver") == 0)
-        {
-            auto send_key = [](WORD key_code, DWORD flags)
-            {
-                INPUT input;
-                memset(&input, 0, sizeof(input));
+void ScreenCapturerWrapper::setSuspended(bool suspended)
+{
+    DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
 
-                input.type       = INPUT_KEYBOARD;
-                input.ki.wVk     = key_code;
-                input.ki.dwFlags = flags;
-                input.ki.wScan   = static_cast<WORD>(MapVirtualKeyW(key_code, MAPVK_VK_TO_VSC));
+    if (is_suspended_ == suspended)
+        return;
 
-                // Do the keyboard event.
-                if (!SendInput(1, &input, sizeof(input)))
-                {
-                    PLOG(LS_WARNING) << "SendInput failed";
-                }
-            };
+    LOG(LS_INFO) << "Capturer " << (suspended ? "suspended" : "resumed");
+    is_suspended_ = suspended;
 
-            send_key(VK_SPACE, 0);
-            send_key(VK_SPACE, KEYEVENTF_KEYUP);
-        }
-    }
-    else
+    if (suspended)
     {
-        LOG(LS_WARNING) << "Unable to get name of desktop";
+        // The display may turn off and the desktop settings are restored for the user, but the
+        // capturer and its frame buffers are kept.
+        environment_.reset();
+        power_save_blocker_.reset();
+        return;
     }
-#endif // defined(OS_WIN)
 
-    selectCapturer();
+    power_save_blocker_ = std::make_unique<PowerSaveBlocker>();
+    environment_ = DesktopEnvironment::create();
+
+    switchToInputDesktop();
+    wakeUpDisplay();
+    restoreCapturer();
 }
 
-ScreenCapturerWrapper::~ScreenCapturerWrapper()
+void ScreenCapturerWrapper::releaseCapturer()
 {
-    LOG(LS_INFO) << "Dtor";
+    DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+
+    if (!screen_capturer_)
+        return;
+
+    LOG(LS_INFO) << "Capturer released";
+
+    screen_capturer_.reset();
+    last_mouse_cursor_.reset();
+    is_released_ = true;
 }
 
 void ScreenCapturerWrapper::selectScreen(ScreenCapturer::ScreenId screen_id, const Size& resolution)
 {
     DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
 
+    restoreCapturer();
+
+    if (!screen_capturer_)
+    {
+        LOG(LS_ERROR) << "Screen capturer NOT initialized";
+        return;
+    }
+
     if (screen_id == screen_capturer_->currentScreen())
     {
         if (resolution.isEmpty())
@@ -181,15 +202,15 @@ void ScreenCapturerWrapper::captureFrame()
 {
     DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
 
+    restoreCapturer();
+
     if (!screen_capturer_)
     {
         LOG(LS_ERROR) << "Screen capturer NOT initialized";
         return;
     }
 
-    switchToInputDesktop();
-
-    ++capture_counter_;
+    checkInputDesktop();
 
     int count = screen_capturer_->screenCount();
     if (screen_count_ != count)
@@ -204,9 +225,18 @@ void ScreenCapturerWrapper::captureFrame()
     }
 
     ScreenCapturer::Error error;
-    const Frame* frame = screen_capturer_->captureFrame(&error);
+    const Frame* frame;
+    {
+        TRACE_EVENT("capture");
+        frame = screen_capturer_->captureFrame(&error);
+    }
     if (!frame)
     {
+#if defined(OS_WIN)
+        // The capture fails when the input desktop is switched.
+        last_desktop_check_ = std::chrono::steady_clock::time_point();
+#endif // defined(OS_WIN)
+
         switch (error)
         {
             case ScreenCapturer::Error::TEMPORARY:
@@ -234,29 +264,40 @@ void ScreenCapturerWrapper::captureFrame()
         permanent_error_count_ = 0;
     }
 
-    const MouseCursor* mouse_cursor = nullptr;
+    delegate_->onScreenCaptured(frame);
+}
+
+void ScreenCapturerWrapper::captureCursor()
+{
+    DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+
+    restoreCapturer();
+
+    if (!screen_capturer_)
+        return;
+
+    checkInputDesktop();
 
-    // Cursor capture only on even frames.
-    if ((capture_counter_ % 2) == 0)
+    const MouseCursor* mouse_cursor = screen_capturer_->captureCursor();
+    if (mouse_cursor && (!last_mouse_cursor_ || !last_mouse_cursor_->equals(*mouse_cursor)))
     {
-        mouse_cursor = screen_capturer_->captureCursor();
+        last_mouse_cursor_ = std::make_unique<MouseCursor>(*mouse_cursor);
+        delegate_->onCursorCaptured(*mouse_cursor);
+    }
 
-        if (enable_cursor_position_)
-        {
-            Point cursor_pos = screen_capturer_->cursorPosition();
+    if (enable_cursor_position_)
+    {
+        Point cursor_pos = screen_capturer_->cursorPosition();
 
-            int32_t delta_x = std::abs(cursor_pos.x() - last_cursor_pos_.x());
-            int32_t delta_y = std::abs(cursor_pos.y() - last_cursor_pos_.y());
+        int32_t delta_x = std::abs(cursor_pos.x() - last_cursor_pos_.x());
+        int32_t delta_y = std::abs(cursor_pos.y() - last_cursor_pos_.y());
 
-            if (delta_x > 1 || delta_y > 1)
-            {
-                delegate_->onCursorPositionChanged(cursor_pos);
-                last_cursor_pos_ = cursor_pos;
-            }
+        if (delta_x > 1 || delta_y > 1)
+        {
+            delegate_->onCursorPositionChanged(cursor_pos);
+            last_cursor_pos_ = cursor_pos;
         }
     }
-
-    delegate_->onScreenCaptured(frame, mouse_cursor);
 }
 
 void ScreenCapturerWrapper::setSharedMemoryFactory(SharedMemoryFactory* shared_memory_factory)
@@ -308,6 +349,30 @@ void ScreenCapturerWrapper::enableCursorPosition(bool enable)
     enable_cursor_position_ = enable;
 }
 
+void ScreenCapturerWrapper::setPreferredLayout(Frame::Layout layout)
+{
+    preferred_layout_ = layout;
+
+    if (screen_capturer_)
+        screen_capturer_->setPreferredLayout(layout);
+}
+
+void ScreenCapturerWrapper::setPreferredSize(const Size& size)
+{
+    preferred_size_ = size;
+
+    if (screen_capturer_)
+        screen_capturer_->setPreferredSize(size);
+}
+
+int ScreenCapturerWrapper::frameBufferCount() const
+{
+    if (!screen_capturer_)
+        return 1;
+
+    return screen_capturer_->frameBufferCount();
+}
+
 ScreenCapturer::ScreenId ScreenCapturerWrapper::defaultScreen()
 {
     ScreenCapturer::ScreenList screen_list;
@@ -404,14 +469,65 @@ void ScreenCapturerWrapper::selectCapturer()
     }
 
 #elif defined(OS_LINUX)
-    NOTIMPLEMENTED();
+    // The portal session of the previous capturer must be closed before a new one is created.
+    screen_capturer_.reset();
+
+#if defined(USE_PIPEWIRE)
+    static const int kMaxPermanentErrorCount = 5;
+
+    std::string session_type;
+    Environment::get("XDG_SESSION_TYPE", &session_type);
+
+    // On Wayland the X11 capturer sees only the windows of Xwayland clients.
+    const bool is_wayland = session_type == "wayland" || Environment::has("WAYLAND_DISPLAY");
+
+    if (permanent_error_count_ >= kMaxPermanentErrorCount)
+    {
+        LOG(LS_INFO) << "Number of permanent errors has been exceeded. Reset to X11 capturer";
+        permanent_error_count_ = 0;
+    }
+    else if (preferred_type_ == ScreenCapturer::Type::LINUX_PIPEWIRE ||
+             (preferred_type_ == ScreenCapturer::Type::DEFAULT && is_wayland))
+    {
+        screen_capturer_ = ScreenCapturerPipeWire::create();
+        if (screen_capturer_)
+            LOG(LS_INFO) << "Using PipeWire capturer";
+        else
+            LOG(LS_INFO) << "PipeWire capturer unavailable";
+    }
+#endif // defined(USE_PIPEWIRE)
+
+    if (!screen_capturer_)
+    {
+        LOG(LS_INFO) << "Using X11 capturer";
+        screen_capturer_ = ScreenCapturerX11::create();
+    }
+
+    if (!screen_capturer_)
+    {
+        LOG(LS_ERROR) << "No screen capturer available";
+        return;
+    }
 #elif defined(OS_MAC)
-    NOTIMPLEMENTED();
+    LOG(LS_INFO) << "Using ScreenCaptureKit capturer";
+    screen_capturer_ = ScreenCapturerMac::create();
+
+    if (!screen_capturer_)
+    {
+        LOG(LS_ERROR) << "No screen capturer available";
+        return;
+    }
 #else
     NOTIMPLEMENTED();
 #endif
 
     screen_capturer_->setSharedMemoryFactory(shared_memory_factory_);
+    screen_capturer_->setPreferredLayout(preferred_layout_);
+    screen_capturer_->setPreferredSize(preferred_size_);
+
+    // The new capturer may report the same cursor in a different way.
+    last_mouse_cursor_.reset();
+
     if (last_screen_id_ != ScreenCapturer::kInvalidScreenId)
     {
         LOG(LS_INFO) << "Restore selected screen: " << last_screen_id_;
@@ -419,10 +535,75 @@ void ScreenCapturerWrapper::selectCapturer()
     }
 }
 
+void ScreenCapturerWrapper::restoreCapturer()
+{
+    if (!is_released_)
+        return;
+
+    LOG(LS_INFO) << "Restoring released capturer";
+
+    is_released_ = false;
+    selectCapturer();
+}
+
+void ScreenCapturerWrapper::wakeUpDisplay()
+{
+#if defined(OS_WIN)
+    // If the monitor is turned off, this call will turn it on.
+    if (!SetThreadExecutionState(ES_DISPLAY_REQUIRED))
+    {
+        PLOG(LS_WARNING) << "SetThreadExecutionState failed";
+    }
+
+    wchar_t desktop[100] = { 0 };
+    if (desktop_.assignedDesktop().name(desktop, sizeof(desktop)))
+    {
+        if (_wcsicmp(desktop, L"Screen-saver") == 0)
+        {
+            auto send_key = [](WORD key_code, DWORD flags)
+            {
+                INPUT input;
+                memset(&input, 0, sizeof(input));
+
+                input.type       = INPUT_KEYBOARD;
+                input.ki.wVk     = key_code;
+                input.ki.dwFlags = flags;
+                input.ki.wScan   = static_cast<WORD>(MapVirtualKeyW(key_code, MAPVK_VK_TO_VSC));
+
+                // Do the keyboard event.
+                if (!SendInput(1, &input, sizeof(input)))
+                {
+                    PLOG(LS_WARNING) << "SendInput failed";
+                }
+            };
+
+            send_key(VK_SPACE, 0);
+            send_key(VK_SPACE, KEYEVENTF_KEYUP);
+        }
+    }
+    else
+    {
+        LOG(LS_WARNING) << "Unable to get name of desktop";
+    }
+#endif // defined(OS_WIN)
+}
+
+void ScreenCapturerWrapper::checkInputDesktop()
+{
+#if defined(OS_WIN)
+    if (std::chrono::steady_clock::now() - last_desktop_check_ < kInputDesktopCheckInterval)
+        return;
+#endif // defined(OS_WIN)
+
+    switchToInputDesktop();
+}
+
 void ScreenCapturerWrapper::switchToInputDesktop()
 {
     DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
 #if defined(OS_WIN)
+    last_desktop_check_ = std::chrono::steady_clock::now();
+
     // Switch to the desktop receiving user input if different from the current one.
     Desktop input_desktop(Desktop::inputDesktop());
 
@@ -447,7 +628,7 @@ void ScreenCapturerWrapper::switchToInputDesktop()
         {
             environment_->onDesktopChanged();
         }
-        else
+        else if (!is_suspended_)
         {
             LOG(LS_WARNING) << "Desktop environment not initialized";
         }
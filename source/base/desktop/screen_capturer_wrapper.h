@@ -25,6 +25,8 @@
 
 #if defined(OS_WIN)
 #include "base/win/scoped_thread_desktop.h"
+
+#include <chrono>
 #elif defined(OS_LINUX)
 #endif
 
@@ -45,25 +47,52 @@ public:
 
         virtual void onScreenListChanged(
             const ScreenCapturer::ScreenList& list, ScreenCapturer::ScreenId current) = 0;
-        virtual void onScreenCaptured(const Frame* frame, const MouseCursor* mouse_cursor) = 0;
+        virtual void onScreenCaptured(const Frame* frame) = 0;
         virtual void onScreenCaptureError(ScreenCapturer::Error error) = 0;
+        virtual void onCursorCaptured(const MouseCursor& mouse_cursor) = 0;
         virtual void onCursorPositionChanged(const Point& position) = 0;
     };
 
+    // The capturer is created suspended, so that it can be initialized before it is needed.
     ScreenCapturerWrapper(ScreenCapturer::Type preferred_type, Delegate* delegate);
     ~ScreenCapturerWrapper();
 
+    // While suspended the display is allowed to turn off and the desktop environment is not
+    // changed. The capturer must be resumed before capturing.
+    void setSuspended(bool suspended);
+    bool isSuspended() const { return is_suspended_; }
+
+    // Destroys the capturer with its device, duplication and frame buffers. It is created again
+    // when it is needed next time.
+    void releaseCapturer();
+
     void selectScreen(ScreenCapturer::ScreenId screen_id, const Size& resolution);
     void captureFrame();
+
+    // Captures the cursor independently of the frames, so that it can be polled more often than
+    // the screen. The delegate is called only if the shape or the position has changed.
+    void captureCursor();
     void setSharedMemoryFactory(SharedMemoryFactory* shared_memory_factory);
     void enableWallpaper(bool enable);
     void enableEffects(bool enable);
     void enableFontSmoothing(bool enable);
     void enableCursorPosition(bool enable);
+    void setPreferredLayout(Frame::Layout layout);
+    void setPreferredSize(const Size& size);
+
+    // Number of frame buffers of the current capturer. See ScreenCapturer::frameBufferCount().
+    int frameBufferCount() const;
 
 private:
     ScreenCapturer::ScreenId defaultScreen();
     void selectCapturer();
+    void restoreCapturer();
+    void wakeUpDisplay();
+
+    // Opening the input desktop is a kernel call, and desktop switches (UAC, lock screen) are
+    // rare, so it is checked at most once per kInputDesktopCheckInterval while capturing. After a
+    // capture error the next call checks it at once.
+    void checkInputDesktop();
     void switchToInputDesktop();
 
     SharedMemoryFactory* shared_memory_factory_ = nullptr;
@@ -72,6 +101,7 @@ private:
 
 #if defined(OS_WIN)
     ScopedThreadDesktop desktop_;
+    std::chrono::steady_clock::time_point last_desktop_check_;
 #endif // defined(OS_WIN)
 
     int screen_count_ = 0;
@@ -79,7 +109,11 @@ private:
     ScreenCapturer::ScreenId last_screen_id_ = ScreenCapturer::kInvalidScreenId;
     Point last_cursor_pos_;
     bool enable_cursor_position_ = false;
-    uint32_t capture_counter_ = 0;
+    bool is_suspended_ = true;
+    bool is_released_ = false;
+    Frame::Layout preferred_layout_ = Frame::Layout::PACKED;
+    Size preferred_size_;
+    std::unique_ptr<MouseCursor> last_mouse_cursor_;
 
     std::unique_ptr<PowerSaveBlocker> power_save_blocker_;
     std::unique_ptr<DesktopEnvironment> environment_;
@@ -28,11 +28,52 @@
 
 namespace base {
 
+namespace {
+
+// Two damage rectangles are read back as their bounding rectangle if it contains no more than this
+// number of undamaged pixels. Each read back is a round trip to the X server, so it is cheaper to
+// read a few extra pixels than to read many small rectangles separately.
+const int64_t kMaxCoalescedWaste = 64 * 64;
+
+// If there are more rectangles after coalescing, then the bounding rectangle of the damage is read.
+const size_t kMaxDamageRects = 32;
+
+int64_t rectArea(const Rect& rect)
+{
+    return static_cast<int64_t>(rect.width()) * rect.height();
+}
+
+void addCoalescedRect(const Rect& rect, std::vector<Rect>* rects)
+{
+    Rect current = rect;
+
+    for (auto it = rects->begin(); it != rects->end();)
+    {
+        Rect bounds = current;
+        bounds.unionWith(*it);
+
+        if (rectArea(bounds) - rectArea(current) - rectArea(*it) <= kMaxCoalescedWaste)
+        {
+            // The merged rectangle can now be close to the other ones.
+            current = bounds;
+            rects->erase(it);
+            it = rects->begin();
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    rects->emplace_back(current);
+}
+
+} // namespace
+
 ScreenCapturerX11::ScreenCapturerX11()
     : ScreenCapturer(ScreenCapturer::Type::LINUX_X11)
 {
     LOG(LS_INFO) << "Ctor";
-    helper_.setLogGridSize(4);
 }
 
 ScreenCapturerX11::~ScreenCapturerX11()
@@ -50,6 +91,7 @@ ScreenCapturerX11::~ScreenCapturerX11()
     deinitXlib();
 }
 
+// static
 std::unique_ptr<ScreenCapturerX11> ScreenCapturerX11::create()
 {
     std::unique_ptr<ScreenCapturerX11> instance = std::make_unique<ScreenCapturerX11>();
@@ -251,6 +293,11 @@ Point ScreenCapturerX11::cursorPosition()
     return Point(root_x, root_y).subtract(selected_monitor_rect_.topLeft());
 }
 
+int ScreenCapturerX11::frameBufferCount() const
+{
+    return FrameQueue<Frame>::kQueueLength;
+}
+
 void ScreenCapturerX11::reset()
 {
     queue_.reset();
@@ -473,7 +520,6 @@ void ScreenCapturerX11::screenConfigurationChanged()
     // Make sure the frame buffers will be reallocated.
     queue_.reset();
 
-    helper_.clearInvalidRegion();
     if (!x_server_pixel_buffer_.init(atom_cache_.get(), DefaultRootWindow(display())))
     {
         LOG(LS_ERROR) << "Failed to initialize pixel buffer after screen configuration change";
@@ -483,21 +529,22 @@ void ScreenCapturerX11::screenConfigurationChanged()
         selected_monitor_rect_ = Rect::makeSize(x_server_pixel_buffer_.windowSize());
 }
 
-void ScreenCapturerX11::synchronizeFrame()
+void ScreenCapturerX11::synchronizeFrame(const Region& damage_region)
 {
     // Synchronize the current buffer with the previous one since we do not capture the entire
     // desktop. Note that encoder may be reading from the previous buffer at this time so thread
     // access complaints are false positives.
-
-    // TODO(hclam): We can reduce the amount of copying here by subtracting |capturer_helper_|s
-    // region from |last_invalid_region_|. http://crbug.com/92354
     DCHECK(queue_.previousFrame());
 
     Frame* current = queue_.currentFrame();
     Frame* last = queue_.previousFrame();
     DCHECK(current != last);
 
-    for (Region::Iterator it(last_invalid_region_); !it.isAtEnd(); it.advance())
+    // The damaged pixels are read from the X server anyway.
+    Region copy_region = last_invalid_region_;
+    copy_region.subtract(damage_region);
+
+    for (Region::Iterator it(copy_region); !it.isAtEnd(); it.advance())
     {
         if (selected_monitor_rect_.containsRect(it.rect()))
         {
@@ -540,55 +587,74 @@ void ScreenCapturerX11::deinitXlib()
     }
 }
 
-Frame* ScreenCapturerX11::captureFrameImpl()
+std::vector<Rect> ScreenCapturerX11::fetchDamageRects()
 {
-    Frame* frame = queue_.currentFrame();
+    // Atomically fetch and clear the damage region.
+    XDamageSubtract(display(), damage_handle_, None, damage_region_);
 
-    // Pass the screen size to the helper, so it can clip the invalid region if it expands that
-    // region to a grid.
-    helper_.setSizeMostRecent(x_server_pixel_buffer_.windowSize());
+    int rects_count = 0;
+    XRectangle bounds;
+    XRectangle* rects =
+        XFixesFetchRegionAndBounds(display(), damage_region_, &rects_count, &bounds);
 
-    // In the DAMAGE case, ensure the frame is up-to-date with the previous frame if any. If there
-    // isn't a previous frame, that means a screen-resolution change occurred, and |invalid_rects|
-    // will be updated to include the whole screen.
-    if (use_damage_ && queue_.previousFrame())
-        synchronizeFrame();
+    std::vector<Rect> result;
+    Rect bounding_rect;
+
+    for (int i = 0; i < rects_count; ++i)
+    {
+        Rect rect = Rect::makeXYWH(rects[i].x, rects[i].y, rects[i].width, rects[i].height);
+        rect.intersectWith(selected_monitor_rect_);
+        if (rect.isEmpty())
+            continue;
+
+        bounding_rect.unionWith(rect);
+        addCoalescedRect(rect, &result);
+    }
+
+    if (rects)
+        XFree(rects);
+
+    if (result.size() > kMaxDamageRects)
+    {
+        result.clear();
+        result.emplace_back(bounding_rect);
+    }
+
+    return result;
+}
 
+Frame* ScreenCapturerX11::captureFrameImpl()
+{
+    Frame* frame = queue_.currentFrame();
     Region* updated_region = frame->updatedRegion();
 
     // Clear updated region.
     updated_region->clear();
 
-    x_server_pixel_buffer_.synchronize();
+    // If there isn't a previous frame, that means a screen-resolution change occurred and the whole
+    // screen is captured.
     if (use_damage_ && queue_.previousFrame())
     {
-        // Atomically fetch and clear the damage region.
-        XDamageSubtract(display(), damage_handle_, None, damage_region_);
-        int rectsNum = 0;
-        XRectangle bounds;
-        XRectangle* rects = XFixesFetchRegionAndBounds(display(), damage_region_,
-                                                       &rectsNum, &bounds);
-        for (int i = 0; i < rectsNum; ++i)
-        {
-            updated_region->addRect(
-                Rect::makeXYWH(rects[i].x, rects[i].y, rects[i].width, rects[i].height));
-        }
-        XFree(rects);
-        helper_.invalidateRegion(*updated_region);
+        // XDamage reports exactly the changed pixels, so neither the full screen is read nor the
+        // frame is compared with the previous one. Only the damaged rectangles are read back.
+        std::vector<Rect> damage_rects = fetchDamageRects();
+
+        for (const auto& rect : damage_rects)
+            updated_region->addRect(rect);
 
-        // Capture the damaged portions of the desktop.
-        helper_.takeInvalidRegion(updated_region);
-        updated_region->intersectWith(selected_monitor_rect_);
+        // Ensure the frame is up-to-date with the previous frame outside of the damage.
+        synchronizeFrame(*updated_region);
 
-        //for (const auto& rect : *updated_region)
-        for (Region::Iterator it(*updated_region); !it.isAtEnd(); it.advance())
+        for (const auto& rect : damage_rects)
         {
-            if (!x_server_pixel_buffer_.captureRect(it.rect(), frame))
+            if (!x_server_pixel_buffer_.captureDamagedRect(rect, frame))
                 return nullptr;
         }
     }
     else
     {
+        x_server_pixel_buffer_.synchronize();
+
         // Doing full-screen polling, or this is the first capture after a screen-resolution change.
         //In either case, need a full-screen capture.
         if (!x_server_pixel_buffer_.captureRect(selected_monitor_rect_, frame))
@@ -20,7 +20,6 @@
 #define BASE_DESKTOP_SCREEN_CAPTURER_X11_H
 
 #include "base/desktop/screen_capturer.h"
-#include "base/desktop/screen_capturer_helper.h"
 #include "base/desktop/frame.h"
 #include "base/desktop/x11/x_atom_cache.h"
 #include "base/desktop/x11/x_server_pixel_buffer.h"
@@ -32,6 +31,8 @@
 #include <X11/extensions/Xfixes.h>
 #include <X11/extensions/Xrandr.h>
 
+#include <vector>
+
 #if defined(Status)
 #undef Status
 #endif
@@ -46,7 +47,7 @@ public:
     ScreenCapturerX11();
     ~ScreenCapturerX11() override;
 
-    std::unique_ptr<ScreenCapturerX11> create();
+    static std::unique_ptr<ScreenCapturerX11> create();
 
     // ScreenCapturer implementation.
     int screenCount() override;
@@ -56,6 +57,7 @@ public:
     const Frame* captureFrame(Error* error) override;
     const MouseCursor* captureCursor() override;
     Point cursorPosition() override;
+    int frameBufferCount() const override;
 
 protected:
     // ScreenCapturer implementation.
@@ -77,14 +79,18 @@ private:
     void screenConfigurationChanged();
 
     // Synchronize the current buffer with |last_buffer_|, by copying pixels from the area of
-    // |last_invalid_rects|.
+    // |last_invalid_rects| which is not covered by |damage_region|.
     // Note this only works on the assumption that kNumBuffers == 2, as |last_invalid_rects| holds
     // the differences from the previous buffer and the one prior to that (which will then be the
     // current buffer).
-    void synchronizeFrame();
+    void synchronizeFrame(const Region& damage_region);
 
     void deinitXlib();
 
+    // Fetches and clears the XDamage region. Returns the damaged rectangles within the selected
+    // monitor with the small neighbouring ones coalesced.
+    std::vector<Rect> fetchDamageRects();
+
     Frame* captureFrameImpl();
 
     base::local_shared_ptr<SharedXDisplay> display_;
@@ -126,10 +132,6 @@ private:
     // Access to the X Server's pixel buffer.
     XServerPixelBuffer x_server_pixel_buffer_;
 
-    // A thread-safe list of invalid rectangles, and the size of the most
-    // recently captured screen.
-    ScreenCapturerHelper helper_;
-
     // Queue of the frames buffers.
     FrameQueue<Frame> queue_;
 
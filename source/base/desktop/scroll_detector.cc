@@ -0,0 +1,191 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/desktop/scroll_detector.h"
+
+#include "base/logging.h"
+#include "base/desktop/frame.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace base {
+
+namespace {
+
+// The moved part must have at least this number of rows, otherwise it is cheaper to send it again.
+const int kMinMovedRows = 32;
+
+// Moving rows that are identical in both frames anyway does not save anything. Rows of a solid
+// color match every offset, so at least this number of moved rows must actually change.
+const int kMinChangedRows = 16;
+
+const uint64_t kHashMultiplier = 0x9e3779b97f4a7c15ULL;
+
+uint64_t hashRow(const uint8_t* data, size_t size)
+{
+    uint64_t hash = size;
+
+    while (size >= sizeof(uint32_t))
+    {
+        uint32_t value;
+        memcpy(&value, data, sizeof(value));
+
+        hash = (hash ^ value) * kHashMultiplier;
+        hash ^= hash >> 29;
+
+        data += sizeof(value);
+        size -= sizeof(value);
+    }
+
+    while (size)
+    {
+        hash = (hash ^ *data) * kHashMultiplier;
+        ++data;
+        --size;
+    }
+
+    return hash;
+}
+
+} // namespace
+
+ScrollDetector::ScrollDetector() = default;
+ScrollDetector::~ScrollDetector() = default;
+
+bool ScrollDetector::detect(const Frame& previous, const Frame& current, const Rect& area,
+                            Rect* source_rect, Point* dest_pos)
+{
+    DCHECK(source_rect);
+    DCHECK(dest_pos);
+    DCHECK(previous.size() == current.size());
+    DCHECK(previous.format().bytesPerPixel() == current.format().bytesPerPixel());
+    DCHECK(Rect::makeSize(current.size()).containsRect(area));
+
+    if (area.height() < kMinMovedRows + 1 || area.isEmpty())
+        return false;
+
+    hashRows(previous, area, &previous_hashes_);
+    hashRows(current, area, &current_hashes_);
+
+    const int offset = findOffset();
+    if (!offset)
+        return false;
+
+    // The longest run of rows which are moved by the offset.
+    const int height = area.height();
+    int best_start = 0;
+    int best_length = 0;
+    int best_changed = 0;
+    int start = 0;
+    int length = 0;
+    int changed = 0;
+
+    for (int i = std::max(offset, 0); i < std::min(height, height + offset); ++i)
+    {
+        if (current_hashes_[i] == previous_hashes_[i - offset])
+        {
+            if (!length)
+            {
+                start = i;
+                changed = 0;
+            }
+
+            ++length;
+            if (current_hashes_[i] != previous_hashes_[i])
+                ++changed;
+
+            if (length > best_length)
+            {
+                best_start = start;
+                best_length = length;
+                best_changed = changed;
+            }
+        }
+        else
+        {
+            length = 0;
+        }
+    }
+
+    if (best_length < kMinMovedRows || best_changed < kMinChangedRows)
+        return false;
+
+    *source_rect = Rect::makeXYWH(area.x(), area.y() + best_start - offset,
+                                  area.width(), best_length);
+    *dest_pos = Point(area.x(), area.y() + best_start);
+    return true;
+}
+
+// static
+void ScrollDetector::hashRows(const Frame& frame, const Rect& area, std::vector<uint64_t>* hashes)
+{
+    const size_t row_size = static_cast<size_t>(area.width() * frame.format().bytesPerPixel());
+    const uint8_t* row = frame.frameDataAtPos(area.topLeft());
+
+    hashes->resize(static_cast<size_t>(area.height()));
+
+    for (int y = 0; y < area.height(); ++y)
+    {
+        (*hashes)[static_cast<size_t>(y)] = hashRow(row, row_size);
+        row += frame.stride();
+    }
+}
+
+int ScrollDetector::findOffset()
+{
+    const int height = static_cast<int>(previous_hashes_.size());
+
+    // Only unique rows can tell the offset. Repeated rows (for example, an empty background) would
+    // vote for many offsets.
+    previous_rows_.clear();
+
+    for (int i = 0; i < height; ++i)
+    {
+        auto result = previous_rows_.emplace(previous_hashes_[i], i);
+        if (!result.second)
+            result.first->second = -1;
+    }
+
+    std::unordered_map<int, int> votes;
+    int best_offset = 0;
+    int best_votes = 0;
+
+    for (int i = 0; i < height; ++i)
+    {
+        const uint64_t hash = current_hashes_[i];
+        if (hash == previous_hashes_[i])
+            continue;
+
+        auto row = previous_rows_.find(hash);
+        if (row == previous_rows_.end() || row->second < 0)
+            continue;
+
+        const int offset = i - row->second;
+        const int count = ++votes[offset];
+
+        if (count > best_votes)
+        {
+            best_offset = offset;
+            best_votes = count;
+        }
+    }
+
+    return best_votes >= kMinChangedRows ? best_offset : 0;
+}
+
+} // namespace base
@@ -0,0 +1,62 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef BASE_DESKTOP_SCROLL_DETECTOR_H
+#define BASE_DESKTOP_SCROLL_DETECTOR_H
+
+#include "base/macros_magic.h"
+#include "base/desktop/geometry.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace base {
+
+class Frame;
+
+// Finds content that was moved vertically between two frames, like a scrolled document. The rows
+// of both frames are compared by their hashes, so the search does not depend on the content
+// itself.
+class ScrollDetector
+{
+public:
+    ScrollDetector();
+    ~ScrollDetector();
+
+    // Searches |area| of |current| for rows that were in the same columns of |previous| at another
+    // vertical position. The frames must have the same size and format. Returns true and fills
+    // |source_rect| (in |previous|) and |dest_pos| (in |current|) if enough consecutive rows are
+    // moved by the same offset.
+    bool detect(const Frame& previous, const Frame& current, const Rect& area,
+                Rect* source_rect, Point* dest_pos);
+
+private:
+    static void hashRows(const Frame& frame, const Rect& area, std::vector<uint64_t>* hashes);
+    int findOffset();
+
+    std::vector<uint64_t> previous_hashes_;
+    std::vector<uint64_t> current_hashes_;
+
+    // A unique row hash of the previous frame to the row index, or -1 if the hash is repeated.
+    std::unordered_map<uint64_t, int> previous_rows_;
+
+    DISALLOW_COPY_AND_ASSIGN(ScrollDetector);
+};
+
+} // namespace base
+
+#endif // BASE_DESKTOP_SCROLL_DETECTOR_H
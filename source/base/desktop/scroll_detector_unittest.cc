@@ -0,0 +1,104 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/desktop/scroll_detector.h"
+
+#include "base/desktop/frame_simple.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+const Size kFrameSize(64, 200);
+
+// Each row has its own content, like the lines of a text document.
+void fillRows(Frame* frame, int first_line)
+{
+    for (int y = 0; y < frame->size().height(); ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(0, y));
+        for (int x = 0; x < frame->size().width(); ++x)
+            row[x] = static_cast<uint32_t>((y + first_line) * 7919 + x);
+    }
+}
+
+} // namespace
+
+TEST(ScrollDetectorTest, DetectsScrollDown)
+{
+    auto previous = FrameSimple::create(kFrameSize, PixelFormat::ARGB());
+    auto current = FrameSimple::create(kFrameSize, PixelFormat::ARGB());
+
+    // The document is scrolled by 30 lines, so the content moves up.
+    fillRows(previous.get(), 0);
+    fillRows(current.get(), 30);
+
+    ScrollDetector detector;
+    Rect source_rect;
+    Point dest_pos;
+
+    ASSERT_TRUE(detector.detect(*previous, *current, Rect::makeSize(kFrameSize),
+                                &source_rect, &dest_pos));
+    EXPECT_EQ(source_rect, Rect::makeXYWH(0, 30, 64, 170));
+    EXPECT_EQ(dest_pos, Point(0, 0));
+}
+
+TEST(ScrollDetectorTest, DetectsScrollUpInArea)
+{
+    auto previous = FrameSimple::create(kFrameSize, PixelFormat::ARGB());
+    auto current = FrameSimple::create(kFrameSize, PixelFormat::ARGB());
+
+    fillRows(previous.get(), 40);
+    fillRows(current.get(), 0);
+
+    const Rect area = Rect::makeXYWH(8, 20, 40, 160);
+
+    ScrollDetector detector;
+    Rect source_rect;
+    Point dest_pos;
+
+    ASSERT_TRUE(detector.detect(*previous, *current, area, &source_rect, &dest_pos));
+    EXPECT_EQ(source_rect, Rect::makeXYWH(8, 20, 40, 120));
+    EXPECT_EQ(dest_pos, Point(8, 60));
+}
+
+TEST(ScrollDetectorTest, IgnoresUnrelatedContent)
+{
+    auto previous = FrameSimple::create(kFrameSize, PixelFormat::ARGB());
+    auto current = FrameSimple::create(kFrameSize, PixelFormat::ARGB());
+
+    fillRows(previous.get(), 0);
+    fillRows(current.get(), 1000);
+
+    ScrollDetector detector;
+    Rect source_rect;
+    Point dest_pos;
+
+    EXPECT_FALSE(detector.detect(*previous, *current, Rect::makeSize(kFrameSize),
+                                 &source_rect, &dest_pos));
+
+    // Solid frames match at any offset, but nothing would be saved.
+    memset(previous->frameData(), 0x40, previous->stride() * kFrameSize.height());
+    memset(current->frameData(), 0x40, current->stride() * kFrameSize.height());
+
+    EXPECT_FALSE(detector.detect(*previous, *current, Rect::makeSize(kFrameSize),
+                                 &source_rect, &dest_pos));
+}
+
+} // namespace base
@@ -0,0 +1,428 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/win/d3d_i420_converter.h"
+
+#include "base/logging.h"
+
+#include <comdef.h>
+#include <d3dcompiler.h>
+
+#include <cstring>
+
+using Microsoft::WRL::ComPtr;
+
+namespace base {
+
+namespace {
+
+// Each thread converts a block of 2x2 pixels.
+const int kThreadGroupSize = 8;
+const int kPixelsPerGroup = kThreadGroupSize * 2;
+
+const char kShaderSource[] = R"(
+Texture2D<float4> source : register(t0);
+RWTexture2D<uint> planes : register(u0);
+
+cbuffer Constants : register(b0)
+{
+    uint2 origin;
+    uint2 extent;
+    uint2 frame_size;
+    uint uv_width;
+    uint padding;
+};
+
+uint toY(float3 c)
+{
+    return (uint)(0.257 * c.r + 0.504 * c.g + 0.098 * c.b + 16.5);
+}
+
+uint toU(float3 c)
+{
+    return (uint)(-0.148 * c.r - 0.291 * c.g + 0.439 * c.b + 128.5);
+}
+
+uint toV(float3 c)
+{
+    return (uint)(0.439 * c.r - 0.368 * c.g - 0.071 * c.b + 128.5);
+}
+
+[numthreads(8, 8, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+    uint2 block = id.xy * 2;
+    if (block.x >= extent.x || block.y >= extent.y)
+        return;
+
+    uint2 pos = origin + block;
+    uint2 last = frame_size - 1;
+
+    float3 p00 = source.Load(int3(pos, 0)).rgb * 255.0;
+    float3 p10 = source.Load(int3(min(pos + uint2(1, 0), last), 0)).rgb * 255.0;
+    float3 p01 = source.Load(int3(min(pos + uint2(0, 1), last), 0)).rgb * 255.0;
+    float3 p11 = source.Load(int3(min(pos + uint2(1, 1), last), 0)).rgb * 255.0;
+
+    planes[pos] = toY(p00);
+    if (pos.x + 1 < frame_size.x)
+        planes[pos + uint2(1, 0)] = toY(p10);
+    if (pos.y + 1 < frame_size.y)
+        planes[pos + uint2(0, 1)] = toY(p01);
+    if (pos.x + 1 < frame_size.x && pos.y + 1 < frame_size.y)
+        planes[pos + uint2(1, 1)] = toY(p11);
+
+    float3 average = (p00 + p10 + p01 + p11) * 0.25;
+    uint2 uv = uint2(pos.x / 2, frame_size.y + pos.y / 2);
+
+    planes[uv] = toU(average);
+    planes[uv + uint2(uv_width, 0)] = toV(average);
+}
+)";
+
+struct Constants
+{
+    uint32_t origin[2];
+    uint32_t extent[2];
+    uint32_t frame_size[2];
+    uint32_t uv_width;
+    uint32_t padding;
+};
+
+static_assert(sizeof(Constants) % 16 == 0, "Constant buffer size must be a multiple of 16");
+
+typedef HRESULT(WINAPI* D3DCompileFunc)(LPCVOID, SIZE_T, LPCSTR, const D3D_SHADER_MACRO*,
+                                        ID3DInclude*, LPCSTR, LPCSTR, UINT, UINT,
+                                        ID3DBlob**, ID3DBlob**);
+
+void copyPlane(const uint8_t* src, int src_stride, uint8_t* dst, int dst_stride,
+               int width, int height)
+{
+    for (int y = 0; y < height; ++y)
+    {
+        memcpy(dst, src, static_cast<size_t>(width));
+        src += src_stride;
+        dst += dst_stride;
+    }
+}
+
+} // namespace
+
+D3dI420Converter::D3dI420Converter(const D3dDevice& device)
+    : device_(device)
+{
+    // Nothing
+}
+
+D3dI420Converter::~D3dI420Converter() = default;
+
+bool D3dI420Converter::convert(ID3D11Texture2D* texture, const Region& region,
+                               const Point& offset, Frame* target)
+{
+    DCHECK(texture);
+    DCHECK(target);
+    DCHECK(target->layout() == Frame::Layout::I420);
+
+    if (shader_failed_)
+        return false;
+
+    D3D11_TEXTURE2D_DESC desc = { 0 };
+    texture->GetDesc(&desc);
+
+    if (!initialize(desc))
+        return false;
+
+    ID3D11DeviceContext* context = device_.context();
+
+    const uint32_t uv_width = static_cast<uint32_t>((size_.width() + 1) / 2);
+
+    context->CSSetShader(shader_.Get(), nullptr, 0);
+    context->CSSetConstantBuffers(0, 1, constants_.GetAddressOf());
+    context->CSSetShaderResources(0, 1, source_view_.GetAddressOf());
+    context->CSSetUnorderedAccessViews(0, 1, planes_view_.GetAddressOf(), nullptr);
+
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+
+        DCHECK_EQ(rect.x() & 1, 0);
+        DCHECK_EQ(rect.y() & 1, 0);
+
+        D3D11_BOX box;
+        box.left = static_cast<UINT>(rect.left());
+        box.top = static_cast<UINT>(rect.top());
+        box.right = static_cast<UINT>(rect.right());
+        box.bottom = static_cast<UINT>(rect.bottom());
+        box.front = 0;
+        box.back = 1;
+
+        context->CopySubresourceRegion(source_.Get(), 0, box.left, box.top, 0,
+                                       texture, 0, &box);
+
+        Constants constants;
+        constants.origin[0] = static_cast<uint32_t>(rect.x());
+        constants.origin[1] = static_cast<uint32_t>(rect.y());
+        constants.extent[0] = static_cast<uint32_t>(rect.width());
+        constants.extent[1] = static_cast<uint32_t>(rect.height());
+        constants.frame_size[0] = static_cast<uint32_t>(size_.width());
+        constants.frame_size[1] = static_cast<uint32_t>(size_.height());
+        constants.uv_width = uv_width;
+        constants.padding = 0;
+
+        context->UpdateSubresource(constants_.Get(), 0, nullptr, &constants, 0, 0);
+        context->Dispatch(static_cast<UINT>((rect.width() + kPixelsPerGroup - 1) / kPixelsPerGroup),
+                          static_cast<UINT>((rect.height() + kPixelsPerGroup - 1) / kPixelsPerGroup),
+                          1);
+
+        // Y plane.
+        context->CopySubresourceRegion(stage_.Get(), 0, box.left, box.top, 0,
+                                       planes_.Get(), 0, &box);
+
+        // U and V planes.
+        D3D11_BOX uv_box;
+        uv_box.left = box.left / 2;
+        uv_box.right = (box.right + 1) / 2;
+        uv_box.top = static_cast<UINT>(size_.height()) + box.top / 2;
+        uv_box.bottom = static_cast<UINT>(size_.height()) + (box.bottom + 1) / 2;
+        uv_box.front = 0;
+        uv_box.back = 1;
+
+        context->CopySubresourceRegion(stage_.Get(), 0, uv_box.left, uv_box.top, 0,
+                                       planes_.Get(), 0, &uv_box);
+
+        uv_box.left += uv_width;
+        uv_box.right += uv_width;
+
+        context->CopySubresourceRegion(stage_.Get(), 0, uv_box.left, uv_box.top, 0,
+                                       planes_.Get(), 0, &uv_box);
+    }
+
+    ID3D11UnorderedAccessView* null_view = nullptr;
+    ID3D11ShaderResourceView* null_resource = nullptr;
+    context->CSSetUnorderedAccessViews(0, 1, &null_view, nullptr);
+    context->CSSetShaderResources(0, 1, &null_resource);
+    context->CSSetShader(nullptr, nullptr, 0);
+
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    memset(&mapped, 0, sizeof(mapped));
+
+    _com_error error = context->Map(stage_.Get(), 0, D3D11_MAP_READ, 0, &mapped);
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "Failed to map the I420 stage texture, error "
+                      << error.ErrorMessage() << ", code " << error.Error();
+        return false;
+    }
+
+    const uint8_t* bits = static_cast<const uint8_t*>(mapped.pData);
+    const int pitch = static_cast<int>(mapped.RowPitch);
+    const uint8_t* u_bits = bits + pitch * size_.height();
+    const uint8_t* v_bits = u_bits + uv_width;
+
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+        const Rect dest_rect = rect.translated(offset.x(), offset.y());
+
+        const int uv_x = rect.x() / 2;
+        const int uv_y = rect.y() / 2;
+        const int uv_rect_width = (rect.right() + 1) / 2 - uv_x;
+        const int uv_rect_height = (rect.bottom() + 1) / 2 - uv_y;
+        const int dest_uv_offset =
+            target->uvStride() * (dest_rect.y() / 2) + (dest_rect.x() / 2);
+
+        copyPlane(bits + pitch * rect.y() + rect.x(), pitch,
+                  target->yPlane() + target->yStride() * dest_rect.y() + dest_rect.x(),
+                  target->yStride(), rect.width(), rect.height());
+        copyPlane(u_bits + pitch * uv_y + uv_x, pitch,
+                  target->uPlane() + dest_uv_offset, target->uvStride(),
+                  uv_rect_width, uv_rect_height);
+        copyPlane(v_bits + pitch * uv_y + uv_x, pitch,
+                  target->vPlane() + dest_uv_offset, target->uvStride(),
+                  uv_rect_width, uv_rect_height);
+    }
+
+    context->Unmap(stage_.Get(), 0);
+    return true;
+}
+
+bool D3dI420Converter::initialize(const D3D11_TEXTURE2D_DESC& desc)
+{
+    if (!shader_ && !createShader())
+    {
+        shader_failed_ = true;
+        return false;
+    }
+
+    const Size size(static_cast<int32_t>(desc.Width), static_cast<int32_t>(desc.Height));
+    if (source_ && size_ == size)
+        return true;
+
+    source_.Reset();
+    source_view_.Reset();
+    planes_.Reset();
+    planes_view_.Reset();
+    stage_.Reset();
+
+    ID3D11Device* device = device_.d3dDevice();
+
+    D3D11_TEXTURE2D_DESC source_desc = desc;
+    source_desc.ArraySize = 1;
+    source_desc.MipLevels = 1;
+    source_desc.MiscFlags = 0;
+    source_desc.SampleDesc.Count = 1;
+    source_desc.SampleDesc.Quality = 0;
+    source_desc.Usage = D3D11_USAGE_DEFAULT;
+    source_desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    source_desc.CPUAccessFlags = 0;
+
+    _com_error error = device->CreateTexture2D(&source_desc, nullptr, source_.GetAddressOf());
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "Failed to create the source texture, error "
+                      << error.ErrorMessage() << ", code " << error.Error();
+        return false;
+    }
+
+    error = device->CreateShaderResourceView(source_.Get(), nullptr, source_view_.GetAddressOf());
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "Failed to create the shader resource view, error "
+                      << error.ErrorMessage() << ", code " << error.Error();
+        return false;
+    }
+
+    const UINT uv_width = (desc.Width + 1) / 2;
+    const UINT uv_height = (desc.Height + 1) / 2;
+
+    D3D11_TEXTURE2D_DESC planes_desc;
+    memset(&planes_desc, 0, sizeof(planes_desc));
+    planes_desc.Width = uv_width * 2;
+    planes_desc.Height = desc.Height + uv_height;
+    planes_desc.MipLevels = 1;
+    planes_desc.ArraySize = 1;
+    planes_desc.Format = DXGI_FORMAT_R8_UINT;
+    planes_desc.SampleDesc.Count = 1;
+    planes_desc.Usage = D3D11_USAGE_DEFAULT;
+    planes_desc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+
+    error = device->CreateTexture2D(&planes_desc, nullptr, planes_.GetAddressOf());
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "Failed to create the planes texture, error "
+                      << error.ErrorMessage() << ", code " << error.Error();
+        return false;
+    }
+
+    error = device->CreateUnorderedAccessView(planes_.Get(), nullptr, planes_view_.GetAddressOf());
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "Failed to create the unordered access view, error "
+                      << error.ErrorMessage() << ", code " << error.Error();
+        return false;
+    }
+
+    D3D11_TEXTURE2D_DESC stage_desc = planes_desc;
+    stage_desc.Usage = D3D11_USAGE_STAGING;
+    stage_desc.BindFlags = 0;
+    stage_desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+    error = device->CreateTexture2D(&stage_desc, nullptr, stage_.GetAddressOf());
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "Failed to create the stage texture, error "
+                      << error.ErrorMessage() << ", code " << error.Error();
+        return false;
+    }
+
+    size_ = size;
+
+    LOG(LS_INFO) << "I420 converter initialized for " << size_;
+    return true;
+}
+
+bool D3dI420Converter::createShader()
+{
+    if (device_.d3dDevice()->GetFeatureLevel() < D3D_FEATURE_LEVEL_11_0)
+    {
+        LOG(LS_WARNING) << "Compute shaders are not supported by the device";
+        return false;
+    }
+
+    // d3dcompiler_47.dll is a part of the OS since Windows 8.1. We load it dynamically to keep the
+    // capturer working on systems without it.
+    HMODULE module = LoadLibraryExW(L"d3dcompiler_47.dll", nullptr, LOAD_LIBRARY_SEARCH_SYSTEM32);
+    if (!module)
+    {
+        PLOG(LS_WARNING) << "LoadLibraryExW failed";
+        return false;
+    }
+
+    D3DCompileFunc d3dCompileFunc =
+        reinterpret_cast<D3DCompileFunc>(GetProcAddress(module, "D3DCompile"));
+    if (!d3dCompileFunc)
+    {
+        PLOG(LS_WARNING) << "GetProcAddress failed";
+        FreeLibrary(module);
+        return false;
+    }
+
+    ComPtr<ID3DBlob> code;
+    ComPtr<ID3DBlob> errors;
+
+    _com_error error = d3dCompileFunc(kShaderSource, sizeof(kShaderSource) - 1, nullptr, nullptr,
+                                      nullptr, "main", "cs_5_0", D3DCOMPILE_OPTIMIZATION_LEVEL3, 0,
+                                      code.GetAddressOf(), errors.GetAddressOf());
+    FreeLibrary(module);
+
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "Failed to compile the I420 shader, error "
+                      << error.ErrorMessage() << ", code " << error.Error();
+        if (errors)
+            LOG(LS_ERROR) << static_cast<const char*>(errors->GetBufferPointer());
+        return false;
+    }
+
+    error = device_.d3dDevice()->CreateComputeShader(
+        code->GetBufferPointer(), code->GetBufferSize(), nullptr, shader_.GetAddressOf());
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "Failed to create the compute shader, error "
+                      << error.ErrorMessage() << ", code " << error.Error();
+        return false;
+    }
+
+    D3D11_BUFFER_DESC buffer_desc;
+    memset(&buffer_desc, 0, sizeof(buffer_desc));
+    buffer_desc.ByteWidth = sizeof(Constants);
+    buffer_desc.Usage = D3D11_USAGE_DEFAULT;
+    buffer_desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+
+    error = device_.d3dDevice()->CreateBuffer(&buffer_desc, nullptr, constants_.GetAddressOf());
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "Failed to create the constant buffer, error "
+                      << error.ErrorMessage() << ", code " << error.Error();
+        shader_.Reset();
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace base
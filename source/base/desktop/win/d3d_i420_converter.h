@@ -0,0 +1,77 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_DESKTOP_WIN_D3D_I420_CONVERTER_H
+#define BASE_DESKTOP_WIN_D3D_I420_CONVERTER_H
+
+#include "base/macros_magic.h"
+#include "base/desktop/frame.h"
+#include "base/desktop/win/d3d_device.h"
+
+#include <d3d11.h>
+#include <wrl/client.h>
+
+namespace base {
+
+// Converts a B8G8R8A8 desktop texture to the I420 layout with a compute shader, so that only the
+// planar data of the changed rectangles is read back from the video memory. The conversion
+// matches libyuv::ARGBToI420 (BT.601, limited range).
+//
+// A D3dI420Converter is bound to the ID3D11Device it was created with and cannot be shared
+// between two DxgiAdapterDuplicators.
+class D3dI420Converter
+{
+public:
+    // Caller must maintain the lifetime of input device to make sure it outlives this instance.
+    explicit D3dI420Converter(const D3dDevice& device);
+    ~D3dI420Converter();
+
+    // Converts the |region| of |texture| and writes the planes into |target| at |offset|. All
+    // rectangles of |region| and |offset| must be aligned to even coordinates. Returns false if
+    // anything wrong, in this case the caller should fall back to the CPU conversion.
+    bool convert(ID3D11Texture2D* texture, const Region& region, const Point& offset,
+                 Frame* target);
+
+private:
+    bool initialize(const D3D11_TEXTURE2D_DESC& desc);
+    bool createShader();
+
+    const D3dDevice device_;
+    bool shader_failed_ = false;
+    Size size_;
+
+    Microsoft::WRL::ComPtr<ID3D11ComputeShader> shader_;
+    Microsoft::WRL::ComPtr<ID3D11Buffer> constants_;
+
+    // Copy of the desktop texture which can be bound as a shader resource. Textures returned by
+    // AcquireNextFrame() do not always have D3D11_BIND_SHADER_RESOURCE flag.
+    Microsoft::WRL::ComPtr<ID3D11Texture2D> source_;
+    Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> source_view_;
+
+    // Single channel texture that holds the Y plane in the top |size_.height()| rows and the U
+    // and V planes side by side below it.
+    Microsoft::WRL::ComPtr<ID3D11Texture2D> planes_;
+    Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> planes_view_;
+    Microsoft::WRL::ComPtr<ID3D11Texture2D> stage_;
+
+    DISALLOW_COPY_AND_ASSIGN(D3dI420Converter);
+};
+
+} // namespace base
+
+#endif // BASE_DESKTOP_WIN_D3D_I420_CONVERTER_H
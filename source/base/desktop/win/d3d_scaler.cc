@@ -0,0 +1,379 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/desktop/win/d3d_scaler.h"
+
+#include "base/logging.h"
+
+#include <comdef.h>
+#include <d3dcompiler.h>
+
+#include <cstring>
+
+using Microsoft::WRL::ComPtr;
+
+namespace base {
+
+namespace {
+
+const int kThreadGroupSize = 8;
+
+const char kShaderSource[] = R"(
+Texture2D<float4> source : register(t0);
+RWTexture2D<unorm float4> scaled : register(u0);
+
+cbuffer Constants : register(b0)
+{
+    uint2 origin;
+    uint2 extent;
+    uint2 source_size;
+    uint2 target_size;
+};
+
+[numthreads(8, 8, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+    if (id.x >= extent.x || id.y >= extent.y)
+        return;
+
+    uint2 pos = origin + id.xy;
+
+    // The box of source pixels covered by the target pixel.
+    uint2 first = pos * source_size / target_size;
+    uint2 last = max(((pos + 1) * source_size + target_size - 1) / target_size, first + 1);
+
+    float4 sum = float4(0.0, 0.0, 0.0, 0.0);
+
+    [loop]
+    for (uint y = first.y; y < last.y; ++y)
+    {
+        [loop]
+        for (uint x = first.x; x < last.x; ++x)
+            sum += source.Load(int3(x, y, 0));
+    }
+
+    float4 color = sum / (float)((last.x - first.x) * (last.y - first.y));
+
+    // The scaled texture is R8G8B8A8, but the frame stores the bytes in BGRA order.
+    scaled[pos] = color.bgra;
+}
+)";
+
+struct Constants
+{
+    uint32_t origin[2];
+    uint32_t extent[2];
+    uint32_t source_size[2];
+    uint32_t target_size[2];
+};
+
+static_assert(sizeof(Constants) % 16 == 0, "Constant buffer size must be a multiple of 16");
+
+typedef HRESULT(WINAPI* D3DCompileFunc)(LPCVOID, SIZE_T, LPCSTR, const D3D_SHADER_MACRO*,
+                                        ID3DInclude*, LPCSTR, LPCSTR, UINT, UINT,
+                                        ID3DBlob**, ID3DBlob**);
+
+D3D11_BOX boxFromRect(const Rect& rect)
+{
+    D3D11_BOX box;
+    box.left = static_cast<UINT>(rect.left());
+    box.top = static_cast<UINT>(rect.top());
+    box.right = static_cast<UINT>(rect.right());
+    box.bottom = static_cast<UINT>(rect.bottom());
+    box.front = 0;
+    box.back = 1;
+    return box;
+}
+
+} // namespace
+
+D3dScaler::D3dScaler(const D3dDevice& device)
+    : device_(device)
+{
+    // Nothing
+}
+
+D3dScaler::~D3dScaler() = default;
+
+bool D3dScaler::scale(ID3D11Texture2D* texture, const Region& region,
+                      const Region& target_region, Frame* target)
+{
+    DCHECK(texture);
+    DCHECK(target);
+    DCHECK(target->layout() == Frame::Layout::PACKED);
+
+    if (shader_failed_)
+        return false;
+
+    D3D11_TEXTURE2D_DESC desc = { 0 };
+    texture->GetDesc(&desc);
+
+    const Size source_size(static_cast<int32_t>(desc.Width), static_cast<int32_t>(desc.Height));
+    const bool copy_all =
+        !source_ || source_size_ != source_size || target_size_ != target->size();
+
+    if (!initialize(desc, target->size()))
+        return false;
+
+    ID3D11DeviceContext* context = device_.context();
+
+    if (copy_all)
+    {
+        // A new copy of the desktop has no content outside of the changed rectangles yet.
+        context->CopySubresourceRegion(source_.Get(), 0, 0, 0, 0, texture, 0, nullptr);
+    }
+    else
+    {
+        for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+        {
+            const D3D11_BOX box = boxFromRect(it.rect());
+            context->CopySubresourceRegion(source_.Get(), 0, box.left, box.top, 0,
+                                           texture, 0, &box);
+        }
+    }
+
+    context->CSSetShader(shader_.Get(), nullptr, 0);
+    context->CSSetConstantBuffers(0, 1, constants_.GetAddressOf());
+    context->CSSetShaderResources(0, 1, source_view_.GetAddressOf());
+    context->CSSetUnorderedAccessViews(0, 1, scaled_view_.GetAddressOf(), nullptr);
+
+    for (Region::Iterator it(target_region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+
+        Constants constants;
+        constants.origin[0] = static_cast<uint32_t>(rect.x());
+        constants.origin[1] = static_cast<uint32_t>(rect.y());
+        constants.extent[0] = static_cast<uint32_t>(rect.width());
+        constants.extent[1] = static_cast<uint32_t>(rect.height());
+        constants.source_size[0] = static_cast<uint32_t>(source_size_.width());
+        constants.source_size[1] = static_cast<uint32_t>(source_size_.height());
+        constants.target_size[0] = static_cast<uint32_t>(target_size_.width());
+        constants.target_size[1] = static_cast<uint32_t>(target_size_.height());
+
+        context->UpdateSubresource(constants_.Get(), 0, nullptr, &constants, 0, 0);
+        context->Dispatch(
+            static_cast<UINT>((rect.width() + kThreadGroupSize - 1) / kThreadGroupSize),
+            static_cast<UINT>((rect.height() + kThreadGroupSize - 1) / kThreadGroupSize),
+            1);
+
+        const D3D11_BOX box = boxFromRect(rect);
+        context->CopySubresourceRegion(stage_.Get(), 0, box.left, box.top, 0,
+                                       scaled_.Get(), 0, &box);
+    }
+
+    ID3D11UnorderedAccessView* null_view = nullptr;
+    ID3D11ShaderResourceView* null_resource = nullptr;
+    context->CSSetUnorderedAccessViews(0, 1, &null_view, nullptr);
+    context->CSSetShaderResources(0, 1, &null_resource);
+    context->CSSetShader(nullptr, nullptr, 0);
+
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    memset(&mapped, 0, sizeof(mapped));
+
+    _com_error error = context->Map(stage_.Get(), 0, D3D11_MAP_READ, 0, &mapped);
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "Failed to map the scaled stage texture, error "
+                      << error.ErrorMessage() << ", code " << error.Error();
+        return false;
+    }
+
+    const uint8_t* bits = static_cast<const uint8_t*>(mapped.pData);
+    const int pitch = static_cast<int>(mapped.RowPitch);
+    const int bytes_per_pixel = target->format().bytesPerPixel();
+
+    for (Region::Iterator it(target_region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+        target->copyPixelsFrom(bits + pitch * rect.y() + bytes_per_pixel * rect.x(), pitch, rect);
+    }
+
+    context->Unmap(stage_.Get(), 0);
+    return true;
+}
+
+bool D3dScaler::initialize(const D3D11_TEXTURE2D_DESC& desc, const Size& target_size)
+{
+    if (!shader_ && !createShader())
+    {
+        shader_failed_ = true;
+        return false;
+    }
+
+    const Size source_size(static_cast<int32_t>(desc.Width), static_cast<int32_t>(desc.Height));
+    if (source_ && source_size_ == source_size && target_size_ == target_size)
+        return true;
+
+    source_.Reset();
+    source_view_.Reset();
+    scaled_.Reset();
+    scaled_view_.Reset();
+    stage_.Reset();
+    source_size_ = Size();
+    target_size_ = Size();
+
+    ID3D11Device* device = device_.d3dDevice();
+
+    D3D11_TEXTURE2D_DESC source_desc = desc;
+    source_desc.ArraySize = 1;
+    source_desc.MipLevels = 1;
+    source_desc.MiscFlags = 0;
+    source_desc.SampleDesc.Count = 1;
+    source_desc.SampleDesc.Quality = 0;
+    source_desc.Usage = D3D11_USAGE_DEFAULT;
+    source_desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    source_desc.CPUAccessFlags = 0;
+
+    _com_error error = device->CreateTexture2D(&source_desc, nullptr, source_.GetAddressOf());
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "Failed to create the source texture, error "
+                      << error.ErrorMessage() << ", code " << error.Error();
+        return false;
+    }
+
+    error = device->CreateShaderResourceView(source_.Get(), nullptr, source_view_.GetAddressOf());
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "Failed to create the shader resource view, error "
+                      << error.ErrorMessage() << ", code " << error.Error();
+        source_.Reset();
+        return false;
+    }
+
+    D3D11_TEXTURE2D_DESC scaled_desc;
+    memset(&scaled_desc, 0, sizeof(scaled_desc));
+    scaled_desc.Width = static_cast<UINT>(target_size.width());
+    scaled_desc.Height = static_cast<UINT>(target_size.height());
+    scaled_desc.MipLevels = 1;
+    scaled_desc.ArraySize = 1;
+    scaled_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    scaled_desc.SampleDesc.Count = 1;
+    scaled_desc.Usage = D3D11_USAGE_DEFAULT;
+    scaled_desc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+
+    error = device->CreateTexture2D(&scaled_desc, nullptr, scaled_.GetAddressOf());
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "Failed to create the scaled texture, error "
+                      << error.ErrorMessage() << ", code " << error.Error();
+        source_.Reset();
+        return false;
+    }
+
+    error = device->CreateUnorderedAccessView(scaled_.Get(), nullptr, scaled_view_.GetAddressOf());
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "Failed to create the unordered access view, error "
+                      << error.ErrorMessage() << ", code " << error.Error();
+        source_.Reset();
+        return false;
+    }
+
+    D3D11_TEXTURE2D_DESC stage_desc = scaled_desc;
+    stage_desc.Usage = D3D11_USAGE_STAGING;
+    stage_desc.BindFlags = 0;
+    stage_desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+    error = device->CreateTexture2D(&stage_desc, nullptr, stage_.GetAddressOf());
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "Failed to create the stage texture, error "
+                      << error.ErrorMessage() << ", code " << error.Error();
+        source_.Reset();
+        return false;
+    }
+
+    source_size_ = source_size;
+    target_size_ = target_size;
+
+    LOG(LS_INFO) << "Scaler initialized for " << source_size_ << " to " << target_size_;
+    return true;
+}
+
+bool D3dScaler::createShader()
+{
+    if (device_.d3dDevice()->GetFeatureLevel() < D3D_FEATURE_LEVEL_11_0)
+    {
+        LOG(LS_WARNING) << "Compute shaders are not supported by the device";
+        return false;
+    }
+
+    // d3dcompiler_47.dll is a part of the OS since Windows 8.1. We load it dynamically to keep the
+    // capturer working on systems without it.
+    HMODULE module = LoadLibraryExW(L"d3dcompiler_47.dll", nullptr, LOAD_LIBRARY_SEARCH_SYSTEM32);
+    if (!module)
+    {
+        PLOG(LS_WARNING) << "LoadLibraryExW failed";
+        return false;
+    }
+
+    D3DCompileFunc d3dCompileFunc =
+        reinterpret_cast<D3DCompileFunc>(GetProcAddress(module, "D3DCompile"));
+    if (!d3dCompileFunc)
+    {
+        PLOG(LS_WARNING) << "GetProcAddress failed";
+        FreeLibrary(module);
+        return false;
+    }
+
+    ComPtr<ID3DBlob> code;
+    ComPtr<ID3DBlob> errors;
+
+    _com_error error = d3dCompileFunc(kShaderSource, sizeof(kShaderSource) - 1, nullptr, nullptr,
+                                      nullptr, "main", "cs_5_0", D3DCOMPILE_OPTIMIZATION_LEVEL3, 0,
+                                      code.GetAddressOf(), errors.GetAddressOf());
+    FreeLibrary(module);
+
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "Failed to compile the scaling shader, error "
+                      << error.ErrorMessage() << ", code " << error.Error();
+        if (errors)
+            LOG(LS_ERROR) << static_cast<const char*>(errors->GetBufferPointer());
+        return false;
+    }
+
+    error = device_.d3dDevice()->CreateComputeShader(
+        code->GetBufferPointer(), code->GetBufferSize(), nullptr, shader_.GetAddressOf());
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "Failed to create the compute shader, error "
+                      << error.ErrorMessage() << ", code " << error.Error();
+        return false;
+    }
+
+    D3D11_BUFFER_DESC buffer_desc;
+    memset(&buffer_desc, 0, sizeof(buffer_desc));
+    buffer_desc.ByteWidth = sizeof(Constants);
+    buffer_desc.Usage = D3D11_USAGE_DEFAULT;
+    buffer_desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+
+    error = device_.d3dDevice()->CreateBuffer(&buffer_desc, nullptr, constants_.GetAddressOf());
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_ERROR) << "Failed to create the constant buffer, error "
+                      << error.ErrorMessage() << ", code " << error.Error();
+        shader_.Reset();
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace base
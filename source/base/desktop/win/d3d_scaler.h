@@ -0,0 +1,77 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef BASE_DESKTOP_WIN_D3D_SCALER_H
+#define BASE_DESKTOP_WIN_D3D_SCALER_H
+
+#include "base/macros_magic.h"
+#include "base/desktop/frame.h"
+#include "base/desktop/win/d3d_device.h"
+
+#include <d3d11.h>
+#include <wrl/client.h>
+
+namespace base {
+
+// Scales a B8G8R8A8 desktop texture down with a box filter in a compute shader, so that only the
+// scaled pixels of the changed rectangles are read back from the video memory.
+//
+// A D3dScaler is bound to the ID3D11Device it was created with and cannot be shared between two
+// DxgiAdapterDuplicators.
+class D3dScaler
+{
+public:
+    // Caller must maintain the lifetime of input device to make sure it outlives this instance.
+    explicit D3dScaler(const D3dDevice& device);
+    ~D3dScaler();
+
+    // Copies the |region| of |texture| into the internal copy of the desktop and writes the
+    // |target_region| of the scaled image into the packed |target|. The scaled image has the size
+    // of |target|. Returns false if anything wrong, in this case the caller should fall back to the
+    // CPU scaling.
+    bool scale(ID3D11Texture2D* texture, const Region& region, const Region& target_region,
+               Frame* target);
+
+private:
+    bool initialize(const D3D11_TEXTURE2D_DESC& desc, const Size& target_size);
+    bool createShader();
+
+    const D3dDevice device_;
+    bool shader_failed_ = false;
+    Size source_size_;
+    Size target_size_;
+
+    Microsoft::WRL::ComPtr<ID3D11ComputeShader> shader_;
+    Microsoft::WRL::ComPtr<ID3D11Buffer> constants_;
+
+    // Copy of the desktop texture which can be bound as a shader resource. Textures returned by
+    // AcquireNextFrame() do not always have D3D11_BIND_SHADER_RESOURCE flag. The scaled pixels
+    // near the changed rectangles also depend on unchanged pixels, so the copy holds the whole
+    // desktop.
+    Microsoft::WRL::ComPtr<ID3D11Texture2D> source_;
+    Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> source_view_;
+
+    Microsoft::WRL::ComPtr<ID3D11Texture2D> scaled_;
+    Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> scaled_view_;
+    Microsoft::WRL::ComPtr<ID3D11Texture2D> stage_;
+
+    DISALLOW_COPY_AND_ASSIGN(D3dScaler);
+};
+
+} // namespace base
+
+#endif // BASE_DESKTOP_WIN_D3D_SCALER_H
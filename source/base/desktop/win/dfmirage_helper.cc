@@ -20,6 +20,7 @@
 
 #include "base/logging.h"
 #include "base/strings/string_util.h"
+#include "base/desktop/block_region.h"
 #include "base/desktop/frame.h"
 
 namespace base {
@@ -98,7 +99,7 @@ std::unique_ptr<DFMirageHelper> DFMirageHelper::create(const Rect& screen_rect)
     return helper;
 }
 
-void DFMirageHelper::addUpdatedRects(Region* updated_region) const
+void DFMirageHelper::addUpdatedRects(BlockRegion* updated_region) const
 {
     DCHECK(updated_region);
 
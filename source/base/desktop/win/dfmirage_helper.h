@@ -33,7 +33,7 @@ public:
     static std::unique_ptr<DFMirageHelper> create(const Rect& screen_rect);
 
     const Rect& screenRect() const override { return screen_rect_; }
-    void addUpdatedRects(Region* updated_region) const override;
+    void addUpdatedRects(BlockRegion* updated_region) const override;
     void copyRegion(Frame* frame, const Region& updated_region) const override;
 
 private:
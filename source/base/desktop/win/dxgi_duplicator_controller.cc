@@ -174,7 +174,10 @@ DxgiDuplicatorController::Result DxgiDuplicatorController::doDuplicate(
         return Result::INITIALIZATION_FAILED;
     }
 
-    if (!frame->prepare(selectedDesktopSize(monitor_id), monitor_id))
+    // Only a frame of a single output can be scaled down.
+    const bool can_scale = monitor_id >= 0 || doScreenCount() == 1;
+
+    if (!frame->prepare(selectedDesktopSize(monitor_id), monitor_id, can_scale))
         return Result::FRAME_PREPARE_FAILED;
 
     frame->frame()->updatedRegion()->clear();
@@ -39,8 +39,18 @@ DxgiFrame::~DxgiFrame()
     LOG(LS_INFO) << "Dtor";
 }
 
-bool DxgiFrame::prepare(const Size& size, ScreenCapturer::ScreenId source_id)
+bool DxgiFrame::prepare(const Size& size, ScreenCapturer::ScreenId source_id, bool can_scale)
 {
+    Size frame_size = size;
+
+    // DxgiOutputDuplicator recognizes a scaled frame by its size, so it must be smaller in both
+    // dimensions.
+    if (can_scale && layout_ == Frame::Layout::PACKED && !preferred_size_.isEmpty() &&
+        preferred_size_.width() < size.width() && preferred_size_.height() < size.height())
+    {
+        frame_size = preferred_size_;
+    }
+
     if (source_id != source_id_)
     {
         // Once the source has been changed, the entire source should be copied.
@@ -49,12 +59,21 @@ bool DxgiFrame::prepare(const Size& size, ScreenCapturer::ScreenId source_id)
         frame_.reset();
     }
 
-    if (!last_frame_size_.has_value() || last_frame_size_ != size)
+    if (!last_frame_size_.has_value() || last_frame_size_ != frame_size)
     {
         // Save the last frame size.
-        last_frame_size_.emplace(size);
+        last_frame_size_.emplace(frame_size);
+
+        // Once the output size changed, recreate the SharedFrame. The new frame is empty, so the
+        // entire source should be copied.
+        context_.reset();
+        frame_.reset();
+    }
 
-        // Once the output size changed, recreate the SharedFrame.
+    if (frame_ && frame_->layout() != layout_)
+    {
+        // The content of the frame cannot be reused with other layout.
+        context_.reset();
         frame_.reset();
     }
 
@@ -64,12 +83,13 @@ bool DxgiFrame::prepare(const Size& size, ScreenCapturer::ScreenId source_id)
 
         if (shared_memory_factory_)
         {
-            frame = SharedMemoryFrame::create(size, PixelFormat::ARGB(), shared_memory_factory_);
+            frame = SharedMemoryFrame::create(
+                frame_size, PixelFormat::ARGB(), shared_memory_factory_);
             LOG(LS_INFO) << "SharedMemoryFrame created";
         }
         else
         {
-            frame = FrameAligned::create(size, PixelFormat::ARGB(), 32);
+            frame = FrameAligned::create(frame_size, PixelFormat::ARGB(), 32);
             LOG(LS_INFO) << "FrameAligned created";
         }
 
@@ -81,8 +101,6 @@ bool DxgiFrame::prepare(const Size& size, ScreenCapturer::ScreenId source_id)
 
         frame->setCapturerType(static_cast<uint32_t>(ScreenCapturer::Type::WIN_DXGI));
 
-        const Size& frame_size = frame->size();
-
         // DirectX capturer won't paint each pixel in the frame due to its one
         // capturer per monitor design. So once the new frame is created, we should
         // clear it to avoid the legacy image to be remained on it. See
@@ -90,9 +108,22 @@ bool DxgiFrame::prepare(const Size& size, ScreenCapturer::ScreenId source_id)
         DCHECK_EQ(frame->stride(), frame_size.width() * frame->format().bytesPerPixel());
         memset(frame->frameData(), 0, static_cast<size_t>(frame->stride() * frame_size.height()));
 
+        if (layout_ == Frame::Layout::I420)
+        {
+            frame->setLayout(layout_);
+
+            // Black color in YUV has zero chroma at the middle of the range.
+            const size_t uv_size = static_cast<size_t>(frame->uvStride()) *
+                static_cast<size_t>((frame_size.height() + 1) / 2);
+            memset(frame->uPlane(), 128, uv_size * 2);
+        }
+
         frame_ = SharedFrame::wrap(std::move(frame));
     }
 
+    if (frame_)
+        frame_->setScreenSize(size);
+
     return !!frame_;
 }
 
@@ -46,13 +46,22 @@ public:
     // Should not be called if prepare() is not executed or returns false.
     SharedFrame* frame() const;
 
+    // Sets the layout of frames created by prepare(). The frame is recreated on the next
+    // prepare() call if the layout changes.
+    void setLayout(Frame::Layout layout) { layout_ = layout; }
+
+    // Sets the size to which the image of a single output is scaled down on the GPU. An empty
+    // size or a size not smaller than the output means no scaling.
+    void setPreferredSize(const Size& size) { preferred_size_ = size; }
+
 private:
     // Allows DxgiDuplicatorController to access prepare() and context() function as well as
     // Context class.
     friend class DxgiDuplicatorController;
 
-    // Prepares current instance with desktop size and source id.
-    bool prepare(const Size& size, ScreenCapturer::ScreenId source_id);
+    // Prepares current instance with desktop size and source id. The frame is scaled down if the
+    // preferred size is smaller than |size| and |can_scale| is true.
+    bool prepare(const Size& size, ScreenCapturer::ScreenId source_id, bool can_scale);
 
     // Should not be called if prepare() is not executed or returns false.
     Context* context();
@@ -60,6 +69,8 @@ private:
     SharedMemoryFactory* const shared_memory_factory_;
     std::optional<Size> last_frame_size_;
     ScreenCapturer::ScreenId source_id_ = ScreenCapturer::kFullDesktopScreenId;
+    Frame::Layout layout_ = Frame::Layout::PACKED;
+    Size preferred_size_;
     std::unique_ptr<SharedFrame> frame_;
     Context context_;
 };
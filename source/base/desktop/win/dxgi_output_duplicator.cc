@@ -19,11 +19,16 @@
 #include "base/desktop/win/dxgi_output_duplicator.h"
 
 #include "base/logging.h"
+#include "base/desktop/frame_simple.h"
 #include "base/desktop/mouse_cursor.h"
+#include "base/desktop/win/d3d_i420_converter.h"
+#include "base/desktop/win/d3d_scaler.h"
 #include "base/desktop/win/dxgi_texture_mapping.h"
 #include "base/desktop/win/dxgi_texture_staging.h"
 
+#include <libyuv/convert.h>
 #include <libyuv/convert_argb.h>
+#include <libyuv/scale_argb.h>
 
 #include <algorithm>
 #include <cstring>
@@ -70,6 +75,47 @@ Rotation dxgiRotationToRotation(DXGI_MODE_ROTATION rotation)
     return Rotation::CLOCK_WISE_0;
 }
 
+// Extends the rectangles of |region| to even coordinates as required by the I420 layout.
+Region alignRegionForI420(const Region& region, const Rect& bounds)
+{
+    Region result;
+
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+        Rect aligned = Rect::makeLTRB(rect.left() & ~1, rect.top() & ~1,
+                                      (rect.right() + 1) & ~1, (rect.bottom() + 1) & ~1);
+        aligned.intersectWith(bounds);
+        result.addRect(aligned);
+    }
+
+    return result;
+}
+
+// Returns the region of a frame of |target_size| which is changed by |region| of a frame of
+// |source_size|. Each target pixel depends on the neighbouring source pixels, so the rectangles
+// are enlarged by one pixel.
+Region scaleRegion(const Region& region, const Size& source_size, const Size& target_size)
+{
+    const Rect bounds = Rect::makeSize(target_size);
+    Region result;
+
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+
+        Rect scaled = Rect::makeLTRB(
+            rect.left() * target_size.width() / source_size.width() - 1,
+            rect.top() * target_size.height() / source_size.height() - 1,
+            rect.right() * target_size.width() / source_size.width() + 2,
+            rect.bottom() * target_size.height() / source_size.height() + 2);
+        scaled.intersectWith(bounds);
+        result.addRect(scaled);
+    }
+
+    return result;
+}
+
 }  // namespace
 
 DxgiOutputDuplicator::DxgiOutputDuplicator(const D3dDevice& device,
@@ -215,7 +261,13 @@ bool DxgiOutputDuplicator::duplicate(
     DCHECK(target);
     DCHECK(cursor);
 
-    if (!Rect::makeSize(target->size()).containsRect(translatedDesktopRect(offset)))
+    // The controller passes a frame smaller than the output in both dimensions if the output
+    // should be scaled down.
+    const bool scaled = offset == Point() && target->layout() == Frame::Layout::PACKED &&
+        target->size().width() < desktopSize().width() &&
+        target->size().height() < desktopSize().height();
+
+    if (!scaled && !Rect::makeSize(target->size()).containsRect(translatedDesktopRect(offset)))
     {
         // target size is not large enough to cover current output region.
         return false;
@@ -287,11 +339,49 @@ bool DxgiOutputDuplicator::duplicate(
         detectUpdatedRegion(frame_info, &context->updated_region);
         spreadContextChange(context);
 
-        if (!texture_->copyFrom(frame_info, resource.Get()))
-            return false;
+        if (target->layout() == Frame::Layout::I420)
+        {
+            updated_region.addRegion(context->updated_region);
+            updated_region = alignRegionForI420(updated_region, untranslatedDesktopRect());
+
+            if (!copyI420(frame_info, resource.Get(), updated_region, offset, target))
+                return false;
+
+            last_frame_ = target->share();
+            last_frame_offset_ = offset;
+            last_frame_scaled_ = false;
+
+            updated_region.translate(offset.x(), offset.y());
+            target->updatedRegion()->addRegion(updated_region);
+            ++num_frames_captured_;
+
+            return releaseFrame();
+        }
 
         updated_region.addRegion(context->updated_region);
 
+        if (scaled)
+        {
+            Region scaled_region;
+
+            if (!copyScaled(frame_info, resource.Get(), updated_region, target, &scaled_region))
+                return false;
+
+            last_frame_ = target->share();
+            last_frame_offset_ = offset;
+            last_frame_scaled_ = true;
+
+            target->updatedRegion()->addRegion(scaled_region);
+            ++num_frames_captured_;
+
+            return releaseFrame();
+        }
+
+        // Only the pixels which are exported to the target are copied from the texture.
+        const Region texture_region = textureRegion(updated_region);
+        if (!texture_->copyFrom(frame_info, resource.Get(), texture_region))
+            return false;
+
         // TODO(zijiehe): Figure out why clearing context->updated_region() here triggers screen
         // flickering?
 
@@ -299,14 +389,9 @@ bool DxgiOutputDuplicator::duplicate(
 
         if (rotation_ != Rotation::CLOCK_WISE_0)
         {
-            for (Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
-            {
-                // The |updated_region| returned by Windows is rotated, but the |source| frame is
-                // not. So we need to rotate it reversely.
-                const Rect source_rect =
-                    rotateRect(it.rect(), desktopSize(), reverseRotation(rotation_));
-                rotateDesktopFrame(source, source_rect, rotation_, offset, target);
-            }
+            // The |updated_region| returned by Windows is rotated, but the |source| frame is not.
+            // So we need to rotate it reversely. Only the updated pixels are rotated.
+            rotateDesktopFrame(source, texture_region, rotation_, offset, target);
         }
         else
         {
@@ -324,6 +409,7 @@ bool DxgiOutputDuplicator::duplicate(
 
         last_frame_ = target->share();
         last_frame_offset_ = offset;
+        last_frame_scaled_ = false;
 
         updated_region.translate(offset.x(), offset.y());
         target->updatedRegion()->addRegion(updated_region);
@@ -332,8 +418,22 @@ bool DxgiOutputDuplicator::duplicate(
         return texture_->release() && releaseFrame();
     }
 
-    if (last_frame_)
+    if (scaled && last_frame_ && last_frame_scaled_ && last_frame_->size() == target->size())
     {
+        // No change since last frame, the scaled pixels are exported from it.
+        const Region scaled_region = scaleRegion(updated_region, desktopSize(), target->size());
+
+        for (Region::Iterator it(scaled_region); !it.isAtEnd(); it.advance())
+            target->copyPixelsFrom(*last_frame_, it.rect().topLeft(), it.rect());
+
+        target->updatedRegion()->addRegion(scaled_region);
+    }
+    else if (!scaled && last_frame_ && !last_frame_scaled_ &&
+             last_frame_->layout() == target->layout())
+    {
+        if (target->layout() == Frame::Layout::I420)
+            updated_region = alignRegionForI420(updated_region, untranslatedDesktopRect());
+
         // No change since last frame or AcquireNextFrame() timed out, we will export last frame to
         // the target.
         for (Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
@@ -347,6 +447,12 @@ bool DxgiOutputDuplicator::duplicate(
             source_rect.translate(last_frame_offset_);
             target_rect.translate(offset);
 
+            if (target->layout() == Frame::Layout::I420)
+            {
+                target->copyPixelsFrom(*last_frame_, source_rect.topLeft(), target_rect);
+                continue;
+            }
+
             libyuv::ARGBCopy(last_frame_->frameDataAtPos(source_rect.topLeft()), last_frame_->stride(),
                              target->frameDataAtPos(target_rect.topLeft()), target->stride(),
                              target_rect.width(), target_rect.height());
@@ -366,6 +472,133 @@ bool DxgiOutputDuplicator::duplicate(
     return error.Error() == DXGI_ERROR_WAIT_TIMEOUT || releaseFrame();
 }
 
+bool DxgiOutputDuplicator::copyI420(const DXGI_OUTDUPL_FRAME_INFO& frame_info,
+                                    IDXGIResource* resource,
+                                    const Region& updated_region,
+                                    const Point& offset,
+                                    SharedFrame* target)
+{
+    // The compute shader works only with unrotated desktop textures in the video memory.
+    if (!gpu_conversion_failed_ && rotation_ == Rotation::CLOCK_WISE_0 &&
+        !desc_.DesktopImageInSystemMemory && !(offset.x() & 1) && !(offset.y() & 1))
+    {
+        if (!converter_)
+            converter_ = std::make_unique<D3dI420Converter>(device_);
+
+        ComPtr<ID3D11Texture2D> texture;
+        if (SUCCEEDED(resource->QueryInterface(__uuidof(ID3D11Texture2D),
+                                               reinterpret_cast<void**>(texture.GetAddressOf()))))
+        {
+            if (converter_->convert(texture.Get(), updated_region, offset, target))
+                return true;
+        }
+
+        LOG(LS_WARNING) << "GPU conversion to I420 failed, use CPU conversion";
+        gpu_conversion_failed_ = true;
+        converter_.reset();
+    }
+
+    const Region texture_region = textureRegion(updated_region);
+    if (!texture_->copyFrom(frame_info, resource, texture_region))
+        return false;
+
+    const Frame* source = &texture_->asDesktopFrame();
+
+    if (rotation_ != Rotation::CLOCK_WISE_0)
+    {
+        if (!rotated_frame_ || rotated_frame_->size() != desktopSize())
+            rotated_frame_ = FrameSimple::create(desktopSize(), PixelFormat::ARGB());
+
+        rotateDesktopFrame(*source, texture_region, rotation_, Point(), rotated_frame_.get());
+        source = rotated_frame_.get();
+    }
+
+    for (Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+        const Rect dest_rect = rect.translated(offset);
+
+        const int y_offset = target->yStride() * dest_rect.y() + dest_rect.x();
+        const int uv_offset = target->uvStride() * (dest_rect.y() / 2) + (dest_rect.x() / 2);
+
+        libyuv::ARGBToI420(source->frameDataAtPos(rect.topLeft()), source->stride(),
+                           target->yPlane() + y_offset, target->yStride(),
+                           target->uPlane() + uv_offset, target->uvStride(),
+                           target->vPlane() + uv_offset, target->uvStride(),
+                           rect.width(), rect.height());
+    }
+
+    return texture_->release();
+}
+
+bool DxgiOutputDuplicator::copyScaled(const DXGI_OUTDUPL_FRAME_INFO& frame_info,
+                                      IDXGIResource* resource,
+                                      const Region& updated_region,
+                                      SharedFrame* target,
+                                      Region* scaled_region)
+{
+    *scaled_region = scaleRegion(updated_region, desktopSize(), target->size());
+
+    // The compute shader works only with unrotated desktop textures in the video memory.
+    if (!gpu_scaling_failed_ && rotation_ == Rotation::CLOCK_WISE_0 &&
+        !desc_.DesktopImageInSystemMemory)
+    {
+        if (!scaler_)
+            scaler_ = std::make_unique<D3dScaler>(device_);
+
+        ComPtr<ID3D11Texture2D> texture;
+        if (SUCCEEDED(resource->QueryInterface(__uuidof(ID3D11Texture2D),
+                                               reinterpret_cast<void**>(texture.GetAddressOf()))))
+        {
+            if (scaler_->scale(texture.Get(), updated_region, *scaled_region, target))
+                return true;
+        }
+
+        LOG(LS_WARNING) << "GPU scaling failed, use CPU scaling";
+        gpu_scaling_failed_ = true;
+        scaler_.reset();
+    }
+
+    // The pixels around the changed rectangles are also used, so the texture must hold the
+    // whole output once the GPU scaling is given up.
+    Region source_region = updated_region;
+    if (gpu_scaling_failed_ && !cpu_scaling_started_)
+    {
+        source_region = Region(untranslatedDesktopRect());
+        *scaled_region = Region(Rect::makeSize(target->size()));
+        cpu_scaling_started_ = true;
+    }
+
+    const Region texture_region = textureRegion(source_region);
+    if (!texture_->copyFrom(frame_info, resource, texture_region))
+        return false;
+
+    const Frame* source = &texture_->asDesktopFrame();
+
+    if (rotation_ != Rotation::CLOCK_WISE_0)
+    {
+        if (!rotated_frame_ || rotated_frame_->size() != desktopSize())
+            rotated_frame_ = FrameSimple::create(desktopSize(), PixelFormat::ARGB());
+
+        rotateDesktopFrame(*source, texture_region, rotation_, Point(), rotated_frame_.get());
+        source = rotated_frame_.get();
+    }
+
+    for (Region::Iterator it(*scaled_region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+
+        libyuv::ARGBScaleClip(source->frameData(), source->stride(),
+                              source->size().width(), source->size().height(),
+                              target->frameData(), target->stride(),
+                              target->size().width(), target->size().height(),
+                              rect.x(), rect.y(), rect.width(), rect.height(),
+                              libyuv::kFilterBox);
+    }
+
+    return texture_->release();
+}
+
 Rect DxgiOutputDuplicator::translatedDesktopRect(const Point& offset) const
 {
     Rect result(Rect::makeSize(desktopSize()));
@@ -378,6 +611,11 @@ Rect DxgiOutputDuplicator::untranslatedDesktopRect() const
     return Rect::makeSize(desktopSize());
 }
 
+Region DxgiOutputDuplicator::textureRegion(const Region& updated_region) const
+{
+    return rotateRegion(updated_region, desktopSize(), reverseRotation(rotation_));
+}
+
 void DxgiOutputDuplicator::detectUpdatedRegion(const DXGI_OUTDUPL_FRAME_INFO& frame_info,
                                                Region* updated_region)
 {
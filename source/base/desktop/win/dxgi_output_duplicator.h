@@ -37,6 +37,9 @@
 
 namespace base {
 
+class D3dI420Converter;
+class D3dScaler;
+
 // Duplicates the content on one IDXGIOutput, i.e. one monitor attached to one video card. None of
 // functions in this class is thread-safe.
 class DxgiOutputDuplicator
@@ -65,6 +68,8 @@ public:
     // The |offset| decides the offset in the |target| where the content should be copied to. i.e.
     // this function copies the content to the rectangle of (offset.x(), offset.y()) to
     // (offset.x() + desktop_rect_.width(), offset.y() + desktop_rect_.height()).
+    // If the |offset| is zero and the |target| is smaller than the output in both dimensions, the
+    // content is scaled down to the size of the |target|.
     // Returns false in case of a failure.
     bool duplicate(
         Context* context, const Point& offset, SharedFrame* target_frame, DxgiCursor* cursor);
@@ -96,6 +101,23 @@ private:
 
     bool releaseFrame();
 
+    // Converts |updated_region| of the acquired frame into the planes of the I420 |target|. Uses
+    // the compute shader if possible and libyuv otherwise.
+    bool copyI420(const DXGI_OUTDUPL_FRAME_INFO& frame_info,
+                  IDXGIResource* resource,
+                  const Region& updated_region,
+                  const Point& offset,
+                  SharedFrame* target);
+
+    // Scales |updated_region| of the acquired frame down into the |target|, which is smaller than
+    // the output. Uses the compute shader if possible and libyuv otherwise. The changed region of
+    // |target| is returned in |scaled_region|.
+    bool copyScaled(const DXGI_OUTDUPL_FRAME_INFO& frame_info,
+                    IDXGIResource* resource,
+                    const Region& updated_region,
+                    SharedFrame* target,
+                    Region* scaled_region);
+
     // Initializes duplication_ instance. Expects duplication_ is in empty status.
     // Returns false if system does not support IDXGIOutputDuplication.
     bool duplicateOutput();
@@ -106,6 +128,9 @@ private:
     // Returns a Rect with the same size of desktopSize(), but starts from (0, 0).
     Rect untranslatedDesktopRect() const;
 
+    // Returns |updated_region| in the coordinates of the unrotated desktop texture.
+    Region textureRegion(const Region& updated_region) const;
+
     // Spreads changes from |context| to other registered Context(s) in contexts_.
     void spreadContextChange(const Context* const context);
 
@@ -121,6 +146,12 @@ private:
     DXGI_OUTDUPL_DESC desc_;
     std::vector<uint8_t> metadata_;
     std::unique_ptr<DxgiTexture> texture_;
+    std::unique_ptr<D3dI420Converter> converter_;
+    std::unique_ptr<D3dScaler> scaler_;
+    std::unique_ptr<Frame> rotated_frame_;
+    bool gpu_conversion_failed_ = false;
+    bool gpu_scaling_failed_ = false;
+    bool cpu_scaling_started_ = false;
     Rotation rotation_ = Rotation::CLOCK_WISE_0;
     Size unrotated_size_;
 
@@ -133,6 +164,7 @@ private:
     // of timeout, i.e. no update, we can copy content from |last_frame_|.
     std::unique_ptr<SharedFrame> last_frame_;
     Point last_frame_offset_;
+    bool last_frame_scaled_ = false;
 
     int64_t num_frames_captured_ = 0;
     Desktop desktop_;
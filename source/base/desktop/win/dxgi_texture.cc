@@ -51,7 +51,9 @@ public:
 DxgiTexture::DxgiTexture() = default;
 DxgiTexture::~DxgiTexture() = default;
 
-bool DxgiTexture::copyFrom(const DXGI_OUTDUPL_FRAME_INFO& frame_info, IDXGIResource* resource)
+bool DxgiTexture::copyFrom(const DXGI_OUTDUPL_FRAME_INFO& frame_info,
+                           IDXGIResource* resource,
+                           const Region& updated_region)
 {
     DCHECK_GT(frame_info.AccumulatedFrames, 0u);
     DCHECK(resource);
@@ -78,7 +80,7 @@ bool DxgiTexture::copyFrom(const DXGI_OUTDUPL_FRAME_INFO& frame_info, IDXGIResou
 
     desktop_size_.set(static_cast<int32_t>(desc.Width), static_cast<int32_t>(desc.Height));
 
-    return copyFromTexture(frame_info, texture.Get());
+    return copyFromTexture(frame_info, texture.Get(), updated_region);
 }
 
 const Frame& DxgiTexture::asDesktopFrame()
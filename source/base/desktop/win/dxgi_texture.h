@@ -20,6 +20,7 @@
 #define BASE_DESKTOP_WIN_DXGI_TEXTURE_H
 
 #include "base/desktop/frame.h"
+#include "base/desktop/region.h"
 
 #include <memory>
 
@@ -37,9 +38,12 @@ public:
     DxgiTexture();
     virtual ~DxgiTexture();
 
-    // Copies selected regions of a frame represented by frame_info and resource.
-    // Returns false if anything wrong.
-    bool copyFrom(const DXGI_OUTDUPL_FRAME_INFO& frame_info, IDXGIResource* resource);
+    // Copies selected regions of a frame represented by frame_info and resource. Only the pixels
+    // of |updated_region| are guaranteed to be up to date after the call, the other ones may keep
+    // the contents of a previous frame. Returns false if anything wrong.
+    bool copyFrom(const DXGI_OUTDUPL_FRAME_INFO& frame_info,
+                  IDXGIResource* resource,
+                  const Region& updated_region);
 
     const Size& desktopSize() const { return desktop_size_; }
     uint8_t* bits() const { return static_cast<uint8_t*>(rect_.pBits); }
@@ -60,7 +64,8 @@ protected:
     DXGI_MAPPED_RECT* rect();
 
     virtual bool copyFromTexture(const DXGI_OUTDUPL_FRAME_INFO& frame_info,
-                                 ID3D11Texture2D* texture) = 0;
+                                 ID3D11Texture2D* texture,
+                                 const Region& updated_region) = 0;
 
     virtual bool doRelease() = 0;
 
@@ -28,6 +28,14 @@ using Microsoft::WRL::ComPtr;
 
 namespace base {
 
+namespace {
+
+// Each rectangle is a separate copy command, so a region of many small rectangles is copied at
+// once as the whole texture.
+const int kMaxRegionCopies = 64;
+
+} // namespace
+
 DxgiTextureStaging::DxgiTextureStaging(const D3dDevice& device)
     : device_(device)
 {
@@ -106,7 +114,8 @@ void DxgiTextureStaging::assertStageAndSurfaceAreSameObject()
 }
 
 bool DxgiTextureStaging::copyFromTexture(const DXGI_OUTDUPL_FRAME_INFO& frame_info,
-                                         ID3D11Texture2D* texture)
+                                         ID3D11Texture2D* texture,
+                                         const Region& updated_region)
 {
     DCHECK_GT(frame_info.AccumulatedFrames, 0u);
     DCHECK(texture);
@@ -116,8 +125,7 @@ bool DxgiTextureStaging::copyFromTexture(const DXGI_OUTDUPL_FRAME_INFO& frame_in
     if (!initializeStage(texture))
         return false;
 
-    device_.context()->CopyResource(static_cast<ID3D11Resource*>(stage_.Get()),
-                                    static_cast<ID3D11Resource*>(texture));
+    copyRegion(texture, updated_region);
 
     *rect() = { 0 };
 
@@ -133,6 +141,37 @@ bool DxgiTextureStaging::copyFromTexture(const DXGI_OUTDUPL_FRAME_INFO& frame_in
     return true;
 }
 
+void DxgiTextureStaging::copyRegion(ID3D11Texture2D* texture, const Region& updated_region)
+{
+    int count = 0;
+    for (Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
+        ++count;
+
+    if (count > kMaxRegionCopies)
+    {
+        device_.context()->CopyResource(static_cast<ID3D11Resource*>(stage_.Get()),
+                                        static_cast<ID3D11Resource*>(texture));
+        return;
+    }
+
+    for (Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+
+        D3D11_BOX box;
+        box.left = static_cast<UINT>(rect.left());
+        box.top = static_cast<UINT>(rect.top());
+        box.front = 0;
+        box.right = static_cast<UINT>(rect.right());
+        box.bottom = static_cast<UINT>(rect.bottom());
+        box.back = 1;
+
+        device_.context()->CopySubresourceRegion(static_cast<ID3D11Resource*>(stage_.Get()), 0,
+                                                 box.left, box.top, 0,
+                                                 static_cast<ID3D11Resource*>(texture), 0, &box);
+    }
+}
+
 bool DxgiTextureStaging::doRelease()
 {
     _com_error error = surface_->Unmap();
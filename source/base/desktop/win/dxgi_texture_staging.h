@@ -46,7 +46,8 @@ protected:
     // Copies selected regions of a frame represented by frame_info and texture.
     // Returns false if anything wrong.
     bool copyFromTexture(const DXGI_OUTDUPL_FRAME_INFO& frame_info,
-                         ID3D11Texture2D* texture) override;
+                         ID3D11Texture2D* texture,
+                         const Region& updated_region) override;
 
     bool doRelease() override;
 
@@ -55,6 +56,10 @@ private:
     // execute Windows APIs, or the size of the texture is not consistent with desktop_rect.
     bool initializeStage(ID3D11Texture2D* texture);
 
+    // Copies the rectangles of |updated_region| from |texture| to stage_. Copies the whole texture
+    // if the region consists of too many rectangles.
+    void copyRegion(ID3D11Texture2D* texture, const Region& updated_region);
+
     // Makes sure stage_ and surface_ are always pointing to a same object.
     // We need an ID3D11Texture2D instance for ID3D11DeviceContext::CopySubresourceRegion, but an
     // IDXGISurface for IDXGISurface::Map.
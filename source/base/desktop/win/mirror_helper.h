@@ -25,6 +25,7 @@
 
 namespace base {
 
+class BlockRegion;
 class Frame;
 class Region;
 
@@ -34,7 +35,9 @@ public:
     virtual ~MirrorHelper() = default;
 
     virtual const Rect& screenRect() const = 0;
-    virtual void addUpdatedRects(Region* updated_region) const = 0;
+
+    // Adds the rectangles of the change records of the driver since the previous call.
+    virtual void addUpdatedRects(BlockRegion* updated_region) const = 0;
     virtual void copyRegion(Frame* frame, const Region& updated_region) const = 0;
 
 protected:
@@ -19,6 +19,7 @@
 #include "base/desktop/win/mv2_helper.h"
 
 #include "base/logging.h"
+#include "base/desktop/block_region.h"
 #include "base/desktop/frame.h"
 
 namespace base {
@@ -89,7 +90,7 @@ std::unique_ptr<Mv2Helper> Mv2Helper::create(const Rect& screen_rect)
     return helper;
 }
 
-void Mv2Helper::addUpdatedRects(Region* updated_region) const
+void Mv2Helper::addUpdatedRects(BlockRegion* updated_region) const
 {
     DCHECK(updated_region);
 
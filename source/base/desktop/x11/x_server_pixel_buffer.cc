@@ -450,4 +450,49 @@ bool XServerPixelBuffer::captureRect(const Rect& rect, Frame* frame)
     return true;
 }
 
+bool XServerPixelBuffer::captureDamagedRect(const Rect& rect, Frame* frame)
+{
+    DCHECK_LE(rect.right(), window_rect_.width());
+    DCHECK_LE(rect.bottom(), window_rect_.height());
+
+    // Pixmaps and XGetImage already read back only the requested rectangle.
+    if (!shm_segment_info_ || shm_pixmap_)
+        return captureRect(rect, frame);
+
+    // XShmGetImage always reads the full size of the image, so a temporary image of the size of
+    // |rect| is placed at the beginning of the shared memory segment. The rows are padded in the
+    // same way as XShmCreateImage does it.
+    XImage image = *x_shm_image_;
+    image.width = rect.width();
+    image.height = rect.height();
+    image.bytes_per_line =
+        ((rect.width() * image.bits_per_pixel + image.bitmap_pad - 1) / image.bitmap_pad) *
+        image.bitmap_pad / 8;
+
+    {
+        XErrorTrap error_trap(display_);
+        if (!XShmGetImage(display_, window_, &image, rect.left(), rect.top(), AllPlanes) ||
+            error_trap.lastErrorAndDisable() != 0)
+        {
+            return false;
+        }
+    }
+
+    // The full-screen contents of the segment were overwritten.
+    xshm_get_image_succeeded_ = false;
+
+    uint8_t* data = reinterpret_cast<uint8_t*>(image.data);
+
+    if (isXImageRGBFormat(&image))
+    {
+        fastBlit(&image, data, rect, frame);
+    }
+    else
+    {
+        slowBlit(&image, data, rect, frame);
+    }
+
+    return true;
+}
+
 } // namespace base
@@ -70,6 +70,12 @@ public:
     // any more work. The caller must ensure that |rect| is not larger than windowSize().
     bool captureRect(const Rect& rect, Frame* frame);
 
+    // Reads only the specified rectangle from the X server and stores it in the |frame|. Unlike
+    // captureRect() it does not require a preceding synchronize() call, so the caller can read back
+    // just the damaged parts of the screen. The caller must ensure that |rect| is not larger than
+    // windowSize().
+    bool captureDamagedRect(const Rect& rect, Frame* frame);
+
 private:
     void releaseSharedMemorySegment();
 
@@ -0,0 +1,141 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/fast_hash.h"
+
+#include <cstring>
+
+namespace base {
+
+namespace {
+
+const uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+const uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+const uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+// Size of the block processed by the four accumulators at once.
+const size_t kStripeSize = 32;
+
+inline uint64_t rotateLeft(uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+// All supported processors are little-endian, so the native reads give the XXH64 result.
+inline uint64_t read64(const uint8_t* data)
+{
+    uint64_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+inline uint32_t read32(const uint8_t* data)
+{
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+inline uint64_t round(uint64_t accumulator, uint64_t input)
+{
+    accumulator += input * kPrime2;
+    accumulator = rotateLeft(accumulator, 31);
+    return accumulator * kPrime1;
+}
+
+inline uint64_t mergeRound(uint64_t accumulator, uint64_t value)
+{
+    accumulator ^= round(0, value);
+    return accumulator * kPrime1 + kPrime4;
+}
+
+} // namespace
+
+uint64_t fastHash64(const void* data, size_t size, uint64_t seed)
+{
+    const uint8_t* input = reinterpret_cast<const uint8_t*>(data);
+    const uint8_t* const end = input + size;
+    uint64_t hash;
+
+    if (size >= kStripeSize)
+    {
+        const uint8_t* const limit = end - kStripeSize;
+
+        uint64_t v1 = seed + kPrime1 + kPrime2;
+        uint64_t v2 = seed + kPrime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - kPrime1;
+
+        do
+        {
+            v1 = round(v1, read64(input));
+            v2 = round(v2, read64(input + 8));
+            v3 = round(v3, read64(input + 16));
+            v4 = round(v4, read64(input + 24));
+
+            input += kStripeSize;
+        }
+        while (input <= limit);
+
+        hash = rotateLeft(v1, 1) + rotateLeft(v2, 7) + rotateLeft(v3, 12) + rotateLeft(v4, 18);
+        hash = mergeRound(hash, v1);
+        hash = mergeRound(hash, v2);
+        hash = mergeRound(hash, v3);
+        hash = mergeRound(hash, v4);
+    }
+    else
+    {
+        hash = seed + kPrime5;
+    }
+
+    hash += static_cast<uint64_t>(size);
+
+    while (end - input >= 8)
+    {
+        hash ^= round(0, read64(input));
+        hash = rotateLeft(hash, 27) * kPrime1 + kPrime4;
+        input += 8;
+    }
+
+    if (end - input >= 4)
+    {
+        hash ^= static_cast<uint64_t>(read32(input)) * kPrime1;
+        hash = rotateLeft(hash, 23) * kPrime2 + kPrime3;
+        input += 4;
+    }
+
+    while (input < end)
+    {
+        hash ^= static_cast<uint64_t>(*input) * kPrime5;
+        hash = rotateLeft(hash, 11) * kPrime1;
+        ++input;
+    }
+
+    // Final mix so that all input bits affect all output bits.
+    hash ^= hash >> 33;
+    hash *= kPrime2;
+    hash ^= hash >> 29;
+    hash *= kPrime3;
+    hash ^= hash >> 32;
+
+    return hash;
+}
+
+} // namespace base
@@ -0,0 +1,34 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_FAST_HASH_H
+#define BASE_FAST_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace base {
+
+// Calculates the 64-bit non-cryptographic hash of the data. The result is the same as XXH64 with
+// the given seed. It is many times faster than GenericHash for large buffers and should be used
+// for caches and duplicate detection. It is not a "secure" calculation!
+uint64_t fastHash64(const void* data, size_t size, uint64_t seed = 0);
+
+} // namespace base
+
+#endif // BASE_FAST_HASH_H
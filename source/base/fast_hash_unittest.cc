@@ -0,0 +1,65 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/fast_hash.h"
+
+#include <cstring>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+TEST(FastHashTest, KnownValues)
+{
+    // Reference values of XXH64 with zero seed.
+    EXPECT_EQ(0xEF46DB3751D8E999ULL, fastHash64(nullptr, 0));
+    EXPECT_EQ(0xD24EC4F1A98C6E5BULL, fastHash64("a", 1));
+    EXPECT_EQ(0x44BC2CF5AD770999ULL, fastHash64("abc", 3));
+
+    // Longer than one stripe of the accumulators.
+    const char kData[] = "The quick brown fox jumps over the lazy dog";
+    EXPECT_EQ(0x0B242D361FDA71BCULL, fastHash64(kData, strlen(kData)));
+}
+
+TEST(FastHashTest, Seed)
+{
+    const char kData[] = "123456789";
+    EXPECT_NE(fastHash64(kData, strlen(kData), 0), fastHash64(kData, strlen(kData), 1));
+}
+
+TEST(FastHashTest, SingleBitChange)
+{
+    std::vector<uint8_t> data(1031);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>(i * 7);
+
+    const uint64_t hash = fastHash64(data.data(), data.size());
+
+    // A change in any part of the buffer (stripes, tail words and tail bytes) changes the hash.
+    for (size_t index : { 0, 31, 32, 1000, 1024, 1028, 1030 })
+    {
+        data[index] ^= 1;
+        EXPECT_NE(hash, fastHash64(data.data(), data.size())) << "index: " << index;
+        data[index] ^= 1;
+    }
+
+    EXPECT_EQ(hash, fastHash64(data.data(), data.size()));
+}
+
+} // namespace base
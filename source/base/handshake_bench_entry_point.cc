@@ -0,0 +1,585 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/command_line.h"
+#include "base/logging.h"
+#include "base/task_runner.h"
+#include "base/crypto/key_pair.h"
+#include "base/crypto/scoped_crypto_initializer.h"
+#include "base/message_loop/message_loop.h"
+#include "base/net/tcp_channel.h"
+#include "base/net/tcp_server.h"
+#include "base/peer/client_authenticator.h"
+#include "base/peer/server_authenticator_manager.h"
+#include "base/peer/user.h"
+#include "base/peer/user_list.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/unicode.h"
+#include "proto/router_common.pb.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+const unsigned int kMaxHandshakeCount = 1000000;
+const unsigned int kMaxConcurrency = 1000;
+const unsigned int kMaxThreadCount = 256;
+
+const char16_t kUserName[] = u"bench";
+const char16_t kPassword[] = u"bench";
+
+using Clock = std::chrono::steady_clock;
+
+enum class Profile
+{
+    ROUTER, // Hosts connecting to the router: X25519 with anonymous access.
+    HOST    // Clients connecting to the host: SRP with a user name and password.
+};
+
+struct Options
+{
+    Profile profile = Profile::ROUTER;
+    size_t count = 1000;
+    size_t concurrency = 16;
+    size_t worker_count = 0;
+    uint16_t port = 18095;
+    bool full = true;
+    bool resume = true;
+};
+
+struct Result
+{
+    size_t succeeded = 0;
+    size_t resumed = 0;
+    size_t failed = 0;
+    std::chrono::microseconds elapsed { 0 };
+    std::vector<int64_t> latencies; // Microseconds.
+};
+
+// Runs the server authenticators and the client authenticators in the same message loop and
+// counts the completed handshakes. The connections are closed right after the authentication.
+class HandshakeBench
+    : public base::TcpServer::Delegate,
+      public base::ServerAuthenticatorManager::Delegate
+{
+public:
+    HandshakeBench(std::shared_ptr<base::TaskRunner> task_runner, const Options& options);
+    ~HandshakeBench() override;
+
+    bool start();
+    bool isSucceeded() const { return is_succeeded_; }
+
+protected:
+    // base::TcpServer::Delegate implementation.
+    void onNewConnection(std::unique_ptr<base::TcpChannel> channel) override;
+
+    // base::ServerAuthenticatorManager::Delegate implementation.
+    void onNewSession(base::ServerAuthenticatorManager::SessionInfo&& session_info) override;
+
+private:
+    class Connection;
+
+    void startPhase(bool resume);
+    void startConnection(size_t slot);
+    void onConnectionFinished(size_t slot, base::Authenticator::ErrorCode error_code,
+                              Clock::time_point start_time);
+    void printResult(const char* name, Result* result) const;
+
+    std::shared_ptr<base::TaskRunner> task_runner_;
+    const Options options_;
+
+    std::unique_ptr<base::TcpServer> server_;
+    std::unique_ptr<base::ServerAuthenticatorManager> authenticator_manager_;
+    base::ByteArray public_key_;
+
+    // One connection and the last received ticket per concurrent slot.
+    std::vector<std::unique_ptr<Connection>> connections_;
+    std::vector<base::ClientAuthenticator::SessionTicket> tickets_;
+
+    bool is_resume_phase_ = false;
+
+    // Set while the slots receive the tickets for the measurement of the resumed handshakes.
+    bool is_ticket_phase_ = false;
+
+    size_t started_ = 0;
+    size_t finished_ = 0;
+    Clock::time_point phase_start_time_;
+    Result result_;
+    bool is_succeeded_ = true;
+
+    DISALLOW_COPY_AND_ASSIGN(HandshakeBench);
+};
+
+class HandshakeBench::Connection : public base::TcpChannel::Listener
+{
+public:
+    using Callback = std::function<void(base::Authenticator::ErrorCode error_code,
+                                        Clock::time_point start_time)>;
+
+    Connection(std::shared_ptr<base::TaskRunner> task_runner,
+               std::unique_ptr<base::ClientAuthenticator> authenticator,
+               Callback callback)
+        : task_runner_(std::move(task_runner)),
+          authenticator_(std::move(authenticator)),
+          callback_(std::move(callback)),
+          start_time_(Clock::now())
+    {
+        // Nothing
+    }
+
+    ~Connection() override
+    {
+        if (authenticator_)
+            task_runner_->deleteSoon(std::move(authenticator_));
+        if (channel_)
+            task_runner_->deleteSoon(std::move(channel_));
+    }
+
+    void connect(uint16_t port)
+    {
+        channel_ = std::make_unique<base::TcpChannel>();
+        channel_->setListener(this);
+        channel_->connect(u"127.0.0.1", port);
+    }
+
+    base::ClientAuthenticator* authenticator() const { return authenticator_.get(); }
+
+protected:
+    // base::TcpChannel::Listener implementation.
+    void onTcpConnected() override
+    {
+        channel_->setNoDelay(true);
+
+        authenticator_->start(std::move(channel_),
+                              [this](base::Authenticator::ErrorCode error_code)
+        {
+            callback_(error_code, start_time_);
+        });
+    }
+
+    void onTcpDisconnected(base::NetworkChannel::ErrorCode /* error_code */) override
+    {
+        callback_(base::Authenticator::ErrorCode::NETWORK_ERROR, start_time_);
+    }
+
+    void onTcpMessageReceived(uint8_t /* channel_id */,
+                              const base::ByteArray& /* buffer */) override
+    {
+        // Not used.
+    }
+
+    void onTcpMessageWritten(uint8_t /* channel_id */, size_t /* pending */) override
+    {
+        // Not used.
+    }
+
+private:
+    std::shared_ptr<base::TaskRunner> task_runner_;
+    std::unique_ptr<base::TcpChannel> channel_;
+    std::unique_ptr<base::ClientAuthenticator> authenticator_;
+    Callback callback_;
+    const Clock::time_point start_time_;
+
+    DISALLOW_COPY_AND_ASSIGN(Connection);
+};
+
+HandshakeBench::HandshakeBench(std::shared_ptr<base::TaskRunner> task_runner,
+                               const Options& options)
+    : task_runner_(std::move(task_runner)),
+      options_(options),
+      connections_(options.concurrency),
+      tickets_(options.concurrency)
+{
+    // Nothing
+}
+
+HandshakeBench::~HandshakeBench() = default;
+
+bool HandshakeBench::start()
+{
+    authenticator_manager_ =
+        std::make_unique<base::ServerAuthenticatorManager>(task_runner_, this);
+    authenticator_manager_->setWorkerThreadCount(options_.worker_count);
+
+    if (options_.profile == Profile::ROUTER)
+    {
+        base::KeyPair key_pair = base::KeyPair::create(base::KeyPair::Type::X25519);
+        if (!key_pair.isValid())
+        {
+            std::cout << "Failed to create a key pair" << std::endl;
+            return false;
+        }
+
+        public_key_ = key_pair.publicKey();
+
+        authenticator_manager_->setPrivateKey(key_pair.privateKey());
+        authenticator_manager_->setUserList(base::UserList::createEmpty());
+        authenticator_manager_->setAnonymousAccess(
+            base::ServerAuthenticator::AnonymousAccess::ENABLE, proto::ROUTER_SESSION_HOST);
+    }
+    else
+    {
+        base::User user = base::User::create(kUserName, kPassword);
+        if (!user.isValid())
+        {
+            std::cout << "Failed to create a user" << std::endl;
+            return false;
+        }
+
+        user.sessions = proto::SESSION_TYPE_DESKTOP_MANAGE;
+        user.flags = base::User::ENABLED;
+
+        std::unique_ptr<base::UserList> user_list = base::UserList::createEmpty();
+        user_list->add(user);
+        authenticator_manager_->setUserList(std::move(user_list));
+    }
+
+    server_ = std::make_unique<base::TcpServer>();
+    server_->start(u"127.0.0.1", options_.port, this);
+
+    startPhase(!options_.full);
+    return true;
+}
+
+void HandshakeBench::onNewConnection(std::unique_ptr<base::TcpChannel> channel)
+{
+    authenticator_manager_->addNewChannel(std::move(channel));
+}
+
+void HandshakeBench::onNewSession(base::ServerAuthenticatorManager::SessionInfo&& session_info)
+{
+    // The session is not needed, the channel is closed.
+    task_runner_->deleteSoon(std::move(session_info.channel));
+}
+
+void HandshakeBench::startPhase(bool resume)
+{
+    is_resume_phase_ = resume;
+    started_ = 0;
+    finished_ = 0;
+    result_ = Result();
+    result_.latencies.reserve(options_.count);
+
+    if (resume)
+    {
+        // Every slot makes a full handshake first to get a ticket. It is not measured.
+        is_ticket_phase_ = true;
+
+        for (size_t slot = 0; slot < options_.concurrency; ++slot)
+        {
+            if (!tickets_[slot].isValid())
+            {
+                ++started_;
+                startConnection(slot);
+            }
+        }
+
+        if (started_)
+            return;
+
+        is_ticket_phase_ = false;
+    }
+
+    phase_start_time_ = Clock::now();
+
+    for (size_t slot = 0; slot < options_.concurrency && started_ < options_.count; ++slot)
+    {
+        ++started_;
+        startConnection(slot);
+    }
+}
+
+void HandshakeBench::startConnection(size_t slot)
+{
+    std::unique_ptr<base::ClientAuthenticator> authenticator =
+        std::make_unique<base::ClientAuthenticator>(task_runner_);
+
+    if (options_.profile == Profile::ROUTER)
+    {
+        authenticator->setIdentify(proto::IDENTIFY_ANONYMOUS);
+        authenticator->setPeerPublicKey(public_key_);
+        authenticator->setSessionType(proto::ROUTER_SESSION_HOST);
+    }
+    else
+    {
+        authenticator->setIdentify(proto::IDENTIFY_SRP);
+        authenticator->setUserName(kUserName);
+        authenticator->setPassword(kPassword);
+        authenticator->setSessionType(proto::SESSION_TYPE_DESKTOP_MANAGE);
+    }
+
+    if (is_resume_phase_)
+        authenticator->setSessionTicket(tickets_[slot]);
+
+    // The previous connection of the slot may still be in its callback.
+    if (connections_[slot])
+        task_runner_->deleteSoon(std::move(connections_[slot]));
+
+    connections_[slot] = std::make_unique<Connection>(
+        task_runner_, std::move(authenticator),
+        [this, slot](base::Authenticator::ErrorCode error_code, Clock::time_point start_time)
+    {
+        onConnectionFinished(slot, error_code, start_time);
+    });
+
+    connections_[slot]->connect(options_.port);
+}
+
+void HandshakeBench::onConnectionFinished(
+    size_t slot, base::Authenticator::ErrorCode error_code, Clock::time_point start_time)
+{
+    base::ClientAuthenticator* authenticator = connections_[slot]->authenticator();
+    const bool is_resumed = authenticator && authenticator->isResumed();
+
+    if (authenticator)
+        tickets_[slot] = authenticator->sessionTicket();
+
+    if (is_ticket_phase_)
+    {
+        if (error_code != base::Authenticator::ErrorCode::SUCCESS)
+        {
+            std::cout << "Handshake failed: "
+                      << base::Authenticator::errorToString(error_code) << std::endl;
+            is_succeeded_ = false;
+            task_runner_->postQuit();
+            return;
+        }
+
+        if (!tickets_[slot].isValid())
+        {
+            std::cout << "The server does not issue session tickets" << std::endl;
+            is_succeeded_ = false;
+            task_runner_->postQuit();
+            return;
+        }
+
+        task_runner_->deleteSoon(std::move(connections_[slot]));
+
+        if (++finished_ == started_)
+        {
+            is_ticket_phase_ = false;
+            startPhase(true);
+        }
+        return;
+    }
+
+    if (error_code == base::Authenticator::ErrorCode::SUCCESS)
+    {
+        ++result_.succeeded;
+        if (is_resumed)
+            ++result_.resumed;
+
+        result_.latencies.emplace_back(std::chrono::duration_cast<std::chrono::microseconds>(
+            Clock::now() - start_time).count());
+    }
+    else
+    {
+        ++result_.failed;
+    }
+
+    if (started_ < options_.count)
+    {
+        ++started_;
+        startConnection(slot);
+        return;
+    }
+
+    task_runner_->deleteSoon(std::move(connections_[slot]));
+
+    if (result_.succeeded + result_.failed < options_.count)
+        return;
+
+    result_.elapsed =
+        std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - phase_start_time_);
+
+    printResult(is_resume_phase_ ? "Resumed handshakes" : "Full handshakes", &result_);
+
+    if (result_.failed || (is_resume_phase_ && result_.resumed != result_.succeeded))
+        is_succeeded_ = false;
+
+    if (!is_resume_phase_ && options_.resume)
+    {
+        startPhase(true);
+        return;
+    }
+
+    task_runner_->postQuit();
+}
+
+void HandshakeBench::printResult(const char* name, Result* result) const
+{
+    std::sort(result->latencies.begin(), result->latencies.end());
+
+    auto percentile = [result](size_t percent) -> double
+    {
+        if (result->latencies.empty())
+            return 0;
+
+        const size_t index = (result->latencies.size() - 1) * percent / 100;
+        return static_cast<double>(result->latencies[index]) / 1000.0;
+    };
+
+    const double seconds = static_cast<double>(result->elapsed.count()) / 1000000.0;
+    const double rate = seconds > 0 ? static_cast<double>(result->succeeded) / seconds : 0;
+
+    std::cout << std::fixed << std::setprecision(2)
+              << name << ':' << std::endl
+              << '\t' << "Succeeded: " << result->succeeded
+              << " (resumed: " << result->resumed << ", failed: " << result->failed << ")"
+              << std::endl
+              << '\t' << "Handshakes per second: " << rate << std::endl
+              << '\t' << "Latency (ms): p50 " << percentile(50) << ", p90 " << percentile(90)
+              << ", p99 " << percentile(99) << std::endl;
+}
+
+void showHelp()
+{
+    std::cout << "aspia_handshake_bench [switch]" << std::endl
+        << "Available switches:" << std::endl
+        << '\t' << "--profile=NAME" << '\t' << "router (X25519) or host (SRP) (router)"
+        << std::endl
+        << '\t' << "--mode=NAME" << '\t' << "full, resume or both (both)" << std::endl
+        << '\t' << "--count=N" << '\t' << "Number of handshakes in each mode (1000)" << std::endl
+        << '\t' << "--concurrency=N" << '\t' << "Handshakes in progress at a time (16)"
+        << std::endl
+        << '\t' << "--workers=N" << '\t' << "Authentication worker threads of the server (0)"
+        << std::endl
+        << '\t' << "--port=N" << '\t' << "Port of the server (18095)" << std::endl
+        << '\t' << "--help" << '\t' << "Show help" << std::endl;
+}
+
+bool readSwitch(const base::CommandLine& command_line, std::u16string_view name,
+                unsigned int min_value, unsigned int max_value, unsigned int* value)
+{
+    if (!command_line.hasSwitch(name))
+        return true;
+
+    unsigned int result;
+    if (!base::stringToUint(command_line.switchValue(name), &result) ||
+        result < min_value || result > max_value)
+    {
+        std::cout << "Invalid value of switch --" << base::utf8FromUtf16(name) << std::endl;
+        return false;
+    }
+
+    *value = result;
+    return true;
+}
+
+bool parseOptions(const base::CommandLine& command_line, Options* options)
+{
+    unsigned int count = static_cast<unsigned int>(options->count);
+    unsigned int concurrency = static_cast<unsigned int>(options->concurrency);
+    unsigned int worker_count = static_cast<unsigned int>(options->worker_count);
+    unsigned int port = options->port;
+
+    if (!readSwitch(command_line, u"count", 1, kMaxHandshakeCount, &count) ||
+        !readSwitch(command_line, u"concurrency", 1, kMaxConcurrency, &concurrency) ||
+        !readSwitch(command_line, u"workers", 0, kMaxThreadCount, &worker_count) ||
+        !readSwitch(command_line, u"port", 1, 65535, &port))
+    {
+        return false;
+    }
+
+    if (command_line.hasSwitch(u"profile"))
+    {
+        const std::u16string& profile = command_line.switchValue(u"profile");
+
+        if (profile == u"router")
+            options->profile = Profile::ROUTER;
+        else if (profile == u"host")
+            options->profile = Profile::HOST;
+        else
+        {
+            std::cout << "Unknown profile: " << base::utf8FromUtf16(profile) << std::endl;
+            return false;
+        }
+    }
+
+    if (command_line.hasSwitch(u"mode"))
+    {
+        const std::u16string& mode = command_line.switchValue(u"mode");
+
+        if (mode == u"full" || mode == u"resume" || mode == u"both")
+        {
+            options->full = mode != u"resume";
+            options->resume = mode != u"full";
+        }
+        else
+        {
+            std::cout << "Unknown mode: " << base::utf8FromUtf16(mode) << std::endl;
+            return false;
+        }
+    }
+
+    options->count = count;
+    options->concurrency = std::min(concurrency, count);
+    options->worker_count = worker_count;
+    options->port = static_cast<uint16_t>(port);
+
+    return true;
+}
+
+} // namespace
+
+int main(int argc, const char* const* argv)
+{
+    base::initLogging();
+
+    base::CommandLine::init(argc, argv);
+    base::CommandLine* command_line = base::CommandLine::forCurrentProcess();
+
+    if (command_line->hasSwitch(u"help"))
+    {
+        showHelp();
+        return 0;
+    }
+
+    Options options;
+    if (!parseOptions(*command_line, &options))
+    {
+        showHelp();
+        return 1;
+    }
+
+    std::unique_ptr<base::ScopedCryptoInitializer> crypto_initializer =
+        std::make_unique<base::ScopedCryptoInitializer>();
+
+    std::unique_ptr<base::MessageLoop> message_loop =
+        std::make_unique<base::MessageLoop>(base::MessageLoop::Type::ASIO);
+
+    std::unique_ptr<HandshakeBench> bench =
+        std::make_unique<HandshakeBench>(message_loop->taskRunner(), options);
+
+    bool succeeded = false;
+    if (bench->start())
+    {
+        message_loop->run();
+        succeeded = bench->isSucceeded();
+    }
+
+    bench.reset();
+    message_loop.reset();
+    crypto_initializer.reset();
+
+    base::shutdownLogging();
+    return succeeded ? 0 : 1;
+}
@@ -0,0 +1,189 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/command_line.h"
+#include "base/crc32.h"
+#include "base/crc32c.h"
+#include "base/fast_hash.h"
+#include "base/logging.h"
+#include "base/crypto/generic_hash.h"
+#include "base/crypto/scoped_crypto_initializer.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/unicode.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const unsigned int kDefaultTotalSize = 256; // MB.
+const unsigned int kMaxTotalSize = 16 * 1024;
+const unsigned int kMaxBlockSize = 64 * 1024 * 1024;
+
+// Typical sizes: a small message, a clipboard text, a row of a 1920x1080 frame with 32 bits per
+// pixel, a file transfer chunk and a large buffer.
+const size_t kDefaultBlockSizes[] = { 64, 1024, 7680, 65536, 1024 * 1024 };
+
+struct Algorithm
+{
+    const char* name;
+    std::function<uint64_t(const uint8_t* data, size_t size)> function;
+};
+
+void showHelp()
+{
+    std::cout << "aspia_hash_bench [switch]" << std::endl
+        << "Available switches:" << std::endl
+        << '\t' << "--total-size=N" << '\t' << "Megabytes hashed for each measurement (256)"
+        << std::endl
+        << '\t' << "--block-size=N" << '\t' << "Size of one hashed buffer in bytes (several)"
+        << std::endl
+        << '\t' << "--help" << '\t' << "Show help" << std::endl;
+}
+
+bool readSwitch(const base::CommandLine& command_line, std::u16string_view name,
+                unsigned int min_value, unsigned int max_value, unsigned int* value)
+{
+    if (!command_line.hasSwitch(name))
+        return true;
+
+    unsigned int result;
+    if (!base::stringToUint(command_line.switchValue(name), &result) ||
+        result < min_value || result > max_value)
+    {
+        std::cout << "Invalid value of switch --" << base::utf8FromUtf16(name) << std::endl;
+        return false;
+    }
+
+    *value = result;
+    return true;
+}
+
+// Returns the throughput in megabytes per second.
+double measure(const Algorithm& algorithm, const std::vector<uint8_t>& buffer, size_t block_size,
+               size_t total_size, uint64_t* checksum)
+{
+    const size_t block_count = buffer.size() / block_size;
+    const size_t iterations = std::max(total_size / block_size, size_t(1));
+
+    Clock::time_point start_time = Clock::now();
+
+    for (size_t i = 0; i < iterations; ++i)
+        *checksum += algorithm.function(buffer.data() + (i % block_count) * block_size, block_size);
+
+    std::chrono::duration<double> elapsed = Clock::now() - start_time;
+    if (elapsed.count() <= 0)
+        return 0;
+
+    const double megabytes =
+        static_cast<double>(iterations * block_size) / static_cast<double>(1024 * 1024);
+    return megabytes / elapsed.count();
+}
+
+uint64_t genericHash(base::GenericHash::Type type, const uint8_t* data, size_t size)
+{
+    base::ByteArray result = base::GenericHash::hash(type, data, size);
+    return result.empty() ? 0 : result.front();
+}
+
+} // namespace
+
+int main(int argc, const char* const* argv)
+{
+    base::initLogging();
+
+    base::CommandLine::init(argc, argv);
+    base::CommandLine* command_line = base::CommandLine::forCurrentProcess();
+
+    if (command_line->hasSwitch(u"help"))
+    {
+        showHelp();
+        return 0;
+    }
+
+    unsigned int total_size = kDefaultTotalSize;
+    unsigned int block_size = 0;
+
+    if (!readSwitch(*command_line, u"total-size", 1, kMaxTotalSize, &total_size) ||
+        !readSwitch(*command_line, u"block-size", 1, kMaxBlockSize, &block_size))
+    {
+        showHelp();
+        return 1;
+    }
+
+    std::vector<size_t> block_sizes;
+    if (block_size)
+        block_sizes.emplace_back(block_size);
+    else
+        block_sizes.assign(std::begin(kDefaultBlockSizes), std::end(kDefaultBlockSizes));
+
+    std::unique_ptr<base::ScopedCryptoInitializer> crypto_initializer =
+        std::make_unique<base::ScopedCryptoInitializer>();
+
+    const std::vector<Algorithm> algorithms =
+    {
+        { "crc32", [](const uint8_t* data, size_t size) { return base::crc32(0, data, size); } },
+        { "crc32c", [](const uint8_t* data, size_t size) { return base::crc32c(0, data, size); } },
+        { "fast_hash64", [](const uint8_t* data, size_t size)
+            { return base::fastHash64(data, size); } },
+        { "sha256", [](const uint8_t* data, size_t size)
+            { return genericHash(base::GenericHash::SHA256, data, size); } },
+        { "blake2b512", [](const uint8_t* data, size_t size)
+            { return genericHash(base::GenericHash::BLAKE2b512, data, size); } }
+    };
+
+    // The buffer is larger than the caches of the processor for large blocks, so that the memory
+    // bandwidth is included in the result, as it is for real frames and files.
+    std::mt19937 random(42);
+    uint64_t checksum = 0;
+
+    std::cout << std::setw(12) << "block" << std::setw(14) << "algorithm" << std::setw(14)
+              << "MB/s" << std::endl;
+
+    for (size_t size : block_sizes)
+    {
+        std::vector<uint8_t> buffer(std::max(size * 16, size_t(32 * 1024 * 1024)) / size * size);
+        for (uint8_t& value : buffer)
+            value = static_cast<uint8_t>(random());
+
+        for (const Algorithm& algorithm : algorithms)
+        {
+            const double throughput = measure(algorithm, buffer, size,
+                                              size_t(total_size) * 1024 * 1024, &checksum);
+
+            std::cout << std::setw(12) << size << std::setw(14) << algorithm.name
+                      << std::setw(14) << std::fixed << std::setprecision(1) << throughput
+                      << std::endl;
+        }
+    }
+
+    // The checksum keeps the compiler from removing the calculations.
+    LOG(LS_INFO) << "Checksum: " << checksum;
+
+    crypto_initializer.reset();
+
+    base::shutdownLogging();
+    return 0;
+}
@@ -21,6 +21,8 @@
 #include "base/location.h"
 #include "base/logging.h"
 #include "base/ipc/ipc_channel_proxy.h"
+#include "base/ipc/shared_memory.h"
+#include "base/memory/byte_array_pool.h"
 #include "base/message_loop/message_loop.h"
 #include "base/message_loop/message_pump_asio.h"
 #include "base/strings/unicode.h"
@@ -28,6 +30,8 @@
 #include <asio/read.hpp>
 #include <asio/write.hpp>
 
+#include <array>
+#include <cstring>
 #include <functional>
 
 #if defined(OS_WIN)
@@ -41,6 +45,24 @@ namespace {
 
 const uint32_t kMaxMessageSize = 16 * 1024 * 1024; // 16MB
 
+// The high bits of the message size describe the message. A shared message contains
+// SharedMessage, a release message contains the ID of a shared message that the peer has read.
+const uint32_t kSharedMessageFlag = 0x80000000;
+const uint32_t kReleaseMessageFlag = 0x40000000;
+const uint32_t kMessageSizeMask = 0x3FFFFFFF;
+
+// Smaller messages are cheaper to write to the channel than to copy to a new shared memory.
+const size_t kSharedMessageThreshold = 64 * 1024; // 64kB
+
+// If the peer does not read the messages, they are written to the channel.
+const size_t kMaxSharedMessages = 16;
+
+struct SharedMessage
+{
+    int32_t id;
+    uint32_t size;
+};
+
 #if defined(OS_WIN)
 
 const char16_t kPipeNamePrefix[] = u"\\\\.\\pipe\\aspia.";
@@ -134,6 +156,8 @@ IpcChannel::~IpcChannel()
     listener_ = nullptr;
 
     disconnect();
+
+    ByteArrayPool::recycle(std::move(read_buffer_));
 }
 
 std::shared_ptr<IpcChannelProxy> IpcChannel::channelProxy()
@@ -259,7 +283,7 @@ void IpcChannel::send(ByteArray&& buffer)
 {
     DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
 
-    const bool schedule_write = write_queue_.empty();
+    const bool schedule_write = !is_writing_;
 
     // Add the buffer to the queue for sending.
     write_queue_.emplace(std::move(buffer));
@@ -268,6 +292,14 @@ void IpcChannel::send(ByteArray&& buffer)
         doWrite();
 }
 
+void IpcChannel::setSharedMemoryEnabled(bool enable)
+{
+    DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+
+    LOG(LS_INFO) << "Shared memory for large messages: " << enable;
+    is_shared_memory_enabled_ = enable;
+}
+
 std::filesystem::path IpcChannel::peerFilePath() const
 {
 #if defined(OS_WIN)
@@ -332,7 +364,38 @@ void IpcChannel::onErrorOccurred(const Location& location, const std::error_code
 
 void IpcChannel::doWrite()
 {
-    write_size_ = static_cast<uint32_t>(write_queue_.front().size());
+    is_writing_ = true;
+
+    if (!release_queue_.empty())
+    {
+        // The peer waits for the release of its shared memory, so it is sent first.
+        write_release_id_ = release_queue_.front();
+        write_size_ = static_cast<uint32_t>(sizeof(write_release_id_)) | kReleaseMessageFlag;
+
+        const std::array<asio::const_buffer, 2> buffers =
+        {
+            asio::buffer(&write_size_, sizeof(write_size_)),
+            asio::buffer(&write_release_id_, sizeof(write_release_id_))
+        };
+
+        asio::async_write(stream_, buffers,
+            [this](const std::error_code& error_code, size_t /* bytes_transferred */)
+        {
+            if (error_code)
+            {
+                onErrorOccurred(FROM_HERE, error_code);
+                return;
+            }
+
+            release_queue_.pop();
+            doNextWrite();
+        });
+        return;
+    }
+
+    ByteArray& message = write_queue_.front();
+
+    write_size_ = static_cast<uint32_t>(message.size());
 
     if (!write_size_ || write_size_ > kMaxMessageSize)
     {
@@ -340,6 +403,9 @@ void IpcChannel::doWrite()
         return;
     }
 
+    if (writeToSharedMemory(&message))
+        write_size_ = static_cast<uint32_t>(message.size()) | kSharedMessageFlag;
+
     asio::async_write(stream_, asio::buffer(&write_size_, sizeof(write_size_)),
         [this](const std::error_code& error_code, size_t bytes_transferred)
     {
@@ -364,21 +430,65 @@ void IpcChannel::doWrite()
                 return;
             }
 
-            DCHECK_EQ(bytes_transferred, write_size_);
+            DCHECK_EQ(bytes_transferred, write_size_ & kMessageSizeMask);
             DCHECK(!write_queue_.empty());
 
             // Delete the sent message from the queue.
+            ByteArrayPool::recycle(std::move(write_queue_.front()));
             write_queue_.pop();
 
-            // If the queue is not empty, then we send the following message.
-            if (write_queue_.empty() && !proxy_->reloadWriteQueue(&write_queue_))
-                return;
-
-            doWrite();
+            doNextWrite();
         });
     });
 }
 
+void IpcChannel::doNextWrite()
+{
+    if (write_queue_.empty())
+        proxy_->reloadWriteQueue(&write_queue_);
+
+    // If the queues are not empty, then we send the following message.
+    if (write_queue_.empty() && release_queue_.empty())
+    {
+        is_writing_ = false;
+        return;
+    }
+
+    doWrite();
+}
+
+bool IpcChannel::writeToSharedMemory(ByteArray* buffer)
+{
+    if (!is_shared_memory_enabled_ || buffer->size() < kSharedMessageThreshold ||
+        shared_messages_.size() >= kMaxSharedMessages)
+    {
+        return false;
+    }
+
+    std::unique_ptr<SharedMemory> shared_memory =
+        SharedMemory::create(SharedMemory::Mode::READ_WRITE, buffer->size());
+    if (!shared_memory)
+    {
+        LOG(LS_WARNING) << "Unable to create shared memory. Large messages are written to the "
+                        << "channel '" << channel_name_ << "'";
+        is_shared_memory_enabled_ = false;
+        return false;
+    }
+
+    memcpy(shared_memory->data(), buffer->data(), buffer->size());
+
+    SharedMessage message;
+    message.id = shared_memory->id();
+    message.size = static_cast<uint32_t>(buffer->size());
+
+    // The capacity is kept, so the buffer is still reused by the pool.
+    buffer->resize(sizeof(message));
+    memcpy(buffer->data(), &message, sizeof(message));
+
+    shared_messages_.emplace(message.id, std::move(shared_memory));
+    return true;
+}
+
 void IpcChannel::doReadMessage()
 {
     asio::async_read(stream_, asio::buffer(&read_size_, sizeof(read_size_)),
@@ -392,7 +502,23 @@ void IpcChannel::doReadMessage()
 
         DCHECK_EQ(bytes_transferred, sizeof(read_size_));
 
-        if (!read_size_ || read_size_ > kMaxMessageSize)
+        if (read_size_ & kReleaseMessageFlag)
+        {
+            if ((read_size_ & kMessageSizeMask) != sizeof(read_release_id_))
+            {
+                onErrorOccurred(FROM_HERE, asio::error::message_size);
+                return;
+            }
+
+            doReadRelease();
+            return;
+        }
+
+        const bool is_shared_message = (read_size_ & kSharedMessageFlag) != 0;
+        read_size_ &= kMessageSizeMask;
+
+        if (!read_size_ || read_size_ > kMaxMessageSize ||
+            (is_shared_message && read_size_ != sizeof(SharedMessage)))
         {
             onErrorOccurred(FROM_HERE, asio::error::message_size);
             return;
@@ -400,14 +526,16 @@ void IpcChannel::doReadMessage()
 
         if (read_buffer_.capacity() < read_size_)
         {
-            read_buffer_.clear();
-            read_buffer_.reserve(read_size_);
+            ByteArrayPool::recycle(std::move(read_buffer_));
+            read_buffer_ = ByteArrayPool::take(read_size_);
+        }
+        else
+        {
+            read_buffer_.resize(read_size_);
         }
-
-        read_buffer_.resize(read_size_);
 
         asio::async_read(stream_, asio::buffer(read_buffer_.data(), read_buffer_.size()),
-            [this](const std::error_code& error_code, size_t bytes_transferred)
+            [this, is_shared_message](const std::error_code& error_code, size_t bytes_transferred)
         {
             if (error_code)
             {
@@ -417,6 +545,12 @@ void IpcChannel::doReadMessage()
 
             DCHECK_EQ(bytes_transferred, read_size_);
 
+            if (is_shared_message && !readFromSharedMemory())
+            {
+                onErrorOccurred(FROM_HERE, asio::error::invalid_argument);
+                return;
+            }
+
             if (is_paused_)
                 return;
 
@@ -432,6 +566,73 @@ void IpcChannel::doReadMessage()
     });
 }
 
+void IpcChannel::doReadRelease()
+{
+    asio::async_read(stream_, asio::buffer(&read_release_id_, sizeof(read_release_id_)),
+        [this](const std::error_code& error_code, size_t /* bytes_transferred */)
+    {
+        if (error_code)
+        {
+            onErrorOccurred(FROM_HERE, error_code);
+            return;
+        }
+
+        shared_messages_.erase(read_release_id_);
+        read_size_ = 0;
+
+        doReadMessage();
+    });
+}
+
+bool IpcChannel::readFromSharedMemory()
+{
+    SharedMessage message;
+    memcpy(&message, read_buffer_.data(), sizeof(message));
+
+    if (!message.size || message.size > kMaxMessageSize)
+    {
+        LOG(LS_ERROR) << "Invalid size of shared message: " << message.size;
+        return false;
+    }
+
+    std::unique_ptr<SharedMemory> shared_memory =
+        SharedMemory::open(SharedMemory::Mode::READ_ONLY, message.id);
+    if (!shared_memory)
+    {
+        LOG(LS_ERROR) << "Unable to open shared message " << message.id;
+        return false;
+    }
+
+    // The size comes from the peer. It must not be trusted to read beyond the mapped memory.
+    if (message.size > shared_memory->size())
+    {
+        LOG(LS_ERROR) << "Shared message size " << message.size << " exceeds the memory size "
+                      << shared_memory->size();
+        return false;
+    }
+
+    // The listener gets the message in the usual buffer, and the peer can destroy the shared
+    // memory right after this copy.
+    if (read_buffer_.capacity() < message.size)
+    {
+        ByteArrayPool::recycle(std::move(read_buffer_));
+        read_buffer_ = ByteArrayPool::take(message.size);
+    }
+    else
+    {
+        read_buffer_.resize(message.size);
+    }
+
+    memcpy(read_buffer_.data(), shared_memory->data(), message.size);
+    read_size_ = message.size;
+
+    release_queue_.push(message.id);
+    if (!is_writing_)
+        doWrite();
+
+    return true;
+}
+
 void IpcChannel::onMessageReceived()
 {
     if (listener_)
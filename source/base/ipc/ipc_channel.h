@@ -31,6 +31,7 @@
 #endif
 
 #include <filesystem>
+#include <map>
 #include <queue>
 
 namespace base {
@@ -38,6 +39,7 @@ namespace base {
 class IpcChannelProxy;
 class IpcServer;
 class Location;
+class SharedMemory;
 
 class IpcChannel
 {
@@ -73,6 +75,11 @@ public:
 
     void send(ByteArray&& buffer);
 
+    // Large messages are passed in shared memory and only its ID is written to the channel. The
+    // peer must be able to open the shared memory of this process. Receiving such messages is
+    // always supported.
+    void setSharedMemoryEnabled(bool enable);
+
     ProcessId peerProcessId() const { return peer_process_id_; }
     SessionId peerSessionId() const { return peer_session_id_; }
     std::filesystem::path peerFilePath() const;
@@ -92,7 +99,11 @@ private:
 
     void onErrorOccurred(const Location& location, const std::error_code& error_code);
     void doWrite();
+    void doNextWrite();
+    bool writeToSharedMemory(ByteArray* buffer);
     void doReadMessage();
+    void doReadRelease();
+    bool readFromSharedMemory();
     void onMessageReceived();
 
     std::u16string channel_name_;
@@ -106,10 +117,20 @@ private:
 
     std::queue<ByteArray> write_queue_;
     uint32_t write_size_ = 0;
+    bool is_writing_ = false;
 
     uint32_t read_size_ = 0;
     ByteArray read_buffer_;
 
+    // Shared memory of the sent messages. It is destroyed when the peer has read the message.
+    bool is_shared_memory_enabled_ = false;
+    std::map<int, std::unique_ptr<SharedMemory>> shared_messages_;
+
+    // IDs of the received shared messages that the peer can destroy.
+    std::queue<int> release_queue_;
+    int write_release_id_ = -1;
+    int read_release_id_ = -1;
+
     ProcessId peer_process_id_ = kNullProcessId;
     SessionId peer_session_id_ = kInvalidSessionId;
 
@@ -54,7 +54,7 @@ void IpcChannelProxy::willDestroyCurrentChannel()
 
 void IpcChannelProxy::scheduleWrite()
 {
-    if (!channel_)
+    if (!channel_ || channel_->is_writing_)
         return;
 
     if (!reloadWriteQueue(&channel_->write_queue_))
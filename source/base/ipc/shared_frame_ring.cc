@@ -0,0 +1,120 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/ipc/shared_frame_ring.h"
+
+#include "base/logging.h"
+#include "base/ipc/shared_memory.h"
+
+#include <atomic>
+
+namespace base {
+
+// The header is accessed from two processes, so only lock-free atomics may be used.
+struct SharedFrameRing::Header
+{
+    std::atomic<uint32_t> produced;
+    std::atomic<uint32_t> consumed;
+    std::atomic<uint32_t> waiting;
+    std::atomic<uint32_t> update_interval; // In milliseconds.
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+SharedFrameRing::SharedFrameRing(std::unique_ptr<SharedMemory> shared_memory)
+    : shared_memory_(std::move(shared_memory)),
+      header_(reinterpret_cast<Header*>(shared_memory_->data()))
+{
+    DCHECK(header_);
+}
+
+SharedFrameRing::~SharedFrameRing() = default;
+
+// static
+std::unique_ptr<SharedFrameRing> SharedFrameRing::create()
+{
+    std::unique_ptr<SharedMemory> shared_memory =
+        SharedMemory::create(SharedMemory::Mode::READ_WRITE, sizeof(Header));
+    if (!shared_memory)
+    {
+        LOG(LS_WARNING) << "Unable to create shared memory for frame ring";
+        return nullptr;
+    }
+
+    // The memory is zeroed at creation, so the ring is empty.
+    return std::unique_ptr<SharedFrameRing>(new SharedFrameRing(std::move(shared_memory)));
+}
+
+// static
+std::unique_ptr<SharedFrameRing> SharedFrameRing::open(int id)
+{
+    std::unique_ptr<SharedMemory> shared_memory =
+        SharedMemory::open(SharedMemory::Mode::READ_WRITE, id);
+    if (!shared_memory)
+    {
+        LOG(LS_WARNING) << "Unable to open shared memory for frame ring: " << id;
+        return nullptr;
+    }
+
+    return std::unique_ptr<SharedFrameRing>(new SharedFrameRing(std::move(shared_memory)));
+}
+
+int SharedFrameRing::id() const
+{
+    return shared_memory_->id();
+}
+
+void SharedFrameRing::push()
+{
+    header_->produced.fetch_add(1);
+}
+
+void SharedFrameRing::setWaiting(bool waiting)
+{
+    header_->waiting.store(waiting ? 1 : 0);
+}
+
+bool SharedFrameRing::pop()
+{
+    if (!pendingCount())
+    {
+        LOG(LS_WARNING) << "No frames in the ring";
+        return false;
+    }
+
+    header_->consumed.fetch_add(1);
+    return header_->waiting.exchange(0) != 0;
+}
+
+void SharedFrameRing::setUpdateInterval(const std::chrono::milliseconds& interval)
+{
+    header_->update_interval.store(static_cast<uint32_t>(interval.count()));
+}
+
+std::chrono::milliseconds SharedFrameRing::updateInterval() const
+{
+    return std::chrono::milliseconds(header_->update_interval.load());
+}
+
+uint32_t SharedFrameRing::pendingCount() const
+{
+    // Unsigned arithmetic handles the wrap-around of the counters.
+    return header_->produced.load() - header_->consumed.load();
+}
+
+} // namespace base
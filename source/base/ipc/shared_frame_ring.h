@@ -0,0 +1,85 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_IPC_SHARED_FRAME_RING_H
+#define BASE_IPC_SHARED_FRAME_RING_H
+
+#include "base/macros_magic.h"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+namespace base {
+
+class SharedMemory;
+
+// Producer and consumer indices of the frame ring between the desktop agent and the service.
+// The indices are stored in a shared memory block, so the producer can check that a frame buffer
+// is released without an IPC round trip. The ring itself consists of the frame buffers of the
+// screen capturer, this class only counts frames in it.
+//
+// If the buffer for the next frame is still in use, the producer sets the waiting flag and the
+// consumer wakes it up (via IPC) after releasing the next frame.
+class SharedFrameRing
+{
+public:
+    ~SharedFrameRing();
+
+    // Creates a new ring (producer side).
+    static std::unique_ptr<SharedFrameRing> create();
+
+    // Opens an existing ring (consumer side).
+    static std::unique_ptr<SharedFrameRing> open(int id);
+
+    int id() const;
+
+    // Producer side. Marks the next frame as sent to the consumer. Must be called before the frame
+    // is sent, otherwise the consumer can release it before it is counted.
+    void push();
+
+    // Producer side. After setting the flag, the producer must check pendingCount() once more,
+    // because the consumer could release a frame before it saw the flag.
+    void setWaiting(bool waiting);
+
+    // Consumer side. Releases the oldest frame. Returns true if the producer is waiting for a free
+    // slot and must be woken up.
+    bool pop();
+
+    // The consumer sets the desired interval between frames, the producer reads it before
+    // scheduling the next capture.
+    void setUpdateInterval(const std::chrono::milliseconds& interval);
+    std::chrono::milliseconds updateInterval() const;
+
+    // Number of frames sent but not yet released.
+    uint32_t pendingCount() const;
+
+private:
+    struct Header;
+
+    explicit SharedFrameRing(std::unique_ptr<SharedMemory> shared_memory);
+
+    std::unique_ptr<SharedMemory> shared_memory_;
+    Header* header_;
+
+    DISALLOW_COPY_AND_ASSIGN(SharedFrameRing);
+};
+
+} // namespace base
+
+#endif // BASE_IPC_SHARED_FRAME_RING_H
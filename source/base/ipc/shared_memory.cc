@@ -150,7 +150,7 @@ bool openFileMapping(SharedMemory::Mode mode, int id, win::ScopedHandle* out)
     return true;
 }
 
-bool mapViewOfFile(SharedMemory::Mode mode, HANDLE file, void** memory)
+bool mapViewOfFile(SharedMemory::Mode mode, HANDLE file, void** memory, size_t* size)
 {
     DWORD desired_access;
     if (!modeToDesiredAccess(mode, &desired_access))
@@ -163,6 +163,17 @@ bool mapViewOfFile(SharedMemory::Mode mode, HANDLE file, void** memory)
         return false;
     }
 
+    // The view maps the whole section. Its size is not known to the side which opens the memory.
+    MEMORY_BASIC_INFORMATION info;
+    if (!VirtualQuery(*memory, &info, sizeof(info)))
+    {
+        PLOG(LS_WARNING) << "VirtualQuery failed";
+        UnmapViewOfFile(*memory);
+        *memory = nullptr;
+        return false;
+    }
+
+    *size = info.RegionSize;
     return true;
 }
 
@@ -179,10 +190,12 @@ const SharedMemory::PlatformHandle kInvalidHandle = -1;
 SharedMemory::SharedMemory(int id,
                            ScopedPlatformHandle&& handle,
                            void* data,
+                           size_t size,
                            base::local_shared_ptr<SharedMemoryFactoryProxy> factory_proxy)
     : factory_proxy_(std::move(factory_proxy)),
       handle_(std::move(handle)),
       data_(data),
+      size_(size),
       id_(id)
 {
     if (factory_proxy_)
@@ -220,13 +233,14 @@ std::unique_ptr<SharedMemory> SharedMemory::create(
         return nullptr;
 
     void* memory = nullptr;
-    if (!mapViewOfFile(mode, file, &memory))
+    size_t mapped_size = 0;
+    if (!mapViewOfFile(mode, file, &memory, &mapped_size))
         return nullptr;
 
     memset(memory, 0, size);
 
     return std::unique_ptr<SharedMemory>(
-        new SharedMemory(id, std::move(file), memory, std::move(factory_proxy)));
+        new SharedMemory(id, std::move(file), memory, size, std::move(factory_proxy)));
 #else
     NOTIMPLEMENTED();
     return nullptr;
@@ -243,11 +257,12 @@ std::unique_ptr<SharedMemory> SharedMemory::open(
         return nullptr;
 
     void* memory = nullptr;
-    if (!mapViewOfFile(mode, file, &memory))
+    size_t size = 0;
+    if (!mapViewOfFile(mode, file, &memory, &size))
         return nullptr;
 
     return std::unique_ptr<SharedMemory>(
-        new SharedMemory(id, std::move(file), memory, std::move(factory_proxy)));
+        new SharedMemory(id, std::move(file), memory, size, std::move(factory_proxy)));
 #else
     NOTIMPLEMENTED();
     return nullptr;
@@ -96,15 +96,21 @@ public:
     PlatformHandle handle() const override { return handle_.get(); }
     int id() const override { return id_; }
 
+    // Number of bytes that can be accessed at data(). For the opened memory it is the size of the
+    // mapped view, which is rounded up to the page size.
+    size_t size() const { return size_; }
+
 private:
     SharedMemory(int id,
                  ScopedPlatformHandle&& handle,
                  void* data,
+                 size_t size,
                  base::local_shared_ptr<SharedMemoryFactoryProxy> factory_proxy);
 
     base::local_shared_ptr<SharedMemoryFactoryProxy> factory_proxy_;
     ScopedPlatformHandle handle_;
     void* data_;
+    size_t size_;
     int id_;
 
     DISALLOW_COPY_AND_ASSIGN(SharedMemory);
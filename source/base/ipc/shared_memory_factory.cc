@@ -15,14 +15,60 @@
 // You should have received a copy of the GNU General Public License
 // along with this program. If not, see <https://www.gnu.org/licenses/>.
 //
-
 #include "base/ipc/shared_memory_factory.h"
 
+#include "base/logging.h"
 #include "base/ipc/shared_memory.h"
 #include "base/ipc/shared_memory_factory_proxy.h"
 
+#include <algorithm>
+
 namespace base {
 
+namespace {
+
+// A frame buffer is placed into a pooled memory only if the memory is at most twice as large, so
+// the buffers of a lower resolution do not hold the memory of a higher one.
+constexpr size_t kMaxCapacityRatio = 2;
+
+// The pool holds the buffers of a few capturers. The memory that is not reused for a long time
+// belongs to a mode that is not used anymore.
+constexpr size_t kMaxPoolSize = 8;
+constexpr std::chrono::seconds kMaxUnusedTime { 30 };
+
+class PooledMemory : public SharedMemoryBase
+{
+public:
+    PooledMemory(std::unique_ptr<SharedMemory> memory,
+                 size_t capacity,
+                 base::local_shared_ptr<SharedMemoryFactoryProxy> factory_proxy)
+        : memory_(std::move(memory)),
+          capacity_(capacity),
+          factory_proxy_(std::move(factory_proxy))
+    {
+        DCHECK(memory_);
+    }
+
+    ~PooledMemory() override
+    {
+        factory_proxy_->onSharedMemoryRelease(std::move(memory_), capacity_);
+    }
+
+    // SharedMemoryBase implementation.
+    void* data() override { return memory_->data(); }
+    PlatformHandle handle() const override { return memory_->handle(); }
+    int id() const override { return memory_->id(); }
+
+private:
+    std::unique_ptr<SharedMemory> memory_;
+    const size_t capacity_;
+    base::local_shared_ptr<SharedMemoryFactoryProxy> factory_proxy_;
+
+    DISALLOW_COPY_AND_ASSIGN(PooledMemory);
+};
+
+} // namespace
+
 SharedMemoryFactory::SharedMemoryFactory(Delegate* delegate)
     : factory_proxy_(base::make_local_shared<SharedMemoryFactoryProxy>(this)),
       delegate_(delegate)
@@ -45,6 +91,46 @@ std::unique_ptr<SharedMemory> SharedMemoryFactory::open(int id)
     return SharedMemory::open(SharedMemory::Mode::READ_ONLY, id, factory_proxy_);
 }
 
+std::unique_ptr<SharedMemoryBase> SharedMemoryFactory::acquire(size_t size)
+{
+    trimPool();
+
+    // The smallest memory that fits.
+    auto best = pool_.end();
+    for (auto it = pool_.begin(); it != pool_.end(); ++it)
+    {
+        if (it->capacity < size || it->capacity / kMaxCapacityRatio > size)
+            continue;
+
+        if (best == pool_.end() || it->capacity < best->capacity)
+            best = it;
+    }
+
+    if (best != pool_.end())
+    {
+        std::unique_ptr<SharedMemory> memory = std::move(best->memory);
+        const size_t capacity = best->capacity;
+        pool_.erase(best);
+
+        return std::make_unique<PooledMemory>(std::move(memory), capacity, factory_proxy_);
+    }
+
+    std::unique_ptr<SharedMemory> memory = create(size);
+    if (!memory)
+        return nullptr;
+
+    return std::make_unique<PooledMemory>(std::move(memory), size, factory_proxy_);
+}
+
+void SharedMemoryFactory::releaseUnused()
+{
+    if (pool_.empty())
+        return;
+
+    LOG(LS_INFO) << "Destroying " << pool_.size() << " unused shared memory";
+    pool_.clear();
+}
+
 void SharedMemoryFactory::onSharedMemoryCreate(int id)
 {
     delegate_->onSharedMemoryCreate(id);
@@ -55,4 +141,25 @@ void SharedMemoryFactory::onSharedMemoryDestroy(int id)
     delegate_->onSharedMemoryDestroy(id);
 }
 
+void SharedMemoryFactory::onSharedMemoryRelease(
+    std::unique_ptr<SharedMemory> memory, size_t capacity)
+{
+    pool_.push_back({ std::move(memory), capacity, Clock::now() });
+    trimPool();
+}
+
+void SharedMemoryFactory::trimPool()
+{
+    const Clock::time_point now = Clock::now();
+
+    pool_.erase(std::remove_if(pool_.begin(), pool_.end(), [now](const PoolEntry& entry)
+    {
+        return now - entry.release_time > kMaxUnusedTime;
+    }), pool_.end());
+
+    // The entries are in the order of release, so the oldest ones are destroyed first.
+    if (pool_.size() > kMaxPoolSize)
+        pool_.erase(pool_.begin(), pool_.begin() + (pool_.size() - kMaxPoolSize));
+}
+
 } // namespace base
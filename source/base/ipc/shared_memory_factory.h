@@ -22,11 +22,14 @@
 #include "base/macros_magic.h"
 #include "base/memory/local_memory.h"
 
+#include <chrono>
 #include <memory>
+#include <vector>
 
 namespace base {
 
 class SharedMemory;
+class SharedMemoryBase;
 class SharedMemoryFactoryProxy;
 
 class SharedMemoryFactory
@@ -55,13 +58,36 @@ public:
     // If any other error occurs, nullptr is returned.
     std::unique_ptr<SharedMemory> open(int id);
 
+    // Returns a shared memory of at least |size| bytes for a frame buffer. When the memory is
+    // destroyed it is kept in a pool and reused for the next frame buffer that fits into it, so
+    // the other side keeps its mapping and a mode switch does not create new memory for every
+    // buffer. If an error occurs, nullptr is returned.
+    std::unique_ptr<SharedMemoryBase> acquire(size_t size);
+
+    // Destroys the memory kept in the pool.
+    void releaseUnused();
+
 private:
     friend class SharedMemoryFactoryProxy;
     void onSharedMemoryCreate(int id);
     void onSharedMemoryDestroy(int id);
+    void onSharedMemoryRelease(std::unique_ptr<SharedMemory> memory, size_t capacity);
+
+    using Clock = std::chrono::steady_clock;
+
+    struct PoolEntry
+    {
+        std::unique_ptr<SharedMemory> memory;
+        size_t capacity;
+        Clock::time_point release_time;
+    };
+
+    // Destroys the memory that is not reused for a long time.
+    void trimPool();
 
     base::local_shared_ptr<SharedMemoryFactoryProxy> factory_proxy_;
     Delegate* delegate_;
+    std::vector<PoolEntry> pool_;
 
     DISALLOW_COPY_AND_ASSIGN(SharedMemoryFactory);
 };
@@ -0,0 +1,91 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/log_ring.h"
+
+namespace base {
+
+namespace {
+
+// Slots that held larger messages release their memory.
+const size_t kMaxSlotCapacity = 4096;
+
+size_t roundUpToPowerOfTwo(size_t value)
+{
+    size_t result = 1;
+    while (result < value)
+        result <<= 1;
+    return result;
+}
+
+} // namespace
+
+LogRing::LogRing(size_t capacity)
+    : slots_(roundUpToPowerOfTwo(capacity)),
+      mask_(slots_.size() - 1)
+{
+    // Nothing
+}
+
+LogRing::~LogRing() = default;
+
+bool LogRing::push(std::string&& message)
+{
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+
+    if (tail - head_.load(std::memory_order_acquire) >= slots_.size())
+    {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    slots_[tail & mask_] = std::move(message);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+size_t LogRing::popAll(std::string* out)
+{
+    const size_t head = head_.load(std::memory_order_relaxed);
+    const size_t tail = tail_.load(std::memory_order_acquire);
+
+    for (size_t i = head; i != tail; ++i)
+    {
+        std::string& slot = slots_[i & mask_];
+        out->append(slot);
+
+        if (slot.capacity() > kMaxSlotCapacity)
+            std::string().swap(slot);
+        else
+            slot.clear();
+    }
+
+    head_.store(tail, std::memory_order_release);
+    return tail - head;
+}
+
+uint64_t LogRing::takeDropped()
+{
+    return dropped_.exchange(0, std::memory_order_relaxed);
+}
+
+size_t LogRing::size() const
+{
+    return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+}
+
+} // namespace base
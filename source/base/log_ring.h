@@ -0,0 +1,64 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef BASE_LOG_RING_H
+#define BASE_LOG_RING_H
+
+#include "base/macros_magic.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace base {
+
+// Bounded queue of log messages with one producer thread and one consumer thread. The threads do
+// not wait for each other. If the queue is full, new messages are dropped and counted.
+class LogRing
+{
+public:
+    // |capacity| is rounded up to a power of two.
+    explicit LogRing(size_t capacity);
+    ~LogRing();
+
+    // Called by the producer. Returns false if the ring is full and the message was dropped.
+    bool push(std::string&& message);
+
+    // Called by the consumer. Appends all queued messages to |out| and returns their number.
+    size_t popAll(std::string* out);
+
+    // Called by the consumer. Returns the number of dropped messages since the previous call.
+    uint64_t takeDropped();
+
+    // Number of queued messages. It may change at any time.
+    size_t size() const;
+    size_t capacity() const { return slots_.size(); }
+
+private:
+    std::vector<std::string> slots_;
+    const size_t mask_;
+
+    std::atomic<size_t> head_ { 0 };
+    std::atomic<size_t> tail_ { 0 };
+    std::atomic<uint64_t> dropped_ { 0 };
+
+    DISALLOW_COPY_AND_ASSIGN(LogRing);
+};
+
+} // namespace base
+
+#endif // BASE_LOG_RING_H
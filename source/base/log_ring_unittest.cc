@@ -0,0 +1,127 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/log_ring.h"
+
+#include <thread>
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+TEST(LogRingTest, PushAndPop)
+{
+    LogRing ring(4);
+
+    EXPECT_TRUE(ring.push("first\n"));
+    EXPECT_TRUE(ring.push("second\n"));
+    EXPECT_EQ(ring.size(), 2u);
+
+    std::string out;
+    EXPECT_EQ(ring.popAll(&out), 2u);
+    EXPECT_EQ(out, "first\nsecond\n");
+    EXPECT_EQ(ring.size(), 0u);
+
+    out.clear();
+    EXPECT_EQ(ring.popAll(&out), 0u);
+    EXPECT_TRUE(out.empty());
+}
+
+TEST(LogRingTest, CapacityIsPowerOfTwo)
+{
+    EXPECT_EQ(LogRing(1).capacity(), 1u);
+    EXPECT_EQ(LogRing(5).capacity(), 8u);
+    EXPECT_EQ(LogRing(1024).capacity(), 1024u);
+}
+
+TEST(LogRingTest, DropsWhenFull)
+{
+    LogRing ring(2);
+
+    EXPECT_TRUE(ring.push("1"));
+    EXPECT_TRUE(ring.push("2"));
+    EXPECT_FALSE(ring.push("3"));
+    EXPECT_FALSE(ring.push("4"));
+
+    EXPECT_EQ(ring.takeDropped(), 2u);
+    EXPECT_EQ(ring.takeDropped(), 0u);
+
+    std::string out;
+    EXPECT_EQ(ring.popAll(&out), 2u);
+    EXPECT_EQ(out, "12");
+
+    // The space is available again.
+    EXPECT_TRUE(ring.push("5"));
+    out.clear();
+    EXPECT_EQ(ring.popAll(&out), 1u);
+    EXPECT_EQ(out, "5");
+}
+
+TEST(LogRingTest, WrapsAround)
+{
+    LogRing ring(4);
+    std::string expected;
+    std::string out;
+
+    for (int i = 0; i < 100; ++i)
+    {
+        const std::string message = std::to_string(i) + ";";
+        expected += message;
+
+        EXPECT_TRUE(ring.push(std::string(message)));
+
+        if (i % 3 == 2)
+            ring.popAll(&out);
+    }
+
+    ring.popAll(&out);
+    EXPECT_EQ(out, expected);
+    EXPECT_EQ(ring.takeDropped(), 0u);
+}
+
+TEST(LogRingTest, ProducerAndConsumerThreads)
+{
+    static const int kMessageCount = 100000;
+
+    LogRing ring(64);
+    std::atomic_bool finished = false;
+    size_t received = 0;
+    uint64_t dropped = 0;
+    std::string out;
+
+    std::thread producer([&]()
+    {
+        for (int i = 0; i < kMessageCount; ++i)
+            ring.push("x");
+
+        finished = true;
+    });
+
+    while (!finished)
+        received += ring.popAll(&out);
+
+    producer.join();
+
+    received += ring.popAll(&out);
+    dropped += ring.takeDropped();
+
+    // Each message is either received once or counted as dropped.
+    EXPECT_EQ(out.size(), received);
+    EXPECT_EQ(received + dropped, static_cast<uint64_t>(kMessageCount));
+}
+
+} // namespace base
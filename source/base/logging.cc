@@ -21,10 +21,12 @@
 #include "base/debug.h"
 #include "base/endian_util.h"
 #include "base/environment.h"
+#include "base/log_ring.h"
 #include "base/system_time.h"
 #include "base/strings/string_number_conversions.h"
 #include "base/strings/unicode.h"
 
+#include <condition_variable>
 #include <fstream>
 #include <iomanip>
 #include <mutex>
@@ -48,6 +50,8 @@
 
 namespace base {
 
+std::string logFilePrefix();
+
 namespace {
 
 const size_t kDefaultMaxLogFileSize = 2 * 1024 * 1024; // 2 Mb.
@@ -65,6 +69,22 @@ std::filesystem::path g_log_file_path;
 std::ofstream g_log_file;
 std::mutex g_log_file_lock;
 
+// Size of the queue of each thread and the interval of the writes in the async mode.
+const size_t kLogRingCapacity = 4096;
+const std::chrono::milliseconds kFlushInterval { 100 };
+
+std::atomic_bool g_async_logging = false;
+
+// The rings of the threads that have logged. A ring is removed when its thread has finished and the
+// messages are written.
+std::mutex g_log_rings_lock;
+std::vector<std::shared_ptr<LogRing>> g_log_rings;
+
+std::thread g_flush_thread;
+std::mutex g_flush_lock;
+std::condition_variable g_flush_condition;
+bool g_flush_stop = false;
+
 const char* severityName(LoggingSeverity severity)
 {
     static const char* const kLogSeverityNames[] = { "I", "W", "E", "F" };
@@ -170,6 +190,121 @@ bool initLoggingUnlocked(const std::string& prefix)
     return true;
 }
 
+void writeToFileUnlocked(const std::string& data)
+{
+    if (g_log_file.tellp() >= g_max_log_file_size)
+    {
+        // The maximum size of the log file has been exceeded. Close the current log file and
+        // create a new one.
+        initLoggingUnlocked(logFilePrefix());
+    }
+
+    g_log_file.write(data.c_str(), data.size());
+    g_log_file.flush();
+}
+
+// Writes the queued messages of all threads with one write.
+void writeQueuedMessages()
+{
+    std::string batch;
+    uint64_t dropped = 0;
+
+    {
+        std::scoped_lock lock(g_log_rings_lock);
+
+        for (auto it = g_log_rings.begin(); it != g_log_rings.end();)
+        {
+            LogRing* ring = it->get();
+
+            ring->popAll(&batch);
+            dropped += ring->takeDropped();
+
+            // Only the list owns the ring of a finished thread.
+            if (it->use_count() == 1 && !ring->size())
+                it = g_log_rings.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    if (dropped)
+        batch += "Log messages dropped: " + std::to_string(dropped) + '\n';
+
+    if (batch.empty())
+        return;
+
+    std::scoped_lock lock(g_log_file_lock);
+    writeToFileUnlocked(batch);
+}
+
+void queueMessage(std::string&& message)
+{
+    thread_local std::shared_ptr<LogRing> ring;
+
+    if (!ring)
+    {
+        ring = std::make_shared<LogRing>(kLogRingCapacity);
+
+        std::scoped_lock lock(g_log_rings_lock);
+        g_log_rings.emplace_back(ring);
+    }
+
+    // A full ring drops the message. It is counted there.
+    ring->push(std::move(message));
+
+    if (ring->size() >= ring->capacity() / 2)
+        g_flush_condition.notify_one();
+}
+
+void flushThreadMain()
+{
+    std::unique_lock lock(g_flush_lock);
+
+    while (!g_flush_stop)
+    {
+        g_flush_condition.wait_for(lock, kFlushInterval);
+
+        lock.unlock();
+        writeQueuedMessages();
+        lock.lock();
+    }
+}
+
+void startAsyncLogging()
+{
+    if (g_flush_thread.joinable())
+        return;
+
+    g_flush_stop = false;
+    g_flush_thread = std::thread(flushThreadMain);
+    g_async_logging = true;
+}
+
+void stopAsyncLogging()
+{
+    if (!g_flush_thread.joinable())
+        return;
+
+    g_async_logging = false;
+
+    {
+        std::scoped_lock lock(g_flush_lock);
+        g_flush_stop = true;
+    }
+
+    g_flush_condition.notify_one();
+    g_flush_thread.join();
+
+    writeQueuedMessages();
+}
+
+// Stops the thread if the application exits without shutdownLogging().
+class AsyncLoggingStopper
+{
+public:
+    ~AsyncLoggingStopper() { stopAsyncLogging(); }
+} g_async_logging_stopper;
+
 } // namespace
 
 // This is never instantiated, it's just used for EAT_STREAM_PARAMETERS to have
@@ -180,7 +315,8 @@ std::ostream* g_swallow_stream;
 LoggingSettings::LoggingSettings()
     : min_log_level(LOG_LS_WARNING),
       max_log_file_size(kDefaultMaxLogFileSize),
-      max_log_file_age(kDefaultMaxLogFileAge)
+      max_log_file_age(kDefaultMaxLogFileAge),
+      async(true)
 {
     std::string log_level_string;
     if (Environment::get("ASPIA_LOG_LEVEL", &log_level_string))
@@ -250,6 +386,14 @@ LoggingSettings::LoggingSettings()
             max_log_file_age = static_cast<size_t>(std::min(value, 366ULL));
         }
     }
+
+    std::string async_string;
+    if (Environment::get("ASPIA_LOG_ASYNC", &async_string))
+    {
+        int value;
+        if (stringToInt(async_string, &value))
+            async = value != 0;
+    }
 }
 
 std::filesystem::path execFilePath()
@@ -299,6 +443,9 @@ bool initLogging(const LoggingSettings& settings)
             return false;
     }
 
+    if (settings.async && (g_logging_destination & LOG_TO_FILE))
+        startAsyncLogging();
+
     LOG(LS_INFO) << "Executable file: " << execFilePath();
     if (g_logging_destination & LOG_TO_FILE)
     {
@@ -323,6 +470,8 @@ void shutdownLogging()
 {
     LOG(LS_INFO) << "Logging finished";
 
+    stopAsyncLogging();
+
     std::scoped_lock lock(g_log_file_lock);
     g_log_file.close();
 }
@@ -447,17 +596,19 @@ LogMessage::~LogMessage()
     // Write to log file.
     if ((g_logging_destination & LOG_TO_FILE) != 0)
     {
-        std::scoped_lock lock(g_log_file_lock);
-
-        if (g_log_file.tellp() >= g_max_log_file_size)
+        if (severity_ != LOG_LS_FATAL && g_async_logging.load(std::memory_order_acquire))
         {
-            // The maximum size of the log file has been exceeded. Close the current log file and
-            // create a new one.
-            initLoggingUnlocked(logFilePrefix());
+            queueMessage(std::move(message));
         }
+        else
+        {
+            // The messages queued before have to be in the file before the crash.
+            if (severity_ == LOG_LS_FATAL)
+                writeQueuedMessages();
 
-        g_log_file.write(message.c_str(), message.size());
-        g_log_file.flush();
+            std::scoped_lock lock(g_log_file_lock);
+            writeToFileUnlocked(message);
+        }
     }
 
     if (severity_ == LOG_LS_FATAL)
@@ -123,6 +123,7 @@ struct LoggingSettings
     //  min_log_level: LOG_LS_INFO
     //  max_log_file_size: 2 Mb
     //  max_log_file_age: 14 days
+    //  async: true
     LoggingSettings();
 
     LoggingDestination destination;
@@ -132,6 +133,12 @@ struct LoggingSettings
 
     size_t max_log_file_size;
     size_t max_log_file_age;
+
+    // If true, the messages are written to the file by a separate thread. Each thread queues its
+    // messages without locks. If a thread logs faster than they are written, its new messages are
+    // dropped and the number of dropped messages is written to the file. Fatal messages are always
+    // written at once.
+    bool async;
 };
 
 // Sets the log file name and other global logging state. Calling this function is recommended,
@@ -139,7 +146,7 @@ struct LoggingSettings
 // See the definition of the enums above for descriptions and default values.
 bool initLogging(const LoggingSettings& settings = LoggingSettings());
 
-// Closes the log file explicitly if open.
+// Closes the log file explicitly if open. The queued messages are written before.
 // NOTE: Since the log file is opened as necessary by the action of logging statements, there's no
 //       guarantee that it will stay closed after this call.
 void shutdownLogging();
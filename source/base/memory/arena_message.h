@@ -0,0 +1,82 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef BASE_MEMORY_ARENA_MESSAGE_H
+#define BASE_MEMORY_ARENA_MESSAGE_H
+
+#include "base/macros_magic.h"
+
+#include <memory>
+
+#include <google/protobuf/arena.h>
+
+namespace base {
+
+// Protobuf message that is reused for each parsed or built message of a hot path. Clear() of a
+// message on the heap deletes its sub-messages, repeated fields and strings, so they are
+// allocated again for the next message. Here the message lives in an arena, and clear() resets the
+// arena and creates an empty message in the same memory. The memory of the arena is retained, so
+// a steady stream of messages does not allocate memory.
+// The sub-messages must not be kept after clear(). release_*() methods return copies.
+template <class T>
+class ArenaMessage
+{
+public:
+    static const size_t kDefaultBlockSize = 16 * 1024;
+
+    explicit ArenaMessage(size_t block_size = kDefaultBlockSize)
+        : block_(std::make_unique<char[]>(block_size)),
+          arena_(arenaOptions(block_.get(), block_size)),
+          message_(google::protobuf::Arena::CreateMessage<T>(&arena_))
+    {
+        // Nothing
+    }
+
+    ~ArenaMessage() = default;
+
+    // Destroys the current message and returns a new empty one.
+    T* clear()
+    {
+        arena_.Reset();
+        message_ = google::protobuf::Arena::CreateMessage<T>(&arena_);
+        return message_;
+    }
+
+    T* get() const { return message_; }
+    T* operator->() const { return message_; }
+    T& operator*() const { return *message_; }
+
+private:
+    static google::protobuf::ArenaOptions arenaOptions(char* block, size_t block_size)
+    {
+        // The first block is not freed by the reset.
+        google::protobuf::ArenaOptions options;
+        options.initial_block = block;
+        options.initial_block_size = block_size;
+        return options;
+    }
+
+    std::unique_ptr<char[]> block_;
+    google::protobuf::Arena arena_;
+    T* message_;
+
+    DISALLOW_COPY_AND_ASSIGN(ArenaMessage);
+};
+
+} // namespace base
+
+#endif // BASE_MEMORY_ARENA_MESSAGE_H
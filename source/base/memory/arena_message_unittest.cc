@@ -0,0 +1,84 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/memory/arena_message.h"
+
+#include "base/memory/byte_array.h"
+#include "proto/desktop.pb.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+TEST(ArenaMessageTest, ParseAndClear)
+{
+    proto::VideoPacket source;
+    source.set_data("frame data");
+
+    for (int i = 0; i < 100; ++i)
+    {
+        proto::Rect* rect = source.add_dirty_rect();
+        rect->set_x(i);
+        rect->set_width(i + 1);
+    }
+
+    const ByteArray buffer = serialize(source);
+
+    ArenaMessage<proto::VideoPacket> message;
+    EXPECT_NE(message.get()->GetArena(), nullptr);
+
+    for (int i = 0; i < 10; ++i)
+    {
+        message.clear();
+        EXPECT_EQ(message->dirty_rect_size(), 0);
+
+        ASSERT_TRUE(parse(buffer, message.get()));
+        EXPECT_EQ(message->data(), "frame data");
+        ASSERT_EQ(message->dirty_rect_size(), 100);
+        EXPECT_EQ(message->dirty_rect(99).width(), 100);
+    }
+}
+
+TEST(ArenaMessageTest, LargerThanBlock)
+{
+    ArenaMessage<proto::VideoPacket> message(256);
+
+    for (int i = 0; i < 3; ++i)
+    {
+        message.clear();
+
+        for (int j = 0; j < 1000; ++j)
+            message->add_dirty_rect()->set_y(j);
+
+        EXPECT_EQ(message->dirty_rect_size(), 1000);
+        EXPECT_EQ((*message).dirty_rect(999).y(), 999);
+    }
+}
+
+TEST(ArenaMessageTest, ReleaseReturnsCopy)
+{
+    ArenaMessage<proto::HostToClient> message;
+    message->mutable_cursor_position()->set_x(10);
+
+    std::unique_ptr<proto::CursorPosition> position(message->release_cursor_position());
+    message.clear();
+
+    EXPECT_EQ(position->GetArena(), nullptr);
+    EXPECT_EQ(position->x(), 10);
+}
+
+} // namespace base
@@ -18,6 +18,8 @@
 
 #include "base/memory/byte_array.h"
 
+#include "base/memory/byte_array_pool.h"
+
 namespace base {
 
 namespace {
@@ -136,8 +138,8 @@ base::ByteArray serialize(const google::protobuf::MessageLite& message)
     if (!size)
         return base::ByteArray();
 
-    base::ByteArray buffer;
-    buffer.resize(size);
+    // Large messages are usually sent and freed soon, so the buffer is taken from the pool.
+    base::ByteArray buffer = ByteArrayPool::take(size);
 
     message.SerializeWithCachedSizesToArray(buffer.data());
     return buffer;
@@ -0,0 +1,199 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/memory/byte_array_pool.h"
+
+#include <array>
+#include <atomic>
+
+namespace base {
+
+namespace {
+
+const size_t kMinClassShift = 12; // 4 kB
+const size_t kMaxClassShift = 23; // 8 MB
+const size_t kClassCount = kMaxClassShift - kMinClassShift + 1;
+
+// Limits for the buffers kept by one thread.
+const size_t kMaxBuffersPerClass = 16;
+const size_t kMaxPoolBytes = 16 * 1024 * 1024; // 16 MB
+
+std::atomic<int64_t> g_allocations { 0 };
+std::atomic<int64_t> g_reuses { 0 };
+std::atomic<int64_t> g_recycled { 0 };
+std::atomic<int64_t> g_discarded { 0 };
+
+size_t classSize(size_t index)
+{
+    return static_cast<size_t>(1) << (index + kMinClassShift);
+}
+
+// Returns the index of the smallest class that can hold |size| bytes.
+size_t classForSize(size_t size)
+{
+    size_t index = 0;
+    while (classSize(index) < size)
+        ++index;
+    return index;
+}
+
+// Returns the index of the largest class whose buffers fit into |capacity| bytes.
+size_t classForCapacity(size_t capacity)
+{
+    size_t index = kClassCount - 1;
+    while (classSize(index) > capacity)
+        --index;
+    return index;
+}
+
+struct ThreadPool
+{
+    std::array<std::vector<ByteArray>, kClassCount> classes;
+    size_t total_bytes = 0;
+};
+
+ThreadPool& currentPool()
+{
+    static thread_local ThreadPool pool;
+    return pool;
+}
+
+} // namespace
+
+// static
+ByteArray ByteArrayPool::take(size_t size)
+{
+    if (size < kMinBufferSize || size > kMaxBufferSize)
+        return ByteArray(size);
+
+    ThreadPool& pool = currentPool();
+    const size_t index = classForSize(size);
+    std::vector<ByteArray>& free_buffers = pool.classes[index];
+
+    ByteArray buffer;
+
+    if (!free_buffers.empty())
+    {
+        buffer = std::move(free_buffers.back());
+        free_buffers.pop_back();
+
+        pool.total_bytes -= buffer.capacity();
+        ++g_reuses;
+    }
+    else
+    {
+        // The capacity is rounded up to the class size so that the buffer can be reused for any
+        // message of this class.
+        buffer.reserve(classSize(index));
+        ++g_allocations;
+    }
+
+    buffer.resize(size);
+    return buffer;
+}
+
+// static
+void ByteArrayPool::recycle(ByteArray&& buffer)
+{
+    const size_t capacity = buffer.capacity();
+    if (!capacity)
+        return;
+
+    if (capacity < kMinBufferSize || capacity >= kMaxBufferSize * 2)
+    {
+        ByteArray().swap(buffer);
+        ++g_discarded;
+        return;
+    }
+
+    ThreadPool& pool = currentPool();
+    std::vector<ByteArray>& free_buffers = pool.classes[classForCapacity(capacity)];
+
+    if (free_buffers.size() >= kMaxBuffersPerClass || pool.total_bytes + capacity > kMaxPoolBytes)
+    {
+        ByteArray().swap(buffer);
+        ++g_discarded;
+        return;
+    }
+
+    buffer.clear();
+    pool.total_bytes += capacity;
+    free_buffers.emplace_back(std::move(buffer));
+    ++g_recycled;
+}
+
+// static
+ByteArrayPool::Stats ByteArrayPool::stats()
+{
+    Stats stats;
+    stats.allocations = g_allocations.load(std::memory_order_relaxed);
+    stats.reuses = g_reuses.load(std::memory_order_relaxed);
+    stats.recycled = g_recycled.load(std::memory_order_relaxed);
+    stats.discarded = g_discarded.load(std::memory_order_relaxed);
+    return stats;
+}
+
+PooledByteArray::PooledByteArray(size_t size)
+    : buffer_(ByteArrayPool::take(size))
+{
+    // Nothing
+}
+
+PooledByteArray::~PooledByteArray()
+{
+    ByteArrayPool::recycle(std::move(buffer_));
+}
+
+PooledByteArray::PooledByteArray(PooledByteArray&& other) noexcept
+    : buffer_(std::move(other.buffer_))
+{
+    other.buffer_.clear();
+}
+
+PooledByteArray& PooledByteArray::operator=(PooledByteArray&& other) noexcept
+{
+    if (this != &other)
+    {
+        ByteArrayPool::recycle(std::move(buffer_));
+        buffer_ = std::move(other.buffer_);
+        other.buffer_.clear();
+    }
+
+    return *this;
+}
+
+void PooledByteArray::resize(size_t size)
+{
+    if (buffer_.capacity() < size)
+    {
+        ByteArrayPool::recycle(std::move(buffer_));
+        buffer_ = ByteArrayPool::take(size);
+        return;
+    }
+
+    buffer_.resize(size);
+}
+
+ByteArray PooledByteArray::release()
+{
+    ByteArray buffer = std::move(buffer_);
+    buffer_ = ByteArray();
+    return buffer;
+}
+
+} // namespace base
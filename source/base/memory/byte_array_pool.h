@@ -0,0 +1,92 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_MEMORY_BYTE_ARRAY_POOL_H
+#define BASE_MEMORY_BYTE_ARRAY_POOL_H
+
+#include "base/macros_magic.h"
+#include "base/memory/byte_array.h"
+
+namespace base {
+
+// Pool of buffers for messages. Buffers are grouped into size classes that are powers of two from
+// 4 kB to 8 MB. Each thread has its own pool, so no locks are needed. Smaller buffers are allocated
+// directly because the allocator handles them well, larger buffers are never kept.
+class ByteArrayPool
+{
+public:
+    struct Stats
+    {
+        int64_t allocations = 0; // Buffers allocated because the pool had no buffer.
+        int64_t reuses = 0;      // Buffers taken from the pool.
+        int64_t recycled = 0;    // Buffers returned to the pool.
+        int64_t discarded = 0;   // Buffers freed because they do not fit into the pool.
+    };
+
+    // Returns a buffer of |size| bytes. The buffer is taken from the pool of the current thread if
+    // possible.
+    static ByteArray take(size_t size);
+
+    // Returns |buffer| to the pool of the current thread. The content of the buffer is lost.
+    static void recycle(ByteArray&& buffer);
+
+    // Returns the counters of all threads since the start of the process.
+    static Stats stats();
+
+    // Smallest and largest pooled buffer sizes.
+    static const size_t kMinBufferSize = 4 * 1024; // 4 kB
+    static const size_t kMaxBufferSize = 8 * 1024 * 1024; // 8 MB
+
+private:
+    DISALLOW_IMPLICIT_CONSTRUCTORS(ByteArrayPool);
+};
+
+// Buffer that is returned to the pool when destroyed.
+class PooledByteArray
+{
+public:
+    PooledByteArray() = default;
+    explicit PooledByteArray(size_t size);
+    ~PooledByteArray();
+
+    PooledByteArray(PooledByteArray&& other) noexcept;
+    PooledByteArray& operator=(PooledByteArray&& other) noexcept;
+
+    ByteArray& get() { return buffer_; }
+    const ByteArray& get() const { return buffer_; }
+
+    uint8_t* data() { return buffer_.data(); }
+    const uint8_t* data() const { return buffer_.data(); }
+    size_t size() const { return buffer_.size(); }
+
+    // Changes the size of the buffer. If the buffer has to grow, a larger buffer is taken from the
+    // pool and the content is not preserved.
+    void resize(size_t size);
+
+    // Takes the buffer out. It will not be returned to the pool.
+    ByteArray release();
+
+private:
+    ByteArray buffer_;
+
+    DISALLOW_COPY_AND_ASSIGN(PooledByteArray);
+};
+
+} // namespace base
+
+#endif // BASE_MEMORY_BYTE_ARRAY_POOL_H
@@ -0,0 +1,151 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/memory/byte_array_pool.h"
+
+#include <thread>
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+TEST(ByteArrayPoolTest, SmallBuffersAreNotPooled)
+{
+    const ByteArrayPool::Stats before = ByteArrayPool::stats();
+
+    ByteArray buffer = ByteArrayPool::take(100);
+    EXPECT_EQ(buffer.size(), 100U);
+
+    ByteArrayPool::recycle(std::move(buffer));
+
+    const ByteArrayPool::Stats after = ByteArrayPool::stats();
+    EXPECT_EQ(after.allocations, before.allocations);
+    EXPECT_EQ(after.reuses, before.reuses);
+    EXPECT_EQ(after.recycled, before.recycled);
+    EXPECT_EQ(after.discarded, before.discarded + 1);
+}
+
+TEST(ByteArrayPoolTest, BufferIsReused)
+{
+    const ByteArrayPool::Stats before = ByteArrayPool::stats();
+
+    ByteArray buffer = ByteArrayPool::take(10000);
+    EXPECT_EQ(buffer.size(), 10000U);
+    EXPECT_GE(buffer.capacity(), 16U * 1024U);
+
+    const uint8_t* data = buffer.data();
+    ByteArrayPool::recycle(std::move(buffer));
+
+    // A buffer of the same size class is taken from the pool.
+    ByteArray other = ByteArrayPool::take(12000);
+    EXPECT_EQ(other.size(), 12000U);
+    EXPECT_EQ(other.data(), data);
+
+    ByteArrayPool::recycle(std::move(other));
+
+    const ByteArrayPool::Stats after = ByteArrayPool::stats();
+    EXPECT_EQ(after.allocations, before.allocations + 1);
+    EXPECT_EQ(after.reuses, before.reuses + 1);
+    EXPECT_EQ(after.recycled, before.recycled + 2);
+}
+
+TEST(ByteArrayPoolTest, LargerClassIsNotUsed)
+{
+    ByteArrayPool::recycle(ByteArrayPool::take(200000));
+
+    const ByteArrayPool::Stats before = ByteArrayPool::stats();
+
+    // The pooled buffer of 256 kB is too small for this size.
+    ByteArray buffer = ByteArrayPool::take(300000);
+    EXPECT_EQ(buffer.size(), 300000U);
+
+    const ByteArrayPool::Stats after = ByteArrayPool::stats();
+    EXPECT_EQ(after.allocations, before.allocations + 1);
+    EXPECT_EQ(after.reuses, before.reuses);
+
+    ByteArrayPool::recycle(std::move(buffer));
+}
+
+TEST(ByteArrayPoolTest, PoolIsLimited)
+{
+    std::vector<ByteArray> buffers;
+    for (int i = 0; i < 32; ++i)
+        buffers.emplace_back(ByteArrayPool::take(64 * 1024));
+
+    const ByteArrayPool::Stats before = ByteArrayPool::stats();
+
+    for (auto& buffer : buffers)
+        ByteArrayPool::recycle(std::move(buffer));
+
+    const ByteArrayPool::Stats after = ByteArrayPool::stats();
+    EXPECT_LE(after.recycled - before.recycled, 16);
+    EXPECT_EQ((after.recycled - before.recycled) + (after.discarded - before.discarded), 32);
+}
+
+TEST(ByteArrayPoolTest, PoolIsPerThread)
+{
+    std::thread thread([]()
+    {
+        ByteArrayPool::recycle(ByteArrayPool::take(1000000));
+    });
+    thread.join();
+
+    const ByteArrayPool::Stats before = ByteArrayPool::stats();
+
+    // The pool of the other thread was freed when the thread exited.
+    ByteArray buffer = ByteArrayPool::take(1000000);
+    EXPECT_EQ(ByteArrayPool::stats().allocations, before.allocations + 1);
+
+    ByteArrayPool::recycle(std::move(buffer));
+}
+
+TEST(ByteArrayPoolTest, PooledByteArray)
+{
+    const ByteArrayPool::Stats before = ByteArrayPool::stats();
+
+    {
+        PooledByteArray buffer(20000);
+        EXPECT_EQ(buffer.size(), 20000U);
+
+        PooledByteArray other(std::move(buffer));
+        EXPECT_EQ(other.size(), 20000U);
+        EXPECT_EQ(buffer.size(), 0U);
+
+        // Growing within the capacity keeps the buffer.
+        const uint8_t* data = other.data();
+        other.resize(30000);
+        EXPECT_EQ(other.data(), data);
+    }
+
+    // The buffer was returned to the pool once.
+    const ByteArrayPool::Stats middle = ByteArrayPool::stats();
+    EXPECT_EQ(middle.recycled, before.recycled + 1);
+
+    {
+        PooledByteArray buffer(25000);
+        ByteArray released = buffer.release();
+        EXPECT_EQ(released.size(), 25000U);
+        EXPECT_EQ(buffer.size(), 0U);
+    }
+
+    const ByteArrayPool::Stats after = ByteArrayPool::stats();
+    EXPECT_EQ(after.reuses, middle.reuses + 1);
+    EXPECT_EQ(after.recycled, middle.recycled);
+}
+
+} // namespace base
@@ -0,0 +1,201 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/message_loop/incoming_task_queue.h"
+
+#include <thread>
+#include <vector>
+
+namespace base {
+
+namespace {
+
+const size_t kMaxCachedNodes = 256;
+
+// Free nodes of the current thread.
+template <class T>
+class NodeCache
+{
+public:
+    NodeCache() = default;
+
+    ~NodeCache()
+    {
+        for (T* node : nodes_)
+            delete node;
+    }
+
+    T* take()
+    {
+        if (nodes_.empty())
+            return new T();
+
+        T* node = nodes_.back();
+        nodes_.pop_back();
+        return node;
+    }
+
+    void put(T* node)
+    {
+        if (nodes_.size() >= kMaxCachedNodes)
+        {
+            delete node;
+            return;
+        }
+
+        nodes_.emplace_back(node);
+    }
+
+private:
+    std::vector<T*> nodes_;
+
+    DISALLOW_COPY_AND_ASSIGN(NodeCache);
+};
+
+template <class T>
+NodeCache<T>& currentNodeCache()
+{
+    static thread_local NodeCache<T> cache;
+    return cache;
+}
+
+} // namespace
+
+IncomingTaskQueue::IncomingTaskQueue()
+    : head_(&stub_),
+      tail_(&stub_)
+{
+    // Nothing
+}
+
+IncomingTaskQueue::~IncomingTaskQueue()
+{
+    // The nodes are deleted directly because the cache of the thread may already be destroyed.
+    while (Node* node = pop())
+        delete node;
+}
+
+bool IncomingTaskQueue::push(PendingTask&& pending_task)
+{
+    Node* node = allocateNode();
+    node->task.emplace(std::move(pending_task));
+
+    pushNode(node);
+
+    // The flag is set after the node is added. If the consumer has cleared it before, then it
+    // will see the node or will be woken up again.
+    return !wakeup_pending_.exchange(true);
+}
+
+bool IncomingTaskQueue::takeAll(TaskQueue* work_queue)
+{
+    // The flag is cleared before the queue is read so that a task added after that wakes up the
+    // consumer.
+    wakeup_pending_.store(false);
+
+    bool has_tasks = false;
+
+    while (Node* node = pop())
+    {
+        work_queue->emplace(std::move(*node->task));
+        freeNode(node);
+        has_tasks = true;
+    }
+
+    return has_tasks;
+}
+
+// static
+IncomingTaskQueue::Node* IncomingTaskQueue::allocateNode()
+{
+    Node* node = currentNodeCache<Node>().take();
+    node->next.store(nullptr, std::memory_order_relaxed);
+    return node;
+}
+
+// static
+void IncomingTaskQueue::freeNode(Node* node)
+{
+    node->task.reset();
+    currentNodeCache<Node>().put(node);
+}
+
+void IncomingTaskQueue::pushNode(Node* node)
+{
+    node->next.store(nullptr, std::memory_order_relaxed);
+
+    Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+
+    // Between the exchange and this store the node is not reachable from |tail_|. The consumer
+    // waits for the store in this case.
+    prev->next.store(node, std::memory_order_release);
+}
+
+IncomingTaskQueue::Node* IncomingTaskQueue::pop()
+{
+    for (;;)
+    {
+        Node* tail = tail_;
+        Node* next = tail->next.load(std::memory_order_acquire);
+
+        if (tail == &stub_)
+        {
+            if (!next)
+            {
+                if (head_.load(std::memory_order_acquire) == &stub_)
+                    return nullptr;
+
+                // A producer has not linked its node yet.
+                std::this_thread::yield();
+                continue;
+            }
+
+            tail_ = next;
+            tail = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+
+        if (next)
+        {
+            tail_ = next;
+            return tail;
+        }
+
+        if (tail != head_.load(std::memory_order_acquire))
+        {
+            // A producer has not linked its node yet.
+            std::this_thread::yield();
+            continue;
+        }
+
+        // |tail| is the last node. The stub is added after it so that it can be taken.
+        pushNode(&stub_);
+
+        next = tail->next.load(std::memory_order_acquire);
+        if (next)
+        {
+            tail_ = next;
+            return tail;
+        }
+
+        // Another producer added a node before the stub and has not linked it yet.
+        std::this_thread::yield();
+    }
+}
+
+} // namespace base
@@ -0,0 +1,74 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_MESSAGE_LOOP_INCOMING_TASK_QUEUE_H
+#define BASE_MESSAGE_LOOP_INCOMING_TASK_QUEUE_H
+
+#include "base/macros_magic.h"
+#include "base/message_loop/pending_task.h"
+
+#include <atomic>
+#include <optional>
+
+namespace base {
+
+// Lock-free queue of tasks posted to a message loop. Any thread can add tasks, adding a task is
+// one atomic exchange. Only the thread of the message loop takes tasks from the queue.
+// Nodes of the queue are reused by the thread that freed them, so posting tasks to the own message
+// loop does not allocate memory.
+class IncomingTaskQueue
+{
+public:
+    IncomingTaskQueue();
+    ~IncomingTaskQueue();
+
+    // Adds a task to the queue. Returns true if the consumer has to be woken up. After that
+    // false is returned until the consumer calls takeAll().
+    bool push(PendingTask&& pending_task);
+
+    // Moves all tasks from the queue into |work_queue|. Returns false if the queue was empty.
+    // Must be called only by the consumer thread.
+    bool takeAll(TaskQueue* work_queue);
+
+private:
+    struct Node
+    {
+        std::atomic<Node*> next { nullptr };
+        std::optional<PendingTask> task;
+    };
+
+    static Node* allocateNode();
+    static void freeNode(Node* node);
+
+    void pushNode(Node* node);
+    Node* pop();
+
+    // Producers add nodes to |head_|, the consumer takes them from |tail_|. |stub_| keeps the
+    // queue non-empty so that producers and the consumer never touch the same pointer.
+    std::atomic<Node*> head_;
+    Node* tail_;
+    Node stub_;
+
+    std::atomic<bool> wakeup_pending_ { false };
+
+    DISALLOW_COPY_AND_ASSIGN(IncomingTaskQueue);
+};
+
+} // namespace base
+
+#endif // BASE_MESSAGE_LOOP_INCOMING_TASK_QUEUE_H
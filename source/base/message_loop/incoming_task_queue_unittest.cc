@@ -0,0 +1,133 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/message_loop/incoming_task_queue.h"
+
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+PendingTask makeTask(std::function<void()> callback)
+{
+    return PendingTask(std::move(callback), PendingTask::TimePoint(), true);
+}
+
+} // namespace
+
+TEST(IncomingTaskQueueTest, Empty)
+{
+    IncomingTaskQueue queue;
+    TaskQueue work_queue;
+
+    EXPECT_FALSE(queue.takeAll(&work_queue));
+    EXPECT_TRUE(work_queue.empty());
+}
+
+TEST(IncomingTaskQueueTest, Order)
+{
+    IncomingTaskQueue queue;
+    std::vector<int> result;
+
+    EXPECT_TRUE(queue.push(makeTask([&]() { result.emplace_back(1); })));
+    EXPECT_FALSE(queue.push(makeTask([&]() { result.emplace_back(2); })));
+    EXPECT_FALSE(queue.push(makeTask([&]() { result.emplace_back(3); })));
+
+    TaskQueue work_queue;
+    EXPECT_TRUE(queue.takeAll(&work_queue));
+    ASSERT_EQ(work_queue.size(), 3U);
+
+    while (!work_queue.empty())
+    {
+        work_queue.front().callback();
+        work_queue.pop();
+    }
+
+    EXPECT_EQ(result, std::vector<int>({ 1, 2, 3 }));
+
+    // After the queue is read, the next task wakes up the consumer again.
+    EXPECT_TRUE(queue.push(makeTask([]() {})));
+    EXPECT_TRUE(queue.takeAll(&work_queue));
+    EXPECT_EQ(work_queue.size(), 1U);
+}
+
+TEST(IncomingTaskQueueTest, PendingTasksAreDeleted)
+{
+    auto counter = std::make_shared<int>(0);
+
+    {
+        IncomingTaskQueue queue;
+        queue.push(makeTask([counter]() {}));
+        queue.push(makeTask([counter]() {}));
+        EXPECT_EQ(counter.use_count(), 3);
+    }
+
+    EXPECT_EQ(counter.use_count(), 1);
+}
+
+TEST(IncomingTaskQueueTest, MultipleProducers)
+{
+    static const int kThreadCount = 4;
+    static const int kTasksPerThread = 50000;
+
+    IncomingTaskQueue queue;
+    std::vector<std::thread> threads;
+    std::vector<int> last_value(kThreadCount, -1);
+    int total = 0;
+
+    for (int i = 0; i < kThreadCount; ++i)
+    {
+        threads.emplace_back([&queue, &last_value, &total, i]()
+        {
+            for (int j = 0; j < kTasksPerThread; ++j)
+            {
+                queue.push(makeTask([&last_value, &total, i, j]()
+                {
+                    // Tasks of one producer keep their order.
+                    EXPECT_EQ(last_value[i] + 1, j);
+                    last_value[i] = j;
+                    ++total;
+                }));
+            }
+        });
+    }
+
+    TaskQueue work_queue;
+
+    while (total < kThreadCount * kTasksPerThread)
+    {
+        queue.takeAll(&work_queue);
+
+        while (!work_queue.empty())
+        {
+            work_queue.front().callback();
+            work_queue.pop();
+        }
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    EXPECT_FALSE(queue.takeAll(&work_queue));
+}
+
+} // namespace base
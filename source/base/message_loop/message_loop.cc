@@ -27,10 +27,17 @@
 #include "base/message_loop/message_pump_win.h"
 #endif // defined(OS_WIN)
 
+#include <algorithm>
 #include <memory>
 
 namespace base {
 
+namespace {
+
+const TimerWheel::Milliseconds kTimerWheelTick(100);
+
+} // namespace
+
 static thread_local MessageLoop* message_loop_for_current_thread = nullptr;
 
 // static
@@ -40,7 +47,8 @@ MessageLoop* MessageLoop::current()
 }
 
 MessageLoop::MessageLoop(Type type)
-    : type_(type)
+    : type_(type),
+      timer_wheel_(kTimerWheelTick, Clock::now())
 {
     DCHECK(!current()) << "should only have one message loop per thread";
 
@@ -165,6 +173,27 @@ std::shared_ptr<TaskRunner> MessageLoop::taskRunner() const
     return proxy_;
 }
 
+void MessageLoop::startTimer(TimerWheel::Timer* timer, const TimerWheel::Milliseconds& delay,
+                             TimerWheel::Callback callback)
+{
+    DCHECK_EQ(this, current());
+
+    timer_wheel_.schedule(timer, Clock::now() + delay, std::move(callback));
+
+    const TimePoint wake_up_time = timer_wheel_.nextWakeUpTime();
+    if (timer_wake_up_time_ != TimePoint() && timer_wake_up_time_ <= wake_up_time)
+        return;
+
+    // The pump has to wake up earlier than it was going to.
+    timer_wake_up_time_ = wake_up_time;
+
+    TimePoint delayed_work_time = timer_wake_up_time_;
+    if (!delayed_work_queue_.empty())
+        delayed_work_time = std::min(delayed_work_time, delayed_work_queue_.top().delayed_run_time);
+
+    pump_->scheduleDelayedWork(delayed_work_time);
+}
+
 void MessageLoop::runTask(const PendingTask& pending_task)
 {
     DCHECK(nestable_tasks_allowed_);
@@ -207,19 +236,10 @@ void MessageLoop::addToDelayedWorkQueue(PendingTask* pending_task)
 void MessageLoop::addToIncomingQueue(
     PendingTask::Callback&& callback, const Milliseconds& delay, bool nestable)
 {
-    bool empty;
-
-    {
-        std::scoped_lock lock(incoming_queue_lock_);
-
-        empty = incoming_queue_.empty();
+    const bool schedule_work = incoming_queue_.push(
+        PendingTask(std::move(callback), calculateDelayedRuntime(delay), nestable));
 
-        incoming_queue_.emplace(std::move(callback),
-                                calculateDelayedRuntime(delay),
-                                nestable);
-    }
-
-    if (!empty)
+    if (!schedule_work)
         return;
 
     std::shared_ptr<MessagePump> pump(pump_);
@@ -231,13 +251,7 @@ void MessageLoop::reloadWorkQueue()
     if (!work_queue_.empty())
         return;
 
-    std::scoped_lock lock(incoming_queue_lock_);
-
-    if (incoming_queue_.empty())
-        return;
-
-    incoming_queue_.Swap(&work_queue_);
-    DCHECK(incoming_queue_.empty());
+    incoming_queue_.takeAll(&work_queue_);
 }
 
 bool MessageLoop::deletePendingTasks()
@@ -246,7 +260,7 @@ bool MessageLoop::deletePendingTasks()
 
     while (!work_queue_.empty())
     {
-        PendingTask pending_task = work_queue_.front();
+        PendingTask pending_task = std::move(work_queue_.front());
         work_queue_.pop();
 
         if (pending_task.delayed_run_time != TimePoint())
@@ -270,6 +284,30 @@ bool MessageLoop::deletePendingTasks()
     return did_work;
 }
 
+bool MessageLoop::runExpiredTimers()
+{
+    if (timer_wheel_.empty())
+    {
+        timer_wake_up_time_ = TimePoint();
+        return false;
+    }
+
+    if (timer_wake_up_time_ > recent_time_)
+    {
+        recent_time_ = Clock::now();
+        if (timer_wake_up_time_ > recent_time_)
+            return false;
+    }
+
+    // The timers are called in the same way as the tasks.
+    nestable_tasks_allowed_ = false;
+    const size_t count = timer_wheel_.advance(recent_time_);
+    nestable_tasks_allowed_ = true;
+
+    timer_wake_up_time_ = timer_wheel_.nextWakeUpTime();
+    return count != 0;
+}
+
 // static
 MessageLoop::TimePoint MessageLoop::calculateDelayedRuntime(const Milliseconds& delay)
 {
@@ -299,7 +337,7 @@ bool MessageLoop::doWork()
         // Execute oldest task.
         do
         {
-            PendingTask pending_task = work_queue_.front();
+            PendingTask pending_task = std::move(work_queue_.front());
             work_queue_.pop();
 
             if (pending_task.delayed_run_time != TimePoint())
@@ -308,9 +346,16 @@ bool MessageLoop::doWork()
 
                 addToDelayedWorkQueue(&pending_task);
 
-                // If we changed the topmost task, then it is time to reschedule.
+                // If we changed the topmost task, then it is time to reschedule. The pump does not
+                // wake up later than the timer wheel needs.
                 if (reschedule)
-                    pump_->scheduleDelayedWork(pending_task.delayed_run_time);
+                {
+                    TimePoint delayed_work_time = delayed_work_queue_.top().delayed_run_time;
+                    if (timer_wake_up_time_ != TimePoint())
+                        delayed_work_time = std::min(delayed_work_time, timer_wake_up_time_);
+
+                    pump_->scheduleDelayedWork(delayed_work_time);
+                }
             }
             else
             {
@@ -327,12 +372,31 @@ bool MessageLoop::doWork()
 
 bool MessageLoop::doDelayedWork(TimePoint* next_delayed_work_time)
 {
-    if (!nestable_tasks_allowed_ || delayed_work_queue_.empty())
+    if (!nestable_tasks_allowed_)
     {
         recent_time_ = *next_delayed_work_time = TimePoint();
         return false;
     }
 
+    const bool did_timer_work = runExpiredTimers();
+
+    // The pump waits for the nearest of the delayed task and the timer wheel.
+    auto nextTime = [this](const TimePoint& delayed_run_time)
+    {
+        if (timer_wake_up_time_ == TimePoint())
+            return delayed_run_time;
+        if (delayed_run_time == TimePoint())
+            return timer_wake_up_time_;
+        return std::min(delayed_run_time, timer_wake_up_time_);
+    };
+
+    if (delayed_work_queue_.empty())
+    {
+        recent_time_ = TimePoint();
+        *next_delayed_work_time = nextTime(TimePoint());
+        return did_timer_work;
+    }
+
     // When we "fall behind," there will be a lot of tasks in the delayed work queue that are ready
     // to run.  To increase efficiency when we fall behind, we will only call Clock::now()
     // intermittently, and then process all tasks that are ready to run before calling it again.
@@ -346,8 +410,8 @@ bool MessageLoop::doDelayedWork(TimePoint* next_delayed_work_time)
         recent_time_ = Clock::now();
         if (next_run_time > recent_time_)
         {
-            *next_delayed_work_time = next_run_time;
-            return false;
+            *next_delayed_work_time = nextTime(next_run_time);
+            return did_timer_work;
         }
     }
 
@@ -355,9 +419,11 @@ bool MessageLoop::doDelayedWork(TimePoint* next_delayed_work_time)
     delayed_work_queue_.pop();
 
     if (!delayed_work_queue_.empty())
-        *next_delayed_work_time = delayed_work_queue_.top().delayed_run_time;
+        *next_delayed_work_time = nextTime(delayed_work_queue_.top().delayed_run_time);
+    else if (timer_wake_up_time_ != TimePoint())
+        *next_delayed_work_time = timer_wake_up_time_;
 
-    return deferOrRunPendingTask(pending_task);
+    return deferOrRunPendingTask(pending_task) || did_timer_work;
 }
 
 bool MessageLoop::doIdleWork()
@@ -365,7 +431,7 @@ bool MessageLoop::doIdleWork()
     if (deferred_non_nestable_work_queue_.empty())
         return false;
 
-    PendingTask pending_task = deferred_non_nestable_work_queue_.front();
+    PendingTask pending_task = std::move(deferred_non_nestable_work_queue_.front());
     deferred_non_nestable_work_queue_.pop();
 
     runTask(pending_task);
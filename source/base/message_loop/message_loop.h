@@ -21,13 +21,14 @@
 
 #include "base/macros_magic.h"
 #include "base/task_runner.h"
+#include "base/message_loop/incoming_task_queue.h"
 #include "base/message_loop/message_pump.h"
 #include "base/message_loop/message_pump_dispatcher.h"
 #include "base/message_loop/pending_task.h"
+#include "base/message_loop/timer_wheel.h"
 #include "build/build_config.h"
 
 #include <memory>
-#include <mutex>
 
 namespace base {
 
@@ -67,6 +68,12 @@ public:
 
     std::shared_ptr<TaskRunner> taskRunner() const;
 
+    // Starts or restarts |timer| in the timer wheel of the loop. The timers of the wheel have the
+    // resolution of 100 ms and are started and stopped in constant time. They are intended for
+    // the keep-alive, idle and statistics timeouts. It must be called on the thread of the loop.
+    void startTimer(TimerWheel::Timer* timer, const TimerWheel::Milliseconds& delay,
+                    TimerWheel::Callback callback);
+
 protected:
     friend class MessageLoopTaskRunner;
     friend class Thread;
@@ -100,11 +107,14 @@ protected:
     void addToIncomingQueue(PendingTask::Callback&& callback, const Milliseconds& delay, bool nestable);
 
     // Load tasks from the incoming_queue_ into work_queue_ if the latter is empty. The former
-    // requires a lock to access, while the latter is directly accessible on this thread.
+    // is filled by any thread, while the latter is directly accessible on this thread.
     void reloadWorkQueue();
 
     bool deletePendingTasks();
 
+    // Calls the expired timers of timer_wheel_. Returns true if any timer was called.
+    bool runExpiredTimers();
+
     // Calculates the time at which a PendingTask should run.
     static TimePoint calculateDelayedRuntime(const Milliseconds& delay);
 
@@ -121,6 +131,11 @@ protected:
     // Contains delayed tasks, sorted by their 'delayed_run_time' property.
     DelayedTaskQueue delayed_work_queue_;
 
+    // Coarse timers of the thread. The pump is woken up at timer_wake_up_time_ to advance the
+    // wheel.
+    TimerWheel timer_wheel_;
+    TimePoint timer_wake_up_time_;
+
     // A list of tasks that need to be processed by this instance.  Note that this queue is only
     // accessed (push/pop) by our current thread.
     TaskQueue work_queue_;
@@ -135,8 +150,7 @@ protected:
 
     std::shared_ptr<MessagePump> pump_;
 
-    TaskQueue incoming_queue_;
-    std::mutex incoming_queue_lock_;
+    IncomingTaskQueue incoming_queue_;
 
     // The next sequence number to use for delayed tasks.
     int next_sequence_num_ = 0;
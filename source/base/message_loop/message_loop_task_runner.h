@@ -23,6 +23,7 @@
 #include "base/message_loop/message_loop.h"
 #include "base/message_loop/pending_task.h"
 
+#include <mutex>
 #include <shared_mutex>
 #include <thread>
 
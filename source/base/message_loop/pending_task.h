@@ -40,6 +40,11 @@ public:
                 int sequence_num = 0);
     ~PendingTask() = default;
 
+    PendingTask(PendingTask&& other) = default;
+    PendingTask& operator=(PendingTask&& other) = default;
+    PendingTask(const PendingTask& other) = default;
+    PendingTask& operator=(const PendingTask& other) = default;
+
     // Used to support sorting.
     bool operator<(const PendingTask& other) const;
 
@@ -0,0 +1,275 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/message_loop/timer_wheel.h"
+
+#include "base/logging.h"
+
+#include <algorithm>
+
+namespace base {
+
+TimerWheel::Timer::~Timer()
+{
+    cancel();
+}
+
+void TimerWheel::Timer::cancel()
+{
+    if (wheel_)
+        wheel_->cancel(this);
+}
+
+void TimerWheel::Timer::unlink()
+{
+    prev_->next_ = next_;
+    next_->prev_ = prev_;
+    prev_ = nullptr;
+    next_ = nullptr;
+}
+
+TimerWheel::TimerWheel(const Milliseconds& tick, const TimePoint& start_time)
+    : tick_(tick),
+      start_time_(start_time)
+{
+    DCHECK_GT(tick_.count(), 0);
+
+    for (Level& level : levels_)
+    {
+        for (Timer& list : level)
+        {
+            list.prev_ = &list;
+            list.next_ = &list;
+        }
+    }
+}
+
+TimerWheel::~TimerWheel()
+{
+    // The timers that are still scheduled are detached from the wheel.
+    for (Level& level : levels_)
+    {
+        for (Timer& list : level)
+        {
+            while (!isListEmpty(list))
+            {
+                Timer* timer = list.next_;
+                timer->unlink();
+                timer->wheel_ = nullptr;
+                timer->callback_ = nullptr;
+            }
+
+            // The sentinel nodes are not scheduled timers.
+            list.prev_ = nullptr;
+            list.next_ = nullptr;
+        }
+    }
+}
+
+void TimerWheel::schedule(Timer* timer, const TimePoint& time, Callback callback)
+{
+    DCHECK(timer);
+    DCHECK(callback);
+
+    if (timer->wheel_)
+        timer->wheel_->cancel(timer);
+
+    // The timer is rounded up to a whole tick, so it never expires earlier than requested.
+    uint64_t expire_tick = 0;
+    if (time > start_time_)
+    {
+        const int64_t elapsed = std::chrono::duration_cast<Milliseconds>(
+            time - start_time_ + tick_ - Clock::duration(1)).count();
+        expire_tick = static_cast<uint64_t>(elapsed / tick_.count());
+    }
+
+    timer->wheel_ = this;
+    timer->expire_tick_ = std::max(expire_tick, current_tick_);
+    timer->callback_ = std::move(callback);
+
+    insert(timer);
+    ++count_;
+}
+
+void TimerWheel::cancel(Timer* timer)
+{
+    DCHECK(timer);
+
+    if (!timer->wheel_)
+        return;
+
+    DCHECK_EQ(timer->wheel_, this);
+
+    timer->unlink();
+    timer->wheel_ = nullptr;
+    timer->callback_ = nullptr;
+    --count_;
+}
+
+size_t TimerWheel::advance(const TimePoint& now)
+{
+    if (now < start_time_)
+        return 0;
+
+    const uint64_t target_tick = static_cast<uint64_t>(
+        std::chrono::duration_cast<Milliseconds>(now - start_time_).count() / tick_.count());
+
+    size_t called = 0;
+
+    while (current_tick_ <= target_tick)
+    {
+        if (!count_)
+        {
+            // Nothing to cascade, the empty ticks are skipped.
+            current_tick_ = target_tick + 1;
+            break;
+        }
+
+        const size_t index = current_tick_ & (kSlotCount - 1);
+
+        // When the lower level wraps around, the next slot of the upper level is moved down.
+        if (index == 0)
+        {
+            for (size_t level = 1; level < kLevelCount; ++level)
+            {
+                const size_t level_index =
+                    (current_tick_ >> (level * kLevelBits)) & (kSlotCount - 1);
+
+                cascade(level);
+
+                if (level_index != 0)
+                    break;
+            }
+        }
+
+        // The expired timers are moved to a separate list, because the callbacks can schedule
+        // new timers in the same slot.
+        Timer expired;
+        expired.prev_ = &expired;
+        expired.next_ = &expired;
+
+        Timer& slot = levels_[0][index];
+        while (!isListEmpty(slot))
+        {
+            Timer* timer = slot.next_;
+            timer->unlink();
+            append(&expired, timer);
+        }
+
+        ++current_tick_;
+
+        while (!isListEmpty(expired))
+        {
+            Timer* timer = expired.next_;
+            Callback callback = std::move(timer->callback_);
+
+            timer->unlink();
+            timer->wheel_ = nullptr;
+            timer->callback_ = nullptr;
+            --count_;
+
+            callback();
+            ++called;
+        }
+
+        expired.prev_ = nullptr;
+        expired.next_ = nullptr;
+    }
+
+    return called;
+}
+
+TimerWheel::TimePoint TimerWheel::nextWakeUpTime() const
+{
+    if (!count_)
+        return TimePoint();
+
+    // The timers of the lowest level expire at the tick of their slot.
+    for (uint64_t i = 0; i < kSlotCount; ++i)
+    {
+        const uint64_t tick = current_tick_ + i;
+        if (!isListEmpty(levels_[0][tick & (kSlotCount - 1)]))
+            return start_time_ + tick_ * tick;
+    }
+
+    // The timers of the upper levels are cascaded when the lowest level wraps around.
+    const uint64_t tick = (current_tick_ + kSlotCount - 1) & ~static_cast<uint64_t>(kSlotCount - 1);
+    return start_time_ + tick_ * tick;
+}
+
+void TimerWheel::insert(Timer* timer)
+{
+    const uint64_t delta = timer->expire_tick_ - current_tick_;
+
+    for (size_t level = 0; level < kLevelCount; ++level)
+    {
+        const int shift = static_cast<int>(level * kLevelBits);
+
+        if (delta < (static_cast<uint64_t>(kSlotCount) << shift) || level == kLevelCount - 1)
+        {
+            if (level == kLevelCount - 1)
+            {
+                // The timers beyond the range of the wheel are clamped to its last slot.
+                const uint64_t max_delta = (static_cast<uint64_t>(kSlotCount) << shift) - 1;
+                if (delta > max_delta)
+                    timer->expire_tick_ = current_tick_ + max_delta;
+            }
+
+            const size_t index = (timer->expire_tick_ >> shift) & (kSlotCount - 1);
+            append(&levels_[level][index], timer);
+            return;
+        }
+    }
+}
+
+void TimerWheel::cascade(size_t level)
+{
+    const size_t index = (current_tick_ >> (level * kLevelBits)) & (kSlotCount - 1);
+
+    Timer pending;
+    pending.prev_ = &pending;
+    pending.next_ = &pending;
+
+    Timer& slot = levels_[level][index];
+    while (!isListEmpty(slot))
+    {
+        Timer* timer = slot.next_;
+        timer->unlink();
+        append(&pending, timer);
+    }
+
+    while (!isListEmpty(pending))
+    {
+        Timer* timer = pending.next_;
+        timer->unlink();
+        insert(timer);
+    }
+
+    pending.prev_ = nullptr;
+    pending.next_ = nullptr;
+}
+
+// static
+void TimerWheel::append(Timer* list, Timer* timer)
+{
+    timer->prev_ = list->prev_;
+    timer->next_ = list;
+    list->prev_->next_ = timer;
+    list->prev_ = timer;
+}
+
+} // namespace base
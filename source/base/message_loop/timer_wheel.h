@@ -0,0 +1,111 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef BASE_MESSAGE_LOOP_TIMER_WHEEL_H
+#define BASE_MESSAGE_LOOP_TIMER_WHEEL_H
+
+#include "base/macros_magic.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+namespace base {
+
+// Hierarchical timer wheel for the timers that do not need a precise time (keep-alive, idle and
+// statistics timeouts). Starting and cancelling a timer takes constant time. The timers are
+// called no earlier than requested and at most one tick later. The wheel is not thread-safe.
+class TimerWheel
+{
+public:
+    using Clock = std::chrono::high_resolution_clock;
+    using TimePoint = Clock::time_point;
+    using Milliseconds = std::chrono::milliseconds;
+    using Callback = std::function<void()>;
+
+    // The timer is owned by the user and is linked into the wheel while it is scheduled.
+    class Timer
+    {
+    public:
+        Timer() = default;
+        ~Timer();
+
+        bool isScheduled() const { return wheel_ != nullptr; }
+        void cancel();
+
+    private:
+        friend class TimerWheel;
+
+        void unlink();
+
+        TimerWheel* wheel_ = nullptr;
+        Timer* prev_ = nullptr;
+        Timer* next_ = nullptr;
+        uint64_t expire_tick_ = 0;
+        Callback callback_;
+
+        DISALLOW_COPY_AND_ASSIGN(Timer);
+    };
+
+    TimerWheel(const Milliseconds& tick, const TimePoint& start_time);
+    ~TimerWheel();
+
+    // Calls |callback| at |time|. If the timer is already scheduled, then it is rescheduled.
+    void schedule(Timer* timer, const TimePoint& time, Callback callback);
+    void cancel(Timer* timer);
+
+    // Calls the callbacks of the timers that have expired by |now|. Returns the number of the
+    // called timers. The callbacks can schedule and cancel any timers.
+    size_t advance(const TimePoint& now);
+
+    // Returns the time at which advance() should be called next or TimePoint() if there are no
+    // timers. The time may be earlier than the expiration of the nearest timer.
+    TimePoint nextWakeUpTime() const;
+
+    bool empty() const { return count_ == 0; }
+    size_t count() const { return count_; }
+    Milliseconds tick() const { return tick_; }
+
+private:
+    static const int kLevelBits = 6;
+    static const size_t kSlotCount = 1 << kLevelBits;
+    static const size_t kLevelCount = 4;
+
+    using Level = std::array<Timer, kSlotCount>;
+
+    void insert(Timer* timer);
+    void cascade(size_t level);
+    static void append(Timer* list, Timer* timer);
+    static bool isListEmpty(const Timer& list) { return list.next_ == &list; }
+
+    const Milliseconds tick_;
+    const TimePoint start_time_;
+
+    // The next tick to process.
+    uint64_t current_tick_ = 0;
+
+    // Each slot is a circular list with a sentinel node.
+    std::array<Level, kLevelCount> levels_;
+    size_t count_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(TimerWheel);
+};
+
+} // namespace base
+
+#endif // BASE_MESSAGE_LOOP_TIMER_WHEEL_H
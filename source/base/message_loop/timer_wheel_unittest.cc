@@ -0,0 +1,165 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/message_loop/timer_wheel.h"
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+using Milliseconds = TimerWheel::Milliseconds;
+
+const Milliseconds kTick(100);
+
+} // namespace
+
+TEST(TimerWheelTest, Empty)
+{
+    const TimerWheel::TimePoint start = TimerWheel::Clock::now();
+    TimerWheel wheel(kTick, start);
+
+    EXPECT_TRUE(wheel.empty());
+    EXPECT_EQ(wheel.nextWakeUpTime(), TimerWheel::TimePoint());
+    EXPECT_EQ(wheel.advance(start + std::chrono::hours(1)), 0U);
+}
+
+TEST(TimerWheelTest, NotEarlier)
+{
+    const TimerWheel::TimePoint start = TimerWheel::Clock::now();
+    TimerWheel wheel(kTick, start);
+    TimerWheel::Timer timer;
+    bool called = false;
+
+    wheel.schedule(&timer, start + Milliseconds(250), [&]() { called = true; });
+    EXPECT_TRUE(timer.isScheduled());
+    EXPECT_EQ(wheel.nextWakeUpTime(), start + Milliseconds(300));
+
+    EXPECT_EQ(wheel.advance(start + Milliseconds(249)), 0U);
+    EXPECT_FALSE(called);
+
+    EXPECT_EQ(wheel.advance(start + Milliseconds(300)), 1U);
+    EXPECT_TRUE(called);
+    EXPECT_FALSE(timer.isScheduled());
+    EXPECT_TRUE(wheel.empty());
+}
+
+TEST(TimerWheelTest, Cancel)
+{
+    const TimerWheel::TimePoint start = TimerWheel::Clock::now();
+    TimerWheel wheel(kTick, start);
+    bool called = false;
+
+    TimerWheel::Timer timer;
+    wheel.schedule(&timer, start + Milliseconds(100), [&]() { called = true; });
+    wheel.cancel(&timer);
+    EXPECT_FALSE(timer.isScheduled());
+
+    {
+        // The destroyed timer is removed from the wheel.
+        TimerWheel::Timer other;
+        wheel.schedule(&other, start + Milliseconds(100), [&]() { called = true; });
+        EXPECT_EQ(wheel.count(), 1U);
+    }
+
+    EXPECT_TRUE(wheel.empty());
+    EXPECT_EQ(wheel.advance(start + Milliseconds(1000)), 0U);
+    EXPECT_FALSE(called);
+}
+
+TEST(TimerWheelTest, Reschedule)
+{
+    const TimerWheel::TimePoint start = TimerWheel::Clock::now();
+    TimerWheel wheel(kTick, start);
+
+    TimerWheel::Timer timer;
+    int calls = 0;
+
+    std::function<void()> callback = [&]()
+    {
+        // A repeated timer schedules itself from the callback.
+        if (++calls < 3)
+            wheel.schedule(&timer, start + Milliseconds(100) * (calls + 1), callback);
+    };
+
+    wheel.schedule(&timer, start + Milliseconds(100), callback);
+
+    EXPECT_EQ(wheel.advance(start + Milliseconds(1000)), 3U);
+    EXPECT_EQ(calls, 3);
+    EXPECT_TRUE(wheel.empty());
+}
+
+TEST(TimerWheelTest, CancelFromCallback)
+{
+    const TimerWheel::TimePoint start = TimerWheel::Clock::now();
+    TimerWheel wheel(kTick, start);
+
+    TimerWheel::Timer first;
+    TimerWheel::Timer second;
+    int calls = 0;
+
+    wheel.schedule(&first, start + Milliseconds(100), [&]() { ++calls; wheel.cancel(&second); });
+    wheel.schedule(&second, start + Milliseconds(100), [&]() { ++calls; wheel.cancel(&first); });
+
+    EXPECT_EQ(wheel.advance(start + Milliseconds(100)), 1U);
+    EXPECT_EQ(calls, 1);
+    EXPECT_TRUE(wheel.empty());
+}
+
+TEST(TimerWheelTest, LongTimeouts)
+{
+    const TimerWheel::TimePoint start = TimerWheel::Clock::now();
+    TimerWheel wheel(kTick, start);
+
+    std::mt19937 random(12345);
+    std::uniform_int_distribution<int> distribution(0, 3 * 3600 * 1000);
+
+    const size_t kCount = 2000;
+    std::vector<std::unique_ptr<TimerWheel::Timer>> timers;
+    std::vector<TimerWheel::TimePoint> expected(kCount);
+    std::vector<TimerWheel::TimePoint> actual(kCount);
+
+    TimerWheel::TimePoint now = start;
+
+    for (size_t i = 0; i < kCount; ++i)
+    {
+        expected[i] = start + Milliseconds(distribution(random));
+        timers.emplace_back(std::make_unique<TimerWheel::Timer>());
+        wheel.schedule(timers.back().get(), expected[i], [&, i]() { actual[i] = now; });
+    }
+
+    // The time advances unevenly, as in a busy message loop.
+    while (!wheel.empty())
+    {
+        now += Milliseconds(distribution(random) % 700);
+        wheel.advance(now);
+    }
+
+    for (size_t i = 0; i < kCount; ++i)
+    {
+        // Each timer is called at the first advance after its tick.
+        EXPECT_GE(actual[i], expected[i]);
+        EXPECT_LT(actual[i], expected[i] + kTick + Milliseconds(700));
+    }
+}
+
+} // namespace base
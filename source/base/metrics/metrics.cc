@@ -0,0 +1,83 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/metrics/metrics.h"
+
+#include "base/logging.h"
+
+#include <algorithm>
+
+namespace base {
+
+namespace {
+
+size_t currentThreadSlot()
+{
+    static std::atomic<size_t> next_slot { 0 };
+    thread_local const size_t slot = next_slot.fetch_add(1, std::memory_order_relaxed);
+    return slot;
+}
+
+} // namespace
+
+void Counter::add(uint64_t value)
+{
+    slots_[currentThreadSlot() % kSlotCount].value.fetch_add(value, std::memory_order_relaxed);
+}
+
+uint64_t Counter::value() const
+{
+    uint64_t result = 0;
+
+    for (const Slot& slot : slots_)
+        result += slot.value.load(std::memory_order_relaxed);
+
+    return result;
+}
+
+Histogram::Histogram(std::vector<uint64_t> bounds)
+    : bounds_(std::move(bounds)),
+      counts_(std::make_unique<std::atomic<uint64_t>[]>(bounds_.size() + 1))
+{
+    DCHECK(std::is_sorted(bounds_.begin(), bounds_.end()));
+
+    for (size_t i = 0; i <= bounds_.size(); ++i)
+        counts_[i].store(0, std::memory_order_relaxed);
+}
+
+void Histogram::add(uint64_t value)
+{
+    const size_t index = static_cast<size_t>(
+        std::lower_bound(bounds_.begin(), bounds_.end(), value) - bounds_.begin());
+
+    counts_[index].fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::vector<uint64_t> Histogram::counts() const
+{
+    std::vector<uint64_t> result(bounds_.size() + 1);
+
+    for (size_t i = 0; i < result.size(); ++i)
+        result[i] = counts_[i].load(std::memory_order_relaxed);
+
+    return result;
+}
+
+} // namespace base
@@ -0,0 +1,103 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_METRICS_METRICS_H
+#define BASE_METRICS_METRICS_H
+
+#include "base/macros_magic.h"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace base {
+
+// Monotonic counter. Each thread adds to its own slot, so threads that count often do not contend
+// for one cache line. The value is the sum of the slots.
+class Counter
+{
+public:
+    Counter() = default;
+    ~Counter() = default;
+
+    void add(uint64_t value = 1);
+    uint64_t value() const;
+
+private:
+    static const size_t kSlotCount = 16;
+
+    struct alignas(64) Slot
+    {
+        std::atomic<uint64_t> value { 0 };
+    };
+
+    std::array<Slot, kSlotCount> slots_;
+
+    DISALLOW_COPY_AND_ASSIGN(Counter);
+};
+
+// Value that can go up and down, for example the number of sessions or the depth of a queue.
+class Gauge
+{
+public:
+    Gauge() = default;
+    ~Gauge() = default;
+
+    void set(int64_t value) { value_.store(value, std::memory_order_relaxed); }
+    void add(int64_t value) { value_.fetch_add(value, std::memory_order_relaxed); }
+    void increment() { add(1); }
+    void decrement() { add(-1); }
+    int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> value_ { 0 };
+
+    DISALLOW_COPY_AND_ASSIGN(Gauge);
+};
+
+// Histogram with fixed bucket bounds. Values can be added from any thread.
+class Histogram
+{
+public:
+    // |bounds| are the inclusive upper bounds of the buckets in ascending order. Values greater
+    // than the last bound are counted in an additional bucket.
+    explicit Histogram(std::vector<uint64_t> bounds);
+    ~Histogram() = default;
+
+    void add(uint64_t value);
+
+    const std::vector<uint64_t>& bounds() const { return bounds_; }
+
+    // Returns the number of values in each bucket. The last element is the overflow bucket.
+    std::vector<uint64_t> counts() const;
+    uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+
+private:
+    const std::vector<uint64_t> bounds_;
+    std::unique_ptr<std::atomic<uint64_t>[]> counts_;
+    std::atomic<uint64_t> sum_ { 0 };
+    std::atomic<uint64_t> count_ { 0 };
+
+    DISALLOW_COPY_AND_ASSIGN(Histogram);
+};
+
+} // namespace base
+
+#endif // BASE_METRICS_METRICS_H
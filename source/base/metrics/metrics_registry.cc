@@ -0,0 +1,193 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/metrics/metrics_registry.h"
+
+#include "base/logging.h"
+#include "base/metrics/prometheus_text.h"
+
+namespace base {
+
+namespace {
+
+void appendJsonKey(std::string* json, std::string_view name, std::string_view labels,
+                   std::string_view suffix)
+{
+    if (json->size() > 1)
+        json->append(",");
+
+    json->append("\"").append(name);
+
+    if (!labels.empty())
+    {
+        // The quotes of the label values are replaced, so the key is a valid JSON string.
+        json->append("{");
+        for (char ch : labels)
+            json->push_back(ch == '"' ? '\'' : ch);
+        json->append("}");
+    }
+
+    json->append(suffix).append("\":");
+}
+
+} // namespace
+
+// static
+MetricsRegistry& MetricsRegistry::global()
+{
+    static MetricsRegistry* registry = new MetricsRegistry();
+    return *registry;
+}
+
+Counter* MetricsRegistry::counter(std::string_view name, std::string_view help,
+                                  std::string_view labels)
+{
+    Metric* result = metric(name, help, labels, Type::COUNTER, 1.0);
+    if (!result->counter)
+        result->counter = std::make_unique<Counter>();
+    return result->counter.get();
+}
+
+Gauge* MetricsRegistry::gauge(std::string_view name, std::string_view help,
+                              std::string_view labels)
+{
+    Metric* result = metric(name, help, labels, Type::GAUGE, 1.0);
+    if (!result->gauge)
+        result->gauge = std::make_unique<Gauge>();
+    return result->gauge.get();
+}
+
+Histogram* MetricsRegistry::histogram(std::string_view name, std::string_view help,
+                                      std::vector<uint64_t> bounds, double scale,
+                                      std::string_view labels)
+{
+    Metric* result = metric(name, help, labels, Type::HISTOGRAM, scale);
+    if (!result->histogram)
+        result->histogram = std::make_unique<Histogram>(std::move(bounds));
+    return result->histogram.get();
+}
+
+std::string MetricsRegistry::toPrometheusText() const
+{
+    std::scoped_lock lock(lock_);
+    std::string text;
+
+    for (const auto& [name, family] : families_)
+    {
+        appendPrometheusHeader(&text, name, typeName(family.type), family.help);
+
+        // A metric of another type than the family is not exported.
+        for (const auto& [labels, metric] : family.metrics)
+        {
+            if (family.type == Type::COUNTER && metric.counter)
+            {
+                appendPrometheusValue(&text, name, labels,
+                                      static_cast<double>(metric.counter->value()));
+            }
+            else if (family.type == Type::GAUGE && metric.gauge)
+            {
+                appendPrometheusValue(&text, name, labels,
+                                      static_cast<double>(metric.gauge->value()));
+            }
+            else if (family.type == Type::HISTOGRAM && metric.histogram)
+            {
+                appendPrometheusHistogram(&text, name, labels, *metric.histogram, family.scale);
+            }
+        }
+    }
+
+    return text;
+}
+
+std::string MetricsRegistry::toJson() const
+{
+    std::scoped_lock lock(lock_);
+    std::string json = "{";
+
+    for (const auto& [name, family] : families_)
+    {
+        for (const auto& [labels, metric] : family.metrics)
+        {
+            if (family.type == Type::COUNTER && metric.counter)
+            {
+                appendJsonKey(&json, name, labels, std::string_view());
+                json.append(std::to_string(metric.counter->value()));
+            }
+            else if (family.type == Type::GAUGE && metric.gauge)
+            {
+                appendJsonKey(&json, name, labels, std::string_view());
+                json.append(std::to_string(metric.gauge->value()));
+            }
+            else if (family.type == Type::HISTOGRAM && metric.histogram)
+            {
+                appendJsonKey(&json, name, labels, "_count");
+                json.append(std::to_string(metric.histogram->count()));
+                appendJsonKey(&json, name, labels, "_sum");
+                json.append(std::to_string(metric.histogram->sum()));
+            }
+        }
+    }
+
+    json.append("}");
+    return json;
+}
+
+// static
+const char* MetricsRegistry::typeName(Type type)
+{
+    switch (type)
+    {
+        case Type::COUNTER:
+            return "counter";
+
+        case Type::GAUGE:
+            return "gauge";
+
+        case Type::HISTOGRAM:
+            return "histogram";
+
+        default:
+            return "untyped";
+    }
+}
+
+MetricsRegistry::Metric* MetricsRegistry::metric(
+    std::string_view name, std::string_view help, std::string_view labels, Type type, double scale)
+{
+    std::scoped_lock lock(lock_);
+
+    auto family = families_.find(name);
+    if (family == families_.end())
+    {
+        family = families_.emplace(std::string(name), Family()).first;
+        family->second.type = type;
+        family->second.help = std::string(help);
+        family->second.scale = scale;
+    }
+
+    if (family->second.type != type)
+        LOG(LS_ERROR) << "Metric '" << name << "' is registered with another type";
+
+    auto metric = family->second.metrics.find(labels);
+    if (metric == family->second.metrics.end())
+        metric = family->second.metrics.emplace(std::string(labels), Metric()).first;
+
+    return &metric->second;
+}
+
+} // namespace base
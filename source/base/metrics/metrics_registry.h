@@ -0,0 +1,95 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_METRICS_METRICS_REGISTRY_H
+#define BASE_METRICS_METRICS_REGISTRY_H
+
+#include "base/metrics/metrics.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace base {
+
+// Named metrics for the export. The metrics are created on the first request and live as long
+// as the registry, so the callers keep the pointers and update the metrics without a lookup.
+// Registration and export are thread-safe.
+class MetricsRegistry
+{
+public:
+    MetricsRegistry() = default;
+    ~MetricsRegistry() = default;
+
+    // Registry of the process. It is never destroyed, so the metrics can be updated at any time.
+    static MetricsRegistry& global();
+
+    // |name| must follow the Prometheus naming rules. Metrics with the same name and different
+    // |labels| (for example "type=\"host\"") share the help and must have the same type.
+    Counter* counter(std::string_view name, std::string_view help,
+                     std::string_view labels = std::string_view());
+    Gauge* gauge(std::string_view name, std::string_view help,
+                 std::string_view labels = std::string_view());
+
+    // The values are multiplied by |scale| in the export, so they can be added in integer units
+    // (for example microseconds) and exported in the base units (seconds). The bounds of an
+    // already created histogram are not changed.
+    Histogram* histogram(std::string_view name, std::string_view help,
+                         std::vector<uint64_t> bounds, double scale = 1.0,
+                         std::string_view labels = std::string_view());
+
+    // Returns all metrics in the Prometheus text format.
+    std::string toPrometheusText() const;
+
+    // Returns the values of counters and gauges and the count and sum of histograms as one JSON
+    // object for the log.
+    std::string toJson() const;
+
+private:
+    enum class Type { COUNTER, GAUGE, HISTOGRAM };
+
+    struct Metric
+    {
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+    };
+
+    struct Family
+    {
+        Type type;
+        std::string help;
+        double scale = 1.0;
+        std::map<std::string, Metric, std::less<>> metrics; // By labels.
+    };
+
+    static const char* typeName(Type type);
+
+    Metric* metric(std::string_view name, std::string_view help, std::string_view labels,
+                   Type type, double scale);
+
+    mutable std::mutex lock_;
+    std::map<std::string, Family, std::less<>> families_;
+
+    DISALLOW_COPY_AND_ASSIGN(MetricsRegistry);
+};
+
+} // namespace base
+
+#endif // BASE_METRICS_METRICS_REGISTRY_H
@@ -0,0 +1,75 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/metrics/metrics_registry.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+TEST(MetricsRegistry, SameMetric)
+{
+    MetricsRegistry registry;
+
+    Counter* first = registry.counter("test_total", "Test counter", "type=\"a\"");
+    Counter* second = registry.counter("test_total", "Test counter", "type=\"a\"");
+    Counter* third = registry.counter("test_total", "Test counter", "type=\"b\"");
+
+    EXPECT_EQ(first, second);
+    EXPECT_NE(first, third);
+
+    Gauge* gauge = registry.gauge("test_gauge", "Test gauge");
+    EXPECT_EQ(gauge, registry.gauge("test_gauge", "Test gauge"));
+}
+
+TEST(MetricsRegistry, PrometheusText)
+{
+    MetricsRegistry registry;
+
+    registry.counter("test_total", "Test counter", "type=\"a\"")->add(3);
+    registry.gauge("test_gauge", "Test gauge")->set(-2);
+    registry.histogram("test_seconds", "Test histogram", { 1000, 10000 }, 1e-6)->add(5000);
+
+    const std::string text = registry.toPrometheusText();
+
+    EXPECT_NE(text.find("# HELP test_total Test counter\n"), std::string::npos);
+    EXPECT_NE(text.find("# TYPE test_total counter\n"), std::string::npos);
+    EXPECT_NE(text.find("test_total{type=\"a\"} 3\n"), std::string::npos);
+
+    EXPECT_NE(text.find("# TYPE test_gauge gauge\n"), std::string::npos);
+    EXPECT_NE(text.find("test_gauge -2\n"), std::string::npos);
+
+    EXPECT_NE(text.find("# TYPE test_seconds histogram\n"), std::string::npos);
+    EXPECT_NE(text.find("test_seconds_bucket{le=\"0.001\"} 0\n"), std::string::npos);
+    EXPECT_NE(text.find("test_seconds_bucket{le=\"0.01\"} 1\n"), std::string::npos);
+    EXPECT_NE(text.find("test_seconds_bucket{le=\"+Inf\"} 1\n"), std::string::npos);
+    EXPECT_NE(text.find("test_seconds_sum 0.005\n"), std::string::npos);
+    EXPECT_NE(text.find("test_seconds_count 1\n"), std::string::npos);
+}
+
+TEST(MetricsRegistry, Json)
+{
+    MetricsRegistry registry;
+    EXPECT_EQ(registry.toJson(), "{}");
+
+    registry.counter("test_total", "Test counter", "type=\"a\"")->add(3);
+    registry.gauge("test_gauge", "Test gauge")->set(7);
+
+    EXPECT_EQ(registry.toJson(), "{\"test_gauge\":7,\"test_total{type='a'}\":3}");
+}
+
+} // namespace base
@@ -0,0 +1,95 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/metrics/metrics.h"
+
+#include <thread>
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+TEST(Metrics, Counter)
+{
+    Counter counter;
+    EXPECT_EQ(counter.value(), 0u);
+
+    counter.add();
+    counter.add(10);
+    EXPECT_EQ(counter.value(), 11u);
+}
+
+TEST(Metrics, CounterThreads)
+{
+    static const int kThreadCount = 8;
+    static const int kAddCount = 10000;
+
+    Counter counter;
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < kThreadCount; ++i)
+    {
+        threads.emplace_back([&counter]()
+        {
+            for (int j = 0; j < kAddCount; ++j)
+                counter.add();
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    EXPECT_EQ(counter.value(), static_cast<uint64_t>(kThreadCount * kAddCount));
+}
+
+TEST(Metrics, Gauge)
+{
+    Gauge gauge;
+    EXPECT_EQ(gauge.value(), 0);
+
+    gauge.increment();
+    gauge.increment();
+    gauge.decrement();
+    EXPECT_EQ(gauge.value(), 1);
+
+    gauge.add(-5);
+    EXPECT_EQ(gauge.value(), -4);
+
+    gauge.set(100);
+    EXPECT_EQ(gauge.value(), 100);
+}
+
+TEST(Metrics, Histogram)
+{
+    Histogram histogram({ 10, 100 });
+
+    histogram.add(0);
+    histogram.add(10);
+    histogram.add(11);
+    histogram.add(1000);
+
+    std::vector<uint64_t> counts = histogram.counts();
+    ASSERT_EQ(counts.size(), 3u);
+    EXPECT_EQ(counts[0], 2u);
+    EXPECT_EQ(counts[1], 1u);
+    EXPECT_EQ(counts[2], 1u);
+
+    EXPECT_EQ(histogram.count(), 4u);
+    EXPECT_EQ(histogram.sum(), 1021u);
+}
+
+} // namespace base
@@ -0,0 +1,96 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/metrics/prometheus_text.h"
+
+#include "base/metrics/metrics.h"
+
+#include <cmath>
+#include <cstdio>
+
+namespace base {
+
+namespace {
+
+std::string formatNumber(double value)
+{
+    if (value == std::floor(value) && std::fabs(value) < 1e15)
+        return std::to_string(static_cast<int64_t>(value));
+
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.9g", value);
+    return buffer;
+}
+
+std::string joinLabels(std::string_view first, std::string_view second)
+{
+    std::string result(first);
+
+    if (!result.empty() && !second.empty())
+        result += ',';
+
+    result.append(second);
+    return result;
+}
+
+} // namespace
+
+void appendPrometheusHeader(std::string* text, std::string_view name, std::string_view type,
+                            std::string_view help)
+{
+    text->append("# HELP ").append(name).append(" ").append(help).append("\n");
+    text->append("# TYPE ").append(name).append(" ").append(type).append("\n");
+}
+
+void appendPrometheusValue(std::string* text, std::string_view name, std::string_view labels,
+                           double value)
+{
+    text->append(name);
+    if (!labels.empty())
+        text->append("{").append(labels).append("}");
+    text->append(" ").append(formatNumber(value)).append("\n");
+}
+
+void appendPrometheusHistogram(std::string* text, std::string_view name, std::string_view labels,
+                               const Histogram& histogram, double scale)
+{
+    const std::string bucket_name = std::string(name) + "_bucket";
+    const std::vector<uint64_t>& bounds = histogram.bounds();
+    const std::vector<uint64_t> counts = histogram.counts();
+
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < bounds.size(); ++i)
+    {
+        cumulative += counts[i];
+
+        const std::string bound = formatNumber(static_cast<double>(bounds[i]) * scale);
+        appendPrometheusValue(text, bucket_name, joinLabels(labels, "le=\"" + bound + "\""),
+                              static_cast<double>(cumulative));
+    }
+
+    cumulative += counts.back();
+    appendPrometheusValue(text, bucket_name, joinLabels(labels, "le=\"+Inf\""),
+                          static_cast<double>(cumulative));
+
+    appendPrometheusValue(text, std::string(name) + "_sum", labels,
+                          static_cast<double>(histogram.sum()) * scale);
+    appendPrometheusValue(text, std::string(name) + "_count", labels,
+                          static_cast<double>(histogram.count()));
+}
+
+} // namespace base
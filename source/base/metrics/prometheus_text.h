@@ -0,0 +1,43 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_METRICS_PROMETHEUS_TEXT_H
+#define BASE_METRICS_PROMETHEUS_TEXT_H
+
+#include <string>
+#include <string_view>
+
+namespace base {
+
+class Histogram;
+
+// Helpers for the Prometheus text exposition format. |labels| are written as is, for example
+// "session_id=\"1\"", and can be empty.
+void appendPrometheusHeader(std::string* text, std::string_view name, std::string_view type,
+                            std::string_view help);
+void appendPrometheusValue(std::string* text, std::string_view name, std::string_view labels,
+                           double value);
+
+// Writes the buckets, the sum and the count of |histogram| without the header. |scale| converts
+// the values of the histogram to the unit of the metric.
+void appendPrometheusHistogram(std::string* text, std::string_view name, std::string_view labels,
+                               const Histogram& histogram, double scale);
+
+} // namespace base
+
+#endif // BASE_METRICS_PROMETHEUS_TEXT_H
@@ -0,0 +1,314 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/net/congestion_controller.h"
+
+#include "base/logging.h"
+
+#include <algorithm>
+
+namespace base {
+
+namespace {
+
+const double kStartupGain = 2.885;
+const double kDrainGain = 1.0 / kStartupGain;
+const double kCwndGain = 2.0;
+
+// Gains of the PROBE_BW cycle: probing for more bandwidth, draining the queue and cruising. Each
+// phase lasts one round.
+const double kProbeBwGains[] = { 1.25, 0.75, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0 };
+const size_t kProbeBwGainCount = sizeof(kProbeBwGains) / sizeof(kProbeBwGains[0]);
+
+// The bandwidth estimate is the maximum delivery rate over this number of rounds.
+const uint64_t kBandwidthWindowRounds = 10;
+
+// The startup ends if the bandwidth has not grown by 25% within three rounds.
+const double kStartupGrowthTarget = 1.25;
+const int kStartupFullRounds = 3;
+
+const std::chrono::seconds kMinRttWindow { 10 };
+const std::chrono::milliseconds kProbeRttDuration { 200 };
+const std::chrono::milliseconds kInitialRtt { 100 };
+const std::chrono::milliseconds kMinRateInterval { 10 };
+
+const size_t kMinCwndPackets = 4;
+const size_t kInitialCwndPackets = 32;
+const int64_t kMinPacingRate = 16 * 1024; // 16 kB/s
+
+// If more packets are lost within a round, then the data in flight is reduced.
+const double kLossThreshold = 0.02;
+const double kStartupLossThreshold = 0.05;
+const double kLossReduction = 0.7;
+const double kLossSmoothing = 0.125;
+
+} // namespace
+
+CongestionController::CongestionController(size_t mss)
+    : mss_(mss)
+{
+    DCHECK_GT(mss_, 0u);
+}
+
+void CongestionController::setMss(size_t mss)
+{
+    DCHECK_GT(mss, 0u);
+    mss_ = mss;
+}
+
+void CongestionController::onSample(const Sample& sample)
+{
+    if (!has_samples_)
+    {
+        has_samples_ = true;
+        rate_start_time_ = sample.time;
+        round_start_time_ = sample.time;
+        min_rtt_time_ = sample.time;
+    }
+
+    if (sample.sent_packets)
+    {
+        double loss = std::min(static_cast<double>(sample.lost_packets) / sample.sent_packets, 1.0);
+        loss_rate_ += (loss - loss_rate_) * kLossSmoothing;
+    }
+
+    round_sent_packets_ += sample.sent_packets;
+    round_lost_packets_ += sample.lost_packets;
+
+    updateMinRtt(sample);
+    updateBandwidth(sample);
+    updateRound(sample);
+    updateState(sample);
+}
+
+int64_t CongestionController::bandwidth() const
+{
+    if (bandwidth_samples_.empty())
+    {
+        return static_cast<int64_t>(kInitialCwndPackets * mss_) * 1000 / kInitialRtt.count();
+    }
+
+    return bandwidth_samples_.front().rate;
+}
+
+int64_t CongestionController::pacingRate() const
+{
+    return std::max(static_cast<int64_t>(static_cast<double>(bandwidth()) * pacingGain()),
+                    kMinPacingRate);
+}
+
+size_t CongestionController::congestionWindow() const
+{
+    const size_t min_cwnd = kMinCwndPackets * mss_;
+
+    if (state_ == State::PROBE_RTT)
+        return min_cwnd;
+
+    double gain = (state_ == State::PROBE_BW) ? kCwndGain : kStartupGain;
+    size_t cwnd = static_cast<size_t>(static_cast<double>(bdp()) * gain);
+
+    if (inflight_limit_)
+        cwnd = std::min(cwnd, inflight_limit_);
+
+    return std::max(cwnd, min_cwnd);
+}
+
+CongestionController::Milliseconds CongestionController::minRtt() const
+{
+    return min_rtt_.count() ? min_rtt_ : kInitialRtt;
+}
+
+void CongestionController::updateMinRtt(const Sample& sample)
+{
+    if (!sample.rtt.count())
+        return;
+
+    const bool expired = sample.time - min_rtt_time_ > kMinRttWindow;
+
+    if (!min_rtt_.count() || sample.rtt <= min_rtt_ || (expired && state_ != State::PROBE_RTT))
+    {
+        min_rtt_ = sample.rtt;
+        min_rtt_time_ = sample.time;
+    }
+
+    // The minimum was not confirmed for a long time. The queue on the path may hide it, so the data
+    // in flight is reduced for a short time.
+    if (expired && state_ != State::PROBE_RTT)
+    {
+        LOG(LS_INFO) << "Enter PROBE_RTT (min RTT: " << min_rtt_.count() << " ms)";
+        state_ = State::PROBE_RTT;
+        probe_rtt_done_time_ = sample.time + kProbeRttDuration;
+    }
+}
+
+void CongestionController::updateBandwidth(const Sample& sample)
+{
+    rate_bytes_ += sample.delivered_bytes;
+
+    const auto interval = std::chrono::duration_cast<std::chrono::microseconds>(
+        sample.time - rate_start_time_);
+    if (interval < std::max(Milliseconds(minRtt() / 2), kMinRateInterval))
+        return;
+
+    const int64_t rate = static_cast<int64_t>(rate_bytes_) * 1000000 / interval.count();
+
+    rate_start_time_ = sample.time;
+    rate_bytes_ = 0;
+
+    // If the sender does not have enough data to fill the window, then the rate is limited by the
+    // application and not by the path. Such samples do not lower the estimate.
+    const bool app_limited = sample.inflight_bytes < congestionWindow() / 2;
+    if (app_limited && !bandwidth_samples_.empty() && rate < bandwidth())
+        return;
+
+    while (!bandwidth_samples_.empty() && bandwidth_samples_.back().rate <= rate)
+        bandwidth_samples_.pop_back();
+
+    bandwidth_samples_.push_back({ round_count_, rate });
+}
+
+void CongestionController::updateRound(const Sample& sample)
+{
+    if (sample.time - round_start_time_ < minRtt())
+        return;
+
+    round_start_time_ = sample.time;
+    ++round_count_;
+
+    while (bandwidth_samples_.size() > 1 &&
+           bandwidth_samples_.front().round + kBandwidthWindowRounds <= round_count_)
+    {
+        bandwidth_samples_.pop_front();
+    }
+
+    onRoundFinished();
+
+    round_sent_packets_ = 0;
+    round_lost_packets_ = 0;
+}
+
+void CongestionController::updateState(const Sample& sample)
+{
+    switch (state_)
+    {
+        case State::DRAIN:
+        {
+            if (sample.inflight_bytes <= bdp())
+            {
+                LOG(LS_INFO) << "Enter PROBE_BW (bandwidth: " << bandwidth() << " B/s)";
+                state_ = State::PROBE_BW;
+                cycle_index_ = 0;
+            }
+        }
+        break;
+
+        case State::PROBE_RTT:
+        {
+            if (sample.time >= probe_rtt_done_time_)
+            {
+                min_rtt_time_ = sample.time;
+                state_ = full_bandwidth_rounds_ >= kStartupFullRounds ?
+                    State::PROBE_BW : State::STARTUP;
+            }
+        }
+        break;
+
+        default:
+            break;
+    }
+}
+
+void CongestionController::onRoundFinished()
+{
+    const double round_loss = round_sent_packets_ ?
+        static_cast<double>(round_lost_packets_) / round_sent_packets_ : 0;
+
+    switch (state_)
+    {
+        case State::STARTUP:
+        {
+            if (bandwidth() >= static_cast<int64_t>(full_bandwidth_ * kStartupGrowthTarget))
+            {
+                full_bandwidth_ = bandwidth();
+                full_bandwidth_rounds_ = 0;
+            }
+            else
+            {
+                ++full_bandwidth_rounds_;
+            }
+
+            if (full_bandwidth_rounds_ >= kStartupFullRounds || round_loss > kStartupLossThreshold)
+            {
+                LOG(LS_INFO) << "Enter DRAIN (bandwidth: " << bandwidth() << " B/s, loss: "
+                             << round_loss << ")";
+                full_bandwidth_rounds_ = kStartupFullRounds;
+                state_ = State::DRAIN;
+            }
+        }
+        break;
+
+        case State::PROBE_BW:
+            cycle_index_ = (cycle_index_ + 1) % kProbeBwGainCount;
+            break;
+
+        default:
+            break;
+    }
+
+    if (round_loss > kLossThreshold)
+    {
+        // The path drops packets when there is too much data in flight.
+        inflight_limit_ = std::max(static_cast<size_t>(
+            static_cast<double>(congestionWindow()) * kLossReduction), kMinCwndPackets * mss_);
+    }
+    else if (inflight_limit_)
+    {
+        // Slowly return to the window defined by the bandwidth.
+        inflight_limit_ += mss_;
+        if (inflight_limit_ >= static_cast<size_t>(static_cast<double>(bdp()) * kCwndGain))
+            inflight_limit_ = 0;
+    }
+}
+
+double CongestionController::pacingGain() const
+{
+    switch (state_)
+    {
+        case State::STARTUP:
+            return kStartupGain;
+
+        case State::DRAIN:
+            return kDrainGain;
+
+        case State::PROBE_BW:
+            return kProbeBwGains[cycle_index_];
+
+        default:
+            return 1.0;
+    }
+}
+
+size_t CongestionController::bdp() const
+{
+    if (bandwidth_samples_.empty())
+        return kInitialCwndPackets * mss_;
+
+    return static_cast<size_t>(bandwidth() * minRtt().count() / 1000);
+}
+
+} // namespace base
@@ -0,0 +1,145 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_NET_CONGESTION_CONTROLLER_H
+#define BASE_NET_CONGESTION_CONTROLLER_H
+
+#include "base/macros_magic.h"
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+
+namespace base {
+
+// BBR-like congestion controller for datagram transports. Instead of reacting to each loss, it
+// estimates the bottleneck bandwidth and the minimum round-trip time of the path and sends the data
+// at the rate the path can deliver it. The transport feeds the controller with delivery samples at
+// regular intervals and uses the pacing rate and the congestion window which it returns.
+class CongestionController
+{
+public:
+    using Clock = std::chrono::high_resolution_clock;
+    using TimePoint = std::chrono::time_point<Clock>;
+    using Milliseconds = std::chrono::milliseconds;
+
+    enum class State
+    {
+        STARTUP,  // Exponential search for the bandwidth of the path.
+        DRAIN,    // Draining the queue created during the startup.
+        PROBE_BW, // Sending at the estimated bandwidth with periodic probing.
+        PROBE_RTT // Short period with a minimum window to measure the minimum RTT.
+    };
+
+    struct Sample
+    {
+        TimePoint time;
+
+        // Bytes acknowledged since the previous sample.
+        size_t delivered_bytes = 0;
+
+        // Bytes sent but not yet acknowledged.
+        size_t inflight_bytes = 0;
+
+        // Round-trip time measured by the transport. Zero if not measured yet.
+        Milliseconds rtt { 0 };
+
+        // Packets sent since the previous sample, including retransmissions.
+        uint32_t sent_packets = 0;
+
+        // Packets retransmitted by timeout since the previous sample.
+        uint32_t lost_packets = 0;
+    };
+
+    explicit CongestionController(size_t mss);
+    ~CongestionController() = default;
+
+    void setMss(size_t mss);
+    void onSample(const Sample& sample);
+
+    State state() const { return state_; }
+
+    // Estimated bandwidth of the path in bytes per second.
+    int64_t bandwidth() const;
+
+    // Rate at which data should be sent in bytes per second.
+    int64_t pacingRate() const;
+
+    // Maximum amount of data in flight in bytes.
+    size_t congestionWindow() const;
+
+    Milliseconds minRtt() const;
+
+    // Smoothed share of the lost packets (from 0 to 1).
+    double lossRate() const { return loss_rate_; }
+
+private:
+    struct BandwidthSample
+    {
+        uint64_t round;
+        int64_t rate;
+    };
+
+    void updateMinRtt(const Sample& sample);
+    void updateBandwidth(const Sample& sample);
+    void updateRound(const Sample& sample);
+    void updateState(const Sample& sample);
+    void onRoundFinished();
+    double pacingGain() const;
+    size_t bdp() const;
+
+    size_t mss_;
+    State state_ = State::STARTUP;
+
+    // Minimum RTT and the time when it was measured.
+    Milliseconds min_rtt_ { 0 };
+    TimePoint min_rtt_time_;
+    TimePoint probe_rtt_done_time_;
+
+    // Windowed maximum of the delivery rate. The first sample is the maximum.
+    std::deque<BandwidthSample> bandwidth_samples_;
+
+    // The delivery rate is measured over intervals of about one RTT to smooth out the bursts of
+    // acknowledgements.
+    TimePoint rate_start_time_;
+    size_t rate_bytes_ = 0;
+
+    // A round is approximated by the minimum RTT.
+    uint64_t round_count_ = 0;
+    TimePoint round_start_time_;
+    uint32_t round_sent_packets_ = 0;
+    uint32_t round_lost_packets_ = 0;
+
+    // Detection of the end of the startup.
+    int64_t full_bandwidth_ = 0;
+    int full_bandwidth_rounds_ = 0;
+
+    size_t cycle_index_ = 0;
+
+    // Upper limit of the data in flight after losses. Zero if there is no limit.
+    size_t inflight_limit_ = 0;
+
+    double loss_rate_ = 0;
+    bool has_samples_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(CongestionController);
+};
+
+} // namespace base
+
+#endif // BASE_NET_CONGESTION_CONTROLLER_H
@@ -0,0 +1,229 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/net/datagram_fec.h"
+
+#include "base/endian_util.h"
+#include "base/logging.h"
+
+#include <cstring>
+
+namespace base {
+
+namespace {
+
+const uint8_t kParityIndex = 0xFF;
+
+// Number of recent groups for which the decoder keeps the datagrams.
+const size_t kMaxGroups = 32;
+
+void writeHeader(uint8_t* buffer, uint32_t group, uint8_t index, uint8_t count)
+{
+    uint32_t group_be = EndianUtil::toBig(group);
+    memcpy(buffer, &group_be, sizeof(group_be));
+    buffer[4] = index;
+    buffer[5] = count;
+}
+
+void xorBlock(uint8_t* target, const uint8_t* source, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+        target[i] ^= source[i];
+}
+
+void xorDatagram(ByteArray* parity, const uint8_t* data, size_t size)
+{
+    if (parity->size() < sizeof(uint16_t) + size)
+        parity->resize(sizeof(uint16_t) + size);
+
+    uint16_t size_be = EndianUtil::toBig(static_cast<uint16_t>(size));
+    xorBlock(parity->data(), reinterpret_cast<const uint8_t*>(&size_be), sizeof(size_be));
+    xorBlock(parity->data() + sizeof(uint16_t), data, size);
+}
+
+} // namespace
+
+DatagramFecEncoder::DatagramFecEncoder(size_t group_size)
+    : group_size_(group_size)
+{
+    DCHECK_GT(group_size_, 0u);
+    DCHECK_LE(group_size_, kMaxGroupSize);
+}
+
+void DatagramFecEncoder::encode(const uint8_t* data, size_t size, std::deque<ByteArray>* output)
+{
+    DCHECK(output);
+    DCHECK_LE(size, 0xFFFFu);
+
+    ByteArray datagram;
+    datagram.resize(kHeaderSize + size);
+
+    // The number of datagrams in the group is known only to the parity datagram.
+    writeHeader(datagram.data(), group_, static_cast<uint8_t>(index_), 0);
+    memcpy(datagram.data() + kHeaderSize, data, size);
+    output->emplace_back(std::move(datagram));
+
+    xorDatagram(&parity_, data, size);
+
+    if (++index_ >= group_size_)
+        flush(output);
+}
+
+void DatagramFecEncoder::flush(std::deque<ByteArray>* output)
+{
+    DCHECK(output);
+
+    if (!index_)
+        return;
+
+    ByteArray datagram;
+    datagram.resize(kHeaderSize + parity_.size());
+
+    writeHeader(datagram.data(), group_, kParityIndex, static_cast<uint8_t>(index_));
+    memcpy(datagram.data() + kHeaderSize, parity_.data(), parity_.size());
+    output->emplace_back(std::move(datagram));
+
+    parity_.clear();
+    index_ = 0;
+    ++group_;
+}
+
+DatagramFecDecoder::DatagramFecDecoder() = default;
+
+bool DatagramFecDecoder::decode(const uint8_t* data, size_t size, const Callback& callback)
+{
+    if (size < DatagramFecEncoder::kHeaderSize)
+        return false;
+
+    uint32_t number;
+    memcpy(&number, data, sizeof(number));
+    number = EndianUtil::fromBig(number);
+
+    const uint8_t index = data[4];
+    const uint8_t count = data[5];
+
+    const uint8_t* payload = data + DatagramFecEncoder::kHeaderSize;
+    const size_t payload_size = size - DatagramFecEncoder::kHeaderSize;
+
+    if (index == kParityIndex)
+    {
+        if (!count || count > DatagramFecEncoder::kMaxGroupSize ||
+            payload_size < sizeof(uint16_t))
+        {
+            return false;
+        }
+
+        Group* current = group(number);
+        if (!current || current->done)
+            return true;
+
+        current->count = count;
+        current->parity = fromData(payload, payload_size);
+
+        tryRestore(current, callback);
+        return true;
+    }
+
+    if (index >= DatagramFecEncoder::kMaxGroupSize)
+        return false;
+
+    callback(payload, payload_size);
+
+    Group* current = group(number);
+    if (!current || current->done)
+        return true;
+
+    if (!current->has_datagram[index])
+    {
+        current->datagrams[index] = fromData(payload, payload_size);
+        current->has_datagram[index] = true;
+        ++current->received;
+    }
+
+    tryRestore(current, callback);
+    return true;
+}
+
+DatagramFecDecoder::Group* DatagramFecDecoder::group(uint32_t number)
+{
+    for (auto& group : groups_)
+    {
+        if (group.number == number)
+            return &group;
+    }
+
+    // The group is too old, its datagrams were already discarded.
+    if (!groups_.empty() &&
+        static_cast<int32_t>(number - groups_.back().number) < -static_cast<int32_t>(kMaxGroups))
+    {
+        return nullptr;
+    }
+
+    if (groups_.size() >= kMaxGroups)
+        groups_.pop_front();
+
+    Group& group = groups_.emplace_back();
+    group.number = number;
+    group.datagrams.resize(DatagramFecEncoder::kMaxGroupSize);
+    group.has_datagram.resize(DatagramFecEncoder::kMaxGroupSize);
+    return &group;
+}
+
+void DatagramFecDecoder::tryRestore(Group* group, const Callback& callback)
+{
+    if (!group->count || group->parity.empty())
+        return;
+
+    // All datagrams were received or more than one is lost.
+    if (group->received != group->count - 1)
+    {
+        if (group->received >= group->count)
+        {
+            group->done = true;
+            group->datagrams.clear();
+            group->parity.clear();
+        }
+        return;
+    }
+
+    ByteArray restored = std::move(group->parity);
+
+    for (size_t i = 0; i < group->count; ++i)
+    {
+        if (group->has_datagram[i])
+            xorDatagram(&restored, group->datagrams[i].data(), group->datagrams[i].size());
+    }
+
+    group->done = true;
+    group->datagrams.clear();
+    group->parity.clear();
+
+    uint16_t restored_size;
+    memcpy(&restored_size, restored.data(), sizeof(restored_size));
+    restored_size = EndianUtil::fromBig(restored_size);
+
+    if (sizeof(uint16_t) + restored_size > restored.size())
+    {
+        LOG(LS_WARNING) << "Invalid restored datagram size: " << restored_size;
+        return;
+    }
+
+    callback(restored.data() + sizeof(uint16_t), restored_size);
+}
+
+} // namespace base
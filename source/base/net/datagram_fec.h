@@ -0,0 +1,103 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_NET_DATAGRAM_FEC_H
+#define BASE_NET_DATAGRAM_FEC_H
+
+#include "base/macros_magic.h"
+#include "base/memory/byte_array.h"
+
+#include <deque>
+#include <functional>
+
+namespace base {
+
+// Forward error correction for datagrams. After each group of datagrams the encoder sends a parity
+// datagram which is XOR of all datagrams of the group. If one datagram of the group is lost, then
+// the decoder restores it without waiting for a retransmission.
+//
+// Each datagram gets the header:
+// [group number (4 bytes, big endian)][index in the group (1 byte)][group size (1 byte)]
+// Parity datagrams have index 255 and contain XOR of [size (2 bytes)][data] of each
+// datagram of the group.
+class DatagramFecEncoder
+{
+public:
+    static constexpr size_t kHeaderSize = 6;
+
+    // Maximum size that FEC adds to the datagrams (the header and the size in parity datagrams).
+    static constexpr size_t kOverhead = kHeaderSize + sizeof(uint16_t);
+
+    static constexpr size_t kMaxGroupSize = 64;
+
+    explicit DatagramFecEncoder(size_t group_size);
+    ~DatagramFecEncoder() = default;
+
+    // Adds the datagram with the FEC header to |output|. If the group is complete, the parity
+    // datagram is added too.
+    void encode(const uint8_t* data, size_t size, std::deque<ByteArray>* output);
+
+    // Adds the parity datagram of an incomplete group to |output|. It is used when there is no
+    // data for a while so that the last datagrams are also protected.
+    void flush(std::deque<ByteArray>* output);
+
+private:
+    const size_t group_size_;
+
+    uint32_t group_ = 0;
+    size_t index_ = 0;
+    ByteArray parity_;
+
+    DISALLOW_COPY_AND_ASSIGN(DatagramFecEncoder);
+};
+
+class DatagramFecDecoder
+{
+public:
+    using Callback = std::function<void(const uint8_t* data, size_t size)>;
+
+    DatagramFecDecoder();
+    ~DatagramFecDecoder() = default;
+
+    // Calls |callback| for the data of the datagram and for the datagram restored with its help.
+    // Returns false if the datagram is malformed.
+    bool decode(const uint8_t* data, size_t size, const Callback& callback);
+
+private:
+    struct Group
+    {
+        uint32_t number = 0;
+        size_t count = 0; // Known after receiving the parity.
+        size_t received = 0;
+        bool done = false;
+        std::vector<ByteArray> datagrams;
+        std::vector<bool> has_datagram;
+        ByteArray parity;
+    };
+
+    Group* group(uint32_t number);
+    void tryRestore(Group* group, const Callback& callback);
+
+    std::deque<Group> groups_;
+
+    DISALLOW_COPY_AND_ASSIGN(DatagramFecDecoder);
+};
+
+} // namespace base
+
+#endif // BASE_NET_DATAGRAM_FEC_H
@@ -0,0 +1,134 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/net/datagram_fec.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+std::deque<ByteArray> encodeGroup(DatagramFecEncoder* encoder, const std::vector<ByteArray>& input)
+{
+    std::deque<ByteArray> output;
+
+    for (const auto& datagram : input)
+        encoder->encode(datagram.data(), datagram.size(), &output);
+
+    return output;
+}
+
+std::vector<ByteArray> decodeAll(DatagramFecDecoder* decoder, const std::deque<ByteArray>& input)
+{
+    std::vector<ByteArray> output;
+
+    for (const auto& datagram : input)
+    {
+        EXPECT_TRUE(decoder->decode(datagram.data(), datagram.size(),
+                                    [&](const uint8_t* data, size_t size)
+        {
+            output.emplace_back(fromData(data, size));
+        }));
+    }
+
+    return output;
+}
+
+} // namespace
+
+TEST(DatagramFecTest, NoLoss)
+{
+    const std::vector<ByteArray> input =
+        { fromStdString("first"), fromStdString("second datagram"), fromStdString("3") };
+
+    DatagramFecEncoder encoder(3);
+    std::deque<ByteArray> encoded = encodeGroup(&encoder, input);
+
+    // Three datagrams and the parity.
+    ASSERT_EQ(encoded.size(), 4u);
+
+    DatagramFecDecoder decoder;
+    EXPECT_EQ(decodeAll(&decoder, encoded), input);
+}
+
+TEST(DatagramFecTest, RestoreLost)
+{
+    const std::vector<ByteArray> input =
+        { fromStdString("first"), fromStdString("second datagram"), fromStdString("3") };
+
+    for (size_t lost = 0; lost < input.size(); ++lost)
+    {
+        DatagramFecEncoder encoder(3);
+        std::deque<ByteArray> encoded = encodeGroup(&encoder, input);
+        encoded.erase(encoded.begin() + static_cast<std::ptrdiff_t>(lost));
+
+        DatagramFecDecoder decoder;
+        std::vector<ByteArray> decoded = decodeAll(&decoder, encoded);
+
+        ASSERT_EQ(decoded.size(), input.size());
+        EXPECT_EQ(decoded.back(), input[lost]);
+    }
+}
+
+TEST(DatagramFecTest, TwoLost)
+{
+    const std::vector<ByteArray> input =
+        { fromStdString("first"), fromStdString("second"), fromStdString("third") };
+
+    DatagramFecEncoder encoder(3);
+    std::deque<ByteArray> encoded = encodeGroup(&encoder, input);
+    encoded.pop_front();
+    encoded.pop_front();
+
+    // Only the third datagram is received, the lost ones cannot be restored.
+    DatagramFecDecoder decoder;
+    std::vector<ByteArray> decoded = decodeAll(&decoder, encoded);
+    ASSERT_EQ(decoded.size(), 1u);
+    EXPECT_EQ(decoded[0], input[2]);
+}
+
+TEST(DatagramFecTest, Flush)
+{
+    DatagramFecEncoder encoder(8);
+
+    const ByteArray datagram = fromStdString("datagram");
+    std::deque<ByteArray> encoded = encodeGroup(&encoder, { datagram, datagram });
+    EXPECT_EQ(encoded.size(), 2u);
+
+    encoder.flush(&encoded);
+    ASSERT_EQ(encoded.size(), 3u);
+
+    // The first datagram is lost.
+    encoded.pop_front();
+
+    DatagramFecDecoder decoder;
+    std::vector<ByteArray> decoded = decodeAll(&decoder, encoded);
+    ASSERT_EQ(decoded.size(), 2u);
+    EXPECT_EQ(decoded[1], datagram);
+}
+
+TEST(DatagramFecTest, Malformed)
+{
+    DatagramFecDecoder decoder;
+    const uint8_t kShort[] = { 0, 0, 0 };
+
+    EXPECT_FALSE(decoder.decode(kShort, sizeof(kShort), [](const uint8_t*, size_t) {}));
+}
+
+} // namespace base
@@ -18,23 +18,90 @@
 
 #include "base/net/kcp_channel.h"
 
+#include "base/endian_util.h"
 #include "base/logging.h"
 #include "base/crypto/large_number_increment.h"
 #include "base/crypto/message_decryptor.h"
 #include "base/crypto/message_encryptor.h"
 #include "base/message_loop/message_loop.h"
 #include "base/message_loop/message_pump_asio.h"
+#include "base/net/congestion_controller.h"
+#include "base/net/datagram_fec.h"
 #include "base/net/kcp_channel_proxy.h"
 #include "base/strings/unicode.h"
 
+#if defined(OS_LINUX)
+#include "base/net/udp_batch_io_linux.h"
+#endif // defined(OS_LINUX)
+
 #include <asio/connect.hpp>
 
+#include <algorithm>
+
 #if defined(USE_MIMALLOC)
 #include <mimalloc.h>
 #endif // defined(USE_MIMALLOC)
 
 namespace base {
 
+namespace {
+
+const size_t kDefaultMtu = 1200;
+
+// Used if the link loses many datagrams. Large datagrams are more likely to be lost and each loss
+// costs more.
+const size_t kLossyMtu = 576;
+const double kHighLossRate = 0.1;
+const double kLowLossRate = 0.02;
+
+// Limits of the adaptive KCP window in segments.
+const size_t kMinWindow = 32;
+const size_t kMaxWindow = 1024;
+
+// Limits of the adaptive KCP update interval in milliseconds.
+const uint32_t kDefaultInterval = 20;
+const uint32_t kMinInterval = 10;
+const uint32_t kMaxInterval = 40;
+
+// The pacer does not accumulate more unused time than this, so there are no bursts after idle
+// periods.
+const std::chrono::milliseconds kMaxPacingBurst { 2 };
+
+const uint32_t kKcpConversation = 0xFA01BB4E;
+
+// Unreliable datagrams start with a conversation number which differs from the KCP one.
+// Header: [conversation (4 bytes, little endian as in KCP)][sequence (8 bytes)]
+// [channel sequence (4 bytes)][fragment index (2 bytes)][fragment count (2 bytes)][channel id]
+// The numbers after the conversation are big endian.
+const uint32_t kUnreliableConversation = 0xFA01BB4F;
+const size_t kUnreliableHeaderSize = 21;
+
+// If more datagrams are waiting to be sent, then new unreliable messages are dropped.
+const size_t kMaxQueuedDatagrams = 1024;
+
+template <typename T>
+void writeBig(uint8_t* buffer, T value)
+{
+    value = EndianUtil::toBig(value);
+    memcpy(buffer, &value, sizeof(value));
+}
+
+template <typename T>
+T readBig(const uint8_t* buffer)
+{
+    T value;
+    memcpy(&value, buffer, sizeof(value));
+    return EndianUtil::fromBig(value);
+}
+
+uint32_t readConversation(const uint8_t* buffer)
+{
+    return static_cast<uint32_t>(buffer[0]) | (static_cast<uint32_t>(buffer[1]) << 8) |
+           (static_cast<uint32_t>(buffer[2]) << 16) | (static_cast<uint32_t>(buffer[3]) << 24);
+}
+
+} // namespace
+
 KcpChannel::KcpChannel()
     : update_timer_(std::make_unique<asio::high_resolution_timer>(
           MessageLoop::current()->pumpAsio()->ioContext())),
@@ -67,6 +134,47 @@ std::shared_ptr<KcpChannelProxy> KcpChannel::channelProxy()
     return proxy_;
 }
 
+void KcpChannel::setTransportOptions(const TransportOptions& options)
+{
+    if (connected_)
+    {
+        LOG(LS_WARNING) << "Transport options must be set before connection";
+        return;
+    }
+
+    if (options.adaptive)
+    {
+        congestion_controller_ = std::make_unique<CongestionController>(kcp_->mss);
+        pacing_timer_ = std::make_unique<asio::high_resolution_timer>(
+            MessageLoop::current()->pumpAsio()->ioContext());
+    }
+    else
+    {
+        congestion_controller_.reset();
+        pacing_timer_.reset();
+    }
+
+    if (options.fec_group_size)
+    {
+        fec_encoder_ = std::make_unique<DatagramFecEncoder>(
+            std::min(options.fec_group_size, DatagramFecEncoder::kMaxGroupSize));
+        fec_decoder_ = std::make_unique<DatagramFecDecoder>();
+    }
+    else
+    {
+        fec_encoder_.reset();
+        fec_decoder_.reset();
+    }
+
+    // The FEC header changes the space available to KCP.
+    setMtu(mtu_);
+}
+
+void KcpChannel::setReliability(uint8_t channel_id, Reliability reliability)
+{
+    unreliable_channels_.set(channel_id, reliability == Reliability::UNRELIABLE);
+}
+
 void KcpChannel::setListener(Listener* listener)
 {
     listener_ = listener;
@@ -122,6 +230,10 @@ void KcpChannel::connect(std::u16string_view host, uint16_t port)
             LOG(LS_INFO) << "Connected to " << endpoint.address() << ":" << endpoint.port();
             connected_ = true;
 
+#if defined(OS_LINUX)
+            batch_io_ = std::make_unique<UdpBatchIo>(socket_.native_handle());
+#endif // defined(OS_LINUX)
+
             if (listener_)
                 listener_->onKcpConnected();
         });
@@ -173,6 +285,13 @@ void KcpChannel::resume()
 
 void KcpChannel::send(uint8_t channel_id, ByteArray&& buffer)
 {
+    if (unreliable_channels_.test(channel_id))
+    {
+        // Unreliable messages do not wait for the delivery of the previous messages.
+        sendUnreliable(channel_id, buffer);
+        return;
+    }
+
     addWriteTask(WriteTask::Type::USER_DATA, channel_id, std::move(buffer));
 }
 
@@ -229,6 +348,34 @@ size_t KcpChannel::pendingMessages() const
     return write_queue_.size();
 }
 
+NetworkChannel::Statistics KcpChannel::statistics() const
+{
+    Statistics statistics = NetworkChannel::statistics();
+
+    statistics.queued_messages = write_queue_.size();
+    statistics.queued_bytes = write_queue_bytes_;
+
+    // The first message of the queue is the oldest one.
+    if (!write_queue_.empty())
+    {
+        statistics.oldest_queued_age = std::chrono::duration_cast<std::chrono::microseconds>(
+            WriteTask::Clock::now() - write_queue_.front().queueTime());
+    }
+
+    if (kcp_)
+    {
+        statistics.has_transport_info = true;
+        statistics.transport_rtt = Milliseconds(kcp_->rx_srtt);
+        statistics.transport_rtt_variance = Milliseconds(kcp_->rx_rttval);
+        statistics.congestion_window =
+            static_cast<size_t>(std::min(kcp_->cwnd, kcp_->snd_wnd)) * kcp_->mss;
+        statistics.bytes_in_flight = static_cast<size_t>(kcp_->nsnd_buf) * kcp_->mss;
+        statistics.retransmits = kcp_->xmit;
+    }
+
+    return statistics;
+}
+
 void KcpChannel::disconnect()
 {
     if (!connected_)
@@ -241,6 +388,9 @@ void KcpChannel::disconnect()
     socket_.close(ignored_code);
 
     stopUpdateTimer();
+
+    if (pacing_timer_)
+        pacing_timer_->cancel();
 }
 
 void KcpChannel::onErrorOccurred(const Location& location, const std::error_code& error_code)
@@ -307,6 +457,7 @@ void KcpChannel::addWriteTask(WriteTask::Type type, uint8_t channel_id, ByteArra
     const bool schedule_write = write_queue_.empty();
 
     // Add the buffer to the queue for sending.
+    write_queue_bytes_ += data.size();
     write_queue_.emplace(type, channel_id, std::move(data));
 
     if (schedule_write)
@@ -315,6 +466,18 @@ void KcpChannel::addWriteTask(WriteTask::Type type, uint8_t channel_id, ByteArra
 
 void KcpChannel::doWrite()
 {
+    // Messages sent through the proxy get into the queue.
+    while (write_queue_.front().type() == WriteTask::Type::USER_DATA &&
+           unreliable_channels_.test(write_queue_.front().channelId()))
+    {
+        sendUnreliable(write_queue_.front().channelId(), write_queue_.front().data());
+        write_queue_bytes_ -= write_queue_.front().data().size();
+        write_queue_.pop();
+
+        if (write_queue_.empty() && !proxy_->reloadWriteQueue(&write_queue_, &write_queue_bytes_))
+            return;
+    }
+
     const WriteTask& task = write_queue_.front();
     const ByteArray& source_buffer = task.data();
 
@@ -547,14 +710,11 @@ void KcpChannel::onReadServiceData(size_t bytes_transferred)
                 return;
             }
 
-            if (DCHECK_IS_ON())
-            {
-                Milliseconds ping_time = std::chrono::duration_cast<Milliseconds>(
-                    Clock::now() - keep_alive_timestamp_);
+            addRoundTripTime(std::chrono::duration_cast<std::chrono::microseconds>(
+                Clock::now() - keep_alive_timestamp_));
 
-                DLOG(LS_INFO) << "Ping result: " << ping_time.count() << " ms ("
-                              << keep_alive_counter_.size() << " bytes)";
-            }
+            DLOG(LS_INFO) << "Ping result: " << roundTripTime().count() << " us ("
+                          << keep_alive_counter_.size() << " bytes)";
 
             // The user can disable keep alive. Restart the timer only if keep alive is enabled.
             if (keep_alive_timer_)
@@ -588,6 +748,42 @@ void KcpChannel::doRead(asio::mutable_buffer buffer, ReadCompleteCallback callba
         return;
     }
 
+#if defined(OS_LINUX)
+    if (batch_io_)
+    {
+        socket_.async_wait(asio::socket_base::wait_read,
+                           [=](const std::error_code& error_code)
+        {
+            if (error_code)
+            {
+                onErrorOccurred(FROM_HERE, error_code);
+                return;
+            }
+
+            std::error_code receive_error;
+            bool result = true;
+
+            batch_io_->receive([&](const uint8_t* data, size_t size)
+            {
+                // Update RX statistics.
+                addRxBytes(size);
+
+                if (result && !onDatagramReceived(data, size))
+                    result = false;
+            },
+            &receive_error);
+
+            if (receive_error)
+                onErrorOccurred(FROM_HERE, receive_error);
+            else if (!result)
+                onErrorOccurred(FROM_HERE, ErrorCode::NETWORK_ERROR);
+            else
+                readKcpData(buffer, callback);
+        });
+        return;
+    }
+#endif // defined(OS_LINUX)
+
     socket_.async_receive(
         asio::buffer(input_buffer_.data(), input_buffer_.size()),
         [=](const std::error_code& error_code, size_t bytes_transferred)
@@ -601,50 +797,54 @@ void KcpChannel::doRead(asio::mutable_buffer buffer, ReadCompleteCallback callba
         // Update RX statistics.
         addRxBytes(bytes_transferred);
 
-        int ret = ikcp_input(kcp_, input_buffer_.data(), static_cast<long>(bytes_transferred));
-        if (ret < 0)
+        if (!onDatagramReceived(reinterpret_cast<const uint8_t*>(input_buffer_.data()),
+                                bytes_transferred))
         {
-            LOG(LS_WARNING) << "ikcp_input failed: " << ret;
             onErrorOccurred(FROM_HERE, ErrorCode::NETWORK_ERROR);
         }
         else
         {
-            int len = ikcp_recv(kcp_,
-                                reinterpret_cast<char*>(recv_buffer_.data()) + recv_buffer_pos_,
-                                static_cast<int>(recv_buffer_.size() - recv_buffer_pos_));
-            if (len > 0)
-            {
-                recv_buffer_pos_ += static_cast<size_t>(len);
-
-                if (recv_buffer_pos_ == recv_buffer_.size())
-                {
-                    // Message received in full.
-                    callback(buffer.size());
-                }
-                else if (recv_buffer_pos_ < buffer.size())
-                {
-                    // Message received incomplete.
-                    doRead(buffer, std::move(callback));
-                }
-                else
-                {
-                    LOG(LS_FATAL) << "Invalid position for read buffer";
-                    return;
-                }
-            }
-            else if (len == 0)
-            {
-                // No data yet.
-                doRead(buffer, std::move(callback));
-            }
-            else
-            {
-                onErrorOccurred(FROM_HERE, ErrorCode::NETWORK_ERROR);
-            }
+            readKcpData(buffer, callback);
         }
     });
 }
 
+void KcpChannel::readKcpData(asio::mutable_buffer buffer, ReadCompleteCallback callback)
+{
+    int len = ikcp_recv(kcp_,
+                        reinterpret_cast<char*>(recv_buffer_.data()) + recv_buffer_pos_,
+                        static_cast<int>(recv_buffer_.size() - recv_buffer_pos_));
+    if (len > 0)
+    {
+        recv_buffer_pos_ += static_cast<size_t>(len);
+
+        if (recv_buffer_pos_ == recv_buffer_.size())
+        {
+            // Message received in full.
+            callback(buffer.size());
+        }
+        else if (recv_buffer_pos_ < buffer.size())
+        {
+            // Message received incomplete.
+            doRead(buffer, std::move(callback));
+        }
+        else
+        {
+            LOG(LS_FATAL) << "Invalid position for read buffer";
+            return;
+        }
+    }
+    else if (len == 0)
+    {
+        // No data yet.
+        doRead(buffer, std::move(callback));
+    }
+    else
+    {
+        onErrorOccurred(FROM_HERE, ErrorCode::NETWORK_ERROR);
+    }
+}
+
 void KcpChannel::startUpdateTimer(uint32_t timeout)
 {
     update_timer_->expires_after(Milliseconds(timeout));
@@ -676,6 +876,17 @@ void KcpChannel::onUpdateTimeout(const std::error_code& error_code)
         last_service_time_ = current_time;
 
         onUpdate(time);
+        doSendDatagram();
+
+        if (congestion_controller_)
+            updateTransport();
+
+        // There is no more data for now. The last datagrams must be protected too.
+        if (fec_encoder_ && send_queue_.empty() && !is_sending_)
+        {
+            fec_encoder_->flush(&send_queue_);
+            doSendDatagram();
+        }
 
         startUpdateTimer(ikcp_check(kcp_, time));
     }
@@ -692,28 +903,86 @@ void KcpChannel::initKcp()
     ikcp_allocator(mi_new, mi_free);
 #endif // defined(USE_MIMALLOC)
 
-    kcp_ = ikcp_create(0xFA01BB4E, this);
+    kcp_ = ikcp_create(kKcpConversation, this);
     CHECK(kcp_) << "ikcp_create failed";
 
     ikcp_setoutput(kcp_, onDataWriteCallback);
 
-    int ret = ikcp_nodelay(kcp_, 1, 20, 2, 1);
+    int ret = ikcp_nodelay(kcp_, 1, kDefaultInterval, 2, 1);
     if (ret != 0)
     {
         LOG(LS_WARNING) << "ikcp_nodelay failed: " << ret;
     }
 
-    ret = ikcp_setmtu(kcp_, 1200);
+    setMtu(kDefaultMtu);
+
+    ret = ikcp_wndsize(kcp_, static_cast<int>(kMaxWindow), static_cast<int>(kMaxWindow));
     if (ret != 0)
     {
-        LOG(LS_WARNING) << "ikcp_setmtu failed: " << ret;
+        LOG(LS_WARNING) << "ikcp_wndsize failed: " << ret;
     }
+}
+
+void KcpChannel::updateTransport()
+{
+    DCHECK(congestion_controller_);
+
+    CongestionController::Sample sample;
+    sample.time = Clock::now();
+    sample.delivered_bytes = static_cast<size_t>(kcp_->snd_una - last_snd_una_) * kcp_->mss;
+    sample.inflight_bytes = static_cast<size_t>(kcp_->nsnd_buf) * kcp_->mss;
+    sample.rtt = Milliseconds(kcp_->rx_srtt);
+    sample.lost_packets = kcp_->xmit - last_xmit_;
+    sample.sent_packets = (kcp_->snd_nxt - last_snd_nxt_) + sample.lost_packets;
+
+    last_snd_una_ = kcp_->snd_una;
+    last_snd_nxt_ = kcp_->snd_nxt;
+    last_xmit_ = kcp_->xmit;
+
+    congestion_controller_->onSample(sample);
+
+    // The congestion control of KCP is disabled, its window is set from the estimated one.
+    size_t window = std::clamp(congestion_controller_->congestionWindow() / kcp_->mss,
+                               kMinWindow, kMaxWindow);
+    if (window != kcp_->snd_wnd)
+        ikcp_wndsize(kcp_, static_cast<int>(window), 0);
+
+    // Short paths need frequent updates for fast acknowledgements, long paths do not.
+    uint32_t interval = std::clamp(
+        static_cast<uint32_t>(congestion_controller_->minRtt().count() / 4),
+        kMinInterval, kMaxInterval);
+    if (interval != kcp_->interval)
+        ikcp_nodelay(kcp_, -1, static_cast<int>(interval), -1, -1);
+
+    double loss_rate = congestion_controller_->lossRate();
+    if (loss_rate > kHighLossRate && mtu_ != kLossyMtu)
+    {
+        LOG(LS_INFO) << "High loss rate: " << loss_rate << ". Decrease MTU";
+        setMtu(kLossyMtu);
+    }
+    else if (loss_rate < kLowLossRate && mtu_ != kDefaultMtu)
+    {
+        LOG(LS_INFO) << "Low loss rate: " << loss_rate << ". Restore MTU";
+        setMtu(kDefaultMtu);
+    }
+}
 
-    ret = ikcp_wndsize(kcp_, 1024, 1024);
+void KcpChannel::setMtu(size_t mtu)
+{
+    // The datagram with the FEC header must not exceed the MTU.
+    size_t kcp_mtu = fec_encoder_ ? mtu - DatagramFecEncoder::kOverhead : mtu;
+
+    int ret = ikcp_setmtu(kcp_, static_cast<int>(kcp_mtu));
     if (ret != 0)
     {
-        LOG(LS_WARNING) << "ikcp_wndsize failed: " << ret;
+        LOG(LS_WARNING) << "ikcp_setmtu failed: " << ret;
+        return;
     }
+
+    mtu_ = mtu;
+
+    if (congestion_controller_)
+        congestion_controller_->setMss(kcp_->mss);
 }
 
 void KcpChannel::onKeepAliveInterval(const std::error_code& error_code)
@@ -787,9 +1056,65 @@ void KcpChannel::sendKeepAlive(uint8_t flags, const void* data, size_t size)
 
 void KcpChannel::onDataWrite(const char* buf, size_t len)
 {
-    socket_.async_send(asio::buffer(buf, len),
+    // The datagrams are sent after the update, so all output of the update is sent in batches.
+    addDatagram(fromData(buf, len));
+}
+
+void KcpChannel::addDatagram(ByteArray&& datagram)
+{
+    if (fec_encoder_)
+        fec_encoder_->encode(datagram.data(), datagram.size(), &send_queue_);
+    else
+        send_queue_.emplace_back(std::move(datagram));
+}
+
+void KcpChannel::doSendDatagram()
+{
+    if (is_sending_ || is_pacing_ || send_queue_.empty() || !connected_)
+        return;
+
+#if defined(OS_LINUX)
+    size_t count = std::min(send_queue_.size(), batch_io_ ? UdpBatchIo::kMaxBatchSize : 1);
+#else
+    size_t count = 1;
+#endif // defined(OS_LINUX)
+
+    if (congestion_controller_)
+    {
+        count = pacedCount(count);
+        if (!count)
+        {
+            is_pacing_ = true;
+
+            pacing_timer_->expires_at(pacing_time_);
+            pacing_timer_->async_wait([this](const std::error_code& error_code)
+            {
+                if (error_code == asio::error::operation_aborted)
+                    return;
+
+                is_pacing_ = false;
+                doSendDatagram();
+            });
+            return;
+        }
+    }
+
+#if defined(OS_LINUX)
+    if (batch_io_)
+    {
+        sendBatch(count);
+        return;
+    }
+#endif // defined(OS_LINUX)
+
+    const ByteArray& datagram = send_queue_.front();
+    is_sending_ = true;
+
+    socket_.async_send(asio::buffer(datagram.data(), datagram.size()),
                        [this](const std::error_code& error_code, size_t bytes_transferred)
     {
+        is_sending_ = false;
+
         if (error_code)
         {
             onErrorOccurred(FROM_HERE, error_code);
@@ -799,28 +1124,294 @@ void KcpChannel::onDataWrite(const char* buf, size_t len)
         // Update TX statistics.
         addTxBytes(bytes_transferred);
 
-        // Check that all data from the KCP has been completely sent.
-        if (ikcp_waitsnd(kcp_) == 0)
+        send_queue_.pop_front();
+
+        onDatagramSent();
+        doSendDatagram();
+    });
+}
+
+size_t KcpChannel::pacedCount(size_t max_count)
+{
+    DCHECK(congestion_controller_);
+
+    TimePoint current_time = Clock::now();
+    if (pacing_time_ > current_time)
+        return 0;
+
+    // The time not used while there was no data does not allow a burst.
+    pacing_time_ = std::max(pacing_time_, current_time - kMaxPacingBurst);
+
+    const int64_t pacing_rate = congestion_controller_->pacingRate();
+    size_t count = 0;
+
+    // All datagrams whose time has come are sent at once.
+    while (count < max_count && pacing_time_ <= current_time)
+    {
+        pacing_time_ += std::chrono::duration_cast<Clock::duration>(std::chrono::microseconds(
+            static_cast<int64_t>(send_queue_[count].size()) * 1000000 / pacing_rate));
+        ++count;
+    }
+
+    return count;
+}
+
+#if defined(OS_LINUX)
+void KcpChannel::sendBatch(size_t count)
+{
+    std::error_code error_code;
+    size_t sent = batch_io_->send(send_queue_, count, &error_code);
+
+    for (size_t i = 0; i < sent; ++i)
+    {
+        // Update TX statistics.
+        addTxBytes(send_queue_.front().size());
+        send_queue_.pop_front();
+    }
+
+    if (error_code == std::errc::operation_would_block)
+    {
+        is_sending_ = true;
+
+        socket_.async_wait(asio::socket_base::wait_write, [this](const std::error_code& error_code)
         {
-            DCHECK(!write_queue_.empty());
+            is_sending_ = false;
 
-            const WriteTask& task = write_queue_.front();
-            WriteTask::Type task_type = task.type();
-            uint8_t channel_id = task.channelId();
+            if (error_code)
+            {
+                onErrorOccurred(FROM_HERE, error_code);
+                return;
+            }
 
-            // Delete the sent message from the queue.
-            write_queue_.pop();
+            doSendDatagram();
+        });
+        return;
+    }
 
-            // If the queue is not empty, then we send the following message.
-            bool schedule_write = !write_queue_.empty() || proxy_->reloadWriteQueue(&write_queue_);
+    if (error_code)
+    {
+        onErrorOccurred(FROM_HERE, error_code);
+        return;
+    }
 
-            if (task_type == WriteTask::Type::USER_DATA)
-                onMessageWritten(channel_id);
+    onDatagramSent();
+    doSendDatagram();
+}
+#endif // defined(OS_LINUX)
 
-            if (schedule_write)
-                doWrite();
-        }
+void KcpChannel::onDatagramSent()
+{
+    // Check that all data from the KCP has been completely sent. Datagrams with acknowledgements
+    // are sent when there are no messages too.
+    if (ikcp_waitsnd(kcp_) != 0 || write_queue_.empty())
+        return;
+
+    const WriteTask& task = write_queue_.front();
+    WriteTask::Type task_type = task.type();
+    uint8_t channel_id = task.channelId();
+
+    // Delete the sent message from the queue.
+    write_queue_bytes_ -= task.data().size();
+    write_queue_.pop();
+
+    // If the queue is not empty, then we send the following message.
+    bool schedule_write = !write_queue_.empty() ||
+        proxy_->reloadWriteQueue(&write_queue_, &write_queue_bytes_);
+
+    if (task_type == WriteTask::Type::USER_DATA)
+        onMessageWritten(channel_id);
+
+    if (schedule_write)
+        doWrite();
+}
+
+bool KcpChannel::onDatagramReceived(const uint8_t* data, size_t size)
+{
+    if (!fec_decoder_)
+        return inputDatagram(data, size);
+
+    bool result = true;
+
+    // KCP ignores the segments restored by FEC if they have already been received.
+    bool decoded = fec_decoder_->decode(data, size, [&](const uint8_t* data, size_t size)
+    {
+        if (!inputDatagram(data, size))
+            result = false;
     });
+
+    if (!decoded)
+    {
+        LOG(LS_WARNING) << "Invalid FEC datagram";
+        return false;
+    }
+
+    return result;
+}
+
+bool KcpChannel::inputDatagram(const uint8_t* data, size_t size)
+{
+    if (size >= sizeof(uint32_t) && readConversation(data) == kUnreliableConversation)
+        return onUnreliableDatagram(data, size);
+
+    int ret = ikcp_input(kcp_, reinterpret_cast<const char*>(data), static_cast<long>(size));
+    if (ret < 0)
+    {
+        LOG(LS_WARNING) << "ikcp_input failed: " << ret;
+        return false;
+    }
+
+    return true;
+}
+
+void KcpChannel::sendUnreliable(uint8_t channel_id, const ByteArray& buffer)
+{
+    if (!connected_)
+        return;
+
+    UnreliableChannel& channel = unreliable_state_[channel_id];
+    const uint32_t channel_sequence = channel.send_sequence++;
+
+    // The link does not keep up. The receiver will see the gap in the sequence numbers.
+    if (send_queue_.size() > kMaxQueuedDatagrams)
+        return;
+
+    ByteArray encrypted;
+    encrypted.resize(encryptor_->encryptedDataSize(buffer.size()));
+
+    if (encrypted.size() > kMaxMessageSize)
+    {
+        LOG(LS_ERROR) << "Too big outgoing message: " << encrypted.size();
+        onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
+        return;
+    }
+
+    const uint64_t sequence = unreliable_sequence_++;
+
+    if (!encryptor_->encryptWithSequence(sequence, buffer.data(), buffer.size(), encrypted.data()))
+    {
+        onErrorOccurred(FROM_HERE, ErrorCode::ACCESS_DENIED);
+        return;
+    }
+
+    size_t fragment_size = mtu_ - kUnreliableHeaderSize;
+    if (fec_encoder_)
+        fragment_size -= DatagramFecEncoder::kOverhead;
+
+    const size_t fragment_count = (encrypted.size() + fragment_size - 1) / fragment_size;
+    DCHECK_LE(fragment_count, 0xFFFFu);
+
+    for (size_t i = 0; i < fragment_count; ++i)
+    {
+        const size_t offset = i * fragment_size;
+        const size_t size = std::min(fragment_size, encrypted.size() - offset);
+
+        ByteArray datagram;
+        datagram.resize(kUnreliableHeaderSize + size);
+
+        uint8_t* header = datagram.data();
+        for (size_t j = 0; j < sizeof(uint32_t); ++j)
+            header[j] = static_cast<uint8_t>(kUnreliableConversation >> (j * 8));
+
+        writeBig<uint64_t>(header + 4, sequence);
+        writeBig<uint32_t>(header + 12, channel_sequence);
+        writeBig<uint16_t>(header + 16, static_cast<uint16_t>(i));
+        writeBig<uint16_t>(header + 18, static_cast<uint16_t>(fragment_count));
+        header[20] = channel_id;
+
+        memcpy(datagram.data() + kUnreliableHeaderSize, encrypted.data() + offset, size);
+        addDatagram(std::move(datagram));
+    }
+
+    doSendDatagram();
+}
+
+bool KcpChannel::onUnreliableDatagram(const uint8_t* data, size_t size)
+{
+    if (size <= kUnreliableHeaderSize)
+        return false;
+
+    const uint64_t sequence = readBig<uint64_t>(data + 4);
+    const uint32_t channel_sequence = readBig<uint32_t>(data + 12);
+    const uint16_t index = readBig<uint16_t>(data + 16);
+    const uint16_t count = readBig<uint16_t>(data + 18);
+    const uint8_t channel_id = data[20];
+
+    if (!count || index >= count || count > kMaxMessageSize / (size - kUnreliableHeaderSize))
+        return false;
+
+    UnreliableChannel& channel = unreliable_state_[channel_id];
+
+    // The message was already delivered or superseded by a newer one.
+    if (channel.has_received &&
+        static_cast<int32_t>(channel_sequence - channel.last_sequence) <= 0)
+    {
+        return true;
+    }
+
+    if (channel.fragments.empty() || channel.sequence != channel_sequence)
+    {
+        if (!channel.fragments.empty() &&
+            static_cast<int32_t>(channel_sequence - channel.sequence) < 0)
+        {
+            return true;
+        }
+
+        // If the previous message was not assembled, then it is lost. The gap is detected when
+        // the next message is delivered.
+        channel.sequence = channel_sequence;
+        channel.received = 0;
+        channel.fragments.clear();
+        channel.fragments.resize(count);
+    }
+
+    if (channel.fragments.size() != count)
+        return false;
+
+    ByteArray& fragment = channel.fragments[index];
+    if (!fragment.empty())
+        return true;
+
+    fragment = fromData(data + kUnreliableHeaderSize, size - kUnreliableHeaderSize);
+    if (++channel.received < count)
+        return true;
+
+    ByteArray encrypted;
+    for (const auto& fragment : channel.fragments)
+        append(&encrypted, fragment.data(), fragment.size());
+
+    channel.fragments.clear();
+
+    const bool lost = channel.has_received ?
+        channel_sequence != channel.last_sequence + 1 : channel_sequence != 0;
+
+    channel.last_sequence = channel_sequence;
+    channel.has_received = true;
+
+    // The message is never shorter than the overhead of the cipher.
+    if (encrypted.size() < encryptor_->encryptedDataSize(0))
+        return false;
+
+    ByteArray decrypted;
+    decrypted.resize(decryptor_->decryptedDataSize(encrypted.size()));
+
+    if (!decryptor_->decryptWithSequence(
+            sequence, encrypted.data(), encrypted.size(), decrypted.data()))
+    {
+        return false;
+    }
+
+    if (!listener_)
+        return true;
+
+    // While the channel is paused the messages are dropped. They are superseded by the time the
+    // channel is resumed.
+    if (lost || paused_)
+        listener_->onKcpMessageLost(channel_id);
+
+    if (!paused_)
+        listener_->onKcpMessageReceived(channel_id, decrypted);
+
+    return true;
 }
 
 // static
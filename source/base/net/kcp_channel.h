@@ -19,6 +19,7 @@
 #ifndef BASE_NET_KCP_CHANNEL_H
 #define BASE_NET_KCP_CHANNEL_H
 
+#include "build/build_config.h"
 #include "base/location.h"
 #include "base/macros_magic.h"
 #include "base/memory/byte_array.h"
@@ -26,7 +27,10 @@
 #include "base/net/write_task.h"
 #include "third_party/kcp/ikcp.h"
 
+#include <bitset>
 #include <cstdint>
+#include <deque>
+#include <map>
 #include <queue>
 #include <string>
 
@@ -35,8 +39,12 @@
 
 namespace base {
 
+class CongestionController;
+class DatagramFecDecoder;
+class DatagramFecEncoder;
 class KcpChannelProxy;
 class MessageEncryptor;
+class UdpBatchIo;
 class MessageDecryptor;
 
 class KcpChannel : public NetworkChannel
@@ -54,10 +62,45 @@ public:
         virtual void onKcpDisconnected(ErrorCode error_code) = 0;
         virtual void onKcpMessageReceived(uint8_t channel_id, const ByteArray& buffer) = 0;
         virtual void onKcpMessageWritten(uint8_t channel_id, size_t pending) = 0;
+
+        // Called if unreliable messages of the channel were lost. For video the receiver
+        // requests a key frame, and the sender calls VideoEncoder::setKeyFrameRequired for it.
+        virtual void onKcpMessageLost(uint8_t channel_id) = 0;
+    };
+
+    enum class Reliability
+    {
+        // Messages are delivered in order, lost datagrams are retransmitted.
+        RELIABLE,
+
+        // Messages are sent in separate datagrams past KCP. Lost messages are not retransmitted
+        // and do not delay the following ones. It is intended for video frames which are
+        // superseded by the next frame anyway.
+        UNRELIABLE
+    };
+
+    struct TransportOptions
+    {
+        // Enables the congestion controller and pacing of datagrams. The KCP window, MTU and
+        // update interval follow the measured bandwidth, RTT and loss. If disabled, fixed KCP
+        // settings are used.
+        bool adaptive = false;
+
+        // Number of datagrams protected by one parity datagram. Zero disables FEC. FEC adds a
+        // header to each datagram, so both peers must use the same value.
+        size_t fec_group_size = 0;
     };
 
     std::shared_ptr<KcpChannelProxy> channelProxy();
 
+    // Sets the transport options. Must be called before connect().
+    void setTransportOptions(const TransportOptions& options);
+
+    // Sets the reliability of outgoing messages with |channel_id|. By default all messages are
+    // reliable. The receiver detects unreliable messages by themselves. There are no
+    // onKcpMessageWritten notifications for unreliable messages.
+    void setReliability(uint8_t channel_id, Reliability reliability);
+
     // Sets an instance of the class to receive connection status notifications or new messages.
     // You can change this in the process.
     void setListener(Listener* listener);
@@ -96,6 +139,9 @@ public:
 
     size_t pendingMessages() const;
 
+    // NetworkChannel implementation. The transport information is the state of the KCP.
+    Statistics statistics() const override;
+
     // Converts an error code to a human readable string.
     // Does not support localization. Used for logs.
     static std::string errorToString(ErrorCode error_code);
@@ -161,18 +207,33 @@ private:
     void onReadServiceData(size_t bytes_transferred);
 
     void doRead(asio::mutable_buffer buffer, ReadCompleteCallback callback);
+    void readKcpData(asio::mutable_buffer buffer, ReadCompleteCallback callback);
 
     void startUpdateTimer(uint32_t timeout);
     void stopUpdateTimer();
     void onUpdateTimeout(const std::error_code& error_code);
     void onUpdate(uint32_t time);
     void initKcp();
+    void updateTransport();
+    void setMtu(size_t mtu);
 
     void onKeepAliveInterval(const std::error_code& error_code);
     void onKeepAliveTimeout(const std::error_code& error_code);
     void sendKeepAlive(uint8_t flags, const void* data, size_t size);
 
     void onDataWrite(const char* buf, size_t len);
+    void addDatagram(ByteArray&& datagram);
+    void doSendDatagram();
+    size_t pacedCount(size_t max_count);
+#if defined(OS_LINUX)
+    void sendBatch(size_t count);
+#endif // defined(OS_LINUX)
+    void onDatagramSent();
+    bool onDatagramReceived(const uint8_t* data, size_t size);
+    bool inputDatagram(const uint8_t* data, size_t size);
+
+    void sendUnreliable(uint8_t channel_id, const ByteArray& buffer);
+    bool onUnreliableDatagram(const uint8_t* data, size_t size);
     static int onDataWriteCallback(const char* buf, int len, struct IKCPCB* kcp, void* user);
 
     Listener* listener_ = nullptr;
@@ -183,6 +244,10 @@ private:
     std::shared_ptr<KcpChannelProxy> proxy_;
     std::unique_ptr<asio::ip::udp::resolver> resolver_;
     asio::ip::udp::socket socket_;
+#if defined(OS_LINUX)
+    // Reads and writes the socket with recvmmsg and sendmmsg.
+    std::unique_ptr<UdpBatchIo> batch_io_;
+#endif // defined(OS_LINUX)
     TimePoint last_service_time_;
     ikcpcb* kcp_ = nullptr;
 
@@ -192,10 +257,52 @@ private:
     ByteArray keep_alive_counter_;
     TimePoint keep_alive_timestamp_;
 
+    // Datagrams from the KCP waiting to be sent. KCP reuses its output buffer, so the datagrams
+    // are copied.
+    std::deque<ByteArray> send_queue_;
+    bool is_sending_ = false;
+
+    // Present only in the adaptive mode.
+    std::unique_ptr<CongestionController> congestion_controller_;
+    std::unique_ptr<asio::high_resolution_timer> pacing_timer_;
+    TimePoint pacing_time_;
+    bool is_pacing_ = false;
+    size_t mtu_ = 0;
+    IUINT32 last_snd_una_ = 0;
+    IUINT32 last_snd_nxt_ = 0;
+    IUINT32 last_xmit_ = 0;
+
+    // Present only if FEC is enabled.
+    std::unique_ptr<DatagramFecEncoder> fec_encoder_;
+    std::unique_ptr<DatagramFecDecoder> fec_decoder_;
+
+    struct UnreliableChannel
+    {
+        // Sequence number of the next outgoing message of the channel.
+        uint32_t send_sequence = 0;
+
+        // Sequence number of the last delivered incoming message.
+        uint32_t last_sequence = 0;
+        bool has_received = false;
+
+        // Fragments of the incoming message being assembled.
+        uint32_t sequence = 0;
+        size_t received = 0;
+        std::vector<ByteArray> fragments;
+    };
+
+    std::bitset<256> unreliable_channels_;
+    std::map<uint8_t, UnreliableChannel> unreliable_state_;
+
+    // Sequence number of the next unreliable message among all channels. The IV of the message is
+    // derived from it.
+    uint64_t unreliable_sequence_ = 0;
+
     std::unique_ptr<MessageEncryptor> encryptor_;
     std::unique_ptr<MessageDecryptor> decryptor_;
 
     std::queue<WriteTask> write_queue_;
+    size_t write_queue_bytes_ = 0;
     ByteArray write_buffer_;
 
     ReadState state_ = ReadState::IDLE;
@@ -39,6 +39,7 @@ void KcpChannelProxy::send(uint8_t channel_id, ByteArray&& buffer)
         std::scoped_lock lock(incoming_queue_lock_);
 
         schedule_write = incoming_queue_.empty();
+        incoming_queue_bytes_ += buffer.size();
         incoming_queue_.emplace(WriteTask::Type::USER_DATA, channel_id, std::move(buffer));
     }
 
@@ -58,13 +59,14 @@ void KcpChannelProxy::scheduleWrite()
     if (!channel_)
         return;
 
-    if (!reloadWriteQueue(&channel_->write_queue_))
+    if (!reloadWriteQueue(&channel_->write_queue_, &channel_->write_queue_bytes_))
         return;
 
     channel_->doWrite();
 }
 
-bool KcpChannelProxy::reloadWriteQueue(std::queue<WriteTask>* work_queue)
+bool KcpChannelProxy::reloadWriteQueue(std::queue<WriteTask>* work_queue,
+                                       size_t* work_queue_bytes)
 {
     if (!work_queue->empty())
         return false;
@@ -77,6 +79,9 @@ bool KcpChannelProxy::reloadWriteQueue(std::queue<WriteTask>* work_queue)
     incoming_queue_.swap(*work_queue);
     DCHECK(incoming_queue_.empty());
 
+    *work_queue_bytes += incoming_queue_bytes_;
+    incoming_queue_bytes_ = 0;
+
     return true;
 }
 
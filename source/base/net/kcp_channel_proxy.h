@@ -40,13 +40,14 @@ private:
     void willDestroyCurrentChannel();
 
     void scheduleWrite();
-    bool reloadWriteQueue(std::queue<WriteTask>* work_queue);
+    bool reloadWriteQueue(std::queue<WriteTask>* work_queue, size_t* work_queue_bytes);
 
     std::shared_ptr<TaskRunner> task_runner_;
 
     KcpChannel* channel_;
 
     std::queue<WriteTask> incoming_queue_;
+    size_t incoming_queue_bytes_ = 0;
     std::mutex incoming_queue_lock_;
 
     DISALLOW_COPY_AND_ASSIGN(KcpChannelProxy);
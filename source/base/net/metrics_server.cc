@@ -0,0 +1,253 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/net/metrics_server.h"
+
+#include "base/logging.h"
+#include "base/message_loop/message_loop.h"
+#include "base/message_loop/message_pump_asio.h"
+#include "base/strings/unicode.h"
+
+#include <asio/high_resolution_timer.hpp>
+#include <asio/post.hpp>
+#include <asio/read_until.hpp>
+#include <asio/write.hpp>
+
+namespace base {
+
+namespace {
+
+const size_t kMaxConnections = 16;
+const size_t kMaxRequestSize = 8 * 1024; // 8 kB
+const std::chrono::seconds kRequestTimeout { 5 };
+
+std::string makeResponse(const char* status, const char* content_type, const std::string& body)
+{
+    std::string response;
+
+    response.append("HTTP/1.1 ").append(status).append("\r\n");
+    response.append("Content-Type: ").append(content_type).append("\r\n");
+    response.append("Content-Length: ").append(std::to_string(body.size())).append("\r\n");
+    response.append("Connection: close\r\n\r\n");
+    response.append(body);
+
+    return response;
+}
+
+} // namespace
+
+class MetricsServer::Connection
+{
+public:
+    Connection(MetricsServer* server, asio::ip::tcp::socket&& socket);
+    ~Connection();
+
+    void start();
+
+private:
+    void onRequest(const std::error_code& error_code, size_t size);
+    void finish();
+
+    MetricsServer* server_;
+    asio::ip::tcp::socket socket_;
+    asio::high_resolution_timer timer_;
+    std::string request_;
+    std::string response_;
+
+    DISALLOW_COPY_AND_ASSIGN(Connection);
+};
+
+MetricsServer::Connection::Connection(MetricsServer* server, asio::ip::tcp::socket&& socket)
+    : server_(server),
+      socket_(std::move(socket)),
+      timer_(socket_.get_executor())
+{
+    // Nothing
+}
+
+MetricsServer::Connection::~Connection()
+{
+    std::error_code ignored_code;
+    socket_.cancel(ignored_code);
+    socket_.close(ignored_code);
+    timer_.cancel();
+}
+
+void MetricsServer::Connection::start()
+{
+    timer_.expires_after(kRequestTimeout);
+    timer_.async_wait([this](const std::error_code& error_code)
+    {
+        if (error_code)
+            return;
+
+        LOG(LS_WARNING) << "Metrics request timeout";
+        finish();
+    });
+
+    asio::async_read_until(socket_, asio::dynamic_buffer(request_, kMaxRequestSize), "\r\n\r\n",
+        [this](const std::error_code& error_code, size_t size)
+    {
+        if (error_code == asio::error::operation_aborted)
+            return;
+
+        onRequest(error_code, size);
+    });
+}
+
+void MetricsServer::Connection::onRequest(const std::error_code& error_code, size_t size)
+{
+    timer_.cancel();
+
+    if (error_code)
+    {
+        LOG(LS_WARNING) << "Failed to read metrics request: "
+                        << utf16FromLocal8Bit(error_code.message());
+        finish();
+        return;
+    }
+
+    // Only the request line is used, the headers are ignored.
+    const std::string request_line = request_.substr(0, std::min(request_.find("\r\n"), size));
+
+    if (request_line.rfind("GET ", 0) != 0)
+    {
+        response_ = makeResponse("405 Method Not Allowed", "text/plain", "Method not allowed\n");
+    }
+    else
+    {
+        const size_t path_end = request_line.find(' ', 4);
+        const std::string path = request_line.substr(4, path_end - 4);
+
+        if ((path == "/metrics" || path.rfind("/metrics?", 0) == 0) && server_->delegate_)
+        {
+            response_ = makeResponse("200 OK", "text/plain; version=0.0.4; charset=utf-8",
+                                     server_->delegate_->onMetricsRequest());
+        }
+        else
+        {
+            response_ = makeResponse("404 Not Found", "text/plain", "Not found\n");
+        }
+    }
+
+    asio::async_write(socket_, asio::buffer(response_),
+        [this](const std::error_code& error_code, size_t /* bytes_transferred */)
+    {
+        if (error_code == asio::error::operation_aborted)
+            return;
+
+        std::error_code ignored_code;
+        socket_.shutdown(asio::ip::tcp::socket::shutdown_both, ignored_code);
+        finish();
+    });
+}
+
+void MetricsServer::Connection::finish()
+{
+    server_->onConnectionFinished(this);
+}
+
+MetricsServer::MetricsServer(const asio::ip::address& listen_address, uint16_t port)
+    : endpoint_(listen_address, port),
+      acceptor_(MessageLoop::current()->pumpAsio()->ioContext())
+{
+    // Nothing
+}
+
+MetricsServer::~MetricsServer()
+{
+    std::error_code ignored_code;
+    acceptor_.cancel(ignored_code);
+    acceptor_.close(ignored_code);
+}
+
+bool MetricsServer::start(Delegate* delegate)
+{
+    delegate_ = delegate;
+    DCHECK(delegate_);
+
+    std::error_code error_code;
+
+    acceptor_.open(endpoint_.protocol(), error_code);
+    if (!error_code)
+        acceptor_.set_option(asio::ip::tcp::acceptor::reuse_address(true), error_code);
+    if (!error_code)
+        acceptor_.bind(endpoint_, error_code);
+    if (!error_code)
+        acceptor_.listen(asio::socket_base::max_listen_connections, error_code);
+
+    if (error_code)
+    {
+        LOG(LS_ERROR) << "Failed to start metrics server: "
+                      << utf16FromLocal8Bit(error_code.message());
+        return false;
+    }
+
+    LOG(LS_INFO) << "Metrics server port: " << endpoint_.port();
+    MetricsServer::doAccept(this);
+    return true;
+}
+
+// static
+void MetricsServer::doAccept(MetricsServer* self)
+{
+    self->acceptor_.async_accept(
+        [self](const std::error_code& error_code, asio::ip::tcp::socket socket)
+    {
+        if (error_code)
+        {
+            if (error_code == asio::error::operation_aborted)
+                return;
+
+            LOG(LS_ERROR) << "Error while accepting metrics connection: "
+                          << utf16FromLocal8Bit(error_code.message());
+        }
+        else if (self->connections_.size() >= kMaxConnections)
+        {
+            LOG(LS_WARNING) << "Too many metrics connections";
+        }
+        else
+        {
+            self->connections_.emplace_back(std::make_unique<Connection>(self, std::move(socket)));
+            self->connections_.back()->start();
+        }
+
+        // Waiting for the next connection.
+        MetricsServer::doAccept(self);
+    });
+}
+
+void MetricsServer::onConnectionFinished(Connection* connection)
+{
+    for (auto it = connections_.begin(); it != connections_.end(); ++it)
+    {
+        if (it->get() != connection)
+            continue;
+
+        // The connection is destroyed after the current handler returns.
+        asio::post(acceptor_.get_executor(), [connection = std::move(*it)]() mutable
+        {
+            connection.reset();
+        });
+
+        connections_.erase(it);
+        return;
+    }
+}
+
+} // namespace base
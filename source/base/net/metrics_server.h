@@ -0,0 +1,67 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_NET_METRICS_SERVER_H
+#define BASE_NET_METRICS_SERVER_H
+
+#include "base/macros_magic.h"
+
+#include <asio/ip/tcp.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace base {
+
+// Minimal HTTP server that answers GET /metrics requests. Each connection serves one request and
+// is closed after the response.
+class MetricsServer
+{
+public:
+    class Delegate
+    {
+    public:
+        virtual ~Delegate() = default;
+
+        // Returns the body of the response in the Prometheus text format.
+        virtual std::string onMetricsRequest() = 0;
+    };
+
+    MetricsServer(const asio::ip::address& listen_address, uint16_t port);
+    ~MetricsServer();
+
+    bool start(Delegate* delegate);
+
+private:
+    class Connection;
+
+    static void doAccept(MetricsServer* self);
+    void onConnectionFinished(Connection* connection);
+
+    asio::ip::tcp::endpoint endpoint_;
+    asio::ip::tcp::acceptor acceptor_;
+    std::vector<std::unique_ptr<Connection>> connections_;
+    Delegate* delegate_ = nullptr;
+
+    DISALLOW_COPY_AND_ASSIGN(MetricsServer);
+};
+
+} // namespace base
+
+#endif // BASE_NET_METRICS_SERVER_H
@@ -18,12 +18,28 @@
 
 #include "base/net/network_channel.h"
 
+#include "base/memory/byte_array_pool.h"
+#include "base/metrics/metrics_registry.h"
 #include "base/strings/string_printf.h"
 
 namespace base {
 
 namespace {
 
+Counter* txBytesCounter()
+{
+    static Counter* counter = MetricsRegistry::global().counter(
+        "aspia_network_sent_bytes_total", "Bytes sent by the network channels.");
+    return counter;
+}
+
+Counter* rxBytesCounter()
+{
+    static Counter* counter = MetricsRegistry::global().counter(
+        "aspia_network_received_bytes_total", "Bytes received by the network channels.");
+    return counter;
+}
+
 int calculateSpeed(int last_speed, const NetworkChannel::Milliseconds& duration, int64_t bytes)
 {
     static const double kAlpha = 0.1;
@@ -60,6 +76,19 @@ int NetworkChannel::speedTx()
     return speed_tx_;
 }
 
+NetworkChannel::Statistics NetworkChannel::statistics() const
+{
+    Statistics statistics;
+
+    statistics.bytes_sent = total_tx_;
+    statistics.bytes_received = total_rx_;
+    statistics.rtt = rtt_;
+    statistics.smoothed_rtt = smoothed_rtt_;
+    statistics.rtt_variance = rtt_variance_;
+
+    return statistics;
+}
+
 // static
 std::string NetworkChannel::errorToString(ErrorCode error_code)
 {
@@ -107,6 +136,10 @@ std::string NetworkChannel::errorToString(ErrorCode error_code)
             str = "ADDRESS_NOT_AVAILABLE";
             break;
 
+        case ErrorCode::WRITE_QUEUE_OVERFLOW:
+            str = "WRITE_QUEUE_OVERFLOW";
+            break;
+
         default:
             str = "UNKNOWN";
             break;
@@ -119,22 +152,45 @@ void NetworkChannel::addTxBytes(size_t bytes_count)
 {
     bytes_tx_ += bytes_count;
     total_tx_ += bytes_count;
+    txBytesCounter()->add(bytes_count);
 }
 
 void NetworkChannel::addRxBytes(size_t bytes_count)
 {
     bytes_rx_ += bytes_count;
     total_rx_ += bytes_count;
+    rxBytesCounter()->add(bytes_count);
+}
+
+void NetworkChannel::addRoundTripTime(std::chrono::microseconds rtt)
+{
+    rtt_ = rtt;
+
+    if (smoothed_rtt_.count() == 0)
+    {
+        // The first measurement.
+        smoothed_rtt_ = rtt;
+        rtt_variance_ = rtt / 2;
+        return;
+    }
+
+    const std::chrono::microseconds delta =
+        smoothed_rtt_ > rtt ? smoothed_rtt_ - rtt : rtt - smoothed_rtt_;
+
+    // RTTVAR = 3/4 * RTTVAR + 1/4 * |SRTT - R|, SRTT = 7/8 * SRTT + 1/8 * R.
+    rtt_variance_ = (rtt_variance_ * 3 + delta) / 4;
+    smoothed_rtt_ = (smoothed_rtt_ * 7 + rtt) / 8;
 }
 
 // static
 void NetworkChannel::resizeBuffer(ByteArray* buffer, size_t new_size)
 {
-    // If the reserved buffer size is less, then increase it.
+    // If the reserved buffer size is less, then replace it with a larger buffer from the pool.
     if (buffer->capacity() < new_size)
     {
-        buffer->clear();
-        buffer->reserve(new_size);
+        ByteArrayPool::recycle(std::move(*buffer));
+        *buffer = ByteArrayPool::take(new_size);
+        return;
     }
 
     // Change the size of the buffer.
@@ -68,7 +68,44 @@ public:
         ADDRESS_IN_USE,
 
         // The address specified does not belong to the host.
-        ADDRESS_NOT_AVAILABLE
+        ADDRESS_NOT_AVAILABLE,
+
+        // The peer does not read the data and the outgoing queue exceeded its limit.
+        WRITE_QUEUE_OVERFLOW
+    };
+
+    struct Statistics
+    {
+        int64_t bytes_sent = 0;
+        int64_t bytes_received = 0;
+
+        // Messages in the outgoing queue of the channel thread (including the message being sent)
+        // and their total size.
+        size_t queued_messages = 0;
+        size_t queued_bytes = 0;
+
+        // How long the oldest message of the outgoing queue has been waiting. Zero if the queue is
+        // empty.
+        std::chrono::microseconds oldest_queued_age { 0 };
+
+        // Round trip time of the last keep alive packet and its smoothed value and variation
+        // (RFC 6298). Zero if keep alive is disabled or no answer has been received yet.
+        std::chrono::microseconds rtt { 0 };
+        std::chrono::microseconds smoothed_rtt { 0 };
+        std::chrono::microseconds rtt_variance { 0 };
+
+        // State of the transport below the channel (TCP_INFO for TCP on Linux, the KCP state for
+        // KCP). The fields are valid only if |has_transport_info| is true.
+        bool has_transport_info = false;
+        std::chrono::microseconds transport_rtt { 0 };
+        std::chrono::microseconds transport_rtt_variance { 0 };
+        size_t congestion_window = 0; // In bytes.
+        size_t bytes_in_flight = 0;
+        uint32_t retransmits = 0; // Total number of retransmitted packets.
+
+        // Memory reserved by the read and write buffers of the channel. Zero if the channel does
+        // not report it.
+        size_t buffer_bytes = 0;
     };
 
     virtual ~NetworkChannel() = default;
@@ -78,6 +115,14 @@ public:
     int speedRx();
     int speedTx();
 
+    // Round trip time of the last keep alive packet and its smoothed value. Zero if keep alive is
+    // disabled or no answer has been received yet.
+    std::chrono::microseconds roundTripTime() const { return rtt_; }
+    std::chrono::microseconds smoothedRoundTripTime() const { return smoothed_rtt_; }
+
+    // Returns the transport statistics of the channel. Must be called on the channel thread.
+    virtual Statistics statistics() const;
+
     // Converts an error code to a human readable string.
     // Does not support localization. Used for logs.
     static std::string errorToString(ErrorCode error_code);
@@ -86,6 +131,9 @@ protected:
     void addTxBytes(size_t bytes_count);
     void addRxBytes(size_t bytes_count);
 
+    // Adds a round trip time measured by a keep alive packet.
+    void addRoundTripTime(std::chrono::microseconds rtt);
+
     static void resizeBuffer(ByteArray* buffer, size_t new_size);
 
 private:
@@ -99,6 +147,10 @@ private:
     TimePoint begin_time_rx_;
     int64_t bytes_rx_ = 0;
     int speed_rx_ = 0;
+
+    std::chrono::microseconds rtt_ { 0 };
+    std::chrono::microseconds smoothed_rtt_ { 0 };
+    std::chrono::microseconds rtt_variance_ { 0 };
 };
 
 } // namespace base
@@ -0,0 +1,82 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/net/network_channel.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+class TestChannel : public NetworkChannel
+{
+public:
+    using NetworkChannel::addRoundTripTime;
+    using NetworkChannel::addRxBytes;
+    using NetworkChannel::addTxBytes;
+};
+
+} // namespace
+
+TEST(NetworkChannelTest, EmptyStatistics)
+{
+    TestChannel channel;
+    NetworkChannel::Statistics statistics = channel.statistics();
+
+    EXPECT_EQ(statistics.bytes_sent, 0);
+    EXPECT_EQ(statistics.bytes_received, 0);
+    EXPECT_EQ(statistics.rtt.count(), 0);
+    EXPECT_EQ(statistics.smoothed_rtt.count(), 0);
+    EXPECT_FALSE(statistics.has_transport_info);
+}
+
+TEST(NetworkChannelTest, TransferredBytes)
+{
+    TestChannel channel;
+    channel.addTxBytes(100);
+    channel.addTxBytes(20);
+    channel.addRxBytes(7);
+
+    NetworkChannel::Statistics statistics = channel.statistics();
+    EXPECT_EQ(statistics.bytes_sent, 120);
+    EXPECT_EQ(statistics.bytes_received, 7);
+}
+
+TEST(NetworkChannelTest, SmoothedRoundTripTime)
+{
+    TestChannel channel;
+
+    channel.addRoundTripTime(std::chrono::microseconds(8000));
+    EXPECT_EQ(channel.roundTripTime().count(), 8000);
+    EXPECT_EQ(channel.smoothedRoundTripTime().count(), 8000);
+    EXPECT_EQ(channel.statistics().rtt_variance.count(), 4000);
+
+    channel.addRoundTripTime(std::chrono::microseconds(16000));
+    EXPECT_EQ(channel.roundTripTime().count(), 16000);
+    EXPECT_EQ(channel.smoothedRoundTripTime().count(), 9000);
+    EXPECT_EQ(channel.statistics().rtt_variance.count(), 5000);
+
+    // A constant round trip time is approached and the variation goes down.
+    for (int i = 0; i < 100; ++i)
+        channel.addRoundTripTime(std::chrono::microseconds(2000));
+
+    EXPECT_NEAR(static_cast<double>(channel.smoothedRoundTripTime().count()), 2000.0, 10.0);
+    EXPECT_LT(channel.statistics().rtt_variance.count(), 10);
+}
+
+} // namespace base
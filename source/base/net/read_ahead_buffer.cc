@@ -0,0 +1,79 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/net/read_ahead_buffer.h"
+
+#include "base/logging.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace base {
+
+ReadAheadBuffer::ReadAheadBuffer(size_t capacity)
+    : buffer_(capacity)
+{
+    DCHECK_GT(capacity, 0u);
+}
+
+ReadAheadBuffer::~ReadAheadBuffer() = default;
+
+uint8_t* ReadAheadBuffer::prepare()
+{
+    if (begin_)
+    {
+        const size_t size = end_ - begin_;
+        if (size)
+            memmove(buffer_.data(), buffer_.data() + begin_, size);
+
+        begin_ = 0;
+        end_ = size;
+    }
+
+    return buffer_.data() + end_;
+}
+
+void ReadAheadBuffer::commit(size_t size)
+{
+    DCHECK_LE(size, freeSize());
+    end_ += std::min(size, freeSize());
+}
+
+void ReadAheadBuffer::consume(size_t size)
+{
+    DCHECK_LE(size, this->size());
+    begin_ += std::min(size, this->size());
+
+    if (begin_ == end_)
+    {
+        begin_ = 0;
+        end_ = 0;
+    }
+}
+
+size_t ReadAheadBuffer::read(uint8_t* out, size_t size)
+{
+    size = std::min(size, this->size());
+    if (size)
+    {
+        memcpy(out, data(), size);
+        consume(size);
+    }
+    return size;
+}
+
+} // namespace base
@@ -0,0 +1,66 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef BASE_NET_READ_AHEAD_BUFFER_H
+#define BASE_NET_READ_AHEAD_BUFFER_H
+
+#include "base/macros_magic.h"
+#include "base/memory/byte_array.h"
+
+namespace base {
+
+// Buffer for reading from a socket with large reads. The data is appended to the end and consumed
+// from the beginning. The unread data is moved to the beginning before the next read, so a
+// message in the buffer is always contiguous.
+class ReadAheadBuffer
+{
+public:
+    explicit ReadAheadBuffer(size_t capacity);
+    ~ReadAheadBuffer();
+
+    size_t capacity() const { return buffer_.size(); }
+
+    // Unread data.
+    const uint8_t* data() const { return buffer_.data() + begin_; }
+    size_t size() const { return end_ - begin_; }
+    bool empty() const { return begin_ == end_; }
+
+    // Free space for the next read. The unread data is moved to the beginning first.
+    uint8_t* prepare();
+    size_t freeSize() const { return buffer_.size() - end_; }
+
+    // Adds |size| bytes written to the free space.
+    void commit(size_t size);
+
+    // Removes |size| bytes from the beginning of the unread data.
+    void consume(size_t size);
+
+    // Copies up to |size| bytes of the unread data to |out| and removes them. Returns the number
+    // of copied bytes.
+    size_t read(uint8_t* out, size_t size);
+
+private:
+    ByteArray buffer_;
+    size_t begin_ = 0;
+    size_t end_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(ReadAheadBuffer);
+};
+
+} // namespace base
+
+#endif // BASE_NET_READ_AHEAD_BUFFER_H
@@ -0,0 +1,96 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/net/read_ahead_buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+namespace base {
+
+namespace {
+
+void write(ReadAheadBuffer* buffer, const char* data)
+{
+    const size_t size = strlen(data);
+    ASSERT_GE(buffer->freeSize(), size);
+
+    memcpy(buffer->prepare(), data, size);
+    buffer->commit(size);
+}
+
+std::string unread(const ReadAheadBuffer& buffer)
+{
+    return std::string(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+}
+
+} // namespace
+
+TEST(ReadAheadBufferTest, WriteAndRead)
+{
+    ReadAheadBuffer buffer(16);
+    EXPECT_TRUE(buffer.empty());
+    EXPECT_EQ(buffer.freeSize(), 16u);
+
+    write(&buffer, "abcdef");
+    EXPECT_EQ(buffer.size(), 6u);
+    EXPECT_EQ(unread(buffer), "abcdef");
+
+    uint8_t out[4];
+    EXPECT_EQ(buffer.read(out, sizeof(out)), 4u);
+    EXPECT_EQ(memcmp(out, "abcd", 4), 0);
+    EXPECT_EQ(unread(buffer), "ef");
+
+    // Only the unread data is copied.
+    EXPECT_EQ(buffer.read(out, sizeof(out)), 2u);
+    EXPECT_EQ(memcmp(out, "ef", 2), 0);
+    EXPECT_TRUE(buffer.empty());
+    EXPECT_EQ(buffer.read(out, sizeof(out)), 0u);
+}
+
+TEST(ReadAheadBufferTest, ConsumeAll)
+{
+    ReadAheadBuffer buffer(8);
+
+    write(&buffer, "12345678");
+    EXPECT_EQ(buffer.freeSize(), 0u);
+
+    // The buffer starts from the beginning when all data is consumed.
+    buffer.consume(8);
+    EXPECT_TRUE(buffer.empty());
+    EXPECT_EQ(buffer.freeSize(), 8u);
+}
+
+TEST(ReadAheadBufferTest, Compact)
+{
+    ReadAheadBuffer buffer(8);
+
+    write(&buffer, "1234567");
+    buffer.consume(5);
+    EXPECT_EQ(buffer.freeSize(), 1u);
+
+    // The unread part of a message is moved to the beginning, so the rest is contiguous.
+    buffer.prepare();
+    EXPECT_EQ(buffer.freeSize(), 6u);
+    EXPECT_EQ(unread(buffer), "67");
+
+    write(&buffer, "89abcd");
+    EXPECT_EQ(unread(buffer), "6789abcd");
+}
+
+} // namespace base
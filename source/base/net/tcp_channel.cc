@@ -23,24 +23,82 @@
 #include "base/crypto/large_number_increment.h"
 #include "base/crypto/message_encryptor_fake.h"
 #include "base/crypto/message_decryptor_fake.h"
+#include "base/memory/byte_array_pool.h"
 #include "base/message_loop/message_loop.h"
 #include "base/message_loop/message_pump_asio.h"
 #include "base/net/tcp_channel_proxy.h"
+#include "base/net/tcp_keep_alive.h"
 #include "base/strings/unicode.h"
+#include "base/task_runner.h"
+#include "base/trace_event.h"
+#include "build/build_config.h"
 
 #include <asio/connect.hpp>
 #include <asio/read.hpp>
 #include <asio/write.hpp>
 
+#include <algorithm>
+
+#if defined(OS_LINUX)
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif // defined(OS_LINUX)
+
 namespace base {
 
+namespace {
+
+// Limits of the messages written with one operation. Large messages are still written one at a
+// time, the limits only group small messages.
+const size_t kMaxWriteBatchCount = 16;
+const size_t kMaxWriteBatchBytes = 512 * 1024; // 512 kB
+
+// The channel id of a frame with packed messages. The frame contains records with the size of the
+// message, the channel id and the message itself.
+const uint8_t kPackedChannelId = 0xFF;
+
+// Only small messages are packed. Large messages do not benefit from the saved overhead.
+const size_t kMaxPackedMessageSize = 4 * 1024; // 4 kB
+const size_t kMaxPackedFrameSize = 16 * 1024; // 16 kB
+
+// Share of the bandwidth for the lanes of normal and low priority when both have messages.
+const size_t kNormalLaneWeight = 3;
+const size_t kLowLaneWeight = 1;
+
+// Small messages and sizes are read from the socket in chunks of this size.
+const size_t kDefaultReadAheadSize = 16 * 1024; // 16 kB
+
+// Buffers larger than this are returned to the pool of the thread if the channel has not needed
+// such a buffer during the interval. Idle channels keep only small buffers.
+const size_t kMaxIdleBufferSize = 64 * 1024; // 64 kB
+const std::chrono::seconds kBufferTrimInterval { 30 };
+
+// Reads the size of the message in the format of VariableSizeWriter.
+bool readPackedSize(const uint8_t* data, size_t size, size_t* pos, size_t* message_size)
+{
+    if (*pos >= size)
+        return false;
+
+    size_t length;
+    if (!VariableSizeReader::parse(data + *pos, size - *pos, message_size, &length))
+        return false;
+
+    *pos += length;
+    return true;
+}
+
+} // namespace
+
 TcpChannel::TcpChannel()
     : proxy_(new TcpChannelProxy(MessageLoop::current()->taskRunner(), this)),
       io_context_(MessageLoop::current()->pumpAsio()->ioContext()),
       socket_(io_context_),
       resolver_(std::make_unique<asio::ip::tcp::resolver>(io_context_)),
       encryptor_(std::make_unique<MessageEncryptorFake>()),
-      decryptor_(std::make_unique<MessageDecryptorFake>())
+      decryptor_(std::make_unique<MessageDecryptorFake>()),
+      self_(std::make_shared<TcpChannel*>(this)),
+      read_ahead_size_(kDefaultReadAheadSize)
 {
     LOG(LS_INFO) << "Ctor";
 }
@@ -51,7 +109,9 @@ TcpChannel::TcpChannel(asio::ip::tcp::socket&& socket)
       socket_(std::move(socket)),
       connected_(true),
       encryptor_(std::make_unique<MessageEncryptorFake>()),
-      decryptor_(std::make_unique<MessageDecryptorFake>())
+      decryptor_(std::make_unique<MessageDecryptorFake>()),
+      self_(std::make_shared<TcpChannel*>(this)),
+      read_ahead_size_(kDefaultReadAheadSize)
 {
     LOG(LS_INFO) << "Ctor";
     DCHECK(socket_.is_open());
@@ -66,6 +126,18 @@ TcpChannel::~TcpChannel()
 
     listener_ = nullptr;
     disconnect();
+
+    *self_ = nullptr;
+
+    {
+        // The work on the crypto task runner uses the buffers, so it must be completed first.
+        std::unique_lock lock(crypto_lock_);
+        crypto_done_.wait(lock, [this]() { return !crypto_pending_; });
+    }
+
+    // The buffers can be used by the next channel on this thread.
+    ByteArrayPool::recycle(std::move(read_buffer_));
+    ByteArrayPool::recycle(std::move(write_buffer_));
 }
 
 std::shared_ptr<TcpChannelProxy> TcpChannel::channelProxy()
@@ -88,6 +160,16 @@ void TcpChannel::setDecryptor(std::unique_ptr<MessageDecryptor> decryptor)
     decryptor_ = std::move(decryptor);
 }
 
+void TcpChannel::setCryptoTaskRunner(
+    std::shared_ptr<TaskRunner> crypto_task_runner, size_t threshold)
+{
+    DCHECK(!crypto_task_runner || !crypto_task_runner->belongsToCurrentThread());
+
+    task_runner_ = MessageLoop::current()->taskRunner();
+    crypto_task_runner_ = std::move(crypto_task_runner);
+    crypto_threshold_ = threshold;
+}
+
 std::u16string TcpChannel::peerAddress() const
 {
     if (!socket_.is_open())
@@ -96,6 +178,16 @@ std::u16string TcpChannel::peerAddress() const
     return utf16FromLocal8Bit(socket_.remote_endpoint().address().to_string());
 }
 
+std::u16string TcpChannel::localAddress() const
+{
+    std::error_code error_code;
+    asio::ip::tcp::endpoint endpoint = socket_.local_endpoint(error_code);
+    if (error_code)
+        return std::u16string();
+
+    return utf16FromLocal8Bit(endpoint.address().to_string());
+}
+
 void TcpChannel::connect(std::u16string_view address, uint16_t port)
 {
     if (connected_ || !resolver_)
@@ -151,6 +243,15 @@ void TcpChannel::resume()
 
     paused_ = false;
 
+    // Reading is restarted when the outgoing queue is drained.
+    if (is_read_throttled_)
+        return;
+
+    restartReading();
+}
+
+void TcpChannel::restartReading()
+{
     switch (state_)
     {
         // We already have an incomplete read operation.
@@ -158,6 +259,7 @@ void TcpChannel::resume()
         case ReadState::READ_USER_DATA:
         case ReadState::READ_SERVICE_HEADER:
         case ReadState::READ_SERVICE_DATA:
+        case ReadState::DECRYPTING:
             return;
 
         default:
@@ -166,14 +268,52 @@ void TcpChannel::resume()
 
     // If we have a message that was received before the pause command.
     if (state_ == ReadState::PENDING)
+    {
         onMessageReceived();
+        return;
+    }
+
+    if (state_ == ReadState::PENDING_DECRYPTED)
+    {
+        onMessageDecrypted(true);
+        return;
+    }
+
+    if (state_ == ReadState::PENDING_PACKED)
+    {
+        state_ = ReadState::IDLE;
+        onPackedMessagesReceived();
+        continueReading();
+        return;
+    }
 
     doReadSize();
 }
 
-void TcpChannel::send(uint8_t channel_id, ByteArray&& buffer)
+void TcpChannel::send(uint8_t channel_id, ByteArray&& buffer, Priority priority)
+{
+    addWriteTask(WriteTask::Type::USER_DATA, channel_id, std::move(buffer), priority);
+}
+
+void TcpChannel::send(
+    uint8_t channel_id, const google::protobuf::MessageLite& message, Priority priority)
+{
+    send(channel_id, serialize(message), priority);
+}
+
+void TcpChannel::shutdownSend()
 {
-    addWriteTask(WriteTask::Type::USER_DATA, channel_id, std::move(buffer));
+    if (!connected_)
+        return;
+
+    asio::error_code error_code;
+    socket_.shutdown(asio::ip::tcp::socket::shutdown_send, error_code);
+
+    if (error_code)
+    {
+        LOG(LS_ERROR) << "Failed to shutdown the sending side: "
+                      << base::utf16FromLocal8Bit(error_code.message());
+    }
 }
 
 bool TcpChannel::setNoDelay(bool enable)
@@ -193,14 +333,9 @@ bool TcpChannel::setNoDelay(bool enable)
     return true;
 }
 
-bool TcpChannel::setKeepAlive(bool enable, const Seconds& interval, const Seconds& timeout)
+bool TcpChannel::setKeepAlive(bool enable, const Seconds& interval, const Seconds& timeout,
+                              bool only_when_idle)
 {
-    if (enable && keep_alive_timer_)
-    {
-        LOG(LS_WARNING) << "Keep alive already active";
-        return false;
-    }
-
     if (interval < Seconds(15) || interval > Seconds(300))
     {
         LOG(LS_ERROR) << "Invalid interval: " << interval.count();
@@ -217,29 +352,43 @@ bool TcpChannel::setKeepAlive(bool enable, const Seconds& interval, const Second
     {
         keep_alive_counter_.clear();
 
-        if (keep_alive_timer_)
-        {
-            keep_alive_timer_->cancel();
-            keep_alive_timer_.reset();
-        }
+        keep_alive_timer_.reset();
+        is_keep_alive_ping_sent_ = false;
+    }
+    else if (keep_alive_timer_)
+    {
+        LOG(LS_INFO) << "Keep alive changed (interval: " << interval.count() << "s, timeout: "
+                     << timeout.count() << "s, only when idle: " << only_when_idle << ")";
+
+        keep_alive_interval_ = interval;
+        keep_alive_timeout_ = timeout;
+        keep_alive_only_when_idle_ = only_when_idle;
+
+        // The pong of the sent ping restarts the interval.
+        if (!is_keep_alive_ping_sent_)
+            startKeepAliveInterval();
     }
     else
     {
         keep_alive_interval_ = interval;
         keep_alive_timeout_ = timeout;
+        keep_alive_only_when_idle_ = only_when_idle;
 
         keep_alive_counter_.resize(sizeof(uint32_t));
         memset(keep_alive_counter_.data(), 0, keep_alive_counter_.size());
 
-        keep_alive_timer_ = std::make_unique<asio::high_resolution_timer>(io_context_);
-        keep_alive_timer_->expires_after(keep_alive_interval_);
-        keep_alive_timer_->async_wait(
-            std::bind(&TcpChannel::onKeepAliveInterval, this, std::placeholders::_1));
+        keep_alive_timer_ = std::make_unique<TimerWheel::Timer>();
+        startKeepAliveInterval();
     }
 
     return true;
 }
 
+bool TcpChannel::setTcpKeepAlive(bool enable, const Seconds& time, const Seconds& interval)
+{
+    return base::setTcpKeepAlive(socket_.native_handle(), enable, time, interval);
+}
+
 void TcpChannel::setChannelIdSupport(bool enable)
 {
     channel_id_support_ = enable;
@@ -250,6 +399,117 @@ bool TcpChannel::hasChannelIdSupport() const
     return channel_id_support_;
 }
 
+void TcpChannel::setMessageBatching(bool enable, const Milliseconds& max_delay)
+{
+    batching_ = enable;
+    batching_delay_ = enable ? max_delay : Milliseconds(0);
+
+    if (batching_delay_ > Milliseconds(0))
+    {
+        if (!batching_timer_)
+            batching_timer_ = std::make_unique<asio::high_resolution_timer>(io_context_);
+    }
+    else if (batching_timer_)
+    {
+        // Delayed messages are written immediately.
+        const bool schedule_write = is_batching_delayed_;
+
+        is_batching_delayed_ = false;
+        batching_timer_->cancel();
+        batching_timer_.reset();
+
+        if (schedule_write && pendingMessages())
+            doWrite();
+    }
+}
+
+bool TcpChannel::hasMessageBatching() const
+{
+    return batching_;
+}
+
+size_t TcpChannel::pendingMessages() const
+{
+    size_t count = write_queue_.size();
+
+    for (const WriteQueue& lane : write_lanes_)
+        count += lane.size();
+
+    return count;
+}
+
+NetworkChannel::Statistics TcpChannel::statistics() const
+{
+    Statistics statistics = NetworkChannel::statistics();
+
+    statistics.queued_messages = pendingMessages();
+    statistics.queued_bytes = write_queue_bytes_;
+    statistics.buffer_bytes = read_prefix_.capacity() + read_buffer_.capacity() +
+        write_buffer_.capacity() + packed_message_.capacity();
+    if (read_ahead_)
+        statistics.buffer_bytes += read_ahead_->capacity();
+
+    // The messages of each queue are in the order of their arrival, so the oldest message is at
+    // the front of one of them.
+    std::optional<WriteTask::Clock::time_point> oldest_time;
+
+    auto check_queue = [&oldest_time](const WriteQueue& queue)
+    {
+        if (!queue.empty() && (!oldest_time || queue.front().queueTime() < *oldest_time))
+            oldest_time = queue.front().queueTime();
+    };
+
+    check_queue(write_queue_);
+    for (const WriteQueue& lane : write_lanes_)
+        check_queue(lane);
+
+    if (oldest_time)
+    {
+        statistics.oldest_queued_age = std::chrono::duration_cast<std::chrono::microseconds>(
+            WriteTask::Clock::now() - *oldest_time);
+    }
+
+#if defined(OS_LINUX)
+    if (connected_)
+    {
+        tcp_info info;
+        socklen_t length = sizeof(info);
+
+        if (getsockopt(const_cast<asio::ip::tcp::socket&>(socket_).native_handle(),
+                       IPPROTO_TCP, TCP_INFO, &info, &length) == 0)
+        {
+            statistics.has_transport_info = true;
+            statistics.transport_rtt = std::chrono::microseconds(info.tcpi_rtt);
+            statistics.transport_rtt_variance = std::chrono::microseconds(info.tcpi_rttvar);
+            statistics.congestion_window =
+                static_cast<size_t>(info.tcpi_snd_cwnd) * info.tcpi_snd_mss;
+            statistics.bytes_in_flight = static_cast<size_t>(info.tcpi_unacked) * info.tcpi_snd_mss;
+            statistics.retransmits = info.tcpi_total_retrans;
+        }
+    }
+#endif // defined(OS_LINUX)
+
+    return statistics;
+}
+
+void TcpChannel::setReadAheadSize(size_t size)
+{
+    // The buffer is replaced in doReadSize() when it has no unread data.
+    read_ahead_size_ = size;
+}
+
+void TcpChannel::setWriteQueueLimits(size_t soft_limit, size_t hard_limit)
+{
+    DCHECK(!soft_limit || !hard_limit || soft_limit <= hard_limit);
+
+    LOG(LS_INFO) << "Write queue limits: " << soft_limit << "/" << hard_limit << " bytes";
+
+    write_queue_soft_limit_ = soft_limit;
+    write_queue_hard_limit_ = hard_limit;
+
+    checkWriteQueueLimits();
+}
+
 bool TcpChannel::setReadBufferSize(size_t size)
 {
     asio::socket_base::receive_buffer_size option(static_cast<int>(size));
@@ -291,6 +551,12 @@ void TcpChannel::disconnect()
 
     connected_ = false;
 
+    if (batching_timer_)
+    {
+        is_batching_delayed_ = false;
+        batching_timer_->cancel();
+    }
+
     std::error_code ignored_code;
 
     socket_.cancel(ignored_code);
@@ -341,209 +607,755 @@ void TcpChannel::onErrorOccurred(const Location& location, ErrorCode error_code)
 void TcpChannel::onMessageWritten(uint8_t channel_id)
 {
     if (listener_)
-        listener_->onTcpMessageWritten(channel_id, write_queue_.size());
+        listener_->onTcpMessageWritten(channel_id, pendingMessages());
 }
 
 void TcpChannel::onMessageReceived()
 {
-    uint8_t* read_data = read_buffer_.data();
-    size_t read_size = read_buffer_.size();
-    uint8_t channel_id = 0;
+    const size_t message_size = read_prefix_.size() + read_buffer_.size();
+    std::optional<size_t> prefix_size = readPrefixSize(message_size);
 
-    if (channel_id_support_)
+    if (!prefix_size.has_value())
     {
-        read_data += sizeof(channel_id);
-        read_size -= sizeof(channel_id);
-        channel_id = read_buffer_[0];
+        onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
+        return;
     }
 
-    resizeBuffer(&decrypt_buffer_, decryptor_->decryptedDataSize(read_size));
-
-    if (!decryptor_->decrypt(read_data, read_size, decrypt_buffer_.data()))
+    // The decryptor is changed by the authenticator after its message is written, so the size of
+    // the next message could be read with the previous decryptor. The message is split again.
+    if (*prefix_size != read_prefix_.size())
     {
-        onErrorOccurred(FROM_HERE, ErrorCode::ACCESS_DENIED);
-        return;
-    }
+        read_buffer_.insert(read_buffer_.begin(), read_prefix_.begin(), read_prefix_.end());
 
-    if (listener_)
-        listener_->onTcpMessageReceived(channel_id, decrypt_buffer_);
-}
+        const auto data_begin = read_buffer_.begin() + static_cast<ptrdiff_t>(*prefix_size);
+        read_prefix_.assign(read_buffer_.begin(), data_begin);
+        read_buffer_.erase(read_buffer_.begin(), data_begin);
+    }
 
-void TcpChannel::addWriteTask(WriteTask::Type type, uint8_t channel_id, ByteArray&& data)
-{
-    const bool schedule_write = write_queue_.empty();
+    const uint8_t* prefix = read_prefix_.data();
+    if (channel_id_support_)
+        prefix += sizeof(uint8_t);
 
-    // Add the buffer to the queue for sending.
-    write_queue_.emplace(type, channel_id, std::move(data));
+    if (crypto_task_runner_ && read_buffer_.size() >= crypto_threshold_)
+    {
+        // The next message is not read until this one is decrypted, so the order of the messages
+        // and the IV of the decryptor are kept.
+        state_ = ReadState::DECRYPTING;
+        postCryptoTask([this, prefix]()
+        {
+            return decryptor_->decryptInPlace(prefix, read_buffer_.data(), read_buffer_.size());
+        },
+        std::bind(&TcpChannel::onMessageDecrypted, this, std::placeholders::_1));
+        return;
+    }
 
-    if (schedule_write)
-        doWrite();
+    onMessageDecrypted(
+        decryptor_->decryptInPlace(prefix, read_buffer_.data(), read_buffer_.size()));
 }
 
-void TcpChannel::doWrite()
+void TcpChannel::onMessageDecrypted(bool succeeded)
 {
-    const WriteTask& task = write_queue_.front();
-    const ByteArray& source_buffer = task.data();
-    const uint8_t channel_id = task.channelId();
-
-    if (source_buffer.empty())
+    if (!succeeded)
     {
-        onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
+        onErrorOccurred(FROM_HERE, ErrorCode::ACCESS_DENIED);
         return;
     }
 
-    if (task.type() == WriteTask::Type::USER_DATA)
+    // The channel was paused while the message was decrypted on the crypto task runner.
+    if (isReadingStopped())
     {
-        // Calculate the size of the encrypted message.
-        size_t target_data_size = encryptor_->encryptedDataSize(source_buffer.size());
-        if (channel_id_support_)
-            target_data_size += sizeof(channel_id);
+        state_ = ReadState::PENDING_DECRYPTED;
+        return;
+    }
 
-        if (target_data_size > kMaxMessageSize)
-        {
-            LOG(LS_ERROR) << "Too big outgoing message: " << target_data_size;
-            onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
-            return;
-        }
+    const uint8_t channel_id = channel_id_support_ ? read_prefix_[0] : 0;
 
-        asio::const_buffer variable_size = variable_size_writer_.variableSize(target_data_size);
+    if (channel_id_support_ && channel_id == kPackedChannelId)
+    {
+        packed_read_pos_ = 0;
+        onPackedMessagesReceived();
+    }
+    else if (listener_)
+    {
+        listener_->onTcpMessageReceived(channel_id, read_buffer_);
+    }
 
-        resizeBuffer(&write_buffer_, variable_size.size() + target_data_size);
+    continueReading();
+}
 
-        // Copy the size of the message to the buffer.
-        memcpy(write_buffer_.data(), variable_size.data(), variable_size.size());
+void TcpChannel::onPackedMessagesReceived()
+{
+    const uint8_t* data = read_buffer_.data();
+    const size_t size = read_buffer_.size();
 
-        uint8_t* write_buffer = write_buffer_.data() + variable_size.size();
-        if (channel_id_support_)
+    while (packed_read_pos_ < size)
+    {
+        // The remaining messages will be notified after calling method resume().
+        if (isReadingStopped())
         {
-            // Copy the channel id to the buffer.
-            memcpy(write_buffer, &channel_id, sizeof(channel_id));
-            write_buffer += sizeof(channel_id);
+            state_ = ReadState::PENDING_PACKED;
+            return;
         }
 
-        // Encrypt the message.
-        if (!encryptor_->encrypt(source_buffer.data(), source_buffer.size(), write_buffer))
+        size_t message_size;
+        if (!readPackedSize(data, size, &packed_read_pos_, &message_size) || !message_size ||
+            size - packed_read_pos_ < sizeof(uint8_t) + message_size)
         {
-            onErrorOccurred(FROM_HERE, ErrorCode::ACCESS_DENIED);
+            onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
             return;
         }
-    }
-    else
-    {
-        DCHECK_EQ(task.type(), WriteTask::Type::SERVICE_DATA);
 
-        resizeBuffer(&write_buffer_, source_buffer.size());
+        const uint8_t channel_id = data[packed_read_pos_];
+        const uint8_t* message = data + packed_read_pos_ + sizeof(channel_id);
 
-        // Service data does not need encryption. Copy the source buffer.
-        memcpy(write_buffer_.data(), source_buffer.data(), source_buffer.size());
-    }
+        packed_read_pos_ += sizeof(channel_id) + message_size;
+        packed_message_.assign(message, message + message_size);
 
-    // Send the buffer to the recipient.
-    asio::async_write(socket_,
-                      asio::buffer(write_buffer_.data(), write_buffer_.size()),
-                      std::bind(&TcpChannel::onWrite,
-                                this,
-                                std::placeholders::_1,
-                                std::placeholders::_2));
+        if (!listener_)
+            return;
+
+        listener_->onTcpMessageReceived(channel_id, packed_message_);
+    }
 }
 
-void TcpChannel::onWrite(const std::error_code& error_code, size_t bytes_transferred)
+void TcpChannel::continueReading()
 {
-    if (error_code)
+    // The channel was paused while notifying about packed messages.
+    if (state_ == ReadState::PENDING_PACKED)
+        return;
+
+    if (isReadingStopped())
     {
-        onErrorOccurred(FROM_HERE, error_code);
+        state_ = ReadState::IDLE;
         return;
     }
 
-    DCHECK(!write_queue_.empty());
+    doReadSize();
+}
 
-    // Update TX statistics.
-    addTxBytes(bytes_transferred);
+void TcpChannel::addWriteTask(WriteTask::Type type, uint8_t channel_id, ByteArray&& data,
+                              Priority priority)
+{
+    DCHECK(type != WriteTask::Type::USER_DATA || !channel_id_support_ ||
+           channel_id != kPackedChannelId);
 
-    const WriteTask& task = write_queue_.front();
-    WriteTask::Type task_type = task.type();
-    uint8_t channel_id = task.channelId();
+    // The channel is disconnected soon, so the messages are not queued anymore.
+    if (is_write_queue_overflow_)
+        return;
 
-    // Delete the sent message from the queue.
-    write_queue_.pop();
+    const bool schedule_write = !pendingMessages();
+    const bool can_be_delayed = batching_timer_ && type == WriteTask::Type::USER_DATA &&
+                                data.size() <= kMaxPackedMessageSize;
 
-    // If the queue is not empty, then we send the following message.
-    bool schedule_write = !write_queue_.empty() || proxy_->reloadWriteQueue(&write_queue_);
+    // Add the buffer to the queue for sending.
+    write_queue_bytes_ += data.size();
+    write_lanes_[static_cast<size_t>(priority)].emplace_back(
+        type, channel_id, std::move(data), priority);
 
-    if (task_type == WriteTask::Type::USER_DATA)
-        onMessageWritten(channel_id);
+    checkWriteQueueLimits();
 
-    if (schedule_write)
-        doWrite();
-}
+    if (is_batching_delayed_)
+    {
+        // The delayed messages are written together with a message that cannot wait or when the
+        // packed frame is full.
+        if (can_be_delayed && write_queue_bytes_ < kMaxPackedFrameSize)
+            return;
 
-void TcpChannel::doReadSize()
-{
-    state_ = ReadState::READ_SIZE;
-    asio::async_read(socket_,
-                     variable_size_reader_.buffer(),
-                     std::bind(&TcpChannel::onReadSize,
-                               this,
-                               std::placeholders::_1,
-                               std::placeholders::_2));
-}
+        is_batching_delayed_ = false;
+        batching_timer_->cancel();
 
-void TcpChannel::onReadSize(const std::error_code& error_code, size_t bytes_transferred)
-{
-    if (error_code)
-    {
-        onErrorOccurred(FROM_HERE, error_code);
+        doWrite();
         return;
     }
 
-    // Update RX statistics.
-    addRxBytes(bytes_transferred);
+    if (!schedule_write)
+        return;
 
-    std::optional<size_t> size = variable_size_reader_.messageSize();
-    if (size.has_value())
+    if (can_be_delayed && channel_id_support_)
     {
-        size_t message_size = *size;
+        // Wait for other small messages to pack them into one frame.
+        is_batching_delayed_ = true;
+        batching_timer_->expires_after(batching_delay_);
+        batching_timer_->async_wait(
+            std::bind(&TcpChannel::onBatchingTimeout, this, std::placeholders::_1));
+        return;
+    }
 
-        if (message_size > kMaxMessageSize)
-        {
-            LOG(LS_ERROR) << "Too big incoming message: " << message_size;
-            onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
-            return;
-        }
+    doWrite();
+}
 
-        // If the message size is 0 (in other words, the first received byte is 0), then you need
-        // to start reading the service message.
-        if (!message_size)
-        {
-            doReadServiceHeader();
-            return;
-        }
+void TcpChannel::postCryptoTask(std::function<bool()> work, std::function<void(bool)> reply)
+{
+    DCHECK(crypto_task_runner_);
 
-        doReadUserData(message_size);
-    }
-    else
     {
-        doReadSize();
+        std::scoped_lock lock(crypto_lock_);
+        ++crypto_pending_;
     }
-}
 
-void TcpChannel::doReadUserData(size_t length)
-{
-    resizeBuffer(&read_buffer_, length);
+    // The counter is decremented when the task is destroyed: after the work or if the crypto task
+    // runner is stopped before running it. The destructor of the channel can complete after this.
+    std::shared_ptr<void> pending(nullptr, [this](void*)
+    {
+        std::scoped_lock lock(crypto_lock_);
+        --crypto_pending_;
+        crypto_done_.notify_all();
+    });
+
+    crypto_task_runner_->postTask([self = self_,
+                                   task_runner = task_runner_,
+                                   pending = std::move(pending),
+                                   work = std::move(work),
+                                   reply = std::move(reply)]()
+    {
+        const bool succeeded = work();
+
+        task_runner->postTask([self, reply, succeeded]()
+        {
+            // The channel may be destroyed or disconnected while the work is in progress.
+            if (*self && (*self)->connected_)
+                reply(succeeded);
+        });
+    });
+}
+
+void TcpChannel::onBatchingTimeout(const std::error_code& error_code)
+{
+    if (error_code == asio::error::operation_aborted)
+        return;
+
+    // The timer could expire after the delayed messages have already been written.
+    if (!is_batching_delayed_)
+        return;
+
+    is_batching_delayed_ = false;
+
+    if (pendingMessages())
+        doWrite();
+}
+
+void TcpChannel::doWrite()
+{
+    TRACE_EVENT("send");
+
+    fillWriteQueue();
+    DCHECK(!write_queue_.empty());
+
+    // Small user messages are packed into one frame only with channel id support.
+    const bool batching = batching_ && channel_id_support_;
+
+    size_t batch_count = 0;
+    size_t batch_bytes = 0;
+
+    write_frames_.clear();
+
+    // Split the messages of the batch into frames. The first message is always written, even if it
+    // is larger than the batch limit.
+    for (const WriteTask& task : write_queue_)
+    {
+        const size_t source_size = task.data().size();
+
+        if (batch_count && (batch_count >= kMaxWriteBatchCount ||
+                            batch_bytes + source_size > kMaxWriteBatchBytes))
+        {
+            break;
+        }
+
+        if (!source_size)
+        {
+            onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
+            return;
+        }
+
+        const bool is_user_data = task.type() == WriteTask::Type::USER_DATA;
+        const bool can_be_packed = batching && is_user_data && source_size <= kMaxPackedMessageSize;
+        const size_t record_size = packedRecordSize(source_size);
+
+        if (can_be_packed && !write_frames_.empty() && write_frames_.back().can_be_packed &&
+            write_frames_.back().records_size + record_size <= kMaxPackedFrameSize)
+        {
+            OutgoingFrame& frame = write_frames_.back();
+            ++frame.task_count;
+            frame.records_size += record_size;
+        }
+        else
+        {
+            OutgoingFrame frame;
+            frame.first_task = batch_count;
+            frame.task_count = 1;
+            frame.source_size = source_size;
+            frame.records_size = record_size;
+            frame.is_user_data = is_user_data;
+            frame.can_be_packed = can_be_packed;
+
+            write_frames_.emplace_back(frame);
+        }
+
+        batch_bytes += source_size;
+        ++batch_count;
+    }
+
+    // Calculate the size of the buffer for the encrypted frames.
+    size_t buffer_size = 0;
+
+    for (const OutgoingFrame& frame : write_frames_)
+    {
+        if (!frame.is_user_data)
+            continue;
+
+        const size_t target_data_size = encryptedMessageSize(frame.plainSize());
+        if (target_data_size > kMaxMessageSize)
+        {
+            LOG(LS_ERROR) << "Too big outgoing message: " << target_data_size;
+            onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
+            return;
+        }
+
+        buffer_size +=
+            variable_size_writer_.variableSize(target_data_size).size() + target_data_size;
+
+        // A separate message is encrypted in place and is not copied to the buffer.
+        if (frame.task_count == 1)
+            buffer_size -= frame.source_size;
+    }
+
+    resizeBuffer(&write_buffer_, buffer_size);
+    onBufferUsed(buffer_size);
+    write_buffers_.clear();
+    seal_items_.clear();
+
+    uint8_t* write_buffer = write_buffer_.data();
+    size_t max_frame_size = 0;
+
+    for (const OutgoingFrame& frame : write_frames_)
+    {
+        const auto first_task = write_queue_.begin() + static_cast<ptrdiff_t>(frame.first_task);
+
+        if (!frame.is_user_data)
+        {
+            DCHECK_EQ(first_task->type(), WriteTask::Type::SERVICE_DATA);
+
+            // Service data does not need encryption. The buffer is written directly from the
+            // queue.
+            const ByteArray& source_buffer = first_task->data();
+            write_buffers_.emplace_back(source_buffer.data(), source_buffer.size());
+            continue;
+        }
+
+        const bool is_packed = frame.task_count > 1;
+        const size_t source_size = frame.plainSize();
+        const uint8_t channel_id = is_packed ? kPackedChannelId : first_task->channelId();
+
+        const size_t target_data_size = encryptedMessageSize(source_size);
+        asio::const_buffer variable_size = variable_size_writer_.variableSize(target_data_size);
+        uint8_t* segment = write_buffer;
+
+        // Copy the size of the message to the buffer.
+        memcpy(write_buffer, variable_size.data(), variable_size.size());
+        write_buffer += variable_size.size();
+
+        if (channel_id_support_)
+        {
+            // Copy the channel id to the buffer.
+            memcpy(write_buffer, &channel_id, sizeof(channel_id));
+            write_buffer += sizeof(channel_id);
+        }
+
+        // The prefix of the encrypted message follows the channel id.
+        uint8_t* prefix = write_buffer;
+        write_buffer += encryptor_->encryptedDataSize(source_size) - source_size;
+
+        uint8_t* source_data;
+
+        if (is_packed)
+        {
+            // The messages are packed after the prefix and encrypted in place in the buffer.
+            source_data = write_buffer;
+
+            const size_t packed_size = packMessages(first_task, frame.task_count, source_data);
+            DCHECK_EQ(packed_size, frame.records_size);
+
+            write_buffer += packed_size;
+            write_buffers_.emplace_back(segment, static_cast<size_t>(write_buffer - segment));
+        }
+        else
+        {
+            // The message is encrypted in place in the queue. Only the size, the channel id and
+            // the prefix are placed in the buffer.
+            source_data = first_task->mutableData().data();
+
+            write_buffers_.emplace_back(segment, static_cast<size_t>(write_buffer - segment));
+            write_buffers_.emplace_back(source_data, source_size);
+        }
+
+        seal_items_.push_back({ prefix, source_data, source_size });
+        max_frame_size = std::max(max_frame_size, source_size);
+    }
+
+    DCHECK_EQ(static_cast<size_t>(write_buffer - write_buffer_.data()), write_buffer_.size());
+    write_batch_count_ = batch_count;
+
+    if (crypto_task_runner_ && max_frame_size >= crypto_threshold_)
+    {
+        // The next batch is not written until this one is sent, so the order of the messages and
+        // the IV of the encryptor are kept.
+        postCryptoTask(std::bind(&TcpChannel::sealFrames, this),
+                       std::bind(&TcpChannel::onFramesSealed, this, std::placeholders::_1));
+        return;
+    }
+
+    onFramesSealed(sealFrames());
+}
+
+bool TcpChannel::sealFrames()
+{
+    for (const SealItem& item : seal_items_)
+    {
+        if (!encryptor_->encryptInPlace(item.prefix, item.data, item.size))
+            return false;
+    }
+
+    return true;
+}
+
+void TcpChannel::onFramesSealed(bool succeeded)
+{
+    if (!succeeded)
+    {
+        onErrorOccurred(FROM_HERE, ErrorCode::ACCESS_DENIED);
+        return;
+    }
+
+    // Send the buffers to the recipient.
+    asio::async_write(socket_,
+                      write_buffers_,
+                      std::bind(&TcpChannel::onWrite,
+                                this,
+                                std::placeholders::_1,
+                                std::placeholders::_2));
+}
+
+void TcpChannel::fillWriteQueue()
+{
+    size_t batch_bytes = 0;
+
+    for (const WriteTask& task : write_queue_)
+        batch_bytes += task.data().size();
+
+    // The messages are taken from the lanes with the same limits as the batch. The first message
+    // is always taken, even if it is larger than the batch limit.
+    while (write_queue_.size() < kMaxWriteBatchCount)
+    {
+        WriteQueue* lane = nextWriteLane();
+        if (!lane)
+            break;
+
+        const size_t source_size = lane->front().data().size();
+
+        if (!write_queue_.empty() && batch_bytes + source_size > kMaxWriteBatchBytes)
+            break;
+
+        lane_written_bytes_[static_cast<size_t>(lane->front().priority())] += source_size;
+        batch_bytes += source_size;
+
+        write_queue_.emplace_back(std::move(lane->front()));
+        lane->pop_front();
+    }
+}
+
+TcpChannel::WriteQueue* TcpChannel::nextWriteLane()
+{
+    WriteQueue& high_lane = write_lanes_[static_cast<size_t>(Priority::HIGH)];
+    WriteQueue& normal_lane = write_lanes_[static_cast<size_t>(Priority::NORMAL)];
+    WriteQueue& low_lane = write_lanes_[static_cast<size_t>(Priority::LOW)];
+
+    // Messages of high priority are always written first.
+    if (!high_lane.empty())
+        return &high_lane;
+
+    if (normal_lane.empty() || low_lane.empty())
+    {
+        // The lane that had no messages does not accumulate a share of the bandwidth.
+        lane_written_bytes_.fill(0);
+
+        if (!normal_lane.empty())
+            return &normal_lane;
+        if (!low_lane.empty())
+            return &low_lane;
+        return nullptr;
+    }
+
+    // Both lanes have messages. The lane that has written fewer bytes relative to its weight is
+    // chosen.
+    const size_t normal_bytes = lane_written_bytes_[static_cast<size_t>(Priority::NORMAL)];
+    const size_t low_bytes = lane_written_bytes_[static_cast<size_t>(Priority::LOW)];
+
+    if (low_bytes * kNormalLaneWeight < normal_bytes * kLowLaneWeight)
+        return &low_lane;
+
+    return &normal_lane;
+}
+
+size_t TcpChannel::packMessages(
+    WriteQueue::const_iterator first_task, size_t task_count, uint8_t* target)
+{
+    uint8_t* const begin = target;
+    size_t separate_size = 0;
+
+    for (auto task = first_task; task != first_task + static_cast<ptrdiff_t>(task_count); ++task)
+    {
+        const ByteArray& data = task->data();
+        const uint8_t channel_id = task->channelId();
+
+        // Each record contains the size of the message, the channel id and the message itself.
+        asio::const_buffer variable_size = variable_size_writer_.variableSize(data.size());
+        memcpy(target, variable_size.data(), variable_size.size());
+        target += variable_size.size();
+
+        *target++ = channel_id;
+
+        memcpy(target, data.data(), data.size());
+        target += data.size();
+
+        const size_t target_data_size = encryptedMessageSize(data.size());
+        separate_size +=
+            variable_size_writer_.variableSize(target_data_size).size() + target_data_size;
+    }
+
+    const size_t records_size = static_cast<size_t>(target - begin);
+    const size_t target_data_size = encryptedMessageSize(records_size);
+    const size_t packed_size =
+        variable_size_writer_.variableSize(target_data_size).size() + target_data_size;
+
+    packed_messages_ += static_cast<int64_t>(task_count);
+    packing_bytes_saved_ += static_cast<int64_t>(separate_size) - static_cast<int64_t>(packed_size);
+    return records_size;
+}
+
+void TcpChannel::onWrite(const std::error_code& error_code, size_t bytes_transferred)
+{
+    if (error_code)
+    {
+        onErrorOccurred(FROM_HERE, error_code);
+        return;
+    }
+
+    DCHECK_LE(write_batch_count_, write_queue_.size());
+
+    // Update TX statistics.
+    addTxBytes(bytes_transferred);
+
+    written_channels_.clear();
+
+    // Delete the sent messages from the queue.
+    for (size_t i = 0; i < write_batch_count_; ++i)
+    {
+        const WriteTask& task = write_queue_.front();
+
+        if (task.type() == WriteTask::Type::USER_DATA)
+            written_channels_.emplace_back(task.channelId());
+
+        write_queue_bytes_ -= task.data().size();
+        ByteArrayPool::recycle(write_queue_.front().releaseData());
+        write_queue_.pop_front();
+    }
+
+    write_batch_count_ = 0;
+
+    // Messages sent from other threads are added to the lanes so that they get their priority
+    // before the next write.
+    if (proxy_->reloadWriteQueue(&write_lanes_, &write_queue_bytes_))
+        checkWriteQueueLimits();
+
+    // If the queue is not empty, then we send the following messages.
+    const bool schedule_write = pendingMessages() != 0;
+
+    for (const auto& channel_id : written_channels_)
+        onMessageWritten(channel_id);
+
+    if (schedule_write)
+        doWrite();
+
+    // Reading is restarted last, because the received messages can be handled right away.
+    if (is_read_throttled_ && write_queue_bytes_ <= write_queue_soft_limit_ / 2)
+        onWriteQueueDrained();
+}
+
+void TcpChannel::checkWriteQueueLimits()
+{
+    if (write_queue_soft_limit_ && !is_read_throttled_ &&
+        write_queue_bytes_ > write_queue_soft_limit_)
+    {
+        LOG(LS_INFO) << "Write queue is full (" << write_queue_bytes_ << " bytes). "
+                     << "Reading is stopped";
+        is_read_throttled_ = true;
+    }
+
+    if (write_queue_hard_limit_ && !is_write_queue_overflow_ &&
+        write_queue_bytes_ > write_queue_hard_limit_)
+    {
+        LOG(LS_ERROR) << "Write queue overflow (" << write_queue_bytes_ << " bytes)";
+        is_write_queue_overflow_ = true;
+
+        // It can be called from send() and the listener can destroy the channel when it is
+        // disconnected, so the error is reported later.
+        MessageLoop::current()->startTimer(&overflow_timer_, TimerWheel::Milliseconds(0), [this]()
+        {
+            onErrorOccurred(FROM_HERE, ErrorCode::WRITE_QUEUE_OVERFLOW);
+        });
+    }
+}
+
+void TcpChannel::onBufferUsed(size_t size)
+{
+    if (size <= kMaxIdleBufferSize)
+        return;
+
+    is_large_buffer_used_ = true;
+
+    if (!trim_timer_.isScheduled())
+        startTrimTimer();
+}
+
+void TcpChannel::startTrimTimer()
+{
+    MessageLoop::current()->startTimer(&trim_timer_, kBufferTrimInterval, [this]()
+    {
+        onTrimTimer();
+    });
+}
+
+void TcpChannel::onTrimTimer()
+{
+    // The channel still transfers large messages.
+    if (is_large_buffer_used_)
+    {
+        is_large_buffer_used_ = false;
+        startTrimTimer();
+        return;
+    }
+
+    bool has_large_buffers = false;
+
+    auto trim = [&has_large_buffers](ByteArray* buffer, bool is_in_use)
+    {
+        if (buffer->capacity() <= kMaxIdleBufferSize)
+            return;
+
+        if (is_in_use)
+        {
+            has_large_buffers = true;
+            return;
+        }
+
+        ByteArrayPool::recycle(std::move(*buffer));
+        *buffer = ByteArray();
+    };
+
+    // The buffers are used until the pending read or write is completed.
+    trim(&read_buffer_, state_ != ReadState::IDLE && state_ != ReadState::READ_SIZE);
+    trim(&write_buffer_, write_batch_count_ != 0);
+
+    if (has_large_buffers)
+        startTrimTimer();
+}
+
+void TcpChannel::onWriteQueueDrained()
+{
+    LOG(LS_INFO) << "Write queue is drained (" << write_queue_bytes_ << " bytes). "
+                 << "Reading is restarted";
+    is_read_throttled_ = false;
+
+    if (connected_ && !paused_)
+        restartReading();
+}
+
+// static
+size_t TcpChannel::packedRecordSize(size_t message_size)
+{
+    size_t size_length = 1;
+    if (message_size > 0x7F)
+        ++size_length;
+    if (message_size > 0x3FFF)
+        ++size_length;
+    if (message_size > 0x1FFFF)
+        ++size_length;
+
+    return size_length + sizeof(uint8_t) + message_size;
+}
+
+std::optional<size_t> TcpChannel::readPrefixSize(size_t message_size) const
+{
+    const size_t channel_id_size = channel_id_support_ ? sizeof(uint8_t) : 0;
+    if (message_size < channel_id_size)
+        return std::nullopt;
+
+    const size_t data_size = decryptor_->decryptedDataSize(message_size - channel_id_size);
+    if (data_size > message_size - channel_id_size)
+        return std::nullopt;
+
+    return message_size - data_size;
+}
+
+size_t TcpChannel::encryptedMessageSize(size_t source_size) const
+{
+    size_t target_data_size = encryptor_->encryptedDataSize(source_size);
+    if (channel_id_support_)
+        target_data_size += sizeof(uint8_t);
+    return target_data_size;
+}
+
+void TcpChannel::doReadSize()
+{
+    state_ = ReadState::READ_SIZE;
+
+    if (!read_ahead_ || read_ahead_->empty())
+    {
+        if (read_ahead_ && read_ahead_->capacity() != read_ahead_size_)
+            read_ahead_.reset();
+
+        if (!read_ahead_ && read_ahead_size_)
+            read_ahead_ = std::make_unique<ReadAheadBuffer>(read_ahead_size_);
+    }
+
+    if (read_ahead_)
+    {
+        // doReadSize() is called again when a message from the buffer is handled synchronously.
+        if (is_reading_buffered_)
+        {
+            has_next_buffered_read_ = true;
+            return;
+        }
+
+        // The listener can destroy the channel while a message is handled.
+        std::shared_ptr<TcpChannel*> self = self_;
+
+        is_reading_buffered_ = true;
+
+        do
+        {
+            has_next_buffered_read_ = false;
+            readBufferedSize();
+
+            if (!*self)
+                return;
+        }
+        while (has_next_buffered_read_);
+
+        is_reading_buffered_ = false;
+        return;
+    }
 
-    state_ = ReadState::READ_USER_DATA;
     asio::async_read(socket_,
-                     asio::buffer(read_buffer_.data(), read_buffer_.size()),
-                     std::bind(&TcpChannel::onReadUserData,
+                     variable_size_reader_.buffer(),
+                     std::bind(&TcpChannel::onReadSize,
                                this,
                                std::placeholders::_1,
                                std::placeholders::_2));
 }
 
-void TcpChannel::onReadUserData(const std::error_code& error_code, size_t bytes_transferred)
+void TcpChannel::onReadSize(const std::error_code& error_code, size_t bytes_transferred)
 {
-    DCHECK_EQ(state_, ReadState::READ_USER_DATA);
-
     if (error_code)
     {
         onErrorOccurred(FROM_HERE, error_code);
@@ -553,32 +1365,203 @@ void TcpChannel::onReadUserData(const std::error_code& error_code, size_t bytes_
     // Update RX statistics.
     addRxBytes(bytes_transferred);
 
-    DCHECK_EQ(bytes_transferred, read_buffer_.size());
+    std::optional<size_t> size = variable_size_reader_.messageSize();
+    if (size.has_value())
+    {
+        size_t message_size = *size;
+
+        if (message_size > kMaxMessageSize)
+        {
+            LOG(LS_ERROR) << "Too big incoming message: " << message_size;
+            onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
+            return;
+        }
 
-    if (paused_)
+        // If the message size is 0 (in other words, the first received byte is 0), then you need
+        // to start reading the service message.
+        if (!message_size)
+        {
+            doReadServiceHeader();
+            return;
+        }
+
+        doReadUserData(message_size);
+    }
+    else
     {
-        state_ = ReadState::PENDING;
+        doReadSize();
+    }
+}
+
+void TcpChannel::readBufferedSize()
+{
+    DCHECK(read_ahead_);
+
+    size_t message_size;
+    size_t size_length;
+
+    if (!VariableSizeReader::parse(read_ahead_->data(), read_ahead_->size(),
+                                   &message_size, &size_length))
+    {
+        doReadAhead();
         return;
     }
 
-    onMessageReceived();
+    if (message_size > kMaxMessageSize)
+    {
+        LOG(LS_ERROR) << "Too big incoming message: " << message_size;
+        onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
+        return;
+    }
+
+    // The message is handled when it is completely in the buffer. Messages that do not fit into
+    // the buffer are read directly into their buffers.
+    const size_t required_size =
+        size_length + (message_size ? message_size : sizeof(ServiceHeader));
 
-    if (paused_)
+    if (required_size <= read_ahead_->capacity() && read_ahead_->size() < required_size)
     {
-        state_ = ReadState::IDLE;
+        doReadAhead();
+        return;
+    }
+
+    read_ahead_->consume(size_length);
+
+    if (!message_size)
+    {
+        doReadServiceHeader();
         return;
     }
 
+    doReadUserData(message_size);
+}
+
+void TcpChannel::doReadAhead()
+{
+    DCHECK(read_ahead_);
+
+    uint8_t* data = read_ahead_->prepare();
+    DCHECK_GT(read_ahead_->freeSize(), 0u);
+
+    socket_.async_read_some(asio::buffer(data, read_ahead_->freeSize()),
+                            std::bind(&TcpChannel::onReadAhead,
+                                      this,
+                                      std::placeholders::_1,
+                                      std::placeholders::_2));
+}
+
+void TcpChannel::onReadAhead(const std::error_code& error_code, size_t bytes_transferred)
+{
+    DCHECK_EQ(state_, ReadState::READ_SIZE);
+
+    if (error_code)
+    {
+        onErrorOccurred(FROM_HERE, error_code);
+        return;
+    }
+
+    // Update RX statistics.
+    addRxBytes(bytes_transferred);
+
+    read_ahead_->commit(bytes_transferred);
     doReadSize();
 }
 
+void TcpChannel::doReadUserData(size_t length)
+{
+    std::optional<size_t> prefix_size = readPrefixSize(length);
+    if (!prefix_size.has_value())
+    {
+        LOG(LS_ERROR) << "Too small incoming message: " << length;
+        onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
+        return;
+    }
+
+    // The message is decrypted in place, so the data is read separately from its prefix.
+    read_prefix_.resize(*prefix_size);
+    resizeBuffer(&read_buffer_, length - *prefix_size);
+    onBufferUsed(read_buffer_.size());
+
+    // The beginning of the message may already be in the read-ahead buffer.
+    size_t prefix_buffered = 0;
+    size_t data_buffered = 0;
+
+    if (read_ahead_)
+    {
+        prefix_buffered = read_ahead_->read(read_prefix_.data(), read_prefix_.size());
+        data_buffered = read_ahead_->read(read_buffer_.data(), read_buffer_.size());
+    }
+
+    state_ = ReadState::READ_USER_DATA;
+
+    if (prefix_buffered + data_buffered == length)
+    {
+        if (isReadingStopped())
+        {
+            state_ = ReadState::PENDING;
+            return;
+        }
+
+        onMessageReceived();
+        return;
+    }
+
+    const std::array<asio::mutable_buffer, 2> buffers =
+    {
+        asio::mutable_buffer(read_prefix_.data() + prefix_buffered,
+                             read_prefix_.size() - prefix_buffered),
+        asio::mutable_buffer(read_buffer_.data() + data_buffered,
+                             read_buffer_.size() - data_buffered)
+    };
+
+    asio::async_read(socket_,
+                     buffers,
+                     std::bind(&TcpChannel::onReadUserData,
+                               this,
+                               std::placeholders::_1,
+                               std::placeholders::_2));
+}
+
+void TcpChannel::onReadUserData(const std::error_code& error_code, size_t bytes_transferred)
+{
+    DCHECK_EQ(state_, ReadState::READ_USER_DATA);
+
+    if (error_code)
+    {
+        onErrorOccurred(FROM_HERE, error_code);
+        return;
+    }
+
+    // Update RX statistics.
+    addRxBytes(bytes_transferred);
+
+    DCHECK_LE(bytes_transferred, read_prefix_.size() + read_buffer_.size());
+
+    if (isReadingStopped())
+    {
+        state_ = ReadState::PENDING;
+        return;
+    }
+
+    onMessageReceived();
+}
+
 void TcpChannel::doReadServiceHeader()
 {
     resizeBuffer(&read_buffer_, sizeof(ServiceHeader));
 
     state_ = ReadState::READ_SERVICE_HEADER;
+
+    const size_t buffered = read_ahead_ ?
+        read_ahead_->read(read_buffer_.data(), read_buffer_.size()) : 0;
+    if (buffered == read_buffer_.size())
+    {
+        onServiceHeaderReceived();
+        return;
+    }
+
     asio::async_read(socket_,
-                     asio::buffer(read_buffer_.data(), read_buffer_.size()),
+                     asio::buffer(read_buffer_.data() + buffered, read_buffer_.size() - buffered),
                      std::bind(&TcpChannel::onReadServiceHeader,
                                this,
                                std::placeholders::_1,
@@ -596,11 +1579,16 @@ void TcpChannel::onReadServiceHeader(const std::error_code& error_code, size_t b
         return;
     }
 
-    DCHECK_EQ(bytes_transferred, read_buffer_.size());
+    DCHECK_LE(bytes_transferred, read_buffer_.size());
 
     // Update RX statistics.
     addRxBytes(bytes_transferred);
 
+    onServiceHeaderReceived();
+}
+
+void TcpChannel::onServiceHeaderReceived()
+{
     ServiceHeader* header = reinterpret_cast<ServiceHeader*>(read_buffer_.data());
     if (header->length > kMaxMessageSize)
     {
@@ -637,9 +1625,18 @@ void TcpChannel::doReadServiceData(size_t length)
 
     // Now we read the data after the header.
     state_ = ReadState::READ_SERVICE_DATA;
+
+    const size_t buffered = read_ahead_ ?
+        read_ahead_->read(read_buffer_.data() + sizeof(ServiceHeader), length) : 0;
+    if (buffered == length)
+    {
+        onServiceDataReceived();
+        return;
+    }
+
     asio::async_read(socket_,
-                     asio::buffer(read_buffer_.data() + sizeof(ServiceHeader),
-                                  read_buffer_.size() - sizeof(ServiceHeader)),
+                     asio::buffer(read_buffer_.data() + sizeof(ServiceHeader) + buffered,
+                                  length - buffered),
                      std::bind(&TcpChannel::onReadServiceData,
                                this,
                                std::placeholders::_1,
@@ -660,10 +1657,17 @@ void TcpChannel::onReadServiceData(const std::error_code& error_code, size_t byt
     // Update RX statistics.
     addRxBytes(bytes_transferred);
 
+    DCHECK_LE(bytes_transferred, read_buffer_.size() - sizeof(ServiceHeader));
+
+    onServiceDataReceived();
+}
+
+void TcpChannel::onServiceDataReceived()
+{
+    DCHECK_EQ(state_, ReadState::READ_SERVICE_DATA);
+
     // Incoming buffer contains a service header.
     ServiceHeader* header = reinterpret_cast<ServiceHeader*>(read_buffer_.data());
-
-    DCHECK_EQ(bytes_transferred, read_buffer_.size() - sizeof(ServiceHeader));
     DCHECK_LE(header->length, kMaxMessageSize);
 
     if (header->type == KEEP_ALIVE)
@@ -698,14 +1702,11 @@ void TcpChannel::onReadServiceData(const std::error_code& error_code, size_t byt
                 return;
             }
 
-            if (DCHECK_IS_ON())
-            {
-                Milliseconds ping_time = std::chrono::duration_cast<Milliseconds>(
-                    Clock::now() - keep_alive_timestamp_);
+            addRoundTripTime(std::chrono::duration_cast<std::chrono::microseconds>(
+                Clock::now() - keep_alive_timestamp_));
 
-                DLOG(LS_INFO) << "Ping result: " << ping_time.count() << " ms ("
-                              << keep_alive_counter_.size() << " bytes)";
-            }
+            DLOG(LS_INFO) << "Ping result: " << roundTripTime().count() << " us ("
+                          << keep_alive_counter_.size() << " bytes)";
 
             // The user can disable keep alive. Restart the timer only if keep alive is enabled.
             if (keep_alive_timer_)
@@ -716,9 +1717,8 @@ void TcpChannel::onReadServiceData(const std::error_code& error_code, size_t byt
                 largeNumberIncrement(&keep_alive_counter_);
 
                 // Restart keep alive timer.
-                keep_alive_timer_->expires_after(keep_alive_interval_);
-                keep_alive_timer_->async_wait(
-                    std::bind(&TcpChannel::onKeepAliveInterval, this, std::placeholders::_1));
+                is_keep_alive_ping_sent_ = false;
+                startKeepAliveInterval();
             }
         }
     }
@@ -731,48 +1731,44 @@ void TcpChannel::onReadServiceData(const std::error_code& error_code, size_t byt
     doReadSize();
 }
 
-void TcpChannel::onKeepAliveInterval(const std::error_code& error_code)
+void TcpChannel::startKeepAliveTimer(const Seconds& delay, void (TcpChannel::*handler)())
 {
-    if (error_code == asio::error::operation_aborted)
-        return;
-
     DCHECK(keep_alive_timer_);
 
-    if (error_code)
-    {
-        LOG(LS_ERROR) << "Keep alive timer error: " << utf16FromLocal8Bit(error_code.message());
-
-        // Restarting the timer.
-        keep_alive_timer_->expires_after(keep_alive_interval_);
-        keep_alive_timer_->async_wait(
-            std::bind(&TcpChannel::onKeepAliveInterval, this, std::placeholders::_1));
-    }
-    else
-    {
-        // Save sending time.
-        keep_alive_timestamp_ = Clock::now();
-
-        // Send ping.
-        sendKeepAlive(KEEP_ALIVE_PING, keep_alive_counter_.data(), keep_alive_counter_.size());
+    MessageLoop::current()->startTimer(keep_alive_timer_.get(), delay, std::bind(handler, this));
+}
 
-        // If a response is not received within the specified interval, the connection will be
-        // terminated.
-        keep_alive_timer_->expires_after(keep_alive_timeout_);
-        keep_alive_timer_->async_wait(
-            std::bind(&TcpChannel::onKeepAliveTimeout, this, std::placeholders::_1));
-    }
+void TcpChannel::startKeepAliveInterval()
+{
+    keep_alive_rx_bytes_ = totalRx();
+    startKeepAliveTimer(keep_alive_interval_, &TcpChannel::onKeepAliveInterval);
 }
 
-void TcpChannel::onKeepAliveTimeout(const std::error_code& error_code)
+void TcpChannel::onKeepAliveInterval()
 {
-    if (error_code == asio::error::operation_aborted)
-        return;
+    DCHECK(keep_alive_timer_);
 
-    if (error_code)
+    // The data received during the interval proves that the peer is alive.
+    if (keep_alive_only_when_idle_ && totalRx() != keep_alive_rx_bytes_)
     {
-        LOG(LS_ERROR) << "Keep alive timer error: " << utf16FromLocal8Bit(error_code.message());
+        startKeepAliveInterval();
+        return;
     }
 
+    // Save sending time.
+    keep_alive_timestamp_ = Clock::now();
+    is_keep_alive_ping_sent_ = true;
+
+    // Send ping.
+    sendKeepAlive(KEEP_ALIVE_PING, keep_alive_counter_.data(), keep_alive_counter_.size());
+
+    // If a response is not received within the specified interval, the connection will be
+    // terminated.
+    startKeepAliveTimer(keep_alive_timeout_, &TcpChannel::onKeepAliveTimeout);
+}
+
+void TcpChannel::onKeepAliveTimeout()
+{
     // No response came within the specified period of time. We forcibly terminate the connection.
     onErrorOccurred(FROM_HERE, ErrorCode::SOCKET_TIMEOUT);
 }
@@ -797,7 +1793,7 @@ void TcpChannel::sendKeepAlive(uint8_t flags, const void* data, size_t size)
     memcpy(buffer.data() + sizeof(uint8_t) + sizeof(header), data, size);
 
     // Add a task to the queue.
-    addWriteTask(WriteTask::Type::SERVICE_DATA, 0, std::move(buffer));
+    addWriteTask(WriteTask::Type::SERVICE_DATA, 0, std::move(buffer), Priority::HIGH);
 }
 
 } // namespace base
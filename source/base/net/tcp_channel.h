@@ -20,7 +20,9 @@
 #define BASE_NET_TCP_CHANNEL_H
 
 #include "base/memory/byte_array.h"
+#include "base/message_loop/timer_wheel.h"
 #include "base/net/network_channel.h"
+#include "base/net/read_ahead_buffer.h"
 #include "base/net/variable_size.h"
 #include "base/net/write_task.h"
 #include "base/peer/host_id.h"
@@ -28,7 +30,13 @@
 #include <asio/ip/tcp.hpp>
 #include <asio/high_resolution_timer.hpp>
 
-#include <queue>
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <vector>
 
 namespace base {
 
@@ -37,6 +45,7 @@ class Location;
 class MessageEncryptor;
 class MessageDecryptor;
 class TcpServer;
+class TaskRunner;
 
 class TcpChannel : public NetworkChannel
 {
@@ -56,6 +65,8 @@ public:
         virtual void onTcpMessageWritten(uint8_t channel_id, size_t pending) = 0;
     };
 
+    using Priority = WriteTask::Priority;
+
     std::shared_ptr<TcpChannelProxy> channelProxy();
 
     // Sets an instance of the class to receive connection status notifications or new messages.
@@ -68,9 +79,18 @@ public:
     void setEncryptor(std::unique_ptr<MessageEncryptor> encryptor);
     void setDecryptor(std::unique_ptr<MessageDecryptor> decryptor);
 
+    // Sets the task runner on which the messages of at least |threshold| bytes are encrypted and
+    // decrypted, so that they do not block other channels of the thread. The messages of the
+    // channel are still processed one by one in their order. The task runner must belong to
+    // another thread. By default, all messages are processed on the thread of the channel.
+    void setCryptoTaskRunner(std::shared_ptr<TaskRunner> crypto_task_runner, size_t threshold);
+
     // Gets the address of the remote host as a string.
     std::u16string peerAddress() const;
 
+    // Gets the local address of the connection as a string.
+    std::u16string localAddress() const;
+
     // Connects to a host at the specified address and port.
     void connect(std::u16string_view address, uint16_t port);
 
@@ -90,31 +110,88 @@ public:
     void resume();
 
     // Sending a message. The method call is thread safe. After the call, the message will be added
-    // to the queue to be sent.
-    void send(uint8_t channel_id, ByteArray&& buffer);
+    // to the queue to be sent. Messages of high priority are written before all other queued
+    // messages. Messages of normal and low priority share the bandwidth in the ratio 3:1. The order
+    // of messages with the same priority is preserved.
+    void send(uint8_t channel_id, ByteArray&& buffer, Priority priority = Priority::NORMAL);
+
+    // Serializes |message| into a buffer of the pool and sends it. The buffer is queued and
+    // encrypted in place when it is written, so the message is not copied again.
+    void send(uint8_t channel_id, const google::protobuf::MessageLite& message,
+              Priority priority = Priority::NORMAL);
+
+    // Shuts down the sending side of the connection. The remote host reads the end of the stream
+    // after the written messages, the incoming messages are still received until it closes the
+    // connection.
+    void shutdownSend();
 
     // Disable or enable the algorithm of Nagle.
     bool setNoDelay(bool enable);
 
-    // Enables or disables sending keep alive packets.
+    // Enables or disables sending keep alive packets. If |only_when_idle| is true, then a ping is
+    // sent only if nothing was received from the peer during the interval. If keep alive is
+    // already active, then its parameters are changed and a ping that is already sent is still
+    // waited for.
     bool setKeepAlive(bool enable,
                       const Seconds& interval = Seconds(45),
-                      const Seconds& timeout = Seconds(15));
+                      const Seconds& timeout = Seconds(15),
+                      bool only_when_idle = false);
+
+    // Enables or disables the keep alive of the OS. If there is no traffic during |time|, then
+    // the OS sends probes every |interval| and closes the connection if they are not answered.
+    // The probes do not wake up the application.
+    bool setTcpKeepAlive(bool enable, const Seconds& time, const Seconds& interval);
 
     void setChannelIdSupport(bool enable);
     bool hasChannelIdSupport() const;
 
+    // Enables or disables packing of small user messages into one encrypted frame. Messages that
+    // are queued at the same time are packed together. If |max_delay| is not zero, then a small
+    // message written to an empty queue waits up to |max_delay| for other messages. Packing works
+    // only with channel id support and the peer must be able to unpack the frames. Packed frames
+    // are always unpacked on receipt.
+    void setMessageBatching(bool enable, const Milliseconds& max_delay = Milliseconds(0));
+    bool hasMessageBatching() const;
+
+    // Number of messages sent in packed frames and the number of bytes saved compared to sending
+    // them separately.
+    int64_t packedMessages() const { return packed_messages_; }
+    int64_t packingBytesSaved() const { return packing_bytes_saved_; }
+
     bool setReadBufferSize(size_t size);
     bool setWriteBufferSize(size_t size);
 
-    size_t pendingMessages() const { return write_queue_.size(); }
+    // Reads the socket with large reads into a buffer of |size| bytes, so that the size and the
+    // data of small messages and several messages in a row are received with one read. Larger
+    // messages are read directly into their buffers. Zero disables the read-ahead. The default is
+    // 16 kB.
+    void setReadAheadSize(size_t size);
+
+    size_t pendingMessages() const;
+
+    // Returns the total size of messages in the outgoing queue (including the message being sent).
+    size_t pendingBytes() const { return write_queue_bytes_; }
+
+    // Limits the size of the outgoing queue in bytes. Zero disables a limit.
+    // If the queue exceeds |soft_limit|, the incoming messages are not read until the queue is
+    // drained to half of the limit, so a peer that does not read the replies cannot make more
+    // requests. The senders should check isWriteQueueFull() before producing optional data.
+    // If the queue exceeds |hard_limit|, the new messages are dropped and the channel is
+    // disconnected with ErrorCode::WRITE_QUEUE_OVERFLOW.
+    void setWriteQueueLimits(size_t soft_limit, size_t hard_limit);
+    bool isWriteQueueFull() const { return is_read_throttled_; }
+
+    // NetworkChannel implementation. On Linux the statistics include TCP_INFO of the socket.
+    Statistics statistics() const override;
 
     base::HostId hostId() const { return host_id_; }
     void setHostId(base::HostId host_id) { host_id_ = host_id; }
 
 protected:
     friend class TcpServer;
+    friend class TcpConnector;
     friend class RelayPeer;
+    friend class DirectPeer;
 
     // Constructor available for server. An already connected socket is being moved.
     explicit TcpChannel(asio::ip::tcp::socket&& socket);
@@ -126,6 +203,9 @@ protected:
 private:
     friend class TcpChannelProxy;
 
+    using WriteQueue = std::deque<WriteTask>;
+    using WriteLanes = std::array<WriteQueue, 3>;
+
     enum class ReadState
     {
         IDLE,                // No reads are in progress right now.
@@ -133,7 +213,31 @@ private:
         READ_SERVICE_HEADER, // Reading the contents of the service header.
         READ_SERVICE_DATA,   // Reading the contents of the service data.
         READ_USER_DATA,      // Reading the contents of the user data.
-        PENDING              // There is a message about which we did not notify.
+        DECRYPTING,          // Decrypting the user data on the crypto task runner.
+        PENDING,             // There is a message about which we did not notify.
+        PENDING_DECRYPTED,   // There is a decrypted message about which we did not notify.
+        PENDING_PACKED       // There are packed messages about which we did not notify.
+    };
+
+    // Part of an outgoing frame that is encrypted in place.
+    struct SealItem
+    {
+        uint8_t* prefix;
+        uint8_t* data;
+        size_t size;
+    };
+
+    // One frame of the outgoing batch. A frame contains one message or several packed messages.
+    struct OutgoingFrame
+    {
+        size_t plainSize() const { return task_count > 1 ? records_size : source_size; }
+
+        size_t first_task = 0;
+        size_t task_count = 0;
+        size_t source_size = 0;
+        size_t records_size = 0;
+        bool is_user_data = false;
+        bool can_be_packed = false;
     };
 
     enum ServiceMessageType
@@ -160,26 +264,61 @@ private:
     void onErrorOccurred(const Location& location, ErrorCode error_code);
     void onMessageWritten(uint8_t channel_id);
     void onMessageReceived();
+    void onMessageDecrypted(bool succeeded);
+    void onPackedMessagesReceived();
+    void continueReading();
 
-    void addWriteTask(WriteTask::Type type, uint8_t channel_id, ByteArray&& data);
+    void addWriteTask(WriteTask::Type type, uint8_t channel_id, ByteArray&& data,
+                      Priority priority);
 
     void doWrite();
+    void fillWriteQueue();
+    WriteQueue* nextWriteLane();
+    bool sealFrames();
+    void onFramesSealed(bool succeeded);
     void onWrite(const std::error_code& error_code, size_t bytes_transferred);
+    size_t encryptedMessageSize(size_t source_size) const;
+
+    // Returns the size of the channel id and the prefix of the encrypted message of
+    // |message_size| bytes or std::nullopt if the message is too small.
+    std::optional<size_t> readPrefixSize(size_t message_size) const;
+    size_t packMessages(WriteQueue::const_iterator first_task, size_t task_count, uint8_t* target);
+    static size_t packedRecordSize(size_t message_size);
+    void onBatchingTimeout(const std::error_code& error_code);
+
+    // Calls |work| on the crypto task runner and then |reply| with its result on the thread of the
+    // channel if the channel still exists and is connected.
+    void postCryptoTask(std::function<bool()> work, std::function<void(bool)> reply);
 
     void doReadSize();
     void onReadSize(const std::error_code& error_code, size_t bytes_transferred);
 
+    void readBufferedSize();
+    void doReadAhead();
+    void onReadAhead(const std::error_code& error_code, size_t bytes_transferred);
+
     void doReadUserData(size_t length);
     void onReadUserData(const std::error_code& error_code, size_t bytes_transferred);
 
     void doReadServiceHeader();
     void onReadServiceHeader(const std::error_code& error_code, size_t bytes_transferred);
+    void onServiceHeaderReceived();
 
     void doReadServiceData(size_t length);
     void onReadServiceData(const std::error_code& error_code, size_t bytes_transferred);
-
-    void onKeepAliveInterval(const std::error_code& error_code);
-    void onKeepAliveTimeout(const std::error_code& error_code);
+    void onServiceDataReceived();
+
+    void startKeepAliveTimer(const Seconds& delay, void (TcpChannel::*handler)());
+    void startKeepAliveInterval();
+    void onKeepAliveInterval();
+    void onKeepAliveTimeout();
+    void restartReading();
+    bool isReadingStopped() const { return paused_ || is_read_throttled_; }
+    void checkWriteQueueLimits();
+    void onWriteQueueDrained();
+    void onBufferUsed(size_t size);
+    void startTrimTimer();
+    void onTrimTimer();
     void sendKeepAlive(uint8_t flags, const void* data, size_t size);
 
     std::shared_ptr<TcpChannelProxy> proxy_;
@@ -187,11 +326,15 @@ private:
     asio::ip::tcp::socket socket_;
     std::unique_ptr<asio::ip::tcp::resolver> resolver_;
 
-    std::unique_ptr<asio::high_resolution_timer> keep_alive_timer_;
+    // The keep-alive timers of all channels of the thread share its timer wheel.
+    std::unique_ptr<TimerWheel::Timer> keep_alive_timer_;
     Seconds keep_alive_interval_;
     Seconds keep_alive_timeout_;
     ByteArray keep_alive_counter_;
     TimePoint keep_alive_timestamp_;
+    bool keep_alive_only_when_idle_ = false;
+    bool is_keep_alive_ping_sent_ = false;
+    int64_t keep_alive_rx_bytes_ = 0;
 
     Listener* listener_ = nullptr;
     bool connected_ = false;
@@ -200,14 +343,71 @@ private:
     std::unique_ptr<MessageEncryptor> encryptor_;
     std::unique_ptr<MessageDecryptor> decryptor_;
 
-    std::queue<WriteTask> write_queue_;
+    std::shared_ptr<TaskRunner> task_runner_;
+    std::shared_ptr<TaskRunner> crypto_task_runner_;
+    size_t crypto_threshold_ = 0;
+
+    // Cleared in the destructor, so that the replies of the crypto task runner do not reach the
+    // destroyed channel.
+    std::shared_ptr<TcpChannel*> self_;
+
+    // The work on the crypto task runner uses the buffers and the cryptographers of the channel,
+    // so the destructor waits for it.
+    std::mutex crypto_lock_;
+    std::condition_variable crypto_done_;
+    size_t crypto_pending_ = 0;
+
+    // Queued messages wait in the lane of their priority. The messages chosen for the next write
+    // are moved to |write_queue_|. |write_queue_bytes_| includes the messages of all lanes.
+    WriteLanes write_lanes_;
+    std::array<size_t, 3> lane_written_bytes_ = {};
+    WriteQueue write_queue_;
+    size_t write_queue_bytes_ = 0;
     VariableSizeWriter variable_size_writer_;
+
+    size_t write_queue_soft_limit_ = 0;
+    size_t write_queue_hard_limit_ = 0;
+    bool is_read_throttled_ = false;
+    bool is_write_queue_overflow_ = false;
+    TimerWheel::Timer overflow_timer_;
+
+    // Several messages from the front of the queue are written with one operation. Separate user
+    // messages are encrypted in place in the queue and only their headers are placed in
+    // |write_buffer_|. Packed frames are built and encrypted in |write_buffer_|. Service messages
+    // are written directly from the queue.
     ByteArray write_buffer_;
+    std::vector<asio::const_buffer> write_buffers_;
+    size_t write_batch_count_ = 0;
+    std::vector<uint8_t> written_channels_;
+
+    bool batching_ = false;
+    Milliseconds batching_delay_;
+    std::unique_ptr<asio::high_resolution_timer> batching_timer_;
+    bool is_batching_delayed_ = false;
+    std::vector<OutgoingFrame> write_frames_;
+    std::vector<SealItem> seal_items_;
+    int64_t packed_messages_ = 0;
+    int64_t packing_bytes_saved_ = 0;
 
     ReadState state_ = ReadState::IDLE;
     VariableSizeReader variable_size_reader_;
+
+    // The messages that are already in |read_ahead_| are handled in a loop in doReadSize() instead
+    // of a recursion.
+    size_t read_ahead_size_;
+    std::unique_ptr<ReadAheadBuffer> read_ahead_;
+    bool is_reading_buffered_ = false;
+    bool has_next_buffered_read_ = false;
+    // The channel id and the prefix of the encrypted message are read into |read_prefix_|. The rest
+    // of the message is read into |read_buffer_| and decrypted in place.
+    ByteArray read_prefix_;
     ByteArray read_buffer_;
-    ByteArray decrypt_buffer_;
+    size_t packed_read_pos_ = 0;
+    ByteArray packed_message_;
+
+    // Large buffers are released after an interval in which the channel has not used them.
+    TimerWheel::Timer trim_timer_;
+    bool is_large_buffer_used_ = false;
 
     base::HostId host_id_ = base::kInvalidHostId;
     bool channel_id_support_ = false;
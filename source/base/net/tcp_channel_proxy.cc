@@ -31,7 +31,7 @@ TcpChannelProxy::TcpChannelProxy(
     // Nothing
 }
 
-void TcpChannelProxy::send(uint8_t channel_id, ByteArray&& buffer)
+void TcpChannelProxy::send(uint8_t channel_id, ByteArray&& buffer, TcpChannel::Priority priority)
 {
     bool schedule_write;
 
@@ -39,7 +39,9 @@ void TcpChannelProxy::send(uint8_t channel_id, ByteArray&& buffer)
         std::scoped_lock lock(incoming_queue_lock_);
 
         schedule_write = incoming_queue_.empty();
-        incoming_queue_.emplace(WriteTask::Type::USER_DATA, channel_id, std::move(buffer));
+        incoming_queue_bytes_ += buffer.size();
+        incoming_queue_.emplace_back(
+            WriteTask::Type::USER_DATA, channel_id, std::move(buffer), priority);
     }
 
     if (!schedule_write)
@@ -48,6 +50,12 @@ void TcpChannelProxy::send(uint8_t channel_id, ByteArray&& buffer)
     task_runner_->postTask(std::bind(&TcpChannelProxy::scheduleWrite, shared_from_this()));
 }
 
+void TcpChannelProxy::send(uint8_t channel_id, const google::protobuf::MessageLite& message,
+                           TcpChannel::Priority priority)
+{
+    send(channel_id, serialize(message), priority);
+}
+
 void TcpChannelProxy::willDestroyCurrentChannel()
 {
     channel_ = nullptr;
@@ -58,24 +66,37 @@ void TcpChannelProxy::scheduleWrite()
     if (!channel_)
         return;
 
-    if (!reloadWriteQueue(&channel_->write_queue_))
+    if (!reloadWriteQueue(&channel_->write_lanes_, &channel_->write_queue_bytes_))
+        return;
+
+    channel_->checkWriteQueueLimits();
+    if (channel_->is_write_queue_overflow_)
+        return;
+
+    // If a write is in progress or the messages are delayed, then the new messages are written
+    // later.
+    if (!channel_->write_queue_.empty() || channel_->is_batching_delayed_)
         return;
 
     channel_->doWrite();
 }
 
-bool TcpChannelProxy::reloadWriteQueue(std::queue<WriteTask>* work_queue)
+bool TcpChannelProxy::reloadWriteQueue(TcpChannel::WriteLanes* work_lanes,
+                                       size_t* work_queue_bytes)
 {
-    if (!work_queue->empty())
-        return false;
-
     std::scoped_lock lock(incoming_queue_lock_);
 
     if (incoming_queue_.empty())
         return false;
 
-    incoming_queue_.swap(*work_queue);
-    DCHECK(incoming_queue_.empty());
+    // Each message is moved to the lane of its priority.
+    for (WriteTask& task : incoming_queue_)
+        (*work_lanes)[static_cast<size_t>(task.priority())].emplace_back(std::move(task));
+
+    incoming_queue_.clear();
+
+    *work_queue_bytes += incoming_queue_bytes_;
+    incoming_queue_bytes_ = 0;
 
     return true;
 }
@@ -30,7 +30,13 @@ class TaskRunner;
 class TcpChannelProxy : public std::enable_shared_from_this<TcpChannelProxy>
 {
 public:
-    void send(uint8_t channel_id, ByteArray&& buffer);
+    void send(uint8_t channel_id, ByteArray&& buffer,
+              TcpChannel::Priority priority = TcpChannel::Priority::NORMAL);
+
+    // Same as TcpChannel::send for a protobuf message. The message is serialized on the calling
+    // thread.
+    void send(uint8_t channel_id, const google::protobuf::MessageLite& message,
+              TcpChannel::Priority priority = TcpChannel::Priority::NORMAL);
 
 private:
     friend class TcpChannel;
@@ -40,13 +46,14 @@ private:
     void willDestroyCurrentChannel();
 
     void scheduleWrite();
-    bool reloadWriteQueue(std::queue<WriteTask>* work_queue);
+    bool reloadWriteQueue(TcpChannel::WriteLanes* work_lanes, size_t* work_queue_bytes);
 
     std::shared_ptr<TaskRunner> task_runner_;
 
     TcpChannel* channel_;
 
-    std::queue<WriteTask> incoming_queue_;
+    TcpChannel::WriteQueue incoming_queue_;
+    size_t incoming_queue_bytes_ = 0;
     std::mutex incoming_queue_lock_;
 
     DISALLOW_COPY_AND_ASSIGN(TcpChannelProxy);
@@ -0,0 +1,257 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/net/tcp_connector.h"
+
+#include "base/logging.h"
+#include "base/message_loop/message_loop.h"
+#include "base/message_loop/message_pump_asio.h"
+#include "base/net/tcp_channel.h"
+#include "base/strings/unicode.h"
+
+#include <algorithm>
+
+namespace base {
+
+namespace {
+
+const std::chrono::milliseconds kDefaultAttemptDelay { 250 };
+const std::chrono::milliseconds kDefaultAttemptTimeout { 5000 };
+
+// Alternates the address families, starting with the family of the first address.
+std::vector<asio::ip::tcp::endpoint> sortEndpoints(
+    const asio::ip::tcp::resolver::results_type& results)
+{
+    std::vector<asio::ip::tcp::endpoint> first;
+    std::vector<asio::ip::tcp::endpoint> second;
+
+    for (const auto& result : results)
+    {
+        const asio::ip::tcp::endpoint& endpoint = result.endpoint();
+
+        if (first.empty() || first.front().protocol() == endpoint.protocol())
+            first.emplace_back(endpoint);
+        else
+            second.emplace_back(endpoint);
+    }
+
+    std::vector<asio::ip::tcp::endpoint> endpoints;
+    endpoints.reserve(first.size() + second.size());
+
+    for (size_t i = 0; i < std::max(first.size(), second.size()); ++i)
+    {
+        if (i < first.size())
+            endpoints.emplace_back(first[i]);
+
+        if (i < second.size())
+            endpoints.emplace_back(second[i]);
+    }
+
+    return endpoints;
+}
+
+} // namespace
+
+TcpConnector::Attempt::Attempt(asio::io_context& io_context)
+    : socket(io_context),
+      timer(io_context)
+{
+    // Nothing
+}
+
+TcpConnector::TcpConnector()
+    : io_context_(MessageLoop::current()->pumpAsio()->ioContext()),
+      resolver_(io_context_),
+      delay_timer_(io_context_),
+      attempt_delay_(kDefaultAttemptDelay),
+      attempt_timeout_(kDefaultAttemptTimeout)
+{
+    // Nothing
+}
+
+TcpConnector::~TcpConnector()
+{
+    callback_ = nullptr;
+    cancel();
+}
+
+void TcpConnector::setAttemptDelay(const std::chrono::milliseconds& delay)
+{
+    attempt_delay_ = delay;
+}
+
+void TcpConnector::setAttemptTimeout(const std::chrono::milliseconds& timeout)
+{
+    attempt_timeout_ = timeout;
+}
+
+void TcpConnector::connect(std::u16string_view address, uint16_t port, Callback callback)
+{
+    callback_ = std::move(callback);
+    DCHECK(callback_);
+
+    resolver_.async_resolve(local8BitFromUtf16(address), std::to_string(port),
+        [this](const std::error_code& error_code,
+               const asio::ip::tcp::resolver::results_type& endpoints)
+    {
+        if (error_code == asio::error::operation_aborted)
+            return;
+
+        if (error_code)
+        {
+            LOG(LS_INFO) << "Unable to resolve address: "
+                         << utf16FromLocal8Bit(error_code.message());
+            onFinished(nullptr);
+            return;
+        }
+
+        onResolved(endpoints);
+    });
+}
+
+void TcpConnector::onResolved(const asio::ip::tcp::resolver::results_type& endpoints)
+{
+    endpoints_ = sortEndpoints(endpoints);
+    if (endpoints_.empty())
+    {
+        onFinished(nullptr);
+        return;
+    }
+
+    startNextAttempt();
+}
+
+void TcpConnector::startNextAttempt()
+{
+    if (attempts_.size() >= endpoints_.size())
+        return;
+
+    const asio::ip::tcp::endpoint& endpoint = endpoints_[attempts_.size()];
+
+    attempts_.emplace_back(std::make_unique<Attempt>(io_context_));
+    Attempt* attempt = attempts_.back().get();
+    ++active_attempts_;
+
+    attempt->socket.async_connect(endpoint, [this, attempt](const std::error_code& error_code)
+    {
+        // The attempt was cancelled by timeout, by another connection or by the destructor.
+        if (error_code == asio::error::operation_aborted)
+            return;
+
+        if (error_code)
+        {
+            onAttemptFailed(attempt);
+            return;
+        }
+
+        onConnected(attempt);
+    });
+
+    attempt->timer.expires_after(attempt_timeout_);
+    attempt->timer.async_wait([this, attempt](const std::error_code& error_code)
+    {
+        if (error_code)
+            return;
+
+        onAttemptFailed(attempt);
+    });
+
+    if (attempts_.size() < endpoints_.size())
+    {
+        delay_timer_.expires_after(attempt_delay_);
+        delay_timer_.async_wait([this](const std::error_code& error_code)
+        {
+            if (error_code)
+                return;
+
+            startNextAttempt();
+        });
+    }
+}
+
+void TcpConnector::onAttemptFailed(Attempt* attempt)
+{
+    if (attempt->is_finished)
+        return;
+
+    attempt->is_finished = true;
+    --active_attempts_;
+
+    std::error_code ignored_code;
+    attempt->timer.cancel();
+    attempt->socket.close(ignored_code);
+
+    if (attempts_.size() < endpoints_.size())
+    {
+        // Do not wait for the delay if the previous attempt has already failed.
+        delay_timer_.cancel();
+        startNextAttempt();
+        return;
+    }
+
+    if (!active_attempts_)
+        onFinished(nullptr);
+}
+
+void TcpConnector::onConnected(Attempt* attempt)
+{
+    attempt->is_finished = true;
+    --active_attempts_;
+
+    attempt->timer.cancel();
+
+    std::unique_ptr<TcpChannel> channel =
+        std::unique_ptr<TcpChannel>(new TcpChannel(std::move(attempt->socket)));
+
+    cancel();
+    onFinished(std::move(channel));
+}
+
+void TcpConnector::cancel()
+{
+    std::error_code ignored_code;
+
+    resolver_.cancel();
+    delay_timer_.cancel();
+
+    for (auto& attempt : attempts_)
+    {
+        attempt->timer.cancel();
+
+        if (!attempt->is_finished)
+        {
+            attempt->socket.cancel(ignored_code);
+            attempt->socket.close(ignored_code);
+            attempt->is_finished = true;
+        }
+    }
+
+    active_attempts_ = 0;
+    endpoints_.clear();
+}
+
+void TcpConnector::onFinished(std::unique_ptr<TcpChannel> channel)
+{
+    Callback callback;
+    callback.swap(callback_);
+
+    if (callback)
+        callback(std::move(channel));
+}
+
+} // namespace base
@@ -0,0 +1,94 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_NET_TCP_CONNECTOR_H
+#define BASE_NET_TCP_CONNECTOR_H
+
+#include "base/macros_magic.h"
+
+#include <asio/high_resolution_timer.hpp>
+#include <asio/ip/tcp.hpp>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace base {
+
+class TcpChannel;
+
+// Connects to a host that can have several addresses. A new attempt is started after a short
+// delay without waiting for the previous ones to fail, the address families are interleaved and
+// the first established connection wins (Happy Eyeballs, RFC 8305). Useful when many hosts are
+// probed and an unreachable address must not hold up the others.
+class TcpConnector
+{
+public:
+    TcpConnector();
+    ~TcpConnector();
+
+    // Called with the connected channel or nullptr if all attempts failed. The connector can be
+    // destroyed in the callback.
+    using Callback = std::function<void(std::unique_ptr<TcpChannel> channel)>;
+
+    // Delay before the attempt to the next address (250 ms by default).
+    void setAttemptDelay(const std::chrono::milliseconds& delay);
+
+    // Time after which an attempt is cancelled (5 seconds by default).
+    void setAttemptTimeout(const std::chrono::milliseconds& timeout);
+
+    void connect(std::u16string_view address, uint16_t port, Callback callback);
+
+private:
+    struct Attempt
+    {
+        explicit Attempt(asio::io_context& io_context);
+
+        asio::ip::tcp::socket socket;
+        asio::high_resolution_timer timer;
+        bool is_finished = false;
+    };
+
+    void onResolved(const asio::ip::tcp::resolver::results_type& endpoints);
+    void startNextAttempt();
+    void onAttemptFailed(Attempt* attempt);
+    void onConnected(Attempt* attempt);
+    void cancel();
+    void onFinished(std::unique_ptr<TcpChannel> channel);
+
+    asio::io_context& io_context_;
+    asio::ip::tcp::resolver resolver_;
+    asio::high_resolution_timer delay_timer_;
+
+    std::chrono::milliseconds attempt_delay_;
+    std::chrono::milliseconds attempt_timeout_;
+
+    Callback callback_;
+
+    std::vector<asio::ip::tcp::endpoint> endpoints_;
+    std::vector<std::unique_ptr<Attempt>> attempts_;
+    size_t active_attempts_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(TcpConnector);
+};
+
+} // namespace base
+
+#endif // BASE_NET_TCP_CONNECTOR_H
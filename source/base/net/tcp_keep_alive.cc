@@ -0,0 +1,91 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/net/tcp_keep_alive.h"
+
+#include "base/logging.h"
+
+#include <algorithm>
+
+#if defined(OS_WIN)
+#include <winsock2.h>
+#include <mstcpip.h>
+#elif defined(OS_POSIX)
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
+
+namespace base {
+
+bool setTcpKeepAlive(NativeSocket socket,
+                     bool enable,
+                     const std::chrono::milliseconds& time,
+                     const std::chrono::milliseconds& interval)
+{
+#if defined(OS_WIN)
+    tcp_keepalive alive;
+    alive.onoff = enable ? TRUE : FALSE;
+    alive.keepalivetime = static_cast<ULONG>(time.count());
+    alive.keepaliveinterval = static_cast<ULONG>(interval.count());
+
+    DWORD bytes_returned;
+    if (WSAIoctl(socket, SIO_KEEPALIVE_VALS, &alive, sizeof(alive),
+                 nullptr, 0, &bytes_returned, nullptr, nullptr) == SOCKET_ERROR)
+    {
+        PLOG(LS_ERROR) << "WSAIoctl failed";
+        return false;
+    }
+#elif defined(OS_POSIX)
+    int value = enable ? 1 : 0;
+    if (setsockopt(socket, SOL_SOCKET, SO_KEEPALIVE, &value, sizeof(value)) != 0)
+    {
+        PLOG(LS_ERROR) << "setsockopt(SO_KEEPALIVE) failed";
+        return false;
+    }
+
+    if (!enable)
+        return true;
+
+    // The OS counts the time in seconds.
+    value = std::max(static_cast<int>(
+        std::chrono::duration_cast<std::chrono::seconds>(time).count()), 1);
+
+#if defined(OS_MAC)
+    if (setsockopt(socket, IPPROTO_TCP, TCP_KEEPALIVE, &value, sizeof(value)) != 0)
+#else
+    if (setsockopt(socket, IPPROTO_TCP, TCP_KEEPIDLE, &value, sizeof(value)) != 0)
+#endif
+    {
+        PLOG(LS_ERROR) << "setsockopt(TCP_KEEPIDLE) failed";
+        return false;
+    }
+
+    value = std::max(static_cast<int>(
+        std::chrono::duration_cast<std::chrono::seconds>(interval).count()), 1);
+
+    if (setsockopt(socket, IPPROTO_TCP, TCP_KEEPINTVL, &value, sizeof(value)) != 0)
+    {
+        PLOG(LS_ERROR) << "setsockopt(TCP_KEEPINTVL) failed";
+        return false;
+    }
+#endif
+
+    return true;
+}
+
+} // namespace base
@@ -19,21 +19,161 @@
 #include "base/net/tcp_server.h"
 
 #include "base/logging.h"
+#include "base/task_runner.h"
 #include "base/message_loop/message_loop.h"
 #include "base/message_loop/message_pump_asio.h"
 #include "base/net/tcp_channel.h"
 #include "base/strings/unicode.h"
+#include "base/threading/thread.h"
+#include "build/build_config.h"
 
 #include <asio/ip/address.hpp>
 
+#if defined(OS_LINUX)
+#include <sys/socket.h>
+#endif // defined(OS_LINUX)
+
 namespace base {
 
+namespace {
+
+const int kMaxErrorCount = 500;
+
+} // namespace
+
+// Listening socket with one or more accept operations in progress. Lives on the thread of its
+// I/O context. The accepted sockets belong to |target_io_context|.
+class TcpServer::Acceptor : public std::enable_shared_from_this<Acceptor>
+{
+public:
+    using Callback = std::function<void(asio::ip::tcp::socket socket)>;
+
+    Acceptor(asio::io_context& io_context, asio::io_context& target_io_context, Callback callback);
+
+    bool open(const asio::ip::tcp::endpoint& endpoint, int backlog, bool reuse_port);
+    void start(size_t accept_count);
+    void stop();
+
+private:
+    void doAccept();
+    void onAccept(const std::error_code& error_code, asio::ip::tcp::socket socket);
+
+    asio::ip::tcp::acceptor acceptor_;
+    asio::io_context& target_io_context_;
+    Callback callback_;
+
+    int accept_error_count_ = 0;
+    bool is_stopped_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(Acceptor);
+};
+
+TcpServer::Acceptor::Acceptor(asio::io_context& io_context,
+                              asio::io_context& target_io_context,
+                              Callback callback)
+    : acceptor_(io_context),
+      target_io_context_(target_io_context),
+      callback_(std::move(callback))
+{
+    DCHECK(callback_);
+}
+
+bool TcpServer::Acceptor::open(const asio::ip::tcp::endpoint& endpoint, int backlog,
+                               bool reuse_port)
+{
+    std::error_code error_code;
+
+    acceptor_.open(endpoint.protocol(), error_code);
+    if (!error_code)
+        acceptor_.set_option(asio::ip::tcp::acceptor::reuse_address(true), error_code);
+
+#if defined(OS_LINUX)
+    if (!error_code && reuse_port)
+    {
+        using ReusePort = asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+        acceptor_.set_option(ReusePort(true), error_code);
+    }
+#else
+    DCHECK(!reuse_port);
+#endif // defined(OS_LINUX)
+
+    if (!error_code)
+        acceptor_.bind(endpoint, error_code);
+    if (!error_code)
+        acceptor_.listen(backlog, error_code);
+
+    if (error_code)
+    {
+        LOG(LS_ERROR) << "Unable to listen on port " << endpoint.port() << ": "
+                      << base::utf16FromLocal8Bit(error_code.message());
+        return false;
+    }
+
+    return true;
+}
+
+void TcpServer::Acceptor::start(size_t accept_count)
+{
+    for (size_t i = 0; i < accept_count; ++i)
+        doAccept();
+}
+
+void TcpServer::Acceptor::stop()
+{
+    is_stopped_ = true;
+
+    std::error_code ignored_code;
+    acceptor_.close(ignored_code);
+}
+
+void TcpServer::Acceptor::doAccept()
+{
+    acceptor_.async_accept(target_io_context_,
+        std::bind(&Acceptor::onAccept, shared_from_this(),
+                  std::placeholders::_1, std::placeholders::_2));
+}
+
+void TcpServer::Acceptor::onAccept(const std::error_code& error_code,
+                                   asio::ip::tcp::socket socket)
+{
+    if (is_stopped_)
+        return;
+
+    if (error_code)
+    {
+        LOG(LS_ERROR) << "Error while accepting connection: "
+                      << base::utf16FromLocal8Bit(error_code.message());
+
+        ++accept_error_count_;
+        if (accept_error_count_ > kMaxErrorCount)
+        {
+            LOG(LS_ERROR) << "WARNING! Too many errors when trying to accept a connection. "
+                          << "New connections will not be accepted";
+            return;
+        }
+    }
+    else
+    {
+        accept_error_count_ = 0;
+
+        // Connection accepted.
+        callback_(std::move(socket));
+    }
+
+    // Accept next connection.
+    doAccept();
+}
+
 class TcpServer::Impl : public base::enable_shared_from_this<Impl>
 {
 public:
     explicit Impl(asio::io_context& io_context);
     ~Impl();
 
+    void setBacklog(int backlog) { backlog_ = backlog; }
+    void setAcceptCount(size_t accept_count) { accept_count_ = std::max(accept_count, size_t(1)); }
+    void setIoThreadCount(size_t thread_count) { io_thread_count_ = thread_count; }
+
     void start(std::u16string_view listen_interface, uint16_t port, Delegate* delegate);
     void stop();
 
@@ -41,23 +181,36 @@ public:
     uint16_t port() const;
 
 private:
-    void doAccept();
-    void onAccept(const std::error_code& error_code, asio::ip::tcp::socket socket);
+    void onAccept(asio::ip::tcp::socket socket);
 
     asio::io_context& io_context_;
-    std::unique_ptr<asio::ip::tcp::acceptor> acceptor_;
+    std::shared_ptr<TaskRunner> task_runner_;
     Delegate* delegate_ = nullptr;
 
+    int backlog_ = asio::socket_base::max_listen_connections;
+    size_t accept_count_ = 1;
+    size_t io_thread_count_ = 0;
+
+    // Acceptor of the thread of the server. Used if there are no I/O threads.
+    std::shared_ptr<Acceptor> acceptor_;
+
+    std::vector<std::unique_ptr<Thread>> io_threads_;
+    std::vector<std::shared_ptr<Acceptor>> io_acceptors_;
+
+    // Cleared when the server is stopped, so that the sockets accepted on the I/O threads do not
+    // reach the delegate after that. It is dereferenced only on the thread of the server.
+    std::shared_ptr<Impl*> self_;
+
     std::u16string listen_interface_;
     uint16_t port_ = 0;
 
-    int accept_error_count_ = 0;
-
     DISALLOW_COPY_AND_ASSIGN(Impl);
 };
 
 TcpServer::Impl::Impl(asio::io_context& io_context)
-    : io_context_(io_context)
+    : io_context_(io_context),
+      task_runner_(MessageLoop::current()->taskRunner()),
+      self_(std::make_shared<Impl*>(this))
 {
     LOG(LS_INFO) << "Ctor";
 }
@@ -66,6 +219,7 @@ TcpServer::Impl::~Impl()
 {
     LOG(LS_INFO) << "Dtor";
     DCHECK(!acceptor_);
+    DCHECK(io_threads_.empty());
 }
 
 void TcpServer::Impl::start(std::u16string_view listen_interface, uint16_t port, Delegate* delegate)
@@ -87,15 +241,99 @@ void TcpServer::Impl::start(std::u16string_view listen_interface, uint16_t port,
     }
 
     asio::ip::tcp::endpoint endpoint(listen_address, port);
-    acceptor_ = std::make_unique<asio::ip::tcp::acceptor>(io_context_, endpoint);
 
-    doAccept();
+    LOG(LS_INFO) << "Backlog: " << backlog_ << ", accept operations: " << accept_count_
+                 << ", I/O threads: " << io_thread_count_;
+
+    if (!io_thread_count_)
+    {
+        acceptor_ = std::make_shared<Acceptor>(io_context_, io_context_,
+            std::bind(&Impl::onAccept, this, std::placeholders::_1));
+
+        if (!acceptor_->open(endpoint, backlog_, false))
+        {
+            acceptor_.reset();
+            return;
+        }
+
+        acceptor_->start(accept_count_);
+        return;
+    }
+
+#if defined(OS_LINUX)
+    // Each thread listens on its own socket and the system balances the connections.
+    const size_t acceptor_count = io_thread_count_;
+    const bool reuse_port = acceptor_count > 1;
+#else
+    // The accept operations of the other threads would use the same socket concurrently.
+    const size_t acceptor_count = 1;
+    const bool reuse_port = false;
+
+    if (io_thread_count_ > 1)
+        LOG(LS_INFO) << "Only one I/O thread is used for accepting on this platform";
+#endif // defined(OS_LINUX)
+
+    for (size_t i = 0; i < acceptor_count; ++i)
+    {
+        std::unique_ptr<Thread> thread = std::make_unique<Thread>();
+        thread->start(MessageLoop::Type::ASIO);
+
+        // The acceptor is opened here, so that the errors are reported right away. The accept
+        // operations are started on its thread.
+        std::shared_ptr<Acceptor> acceptor = std::make_shared<Acceptor>(
+            thread->messageLoop()->pumpAsio()->ioContext(), io_context_,
+            [task_runner = task_runner_, self = self_](asio::ip::tcp::socket socket)
+        {
+            std::shared_ptr<asio::ip::tcp::socket> accepted =
+                std::make_shared<asio::ip::tcp::socket>(std::move(socket));
+
+            task_runner->postTask([self, accepted]()
+            {
+                if (*self)
+                    (*self)->onAccept(std::move(*accepted));
+            });
+        });
+
+        if (!acceptor->open(endpoint, backlog_, reuse_port))
+        {
+            thread->stop();
+            stop();
+            return;
+        }
+
+        thread->taskRunner()->postTask([acceptor, accept_count = accept_count_]()
+        {
+            acceptor->start(accept_count);
+        });
+
+        io_acceptors_.emplace_back(std::move(acceptor));
+        io_threads_.emplace_back(std::move(thread));
+    }
 }
 
 void TcpServer::Impl::stop()
 {
     delegate_ = nullptr;
-    acceptor_.reset();
+    *self_ = nullptr;
+
+    if (acceptor_)
+    {
+        acceptor_->stop();
+        acceptor_.reset();
+    }
+
+    for (size_t i = 0; i < io_threads_.size(); ++i)
+    {
+        // The acceptor is closed on its thread before the thread is stopped.
+        io_threads_[i]->taskRunner()->postTask([acceptor = io_acceptors_[i]]()
+        {
+            acceptor->stop();
+        });
+        io_threads_[i]->stop();
+    }
+
+    io_threads_.clear();
+    io_acceptors_.clear();
 }
 
 std::u16string TcpServer::Impl::listenInterface() const
@@ -108,45 +346,16 @@ uint16_t TcpServer::Impl::port() const
     return port_;
 }
 
-void TcpServer::Impl::doAccept()
-{
-    acceptor_->async_accept(
-        std::bind(&Impl::onAccept, shared_from_this(), std::placeholders::_1, std::placeholders::_2));
-}
-
-void TcpServer::Impl::onAccept(const std::error_code& error_code, asio::ip::tcp::socket socket)
+void TcpServer::Impl::onAccept(asio::ip::tcp::socket socket)
 {
     if (!delegate_)
         return;
 
-    if (error_code)
-    {
-        LOG(LS_ERROR) << "Error while accepting connection: "
-                      << base::utf16FromLocal8Bit(error_code.message());
-
-        static const int kMaxErrorCount = 500;
+    std::unique_ptr<TcpChannel> channel =
+        std::unique_ptr<TcpChannel>(new TcpChannel(std::move(socket)));
 
-        ++accept_error_count_;
-        if (accept_error_count_ > kMaxErrorCount)
-        {
-            LOG(LS_ERROR) << "WARNING! Too many errors when trying to accept a connection. "
-                          << "New connections will not be accepted";
-            return;
-        }
-    }
-    else
-    {
-        accept_error_count_ = 0;
-
-        std::unique_ptr<TcpChannel> channel =
-            std::unique_ptr<TcpChannel>(new TcpChannel(std::move(socket)));
-
-        // Connection accepted.
-        delegate_->onNewConnection(std::move(channel));
-    }
-
-    // Accept next connection.
-    doAccept();
+    // Connection accepted.
+    delegate_->onNewConnection(std::move(channel));
 }
 
 TcpServer::TcpServer()
@@ -161,6 +370,21 @@ TcpServer::~TcpServer()
     impl_->stop();
 }
 
+void TcpServer::setBacklog(int backlog)
+{
+    impl_->setBacklog(backlog);
+}
+
+void TcpServer::setAcceptCount(size_t accept_count)
+{
+    impl_->setAcceptCount(accept_count);
+}
+
+void TcpServer::setIoThreadCount(size_t thread_count)
+{
+    impl_->setIoThreadCount(thread_count);
+}
+
 void TcpServer::start(std::u16string_view listen_interface, uint16_t port, Delegate* delegate)
 {
     impl_->start(listen_interface, port, delegate);
@@ -44,6 +44,22 @@ public:
         virtual void onNewConnection(std::unique_ptr<TcpChannel> channel) = 0;
     };
 
+    // Sets the maximum length of the queue of connections that are not accepted yet. By default,
+    // the system maximum is used. Must be called before start().
+    void setBacklog(int backlog);
+
+    // Sets the number of accept operations in progress at a time. The default is 1. Must be called
+    // before start().
+    void setAcceptCount(size_t accept_count);
+
+    // Accepts the connections on |thread_count| I/O threads, so that bursts of connections are
+    // taken from the system queue while the thread of the server is busy. On Linux, each thread
+    // has its own listening socket and the system distributes the connections between them.
+    // The channels are created and passed to the delegate on the thread of the server. Zero (by
+    // default) means that the connections are accepted on the thread of the server. Must be called
+    // before start().
+    void setIoThreadCount(size_t thread_count);
+
     void start(std::u16string_view listen_interface, uint16_t port, Delegate* delegate);
     void stop();
 
@@ -53,6 +69,7 @@ public:
     static bool isValidListenInterface(std::u16string_view interface);
 
 private:
+    class Acceptor;
     class Impl;
     base::local_shared_ptr<Impl> impl_;
 
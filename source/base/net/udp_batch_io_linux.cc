@@ -0,0 +1,265 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/net/udp_batch_io_linux.h"
+
+#include "base/logging.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <netinet/in.h>
+#include <netinet/udp.h>
+
+namespace base {
+
+namespace {
+
+// Limits of the kernel for one GSO buffer.
+const size_t kMaxSegments = 64;
+const size_t kMaxGsoSize = 65000;
+
+const size_t kReceiveBatchSize = 32;
+const size_t kReceiveBufferSize = 2048;
+
+// With GRO one buffer can contain many datagrams.
+const size_t kGroReceiveBatchSize = 4;
+const size_t kGroReceiveBufferSize = 65536;
+
+// The socket is not read forever if the peer sends faster than the datagrams are processed.
+const int kMaxReceiveRounds = 4;
+
+const size_t kSendControlSize = CMSG_SPACE(sizeof(uint16_t));
+const size_t kReceiveControlSize = CMSG_SPACE(sizeof(int));
+
+bool isWouldBlock(int error)
+{
+    return error == EAGAIN || error == EWOULDBLOCK;
+}
+
+} // namespace
+
+UdpBatchIo::UdpBatchIo(int socket)
+    : socket_(socket)
+{
+#if defined(UDP_SEGMENT)
+    int segment_size = 0;
+    socklen_t length = sizeof(segment_size);
+
+    // The option is known to the kernel if it can be read.
+    gso_enabled_ = getsockopt(socket_, IPPROTO_UDP, UDP_SEGMENT, &segment_size, &length) == 0;
+#endif // defined(UDP_SEGMENT)
+
+#if defined(UDP_GRO)
+    int enable = 1;
+    gro_enabled_ = setsockopt(socket_, IPPROTO_UDP, UDP_GRO, &enable, sizeof(enable)) == 0;
+#endif // defined(UDP_GRO)
+
+    LOG(LS_INFO) << "UDP GSO: " << gso_enabled_ << " GRO: " << gro_enabled_;
+
+    send_controls_.resize(kMaxBatchSize * kSendControlSize);
+
+    const size_t batch_size = gro_enabled_ ? kGroReceiveBatchSize : kReceiveBatchSize;
+    const size_t buffer_size = gro_enabled_ ? kGroReceiveBufferSize : kReceiveBufferSize;
+
+    receive_buffers_.resize(batch_size);
+    receive_headers_.resize(batch_size);
+    receive_vectors_.resize(batch_size);
+    receive_controls_.resize(batch_size * kReceiveControlSize);
+
+    for (size_t i = 0; i < batch_size; ++i)
+    {
+        receive_buffers_[i].resize(buffer_size);
+        receive_vectors_[i].iov_base = receive_buffers_[i].data();
+        receive_vectors_[i].iov_len = buffer_size;
+    }
+}
+
+UdpBatchIo::~UdpBatchIo() = default;
+
+size_t UdpBatchIo::send(
+    const std::deque<ByteArray>& datagrams, size_t count, std::error_code* error_code)
+{
+    DCHECK(error_code);
+
+    count = std::min({ count, datagrams.size(), kMaxBatchSize });
+    if (!count)
+        return 0;
+
+    size_t message_count = 0;
+    size_t vector_count = 0;
+    size_t index = 0;
+
+    while (index < count)
+    {
+        struct mmsghdr& header = send_headers_[message_count];
+        memset(&header, 0, sizeof(header));
+
+        const size_t segment_size = datagrams[index].size();
+        size_t segments = 0;
+        size_t total_size = 0;
+
+        header.msg_hdr.msg_iov = &send_vectors_[vector_count];
+
+        // With GSO the kernel splits the buffer into datagrams of |segment_size| bytes, only the
+        // last one may be shorter.
+        do
+        {
+            const ByteArray& datagram = datagrams[index];
+
+            send_vectors_[vector_count].iov_base = const_cast<uint8_t*>(datagram.data());
+            send_vectors_[vector_count].iov_len = datagram.size();
+
+            total_size += datagram.size();
+            ++vector_count;
+            ++segments;
+            ++index;
+        }
+        while (gso_enabled_ && index < count && segments < kMaxSegments &&
+               datagrams[index - 1].size() == segment_size &&
+               datagrams[index].size() <= segment_size &&
+               total_size + datagrams[index].size() <= kMaxGsoSize);
+
+        header.msg_hdr.msg_iovlen = segments;
+
+#if defined(UDP_SEGMENT)
+        if (segments > 1)
+        {
+            uint8_t* control = send_controls_.data() + message_count * kSendControlSize;
+            memset(control, 0, kSendControlSize);
+
+            header.msg_hdr.msg_control = control;
+            header.msg_hdr.msg_controllen = kSendControlSize;
+
+            struct cmsghdr* cmsg = CMSG_FIRSTHDR(&header.msg_hdr);
+            cmsg->cmsg_level = IPPROTO_UDP;
+            cmsg->cmsg_type = UDP_SEGMENT;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+
+            const uint16_t gso_size = static_cast<uint16_t>(segment_size);
+            memcpy(CMSG_DATA(cmsg), &gso_size, sizeof(gso_size));
+        }
+#endif // defined(UDP_SEGMENT)
+
+        ++message_count;
+    }
+
+    int ret = sendmmsg(socket_, send_headers_, static_cast<unsigned int>(message_count),
+                       MSG_DONTWAIT);
+    if (ret < 0)
+    {
+        const int error = errno;
+
+        if (isWouldBlock(error))
+        {
+            *error_code = std::make_error_code(std::errc::operation_would_block);
+            return 0;
+        }
+
+        if (error == EIO && gso_enabled_)
+        {
+            // The network device does not support checksum offload required for GSO.
+            LOG(LS_WARNING) << "UDP GSO is not supported by the device";
+            gso_enabled_ = false;
+            return send(datagrams, count, error_code);
+        }
+
+        *error_code = std::error_code(error, std::system_category());
+        return 0;
+    }
+
+    size_t sent = 0;
+    for (int i = 0; i < ret; ++i)
+        sent += send_headers_[i].msg_hdr.msg_iovlen;
+
+    return sent;
+}
+
+void UdpBatchIo::receive(const ReceiveCallback& callback, std::error_code* error_code)
+{
+    DCHECK(error_code);
+
+    const size_t batch_size = receive_headers_.size();
+
+    for (int round = 0; round < kMaxReceiveRounds; ++round)
+    {
+        for (size_t i = 0; i < batch_size; ++i)
+        {
+            struct mmsghdr& header = receive_headers_[i];
+            memset(&header, 0, sizeof(header));
+
+            header.msg_hdr.msg_iov = &receive_vectors_[i];
+            header.msg_hdr.msg_iovlen = 1;
+
+            if (gro_enabled_)
+            {
+                header.msg_hdr.msg_control = receive_controls_.data() + i * kReceiveControlSize;
+                header.msg_hdr.msg_controllen = kReceiveControlSize;
+            }
+        }
+
+        int ret = recvmmsg(socket_, receive_headers_.data(), static_cast<unsigned int>(batch_size),
+                           MSG_DONTWAIT, nullptr);
+        if (ret < 0)
+        {
+            const int error = errno;
+
+            if (!isWouldBlock(error) && error != EINTR)
+                *error_code = std::error_code(error, std::system_category());
+            return;
+        }
+
+        for (int i = 0; i < ret; ++i)
+        {
+            const struct mmsghdr& header = receive_headers_[i];
+            if (header.msg_hdr.msg_flags & MSG_TRUNC)
+            {
+                LOG(LS_WARNING) << "Too big datagram";
+                continue;
+            }
+
+            const uint8_t* data = receive_buffers_[i].data();
+            const size_t size = header.msg_len;
+            size_t segment_size = size;
+
+#if defined(UDP_GRO)
+            for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&header.msg_hdr); cmsg;
+                 cmsg = CMSG_NXTHDR(const_cast<struct msghdr*>(&header.msg_hdr), cmsg))
+            {
+                if (cmsg->cmsg_level == IPPROTO_UDP && cmsg->cmsg_type == UDP_GRO)
+                {
+                    int gso_size;
+                    memcpy(&gso_size, CMSG_DATA(cmsg), sizeof(gso_size));
+                    if (gso_size > 0)
+                        segment_size = static_cast<size_t>(gso_size);
+                }
+            }
+#endif // defined(UDP_GRO)
+
+            // Coalesced datagrams have the same size, only the last one may be shorter.
+            for (size_t offset = 0; offset < size; offset += segment_size)
+                callback(data + offset, std::min(segment_size, size - offset));
+        }
+
+        if (static_cast<size_t>(ret) < batch_size)
+            return;
+    }
+}
+
+} // namespace base
@@ -0,0 +1,74 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_NET_UDP_BATCH_IO_LINUX_H
+#define BASE_NET_UDP_BATCH_IO_LINUX_H
+
+#include "base/macros_magic.h"
+#include "base/memory/byte_array.h"
+
+#include <deque>
+#include <functional>
+#include <system_error>
+
+#include <sys/socket.h>
+
+namespace base {
+
+// Sends and receives datagrams of a non-blocking UDP socket in batches with sendmmsg and
+// recvmmsg. If the kernel supports UDP GSO and GRO, then consecutive datagrams of the same size
+// are passed through the network stack as one buffer.
+class UdpBatchIo
+{
+public:
+    using ReceiveCallback = std::function<void(const uint8_t* data, size_t size)>;
+
+    static constexpr size_t kMaxBatchSize = 64;
+
+    explicit UdpBatchIo(int socket);
+    ~UdpBatchIo();
+
+    // Sends up to |count| datagrams from the front of |datagrams|. Returns the number of sent
+    // datagrams. If the socket would block, |error_code| is set to
+    // std::errc::operation_would_block.
+    size_t send(const std::deque<ByteArray>& datagrams, size_t count, std::error_code* error_code);
+
+    // Receives all datagrams available without blocking (but no more than a few batches) and
+    // calls |callback| for each of them.
+    void receive(const ReceiveCallback& callback, std::error_code* error_code);
+
+private:
+    const int socket_;
+    bool gso_enabled_ = false;
+    bool gro_enabled_ = false;
+
+    struct mmsghdr send_headers_[kMaxBatchSize];
+    struct iovec send_vectors_[kMaxBatchSize];
+    std::vector<uint8_t> send_controls_;
+
+    std::vector<ByteArray> receive_buffers_;
+    std::vector<struct mmsghdr> receive_headers_;
+    std::vector<struct iovec> receive_vectors_;
+    std::vector<uint8_t> receive_controls_;
+
+    DISALLOW_COPY_AND_ASSIGN(UdpBatchIo);
+};
+
+} // namespace base
+
+#endif // BASE_NET_UDP_BATCH_IO_LINUX_H
@@ -63,6 +63,37 @@ std::optional<size_t> VariableSizeReader::messageSize()
     }
 }
 
+// static
+bool VariableSizeReader::parse(const uint8_t* data, size_t size, size_t* message_size,
+                               size_t* length)
+{
+    DCHECK(data || !size);
+    DCHECK(message_size && length);
+
+    size_t result = 0;
+
+    for (size_t pos = 0; pos < size && pos < 4; ++pos)
+    {
+        if (pos == 3)
+        {
+            // The last byte uses all 8 bits.
+            result += static_cast<size_t>(data[pos]) << 21;
+        }
+        else
+        {
+            result += static_cast<size_t>(data[pos] & 0x7F) << (7 * pos);
+            if (data[pos] & 0x80)
+                continue;
+        }
+
+        *message_size = result;
+        *length = pos + 1;
+        return true;
+    }
+
+    return false;
+}
+
 VariableSizeWriter::VariableSizeWriter() = default;
 
 VariableSizeWriter::~VariableSizeWriter() = default;
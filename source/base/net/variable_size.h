@@ -37,6 +37,10 @@ public:
     asio::mutable_buffer buffer();
     std::optional<size_t> messageSize();
 
+    // Parses the size at the beginning of |data|. Returns false if |data| does not contain the
+    // whole size yet. |length| receives the number of bytes of the size.
+    static bool parse(const uint8_t* data, size_t size, size_t* message_size, size_t* length);
+
 private:
     uint8_t buffer_[4] = { 0 };
     size_t pos_ = 0;
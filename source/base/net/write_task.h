@@ -21,6 +21,8 @@
 
 #include "base/memory/byte_array.h"
 
+#include <chrono>
+
 namespace base {
 
 class WriteTask
@@ -28,22 +30,42 @@ class WriteTask
 public:
     enum class Type { SERVICE_DATA, USER_DATA };
 
-    WriteTask(Type type, uint8_t channel_id, ByteArray&& data)
+    // Messages of higher priority are written before the queued messages of lower priority.
+    enum class Priority { HIGH, NORMAL, LOW };
+
+    using Clock = std::chrono::high_resolution_clock;
+
+    WriteTask(Type type, uint8_t channel_id, ByteArray&& data,
+              Priority priority = Priority::NORMAL)
         : type_(type),
           channel_id_(channel_id),
-          data_(std::move(data))
+          priority_(priority),
+          data_(std::move(data)),
+          queue_time_(Clock::now())
     {
         // Nothing
     }
 
     Type type() const { return type_; }
     uint8_t channelId() const { return channel_id_; }
+    Priority priority() const { return priority_; }
     const ByteArray& data() const { return data_; }
 
+    // Time when the message was queued for sending.
+    Clock::time_point queueTime() const { return queue_time_; }
+
+    // Allows the channel to encrypt the data in place before it is written.
+    ByteArray& mutableData() { return data_; }
+
+    // Takes the data out of the task after it has been written.
+    ByteArray releaseData() { return std::move(data_); }
+
 private:
-    const Type type_;
-    const uint8_t channel_id_;
-    const ByteArray data_;
+    Type type_;
+    uint8_t channel_id_;
+    Priority priority_;
+    ByteArray data_;
+    Clock::time_point queue_time_;
 };
 
 } // namespace base
@@ -0,0 +1,90 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/peer/auth_rate_limiter.h"
+
+#include "base/logging.h"
+
+#include <algorithm>
+
+namespace base {
+
+AuthRateLimiter::AuthRateLimiter(uint32_t rate_per_minute, uint32_t burst, size_t max_keys)
+    : tokens_per_second_(static_cast<double>(rate_per_minute) / 60.0),
+      burst_(static_cast<double>(std::max(burst, 1U))),
+      max_keys_(max_keys)
+{
+    DCHECK_GT(max_keys_, 0u);
+}
+
+AuthRateLimiter::~AuthRateLimiter() = default;
+
+bool AuthRateLimiter::tryAcquire(std::string_view key)
+{
+    const Clock::time_point now = Clock::now();
+
+    auto it = buckets_.find(std::string(key));
+    if (it == buckets_.end())
+    {
+        // The sweep is limited, so that a flood from many addresses does not make it on each
+        // attempt.
+        if (buckets_.size() >= max_keys_ && now - last_sweep_time_ >= std::chrono::seconds(1))
+        {
+            removeFull(now);
+            last_sweep_time_ = now;
+        }
+
+        // Too many sources at once to track them. The attempt is not limited rather than
+        // rejecting everyone.
+        if (buckets_.size() >= max_keys_)
+            return true;
+
+        buckets_.emplace(std::string(key), Bucket{ burst_ - 1.0, now });
+        return true;
+    }
+
+    Bucket& bucket = it->second;
+    bucket.tokens = refill(bucket, now);
+    bucket.time = now;
+
+    if (bucket.tokens < 1.0)
+        return false;
+
+    bucket.tokens -= 1.0;
+    return true;
+}
+
+double AuthRateLimiter::refill(const Bucket& bucket, Clock::time_point now) const
+{
+    const double elapsed = std::chrono::duration<double>(now - bucket.time).count();
+    return std::min(burst_, bucket.tokens + elapsed * tokens_per_second_);
+}
+
+void AuthRateLimiter::removeFull(Clock::time_point now)
+{
+    // A full bucket is the same as no bucket.
+    for (auto it = buckets_.begin(); it != buckets_.end();)
+    {
+        if (refill(it->second, now) >= burst_)
+            it = buckets_.erase(it);
+        else
+            ++it;
+    }
+}
+
+} // namespace base
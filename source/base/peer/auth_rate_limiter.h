@@ -0,0 +1,73 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_PEER_AUTH_RATE_LIMITER_H
+#define BASE_PEER_AUTH_RATE_LIMITER_H
+
+#include "base/macros_magic.h"
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace base {
+
+// Limits the rate of authentication attempts for each key (the address of a peer or a user name)
+// with a token bucket. It is checked before the key exchange and SRP calculations, so that one
+// source can not take the processor time of the server.
+// Not thread-safe, the limiter is used on the task runner of the authenticators.
+class AuthRateLimiter
+{
+public:
+    static const size_t kDefaultMaxKeys = 100000;
+
+    // Each key can make |burst| attempts at once and then |rate_per_minute| attempts per minute.
+    AuthRateLimiter(uint32_t rate_per_minute, uint32_t burst, size_t max_keys = kDefaultMaxKeys);
+    ~AuthRateLimiter();
+
+    // Takes one attempt of |key|. Returns false if the key has used up its attempts.
+    bool tryAcquire(std::string_view key);
+
+    size_t count() const { return buckets_.size(); }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Bucket
+    {
+        double tokens;
+        Clock::time_point time;
+    };
+
+    double refill(const Bucket& bucket, Clock::time_point now) const;
+    void removeFull(Clock::time_point now);
+
+    const double tokens_per_second_;
+    const double burst_;
+    const size_t max_keys_;
+
+    std::unordered_map<std::string, Bucket> buckets_;
+    Clock::time_point last_sweep_time_;
+
+    DISALLOW_COPY_AND_ASSIGN(AuthRateLimiter);
+};
+
+} // namespace base
+
+#endif // BASE_PEER_AUTH_RATE_LIMITER_H
@@ -34,6 +34,7 @@ namespace base {
 namespace {
 
 const size_t kIvSize = 12; // 12 bytes.
+const size_t kNonceSize = 32;
 
 bool verifyNg(std::string_view N, std::string_view g)
 {
@@ -106,6 +107,11 @@ void ClientAuthenticator::setSessionType(uint32_t session_type)
     session_type_ = session_type;
 }
 
+void ClientAuthenticator::setSessionTicket(const SessionTicket& ticket)
+{
+    ticket_ = ticket;
+}
+
 bool ClientAuthenticator::onStarted()
 {
     internal_state_ = InternalState::SEND_CLIENT_HELLO;
@@ -121,7 +127,7 @@ void ClientAuthenticator::onReceived(const ByteArray& buffer)
         {
             if (readServerHello(buffer))
             {
-                if (identify_ == proto::IDENTIFY_ANONYMOUS)
+                if (is_resumed_ || identify_ == proto::IDENTIFY_ANONYMOUS)
                 {
                     internal_state_ = InternalState::READ_SESSION_CHALLENGE;
                 }
@@ -148,6 +154,13 @@ void ClientAuthenticator::onReceived(const ByteArray& buffer)
         {
             if (readSessionChallenge(buffer))
             {
+                // The server knows the session type and the client information from the ticket.
+                if (is_resumed_)
+                {
+                    finish(FROM_HERE, ErrorCode::SUCCESS);
+                    return;
+                }
+
                 internal_state_ = InternalState::SEND_SESSION_RESPONSE;
                 sendSessionResponse();
             }
@@ -266,6 +279,29 @@ void ClientAuthenticator::sendClientHello()
         client_hello->set_iv(toStdString(encrypt_iv_));
     }
 
+    if (ticket_.isValid() && ticket_.session_type == session_type_)
+    {
+        resume_nonce_ = Random::byteArray(kNonceSize);
+        resume_iv_ = Random::byteArray(kIvSize);
+
+        if (!resume_nonce_.empty() && !resume_iv_.empty())
+        {
+            GenericHash hash(GenericHash::BLAKE2s256);
+            hash.addData(ticket_.session_key);
+            hash.addData(ticket_.id);
+            hash.addData(resume_nonce_);
+            hash.addData(resume_iv_);
+
+            proto::SessionResume* resume = client_hello->mutable_resume();
+            resume->set_ticket(toStdString(ticket_.id));
+            resume->set_nonce(toStdString(resume_nonce_));
+            resume->set_iv(toStdString(resume_iv_));
+            resume->set_proof(toStdString(hash.result()));
+
+            LOG(LS_INFO) << "Trying to resume the session";
+        }
+    }
+
     LOG(LS_INFO) << "Sending: ClientHello";
     sendMessage(*client_hello);
 }
@@ -297,6 +333,27 @@ bool ClientAuthenticator::readServerHello(const ByteArray& buffer)
 
     decrypt_iv_ = fromStdString(server_hello->iv());
 
+    if (!server_hello->resume_nonce().empty())
+    {
+        if (resume_nonce_.empty() || encryption_ != ticket_.encryption ||
+            decrypt_iv_.size() != kIvSize)
+        {
+            finish(FROM_HERE, ErrorCode::PROTOCOL_ERROR);
+            return false;
+        }
+
+        LOG(LS_INFO) << "Session resumed";
+
+        GenericHash hash(GenericHash::BLAKE2s256);
+        hash.addData(ticket_.session_key);
+        hash.addData(resume_nonce_);
+        hash.addData(fromStdString(server_hello->resume_nonce()));
+
+        session_key_ = hash.result();
+        encrypt_iv_ = resume_iv_;
+        is_resumed_ = true;
+    }
+
     if (session_key_.empty() != decrypt_iv_.empty())
     {
         finish(FROM_HERE, ErrorCode::PROTOCOL_ERROR);
@@ -417,6 +474,16 @@ bool ClientAuthenticator::readSessionChallenge(const ByteArray& buffer)
     setPeerOsName(challenge->os_name());
     setPeerComputerName(challenge->computer_name());
 
+    // The ticket can be used only once, so the previous one is replaced in any case.
+    ticket_ = SessionTicket();
+    if (!challenge->ticket().empty())
+    {
+        ticket_.id = fromStdString(challenge->ticket());
+        ticket_.session_key = session_key_;
+        ticket_.encryption = encryption_;
+        ticket_.session_type = session_type_;
+    }
+
     LOG(LS_INFO) << "Server Version: " << peerVersion();
     LOG(LS_INFO) << "Server Name: " << challenge->computer_name();
     LOG(LS_INFO) << "Server OS: " << challenge->os_name();
@@ -30,12 +30,35 @@ public:
     explicit ClientAuthenticator(std::shared_ptr<TaskRunner> task_runner);
     ~ClientAuthenticator() override;
 
+    // Ticket for resuming a session with the same server without the full authentication.
+    struct SessionTicket
+    {
+        ByteArray id;
+        ByteArray session_key;
+        proto::Encryption encryption = proto::ENCRYPTION_UNKNOWN;
+        uint32_t session_type = 0;
+
+        bool isValid() const { return !id.empty() && !session_key.empty(); }
+    };
+
     void setPeerPublicKey(const ByteArray& public_key);
     void setIdentify(proto::Identify identify);
     void setUserName(std::u16string_view username);
     void setPassword(std::u16string_view password);
     void setSessionType(uint32_t session_type);
 
+    // Sets the ticket received in a previous session with the same server. If the server accepts
+    // it, the session is resumed in one round trip. Otherwise, the full authentication is done, so
+    // the other parameters must be set as usual.
+    void setSessionTicket(const SessionTicket& ticket);
+
+    // Returns the ticket for the next connection to the server. It is not valid if the server does
+    // not issue tickets.
+    [[nodiscard]] const SessionTicket& sessionTicket() const { return ticket_; }
+
+    // Returns true if the session was resumed with a ticket.
+    [[nodiscard]] bool isResumed() const { return is_resumed_; }
+
 protected:
     // Authenticator implementation.
     [[nodiscard]] bool onStarted() override;
@@ -75,6 +98,11 @@ private:
     BigNum a_;
     BigNum A_;
 
+    SessionTicket ticket_;
+    ByteArray resume_nonce_;
+    ByteArray resume_iv_;
+    bool is_resumed_ = false;
+
     DISALLOW_COPY_AND_ASSIGN(ClientAuthenticator);
 };
 
@@ -0,0 +1,489 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/peer/direct_peer.h"
+
+#include "base/logging.h"
+#include "base/message_loop/message_loop.h"
+#include "base/message_loop/message_pump_asio.h"
+#include "base/net/adapter_enumerator.h"
+#include "base/net/tcp_channel.h"
+#include "base/strings/unicode.h"
+
+#include <asio/read.hpp>
+#include <asio/write.hpp>
+
+#include <cstring>
+#include <optional>
+
+#if defined(OS_POSIX)
+#include <sys/socket.h>
+#endif // defined(OS_POSIX)
+
+namespace base {
+
+namespace {
+
+// If no direct connection is established during this time, then the peers use the relay.
+const std::chrono::seconds kConnectTimeout { 3 };
+
+// A connection attempt that is refused (for example, by a NAT that has not seen the packets of
+// this peer yet) is repeated after this interval.
+const std::chrono::milliseconds kRetryInterval { 250 };
+
+const size_t kMaxAttempts = 4;
+
+// The router keeps only a few candidates of a peer besides its public address.
+const int kMaxLocalCandidates = 3;
+
+// After the timeout, the client waits this long for the acknowledgement of a marker that is already
+// sent. The host may have taken the connection.
+const std::chrono::seconds kAckTimeout { 2 };
+
+// The client sends it on the selected connection. The host answers with the acknowledgement.
+const std::array<uint8_t, 8> kSelectMarker = { 'A', 'S', 'P', 'I', 'A', 'D', 'P', '1' };
+const std::array<uint8_t, 8> kSelectAck = { 'A', 'S', 'P', 'I', 'A', 'D', 'A', '1' };
+
+// Several sockets are bound to the same port. The port is never listened.
+void setReuseOptions(asio::ip::tcp::socket* socket)
+{
+    std::error_code ignored_code;
+    socket->set_option(asio::ip::tcp::socket::reuse_address(true), ignored_code);
+
+#if defined(OS_POSIX)
+    int enable = 1;
+    setsockopt(socket->native_handle(), SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable));
+#endif // defined(OS_POSIX)
+}
+
+// Addresses which the peers in the same LAN can connect to.
+bool isLocalCandidate(const std::string& address_string)
+{
+    std::error_code error_code;
+    asio::ip::address_v4 address = asio::ip::make_address_v4(address_string, error_code);
+    if (error_code || address.is_unspecified() || address.is_loopback() || address.is_multicast())
+        return false;
+
+    // Link-local addresses (169.254.0.0/16) are assigned when there is no DHCP server.
+    return (address.to_uint() & 0xFFFF0000) != 0xA9FE0000;
+}
+
+std::optional<asio::ip::tcp::endpoint> toEndpoint(const proto::DirectEndpoint& endpoint)
+{
+    if (!endpoint.port() || endpoint.port() > 65535)
+        return std::nullopt;
+
+    std::error_code error_code;
+    asio::ip::address address = asio::ip::make_address(endpoint.address(), error_code);
+    if (error_code)
+        return std::nullopt;
+
+    // The router can see the IPv4 address of the peer as an IPv4-mapped IPv6 address.
+    if (address.is_v6() && address.to_v6().is_v4_mapped())
+        address = asio::ip::make_address_v4(asio::ip::v4_mapped, address.to_v6());
+
+    // The port is bound for IPv4 only.
+    if (!address.is_v4() || address.is_unspecified())
+        return std::nullopt;
+
+    return asio::ip::tcp::endpoint(address, static_cast<uint16_t>(endpoint.port()));
+}
+
+} // namespace
+
+struct DirectPeer::Attempt
+{
+    explicit Attempt(asio::io_context& io_context)
+        : socket(io_context),
+          retry_timer(io_context)
+    {
+        // Nothing
+    }
+
+    asio::ip::tcp::endpoint endpoint;
+    asio::ip::tcp::socket socket;
+    asio::high_resolution_timer retry_timer;
+    std::array<uint8_t, 8> marker;
+};
+
+DirectPort::DirectPort()
+    : socket_(MessageLoop::current()->pumpAsio()->ioContext())
+{
+    // Nothing
+}
+
+DirectPort::~DirectPort()
+{
+    std::error_code ignored_code;
+    socket_.close(ignored_code);
+}
+
+bool DirectPort::open()
+{
+    std::error_code error_code;
+    socket_.open(asio::ip::tcp::v4(), error_code);
+    if (error_code)
+    {
+        LOG(LS_WARNING) << "Unable to open socket: " << utf16FromLocal8Bit(error_code.message());
+        return false;
+    }
+
+    setReuseOptions(&socket_);
+
+    socket_.bind(asio::ip::tcp::endpoint(asio::ip::tcp::v4(), 0), error_code);
+    if (error_code)
+    {
+        LOG(LS_WARNING) << "Unable to bind socket: " << utf16FromLocal8Bit(error_code.message());
+        return false;
+    }
+
+    port_ = socket_.local_endpoint(error_code).port();
+    if (error_code || !port_)
+    {
+        LOG(LS_WARNING) << "Unable to get local port";
+        return false;
+    }
+
+    LOG(LS_INFO) << "Direct port: " << port_;
+    return true;
+}
+
+proto::DirectCandidates DirectPort::candidates(const std::string& local_address) const
+{
+    proto::DirectCandidates candidates;
+    if (!port_)
+        return candidates;
+
+    auto add_candidate = [&](const std::string& address)
+    {
+        if (candidates.endpoint_size() >= kMaxLocalCandidates || !isLocalCandidate(address))
+            return;
+
+        for (const auto& endpoint : candidates.endpoint())
+        {
+            if (endpoint.address() == address)
+                return;
+        }
+
+        proto::DirectEndpoint* endpoint = candidates.add_endpoint();
+        endpoint->set_address(address);
+        endpoint->set_port(port_);
+    };
+
+    // The address of the route to the router goes first, it is most likely reachable.
+    add_candidate(local_address);
+
+    // Peers in the same LAN can connect to the addresses of the other adapters.
+    for (AdapterEnumerator adapter; !adapter.isAtEnd(); adapter.advance())
+    {
+        for (AdapterEnumerator::IpAddressEnumerator address(adapter); !address.isAtEnd();
+             address.advance())
+        {
+            add_candidate(address.address());
+        }
+    }
+
+    return candidates;
+}
+
+DirectPeer::DirectPeer()
+    : io_context_(MessageLoop::current()->pumpAsio()->ioContext()),
+      timeout_timer_(io_context_)
+{
+    LOG(LS_INFO) << "Ctor";
+}
+
+DirectPeer::~DirectPeer()
+{
+    LOG(LS_INFO) << "Dtor";
+    delegate_ = nullptr;
+    stop();
+}
+
+void DirectPeer::start(const proto::ConnectionOffer& offer, uint16_t local_port, Delegate* delegate)
+{
+    delegate_ = delegate;
+    connection_offer_ = offer;
+    local_port_ = local_port;
+    is_client_ = offer.peer_role() == proto::ConnectionOffer::CLIENT;
+    start_time_ = std::chrono::steady_clock::now();
+
+    DCHECK(delegate_);
+
+    LOG(LS_INFO) << "Direct connection offer (trace: " << offer.trace_id()
+                 << ", candidates: " << offer.direct().endpoint_size() << ")";
+
+    for (const auto& candidate : offer.direct().endpoint())
+    {
+        if (attempts_.size() >= kMaxAttempts)
+            break;
+
+        std::optional<asio::ip::tcp::endpoint> endpoint = toEndpoint(candidate);
+        if (!endpoint.has_value())
+        {
+            LOG(LS_INFO) << "Skipped candidate: " << candidate.address() << ":" << candidate.port();
+            continue;
+        }
+
+        attempts_.emplace_back(std::make_unique<Attempt>(io_context_));
+        attempts_.back()->endpoint = *endpoint;
+    }
+
+    timeout_timer_.expires_after(kConnectTimeout);
+    timeout_timer_.async_wait([this](const std::error_code& error_code)
+    {
+        if (error_code == asio::error::operation_aborted)
+            return;
+
+        onTimeout();
+    });
+
+    for (size_t i = 0; i < attempts_.size(); ++i)
+        doConnect(i);
+}
+
+void DirectPeer::doConnect(size_t index)
+{
+    Attempt* attempt = attempts_[index].get();
+    std::error_code error_code;
+
+    attempt->socket.close(error_code);
+    attempt->socket.open(asio::ip::tcp::v4(), error_code);
+    if (!error_code)
+    {
+        setReuseOptions(&attempt->socket);
+        attempt->socket.bind(asio::ip::tcp::endpoint(asio::ip::tcp::v4(), local_port_), error_code);
+    }
+
+    if (error_code)
+    {
+        LOG(LS_WARNING) << "Unable to bind port " << local_port_ << ": "
+                        << utf16FromLocal8Bit(error_code.message());
+        return;
+    }
+
+    attempt->socket.async_connect(attempt->endpoint, [this, index](const std::error_code& error_code)
+    {
+        if (error_code == asio::error::operation_aborted)
+            return;
+
+        if (!error_code)
+        {
+            onConnected(index);
+            return;
+        }
+
+        Attempt* attempt = attempts_[index].get();
+
+        attempt->retry_timer.expires_after(kRetryInterval);
+        attempt->retry_timer.async_wait([this, index](const std::error_code& error_code)
+        {
+            if (error_code == asio::error::operation_aborted)
+                return;
+
+            doConnect(index);
+        });
+    });
+}
+
+void DirectPeer::onConnected(size_t index)
+{
+    Attempt* attempt = attempts_[index].get();
+
+    LOG(LS_INFO) << "Connected to " << attempt->endpoint.address() << ":"
+                 << attempt->endpoint.port();
+
+    if (is_client_)
+    {
+        // The other connections are closed after the selected one is acknowledged. No connection
+        // is selected after the timeout.
+        if (is_selecting_ || is_timed_out_)
+            return;
+
+        is_selecting_ = true;
+
+        asio::async_write(attempt->socket,
+                          asio::const_buffer(kSelectMarker.data(), kSelectMarker.size()),
+            [this, index](const std::error_code& error_code, size_t /* bytes_transferred */)
+        {
+            if (error_code == asio::error::operation_aborted)
+                return;
+
+            if (error_code)
+            {
+                onSelectFailed(index);
+                return;
+            }
+
+            Attempt* attempt = attempts_[index].get();
+
+            // The host closes the connection if it has already fallen back to the relay.
+            asio::async_read(attempt->socket,
+                             asio::mutable_buffer(attempt->marker.data(), attempt->marker.size()),
+                [this, index](const std::error_code& error_code, size_t /* bytes_transferred */)
+            {
+                if (error_code == asio::error::operation_aborted)
+                    return;
+
+                if (error_code || attempts_[index]->marker != kSelectAck)
+                {
+                    onSelectFailed(index);
+                    return;
+                }
+
+                onSelected(index);
+            });
+        });
+        return;
+    }
+
+    asio::async_read(attempt->socket,
+                     asio::mutable_buffer(attempt->marker.data(), attempt->marker.size()),
+        [this, index](const std::error_code& error_code, size_t /* bytes_transferred */)
+    {
+        if (error_code == asio::error::operation_aborted)
+            return;
+
+        Attempt* attempt = attempts_[index].get();
+
+        if (error_code || attempt->marker != kSelectMarker || is_selecting_)
+        {
+            // The client has selected another connection.
+            std::error_code ignored_code;
+            attempt->socket.close(ignored_code);
+            return;
+        }
+
+        // The timeout does not stop the acknowledgement that is being sent. After it, the client
+        // takes this connection.
+        is_selecting_ = true;
+
+        asio::async_write(attempt->socket,
+                          asio::const_buffer(kSelectAck.data(), kSelectAck.size()),
+            [this, index](const std::error_code& error_code, size_t /* bytes_transferred */)
+        {
+            if (error_code == asio::error::operation_aborted)
+                return;
+
+            if (error_code)
+            {
+                onSelectFailed(index);
+                return;
+            }
+
+            onSelected(index);
+        });
+    });
+}
+
+void DirectPeer::onSelected(size_t index)
+{
+    if (is_finished_)
+        return;
+
+    LOG(LS_INFO) << "Direct connection ready in "
+                 << std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - start_time_).count()
+                 << "ms (trace: " << connection_offer_.trace_id() << ")";
+
+    std::unique_ptr<TcpChannel> channel =
+        std::unique_ptr<TcpChannel>(new TcpChannel(std::move(attempts_[index]->socket)));
+    channel->setHostId(connection_offer_.host_data().host_id());
+
+    is_finished_ = true;
+    stop();
+
+    if (delegate_)
+    {
+        delegate_->onDirectConnectionReady(std::move(channel));
+    }
+    else
+    {
+        LOG(LS_WARNING) << "Invalid delegate";
+    }
+}
+
+void DirectPeer::onSelectFailed(size_t index)
+{
+    LOG(LS_INFO) << "Direct connection not selected (trace: " << connection_offer_.trace_id()
+                 << ")";
+
+    std::error_code ignored_code;
+    attempts_[index]->socket.close(ignored_code);
+
+    is_selecting_ = false;
+
+    // The timeout is postponed while the selection is in progress.
+    if (is_timed_out_)
+        onTimeout();
+}
+
+void DirectPeer::onTimeout()
+{
+    if (is_finished_)
+        return;
+
+    if (is_selecting_)
+    {
+        // The marker or the acknowledgement is in flight. The other peer may already use the
+        // connection, so the selection is finished first.
+        if (!is_timed_out_ && is_client_)
+        {
+            timeout_timer_.expires_after(kAckTimeout);
+            timeout_timer_.async_wait([this](const std::error_code& error_code)
+            {
+                if (error_code == asio::error::operation_aborted)
+                    return;
+
+                is_selecting_ = false;
+                onTimeout();
+            });
+        }
+
+        is_timed_out_ = true;
+        return;
+    }
+
+    LOG(LS_INFO) << "No direct connection (trace: " << connection_offer_.trace_id() << ")";
+
+    is_finished_ = true;
+    stop();
+
+    if (delegate_)
+    {
+        delegate_->onDirectConnectionError();
+    }
+    else
+    {
+        LOG(LS_WARNING) << "Invalid delegate";
+    }
+}
+
+void DirectPeer::stop()
+{
+    std::error_code ignored_code;
+    timeout_timer_.cancel(ignored_code);
+
+    for (auto& attempt : attempts_)
+    {
+        attempt->retry_timer.cancel(ignored_code);
+        attempt->socket.cancel(ignored_code);
+        attempt->socket.close(ignored_code);
+    }
+}
+
+} // namespace base
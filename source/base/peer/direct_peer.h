@@ -0,0 +1,113 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef BASE_PEER_DIRECT_PEER_H
+#define BASE_PEER_DIRECT_PEER_H
+
+#include "base/macros_magic.h"
+#include "proto/router_peer.pb.h"
+
+#include <asio/high_resolution_timer.hpp>
+#include <asio/ip/tcp.hpp>
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace base {
+
+class TcpChannel;
+
+// Keeps a local TCP port bound, so that the port can be announced to the router before the
+// connection offers come. The direct connections are made from this port.
+class DirectPort
+{
+public:
+    DirectPort();
+    ~DirectPort();
+
+    // Binds a free port. Returns false on failure.
+    bool open();
+    uint16_t port() const { return port_; }
+
+    // Endpoints of the port on |local_address| and on the addresses of the network adapters, so
+    // that the peers in the same LAN connect without leaving it. The router adds the address from
+    // which it sees the peer.
+    proto::DirectCandidates candidates(const std::string& local_address) const;
+
+private:
+    asio::ip::tcp::socket socket_;
+    uint16_t port_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(DirectPort);
+};
+
+// Connects two peers behind NATs without the relay. Both peers connect from their announced port
+// to all candidates of the other peer at the same time. The outgoing packets open the NATs for
+// the packets of the other peer, and the crossing connection attempts complete each other (TCP
+// simultaneous open). The client marks the first connection, the host acknowledges the marker and
+// takes the connection, and the client takes it after the acknowledgement. So both peers either
+// use the same connection or fall back to the relay together.
+class DirectPeer
+{
+public:
+    DirectPeer();
+    ~DirectPeer();
+
+    class Delegate
+    {
+    public:
+        virtual ~Delegate() = default;
+
+        virtual void onDirectConnectionReady(std::unique_ptr<TcpChannel> channel) = 0;
+        virtual void onDirectConnectionError() = 0;
+    };
+
+    void start(const proto::ConnectionOffer& offer, uint16_t local_port, Delegate* delegate);
+    bool isFinished() const { return is_finished_; }
+    const proto::ConnectionOffer& connectionOffer() const { return connection_offer_; }
+
+private:
+    struct Attempt;
+
+    void doConnect(size_t index);
+    void onConnected(size_t index);
+    void onSelected(size_t index);
+    void onSelectFailed(size_t index);
+    void onTimeout();
+    void stop();
+
+    Delegate* delegate_ = nullptr;
+    proto::ConnectionOffer connection_offer_;
+    std::chrono::steady_clock::time_point start_time_;
+    uint16_t local_port_ = 0;
+    bool is_client_ = false;
+    bool is_selecting_ = false;
+    bool is_timed_out_ = false;
+    bool is_finished_ = false;
+
+    asio::io_context& io_context_;
+    asio::high_resolution_timer timeout_timer_;
+    std::vector<std::unique_ptr<Attempt>> attempts_;
+
+    DISALLOW_COPY_AND_ASSIGN(DirectPeer);
+};
+
+} // namespace base
+
+#endif // BASE_PEER_DIRECT_PEER_H
@@ -57,9 +57,12 @@ void RelayPeer::start(const proto::ConnectionOffer& offer, Delegate* delegate)
 {
     delegate_ = delegate;
     connection_offer_ = offer;
+    start_time_ = std::chrono::steady_clock::now();
 
     DCHECK(delegate_);
 
+    LOG(LS_INFO) << "Connection offer (trace: " << connection_offer_.trace_id() << ")";
+
     const proto::RelayCredentials& credentials = connection_offer_.relay();
 
     message_ = authenticationMessage(credentials.key(), credentials.secret());
@@ -139,6 +142,11 @@ void RelayPeer::onConnected()
                 return;
             }
 
+            LOG(LS_INFO) << "Relay connection ready in "
+                         << std::chrono::duration_cast<std::chrono::milliseconds>(
+                                std::chrono::steady_clock::now() - start_time_).count()
+                         << "ms (trace: " << connection_offer_.trace_id() << ")";
+
             is_finished_ = true;
             if (delegate_)
             {
@@ -160,7 +168,7 @@ void RelayPeer::onErrorOccurred(const Location& location, const std::error_code&
 {
     LOG(LS_ERROR) << "Failed to connect to relay server: "
                   << utf16FromLocal8Bit(error_code.message()) << " ("
-                  << location.toString() << ")";
+                  << location.toString() << ", trace: " << connection_offer_.trace_id() << ")";
 
     is_finished_ = true;
     if (delegate_)
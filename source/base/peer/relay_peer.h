@@ -27,6 +27,7 @@
 
 #include <asio/ip/tcp.hpp>
 
+#include <chrono>
 #include <optional>
 
 namespace base {
@@ -61,6 +62,7 @@ private:
 
     Delegate* delegate_ = nullptr;
     proto::ConnectionOffer connection_offer_;
+    std::chrono::steady_clock::time_point start_time_;
     bool is_finished_ = false;
 
     uint32_t message_size_ = 0;
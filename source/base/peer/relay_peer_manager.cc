@@ -24,6 +24,29 @@
 
 namespace base {
 
+namespace {
+
+template <class T>
+void cleanupList(const std::shared_ptr<TaskRunner>& task_runner,
+                 std::vector<std::unique_ptr<T>>* list)
+{
+    auto it = list->begin();
+    while (it != list->end())
+    {
+        if (it->get()->isFinished())
+        {
+            task_runner->deleteSoon(std::move(*it));
+            it = list->erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+} // namespace
+
 RelayPeerManager::RelayPeerManager(std::shared_ptr<TaskRunner> task_runner, Delegate* delegate)
     : task_runner_(std::move(task_runner)),
       delegate_(delegate)
@@ -40,8 +63,14 @@ RelayPeerManager::~RelayPeerManager()
 
 void RelayPeerManager::addConnectionOffer(const proto::ConnectionOffer& offer)
 {
-    pending_.emplace_back(std::make_unique<RelayPeer>());
-    pending_.back()->start(offer, this);
+    if (direct_port_ && offer.direct().endpoint_size())
+    {
+        direct_pending_.emplace_back(std::make_unique<DirectPeer>());
+        direct_pending_.back()->start(offer, direct_port_, this);
+        return;
+    }
+
+    startRelayPeer(offer);
 }
 
 void RelayPeerManager::onRelayConnectionReady(std::unique_ptr<TcpChannel> channel)
@@ -63,21 +92,36 @@ void RelayPeerManager::onRelayConnectionError()
     cleanup();
 }
 
-void RelayPeerManager::cleanup()
+void RelayPeerManager::onDirectConnectionReady(std::unique_ptr<TcpChannel> channel)
 {
-    auto it = pending_.begin();
-    while (it != pending_.end())
+    onRelayConnectionReady(std::move(channel));
+}
+
+void RelayPeerManager::onDirectConnectionError()
+{
+    // The failed peer is the only finished one, the others are removed after they are finished.
+    for (const auto& direct_peer : direct_pending_)
     {
-        if (it->get()->isFinished())
-        {
-            task_runner_->deleteSoon(std::move(*it));
-            it = pending_.erase(it);
-        }
-        else
+        if (direct_peer->isFinished())
         {
-            ++it;
+            LOG(LS_INFO) << "Falling back to relay";
+            startRelayPeer(direct_peer->connectionOffer());
         }
     }
+
+    cleanup();
+}
+
+void RelayPeerManager::startRelayPeer(const proto::ConnectionOffer& offer)
+{
+    pending_.emplace_back(std::make_unique<RelayPeer>());
+    pending_.back()->start(offer, this);
+}
+
+void RelayPeerManager::cleanup()
+{
+    cleanupList(task_runner_, &pending_);
+    cleanupList(task_runner_, &direct_pending_);
 }
 
 } // namespace base
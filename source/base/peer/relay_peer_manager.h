@@ -20,6 +20,7 @@
 #define BASE_PEER_RELAY_PEER_MANAGER_H
 
 #include "base/macros_magic.h"
+#include "base/peer/direct_peer.h"
 #include "base/peer/relay_peer.h"
 
 #include <memory>
@@ -34,7 +35,9 @@ namespace base {
 class TcpChannel;
 class TaskRunner;
 
-class RelayPeerManager : public RelayPeer::Delegate
+class RelayPeerManager
+    : public RelayPeer::Delegate,
+      public DirectPeer::Delegate
 {
 public:
     class Delegate
@@ -48,6 +51,10 @@ public:
     RelayPeerManager(std::shared_ptr<TaskRunner> task_runner, Delegate* delegate);
     ~RelayPeerManager() override;
 
+    // The offers with the direct candidates are first tried without the relay from this port.
+    // Zero disables the direct connections.
+    void setDirectPort(uint16_t port) { direct_port_ = port; }
+
     void addConnectionOffer(const proto::ConnectionOffer& offer);
 
 protected:
@@ -55,13 +62,20 @@ protected:
     void onRelayConnectionReady(std::unique_ptr<TcpChannel> channel) override;
     void onRelayConnectionError() override;
 
+    // DirectPeer::Delegate implementation.
+    void onDirectConnectionReady(std::unique_ptr<TcpChannel> channel) override;
+    void onDirectConnectionError() override;
+
 private:
+    void startRelayPeer(const proto::ConnectionOffer& offer);
     void cleanup();
 
     std::shared_ptr<TaskRunner> task_runner_;
     Delegate* delegate_;
 
     std::vector<std::unique_ptr<RelayPeer>> pending_;
+    std::vector<std::unique_ptr<DirectPeer>> direct_pending_;
+    uint16_t direct_port_ = 0;
 
     DISALLOW_COPY_AND_ASSIGN(RelayPeerManager);
 };
@@ -27,6 +27,10 @@
 #include "base/crypto/random.h"
 #include "base/crypto/srp_constants.h"
 #include "base/crypto/srp_math.h"
+#include "base/metrics/metrics_registry.h"
+#include "base/peer/auth_rate_limiter.h"
+#include "base/peer/session_ticket_store.h"
+#include "base/peer/srp_verifier_cache.h"
 #include "base/peer/user_list.h"
 #include "base/strings/unicode.h"
 
@@ -35,6 +39,20 @@ namespace base {
 namespace {
 
 constexpr size_t kIvSize = 12;
+constexpr size_t kNonceSize = 32;
+
+// Compares the arrays in a time that does not depend on the position of the first difference.
+bool isEqualProof(const ByteArray& first, const ByteArray& second)
+{
+    if (first.size() != second.size())
+        return false;
+
+    uint8_t difference = 0;
+    for (size_t i = 0; i < first.size(); ++i)
+        difference |= first[i] ^ second[i];
+
+    return difference == 0;
+}
 
 const char* identifyToString(proto::Identify identify)
 {
@@ -54,7 +72,11 @@ const char* identifyToString(proto::Identify identify)
 } // namespace
 
 ServerAuthenticator::ServerAuthenticator(std::shared_ptr<TaskRunner> task_runner)
-    : Authenticator(std::move(task_runner))
+    : Authenticator(task_runner),
+      task_runner_(std::move(task_runner)),
+      self_(std::make_shared<ServerAuthenticator*>(this)),
+      key_pair_(std::make_shared<KeyPair>()),
+      srp_(std::make_shared<SrpNumbers>())
 {
     LOG(LS_INFO) << "Ctor";
 }
@@ -62,6 +84,7 @@ ServerAuthenticator::ServerAuthenticator(std::shared_ptr<TaskRunner> task_runner
 ServerAuthenticator::~ServerAuthenticator()
 {
     LOG(LS_INFO) << "Dtor";
+    *self_ = nullptr;
 }
 
 void ServerAuthenticator::setUserList(base::local_shared_ptr<UserListBase> user_list)
@@ -82,8 +105,8 @@ bool ServerAuthenticator::setPrivateKey(const ByteArray& private_key)
         return false;
     }
 
-    key_pair_ = KeyPair::fromPrivateKey(private_key);
-    if (!key_pair_.isValid())
+    *key_pair_ = KeyPair::fromPrivateKey(private_key);
+    if (!key_pair_->isValid())
     {
         LOG(LS_ERROR) << "Failed to load private key. Perhaps the key is incorrect";
         return false;
@@ -108,7 +131,7 @@ bool ServerAuthenticator::setAnonymousAccess(
 
     if (anonymous_access == AnonymousAccess::ENABLE)
     {
-        if (!key_pair_.isValid())
+        if (!key_pair_->isValid())
         {
             LOG(LS_ERROR) << "When anonymous access is enabled, a private key must be installed";
             return false;
@@ -132,12 +155,32 @@ bool ServerAuthenticator::setAnonymousAccess(
     return true;
 }
 
+void ServerAuthenticator::setWorkerTaskRunner(std::shared_ptr<TaskRunner> worker_task_runner)
+{
+    worker_task_runner_ = std::move(worker_task_runner);
+}
+
+void ServerAuthenticator::setSessionTicketStore(std::shared_ptr<SessionTicketStore> ticket_store)
+{
+    ticket_store_ = std::move(ticket_store);
+}
+
+void ServerAuthenticator::setVerifierCache(std::shared_ptr<SrpVerifierCache> verifier_cache)
+{
+    verifier_cache_ = std::move(verifier_cache);
+}
+
+void ServerAuthenticator::setUserRateLimiter(std::shared_ptr<AuthRateLimiter> user_rate_limiter)
+{
+    user_rate_limiter_ = std::move(user_rate_limiter);
+}
+
 bool ServerAuthenticator::onStarted()
 {
     internal_state_ = InternalState::READ_CLIENT_HELLO;
 
     // We do not allow anonymous access without a private key.
-    if (anonymous_access_ == AnonymousAccess::ENABLE && !key_pair_.isValid())
+    if (anonymous_access_ == AnonymousAccess::ENABLE && !key_pair_->isValid())
     {
         finish(FROM_HERE, ErrorCode::UNKNOWN_ERROR);
         return false;
@@ -146,7 +189,7 @@ bool ServerAuthenticator::onStarted()
     if (anonymous_access_ == AnonymousAccess::ENABLE)
     {
         // When anonymous access is enabled, a private key must be installed.
-        if (!key_pair_.isValid())
+        if (!key_pair_->isValid())
         {
             finish(FROM_HERE, ErrorCode::UNKNOWN_ERROR);
             return false;
@@ -193,8 +236,13 @@ void ServerAuthenticator::onReceived(const ByteArray& buffer)
             break;
 
         default:
-            NOTREACHED();
-            break;
+        {
+            // The client must wait for the reply of the server. While the calculations are in
+            // progress the numbers can't be changed by a repeated message.
+            LOG(LS_ERROR) << "Unexpected message in state " << static_cast<int>(internal_state_);
+            finish(FROM_HERE, ErrorCode::PROTOCOL_ERROR);
+        }
+        break;
     }
 }
 
@@ -212,6 +260,14 @@ void ServerAuthenticator::onWritten()
                     return;
             }
 
+            if (is_resumed_)
+            {
+                // The key is already known, the session challenge is sent right away.
+                internal_state_ = InternalState::SEND_SESSION_CHALLENGE;
+                doSessionChallenge();
+                break;
+            }
+
             switch (identify_)
             {
                 case proto::IDENTIFY_SRP:
@@ -244,6 +300,15 @@ void ServerAuthenticator::onWritten()
         case InternalState::SEND_SESSION_CHALLENGE:
         {
             LOG(LS_INFO) << "Sended: SessionChallenge";
+
+            if (is_resumed_)
+            {
+                // The session type and the client information are known from the ticket.
+                addTicket();
+                finish(FROM_HERE, ErrorCode::SUCCESS);
+                return;
+            }
+
             internal_state_ = InternalState::READ_SESSION_RESPONSE;
         }
         break;
@@ -311,9 +376,37 @@ void ServerAuthenticator::onClientHello(const ByteArray& buffer)
         }
     }
 
-    std::unique_ptr<proto::ServerHello> server_hello = std::make_unique<proto::ServerHello>();
+    if (client_hello->has_resume() && tryResume(client_hello->resume(), encryption))
+    {
+        internal_state_ = InternalState::SEND_SERVER_HELLO;
+        sendServerHello();
+        return;
+    }
+
+    bool has_aes_ni = false;
+
+#if defined(ARCH_CPU_X86_FAMILY)
+    has_aes_ni = CpuidUtil::hasAesNi();
+#endif
+
+    if ((encryption & proto::ENCRYPTION_AES256_GCM) && has_aes_ni)
+    {
+        LOG(LS_INFO) << "Both sides have hardware support AES. Using AES256 GCM";
+        // If both sides of the connection support AES, then method AES256 GCM is the fastest option.
+        encryption_ = proto::ENCRYPTION_AES256_GCM;
+    }
+    else
+    {
+        LOG(LS_INFO) << "Using ChaCha20+Poly1305";
+        // Otherwise, we use ChaCha20+Poly1305. This works faster in the absence of hardware
+        // support AES.
+        encryption_ = proto::ENCRYPTION_CHACHA20_POLY1305;
+    }
 
-    if (key_pair_.isValid())
+    // Now we are in the authentication phase.
+    internal_state_ = InternalState::SEND_SERVER_HELLO;
+
+    if (key_pair_->isValid())
     {
         ByteArray peer_public_key = fromStdString(client_hello->public_key());
         decrypt_iv_ = fromStdString(client_hello->iv());
@@ -326,48 +419,157 @@ void ServerAuthenticator::onClientHello(const ByteArray& buffer)
 
         if (!peer_public_key.empty() && !decrypt_iv_.empty())
         {
-            ByteArray temp = key_pair_.sessionKey(peer_public_key);
-            if (temp.empty())
-            {
-                finish(FROM_HERE, ErrorCode::UNKNOWN_ERROR);
-                return;
-            }
+            std::shared_ptr<ByteArray> session_key = std::make_shared<ByteArray>();
 
-            session_key_ = GenericHash::hash(GenericHash::Type::BLAKE2s256, temp);
-            if (session_key_.empty())
+            postWork([key_pair = key_pair_, peer_public_key, session_key]()
             {
-                finish(FROM_HERE, ErrorCode::UNKNOWN_ERROR);
-                return;
-            }
+                ByteArray temp = key_pair->sessionKey(peer_public_key);
+                if (!temp.empty())
+                    *session_key = GenericHash::hash(GenericHash::Type::BLAKE2s256, temp);
+            },
+            [this, session_key]()
+            {
+                if (session_key->empty())
+                {
+                    finish(FROM_HERE, ErrorCode::UNKNOWN_ERROR);
+                    return;
+                }
 
-            DCHECK(!encrypt_iv_.empty());
-            server_hello->set_iv(toStdString(encrypt_iv_));
+                session_key_ = std::move(*session_key);
+                sendServerHello();
+            });
+            return;
         }
     }
 
-    bool has_aes_ni = false;
+    sendServerHello();
+}
 
-#if defined(ARCH_CPU_X86_FAMILY)
-    has_aes_ni = CpuidUtil::hasAesNi();
-#endif
+bool ServerAuthenticator::tryResume(const proto::SessionResume& resume, uint32_t encryption)
+{
+    if (!ticket_store_)
+        return false;
 
-    if ((encryption & proto::ENCRYPTION_AES256_GCM) && has_aes_ni)
+    const ByteArray ticket_id = fromStdString(resume.ticket());
+
+    // The ticket is removed from the store even if it is rejected, so it can not be replayed.
+    std::optional<SessionTicketStore::Ticket> ticket = ticket_store_->take(ticket_id);
+    if (!ticket.has_value())
     {
-        LOG(LS_INFO) << "Both sides have hardware support AES. Using AES256 GCM";
-        // If both sides of the connection support AES, then method AES256 GCM is the fastest option.
-        server_hello->set_encryption(proto::ENCRYPTION_AES256_GCM);
+        LOG(LS_INFO) << "Unknown or expired session ticket";
+        return false;
     }
-    else
+
+    ByteArray client_nonce = fromStdString(resume.nonce());
+    ByteArray client_iv = fromStdString(resume.iv());
+
+    if (client_nonce.size() != kNonceSize || client_iv.size() != kIvSize ||
+        ticket->identify != identify_ || !(encryption & ticket->encryption))
     {
-        LOG(LS_INFO) << "Using ChaCha20+Poly1305";
-        // Otherwise, we use ChaCha20+Poly1305. This works faster in the absence of hardware
-        // support AES.
-        server_hello->set_encryption(proto::ENCRYPTION_CHACHA20_POLY1305);
+        LOG(LS_WARNING) << "Session ticket does not match the client hello";
+        return false;
     }
 
-    // Now we are in the authentication phase.
-    internal_state_ = InternalState::SEND_SERVER_HELLO;
-    encryption_ = server_hello->encryption();
+    GenericHash proof_hash(GenericHash::BLAKE2s256);
+    proof_hash.addData(ticket->session_key);
+    proof_hash.addData(ticket_id);
+    proof_hash.addData(client_nonce);
+    proof_hash.addData(client_iv);
+
+    if (!isEqualProof(proof_hash.result(), fromStdString(resume.proof())))
+    {
+        LOG(LS_WARNING) << "Invalid proof of the session ticket";
+        return false;
+    }
+
+    uint32_t session_types = session_types_;
+
+    if (identify_ == proto::IDENTIFY_SRP)
+    {
+        // The user could be disabled or changed since the ticket was issued.
+        User user;
+        if (user_list_)
+            user = user_list_->find(utf16FromUtf8(ticket->user_name));
+
+        if (!user.isValid() || !(user.flags & User::ENABLED) || user.verifier != ticket->verifier)
+        {
+            LOG(LS_INFO) << "User of the session ticket is no longer valid";
+            return false;
+        }
+
+        session_types = user.sessions;
+    }
+
+    if (!(session_types & ticket->session_type))
+    {
+        LOG(LS_INFO) << "Session type of the ticket is no longer allowed";
+        return false;
+    }
+
+    ByteArray server_nonce = Random::byteArray(kNonceSize);
+    ByteArray server_iv = Random::byteArray(kIvSize);
+    if (server_nonce.empty() || server_iv.empty())
+        return false;
+
+    GenericHash key_hash(GenericHash::BLAKE2s256);
+    key_hash.addData(ticket->session_key);
+    key_hash.addData(client_nonce);
+    key_hash.addData(server_nonce);
+
+    session_key_ = key_hash.result();
+    encryption_ = ticket->encryption;
+    encrypt_iv_ = std::move(server_iv);
+    decrypt_iv_ = std::move(client_iv);
+    resume_nonce_ = std::move(server_nonce);
+
+    session_types_ = session_types;
+    session_type_ = ticket->session_type;
+    user_name_ = std::move(ticket->user_name);
+    verifier_ = std::move(ticket->verifier);
+
+    setPeerVersion(ticket->version.toProto());
+    setPeerOsName(ticket->os_name);
+    setPeerComputerName(ticket->computer_name);
+
+    LOG(LS_INFO) << "Session resumed (user: '" << user_name_ << "', session type: "
+                 << session_type_ << ")";
+
+    is_resumed_ = true;
+    return true;
+}
+
+void ServerAuthenticator::addTicket()
+{
+    if (!ticket_store_ || ticket_id_.empty())
+        return;
+
+    SessionTicketStore::Ticket ticket;
+    ticket.session_key = session_key_;
+    ticket.encryption = encryption_;
+    ticket.identify = identify_;
+    ticket.user_name = user_name_;
+    ticket.verifier = verifier_;
+    ticket.session_type = session_type_;
+    ticket.version = peerVersion();
+    ticket.os_name = peerOsName();
+    ticket.computer_name = peerComputerName();
+
+    ticket_store_->add(ticket_id_, std::move(ticket));
+}
+
+void ServerAuthenticator::sendServerHello()
+{
+    std::unique_ptr<proto::ServerHello> server_hello = std::make_unique<proto::ServerHello>();
+    server_hello->set_encryption(encryption_);
+
+    if (!session_key_.empty())
+    {
+        DCHECK(!encrypt_iv_.empty());
+        server_hello->set_iv(toStdString(encrypt_iv_));
+    }
+
+    if (is_resumed_)
+        server_hello->set_resume_nonce(toStdString(resume_nonce_));
 
     LOG(LS_INFO) << "Sending: ServerHello";
     sendMessage(*server_hello);
@@ -393,21 +595,53 @@ void ServerAuthenticator::onIdentify(const ByteArray& buffer)
 
     LOG(LS_INFO) << "Username: '" << user_name_ << "'";
 
+    if (user_rate_limiter_ && !user_rate_limiter_->tryAcquire(user_name_))
+    {
+        LOG(LS_WARNING) << "Too many authentication attempts for user '" << user_name_ << "'";
+
+        static Counter* rate_limited_counter = MetricsRegistry::global().counter(
+            "aspia_rate_limited_handshakes_total", "Authentications rejected by the rate limits.",
+            "source=\"user\"");
+        rate_limited_counter->add();
+
+        finish(FROM_HERE, ErrorCode::ACCESS_DENIED);
+        return;
+    }
+
+    internal_state_ = InternalState::SEND_SERVER_KEY_EXCHANGE;
+
+    if (!user_list_)
+    {
+        LOG(LS_INFO) << "UserList is nullptr";
+        onUserFound(User());
+        return;
+    }
+
+    user_list_->findAsync(base::utf16FromUtf8(user_name_), [self = self_](const User& user)
+    {
+        // The authenticator may be destroyed or finished (for example, by timeout) while the
+        // user is being searched.
+        if (*self && (*self)->state() == State::PENDING)
+            (*self)->onUserFound(user);
+    });
+}
+
+void ServerAuthenticator::onUserFound(const User& user)
+{
+    std::u16string user_name_utf16 = base::utf16FromUtf8(user_name_);
+
+    // Not empty if the verifier of an unknown user must be calculated.
+    ByteArray fake_seed_key;
+
     do
     {
-        std::u16string user_name_utf16 = base::utf16FromUtf8(user_name_);
         ByteArray seed_key;
-        User user;
 
         if (user_list_)
-        {
-            user = user_list_->find(user_name_utf16);
             seed_key = user_list_->seedKey();
-        }
-        else
-        {
-            LOG(LS_INFO) << "UserList is nullptr";
-        }
+
+        // The verifier of an unknown user is cached only if it is the same for each attempt.
+        const bool can_cache_verifier = verifier_cache_ && !seed_key.empty();
 
         if (seed_key.empty())
             seed_key = base::Random::byteArray(64);
@@ -425,14 +659,15 @@ void ServerAuthenticator::onIdentify(const ByteArray& buffer)
         if (user.isValid() && (user.flags & User::ENABLED))
         {
             session_types_ = user.sessions;
+            verifier_ = user.verifier;
 
             std::optional<SrpNgPair> Ng_pair = pairByGroup(user.group);
             if (Ng_pair.has_value())
             {
-                N_ = BigNum::fromStdString(Ng_pair->first);
-                g_ = BigNum::fromStdString(Ng_pair->second);
-                s_ = BigNum::fromByteArray(user.salt);
-                v_ = BigNum::fromByteArray(user.verifier);
+                srp_->N = BigNum::fromStdString(Ng_pair->first);
+                srp_->g = BigNum::fromStdString(Ng_pair->second);
+                srp_->s = BigNum::fromByteArray(user.salt);
+                srp_->v = BigNum::fromByteArray(user.verifier);
                 break;
             }
             else
@@ -447,32 +682,66 @@ void ServerAuthenticator::onIdentify(const ByteArray& buffer)
         hash.addData(seed_key);
         hash.addData(user_name_);
 
-        N_ = BigNum::fromStdString(kSrpNgPair_8192.first);
-        g_ = BigNum::fromStdString(kSrpNgPair_8192.second);
-        s_ = BigNum::fromByteArray(hash.result());
-        v_ = SrpMath::calc_v(user_name_utf16, seed_key, s_, N_, g_);
+        ByteArray salt = hash.result();
+
+        srp_->N = BigNum::fromStdString(kSrpNgPair_8192.first);
+        srp_->g = BigNum::fromStdString(kSrpNgPair_8192.second);
+        srp_->s = BigNum::fromByteArray(salt);
+
+        if (can_cache_verifier)
+        {
+            std::optional<ByteArray> verifier = verifier_cache_->find(salt);
+            if (verifier.has_value())
+            {
+                srp_->v = BigNum::fromByteArray(*verifier);
+                break;
+            }
+
+            fake_salt_ = std::move(salt);
+        }
+
+        fake_seed_key = std::move(seed_key);
     }
     while (false);
 
-    b_ = BigNum::fromByteArray(Random::byteArray(128)); // 1024 bits.
-    B_ = SrpMath::calc_B(b_, N_, g_, v_);
+    postWork([srp = srp_,
+              user_name = std::move(user_name_utf16),
+              seed_key = std::move(fake_seed_key)]()
+    {
+        if (!seed_key.empty())
+            srp->v = SrpMath::calc_v(user_name, seed_key, srp->s, srp->N, srp->g);
+
+        srp->b = BigNum::fromByteArray(Random::byteArray(128)); // 1024 bits.
+        srp->B = SrpMath::calc_B(srp->b, srp->N, srp->g, srp->v);
+    },
+    std::bind(&ServerAuthenticator::sendServerKeyExchange, this));
+}
 
-    if (!N_.isValid() || !g_.isValid() || !s_.isValid() || !B_.isValid())
+void ServerAuthenticator::sendServerKeyExchange()
+{
+    if (!srp_->N.isValid() || !srp_->g.isValid() || !srp_->s.isValid() || !srp_->B.isValid())
     {
         finish(FROM_HERE, ErrorCode::PROTOCOL_ERROR);
         return;
     }
 
-    internal_state_ = InternalState::SEND_SERVER_KEY_EXCHANGE;
+    if (!fake_salt_.empty())
+    {
+        if (verifier_cache_ && srp_->v.isValid())
+            verifier_cache_->add(fake_salt_, srp_->v.toByteArray());
+
+        fake_salt_.clear();
+    }
+
     encrypt_iv_ = Random::byteArray(kIvSize);
 
     std::unique_ptr<proto::SrpServerKeyExchange> server_key_exchange =
         std::make_unique<proto::SrpServerKeyExchange>();
 
-    server_key_exchange->set_number(N_.toStdString());
-    server_key_exchange->set_generator(g_.toStdString());
-    server_key_exchange->set_salt(s_.toStdString());
-    server_key_exchange->set_b(B_.toStdString());
+    server_key_exchange->set_number(srp_->N.toStdString());
+    server_key_exchange->set_generator(srp_->g.toStdString());
+    server_key_exchange->set_salt(srp_->s.toStdString());
+    server_key_exchange->set_b(srp_->B.toStdString());
     server_key_exchange->set_iv(toStdString(encrypt_iv_));
 
     LOG(LS_INFO) << "Sending: ServerKeyExchange";
@@ -491,16 +760,33 @@ void ServerAuthenticator::onClientKeyExchange(const ByteArray& buffer)
         return;
     }
 
-    A_ = BigNum::fromStdString(client_key_exchange->a());
+    srp_->A = BigNum::fromStdString(client_key_exchange->a());
     decrypt_iv_ = fromStdString(client_key_exchange->iv());
 
-    if (!A_.isValid() || decrypt_iv_.empty())
+    if (!srp_->A.isValid() || decrypt_iv_.empty())
     {
         finish(FROM_HERE, ErrorCode::PROTOCOL_ERROR);
         return;
     }
 
-    ByteArray srp_key = createSrpKey();
+    // The key is calculated on the worker, the next messages of the client are not expected until
+    // the session challenge is sent.
+    internal_state_ = InternalState::SEND_SESSION_CHALLENGE;
+
+    std::shared_ptr<ByteArray> srp_key = std::make_shared<ByteArray>();
+
+    postWork([srp = srp_, srp_key]()
+    {
+        *srp_key = createSrpKey(*srp);
+    },
+    [this, srp_key]()
+    {
+        onSrpKeyCreated(*srp_key);
+    });
+}
+
+void ServerAuthenticator::onSrpKeyCreated(const ByteArray& srp_key)
+{
     if (srp_key.empty())
     {
         finish(FROM_HERE, ErrorCode::UNKNOWN_ERROR);
@@ -533,7 +819,6 @@ void ServerAuthenticator::onClientKeyExchange(const ByteArray& buffer)
     if (!onSessionKeyChanged())
         return;
 
-    internal_state_ = InternalState::SEND_SESSION_CHALLENGE;
     doSessionChallenge();
 }
 
@@ -553,6 +838,13 @@ void ServerAuthenticator::doSessionChallenge()
     session_challenge->set_computer_name(SysInfo::computerName());
     session_challenge->set_cpu_cores(static_cast<uint32_t>(SysInfo::processorThreads()));
 
+    if (ticket_store_)
+    {
+        // The ticket is stored only when the authentication is completed.
+        ticket_id_ = SessionTicketStore::createId();
+        session_challenge->set_ticket(toStdString(ticket_id_));
+    }
+
     LOG(LS_INFO) << "Sending: SessionChallenge";
     sendMessage(*session_challenge);
 }
@@ -594,21 +886,49 @@ void ServerAuthenticator::onSessionResponse(const ByteArray& buffer)
     }
 
     // Authentication completed successfully.
+    addTicket();
     finish(FROM_HERE, ErrorCode::SUCCESS);
 }
 
-ByteArray ServerAuthenticator::createSrpKey()
+// static
+ByteArray ServerAuthenticator::createSrpKey(const SrpNumbers& srp)
 {
-    if (!SrpMath::verify_A_mod_N(A_, N_))
+    if (!SrpMath::verify_A_mod_N(srp.A, srp.N))
     {
         LOG(LS_ERROR) << "SrpMath::verify_A_mod_N failed";
         return ByteArray();
     }
 
-    BigNum u = SrpMath::calc_u(A_, B_, N_);
-    BigNum server_key = SrpMath::calcServerKey(A_, v_, u, b_, N_);
+    BigNum u = SrpMath::calc_u(srp.A, srp.B, srp.N);
+    BigNum server_key = SrpMath::calcServerKey(srp.A, srp.v, u, srp.b, srp.N);
 
     return server_key.toByteArray();
 }
 
+void ServerAuthenticator::postWork(TaskRunner::Callback work, TaskRunner::Callback reply)
+{
+    if (!worker_task_runner_)
+    {
+        work();
+        reply();
+        return;
+    }
+
+    worker_task_runner_->postTask([task_runner = task_runner_,
+                                   self = self_,
+                                   work = std::move(work),
+                                   reply = std::move(reply)]()
+    {
+        work();
+
+        task_runner->postTask([self, reply]()
+        {
+            // The authenticator may be destroyed or finished (for example, by timeout) while the
+            // work is in progress.
+            if (*self && (*self)->state() == State::PENDING)
+                reply();
+        });
+    });
+}
+
 } // namespace base
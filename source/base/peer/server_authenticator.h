@@ -19,6 +19,7 @@
 #ifndef BASE_PEER_SERVER_AUTHENTICATOR_H
 #define BASE_PEER_SERVER_AUTHENTICATOR_H
 
+#include "base/task_runner.h"
 #include "base/crypto/big_num.h"
 #include "base/crypto/key_pair.h"
 #include "base/memory/local_memory.h"
@@ -27,7 +28,11 @@
 
 namespace base {
 
+class AuthRateLimiter;
+class SessionTicketStore;
+class SrpVerifierCache;
 class UserListBase;
+class User;
 
 class ServerAuthenticator : public Authenticator
 {
@@ -53,6 +58,26 @@ public:
     // By default, anonymous access is disabled.
     [[nodiscard]] bool setAnonymousAccess(AnonymousAccess anonymous_access, uint32_t session_types);
 
+    // Sets the task runner for the key exchange and SRP calculations. The results are returned to
+    // the task runner of the authenticator. By default, the calculations are done on the task
+    // runner of the authenticator.
+    void setWorkerTaskRunner(std::shared_ptr<TaskRunner> worker_task_runner);
+
+    // Sets the store of the session tickets. If it is set, the client gets a ticket after the
+    // authentication and can resume the session with it later. By default, resumption is disabled.
+    void setSessionTicketStore(std::shared_ptr<SessionTicketStore> ticket_store);
+
+    // Sets the cache of the verifiers of unknown users. By default, the verifier of an unknown
+    // user is calculated for each attempt.
+    void setVerifierCache(std::shared_ptr<SrpVerifierCache> verifier_cache);
+
+    // Sets the limiter of attempts for each user name. It is checked before the SRP calculations.
+    // By default, the attempts are not limited.
+    void setUserRateLimiter(std::shared_ptr<AuthRateLimiter> user_rate_limiter);
+
+    // Returns true if the session was resumed with a ticket.
+    [[nodiscard]] bool isResumed() const { return is_resumed_; }
+
 protected:
     // Authenticator implementation.
     [[nodiscard]] bool onStarted() override;
@@ -60,12 +85,40 @@ protected:
     void onWritten() override;
 
 private:
+    struct SrpNumbers
+    {
+        BigNum N;
+        BigNum g;
+        BigNum v;
+        BigNum s;
+        BigNum b;
+        BigNum B;
+        BigNum A;
+    };
+
     void onClientHello(const ByteArray& buffer);
+    [[nodiscard]] bool tryResume(const proto::SessionResume& resume, uint32_t encryption);
+    void addTicket();
+    void sendServerHello();
     void onIdentify(const ByteArray& buffer);
+    void onUserFound(const User& user);
+    void sendServerKeyExchange();
     void onClientKeyExchange(const ByteArray& buffer);
+    void onSrpKeyCreated(const ByteArray& srp_key);
     void doSessionChallenge();
     void onSessionResponse(const ByteArray& buffer);
-    [[nodiscard]] ByteArray createSrpKey();
+    [[nodiscard]] static ByteArray createSrpKey(const SrpNumbers& srp);
+
+    // Calls |work| on the worker task runner and then |reply| on the task runner of the
+    // authenticator if it still exists and is not finished. |work| must not use the members.
+    void postWork(TaskRunner::Callback work, TaskRunner::Callback reply);
+
+    std::shared_ptr<TaskRunner> task_runner_;
+    std::shared_ptr<TaskRunner> worker_task_runner_;
+
+    // Cleared in the destructor, so that the replies of the worker do not reach the destroyed
+    // authenticator.
+    std::shared_ptr<ServerAuthenticator*> self_;
 
     base::local_shared_ptr<UserListBase> user_list_;
 
@@ -86,14 +139,20 @@ private:
     // Bitmask of allowed session types.
     uint32_t session_types_ = 0;
 
-    KeyPair key_pair_;
-    BigNum N_;
-    BigNum g_;
-    BigNum v_;
-    BigNum s_;
-    BigNum b_;
-    BigNum B_;
-    BigNum A_;
+    // Shared with the calculations on the worker task runner, which can outlive the authenticator.
+    std::shared_ptr<KeyPair> key_pair_;
+    std::shared_ptr<SrpNumbers> srp_;
+
+    std::shared_ptr<SessionTicketStore> ticket_store_;
+    std::shared_ptr<SrpVerifierCache> verifier_cache_;
+    std::shared_ptr<AuthRateLimiter> user_rate_limiter_;
+
+    // Salt of the unknown user whose verifier is calculated and must be added to the cache.
+    ByteArray fake_salt_;
+    ByteArray ticket_id_; // Identifier of the ticket sent to the client.
+    ByteArray verifier_; // SRP verifier of the authenticated user.
+    ByteArray resume_nonce_;
+    bool is_resumed_ = false;
 
     DISALLOW_COPY_AND_ASSIGN(ServerAuthenticator);
 };
@@ -20,13 +20,63 @@
 
 #include "base/logging.h"
 #include "base/task_runner.h"
+#include "base/metrics/metrics_registry.h"
+#include "base/peer/auth_rate_limiter.h"
+#include "base/peer/session_ticket_store.h"
+#include "base/peer/srp_verifier_cache.h"
 #include "base/peer/user_list_base.h"
+#include "base/strings/unicode.h"
+#include "base/threading/thread.h"
 
 namespace base {
 
+namespace {
+
+// Channels that waited longer than this are closed without authentication. Their peers have most
+// likely given up already.
+constexpr std::chrono::minutes kMaxWaitTime { 1 };
+
+constexpr std::chrono::minutes kDefaultTicketLifetime { 5 };
+
+struct AuthenticatorMetrics
+{
+    Counter* succeeded;
+    Counter* failed;
+    Gauge* pending;
+    Gauge* waiting;
+    Counter* rejected;
+    Counter* rate_limited;
+};
+
+const AuthenticatorMetrics& authenticatorMetrics()
+{
+    static const AuthenticatorMetrics metrics =
+    {
+        MetricsRegistry::global().counter(
+            "aspia_handshakes_total", "Finished authentications.", "result=\"success\""),
+        MetricsRegistry::global().counter(
+            "aspia_handshakes_total", "Finished authentications.", "result=\"failure\""),
+        MetricsRegistry::global().gauge(
+            "aspia_pending_handshakes", "Authentications in progress."),
+        MetricsRegistry::global().gauge(
+            "aspia_waiting_handshakes", "Connections waiting for the start of authentication."),
+        MetricsRegistry::global().counter(
+            "aspia_rejected_handshakes_total", "Connections closed because of the queue limit."),
+        MetricsRegistry::global().counter(
+            "aspia_rate_limited_handshakes_total", "Authentications rejected by the rate limits.",
+            "source=\"address\"")
+    };
+
+    return metrics;
+}
+
+} // namespace
+
 ServerAuthenticatorManager::ServerAuthenticatorManager(
     std::shared_ptr<TaskRunner> task_runner, Delegate* delegate)
     : task_runner_(std::move(task_runner)),
+      ticket_store_(std::make_shared<SessionTicketStore>(kDefaultTicketLifetime)),
+      verifier_cache_(std::make_shared<SrpVerifierCache>()),
       delegate_(delegate)
 {
     LOG(LS_INFO) << "Ctor";
@@ -36,6 +86,13 @@ ServerAuthenticatorManager::ServerAuthenticatorManager(
 ServerAuthenticatorManager::~ServerAuthenticatorManager()
 {
     LOG(LS_INFO) << "Dtor";
+
+    // The calculations in progress must be completed before the authenticators are destroyed.
+    for (auto& worker : workers_)
+        worker->stop();
+
+    authenticatorMetrics().pending->add(-static_cast<int64_t>(pending_.size()));
+    authenticatorMetrics().waiting->add(-static_cast<int64_t>(waiting_.size()));
 }
 
 void ServerAuthenticatorManager::setUserList(std::unique_ptr<UserListBase> user_list)
@@ -56,13 +113,121 @@ void ServerAuthenticatorManager::setAnonymousAccess(
     anonymous_session_types_ = session_types;
 }
 
+void ServerAuthenticatorManager::setWorkerThreadCount(size_t thread_count)
+{
+    DCHECK(pending_.empty());
+
+    LOG(LS_INFO) << "Worker threads: " << thread_count;
+
+    workers_.clear();
+    next_worker_ = 0;
+
+    for (size_t i = 0; i < thread_count; ++i)
+    {
+        std::unique_ptr<Thread> worker = std::make_unique<Thread>();
+        worker->start(MessageLoop::Type::DEFAULT);
+        workers_.emplace_back(std::move(worker));
+    }
+}
+
+void ServerAuthenticatorManager::setMaxPendingCount(size_t max_pending_count)
+{
+    LOG(LS_INFO) << "Max pending authentications: " << max_pending_count;
+    max_pending_count_ = max_pending_count;
+    startWaiting();
+}
+
+void ServerAuthenticatorManager::setMaxWaitingCount(size_t max_waiting_count)
+{
+    LOG(LS_INFO) << "Max waiting authentications: " << max_waiting_count;
+    max_waiting_count_ = max_waiting_count;
+}
+
+void ServerAuthenticatorManager::setRateLimits(
+    uint32_t address_rate_per_minute, uint32_t user_rate_per_minute)
+{
+    LOG(LS_INFO) << "Authentication rate limits (address: " << address_rate_per_minute
+                 << ", user: " << user_rate_per_minute << ")";
+
+    // One minute of attempts can be made at once.
+    if (address_rate_per_minute)
+    {
+        address_rate_limiter_ = std::make_unique<AuthRateLimiter>(
+            address_rate_per_minute, address_rate_per_minute);
+    }
+    else
+    {
+        address_rate_limiter_.reset();
+    }
+
+    if (user_rate_per_minute)
+    {
+        user_rate_limiter_ = std::make_shared<AuthRateLimiter>(
+            user_rate_per_minute, user_rate_per_minute);
+    }
+    else
+    {
+        user_rate_limiter_.reset();
+    }
+}
+
+void ServerAuthenticatorManager::setSessionTicketLifetime(std::chrono::seconds lifetime)
+{
+    LOG(LS_INFO) << "Session ticket lifetime: " << lifetime.count() << " seconds";
+
+    // The tickets issued with the previous lifetime are dropped.
+    if (lifetime.count() > 0)
+        ticket_store_ = std::make_shared<SessionTicketStore>(lifetime);
+    else
+        ticket_store_.reset();
+}
+
 void ServerAuthenticatorManager::addNewChannel(std::unique_ptr<TcpChannel> channel)
 {
     DCHECK(channel);
 
+    if (address_rate_limiter_ &&
+        !address_rate_limiter_->tryAcquire(utf8FromUtf16(channel->peerAddress())))
+    {
+        // The channel is closed when it is destroyed, before any key exchange.
+        LOG(LS_WARNING) << "Too many connections from " << channel->peerAddress();
+        authenticatorMetrics().rate_limited->add();
+        return;
+    }
+
+    if (max_pending_count_ && pending_.size() >= max_pending_count_)
+    {
+        if (max_waiting_count_ && waiting_.size() >= max_waiting_count_)
+        {
+            // The channel is closed when it is destroyed. The peer can try again later.
+            LOG(LS_WARNING) << "Too many waiting authentications. Connection rejected: "
+                            << channel->peerAddress();
+            authenticatorMetrics().rejected->add();
+            return;
+        }
+
+        waiting_.push_back({ std::move(channel), Clock::now() });
+        authenticatorMetrics().waiting->increment();
+        return;
+    }
+
+    startAuthenticator(std::move(channel));
+}
+
+void ServerAuthenticatorManager::startAuthenticator(std::unique_ptr<TcpChannel> channel)
+{
     std::unique_ptr<ServerAuthenticator> authenticator =
         std::make_unique<ServerAuthenticator>(task_runner_);
     authenticator->setUserList(user_list_);
+    authenticator->setSessionTicketStore(ticket_store_);
+    authenticator->setVerifierCache(verifier_cache_);
+    authenticator->setUserRateLimiter(user_rate_limiter_);
+
+    if (!workers_.empty())
+    {
+        authenticator->setWorkerTaskRunner(workers_[next_worker_]->taskRunner());
+        next_worker_ = (next_worker_ + 1) % workers_.size();
+    }
 
     if (!private_key_.empty())
     {
@@ -81,12 +246,31 @@ void ServerAuthenticatorManager::addNewChannel(std::unique_ptr<TcpChannel> chann
 
     // Create a new authenticator for the connection and put it on the list.
     pending_.emplace_back(std::move(authenticator));
+    authenticatorMetrics().pending->increment();
 
     // Start the authentication process.
     pending_.back()->start(
         std::move(channel), std::bind(&ServerAuthenticatorManager::onComplete, this));
 }
 
+void ServerAuthenticatorManager::startWaiting()
+{
+    while (!waiting_.empty() && (!max_pending_count_ || pending_.size() < max_pending_count_))
+    {
+        WaitingChannel waiting = std::move(waiting_.front());
+        waiting_.pop_front();
+        authenticatorMetrics().waiting->decrement();
+
+        if (Clock::now() - waiting.time > kMaxWaitTime)
+        {
+            LOG(LS_WARNING) << "Channel waited too long for authentication";
+            continue;
+        }
+
+        startAuthenticator(std::move(waiting.channel));
+    }
+}
+
 void ServerAuthenticatorManager::onComplete()
 {
     for (auto it = pending_.begin(); it != pending_.end();)
@@ -100,6 +284,8 @@ void ServerAuthenticatorManager::onComplete()
             {
                 if (current->state() == Authenticator::State::SUCCESS)
                 {
+                    authenticatorMetrics().succeeded->add();
+
                     SessionInfo session_info;
 
                     session_info.channel       = current->takeChannel();
@@ -111,10 +297,15 @@ void ServerAuthenticatorManager::onComplete()
 
                     delegate_->onNewSession(std::move(session_info));
                 }
+                else
+                {
+                    authenticatorMetrics().failed->add();
+                }
 
                 // Authenticator not needed anymore.
                 task_runner_->deleteSoon(std::move(*it));
                 it = pending_.erase(it);
+                authenticatorMetrics().pending->decrement();
             }
             break;
 
@@ -128,6 +319,8 @@ void ServerAuthenticatorManager::onComplete()
                 return;
         }
     }
+
+    startWaiting();
 }
 
 } // namespace base
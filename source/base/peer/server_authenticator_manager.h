@@ -21,8 +21,16 @@
 
 #include "base/peer/server_authenticator.h"
 
+#include <chrono>
+#include <deque>
+
 namespace base {
 
+class AuthRateLimiter;
+class SessionTicketStore;
+class SrpVerifierCache;
+class Thread;
+
 class ServerAuthenticatorManager
 {
 public:
@@ -63,18 +71,63 @@ public:
     void setAnonymousAccess(
         ServerAuthenticator::AnonymousAccess anonymous_access, uint32_t session_types);
 
+    // Runs the key exchange and SRP calculations of the authenticators on |thread_count| threads.
+    // By default, they run on the task runner of the manager. Must be called before adding
+    // channels.
+    void setWorkerThreadCount(size_t thread_count);
+
+    // Limits the number of authentications in progress. New channels wait in a queue until one of
+    // the authentications is completed. Zero means no limit (default).
+    void setMaxPendingCount(size_t max_pending_count);
+
+    // Limits the queue of channels waiting for the start of authentication. Channels beyond it are
+    // closed at once, so that a flood of connections does not delay the sessions in progress.
+    // Zero means no limit (default).
+    void setMaxWaitingCount(size_t max_waiting_count);
+
+    // Limits the attempts of authentication for each address of a peer and for each user name to
+    // the given number per minute. The address is checked before the channel is queued and the
+    // user name before the SRP calculations. Zero means no limit (default).
+    void setRateLimits(uint32_t address_rate_per_minute, uint32_t user_rate_per_minute);
+
+    // Sets the time during which a client can resume its session after a reconnect without the
+    // full authentication. Zero disables session resumption. The default is 5 minutes.
+    void setSessionTicketLifetime(std::chrono::seconds lifetime);
+
     // Adds a channel to the authentication queue. After success completion, a session will be
     // created (in a stopped state) and method Delegate::onNewSession will be called.
     // If authentication fails, the channel will be automatically deleted.
     void addNewChannel(std::unique_ptr<TcpChannel> channel);
 
 private:
+    using Clock = std::chrono::steady_clock;
+
+    struct WaitingChannel
+    {
+        std::unique_ptr<TcpChannel> channel;
+        Clock::time_point time;
+    };
+
+    void startAuthenticator(std::unique_ptr<TcpChannel> channel);
+    void startWaiting();
     void onComplete();
 
     std::shared_ptr<TaskRunner> task_runner_;
     base::local_shared_ptr<UserListBase> user_list_;
     std::vector<std::unique_ptr<ServerAuthenticator>> pending_;
 
+    std::vector<std::unique_ptr<Thread>> workers_;
+    size_t next_worker_ = 0;
+
+    size_t max_pending_count_ = 0;
+    size_t max_waiting_count_ = 0;
+    std::deque<WaitingChannel> waiting_;
+
+    std::shared_ptr<SessionTicketStore> ticket_store_;
+    std::shared_ptr<SrpVerifierCache> verifier_cache_;
+    std::unique_ptr<AuthRateLimiter> address_rate_limiter_;
+    std::shared_ptr<AuthRateLimiter> user_rate_limiter_;
+
     ByteArray private_key_;
 
     ServerAuthenticator::AnonymousAccess anonymous_access_ =
@@ -0,0 +1,204 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/peer/server_authenticator.h"
+
+#include "base/crypto/random.h"
+#include "base/message_loop/message_loop.h"
+#include "base/net/tcp_server.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+const uint16_t kTestPort = 18093;
+
+// Runs the tasks right away until it is held. The held tasks are never run.
+class TestWorkerTaskRunner : public TaskRunner
+{
+public:
+    void hold() { held_ = true; }
+    size_t heldCount() const { return held_tasks_.size(); }
+
+    // TaskRunner implementation.
+    bool belongsToCurrentThread() const override { return true; }
+
+    void postTask(Callback task) override
+    {
+        if (held_)
+            held_tasks_.emplace_back(std::move(task));
+        else
+            task();
+    }
+
+    void postDelayedTask(Callback callback, const Milliseconds& /* delay */) override
+    {
+        postTask(std::move(callback));
+    }
+
+    void postNonNestableTask(Callback callback) override
+    {
+        postTask(std::move(callback));
+    }
+
+    void postNonNestableDelayedTask(Callback callback, const Milliseconds& /* delay */) override
+    {
+        postTask(std::move(callback));
+    }
+
+    void postQuit() override
+    {
+        // Nothing
+    }
+
+private:
+    bool held_ = false;
+    std::vector<Callback> held_tasks_;
+};
+
+// Client which sends SrpClientKeyExchange twice without waiting for the reply of the server.
+class DuplicateKeyExchangeClient : public TcpChannel::Listener
+{
+public:
+    explicit DuplicateKeyExchangeClient(TestWorkerTaskRunner* worker_task_runner)
+        : worker_task_runner_(worker_task_runner),
+          channel_(std::make_unique<TcpChannel>())
+    {
+        channel_->setListener(this);
+        channel_->connect(u"127.0.0.1", kTestPort);
+    }
+
+    ~DuplicateKeyExchangeClient() override
+    {
+        channel_->setListener(nullptr);
+    }
+
+protected:
+    // TcpChannel::Listener implementation.
+    void onTcpConnected() override
+    {
+        channel_->resume();
+
+        proto::ClientHello client_hello;
+        client_hello.set_encryption(proto::ENCRYPTION_CHACHA20_POLY1305);
+        client_hello.set_identify(proto::IDENTIFY_SRP);
+        channel_->send(0, client_hello);
+    }
+
+    void onTcpDisconnected(NetworkChannel::ErrorCode /* error_code */) override
+    {
+        // Nothing
+    }
+
+    void onTcpMessageReceived(uint8_t /* channel_id */, const ByteArray& /* buffer */) override
+    {
+        ++received_count_;
+
+        if (received_count_ == 1)
+        {
+            // ServerHello.
+            proto::SrpIdentify identify;
+            identify.set_username("user");
+            channel_->send(0, identify);
+        }
+        else if (received_count_ == 2)
+        {
+            // SrpServerKeyExchange. The calculation of the key stays in progress.
+            worker_task_runner_->hold();
+
+            proto::SrpClientKeyExchange client_key_exchange;
+            client_key_exchange.set_a(toStdString(Random::byteArray(128)));
+            client_key_exchange.set_iv(toStdString(Random::byteArray(12)));
+
+            channel_->send(0, client_key_exchange);
+
+            client_key_exchange.set_a(toStdString(Random::byteArray(128)));
+            channel_->send(0, client_key_exchange);
+        }
+    }
+
+    void onTcpMessageWritten(uint8_t /* channel_id */, size_t /* pending */) override
+    {
+        // Nothing
+    }
+
+private:
+    TestWorkerTaskRunner* worker_task_runner_;
+    std::unique_ptr<TcpChannel> channel_;
+    int received_count_ = 0;
+};
+
+class TestServer : public TcpServer::Delegate
+{
+public:
+    TestServer(std::shared_ptr<TaskRunner> task_runner,
+               std::shared_ptr<TaskRunner> worker_task_runner)
+        : task_runner_(std::move(task_runner)),
+          worker_task_runner_(std::move(worker_task_runner))
+    {
+        server_.start(u"127.0.0.1", kTestPort, this);
+    }
+
+    Authenticator::ErrorCode errorCode() const { return error_code_; }
+
+protected:
+    // TcpServer::Delegate implementation.
+    void onNewConnection(std::unique_ptr<TcpChannel> channel) override
+    {
+        authenticator_ = std::make_unique<ServerAuthenticator>(task_runner_);
+        authenticator_->setWorkerTaskRunner(worker_task_runner_);
+
+        authenticator_->start(std::move(channel), [this](Authenticator::ErrorCode error_code)
+        {
+            error_code_ = error_code;
+            task_runner_->postQuit();
+        });
+    }
+
+private:
+    std::shared_ptr<TaskRunner> task_runner_;
+    std::shared_ptr<TaskRunner> worker_task_runner_;
+    TcpServer server_;
+    std::unique_ptr<ServerAuthenticator> authenticator_;
+    Authenticator::ErrorCode error_code_ = Authenticator::ErrorCode::SUCCESS;
+};
+
+} // namespace
+
+TEST(ServerAuthenticatorTest, DuplicateClientKeyExchange)
+{
+    MessageLoop message_loop(MessageLoop::Type::ASIO);
+
+    std::shared_ptr<TestWorkerTaskRunner> worker_task_runner =
+        std::make_shared<TestWorkerTaskRunner>();
+
+    TestServer server(message_loop.taskRunner(), worker_task_runner);
+    DuplicateKeyExchangeClient client(worker_task_runner.get());
+
+    message_loop.run();
+
+    // The repeated message is rejected while the key is calculated, and the key is never used.
+    EXPECT_EQ(server.errorCode(), Authenticator::ErrorCode::PROTOCOL_ERROR);
+    EXPECT_EQ(worker_task_runner->heldCount(), 1U);
+}
+
+} // namespace base
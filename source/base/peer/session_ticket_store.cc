@@ -0,0 +1,101 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/peer/session_ticket_store.h"
+
+#include "base/logging.h"
+#include "base/crypto/random.h"
+
+namespace base {
+
+SessionTicketStore::SessionTicketStore(std::chrono::seconds lifetime, size_t max_count)
+    : lifetime_(lifetime),
+      max_count_(max_count)
+{
+    DCHECK_GT(max_count_, 0u);
+}
+
+SessionTicketStore::~SessionTicketStore() = default;
+
+// static
+ByteArray SessionTicketStore::createId()
+{
+    return Random::byteArray(kIdSize);
+}
+
+void SessionTicketStore::add(const ByteArray& id, Ticket&& ticket)
+{
+    if (id.size() != kIdSize)
+        return;
+
+    const Clock::time_point now = Clock::now();
+    removeExpired(now);
+
+    while (tickets_.size() >= max_count_ && !order_.empty())
+    {
+        tickets_.erase(order_.front().second);
+        order_.pop_front();
+    }
+
+    const Clock::time_point expire_time = now + lifetime_;
+    std::string key = toStdString(id);
+
+    tickets_.insert_or_assign(key, Entry{ std::move(ticket), expire_time });
+    order_.emplace_back(expire_time, std::move(key));
+}
+
+std::optional<SessionTicketStore::Ticket> SessionTicketStore::take(const ByteArray& id)
+{
+    const Clock::time_point now = Clock::now();
+    removeExpired(now);
+
+    auto it = tickets_.find(toStdString(id));
+    if (it == tickets_.end())
+        return std::nullopt;
+
+    Ticket ticket = std::move(it->second.ticket);
+    tickets_.erase(it);
+    return ticket;
+}
+
+void SessionTicketStore::removeExpired(Clock::time_point now)
+{
+    while (!order_.empty() && order_.front().first <= now)
+    {
+        auto it = tickets_.find(order_.front().second);
+
+        // The ticket could be taken and then added again with the same identifier.
+        if (it != tickets_.end() && it->second.expire_time <= now)
+            tickets_.erase(it);
+
+        order_.pop_front();
+    }
+
+    // Drop the identifiers of the taken tickets if they pile up.
+    if (order_.size() > 2 * max_count_)
+    {
+        std::deque<std::pair<Clock::time_point, std::string>> order;
+        for (auto& item : order_)
+        {
+            if (tickets_.count(item.second))
+                order.emplace_back(std::move(item));
+        }
+        order_.swap(order);
+    }
+}
+
+} // namespace base
@@ -0,0 +1,100 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef BASE_PEER_SESSION_TICKET_STORE_H
+#define BASE_PEER_SESSION_TICKET_STORE_H
+
+#include "base/macros_magic.h"
+#include "base/version.h"
+#include "base/memory/byte_array.h"
+#include "proto/key_exchange.pb.h"
+
+#include <chrono>
+#include <deque>
+#include <optional>
+#include <unordered_map>
+
+namespace base {
+
+// Keeps the sessions that were authenticated recently, so that a client that reconnects after a
+// short network failure can resume its session without the key exchange and SRP calculations.
+// Not thread-safe, the store is used on the task runner of the authenticators.
+class SessionTicketStore
+{
+public:
+    struct Ticket
+    {
+        ByteArray session_key;
+        proto::Encryption encryption = proto::ENCRYPTION_UNKNOWN;
+        proto::Identify identify = proto::IDENTIFY_SRP;
+        std::string user_name;
+
+        // SRP verifier of the user at the time of the authentication. The ticket is not accepted
+        // if the password of the user has been changed since then.
+        ByteArray verifier;
+
+        uint32_t session_type = 0;
+        Version version;
+        std::string os_name;
+        std::string computer_name;
+    };
+
+    static const size_t kIdSize = 32;
+    static const size_t kDefaultMaxCount = 10000;
+
+    explicit SessionTicketStore(std::chrono::seconds lifetime,
+                                size_t max_count = kDefaultMaxCount);
+    ~SessionTicketStore();
+
+    // Creates a random identifier for a new ticket.
+    static ByteArray createId();
+
+    // Adds a ticket. If the store is full, the oldest ticket is removed.
+    void add(const ByteArray& id, Ticket&& ticket);
+
+    // Removes the ticket and returns it. Returns std::nullopt if there is no such ticket or it has
+    // expired.
+    std::optional<Ticket> take(const ByteArray& id);
+
+    size_t count() const { return tickets_.size(); }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry
+    {
+        Ticket ticket;
+        Clock::time_point expire_time;
+    };
+
+    void removeExpired(Clock::time_point now);
+
+    const std::chrono::seconds lifetime_;
+    const size_t max_count_;
+
+    std::unordered_map<std::string, Entry> tickets_;
+
+    // Identifiers in the order of addition. All tickets have the same lifetime, so this is also the
+    // order of expiration. The identifiers of the taken tickets are removed lazily.
+    std::deque<std::pair<Clock::time_point, std::string>> order_;
+
+    DISALLOW_COPY_AND_ASSIGN(SessionTicketStore);
+};
+
+} // namespace base
+
+#endif // BASE_PEER_SESSION_TICKET_STORE_H
@@ -0,0 +1,60 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/peer/srp_verifier_cache.h"
+
+#include "base/logging.h"
+
+namespace base {
+
+SrpVerifierCache::SrpVerifierCache(size_t max_count)
+    : max_count_(max_count)
+{
+    DCHECK_GT(max_count_, 0u);
+}
+
+SrpVerifierCache::~SrpVerifierCache() = default;
+
+std::optional<ByteArray> SrpVerifierCache::find(const ByteArray& salt) const
+{
+    auto it = verifiers_.find(toStdString(salt));
+    if (it == verifiers_.end())
+        return std::nullopt;
+
+    return it->second;
+}
+
+void SrpVerifierCache::add(const ByteArray& salt, const ByteArray& verifier)
+{
+    if (salt.empty() || verifier.empty())
+        return;
+
+    std::string key = toStdString(salt);
+    if (verifiers_.find(key) != verifiers_.end())
+        return;
+
+    while (verifiers_.size() >= max_count_ && !order_.empty())
+    {
+        verifiers_.erase(order_.front());
+        order_.pop_front();
+    }
+
+    verifiers_.emplace(key, verifier);
+    order_.emplace_back(std::move(key));
+}
+
+} // namespace base
@@ -0,0 +1,63 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef BASE_PEER_SRP_VERIFIER_CACHE_H
+#define BASE_PEER_SRP_VERIFIER_CACHE_H
+
+#include "base/macros_magic.h"
+#include "base/memory/byte_array.h"
+
+#include <deque>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace base {
+
+// Keeps the SRP verifiers that the server calculates for unknown users. The verifier of an
+// unknown user depends only on the user name and the seed key, so repeated attempts with the same
+// name do not need the expensive calculation again.
+// Not thread-safe, the cache is used on the task runner of the authenticators.
+class SrpVerifierCache
+{
+public:
+    static const size_t kDefaultMaxCount = 4096;
+
+    explicit SrpVerifierCache(size_t max_count = kDefaultMaxCount);
+    ~SrpVerifierCache();
+
+    // |salt| is the salt calculated from the seed key and the user name. It identifies the
+    // verifier.
+    std::optional<ByteArray> find(const ByteArray& salt) const;
+
+    // Adds a verifier. If the cache is full, the oldest verifier is removed.
+    void add(const ByteArray& salt, const ByteArray& verifier);
+
+    size_t count() const { return verifiers_.size(); }
+
+private:
+    const size_t max_count_;
+
+    std::unordered_map<std::string, ByteArray> verifiers_;
+    std::deque<std::string> order_;
+
+    DISALLOW_COPY_AND_ASSIGN(SrpVerifierCache);
+};
+
+} // namespace base
+
+#endif // BASE_PEER_SRP_VERIFIER_CACHE_H
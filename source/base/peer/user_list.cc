@@ -28,7 +28,10 @@ UserList::UserList(const std::vector<User>& list, const ByteArray& seed_key)
     : seed_key_(seed_key),
       list_(list)
 {
-    // Nothing
+    index_.reserve(list_.size());
+
+    for (size_t i = 0; i < list_.size(); ++i)
+        addToIndex(i);
 }
 
 UserList::~UserList() = default;
@@ -46,27 +49,28 @@ std::unique_ptr<UserList> UserList::duplicate() const
 
 void UserList::add(const User& user)
 {
-    if (user.isValid())
-        list_.emplace_back(user);
+    if (!user.isValid())
+        return;
+
+    list_.emplace_back(user);
+    addToIndex(list_.size() - 1);
 }
 
 void UserList::merge(const UserList& user_list)
 {
+    list_.reserve(list_.size() + user_list.list_.size());
+
     for (const auto& user : user_list.list_)
         add(user);
 }
 
 User UserList::find(std::u16string_view username) const
 {
-    const User* user = &User::kInvalidUser;
-
-    for (const auto& item : list_)
-    {
-        if (compareCaseInsensitive(username, item.name) == 0)
-            user = &item;
-    }
+    auto it = index_.find(toLower(username));
+    if (it == index_.end())
+        return User::kInvalidUser;
 
-    return *user;
+    return list_[it->second];
 }
 
 void UserList::setSeedKey(const ByteArray& seed_key)
@@ -74,4 +78,9 @@ void UserList::setSeedKey(const ByteArray& seed_key)
     seed_key_ = seed_key;
 }
 
+void UserList::addToIndex(size_t index)
+{
+    index_.insert_or_assign(toLower(list_[index].name), index);
+}
+
 } // namespace base
@@ -22,6 +22,8 @@
 #include "base/macros_magic.h"
 #include "base/peer/user_list_base.h"
 
+#include <unordered_map>
+
 namespace base {
 
 class UserList : public UserListBase
@@ -44,9 +46,15 @@ private:
     UserList();
     UserList(const std::vector<User>& list, const ByteArray& seed_key);
 
+    void addToIndex(size_t index);
+
     ByteArray seed_key_;
     std::vector<User> list_;
 
+    // Lowercase user name to the index in |list_|. If there are several users with the same name,
+    // the last one is used.
+    std::unordered_map<std::u16string, size_t> index_;
+
     DISALLOW_COPY_AND_ASSIGN(UserList);
 };
 
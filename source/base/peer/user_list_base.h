@@ -21,6 +21,8 @@
 
 #include "base/peer/user.h"
 
+#include <functional>
+
 namespace base {
 
 class UserListBase
@@ -30,6 +32,16 @@ public:
 
     virtual void add(const User& user) = 0;
     virtual User find(std::u16string_view username) const = 0;
+
+    using FindCallback = std::function<void(const User& user)>;
+
+    // Calls |callback| with the result of find(). Lists that are backed by a database may call it
+    // later on the thread of the caller, so the caller does not wait for the database.
+    virtual void findAsync(std::u16string_view username, FindCallback callback) const
+    {
+        callback(find(username));
+    }
+
     virtual const ByteArray& seedKey() const = 0;
     virtual void setSeedKey(const ByteArray& seed_key) = 0;
     virtual std::vector<User> list() const = 0;
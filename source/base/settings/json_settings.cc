@@ -147,11 +147,23 @@ bool JsonSettings::isWritable() const
     }
 }
 
-void JsonSettings::sync()
+bool JsonSettings::sync()
 {
+    // If there are no local changes and the file has not been changed since the last read or
+    // write, then there is nothing to parse.
+    if (!isChanged() && !file_buffer_.empty())
+    {
+        std::string file_buffer;
+        if (base::readFile(path_, &file_buffer) && file_buffer == file_buffer_)
+            return false;
+    }
+
+    Map previous_map;
+    previous_map.swap(map());
+
     for (int i = 0; i < 3; ++i)
     {
-        if (readFile(path_, map(), encrypted_))
+        if (readFile(path_, map(), encrypted_, &file_buffer_))
         {
             if (backups_ == Backups::NO)
                 break;
@@ -210,6 +222,7 @@ void JsonSettings::sync()
     }
 
     setChanged(false);
+    return map() != previous_map;
 }
 
 bool JsonSettings::flush()
@@ -222,16 +235,20 @@ bool JsonSettings::flush()
     }
 
     // Before writing the configuration file, make a backup copy.
-    if (backups_ == Backups::YES && !map().empty())
+    if (backups_ == Backups::YES && !is_backup_updated_ && !map().empty())
     {
         if (!createBackupFor(path_))
         {
             LOG(LS_WARNING) << "createBackupFor failed for: " << path_;
         }
+        else
+        {
+            is_backup_updated_ = true;
+        }
     }
 
     // Write to the configuration file.
-    if (writeFile(path_, map(), encrypted_))
+    if (writeFile(path_, map(), encrypted_, &file_buffer_))
     {
         LOG(LS_INFO) << "Configuration file '" << path_ << "' successfully written to disk";
         setChanged(false);
@@ -297,17 +314,23 @@ std::filesystem::path JsonSettings::filePath(Scope scope,
 }
 
 // static
-bool JsonSettings::readFile(const std::filesystem::path& file, Map& map, Encrypted encrypted)
+bool JsonSettings::readFile(const std::filesystem::path& file,
+                            Map& map,
+                            Encrypted encrypted,
+                            std::string* file_buffer)
 {
     map.clear();
 
+    if (file_buffer)
+        file_buffer->clear();
+
     std::error_code ignored_code;
     std::filesystem::file_status status = std::filesystem::status(file, ignored_code);
 
     if (!std::filesystem::exists(status))
     {
         // If the configuration file does not yet exist, then we write an empty file.
-        writeFile(file, map, encrypted);
+        writeFile(file, map, encrypted, file_buffer);
 
         // The absence of a configuration file is normal case.
         return true;
@@ -341,19 +364,19 @@ bool JsonSettings::readFile(const std::filesystem::path& file, Map& map, Encrypt
         return false;
     }
 
+    std::string decrypted;
+
     if (encrypted == Encrypted::YES)
     {
-        std::string decrypted;
         if (!OSCrypt::decryptString(buffer, &decrypted))
         {
             LOG(LS_ERROR) << "Failed to decrypt config file: '" << file << "'";
             return false;
         }
-
-        buffer.swap(decrypted);
     }
 
-    rapidjson::StringStream stream(buffer.data());
+    rapidjson::StringStream stream(
+        encrypted == Encrypted::YES ? decrypted.c_str() : buffer.c_str());
     rapidjson::Document doc;
     doc.ParseStream(stream);
 
@@ -367,12 +390,21 @@ bool JsonSettings::readFile(const std::filesystem::path& file, Map& map, Encrypt
     std::vector<std::string_view> segments;
     parseObject(doc, &segments, &map);
 
+    if (file_buffer)
+        file_buffer->swap(buffer);
+
     return true;
 }
 
 // static
-bool JsonSettings::writeFile(const std::filesystem::path& file, const Map& map, Encrypted encrypted)
+bool JsonSettings::writeFile(const std::filesystem::path& file,
+                             const Map& map,
+                             Encrypted encrypted,
+                             std::string* file_buffer)
 {
+    if (file_buffer)
+        file_buffer->clear();
+
     std::error_code error_code;
     if (!std::filesystem::create_directories(file.parent_path(), error_code))
     {
@@ -454,6 +486,9 @@ bool JsonSettings::writeFile(const std::filesystem::path& file, const Map& map,
             LOG(LS_ERROR) << "Failed to write config file";
             return false;
         }
+
+        if (file_buffer)
+            file_buffer->swap(cipher_buffer);
     }
     else
     {
@@ -464,6 +499,9 @@ bool JsonSettings::writeFile(const std::filesystem::path& file, const Map& map,
             LOG(LS_ERROR) << "Failed to write config file";
             return false;
         }
+
+        if (file_buffer)
+            file_buffer->assign(source_buffer);
     }
 
     return true;
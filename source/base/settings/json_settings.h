@@ -44,7 +44,12 @@ public:
     ~JsonSettings() override;
 
     bool isWritable() const;
-    void sync();
+
+    // Re-reads the settings from the file. If the file content is the same as it was during the
+    // previous read or write, the parsing is skipped. Returns true if any value has changed.
+    bool sync();
+
+    // Writes the settings to the file if any value has changed since the last sync or flush.
     bool flush();
 
     const std::filesystem::path& filePath() const { return path_; }
@@ -54,12 +59,16 @@ public:
                                           std::string_view application_name,
                                           std::string_view file_name);
 
+    // If |file_buffer| is not null, it receives the content of the file as it is stored on disk
+    // (encrypted, if encryption is used).
     static bool readFile(const std::filesystem::path& file,
                          Map& map,
-                         Encrypted encrypted = Encrypted::NO);
+                         Encrypted encrypted = Encrypted::NO,
+                         std::string* file_buffer = nullptr);
     static bool writeFile(const std::filesystem::path& file,
                           const Map& map,
-                          Encrypted encrypted = Encrypted::NO);
+                          Encrypted encrypted = Encrypted::NO,
+                          std::string* file_buffer = nullptr);
 
     static std::filesystem::path backupFilePathFor(const std::filesystem::path& source_file_path);
     static bool hasBackupFor(const std::filesystem::path& source_file_path);
@@ -73,6 +82,13 @@ private:
     const Backups backups_;
     std::filesystem::path path_;
 
+    // Content of the file after the last successful read or write.
+    std::string file_buffer_;
+
+    // The backup copy is updated only before the first write. Subsequent writes do not change the
+    // last known good state of the file.
+    bool is_backup_updated_ = false;
+
     DISALLOW_COPY_AND_ASSIGN(JsonSettings);
 };
 
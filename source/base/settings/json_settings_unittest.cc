@@ -113,6 +113,55 @@ TEST(JsonSettingsTest, SettingsTest)
     EXPECT_TRUE(ret);
 }
 
+TEST(JsonSettingsTest, SyncChanges)
+{
+    std::unique_ptr<JsonSettings> settings =
+        std::make_unique<JsonSettings>(JsonSettings::Scope::USER, "test", "temp.json");
+
+    settings->set<uint32_t>("TcpPort", 8050);
+    settings->set<std::string>("Group/Name", "user1");
+    EXPECT_TRUE(settings->flush());
+
+    // The file was not changed after the flush.
+    EXPECT_FALSE(settings->sync());
+    EXPECT_EQ(settings->get<uint32_t>("TcpPort"), 8050u);
+
+    // Another instance writes the same values.
+    {
+        JsonSettings other(JsonSettings::Scope::USER, "test", "temp.json");
+        other.set<uint32_t>("TcpPort", 8050);
+        other.remove("Unknown");
+    }
+
+    EXPECT_FALSE(settings->sync());
+
+    // Another instance changes a value.
+    {
+        JsonSettings other(JsonSettings::Scope::USER, "test", "temp.json");
+        other.set<uint32_t>("TcpPort", 8060);
+    }
+
+    EXPECT_TRUE(settings->sync());
+    EXPECT_EQ(settings->get<uint32_t>("TcpPort"), 8060u);
+    EXPECT_EQ(settings->get<std::string>("Group/Name"), "user1");
+    EXPECT_FALSE(settings->sync());
+
+    // Another instance removes a value.
+    {
+        JsonSettings other(JsonSettings::Scope::USER, "test", "temp.json");
+        other.remove("Group");
+    }
+
+    EXPECT_TRUE(settings->sync());
+    EXPECT_TRUE(settings->get<std::string>("Group/Name").empty());
+
+    std::filesystem::path file_path = settings->filePath();
+    settings.reset();
+
+    bool ret = removeFile(file_path);
+    EXPECT_TRUE(ret);
+}
+
 TEST(JsonSettingsTest, DISABLED_Performance)
 {
     std::unique_ptr<JsonSettings> settings =
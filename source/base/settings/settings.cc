@@ -93,9 +93,7 @@ void Settings::setGroup(std::string_view key, const Settings& group)
     const Map& array_map = group.constMap();
 
     for (auto it = array_map.cbegin(); it != array_map.cend(); ++it)
-        map_.insert_or_assign(strCat({ key, kSeparator, it->first }), it->second);
-
-    setChanged(true);
+        setValue(strCat({ key, kSeparator, it->first }), std::string(it->second));
 }
 
 void Settings::remove(std::string_view key)
@@ -105,9 +103,30 @@ void Settings::remove(std::string_view key)
     for (auto it = map_.begin(); it != map_.end();)
     {
         if (startsWith(it->first, prefix))
+        {
             it = map_.erase(it);
+            setChanged(true);
+        }
         else
+        {
             ++it;
+        }
+    }
+}
+
+void Settings::setValue(std::string_view key, std::string&& value)
+{
+    Map::iterator result = map_.find(key);
+    if (result != map_.end())
+    {
+        if (result->second == value)
+            return;
+
+        result->second = std::move(value);
+    }
+    else
+    {
+        map_.emplace(std::string(key), std::move(value));
     }
 
     setChanged(true);
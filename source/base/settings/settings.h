@@ -82,11 +82,11 @@ public:
         return Converter<T>::get_value(result->second).value_or(default_value);
     }
 
+    // The settings are marked as changed only if the stored value is actually different.
     template <typename T>
     void set(std::string_view key, const T& value)
     {
-        map_.insert_or_assign(std::string(key), Converter<T>::set_value(value));
-        setChanged(true);
+        setValue(key, Converter<T>::set_value(value));
     }
 
     Array getArray(std::string_view key) const;
@@ -105,6 +105,8 @@ protected:
     void setChanged(bool is_changed) { is_changed_ = is_changed; }
 
 private:
+    void setValue(std::string_view key, std::string&& value);
+
     bool is_changed_ = false;
     Map map_;
 };
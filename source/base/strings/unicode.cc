@@ -20,6 +20,12 @@
 
 #include "base/logging.h"
 
+#include <cstring>
+
+#if defined(ARCH_CPU_X86_FAMILY)
+#include <emmintrin.h>
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
 #if defined(OS_WIN)
 #include <Windows.h>
 #endif // defined(OS_WIN)
@@ -33,6 +39,112 @@ namespace base {
 
 namespace {
 
+// Most of the converted strings (paths, user names, addresses, log messages) contain only ASCII
+// characters. They are converted without the system converters. If a non-ASCII character is found,
+// false is returned and the string must be converted (and validated) by the system converter.
+template <class OutputString>
+bool convertAsciiToUtf16(std::string_view in, OutputString* out)
+{
+    static_assert(sizeof(typename OutputString::value_type) == sizeof(uint16_t));
+
+    const size_t size = in.size();
+    out->resize(size);
+
+    const uint8_t* src = reinterpret_cast<const uint8_t*>(in.data());
+    uint16_t* dst = reinterpret_cast<uint16_t*>(out->data());
+    size_t i = 0;
+
+#if defined(ARCH_CPU_X86_FAMILY)
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; i + 16 <= size; i += 16)
+    {
+        const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+
+        // All bytes of multibyte sequences have the high bit set.
+        if (_mm_movemask_epi8(value))
+            return false;
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi8(value, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8), _mm_unpackhi_epi8(value, zero));
+    }
+#else
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t value;
+        memcpy(&value, src + i, sizeof(value));
+
+        if (value & 0x8080808080808080ULL)
+            return false;
+
+        for (size_t j = 0; j < 8; ++j)
+            dst[i + j] = src[i + j];
+    }
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+    for (; i < size; ++i)
+    {
+        if (src[i] & 0x80)
+            return false;
+
+        dst[i] = src[i];
+    }
+
+    return true;
+}
+
+template <class InputString>
+bool convertUtf16ToAscii(InputString in, std::string* out)
+{
+    static_assert(sizeof(typename InputString::value_type) == sizeof(uint16_t));
+
+    const size_t size = in.size();
+    out->resize(size);
+
+    const uint16_t* src = reinterpret_cast<const uint16_t*>(in.data());
+    uint8_t* dst = reinterpret_cast<uint8_t*>(out->data());
+    size_t i = 0;
+
+#if defined(ARCH_CPU_X86_FAMILY)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i non_ascii_mask = _mm_set1_epi16(static_cast<int16_t>(0xFF80));
+
+    for (; i + 16 <= size; i += 16)
+    {
+        const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8));
+        const __m128i non_ascii = _mm_and_si128(_mm_or_si128(low, high), non_ascii_mask);
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(non_ascii, zero)) != 0xFFFF)
+            return false;
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(low, high));
+    }
+#else
+    for (; i + 4 <= size; i += 4)
+    {
+        uint64_t value;
+        memcpy(&value, src + i, sizeof(value));
+
+        if (value & 0xFF80FF80FF80FF80ULL)
+            return false;
+
+        for (size_t j = 0; j < 4; ++j)
+            dst[i + j] = static_cast<uint8_t>(src[i + j]);
+    }
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+    for (; i < size; ++i)
+    {
+        if (src[i] >= 0x80)
+            return false;
+
+        dst[i] = static_cast<uint8_t>(src[i]);
+    }
+
+    return true;
+}
+
 #if defined(OS_WIN)
 
 template <class InputType>
@@ -193,12 +305,12 @@ bool utf8ToUtf16Impl(std::string_view in, std::u16string* out)
 
 bool utf16ToLocalImpl(std::u16string_view in, std::string* out)
 {
-    return utf16ToUtf8Impl(in, out);
+    return utf16ToUtf8(in, out);
 }
 
 bool localToUtf16Impl(std::string_view in, std::u16string* out)
 {
-    return utf8ToUtf16Impl(in, out);
+    return utf8ToUtf16(in, out);
 }
 
 #endif
@@ -219,6 +331,9 @@ OutputString asciiConverter(InputString in)
 
 bool utf16ToUtf8(std::u16string_view in, std::string* out)
 {
+    if (convertUtf16ToAscii(in, out))
+        return true;
+
 #if defined(WCHAR_T_IS_UTF16)
     return wideToUtf8Impl(in, out);
 #else
@@ -228,6 +343,9 @@ bool utf16ToUtf8(std::u16string_view in, std::string* out)
 
 bool utf8ToUtf16(std::string_view in, std::u16string* out)
 {
+    if (convertAsciiToUtf16(in, out))
+        return true;
+
 #if defined(WCHAR_T_IS_UTF16)
     return utf8ToWideImpl(in, out);
 #else
@@ -253,11 +371,17 @@ std::string utf8FromUtf16(std::u16string_view in)
 
 bool wideToUtf8(std::wstring_view in, std::string* out)
 {
+    if (convertUtf16ToAscii(in, out))
+        return true;
+
     return wideToUtf8Impl(in, out);
 }
 
 bool utf8ToWide(std::string_view in, std::wstring* out)
 {
+    if (convertAsciiToUtf16(in, out))
+        return true;
+
     return utf8ToWideImpl(in, out);
 }
 
@@ -0,0 +1,125 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/strings/unicode.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+const int kTimesToRun = 1000000;
+
+// A typical path of a file list.
+const char kBenchmarkPath[] = "/home/user/Documents/projects/aspia/source/base/unicode.cc";
+
+std::string makeAsciiString(size_t length)
+{
+    std::string result;
+
+    for (size_t i = 0; i < length; ++i)
+        result += static_cast<char>(0x20 + (i % 0x5F));
+
+    return result;
+}
+
+} // namespace
+
+TEST(unicode_test, ascii)
+{
+    EXPECT_EQ(utf16FromUtf8(""), u"");
+    EXPECT_EQ(utf8FromUtf16(u""), "");
+
+    // The lengths cover the vectorized blocks and the tails.
+    for (size_t length = 1; length < 100; ++length)
+    {
+        const std::string utf8 = makeAsciiString(length);
+        const std::u16string utf16 = utf16FromAscii(utf8);
+
+        std::u16string utf16_result;
+        ASSERT_TRUE(utf8ToUtf16(utf8, &utf16_result));
+        EXPECT_EQ(utf16_result, utf16);
+
+        std::string utf8_result;
+        ASSERT_TRUE(utf16ToUtf8(utf16, &utf8_result));
+        EXPECT_EQ(utf8_result, utf8);
+    }
+}
+
+TEST(unicode_test, non_ascii)
+{
+    const std::string kUtf8 = "C:\\Users\\\xD0\x9F\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82\\"
+                              "\xE6\x96\x87\xE4\xBB\xB6\\\xF0\x9F\x98\x80.txt";
+    const std::u16string kUtf16 = u"C:\\Users\\\u041F\u0440\u0438\u0432\u0435\u0442\\"
+                                  u"\u6587\u4EF6\\\U0001F600.txt";
+
+    // A non-ASCII character at every position of the vectorized blocks.
+    for (size_t prefix_length = 0; prefix_length < 40; ++prefix_length)
+    {
+        const std::string prefix = makeAsciiString(prefix_length);
+
+        EXPECT_EQ(utf16FromUtf8(prefix + kUtf8), utf16FromAscii(prefix) + kUtf16);
+        EXPECT_EQ(utf8FromUtf16(utf16FromAscii(prefix) + kUtf16), prefix + kUtf8);
+    }
+
+    // Characters that are out of the ASCII range only in the high byte.
+    EXPECT_EQ(utf8FromUtf16(u"0123456789ABCDE\u0141"), "0123456789ABCDE\xC5\x81");
+    EXPECT_EQ(utf8FromUtf16(u"\u0100"), "\xC4\x80");
+}
+
+TEST(unicode_test, invalid)
+{
+    const std::string prefix = makeAsciiString(35);
+
+    std::u16string utf16;
+    EXPECT_FALSE(utf8ToUtf16(prefix + "\xFF", &utf16));
+    EXPECT_FALSE(utf8ToUtf16(prefix + "\xD0", &utf16));
+    EXPECT_FALSE(utf8ToUtf16("\x80" + prefix, &utf16));
+
+    std::string utf8;
+    EXPECT_FALSE(utf16ToUtf8(utf16FromAscii(prefix) + u'\xD800', &utf8));
+    EXPECT_FALSE(utf16ToUtf8(u'\xDC00' + utf16FromAscii(prefix), &utf8));
+}
+
+TEST(unicode_test, DISABLED_benchmark)
+{
+    const std::string path = kBenchmarkPath;
+    const std::u16string utf16_path = utf16FromUtf8(path);
+
+    for (int i = 0; i < kTimesToRun; ++i)
+    {
+        EXPECT_FALSE(utf16FromUtf8(path).empty());
+        EXPECT_FALSE(utf8FromUtf16(utf16_path).empty());
+    }
+}
+
+// The same path with a non-ASCII file name, which is converted by the system converter.
+TEST(unicode_test, DISABLED_benchmark_non_ascii)
+{
+    const std::string path = std::string(kBenchmarkPath) + "\xD0\xAF";
+    const std::u16string utf16_path = utf16FromUtf8(path);
+
+    for (int i = 0; i < kTimesToRun; ++i)
+    {
+        EXPECT_FALSE(utf16FromUtf8(path).empty());
+        EXPECT_FALSE(utf8FromUtf16(utf16_path).empty());
+    }
+}
+
+} // namespace base
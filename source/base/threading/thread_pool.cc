@@ -0,0 +1,380 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/threading/thread_pool.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+#include "build/build_config.h"
+
+#include <algorithm>
+#include <bitset>
+
+#if defined(OS_WIN)
+#include <Windows.h>
+#elif defined(OS_LINUX)
+#include <sched.h>
+#endif
+
+namespace base {
+
+namespace {
+
+thread_local const ThreadPool* t_current_pool = nullptr;
+thread_local size_t t_worker_index = 0;
+
+} // namespace
+
+class ThreadPool::PoolTaskRunner : public TaskRunner
+{
+public:
+    explicit PoolTaskRunner(ThreadPool* pool)
+        : pool_(pool)
+    {
+        // Nothing
+    }
+
+    // The tasks posted after the destruction of the pool are dropped.
+    void detach()
+    {
+        std::scoped_lock lock(lock_);
+        pool_ = nullptr;
+    }
+
+    // TaskRunner implementation.
+    bool belongsToCurrentThread() const override
+    {
+        std::scoped_lock lock(lock_);
+        return pool_ && pool_->belongsToCurrentThread();
+    }
+
+    void postTask(Callback task) override
+    {
+        std::scoped_lock lock(lock_);
+        if (pool_)
+            pool_->postTask(std::move(task));
+    }
+
+    void postDelayedTask(Callback callback, const Milliseconds& delay) override
+    {
+        std::scoped_lock lock(lock_);
+        if (pool_)
+            pool_->postDelayedTask(std::move(callback), delay);
+    }
+
+    void postNonNestableTask(Callback callback) override
+    {
+        postTask(std::move(callback));
+    }
+
+    void postNonNestableDelayedTask(Callback callback, const Milliseconds& delay) override
+    {
+        postDelayedTask(std::move(callback), delay);
+    }
+
+    void postQuit() override
+    {
+        // The threads of the pool are stopped only by its destruction.
+    }
+
+private:
+    mutable std::mutex lock_;
+    ThreadPool* pool_;
+
+    DISALLOW_COPY_AND_ASSIGN(PoolTaskRunner);
+};
+
+ThreadPool::ThreadPool(int thread_count)
+{
+    if (thread_count <= 0)
+        thread_count = availableProcessors();
+
+    LOG(LS_INFO) << "Ctor (threads: " << thread_count << ")";
+
+    for (int i = 0; i < thread_count; ++i)
+        workers_.emplace_back(std::make_unique<Worker>());
+
+    for (int i = 0; i < thread_count; ++i)
+        threads_.emplace_back(&ThreadPool::threadMain, this, static_cast<size_t>(i));
+}
+
+ThreadPool::~ThreadPool()
+{
+    LOG(LS_INFO) << "Dtor";
+
+    if (task_runner_)
+        task_runner_->detach();
+
+    {
+        std::scoped_lock lock(lock_);
+        terminate_ = true;
+    }
+
+    event_.notify_all();
+
+    for (auto& thread : threads_)
+        thread.join();
+}
+
+// static
+ThreadPool* ThreadPool::shared()
+{
+    // The pool is never destroyed, so the tasks can be posted until the end of the process.
+    static ThreadPool* pool = new ThreadPool();
+    return pool;
+}
+
+// static
+int ThreadPool::availableProcessors()
+{
+    int count = 0;
+
+#if defined(OS_WIN)
+    DWORD_PTR process_mask = 0;
+    DWORD_PTR system_mask = 0;
+
+    if (GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask))
+        count = static_cast<int>(std::bitset<sizeof(DWORD_PTR) * 8>(process_mask).count());
+#elif defined(OS_LINUX)
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+
+    if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0)
+        count = CPU_COUNT(&cpu_set);
+#endif
+
+    if (count <= 0)
+        count = static_cast<int>(std::thread::hardware_concurrency());
+
+    return std::max(count, 1);
+}
+
+void ThreadPool::postTask(Task task)
+{
+    if (t_current_pool == this)
+    {
+        Worker* worker = workers_[t_worker_index].get();
+
+        std::scoped_lock lock(worker->lock);
+        worker->tasks.emplace_back(std::move(task));
+    }
+    else
+    {
+        std::scoped_lock lock(lock_);
+        incoming_tasks_.emplace_back(std::move(task));
+    }
+
+    ++pending_;
+    wakeUp();
+}
+
+void ThreadPool::postDelayedTask(Task task, const Milliseconds& delay)
+{
+    {
+        std::scoped_lock lock(lock_);
+        delayed_tasks_.push(DelayedTask{ std::chrono::steady_clock::now() + delay,
+                                         delayed_sequence_++, std::move(task) });
+    }
+
+    // A sleeping thread has to wait for the new time.
+    event_.notify_one();
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t index)>& task)
+{
+    struct State
+    {
+        size_t count;
+        const std::function<void(size_t index)>* task;
+        std::atomic<size_t> next { 0 };
+        std::atomic<size_t> done { 0 };
+        std::mutex lock;
+        std::condition_variable event;
+    };
+
+    auto work = [](State* state)
+    {
+        size_t done = 0;
+
+        while (true)
+        {
+            const size_t index = state->next.fetch_add(1);
+            if (index >= state->count)
+                break;
+
+            (*state->task)(index);
+            ++done;
+        }
+
+        if (done && state->done.fetch_add(done) + done == state->count)
+        {
+            std::scoped_lock lock(state->lock);
+            state->event.notify_all();
+        }
+    };
+
+    if (!count)
+        return;
+
+    std::shared_ptr<State> state = std::make_shared<State>();
+    state->count = count;
+    state->task = &task;
+
+    // The helpers that start after all indexes are taken only return.
+    const size_t helper_count = std::min(count, threads_.size() + 1) - 1;
+    for (size_t i = 0; i < helper_count; ++i)
+        postTask([state, work]() { work(state.get()); });
+
+    work(state.get());
+
+    std::unique_lock lock(state->lock);
+    state->event.wait(lock, [&]() { return state->done == count; });
+}
+
+bool ThreadPool::belongsToCurrentThread() const
+{
+    return t_current_pool == this;
+}
+
+std::shared_ptr<TaskRunner> ThreadPool::taskRunner()
+{
+    std::scoped_lock lock(lock_);
+
+    if (!task_runner_)
+        task_runner_ = std::make_shared<PoolTaskRunner>(this);
+
+    return task_runner_;
+}
+
+void ThreadPool::threadMain(size_t index)
+{
+    t_current_pool = this;
+    t_worker_index = index;
+
+    while (true)
+    {
+        Task task;
+        if (!terminate_ && takeTask(index, &task))
+        {
+            task();
+            continue;
+        }
+
+        std::unique_lock lock(lock_);
+
+        if (terminate_)
+            break;
+
+        // The delayed tasks that are due are run as usual tasks.
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        bool has_due_tasks = false;
+
+        while (!delayed_tasks_.empty() && delayed_tasks_.top().time <= now)
+        {
+            incoming_tasks_.emplace_back(std::move(const_cast<Task&>(delayed_tasks_.top().task)));
+            delayed_tasks_.pop();
+            ++pending_;
+            has_due_tasks = true;
+        }
+
+        if (has_due_tasks)
+        {
+            if (!incoming_tasks_.empty())
+                event_.notify_one();
+            continue;
+        }
+
+        // The counter is checked after announcing the sleep, so a task posted at the same time
+        // wakes this thread up.
+        ++sleeping_;
+
+        if (pending_ == 0)
+        {
+            if (delayed_tasks_.empty())
+                event_.wait(lock);
+            else
+                event_.wait_until(lock, delayed_tasks_.top().time);
+        }
+
+        --sleeping_;
+    }
+
+    t_current_pool = nullptr;
+}
+
+bool ThreadPool::takeTask(size_t index, Task* task)
+{
+    auto take = [&](std::deque<Task>* tasks, bool from_back)
+    {
+        if (tasks->empty())
+            return false;
+
+        if (from_back)
+        {
+            *task = std::move(tasks->back());
+            tasks->pop_back();
+        }
+        else
+        {
+            *task = std::move(tasks->front());
+            tasks->pop_front();
+        }
+
+        --pending_;
+        return true;
+    };
+
+    // The own queue is processed from the end, so the related tasks run one after another.
+    {
+        Worker* worker = workers_[index].get();
+        std::scoped_lock lock(worker->lock);
+        if (take(&worker->tasks, true))
+            return true;
+    }
+
+    {
+        std::scoped_lock lock(lock_);
+        if (take(&incoming_tasks_, false))
+            return true;
+    }
+
+    // The oldest tasks are stolen from the other threads.
+    for (size_t i = 1; i < workers_.size(); ++i)
+    {
+        Worker* worker = workers_[(index + i) % workers_.size()].get();
+        std::scoped_lock lock(worker->lock);
+        if (take(&worker->tasks, false))
+            return true;
+    }
+
+    return false;
+}
+
+void ThreadPool::wakeUp()
+{
+    if (sleeping_ == 0)
+        return;
+
+    {
+        // The sleeping thread either has not checked the counter yet or waits already.
+        std::scoped_lock lock(lock_);
+    }
+
+    event_.notify_one();
+}
+
+} // namespace base
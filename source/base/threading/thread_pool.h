@@ -0,0 +1,125 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef BASE_THREADING_THREAD_POOL_H
+#define BASE_THREADING_THREAD_POOL_H
+
+#include "base/macros_magic.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace base {
+
+class TaskRunner;
+
+// Pool of threads for independent tasks. Each thread has its own queue. The tasks posted from a
+// thread of the pool go to its queue, and the idle threads take the tasks from the queues of the
+// other threads. The tasks can run in parallel and in any order.
+class ThreadPool
+{
+public:
+    using Task = std::function<void()>;
+    using Milliseconds = std::chrono::milliseconds;
+
+    // If |thread_count| is zero, then the pool has one thread per processor available to the
+    // process.
+    explicit ThreadPool(int thread_count = 0);
+
+    // Waits until the running tasks are finished. The queued tasks are not run.
+    ~ThreadPool();
+
+    // The pool shared by all components of the process. It is created on first use.
+    static ThreadPool* shared();
+
+    // Number of processors on which the threads of the process can run.
+    static int availableProcessors();
+
+    int threadCount() const { return static_cast<int>(threads_.size()); }
+
+    void postTask(Task task);
+    void postDelayedTask(Task task, const Milliseconds& delay);
+
+    // Calls |task| for each index in range [0; count) and returns when all calls are finished. The
+    // calling thread also takes part. It can be called from a task of the pool.
+    void parallelFor(size_t count, const std::function<void(size_t index)>& task);
+
+    // Returns true if the current thread belongs to the pool.
+    bool belongsToCurrentThread() const;
+
+    // The task runner posts the tasks to the pool. The tasks are not sequenced and postQuit() has
+    // no effect.
+    std::shared_ptr<TaskRunner> taskRunner();
+
+private:
+    class PoolTaskRunner;
+
+    struct Worker
+    {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    struct DelayedTask
+    {
+        std::chrono::steady_clock::time_point time;
+        uint64_t sequence;
+        Task task;
+
+        bool operator<(const DelayedTask& other) const
+        {
+            // The earliest task is on top of the queue.
+            if (time != other.time)
+                return time > other.time;
+            return sequence > other.sequence;
+        }
+    };
+
+    void threadMain(size_t index);
+    bool takeTask(size_t index, Task* task);
+    void wakeUp();
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+
+    // The tasks posted from other threads.
+    std::mutex lock_;
+    std::condition_variable event_;
+    std::deque<Task> incoming_tasks_;
+    std::priority_queue<DelayedTask> delayed_tasks_;
+    uint64_t delayed_sequence_ = 0;
+    std::atomic_bool terminate_ { false };
+
+    std::atomic<size_t> pending_ { 0 };
+    std::atomic<int> sleeping_ { 0 };
+
+    std::shared_ptr<PoolTaskRunner> task_runner_;
+
+    DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+};
+
+} // namespace base
+
+#endif // BASE_THREADING_THREAD_POOL_H
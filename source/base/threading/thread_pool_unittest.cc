@@ -0,0 +1,249 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/threading/thread_pool.h"
+
+#include "base/task_runner.h"
+
+#include <future>
+#include <set>
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+const std::chrono::seconds kWaitTimeout { 10 };
+
+} // namespace
+
+TEST(ThreadPoolTest, PostTask)
+{
+    ThreadPool pool(4);
+    EXPECT_EQ(pool.threadCount(), 4);
+    EXPECT_FALSE(pool.belongsToCurrentThread());
+
+    const int kTaskCount = 1000;
+    std::atomic<int> count { 0 };
+    std::promise<void> done;
+
+    for (int i = 0; i < kTaskCount; ++i)
+    {
+        pool.postTask([&]()
+        {
+            EXPECT_TRUE(pool.belongsToCurrentThread());
+
+            if (++count == kTaskCount)
+                done.set_value();
+        });
+    }
+
+    ASSERT_EQ(done.get_future().wait_for(kWaitTimeout), std::future_status::ready);
+    EXPECT_EQ(count, kTaskCount);
+}
+
+TEST(ThreadPoolTest, PostTaskOrder)
+{
+    // With one thread the tasks posted from outside of the pool run in the order of posting.
+    ThreadPool pool(1);
+
+    std::vector<int> order;
+    std::promise<void> done;
+
+    for (int i = 0; i < 100; ++i)
+        pool.postTask([&order, i]() { order.emplace_back(i); });
+
+    pool.postTask([&]() { done.set_value(); });
+
+    ASSERT_EQ(done.get_future().wait_for(kWaitTimeout), std::future_status::ready);
+    ASSERT_EQ(order.size(), 100U);
+
+    for (int i = 0; i < 100; ++i)
+        EXPECT_EQ(order[static_cast<size_t>(i)], i);
+}
+
+TEST(ThreadPoolTest, Stealing)
+{
+    ThreadPool pool(4);
+
+    const int kTaskCount = 100;
+    std::atomic<int> count { 0 };
+    std::promise<void> done;
+    std::promise<std::thread::id> owner_id;
+    std::mutex lock;
+    std::set<std::thread::id> thread_ids;
+
+    // All tasks are posted to the queue of one thread, which is busy until they are finished. The
+    // other threads must take them.
+    pool.postTask([&]()
+    {
+        owner_id.set_value(std::this_thread::get_id());
+
+        for (int i = 0; i < kTaskCount; ++i)
+        {
+            pool.postTask([&]()
+            {
+                {
+                    std::scoped_lock scoped_lock(lock);
+                    thread_ids.insert(std::this_thread::get_id());
+                }
+
+                if (++count == kTaskCount)
+                    done.set_value();
+            });
+        }
+
+        done.get_future().wait_for(kWaitTimeout);
+    });
+
+    std::thread::id owner = owner_id.get_future().get();
+
+    // The future of |done| is taken by the owner task, so the counter is polled.
+    const std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + kWaitTimeout;
+    while (count < kTaskCount && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    ASSERT_EQ(count, kTaskCount);
+
+    std::scoped_lock scoped_lock(lock);
+    EXPECT_FALSE(thread_ids.empty());
+    EXPECT_EQ(thread_ids.count(owner), 0U);
+}
+
+TEST(ThreadPoolTest, ParallelFor)
+{
+    ThreadPool pool(4);
+
+    const size_t kCount = 1000;
+    std::vector<std::atomic<int>> visits(kCount);
+
+    pool.parallelFor(kCount, [&](size_t index) { ++visits[index]; });
+
+    for (size_t i = 0; i < kCount; ++i)
+        EXPECT_EQ(visits[i], 1) << "index " << i;
+
+    // Nothing to do.
+    pool.parallelFor(0, [](size_t /* index */) { FAIL(); });
+}
+
+TEST(ThreadPoolTest, NestedParallelFor)
+{
+    ThreadPool pool(2);
+
+    std::atomic<size_t> sum { 0 };
+    std::promise<void> done;
+
+    // The outer calls occupy all threads of the pool, the inner ones must still finish.
+    pool.postTask([&]()
+    {
+        pool.parallelFor(8, [&](size_t /* outer */)
+        {
+            pool.parallelFor(100, [&](size_t index) { sum += index; });
+        });
+
+        done.set_value();
+    });
+
+    ASSERT_EQ(done.get_future().wait_for(kWaitTimeout), std::future_status::ready);
+    EXPECT_EQ(sum, 8U * (99U * 100U / 2U));
+}
+
+TEST(ThreadPoolTest, DelayedTasks)
+{
+    ThreadPool pool(1);
+
+    std::vector<int> order;
+    std::promise<void> done;
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point finish;
+
+    pool.postDelayedTask([&]()
+    {
+        order.emplace_back(2);
+        finish = std::chrono::steady_clock::now();
+        done.set_value();
+    }, std::chrono::milliseconds(60));
+
+    pool.postDelayedTask([&]() { order.emplace_back(1); }, std::chrono::milliseconds(20));
+    pool.postTask([&]() { order.emplace_back(0); });
+
+    ASSERT_EQ(done.get_future().wait_for(kWaitTimeout), std::future_status::ready);
+    EXPECT_EQ(order, std::vector<int>({ 0, 1, 2 }));
+    EXPECT_GE(finish - start, std::chrono::milliseconds(60));
+}
+
+TEST(ThreadPoolTest, TaskRunner)
+{
+    std::shared_ptr<TaskRunner> task_runner;
+    std::promise<bool> belongs;
+    std::promise<void> delayed_done;
+
+    {
+        ThreadPool pool(2);
+        task_runner = pool.taskRunner();
+        EXPECT_EQ(task_runner, pool.taskRunner());
+        EXPECT_FALSE(task_runner->belongsToCurrentThread());
+
+        task_runner->postTask([&]() { belongs.set_value(task_runner->belongsToCurrentThread()); });
+        task_runner->postDelayedTask([&]() { delayed_done.set_value(); },
+                                     std::chrono::milliseconds(10));
+
+        std::future<bool> belongs_future = belongs.get_future();
+        ASSERT_EQ(belongs_future.wait_for(kWaitTimeout), std::future_status::ready);
+        EXPECT_TRUE(belongs_future.get());
+
+        ASSERT_EQ(delayed_done.get_future().wait_for(kWaitTimeout), std::future_status::ready);
+    }
+
+    // The tasks posted after the destruction of the pool are dropped.
+    EXPECT_FALSE(task_runner->belongsToCurrentThread());
+    task_runner->postTask([]() { FAIL(); });
+    task_runner->postDelayedTask([]() { FAIL(); }, std::chrono::milliseconds(1));
+}
+
+TEST(ThreadPoolTest, DestroyWithQueuedTasks)
+{
+    std::atomic<int> count { 0 };
+    std::promise<void> started;
+
+    {
+        ThreadPool pool(1);
+
+        // The only thread is busy while the pool is destroyed.
+        pool.postTask([&]()
+        {
+            started.set_value();
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        });
+
+        for (int i = 0; i < 10; ++i)
+            pool.postTask([&]() { ++count; });
+
+        pool.postDelayedTask([&]() { ++count; }, std::chrono::milliseconds(1));
+
+        started.get_future().wait();
+    }
+
+    // The running task is finished, the queued ones are not run.
+    EXPECT_EQ(count, 0);
+}
+
+} // namespace base
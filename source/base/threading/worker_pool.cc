@@ -0,0 +1,98 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/threading/worker_pool.h"
+
+namespace base {
+
+WorkerPool::WorkerPool(int thread_count)
+    : thread_count_(thread_count)
+{
+    for (int i = 1; i < thread_count_; ++i)
+        threads_.emplace_back(&WorkerPool::threadMain, this, i);
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::scoped_lock lock(lock_);
+        terminate_ = true;
+    }
+
+    work_event_.notify_all();
+
+    for (auto& thread : threads_)
+        thread.join();
+}
+
+void WorkerPool::run(const Task& task)
+{
+    {
+        std::scoped_lock lock(lock_);
+        task_ = &task;
+        pending_ = thread_count_ - 1;
+        ++generation_;
+    }
+
+    work_event_.notify_all();
+
+    // Index 0 is always processed by the calling thread.
+    task(0);
+
+    std::unique_lock lock(lock_);
+    done_event_.wait(lock, [this]() { return pending_ == 0; });
+    task_ = nullptr;
+}
+
+void WorkerPool::threadMain(int index)
+{
+    uint64_t last_generation = 0;
+
+    while (true)
+    {
+        const Task* task;
+
+        {
+            std::unique_lock lock(lock_);
+            work_event_.wait(lock, [&]()
+            {
+                return terminate_ || generation_ != last_generation;
+            });
+
+            if (terminate_)
+                return;
+
+            last_generation = generation_;
+            task = task_;
+        }
+
+        (*task)(index);
+
+        bool is_last;
+
+        {
+            std::scoped_lock lock(lock_);
+            is_last = (--pending_ == 0);
+        }
+
+        if (is_last)
+            done_event_.notify_one();
+    }
+}
+
+} // namespace base
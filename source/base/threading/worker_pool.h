@@ -0,0 +1,67 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_THREADING_WORKER_POOL_H
+#define BASE_THREADING_WORKER_POOL_H
+
+#include "base/macros_magic.h"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace base {
+
+// Pool of threads to process parts of one job in parallel. The calling thread also takes part in
+// the processing, so the pool contains |thread_count| - 1 threads.
+class WorkerPool
+{
+public:
+    using Task = std::function<void(int index)>;
+
+    explicit WorkerPool(int thread_count);
+    ~WorkerPool();
+
+    int threadCount() const { return thread_count_; }
+
+    // Calls |task| for each index in range [0; threadCount()) and waits for their completion.
+    void run(const Task& task);
+
+private:
+    void threadMain(int index);
+
+    const int thread_count_;
+    std::vector<std::thread> threads_;
+
+    std::mutex lock_;
+    std::condition_variable work_event_;
+    std::condition_variable done_event_;
+
+    const Task* task_ = nullptr;
+    uint64_t generation_ = 0;
+    int pending_ = 0;
+    bool terminate_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(WorkerPool);
+};
+
+} // namespace base
+
+#endif // BASE_THREADING_WORKER_POOL_H
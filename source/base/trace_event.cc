@@ -0,0 +1,287 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/trace_event.h"
+
+#include "base/environment.h"
+#include "base/logging.h"
+#include "base/process_handle.h"
+#include "base/system_time.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace base {
+
+namespace {
+
+// Number of the latest events kept for each thread.
+const size_t kThreadBufferSize = 8192;
+
+std::atomic_uint32_t g_next_thread_id { 1 };
+
+} // namespace
+
+class TraceLog::ThreadBuffer
+{
+public:
+    ThreadBuffer()
+        : events_(kThreadBufferSize)
+    {
+        // Nothing
+    }
+
+    void add(uint32_t thread_id, const char* name, int64_t begin_time, int64_t duration)
+    {
+        // The lock is only contended while the events are exported.
+        std::scoped_lock lock(lock_);
+
+        Event& event = events_[next_];
+        event.name = name;
+        event.thread_id = thread_id;
+        event.begin_time = begin_time;
+        event.duration = duration;
+
+        next_ = (next_ + 1) % events_.size();
+        count_ = std::min(count_ + 1, events_.size());
+    }
+
+    void appendJson(std::ostringstream* json, ProcessId process_id, bool* first) const
+    {
+        std::scoped_lock lock(lock_);
+
+        // The oldest event is the first one after the newest.
+        size_t index = (next_ + events_.size() - count_) % events_.size();
+
+        for (size_t i = 0; i < count_; ++i)
+        {
+            const Event& event = events_[index];
+
+            if (!*first)
+                *json << ',';
+            *first = false;
+
+            *json << "{\"name\":\"" << event.name << "\",\"ph\":\"X\""
+                  << ",\"pid\":" << process_id
+                  << ",\"tid\":" << event.thread_id
+                  << ",\"ts\":" << event.begin_time
+                  << ",\"dur\":" << event.duration << '}';
+
+            index = (index + 1) % events_.size();
+        }
+    }
+
+    void clear()
+    {
+        std::scoped_lock lock(lock_);
+        next_ = 0;
+        count_ = 0;
+    }
+
+    // The buffer of an exited thread is reused by a new thread. The events of the exited thread
+    // are kept until they are overwritten.
+    std::atomic_bool in_use { false };
+
+private:
+    struct Event
+    {
+        const char* name = nullptr;
+        uint32_t thread_id = 0;
+        int64_t begin_time = 0;
+        int64_t duration = 0;
+    };
+
+    mutable std::mutex lock_;
+    std::vector<Event> events_;
+    size_t next_ = 0;
+    size_t count_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(ThreadBuffer);
+};
+
+namespace {
+
+// Releases the buffer of the thread when the thread exits.
+class ThreadBufferHolder
+{
+public:
+    ThreadBufferHolder() = default;
+
+    ~ThreadBufferHolder()
+    {
+        if (in_use)
+            in_use->store(false, std::memory_order_release);
+    }
+
+    std::atomic_bool* in_use = nullptr;
+    void* buffer = nullptr;
+    const uint32_t thread_id = g_next_thread_id.fetch_add(1, std::memory_order_relaxed);
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(ThreadBufferHolder);
+};
+
+thread_local ThreadBufferHolder t_buffer_holder;
+
+} // namespace
+
+// static
+std::atomic_bool TraceLog::enabled_ { false };
+
+TraceLog::TraceLog()
+    : start_time_(std::chrono::steady_clock::now())
+{
+    std::string dump_dir;
+    if (Environment::get("ASPIA_TRACE_DIR", &dump_dir) && !dump_dir.empty())
+    {
+        dump_dir_ = dump_dir;
+        enabled_.store(true, std::memory_order_relaxed);
+    }
+}
+
+// static
+TraceLog& TraceLog::instance()
+{
+    // Never destroyed, so the events can be added while the threads are exiting.
+    static TraceLog* trace_log = new TraceLog();
+    return *trace_log;
+}
+
+void TraceLog::setEnabled(bool enable)
+{
+    enabled_.store(enable, std::memory_order_relaxed);
+}
+
+int64_t TraceLog::now() const
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start_time_).count();
+}
+
+void TraceLog::addEvent(const char* name, int64_t begin_time, int64_t duration)
+{
+    currentThreadBuffer()->add(t_buffer_holder.thread_id, name, begin_time, duration);
+}
+
+std::string TraceLog::toJson() const
+{
+    const ProcessId process_id = currentProcessId();
+
+    std::ostringstream json;
+    json << "{\"traceEvents\":[";
+
+    bool first = true;
+    {
+        std::scoped_lock lock(buffers_lock_);
+        for (const auto& buffer : buffers_)
+            buffer->appendJson(&json, process_id, &first);
+    }
+
+    json << "],\"displayTimeUnit\":\"ms\"}";
+    return json.str();
+}
+
+bool TraceLog::dumpToFile(const std::filesystem::path& file_path) const
+{
+    std::ofstream file(file_path, std::ofstream::out | std::ofstream::trunc);
+    if (!file.is_open())
+    {
+        LOG(LS_ERROR) << "Unable to open trace file: " << file_path;
+        return false;
+    }
+
+    file << toJson();
+    if (file.fail())
+    {
+        LOG(LS_ERROR) << "Unable to write trace file: " << file_path;
+        return false;
+    }
+
+    return true;
+}
+
+void TraceLog::dump() const
+{
+    if (!isEnabled() || dump_dir_.empty())
+        return;
+
+    std::error_code error_code;
+    std::filesystem::create_directories(dump_dir_, error_code);
+
+    SystemTime time = SystemTime::now();
+
+    std::ostringstream file_name;
+    file_name << "aspia-trace-" << currentProcessId() << '-'
+              << std::setfill('0')
+              << std::setw(4) << time.year()
+              << std::setw(2) << time.month()
+              << std::setw(2) << time.day()
+              << '-'
+              << std::setw(2) << time.hour()
+              << std::setw(2) << time.minute()
+              << std::setw(2) << time.second()
+              << '.'
+              << std::setw(3) << time.millisecond()
+              << ".json";
+
+    std::filesystem::path file_path = dump_dir_;
+    file_path.append(file_name.str());
+
+    if (dumpToFile(file_path))
+        LOG(LS_INFO) << "Trace written to " << file_path;
+}
+
+void TraceLog::clear()
+{
+    std::scoped_lock lock(buffers_lock_);
+    for (const auto& buffer : buffers_)
+        buffer->clear();
+}
+
+TraceLog::ThreadBuffer* TraceLog::currentThreadBuffer()
+{
+    if (t_buffer_holder.buffer)
+        return static_cast<ThreadBuffer*>(t_buffer_holder.buffer);
+
+    std::scoped_lock lock(buffers_lock_);
+
+    ThreadBuffer* result = nullptr;
+    for (const auto& buffer : buffers_)
+    {
+        bool expected = false;
+        if (buffer->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire))
+        {
+            result = buffer.get();
+            break;
+        }
+    }
+
+    if (!result)
+    {
+        buffers_.emplace_back(std::make_unique<ThreadBuffer>());
+        result = buffers_.back().get();
+        result->in_use.store(true, std::memory_order_relaxed);
+    }
+
+    t_buffer_holder.in_use = &result->in_use;
+    t_buffer_holder.buffer = result;
+    return result;
+}
+
+} // namespace base
@@ -0,0 +1,122 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef BASE_TRACE_EVENT_H
+#define BASE_TRACE_EVENT_H
+
+#include "base/macros_magic.h"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace base {
+
+// Collects the durations of the scopes marked with TRACE_EVENT. Each thread writes its events to
+// its own ring buffer, so only the latest events of each thread are kept. The events are written
+// in the Chrome trace format (chrome://tracing or https://ui.perfetto.dev).
+//
+// Tracing is disabled by default. If the environment variable ASPIA_TRACE_DIR is set, tracing is
+// enabled at startup and dump() writes the files into that directory.
+class TraceLog
+{
+public:
+    static TraceLog& instance();
+
+    static bool isEnabled() { return enabled_.load(std::memory_order_relaxed); }
+    void setEnabled(bool enable);
+
+    // Returns the time in microseconds since the start of the process.
+    int64_t now() const;
+
+    // |name| must have a static storage duration (a string literal).
+    void addEvent(const char* name, int64_t begin_time, int64_t duration);
+
+    // Returns the events of all threads in the Chrome trace JSON format.
+    std::string toJson() const;
+
+    // Writes the events to |file_path|. Returns false if the file could not be written.
+    bool dumpToFile(const std::filesystem::path& file_path) const;
+
+    // Writes the events to a new file in the directory from ASPIA_TRACE_DIR. Does nothing if
+    // tracing is disabled or the directory is not set.
+    void dump() const;
+
+    // Removes the events of all threads.
+    void clear();
+
+private:
+    class ThreadBuffer;
+
+    TraceLog();
+    ~TraceLog() = delete;
+
+    ThreadBuffer* currentThreadBuffer();
+
+    static std::atomic_bool enabled_;
+
+    const std::chrono::steady_clock::time_point start_time_;
+    std::filesystem::path dump_dir_;
+
+    mutable std::mutex buffers_lock_;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+
+    DISALLOW_COPY_AND_ASSIGN(TraceLog);
+};
+
+class ScopedTraceEvent
+{
+public:
+    explicit ScopedTraceEvent(const char* name)
+    {
+        if (TraceLog::isEnabled())
+        {
+            name_ = name;
+            begin_time_ = TraceLog::instance().now();
+        }
+    }
+
+    ~ScopedTraceEvent()
+    {
+        if (name_)
+        {
+            TraceLog& trace_log = TraceLog::instance();
+            trace_log.addEvent(name_, begin_time_, trace_log.now() - begin_time_);
+        }
+    }
+
+private:
+    const char* name_ = nullptr;
+    int64_t begin_time_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedTraceEvent);
+};
+
+} // namespace base
+
+#define TRACE_EVENT_CONCAT_INTERNAL(a, b) a##b
+#define TRACE_EVENT_CONCAT(a, b) TRACE_EVENT_CONCAT_INTERNAL(a, b)
+
+// Records the duration of the current scope with |name|. |name| must be a string literal.
+#define TRACE_EVENT(name) \
+    ::base::ScopedTraceEvent TRACE_EVENT_CONCAT(trace_event_, __LINE__)(name)
+
+#endif // BASE_TRACE_EVENT_H
@@ -0,0 +1,102 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/trace_event.h"
+
+#include <thread>
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+size_t countOf(const std::string& text, const std::string& pattern)
+{
+    size_t count = 0;
+    for (size_t pos = text.find(pattern); pos != std::string::npos;
+         pos = text.find(pattern, pos + pattern.size()))
+    {
+        ++count;
+    }
+    return count;
+}
+
+} // namespace
+
+TEST(TraceEvent, Disabled)
+{
+    TraceLog& trace_log = TraceLog::instance();
+    trace_log.setEnabled(false);
+    trace_log.clear();
+
+    {
+        TRACE_EVENT("disabled");
+    }
+
+    EXPECT_EQ(trace_log.toJson().find("disabled"), std::string::npos);
+}
+
+TEST(TraceEvent, Threads)
+{
+    TraceLog& trace_log = TraceLog::instance();
+    trace_log.setEnabled(true);
+    trace_log.clear();
+
+    {
+        TRACE_EVENT("main");
+    }
+
+    std::thread thread([]()
+    {
+        for (int i = 0; i < 10; ++i)
+        {
+            TRACE_EVENT("worker");
+        }
+    });
+    thread.join();
+
+    trace_log.setEnabled(false);
+
+    const std::string json = trace_log.toJson();
+    EXPECT_EQ(json.find("{\"traceEvents\":["), 0u);
+    EXPECT_EQ(countOf(json, "\"name\":\"main\",\"ph\":\"X\""), 1u);
+    EXPECT_EQ(countOf(json, "\"name\":\"worker\",\"ph\":\"X\""), 10u);
+}
+
+TEST(TraceEvent, RingOverflow)
+{
+    TraceLog& trace_log = TraceLog::instance();
+    trace_log.setEnabled(true);
+    trace_log.clear();
+
+    trace_log.addEvent("old", 0, 1);
+    for (int i = 0; i < 10000; ++i)
+        trace_log.addEvent("new", i + 1, 1);
+
+    trace_log.setEnabled(false);
+
+    // Only the latest events are kept.
+    const std::string json = trace_log.toJson();
+    EXPECT_EQ(countOf(json, "\"name\":\"old\""), 0u);
+    EXPECT_EQ(countOf(json, "\"name\":\"new\""), 8192u);
+
+    trace_log.clear();
+    EXPECT_EQ(countOf(trace_log.toJson(), "\"name\""), 0u);
+}
+
+} // namespace base
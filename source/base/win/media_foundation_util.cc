@@ -0,0 +1,126 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/win/media_foundation_util.h"
+
+#include "base/logging.h"
+
+#include <comdef.h>
+#include <mferror.h>
+
+#include <mutex>
+
+using Microsoft::WRL::ComPtr;
+
+namespace base::win {
+
+bool initializeMediaFoundation()
+{
+    static std::once_flag once_flag;
+    static bool initialized = false;
+
+    std::call_once(once_flag, []()
+    {
+        _com_error error = MFStartup(MF_VERSION, MFSTARTUP_LITE);
+        if (error.Error() != S_OK)
+        {
+            LOG(LS_WARNING) << "MFStartup failed: " << error.ErrorMessage();
+            return;
+        }
+
+        initialized = true;
+    });
+
+    return initialized;
+}
+
+ComPtr<IMFTransform> createTransform(
+    const GUID& category, UINT32 flags, const GUID& input_subtype, const GUID& output_subtype)
+{
+    if (!initializeMediaFoundation())
+        return nullptr;
+
+    MFT_REGISTER_TYPE_INFO input_type = { MFMediaType_Video, input_subtype };
+    MFT_REGISTER_TYPE_INFO output_type = { MFMediaType_Video, output_subtype };
+
+    IMFActivate** activates = nullptr;
+    UINT32 count = 0;
+
+    _com_error error = MFTEnumEx(category, flags, &input_type, &output_type, &activates, &count);
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_WARNING) << "MFTEnumEx failed: " << error.ErrorMessage();
+        return nullptr;
+    }
+
+    ComPtr<IMFTransform> transform;
+
+    for (UINT32 i = 0; i < count; ++i)
+    {
+        if (!transform)
+        {
+            wchar_t* name = nullptr;
+            UINT32 name_length = 0;
+
+            if (SUCCEEDED(activates[i]->GetAllocatedString(
+                    MFT_FRIENDLY_NAME_Attribute, &name, &name_length)))
+            {
+                LOG(LS_INFO) << "Transform found: " << name;
+                CoTaskMemFree(name);
+            }
+
+            error = activates[i]->ActivateObject(IID_PPV_ARGS(transform.GetAddressOf()));
+            if (error.Error() != S_OK)
+            {
+                LOG(LS_WARNING) << "ActivateObject failed: " << error.ErrorMessage();
+                transform.Reset();
+            }
+        }
+
+        activates[i]->Release();
+    }
+
+    CoTaskMemFree(activates);
+    return transform;
+}
+
+ComPtr<IMFMediaType> createVideoMediaType(
+    const GUID& subtype, const Size& size, UINT32 frame_rate)
+{
+    ComPtr<IMFMediaType> media_type;
+
+    _com_error error = MFCreateMediaType(media_type.GetAddressOf());
+    if (error.Error() != S_OK)
+    {
+        LOG(LS_WARNING) << "MFCreateMediaType failed: " << error.ErrorMessage();
+        return nullptr;
+    }
+
+    media_type->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video);
+    media_type->SetGUID(MF_MT_SUBTYPE, subtype);
+    media_type->SetUINT32(MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive);
+    media_type->SetUINT32(MF_MT_ALL_SAMPLES_INDEPENDENT, TRUE);
+    MFSetAttributeSize(media_type.Get(), MF_MT_FRAME_SIZE,
+                       static_cast<UINT32>(size.width()), static_cast<UINT32>(size.height()));
+    MFSetAttributeRatio(media_type.Get(), MF_MT_FRAME_RATE, frame_rate, 1);
+    MFSetAttributeRatio(media_type.Get(), MF_MT_PIXEL_ASPECT_RATIO, 1, 1);
+
+    return media_type;
+}
+
+} // namespace base::win
@@ -0,0 +1,47 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE_WIN_MEDIA_FOUNDATION_UTIL_H
+#define BASE_WIN_MEDIA_FOUNDATION_UTIL_H
+
+#include "base/desktop/geometry.h"
+
+#include <mfapi.h>
+#include <mfidl.h>
+#include <mftransform.h>
+#include <wrl/client.h>
+
+namespace base::win {
+
+// Starts Media Foundation for the process. It is safe to call the function many times, the
+// platform is started only once and is never shut down. Returns false if Media Foundation is not
+// available (for example, on Windows N editions without the Media Feature Pack).
+bool initializeMediaFoundation();
+
+// Returns the first transform of |category| that converts |input_subtype| to |output_subtype|.
+// |flags| is a combination of MFT_ENUM_FLAG values.
+Microsoft::WRL::ComPtr<IMFTransform> createTransform(
+    const GUID& category, UINT32 flags, const GUID& input_subtype, const GUID& output_subtype);
+
+// Creates a video media type with the specified subtype, frame size and frame rate.
+Microsoft::WRL::ComPtr<IMFMediaType> createVideoMediaType(
+    const GUID& subtype, const Size& size, UINT32 frame_rate);
+
+} // namespace base::win
+
+#endif // BASE_WIN_MEDIA_FOUNDATION_UTIL_H
@@ -0,0 +1,643 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "client/batch_job.h"
+
+#include "base/logging.h"
+#include "base/scoped_task_runner.h"
+#include "base/task_runner.h"
+#include "base/waitable_timer.h"
+#include "client/client_file_transfer.h"
+#include "client/client_proxy.h"
+#include "client/client_system_info.h"
+#include "client/file_control_proxy.h"
+#include "client/file_manager_window.h"
+#include "client/file_manager_window_proxy.h"
+#include "client/file_transfer_proxy.h"
+#include "client/file_transfer_window.h"
+#include "client/file_transfer_window_proxy.h"
+#include "client/status_window.h"
+#include "client/status_window_proxy.h"
+#include "client/system_info_control_proxy.h"
+#include "client/system_info_window.h"
+#include "client/system_info_window_proxy.h"
+#include "common/desktop_session_constants.h"
+#include "proto/desktop.pb.h"
+#include "proto/system_info.pb.h"
+
+#include <algorithm>
+#include <filesystem>
+
+namespace client {
+
+namespace {
+
+// Time to wait for the host to close the connection after the power action is written.
+const std::chrono::seconds kCloseTimeout { 5 };
+
+std::string routerErrorToString(const RouterController::Error& error)
+{
+    switch (error.type)
+    {
+        case RouterController::ErrorType::NETWORK:
+            return "Router network error: " +
+                base::NetworkChannel::errorToString(error.code.network);
+
+        case RouterController::ErrorType::AUTHENTICATION:
+            return std::string("Router authentication error: ") +
+                base::Authenticator::errorToString(error.code.authentication);
+
+        case RouterController::ErrorType::ROUTER:
+        {
+            switch (error.code.router)
+            {
+                case RouterController::ErrorCode::PEER_NOT_FOUND:
+                    return "Host is not connected to the router";
+
+                case RouterController::ErrorCode::ACCESS_DENIED:
+                    return "Access to the router denied";
+
+                case RouterController::ErrorCode::KEY_POOL_EMPTY:
+                    return "No free relays";
+
+                case RouterController::ErrorCode::RELAY_ERROR:
+                    return "Relay error";
+
+                default:
+                    return "Router error";
+            }
+        }
+
+        default:
+            return "Unknown router error";
+    }
+}
+
+// Sends the power action in a desktop manage session. When the message is written, the sending
+// side of the connection is shut down and the session is stopped as soon as the host closes the
+// connection. The video and other messages of the desktop session are ignored.
+class PowerControlClient : public Client
+{
+public:
+    PowerControlClient(std::shared_ptr<base::TaskRunner> io_task_runner,
+                       proto::PowerControl::Action action)
+        : Client(io_task_runner),
+          io_task_runner_(io_task_runner),
+          close_timer_(base::WaitableTimer::Type::SINGLE_SHOT, io_task_runner),
+          action_(action)
+    {
+        // Nothing
+    }
+
+protected:
+    // Client implementation.
+    void onSessionStarted(const base::Version& /* peer_version */) override
+    {
+        LOG(LS_INFO) << "Power control session started (action: " << action_ << ")";
+
+        proto::PowerControl power_control;
+        power_control.set_action(action_);
+
+        proto::ClientToHost message;
+        proto::DesktopExtension* extension = message.mutable_extension();
+        extension->set_name(common::kPowerControlExtension);
+        extension->set_data(power_control.SerializeAsString());
+
+        is_sent_ = true;
+        sendMessage(proto::HOST_CHANNEL_ID_SESSION, message);
+    }
+
+    void onSessionMessageReceived(uint8_t /* channel_id */,
+                                  const base::ByteArray& /* buffer */) override
+    {
+        // Nothing
+    }
+
+    void onSessionMessageWritten(uint8_t /* channel_id */, size_t pending) override
+    {
+        if (!is_sent_ || pending)
+            return;
+
+        is_sent_ = false;
+        is_closing_ = true;
+
+        // The written message can still be in the socket buffers. The host reads the end of the
+        // stream only after the message is handled and then closes the connection.
+        shutdownSend();
+
+        close_timer_.start(kCloseTimeout, [this]()
+        {
+            LOG(LS_WARNING) << "Host did not close the connection in time";
+            stop();
+        });
+    }
+
+    void onTcpDisconnected(base::NetworkChannel::ErrorCode error_code) override
+    {
+        if (!is_closing_)
+        {
+            Client::onTcpDisconnected(error_code);
+            return;
+        }
+
+        LOG(LS_INFO) << "Host closed the connection";
+        close_timer_.stop();
+
+        // The stop is reported to the status window of the session as the end of the operation.
+        // The channel can not be destroyed from its own callback.
+        io_task_runner_.postTask([this]() { stop(); });
+    }
+
+private:
+    base::ScopedTaskRunner io_task_runner_;
+    base::WaitableTimer close_timer_;
+    const proto::PowerControl::Action action_;
+    bool is_sent_ = false;
+    bool is_closing_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(PowerControlClient);
+};
+
+} // namespace
+
+class BatchJob::Session
+    : public StatusWindow,
+      public SystemInfoWindow,
+      public FileManagerWindow,
+      public FileTransferWindow
+{
+public:
+    Session(BatchJob* job, const Computer& computer);
+    ~Session() override;
+
+    void connect();
+
+    // After the call the session does not call the job and can be deleted later.
+    void dettach();
+
+protected:
+    // StatusWindow implementation.
+    void onStarted(const std::u16string& address_or_id) override;
+    void onStopped() override;
+    void onConnected() override;
+    void onDisconnected(base::TcpChannel::ErrorCode error_code) override;
+    void onAccessDenied(base::ClientAuthenticator::ErrorCode error_code) override;
+    void onRouterError(const RouterController::Error& error) override;
+
+    // SystemInfoWindow implementation.
+    void start(std::shared_ptr<SystemInfoControlProxy> system_info_control_proxy) override;
+    void setSystemInfo(const proto::system_info::SystemInfo& system_info) override;
+
+    // FileManagerWindow implementation.
+    void start(std::shared_ptr<FileControlProxy> file_control_proxy) override;
+    void onErrorOccurred(proto::FileError error_code) override;
+    void onDriveList(common::FileTask::Target target,
+                     proto::FileError error_code,
+                     const proto::DriveList& drive_list) override;
+    void onFileList(common::FileTask::Target target,
+                    proto::FileError error_code,
+                    const proto::FileList& file_list) override;
+    void onFileListPage(common::FileTask::Target target,
+                        proto::FileError error_code,
+                        const proto::FileList& file_list) override;
+    void onCreateDirectory(common::FileTask::Target target, proto::FileError error_code) override;
+    void onRename(common::FileTask::Target target, proto::FileError error_code) override;
+
+    // FileTransferWindow implementation.
+    void start(std::shared_ptr<FileTransferProxy> transfer_proxy) override;
+    void stop() override;
+    void setCurrentItem(const std::string& source_path, const std::string& target_path) override;
+    void setCurrentProgress(int total, int current) override;
+    void errorOccurred(const FileTransfer::Error& error) override;
+
+private:
+    void setState(State state, int percentage = -1);
+    void finish(bool succeeded, const std::string& message,
+                const std::string& result = std::string());
+
+    BatchJob* job_;
+    const Computer computer_;
+    const Options options_;
+
+    std::shared_ptr<StatusWindowProxy> status_window_proxy_;
+    std::shared_ptr<SystemInfoWindowProxy> system_info_window_proxy_;
+    std::shared_ptr<FileManagerWindowProxy> file_manager_window_proxy_;
+    std::shared_ptr<FileTransferWindowProxy> file_transfer_window_proxy_;
+
+    std::shared_ptr<SystemInfoControlProxy> system_info_control_proxy_;
+    std::shared_ptr<FileControlProxy> file_control_proxy_;
+    std::shared_ptr<FileTransferProxy> transfer_proxy_;
+
+    std::unique_ptr<ClientProxy> client_proxy_;
+    base::WaitableTimer timeout_timer_;
+
+    bool is_connected_ = false;
+    bool is_finished_ = false;
+    std::string transfer_error_;
+
+    DISALLOW_COPY_AND_ASSIGN(Session);
+};
+
+BatchJob::Session::Session(BatchJob* job, const Computer& computer)
+    : job_(job),
+      computer_(computer),
+      options_(job->options_),
+      timeout_timer_(base::WaitableTimer::Type::SINGLE_SHOT, job->owner_task_runner_)
+{
+    DCHECK(job_);
+}
+
+BatchJob::Session::~Session()
+{
+    dettach();
+
+    // The client is stopped and destroyed on the I/O thread.
+    client_proxy_.reset();
+}
+
+void BatchJob::Session::connect()
+{
+    const std::shared_ptr<base::TaskRunner>& io_task_runner = job_->io_task_runner_;
+    const std::shared_ptr<base::TaskRunner>& owner_task_runner = job_->owner_task_runner_;
+
+    status_window_proxy_ = std::make_shared<StatusWindowProxy>(owner_task_runner, this);
+
+    Config config = computer_.config;
+    std::unique_ptr<Client> client;
+
+    switch (options_.operation)
+    {
+        case Operation::SYSTEM_INFO:
+        {
+            config.session_type = proto::SESSION_TYPE_SYSTEM_INFO;
+
+            std::unique_ptr<ClientSystemInfo> system_info_client =
+                std::make_unique<ClientSystemInfo>(io_task_runner);
+
+            system_info_window_proxy_ =
+                std::make_shared<SystemInfoWindowProxy>(owner_task_runner, this);
+            system_info_client->setSystemInfoWindow(system_info_window_proxy_);
+
+            client = std::move(system_info_client);
+        }
+        break;
+
+        case Operation::FILE_UPLOAD:
+        {
+            config.session_type = proto::SESSION_TYPE_FILE_TRANSFER;
+
+            std::unique_ptr<ClientFileTransfer> file_transfer_client =
+                std::make_unique<ClientFileTransfer>(io_task_runner);
+
+            file_manager_window_proxy_ =
+                std::make_shared<FileManagerWindowProxy>(owner_task_runner, this);
+            file_transfer_window_proxy_ =
+                std::make_shared<FileTransferWindowProxy>(owner_task_runner, this);
+            file_transfer_client->setFileManagerWindow(file_manager_window_proxy_);
+
+            client = std::move(file_transfer_client);
+        }
+        break;
+
+        case Operation::POWER_CONTROL:
+        {
+            config.session_type = proto::SESSION_TYPE_DESKTOP_MANAGE;
+            client = std::make_unique<PowerControlClient>(io_task_runner, options_.power_action);
+        }
+        break;
+
+        default:
+            NOTREACHED();
+            return;
+    }
+
+    // When connecting with a one-time password, the username must be in the following format:
+    // #host_id.
+    if (config.username.empty())
+        config.username = u"#" + config.address_or_id;
+
+    client->setStatusWindow(status_window_proxy_);
+
+    client_proxy_ = std::make_unique<ClientProxy>(io_task_runner, std::move(client), config);
+    client_proxy_->start();
+
+    timeout_timer_.start(options_.timeout, [this]()
+    {
+        finish(false, "Operation timed out");
+    });
+}
+
+void BatchJob::Session::dettach()
+{
+    is_finished_ = true;
+    timeout_timer_.stop();
+
+    // The proxies may have tasks in the queue, they must not call the session anymore.
+    if (status_window_proxy_)
+        status_window_proxy_->dettach();
+    if (system_info_window_proxy_)
+        system_info_window_proxy_->dettach();
+    if (file_manager_window_proxy_)
+        file_manager_window_proxy_->dettach();
+    if (file_transfer_window_proxy_)
+        file_transfer_window_proxy_->dettach();
+}
+
+void BatchJob::Session::onStarted(const std::u16string& /* address_or_id */)
+{
+    setState(State::CONNECTING);
+}
+
+void BatchJob::Session::onStopped()
+{
+    // The power control client stops itself after the action is sent.
+    if (options_.operation == Operation::POWER_CONTROL && is_connected_)
+        finish(true, std::string());
+    else
+        finish(false, "Session stopped");
+}
+
+void BatchJob::Session::onConnected()
+{
+    is_connected_ = true;
+    setState(State::RUNNING);
+}
+
+void BatchJob::Session::onDisconnected(base::TcpChannel::ErrorCode error_code)
+{
+    finish(false, "Connection error: " + base::NetworkChannel::errorToString(error_code));
+}
+
+void BatchJob::Session::onAccessDenied(base::ClientAuthenticator::ErrorCode error_code)
+{
+    finish(false, std::string("Access denied: ") + base::Authenticator::errorToString(error_code));
+}
+
+void BatchJob::Session::onRouterError(const RouterController::Error& error)
+{
+    finish(false, routerErrorToString(error));
+}
+
+void BatchJob::Session::start(std::shared_ptr<SystemInfoControlProxy> system_info_control_proxy)
+{
+    system_info_control_proxy_ = std::move(system_info_control_proxy);
+
+    proto::system_info::SystemInfoRequest request;
+    request.set_category(options_.system_info_category);
+
+    system_info_control_proxy_->onSystemInfoRequest(request);
+}
+
+void BatchJob::Session::setSystemInfo(const proto::system_info::SystemInfo& system_info)
+{
+    finish(true, std::string(), system_info.SerializeAsString());
+}
+
+void BatchJob::Session::start(std::shared_ptr<FileControlProxy> file_control_proxy)
+{
+    file_control_proxy_ = std::move(file_control_proxy);
+
+    std::filesystem::path source_file = std::filesystem::u8path(options_.source_file);
+
+    std::error_code error_code;
+    uintmax_t file_size = std::filesystem::file_size(source_file, error_code);
+    if (error_code)
+    {
+        finish(false, "Unable to get the size of the source file");
+        return;
+    }
+
+    std::vector<FileTransfer::Item> items;
+    items.emplace_back(source_file.filename().u8string(), static_cast<int64_t>(file_size), false);
+
+    file_control_proxy_->transfer(file_transfer_window_proxy_,
+                                  FileTransfer::Type::UPLOADER,
+                                  source_file.parent_path().u8string(),
+                                  options_.target_directory,
+                                  items);
+}
+
+void BatchJob::Session::onErrorOccurred(proto::FileError error_code)
+{
+    finish(false, "File session error: " + proto::FileError_Name(error_code));
+}
+
+void BatchJob::Session::onDriveList(common::FileTask::Target /* target */,
+                                    proto::FileError /* error_code */,
+                                    const proto::DriveList& /* drive_list */)
+{
+    // Nothing
+}
+
+void BatchJob::Session::onFileList(common::FileTask::Target /* target */,
+                                   proto::FileError /* error_code */,
+                                   const proto::FileList& /* file_list */)
+{
+    // Nothing
+}
+
+void BatchJob::Session::onFileListPage(common::FileTask::Target /* target */,
+                                       proto::FileError /* error_code */,
+                                       const proto::FileList& /* file_list */)
+{
+    // Nothing
+}
+
+void BatchJob::Session::onCreateDirectory(common::FileTask::Target /* target */,
+                                          proto::FileError /* error_code */)
+{
+    // Nothing
+}
+
+void BatchJob::Session::onRename(common::FileTask::Target /* target */,
+                                 proto::FileError /* error_code */)
+{
+    // Nothing
+}
+
+void BatchJob::Session::start(std::shared_ptr<FileTransferProxy> transfer_proxy)
+{
+    transfer_proxy_ = std::move(transfer_proxy);
+    setState(State::RUNNING, 0);
+}
+
+void BatchJob::Session::stop()
+{
+    // The transfer is finished. If an error occurred, then it was aborted.
+    if (transfer_error_.empty())
+        finish(true, std::string());
+    else
+        finish(false, transfer_error_);
+}
+
+void BatchJob::Session::setCurrentItem(const std::string& /* source_path */,
+                                       const std::string& /* target_path */)
+{
+    // Nothing
+}
+
+void BatchJob::Session::setCurrentProgress(int total, int /* current */)
+{
+    setState(State::RUNNING, total);
+}
+
+void BatchJob::Session::errorOccurred(const FileTransfer::Error& error)
+{
+    if (!transfer_proxy_)
+        return;
+
+    if (error.type() == FileTransfer::Error::Type::ALREADY_EXISTS && options_.overwrite)
+    {
+        transfer_proxy_->setAction(error.type(), FileTransfer::Error::ACTION_REPLACE_ALL);
+        return;
+    }
+
+    transfer_error_ = "File transfer error: " + proto::FileError_Name(error.code()) +
+        " (" + error.path() + ")";
+    transfer_proxy_->setAction(error.type(), FileTransfer::Error::ACTION_ABORT);
+}
+
+void BatchJob::Session::setState(State state, int percentage)
+{
+    if (is_finished_ || !job_->delegate_)
+        return;
+
+    job_->delegate_->onBatchJobProgress(computer_.computer_id, state, percentage);
+}
+
+void BatchJob::Session::finish(bool succeeded, const std::string& message,
+                               const std::string& result)
+{
+    if (is_finished_)
+        return;
+
+    dettach();
+
+    LOG(LS_INFO) << "Computer " << computer_.computer_id << " finished (succeeded: " << succeeded
+                 << (message.empty() ? "" : ", ") << message << ")";
+
+    job_->onSessionFinished(computer_.computer_id, succeeded, message, result);
+}
+
+BatchJob::BatchJob(std::shared_ptr<base::TaskRunner> io_task_runner,
+                   std::shared_ptr<base::TaskRunner> owner_task_runner)
+    : io_task_runner_(std::move(io_task_runner)),
+      owner_task_runner_(std::move(owner_task_runner))
+{
+    LOG(LS_INFO) << "Ctor";
+    DCHECK(io_task_runner_ && owner_task_runner_);
+}
+
+BatchJob::~BatchJob()
+{
+    LOG(LS_INFO) << "Dtor";
+    stop();
+}
+
+void BatchJob::start(const ComputerList& computers, const Options& options, Delegate* delegate)
+{
+    DCHECK(owner_task_runner_->belongsToCurrentThread());
+    DCHECK(delegate);
+
+    options_ = options;
+    options_.max_sessions = std::max(options_.max_sessions, size_t(1));
+    delegate_ = delegate;
+
+    LOG(LS_INFO) << "Start batch job (computers: " << computers.size()
+                 << ", max sessions: " << options_.max_sessions << ")";
+
+    for (const auto& computer : computers)
+    {
+        pending_.emplace_back(computer);
+        delegate_->onBatchJobProgress(computer.computer_id, State::WAITING, -1);
+    }
+
+    if (pending_.empty())
+    {
+        delegate_->onBatchJobFinished();
+        return;
+    }
+
+    startNextSessions();
+}
+
+void BatchJob::stop()
+{
+    delegate_ = nullptr;
+    pending_.clear();
+
+    // The method can be called from a callback of a session, so the sessions are deleted later.
+    for (auto& session : sessions_)
+    {
+        session.second->dettach();
+        owner_task_runner_->deleteSoon(std::move(session.second));
+    }
+
+    sessions_.clear();
+}
+
+void BatchJob::startNextSessions()
+{
+    while (sessions_.size() < options_.max_sessions && !pending_.empty())
+    {
+        Computer computer = std::move(pending_.front());
+        pending_.pop_front();
+
+        if (sessions_.count(computer.computer_id))
+        {
+            LOG(LS_WARNING) << "Computer " << computer.computer_id << " is already in progress";
+            continue;
+        }
+
+        std::unique_ptr<Session> session = std::make_unique<Session>(this, computer);
+        Session* session_ptr = session.get();
+
+        sessions_.emplace(computer.computer_id, std::move(session));
+        session_ptr->connect();
+    }
+}
+
+void BatchJob::onSessionFinished(int computer_id, bool succeeded,
+                                 const std::string& message, const std::string& result)
+{
+    // The call comes from the session, so it is deleted later.
+    auto it = sessions_.find(computer_id);
+    if (it != sessions_.end())
+    {
+        owner_task_runner_->deleteSoon(std::move(it->second));
+        sessions_.erase(it);
+    }
+
+    if (!delegate_)
+        return;
+
+    delegate_->onBatchJobProgress(
+        computer_id, succeeded ? State::SUCCEEDED : State::FAILED, succeeded ? 100 : -1);
+    delegate_->onBatchJobResult(computer_id, succeeded, message, result);
+
+    if (!delegate_)
+        return;
+
+    startNextSessions();
+
+    // The delegate can destroy the job when it is finished.
+    if (pending_.empty() && sessions_.empty())
+        delegate_->onBatchJobFinished();
+}
+
+} // namespace client
@@ -0,0 +1,139 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CLIENT_BATCH_JOB_H
+#define CLIENT_BATCH_JOB_H
+
+#include "base/macros_magic.h"
+#include "client/client_config.h"
+#include "proto/desktop_extensions.pb.h"
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace base {
+class TaskRunner;
+} // namespace base
+
+namespace client {
+
+// Runs one operation against a list of computers. At most |max_sessions| sessions are connected
+// at a time, the next computer is started as soon as one of them finishes. The sessions work on
+// the I/O thread in the same way as the session windows, the delegate is called on the thread on
+// which the job was started.
+class BatchJob
+{
+public:
+    enum class Operation
+    {
+        SYSTEM_INFO,   // Requests a category of the system information.
+        FILE_UPLOAD,   // Uploads a local file to a directory of the computer.
+        POWER_CONTROL  // Sends a power action (reboot, shutdown, etc.).
+    };
+
+    enum class State
+    {
+        WAITING,
+        CONNECTING,
+        RUNNING,
+        SUCCEEDED,
+        FAILED
+    };
+
+    struct Options
+    {
+        Operation operation = Operation::SYSTEM_INFO;
+        size_t max_sessions = 8;
+
+        // A session that is not finished within this time is failed.
+        std::chrono::seconds timeout { 300 };
+
+        // SYSTEM_INFO.
+        std::string system_info_category;
+
+        // FILE_UPLOAD. An existing file with the same name is replaced if |overwrite| is true.
+        std::string source_file;
+        std::string target_directory;
+        bool overwrite = false;
+
+        // POWER_CONTROL.
+        proto::PowerControl::Action power_action = proto::PowerControl::ACTION_REBOOT;
+    };
+
+    struct Computer
+    {
+        int computer_id = -1;
+        Config config;
+    };
+    using ComputerList = std::vector<Computer>;
+
+    class Delegate
+    {
+    public:
+        virtual ~Delegate() = default;
+
+        // Called when the state of the computer changes and when the progress of the upload
+        // changes. |percentage| is -1 if the operation has no progress.
+        virtual void onBatchJobProgress(int computer_id, State state, int percentage) = 0;
+
+        // Called once for each computer. |result| is the serialized SystemInfo for SYSTEM_INFO
+        // and empty for other operations. |message| describes the error if it failed.
+        virtual void onBatchJobResult(int computer_id, bool succeeded,
+                                      const std::string& message, const std::string& result) = 0;
+
+        virtual void onBatchJobFinished() = 0;
+    };
+
+    BatchJob(std::shared_ptr<base::TaskRunner> io_task_runner,
+             std::shared_ptr<base::TaskRunner> owner_task_runner);
+    ~BatchJob();
+
+    void start(const ComputerList& computers, const Options& options, Delegate* delegate);
+
+    // Stops all sessions. The computers that are not finished yet are not reported.
+    void stop();
+
+    size_t pendingCount() const { return pending_.size(); }
+    size_t activeCount() const { return sessions_.size(); }
+
+private:
+    class Session;
+
+    void startNextSessions();
+    void onSessionFinished(int computer_id, bool succeeded,
+                           const std::string& message, const std::string& result);
+
+    std::shared_ptr<base::TaskRunner> io_task_runner_;
+    std::shared_ptr<base::TaskRunner> owner_task_runner_;
+
+    Options options_;
+    Delegate* delegate_ = nullptr;
+
+    std::deque<Computer> pending_;
+    std::map<int, std::unique_ptr<Session>> sessions_;
+
+    DISALLOW_COPY_AND_ASSIGN(BatchJob);
+};
+
+} // namespace client
+
+#endif // CLIENT_BATCH_JOB_H
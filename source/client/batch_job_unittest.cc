@@ -0,0 +1,261 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "client/batch_job.h"
+
+#include "base/message_loop/message_loop.h"
+#include "base/net/tcp_channel.h"
+#include "base/net/tcp_server.h"
+#include "base/task_runner.h"
+
+#include <map>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace client {
+
+namespace {
+
+// Nothing listens on this port, the connections are refused.
+const uint16_t kClosedPort = 18094;
+
+// The server accepts the connections but never replies.
+const uint16_t kSilentPort = 18095;
+
+const std::chrono::seconds kTestTimeout { 10 };
+
+class SilentServer : public base::TcpServer::Delegate
+{
+public:
+    SilentServer()
+    {
+        server_.start(u"127.0.0.1", kSilentPort, this);
+    }
+
+protected:
+    // base::TcpServer::Delegate implementation.
+    void onNewConnection(std::unique_ptr<base::TcpChannel> channel) override
+    {
+        channels_.emplace_back(std::move(channel));
+    }
+
+private:
+    base::TcpServer server_;
+    std::vector<std::unique_ptr<base::TcpChannel>> channels_;
+};
+
+class TestDelegate : public BatchJob::Delegate
+{
+public:
+    explicit TestDelegate(std::shared_ptr<base::TaskRunner> task_runner)
+        : task_runner_(std::move(task_runner))
+    {
+        // Nothing
+    }
+
+    void setJob(BatchJob* job) { job_ = job; }
+
+    // The job is stopped from the first result.
+    void setStopOnResult(bool enable) { stop_on_result_ = enable; }
+
+    struct Result
+    {
+        bool succeeded = false;
+        std::string message;
+    };
+
+    const std::map<int, Result>& results() const { return results_; }
+    const std::map<int, std::vector<BatchJob::State>>& states() const { return states_; }
+    size_t maxActiveCount() const { return max_active_count_; }
+    int finishedCount() const { return finished_count_; }
+
+protected:
+    // BatchJob::Delegate implementation.
+    void onBatchJobProgress(int computer_id, BatchJob::State state, int /* percentage */) override
+    {
+        std::vector<BatchJob::State>& states = states_[computer_id];
+        if (states.empty() || states.back() != state)
+            states.emplace_back(state);
+
+        if (job_)
+            max_active_count_ = std::max(max_active_count_, job_->activeCount());
+    }
+
+    void onBatchJobResult(int computer_id, bool succeeded,
+                          const std::string& message, const std::string& /* result */) override
+    {
+        EXPECT_EQ(results_.count(computer_id), 0U);
+        results_[computer_id] = { succeeded, message };
+
+        if (stop_on_result_ && job_)
+            job_->stop();
+    }
+
+    void onBatchJobFinished() override
+    {
+        ++finished_count_;
+        task_runner_->postQuit();
+    }
+
+private:
+    std::shared_ptr<base::TaskRunner> task_runner_;
+    BatchJob* job_ = nullptr;
+    bool stop_on_result_ = false;
+
+    std::map<int, Result> results_;
+    std::map<int, std::vector<BatchJob::State>> states_;
+    size_t max_active_count_ = 0;
+    int finished_count_ = 0;
+};
+
+BatchJob::ComputerList makeComputers(int count, uint16_t port)
+{
+    BatchJob::ComputerList computers;
+
+    for (int i = 0; i < count; ++i)
+    {
+        BatchJob::Computer computer;
+        computer.computer_id = i + 1;
+        computer.config.address_or_id = u"127.0.0.1";
+        computer.config.port = port;
+        computer.config.username = u"user";
+        computer.config.password = u"password";
+
+        computers.emplace_back(std::move(computer));
+    }
+
+    return computers;
+}
+
+void runLoop(base::MessageLoop* message_loop)
+{
+    std::shared_ptr<base::TaskRunner> task_runner = message_loop->taskRunner();
+
+    // The test is failed by the missing results if the job hangs.
+    task_runner->postDelayedTask(
+        std::bind(&base::TaskRunner::postQuit, task_runner), kTestTimeout);
+    message_loop->run();
+}
+
+} // namespace
+
+TEST(BatchJobTest, EmptyList)
+{
+    base::MessageLoop message_loop(base::MessageLoop::Type::ASIO);
+    std::shared_ptr<base::TaskRunner> task_runner = message_loop.taskRunner();
+
+    TestDelegate delegate(task_runner);
+    BatchJob job(task_runner, task_runner);
+    job.start(BatchJob::ComputerList(), BatchJob::Options(), &delegate);
+
+    EXPECT_EQ(delegate.finishedCount(), 1);
+    EXPECT_TRUE(delegate.results().empty());
+    EXPECT_EQ(job.activeCount(), 0U);
+}
+
+TEST(BatchJobTest, MaxSessions)
+{
+    base::MessageLoop message_loop(base::MessageLoop::Type::ASIO);
+    std::shared_ptr<base::TaskRunner> task_runner = message_loop.taskRunner();
+
+    TestDelegate delegate(task_runner);
+    BatchJob job(task_runner, task_runner);
+    delegate.setJob(&job);
+
+    BatchJob::Options options;
+    options.max_sessions = 2;
+
+    job.start(makeComputers(5, kClosedPort), options, &delegate);
+
+    // The other computers wait until one of the sessions is finished.
+    EXPECT_EQ(job.activeCount(), 2U);
+    EXPECT_EQ(job.pendingCount(), 3U);
+
+    runLoop(&message_loop);
+
+    EXPECT_EQ(delegate.finishedCount(), 1);
+    EXPECT_EQ(delegate.maxActiveCount(), 2U);
+    EXPECT_EQ(job.activeCount(), 0U);
+    EXPECT_EQ(job.pendingCount(), 0U);
+
+    ASSERT_EQ(delegate.results().size(), 5U);
+    for (const auto& result : delegate.results())
+    {
+        EXPECT_FALSE(result.second.succeeded);
+        EXPECT_FALSE(result.second.message.empty());
+
+        const std::vector<BatchJob::State>& states = delegate.states().at(result.first);
+        ASSERT_FALSE(states.empty());
+        EXPECT_EQ(states.front(), BatchJob::State::WAITING);
+        EXPECT_EQ(states.back(), BatchJob::State::FAILED);
+    }
+}
+
+TEST(BatchJobTest, Timeout)
+{
+    base::MessageLoop message_loop(base::MessageLoop::Type::ASIO);
+    std::shared_ptr<base::TaskRunner> task_runner = message_loop.taskRunner();
+
+    SilentServer server;
+    TestDelegate delegate(task_runner);
+    BatchJob job(task_runner, task_runner);
+
+    BatchJob::Options options;
+    options.timeout = std::chrono::seconds(1);
+
+    job.start(makeComputers(2, kSilentPort), options, &delegate);
+    runLoop(&message_loop);
+
+    EXPECT_EQ(delegate.finishedCount(), 1);
+
+    ASSERT_EQ(delegate.results().size(), 2U);
+    for (const auto& result : delegate.results())
+    {
+        EXPECT_FALSE(result.second.succeeded);
+        EXPECT_EQ(result.second.message, "Operation timed out");
+    }
+}
+
+TEST(BatchJobTest, StopFromResult)
+{
+    base::MessageLoop message_loop(base::MessageLoop::Type::ASIO);
+    std::shared_ptr<base::TaskRunner> task_runner = message_loop.taskRunner();
+
+    TestDelegate delegate(task_runner);
+    BatchJob job(task_runner, task_runner);
+    delegate.setJob(&job);
+    delegate.setStopOnResult(true);
+
+    BatchJob::Options options;
+    options.max_sessions = 1;
+
+    job.start(makeComputers(3, kClosedPort), options, &delegate);
+
+    task_runner->postDelayedTask(
+        std::bind(&base::TaskRunner::postQuit, task_runner), std::chrono::seconds(2));
+    message_loop.run();
+
+    // The job is stopped after the first result, the other computers are not reported.
+    EXPECT_EQ(delegate.results().size(), 1U);
+    EXPECT_EQ(delegate.finishedCount(), 0);
+    EXPECT_EQ(job.activeCount(), 0U);
+    EXPECT_EQ(job.pendingCount(), 0U);
+}
+
+} // namespace client
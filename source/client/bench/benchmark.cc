@@ -0,0 +1,475 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "client/bench/benchmark.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+#include "base/memory/byte_array.h"
+#include "client/file_transfer_proxy.h"
+#include "client/file_transfer_window_proxy.h"
+#include "common/file_task_consumer_proxy.h"
+#include "common/file_task_producer_proxy.h"
+#include "common/file_worker.h"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+namespace client {
+
+namespace {
+
+const size_t kChunkSize = 1024 * 1024; // 1 MB
+
+const char* scenarioName(Benchmark::Scenario scenario)
+{
+    switch (scenario)
+    {
+        case Benchmark::Scenario::LARGE:
+            return "large";
+
+        case Benchmark::Scenario::SMALL:
+            return "small";
+
+        case Benchmark::Scenario::TREE:
+            return "tree";
+
+        default:
+            return "unknown";
+    }
+}
+
+double megabytes(int64_t bytes)
+{
+    return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+
+} // namespace
+
+Benchmark::Link::Link(std::shared_ptr<base::TaskRunner> task_runner,
+                      std::chrono::microseconds delay,
+                      uint64_t bandwidth)
+    : task_runner_(std::move(task_runner)),
+      delay_(delay),
+      bandwidth_(bandwidth)
+{
+    DCHECK(task_runner_);
+}
+
+void Benchmark::Link::send(size_t size, std::function<void()> deliver)
+{
+    bytes_sent_ += static_cast<int64_t>(size);
+
+    if (!delay_.count() && !bandwidth_)
+    {
+        task_runner_->postTask(std::move(deliver));
+        return;
+    }
+
+    // The link transmits one message at a time, so a message waits for the previous ones.
+    Clock::time_point now = Clock::now();
+    busy_until_ = std::max(busy_until_, now);
+
+    if (bandwidth_)
+    {
+        busy_until_ += std::chrono::microseconds(
+            static_cast<int64_t>(static_cast<uint64_t>(size) * 1000000 / bandwidth_));
+    }
+
+    queue_.push_back(Message{ busy_until_ + delay_, std::move(deliver) });
+    schedule();
+}
+
+void Benchmark::Link::schedule()
+{
+    if (is_scheduled_ || queue_.empty())
+        return;
+
+    const auto wait_time = std::chrono::ceil<std::chrono::milliseconds>(
+        queue_.front().time - Clock::now());
+
+    is_scheduled_ = true;
+
+    if (wait_time.count() <= 0)
+        task_runner_->postTask(std::bind(&Link::onTimer, this));
+    else
+        task_runner_->postDelayedTask(std::bind(&Link::onTimer, this), wait_time);
+}
+
+void Benchmark::Link::onTimer()
+{
+    is_scheduled_ = false;
+
+    Clock::time_point now = Clock::now();
+
+    while (!queue_.empty() && queue_.front().time <= now)
+    {
+        std::function<void()> deliver = std::move(queue_.front().deliver);
+        queue_.pop_front();
+        deliver();
+    }
+
+    schedule();
+}
+
+Benchmark::Benchmark(std::shared_ptr<base::TaskRunner> task_runner, const Options& options)
+    : task_runner_(task_runner),
+      options_(options),
+      task_consumer_proxy_(std::make_shared<common::FileTaskConsumerProxy>(this)),
+      task_producer_proxy_(std::make_shared<common::FileTaskProducerProxy>(this)),
+      transfer_window_proxy_(std::make_shared<FileTransferWindowProxy>(task_runner, this)),
+      local_worker_(std::make_unique<common::FileWorker>(task_runner)),
+      remote_worker_(std::make_unique<common::FileWorker>(task_runner)),
+      request_link_(task_runner, options.rtt / 2, options.bandwidth),
+      reply_link_(task_runner, options.rtt / 2, options.bandwidth)
+{
+    DCHECK(task_runner_);
+}
+
+Benchmark::~Benchmark()
+{
+    transfer_.reset();
+
+    task_consumer_proxy_->dettach();
+    task_producer_proxy_->dettach();
+    transfer_window_proxy_->dettach();
+
+    std::error_code ignored_code;
+    std::filesystem::remove_all(options_.directory, ignored_code);
+}
+
+bool Benchmark::start()
+{
+    std::cout << "Preparing the test data in " << options_.directory.u8string() << std::endl;
+
+    if (!prepareData())
+    {
+        is_succeeded_ = false;
+        return false;
+    }
+
+    std::cout << std::setw(8) << "Scenario"
+              << std::setw(10) << "Files"
+              << std::setw(12) << "MB"
+              << std::setw(10) << "Seconds"
+              << std::setw(10) << "MB/s"
+              << std::setw(12) << "Files/s"
+              << std::setw(12) << "Request MB"
+              << std::setw(12) << "Reply MB" << std::endl;
+
+    runNextScenario();
+    return true;
+}
+
+void Benchmark::doTask(std::shared_ptr<common::FileTask> task)
+{
+    if (task->target() == common::FileTask::Target::LOCAL)
+    {
+        local_worker_->doTask(std::move(task));
+        return;
+    }
+
+    // The request is serialized in the same way as for the network. The detached data of a
+    // packet is passed as is.
+    base::ByteArray buffer = base::serialize(task->request());
+    base::ByteArray data = task->takeRequestData();
+    const size_t size = buffer.size() + data.size();
+
+    remote_task_queue_.emplace(std::move(task));
+
+    request_link_.send(size, [this, buffer = std::move(buffer), data = std::move(data)]() mutable
+    {
+        std::unique_ptr<proto::FileRequest> request = std::make_unique<proto::FileRequest>();
+        if (!base::parse(buffer, request.get()))
+        {
+            LOG(LS_ERROR) << "Unable to parse the request";
+            return;
+        }
+
+        remote_worker_->doTask(std::make_shared<common::FileTask>(
+            task_producer_proxy_,
+            std::move(request),
+            common::FileTask::Target::REMOTE,
+            std::move(data)));
+    });
+}
+
+void Benchmark::onTaskDone(std::shared_ptr<common::FileTask> task)
+{
+    // The reply of the remote worker goes back through the link.
+    base::ByteArray buffer = base::serialize(task->reply());
+    base::ByteArray data = task->takeReplyData();
+    const size_t size = buffer.size() + data.size();
+
+    reply_link_.send(size, [this, buffer = std::move(buffer), data = std::move(data)]() mutable
+    {
+        if (remote_task_queue_.empty())
+        {
+            LOG(LS_ERROR) << "Reply without a request";
+            return;
+        }
+
+        std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
+        if (!base::parse(buffer, reply.get()))
+        {
+            LOG(LS_ERROR) << "Unable to parse the reply";
+            return;
+        }
+
+        remote_task_queue_.front()->setReply(std::move(reply), std::move(data));
+        remote_task_queue_.pop();
+    });
+}
+
+void Benchmark::start(std::shared_ptr<FileTransferProxy> transfer_proxy)
+{
+    transfer_proxy_ = std::move(transfer_proxy);
+}
+
+void Benchmark::stop()
+{
+    transfer_proxy_.reset();
+}
+
+void Benchmark::setCurrentItem(const std::string& /* source_path */,
+                               const std::string& /* target_path */)
+{
+    // Nothing
+}
+
+void Benchmark::setCurrentProgress(int /* total */, int /* current */)
+{
+    // Nothing
+}
+
+void Benchmark::errorOccurred(const FileTransfer::Error& error)
+{
+    LOG(LS_ERROR) << "Transfer error " << error.code() << " for " << error.path();
+
+    ++error_count_;
+
+    if (transfer_proxy_)
+        transfer_proxy_->setAction(error.type(), FileTransfer::Error::ACTION_ABORT);
+}
+
+bool Benchmark::prepareData()
+{
+    std::error_code error_code;
+    std::filesystem::remove_all(options_.directory, error_code);
+
+    std::filesystem::path source_path = options_.directory / "source";
+
+    if (!std::filesystem::create_directories(source_path, error_code) ||
+        !std::filesystem::create_directories(options_.directory / "target", error_code))
+    {
+        std::cout << "Unable to create the directories" << std::endl;
+        return false;
+    }
+
+    chunk_.resize(kChunkSize);
+
+    if (options_.compressible)
+    {
+        static const char kText[] = "The quick brown fox jumps over the lazy dog. ";
+        for (size_t i = 0; i < chunk_.size(); ++i)
+            chunk_[i] = static_cast<uint8_t>(kText[i % (sizeof(kText) - 1)]);
+    }
+    else
+    {
+        std::mt19937 generator;
+        std::uniform_int_distribution<int> distribution(0, 255);
+
+        for (size_t i = 0; i < chunk_.size(); ++i)
+            chunk_[i] = static_cast<uint8_t>(distribution(generator));
+    }
+
+    for (Scenario scenario : options_.scenarios)
+    {
+        std::filesystem::path path = source_path / scenarioName(scenario);
+
+        if (!std::filesystem::create_directory(path, error_code))
+        {
+            std::cout << "Unable to create the directory " << path.u8string() << std::endl;
+            return false;
+        }
+
+        bool result = true;
+        Totals& totals = totals_[static_cast<size_t>(scenario)];
+
+        switch (scenario)
+        {
+            case Scenario::LARGE:
+                result = writeFile(path / "large.bin", options_.large_file_size);
+                totals.files = 1;
+                totals.bytes = static_cast<int64_t>(options_.large_file_size);
+                break;
+
+            case Scenario::SMALL:
+            {
+                for (size_t i = 0; i < options_.small_file_count && result; ++i)
+                    result = writeFile(path / ("small_" + std::to_string(i) + ".bin"),
+                                       options_.small_file_size);
+
+                totals.files = static_cast<int64_t>(options_.small_file_count);
+                totals.bytes = static_cast<int64_t>(
+                    options_.small_file_count * options_.small_file_size);
+            }
+            break;
+
+            case Scenario::TREE:
+                result = writeTree(path, 0);
+                break;
+        }
+
+        if (!result)
+        {
+            std::cout << "Unable to write the test data of scenario " << scenarioName(scenario)
+                      << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Benchmark::writeFile(const std::filesystem::path& path, uint64_t size)
+{
+    std::ofstream stream(path, std::ofstream::binary);
+    if (!stream.is_open())
+        return false;
+
+    // The chunk is written from different offsets, so that the blocks of a file differ.
+    size_t offset = static_cast<size_t>(std::hash<std::string>()(path.u8string()) % kChunkSize);
+
+    while (size)
+    {
+        const size_t write_size = static_cast<size_t>(
+            std::min(size, static_cast<uint64_t>(chunk_.size() - offset)));
+
+        stream.write(reinterpret_cast<const char*>(chunk_.data() + offset),
+                     static_cast<std::streamsize>(write_size));
+        if (stream.fail())
+            return false;
+
+        size -= write_size;
+        offset = (offset + write_size) % chunk_.size();
+    }
+
+    return true;
+}
+
+bool Benchmark::writeTree(const std::filesystem::path& path, size_t depth)
+{
+    Totals& totals = totals_[static_cast<size_t>(Scenario::TREE)];
+
+    for (size_t i = 0; i < options_.tree_file_count; ++i)
+    {
+        if (!writeFile(path / ("file_" + std::to_string(i) + ".bin"), options_.tree_file_size))
+            return false;
+
+        ++totals.files;
+        totals.bytes += static_cast<int64_t>(options_.tree_file_size);
+    }
+
+    if (depth >= options_.tree_depth)
+        return true;
+
+    for (size_t i = 0; i < options_.tree_width; ++i)
+    {
+        std::filesystem::path child_path = path / ("dir_" + std::to_string(i));
+
+        std::error_code error_code;
+        if (!std::filesystem::create_directory(child_path, error_code))
+            return false;
+
+        if (!writeTree(child_path, depth + 1))
+            return false;
+    }
+
+    return true;
+}
+
+void Benchmark::runNextScenario()
+{
+    if (scenario_index_ >= options_.scenarios.size())
+    {
+        task_runner_->postQuit();
+        return;
+    }
+
+    const char* name = scenarioName(options_.scenarios[scenario_index_]);
+
+    std::error_code ignored_code;
+    std::filesystem::remove_all(options_.directory / "target" / name, ignored_code);
+
+    // The data always flows from the source directory to the target directory. The type only
+    // selects the side of the link on which the source is located.
+    std::string source_path = (options_.directory / "source").u8string();
+    std::string target_path = (options_.directory / "target").u8string();
+
+    error_count_ = 0;
+    start_request_bytes_ = request_link_.bytesSent();
+    start_reply_bytes_ = reply_link_.bytesSent();
+    start_time_ = Clock::now();
+
+    transfer_ = std::make_unique<FileTransfer>(
+        task_runner_, transfer_window_proxy_, task_consumer_proxy_, options_.type);
+
+    transfer_->start(source_path, target_path, { FileTransfer::Item(name, 0, true) }, [this]()
+    {
+        task_runner_->postTask(std::bind(&Benchmark::onScenarioFinished, this));
+    });
+}
+
+void Benchmark::onScenarioFinished()
+{
+    const double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(
+        Clock::now() - start_time_).count();
+
+    transfer_.reset();
+
+    const Scenario scenario = options_.scenarios[scenario_index_];
+    const Totals& totals = totals_[static_cast<size_t>(scenario)];
+
+    const int64_t request_bytes = request_link_.bytesSent() - start_request_bytes_;
+    const int64_t reply_bytes = reply_link_.bytesSent() - start_reply_bytes_;
+
+    std::cout << std::fixed << std::setprecision(2)
+              << std::setw(8) << scenarioName(scenario)
+              << std::setw(10) << totals.files
+              << std::setw(12) << megabytes(totals.bytes)
+              << std::setw(10) << seconds
+              << std::setw(10) << (seconds > 0 ? megabytes(totals.bytes) / seconds : 0)
+              << std::setw(12) << (seconds > 0 ? static_cast<double>(totals.files) / seconds : 0)
+              << std::setw(12) << megabytes(request_bytes)
+              << std::setw(12) << megabytes(reply_bytes) << std::endl;
+
+    if (error_count_)
+    {
+        std::cout << "Scenario " << scenarioName(scenario) << " finished with " << error_count_
+                  << " error(s)" << std::endl;
+        is_succeeded_ = false;
+    }
+
+    ++scenario_index_;
+    runNextScenario();
+}
+
+} // namespace client
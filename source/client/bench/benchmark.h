@@ -0,0 +1,187 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CLIENT_BENCH_BENCHMARK_H
+#define CLIENT_BENCH_BENCHMARK_H
+
+#include "client/file_transfer.h"
+#include "client/file_transfer_window.h"
+#include "common/file_task_consumer.h"
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <queue>
+
+namespace base {
+class TaskRunner;
+} // namespace base
+
+namespace common {
+class FileTaskConsumerProxy;
+class FileTaskProducerProxy;
+class FileWorker;
+} // namespace common
+
+namespace client {
+
+class FileTransferWindowProxy;
+
+// Runs FileTransfer between two FileWorkers in the current process. The requests of the remote
+// worker are serialized and passed through an emulated link with the configured round trip time
+// and bandwidth, so that the results do not depend on a real network.
+class Benchmark
+    : public common::FileTaskConsumer,
+      public common::FileTaskProducer,
+      public FileTransferWindow
+{
+public:
+    enum class Scenario
+    {
+        LARGE, // One large file.
+        SMALL, // Many small files in one directory.
+        TREE   // A directory tree with files of medium size.
+    };
+
+    struct Options
+    {
+        // Directory for the test data. It is removed after the benchmark.
+        std::filesystem::path directory;
+
+        std::vector<Scenario> scenarios = { Scenario::LARGE, Scenario::SMALL, Scenario::TREE };
+        FileTransfer::Type type = FileTransfer::Type::UPLOADER;
+
+        std::chrono::milliseconds rtt { 0 };
+
+        // Bandwidth of each direction of the link in bytes per second. Zero means unlimited.
+        uint64_t bandwidth = 0;
+
+        // The files are filled with text instead of random data.
+        bool compressible = false;
+
+        uint64_t large_file_size = 256 * 1024 * 1024;
+        size_t small_file_count = 2000;
+        size_t small_file_size = 4 * 1024;
+        size_t tree_depth = 3;
+        size_t tree_width = 4;
+        size_t tree_file_count = 16; // In each directory.
+        size_t tree_file_size = 32 * 1024;
+    };
+
+    Benchmark(std::shared_ptr<base::TaskRunner> task_runner, const Options& options);
+    ~Benchmark() override;
+
+    bool start();
+
+    // Returns true if all scenarios were transferred without errors.
+    bool isSucceeded() const { return is_succeeded_; }
+
+    // FileTaskConsumer implementation.
+    void doTask(std::shared_ptr<common::FileTask> task) override;
+
+protected:
+    // FileTaskProducer implementation.
+    void onTaskDone(std::shared_ptr<common::FileTask> task) override;
+
+    // FileTransferWindow implementation.
+    void start(std::shared_ptr<FileTransferProxy> transfer_proxy) override;
+    void stop() override;
+    void setCurrentItem(const std::string& source_path, const std::string& target_path) override;
+    void setCurrentProgress(int total, int current) override;
+    void errorOccurred(const FileTransfer::Error& error) override;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // One direction of the emulated link. The messages are delivered in the order of sending.
+    class Link
+    {
+    public:
+        Link(std::shared_ptr<base::TaskRunner> task_runner,
+             std::chrono::microseconds delay,
+             uint64_t bandwidth);
+
+        void send(size_t size, std::function<void()> deliver);
+        int64_t bytesSent() const { return bytes_sent_; }
+
+    private:
+        void schedule();
+        void onTimer();
+
+        struct Message
+        {
+            Clock::time_point time;
+            std::function<void()> deliver;
+        };
+
+        std::shared_ptr<base::TaskRunner> task_runner_;
+        const std::chrono::microseconds delay_;
+        const uint64_t bandwidth_;
+
+        std::deque<Message> queue_;
+        Clock::time_point busy_until_;
+        bool is_scheduled_ = false;
+        int64_t bytes_sent_ = 0;
+
+        DISALLOW_COPY_AND_ASSIGN(Link);
+    };
+
+    struct Totals
+    {
+        int64_t bytes = 0;
+        int64_t files = 0;
+    };
+
+    bool prepareData();
+    bool writeFile(const std::filesystem::path& path, uint64_t size);
+    bool writeTree(const std::filesystem::path& path, size_t depth);
+    void runNextScenario();
+    void onScenarioFinished();
+
+    std::shared_ptr<base::TaskRunner> task_runner_;
+    const Options options_;
+
+    std::shared_ptr<common::FileTaskConsumerProxy> task_consumer_proxy_;
+    std::shared_ptr<common::FileTaskProducerProxy> task_producer_proxy_;
+    std::shared_ptr<FileTransferWindowProxy> transfer_window_proxy_;
+    std::shared_ptr<FileTransferProxy> transfer_proxy_;
+
+    std::unique_ptr<common::FileWorker> local_worker_;
+    std::unique_ptr<common::FileWorker> remote_worker_;
+    std::queue<std::shared_ptr<common::FileTask>> remote_task_queue_;
+    Link request_link_;
+    Link reply_link_;
+
+    std::unique_ptr<FileTransfer> transfer_;
+    size_t scenario_index_ = 0;
+    Totals totals_[3];
+
+    Clock::time_point start_time_;
+    int64_t start_request_bytes_ = 0;
+    int64_t start_reply_bytes_ = 0;
+    size_t error_count_ = 0;
+    bool is_succeeded_ = true;
+
+    std::vector<uint8_t> chunk_;
+
+    DISALLOW_COPY_AND_ASSIGN(Benchmark);
+};
+
+} // namespace client
+
+#endif // CLIENT_BENCH_BENCHMARK_H
@@ -0,0 +1,197 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/command_line.h"
+#include "base/logging.h"
+#include "base/message_loop/message_loop.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/unicode.h"
+#include "client/bench/benchmark.h"
+
+#include <iostream>
+
+namespace {
+
+const unsigned int kMaxFileCount = 1000000;
+const unsigned int kMaxFileSize = 64 * 1024 * 1024; // 64 MB
+const unsigned int kMaxLargeFileSize = 64 * 1024; // In MB.
+
+void showHelp()
+{
+    std::cout << "aspia_file_transfer_bench [switch]" << std::endl
+        << "Available switches:" << std::endl
+        << '\t' << "--scenario=NAME" << '\t' << "large, small, tree or all (all)" << std::endl
+        << '\t' << "--download" << '\t' << "The source is on the remote side of the link"
+        << std::endl
+        << '\t' << "--rtt=MS" << '\t' << "Round trip time of the link (0)" << std::endl
+        << '\t' << "--bandwidth=N" << '\t' << "Bandwidth of the link in Mbit/s, 0 for unlimited (0)"
+        << std::endl
+        << '\t' << "--compressible" << '\t' << "Fill the files with text instead of random data"
+        << std::endl
+        << '\t' << "--dir=PATH" << '\t' << "Directory for the test data (system temp directory)"
+        << std::endl
+        << '\t' << "--large-size=MB" << '\t' << "Size of the large file (256)" << std::endl
+        << '\t' << "--small-count=N" << '\t' << "Number of small files (2000)" << std::endl
+        << '\t' << "--small-size=N" << '\t' << "Size of small files in bytes (4096)" << std::endl
+        << '\t' << "--tree-depth=N" << '\t' << "Depth of the tree (3)" << std::endl
+        << '\t' << "--tree-width=N" << '\t' << "Subdirectories in each directory of the tree (4)"
+        << std::endl
+        << '\t' << "--tree-files=N" << '\t' << "Files in each directory of the tree (16)"
+        << std::endl
+        << '\t' << "--tree-file-size=N" << '\t' << "Size of the tree files in bytes (32768)"
+        << std::endl
+        << '\t' << "--help" << '\t' << "Show help" << std::endl;
+}
+
+bool readSwitch(const base::CommandLine& command_line, std::u16string_view name,
+                unsigned int min_value, unsigned int max_value, unsigned int* value)
+{
+    if (!command_line.hasSwitch(name))
+        return true;
+
+    unsigned int result;
+    if (!base::stringToUint(command_line.switchValue(name), &result) ||
+        result < min_value || result > max_value)
+    {
+        std::cout << "Invalid value of switch --" << base::utf8FromUtf16(name) << std::endl;
+        return false;
+    }
+
+    *value = result;
+    return true;
+}
+
+bool parseOptions(const base::CommandLine& command_line, client::Benchmark::Options* options)
+{
+    unsigned int rtt = static_cast<unsigned int>(options->rtt.count());
+    unsigned int bandwidth = 0;
+    unsigned int large_size =
+        static_cast<unsigned int>(options->large_file_size / (1024 * 1024));
+    unsigned int small_count = static_cast<unsigned int>(options->small_file_count);
+    unsigned int small_size = static_cast<unsigned int>(options->small_file_size);
+    unsigned int tree_depth = static_cast<unsigned int>(options->tree_depth);
+    unsigned int tree_width = static_cast<unsigned int>(options->tree_width);
+    unsigned int tree_files = static_cast<unsigned int>(options->tree_file_count);
+    unsigned int tree_file_size = static_cast<unsigned int>(options->tree_file_size);
+
+    if (!readSwitch(command_line, u"rtt", 0, 10000, &rtt) ||
+        !readSwitch(command_line, u"bandwidth", 0, 100000, &bandwidth) ||
+        !readSwitch(command_line, u"large-size", 1, kMaxLargeFileSize, &large_size) ||
+        !readSwitch(command_line, u"small-count", 1, kMaxFileCount, &small_count) ||
+        !readSwitch(command_line, u"small-size", 0, kMaxFileSize, &small_size) ||
+        !readSwitch(command_line, u"tree-depth", 0, 8, &tree_depth) ||
+        !readSwitch(command_line, u"tree-width", 1, 16, &tree_width) ||
+        !readSwitch(command_line, u"tree-files", 0, 1000, &tree_files) ||
+        !readSwitch(command_line, u"tree-file-size", 0, kMaxFileSize, &tree_file_size))
+    {
+        return false;
+    }
+
+    if (command_line.hasSwitch(u"scenario"))
+    {
+        const std::u16string& scenario = command_line.switchValue(u"scenario");
+
+        if (scenario == u"large")
+            options->scenarios = { client::Benchmark::Scenario::LARGE };
+        else if (scenario == u"small")
+            options->scenarios = { client::Benchmark::Scenario::SMALL };
+        else if (scenario == u"tree")
+            options->scenarios = { client::Benchmark::Scenario::TREE };
+        else if (scenario != u"all")
+        {
+            std::cout << "Unknown scenario: " << base::utf8FromUtf16(scenario) << std::endl;
+            return false;
+        }
+    }
+
+    if (command_line.hasSwitch(u"dir"))
+    {
+        options->directory = command_line.switchValuePath(u"dir");
+    }
+    else
+    {
+        std::error_code error_code;
+        options->directory = std::filesystem::temp_directory_path(error_code);
+        if (error_code)
+        {
+            std::cout << "Unable to get the temp directory" << std::endl;
+            return false;
+        }
+    }
+
+    // The directory is removed after the benchmark, so the data is always placed in a subdirectory.
+    options->directory /= "aspia_file_transfer_bench";
+
+    if (command_line.hasSwitch(u"download"))
+        options->type = client::FileTransfer::Type::DOWNLOADER;
+
+    options->rtt = std::chrono::milliseconds(rtt);
+    options->bandwidth = static_cast<uint64_t>(bandwidth) * 1000 * 1000 / 8;
+    options->compressible = command_line.hasSwitch(u"compressible");
+    options->large_file_size = static_cast<uint64_t>(large_size) * 1024 * 1024;
+    options->small_file_count = small_count;
+    options->small_file_size = small_size;
+    options->tree_depth = tree_depth;
+    options->tree_width = tree_width;
+    options->tree_file_count = tree_files;
+    options->tree_file_size = tree_file_size;
+
+    return true;
+}
+
+} // namespace
+
+int main(int argc, const char* const* argv)
+{
+    base::initLogging();
+
+    base::CommandLine::init(argc, argv);
+    base::CommandLine* command_line = base::CommandLine::forCurrentProcess();
+
+    if (command_line->hasSwitch(u"help"))
+    {
+        showHelp();
+        return 0;
+    }
+
+    client::Benchmark::Options options;
+    if (!parseOptions(*command_line, &options))
+    {
+        showHelp();
+        return 1;
+    }
+
+    std::unique_ptr<base::MessageLoop> message_loop =
+        std::make_unique<base::MessageLoop>(base::MessageLoop::Type::ASIO);
+
+    std::unique_ptr<client::Benchmark> benchmark =
+        std::make_unique<client::Benchmark>(message_loop->taskRunner(), options);
+
+    bool succeeded = false;
+    if (benchmark->start())
+    {
+        message_loop->run();
+        succeeded = benchmark->isSucceeded();
+    }
+
+    benchmark.reset();
+    message_loop.reset();
+
+    base::shutdownLogging();
+    return succeeded ? 0 : 1;
+}
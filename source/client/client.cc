@@ -146,7 +146,9 @@ proto::SessionType Client::sessionType() const
     return config_.session_type;
 }
 
-void Client::sendMessage(uint8_t channel_id, const google::protobuf::MessageLite& message)
+void Client::sendMessage(uint8_t channel_id,
+                         const google::protobuf::MessageLite& message,
+                         base::TcpChannel::Priority priority)
 {
     if (!channel_)
     {
@@ -154,7 +156,31 @@ void Client::sendMessage(uint8_t channel_id, const google::protobuf::MessageLite
         return;
     }
 
-    channel_->send(channel_id, base::serialize(message));
+    channel_->send(channel_id, base::serialize(message), priority);
+}
+
+void Client::sendMessage(uint8_t channel_id,
+                         base::ByteArray&& buffer,
+                         base::TcpChannel::Priority priority)
+{
+    if (!channel_)
+    {
+        LOG(LS_WARNING) << "sendMessage called but channel not initialized";
+        return;
+    }
+
+    channel_->send(channel_id, std::move(buffer), priority);
+}
+
+void Client::shutdownSend()
+{
+    if (!channel_)
+    {
+        LOG(LS_WARNING) << "shutdownSend called but channel not initialized";
+        return;
+    }
+
+    channel_->shutdownSend();
 }
 
 int64_t Client::totalRx() const
@@ -201,6 +227,17 @@ int Client::speedTx()
     return channel_->speedTx();
 }
 
+std::chrono::microseconds Client::roundTripTime() const
+{
+    if (!channel_)
+    {
+        LOG(LS_WARNING) << "roundTripTime called but channel not initialized";
+        return std::chrono::microseconds::zero();
+    }
+
+    return channel_->roundTripTime();
+}
+
 void Client::onTcpConnected()
 {
     LOG(LS_INFO) << "Connection established";
@@ -301,6 +338,12 @@ void Client::startAuthentication()
                 channel_->setChannelIdSupport(true);
             }
 
+            if (authenticator_->peerVersion() >= base::Version(2, 7, 0))
+            {
+                LOG(LS_INFO) << "Using message batching";
+                channel_->setMessageBatching(true);
+            }
+
             status_window_proxy_->onConnected();
 
             // Signal that everything is ready to start the session (connection established,
@@ -70,13 +70,21 @@ protected:
     virtual void onSessionMessageWritten(uint8_t channel_id, size_t pending) = 0;
 
     // Sends outgoing message.
-    void sendMessage(uint8_t channel_id, const google::protobuf::MessageLite& message);
+    void sendMessage(uint8_t channel_id, const google::protobuf::MessageLite& message,
+                     base::TcpChannel::Priority priority = base::TcpChannel::Priority::NORMAL);
+    void sendMessage(uint8_t channel_id, base::ByteArray&& buffer,
+                     base::TcpChannel::Priority priority = base::TcpChannel::Priority::NORMAL);
+
+    // Shuts down the sending side of the connection. The host closes the connection after it reads
+    // all sent messages, which is reported to onTcpDisconnected.
+    void shutdownSend();
 
     // Methods for obtaining network metrics.
     int64_t totalRx() const;
     int64_t totalTx() const;
     int speedRx();
     int speedTx();
+    std::chrono::microseconds roundTripTime() const;
 
     // base::TcpChannel::Listener implementation.
     void onTcpConnected() override;
@@ -20,23 +20,35 @@
 
 #include "base/logging.h"
 #include "base/task_runner.h"
+#include "base/trace_event.h"
 #include "base/audio/audio_player.h"
-#include "base/codec/audio_decoder_opus.h"
 #include "base/codec/cursor_decoder.h"
 #include "base/codec/video_decoder.h"
-#include "base/codec/webm_file_writer.h"
-#include "base/codec/webm_video_encoder.h"
+#include "base/codec/webm_recorder.h"
+#include "base/crypto/random.h"
 #include "base/desktop/mouse_cursor.h"
+#include "base/strings/string_split.h"
 #include "client/desktop_control_proxy.h"
 #include "client/desktop_window.h"
 #include "client/desktop_window_proxy.h"
 #include "client/config_factory.h"
+#include "client/latency_stats.h"
+#include "client/video_decode_thread.h"
 #include "common/desktop_session_constants.h"
 
+#include <algorithm>
+
 namespace client {
 
 namespace {
 
+// Mouse moves are sent at most at 200 Hz.
+const std::chrono::milliseconds kMouseMoveInterval { 5 };
+
+// A mouse event is marked to measure the input latency at most once per interval. If the host does
+// not return the mark within the interval, the next event is marked.
+const std::chrono::milliseconds kInputProbeInterval { 1000 };
+
 int calculateFps(int last_fps, const std::chrono::milliseconds& duration, int64_t count)
 {
     static const double kAlpha = 0.1;
@@ -59,15 +71,24 @@ ClientDesktop::ClientDesktop(std::shared_ptr<base::TaskRunner> io_task_runner)
     : Client(io_task_runner),
       desktop_control_proxy_(std::make_shared<DesktopControlProxy>(io_task_runner, this)),
       incoming_message_(std::make_unique<proto::HostToClient>()),
-      outgoing_message_(std::make_unique<proto::ClientToHost>())
+      latency_stats_(std::make_shared<LatencyStats>()),
+      mouse_event_coalescer_(io_task_runner, kMouseMoveInterval,
+                             std::bind(&ClientDesktop::onMouseEvents, this, std::placeholders::_1))
 {
     LOG(LS_INFO) << "Ctor";
+
+    // The host can send the same packets to several clients. The marks of the other clients must
+    // not be taken for ours.
+    input_probe_id_ = base::Random::number32();
 }
 
 ClientDesktop::~ClientDesktop()
 {
     LOG(LS_INFO) << "Dtor";
     desktop_control_proxy_->dettach();
+
+    // The trace of the ended session is written if tracing is enabled.
+    base::TraceLog::instance().dump();
 }
 
 void ClientDesktop::setDesktopWindow(std::shared_ptr<DesktopWindowProxy> desktop_window_proxy)
@@ -89,6 +110,10 @@ void ClientDesktop::onSessionStarted(const base::Version& peer_version)
     clipboard_monitor_->start(ioTaskRunner(), this);
 
     audio_player_ = base::AudioPlayer::create();
+    desktop_window_proxy_->setLatencyStats(latency_stats_);
+    video_decode_thread_ =
+        std::make_unique<VideoDecodeThread>(desktop_window_proxy_, latency_stats_);
+    video_decode_thread_->setHighPriority(is_window_active_);
 }
 
 void ClientDesktop::onSessionMessageReceived(uint8_t /* channel_id */, const base::ByteArray& buffer)
@@ -104,7 +129,10 @@ void ClientDesktop::onSessionMessageReceived(uint8_t /* channel_id */, const bas
     if (incoming_message_->has_video_packet() || incoming_message_->has_cursor_shape())
     {
         if (incoming_message_->has_video_packet())
-            readVideoPacket(incoming_message_->video_packet());
+        {
+            readVideoPacket(std::unique_ptr<proto::VideoPacket>(
+                incoming_message_->release_video_packet()));
+        }
 
         if (incoming_message_->has_cursor_shape())
             readCursorShape(incoming_message_->cursor_shape());
@@ -150,9 +178,10 @@ void ClientDesktop::onClipboardEvent(const proto::ClipboardEvent& event)
     if (!out_event.has_value())
         return;
 
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
     outgoing_message_->mutable_clipboard_event()->CopyFrom(*out_event);
-    sendMessage(proto::HOST_CHANNEL_ID_SESSION, *outgoing_message_);
+    sendMessage(proto::HOST_CHANNEL_ID_SESSION, *outgoing_message_,
+                base::TcpChannel::Priority::LOW);
 }
 
 void ClientDesktop::setDesktopConfig(const proto::DesktopConfig& desktop_config)
@@ -176,9 +205,21 @@ void ClientDesktop::setDesktopConfig(const proto::DesktopConfig& desktop_config)
     }
 
     input_event_filter_.setClipboardEnabled(desktop_config_.flags() & proto::ENABLE_CLIPBOARD);
+    video_decode_thread_->setMultithreadedDecoding(
+        desktop_config_.flags() & proto::VP9_MULTITHREADED);
+
+    if (audio_player_)
+        audio_player_->setLowLatency(desktop_config_.flags() & proto::LOW_LATENCY_AUDIO);
+
+    outgoing_message_.clear();
 
-    outgoing_message_->Clear();
-    outgoing_message_->mutable_config()->CopyFrom(desktop_config_);
+    proto::DesktopConfig* config = outgoing_message_->mutable_config();
+    config->CopyFrom(desktop_config_);
+
+    // The flags are not stored in the configuration, they report the capabilities of the decoder.
+    config->set_flags(config->flags() | proto::ZSTD_SLICES | proto::ZSTD_STREAM |
+                      proto::COPY_RECTS | proto::SCREEN_STREAMS | proto::LARGE_CURSOR_CACHE |
+                      proto::ZSTD_PALETTE | proto::PACKED_RECTS);
 
     LOG(LS_INFO) << "Send new config to host";
     sendMessage(proto::HOST_CHANNEL_ID_SESSION, *outgoing_message_);
@@ -188,7 +229,7 @@ void ClientDesktop::setCurrentScreen(const proto::Screen& screen)
 {
     LOG(LS_INFO) << "Current screen changed: " << screen.id();
 
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
     proto::DesktopExtension* extension = outgoing_message_->mutable_extension();
 
     extension->set_name(common::kSelectScreenExtension);
@@ -201,7 +242,7 @@ void ClientDesktop::setPreferredSize(int width, int height)
 {
     LOG(LS_INFO) << "Preferred size changed: " << width << "x" << height;
 
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
 
     proto::PreferredSize preferred_size;
     preferred_size.set_width(width);
@@ -230,7 +271,7 @@ void ClientDesktop::setVideoPause(bool enable)
         ++video_resume_count_;
     }
 
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
 
     proto::Pause pause;
     pause.set_enable(enable);
@@ -258,7 +299,7 @@ void ClientDesktop::setAudioPause(bool enable)
         ++audio_resume_count_;
     }
 
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
 
     proto::Pause pause;
     pause.set_enable(enable);
@@ -271,6 +312,16 @@ void ClientDesktop::setAudioPause(bool enable)
     sendMessage(proto::HOST_CHANNEL_ID_SESSION, *outgoing_message_);
 }
 
+void ClientDesktop::setWindowActive(bool active)
+{
+    LOG(LS_INFO) << "Window active: " << active;
+
+    is_window_active_ = active;
+
+    if (video_decode_thread_)
+        video_decode_thread_->setHighPriority(active);
+}
+
 void ClientDesktop::setVideoRecording(bool enable, const std::filesystem::path& file_path)
 {
     proto::VideoRecording video_recording;
@@ -279,20 +330,22 @@ void ClientDesktop::setVideoRecording(bool enable, const std::filesystem::path&
     {
         video_recording.set_action(proto::VideoRecording::ACTION_STARTED);
 
-        webm_file_writer_ = std::make_unique<base::WebmFileWriter>(file_path, computerName());
-        webm_video_encoder_ = std::make_unique<base::WebmVideoEncoder>();
+        webm_recorder_ = std::make_unique<base::WebmRecorder>(file_path, computerName());
+        recording_passthrough_ = false;
 
         webm_video_encode_timer_ = std::make_unique<base::WaitableTimer>(
             base::WaitableTimer::Type::REPEATED, ioTaskRunner());
         webm_video_encode_timer_->start(std::chrono::milliseconds(60), [this]()
         {
-            if (!webm_video_encoder_ || !webm_file_writer_ || !desktop_frame_)
+            if (!webm_recorder_ || !video_decode_thread_ || recording_passthrough_)
                 return;
 
-            proto::VideoPacket packet;
+            std::shared_ptr<base::Frame> frame = video_decode_thread_->frame();
+            if (!frame)
+                return;
 
-            if (webm_video_encoder_->encode(*desktop_frame_, &packet))
-                webm_file_writer_->addVideoPacket(packet);
+            // The frame is encoded on the recording thread.
+            webm_recorder_->addFrame(std::move(frame));
         });
     }
     else
@@ -300,11 +353,12 @@ void ClientDesktop::setVideoRecording(bool enable, const std::filesystem::path&
         video_recording.set_action(proto::VideoRecording::ACTION_STOPPED);
 
         webm_video_encode_timer_.reset();
-        webm_video_encoder_.reset();
-        webm_file_writer_.reset();
+
+        // Waits for the queued packets to be written.
+        webm_recorder_.reset();
     }
 
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
     proto::DesktopExtension* extension = outgoing_message_->mutable_extension();
 
     extension->set_name(common::kVideoRecordingExtension);
@@ -319,10 +373,12 @@ void ClientDesktop::onKeyEvent(const proto::KeyEvent& event)
     if (!out_event.has_value())
         return;
 
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
     outgoing_message_->mutable_key_event()->CopyFrom(*out_event);
 
-    sendMessage(proto::HOST_CHANNEL_ID_SESSION, *outgoing_message_);
+    // Input events are written before other queued messages to keep the input latency low.
+    sendMessage(proto::HOST_CHANNEL_ID_SESSION, *outgoing_message_,
+                base::TcpChannel::Priority::HIGH);
 }
 
 void ClientDesktop::onTextEvent(const proto::TextEvent& event)
@@ -331,10 +387,11 @@ void ClientDesktop::onTextEvent(const proto::TextEvent& event)
     if (!out_event.has_value())
         return;
 
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
     outgoing_message_->mutable_text_event()->CopyFrom(*out_event);
 
-    sendMessage(proto::HOST_CHANNEL_ID_SESSION, *outgoing_message_);
+    sendMessage(proto::HOST_CHANNEL_ID_SESSION, *outgoing_message_,
+                base::TcpChannel::Priority::HIGH);
 }
 
 void ClientDesktop::onMouseEvent(const proto::MouseEvent& event)
@@ -343,10 +400,32 @@ void ClientDesktop::onMouseEvent(const proto::MouseEvent& event)
     if (!out_event.has_value())
         return;
 
-    outgoing_message_->Clear();
-    outgoing_message_->mutable_mouse_event()->CopyFrom(*out_event);
+    mouse_event_coalescer_.addEvent(*out_event);
+}
 
-    sendMessage(proto::HOST_CHANNEL_ID_SESSION, *outgoing_message_);
+void ClientDesktop::onMouseEvents(const std::vector<proto::MouseEvent>& events)
+{
+    for (const auto& event : events)
+    {
+        outgoing_message_.clear();
+
+        proto::MouseEvent* mouse_event = outgoing_message_->mutable_mouse_event();
+        mouse_event->CopyFrom(event);
+
+        const TimePoint now = Clock::now();
+        if (now - input_probe_time_ >= kInputProbeInterval)
+        {
+            if (!++input_probe_id_)
+                ++input_probe_id_;
+
+            input_probe_time_ = now;
+            is_input_probe_pending_ = true;
+            mouse_event->set_input_id(input_probe_id_);
+        }
+
+        sendMessage(proto::HOST_CHANNEL_ID_SESSION, *outgoing_message_,
+                    base::TcpChannel::Priority::HIGH);
+    }
 }
 
 void ClientDesktop::onPowerControl(proto::PowerControl::Action action)
@@ -357,7 +436,7 @@ void ClientDesktop::onPowerControl(proto::PowerControl::Action action)
         return;
     }
 
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
     proto::DesktopExtension* extension = outgoing_message_->mutable_extension();
 
     proto::PowerControl power_control;
@@ -371,14 +450,14 @@ void ClientDesktop::onPowerControl(proto::PowerControl::Action action)
 
 void ClientDesktop::onRemoteUpdate()
 {
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
     outgoing_message_->mutable_extension()->set_name(common::kRemoteUpdateExtension);
     sendMessage(proto::HOST_CHANNEL_ID_SESSION, *outgoing_message_);
 }
 
 void ClientDesktop::onSystemInfoRequest(const proto::system_info::SystemInfoRequest& request)
 {
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
     proto::DesktopExtension* extension = outgoing_message_->mutable_extension();
     extension->set_name(common::kSystemInfoExtension);
     extension->set_data(request.SerializeAsString());
@@ -388,7 +467,7 @@ void ClientDesktop::onSystemInfoRequest(const proto::system_info::SystemInfoRequ
 
 void ClientDesktop::onTaskManager(const proto::task_manager::ClientToHost& message)
 {
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
     proto::DesktopExtension* extension = outgoing_message_->mutable_extension();
     extension->set_name(common::kTaskManagerExtension);
     extension->set_data(message.SerializeAsString());
@@ -400,11 +479,16 @@ void ClientDesktop::onMetricsRequest()
 {
     TimePoint current_time = Clock::now();
 
+    // The frames are counted by the decoding thread.
+    int64_t fps_frame_count = 0;
+    if (video_decode_thread_)
+        fps_frame_count = video_decode_thread_->takeDecodedFrameCount();
+
     if (fps_time_ != TimePoint())
     {
         std::chrono::milliseconds fps_duration =
             std::chrono::duration_cast<std::chrono::milliseconds>(current_time - fps_time_);
-        fps_ = calculateFps(fps_, fps_duration, fps_frame_count_);
+        fps_ = calculateFps(fps_, fps_duration, fps_frame_count);
     }
     else
     {
@@ -412,7 +496,12 @@ void ClientDesktop::onMetricsRequest()
     }
 
     fps_time_ = current_time;
-    fps_frame_count_ = 0;
+
+    // The clocks of the host and the client are not synchronized, so the network time is
+    // estimated from the round trip time of the keep alive packets.
+    std::chrono::microseconds round_trip_time = roundTripTime();
+    if (round_trip_time != std::chrono::microseconds::zero())
+        latency_stats_->addSample(LatencyStats::Stage::NETWORK, round_trip_time / 2);
 
     std::chrono::seconds session_duration =
         std::chrono::duration_cast<std::chrono::seconds>(current_time - start_time_);
@@ -444,8 +533,10 @@ void ClientDesktop::onMetricsRequest()
 
     metrics.video_capturer_type = video_capturer_type_;
     metrics.fps = fps_;
-    metrics.send_mouse = input_event_filter_.sendMouseCount();
-    metrics.drop_mouse = input_event_filter_.dropMouseCount();
+    metrics.send_mouse =
+        input_event_filter_.sendMouseCount() - mouse_event_coalescer_.coalescedCount();
+    metrics.drop_mouse =
+        input_event_filter_.dropMouseCount() + mouse_event_coalescer_.coalescedCount();
     metrics.send_key   = input_event_filter_.sendKeyCount();
     metrics.send_text  = input_event_filter_.sendTextCount();
     metrics.read_clipboard = input_event_filter_.readClipboardCount();
@@ -459,6 +550,8 @@ void ClientDesktop::onMetricsRequest()
         metrics.cursor_taken_from_cache = cursor_decoder_->takenCursorsFromCache();
     }
 
+    metrics.latency = latency_stats_->takeMetrics();
+
     desktop_window_proxy_->setMetrics(metrics);
 }
 
@@ -471,8 +564,23 @@ void ClientDesktop::readConfigRequest(const proto::DesktopConfigRequest& config_
     desktop_window_proxy_->setCapabilities(
         config_request.extensions(), config_request.video_encodings());
 
-    // If current video encoding not supported.
-    if (!(config_request.video_encodings() & static_cast<uint32_t>(desktop_config_.video_encoding())))
+    // Older hosts do not send key frames on request, so the frames cannot be dropped.
+    if (video_decode_thread_)
+    {
+        std::vector<std::string_view> extensions = base::splitStringView(
+            config_request.extensions(), ";", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
+
+        video_decode_thread_->setFrameDroppingEnabled(
+            std::find(extensions.begin(), extensions.end(), common::kKeyFrameExtension) !=
+            extensions.end());
+    }
+
+    // If current video encoding is not supported by the host or can't be decoded here (for
+    // example, the hardware decoder has been removed since the encoding was selected).
+    const uint32_t video_encodings =
+        config_request.video_encodings() & base::VideoDecoder::supportedEncodings();
+
+    if (!(video_encodings & static_cast<uint32_t>(desktop_config_.video_encoding())))
     {
         LOG(LS_WARNING) << "Current video encoding not supported";
 
@@ -486,113 +594,76 @@ void ClientDesktop::readConfigRequest(const proto::DesktopConfigRequest& config_
     }
 }
 
-void ClientDesktop::readVideoPacket(const proto::VideoPacket& packet)
+void ClientDesktop::readVideoPacket(std::unique_ptr<proto::VideoPacket> packet)
 {
-    proto::VideoErrorCode error_code = packet.error_code();
-    if (error_code != proto::VIDEO_ERROR_CODE_OK)
+    if (!video_decode_thread_)
     {
-        LOG(LS_WARNING) << "Video error detected: " << error_code;
-        desktop_window_proxy_->setFrameError(error_code);
+        LOG(LS_ERROR) << "Video decoding not started";
         return;
     }
 
-    if (video_encoding_ != packet.encoding())
+    if (packet->error_code() == proto::VIDEO_ERROR_CODE_OK)
     {
-        video_decoder_ = base::VideoDecoder::create(packet.encoding());
-        video_encoding_ = packet.encoding();
-
-        LOG(LS_INFO) << "Video encoding changed to: " << video_encoding_;
-    }
-
-    if (!video_decoder_)
-    {
-        LOG(LS_ERROR) << "Video decoder not initialized";
-        return;
-    }
-
-    if (packet.has_format())
-    {
-        const proto::VideoPacketFormat& format = packet.format();
-        base::Size video_size(format.video_rect().width(), format.video_rect().height());
-        base::Size screen_size = video_size;
-
-        static const int kMaxValue = std::numeric_limits<uint16_t>::max();
-
-        if (video_size.width()  <= 0 || video_size.width()  >= kMaxValue ||
-            video_size.height() <= 0 || video_size.height() >= kMaxValue)
+        if (packet->has_format())
         {
-            LOG(LS_ERROR) << "Wrong video frame size: "
-                          << video_size.width() << "x" << video_size.height();
-            return;
+            video_capturer_type_ = packet->format().capturer_type();
+            LOG(LS_INFO) << "New video capturer: " << video_capturer_type_;
+
+            const proto::Rect& video_rect = packet->format().video_rect();
+            video_size_ = base::Size(video_rect.width(), video_rect.height());
         }
 
-        if (format.has_screen_size())
+        if (webm_recorder_)
         {
-            screen_size = base::Size(
-                format.screen_size().width(), format.screen_size().height());
-
-            if (screen_size.width() <= 0 || screen_size.width() >= kMaxValue ||
-                screen_size.height() <= 0 || screen_size.height() >= kMaxValue)
-            {
-                LOG(LS_ERROR) << "Wrong screen size: "
-                              << screen_size.width() << "x" << screen_size.height();
-                return;
-            }
+            recording_passthrough_ = base::WebmRecorder::isPassthroughPacket(*packet);
+
+            if (recording_passthrough_ && webm_recorder_->addVideoPacket(*packet, video_size_))
+                sendKeyFrameRequest();
         }
 
-        video_capturer_type_ = format.capturer_type();
+        ++video_packet_count_;
 
-        LOG(LS_INFO) << "New video size: " << video_size.width() << "x" << video_size.height();
-        LOG(LS_INFO) << "New screen size: " << screen_size.width() << "x" << screen_size.height();
-        LOG(LS_INFO) << "New video capturer: " << video_capturer_type_;
+        size_t packet_size = packet->ByteSizeLong();
 
-        desktop_frame_ = desktop_window_proxy_->allocateFrame(video_size);
-        desktop_window_proxy_->setFrame(screen_size, desktop_frame_);
-    }
+        avg_video_packet_ = calculateAvgSize(avg_video_packet_, packet_size);
+        min_video_packet_ = std::min(min_video_packet_, packet_size);
+        max_video_packet_ = std::max(max_video_packet_, packet_size);
 
-    if (!desktop_frame_)
-    {
-        LOG(LS_ERROR) << "The desktop frame is not initialized";
-        return;
-    }
+        // Older hosts do not return the marks of the mouse events.
+        if (is_input_probe_pending_ && packet->input_id() == input_probe_id_)
+        {
+            latency_stats_->addSample(LatencyStats::Stage::INPUT,
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    Clock::now() - input_probe_time_));
+            is_input_probe_pending_ = false;
+        }
 
-    if (!video_decoder_->decode(packet, desktop_frame_.get()))
-    {
-        LOG(LS_ERROR) << "The video packet could not be decoded";
-        return;
+        // Older hosts do not send the timings.
+        if (packet->host_time())
+        {
+            latency_stats_->addSample(LatencyStats::Stage::CAPTURE,
+                                      std::chrono::microseconds(packet->capture_time()));
+            latency_stats_->addSample(LatencyStats::Stage::ENCODE,
+                                      std::chrono::microseconds(packet->encode_time()));
+            latency_stats_->addSample(LatencyStats::Stage::HOST,
+                                      std::chrono::microseconds(packet->host_time()));
+        }
     }
 
-    ++video_packet_count_;
-    ++fps_frame_count_;
-
-    size_t packet_size = packet.ByteSizeLong();
-
-    avg_video_packet_ = calculateAvgSize(avg_video_packet_, packet_size);
-    min_video_packet_ = std::min(min_video_packet_, packet_size);
-    max_video_packet_ = std::max(max_video_packet_, packet_size);
-
-    desktop_window_proxy_->drawFrame();
+    // The packet is decoded on a separate thread. If the decoder is behind, the packets are
+    // dropped and a key frame is requested.
+    if (video_decode_thread_->addPacket(std::move(packet)))
+        sendKeyFrameRequest();
 }
 
 void ClientDesktop::readAudioPacket(const proto::AudioPacket& packet)
 {
-    if (webm_file_writer_)
-        webm_file_writer_->addAudioPacket(packet);
+    if (webm_recorder_)
+        webm_recorder_->addAudioPacket(packet);
 
     if (!audio_player_)
         return;
 
-    if (packet.encoding() != audio_encoding_)
-    {
-        audio_decoder_ = base::AudioDecoder::create(packet.encoding());
-        audio_encoding_ = packet.encoding();
-
-        LOG(LS_INFO) << "Audio encoding changed to: " << audio_encoding_;
-    }
-
-    if (!audio_decoder_)
-        return;
-
     size_t packet_size = packet.ByteSizeLong();
 
     avg_audio_packet_ = calculateAvgSize(avg_audio_packet_, packet_size);
@@ -601,9 +672,8 @@ void ClientDesktop::readAudioPacket(const proto::AudioPacket& packet)
 
     ++audio_packet_count_;
 
-    std::unique_ptr<proto::AudioPacket> decoded_packet = audio_decoder_->decode(packet);
-    if (decoded_packet)
-        audio_player_->addPacket(std::move(decoded_packet));
+    // The packet is decoded by the player, so that the decoder can conceal the lost data.
+    audio_player_->addPacket(std::make_unique<proto::AudioPacket>(packet));
 }
 
 void ClientDesktop::readCursorShape(const proto::CursorShape& cursor_shape)
@@ -725,4 +795,13 @@ void ClientDesktop::readExtension(const proto::DesktopExtension& extension)
     }
 }
 
+void ClientDesktop::sendKeyFrameRequest()
+{
+    outgoing_message_.clear();
+    proto::DesktopExtension* extension = outgoing_message_->mutable_extension();
+    extension->set_name(common::kKeyFrameExtension);
+
+    sendMessage(proto::HOST_CHANNEL_ID_SESSION, *outgoing_message_);
+}
+
 } // namespace client
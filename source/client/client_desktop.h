@@ -20,20 +20,19 @@
 #define CLIENT_CLIENT_DESKTOP_H
 
 #include "base/macros_magic.h"
+#include "base/desktop/geometry.h"
+#include "base/memory/arena_message.h"
 #include "client/client.h"
 #include "client/desktop_control.h"
 #include "client/input_event_filter.h"
 #include "common/clipboard_monitor.h"
+#include "common/mouse_event_coalescer.h"
 
 namespace base {
-class AudioDecoder;
 class AudioPlayer;
 class CursorDecoder;
-class Frame;
-class VideoDecoder;
 class WaitableTimer;
-class WebmFileWriter;
-class WebmVideoEncoder;
+class WebmRecorder;
 } // namespace base
 
 namespace client {
@@ -42,6 +41,8 @@ class AudioRenderer;
 class DesktopControlProxy;
 class DesktopWindow;
 class DesktopWindowProxy;
+class LatencyStats;
+class VideoDecodeThread;
 
 class ClientDesktop
     : public Client,
@@ -60,6 +61,7 @@ public:
     void setPreferredSize(int width, int height) override;
     void setVideoPause(bool enable) override;
     void setAudioPause(bool enable) override;
+    void setWindowActive(bool active) override;
     void setVideoRecording(bool enable, const std::filesystem::path& file_path) override;
     void onKeyEvent(const proto::KeyEvent& event) override;
     void onTextEvent(const proto::TextEvent& event) override;
@@ -81,37 +83,42 @@ protected:
 
 private:
     void readConfigRequest(const proto::DesktopConfigRequest& config_request);
-    void readVideoPacket(const proto::VideoPacket& packet);
+    void readVideoPacket(std::unique_ptr<proto::VideoPacket> packet);
     void readAudioPacket(const proto::AudioPacket& packet);
     void readCursorShape(const proto::CursorShape& cursor_shape);
     void readCursorPosition(const proto::CursorPosition& cursor_position);
     void readClipboardEvent(const proto::ClipboardEvent& event);
     void readExtension(const proto::DesktopExtension& extension);
+    void sendKeyFrameRequest();
+    void onMouseEvents(const std::vector<proto::MouseEvent>& events);
 
     bool started_ = false;
 
     std::shared_ptr<DesktopControlProxy> desktop_control_proxy_;
     std::shared_ptr<DesktopWindowProxy> desktop_window_proxy_;
-    std::shared_ptr<base::Frame> desktop_frame_;
     proto::DesktopConfig desktop_config_;
 
     std::unique_ptr<proto::HostToClient> incoming_message_;
-    std::unique_ptr<proto::ClientToHost> outgoing_message_;
+    base::ArenaMessage<proto::ClientToHost> outgoing_message_;
 
-    proto::VideoEncoding video_encoding_ = proto::VIDEO_ENCODING_UNKNOWN;
-    proto::AudioEncoding audio_encoding_ = proto::AUDIO_ENCODING_UNKNOWN;
-
-    std::unique_ptr<base::VideoDecoder> video_decoder_;
+    std::shared_ptr<LatencyStats> latency_stats_;
+    std::unique_ptr<VideoDecodeThread> video_decode_thread_;
     std::unique_ptr<base::CursorDecoder> cursor_decoder_;
-    std::unique_ptr<base::AudioDecoder> audio_decoder_;
     std::unique_ptr<base::AudioPlayer> audio_player_;
     std::unique_ptr<common::ClipboardMonitor> clipboard_monitor_;
 
     InputEventFilter input_event_filter_;
 
+    // High polling rate mice generate more moves than the host can show.
+    common::MouseEventCoalescer mouse_event_coalescer_;
+
+    // The VP8 and VP9 packets are recorded as they are received. Other encodings are recorded
+    // from the decoded frames by the timer.
     std::unique_ptr<base::WaitableTimer> webm_video_encode_timer_;
-    std::unique_ptr<base::WebmVideoEncoder> webm_video_encoder_;
-    std::unique_ptr<base::WebmFileWriter> webm_file_writer_;
+    std::unique_ptr<base::WebmRecorder> webm_recorder_;
+    bool recording_passthrough_ = false;
+    base::Size video_size_;
+    bool is_window_active_ = false;
 
     using Clock = std::chrono::high_resolution_clock;
     using TimePoint = std::chrono::time_point<Clock>;
@@ -125,7 +132,6 @@ private:
     uint32_t video_capturer_type_ = 0;
     TimePoint start_time_;
     TimePoint fps_time_;
-    int64_t fps_frame_count_ = 0;
     size_t min_video_packet_ = std::numeric_limits<size_t>::max();
     size_t max_video_packet_ = 0;
     size_t avg_video_packet_ = 0;
@@ -136,6 +142,10 @@ private:
     int cursor_shape_count_ = 0;
     int cursor_pos_count_ = 0;
 
+    uint32_t input_probe_id_ = 0;
+    bool is_input_probe_pending_ = false;
+    TimePoint input_probe_time_;
+
     DISALLOW_COPY_AND_ASSIGN(ClientDesktop);
 };
 
@@ -29,6 +29,14 @@
 
 namespace client {
 
+namespace {
+
+// Large directories are listed in pages, so that the host does not stall on a single huge reply
+// and the panel shows the first items quickly.
+const uint32_t kFileListPageSize = 4096;
+
+} // namespace
+
 ClientFileTransfer::ClientFileTransfer(std::shared_ptr<base::TaskRunner> io_task_runner)
     : Client(io_task_runner),
       task_consumer_proxy_(std::make_shared<common::FileTaskConsumerProxy>(this)),
@@ -73,6 +81,20 @@ void ClientFileTransfer::onSessionStarted(const base::Version& /* peer_version *
 void ClientFileTransfer::onSessionMessageReceived(
     uint8_t /* channel_id */, const base::ByteArray& buffer)
 {
+    if (detached_reply_)
+    {
+        // The message contains the data of the previous reply.
+        if (remote_task_queue_.empty())
+        {
+            file_manager_window_proxy_->onErrorOccurred(proto::FILE_ERROR_UNKNOWN);
+            return;
+        }
+
+        remote_task_queue_.front()->setReply(std::move(detached_reply_), base::ByteArray(buffer));
+        remote_task_queue_.pop();
+        return;
+    }
+
     std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
 
     if (!reply->ParseFromArray(buffer.data(), static_cast<int>(buffer.size())))
@@ -85,6 +107,11 @@ void ClientFileTransfer::onSessionMessageReceived(
     {
         file_manager_window_proxy_->onErrorOccurred(reply->error_code());
     }
+    else if (reply->packet().flags() & proto::FilePacket::DETACHED_DATA)
+    {
+        // The reply is completed by the next message.
+        detached_reply_ = std::move(reply);
+    }
     else if (!remote_task_queue_.empty())
     {
         // Move the reply to the request and notify the sender.
@@ -92,9 +119,6 @@ void ClientFileTransfer::onSessionMessageReceived(
 
         // Remove the request from the queue.
         remote_task_queue_.pop();
-
-        // Execute the next request.
-        doNextRemoteTask();
     }
     else
     {
@@ -119,8 +143,7 @@ void ClientFileTransfer::onTaskDone(std::shared_ptr<common::FileTask> task)
     }
     else if (request.has_file_list_request())
     {
-        file_manager_window_proxy_->onFileList(
-            task->target(), reply.error_code(), reply.file_list());
+        onFileListReply(task->target(), request.file_list_request(), reply);
     }
     else if (request.has_create_directory_request())
     {
@@ -136,32 +159,68 @@ void ClientFileTransfer::onTaskDone(std::shared_ptr<common::FileTask> task)
     }
 }
 
-void ClientFileTransfer::doTask(std::shared_ptr<common::FileTask> task)
+void ClientFileTransfer::onFileListReply(common::FileTask::Target target,
+                                         const proto::FileListRequest& request,
+                                         const proto::FileReply& reply)
 {
-    if (task->target() == common::FileTask::Target::LOCAL)
+    ListState& state = listState(target);
+
+    DCHECK_GT(state.pending_count, 0U);
+    --state.pending_count;
+
+    if (state.stale_count)
     {
-        local_worker_->doTask(std::move(task));
+        // The reply belongs to a listing that was replaced by a newer one.
+        --state.stale_count;
+        return;
+    }
+
+    if (!request.next())
+    {
+        file_manager_window_proxy_->onFileList(target, reply.error_code(), reply.file_list());
     }
     else
     {
-        const bool schedule = remote_task_queue_.empty();
-
-        // Add the request to the queue.
-        remote_task_queue_.emplace(std::move(task));
+        file_manager_window_proxy_->onFileListPage(target, reply.error_code(), reply.file_list());
+    }
 
-        // If the request queue was empty, then run execution.
-        if (schedule)
-            doNextRemoteTask();
+    if (reply.error_code() == proto::FILE_ERROR_SUCCESS && reply.file_list().has_more())
+    {
+        ++state.pending_count;
+        task_consumer_proxy_->doTask(
+            taskFactory(target)->fileList(request.path(), kFileListPageSize, true));
     }
 }
 
-void ClientFileTransfer::doNextRemoteTask()
+ClientFileTransfer::ListState& ClientFileTransfer::listState(common::FileTask::Target target)
 {
-    if (remote_task_queue_.empty())
-        return;
+    if (target == common::FileTask::Target::LOCAL)
+        return local_list_state_;
 
-    // Send a request to the remote computer.
-    sendMessage(proto::HOST_CHANNEL_ID_SESSION, remote_task_queue_.front()->request());
+    DCHECK_EQ(target, common::FileTask::Target::REMOTE);
+    return remote_list_state_;
+}
+
+void ClientFileTransfer::doTask(std::shared_ptr<common::FileTask> task)
+{
+    if (task->target() == common::FileTask::Target::LOCAL)
+    {
+        local_worker_->doTask(std::move(task));
+    }
+    else
+    {
+        // The host executes the requests one by one and replies in the same order, so the request
+        // is sent without waiting for the previous replies. This keeps several file packets in
+        // flight.
+        sendMessage(proto::HOST_CHANNEL_ID_SESSION, task->request());
+
+        // The data of the packet follows the request as is.
+        if (task->request().packet().flags() & proto::FilePacket::DETACHED_DATA)
+            sendMessage(proto::HOST_CHANNEL_ID_SESSION, task->takeRequestData());
+
+        // Add the request to the queue of the requests waiting for a reply.
+        remote_task_queue_.emplace(std::move(task));
+    }
 }
 
 common::FileTaskFactory* ClientFileTransfer::taskFactory(common::FileTask::Target target)
@@ -189,7 +248,14 @@ void ClientFileTransfer::driveList(common::FileTask::Target target)
 
 void ClientFileTransfer::fileList(common::FileTask::Target target, const std::string& path)
 {
-    task_consumer_proxy_->doTask(taskFactory(target)->fileList(path));
+    ListState& state = listState(target);
+
+    // The replies come in the order of the requests, so all the replies that are still pending
+    // belong to the previous listing.
+    state.stale_count = state.pending_count;
+    ++state.pending_count;
+
+    task_consumer_proxy_->doTask(taskFactory(target)->fileList(path, kFileListPageSize));
 }
 
 void ClientFileTransfer::createDirectory(common::FileTask::Target target, const std::string& path)
@@ -34,6 +34,7 @@ class FileWorker;
 } // namespace common
 
 namespace proto {
+class FileListRequest;
 class FileReply;
 } // namespace proto
 
@@ -67,8 +68,19 @@ protected:
     void onTaskDone(std::shared_ptr<common::FileTask> task) override;
 
 private:
-    void doNextRemoteTask();
-
+    struct ListState
+    {
+        // Number of file list requests waiting for a reply.
+        size_t pending_count = 0;
+
+        // Number of the pending requests whose replies must be ignored.
+        size_t stale_count = 0;
+    };
+
+    void onFileListReply(common::FileTask::Target target,
+                         const proto::FileListRequest& request,
+                         const proto::FileReply& reply);
+    ListState& listState(common::FileTask::Target target);
     common::FileTaskFactory* taskFactory(common::FileTask::Target target);
 
     // FileControl implementation.
@@ -94,6 +106,9 @@ private:
     std::unique_ptr<common::FileTaskFactory> remote_task_factory_;
 
     std::queue<std::shared_ptr<common::FileTask>> remote_task_queue_;
+
+    // Reply whose packet data is expected in the next message.
+    std::unique_ptr<proto::FileReply> detached_reply_;
     std::unique_ptr<common::FileWorker> local_worker_;
 
     std::shared_ptr<FileControlProxy> file_control_proxy_;
@@ -101,6 +116,9 @@ private:
     std::unique_ptr<FileRemover> remover_;
     std::unique_ptr<FileTransfer> transfer_;
 
+    ListState local_list_state_;
+    ListState remote_list_state_;
+
     DISALLOW_COPY_AND_ASSIGN(ClientFileTransfer);
 };
 
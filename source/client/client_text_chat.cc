@@ -46,12 +46,21 @@ void ClientTextChat::setTextChatWindow(
 
 void ClientTextChat::onTextChatMessage(const proto::TextChat& text_chat)
 {
-    sendMessage(proto::HOST_CHANNEL_ID_SESSION, text_chat);
+    if (!is_batch_supported_)
+    {
+        sendMessage(proto::HOST_CHANNEL_ID_SESSION, text_chat);
+        return;
+    }
+
+    proto::TextChat message;
+    if (batcher_.add(text_chat, &message))
+        sendMessage(proto::HOST_CHANNEL_ID_SESSION, message);
 }
 
-void ClientTextChat::onSessionStarted(const base::Version& /* peer_version */)
+void ClientTextChat::onSessionStarted(const base::Version& peer_version)
 {
     LOG(LS_INFO) << "Text chat session started";
+    is_batch_supported_ = peer_version >= base::Version(2, 7, 0);
     text_chat_window_proxy_->start(text_chat_control_proxy_);
 }
 
@@ -65,12 +74,20 @@ void ClientTextChat::onSessionMessageReceived(
         return;
     }
 
-    text_chat_window_proxy_->onTextChatMessage(text_chat);
+    common::TextChatBatcher::unpack(text_chat, [this](const proto::TextChat& item)
+    {
+        text_chat_window_proxy_->onTextChatMessage(item);
+    });
 }
 
-void ClientTextChat::onSessionMessageWritten(uint8_t /* channel_id */, size_t /* pending */)
+void ClientTextChat::onSessionMessageWritten(uint8_t /* channel_id */, size_t pending)
 {
-    // Nothing
+    if (pending)
+        return;
+
+    proto::TextChat message;
+    if (batcher_.takeBatch(&message))
+        sendMessage(proto::HOST_CHANNEL_ID_SESSION, message);
 }
 
 } // namespace client
@@ -21,6 +21,7 @@
 
 #include "client/client.h"
 #include "client/text_chat_control.h"
+#include "common/text_chat_batcher.h"
 
 namespace client {
 
@@ -50,6 +51,9 @@ private:
     std::shared_ptr<TextChatControlProxy> text_chat_control_proxy_;
     std::shared_ptr<TextChatWindowProxy> text_chat_window_proxy_;
 
+    common::TextChatBatcher batcher_;
+    bool is_batch_supported_ = false;
+
     DISALLOW_COPY_AND_ASSIGN(ClientTextChat);
 };
 
@@ -70,7 +70,8 @@ void ConfigFactory::setDefaultDesktopManageConfig(proto::DesktopConfig* config)
 
     static const uint32_t kDefaultFlags =
         proto::ENABLE_CLIPBOARD | proto::ENABLE_CURSOR_SHAPE | proto::DISABLE_DESKTOP_EFFECTS |
-        proto::DISABLE_DESKTOP_WALLPAPER | proto::CLEAR_CLIPBOARD;
+        proto::DISABLE_DESKTOP_WALLPAPER | proto::CLEAR_CLIPBOARD |
+        proto::VP9_MULTITHREADED;
 
     config->set_flags(kDefaultFlags);
     config->set_video_encoding(kDefaultVideoEncoding);
@@ -87,7 +88,8 @@ void ConfigFactory::setDefaultDesktopViewConfig(proto::DesktopConfig* config)
     DCHECK(config);
 
     static const uint32_t kDefaultFlags =
-        proto::DISABLE_DESKTOP_EFFECTS | proto::DISABLE_DESKTOP_WALLPAPER;
+        proto::DISABLE_DESKTOP_EFFECTS | proto::DISABLE_DESKTOP_WALLPAPER |
+        proto::VP9_MULTITHREADED;
 
     config->set_flags(kDefaultFlags);
     config->set_video_encoding(kDefaultVideoEncoding);
@@ -0,0 +1,98 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "client/cursor_predictor.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace client {
+
+namespace {
+
+// The positions are scaled on both sides, so they may differ by a few pixels.
+const int kPositionTolerance = 2;
+
+const size_t kMaxSamples = 128;
+
+const std::chrono::milliseconds kMinCorrectionDelay { 50 };
+const std::chrono::milliseconds kMaxCorrectionDelay { 1000 };
+
+bool isSamePosition(const base::Point& first, const base::Point& second)
+{
+    return std::abs(first.x() - second.x()) <= kPositionTolerance &&
+           std::abs(first.y() - second.y()) <= kPositionTolerance;
+}
+
+} // namespace
+
+CursorPredictor::CursorPredictor() = default;
+
+CursorPredictor::~CursorPredictor() = default;
+
+void CursorPredictor::addLocalPosition(const base::Point& position)
+{
+    local_position_ = position;
+    local_time_ = Clock::now();
+    has_local_position_ = true;
+
+    samples_.push_back({ position, local_time_ });
+    if (samples_.size() > kMaxSamples)
+        samples_.pop_front();
+}
+
+void CursorPredictor::addRemotePosition(const base::Point& position)
+{
+    remote_position_ = position;
+
+    for (auto it = samples_.rbegin(); it != samples_.rend(); ++it)
+    {
+        if (!isSamePosition(it->position, position))
+            continue;
+
+        const std::chrono::microseconds latency =
+            std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - it->time);
+        latency_ = (latency_ * 7 + latency) / 8;
+
+        // The older positions will not be reported anymore.
+        samples_.erase(samples_.begin(), std::next(it).base());
+        has_correction_ = false;
+        return;
+    }
+
+    has_correction_ = true;
+}
+
+base::Point CursorPredictor::position() const
+{
+    if (!has_local_position_)
+        return remote_position_;
+
+    if (has_correction_ && Clock::now() - local_time_ >= correctionDelay())
+        return remote_position_;
+
+    return local_position_;
+}
+
+std::chrono::milliseconds CursorPredictor::correctionDelay() const
+{
+    // The host can report positions from before the local input during one latency.
+    return std::clamp(std::chrono::duration_cast<std::chrono::milliseconds>(latency_ * 2),
+                      kMinCorrectionDelay, kMaxCorrectionDelay);
+}
+
+} // namespace client
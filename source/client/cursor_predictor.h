@@ -0,0 +1,79 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef CLIENT_CURSOR_PREDICTOR_H
+#define CLIENT_CURSOR_PREDICTOR_H
+
+#include "base/macros_magic.h"
+#include "base/desktop/geometry.h"
+
+#include <chrono>
+#include <deque>
+
+namespace client {
+
+// Hides the network delay of the remote cursor. While the user moves the mouse, the cursor is
+// drawn at the position sent to the host. The positions reported by the host are compared with
+// the sent ones. If the host reports a position that was not sent (for example, an application
+// moved the cursor), the cursor is drawn at it once the local input has stopped for a while.
+class CursorPredictor
+{
+public:
+    CursorPredictor();
+    ~CursorPredictor();
+
+    // Adds a position sent to the host.
+    void addLocalPosition(const base::Point& position);
+
+    // Adds a position reported by the host.
+    void addRemotePosition(const base::Point& position);
+
+    // Returns the position where the cursor is drawn.
+    base::Point position() const;
+
+    // Returns true if the host reported a position that was not sent. It is used after
+    // correctionDelay() without local input.
+    bool hasCorrection() const { return has_correction_; }
+    std::chrono::milliseconds correctionDelay() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Sample
+    {
+        base::Point position;
+        Clock::time_point time;
+    };
+
+    // The positions not yet confirmed by the host, oldest first.
+    std::deque<Sample> samples_;
+
+    base::Point local_position_;
+    base::Point remote_position_;
+    Clock::time_point local_time_;
+    bool has_local_position_ = false;
+    bool has_correction_ = false;
+
+    // Estimate of the time until the host reports a sent position.
+    std::chrono::microseconds latency_ { 100000 };
+
+    DISALLOW_COPY_AND_ASSIGN(CursorPredictor);
+};
+
+} // namespace client
+
+#endif // CLIENT_CURSOR_PREDICTOR_H
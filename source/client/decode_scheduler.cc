@@ -0,0 +1,205 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "client/decode_scheduler.h"
+
+#include "base/logging.h"
+
+#include <algorithm>
+
+namespace client {
+
+namespace {
+
+// The decoders of VP9 and ZSTD slices have threads of their own, so the pool is not larger.
+const int kMaxThreadCount = 16;
+
+std::mutex g_instance_lock;
+std::weak_ptr<DecodeScheduler> g_instance;
+
+} // namespace
+
+DecodeScheduler::DecodeScheduler(int thread_count)
+{
+    LOG(LS_INFO) << "Ctor (threads: " << thread_count << ")";
+
+    for (int i = 0; i < thread_count; ++i)
+        threads_.emplace_back(&DecodeScheduler::threadMain, this);
+}
+
+DecodeScheduler::~DecodeScheduler()
+{
+    LOG(LS_INFO) << "Dtor";
+
+    {
+        std::scoped_lock lock(lock_);
+        DCHECK(tasks_.empty());
+        terminate_ = true;
+    }
+
+    work_event_.notify_all();
+
+    for (auto& thread : threads_)
+        thread.join();
+}
+
+// static
+std::shared_ptr<DecodeScheduler> DecodeScheduler::instance()
+{
+    std::scoped_lock lock(g_instance_lock);
+
+    std::shared_ptr<DecodeScheduler> scheduler = g_instance.lock();
+    if (!scheduler)
+    {
+        const int thread_count = std::clamp(
+            static_cast<int>(std::thread::hardware_concurrency()), 1, kMaxThreadCount);
+
+        scheduler.reset(new DecodeScheduler(thread_count));
+        g_instance = scheduler;
+    }
+
+    return scheduler;
+}
+
+void DecodeScheduler::addTask(Task* task)
+{
+    DCHECK(task);
+
+    std::scoped_lock lock(lock_);
+    DCHECK(tasks_.find(task) == tasks_.end());
+    tasks_.emplace(task, TaskState());
+}
+
+void DecodeScheduler::removeTask(Task* task)
+{
+    std::unique_lock lock(lock_);
+
+    auto it = tasks_.find(task);
+    if (it == tasks_.end())
+        return;
+
+    done_event_.wait(lock, [&]() { return !it->second.is_running; });
+
+    std::deque<Task*>& queue = it->second.is_high_priority ? high_priority_queue_ : queue_;
+    queue.erase(std::remove(queue.begin(), queue.end(), task), queue.end());
+
+    tasks_.erase(it);
+}
+
+void DecodeScheduler::schedule(Task* task)
+{
+    {
+        std::scoped_lock lock(lock_);
+
+        auto it = tasks_.find(task);
+        if (it == tasks_.end())
+            return;
+
+        TaskState& state = it->second;
+
+        // The thread that runs the task queues it again after the step.
+        if (state.is_running)
+        {
+            state.is_rescheduled = true;
+            return;
+        }
+
+        if (state.is_queued)
+            return;
+
+        enqueue(task, &state);
+    }
+
+    work_event_.notify_one();
+}
+
+void DecodeScheduler::setHighPriority(Task* task, bool enable)
+{
+    std::scoped_lock lock(lock_);
+
+    auto it = tasks_.find(task);
+    if (it == tasks_.end())
+        return;
+
+    TaskState& state = it->second;
+    if (state.is_high_priority == enable)
+        return;
+
+    if (state.is_queued)
+    {
+        std::deque<Task*>& queue = state.is_high_priority ? high_priority_queue_ : queue_;
+        queue.erase(std::remove(queue.begin(), queue.end(), task), queue.end());
+    }
+
+    state.is_high_priority = enable;
+
+    if (state.is_queued)
+        (enable ? high_priority_queue_ : queue_).push_back(task);
+}
+
+void DecodeScheduler::enqueue(Task* task, TaskState* state)
+{
+    state->is_queued = true;
+
+    if (state->is_high_priority)
+        high_priority_queue_.push_back(task);
+    else
+        queue_.push_back(task);
+}
+
+void DecodeScheduler::threadMain()
+{
+    std::unique_lock lock(lock_);
+
+    while (true)
+    {
+        work_event_.wait(lock, [this]()
+        {
+            return terminate_ || !high_priority_queue_.empty() || !queue_.empty();
+        });
+
+        if (terminate_)
+            break;
+
+        std::deque<Task*>& queue = !high_priority_queue_.empty() ? high_priority_queue_ : queue_;
+        Task* task = queue.front();
+        queue.pop_front();
+
+        TaskState* state = &tasks_[task];
+        state->is_queued = false;
+        state->is_running = true;
+        state->is_rescheduled = false;
+
+        lock.unlock();
+        const bool has_more_work = task->runStep();
+        lock.lock();
+
+        // The task cannot be removed while it is running, so the state is still valid.
+        state->is_running = false;
+
+        if (has_more_work || state->is_rescheduled)
+        {
+            enqueue(task, state);
+            work_event_.notify_one();
+        }
+
+        done_event_.notify_all();
+    }
+}
+
+} // namespace client
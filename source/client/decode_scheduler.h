@@ -0,0 +1,96 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CLIENT_DECODE_SCHEDULER_H
+#define CLIENT_DECODE_SCHEDULER_H
+
+#include "base/macros_magic.h"
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace client {
+
+// Runs the decoding of all desktop sessions of the process on one pool of threads, one thread
+// per processor. Each session is a task that is run by one thread at a time, so its packets are
+// decoded in order. A task runs one step per turn and then goes to the end of the queue, so the
+// sessions get the threads in turn. The tasks of the active windows are run first.
+class DecodeScheduler
+{
+public:
+    class Task
+    {
+    public:
+        virtual ~Task() = default;
+
+        // Runs one step of the work on a thread of the pool. Returns true if there is more work.
+        virtual bool runStep() = 0;
+    };
+
+    ~DecodeScheduler();
+
+    // Returns the scheduler of the process. The threads are stopped when the last reference is
+    // released.
+    static std::shared_ptr<DecodeScheduler> instance();
+
+    void addTask(Task* task);
+
+    // Waits for the current step of |task| to finish.
+    void removeTask(Task* task);
+
+    // Queues |task| to run its next step.
+    void schedule(Task* task);
+
+    void setHighPriority(Task* task, bool enable);
+
+private:
+    explicit DecodeScheduler(int thread_count);
+
+    struct TaskState
+    {
+        bool is_high_priority = false;
+        bool is_queued = false;
+        bool is_running = false;
+        bool is_rescheduled = false;
+    };
+
+    void enqueue(Task* task, TaskState* state);
+    void threadMain();
+
+    std::mutex lock_;
+    std::condition_variable work_event_;
+    std::condition_variable done_event_;
+
+    std::map<Task*, TaskState> tasks_;
+    std::deque<Task*> high_priority_queue_;
+    std::deque<Task*> queue_;
+    bool terminate_ = false;
+
+    std::vector<std::thread> threads_;
+
+    DISALLOW_COPY_AND_ASSIGN(DecodeScheduler);
+};
+
+} // namespace client
+
+#endif // CLIENT_DECODE_SCHEDULER_H
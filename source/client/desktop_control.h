@@ -40,6 +40,9 @@ public:
     virtual void setAudioPause(bool enable) = 0;
     virtual void setVideoRecording(bool enable, const std::filesystem::path& file_path) = 0;
 
+    // The video of the active window is decoded before the video of other sessions.
+    virtual void setWindowActive(bool active) = 0;
+
     virtual void onKeyEvent(const proto::KeyEvent& event) = 0;
     virtual void onTextEvent(const proto::TextEvent& event) = 0;
     virtual void onMouseEvent(const proto::MouseEvent& event) = 0;
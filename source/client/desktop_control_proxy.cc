@@ -112,6 +112,19 @@ void DesktopControlProxy::setAudioPause(bool enable)
         desktop_control_->setAudioPause(enable);
 }
 
+void DesktopControlProxy::setWindowActive(bool active)
+{
+    if (!io_task_runner_->belongsToCurrentThread())
+    {
+        io_task_runner_->postTask(
+            std::bind(&DesktopControlProxy::setWindowActive, shared_from_this(), active));
+        return;
+    }
+
+    if (desktop_control_)
+        desktop_control_->setWindowActive(active);
+}
+
 void DesktopControlProxy::setVideoRecording(bool enable, const std::filesystem::path& file_path)
 {
     if (!io_task_runner_->belongsToCurrentThread())
@@ -49,6 +49,7 @@ public:
     void setPreferredSize(int width, int height);
     void setVideoPause(bool enable);
     void setAudioPause(bool enable);
+    void setWindowActive(bool active);
     void setVideoRecording(bool enable, const std::filesystem::path& file_path);
     void onKeyEvent(const proto::KeyEvent& event);
     void onTextEvent(const proto::TextEvent& event);
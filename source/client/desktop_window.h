@@ -19,6 +19,7 @@
 #ifndef CLIENT_DESKTOP_WINDOW_H
 #define CLIENT_DESKTOP_WINDOW_H
 
+#include "client/latency_stats.h"
 #include "proto/desktop.pb.h"
 #include "proto/desktop_extensions.pb.h"
 
@@ -29,6 +30,7 @@
 namespace base {
 class Frame;
 class MouseCursor;
+class Region;
 class Size;
 class Version;
 } // namespace base
@@ -75,6 +77,7 @@ public:
         size_t avg_audio_packet = 0;
         uint32_t video_capturer_type = 0;
         int fps = 0;
+        int presented_fps = 0; // Filled by the window.
         int send_mouse = 0;
         int drop_mouse = 0;
         int send_key = 0;
@@ -85,6 +88,7 @@ public:
         int cursor_pos_count = 0;
         int cursor_cached = 0;
         int cursor_taken_from_cache = 0;
+        LatencyStats::Metrics latency;
     };
 
     virtual void showWindow(std::shared_ptr<DesktopControlProxy> desktop_control_proxy,
@@ -103,7 +107,10 @@ public:
     virtual void setFrameError(proto::VideoErrorCode error_code) = 0;
     virtual void setFrame(const base::Size& screen_size,
                           std::shared_ptr<base::Frame> frame) = 0;
-    virtual void drawFrame() = 0;
+    // |frame| is the buffer to show from now on. It has the same size as the frame of setFrame()
+    // and differs from the previous buffer only in |updated_region|.
+    virtual void drawFrame(std::shared_ptr<base::Frame> frame,
+                           const base::Region& updated_region) = 0;
     virtual void setMouseCursor(std::shared_ptr<base::MouseCursor> mouse_cursor) = 0;
 };
 
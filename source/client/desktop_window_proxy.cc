@@ -22,9 +22,12 @@
 #include "base/task_runner.h"
 #include "base/version.h"
 #include "base/desktop/geometry.h"
+#include "base/desktop/region.h"
 #include "client/desktop_control_proxy.h"
 #include "client/desktop_window.h"
+#include "client/frame_chain.h"
 #include "client/frame_factory.h"
+#include "client/latency_stats.h"
 #include "proto/desktop.pb.h"
 #include "proto/desktop_extensions.pb.h"
 
@@ -52,6 +55,11 @@ void DesktopWindowProxy::dettach()
     desktop_window_ = nullptr;
 }
 
+void DesktopWindowProxy::setLatencyStats(std::shared_ptr<LatencyStats> latency_stats)
+{
+    latency_stats_ = std::move(latency_stats);
+}
+
 void DesktopWindowProxy::configRequired()
 {
     if (!ui_task_runner_->belongsToCurrentThread())
@@ -182,29 +190,73 @@ void DesktopWindowProxy::setFrameError(proto::VideoErrorCode error_code)
 }
 
 void DesktopWindowProxy::setFrame(
-    const base::Size& screen_size, std::shared_ptr<base::Frame> frame)
+    const base::Size& screen_size, std::shared_ptr<FrameChain> frame_chain)
 {
     if (!ui_task_runner_->belongsToCurrentThread())
     {
-        ui_task_runner_->postTask(
-            std::bind(&DesktopWindowProxy::setFrame, shared_from_this(), screen_size, frame));
+        ui_task_runner_->postTask(std::bind(&DesktopWindowProxy::setFrame,
+                                            shared_from_this(),
+                                            screen_size,
+                                            frame_chain));
         return;
     }
 
+    frame_chain_ = std::move(frame_chain);
+
     if (desktop_window_)
-        desktop_window_->setFrame(screen_size, frame);
+        desktop_window_->setFrame(screen_size, frame_chain_->takeDisplayFrame());
 }
 
-void DesktopWindowProxy::drawFrame()
+void DesktopWindowProxy::drawFrame(const base::Region& updated_region)
 {
+    {
+        std::scoped_lock lock(draw_lock_);
+
+        pending_region_.addRegion(updated_region);
+
+        // The posted task takes this region too.
+        if (is_draw_pending_)
+            return;
+
+        is_draw_pending_ = true;
+        draw_post_time_ = Clock::now();
+    }
+
     if (!ui_task_runner_->belongsToCurrentThread())
     {
-        ui_task_runner_->postTask(std::bind(&DesktopWindowProxy::drawFrame, shared_from_this()));
+        ui_task_runner_->postTask(
+            std::bind(&DesktopWindowProxy::drawPendingFrame, shared_from_this()));
         return;
     }
 
-    if (desktop_window_)
-        desktop_window_->drawFrame();
+    drawPendingFrame();
+}
+
+void DesktopWindowProxy::drawPendingFrame()
+{
+    base::Region updated_region;
+    Clock::time_point post_time;
+
+    {
+        std::scoped_lock lock(draw_lock_);
+
+        updated_region.swap(&pending_region_);
+        post_time = draw_post_time_;
+        is_draw_pending_ = false;
+    }
+
+    if (!desktop_window_ || !frame_chain_)
+        return;
+
+    // The region is taken first, so the frame contains at least the changes of the region.
+    desktop_window_->drawFrame(frame_chain_->takeDisplayFrame(), updated_region);
+
+    if (latency_stats_)
+    {
+        latency_stats_->addSample(LatencyStats::Stage::RENDER,
+                                  std::chrono::duration_cast<std::chrono::microseconds>(
+                                      Clock::now() - post_time));
+    }
 }
 
 void DesktopWindowProxy::setMouseCursor(std::shared_ptr<base::MouseCursor> mouse_cursor)
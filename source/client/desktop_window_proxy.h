@@ -20,8 +20,10 @@
 #define CLIENT_DESKTOP_WINDOW_PROXY_H
 
 #include "base/macros_magic.h"
+#include "base/desktop/region.h"
 #include "client/desktop_window.h"
 
+#include <mutex>
 #include <string>
 
 namespace base {
@@ -31,6 +33,8 @@ class TaskRunner;
 namespace client {
 
 class DesktopControlProxy;
+class FrameChain;
+class LatencyStats;
 
 class DesktopWindowProxy : public std::enable_shared_from_this<DesktopWindowProxy>
 {
@@ -41,6 +45,10 @@ public:
 
     void dettach();
 
+    // The time from drawFrame() until the window has taken the frame on the UI thread is added to
+    // |latency_stats|. Must be called before the first frame is drawn.
+    void setLatencyStats(std::shared_ptr<LatencyStats> latency_stats);
+
     void showWindow(std::shared_ptr<DesktopControlProxy> desktop_control_proxy,
                     const base::Version& peer_version);
 
@@ -55,15 +63,31 @@ public:
 
     std::shared_ptr<base::Frame> allocateFrame(const base::Size& size);
     void setFrameError(proto::VideoErrorCode error_code);
-    void setFrame(const base::Size& screen_size, std::shared_ptr<base::Frame> frame);
-    void drawFrame();
+    void setFrame(const base::Size& screen_size, std::shared_ptr<FrameChain> frame_chain);
+
+    // The regions of the frames decoded while the window is drawing are merged, so the window
+    // draws once for all of them. The window gets the newest frame of the chain.
+    void drawFrame(const base::Region& updated_region);
     void setMouseCursor(std::shared_ptr<base::MouseCursor> mouse_cursor);
 
 private:
+    using Clock = std::chrono::steady_clock;
+
+    void drawPendingFrame();
+
     std::shared_ptr<base::TaskRunner> ui_task_runner_;
     std::unique_ptr<FrameFactory> frame_factory_;
+    std::shared_ptr<LatencyStats> latency_stats_;
     DesktopWindow* desktop_window_;
 
+    // Used only on the UI thread.
+    std::shared_ptr<FrameChain> frame_chain_;
+
+    std::mutex draw_lock_;
+    base::Region pending_region_;
+    Clock::time_point draw_post_time_;
+    bool is_draw_pending_ = false;
+
     DISALLOW_COPY_AND_ASSIGN(DesktopWindowProxy);
 };
 
@@ -0,0 +1,127 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "client/file_packet_window.h"
+
+#include "base/logging.h"
+#include "common/file_packet.h"
+
+#include <algorithm>
+
+namespace client {
+
+namespace {
+
+const size_t kInitialWindowSize = 4 * common::kDefaultFilePacketSize;
+const size_t kMinWindowSize = common::kDefaultFilePacketSize;
+const size_t kMaxWindowSize = 16 * 1024 * 1024; // 16 MB
+
+// The throughput is measured over at least one round trip and not more often than this.
+const std::chrono::milliseconds kMinMeasureInterval { 100 };
+
+// The minimum round trip time is measured again after this time in case the route has changed.
+const std::chrono::seconds kMinRttLifetime { 10 };
+
+// The estimate falls slowly, so that a short pause of the disk does not shrink the window.
+const double kThroughputDecay = 0.75;
+
+// The packet size is about an eighth of the bandwidth-delay product.
+const size_t kPacketsPerBdp = 8;
+
+} // namespace
+
+FilePacketWindow::FilePacketWindow()
+    : window_size_(kInitialWindowSize)
+{
+    // Nothing
+}
+
+FilePacketWindow::~FilePacketWindow() = default;
+
+size_t FilePacketWindow::packetSize() const
+{
+    const double bdp = throughput_ * std::chrono::duration<double>(min_rtt_).count();
+
+    size_t packet_size = common::kDefaultFilePacketSize;
+    while (packet_size < common::kMaxFilePacketSize && packet_size * 2 * kPacketsPerBdp <= bdp)
+        packet_size *= 2;
+
+    return packet_size;
+}
+
+void FilePacketWindow::onFileStarted()
+{
+    send_times_.clear();
+}
+
+void FilePacketWindow::onPacketSent()
+{
+    send_times_.emplace_back(Clock::now());
+}
+
+void FilePacketWindow::onPacketAcknowledged(size_t bytes)
+{
+    if (send_times_.empty())
+    {
+        LOG(LS_WARNING) << "Unexpected packet acknowledgement";
+        return;
+    }
+
+    const Clock::time_point now = Clock::now();
+
+    const std::chrono::microseconds rtt =
+        std::chrono::duration_cast<std::chrono::microseconds>(now - send_times_.front());
+    send_times_.pop_front();
+
+    if (min_rtt_ == std::chrono::microseconds::zero() || rtt < min_rtt_ ||
+        now - min_rtt_time_ > kMinRttLifetime)
+    {
+        min_rtt_ = rtt;
+        min_rtt_time_ = now;
+    }
+
+    if (interval_start_ == Clock::time_point())
+    {
+        // The first acknowledgement only starts the measurement.
+        interval_start_ = now;
+        return;
+    }
+
+    interval_bytes_ += bytes;
+
+    const Clock::duration elapsed = now - interval_start_;
+    if (elapsed < std::max<Clock::duration>(min_rtt_, kMinMeasureInterval))
+        return;
+
+    const double throughput =
+        static_cast<double>(interval_bytes_) / std::chrono::duration<double>(elapsed).count();
+
+    throughput_ = std::max(throughput, throughput_ * kThroughputDecay);
+    interval_bytes_ = 0;
+    interval_start_ = now;
+
+    updateWindow();
+}
+
+void FilePacketWindow::updateWindow()
+{
+    const double bdp = throughput_ * std::chrono::duration<double>(min_rtt_).count();
+
+    window_size_ = std::clamp(static_cast<size_t>(bdp * 2), kMinWindowSize, kMaxWindowSize);
+}
+
+} // namespace client
@@ -0,0 +1,76 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef CLIENT_FILE_PACKET_WINDOW_H
+#define CLIENT_FILE_PACKET_WINDOW_H
+
+#include "base/macros_magic.h"
+
+#include <chrono>
+#include <deque>
+
+namespace client {
+
+// Controls how many bytes of the file packets may be in flight between the source and the target.
+// The window covers twice the bandwidth-delay product, which is estimated from the round trip time
+// of the packets and the measured throughput. While the window limits the transfer, each
+// measurement doubles it; once the network is the limit, the window stays at the estimate.
+class FilePacketWindow
+{
+public:
+    FilePacketWindow();
+    ~FilePacketWindow();
+
+    // Maximum number of bytes in flight.
+    size_t windowSize() const { return window_size_; }
+
+    // Size of the next packet to request. Larger packets reduce the request overhead on fast
+    // networks.
+    size_t packetSize() const;
+
+    // Must be called before the first packet of a file is sent. The packets that are still in
+    // flight after an error are not acknowledged, so they are forgotten here.
+    void onFileStarted();
+
+    // Must be called for each packet request and each acknowledgement from the target. The
+    // acknowledgements come in the order of the requests.
+    void onPacketSent();
+    void onPacketAcknowledged(size_t bytes);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void updateWindow();
+
+    std::deque<Clock::time_point> send_times_;
+
+    std::chrono::microseconds min_rtt_ { 0 };
+    Clock::time_point min_rtt_time_;
+
+    // Bytes per second.
+    double throughput_ = 0;
+    size_t interval_bytes_ = 0;
+    Clock::time_point interval_start_;
+
+    size_t window_size_;
+
+    DISALLOW_COPY_AND_ASSIGN(FilePacketWindow);
+};
+
+} // namespace client
+
+#endif // CLIENT_FILE_PACKET_WINDOW_H
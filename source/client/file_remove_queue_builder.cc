@@ -63,6 +63,12 @@ void FileRemoveQueueBuilder::onTaskDone(std::shared_ptr<common::FileTask> task)
     const proto::FileRequest& request = task->request();
     const proto::FileReply& reply = task->reply();
 
+    if (request.has_file_tree_request())
+    {
+        onFileTree(request.file_tree_request(), reply);
+        return;
+    }
+
     if (!request.has_file_list_request())
     {
         onAborted(proto::FILE_ERROR_UNKNOWN);
@@ -88,6 +94,41 @@ void FileRemoveQueueBuilder::onTaskDone(std::shared_ptr<common::FileTask> task)
     doPendingTasks();
 }
 
+void FileRemoveQueueBuilder::onFileTree(
+    const proto::FileTreeRequest& request, const proto::FileReply& reply)
+{
+    if (reply.error_code() == proto::FILE_ERROR_INVALID_REQUEST && !request.next())
+    {
+        // Older peers list only one directory per request.
+        is_tree_supported_ = false;
+        task_consumer_proxy_->doTask(task_factory_->fileList(request.path()));
+        return;
+    }
+
+    if (reply.error_code() != proto::FILE_ERROR_SUCCESS)
+    {
+        onAborted(reply.error_code());
+        return;
+    }
+
+    const proto::FileTree& file_tree = reply.file_tree();
+
+    // A directory is listed before its content, so the content is removed first.
+    for (int i = 0; i < file_tree.item_size(); ++i)
+    {
+        const proto::FileTree::Item& item = file_tree.item(i);
+        tasks_.emplace_front(request.path() + '/' + item.path(), item.is_directory());
+    }
+
+    if (!file_tree.is_last())
+    {
+        task_consumer_proxy_->doTask(task_factory_->fileTree(request.path(), true));
+        return;
+    }
+
+    doPendingTasks();
+}
+
 void FileRemoveQueueBuilder::doPendingTasks()
 {
     while (!pending_tasks_.empty())
@@ -97,7 +138,10 @@ void FileRemoveQueueBuilder::doPendingTasks()
 
         if (tasks_.front().isDirectory())
         {
-            task_consumer_proxy_->doTask(task_factory_->fileList(tasks_.front().path()));
+            if (is_tree_supported_)
+                task_consumer_proxy_->doTask(task_factory_->fileTree(tasks_.front().path(), false));
+            else
+                task_consumer_proxy_->doTask(task_factory_->fileList(tasks_.front().path()));
             return;
         }
     }
@@ -45,6 +45,7 @@ protected:
     void onTaskDone(std::shared_ptr<common::FileTask> task) override;
 
 private:
+    void onFileTree(const proto::FileTreeRequest& request, const proto::FileReply& reply);
     void doPendingTasks();
     void onAborted(proto::FileError error_code);
 
@@ -57,6 +58,9 @@ private:
     FileRemover::TaskList pending_tasks_;
     FileRemover::TaskList tasks_;
 
+    // The tree of each directory is listed with one request (in several parts for large trees).
+    bool is_tree_supported_ = true;
+
     DISALLOW_COPY_AND_ASSIGN(FileRemoveQueueBuilder);
 };
 
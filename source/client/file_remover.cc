@@ -22,6 +22,7 @@
 #include "client/file_remove_queue_builder.h"
 #include "client/file_remove_window_proxy.h"
 #include "client/file_remover_proxy.h"
+#include "common/file_packet.h"
 #include "common/file_task_factory.h"
 #include "common/file_task_consumer_proxy.h"
 #include "common/file_task_producer_proxy.h"
@@ -114,6 +115,12 @@ void FileRemover::onTaskDone(std::shared_ptr<common::FileTask> task)
     const proto::FileRequest& request = task->request();
     const proto::FileReply& reply = task->reply();
 
+    if (request.has_remove_batch_request())
+    {
+        onRemoveBatchReply(reply);
+        return;
+    }
+
     if (!request.has_remove_request())
     {
         remove_window_proxy_->errorOccurred(
@@ -123,34 +130,62 @@ void FileRemover::onTaskDone(std::shared_ptr<common::FileTask> task)
 
     if (reply.error_code() != proto::FILE_ERROR_SUCCESS)
     {
-        uint32_t actions;
+        onError(request.remove_request().path(), reply.error_code());
+        return;
+    }
+
+    doNextTask();
+}
+
+void FileRemover::onRemoveBatchReply(const proto::FileReply& reply)
+{
+    if (reply.error_code() == proto::FILE_ERROR_INVALID_REQUEST && !reply.processed_count())
+    {
+        // Older peers remove only one item per request.
+        is_batch_supported_ = false;
+        doCurrentTask();
+        return;
+    }
+
+    // The processed items are removed from the queue. The next item is the failed one.
+    size_t processed_count = std::min(static_cast<size_t>(reply.processed_count()), tasks_.size());
+    while (processed_count--)
+        tasks_.pop_front();
+
+    if (reply.error_code() != proto::FILE_ERROR_SUCCESS && !tasks_.empty())
+    {
+        onError(tasks_.front().path(), reply.error_code());
+        return;
+    }
+
+    doCurrentTask();
+}
 
-        switch (reply.error_code())
+void FileRemover::onError(const std::string& path, proto::FileError error_code)
+{
+    uint32_t actions;
+
+    switch (error_code)
+    {
+        case proto::FILE_ERROR_PATH_NOT_FOUND:
+        case proto::FILE_ERROR_ACCESS_DENIED:
         {
-            case proto::FILE_ERROR_PATH_NOT_FOUND:
-            case proto::FILE_ERROR_ACCESS_DENIED:
+            if (failure_action_ != ACTION_ASK)
             {
-                if (failure_action_ != ACTION_ASK)
-                {
-                    setAction(failure_action_);
-                    return;
-                }
-
-                actions = ACTION_ABORT | ACTION_SKIP | ACTION_SKIP_ALL;
+                setAction(failure_action_);
+                return;
             }
-            break;
 
-            default:
-                actions = ACTION_ABORT;
-                break;
+            actions = ACTION_ABORT | ACTION_SKIP | ACTION_SKIP_ALL;
         }
+        break;
 
-        remove_window_proxy_->errorOccurred(
-            request.remove_request().path(), reply.error_code(), actions);
-        return;
+        default:
+            actions = ACTION_ABORT;
+            break;
     }
 
-    doNextTask();
+    remove_window_proxy_->errorOccurred(path, error_code, actions);
 }
 
 void FileRemover::doNextTask()
@@ -178,6 +213,26 @@ void FileRemover::doCurrentTask()
     // Updating progress in UI.
     remove_window_proxy_->setCurrentProgress(path, static_cast<int>(percentage));
 
+    if (is_batch_supported_)
+    {
+        // The items are removed in order, so a directory is removed after its content.
+        std::unique_ptr<proto::RemoveBatchRequest> batch =
+            std::make_unique<proto::RemoveBatchRequest>();
+
+        for (const Task& task : tasks_)
+        {
+            if (batch->path_size() >= common::kMaxRemoveBatchCount)
+                break;
+
+            batch->add_path(task.path());
+        }
+
+        batch->set_skip_errors(failure_action_ == ACTION_SKIP_ALL);
+
+        task_consumer_proxy_->doTask(task_factory_->removeBatch(std::move(batch)));
+        return;
+    }
+
     // Send a request to delete the next item.
     task_consumer_proxy_->doTask(task_factory_->remove(path));
 }
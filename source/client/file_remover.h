@@ -21,6 +21,7 @@
 
 #include "common/file_task.h"
 #include "common/file_task_producer.h"
+#include "proto/file_transfer.pb.h"
 
 #include <functional>
 #include <deque>
@@ -93,6 +94,8 @@ protected:
     void onTaskDone(std::shared_ptr<common::FileTask> task) override;
 
 private:
+    void onRemoveBatchReply(const proto::FileReply& reply);
+    void onError(const std::string& path, proto::FileError error_code);
     void doNextTask();
     void doCurrentTask();
     void onFinished();
@@ -110,6 +113,7 @@ private:
 
     Action failure_action_ = ACTION_ASK;
     size_t tasks_count_ = 0;
+    bool is_batch_supported_ = true;
 
     DISALLOW_COPY_AND_ASSIGN(FileRemover);
 };
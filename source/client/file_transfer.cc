@@ -27,6 +27,8 @@
 #include "common/file_task_producer_proxy.h"
 #include "common/file_packet.h"
 
+#include <algorithm>
+
 namespace client {
 
 namespace {
@@ -196,7 +198,7 @@ void FileTransfer::onTaskDone(std::shared_ptr<common::FileTask> task)
         {
             DCHECK_EQ(task->target(), common::FileTask::Target::REMOTE);
 
-            sourceReply(task->request(), task->reply());
+            sourceReply(task->request(), task->reply(), task->takeReplyData());
         }
     }
     else
@@ -205,7 +207,7 @@ void FileTransfer::onTaskDone(std::shared_ptr<common::FileTask> task)
 
         if (task->target() == common::FileTask::Target::LOCAL)
         {
-            sourceReply(task->request(), task->reply());
+            sourceReply(task->request(), task->reply(), task->takeReplyData());
         }
         else
         {
@@ -250,31 +252,57 @@ void FileTransfer::targetReply(const proto::FileRequest& request, const proto::F
             return;
         }
 
-        task_consumer_proxy_->doTask(
-            task_factory_source_->packetRequest(proto::FilePacketRequest::NO_FLAGS));
+        // Older targets do not set the flag and receive only uncompressed packets.
+        packet_compression_ = reply.packet_compression();
+        packet_detached_data_ = reply.packet_detached_data();
+
+        const proto::FileBlockList& block_list = reply.block_list();
+        if (block_list.block_size() && block_list.block_size() <= common::kMaxFilePacketSize)
+        {
+            // Each packet covers one block, so the source can skip the unchanged ones.
+            block_size_ = block_list.block_size();
+
+            requestPacket(proto::FilePacketRequest::NO_FLAGS, block_size_, &block_list);
+            return;
+        }
+
+        // The size of the file is not known until the first packet is received, so only one
+        // packet is requested.
+        requestPacket(proto::FilePacketRequest::NO_FLAGS, packet_window_.packetSize());
+    }
+    else if (request.has_write_batch_request())
+    {
+        onWriteBatchReply(reply);
     }
     else if (request.has_packet())
     {
+        --pending_target_packets_;
+
+        if (packet_error_)
+        {
+            checkPacketError();
+            return;
+        }
+
         if (reply.error_code() != proto::FILE_ERROR_SUCCESS)
         {
-            onError(Error::Type::WRITE_FILE, reply.error_code(), frontTask().targetPath());
+            onPacketError(Error::Type::WRITE_FILE, reply.error_code(), frontTask().targetPath());
             return;
         }
 
+        const size_t packet_size = common::filePacketDataSize(request.packet());
+
+        in_flight_size_ -= std::min(in_flight_size_, packet_size);
+        packet_window_.onPacketAcknowledged(packet_size);
+
         const int64_t full_task_size = frontTask().size();
         if (full_task_size && total_size_)
         {
-            int64_t packet_size = common::kMaxFilePacketSize;
-
-            task_transfered_size_ += packet_size;
-
-            if (task_transfered_size_ > full_task_size)
-            {
-                packet_size = task_transfered_size_ - full_task_size;
-                task_transfered_size_ = full_task_size;
-            }
+            const int64_t transfered_size = std::min(
+                static_cast<int64_t>(packet_size), full_task_size - task_transfered_size_);
 
-            total_transfered_size_ += packet_size;
+            task_transfered_size_ += transfered_size;
+            total_transfered_size_ += transfered_size;
 
             const int task_percentage =
                 static_cast<int>(task_transfered_size_ * 100 / full_task_size);
@@ -292,15 +320,15 @@ void FileTransfer::targetReply(const proto::FileRequest& request, const proto::F
 
         if (request.packet().flags() & proto::FilePacket::LAST_PACKET)
         {
+            // The last packet is acknowledged after all others.
+            DCHECK_EQ(pending_source_packets_, 0);
+            DCHECK_EQ(pending_target_packets_, 0);
+
             doNextTask();
             return;
         }
 
-        uint32_t flags = proto::FilePacketRequest::NO_FLAGS;
-        if (is_canceled_)
-            flags = proto::FilePacketRequest::CANCEL;
-
-        task_consumer_proxy_->doTask(task_factory_source_->packetRequest(flags));
+        fillPacketWindow();
     }
     else
     {
@@ -308,7 +336,9 @@ void FileTransfer::targetReply(const proto::FileRequest& request, const proto::F
     }
 }
 
-void FileTransfer::sourceReply(const proto::FileRequest& request, const proto::FileReply& reply)
+void FileTransfer::sourceReply(const proto::FileRequest& request,
+                               const proto::FileReply& reply,
+                               base::ByteArray&& reply_data)
 {
     if (tasks_.empty())
         return;
@@ -323,18 +353,60 @@ void FileTransfer::sourceReply(const proto::FileRequest& request, const proto::F
             return;
         }
 
-        task_consumer_proxy_->doTask(
-            task_factory_target_->upload(front_task.targetPath(), front_task.overwrite()));
+        // When an existing file is replaced, only the changed blocks are sent. This also resumes
+        // an interrupted transfer of the file.
+        const bool delta =
+            front_task.overwrite() && front_task.size() >= common::kMinDeltaFileSize;
+
+        task_consumer_proxy_->doTask(task_factory_target_->upload(
+            front_task.targetPath(), front_task.overwrite(), delta));
     }
     else if (request.has_packet_request())
     {
+        --pending_source_packets_;
+
+        if (packet_error_)
+        {
+            checkPacketError();
+            return;
+        }
+
         if (reply.error_code() != proto::FILE_ERROR_SUCCESS)
         {
-            onError(Error::Type::READ_FILE, reply.error_code(), frontTask().sourcePath());
+            onPacketError(Error::Type::READ_FILE, reply.error_code(), frontTask().sourcePath());
             return;
         }
 
-        task_consumer_proxy_->doTask(task_factory_target_->packet(reply.packet()));
+        const proto::FilePacket& packet = reply.packet();
+
+        if (!first_packet_received_)
+        {
+            // Only the first packet was requested, so nothing else is in flight.
+            first_packet_received_ = true;
+            max_packet_size_ = std::min(
+                static_cast<size_t>(packet.max_packet_size()), common::kMaxFilePacketSize);
+            in_flight_size_ = common::filePacketDataSize(packet);
+
+            if (packet.flags() & proto::FilePacket::LAST_PACKET)
+            {
+                all_packets_requested_ = true;
+            }
+            else if (packet.file_size() > in_flight_size_)
+            {
+                unrequested_size_ = packet.file_size() - in_flight_size_;
+            }
+        }
+
+        // The detached data is passed to the target without copying.
+        ++pending_target_packets_;
+        task_consumer_proxy_->doTask(
+            task_factory_target_->packet(packet, std::move(reply_data)));
+
+        fillPacketWindow();
+    }
+    else if (request.has_read_batch_request())
+    {
+        onReadBatchReply(reply);
     }
     else
     {
@@ -378,14 +450,32 @@ void FileTransfer::setAction(Error::Type error_type, Error::Action action)
 
 void FileTransfer::doFrontTask(bool overwrite)
 {
+    DCHECK_EQ(pending_source_packets_, 0);
+    DCHECK_EQ(pending_target_packets_, 0);
+
     task_percentage_ = 0;
     task_transfered_size_ = 0;
 
+    first_packet_received_ = false;
+    all_packets_requested_ = false;
+    max_packet_size_ = 0;
+    block_size_ = 0;
+    unrequested_size_ = 0;
+    in_flight_size_ = 0;
+    packet_window_.onFileStarted();
+
     Task& front_task = frontTask();
     front_task.setOverwrite(overwrite);
 
     transfer_window_proxy_->setCurrentItem(front_task.sourcePath(), front_task.targetPath());
 
+    if (batch_supported_ && !unbatched_count_ && !front_task.isDirectory() &&
+        front_task.size() <= static_cast<int64_t>(common::kMaxBatchedFileSize))
+    {
+        doBatch();
+        return;
+    }
+
     if (front_task.isDirectory())
     {
         task_consumer_proxy_->doTask(
@@ -400,18 +490,23 @@ void FileTransfer::doFrontTask(bool overwrite)
 
 void FileTransfer::doNextTask()
 {
-    if (is_canceled_)
-    {
-        while (!tasks_.empty())
-            tasks_.pop_front();
-    }
-
     if (!tasks_.empty())
     {
         // Delete the task only after confirmation of its successful execution.
         tasks_.pop_front();
+
+        if (unbatched_count_)
+            --unbatched_count_;
     }
 
+    continueTransfer();
+}
+
+void FileTransfer::continueTransfer()
+{
+    if (is_canceled_)
+        tasks_.clear();
+
     if (tasks_.empty())
     {
         if (cancel_timer_.isActive())
@@ -424,6 +519,223 @@ void FileTransfer::doNextTask()
     doFrontTask(false);
 }
 
+void FileTransfer::doBatch()
+{
+    std::unique_ptr<proto::FileBatch> batch = std::make_unique<proto::FileBatch>();
+    int64_t batch_size = 0;
+
+    for (const Task& task : tasks_)
+    {
+        if (task.isDirectory() ||
+            task.size() > static_cast<int64_t>(common::kMaxBatchedFileSize) ||
+            batch_size + task.size() > static_cast<int64_t>(common::kMaxFileBatchSize) ||
+            batch->entry_size() >= common::kMaxFileBatchCount)
+        {
+            break;
+        }
+
+        batch_size += task.size();
+        batch->add_entry()->set_path(task.sourcePath());
+    }
+
+    DCHECK_GT(batch->entry_size(), 0);
+
+    batch_count_ = batch->entry_size();
+    batch_done_.assign(static_cast<size_t>(batch_count_), false);
+    batch_write_indexes_.clear();
+
+    task_consumer_proxy_->doTask(task_factory_source_->readBatch(std::move(batch)));
+}
+
+void FileTransfer::onReadBatchReply(const proto::FileReply& reply)
+{
+    if (reply.error_code() != proto::FILE_ERROR_SUCCESS ||
+        reply.batch().entry_size() != batch_count_)
+    {
+        // Older sources do not support batches.
+        batch_supported_ = false;
+        finishBatch();
+        return;
+    }
+
+    if (is_canceled_)
+    {
+        finishBatch();
+        return;
+    }
+
+    // Existing files are replaced only if the user has chosen it for all files.
+    auto action = actions_.find(Error::Type::ALREADY_EXISTS);
+    const bool overwrite =
+        action != actions_.end() && action->second == Error::ACTION_REPLACE_ALL;
+
+    std::unique_ptr<proto::FileBatch> batch = std::make_unique<proto::FileBatch>();
+
+    for (int i = 0; i < batch_count_; ++i)
+    {
+        const proto::FileBatchEntry& entry = reply.batch().entry(i);
+        if (entry.error_code() != proto::FILE_ERROR_SUCCESS)
+            continue;
+
+        proto::FileBatchEntry* target_entry = batch->add_entry();
+        target_entry->set_path(tasks_[static_cast<size_t>(i)].targetPath());
+        target_entry->set_overwrite(overwrite);
+        target_entry->set_data(entry.data());
+
+        batch_write_indexes_.push_back(i);
+    }
+
+    if (!batch->entry_size())
+    {
+        finishBatch();
+        return;
+    }
+
+    task_consumer_proxy_->doTask(task_factory_target_->writeBatch(std::move(batch)));
+}
+
+void FileTransfer::onWriteBatchReply(const proto::FileReply& reply)
+{
+    if (reply.error_code() != proto::FILE_ERROR_SUCCESS ||
+        reply.batch().entry_size() != static_cast<int>(batch_write_indexes_.size()))
+    {
+        // Older targets do not support batches.
+        batch_supported_ = false;
+        finishBatch();
+        return;
+    }
+
+    for (int i = 0; i < reply.batch().entry_size(); ++i)
+    {
+        if (reply.batch().entry(i).error_code() == proto::FILE_ERROR_SUCCESS)
+            batch_done_[static_cast<size_t>(batch_write_indexes_[static_cast<size_t>(i)])] = true;
+    }
+
+    finishBatch();
+}
+
+void FileTransfer::finishBatch()
+{
+    TaskList failed_tasks;
+
+    for (int i = 0; i < batch_count_; ++i)
+    {
+        if (batch_done_[static_cast<size_t>(i)])
+            total_transfered_size_ += frontTask().size();
+        else
+            failed_tasks.emplace_back(std::move(frontTask()));
+
+        tasks_.pop_front();
+    }
+
+    batch_count_ = 0;
+    batch_done_.clear();
+    batch_write_indexes_.clear();
+
+    unbatched_count_ = failed_tasks.size();
+    tasks_.insert(tasks_.begin(),
+                  std::make_move_iterator(failed_tasks.begin()),
+                  std::make_move_iterator(failed_tasks.end()));
+
+    if (total_size_)
+    {
+        const int total_percentage = static_cast<int>(total_transfered_size_ * 100 / total_size_);
+        if (total_percentage != total_percentage_)
+        {
+            total_percentage_ = total_percentage;
+            transfer_window_proxy_->setCurrentProgress(total_percentage_, 100);
+        }
+    }
+
+    continueTransfer();
+}
+
+void FileTransfer::requestPacket(
+    uint32_t flags, size_t packet_size, const proto::FileBlockList* block_list)
+{
+    ++pending_source_packets_;
+    packet_window_.onPacketSent();
+
+    if (packet_compression_)
+        flags |= proto::FilePacketRequest::COMPRESS;
+
+    if (packet_detached_data_)
+        flags |= proto::FilePacketRequest::DETACH_DATA;
+
+    if (block_list)
+    {
+        task_consumer_proxy_->doTask(task_factory_source_->packetRequest(
+            flags, static_cast<uint32_t>(packet_size), *block_list));
+    }
+    else
+    {
+        task_consumer_proxy_->doTask(
+            task_factory_source_->packetRequest(flags, static_cast<uint32_t>(packet_size)));
+    }
+}
+
+void FileTransfer::fillPacketWindow()
+{
+    if (!first_packet_received_)
+        return;
+
+    while (!all_packets_requested_)
+    {
+        if (is_canceled_)
+        {
+            // The source replies with an empty last packet after the packets in flight and the
+            // target deletes the file.
+            all_packets_requested_ = true;
+            requestPacket(proto::FilePacketRequest::CANCEL, 0);
+            break;
+        }
+
+        size_t packet_size = common::kDefaultFilePacketSize;
+        if (max_packet_size_)
+        {
+            if (block_size_)
+                packet_size = std::min(block_size_, max_packet_size_);
+            else
+                packet_size = std::min(packet_window_.packetSize(), max_packet_size_);
+        }
+
+        // The source reads the rest of the file, so the size of each packet is known in advance.
+        packet_size = static_cast<size_t>(std::min<uint64_t>(packet_size, unrequested_size_));
+
+        if (in_flight_size_ && in_flight_size_ + packet_size > packet_window_.windowSize())
+            break;
+
+        in_flight_size_ += packet_size;
+        unrequested_size_ -= packet_size;
+
+        if (!unrequested_size_)
+            all_packets_requested_ = true;
+
+        requestPacket(proto::FilePacketRequest::NO_FLAGS, packet_size);
+    }
+}
+
+void FileTransfer::onPacketError(
+    Error::Type type, proto::FileError code, const std::string& path)
+{
+    packet_error_.emplace(type, code, path);
+    checkPacketError();
+}
+
+void FileTransfer::checkPacketError()
+{
+    DCHECK(packet_error_);
+
+    // The replies to the packets in flight are ignored. The next task must not receive them.
+    if (pending_source_packets_ || pending_target_packets_)
+        return;
+
+    const Error error = *packet_error_;
+    packet_error_.reset();
+
+    onError(error.type(), error.code(), error.path());
+}
+
 void FileTransfer::onError(Error::Type type, proto::FileError code, const std::string& path)
 {
     auto default_action = actions_.find(type);
@@ -20,11 +20,13 @@
 #define CLIENT_FILE_TRANSFER_H
 
 #include "base/waitable_timer.h"
+#include "client/file_packet_window.h"
 #include "common/file_task.h"
 #include "common/file_task_producer.h"
 #include "proto/file_transfer.pb.h"
 
 #include <deque>
+#include <optional>
 
 namespace base {
 class TaskRunner;
@@ -176,9 +178,21 @@ protected:
 private:
     Task& frontTask();
     void targetReply(const proto::FileRequest& request, const proto::FileReply& reply);
-    void sourceReply(const proto::FileRequest& request, const proto::FileReply& reply);
+    void sourceReply(const proto::FileRequest& request,
+                     const proto::FileReply& reply,
+                     base::ByteArray&& reply_data);
     void doFrontTask(bool overwrite);
     void doNextTask();
+    void continueTransfer();
+    void doBatch();
+    void onReadBatchReply(const proto::FileReply& reply);
+    void onWriteBatchReply(const proto::FileReply& reply);
+    void finishBatch();
+    void requestPacket(uint32_t flags, size_t packet_size,
+                       const proto::FileBlockList* block_list = nullptr);
+    void fillPacketWindow();
+    void onPacketError(Error::Type type, proto::FileError code, const std::string& path);
+    void checkPacketError();
     void onError(Error::Type type, proto::FileError code, const std::string& path = std::string());
     void setActionForErrorType(Error::Type error_type, Error::Action action);
     void onFinished();
@@ -208,6 +222,32 @@ private:
     int total_percentage_ = 0;
     int task_percentage_ = 0;
 
+    // Several packets of the current file are in flight. The source replies to the packet
+    // requests and the target acknowledges the packets in order.
+    FilePacketWindow packet_window_;
+    bool first_packet_received_ = false;
+    bool all_packets_requested_ = false;
+    bool packet_compression_ = false; // The target accepts compressed packets.
+    bool packet_detached_data_ = false; // The target accepts packets with detached data.
+    size_t max_packet_size_ = 0; // Zero if the source supports only the default size.
+    size_t block_size_ = 0; // Nonzero if the target has reported the blocks of the existing file.
+    uint64_t unrequested_size_ = 0;
+    size_t in_flight_size_ = 0;
+    int pending_source_packets_ = 0;
+    int pending_target_packets_ = 0;
+
+    // An error is reported only after the replies to all packets in flight have been received.
+    std::optional<Error> packet_error_;
+
+    // Small files at the front of the queue are transferred in batches. The files that failed in
+    // a batch are moved to the front of the queue and transferred separately, which reports the
+    // errors in the usual way.
+    bool batch_supported_ = true;
+    int batch_count_ = 0;
+    std::vector<int> batch_write_indexes_; // Indexes of the batch tasks sent to the target.
+    std::vector<bool> batch_done_;
+    size_t unbatched_count_ = 0;
+
     bool is_canceled_ = false;
 
     DISALLOW_COPY_AND_ASSIGN(FileTransfer);
@@ -72,6 +72,12 @@ void FileTransferQueueBuilder::onTaskDone(std::shared_ptr<common::FileTask> task
     const proto::FileRequest& request = task->request();
     const proto::FileReply& reply = task->reply();
 
+    if (request.has_file_tree_request())
+    {
+        onFileTree(request.file_tree_request(), reply);
+        return;
+    }
+
     if (!request.has_file_list_request())
     {
         onAborted(proto::FILE_ERROR_UNKNOWN);
@@ -102,6 +108,48 @@ void FileTransferQueueBuilder::onTaskDone(std::shared_ptr<common::FileTask> task
     doPendingTasks();
 }
 
+void FileTransferQueueBuilder::onFileTree(
+    const proto::FileTreeRequest& request, const proto::FileReply& reply)
+{
+    if (reply.error_code() == proto::FILE_ERROR_INVALID_REQUEST && !request.next())
+    {
+        // Older peers list only one directory per request.
+        is_tree_supported_ = false;
+        task_consumer_proxy_->doTask(task_factory_->fileList(request.path()));
+        return;
+    }
+
+    if (reply.error_code() != proto::FILE_ERROR_SUCCESS)
+    {
+        onAborted(reply.error_code());
+        return;
+    }
+
+    const proto::FileTree& file_tree = reply.file_tree();
+
+    // The whole tree is listed, so the items are added to the queue directly.
+    for (int i = 0; i < file_tree.item_size(); ++i)
+    {
+        const proto::FileTree::Item& item = file_tree.item(i);
+        const int64_t size = static_cast<int64_t>(item.size());
+
+        total_size_ += size;
+
+        tasks_.emplace_back(tree_source_path_ + '/' + item.path(),
+                            tree_target_path_ + '/' + item.path(),
+                            item.is_directory(),
+                            size);
+    }
+
+    if (!file_tree.is_last())
+    {
+        task_consumer_proxy_->doTask(task_factory_->fileTree(request.path(), true));
+        return;
+    }
+
+    doPendingTasks();
+}
+
 void FileTransferQueueBuilder::addPendingTask(const std::string& source_dir,
                                               const std::string& target_dir,
                                               const std::string& item_name,
@@ -123,9 +171,21 @@ void FileTransferQueueBuilder::doPendingTasks()
         tasks_.emplace_back(std::move(pending_tasks_.front()));
         pending_tasks_.pop_front();
 
-        if (tasks_.back().isDirectory())
+        const FileTransfer::Task& task = tasks_.back();
+
+        if (task.isDirectory())
         {
-            task_consumer_proxy_->doTask(task_factory_->fileList(tasks_.back().sourcePath()));
+            if (is_tree_supported_)
+            {
+                tree_source_path_ = task.sourcePath();
+                tree_target_path_ = task.targetPath();
+
+                task_consumer_proxy_->doTask(task_factory_->fileTree(task.sourcePath(), false));
+            }
+            else
+            {
+                task_consumer_proxy_->doTask(task_factory_->fileList(task.sourcePath()));
+            }
             return;
         }
     }
@@ -53,6 +53,7 @@ private:
                         const std::string& item_name,
                         bool is_directory,
                         int64_t size);
+    void onFileTree(const proto::FileTreeRequest& request, const proto::FileReply& reply);
     void doPendingTasks();
     void onAborted(proto::FileError error_code);
 
@@ -66,6 +67,11 @@ private:
     FileTransfer::TaskList tasks_;
     int64_t total_size_ = 0;
 
+    // The tree of each directory is listed with one request (in several parts for large trees).
+    bool is_tree_supported_ = true;
+    std::string tree_source_path_;
+    std::string tree_target_path_;
+
     DISALLOW_COPY_AND_ASSIGN(FileTransferQueueBuilder);
 };
 
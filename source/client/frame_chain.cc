@@ -0,0 +1,96 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "client/frame_chain.h"
+
+#include "base/logging.h"
+#include "base/desktop/frame.h"
+
+namespace client {
+
+FrameChain::FrameChain(const Frames& frames)
+{
+    for (size_t i = 0; i < kBufferCount; ++i)
+    {
+        DCHECK(frames[i]);
+        DCHECK(frames[i]->size() == frames[0]->size());
+
+        buffers_[i].frame = frames[i];
+    }
+}
+
+FrameChain::~FrameChain() = default;
+
+base::Frame* FrameChain::decodeFrame() const
+{
+    return buffers_[decode_index_].frame.get();
+}
+
+void FrameChain::publish()
+{
+    const Buffer& decoded = buffers_[decode_index_];
+    const base::Region& updated_region = decoded.frame->constUpdatedRegion();
+
+    for (size_t i = 0; i < kBufferCount; ++i)
+    {
+        if (i != decode_index_)
+            buffers_[i].stale_region.addRegion(updated_region);
+    }
+
+    const size_t newest_index = decode_index_;
+
+    {
+        std::scoped_lock lock(lock_);
+
+        // The previous ready frame was not displayed, so it is decoded into instead.
+        decode_index_ = ready_index_;
+        ready_index_ = newest_index;
+        newest_index_ = newest_index;
+        has_ready_frame_ = true;
+    }
+
+    // The newest frame is only read by the window, so it can be copied without the lock.
+    Buffer& next = buffers_[decode_index_];
+    const base::Frame& newest_frame = *buffers_[newest_index].frame;
+
+    for (base::Region::Iterator it(next.stale_region); !it.isAtEnd(); it.advance())
+        next.frame->copyPixelsFrom(newest_frame, it.rect().topLeft(), it.rect());
+
+    next.stale_region.clear();
+}
+
+std::shared_ptr<base::Frame> FrameChain::newestFrame() const
+{
+    std::scoped_lock lock(lock_);
+    return buffers_[newest_index_].frame;
+}
+
+std::shared_ptr<base::Frame> FrameChain::takeDisplayFrame()
+{
+    std::scoped_lock lock(lock_);
+
+    if (has_ready_frame_)
+    {
+        std::swap(display_index_, ready_index_);
+        has_ready_frame_ = false;
+    }
+
+    return buffers_[display_index_].frame;
+}
+
+} // namespace client
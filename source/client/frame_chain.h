@@ -0,0 +1,90 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CLIENT_FRAME_CHAIN_H
+#define CLIENT_FRAME_CHAIN_H
+
+#include "base/macros_magic.h"
+#include "base/desktop/region.h"
+
+#include <array>
+#include <memory>
+#include <mutex>
+
+namespace base {
+class Frame;
+} // namespace base
+
+namespace client {
+
+// Three buffers of the desktop frame, so that the decoder and the window never wait for each
+// other: the decoder writes to one buffer, the window shows another one and the third one holds
+// the newest decoded frame until the window takes it. The decoder only changes the updated areas
+// of a frame, so before a buffer is decoded into again, the areas that were changed in the other
+// buffers in the meantime are copied into it from the newest frame.
+class FrameChain
+{
+public:
+    static const size_t kBufferCount = 3;
+    using Frames = std::array<std::shared_ptr<base::Frame>, kBufferCount>;
+
+    // The frames must have the same size.
+    explicit FrameChain(const Frames& frames);
+    ~FrameChain();
+
+    // Called on the decoding thread. Returns the buffer to decode into.
+    base::Frame* decodeFrame() const;
+
+    // Called on the decoding thread. Makes the decoded buffer the newest frame and prepares the
+    // next buffer for decoding. The updated region of the decoded buffer is the changed area.
+    void publish();
+
+    // Returns the newest decoded frame. Its content may be changed by the decoder later.
+    std::shared_ptr<base::Frame> newestFrame() const;
+
+    // Called on the UI thread. Makes the newest decoded frame the displayed one and returns it.
+    // The displayed frame is not changed by the decoder until the next call.
+    std::shared_ptr<base::Frame> takeDisplayFrame();
+
+private:
+    struct Buffer
+    {
+        std::shared_ptr<base::Frame> frame;
+
+        // The areas changed in the other buffers since this one was decoded into. Used only on
+        // the decoding thread.
+        base::Region stale_region;
+    };
+
+    std::array<Buffer, kBufferCount> buffers_;
+
+    // Used only on the decoding thread.
+    size_t decode_index_ = 0;
+
+    mutable std::mutex lock_;
+    size_t ready_index_ = 1;
+    size_t display_index_ = 2;
+    size_t newest_index_ = 2;
+    bool has_ready_frame_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(FrameChain);
+};
+
+} // namespace client
+
+#endif // CLIENT_FRAME_CHAIN_H
@@ -0,0 +1,70 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "client/latency_stats.h"
+
+#include "base/logging.h"
+
+#include <algorithm>
+
+namespace client {
+
+LatencyStats::LatencyStats() = default;
+
+LatencyStats::~LatencyStats() = default;
+
+void LatencyStats::addSample(Stage stage, const std::chrono::microseconds& duration)
+{
+    DCHECK_LT(static_cast<size_t>(stage), kStageCount);
+
+    std::scoped_lock lock(lock_);
+
+    Accumulator& accumulator = accumulators_[static_cast<size_t>(stage)];
+    ++accumulator.count;
+    accumulator.total += duration;
+    accumulator.max = std::max(accumulator.max, duration);
+}
+
+LatencyStats::Metrics LatencyStats::takeMetrics()
+{
+    std::scoped_lock lock(lock_);
+
+    for (size_t i = 0; i < kStageCount; ++i)
+    {
+        Accumulator& accumulator = accumulators_[i];
+        if (!accumulator.count)
+            continue;
+
+        StageTime& stage = last_metrics_.stages[i];
+        stage.avg = accumulator.total / accumulator.count;
+        stage.max = accumulator.max;
+
+        accumulator = Accumulator();
+    }
+
+    auto avg = [this](Stage stage)
+    {
+        return last_metrics_.stages[static_cast<size_t>(stage)].avg;
+    };
+
+    // The host time already includes the capture and the encoding.
+    last_metrics_.glass_to_glass = avg(Stage::HOST) + avg(Stage::NETWORK) + avg(Stage::QUEUE) +
+                                   avg(Stage::DECODE) + avg(Stage::RENDER);
+    return last_metrics_;
+}
+
+} // namespace client
@@ -0,0 +1,90 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef CLIENT_LATENCY_STATS_H
+#define CLIENT_LATENCY_STATS_H
+
+#include "base/macros_magic.h"
+
+#include <array>
+#include <chrono>
+#include <mutex>
+
+namespace client {
+
+// Collects the durations of the video pipeline stages. The host stages are reported by the host in
+// each video packet, the client stages are measured on the I/O, decoding and UI threads.
+class LatencyStats
+{
+public:
+    LatencyStats();
+    ~LatencyStats();
+
+    enum class Stage
+    {
+        CAPTURE, // Screen capture on the host.
+        ENCODE,  // Video encoding on the host.
+        HOST,    // From the start of the capture until the packet is sent by the host.
+        NETWORK, // Half of the round trip time.
+        QUEUE,   // Waiting for the decoder on the client.
+        DECODE,  // Video decoding on the client.
+        RENDER,  // From the end of the decoding until the frame is drawn.
+        INPUT,   // From sending a mouse event until a frame that reflects it is received.
+        COUNT
+    };
+
+    static const size_t kStageCount = static_cast<size_t>(Stage::COUNT);
+
+    struct StageTime
+    {
+        std::chrono::microseconds avg { 0 };
+        std::chrono::microseconds max { 0 };
+    };
+
+    struct Metrics
+    {
+        std::array<StageTime, kStageCount> stages;
+
+        // Estimate of the time from the capture on the host until the frame is shown on the
+        // client: the host time, the network time and the client stages.
+        std::chrono::microseconds glass_to_glass { 0 };
+    };
+
+    void addSample(Stage stage, const std::chrono::microseconds& duration);
+
+    // Returns the metrics of the samples added since the previous call. If a stage has no new
+    // samples (for example, the screen did not change), its previous values are returned.
+    Metrics takeMetrics();
+
+private:
+    struct Accumulator
+    {
+        int64_t count = 0;
+        std::chrono::microseconds total { 0 };
+        std::chrono::microseconds max { 0 };
+    };
+
+    std::mutex lock_;
+    std::array<Accumulator, kStageCount> accumulators_;
+    Metrics last_metrics_;
+
+    DISALLOW_COPY_AND_ASSIGN(LatencyStats);
+};
+
+} // namespace client
+
+#endif // CLIENT_LATENCY_STATS_H
@@ -21,16 +21,23 @@
 #include "base/location.h"
 #include "base/logging.h"
 #include "base/waitable_timer.h"
+#include "base/task_runner.h"
 #include "base/net/tcp_channel.h"
+#include "base/net/tcp_connector.h"
 #include "proto/key_exchange.pb.h"
 
 namespace client {
 
 namespace {
 
-const size_t kNumberOfParallelTasks = 30;
+const size_t kNumberOfParallelTasks = 64;
 const std::chrono::seconds kTimeout { 15 };
 
+// Computers may have several addresses. If an address does not answer quickly, the next one is
+// tried in parallel.
+const std::chrono::milliseconds kAttemptDelay { 250 };
+const std::chrono::seconds kAttemptTimeout { 5 };
+
 } // namespace
 
 class OnlineCheckerDirect::Instance : public base::TcpChannel::Listener
@@ -53,6 +60,7 @@ protected:
     void onTcpMessageWritten(uint8_t channel_id, size_t pending) override;
 
 private:
+    void onConnected(std::unique_ptr<base::TcpChannel> channel);
     void onFinished(bool online);
 
     const int computer_id_;
@@ -60,6 +68,7 @@ private:
     const uint16_t port_;
 
     FinishCallback finish_callback_;
+    std::unique_ptr<base::TcpConnector> connector_;
     std::unique_ptr<base::TcpChannel> channel_;
     base::WaitableTimer timer_;
 };
@@ -72,18 +81,19 @@ OnlineCheckerDirect::Instance::Instance(
       port_(port),
       timer_(base::WaitableTimer::Type::SINGLE_SHOT, std::move(task_runner))
 {
-    timer_.start(kTimeout, [this]()
-    {
-        LOG(LS_INFO) << "Timeout for computer: " << computer_id_;
-        onFinished(false);
-    });
+    // Nothing
 }
 
 OnlineCheckerDirect::Instance::~Instance()
 {
     finish_callback_ = nullptr;
-    channel_->setListener(nullptr);
-    channel_.reset();
+    connector_.reset();
+
+    if (channel_)
+    {
+        channel_->setListener(nullptr);
+        channel_.reset();
+    }
 }
 
 void OnlineCheckerDirect::Instance::start(FinishCallback finish_callback)
@@ -94,9 +104,32 @@ void OnlineCheckerDirect::Instance::start(FinishCallback finish_callback)
     LOG(LS_INFO) << "Starting connection to " << address_ << ":" << port_
                  << " (computer: " << computer_id_ << ")";
 
-    channel_ = std::make_unique<base::TcpChannel>();
+    timer_.start(kTimeout, [this]()
+    {
+        LOG(LS_INFO) << "Timeout for computer: " << computer_id_;
+        onFinished(false);
+    });
+
+    connector_ = std::make_unique<base::TcpConnector>();
+    connector_->setAttemptDelay(kAttemptDelay);
+    connector_->setAttemptTimeout(kAttemptTimeout);
+    connector_->connect(address_, port_,
+                        std::bind(&Instance::onConnected, this, std::placeholders::_1));
+}
+
+void OnlineCheckerDirect::Instance::onConnected(std::unique_ptr<base::TcpChannel> channel)
+{
+    if (!channel)
+    {
+        LOG(LS_INFO) << "Unable to connect to computer: " << computer_id_;
+        onFinished(false);
+        return;
+    }
+
+    channel_ = std::move(channel);
     channel_->setListener(this);
-    channel_->connect(address_, port_);
+
+    onTcpConnected();
 }
 
 void OnlineCheckerDirect::Instance::onTcpConnected()
@@ -157,10 +190,14 @@ void OnlineCheckerDirect::Instance::onTcpMessageWritten(
 
 void OnlineCheckerDirect::Instance::onFinished(bool online)
 {
+    timer_.stop();
+
     if (finish_callback_)
     {
-        finish_callback_(computer_id_, online);
-        finish_callback_ = nullptr;
+        // The callback destroys the instance.
+        FinishCallback finish_callback;
+        finish_callback.swap(finish_callback_);
+        finish_callback(computer_id_, online);
     }
     else
     {
@@ -197,8 +234,12 @@ void OnlineCheckerDirect::start(const ComputerList& computers, Delegate* delegat
         return;
     }
 
-    size_t count = std::min(pending_queue_.size(), kNumberOfParallelTasks);
-    while (count != 0)
+    startNextInstances();
+}
+
+void OnlineCheckerDirect::startNextInstances()
+{
+    while (!pending_queue_.empty() && work_queue_.size() < kNumberOfParallelTasks)
     {
         const Computer& computer = pending_queue_.front();
         std::unique_ptr<Instance> instance = std::make_unique<Instance>(
@@ -206,16 +247,14 @@ void OnlineCheckerDirect::start(const ComputerList& computers, Delegate* delegat
 
         LOG(LS_INFO) << "Instance for '" << computer.computer_id << "' is created (address: "
                      << computer.address << " port: " << computer.port << ")";
+
+        Instance* instance_ptr = instance.get();
+
         work_queue_.emplace_back(std::move(instance));
         pending_queue_.pop_front();
 
-        --count;
-    }
-
-    for (const auto& task : work_queue_)
-    {
-        task->start(std::bind(&OnlineCheckerDirect::onChecked, this,
-                              std::placeholders::_1, std::placeholders::_2));
+        instance_ptr->start(std::bind(&OnlineCheckerDirect::onChecked, this,
+                                      std::placeholders::_1, std::placeholders::_2));
     }
 }
 
@@ -231,37 +270,24 @@ void OnlineCheckerDirect::onChecked(int computer_id, bool online)
         return;
     }
 
-    if (!pending_queue_.empty())
-    {
-        const Computer& computer = pending_queue_.front();
-        std::unique_ptr<Instance> instance = std::make_unique<Instance>(
-            computer.computer_id, computer.address, computer.port, task_runner_);
-
-        LOG(LS_INFO) << "Instance for '" << computer.computer_id << "' is created (address: "
-                     << computer.address << " port: " << computer.port << ")";
-
-        work_queue_.emplace_back(std::move(instance));
-        work_queue_.back()->start(std::bind(&OnlineCheckerDirect::onChecked, this,
-                                            std::placeholders::_1, std::placeholders::_2));
-        pending_queue_.pop_front();
-    }
-    else
+    // The connection is closed as soon as the result is known, so that the slot is free for the
+    // next computer. The instance is on the stack, so it is destroyed later.
+    for (auto it = work_queue_.begin(); it != work_queue_.end(); ++it)
     {
-        for (auto it = work_queue_.begin(); it != work_queue_.end(); ++it)
+        if (it->get()->computerId() == computer_id)
         {
-            if (it->get()->computerId() == computer_id)
-            {
-                work_queue_.erase(it);
-                break;
-            }
+            task_runner_->deleteSoon(std::move(*it));
+            work_queue_.erase(it);
+            break;
         }
+    }
 
-        if (work_queue_.empty())
-        {
-            LOG(LS_INFO) << "No more items in queue";
-            onFinished(FROM_HERE);
-            return;
-        }
+    startNextInstances();
+
+    if (work_queue_.empty())
+    {
+        LOG(LS_INFO) << "No more items in queue";
+        onFinished(FROM_HERE);
     }
 }
 
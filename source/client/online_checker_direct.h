@@ -56,6 +56,7 @@ public:
     void start(const ComputerList& computers, Delegate* delegate);
 
 private:
+    void startNextInstances();
     void onChecked(int computer_id, bool online);
     void onFinished(const base::Location& location);
 
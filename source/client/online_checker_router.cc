@@ -30,6 +30,9 @@ namespace {
 
 const std::chrono::seconds kTimeout { 30 };
 
+const size_t kBatchSize = 256;
+const size_t kMaxPendingBatches = 4;
+
 } // namespace
 
 OnlineCheckerRouter::OnlineCheckerRouter(const RouterConfig& router_config,
@@ -40,11 +43,7 @@ OnlineCheckerRouter::OnlineCheckerRouter(const RouterConfig& router_config,
 {
     LOG(LS_INFO) << "Ctor";
     DCHECK(task_runner_);
-
-    timer_.start(kTimeout, [this]()
-    {
-        onFinished(FROM_HERE);
-    });
+    startTimer();
 }
 
 OnlineCheckerRouter::~OnlineCheckerRouter()
@@ -100,7 +99,11 @@ void OnlineCheckerRouter::onTcpConnected()
             // Now the session will receive incoming messages.
             channel_->resume();
 
-            checkNextComputer();
+            batch_support_ = authenticator_->peerVersion() >= base::Version(2, 7, 0);
+            if (batch_support_)
+                sendNextBatches();
+            else
+                checkNextComputer();
         }
         else
         {
@@ -135,6 +138,12 @@ void OnlineCheckerRouter::onTcpMessageReceived(
         return;
     }
 
+    if (message.has_host_status_list())
+    {
+        readHostStatusList(message.host_status_list());
+        return;
+    }
+
     if (!message.has_host_status())
     {
         LOG(LS_ERROR) << "HostStatus not present in message";
@@ -175,6 +184,74 @@ void OnlineCheckerRouter::checkNextComputer()
     channel_->send(proto::ROUTER_CHANNEL_ID_SESSION, base::serialize(message));
 }
 
+void OnlineCheckerRouter::sendNextBatches()
+{
+    if (computers_.empty() && pending_batches_.empty())
+    {
+        LOG(LS_INFO) << "No more computers";
+        onFinished(FROM_HERE);
+        return;
+    }
+
+    while (!computers_.empty() && pending_batches_.size() < kMaxPendingBatches)
+    {
+        Batch& batch = pending_batches_.emplace_back();
+        batch.request_id = ++last_request_id_;
+
+        proto::PeerToRouter message;
+        proto::CheckHostStatusList* check_host_status_list =
+            message.mutable_check_host_status_list();
+        check_host_status_list->set_request_id(batch.request_id);
+
+        while (!computers_.empty() && batch.computers.size() < kBatchSize)
+        {
+            check_host_status_list->add_host_id(computers_.front().host_id);
+            batch.computers.emplace_back(computers_.front());
+            computers_.pop_front();
+        }
+
+        LOG(LS_INFO) << "Checking status for " << batch.computers.size() << " hosts (request "
+                     << batch.request_id << ")";
+
+        channel_->send(proto::ROUTER_CHANNEL_ID_SESSION, base::serialize(message));
+    }
+}
+
+void OnlineCheckerRouter::readHostStatusList(const proto::HostStatusList& host_status_list)
+{
+    if (pending_batches_.empty() ||
+        pending_batches_.front().request_id != host_status_list.request_id())
+    {
+        LOG(LS_ERROR) << "Unexpected host status list: " << host_status_list.request_id();
+        onFinished(FROM_HERE);
+        return;
+    }
+
+    Batch batch = std::move(pending_batches_.front());
+    pending_batches_.pop_front();
+
+    // The router answers in time, so a large address book does not hit the timeout.
+    startTimer();
+
+    for (size_t i = 0; i < batch.computers.size(); ++i)
+    {
+        bool online = i < static_cast<size_t>(host_status_list.status_size()) &&
+            host_status_list.status(static_cast<int>(i)) == proto::HostStatus::STATUS_ONLINE;
+
+        delegate_->onRouterCheckerResult(batch.computers[i].computer_id, online);
+    }
+
+    sendNextBatches();
+}
+
+void OnlineCheckerRouter::startTimer()
+{
+    timer_.start(kTimeout, [this]()
+    {
+        onFinished(FROM_HERE);
+    });
+}
+
 void OnlineCheckerRouter::onFinished(const base::Location& location)
 {
     if (!delegate_)
@@ -191,6 +268,14 @@ void OnlineCheckerRouter::onFinished(const base::Location& location)
     if (authenticator_)
         task_runner_->deleteSoon(std::move(authenticator_));
 
+    for (const auto& batch : pending_batches_)
+    {
+        for (const auto& computer : batch.computers)
+            delegate_->onRouterCheckerResult(computer.computer_id, false);
+    }
+
+    pending_batches_.clear();
+
     for (const auto& computer : computers_)
         delegate_->onRouterCheckerResult(computer.computer_id, false);
 
@@ -25,6 +25,10 @@
 
 #include <deque>
 
+namespace proto {
+class HostStatusList;
+} // namespace proto
+
 namespace base {
 class ClientAuthenticator;
 class Location;
@@ -66,7 +70,16 @@ protected:
     void onTcpMessageWritten(uint8_t channel_id, size_t pending) override;
 
 private:
+    struct Batch
+    {
+        uint32_t request_id = 0;
+        ComputerList computers;
+    };
+
     void checkNextComputer();
+    void sendNextBatches();
+    void readHostStatusList(const proto::HostStatusList& host_status_list);
+    void startTimer();
     void onFinished(const base::Location& location);
 
     std::shared_ptr<base::TaskRunner> task_runner_;
@@ -76,6 +89,13 @@ private:
     RouterConfig router_config_;
 
     ComputerList computers_;
+
+    // Routers since version 2.7.0 answer status requests for many hosts at once. Several of these
+    // requests are sent without waiting for the replies.
+    bool batch_support_ = false;
+    std::deque<Batch> pending_batches_;
+    uint32_t last_request_id_ = 0;
+
     Delegate* delegate_ = nullptr;
 };
 
@@ -21,6 +21,7 @@
 #include "base/logging.h"
 #include "base/task_runner.h"
 #include "base/peer/client_authenticator.h"
+#include "base/strings/unicode.h"
 #include "proto/router_peer.pb.h"
 
 namespace client {
@@ -91,7 +92,22 @@ void RouterController::onTcpConnected()
 
             // Send connection request.
             proto::PeerToRouter message;
-            message.mutable_connection_request()->set_host_id(host_id_);
+            proto::ConnectionRequest* request = message.mutable_connection_request();
+            request->set_host_id(host_id_);
+
+            // The host is first tried directly from this port. Without the port the relay is
+            // used as before.
+            direct_port_ = std::make_unique<base::DirectPort>();
+            if (direct_port_->open())
+            {
+                request->mutable_direct()->CopyFrom(
+                    direct_port_->candidates(base::utf8FromUtf16(channel_->localAddress())));
+            }
+            else
+            {
+                direct_port_.reset();
+            }
+
             channel_->send(proto::ROUTER_CHANNEL_ID_SESSION, base::serialize(message));
         }
         else
@@ -150,7 +166,7 @@ void RouterController::onTcpMessageReceived(uint8_t /* channel_id */, const base
 
     if (message.has_connection_offer())
     {
-        if (relay_peer_)
+        if (relay_peer_ || direct_peer_)
         {
             LOG(LS_ERROR) << "Re-offer connection detected";
             return;
@@ -189,10 +205,14 @@ void RouterController::onTcpMessageReceived(uint8_t /* channel_id */, const base
                 LOG(LS_WARNING) << "Invalid delegate";
             }
         }
+        else if (direct_port_ && connection_offer.direct().endpoint_size())
+        {
+            direct_peer_ = std::make_unique<base::DirectPeer>();
+            direct_peer_->start(connection_offer, direct_port_->port(), this);
+        }
         else
         {
-            relay_peer_ = std::make_unique<base::RelayPeer>();
-            relay_peer_->start(connection_offer, this);
+            startRelayPeer(connection_offer);
         }
     }
     else
@@ -233,4 +253,25 @@ void RouterController::onRelayConnectionError()
     delegate_->onErrorOccurred(error);
 }
 
+void RouterController::onDirectConnectionReady(std::unique_ptr<base::TcpChannel> channel)
+{
+    onRelayConnectionReady(std::move(channel));
+}
+
+void RouterController::onDirectConnectionError()
+{
+    LOG(LS_INFO) << "Falling back to relay";
+
+    proto::ConnectionOffer offer = direct_peer_->connectionOffer();
+    task_runner_->deleteSoon(std::move(direct_peer_));
+
+    startRelayPeer(offer);
+}
+
+void RouterController::startRelayPeer(const proto::ConnectionOffer& offer)
+{
+    relay_peer_ = std::make_unique<base::RelayPeer>();
+    relay_peer_->start(offer, this);
+}
+
 } // namespace client
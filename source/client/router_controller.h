@@ -22,6 +22,7 @@
 #include "base/waitable_timer.h"
 #include "base/net/tcp_channel.h"
 #include "base/peer/authenticator.h"
+#include "base/peer/direct_peer.h"
 #include "base/peer/host_id.h"
 #include "base/peer/relay_peer.h"
 #include "client/router_config.h"
@@ -34,7 +35,8 @@ namespace client {
 
 class RouterController
     : public base::TcpChannel::Listener,
-      public base::RelayPeer::Delegate
+      public base::RelayPeer::Delegate,
+      public base::DirectPeer::Delegate
 {
 public:
     enum class ErrorType
@@ -92,11 +94,19 @@ protected:
     void onRelayConnectionReady(std::unique_ptr<base::TcpChannel> channel) override;
     void onRelayConnectionError() override;
 
+    // base::DirectPeer::Delegate implementation.
+    void onDirectConnectionReady(std::unique_ptr<base::TcpChannel> channel) override;
+    void onDirectConnectionError() override;
+
 private:
+    void startRelayPeer(const proto::ConnectionOffer& offer);
+
     std::shared_ptr<base::TaskRunner> task_runner_;
     std::unique_ptr<base::TcpChannel> channel_;
     std::unique_ptr<base::ClientAuthenticator> authenticator_;
     std::unique_ptr<base::RelayPeer> relay_peer_;
+    std::unique_ptr<base::DirectPort> direct_port_;
+    std::unique_ptr<base::DirectPeer> direct_peer_;
     RouterConfig router_config_;
 
     base::HostId host_id_ = base::kInvalidHostId;
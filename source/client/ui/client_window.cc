@@ -19,6 +19,7 @@
 #include "client/ui/client_window.h"
 
 #include "base/logging.h"
+#include "base/codec/video_decoder.h"
 #include "base/net/address.h"
 #include "build/build_config.h"
 #include "client/router_config_storage.h"
@@ -54,7 +55,6 @@ ClientWindow::ClientWindow(QWidget* parent)
     ui.setupUi(this);
     setFixedHeight(sizeHint().height());
 
-    createLanguageMenu(settings.locale());
     reloadSessionTypes();
 
     QComboBox* combo_address = ui.combo_address;
@@ -109,22 +109,14 @@ ClientWindow::ClientWindow(QWidget* parent)
     {
         UpdateSettingsDialog(this).exec();
     });
-
-    if (settings.checkUpdates())
-    {
-        update_checker_ = std::make_unique<common::UpdateChecker>();
-
-        update_checker_->setUpdateServer(settings.updateServer().toStdString());
-        update_checker_->setPackageName("client");
-
-        update_checker_->start(Application::uiTaskRunner(), this);
-    }
 #else
     ui.action_check_for_updates->setVisible(false);
     ui.action_update_settings->setVisible(false);
 #endif
 
     combo_address->setFocus();
+
+    Application::traceStartup("Main window created");
 }
 
 ClientWindow::~ClientWindow() = default;
@@ -134,6 +126,40 @@ void ClientWindow::closeEvent(QCloseEvent* /* event */)
     QApplication::quit();
 }
 
+void ClientWindow::showEvent(QShowEvent* event)
+{
+    QMainWindow::showEvent(event);
+
+    if (is_shown_)
+        return;
+
+    is_shown_ = true;
+
+    // A zero timer is triggered after the window system events (including the first paint) are
+    // processed.
+    QTimer::singleShot(0, this, &ClientWindow::onFirstShown);
+}
+
+void ClientWindow::onFirstShown()
+{
+    Application::traceStartup("Main window shown");
+
+    ClientSettings& settings = Application::instance()->settings();
+    createLanguageMenu(settings.locale());
+
+#if defined(OS_WIN)
+    if (settings.checkUpdates())
+    {
+        update_checker_ = std::make_unique<common::UpdateChecker>();
+
+        update_checker_->setUpdateServer(settings.updateServer().toStdString());
+        update_checker_->setPackageName("client");
+
+        update_checker_->start(Application::uiTaskRunner(), this);
+    }
+#endif // defined(OS_WIN)
+}
+
 void ClientWindow::onUpdateCheckedFinished(const base::ByteArray& result)
 {
     common::UpdateInfo update_info = common::UpdateInfo::fromXml(result);
@@ -210,7 +236,7 @@ void ClientWindow::sessionConfigButtonPressed()
         {
             DesktopConfigDialog dialog(session_type,
                                        settings.desktopManageConfig(),
-                                       common::kSupportedVideoEncodings,
+                                       base::VideoDecoder::supportedEncodings(),
                                        this);
 
             if (dialog.exec() == DesktopConfigDialog::Accepted)
@@ -222,7 +248,7 @@ void ClientWindow::sessionConfigButtonPressed()
         {
             DesktopConfigDialog dialog(session_type,
                                        settings.desktopViewConfig(),
-                                       common::kSupportedVideoEncodings,
+                                       base::VideoDecoder::supportedEncodings(),
                                        this);
 
             if (dialog.exec() == DesktopConfigDialog::Accepted)
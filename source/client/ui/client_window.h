@@ -43,6 +43,7 @@ public:
 protected:
     // QMainWindow implementation.
     void closeEvent(QCloseEvent* event) override;
+    void showEvent(QShowEvent* event) override;
 
     // common::UpdateChecker::Delegate implementation.
     void onUpdateCheckedFinished(const base::ByteArray& result) override;
@@ -58,11 +59,13 @@ private slots:
     void onCheckUpdates();
 
 private:
+    void onFirstShown();
     void createLanguageMenu(const QString& current_locale);
     void reloadSessionTypes();
 
     Ui::ClientWindow ui;
     std::unique_ptr<common::UpdateChecker> update_checker_;
+    bool is_shown_ = false;
 
     DISALLOW_COPY_AND_ASSIGN(ClientWindow);
 };
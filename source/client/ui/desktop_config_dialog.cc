@@ -19,6 +19,7 @@
 #include "client/ui/desktop_config_dialog.h"
 
 #include "base/logging.h"
+#include "base/codec/video_decoder.h"
 #include "base/desktop/pixel_format.h"
 #include "client/config_factory.h"
 #include "ui_desktop_config_dialog.h"
@@ -84,6 +85,15 @@ DesktopConfigDialog::DesktopConfigDialog(proto::SessionType session_type,
 
     QComboBox* combo_codec = ui->combo_codec;
 
+    // Hardware codecs are offered only if the host can encode and the client can decode them.
+    const uint32_t decodings = base::VideoDecoder::supportedEncodings();
+
+    if (video_encodings & decodings & proto::VIDEO_ENCODING_HEVC)
+        combo_codec->addItem(QStringLiteral("HEVC"), proto::VIDEO_ENCODING_HEVC);
+
+    if (video_encodings & decodings & proto::VIDEO_ENCODING_H264)
+        combo_codec->addItem(QStringLiteral("H.264"), proto::VIDEO_ENCODING_H264);
+
     if (video_encodings & proto::VIDEO_ENCODING_VP9)
         combo_codec->addItem(QStringLiteral("VP9"), proto::VIDEO_ENCODING_VP9);
 
@@ -100,6 +110,18 @@ DesktopConfigDialog::DesktopConfigDialog(proto::SessionType session_type,
     combo_codec->setCurrentIndex(current_codec);
     onCodecChanged(current_codec);
 
+    if (config_.flags() & proto::VP9_MULTITHREADED)
+        ui->checkbox_vp9_multithreaded->setChecked(true);
+
+    if (config_.flags() & proto::HYBRID_ENCODING)
+        ui->checkbox_vp9_hybrid->setChecked(true);
+
+    if (config_.flags() & proto::VP9_I444)
+        ui->checkbox_vp9_i444->setChecked(true);
+
+    if (config_.scale_filter() == proto::SCALE_FILTER_BILINEAR)
+        ui->checkbox_fast_scaling->setChecked(true);
+
     QComboBox* combo_color_depth = ui->combobox_color_depth;
     combo_color_depth->addItem(tr("True color (32 bit)"), COLOR_DEPTH_ARGB);
     combo_color_depth->addItem(tr("High color (16 bit)"), COLOR_DEPTH_RGB565);
@@ -131,6 +153,11 @@ DesktopConfigDialog::DesktopConfigDialog(proto::SessionType session_type,
     if (config_.audio_encoding() != proto::AUDIO_ENCODING_UNKNOWN)
         ui->checkbox_audio->setChecked(true);
 
+    if (config_.flags() & proto::LOW_LATENCY_AUDIO)
+        ui->checkbox_low_latency_audio->setChecked(true);
+
+    ui->checkbox_low_latency_audio->setEnabled(ui->checkbox_audio->isChecked());
+
     if (session_type == proto::SESSION_TYPE_DESKTOP_MANAGE)
     {
         if (config_.flags() & proto::LOCK_AT_DISCONNECT)
@@ -171,6 +198,9 @@ DesktopConfigDialog::DesktopConfigDialog(proto::SessionType session_type,
     connect(combo_codec, QOverload<int>::of(&QComboBox::currentIndexChanged),
             this, &DesktopConfigDialog::onCodecChanged);
 
+    connect(ui->checkbox_audio, &QCheckBox::toggled,
+            ui->checkbox_low_latency_audio, &QCheckBox::setEnabled);
+
     connect(ui->slider_compress_ratio, &QSlider::valueChanged,
             this, &DesktopConfigDialog::onCompressionRatioChanged);
 
@@ -188,8 +218,12 @@ DesktopConfigDialog::~DesktopConfigDialog() = default;
 
 void DesktopConfigDialog::onCodecChanged(int item_index)
 {
-    bool has_pixel_format =
-        (ui->combo_codec->itemData(item_index).toInt() == proto::VIDEO_ENCODING_ZSTD);
+    const int encoding = ui->combo_codec->itemData(item_index).toInt();
+    bool has_pixel_format = (encoding == proto::VIDEO_ENCODING_ZSTD);
+
+    ui->checkbox_vp9_multithreaded->setEnabled(encoding == proto::VIDEO_ENCODING_VP9);
+    ui->checkbox_vp9_hybrid->setEnabled(encoding == proto::VIDEO_ENCODING_VP9);
+    ui->checkbox_vp9_i444->setEnabled(encoding == proto::VIDEO_ENCODING_VP9);
 
     ui->label_color_depth->setEnabled(has_pixel_format);
     ui->combobox_color_depth->setEnabled(has_pixel_format);
@@ -249,6 +283,9 @@ void DesktopConfigDialog::onButtonBoxClicked(QAbstractButton* button)
             config_.set_compress_ratio(static_cast<uint32_t>(ui->slider_compress_ratio->value()));
         }
 
+        config_.set_scale_filter(ui->checkbox_fast_scaling->isChecked() ?
+            proto::SCALE_FILTER_BILINEAR : proto::SCALE_FILTER_BOX);
+
         if (ui->checkbox_audio->isChecked())
             config_.set_audio_encoding(proto::AUDIO_ENCODING_OPUS);
         else
@@ -283,6 +320,22 @@ void DesktopConfigDialog::onButtonBoxClicked(QAbstractButton* button)
         if (ui->checkbox_clear_clipboard->isChecked())
             flags |= proto::CLEAR_CLIPBOARD;
 
+        // The setting is kept when another codec is selected.
+        if (ui->checkbox_vp9_multithreaded->isChecked())
+            flags |= proto::VP9_MULTITHREADED;
+
+        if (ui->checkbox_vp9_hybrid->isChecked())
+            flags |= proto::HYBRID_ENCODING;
+
+        if (ui->checkbox_vp9_i444->isChecked())
+            flags |= proto::VP9_I444;
+
+        if (ui->checkbox_low_latency_audio->isChecked() &&
+            ui->checkbox_low_latency_audio->isEnabled())
+        {
+            flags |= proto::LOW_LATENCY_AUDIO;
+        }
+
         config_.set_flags(flags);
 
         emit configChanged(config_);
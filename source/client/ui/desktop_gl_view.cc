@@ -0,0 +1,274 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "client/ui/desktop_gl_view.h"
+
+#include "base/logging.h"
+#include "base/trace_event.h"
+#include "client/ui/desktop_widget.h"
+#include "client/ui/frame_qimage.h"
+
+#include <QOpenGLContext>
+#include <QOpenGLShaderProgram>
+#include <QPainter>
+
+#if !defined(GL_UNPACK_ROW_LENGTH)
+#define GL_UNPACK_ROW_LENGTH 0x0CF2
+#endif
+
+namespace client {
+
+namespace {
+
+const char kVertexShader[] =
+    "attribute highp vec2 position;\n"
+    "attribute highp vec2 tex_coord;\n"
+    "varying highp vec2 v_tex_coord;\n"
+    "void main()\n"
+    "{\n"
+    "    v_tex_coord = tex_coord;\n"
+    "    gl_Position = vec4(position, 0.0, 1.0);\n"
+    "}\n";
+
+// The frame has the BGRA byte order and it is uploaded as RGBA, which is supported everywhere.
+// The channels are swapped back here.
+const char kFragmentShader[] =
+    "uniform sampler2D frame;\n"
+    "varying highp vec2 v_tex_coord;\n"
+    "void main()\n"
+    "{\n"
+    "    gl_FragColor = vec4(texture2D(frame, v_tex_coord).bgr, 1.0);\n"
+    "}\n";
+
+// A quad over the whole view. The first row of the frame is at the top.
+const GLfloat kPositions[] = { -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f, -1.0f };
+const GLfloat kTexCoords[] = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f, 1.0f };
+
+} // namespace
+
+DesktopGlView::DesktopGlView(DesktopWidget* desktop)
+    : QOpenGLWidget(desktop),
+      desktop_(desktop)
+{
+    DCHECK(desktop_);
+
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    setFocusPolicy(Qt::NoFocus);
+}
+
+DesktopGlView::~DesktopGlView()
+{
+    releaseResources();
+}
+
+void DesktopGlView::setFrameChanged()
+{
+    full_upload_ = true;
+    updated_region_.clear();
+    update();
+}
+
+void DesktopGlView::addUpdatedRegion(const base::Region& updated_region)
+{
+    if (!full_upload_)
+        updated_region_.addRegion(updated_region);
+
+    update();
+}
+
+void DesktopGlView::initializeGL()
+{
+    initializeOpenGLFunctions();
+
+    // The context is recreated when the view is moved to another window.
+    connect(context(), &QOpenGLContext::aboutToBeDestroyed,
+            this, &DesktopGlView::releaseResources, Qt::UniqueConnection);
+
+    texture_ = 0;
+    texture_size_ = QSize();
+    full_upload_ = true;
+
+    QOpenGLContext* current_context = context();
+    is_row_length_supported_ =
+        !current_context->isOpenGLES() || current_context->format().majorVersion() >= 3;
+
+    if (!createProgram())
+    {
+        LOG(LS_WARNING) << "Unable to use OpenGL for the desktop";
+        is_failed_ = true;
+
+        // The view is deleted by the receiver, so it cannot be done inside this call.
+        QMetaObject::invokeMethod(this, &DesktopGlView::sig_failed, Qt::QueuedConnection);
+        return;
+    }
+
+    LOG(LS_INFO) << "OpenGL desktop view initialized (ES: " << current_context->isOpenGLES()
+                 << ", row length: " << is_row_length_supported_ << ")";
+}
+
+void DesktopGlView::paintGL()
+{
+    if (is_failed_)
+        return;
+
+    TRACE_EVENT("paint");
+
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    const FrameQImage* frame = static_cast<const FrameQImage*>(desktop_->desktopFrame());
+    if (frame)
+    {
+        uploadFrame(*frame);
+
+        program_->bind();
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, texture_);
+
+        program_->setUniformValue("frame", 0);
+        program_->enableAttributeArray(position_location_);
+        program_->enableAttributeArray(tex_coord_location_);
+        program_->setAttributeArray(position_location_, GL_FLOAT, kPositions, 2);
+        program_->setAttributeArray(tex_coord_location_, GL_FLOAT, kTexCoords, 2);
+
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+        program_->disableAttributeArray(position_location_);
+        program_->disableAttributeArray(tex_coord_location_);
+        program_->release();
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    // The cursor and the error messages are drawn in the same way as without OpenGL.
+    QPainter painter(this);
+    desktop_->paintDesktop(&painter, QRegion());
+}
+
+bool DesktopGlView::createProgram()
+{
+    program_ = std::make_unique<QOpenGLShaderProgram>();
+
+    if (!program_->addShaderFromSourceCode(QOpenGLShader::Vertex, kVertexShader) ||
+        !program_->addShaderFromSourceCode(QOpenGLShader::Fragment, kFragmentShader) ||
+        !program_->link())
+    {
+        LOG(LS_WARNING) << "Unable to create shader program: " << program_->log();
+        program_.reset();
+        return false;
+    }
+
+    position_location_ = program_->attributeLocation("position");
+    tex_coord_location_ = program_->attributeLocation("tex_coord");
+    return true;
+}
+
+void DesktopGlView::uploadFrame(const FrameQImage& frame)
+{
+    const QImage& image = frame.constImage();
+    const QSize frame_size = image.size();
+
+    if (!texture_ || texture_size_ != frame_size)
+    {
+        if (texture_)
+            glDeleteTextures(1, &texture_);
+
+        glGenTextures(1, &texture_);
+        glBindTexture(GL_TEXTURE_2D, texture_);
+
+        // Non-power-of-two textures in OpenGL ES 2.0 require these parameters.
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        texture_size_ = frame_size;
+        full_upload_ = true;
+    }
+    else
+    {
+        glBindTexture(GL_TEXTURE_2D, texture_);
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    if (full_upload_)
+    {
+        if (is_row_length_supported_)
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, image.bytesPerLine() / 4);
+
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, frame_size.width(), frame_size.height(), 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, image.constBits());
+
+        full_upload_ = false;
+        updated_region_.clear();
+    }
+    else if (!updated_region_.isEmpty())
+    {
+        updated_region_.intersectWith(
+            base::Rect::makeWH(frame_size.width(), frame_size.height()));
+
+        if (is_row_length_supported_)
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, image.bytesPerLine() / 4);
+
+        for (base::Region::Iterator it(updated_region_); !it.isAtEnd(); it.advance())
+        {
+            const base::Rect rect = it.rect();
+
+            if (is_row_length_supported_)
+            {
+                glTexSubImage2D(GL_TEXTURE_2D, 0, rect.x(), rect.y(), rect.width(), rect.height(),
+                                GL_RGBA, GL_UNSIGNED_BYTE,
+                                image.constScanLine(rect.y()) + rect.x() * 4);
+            }
+            else
+            {
+                // Without GL_UNPACK_ROW_LENGTH the rows must be contiguous, so whole rows are
+                // uploaded.
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, rect.y(), frame_size.width(), rect.height(),
+                                GL_RGBA, GL_UNSIGNED_BYTE, image.constScanLine(rect.y()));
+            }
+        }
+
+        updated_region_.clear();
+    }
+
+    if (is_row_length_supported_)
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
+
+void DesktopGlView::releaseResources()
+{
+    if (!texture_ && !program_)
+        return;
+
+    makeCurrent();
+
+    if (texture_)
+    {
+        glDeleteTextures(1, &texture_);
+        texture_ = 0;
+    }
+
+    texture_size_ = QSize();
+    program_.reset();
+
+    doneCurrent();
+}
+
+} // namespace client
@@ -0,0 +1,89 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef CLIENT_UI_DESKTOP_GL_VIEW_H
+#define CLIENT_UI_DESKTOP_GL_VIEW_H
+
+#include "base/macros_magic.h"
+#include "base/desktop/region.h"
+
+#include <QOpenGLFunctions>
+#include <QOpenGLWidget>
+
+#include <memory>
+
+class QOpenGLShaderProgram;
+
+namespace client {
+
+class DesktopWidget;
+class FrameQImage;
+
+// Draws the remote desktop with OpenGL. The frame is kept in a texture and only the updated areas
+// are uploaded. Scaling is done by the GPU. The view covers the desktop widget and is transparent
+// for mouse events, so the input is still handled by the desktop widget.
+class DesktopGlView
+    : public QOpenGLWidget,
+      protected QOpenGLFunctions
+{
+    Q_OBJECT
+
+public:
+    explicit DesktopGlView(DesktopWidget* desktop);
+    ~DesktopGlView() override;
+
+    // The whole frame will be uploaded on the next paint.
+    void setFrameChanged();
+    void addUpdatedRegion(const base::Region& updated_region);
+
+signals:
+    // OpenGL cannot be used. The view must be replaced by the raster painting.
+    void sig_failed();
+
+protected:
+    // QOpenGLWidget implementation.
+    void initializeGL() override;
+    void paintGL() override;
+
+private:
+    bool createProgram();
+    void uploadFrame(const FrameQImage& frame);
+    void releaseResources();
+
+    DesktopWidget* desktop_;
+
+    std::unique_ptr<QOpenGLShaderProgram> program_;
+    int position_location_ = -1;
+    int tex_coord_location_ = -1;
+
+    GLuint texture_ = 0;
+    QSize texture_size_;
+
+    // Areas of the frame that have changed since the last upload.
+    base::Region updated_region_;
+    bool full_upload_ = true;
+
+    // Whether GL_UNPACK_ROW_LENGTH can be used to upload a part of a row.
+    bool is_row_length_supported_ = false;
+    bool is_failed_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(DesktopGlView);
+};
+
+} // namespace client
+
+#endif // CLIENT_UI_DESKTOP_GL_VIEW_H
@@ -32,6 +32,7 @@ const QString kRecordSessionsParam = QStringLiteral("Desktop/RecordSessions");
 const QString kToolBarPinnedParam = QStringLiteral("Desktop/ToolBarPinned");
 const QString kPauseVideoParam = QStringLiteral("Desktop/PauseVideo");
 const QString kPauseAudioParam = QStringLiteral("Desktop/PauseAudio");
+const QString kGpuRenderingParam = QStringLiteral("Desktop/GpuRendering");
 
 } // namespace
 
@@ -141,4 +142,14 @@ void DesktopSettings::setPauseAudioWhenMinimizing(bool enable)
     settings_.setValue(kPauseAudioParam, enable);
 }
 
+bool DesktopSettings::gpuRendering() const
+{
+    return settings_.value(kGpuRenderingParam, true).toBool();
+}
+
+void DesktopSettings::setGpuRendering(bool enable)
+{
+    settings_.setValue(kGpuRenderingParam, enable);
+}
+
 } // namespace client
@@ -54,6 +54,9 @@ public:
     bool pauseAudioWhenMinimizing() const;
     void setPauseAudioWhenMinimizing(bool enable);
 
+    bool gpuRendering() const;
+    void setGpuRendering(bool enable);
+
 private:
     QSettings settings_;
 
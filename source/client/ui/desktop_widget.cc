@@ -19,12 +19,19 @@
 #include "client/ui/desktop_widget.h"
 
 #include "base/logging.h"
+#include "base/trace_event.h"
 #include "common/keycode_converter.h"
+#include "client/ui/desktop_gl_view.h"
+#include "client/ui/desktop_settings.h"
 #include "client/ui/frame_qimage.h"
 
 #include <QApplication>
+#include <QPaintEvent>
+#include <QResizeEvent>
 #include <QWheelEvent>
 
+#include <cmath>
+
 #if defined(OS_LINUX)
 #include <X11/XKBlib.h>
 #if defined(KeyPress)
@@ -115,6 +122,21 @@ DesktopWidget::DesktopWidget(QWidget* parent)
 
     enableKeyHooks(true);
 
+    if (DesktopSettings().gpuRendering())
+    {
+        gl_view_ = new DesktopGlView(this);
+        gl_view_->resize(size());
+
+        connect(gl_view_, &DesktopGlView::sig_failed, this, [this]()
+        {
+            LOG(LS_INFO) << "Switching to the raster painting of the desktop";
+
+            gl_view_->deleteLater();
+            gl_view_.clear();
+            update();
+        });
+    }
+
     connect(static_cast<QApplication*>(QApplication::instance()), &QApplication::applicationStateChanged,
             this, [=](Qt::ApplicationState state)
     {
@@ -140,6 +162,15 @@ base::Frame* DesktopWidget::desktopFrame()
 void DesktopWidget::setDesktopFrame(std::shared_ptr<base::Frame>& frame)
 {
     frame_ = std::move(frame);
+
+    if (gl_view_)
+        gl_view_->setFrameChanged();
+}
+
+void DesktopWidget::replaceDesktopFrame(std::shared_ptr<base::Frame> frame)
+{
+    DCHECK(frame_ && frame && frame_->size() == frame->size());
+    frame_ = std::move(frame);
 }
 
 void DesktopWidget::setDesktopFrameError(proto::VideoErrorCode error_code)
@@ -169,23 +200,64 @@ void DesktopWidget::setDesktopFrameError(proto::VideoErrorCode error_code)
 
         error_timer_->deleteLater();
         update();
+
+        if (gl_view_)
+            gl_view_->update();
     });
 
     error_timer_->start(std::chrono::milliseconds(1500));
 }
 
-void DesktopWidget::drawDesktopFrame()
+void DesktopWidget::drawDesktopFrame(const base::Region& updated_region)
 {
     if (error_timer_)
         delete error_timer_;
 
-    if (current_error_code_ != proto::VIDEO_ERROR_CODE_OK)
+    const bool had_error = current_error_code_ != proto::VIDEO_ERROR_CODE_OK;
+    if (had_error)
         error_image_.reset();
 
     last_error_code_ = proto::VIDEO_ERROR_CODE_OK;
     current_error_code_ = proto::VIDEO_ERROR_CODE_OK;
 
-    update();
+    if (gl_view_)
+    {
+        gl_view_->addUpdatedRegion(updated_region);
+        return;
+    }
+
+    // The error message covers the whole widget.
+    if (had_error || !frame_)
+    {
+        update();
+        return;
+    }
+
+    const base::Size& frame_size = frame_->size();
+    if (frame_size.isEmpty())
+        return;
+
+    const double scale_x = static_cast<double>(width()) / frame_size.width();
+    const double scale_y = static_cast<double>(height()) / frame_size.height();
+
+    QRegion widget_region;
+
+    for (base::Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
+    {
+        const base::Rect& rect = it.rect();
+
+        // The smooth scaling uses the neighboring pixels, so the area is extended by one pixel.
+        const int left = static_cast<int>(std::floor(rect.left() * scale_x)) - 1;
+        const int top = static_cast<int>(std::floor(rect.top() * scale_y)) - 1;
+        const int right = static_cast<int>(std::ceil(rect.right() * scale_x)) + 1;
+        const int bottom = static_cast<int>(std::ceil(rect.bottom() * scale_y)) + 1;
+
+        widget_region += QRect(left, top, right - left, bottom - top);
+    }
+
+    widget_region &= rect();
+    if (!widget_region.isEmpty())
+        update(widget_region);
 }
 
 void DesktopWidget::setCursorShape(QPixmap&& cursor_shape, const QPoint& hotspot)
@@ -218,6 +290,17 @@ void DesktopWidget::setCursorPosition(const QPoint& cursor_position)
         remote_cursor_pos_.setY(0);
     else if (remote_cursor_pos_.y() > widget_size.height())
         remote_cursor_pos_.setY(widget_size.height());
+
+    cursor_predictor_.addRemotePosition(
+        base::Point(remote_cursor_pos_.x(), remote_cursor_pos_.y()));
+    updateRemoteCursor();
+
+    if (cursor_predictor_.hasCorrection())
+    {
+        // The position of the host is shown if there is no local input until then.
+        QTimer::singleShot(cursor_predictor_.correctionDelay(), this,
+                           &DesktopWidget::updateRemoteCursor);
+    }
 }
 
 void DesktopWidget::doMouseEvent(QEvent::Type event_type,
@@ -278,6 +361,9 @@ void DesktopWidget::doMouseEvent(QEvent::Type event_type,
         prev_pos_ = pos;
         prev_mask_ = mask & ~kWheelMask;
 
+        cursor_predictor_.addLocalPosition(base::Point(pos.x(), pos.y()));
+        updateRemoteCursor();
+
         proto::MouseEvent event;
         event.set_x(pos.x());
         event.set_y(pos.y());
@@ -413,6 +499,9 @@ void DesktopWidget::enableRemoteCursorPosition(bool enable)
 {
     enable_remote_cursor_pos_ = enable;
     update();
+
+    if (gl_view_)
+        gl_view_->update();
 }
 
 void DesktopWidget::userLeftFromWindow()
@@ -421,35 +510,67 @@ void DesktopWidget::userLeftFromWindow()
     releaseKeyboardButtons();
 }
 
-void DesktopWidget::paintEvent(QPaintEvent* /* event */)
+void DesktopWidget::paintEvent(QPaintEvent* event)
 {
+    // The frame is drawn by the OpenGL view on top of this widget.
+    if (gl_view_)
+        return;
+
+    TRACE_EVENT("paint");
+
     painter_.begin(this);
 
 #if !defined(OS_MAC)
     // SmoothPixmapTransform causes too much CPU load in MacOSX.
     painter_.setRenderHint(QPainter::SmoothPixmapTransform);
 #endif
+    paintDesktop(&painter_, event->region());
+
+    painter_.end();
+}
+
+void DesktopWidget::resizeEvent(QResizeEvent* event)
+{
+    if (gl_view_)
+        gl_view_->resize(event->size());
+
+    QWidget::resizeEvent(event);
+}
+
+void DesktopWidget::paintDesktop(QPainter* painter, const QRegion& frame_region)
+{
     if (current_error_code_ == proto::VIDEO_ERROR_CODE_OK)
     {
         FrameQImage* frame = reinterpret_cast<FrameQImage*>(frame_.get());
         if (frame)
         {
-            painter_.drawImage(rect(), frame->constImage());
+            const QImage& image = frame->constImage();
+            const qreal scale_x = static_cast<qreal>(image.width()) / width();
+            const qreal scale_y = static_cast<qreal>(image.height()) / height();
+
+            // Only the source area of each rectangle is scaled.
+            for (const QRect& target : frame_region)
+            {
+                const QRectF source(target.x() * scale_x, target.y() * scale_y,
+                                    target.width() * scale_x, target.height() * scale_y);
+                painter->drawImage(target, image, source);
+            }
 
             if (enable_remote_cursor_pos_)
             {
+                drawn_cursor_pos_ = remoteCursorPosition();
+
                 if (!remote_cursor_shape_.isNull())
                 {
-                    painter_.drawPixmap(QRect(remote_cursor_pos_ - remote_cursor_hotspot_,
-                                              remote_cursor_shape_.size()),
+                    painter->drawPixmap(remoteCursorRect(drawn_cursor_pos_),
                                         remote_cursor_shape_,
                                         remote_cursor_shape_.rect());
                 }
                 else
                 {
-                    painter_.setBrush(QBrush(Qt::black));
-                    painter_.setPen(QPen(Qt::white));
-                    painter_.drawEllipse(remote_cursor_pos_, 3, 3);
+                    painter->setBrush(QBrush(Qt::black));
+                    painter->setPen(QPen(Qt::white));
+                    painter->drawEllipse(drawn_cursor_pos_, 3, 3);
                 }
             }
         }
@@ -477,21 +598,21 @@ void DesktopWidget::paintEvent(QPaintEvent* /* event */)
                            table_rect.height() - kTitleHeight - (kBorderSize * 2));
 
         if (error_image_)
-            painter_.drawImage(rect(), *error_image_);
+            painter->drawImage(rect(), *error_image_);
 
-        painter_.fillRect(table_rect, QColor(167, 167, 167));
-        painter_.fillRect(title_rect, QColor(207, 207, 207));
-        painter_.fillRect(message_rect, QColor(255, 255, 255));
+        painter->fillRect(table_rect, QColor(167, 167, 167));
+        painter->fillRect(title_rect, QColor(207, 207, 207));
+        painter->fillRect(message_rect, QColor(255, 255, 255));
 
         QPixmap icon(QStringLiteral(":/img/main.png"));
         QPoint icon_pos(title_rect.x() + 8, title_rect.y() + (kTitleHeight / 2) - (icon.height() / 2));
 
         title_rect.setLeft(icon_pos.x() + icon.width() + 8);
 
-        painter_.setPen(Qt::black);
+        painter->setPen(Qt::black);
 
-        painter_.drawPixmap(icon_pos, icon);
-        painter_.drawText(title_rect, Qt::AlignVCenter, QStringLiteral("Aspia"));
+        painter->drawPixmap(icon_pos, icon);
+        painter->drawText(title_rect, Qt::AlignVCenter, QStringLiteral("Aspia"));
 
         QString message;
         switch (last_error_code_)
@@ -513,10 +634,8 @@ void DesktopWidget::paintEvent(QPaintEvent* /* event */)
                 break;
         }
 
-        painter_.drawText(message_rect, Qt::AlignCenter, message);
+        painter->drawText(message_rect, Qt::AlignCenter, message);
     }
-
-    painter_.end();
 }
 
 void DesktopWidget::mouseMoveEvent(QMouseEvent* event)
@@ -627,6 +746,35 @@ void DesktopWidget::releaseKeyboardButtons()
     }
 }
 
+QPoint DesktopWidget::remoteCursorPosition() const
+{
+    const base::Point position = cursor_predictor_.position();
+    return QPoint(position.x(), position.y());
+}
+
+QRect DesktopWidget::remoteCursorRect(const QPoint& position) const
+{
+    if (remote_cursor_shape_.isNull())
+        return QRect(position - QPoint(4, 4), QSize(9, 9));
+
+    return QRect(position - remote_cursor_hotspot_, remote_cursor_shape_.size());
+}
+
+void DesktopWidget::updateRemoteCursor()
+{
+    if (!enable_remote_cursor_pos_)
+        return;
+
+    if (gl_view_)
+    {
+        gl_view_->update();
+        return;
+    }
+
+    // Repaint the cursor at the old and the new positions only.
+    update(remoteCursorRect(drawn_cursor_pos_).united(remoteCursorRect(remoteCursorPosition())));
+}
+
 #if defined(OS_WIN)
 // static
 LRESULT CALLBACK DesktopWidget::keyboardHookProc(INT code, WPARAM wparam, LPARAM lparam)
@@ -20,7 +20,9 @@
 #define CLIENT_UI_DESKTOP_WIDGET_H
 
 #include "base/desktop/frame.h"
+#include "base/desktop/region.h"
 #include "build/build_config.h"
+#include "client/cursor_predictor.h"
 #include "proto/desktop.pb.h"
 
 #if defined(OS_WIN)
@@ -38,6 +40,8 @@
 
 namespace client {
 
+class DesktopGlView;
+
 class DesktopWidget : public QWidget
 {
     Q_OBJECT
@@ -48,8 +52,12 @@ public:
 
     base::Frame* desktopFrame();
     void setDesktopFrame(std::shared_ptr<base::Frame>& frame);
+
+    // Replaces the frame with another buffer of the same size. The areas that differ between the
+    // buffers are drawn by drawDesktopFrame().
+    void replaceDesktopFrame(std::shared_ptr<base::Frame> frame);
     void setDesktopFrameError(proto::VideoErrorCode error_code);
-    void drawDesktopFrame();
+    void drawDesktopFrame(const base::Region& updated_region);
     void setCursorShape(QPixmap&& cursor_shape, const QPoint& hotspot);
     void setCursorPosition(const QPoint& cursor_position);
 
@@ -75,6 +83,7 @@ signals:
 protected:
     // QWidget implementation.
     void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
     void mouseMoveEvent(QMouseEvent* event) override;
     void mousePressEvent(QMouseEvent* event) override;
     void mouseReleaseEvent(QMouseEvent* event) override;
@@ -86,12 +95,21 @@ protected:
     void focusOutEvent(QFocusEvent* event) override;
 
 private:
+    friend class DesktopGlView;
+
+    // Draws the desktop. The frame is drawn only in |frame_region| of the widget. The OpenGL view
+    // draws the frame itself and passes an empty region.
+    void paintDesktop(QPainter* painter, const QRegion& frame_region);
     void executeKeyEvent(uint32_t usb_keycode, uint32_t flags);
     void enableKeyHooks(bool enable);
     void releaseMouseButtons();
     void releaseKeyboardButtons();
+    QPoint remoteCursorPosition() const;
+    QRect remoteCursorRect(const QPoint& position) const;
+    void updateRemoteCursor();
 
     QPainter painter_;
+    QPointer<DesktopGlView> gl_view_;
 
 #if defined(OS_WIN)
     static LRESULT CALLBACK keyboardHookProc(INT code, WPARAM wparam, LPARAM lparam);
@@ -111,6 +129,10 @@ private:
     QPoint remote_cursor_pos_;
     QPoint remote_cursor_hotspot_;
 
+    // The remote cursor follows the local input without waiting for the host.
+    CursorPredictor cursor_predictor_;
+    QPoint drawn_cursor_pos_;
+
     QPoint prev_pos_;
     uint32_t prev_mask_ = 0;
 
@@ -42,13 +42,14 @@ void sortByName(T& list, Qt::SortOrder order)
     std::sort(list.begin(), list.end(),
               [order](const typename T::value_type& f1, const typename T::value_type& f2)
     {
-        const QString& f1_name = f1.name;
-        const QString& f2_name = f2.name;
+        // The comparison does not allocate lowered copies of the names, which matters for
+        // directories with many thousands of items.
+        const int result = QString::compare(f1.name, f2.name, Qt::CaseInsensitive);
 
         if (order == Qt::AscendingOrder)
-            return f1_name.toLower() < f2_name.toLower();
+            return result < 0;
         else
-            return f1_name.toLower() > f2_name.toLower();
+            return result > 0;
     });
 }
 
@@ -91,6 +92,34 @@ void sortByTime(T& list, Qt::SortOrder order)
     });
 }
 
+template<class FolderList, class FileList>
+void sortLists(FolderList& folders, FileList& files, int column, Qt::SortOrder order)
+{
+    switch (column)
+    {
+        case COLUMN_NAME:
+            sortByName(folders, order);
+            sortByName(files, order);
+            break;
+
+        case COLUMN_SIZE:
+            sortBySize(files, order);
+            break;
+
+        case COLUMN_TYPE:
+            sortByType(files, order);
+            break;
+
+        case COLUMN_LAST_WRITE:
+            sortByTime(folders, order);
+            sortByTime(files, order);
+            break;
+
+        default:
+            break;
+    }
+}
+
 } // namespace
 
 FileListModel::FileListModel(QObject* parent)
@@ -109,11 +138,16 @@ void FileListModel::setMimeType(const QString& mime_type)
 void FileListModel::setFileList(const proto::FileList& list)
 {
     clear();
+    addFileList(list);
+}
 
+void FileListModel::addFileList(const proto::FileList& list)
+{
     if (!list.item_size())
         return;
 
-    beginInsertRows(QModelIndex(), 0, list.item_size() - 1);
+    QList<Folder> folders;
+    QList<File> files;
 
     for (int i = 0; i < list.item_size(); ++i)
     {
@@ -125,7 +159,7 @@ void FileListModel::setFileList(const proto::FileList& list)
             folder.name       = QString::fromStdString(item.name());
             folder.last_write = item.modification_time();
 
-            folder_items_.append(folder);
+            folders.append(folder);
         }
         else
         {
@@ -138,13 +172,36 @@ void FileListModel::setFileList(const proto::FileList& list)
             file.icon = file_info.first;
             file.type = file_info.second;
 
-            file_items_.append(file);
+            files.append(file);
         }
     }
 
-    sortItems(current_column_, current_order_);
+    const bool is_first_page = folder_items_.isEmpty() && file_items_.isEmpty();
 
-    endInsertRows();
+    sortLists(folders, files, current_column_, current_order_);
+
+    // Only the new rows are inserted, so the view is not reset for each page.
+    if (!folders.isEmpty())
+    {
+        const int row = folder_items_.count();
+
+        beginInsertRows(QModelIndex(), row, row + folders.count() - 1);
+        folder_items_.append(folders);
+        endInsertRows();
+    }
+
+    if (!files.isEmpty())
+    {
+        const int row = folder_items_.count() + file_items_.count();
+
+        beginInsertRows(QModelIndex(), row, row + files.count() - 1);
+        file_items_.append(files);
+        endInsertRows();
+    }
+
+    // The pages are sorted separately. The whole list is sorted once after the last page.
+    if (!list.has_more() && !is_first_page)
+        sort(current_column_, current_order_);
 }
 
 void FileListModel::setSortOrder(int column, Qt::SortOrder order)
@@ -486,29 +543,7 @@ void FileListModel::sortItems(int column, Qt::SortOrder order)
     current_order_ = order;
     current_column_ = column;
 
-    switch (column)
-    {
-        case COLUMN_NAME:
-            sortByName(folder_items_, order);
-            sortByName(file_items_, order);
-            break;
-
-        case COLUMN_SIZE:
-            sortBySize(file_items_, order);
-            break;
-
-        case COLUMN_TYPE:
-            sortByType(file_items_, order);
-            break;
-
-        case COLUMN_LAST_WRITE:
-            sortByTime(folder_items_, order);
-            sortByTime(file_items_, order);
-            break;
-
-        default:
-            break;
-    }
+    sortLists(folder_items_, file_items_, column, order);
 }
 
 // static
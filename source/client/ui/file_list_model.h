@@ -36,6 +36,9 @@ public:
     void setMimeType(const QString& mime_type);
     QString mimeType() const { return mime_type_; }
     void setFileList(const proto::FileList& file_list);
+
+    // Appends the next page of a large directory to the current list.
+    void addFileList(const proto::FileList& file_list);
     void setSortOrder(int column, Qt::SortOrder order);
     void clear();
     bool isFolder(const QModelIndex& index) const;
@@ -20,6 +20,7 @@
 
 #include "base/logging.h"
 #include "base/stl_util.h"
+#include "base/codec/video_decoder.h"
 #include "base/desktop/mouse_cursor.h"
 #include "base/strings/string_split.h"
 #include "client/client_desktop.h"
@@ -56,6 +57,10 @@ namespace client {
 
 namespace {
 
+// The window that is covered for a moment (for example, while switching between windows) keeps
+// receiving the video.
+constexpr std::chrono::milliseconds kOcclusionPauseDelay { 2000 };
+
 QSize scaledSize(const QSize& source_size, int scale)
 {
     if (scale == -1)
@@ -104,6 +109,10 @@ QtDesktopWindow::QtDesktopWindow(proto::SessionType session_type,
     scroll_timer_ = new QTimer(this);
     connect(scroll_timer_, &QTimer::timeout, this, &QtDesktopWindow::onScrollTimer);
 
+    occlusion_timer_ = new QTimer(this);
+    occlusion_timer_->setSingleShot(true);
+    connect(occlusion_timer_, &QTimer::timeout, this, &QtDesktopWindow::onOcclusionTimer);
+
     desktop_->enableKeyCombinations(panel_->sendKeyCombinations());
     desktop_->enableRemoteCursorPosition(desktop_config_.flags() & proto::CURSOR_POSITION);
 
@@ -120,6 +129,7 @@ QtDesktopWindow::QtDesktopWindow(proto::SessionType session_type,
     connect(panel_, &DesktopPanel::videoPauseChanged, this, [this](bool enable)
     {
         enable_video_pause_ = enable;
+        updateVideoPause();
     });
 
     enable_audio_pause_ = panel_->isAudioPauseEnabled();
@@ -280,12 +290,17 @@ void QtDesktopWindow::showWindow(
     show();
     activateWindow();
 
+    // The window receives expose events when it is covered or uncovered by other windows. Not all
+    // platforms report it.
+    if (QWindow* window = windowHandle())
+        window->installEventFilter(this);
+
     panel_->enableTextChat(peer_version_ >= base::Version(2, 4, 0));
 }
 
 void QtDesktopWindow::configRequired()
 {
-    if (!(video_encodings_ & common::kSupportedVideoEncodings))
+    if (!(video_encodings_ & base::VideoDecoder::supportedEncodings()))
     {
         QMessageBox::warning(this,
                              tr("Warning"),
@@ -390,7 +405,24 @@ void QtDesktopWindow::setMetrics(const DesktopWindow::Metrics& metrics)
         statistics_dialog_->activateWindow();
     }
 
-    statistics_dialog_->setMetrics(metrics);
+    DesktopWindow::Metrics window_metrics = metrics;
+
+    const std::chrono::steady_clock::time_point current_time = std::chrono::steady_clock::now();
+    if (presented_fps_time_ != std::chrono::steady_clock::time_point())
+    {
+        const int64_t duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+            current_time - presented_fps_time_).count();
+        if (duration > 0)
+        {
+            window_metrics.presented_fps =
+                static_cast<int>(presented_frame_count_ * 1000 / duration);
+        }
+    }
+
+    presented_frame_count_ = 0;
+    presented_fps_time_ = current_time;
+
+    statistics_dialog_->setMetrics(window_metrics);
 }
 
 std::unique_ptr<FrameFactory> QtDesktopWindow::frameFactory()
@@ -427,10 +459,25 @@ void QtDesktopWindow::setFrame(
     }
 }
 
-void QtDesktopWindow::drawFrame()
+void QtDesktopWindow::drawFrame(
+    std::shared_ptr<base::Frame> frame, const base::Region& updated_region)
 {
-    desktop_->drawDesktopFrame();
-    panel_->update();
+    // The widget is painted from the new buffer even if the region is drawn later.
+    desktop_->replaceDesktopFrame(std::move(frame));
+    pending_region_.addRegion(updated_region);
+
+    QWindow* window = windowHandle();
+    if (!window || !window->isExposed())
+    {
+        presentFrame();
+        return;
+    }
+
+    if (is_update_requested_)
+        return;
+
+    is_update_requested_ = true;
+    window->requestUpdate();
 }
 
 void QtDesktopWindow::setMouseCursor(std::shared_ptr<base::MouseCursor> mouse_cursor)
@@ -517,20 +564,19 @@ void QtDesktopWindow::leaveEvent(QEvent* event)
 
 void QtDesktopWindow::changeEvent(QEvent* event)
 {
+    if (event->type() == QEvent::ActivationChange && desktop_control_proxy_)
+        desktop_control_proxy_->setWindowActive(isActiveWindow());
+
     if (event->type() == QEvent::WindowStateChange)
     {
         bool is_minimized = isMinimized();
 
         LOG(LS_INFO) << "Window minimized: " << is_minimized;
 
+        updateVideoPause();
+
         if (is_minimized)
         {
-            if (enable_video_pause_)
-            {
-                desktop_control_proxy_->setVideoPause(true);
-                video_pause_last_ = true;
-            }
-
             if (enable_audio_pause_)
             {
                 desktop_control_proxy_->setAudioPause(true);
@@ -541,15 +587,6 @@ void QtDesktopWindow::changeEvent(QEvent* event)
         }
         else
         {
-            if (enable_video_pause_ || video_pause_last_)
-            {
-                if (video_pause_last_)
-                {
-                    desktop_control_proxy_->setVideoPause(false);
-                    video_pause_last_ = false;
-                }
-            }
-
             if (enable_audio_pause_ || audio_pause_last_)
             {
                 if (audio_pause_last_)
@@ -581,7 +618,23 @@ void QtDesktopWindow::closeEvent(QCloseEvent* /* event */)
 
 bool QtDesktopWindow::eventFilter(QObject* object, QEvent* event)
 {
-    if (object == desktop_)
+    if (object == windowHandle())
+    {
+        if (event->type() == QEvent::Expose)
+        {
+            onExposeChanged();
+        }
+        else if (event->type() == QEvent::UpdateRequest && is_update_requested_)
+        {
+            // The widgets are repainted while the window handles this event, so the region is
+            // drawn without waiting for another refresh.
+            is_update_requested_ = false;
+            presentFrame();
+        }
+
+        return false;
+    }
+    else if (object == desktop_)
     {
         if (event->type() == QEvent::KeyPress || event->type() == QEvent::KeyRelease)
         {
@@ -944,4 +997,69 @@ void QtDesktopWindow::onShowHidePanel()
     animation->start(QPropertyAnimation::DeleteWhenStopped);
 }
 
+void QtDesktopWindow::onOcclusionTimer()
+{
+    QWindow* window = windowHandle();
+    if (!window || window->isExposed())
+        return;
+
+    LOG(LS_INFO) << "Window occluded";
+    is_occluded_ = true;
+    updateVideoPause();
+}
+
+void QtDesktopWindow::onExposeChanged()
+{
+    QWindow* window = windowHandle();
+    if (!window)
+        return;
+
+    if (window->isExposed())
+    {
+        occlusion_timer_->stop();
+
+        if (is_occluded_)
+        {
+            LOG(LS_INFO) << "Window exposed";
+            is_occluded_ = false;
+            updateVideoPause();
+        }
+    }
+    else if (!is_occluded_ && !isMinimized() && isVisible())
+    {
+        occlusion_timer_->start(kOcclusionPauseDelay);
+    }
+}
+
+void QtDesktopWindow::presentFrame()
+{
+    if (pending_region_.isEmpty())
+        return;
+
+    desktop_->drawDesktopFrame(pending_region_);
+    pending_region_.clear();
+    panel_->update();
+
+    ++presented_frame_count_;
+}
+
+void QtDesktopWindow::updateVideoPause()
+{
+    if (!desktop_control_proxy_)
+        return;
+
+    const bool is_hidden = isMinimized() || is_occluded_;
+
+    if (is_hidden && enable_video_pause_ && !video_pause_last_)
+    {
+        desktop_control_proxy_->setVideoPause(true);
+        video_pause_last_ = true;
+    }
+    else if ((!is_hidden || !enable_video_pause_) && video_pause_last_)
+    {
+        desktop_control_proxy_->setVideoPause(false);
+        video_pause_last_ = false;
+    }
+}
+
 } // namespace client
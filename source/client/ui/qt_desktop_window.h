@@ -20,6 +20,7 @@
 #define CLIENT_UI_QT_DESKTOP_WINDOW_H
 
 #include "base/version.h"
+#include "base/desktop/region.h"
 #include "client/client_desktop.h"
 #include "client/desktop_window.h"
 #include "client/system_info_control.h"
@@ -73,7 +74,8 @@ public:
     std::unique_ptr<FrameFactory> frameFactory() override;
     void setFrameError(proto::VideoErrorCode error_code) override;
     void setFrame(const base::Size& screen_size, std::shared_ptr<base::Frame> frame) override;
-    void drawFrame() override;
+    void drawFrame(std::shared_ptr<base::Frame> frame,
+                   const base::Region& updated_region) override;
     void setMouseCursor(std::shared_ptr<base::MouseCursor> mouse_cursor) override;
 
     // SystemInfoControl implementation.
@@ -100,8 +102,19 @@ private slots:
     void onScrollTimer();
     void onPasteKeystrokes();
     void onShowHidePanel();
+    void onOcclusionTimer();
 
 private:
+    void onExposeChanged();
+
+    // The decoded frames are drawn at most once per refresh of the display. The window requests
+    // an update and draws the merged region when the platform is ready for the next frame.
+    void presentFrame();
+
+    // Pauses the video while the window is minimized or covered by other windows, if the pause is
+    // enabled. The host sends a key frame when the video is resumed.
+    void updateVideoPause();
+
     const proto::SessionType session_type_;
     proto::DesktopConfig desktop_config_;
 
@@ -129,6 +142,14 @@ private:
     std::optional<QPoint> start_panel_pos_;
     int panel_pos_x_ = 50;
 
+    QTimer* occlusion_timer_ = nullptr;
+    bool is_occluded_ = false;
+
+    base::Region pending_region_;
+    bool is_update_requested_ = false;
+    int64_t presented_frame_count_ = 0;
+    std::chrono::steady_clock::time_point presented_fps_time_;
+
     bool enable_video_pause_ = true;
     bool video_pause_last_ = false;
     bool enable_audio_pause_ = true;
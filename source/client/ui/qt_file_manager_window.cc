@@ -117,6 +117,20 @@ void QtFileManagerWindow::onFileList(
     }
 }
 
+void QtFileManagerWindow::onFileListPage(
+    common::FileTask::Target target, proto::FileError error_code, const proto::FileList& file_list)
+{
+    if (target == common::FileTask::Target::LOCAL)
+    {
+        ui->local_panel->onFileListPage(error_code, file_list);
+    }
+    else
+    {
+        DCHECK_EQ(target, common::FileTask::Target::REMOTE);
+        ui->remote_panel->onFileListPage(error_code, file_list);
+    }
+}
+
 void QtFileManagerWindow::onCreateDirectory(
     common::FileTask::Target target, proto::FileError error_code)
 {
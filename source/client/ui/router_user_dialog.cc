@@ -81,6 +81,7 @@ RouterUserDialog::RouterUserDialog(const base::User& user,
 
     add_session(proto::ROUTER_SESSION_CLIENT);
     add_session(proto::ROUTER_SESSION_ADMIN);
+    add_session(proto::ROUTER_SESSION_CLUSTER);
 
     connect(ui.buttonbox, &QDialogButtonBox::clicked, this, &RouterUserDialog::onButtonBoxClicked);
     connect(ui.edit_username, &QLineEdit::textEdited, this, [this]()
@@ -302,6 +303,10 @@ QString RouterUserDialog::sessionTypeToString(proto::RouterSession session_type)
             str = QT_TR_NOOP("Client");
             break;
 
+        case proto::ROUTER_SESSION_CLUSTER:
+            str = QT_TR_NOOP("Cluster router");
+            break;
+
         default:
             break;
     }
@@ -20,6 +20,8 @@
 
 #include "base/desktop/screen_capturer.h"
 
+#include <QClipboard>
+#include <QGuiApplication>
 #include <QTimer>
 
 namespace client {
@@ -34,6 +36,8 @@ StatisticsDialog::StatisticsDialog(QWidget* parent)
     update_timer_ = new QTimer(this);
     connect(update_timer_, &QTimer::timeout, this, &StatisticsDialog::metricsRequired);
     update_timer_->start(std::chrono::seconds(1));
+
+    connect(ui.button_copy, &QPushButton::clicked, this, &StatisticsDialog::copyToClipboard);
 }
 
 StatisticsDialog::~StatisticsDialog() = default;
@@ -167,10 +171,52 @@ void StatisticsDialog::setMetrics(const DesktopWindow::Metrics& metrics)
             case 26:
                 item->setText(1, QString::number(metrics.cursor_pos_count));
                 break;
+
+            case 27:
+            case 28:
+            case 29:
+            case 30:
+            case 31:
+            case 32:
+            case 33:
+                // The items follow the order of the stages.
+                item->setText(1, latencyToString(metrics.latency.stages[i - 27]));
+                break;
+
+            case 34:
+                item->setText(1, latencyToString(metrics.latency.glass_to_glass));
+                break;
+
+            case 35:
+                item->setText(1, latencyToString(metrics.latency.stages[
+                    static_cast<size_t>(LatencyStats::Stage::INPUT)]));
+                break;
+
+            case 36:
+                item->setText(1, QString::number(metrics.presented_fps));
+                break;
         }
     }
 }
 
+void StatisticsDialog::copyToClipboard()
+{
+    QClipboard* clipboard = QGuiApplication::clipboard();
+    if (!clipboard)
+        return;
+
+    // Plain text, so that it can be attached to a support request.
+    QString text;
+
+    for (int i = 0; i < ui.tree->topLevelItemCount(); ++i)
+    {
+        QTreeWidgetItem* item = ui.tree->topLevelItem(i);
+        text += item->text(0) + ": " + item->text(1) + "\n";
+    }
+
+    clipboard->setText(text);
+}
+
 // static
 QString StatisticsDialog::sizeToString(int64_t size)
 {
@@ -255,4 +301,21 @@ QString StatisticsDialog::speedToString(int64_t speed)
         .arg(units);
 }
 
+// static
+QString StatisticsDialog::latencyToString(const LatencyStats::StageTime& stage_time)
+{
+    if (stage_time.max == std::chrono::microseconds::zero())
+        return "-";
+
+    return QString("%1 (max %2)")
+        .arg(latencyToString(stage_time.avg))
+        .arg(latencyToString(stage_time.max));
+}
+
+// static
+QString StatisticsDialog::latencyToString(const std::chrono::microseconds& latency)
+{
+    return QString("%1 ms").arg(static_cast<double>(latency.count()) / 1000.0, 0, 'f', 1);
+}
+
 } // namespace client
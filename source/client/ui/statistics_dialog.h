@@ -41,8 +41,12 @@ signals:
     void metricsRequired();
 
 private:
+    void copyToClipboard();
+
     static QString sizeToString(int64_t size);
     static QString speedToString(int64_t speed);
+    static QString latencyToString(const LatencyStats::StageTime& stage_time);
+    static QString latencyToString(const std::chrono::microseconds& latency);
 
     Ui::StatisticsDialog ui;
     QTimer* update_timer_ = nullptr;
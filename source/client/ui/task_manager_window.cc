@@ -26,6 +26,7 @@
 #include <QLabel>
 #include <QMenu>
 #include <QMessageBox>
+#include <QSet>
 #include <QTimer>
 
 namespace client {
@@ -64,6 +65,8 @@ enum UserColumn
     USER_COL_SESSION_NAME = 4
 };
 
+} // namespace
+
 class ProcessItem : public QTreeWidgetItem
 {
     Q_DECLARE_TR_FUNCTIONS(ProcessItem)
@@ -168,6 +171,8 @@ private:
     proto::task_manager::Process process_;
 };
 
+namespace {
+
 class ServiceItem : public QTreeWidgetItem
 {
     Q_DECLARE_TR_FUNCTIONS(ServiceItem)
@@ -482,10 +487,26 @@ TaskManagerWindow::TaskManagerWindow(QWidget* parent)
 
     connect(update_timer_, &QTimer::timeout, this, [this]()
     {
-        sendProcessListRequest(proto::task_manager::ProcessListRequest::NONE);
+        // The process list is not updated while nobody looks at it and until the previous list
+        // is received. On a slow connection the updates are made as often as the list arrives.
+        if (!isMinimized() && ui.tab->currentWidget() == ui.tab_processes &&
+            !is_process_list_pending_)
+        {
+            sendProcessListRequest(proto::task_manager::ProcessListRequest::NONE);
+        }
+
         sendUserListRequest();
     });
 
+    connect(ui.tab, &QTabWidget::currentChanged, this, [this](int /* index */)
+    {
+        if (ui.tab->currentWidget() == ui.tab_processes && update_timer_->isActive() &&
+            !is_process_list_pending_)
+        {
+            sendProcessListRequest(proto::task_manager::ProcessListRequest::NONE);
+        }
+    });
+
     std::chrono::milliseconds update_speed = settings.updateSpeed();
     if (update_speed == std::chrono::milliseconds(500))
         ui.action_high_speed->setChecked(true);
@@ -747,10 +768,57 @@ void TaskManagerWindow::onLogoffUser()
 void TaskManagerWindow::sendProcessListRequest(uint32_t flags)
 {
     proto::task_manager::ClientToHost message;
-    message.mutable_process_list_request()->set_flags(flags);
+
+    proto::task_manager::ProcessListRequest* request = message.mutable_process_list_request();
+    request->set_flags(flags | proto::task_manager::ProcessListRequest::DELTA);
+    request->set_columns(processColumns());
+
+    is_process_list_pending_ = true;
     emit sig_sendMessage(message);
 }
 
+uint32_t TaskManagerWindow::processColumns() const
+{
+    using Request = proto::task_manager::ProcessListRequest;
+
+    static const std::pair<int, Request::Column> kColumns[] =
+    {
+        { PROC_COL_SESSION_ID, Request::COLUMN_SESSION_ID },
+        { PROC_COL_CPU_USAGE, Request::COLUMN_CPU_USAGE },
+        { PROC_COL_MEM_PRIVATE_WORKING_SET, Request::COLUMN_MEM_PRIVATE_WORKING_SET },
+        { PROC_COL_MEM_WORKING_SET, Request::COLUMN_MEM_WORKING_SET },
+        { PROC_COL_MEM_PEAK_WORKING_SET, Request::COLUMN_MEM_PEAK_WORKING_SET },
+        { PROC_COL_MEM_WORKING_SET_DELTA, Request::COLUMN_MEM_WORKING_SET_DELTA },
+        { PROC_COL_THREAD_COUNT, Request::COLUMN_THREAD_COUNT }
+    };
+
+    const QHeaderView* header = ui.tree_processes->header();
+    uint32_t columns = 0;
+
+    // The values of the hidden columns are not needed, except the one the list is sorted by.
+    for (const auto& column : kColumns)
+    {
+        if (!header->isSectionHidden(column.first) ||
+            header->sortIndicatorSection() == column.first)
+        {
+            columns |= column.second;
+        }
+    }
+
+    // The name and identifier are always sent. If no other column is shown, then cpu usage is
+    // requested because zero means all columns.
+    if (!columns)
+        columns = Request::COLUMN_CPU_USAGE;
+
+    return columns;
+}
+
+void TaskManagerWindow::removeProcessItem(ProcessItem* item)
+{
+    process_items_.remove(item->processId());
+    delete item;
+}
+
 void TaskManagerWindow::sendEndProcessRequest(uint64_t process_id)
 {
     proto::task_manager::ClientToHost message;
@@ -798,44 +866,49 @@ void TaskManagerWindow::sendUserRequest(
 
 void TaskManagerWindow::readProcessList(const proto::task_manager::ProcessList& process_list)
 {
-    // Remove dead processes from the list.
-    for (int i = ui.tree_processes->topLevelItemCount() - 1; i >= 0; --i)
-    {
-        ProcessItem* temp = static_cast<ProcessItem*>(ui.tree_processes->topLevelItem(i));
+    is_process_list_pending_ = false;
 
-        bool found = false;
-        for (int j = 0; j < process_list.process_size(); ++j)
+    if (process_list.is_delta())
+    {
+        // Remove ended processes from the list.
+        for (int i = 0; i < process_list.removed_process_id_size(); ++i)
         {
-            if (temp->processId() == process_list.process(j).process_id())
-            {
-                found = true;
-                break;
-            }
+            ProcessItem* item = process_items_.value(process_list.removed_process_id(i));
+            if (item)
+                removeProcessItem(item);
         }
+    }
+    else
+    {
+        // The full list contains all processes. Remove dead processes from the list.
+        QSet<uint64_t> process_ids;
+        process_ids.reserve(process_list.process_size());
 
-        if (!found)
-            delete temp;
+        for (int i = 0; i < process_list.process_size(); ++i)
+            process_ids.insert(process_list.process(i).process_id());
+
+        for (int i = ui.tree_processes->topLevelItemCount() - 1; i >= 0; --i)
+        {
+            ProcessItem* item = static_cast<ProcessItem*>(ui.tree_processes->topLevelItem(i));
+            if (!process_ids.contains(item->processId()))
+                removeProcessItem(item);
+        }
     }
 
+    // The items are sorted once after all of them are updated.
+    ui.tree_processes->setSortingEnabled(false);
+
     // Adding or updating processes.
     for (int i = 0; i < process_list.process_size(); ++i)
     {
         const proto::task_manager::Process& process = process_list.process(i);
-        ProcessItem* process_item = nullptr;
-
-        for (int j = 0; j < ui.tree_processes->topLevelItemCount(); ++j)
-        {
-            ProcessItem* temp = static_cast<ProcessItem*>(ui.tree_processes->topLevelItem(j));
-            if (temp->processId() == process.process_id())
-            {
-                process_item = temp;
-                break;
-            }
-        }
 
+        ProcessItem* process_item = process_items_.value(process.process_id());
         if (!process_item)
         {
-            ui.tree_processes->addTopLevelItem(new ProcessItem(process));
+            process_item = new ProcessItem(process);
+            process_items_.insert(process.process_id(), process_item);
+            ui.tree_processes->addTopLevelItem(process_item);
         }
         else
         {
@@ -843,14 +916,17 @@ void TaskManagerWindow::readProcessList(const proto::task_manager::ProcessList&
         }
     }
 
-    if (process_list.process_size() != ui.tree_processes->topLevelItemCount())
+    ui.tree_processes->setSortingEnabled(true);
+
+    if (!process_list.is_delta() &&
+        process_list.process_size() != ui.tree_processes->topLevelItemCount())
     {
         LOG(LS_WARNING) << "Number of processes mismatch (expected: "
                         << process_list.process_size() << " actual: "
                         << ui.tree_processes->topLevelItemCount() << ")";
     }
 
-    setProcessCount(process_list.process_size());
+    setProcessCount(ui.tree_processes->topLevelItemCount());
     setCpuUsage(process_list.cpu_usage());
     setMemoryUsage(process_list.memory_usage());
 }
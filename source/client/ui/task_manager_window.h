@@ -23,6 +23,7 @@
 #include "proto/task_manager.pb.h"
 #include "ui_task_manager_window.h"
 
+#include <QHash>
 #include <QTreeWidget>
 
 class QHBoxLayout;
@@ -31,6 +32,8 @@ class QStatusBar;
 
 namespace client {
 
+class ProcessItem;
+
 class TaskManagerWindow : public QMainWindow
 {
     Q_OBJECT
@@ -63,6 +66,8 @@ private slots:
 
 private:
     void sendProcessListRequest(uint32_t flags);
+    uint32_t processColumns() const;
+    void removeProcessItem(ProcessItem* item);
     void sendEndProcessRequest(uint64_t process_id);
     void sendServiceListRequest();
     void sendServiceRequest(const std::string& name, proto::task_manager::ServiceRequest::Command command);
@@ -84,6 +89,9 @@ private:
 
     QTimer* update_timer_ = nullptr;
 
+    QHash<uint64_t, ProcessItem*> process_items_;
+    bool is_process_list_pending_ = false;
+
     DISALLOW_COPY_AND_ASSIGN(TaskManagerWindow);
 };
 
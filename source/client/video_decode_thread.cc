@@ -0,0 +1,416 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "client/video_decode_thread.h"
+
+#include "base/logging.h"
+#include "base/trace_event.h"
+#include "base/codec/video_decoder.h"
+#include "base/desktop/frame_view.h"
+#include "client/desktop_window_proxy.h"
+#include "client/frame_chain.h"
+#include "client/latency_stats.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace client {
+
+namespace {
+
+// At 30 frames per second the queue adds no more than 100 ms of latency.
+const size_t kMaxQueueSize = 3;
+
+// While the key frame is awaited, the request is sent again after this number of packets.
+const int64_t kKeyFrameRequestInterval = 60;
+
+// Packets that must not be dropped: the video errors are shown to the user and the key frames
+// (including the packets with a new format) restore the decoder state.
+bool isDroppable(const proto::VideoPacket& packet)
+{
+    return packet.error_code() == proto::VIDEO_ERROR_CODE_OK &&
+           !packet.key_frame() && !packet.has_format();
+}
+
+} // namespace
+
+VideoDecodeThread::VideoDecodeThread(std::shared_ptr<DesktopWindowProxy> desktop_window_proxy,
+                                     std::shared_ptr<LatencyStats> latency_stats)
+    : desktop_window_proxy_(std::move(desktop_window_proxy)),
+      latency_stats_(std::move(latency_stats)),
+      scheduler_(DecodeScheduler::instance())
+{
+    LOG(LS_INFO) << "Ctor";
+    DCHECK(desktop_window_proxy_);
+    DCHECK(latency_stats_);
+
+    scheduler_->addTask(this);
+}
+
+VideoDecodeThread::~VideoDecodeThread()
+{
+    LOG(LS_INFO) << "Dtor";
+    scheduler_->removeTask(this);
+}
+
+void VideoDecodeThread::setFrameDroppingEnabled(bool enable)
+{
+    LOG(LS_INFO) << "Frame dropping enabled: " << enable;
+
+    std::scoped_lock lock(queue_lock_);
+    dropping_enabled_ = enable;
+    waiting_key_frame_ = false;
+}
+
+void VideoDecodeThread::setMultithreadedDecoding(bool enable)
+{
+    std::scoped_lock lock(queue_lock_);
+    multithreaded_ = enable;
+}
+
+void VideoDecodeThread::setHighPriority(bool enable)
+{
+    scheduler_->setHighPriority(this, enable);
+}
+
+bool VideoDecodeThread::addPacket(std::unique_ptr<proto::VideoPacket> packet)
+{
+    DCHECK(packet);
+
+    {
+        std::scoped_lock lock(queue_lock_);
+
+        if (dropping_enabled_)
+        {
+            if (waiting_key_frame_)
+            {
+                if (isDroppable(*packet))
+                {
+                    ++dropped_frame_count_;
+
+                    // The request is repeated in case the key frame was sent before the host
+                    // received it.
+                    return ++skipped_packet_count_ % kKeyFrameRequestInterval == 0;
+                }
+
+                if (packet->error_code() == proto::VIDEO_ERROR_CODE_OK)
+                    waiting_key_frame_ = false;
+            }
+            else if (queue_.size() >= kMaxQueueSize && isDroppable(*packet))
+            {
+                // The queued packets are older than the new one and depend on each other, so all
+                // inter frames are dropped and the decoder waits for a key frame.
+                const size_t count = queue_.size();
+
+                queue_.erase(std::remove_if(queue_.begin(), queue_.end(),
+                    [](const QueuedPacket& queued_packet)
+                {
+                    return isDroppable(*queued_packet.packet);
+                }), queue_.end());
+
+                const size_t dropped = count - queue_.size() + 1;
+
+                LOG(LS_INFO) << "Decoder is behind, " << dropped << " frames dropped";
+
+                dropped_frame_count_ += static_cast<int64_t>(dropped);
+                skipped_packet_count_ = 0;
+                waiting_key_frame_ = true;
+                return true;
+            }
+        }
+
+        queue_.push_back({ std::move(packet), Clock::now() });
+    }
+
+    scheduler_->schedule(this);
+    return false;
+}
+
+std::shared_ptr<base::Frame> VideoDecodeThread::frame() const
+{
+    std::scoped_lock lock(frame_lock_);
+
+    if (!frame_chain_)
+        return nullptr;
+
+    return frame_chain_->newestFrame();
+}
+
+int64_t VideoDecodeThread::takeDecodedFrameCount()
+{
+    std::scoped_lock lock(queue_lock_);
+
+    int64_t count = decoded_frame_count_;
+    decoded_frame_count_ = 0;
+    return count;
+}
+
+int64_t VideoDecodeThread::droppedFrameCount() const
+{
+    std::scoped_lock lock(queue_lock_);
+    return dropped_frame_count_;
+}
+
+bool VideoDecodeThread::runStep()
+{
+    QueuedPacket queued_packet;
+
+    {
+        std::scoped_lock lock(queue_lock_);
+
+        if (queue_.empty())
+            return false;
+
+        queued_packet = std::move(queue_.front());
+        queue_.pop_front();
+    }
+
+    latency_stats_->addSample(LatencyStats::Stage::QUEUE,
+                              std::chrono::duration_cast<std::chrono::microseconds>(
+                                  Clock::now() - queued_packet.receive_time));
+
+    decodePacket(*queued_packet.packet);
+
+    std::scoped_lock lock(queue_lock_);
+    return !queue_.empty();
+}
+
+void VideoDecodeThread::decodePacket(const proto::VideoPacket& packet)
+{
+    proto::VideoErrorCode error_code = packet.error_code();
+    if (error_code != proto::VIDEO_ERROR_CODE_OK)
+    {
+        LOG(LS_WARNING) << "Video error detected: " << error_code;
+        desktop_window_proxy_->setFrameError(error_code);
+        return;
+    }
+
+    bool multithreaded;
+
+    {
+        std::scoped_lock lock(queue_lock_);
+        multithreaded = multithreaded_;
+    }
+
+    if (video_encoding_ != packet.encoding() ||
+        (packet.has_format() && decoder_multithreaded_ != multithreaded))
+    {
+        // Zero means one thread per processor.
+        const int thread_count =
+            (multithreaded && packet.encoding() == proto::VIDEO_ENCODING_VP9) ? 0 : 2;
+
+        video_decoder_ = base::VideoDecoder::create(packet.encoding(), thread_count);
+        video_encoding_ = packet.encoding();
+        decoder_multithreaded_ = multithreaded;
+
+        LOG(LS_INFO) << "Video encoding changed to: " << video_encoding_
+                     << " (multithreaded: " << multithreaded << ")";
+    }
+
+    if (!video_decoder_)
+    {
+        LOG(LS_ERROR) << "Video decoder not initialized";
+        return;
+    }
+
+    if (packet.has_format())
+    {
+        const proto::VideoPacketFormat& format = packet.format();
+        base::Size video_size(format.video_rect().width(), format.video_rect().height());
+        base::Size screen_size = video_size;
+
+        static const int kMaxValue = std::numeric_limits<uint16_t>::max();
+
+        if (video_size.width()  <= 0 || video_size.width()  >= kMaxValue ||
+            video_size.height() <= 0 || video_size.height() >= kMaxValue)
+        {
+            LOG(LS_ERROR) << "Wrong video frame size: "
+                          << video_size.width() << "x" << video_size.height();
+            return;
+        }
+
+        if (format.has_screen_size())
+        {
+            screen_size = base::Size(
+                format.screen_size().width(), format.screen_size().height());
+
+            if (screen_size.width() <= 0 || screen_size.width() >= kMaxValue ||
+                screen_size.height() <= 0 || screen_size.height() >= kMaxValue)
+            {
+                LOG(LS_ERROR) << "Wrong screen size: "
+                              << screen_size.width() << "x" << screen_size.height();
+                return;
+            }
+        }
+
+        LOG(LS_INFO) << "New video size: " << video_size.width() << "x" << video_size.height();
+        LOG(LS_INFO) << "New screen size: " << screen_size.width() << "x" << screen_size.height();
+
+        FrameChain::Frames frames;
+        for (auto& frame : frames)
+            frame = desktop_window_proxy_->allocateFrame(video_size);
+
+        std::shared_ptr<FrameChain> frame_chain = std::make_shared<FrameChain>(frames);
+
+        {
+            std::scoped_lock lock(frame_lock_);
+            frame_chain_ = frame_chain;
+        }
+
+        frame_ = frame_chain->decodeFrame();
+        desktop_window_proxy_->setFrame(screen_size, frame_chain);
+
+        // The streams of the monitors are restarted together with the frame.
+        screen_streams_.clear();
+        lossless_decoder_.reset();
+    }
+
+    // The chain is replaced only in runStep(), so it can be used without the lock.
+    if (!frame_)
+    {
+        LOG(LS_ERROR) << "The desktop frame is not initialized";
+        return;
+    }
+
+    const Clock::time_point decode_start_time = Clock::now();
+
+    {
+        TRACE_EVENT("decode");
+
+        if (packet.screen_packet_size() > 0)
+        {
+            if (!decodeScreenPackets(packet))
+                return;
+        }
+        else if (!video_decoder_->decode(packet, frame_))
+        {
+            LOG(LS_ERROR) << "The video packet could not be decoded";
+            return;
+        }
+        else if (packet.has_lossless_packet() &&
+                 !decodeLosslessPacket(packet.lossless_packet(), &lossless_decoder_, frame_))
+        {
+            return;
+        }
+    }
+
+    latency_stats_->addSample(LatencyStats::Stage::DECODE,
+                              std::chrono::duration_cast<std::chrono::microseconds>(
+                                  Clock::now() - decode_start_time));
+
+    {
+        std::scoped_lock lock(queue_lock_);
+        ++decoded_frame_count_;
+    }
+
+    // The published buffer can be shown by the window at once, so the region is copied first.
+    const base::Region updated_region = frame_->constUpdatedRegion();
+
+    frame_chain_->publish();
+    frame_ = frame_chain_->decodeFrame();
+
+    desktop_window_proxy_->drawFrame(updated_region);
+}
+
+bool VideoDecodeThread::decodeScreenPackets(const proto::VideoPacket& packet)
+{
+    const base::Rect frame_rect = base::Rect::makeSize(frame_->size());
+
+    screen_streams_.resize(static_cast<size_t>(packet.screen_packet_size()));
+
+    base::Region* updated_region = frame_->updatedRegion();
+    updated_region->clear();
+
+    for (int i = 0; i < packet.screen_packet_size(); ++i)
+    {
+        const proto::VideoPacket& screen_packet = packet.screen_packet(i);
+        ScreenStream& stream = screen_streams_[static_cast<size_t>(i)];
+
+        if (screen_packet.has_format())
+        {
+            const proto::Rect& video_rect = screen_packet.format().video_rect();
+            const base::Rect rect = base::Rect::makeXYWH(
+                video_rect.x(), video_rect.y(), video_rect.width(), video_rect.height());
+
+            if (rect.isEmpty() || !frame_rect.containsRect(rect))
+            {
+                LOG(LS_ERROR) << "Wrong screen stream rectangle: " << rect;
+                return false;
+            }
+
+            stream.rect = rect;
+            stream.decoder = base::VideoDecoder::create(screen_packet.encoding(), 2);
+            stream.lossless_decoder.reset();
+        }
+
+        if (!stream.decoder)
+        {
+            LOG(LS_ERROR) << "Screen stream " << i << " not initialized";
+            return false;
+        }
+
+        base::FrameView view(*frame_, stream.rect);
+
+        if (!stream.decoder->decode(screen_packet, &view))
+        {
+            LOG(LS_ERROR) << "The screen packet " << i << " could not be decoded";
+            return false;
+        }
+
+        if (screen_packet.has_lossless_packet() &&
+            !decodeLosslessPacket(screen_packet.lossless_packet(), &stream.lossless_decoder, &view))
+        {
+            return false;
+        }
+
+        base::Region view_region = view.constUpdatedRegion();
+        view_region.translate(stream.rect.x(), stream.rect.y());
+        updated_region->addRegion(view_region);
+    }
+
+    return true;
+}
+
+// static
+bool VideoDecodeThread::decodeLosslessPacket(const proto::VideoPacket& packet,
+                                             std::unique_ptr<base::VideoDecoder>* decoder,
+                                             base::Frame* frame)
+{
+    if (packet.has_format())
+        *decoder = base::VideoDecoder::create(proto::VIDEO_ENCODING_ZSTD);
+
+    if (!*decoder)
+    {
+        LOG(LS_ERROR) << "The lossless stream is not initialized";
+        return false;
+    }
+
+    // The decoder replaces the updated region of the frame.
+    base::Region updated_region = frame->constUpdatedRegion();
+
+    if (!(*decoder)->decode(packet, frame))
+    {
+        LOG(LS_ERROR) << "The lossless packet could not be decoded";
+        return false;
+    }
+
+    updated_region.addRegion(frame->constUpdatedRegion());
+    *frame->updatedRegion() = std::move(updated_region);
+    return true;
+}
+
+} // namespace client
@@ -0,0 +1,139 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef CLIENT_VIDEO_DECODE_THREAD_H
+#define CLIENT_VIDEO_DECODE_THREAD_H
+
+#include "base/macros_magic.h"
+#include "base/desktop/geometry.h"
+#include "client/decode_scheduler.h"
+#include "proto/desktop.pb.h"
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace base {
+class Frame;
+class VideoDecoder;
+} // namespace base
+
+namespace client {
+
+class DesktopWindowProxy;
+class FrameChain;
+class LatencyStats;
+
+// Decodes the video packets on the threads of DecodeScheduler, so that a slow decoding of a large
+// frame does not delay the network I/O. The queue between the threads is bounded. When the
+// decoder falls behind, the queued inter frames are dropped and the next packets are skipped until
+// a key frame.
+class VideoDecodeThread : public DecodeScheduler::Task
+{
+public:
+    VideoDecodeThread(std::shared_ptr<DesktopWindowProxy> desktop_window_proxy,
+                      std::shared_ptr<LatencyStats> latency_stats);
+    ~VideoDecodeThread() override;
+
+    // Frames can be dropped only if the host is able to send a key frame on request. Otherwise
+    // the size of the queue is not limited.
+    void setFrameDroppingEnabled(bool enable);
+
+    // VP9 is decoded with one thread per processor. The setting is applied when the next packet
+    // with a new format is received, because the host restarts the stream after a config change.
+    void setMultithreadedDecoding(bool enable);
+
+    // The packets of the active window are decoded before the packets of other sessions.
+    void setHighPriority(bool enable);
+
+    // Adds |packet| to the queue. Returns true if frames were dropped and a key frame should be
+    // requested from the host.
+    bool addPacket(std::unique_ptr<proto::VideoPacket> packet);
+
+    // Returns the newest decoded frame. Its content may be changed by the decoder at any time.
+    std::shared_ptr<base::Frame> frame() const;
+
+    // Returns the number of frames decoded since the previous call.
+    int64_t takeDecodedFrameCount();
+
+    int64_t droppedFrameCount() const;
+
+protected:
+    // DecodeScheduler::Task implementation.
+    bool runStep() override;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct QueuedPacket
+    {
+        std::unique_ptr<proto::VideoPacket> packet;
+        Clock::time_point receive_time;
+    };
+
+    void decodePacket(const proto::VideoPacket& packet);
+    bool decodeScreenPackets(const proto::VideoPacket& packet);
+    static bool decodeLosslessPacket(const proto::VideoPacket& packet,
+                                     std::unique_ptr<base::VideoDecoder>* decoder,
+                                     base::Frame* frame);
+
+    std::shared_ptr<DesktopWindowProxy> desktop_window_proxy_;
+    std::shared_ptr<LatencyStats> latency_stats_;
+
+    std::shared_ptr<DecodeScheduler> scheduler_;
+
+    mutable std::mutex queue_lock_;
+    std::deque<QueuedPacket> queue_;
+    bool dropping_enabled_ = false;
+    bool waiting_key_frame_ = false;
+    int64_t skipped_packet_count_ = 0;
+    bool multithreaded_ = false;
+    int64_t decoded_frame_count_ = 0;
+    int64_t dropped_frame_count_ = 0;
+
+    // Used only in runStep().
+    proto::VideoEncoding video_encoding_ = proto::VIDEO_ENCODING_UNKNOWN;
+    bool decoder_multithreaded_ = false;
+    std::unique_ptr<base::VideoDecoder> video_decoder_;
+
+    // Decodes the text of the hybrid encoding on top of the frame decoded by |video_decoder_|.
+    std::unique_ptr<base::VideoDecoder> lossless_decoder_;
+
+    // Decoders of the monitors if the host sends them as separate streams.
+    struct ScreenStream
+    {
+        base::Rect rect;
+        std::unique_ptr<base::VideoDecoder> decoder;
+        std::unique_ptr<base::VideoDecoder> lossless_decoder;
+    };
+
+    std::vector<ScreenStream> screen_streams_;
+
+    // The packets are decoded into |frame_|, which is a buffer of the chain. The chain is
+    // written on the decoding thread and read on the I/O thread.
+    mutable std::mutex frame_lock_;
+    std::shared_ptr<FrameChain> frame_chain_;
+    base::Frame* frame_ = nullptr;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoDecodeThread);
+};
+
+} // namespace client
+
+#endif // CLIENT_VIDEO_DECODE_THREAD_H
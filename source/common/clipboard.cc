@@ -19,6 +19,7 @@
 #include "common/clipboard.h"
 
 #include "base/logging.h"
+#include "base/crypto/generic_hash.h"
 
 #include <zstd.h>
 
@@ -29,6 +30,16 @@ namespace {
 const char kMimeTypeTextUtf8[] = "text/plain; charset=UTF-8";
 const char kMimeTypeCompressedTextUtf8[] = "text/plain; charset=UTF-8; compression=ZSTD";
 
+// All parts of large data except the last one have this type. Older peers ignore them and cannot
+// decompress the last part alone.
+const char kMimeTypePart[] = "application/octet-stream; clipboard-part";
+
+// Large data is split into parts, so that the other messages of the channel are sent between them.
+const size_t kMaxPartSize = 64 * 1024;
+
+// Larger data is not received.
+const size_t kMaxDataSize = 64 * 1024 * 1024;
+
 // The compression ratio can be in the range of 1 to 22.
 const int kCompressionRatio = 8;
 
@@ -98,6 +109,11 @@ bool decompress(const std::string& in, std::string* out)
     return true;
 }
 
+base::ByteArray dataHash(const std::string& data)
+{
+    return base::GenericHash::hash(base::GenericHash::BLAKE2s256, data);
+}
+
 } // namespace
 
 void Clipboard::start(Delegate* delegate)
@@ -109,58 +125,99 @@ void Clipboard::start(Delegate* delegate)
 
 void Clipboard::injectClipboardEvent(const proto::ClipboardEvent& event)
 {
-    if (event.mime_type() == kMimeTypeCompressedTextUtf8)
+    if (event.mime_type() == kMimeTypePart)
     {
-        std::string decompressed_data;
-        if (!decompress(event.data(), &decompressed_data))
+        if (pending_data_.size() + event.data().size() > kMaxDataSize)
+        {
+            LOG(LS_WARNING) << "Too large clipboard data";
+            pending_data_.clear();
+            pending_data_.shrink_to_fit();
             return;
+        }
 
-        // Store last injected data.
-        last_data_ = std::move(decompressed_data);
+        pending_data_.append(event.data());
+        return;
     }
-    else if (event.mime_type() == kMimeTypeTextUtf8)
+
+    std::string data;
+    if (!pending_data_.empty())
     {
-        // Store last injected data.
-        last_data_ = event.data();
+        data = std::move(pending_data_);
+        data.append(event.data());
+        pending_data_.clear();
     }
     else
+    {
+        data = event.data();
+    }
+
+    if (event.mime_type() == kMimeTypeCompressedTextUtf8)
+    {
+        std::string decompressed_data;
+        if (!decompress(data, &decompressed_data))
+            return;
+
+        data = std::move(decompressed_data);
+    }
+    else if (event.mime_type() != kMimeTypeTextUtf8)
     {
         LOG(LS_WARNING) << "Unsupported mime type: " << event.mime_type();
         return;
     }
 
-    setData(last_data_);
+    // The injected data comes back from the system clipboard and must not be sent back.
+    last_hash_ = dataHash(data);
+    setData(data);
 }
 
 void Clipboard::clearClipboard()
 {
+    // The empty clipboard is not sent to the other side.
+    last_hash_ = dataHash(std::string());
     setData(std::string());
 }
 
 void Clipboard::onData(const std::string& data)
 {
-    if (last_data_ == data)
+    base::ByteArray hash = dataHash(data);
+    if (last_hash_ == hash)
         return;
 
-    proto::ClipboardEvent event;
+    last_hash_ = std::move(hash);
 
-    if (data.size() > kMinSizeToCompress)
-    {
-        std::string compressed_data;
-        if (!compress(data, &compressed_data))
-            return;
+    if (!delegate_)
+        return;
 
-        event.set_mime_type(kMimeTypeCompressedTextUtf8);
-        event.set_data(std::move(compressed_data));
-    }
-    else
+    proto::ClipboardEvent event;
+
+    if (data.size() <= kMinSizeToCompress)
     {
         event.set_mime_type(kMimeTypeTextUtf8);
         event.set_data(data);
+
+        delegate_->onClipboardEvent(event);
+        return;
     }
 
-    if (delegate_)
+    std::string compressed_data;
+    if (!compress(data, &compressed_data))
+        return;
+
+    // All parts except the last one are collected by the receiver.
+    event.set_mime_type(kMimeTypePart);
+
+    size_t offset = 0;
+    while (compressed_data.size() - offset > kMaxPartSize)
+    {
+        event.set_data(compressed_data.data() + offset, kMaxPartSize);
         delegate_->onClipboardEvent(event);
+        offset += kMaxPartSize;
+    }
+
+    event.set_mime_type(kMimeTypeCompressedTextUtf8);
+    event.set_data(compressed_data.data() + offset, compressed_data.size() - offset);
+
+    delegate_->onClipboardEvent(event);
 }
 
 } // namespace common
@@ -19,6 +19,7 @@
 #ifndef COMMON_CLIPBOARD_H
 #define COMMON_CLIPBOARD_H
 
+#include "base/memory/byte_array.h"
 #include "proto/desktop.pb.h"
 
 #include <memory>
@@ -50,8 +51,13 @@ protected:
     void onData(const std::string& data);
 
 private:
+    // The hash of the last sent or injected data. The same data is not sent again.
+    base::ByteArray last_hash_;
+
+    // Large data is sent in several events. The parts are collected until the last one.
+    std::string pending_data_;
+
     Delegate* delegate_ = nullptr;
-    std::string last_data_;
 };
 
 } // namespace common
@@ -31,21 +31,24 @@ const char kSystemInfoExtension[] = "system_info";
 const char kTaskManagerExtension[] = "task_manager";
 const char kVideoPauseExtension[] = "video_pause";
 const char kAudioPauseExtension[] = "audio_pause";
+const char kKeyFrameExtension[] = "key_frame";
 
 #if defined(OS_WIN)
 const char kSupportedExtensionsForManage[] =
-    "select_screen;preferred_size;power_control;remote_update;system_info;video_recording;task_manager;video_pause;audio_pause";
+    "select_screen;preferred_size;power_control;remote_update;system_info;video_recording;task_manager;video_pause;audio_pause;key_frame";
 
 const char kSupportedExtensionsForView[] =
-    "select_screen;preferred_size;system_info;video_recording;video_pause;audio_pause";
+    "select_screen;preferred_size;system_info;video_recording;video_pause;audio_pause;key_frame";
 #else
 const char kSupportedExtensionsForManage[] =
-    "select_screen;preferred_size;video_recording;video_pause;audio_pause";
+    "select_screen;preferred_size;video_recording;video_pause;audio_pause;key_frame";
 
 const char kSupportedExtensionsForView[] =
-    "select_screen;preferred_size;video_recording;video_pause;audio_pause";
+    "select_screen;preferred_size;video_recording;video_pause;audio_pause;key_frame";
 #endif
 
+// H.264 and HEVC depend on the hardware and are added at run time by the host (see
+// base::VideoEncoderMF) and the client (see base::VideoDecoder).
 const uint32_t kSupportedVideoEncodings =
     proto::VIDEO_ENCODING_VP8 | proto::VIDEO_ENCODING_VP9 | proto::VIDEO_ENCODING_ZSTD;
 const uint32_t kSupportedAudioEncodings = proto::AUDIO_ENCODING_OPUS;
@@ -19,54 +19,115 @@
 #include "common/file_depacketizer.h"
 
 #include "base/logging.h"
+#include "base/strings/unicode.h"
+#include "common/file_packet.h"
+
+#include <algorithm>
 
 namespace common {
 
+namespace {
+
+bool readBlockList(const std::filesystem::path& file_path, proto::FileBlockList* block_list)
+{
+    std::error_code error_code;
+    const uintmax_t file_size = std::filesystem::file_size(file_path, error_code);
+    if (error_code)
+        return false;
+
+    size_t block_size = kMinFileBlockSize;
+    while (block_size < kMaxFilePacketSize && file_size / block_size > kMaxFileBlockCount)
+        block_size *= 2;
+
+    std::ifstream file_stream;
+    file_stream.open(file_path, std::ifstream::binary);
+    if (!file_stream.is_open())
+        return false;
+
+    std::string buffer;
+    buffer.resize(block_size);
+
+    for (uintmax_t offset = 0; offset < file_size; offset += block_size)
+    {
+        const size_t size =
+            static_cast<size_t>(std::min<uintmax_t>(block_size, file_size - offset));
+
+        file_stream.read(buffer.data(), static_cast<std::streamsize>(size));
+        if (file_stream.fail())
+            return false;
+
+        block_list->add_hash(fileBlockHash(buffer.data(), size));
+    }
+
+    block_list->set_block_size(static_cast<uint32_t>(block_size));
+    return true;
+}
+
+} // namespace
+
 FileDepacketizer::FileDepacketizer(const std::filesystem::path& file_path,
-                                   std::ofstream&& file_stream)
+                                   std::ofstream&& file_stream,
+                                   bool is_delta)
     : file_path_(file_path),
-      file_stream_(std::move(file_stream))
+      file_stream_(std::move(file_stream)),
+      is_delta_(is_delta),
+      stream_(ZSTD_createDStream())
 {
     // Nothing
 }
 
 FileDepacketizer::~FileDepacketizer()
 {
-    // If the file is opened, it was not completely written.
+    // If the file is opened, the transfer was interrupted. The incomplete file is kept, so that
+    // the next transfer with the delta can resume it.
     if (file_stream_.is_open())
-    {
         file_stream_.close();
-
-        // The transfer of files was canceled. Delete the file.
-        std::error_code ignored_error;
-        std::filesystem::remove(file_path_, ignored_error);
-    }
 }
 
 // static
 std::unique_ptr<FileDepacketizer> FileDepacketizer::create(
-    const std::filesystem::path& file_path, bool overwrite)
+    const std::filesystem::path& file_path, bool overwrite, proto::FileBlockList* block_list)
 {
     std::ofstream::openmode mode = std::ofstream::binary;
+    bool is_delta = false;
 
     if (overwrite)
-        mode |= std::ofstream::trunc;
+    {
+        std::error_code ignored_code;
+        if (block_list && std::filesystem::is_regular_file(file_path, ignored_code))
+        {
+            // The content of the file is kept and only the changed blocks are written.
+            is_delta = readBlockList(file_path, block_list);
+            if (!is_delta)
+                block_list->Clear();
+        }
+
+        if (is_delta)
+            mode |= std::ofstream::in | std::ofstream::out;
+        else
+            mode |= std::ofstream::trunc;
+    }
 
     std::ofstream file_stream;
 
     file_stream.open(file_path, mode);
     if (!file_stream.is_open())
+    {
+        if (block_list)
+            block_list->Clear();
         return nullptr;
+    }
 
     return std::unique_ptr<FileDepacketizer>(
-        new FileDepacketizer(file_path, std::move(file_stream)));
+        new FileDepacketizer(file_path, std::move(file_stream), is_delta));
 }
 
-bool FileDepacketizer::writeNextPacket(const proto::FilePacket& packet)
+bool FileDepacketizer::writeNextPacket(const proto::FilePacket& packet,
+                                       const base::ByteArray& detached_data)
 {
     DCHECK(file_stream_.is_open());
 
-    const size_t packet_size = packet.data().size();
+    const size_t packet_size = filePacketDataSize(packet);
     if (!packet_size)
     {
         if (packet.flags() & proto::FilePacket::LAST_PACKET)
@@ -75,14 +136,15 @@ bool FileDepacketizer::writeNextPacket(const proto::FilePacket& packet)
             {
                 // Zero-length file received.
                 file_size_ = 0;
-                file_stream_.close();
-            }
-            else
-            {
-                // If an empty data packet with the last packet flag set is received, the transfer
-                // is canceled.
+                return finishFile();
             }
 
+            // If an empty data packet with the last packet flag set is received, the transfer
+            // is canceled. Delete the file.
+            file_stream_.close();
+
+            std::error_code ignored_error;
+            std::filesystem::remove(file_path_, ignored_error);
             return true;
         }
 
@@ -97,8 +159,61 @@ bool FileDepacketizer::writeNextPacket(const proto::FilePacket& packet)
         left_size_ = file_size_;
     }
 
-    file_stream_.seekp(static_cast<std::streamoff>(file_size_ - left_size_));
-    file_stream_.write(packet.data().data(), packet_size);
+    if (packet_size > left_size_)
+    {
+        LOG(LS_WARNING) << "Packet is larger than the rest of the file";
+        return false;
+    }
+
+    if (packet.flags() & proto::FilePacket::UNCHANGED)
+    {
+        if (!is_delta_)
+        {
+            LOG(LS_WARNING) << "Unexpected unchanged packet";
+            return false;
+        }
+
+        // The block is already in the file.
+        left_size_ -= packet_size;
+        file_stream_.seekp(static_cast<std::streamoff>(file_size_ - left_size_));
+        if (file_stream_.fail())
+        {
+            LOG(LS_WARNING) << "Unable to seek file";
+            return false;
+        }
+
+        if (packet.flags() & proto::FilePacket::LAST_PACKET)
+            return finishFile();
+
+        return true;
+    }
+
+    const char* data = packet.data().data();
+    size_t data_size = packet.data().size();
+
+    if (packet.flags() & proto::FilePacket::DETACHED_DATA)
+    {
+        if (detached_data.size() != packet.detached_size())
+        {
+            LOG(LS_WARNING) << "Wrong size of detached data";
+            return false;
+        }
+
+        data = reinterpret_cast<const char*>(detached_data.data());
+        data_size = detached_data.size();
+    }
+
+    if (packet.flags() & proto::FilePacket::COMPRESSED)
+    {
+        if (packet_size > kMaxFilePacketSize || !decompressPacket(data, data_size, packet_size))
+            return false;
+
+        data = decompress_buffer_.data();
+    }
+
+    // The packets are received in order, so the file is written sequentially without seeking
+    // (a seek flushes the buffer of the stream).
+    file_stream_.write(data, static_cast<std::streamsize>(packet_size));
     if (file_stream_.fail())
     {
         LOG(LS_WARNING) << "Unable to write file";
@@ -108,9 +223,75 @@ bool FileDepacketizer::writeNextPacket(const proto::FilePacket& packet)
     left_size_ -= packet_size;
 
     if (packet.flags() & proto::FilePacket::LAST_PACKET)
+        return finishFile();
+
+    return true;
+}
+
+bool FileDepacketizer::finishFile()
+{
+    file_stream_.close();
+
+    // The existing file may be longer than the new one.
+    if (is_delta_)
     {
-        file_size_ = 0;
-        file_stream_.close();
+        std::error_code error_code;
+        std::filesystem::resize_file(file_path_, file_size_, error_code);
+        if (error_code)
+        {
+            LOG(LS_WARNING) << "Unable to resize file: "
+                            << base::utf16FromLocal8Bit(error_code.message());
+            return false;
+        }
+    }
+
+    file_size_ = 0;
+    return true;
+}
+
+bool FileDepacketizer::decompressPacket(const char* data, size_t size, size_t uncompressed_size)
+{
+    size_t ret;
+
+    if (!stream_started_)
+    {
+        ret = ZSTD_initDStream(stream_.get());
+        if (ZSTD_isError(ret))
+        {
+            LOG(LS_WARNING) << "ZSTD_initDStream failed: " << ZSTD_getErrorName(ret);
+            return false;
+        }
+
+        stream_started_ = true;
+    }
+
+    decompress_buffer_.resize(uncompressed_size);
+
+    ZSTD_inBuffer input = { data, size, 0 };
+    ZSTD_outBuffer output = { decompress_buffer_.data(), decompress_buffer_.size(), 0 };
+
+    // The source flushes the stream at the end of each packet, so all the data can be
+    // decompressed.
+    while (input.pos < input.size)
+    {
+        const size_t input_pos = input.pos;
+
+        ret = ZSTD_decompressStream(stream_.get(), &output, &input);
+        if (ZSTD_isError(ret))
+        {
+            LOG(LS_WARNING) << "ZSTD_decompressStream failed: " << ZSTD_getErrorName(ret);
+            return false;
+        }
+
+        // The packet contains more data than declared.
+        if (input.pos == input_pos && output.pos == output.size)
+            break;
+    }
+
+    if (input.pos != input.size || output.pos != output.size)
+    {
+        LOG(LS_WARNING) << "Invalid compressed packet";
+        return false;
     }
 
     return true;
@@ -20,6 +20,8 @@
 #define COMMON_FILE_DEPACKETIZER_H
 
 #include "base/macros_magic.h"
+#include "base/codec/scoped_zstd_stream.h"
+#include "base/memory/byte_array.h"
 #include "proto/file_transfer.pb.h"
 
 #include <filesystem>
@@ -33,17 +35,35 @@ class FileDepacketizer
 public:
     ~FileDepacketizer();
 
+    // If |block_list| is not null and an existing file is overwritten, then its content is kept
+    // and |block_list| receives the hashes of its blocks.
     static std::unique_ptr<FileDepacketizer> create(const std::filesystem::path& file_path,
-                                                    bool overwrite);
+                                                    bool overwrite,
+                                                    proto::FileBlockList* block_list = nullptr);
 
-    // Reads the packet and writes its contents to a file.
-    bool writeNextPacket(const proto::FilePacket& packet);
+    // Reads the packet and writes its contents to a file. |detached_data| contains the data of a
+    // packet with the DETACHED_DATA flag.
+    bool writeNextPacket(const proto::FilePacket& packet,
+                         const base::ByteArray& detached_data = base::ByteArray());
 
 private:
-    FileDepacketizer(const std::filesystem::path& file_path, std::ofstream&& file_stream);
+    FileDepacketizer(const std::filesystem::path& file_path,
+                     std::ofstream&& file_stream,
+                     bool is_delta);
+
+    // Closes the completely written file.
+    bool finishFile();
+
+    // Decompresses |size| bytes of |data| to |decompress_buffer_|.
+    bool decompressPacket(const char* data, size_t size, size_t uncompressed_size);
 
     std::filesystem::path file_path_;
     std::ofstream file_stream_;
+    const bool is_delta_;
+
+    base::ScopedZstdDStream stream_;
+    bool stream_started_ = false;
+    std::string decompress_buffer_;
 
     uint64_t file_size_ = 0;
     uint64_t left_size_ = 0;
@@ -19,11 +19,55 @@
 #ifndef COMMON_FILE_PACKET_H
 #define COMMON_FILE_PACKET_H
 
+#include "base/crypto/generic_hash.h"
+#include "proto/file_transfer.pb.h"
+
 namespace common {
 
 // When transferring a file is divided into parts and each part is transmitted separately.
-// This parameter specifies the size of the part.
-static const size_t kMaxFilePacketSize = 64 * 1024; // 64 kB
+// This parameter specifies the size of the part if the request does not specify another one.
+static const size_t kDefaultFilePacketSize = 64 * 1024; // 64 kB
+
+// The largest part that the source sends on request.
+static const size_t kMaxFilePacketSize = 1024 * 1024; // 1 MB
+
+// Files up to this size are transferred in batches of up to kMaxFileBatchCount files with the
+// total size up to kMaxFileBatchSize.
+static const size_t kMaxBatchedFileSize = 64 * 1024; // 64 kB
+static const size_t kMaxFileBatchSize = 1024 * 1024; // 1 MB
+static const int kMaxFileBatchCount = 256;
+
+// Maximum number of paths in one remove request.
+static const int kMaxRemoveBatchCount = 1024;
+
+// Existing files are compared in blocks of at least kMinFileBlockSize. The block size grows for
+// large files, so that the number of blocks does not exceed kMaxFileBlockCount until the block size
+// reaches kMaxFilePacketSize.
+static const size_t kMinFileBlockSize = 256 * 1024; // 256 kB
+static const size_t kMaxFileBlockCount = 4096;
+
+// Files smaller than this are always sent in full.
+static const int64_t kMinDeltaFileSize = 4 * 1024 * 1024; // 4 MB
+
+inline std::string fileBlockHash(const void* data, size_t size)
+{
+    return base::toStdString(base::GenericHash::hash(base::GenericHash::BLAKE2s256, data, size));
+}
+
+// Returns the size of the file data in the packet.
+inline size_t filePacketDataSize(const proto::FilePacket& packet)
+{
+    if (packet.flags() & proto::FilePacket::COMPRESSED)
+        return packet.uncompressed_size();
+
+    if (packet.flags() & proto::FilePacket::UNCHANGED)
+        return packet.unchanged_size();
+
+    if (packet.flags() & proto::FilePacket::DETACHED_DATA)
+        return packet.detached_size();
+
+    return packet.data().size();
+}
 
 } // namespace common
 
@@ -21,20 +21,62 @@
 #include "base/logging.h"
 #include "common/file_packet.h"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+
 namespace common {
 
 namespace {
 
-char* outputBuffer(proto::FilePacket* packet, size_t size)
+const int kCompressionLevel = 3;
+
+// Packets smaller than this are sent as is.
+const size_t kMinCompressSize = 4096;
+
+// Number of bytes in the sample for the entropy estimation.
+const size_t kEntropySampleSize = 4096;
+
+// Data with a higher entropy (bits per byte) is considered already compressed (archives, images,
+// video) and is sent as is.
+const double kMaxCompressibleEntropy = 7.5;
+
+// The file is read in blocks of this size, so several packets are served from memory.
+const size_t kReadAheadSize = 4 * kMaxFilePacketSize;
+
+bool isCompressible(const char* data, size_t size)
 {
-    packet->mutable_data()->resize(size);
-    return packet->mutable_data()->data();
+    std::array<uint32_t, 256> histogram;
+    histogram.fill(0);
+
+    const size_t step = std::max(size / kEntropySampleSize, size_t(1));
+    uint32_t count = 0;
+
+    for (size_t i = 0; i < size; i += step)
+    {
+        ++histogram[static_cast<uint8_t>(data[i])];
+        ++count;
+    }
+
+    double entropy = 0;
+
+    for (uint32_t value : histogram)
+    {
+        if (!value)
+            continue;
+
+        const double probability = static_cast<double>(value) / count;
+        entropy -= probability * std::log2(probability);
+    }
+
+    return entropy < kMaxCompressibleEntropy;
 }
 
 } // namespace
 
 FilePacketizer::FilePacketizer(std::ifstream&& file_stream)
-    : file_stream_(std::move(file_stream))
+    : file_stream_(std::move(file_stream)),
+      stream_(ZSTD_createCStream())
 {
     file_stream_.seekg(0, file_stream_.end);
     file_size_ = static_cast<uint64_t>(file_stream_.tellg());
@@ -54,7 +96,7 @@ std::unique_ptr<FilePacketizer> FilePacketizer::create(const std::filesystem::pa
 }
 
 std::unique_ptr<proto::FilePacket> FilePacketizer::readNextPacket(
-    const proto::FilePacketRequest& request)
+    const proto::FilePacketRequest& request, base::ByteArray* detached_data)
 {
     DCHECK(file_stream_.is_open());
 
@@ -67,29 +109,74 @@ std::unique_ptr<proto::FilePacket> FilePacketizer::readNextPacket(
         return packet;
     }
 
-    size_t packet_buffer_size = kMaxFilePacketSize;
+    size_t packet_buffer_size = kDefaultFilePacketSize;
+    if (request.packet_size())
+    {
+        packet_buffer_size =
+            std::min(static_cast<size_t>(request.packet_size()), kMaxFilePacketSize);
+    }
 
-    if (left_size_ < kMaxFilePacketSize)
+    if (left_size_ < packet_buffer_size)
         packet_buffer_size = static_cast<size_t>(left_size_);
 
-    char* packet_buffer = outputBuffer(packet.get(), packet_buffer_size);
-
-    // Moving to a new position in file.
-    file_stream_.seekg(static_cast<std::streamoff>(file_size_ - left_size_));
-
-    file_stream_.read(packet_buffer, packet_buffer_size);
-    if (file_stream_.fail())
+    if (!fillBuffer(packet_buffer_size))
     {
         LOG(LS_WARNING) << "Unable to read file";
         return nullptr;
     }
 
+    const uint64_t offset = file_size_ - left_size_;
+
+    if (!offset && request.has_block_list())
+        target_blocks_ = request.block_list();
+
+    const char* data = buffer_.data() + buffer_pos_;
+
+    if (isUnchangedBlock(offset, data, packet_buffer_size))
+    {
+        packet->set_flags(proto::FilePacket::UNCHANGED);
+        packet->set_unchanged_size(static_cast<uint32_t>(packet_buffer_size));
+    }
+    else if (detached_data && packet_buffer_size &&
+             (request.flags() & proto::FilePacketRequest::DETACH_DATA))
+    {
+        if ((request.flags() & proto::FilePacketRequest::COMPRESS) &&
+            compressData(data, packet_buffer_size, detached_data))
+        {
+            packet->set_flags(proto::FilePacket::COMPRESSED);
+            packet->set_uncompressed_size(static_cast<uint32_t>(packet_buffer_size));
+        }
+        else
+        {
+            detached_data->assign(data, data + packet_buffer_size);
+        }
+
+        packet->set_flags(packet->flags() | proto::FilePacket::DETACHED_DATA);
+        packet->set_detached_size(static_cast<uint32_t>(detached_data->size()));
+    }
+    else
+    {
+        if ((request.flags() & proto::FilePacketRequest::COMPRESS) &&
+            compressData(data, packet_buffer_size, packet->mutable_data()))
+        {
+            packet->set_flags(proto::FilePacket::COMPRESSED);
+            packet->set_uncompressed_size(static_cast<uint32_t>(packet_buffer_size));
+        }
+        else
+        {
+            packet->mutable_data()->assign(data, packet_buffer_size);
+        }
+    }
+
+    buffer_pos_ += packet_buffer_size;
+
     if (left_size_ == file_size_)
     {
         packet->set_flags(packet->flags() | proto::FilePacket::FIRST_PACKET);
 
         // Set file path and size in first packet.
         packet->set_file_size(file_size_);
+        packet->set_max_packet_size(kMaxFilePacketSize);
     }
 
     left_size_ -= packet_buffer_size;
@@ -105,4 +192,118 @@ std::unique_ptr<proto::FilePacket> FilePacketizer::readNextPacket(
     return packet;
 }
 
+bool FilePacketizer::isUnchangedBlock(uint64_t offset, const char* data, size_t size) const
+{
+    const uint64_t block_size = target_blocks_.block_size();
+    if (!block_size || !size || offset % block_size)
+        return false;
+
+    // Only a whole block (or the end of the file) is compared.
+    if (size != block_size && offset + size != file_size_)
+        return false;
+
+    const uint64_t index = offset / block_size;
+    if (index >= static_cast<uint64_t>(target_blocks_.hash_size()))
+        return false;
+
+    return target_blocks_.hash(static_cast<int>(index)) == fileBlockHash(data, size);
+}
+
+void FilePacketizer::readAhead()
+{
+    if (!file_stream_.is_open() || !left_size_)
+        return;
+
+    // Read errors are reported when the data is requested.
+    fillBuffer(kReadAheadSize);
+}
+
+bool FilePacketizer::fillBuffer(size_t size)
+{
+    const size_t available = buffer_.size() - buffer_pos_;
+    if (available >= size)
+        return true;
+
+    const uint64_t unread_size = file_size_ - read_size_;
+    const size_t read_size = static_cast<size_t>(
+        std::min<uint64_t>(std::max(size, kReadAheadSize) - available, unread_size));
+    if (!read_size)
+        return false;
+
+    buffer_.erase(0, buffer_pos_);
+    buffer_pos_ = 0;
+
+    buffer_.resize(available + read_size);
+
+    // The file is read sequentially, so no seek is needed.
+    file_stream_.read(buffer_.data() + available, static_cast<std::streamsize>(read_size));
+    if (file_stream_.fail())
+    {
+        buffer_.resize(available);
+        return false;
+    }
+
+    read_size_ += read_size;
+    return buffer_.size() >= size;
+}
+
+template <class T>
+bool FilePacketizer::compressData(const char* source, size_t size, T* output)
+{
+    if (compression_failed_ || size < kMinCompressSize)
+        return false;
+
+    // The skipped packets are not passed to the stream, so the stream is the same on both sides.
+    if (!isCompressible(source, size))
+        return false;
+
+    size_t ret;
+
+    if (!stream_started_)
+    {
+        ret = ZSTD_initCStream(stream_.get(), kCompressionLevel);
+        if (ZSTD_isError(ret))
+        {
+            LOG(LS_WARNING) << "ZSTD_initCStream failed: " << ZSTD_getErrorName(ret);
+            compression_failed_ = true;
+            return false;
+        }
+
+        stream_started_ = true;
+    }
+
+    output->resize(ZSTD_compressBound(size));
+
+    ZSTD_inBuffer input = { source, size, 0 };
+    ZSTD_outBuffer output_buffer = { output->data(), output->size(), 0 };
+
+    while (input.pos < input.size)
+    {
+        ret = ZSTD_compressStream(stream_.get(), &output_buffer, &input);
+        if (ZSTD_isError(ret))
+        {
+            LOG(LS_WARNING) << "ZSTD_compressStream failed: " << ZSTD_getErrorName(ret);
+            compression_failed_ = true;
+            return false;
+        }
+    }
+
+    do
+    {
+        ret = ZSTD_flushStream(stream_.get(), &output_buffer);
+        if (ZSTD_isError(ret))
+        {
+            LOG(LS_WARNING) << "ZSTD_flushStream failed: " << ZSTD_getErrorName(ret);
+            compression_failed_ = true;
+            return false;
+        }
+    }
+    while (ret != 0);
+
+    // The data is already in the stream, so the packet is sent compressed even if it has not
+    // become smaller.
+    output->resize(output_buffer.pos);
+    return true;
+}
+
 } // namespace common
@@ -20,6 +20,8 @@
 #define COMMON_FILE_PACKETIZER_H
 
 #include "base/macros_magic.h"
+#include "base/codec/scoped_zstd_stream.h"
+#include "base/memory/byte_array.h"
 #include "proto/file_transfer.pb.h"
 
 #include <filesystem>
@@ -38,14 +40,42 @@ public:
     // If the specified file can not be opened for reading, then returns nullptr.
     static std::unique_ptr<FilePacketizer> create(const std::filesystem::path& file_path);
 
-    // Creates a packet for transferring.
-    std::unique_ptr<proto::FilePacket> readNextPacket(const proto::FilePacketRequest& request);
+    // Creates a packet for transferring. If the request allows it and |detached_data| is not null,
+    // the data of the packet is placed in |detached_data| instead of the packet.
+    std::unique_ptr<proto::FilePacket> readNextPacket(const proto::FilePacketRequest& request,
+                                                      base::ByteArray* detached_data = nullptr);
+
+    // Reads the next several packets of the file into memory. Called when the worker has no
+    // requests, so the disk reads overlap the sending of the previous packets.
+    void readAhead();
 
 private:
     explicit FilePacketizer(std::ifstream&& file_stream);
 
+    // Makes at least |size| bytes available in |buffer_|.
+    bool fillBuffer(size_t size);
+
+    // Returns true if the block at |offset| is the same in the target file.
+    bool isUnchangedBlock(uint64_t offset, const char* data, size_t size) const;
+
+    // Compresses |size| bytes of |source| to |output| if it is worth it. Returns false if the data
+    // must be sent as is.
+    template <class T>
+    bool compressData(const char* source, size_t size, T* output);
+
     std::ifstream file_stream_;
 
+    // Data read from the file but not sent yet starts at |buffer_pos_|.
+    std::string buffer_;
+    size_t buffer_pos_ = 0;
+    uint64_t read_size_ = 0;
+
+    proto::FileBlockList target_blocks_;
+
+    base::ScopedZstdCStream stream_;
+    bool stream_started_ = false;
+    bool compression_failed_ = false;
+
     uint64_t file_size_ = 0;
     uint64_t left_size_ = 0;
 
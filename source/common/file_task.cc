@@ -26,10 +26,12 @@ namespace common {
 
 FileTask::FileTask(std::shared_ptr<FileTaskProducerProxy> producer_proxy,
                    std::unique_ptr<proto::FileRequest> request,
-                   Target target)
+                   Target target,
+                   base::ByteArray&& request_data)
     : producer_proxy_(std::move(producer_proxy)),
       target_(target),
-      request_(std::move(request))
+      request_(std::move(request)),
+      request_data_(std::move(request_data))
 {
     DCHECK(producer_proxy_);
     DCHECK(request_);
@@ -53,10 +55,11 @@ const proto::FileReply& FileTask::reply() const
     return *reply_;
 }
 
-void FileTask::setReply(std::unique_ptr<proto::FileReply> reply)
+void FileTask::setReply(std::unique_ptr<proto::FileReply> reply, base::ByteArray&& reply_data)
 {
     // Save the reply inside the request.
     reply_ = std::move(reply);
+    reply_data_ = std::move(reply_data);
 
     // Now notify the sender of the reply.
     producer_proxy_->onTaskDone(shared_from_this());
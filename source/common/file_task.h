@@ -20,6 +20,7 @@
 #define COMMON_FILE_TASK_H
 
 #include "base/macros_magic.h"
+#include "base/memory/byte_array.h"
 
 #include <memory>
 
@@ -44,7 +45,8 @@ public:
 
     FileTask(std::shared_ptr<FileTaskProducerProxy> producer_proxy,
              std::unique_ptr<proto::FileRequest> request,
-             Target target);
+             Target target,
+             base::ByteArray&& request_data = base::ByteArray());
     virtual ~FileTask();
 
     // Returns the target of the current request. It can be a local computer or a remote computer.
@@ -59,7 +61,16 @@ public:
     const proto::FileReply& reply() const;
 
     // Sets the reply to the current request. The sender will be notified of this reply.
-    void setReply(std::unique_ptr<proto::FileReply> reply);
+    void setReply(std::unique_ptr<proto::FileReply> reply,
+                  base::ByteArray&& reply_data = base::ByteArray());
+
+    // Data of a file packet with the DETACHED_DATA flag in the request or the reply.
+    const base::ByteArray& requestData() const { return request_data_; }
+    const base::ByteArray& replyData() const { return reply_data_; }
+
+    // Moves the data out of the task, so that it can be sent further without copying.
+    base::ByteArray takeRequestData() { return std::move(request_data_); }
+    base::ByteArray takeReplyData() { return std::move(reply_data_); }
 
 private:
     std::shared_ptr<FileTaskProducerProxy> producer_proxy_;
@@ -68,6 +79,9 @@ private:
     std::unique_ptr<proto::FileRequest> request_;
     std::unique_ptr<proto::FileReply> reply_;
 
+    base::ByteArray request_data_;
+    base::ByteArray reply_data_;
+
     DISALLOW_COPY_AND_ASSIGN(FileTask);
 };
 
@@ -41,10 +41,22 @@ std::shared_ptr<FileTask> FileTaskFactory::driveList()
     return makeTask(std::move(request));
 }
 
-std::shared_ptr<FileTask> FileTaskFactory::fileList(const std::string& path)
+std::shared_ptr<FileTask> FileTaskFactory::fileList(
+    const std::string& path, uint32_t page_size, bool next)
 {
     auto request = std::make_unique<proto::FileRequest>();
-    request->mutable_file_list_request()->set_path(path);
+    proto::FileListRequest* file_list_request = request->mutable_file_list_request();
+    file_list_request->set_path(path);
+    file_list_request->set_page_size(page_size);
+    file_list_request->set_next(next);
+    return makeTask(std::move(request));
+}
+
+std::shared_ptr<FileTask> FileTaskFactory::fileTree(const std::string& path, bool next)
+{
+    auto request = std::make_unique<proto::FileRequest>();
+    request->mutable_file_tree_request()->set_path(path);
+    request->mutable_file_tree_request()->set_next(next);
     return makeTask(std::move(request));
 }
 
@@ -74,6 +86,14 @@ std::shared_ptr<FileTask> FileTaskFactory::remove(const std::string& path)
     return makeTask(std::move(request));
 }
 
+std::shared_ptr<FileTask> FileTaskFactory::removeBatch(
+    std::unique_ptr<proto::RemoveBatchRequest> batch)
+{
+    auto request = std::make_unique<proto::FileRequest>();
+    request->set_allocated_remove_batch_request(batch.release());
+    return makeTask(std::move(request));
+}
+
 std::shared_ptr<FileTask> FileTaskFactory::download(const std::string& file_path)
 {
     auto request = std::make_unique<proto::FileRequest>();
@@ -81,41 +101,71 @@ std::shared_ptr<FileTask> FileTaskFactory::download(const std::string& file_path
     return makeTask(std::move(request));
 }
 
-std::shared_ptr<FileTask> FileTaskFactory::upload(const std::string& file_path, bool overwrite)
+std::shared_ptr<FileTask> FileTaskFactory::upload(
+    const std::string& file_path, bool overwrite, bool delta)
 {
     auto request = std::make_unique<proto::FileRequest>();
 
     proto::UploadRequest* upload_request = request->mutable_upload_request();
     upload_request->set_path(file_path);
     upload_request->set_overwrite(overwrite);
+    upload_request->set_delta(delta);
 
     return makeTask(std::move(request));
 }
 
-std::shared_ptr<FileTask> FileTaskFactory::packetRequest(uint32_t flags)
+std::shared_ptr<FileTask> FileTaskFactory::packetRequest(uint32_t flags, uint32_t packet_size)
 {
     auto request = std::make_unique<proto::FileRequest>();
     request->mutable_packet_request()->set_flags(flags);
+    request->mutable_packet_request()->set_packet_size(packet_size);
     return makeTask(std::move(request));
 }
 
-std::shared_ptr<FileTask> FileTaskFactory::packet(const proto::FilePacket& packet)
+std::shared_ptr<FileTask> FileTaskFactory::packetRequest(
+    uint32_t flags, uint32_t packet_size, const proto::FileBlockList& block_list)
 {
     auto request = std::make_unique<proto::FileRequest>();
-    request->mutable_packet()->CopyFrom(packet);
+    request->mutable_packet_request()->set_flags(flags);
+    request->mutable_packet_request()->set_packet_size(packet_size);
+    request->mutable_packet_request()->mutable_block_list()->CopyFrom(block_list);
     return makeTask(std::move(request));
 }
 
-std::shared_ptr<FileTask> FileTaskFactory::packet(std::unique_ptr<proto::FilePacket> packet)
+std::shared_ptr<FileTask> FileTaskFactory::packet(const proto::FilePacket& packet,
+                                                  base::ByteArray&& data)
+{
+    auto request = std::make_unique<proto::FileRequest>();
+    request->mutable_packet()->CopyFrom(packet);
+    return makeTask(std::move(request), std::move(data));
+}
+
+std::shared_ptr<FileTask> FileTaskFactory::packet(std::unique_ptr<proto::FilePacket> packet,
+                                                  base::ByteArray&& data)
 {
     auto request = std::make_unique<proto::FileRequest>();
     request->set_allocated_packet(packet.release());
+    return makeTask(std::move(request), std::move(data));
+}
+
+std::shared_ptr<FileTask> FileTaskFactory::readBatch(std::unique_ptr<proto::FileBatch> batch)
+{
+    auto request = std::make_unique<proto::FileRequest>();
+    request->set_allocated_read_batch_request(batch.release());
+    return makeTask(std::move(request));
+}
+
+std::shared_ptr<FileTask> FileTaskFactory::writeBatch(std::unique_ptr<proto::FileBatch> batch)
+{
+    auto request = std::make_unique<proto::FileRequest>();
+    request->set_allocated_write_batch_request(batch.release());
     return makeTask(std::move(request));
 }
 
-std::shared_ptr<FileTask> FileTaskFactory::makeTask(std::unique_ptr<proto::FileRequest> request)
+std::shared_ptr<FileTask> FileTaskFactory::makeTask(std::unique_ptr<proto::FileRequest> request,
+                                                    base::ByteArray&& data)
 {
-    return std::make_shared<FileTask>(producer_proxy_, std::move(request), target_);
+    return std::make_shared<FileTask>(producer_proxy_, std::move(request), target_, std::move(data));
 }
 
 } // namespace common
@@ -24,7 +24,10 @@
 #include <string>
 
 namespace proto {
+class FileBatch;
+class FileBlockList;
 class FilePacket;
+class RemoveBatchRequest;
 } // namespace proto
 
 namespace common {
@@ -38,18 +41,28 @@ public:
     FileTask::Target target() const { return target_; }
 
     std::shared_ptr<FileTask> driveList();
-    std::shared_ptr<FileTask> fileList(const std::string& path);
+    std::shared_ptr<FileTask> fileList(
+        const std::string& path, uint32_t page_size = 0, bool next = false);
+    std::shared_ptr<FileTask> fileTree(const std::string& path, bool next);
     std::shared_ptr<FileTask> createDirectory(const std::string& path);
     std::shared_ptr<FileTask> rename(const std::string& old_name, const std::string& new_name);
     std::shared_ptr<FileTask> remove(const std::string& path);
+    std::shared_ptr<FileTask> removeBatch(std::unique_ptr<proto::RemoveBatchRequest> batch);
     std::shared_ptr<FileTask> download(const std::string& file_path);
-    std::shared_ptr<FileTask> upload(const std::string& file_path, bool overwrite);
-    std::shared_ptr<FileTask> packetRequest(uint32_t flags);
-    std::shared_ptr<FileTask> packet(const proto::FilePacket& packet);
-    std::shared_ptr<FileTask> packet(std::unique_ptr<proto::FilePacket> packet);
+    std::shared_ptr<FileTask> upload(const std::string& file_path, bool overwrite, bool delta);
+    std::shared_ptr<FileTask> packetRequest(uint32_t flags, uint32_t packet_size);
+    std::shared_ptr<FileTask> packetRequest(uint32_t flags, uint32_t packet_size,
+                                            const proto::FileBlockList& block_list);
+    std::shared_ptr<FileTask> packet(const proto::FilePacket& packet,
+                                     base::ByteArray&& data = base::ByteArray());
+    std::shared_ptr<FileTask> packet(std::unique_ptr<proto::FilePacket> packet,
+                                     base::ByteArray&& data = base::ByteArray());
+    std::shared_ptr<FileTask> readBatch(std::unique_ptr<proto::FileBatch> batch);
+    std::shared_ptr<FileTask> writeBatch(std::unique_ptr<proto::FileBatch> batch);
 
 private:
-    std::shared_ptr<FileTask> makeTask(std::unique_ptr<proto::FileRequest> request);
+    std::shared_ptr<FileTask> makeTask(std::unique_ptr<proto::FileRequest> request,
+                                       base::ByteArray&& data = base::ByteArray());
 
     std::shared_ptr<FileTaskProducerProxy> producer_proxy_;
     const FileTask::Target target_;
@@ -0,0 +1,79 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "common/file_tree_enumerator.h"
+
+#include "common/file_enumerator.h"
+
+namespace common {
+
+FileTreeEnumerator::FileTreeEnumerator(const std::filesystem::path& root_path)
+    : root_path_(root_path)
+{
+    addLevel(std::string());
+}
+
+FileTreeEnumerator::~FileTreeEnumerator() = default;
+
+bool FileTreeEnumerator::enumerate(int max_count, proto::FileTree* file_tree)
+{
+    while (!levels_.empty() && error_code_ == proto::FILE_ERROR_SUCCESS)
+    {
+        if (file_tree->item_size() >= max_count)
+            return false;
+
+        Level& level = levels_.back();
+        if (level.enumerator->isAtEnd())
+        {
+            levels_.pop_back();
+            continue;
+        }
+
+        const FileEnumerator::FileInfo& file_info = level.enumerator->fileInfo();
+
+        std::string path = file_info.u8name();
+        if (!level.path.empty())
+            path = level.path + '/' + path;
+
+        const bool is_directory = file_info.isDirectory();
+
+        proto::FileTree::Item* item = file_tree->add_item();
+        item->set_path(path);
+        item->set_is_directory(is_directory);
+        if (!is_directory)
+            item->set_size(static_cast<uint64_t>(file_info.size()));
+
+        level.enumerator->advance();
+
+        if (is_directory)
+            addLevel(path);
+    }
+
+    return true;
+}
+
+void FileTreeEnumerator::addLevel(const std::string& path)
+{
+    Level level;
+    level.path = path;
+    level.enumerator = std::make_unique<FileEnumerator>(root_path_ / std::filesystem::u8path(path));
+
+    error_code_ = level.enumerator->errorCode();
+    levels_.emplace_back(std::move(level));
+}
+
+} // namespace common
@@ -0,0 +1,64 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef COMMON_FILE_TREE_ENUMERATOR_H
+#define COMMON_FILE_TREE_ENUMERATOR_H
+
+#include "base/macros_magic.h"
+#include "proto/file_transfer.pb.h"
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace common {
+
+class FileEnumerator;
+
+// Enumerates all files and directories in the tree of the directory. A directory is enumerated
+// before its content. The enumeration can be continued in parts.
+class FileTreeEnumerator
+{
+public:
+    explicit FileTreeEnumerator(const std::filesystem::path& root_path);
+    ~FileTreeEnumerator();
+
+    // Adds up to |max_count| items to |file_tree|. Returns true if the tree is enumerated up to the
+    // end or an error occurred.
+    bool enumerate(int max_count, proto::FileTree* file_tree);
+
+    proto::FileError errorCode() const { return error_code_; }
+
+private:
+    struct Level
+    {
+        std::string path; // Path relative to the root directory.
+        std::unique_ptr<FileEnumerator> enumerator;
+    };
+
+    void addLevel(const std::string& path);
+
+    const std::filesystem::path root_path_;
+    std::vector<Level> levels_;
+    proto::FileError error_code_ = proto::FILE_ERROR_SUCCESS;
+
+    DISALLOW_COPY_AND_ASSIGN(FileTreeEnumerator);
+};
+
+} // namespace common
+
+#endif // COMMON_FILE_TREE_ENUMERATOR_H
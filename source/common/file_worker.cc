@@ -21,12 +21,15 @@
 #include "base/logging.h"
 #include "base/task_runner.h"
 #include "base/files/base_paths.h"
+#include "base/files/file_util.h"
 #include "build/build_config.h"
 #include "common/file_depacketizer.h"
 #include "common/file_packetizer.h"
 #include "common/file_enumerator.h"
+#include "common/file_packet.h"
 #include "common/file_platform_util.h"
 #include "common/file_task.h"
+#include "common/file_tree_enumerator.h"
 
 #if defined(OS_WIN)
 #include "base/win/drive_enumerator.h"
@@ -34,6 +37,37 @@
 
 namespace common {
 
+namespace {
+
+// Number of items in each part of the file tree listing.
+const int kMaxFileTreeItems = 4096;
+
+proto::FileError removePath(const std::filesystem::path& path)
+{
+    std::error_code error_code;
+    if (!std::filesystem::exists(path, error_code))
+    {
+        if (error_code)
+            return proto::FILE_ERROR_ACCESS_DENIED;
+
+        return proto::FILE_ERROR_PATH_NOT_FOUND;
+    }
+
+    std::error_code ignored_code;
+    std::filesystem::permissions(
+        path,
+        std::filesystem::perms::owner_all | std::filesystem::perms::group_all,
+        std::filesystem::perm_options::add,
+        ignored_code);
+
+    if (!std::filesystem::remove(path, ignored_code))
+        return proto::FILE_ERROR_ACCESS_DENIED;
+
+    return proto::FILE_ERROR_SUCCESS;
+}
+
+} // namespace
+
 class FileWorker::Impl : public std::enable_shared_from_this<Impl>
 {
 public:
@@ -45,20 +79,33 @@ public:
     std::shared_ptr<base::TaskRunner> taskRunner() { return task_runner_; }
 
 private:
-    std::unique_ptr<proto::FileReply> doRequest(const proto::FileRequest& request);
+    std::unique_ptr<proto::FileReply> doRequest(const proto::FileRequest& request,
+                                                const base::ByteArray& request_data,
+                                                base::ByteArray* reply_data);
     std::unique_ptr<proto::FileReply> doDriveListRequest();
     std::unique_ptr<proto::FileReply> doFileListRequest(const proto::FileListRequest& request);
+    std::unique_ptr<proto::FileReply> doFileTreeRequest(const proto::FileTreeRequest& request);
     std::unique_ptr<proto::FileReply> doCreateDirectoryRequest(const proto::CreateDirectoryRequest& request);
     std::unique_ptr<proto::FileReply> doRenameRequest(const proto::RenameRequest& request);
     std::unique_ptr<proto::FileReply> doRemoveRequest(const proto::RemoveRequest& request);
+    std::unique_ptr<proto::FileReply> doRemoveBatchRequest(
+        const proto::RemoveBatchRequest& request);
     std::unique_ptr<proto::FileReply> doDownloadRequest(const proto::DownloadRequest& request);
     std::unique_ptr<proto::FileReply> doUploadRequest(const proto::UploadRequest& request);
-    std::unique_ptr<proto::FileReply> doPacketRequest(const proto::FilePacketRequest& request);
-    std::unique_ptr<proto::FileReply> doPacket(const proto::FilePacket& packet);
+    std::unique_ptr<proto::FileReply> doPacketRequest(
+        const proto::FilePacketRequest& request, base::ByteArray* reply_data);
+    std::unique_ptr<proto::FileReply> doPacket(
+        const proto::FilePacket& packet, const base::ByteArray& request_data);
+    std::unique_ptr<proto::FileReply> doReadBatchRequest(const proto::FileBatch& request);
+    std::unique_ptr<proto::FileReply> doWriteBatchRequest(const proto::FileBatch& request);
+    void scheduleReadAhead();
 
     std::shared_ptr<base::TaskRunner> task_runner_;
     std::unique_ptr<FileDepacketizer> depacketizer_;
     std::unique_ptr<FilePacketizer> packetizer_;
+    std::unique_ptr<FileTreeEnumerator> tree_enumerator_;
+    std::unique_ptr<FileEnumerator> list_enumerator_;
+    bool read_ahead_scheduled_ = false;
 
     DISALLOW_COPY_AND_ASSIGN(Impl);
 };
@@ -76,11 +123,17 @@ void FileWorker::Impl::doTask(std::shared_ptr<FileTask> task)
     auto self = shared_from_this();
     task_runner_->postTask([self, task]()
     {
-        task->setReply(self->doRequest(task->request()));
+        base::ByteArray reply_data;
+        std::unique_ptr<proto::FileReply> reply =
+            self->doRequest(task->request(), task->requestData(), &reply_data);
+
+        task->setReply(std::move(reply), std::move(reply_data));
     });
 }
 
-std::unique_ptr<proto::FileReply> FileWorker::Impl::doRequest(const proto::FileRequest& request)
+std::unique_ptr<proto::FileReply> FileWorker::Impl::doRequest(const proto::FileRequest& request,
+                                                             const base::ByteArray& request_data,
+                                                             base::ByteArray* reply_data)
 {
 #if defined(OS_WIN)
     // We send a notification to the system that it is used to prevent the screen saver, going into
@@ -96,6 +149,10 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doRequest(const proto::FileR
     {
         return doFileListRequest(request.file_list_request());
     }
+    else if (request.has_file_tree_request())
+    {
+        return doFileTreeRequest(request.file_tree_request());
+    }
     else if (request.has_create_directory_request())
     {
         return doCreateDirectoryRequest(request.create_directory_request());
@@ -108,6 +165,10 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doRequest(const proto::FileR
     {
         return doRemoveRequest(request.remove_request());
     }
+    else if (request.has_remove_batch_request())
+    {
+        return doRemoveBatchRequest(request.remove_batch_request());
+    }
     else if (request.has_download_request())
     {
         return doDownloadRequest(request.download_request());
@@ -118,11 +179,19 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doRequest(const proto::FileR
     }
     else if (request.has_packet_request())
     {
-        return doPacketRequest(request.packet_request());
+        return doPacketRequest(request.packet_request(), reply_data);
     }
     else if (request.has_packet())
     {
-        return doPacket(request.packet());
+        return doPacket(request.packet(), request_data);
+    }
+    else if (request.has_read_batch_request())
+    {
+        return doReadBatchRequest(request.read_batch_request());
+    }
+    else if (request.has_write_batch_request())
+    {
+        return doWriteBatchRequest(request.write_batch_request());
     }
     else
     {
@@ -221,30 +290,59 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doFileListRequest(
     const proto::FileListRequest& request)
 {
     std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
+    std::unique_ptr<FileEnumerator> enumerator;
 
-    std::filesystem::path path = std::filesystem::u8path(request.path());
+    if (!request.next())
+    {
+        std::filesystem::path path = std::filesystem::u8path(request.path());
 
-    std::error_code ignored_code;
-    std::filesystem::file_status status = std::filesystem::status(path, ignored_code);
+        std::error_code ignored_code;
+        std::filesystem::file_status status = std::filesystem::status(path, ignored_code);
 
-    if (!std::filesystem::exists(status))
-    {
-        reply->set_error_code(proto::FILE_ERROR_PATH_NOT_FOUND);
-        return reply;
-    }
+        if (!std::filesystem::exists(status))
+        {
+            reply->set_error_code(proto::FILE_ERROR_PATH_NOT_FOUND);
+            return reply;
+        }
+
+        if (!std::filesystem::is_directory(status))
+        {
+            reply->set_error_code(proto::FILE_ERROR_INVALID_PATH_NAME);
+            return reply;
+        }
+
+        // A new paged listing cancels the previous one. Full listings do not affect it.
+        if (request.page_size())
+            list_enumerator_.reset();
 
-    if (!std::filesystem::is_directory(status))
+        enumerator = std::make_unique<FileEnumerator>(path);
+    }
+    else
     {
-        reply->set_error_code(proto::FILE_ERROR_INVALID_PATH_NAME);
-        return reply;
+        if (!list_enumerator_)
+        {
+            reply->set_error_code(proto::FILE_ERROR_INVALID_REQUEST);
+            return reply;
+        }
+
+        enumerator = std::move(list_enumerator_);
     }
 
     proto::FileList* file_list = reply->mutable_file_list();
-    FileEnumerator enumerator(path);
+    uint32_t count = 0;
 
-    while (!enumerator.isAtEnd())
+    while (!enumerator->isAtEnd())
     {
-        const FileEnumerator::FileInfo& file_info = enumerator.fileInfo();
+        if (request.page_size() && count >= request.page_size())
+        {
+            // The rest of the directory is returned by the next requests.
+            list_enumerator_ = std::move(enumerator);
+            file_list->set_has_more(true);
+            reply->set_error_code(proto::FILE_ERROR_SUCCESS);
+            return reply;
+        }
+
+        const FileEnumerator::FileInfo& file_info = enumerator->fileInfo();
 
         proto::FileList::Item* item = file_list->add_item();
         item->set_name(file_info.u8name());
@@ -252,10 +350,60 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doFileListRequest(
         item->set_modification_time(file_info.lastWriteTime());
         item->set_is_directory(file_info.isDirectory());
 
-        enumerator.advance();
+        ++count;
+        enumerator->advance();
+    }
+
+    reply->set_error_code(enumerator->errorCode());
+    return reply;
+}
+
+std::unique_ptr<proto::FileReply> FileWorker::Impl::doFileTreeRequest(
+    const proto::FileTreeRequest& request)
+{
+    std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
+    std::unique_ptr<FileEnumerator> enumerator;
+
+    if (!request.next())
+    {
+        std::filesystem::path path = std::filesystem::u8path(request.path());
+
+        std::error_code ignored_code;
+        std::filesystem::file_status status = std::filesystem::status(path, ignored_code);
+
+        if (!std::filesystem::exists(status))
+        {
+            reply->set_error_code(proto::FILE_ERROR_PATH_NOT_FOUND);
+            return reply;
+        }
+
+        if (!std::filesystem::is_directory(status))
+        {
+            reply->set_error_code(proto::FILE_ERROR_INVALID_PATH_NAME);
+            return reply;
+        }
+
+        tree_enumerator_ = std::make_unique<FileTreeEnumerator>(path);
+    }
+    else if (!tree_enumerator_)
+    {
+        reply->set_error_code(proto::FILE_ERROR_INVALID_REQUEST);
+        return reply;
+    }
+
+    proto::FileTree* file_tree = reply->mutable_file_tree();
+
+    if (tree_enumerator_->enumerate(kMaxFileTreeItems, file_tree))
+    {
+        file_tree->set_is_last(true);
+        reply->set_error_code(tree_enumerator_->errorCode());
+        tree_enumerator_.reset();
+    }
+    else
+    {
+        reply->set_error_code(proto::FILE_ERROR_SUCCESS);
     }
 
-    reply->set_error_code(enumerator.errorCode());
     return reply;
 }
 
@@ -337,34 +485,37 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doRemoveRequest(
     const proto::RemoveRequest& request)
 {
     std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
+    reply->set_error_code(removePath(std::filesystem::u8path(request.path())));
+    return reply;
+}
 
-    std::filesystem::path path = std::filesystem::u8path(request.path());
+std::unique_ptr<proto::FileReply> FileWorker::Impl::doRemoveBatchRequest(
+    const proto::RemoveBatchRequest& request)
+{
+    std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
 
-    std::error_code error_code;
-    if (!std::filesystem::exists(path, error_code))
+    if (request.path_size() > kMaxRemoveBatchCount)
     {
-        if (error_code)
-            reply->set_error_code(proto::FILE_ERROR_ACCESS_DENIED);
-        else
-            reply->set_error_code(proto::FILE_ERROR_PATH_NOT_FOUND);
-
+        reply->set_error_code(proto::FILE_ERROR_INVALID_REQUEST);
         return reply;
     }
 
-    std::error_code ignored_code;
-    std::filesystem::permissions(
-        path,
-        std::filesystem::perms::owner_all | std::filesystem::perms::group_all,
-        std::filesystem::perm_options::add,
-        ignored_code);
+    uint32_t processed_count = 0;
+    proto::FileError error_code = proto::FILE_ERROR_SUCCESS;
 
-    if (!std::filesystem::remove(path, ignored_code))
+    for (int i = 0; i < request.path_size(); ++i)
     {
-        reply->set_error_code(proto::FILE_ERROR_ACCESS_DENIED);
-        return reply;
+        error_code = removePath(std::filesystem::u8path(request.path(i)));
+
+        if (error_code != proto::FILE_ERROR_SUCCESS && !request.skip_errors())
+            break;
+
+        error_code = proto::FILE_ERROR_SUCCESS;
+        ++processed_count;
     }
 
-    reply->set_error_code(proto::FILE_ERROR_SUCCESS);
+    reply->set_processed_count(processed_count);
+    reply->set_error_code(error_code);
     return reply;
 }
 
@@ -401,13 +552,19 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doUploadRequest(
             }
         }
 
-        depacketizer_ = FileDepacketizer::create(file_path, request.overwrite());
+        proto::FileBlockList* block_list = nullptr;
+        if (request.delta())
+            block_list = reply->mutable_block_list();
+
+        depacketizer_ = FileDepacketizer::create(file_path, request.overwrite(), block_list);
         if (!depacketizer_)
         {
             reply->set_error_code(proto::FILE_ERROR_FILE_CREATE_ERROR);
             break;
         }
 
+        reply->set_packet_compression(true);
+        reply->set_packet_detached_data(true);
         reply->set_error_code(proto::FILE_ERROR_SUCCESS);
     }
     while (false);
@@ -416,7 +573,7 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doUploadRequest(
 }
 
 std::unique_ptr<proto::FileReply> FileWorker::Impl::doPacketRequest(
-    const proto::FilePacketRequest& request)
+    const proto::FilePacketRequest& request, base::ByteArray* reply_data)
 {
     std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
 
@@ -428,7 +585,7 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doPacketRequest(
     }
     else
     {
-        std::unique_ptr<proto::FilePacket> packet = packetizer_->readNextPacket(request);
+        std::unique_ptr<proto::FilePacket> packet = packetizer_->readNextPacket(request, reply_data);
         if (!packet)
         {
             reply->set_error_code(proto::FILE_ERROR_FILE_READ_ERROR);
@@ -438,6 +595,8 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doPacketRequest(
         {
             if (packet->flags() & proto::FilePacket::LAST_PACKET)
                 packetizer_.reset();
+            else
+                scheduleReadAhead();
 
             reply->set_error_code(proto::FILE_ERROR_SUCCESS);
             reply->set_allocated_packet(packet.release());
@@ -447,7 +606,124 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doPacketRequest(
     return reply;
 }
 
-std::unique_ptr<proto::FileReply> FileWorker::Impl::doPacket(const proto::FilePacket& packet)
+std::unique_ptr<proto::FileReply> FileWorker::Impl::doReadBatchRequest(
+    const proto::FileBatch& request)
+{
+    std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
+
+    if (request.entry_size() > kMaxFileBatchCount)
+    {
+        reply->set_error_code(proto::FILE_ERROR_INVALID_REQUEST);
+        return reply;
+    }
+
+    size_t left_size = kMaxFileBatchSize;
+
+    for (int i = 0; i < request.entry_size(); ++i)
+    {
+        const std::filesystem::path file_path =
+            std::filesystem::u8path(request.entry(i).path());
+
+        proto::FileBatchEntry* entry = reply->mutable_batch()->add_entry();
+        entry->set_path(request.entry(i).path());
+
+        std::error_code error_code;
+        const uintmax_t file_size = std::filesystem::file_size(file_path, error_code);
+        if (error_code)
+        {
+            entry->set_error_code(proto::FILE_ERROR_FILE_OPEN_ERROR);
+            continue;
+        }
+
+        // The file may have grown since the list of files was received. It is transferred
+        // separately then.
+        if (file_size > left_size)
+        {
+            entry->set_error_code(proto::FILE_ERROR_FILE_READ_ERROR);
+            continue;
+        }
+
+        if (!base::readFile(file_path, entry->mutable_data()) || entry->data().size() > left_size)
+        {
+            entry->clear_data();
+            entry->set_error_code(proto::FILE_ERROR_FILE_READ_ERROR);
+            continue;
+        }
+
+        left_size -= entry->data().size();
+        entry->set_error_code(proto::FILE_ERROR_SUCCESS);
+    }
+
+    reply->set_error_code(proto::FILE_ERROR_SUCCESS);
+    return reply;
+}
+
+std::unique_ptr<proto::FileReply> FileWorker::Impl::doWriteBatchRequest(
+    const proto::FileBatch& request)
+{
+    std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
+
+    if (request.entry_size() > kMaxFileBatchCount)
+    {
+        reply->set_error_code(proto::FILE_ERROR_INVALID_REQUEST);
+        return reply;
+    }
+
+    for (int i = 0; i < request.entry_size(); ++i)
+    {
+        const proto::FileBatchEntry& request_entry = request.entry(i);
+        const std::filesystem::path file_path = std::filesystem::u8path(request_entry.path());
+
+        proto::FileBatchEntry* entry = reply->mutable_batch()->add_entry();
+        entry->set_path(request_entry.path());
+
+        std::error_code ignored_code;
+        const bool exists = std::filesystem::exists(file_path, ignored_code);
+
+        if (exists && !request_entry.overwrite())
+        {
+            entry->set_error_code(proto::FILE_ERROR_PATH_ALREADY_EXISTS);
+            continue;
+        }
+
+        if (!base::writeFile(file_path, request_entry.data()))
+        {
+            // The file is transferred separately after the error. An incomplete new file would
+            // be reported as an existing one.
+            if (!exists)
+                std::filesystem::remove(file_path, ignored_code);
+
+            entry->set_error_code(proto::FILE_ERROR_FILE_WRITE_ERROR);
+            continue;
+        }
+
+        entry->set_error_code(proto::FILE_ERROR_SUCCESS);
+    }
+
+    reply->set_error_code(proto::FILE_ERROR_SUCCESS);
+    return reply;
+}
+
+void FileWorker::Impl::scheduleReadAhead()
+{
+    if (read_ahead_scheduled_)
+        return;
+
+    read_ahead_scheduled_ = true;
+
+    // The task is executed after the requests that are already queued.
+    auto self = shared_from_this();
+    task_runner_->postTask([self]()
+    {
+        self->read_ahead_scheduled_ = false;
+
+        if (self->packetizer_)
+            self->packetizer_->readAhead();
+    });
+}
+
+std::unique_ptr<proto::FileReply> FileWorker::Impl::doPacket(
+    const proto::FilePacket& packet, const base::ByteArray& request_data)
 {
     std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
 
@@ -459,7 +735,7 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doPacket(const proto::FilePa
     }
     else
     {
-        if (!depacketizer_->writeNextPacket(packet))
+        if (!depacketizer_->writeNextPacket(packet, request_data))
         {
             reply->set_error_code(proto::FILE_ERROR_FILE_WRITE_ERROR);
             depacketizer_.reset();
@@ -20,10 +20,107 @@
 
 #include "base/environment.h"
 #include "base/logging.h"
+#include "base/crypto/generic_hash.h"
 #include "base/net/curl_util.h"
 
+#include <algorithm>
+#include <cstring>
+
 namespace common {
 
+namespace {
+
+// How many times an interrupted download is resumed from the same URL.
+const int kMaxResumeAttempts = 5;
+
+// Files smaller than two such ranges are downloaded over one connection.
+const int64_t kMinParallelRangeSize = 1024 * 1024;
+const size_t kMaxParallelConnections = 8;
+
+// Size of the blocks in which the downloaded file is read to calculate its hash.
+const size_t kHashBlockSize = 64 * 1024;
+
+bool isResumableError(int error_code)
+{
+    switch (error_code)
+    {
+        case CURLE_COULDNT_CONNECT:
+        case CURLE_PARTIAL_FILE:
+        case CURLE_OPERATION_TIMEDOUT:
+        case CURLE_RANGE_ERROR:
+        case CURLE_GOT_NOTHING:
+        case CURLE_SEND_ERROR:
+        case CURLE_RECV_ERROR:
+        case CURLE_HTTP2_STREAM:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+void setCommonOptions(CURL* curl, const std::string& url)
+{
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 15);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1);
+    curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1);
+
+    long verify_peer = 1;
+    if (base::Environment::has("ASPIA_NO_VERIFY_TLS_PEER"))
+        verify_peer = 0;
+
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, verify_peer);
+
+    // A stalled transfer is aborted to be resumed over a new connection.
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, 60L);
+}
+
+// Returns the size of the file or -1 if the server does not report it.
+int64_t contentLength(const std::string& url)
+{
+    base::ScopedCURL curl;
+
+    setCommonOptions(curl.get(), url);
+    curl_easy_setopt(curl.get(), CURLOPT_NOBODY, 1);
+    curl_easy_setopt(curl.get(), CURLOPT_TIMEOUT, 30L);
+
+    if (curl_easy_perform(curl.get()) != CURLE_OK)
+        return -1;
+
+    curl_off_t length = -1;
+    curl_easy_getinfo(curl.get(), CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+    return length;
+}
+
+} // namespace
+
+struct HttpFileDownloader::Range
+{
+    explicit Range(HttpFileDownloader* self)
+        : self(self)
+    {
+        // Nothing
+    }
+
+    int64_t position() const { return begin + received; }
+    bool isCompleted() const { return end >= 0 && position() >= end; }
+
+    HttpFileDownloader* self;
+    CURL* curl = nullptr;
+
+    int64_t begin = 0;
+    int64_t end = -1; // Exclusive. -1 means up to the end of the file.
+    int64_t received = 0;
+
+    // The range is requested with the "Range" header and the server must reply with 206.
+    bool partial = false;
+
+    bool is_started = false;
+    bool is_range_error = false;
+};
+
 class HttpFileDownloader::Runner : public std::enable_shared_from_this<Runner>
 {
 public:
@@ -111,6 +208,26 @@ HttpFileDownloader::~HttpFileDownloader()
     thread_.stop();
 }
 
+void HttpFileDownloader::setMirrorUrl(std::string_view url)
+{
+    mirror_url_ = url;
+}
+
+void HttpFileDownloader::setExpectedHash(const base::ByteArray& sha256)
+{
+    expected_hash_ = sha256;
+}
+
+void HttpFileDownloader::setOutputFile(const std::filesystem::path& path)
+{
+    file_path_ = path;
+}
+
+void HttpFileDownloader::setParallelConnections(size_t count)
+{
+    parallel_connections_ = std::clamp(count, size_t(1), kMaxParallelConnections);
+}
+
 void HttpFileDownloader::start(std::string_view url,
                                std::shared_ptr<base::TaskRunner> owner_task_runner,
                                Delegate* delegate)
@@ -122,27 +239,175 @@ void HttpFileDownloader::start(std::string_view url,
 
 void HttpFileDownloader::run()
 {
-    base::ScopedCURL curl;
+    int error_code = CURLE_OK;
+    bool succeeded = false;
 
-    curl_easy_setopt(curl.get(), CURLOPT_URL, url_.c_str());
-    curl_easy_setopt(curl.get(), CURLOPT_NOPROGRESS, 0);
-    curl_easy_setopt(curl.get(), CURLOPT_MAXREDIRS, 15);
-    curl_easy_setopt(curl.get(), CURLOPT_FOLLOWLOCATION, 1);
+    if (!mirror_url_.empty())
+    {
+        succeeded = download(mirror_url_, &error_code);
+        if (!succeeded && !thread_.isStopping())
+            LOG(LS_INFO) << "Unable to download from mirror. Falling back to " << url_;
+    }
 
-    long verify_peer = 1;
-    if (base::Environment::has("ASPIA_NO_VERIFY_TLS_PEER"))
-        verify_peer = 0;
+    if (!succeeded && !thread_.isStopping())
+        succeeded = download(url_, &error_code);
+
+    if (file_.is_open())
+        file_.close();
+
+    if (!succeeded && !file_path_.empty())
+    {
+        std::error_code ignored_code;
+        std::filesystem::remove(file_path_, ignored_code);
+    }
+
+    if (thread_.isStopping())
+        return;
 
-    curl_easy_setopt(curl.get(), CURLOPT_SSL_VERIFYPEER, verify_peer);
-    curl_easy_setopt(curl.get(), CURLOPT_WRITEFUNCTION, writeDataCallback);
-    curl_easy_setopt(curl.get(), CURLOPT_WRITEDATA, this);
-    curl_easy_setopt(curl.get(), CURLOPT_XFERINFOFUNCTION, progressCallback);
-    curl_easy_setopt(curl.get(), CURLOPT_XFERINFODATA, this);
+    if (!succeeded)
+    {
+        if (runner_)
+            runner_->onError(error_code);
+    }
+    else
+    {
+        LOG(LS_INFO) << "Download is finished";
+        if (runner_)
+            runner_->onCompleted();
+    }
+}
 
+bool HttpFileDownloader::download(const std::string& url, int* error_code)
+{
+    std::vector<Range> ranges = splitRanges(url);
+    if (thread_.isStopping())
+        return false;
+
+    if (!resetOutput())
+    {
+        *error_code = CURLE_WRITE_ERROR;
+        return false;
+    }
+
+    for (int attempt = 0; attempt <= kMaxResumeAttempts; ++attempt)
+    {
+        if (attempt != 0)
+        {
+            if (*error_code == CURLE_RANGE_ERROR)
+            {
+                // The server does not support ranges. The download starts over.
+                LOG(LS_INFO) << "Unable to resume download. Starting over";
+
+                ranges = { Range(this) };
+                if (!resetOutput())
+                {
+                    *error_code = CURLE_WRITE_ERROR;
+                    return false;
+                }
+            }
+            else
+            {
+                LOG(LS_INFO) << "Resuming download (attempt " << attempt << ")";
+            }
+        }
+
+        *error_code = transfer(url, &ranges);
+        if (thread_.isStopping())
+            return false;
+
+        if (*error_code == CURLE_OK)
+            break;
+
+        LOG(LS_WARNING) << "Download of '" << url << "' failed: "
+                        << curl_easy_strerror(static_cast<CURLcode>(*error_code));
+
+        if (!isResumableError(*error_code))
+            return false;
+    }
+
+    if (*error_code != CURLE_OK)
+        return false;
+
+    if (!verifyOutput())
+    {
+        LOG(LS_WARNING) << "Hash of the downloaded data does not match (url: " << url << ")";
+        data_.clear();
+        *error_code = kHashMismatchError;
+        return false;
+    }
+
+    return true;
+}
+
+std::vector<HttpFileDownloader::Range> HttpFileDownloader::splitRanges(const std::string& url)
+{
+    total_size_ = -1;
+    last_percentage_ = -1;
+
+    if (parallel_connections_ > 1)
+        total_size_ = contentLength(url);
+
+    const int64_t count = std::min(static_cast<int64_t>(parallel_connections_),
+                                   total_size_ / kMinParallelRangeSize);
+    if (count <= 1)
+        return { Range(this) };
+
+    LOG(LS_INFO) << "Downloading " << total_size_ << " bytes over " << count << " connections";
+
+    const int64_t step = total_size_ / count;
+
+    std::vector<Range> ranges;
+    for (int64_t i = 0; i < count; ++i)
+    {
+        Range range(this);
+        range.begin = i * step;
+        range.end = (i == count - 1) ? total_size_ : range.begin + step;
+        range.partial = true;
+        ranges.emplace_back(range);
+    }
+
+    return ranges;
+}
+
+int HttpFileDownloader::transfer(const std::string& url, std::vector<Range>* ranges)
+{
     base::ScopedCURLM multi_curl;
-    curl_multi_add_handle(multi_curl.get(), curl.get());
+    std::vector<std::unique_ptr<base::ScopedCURL>> handles;
+
+    for (Range& range : *ranges)
+    {
+        if (range.isCompleted())
+            continue;
+
+        std::unique_ptr<base::ScopedCURL> curl = std::make_unique<base::ScopedCURL>();
+        setCommonOptions(curl->get(), url);
+
+        if (range.partial)
+        {
+            std::string value =
+                std::to_string(range.position()) + '-' + std::to_string(range.end - 1);
+            curl_easy_setopt(curl->get(), CURLOPT_RANGE, value.c_str());
+        }
+        else
+        {
+            curl_easy_setopt(curl->get(), CURLOPT_RESUME_FROM_LARGE,
+                             static_cast<curl_off_t>(range.position()));
+        }
+
+        curl_easy_setopt(curl->get(), CURLOPT_WRITEFUNCTION, writeDataCallback);
+        curl_easy_setopt(curl->get(), CURLOPT_WRITEDATA, &range);
+        curl_easy_setopt(curl->get(), CURLOPT_PRIVATE, &range);
+
+        range.curl = curl->get();
+        range.is_started = false;
+        range.is_range_error = false;
+
+        curl_multi_add_handle(multi_curl.get(), curl->get());
+        handles.emplace_back(std::move(curl));
+    }
 
     CURLMcode error_code = CURLM_OK;
+    CURLcode result = CURLE_OK;
     int still_running = 1;
 
     do
@@ -165,63 +430,180 @@ void HttpFileDownloader::run()
             LOG(LS_INFO) << "Downloading canceled";
             break;
         }
+
+        reportProgress(*ranges);
     }
     while (still_running);
 
-    curl_multi_remove_handle(multi_curl.get(), curl.get());
-
-    if (!thread_.isStopping())
+    if (error_code != CURLM_OK)
     {
-        if (error_code != CURLM_OK)
-        {
-            if (runner_)
-                runner_->onError(error_code);
-        }
-        else
+        result = CURLE_FAILED_INIT;
+    }
+    else
+    {
+        int messages_in_queue = 0;
+        while (CURLMsg* message = curl_multi_info_read(multi_curl.get(), &messages_in_queue))
         {
-            LOG(LS_INFO) << "Download is finished: " << data_.size() << " bytes";
-            if (runner_)
-                runner_->onCompleted();
+            if (message->msg != CURLMSG_DONE || message->data.result == CURLE_OK)
+                continue;
+
+            Range* range = nullptr;
+            curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, &range);
+
+            if (range && range->is_range_error)
+                result = CURLE_RANGE_ERROR;
+            else if (result == CURLE_OK)
+                result = message->data.result;
         }
     }
+
+    for (const auto& curl : handles)
+        curl_multi_remove_handle(multi_curl.get(), curl->get());
+
+    for (Range& range : *ranges)
+        range.curl = nullptr;
+
+    return result;
 }
 
-// static
-size_t HttpFileDownloader::writeDataCallback(
-    void* ptr, size_t size, size_t nmemb, HttpFileDownloader* self)
+bool HttpFileDownloader::resetOutput()
 {
-    size_t result = 0;
+    data_.clear();
+
+    if (file_path_.empty())
+        return true;
 
-    if (self)
+    if (file_.is_open())
+        file_.close();
+
+    file_.open(file_path_, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+    if (!file_.is_open())
     {
-        if (self->thread_.isStopping())
-        {
-            LOG(LS_INFO) << "Interrupted by user";
-            return 0;
-        }
+        LOG(LS_WARNING) << "Unable to open file '" << file_path_ << "'";
+        return false;
+    }
+
+    return true;
+}
 
-        result = size * nmemb;
-        base::append(&self->data_, ptr, result);
+bool HttpFileDownloader::writeOutput(int64_t offset, const void* data, size_t size)
+{
+    if (file_path_.empty())
+    {
+        const size_t end = static_cast<size_t>(offset) + size;
+        if (data_.size() < end)
+            data_.resize(end);
+
+        memcpy(data_.data() + offset, data, size);
+        return true;
     }
 
-    return result;
+    file_.seekp(offset);
+    file_.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+
+    if (!file_.good())
+    {
+        LOG(LS_WARNING) << "Unable to write file '" << file_path_ << "'";
+        return false;
+    }
+
+    return true;
+}
+
+bool HttpFileDownloader::verifyOutput()
+{
+    if (expected_hash_.empty())
+        return true;
+
+    if (file_path_.empty())
+        return base::GenericHash::hash(base::GenericHash::SHA256, data_) == expected_hash_;
+
+    base::GenericHash hash(base::GenericHash::SHA256);
+    base::ByteArray block(kHashBlockSize);
+
+    file_.flush();
+    file_.seekg(0);
+
+    while (file_)
+    {
+        file_.read(reinterpret_cast<char*>(block.data()),
+                   static_cast<std::streamsize>(block.size()));
+        if (file_.gcount() > 0)
+            hash.addData(block.data(), static_cast<size_t>(file_.gcount()));
+    }
+
+    file_.clear();
+    return hash.result() == expected_hash_;
+}
+
+void HttpFileDownloader::reportProgress(const std::vector<Range>& ranges)
+{
+    if (total_size_ <= 0 || !runner_)
+        return;
+
+    int64_t received = 0;
+    for (const Range& range : ranges)
+        received += range.received;
+
+    const int percentage = static_cast<int>(std::min(received * 100 / total_size_, int64_t(100)));
+    if (percentage == last_percentage_)
+        return;
+
+    last_percentage_ = percentage;
+    runner_->onProgress(percentage);
 }
 
 // static
-int HttpFileDownloader::progressCallback(
-    HttpFileDownloader* self, double dltotal, double dlnow, double /* ultotal */, double /* ulnow */)
+size_t HttpFileDownloader::writeDataCallback(void* ptr, size_t size, size_t nmemb, Range* range)
 {
-    if (self && !self->thread_.isStopping())
+    if (!range || !range->self)
+        return 0;
+
+    HttpFileDownloader* self = range->self;
+    if (self->thread_.isStopping())
+    {
+        LOG(LS_INFO) << "Interrupted by user";
+        return 0;
+    }
+
+    if (!range->is_started)
     {
-        int percentage = 0;
-        if (dltotal > 0)
-            percentage = static_cast<int>((dlnow * 100) / dltotal);
+        range->is_started = true;
 
-        if (self->runner_)
-            self->runner_->onProgress(percentage);
+        if (range->partial)
+        {
+            long response_code = 0;
+            curl_easy_getinfo(range->curl, CURLINFO_RESPONSE_CODE, &response_code);
+
+            // The server sent the whole file instead of the requested range.
+            if (response_code != 206)
+            {
+                range->is_range_error = true;
+                return 0;
+            }
+        }
+        else if (self->total_size_ < 0)
+        {
+            curl_off_t length = -1;
+            curl_easy_getinfo(range->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+            if (length >= 0)
+                self->total_size_ = range->position() + length;
+        }
+    }
+
+    const size_t result = size * nmemb;
+
+    if (range->end >= 0 && range->position() + static_cast<int64_t>(result) > range->end)
+    {
+        range->is_range_error = true;
+        return 0;
     }
 
-    return 0;
+    if (!self->writeOutput(range->position(), ptr, result))
+        return 0;
+
+    range->received += static_cast<int64_t>(result);
+    return result;
 }
 
 } // namespace common
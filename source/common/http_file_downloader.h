@@ -24,6 +24,9 @@
 #include "base/memory/byte_array.h"
 #include "base/threading/simple_thread.h"
 
+#include <filesystem>
+#include <fstream>
+
 namespace common {
 
 class HttpFileDownloader
@@ -42,17 +45,42 @@ public:
         virtual void onFileDownloaderProgress(int percentage) = 0;
     };
 
+    // Error code reported when the downloaded data does not match the expected hash.
+    static const int kHashMismatchError = -1;
+
+    // The file is first downloaded from the mirror (for example, a caching server of the site).
+    // If the mirror fails or returns corrupted data, the file is downloaded from the main URL.
+    void setMirrorUrl(std::string_view url);
+
+    // If set, the downloaded data must have the given SHA-256 hash.
+    void setExpectedHash(const base::ByteArray& sha256);
+
+    // The data is written to the file instead of memory and data() stays empty. The file is
+    // removed if the download fails.
+    void setOutputFile(const std::filesystem::path& path);
+
+    // If the server supports ranges, a large file is downloaded over |count| connections at once.
+    void setParallelConnections(size_t count);
+
     void start(std::string_view url,
                std::shared_ptr<base::TaskRunner> owner_task_runner,
                Delegate* delegate);
     const base::ByteArray& data() const { return data_; }
 
 private:
+    struct Range;
+
     void run();
+    bool download(const std::string& url, int* error_code);
+    std::vector<Range> splitRanges(const std::string& url);
+    int transfer(const std::string& url, std::vector<Range>* ranges);
+
+    bool resetOutput();
+    bool writeOutput(int64_t offset, const void* data, size_t size);
+    bool verifyOutput();
+    void reportProgress(const std::vector<Range>& ranges);
 
-    static size_t writeDataCallback(void* ptr, size_t size, size_t nmemb, HttpFileDownloader* self);
-    static int progressCallback(
-        HttpFileDownloader* self, double dltotal, double dlnow, double ultotal, double ulnow);
+    static size_t writeDataCallback(void* ptr, size_t size, size_t nmemb, Range* range);
 
     base::SimpleThread thread_;
 
@@ -60,7 +88,17 @@ private:
     std::shared_ptr<Runner> runner_;
 
     std::string url_;
+    std::string mirror_url_;
+    base::ByteArray expected_hash_;
+    std::filesystem::path file_path_;
+    size_t parallel_connections_ = 1;
+
     base::ByteArray data_;
+    std::fstream file_;
+
+    // Size of the file or -1 if it is not known yet.
+    int64_t total_size_ = -1;
+    int last_percentage_ = -1;
 
     DISALLOW_COPY_AND_ASSIGN(HttpFileDownloader);
 };
@@ -21,6 +21,8 @@
 
 #include <QKeyEvent>
 
+#include <array>
+
 namespace common {
 
 namespace {
@@ -36,12 +38,76 @@ namespace {
 #else
 #define USB_KEYMAP(usb, evdev, xkb, win, mac, qt) {usb, 0, qt}
 #endif
-#define USB_KEYMAP_DECLARATION const KeycodeMapEntry usb_keycode_map[] =
+#define USB_KEYMAP_DECLARATION constexpr KeycodeMapEntry usb_keycode_map[] =
 #include "common/keycode_converter_data.inc"
 #undef USB_KEYMAP
 #undef USB_KEYMAP_DECLARATION
 
-const size_t kKeycodeMapEntries = std::size(usb_keycode_map);
+constexpr size_t kKeycodeMapEntries = std::size(usb_keycode_map);
+
+// The lookup tables are open addressing hash tables with the indexes of the entries of the map.
+// They are built at compile time. The size is a power of two and more than twice the number of
+// entries, so that the probe sequences stay short.
+constexpr int kLookupTableBits = 9;
+constexpr size_t kLookupTableSize = size_t(1) << kLookupTableBits;
+constexpr uint16_t kEmptySlot = 0xFFFF;
+
+static_assert(kKeycodeMapEntries * 2 <= kLookupTableSize);
+
+using LookupTable = std::array<uint16_t, kLookupTableSize>;
+
+constexpr size_t lookupSlot(uint32_t key)
+{
+    // Fibonacci hashing: the upper bits of the product are well mixed.
+    return static_cast<size_t>((key * 0x9E3779B1U) >> (32 - kLookupTableBits));
+}
+
+constexpr size_t nextSlot(size_t slot)
+{
+    return (slot + 1) & (kLookupTableSize - 1);
+}
+
+template <typename T>
+constexpr LookupTable makeLookupTable(T KeycodeMapEntry::* field)
+{
+    LookupTable table = {};
+
+    for (size_t i = 0; i < table.size(); ++i)
+        table[i] = kEmptySlot;
+
+    for (size_t i = 0; i < kKeycodeMapEntries; ++i)
+    {
+        const T key = usb_keycode_map[i].*field;
+        size_t slot = lookupSlot(static_cast<uint32_t>(key));
+
+        while (table[slot] != kEmptySlot && usb_keycode_map[table[slot]].*field != key)
+            slot = nextSlot(slot);
+
+        // As with a linear search of the map, the first entry with the key is found.
+        if (table[slot] == kEmptySlot)
+            table[slot] = static_cast<uint16_t>(i);
+    }
+
+    return table;
+}
+
+constexpr LookupTable kUsbLookupTable = makeLookupTable(&KeycodeMapEntry::usb_keycode);
+constexpr LookupTable kNativeLookupTable = makeLookupTable(&KeycodeMapEntry::native_keycode);
+constexpr LookupTable kQtLookupTable = makeLookupTable(&KeycodeMapEntry::qt_keycode);
+
+template <typename T>
+const KeycodeMapEntry* findEntry(const LookupTable& table, T KeycodeMapEntry::* field, T key)
+{
+    for (size_t slot = lookupSlot(static_cast<uint32_t>(key)); table[slot] != kEmptySlot;
+         slot = nextSlot(slot))
+    {
+        const KeycodeMapEntry& entry = usb_keycode_map[table[slot]];
+        if (entry.*field == key)
+            return &entry;
+    }
+
+    return nullptr;
+}
 
 } // namespace
 
@@ -74,11 +140,10 @@ int KeycodeConverter::usbKeycodeToNativeKeycode(uint32_t usb_keycode)
         usb_keycode = 0x070068; // F13.
 #endif
 
-    for (size_t i = 0; i < kKeycodeMapEntries; ++i)
-    {
-        if (usb_keycode_map[i].usb_keycode == usb_keycode)
-            return usb_keycode_map[i].native_keycode;
-    }
+    const KeycodeMapEntry* entry =
+        findEntry(kUsbLookupTable, &KeycodeMapEntry::usb_keycode, usb_keycode);
+    if (entry)
+        return entry->native_keycode;
 
     return invalidNativeKeycode();
 }
@@ -86,11 +151,10 @@ int KeycodeConverter::usbKeycodeToNativeKeycode(uint32_t usb_keycode)
 // static
 uint32_t KeycodeConverter::nativeKeycodeToUsbKeycode(int native_keycode)
 {
-    for (size_t i = 0; i < kKeycodeMapEntries; ++i)
-    {
-        if (usb_keycode_map[i].native_keycode == native_keycode)
-            return usb_keycode_map[i].usb_keycode;
-    }
+    const KeycodeMapEntry* entry =
+        findEntry(kNativeLookupTable, &KeycodeMapEntry::native_keycode, native_keycode);
+    if (entry)
+        return entry->usb_keycode;
 
     return invalidUsbKeycode();
 }
@@ -98,11 +162,10 @@ uint32_t KeycodeConverter::nativeKeycodeToUsbKeycode(int native_keycode)
 // static
 uint32_t KeycodeConverter::qtKeycodeToUsbKeycode(int qt_keycode)
 {
-    for (size_t i = 0; i < kKeycodeMapEntries; ++i)
-    {
-        if (usb_keycode_map[i].qt_keycode == qt_keycode)
-            return usb_keycode_map[i].usb_keycode;
-    }
+    const KeycodeMapEntry* entry =
+        findEntry(kQtLookupTable, &KeycodeMapEntry::qt_keycode, qt_keycode);
+    if (entry)
+        return entry->usb_keycode;
 
     return invalidUsbKeycode();
 }
@@ -0,0 +1,94 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "common/mouse_event_coalescer.h"
+
+#include "base/logging.h"
+
+namespace common {
+
+namespace {
+
+const uint32_t kWheelMask = proto::MouseEvent::WHEEL_DOWN | proto::MouseEvent::WHEEL_UP;
+
+} // namespace
+
+MouseEventCoalescer::MouseEventCoalescer(std::shared_ptr<base::TaskRunner> task_runner,
+                                         const std::chrono::milliseconds& interval,
+                                         Callback callback)
+    : interval_(interval),
+      callback_(std::move(callback)),
+      timer_(base::WaitableTimer::Type::SINGLE_SHOT, std::move(task_runner))
+{
+    DCHECK(callback_);
+    pending_events_.reserve(2);
+}
+
+MouseEventCoalescer::~MouseEventCoalescer() = default;
+
+void MouseEventCoalescer::addEvent(const proto::MouseEvent& event)
+{
+    // A move does not change the buttons and does not turn the wheel.
+    const bool is_move = !(event.mask() & kWheelMask) && event.mask() == last_mask_;
+    last_mask_ = event.mask() & ~kWheelMask;
+
+    if (!is_move)
+    {
+        pending_events_.emplace_back(event);
+        flush();
+        return;
+    }
+
+    if (!pending_events_.empty())
+    {
+        // Only a move can wait. The new position replaces it.
+        pending_events_.back() = event;
+        ++coalesced_count_;
+        return;
+    }
+
+    pending_events_.emplace_back(event);
+
+    const Clock::duration elapsed = Clock::now() - last_delivery_time_;
+    if (elapsed >= interval_)
+    {
+        deliver();
+        return;
+    }
+
+    timer_.start(std::chrono::duration_cast<std::chrono::milliseconds>(interval_ - elapsed),
+                 std::bind(&MouseEventCoalescer::deliver, this));
+}
+
+void MouseEventCoalescer::flush()
+{
+    timer_.stop();
+    deliver();
+}
+
+void MouseEventCoalescer::deliver()
+{
+    if (pending_events_.empty())
+        return;
+
+    last_delivery_time_ = Clock::now();
+
+    callback_(pending_events_);
+    pending_events_.clear();
+}
+
+} // namespace common
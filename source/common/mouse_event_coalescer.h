@@ -0,0 +1,72 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef COMMON_MOUSE_EVENT_COALESCER_H
+#define COMMON_MOUSE_EVENT_COALESCER_H
+
+#include "base/macros_magic.h"
+#include "base/waitable_timer.h"
+#include "proto/desktop.pb.h"
+
+#include <chrono>
+#include <functional>
+#include <vector>
+
+namespace common {
+
+// Limits the rate of mouse moves. A move that comes less than |interval| after the previous
+// delivery waits for the end of the interval and is replaced by the next move. Button and wheel
+// events are delivered at once together with the waiting move, so the order of the events is
+// kept.
+class MouseEventCoalescer
+{
+public:
+    using Callback = std::function<void(const std::vector<proto::MouseEvent>& events)>;
+
+    MouseEventCoalescer(std::shared_ptr<base::TaskRunner> task_runner,
+                        const std::chrono::milliseconds& interval,
+                        Callback callback);
+    ~MouseEventCoalescer();
+
+    void addEvent(const proto::MouseEvent& event);
+
+    // Delivers the waiting move.
+    void flush();
+
+    int coalescedCount() const { return coalesced_count_; }
+
+private:
+    void deliver();
+
+    using Clock = std::chrono::steady_clock;
+
+    const std::chrono::milliseconds interval_;
+    Callback callback_;
+    base::WaitableTimer timer_;
+
+    // Holds at most one move followed by at most one other event.
+    std::vector<proto::MouseEvent> pending_events_;
+    uint32_t last_mask_ = 0;
+    Clock::time_point last_delivery_time_;
+    int coalesced_count_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(MouseEventCoalescer);
+};
+
+} // namespace common
+
+#endif // COMMON_MOUSE_EVENT_COALESCER_H
@@ -0,0 +1,105 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "common/text_chat_batcher.h"
+
+#include "base/logging.h"
+
+namespace common {
+
+namespace {
+
+const int kMaxBatchSize = 64;
+
+bool isTypingStatus(const proto::TextChat& text_chat)
+{
+    return text_chat.has_chat_status() &&
+           text_chat.chat_status().status() == proto::TextChatStatus::STATUS_TYPING;
+}
+
+} // namespace
+
+TextChatBatcher::TextChatBatcher() = default;
+
+TextChatBatcher::~TextChatBatcher() = default;
+
+bool TextChatBatcher::add(const proto::TextChat& text_chat, proto::TextChat* message)
+{
+    DCHECK(message);
+
+    if (!is_writing_)
+    {
+        is_writing_ = true;
+        message->CopyFrom(text_chat);
+        return true;
+    }
+
+    if (isTypingStatus(text_chat))
+    {
+        for (int i = 0; i < batch_.batch_size(); ++i)
+        {
+            proto::TextChat* item = batch_.mutable_batch(i);
+
+            if (isTypingStatus(*item) &&
+                item->chat_status().source() == text_chat.chat_status().source())
+            {
+                item->CopyFrom(text_chat);
+                return false;
+            }
+        }
+    }
+
+    batch_.add_batch()->CopyFrom(text_chat);
+
+    if (batch_.batch_size() < kMaxBatchSize)
+        return false;
+
+    message->Swap(&batch_);
+    batch_.Clear();
+    return true;
+}
+
+bool TextChatBatcher::takeBatch(proto::TextChat* message)
+{
+    DCHECK(message);
+
+    if (!batch_.batch_size())
+    {
+        is_writing_ = false;
+        return false;
+    }
+
+    message->Swap(&batch_);
+    batch_.Clear();
+    return true;
+}
+
+// static
+void TextChatBatcher::unpack(const proto::TextChat& text_chat,
+                             const std::function<void(const proto::TextChat& item)>& callback)
+{
+    if (!text_chat.batch_size())
+    {
+        callback(text_chat);
+        return;
+    }
+
+    for (int i = 0; i < text_chat.batch_size(); ++i)
+        callback(text_chat.batch(i));
+}
+
+} // namespace common
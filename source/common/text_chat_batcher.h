@@ -0,0 +1,58 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef COMMON_TEXT_CHAT_BATCHER_H
+#define COMMON_TEXT_CHAT_BATCHER_H
+
+#include "base/macros_magic.h"
+#include "proto/text_chat.pb.h"
+
+#include <functional>
+
+namespace common {
+
+// Collects the text chat messages that come while the previous message is being written and
+// sends them as one batch when the write is finished. A typing status replaces the previous
+// typing status of the same user in the batch.
+class TextChatBatcher
+{
+public:
+    TextChatBatcher();
+    ~TextChatBatcher();
+
+    // Returns true if |message| must be sent at once. It contains either |text_chat| or the
+    // collected batch if the batch is full.
+    bool add(const proto::TextChat& text_chat, proto::TextChat* message);
+
+    // Must be called when the write is finished. Returns true if |message| contains the collected
+    // batch to send.
+    bool takeBatch(proto::TextChat* message);
+
+    // Calls |callback| for each status or message in |text_chat|.
+    static void unpack(const proto::TextChat& text_chat,
+                       const std::function<void(const proto::TextChat& item)>& callback);
+
+private:
+    proto::TextChat batch_;
+    bool is_writing_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(TextChatBatcher);
+};
+
+} // namespace common
+
+#endif // COMMON_TEXT_CHAT_BATCHER_H
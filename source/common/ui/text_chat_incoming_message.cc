@@ -54,6 +54,11 @@ QString TextChatIncomingMessage::messageText() const
     return ui.label_message->text();
 }
 
+void TextChatIncomingMessage::setMessageTime(const QString& time)
+{
+    ui.label_time->setText(time);
+}
+
 QString TextChatIncomingMessage::messageTime() const
 {
     return ui.label_time->text();
@@ -37,6 +37,7 @@ public:
 
     void setMessageText(const QString& text) override;
     QString messageText() const override;
+    void setMessageTime(const QString& time) override;
     QString messageTime() const override;
 
 private:
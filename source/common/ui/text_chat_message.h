@@ -49,6 +49,7 @@ public:
 
     virtual void setMessageText(const QString& text) = 0;
     virtual QString messageText() const = 0;
+    virtual void setMessageTime(const QString& time) = 0;
     virtual QString messageTime() const = 0;
 
 private:
@@ -45,6 +45,11 @@ QString TextChatOutgoingMessage::messageText() const
     return ui.label_message->text();
 }
 
+void TextChatOutgoingMessage::setMessageTime(const QString& time)
+{
+    ui.label_time->setText(time);
+}
+
 QString TextChatOutgoingMessage::messageTime() const
 {
     return ui.label_time->text();
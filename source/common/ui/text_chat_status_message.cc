@@ -41,6 +41,11 @@ QString TextChatStatusMessage::messageText() const
     return ui.label_message->text();
 }
 
+void TextChatStatusMessage::setMessageTime(const QString& /* time */)
+{
+    // Nothing
+}
+
 QString TextChatStatusMessage::messageTime() const
 {
     return QString();
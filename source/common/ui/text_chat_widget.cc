@@ -40,13 +40,26 @@ namespace {
 
 const int kMaxMessageLength = 2048;
 
+// Maximum number of messages in the list. Older messages are moved to the history.
+const int kMaxListMessages = 200;
+
+// Maximum number of messages in the history. The oldest messages are deleted.
+const size_t kMaxHistoryMessages = 5000;
+
+// Number of messages returned from the history to the list at a time.
+const int kHistoryPageSize = 50;
+
+// The typing status is sent to the peer at most once in this interval.
+const std::chrono::seconds kTypingStatusInterval { 3 };
+
 } // namespace
 
 TextChatWidget::TextChatWidget(QWidget* parent)
     : QWidget(parent),
       ui(std::make_unique<Ui::TextChatWidget>()),
       host_name_(QHostInfo::localHostName().toStdString()),
-      status_clear_timer_(new QTimer(this))
+      status_clear_timer_(new QTimer(this)),
+      scroll_timer_(new QTimer(this))
 {
     LOG(LS_INFO) << "Ctor";
     ui->setupUi(this);
@@ -54,7 +67,16 @@ TextChatWidget::TextChatWidget(QWidget* parent)
     ui->list_messages->horizontalScrollBar()->installEventFilter(this);
     ui->list_messages->verticalScrollBar()->installEventFilter(this);
 
+    scroll_timer_->setSingleShot(true);
+
     connect(status_clear_timer_, &QTimer::timeout, ui->label_status, &QLabel::clear);
+    connect(scroll_timer_, &QTimer::timeout, this, &TextChatWidget::onScrollToBottom);
+    connect(ui->list_messages->verticalScrollBar(), &QScrollBar::valueChanged,
+            this, [this](int value)
+    {
+        if (value == ui->list_messages->verticalScrollBar()->minimum())
+            onShowOlderMessages();
+    });
     connect(ui->button_send, &QToolButton::clicked, this, &TextChatWidget::onSendMessage);
     connect(ui->button_tools, &QToolButton::clicked, this, [=]()
     {
@@ -89,19 +111,13 @@ TextChatWidget::~TextChatWidget()
 
 void TextChatWidget::readMessage(const proto::TextChatMessage& message)
 {
-    QListWidget* list_messages = ui->list_messages;
-    TextChatIncomingMessage* message_widget = new TextChatIncomingMessage(list_messages);
-
-    message_widget->setTimestamp(message.timestamp());
-    message_widget->setSource(QString::fromStdString(message.source()));
-    message_widget->setMessageText(QString::fromStdString(message.text()));
-
-    QListWidgetItem* item = new QListWidgetItem(list_messages);
+    Message incoming_message;
+    incoming_message.direction = TextChatMessage::Direction::INCOMING;
+    incoming_message.timestamp = message.timestamp();
+    incoming_message.source = QString::fromStdString(message.source());
+    incoming_message.text = QString::fromStdString(message.text());
 
-    list_messages->addItem(item);
-    list_messages->setItemWidget(item, message_widget);
-
-    onUpdateSize();
+    addMessage(incoming_message);
 }
 
 void TextChatWidget::readStatus(const proto::TextChatStatus& status)
@@ -163,7 +179,12 @@ bool TextChatWidget::eventFilter(QObject* object, QEvent* event)
             return true;
         }
 
-        onSendStatus(proto::TextChatStatus::STATUS_TYPING);
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now - last_typing_time_ >= kTypingStatusInterval)
+        {
+            last_typing_time_ = now;
+            onSendStatus(proto::TextChatStatus::STATUS_TYPING);
+        }
     }
     else if (object == ui->list_messages->horizontalScrollBar() ||
              object == ui->list_messages->verticalScrollBar())
@@ -189,34 +210,164 @@ void TextChatWidget::closeEvent(QCloseEvent* event)
 }
 
 void TextChatWidget::addOutgoingMessage(time_t timestamp, const QString& message)
+{
+    Message outgoing_message;
+    outgoing_message.direction = TextChatMessage::Direction::OUTGOING;
+    outgoing_message.timestamp = timestamp;
+    outgoing_message.text = message;
+
+    addMessage(outgoing_message);
+}
+
+void TextChatWidget::addStatusMessage(const QString& message)
+{
+    Message status_message;
+    status_message.direction = TextChatMessage::Direction::STATUS;
+    status_message.text = message;
+
+    addMessage(status_message);
+}
+
+void TextChatWidget::addMessage(const Message& message)
+{
+    updateItemSize(insertMessage(ui->list_messages->count(), message));
+
+    if (!scroll_timer_->isActive())
+        scroll_timer_->start(0);
+}
+
+QListWidgetItem* TextChatWidget::insertMessage(int row, const Message& message)
 {
     QListWidget* list_messages = ui->list_messages;
-    TextChatOutgoingMessage* message_widget = new TextChatOutgoingMessage(list_messages);
+    TextChatMessage* message_widget;
 
-    message_widget->setTimestamp(timestamp);
-    message_widget->setMessageText(message);
+    switch (message.direction)
+    {
+        case TextChatMessage::Direction::INCOMING:
+        {
+            TextChatIncomingMessage* incoming_message =
+                new TextChatIncomingMessage(list_messages);
+            incoming_message->setSource(message.source);
+            message_widget = incoming_message;
+        }
+        break;
+
+        case TextChatMessage::Direction::OUTGOING:
+            message_widget = new TextChatOutgoingMessage(list_messages);
+            break;
+
+        default:
+            message_widget = new TextChatStatusMessage(list_messages);
+            break;
+    }
 
-    QListWidgetItem* item = new QListWidgetItem(list_messages);
+    message_widget->setTimestamp(message.timestamp);
+    message_widget->setMessageText(message.text);
 
-    list_messages->addItem(item);
+    // New messages have the current time already.
+    if (!message.time.isEmpty())
+        message_widget->setMessageTime(message.time);
+
+    QListWidgetItem* item = new QListWidgetItem();
+
+    list_messages->insertItem(row, item);
     list_messages->setItemWidget(item, message_widget);
+    return item;
+}
 
-    onUpdateSize();
+TextChatWidget::Message TextChatWidget::messageFromItem(QListWidgetItem* item) const
+{
+    TextChatMessage* message_widget =
+        static_cast<TextChatMessage*>(ui->list_messages->itemWidget(item));
+
+    Message message;
+    message.direction = message_widget->direction();
+    message.timestamp = message_widget->timestamp();
+    message.time = message_widget->messageTime();
+    message.text = message_widget->messageText();
+
+    if (message.direction == TextChatMessage::Direction::INCOMING)
+        message.source = static_cast<TextChatIncomingMessage*>(message_widget)->source();
+
+    return message;
 }
 
-void TextChatWidget::addStatusMessage(const QString& message)
+void TextChatWidget::updateItemSize(QListWidgetItem* item)
 {
     QListWidget* list_messages = ui->list_messages;
-    TextChatStatusMessage* message_widget = new TextChatStatusMessage(list_messages);
 
-    message_widget->setMessageText(message);
+    TextChatMessage* message_widget =
+        static_cast<TextChatMessage*>(list_messages->itemWidget(item));
+    int viewport_width = list_messages->viewport()->width();
 
-    QListWidgetItem* item = new QListWidgetItem(list_messages);
+    message_widget->setFixedWidth(viewport_width);
+    message_widget->setFixedHeight(message_widget->heightForWidth(viewport_width));
 
-    list_messages->addItem(item);
-    list_messages->setItemWidget(item, message_widget);
+    item->setSizeHint(message_widget->size());
+}
 
-    onUpdateSize();
+void TextChatWidget::trimMessages()
+{
+    QListWidget* list_messages = ui->list_messages;
+
+    int remove_count = list_messages->count() - kMaxListMessages;
+    for (int i = 0; i < remove_count; ++i)
+    {
+        QListWidgetItem* item = list_messages->item(0);
+        history_.emplace_back(messageFromItem(item));
+        delete item;
+    }
+
+    while (history_.size() > kMaxHistoryMessages)
+        history_.pop_front();
+}
+
+void TextChatWidget::onScrollToBottom()
+{
+    trimMessages();
+    ui->list_messages->scrollToBottom();
+}
+
+void TextChatWidget::onShowOlderMessages()
+{
+    QListWidget* list_messages = ui->list_messages;
+    if (history_.empty() || !list_messages->count())
+        return;
+
+    QListWidgetItem* first_item = list_messages->item(0);
+
+    for (int i = 0; i < kHistoryPageSize && !history_.empty(); ++i)
+    {
+        updateItemSize(insertMessage(0, history_.back()));
+        history_.pop_back();
+    }
+
+    // The message that was at the top stays in place.
+    list_messages->scrollToItem(first_item, QAbstractItemView::PositionAtTop);
+}
+
+// static
+void TextChatWidget::writeMessage(QTextStream& stream, const Message& message)
+{
+    if (message.direction == TextChatMessage::Direction::INCOMING)
+    {
+        stream << "[" << message.time << "] " << message.source << Qt::endl;
+        stream << message.text << Qt::endl;
+        stream << Qt::endl;
+    }
+    else if (message.direction == TextChatMessage::Direction::OUTGOING)
+    {
+        stream << "[" << message.time << "] " << Qt::endl;
+        stream << message.text << Qt::endl;
+        stream << Qt::endl;
+    }
+    else
+    {
+        DCHECK_EQ(message.direction, TextChatMessage::Direction::STATUS);
+
+        stream << message.text << Qt::endl;
+        stream << Qt::endl;
+    }
 }
 
 void TextChatWidget::onSendMessage()
@@ -241,6 +392,7 @@ void TextChatWidget::onSendMessage()
     addOutgoingMessage(timestamp, message);
     edit_message->clear();
     edit_message->setFocus();
+    last_typing_time_ = std::chrono::steady_clock::time_point();
 
     proto::TextChatMessage text_chat_message;
     text_chat_message.set_timestamp(timestamp);
@@ -262,6 +414,8 @@ void TextChatWidget::onSendStatus(proto::TextChatStatus::Status status)
 
 void TextChatWidget::onClearHistory()
 {
+    history_.clear();
+
     QListWidget* list_messages = ui->list_messages;
     for (int i = list_messages->count() - 1; i >= 0; --i)
         delete list_messages->item(i);
@@ -291,42 +445,11 @@ void TextChatWidget::onSaveChat()
     QListWidget* list_messages = ui->list_messages;
     QTextStream stream(&file);
 
-    for (int i = 0; i < list_messages->count(); ++i)
-    {
-        QListWidgetItem* item = list_messages->item(i);
-        TextChatMessage* message_widget =
-            static_cast<TextChatMessage*>(list_messages->itemWidget(item));
-
-        if (message_widget->direction() == TextChatMessage::Direction::INCOMING)
-        {
-            TextChatIncomingMessage* incoming_message_widget =
-                static_cast<TextChatIncomingMessage*>(message_widget);
-
-            stream << "[" << incoming_message_widget->messageTime() << "] "
-                   << incoming_message_widget->source() << Qt::endl;
-            stream << incoming_message_widget->messageText() << Qt::endl;
-            stream << Qt::endl;
-        }
-        else if (message_widget->direction() == TextChatMessage::Direction::OUTGOING)
-        {
-            TextChatOutgoingMessage* outgoing_message_widget =
-                static_cast<TextChatOutgoingMessage*>(message_widget);
-
-            stream << "[" << outgoing_message_widget->messageTime() << "] " << Qt::endl;
-            stream << outgoing_message_widget->messageText() << Qt::endl;
-            stream << Qt::endl;
-        }
-        else
-        {
-            DCHECK_EQ(message_widget->direction(), TextChatMessage::Direction::STATUS);
-
-            TextChatStatusMessage* status_message_widget =
-                static_cast<TextChatStatusMessage*>(message_widget);
+    for (const auto& message : history_)
+        writeMessage(stream, message);
 
-            stream << status_message_widget->messageText() << Qt::endl;
-            stream << Qt::endl;
-        }
-    }
+    for (int i = 0; i < list_messages->count(); ++i)
+        writeMessage(stream, messageFromItem(list_messages->item(i)));
 }
 
 void TextChatWidget::onUpdateSize()
@@ -335,18 +458,7 @@ void TextChatWidget::onUpdateSize()
     int count = list_messages->count();
 
     for (int i = 0; i < count; ++i)
-    {
-        QListWidgetItem* item = list_messages->item(i);
-
-        TextChatMessage* message_widget =
-            static_cast<TextChatMessage*>(list_messages->itemWidget(item));
-        int viewport_width = list_messages->viewport()->width();
-
-        message_widget->setFixedWidth(viewport_width);
-        message_widget->setFixedHeight(message_widget->heightForWidth(viewport_width));
-
-        item->setSizeHint(message_widget->size());
-    }
+        updateItemSize(list_messages->item(i));
 
     list_messages->scrollToBottom();
 }
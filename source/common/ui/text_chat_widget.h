@@ -19,10 +19,17 @@
 #ifndef COMMON_UI_TEXT_CHAT_WIDGET_H
 #define COMMON_UI_TEXT_CHAT_WIDGET_H
 
+#include "common/ui/text_chat_message.h"
 #include "proto/text_chat.pb.h"
 
 #include <QWidget>
 
+#include <chrono>
+#include <deque>
+
+class QListWidgetItem;
+class QTextStream;
+
 namespace Ui {
 class TextChatWidget;
 } // namespace Ui
@@ -51,8 +58,25 @@ protected:
     void closeEvent(QCloseEvent* event) override;
 
 private:
+    struct Message
+    {
+        TextChatMessage::Direction direction;
+        time_t timestamp = 0;
+        QString time;
+        QString source;
+        QString text;
+    };
+
     void addOutgoingMessage(time_t timestamp, const QString& message);
     void addStatusMessage(const QString& message);
+    void addMessage(const Message& message);
+    QListWidgetItem* insertMessage(int row, const Message& message);
+    Message messageFromItem(QListWidgetItem* item) const;
+    void updateItemSize(QListWidgetItem* item);
+    void trimMessages();
+    void onScrollToBottom();
+    void onShowOlderMessages();
+    static void writeMessage(QTextStream& stream, const Message& message);
     void onSendMessage();
     void onSendStatus(proto::TextChatStatus::Status status);
     void onClearHistory();
@@ -62,6 +86,15 @@ private:
     std::unique_ptr<Ui::TextChatWidget> ui;
     std::string host_name_;
     QTimer* status_clear_timer_;
+
+    // Several messages added in one pass of the event loop are trimmed and scrolled once.
+    QTimer* scroll_timer_;
+
+    // Messages removed from the list, the oldest first. They are shown again page by page when
+    // the list is scrolled to the top.
+    std::deque<Message> history_;
+
+    std::chrono::steady_clock::time_point last_typing_time_;
 };
 
 } // namespace common
@@ -67,6 +67,9 @@ UpdateInfo UpdateInfo::fromXml(const base::ByteArray& buffer)
                 update_info.description_ = std::string(node->value(), node->value_size());
             else if (name == "url")
                 update_info.url_ = std::string(node->value(), node->value_size());
+            else if (name == "sha256")
+                update_info.hash_ = base::fromHex(std::string_view(node->value(),
+                                                                   node->value_size()));
         }
     }
 
@@ -41,11 +41,15 @@ public:
     std::string description() const { return description_; }
     std::string url() const { return url_; }
 
+    // SHA-256 hash of the package. Empty if the update server does not provide it.
+    const base::ByteArray& hash() const { return hash_; }
+
 private:
     bool valid_ = false;
     base::Version version_;
     std::string description_;
     std::string url_;
+    base::ByteArray hash_;
 };
 
 } // namespace common
@@ -34,15 +34,25 @@
 #include "console/settings.h"
 #include "qt_base/application.h"
 
+#include <QEventLoop>
 #include <QFileDialog>
 #include <QMenu>
 #include <QMessageBox>
+#include <QProgressDialog>
+#include <QSaveFile>
+#include <QThread>
 #include <QTimer>
 
 namespace console {
 
 namespace {
 
+// The search is started after the user stops typing.
+const int kSearchDelayMs = 250;
+
+// The search results are limited so that a short text does not list the whole address book.
+const size_t kMaxSearchResults = 5000;
+
 void cleanupComputer(proto::address_book::Computer* computer)
 {
     if (!computer)
@@ -92,6 +102,26 @@ void cleanupFile(proto::address_book::File* file)
     base::memZero(file->mutable_data());
 }
 
+// Runs |function| in a worker thread. The key derivation of large or strongly protected address
+// books takes seconds, so the events are processed and a progress dialog is shown meanwhile.
+// The dialog is modal and the address book cannot be changed until the function completes.
+void runInBackground(QWidget* parent, const QString& label, std::function<void()> function)
+{
+    QProgressDialog progress_dialog(label, QString(), 0, 0, parent);
+    progress_dialog.setWindowModality(Qt::WindowModal);
+    progress_dialog.setMinimumDuration(500);
+    progress_dialog.setValue(0);
+
+    std::unique_ptr<QThread> thread(QThread::create(std::move(function)));
+
+    QEventLoop event_loop;
+    QObject::connect(thread.get(), &QThread::finished, &event_loop, &QEventLoop::quit);
+
+    thread->start();
+    event_loop.exec(QEventLoop::ExcludeUserInputEvents);
+    thread->wait();
+}
+
 } // namespace
 
 AddressBookTab::AddressBookTab(const QString& file_path,
@@ -174,6 +204,14 @@ AddressBookTab::AddressBookTab(const QString& file_path,
 
     connect(ui.tree_computer, &ComputerTree::itemDoubleClicked,
             this, &AddressBookTab::onComputerItemDoubleClicked);
+
+    search_timer_ = new QTimer(this);
+    search_timer_->setSingleShot(true);
+    search_timer_->setInterval(kSearchDelayMs);
+
+    connect(search_timer_, &QTimer::timeout, this, &AddressBookTab::updateSearchResults);
+    connect(ui.edit_search, &QLineEdit::textChanged,
+            search_timer_, QOverload<>::of(&QTimer::start));
 }
 
 AddressBookTab::~AddressBookTab()
@@ -239,15 +277,13 @@ AddressBookTab* AddressBookTab::openFromFile(const QString& file_path, QWidget*
         return nullptr;
     }
 
-    proto::address_book::Data address_book_data;
+    base::memZero(buffer.data(), static_cast<size_t>(buffer.size()));
 
-    std::unique_ptr<base::DataCryptor> cryptor;
-    std::string key;
+    std::string password;
 
     switch (address_book_file.encryption_type())
     {
         case proto::address_book::ENCRYPTION_TYPE_NONE:
-            cryptor = std::make_unique<base::DataCryptorFake>();
             break;
 
         case proto::address_book::ENCRYPTION_TYPE_CHACHA20_POLY1305:
@@ -256,41 +292,64 @@ AddressBookTab* AddressBookTab::openFromFile(const QString& file_path, QWidget*
             if (dialog.exec() != QDialog::Accepted)
                 return nullptr;
 
-            key = base::PasswordHash::hash(
-                base::PasswordHash::SCRYPT,
-                dialog.password().toStdString(),
-                address_book_file.hashing_salt());
-
-            cryptor = std::make_unique<base::DataCryptorChaCha20Poly1305>(key);
+            password = dialog.password().toStdString();
         }
         break;
 
         default:
+        {
             LOG(LS_ERROR) << "Unexpected encryption type: " << address_book_file.encryption_type();
-            break;
+            showOpenError(parent, tr("The address book file is encrypted with an unsupported "
+                                     "encryption type."));
+            return nullptr;
+        }
     }
 
-    if (!cryptor)
+    enum class OpenResult { SUCCESS, DECRYPT_ERROR, PARSE_ERROR };
+
+    proto::address_book::Data address_book_data;
+    std::string key;
+    OpenResult result = OpenResult::SUCCESS;
+
+    // The key derivation and decryption are done outside the UI thread.
+    runInBackground(parent, tr("Opening address book..."), [&]()
     {
-        showOpenError(parent, tr("The address book file is encrypted with an unsupported encryption type."));
-        return nullptr;
-    }
+        std::unique_ptr<base::DataCryptor> cryptor;
+
+        if (address_book_file.encryption_type() == proto::address_book::ENCRYPTION_TYPE_NONE)
+        {
+            cryptor = std::make_unique<base::DataCryptorFake>();
+        }
+        else
+        {
+            key = base::PasswordHash::hash(
+                base::PasswordHash::SCRYPT, password, address_book_file.hashing_salt());
+            cryptor = std::make_unique<base::DataCryptorChaCha20Poly1305>(key);
+        }
+
+        std::string decrypted_data;
+        if (!cryptor->decrypt(address_book_file.data(), &decrypted_data))
+            result = OpenResult::DECRYPT_ERROR;
+        else if (!address_book_data.ParseFromString(decrypted_data))
+            result = OpenResult::PARSE_ERROR;
+
+        base::memZero(&decrypted_data);
+    });
 
-    std::string decrypted_data;
-    if (!cryptor->decrypt(address_book_file.data(), &decrypted_data))
+    base::memZero(&password);
+
+    if (result == OpenResult::DECRYPT_ERROR)
     {
         showOpenError(parent, tr("Unable to decrypt the address book with the specified password."));
         return nullptr;
     }
 
-    if (!address_book_data.ParseFromString(decrypted_data))
+    if (result == OpenResult::PARSE_ERROR)
     {
         showOpenError(parent, tr("The address book file is corrupted or has an unknown format."));
         return nullptr;
     }
 
-    base::memZero(&decrypted_data);
-
     return new AddressBookTab(file_path,
                               std::move(address_book_file),
                               std::move(address_book_data),
@@ -339,6 +398,10 @@ AddressBookTab* AddressBookTab::duplicateTab() const
 
 bool AddressBookTab::save()
 {
+    // The unchanged address book is already on disk.
+    if (!is_changed_ && !file_path_.isEmpty())
+        return true;
+
     return saveToFile(file_path_);
 }
 
@@ -573,7 +636,13 @@ void AddressBookTab::removeComputerGroup()
         cleanupComputerGroup(current_item->computerGroup());
 
         if (parent_item->deleteChildComputerGroup(current_item))
+        {
             setChanged(true);
+
+            // The search results may contain the computers of the deleted group.
+            if (isSearchActive())
+                updateSearchResults();
+        }
     }
 }
 
@@ -619,6 +688,7 @@ void AddressBookTab::startOnlineChecker()
     for (int i = 0; i < ui.tree_computer->topLevelItemCount(); ++i)
     {
         ComputerItem* computer_item = static_cast<ComputerItem*>(ui.tree_computer->topLevelItem(i));
+        online_check_items_.insert(computer_item->computerId(), computer_item);
 
         client::OnlineChecker::Computer computer;
         computer.computer_id = computer_item->computerId();
@@ -642,13 +712,15 @@ void AddressBookTab::startOnlineChecker()
 void AddressBookTab::stopOnlineChecker()
 {
     online_checker_.reset();
+    online_check_items_.clear();
+
+    const QIcon icon = ComputerItem::defaultIcon();
 
     for (int i = 0; i < ui.tree_computer->topLevelItemCount(); ++i)
     {
         ComputerItem* computer_item = static_cast<ComputerItem*>(ui.tree_computer->topLevelItem(i));
 
-        computer_item->setIcon(ComputerItem::COLUMN_INDEX_NAME,
-                               QIcon(QStringLiteral(":/img/computer.png")));
+        computer_item->setIcon(ComputerItem::COLUMN_INDEX_NAME, icon);
         computer_item->setText(ComputerItem::COLUMN_INDEX_STATUS, QString());
     }
 
@@ -661,6 +733,14 @@ void AddressBookTab::onGroupItemClicked(QTreeWidgetItem* item, int /* column */)
     if (!current_item)
         return;
 
+    // The user has selected a group, so its computers are shown instead of the search results.
+    if (!ui.edit_search->text().isEmpty())
+    {
+        QSignalBlocker blocker(ui.edit_search);
+        ui.edit_search->clear();
+        search_timer_->stop();
+    }
+
     bool is_root = !current_item->parent();
     emit computerGroupActivated(true, is_root);
     updateComputerList(current_item);
@@ -708,8 +788,12 @@ void AddressBookTab::onGroupItemDropped()
         return;
 
     ui.tree_group->sortItems(0, Qt::AscendingOrder);
-    updateComputerList(current_item);
     setChanged(true);
+
+    if (isSearchActive())
+        updateSearchResults();
+    else
+        updateComputerList(current_item);
 }
 
 void AddressBookTab::onComputerItemClicked(QTreeWidgetItem* item, int /* column */)
@@ -742,6 +826,32 @@ void AddressBookTab::onComputerItemDoubleClicked(QTreeWidgetItem* item, int /* c
     emit computerDoubleClicked(current_item->computerToConnect());
 }
 
+void AddressBookTab::updateSearchResults()
+{
+    if (!isSearchActive())
+    {
+        ComputerGroupItem* current_item =
+            dynamic_cast<ComputerGroupItem*>(ui.tree_group->currentItem());
+        if (current_item)
+            updateComputerList(current_item);
+        return;
+    }
+
+    if (!computer_index_.isValid())
+        computer_index_.rebuild(rootComputerGroupItem());
+
+    const std::vector<ComputerIndex::Entry> entries =
+        computer_index_.find(ui.edit_search->text(), kMaxSearchResults);
+
+    QList<QTreeWidgetItem*> items;
+    items.reserve(static_cast<int>(entries.size()));
+
+    for (const auto& entry : entries)
+        items.push_back(new ComputerItem(entry.computer, entry.group_item));
+
+    setComputerItems(items);
+}
+
 void AddressBookTab::showEvent(QShowEvent* event)
 {
     ComputerGroupItem* current_group =
@@ -834,18 +944,7 @@ void AddressBookTab::keyPressEvent(QKeyEvent* event)
 
 void AddressBookTab::onOnlineCheckerResult(int computer_id, bool online)
 {
-    ComputerItem* item = nullptr;
-
-    for (int i = 0; i < ui.tree_computer->topLevelItemCount(); ++i)
-    {
-        item = static_cast<ComputerItem*>(ui.tree_computer->topLevelItem(i));
-        if (!item)
-            return;
-
-        if (item->computerId() == computer_id)
-            break;
-    }
-
+    ComputerItem* item = online_check_items_.value(computer_id, nullptr);
     if (!item)
     {
         LOG(LS_WARNING) << "Computer with id " << computer_id << " not found in list";
@@ -881,6 +980,9 @@ void AddressBookTab::onOnlineCheckerFinished()
 
 void AddressBookTab::setChanged(bool value)
 {
+    if (value)
+        computer_index_.clear();
+
     is_changed_ = value;
     emit addressBookChanged(value);
 }
@@ -943,18 +1045,47 @@ void AddressBookTab::restoreState(const QByteArray& state)
 }
 
 void AddressBookTab::updateComputerList(ComputerGroupItem* computer_group)
+{
+    setComputerItems(computer_group->ComputerList());
+}
+
+void AddressBookTab::setComputerItems(const QList<QTreeWidgetItem*>& items)
 {
     online_checker_.reset();
+    online_check_items_.clear();
 
-    for (int i = ui.tree_computer->topLevelItemCount() - 1; i >= 0; --i)
-        std::unique_ptr<QTreeWidgetItem> item_deleter(ui.tree_computer->takeTopLevelItem(i));
+    // The items are sorted once after all of them are added.
+    const bool is_sorting_enabled = ui.tree_computer->isSortingEnabled();
+    ui.tree_computer->setSortingEnabled(false);
 
-    ui.tree_computer->addTopLevelItems(computer_group->ComputerList());
+    ui.tree_computer->clear();
+    ui.tree_computer->addTopLevelItems(items);
+
+    ui.tree_computer->setSortingEnabled(is_sorting_enabled);
+}
+
+bool AddressBookTab::isSearchActive() const
+{
+    return !ui.edit_search->text().trimmed().isEmpty();
 }
 
 bool AddressBookTab::saveToFile(const QString& file_path)
 {
-    std::string serialized_data = data_.SerializeAsString();
+    QString path = file_path;
+    if (path.isEmpty())
+    {
+        Settings settings;
+
+        path = QFileDialog::getSaveFileName(this,
+                                            tr("Save Address Book"),
+                                            settings.lastDirectory(),
+                                            tr("Aspia Address Book (*.aab)"));
+        if (path.isEmpty())
+            return false;
+
+        settings.setLastDirectory(QFileInfo(path).absolutePath());
+    }
+
     std::unique_ptr<base::DataCryptor> cryptor;
 
     switch (file_.encryption_type())
@@ -972,42 +1103,46 @@ bool AddressBookTab::saveToFile(const QString& file_path)
             return false;
     }
 
-    std::string encrypted_data;
-    CHECK(cryptor->encrypt(serialized_data, &encrypted_data));
-    base::memZero(&serialized_data);
+    enum class SaveResult { SUCCESS, OPEN_ERROR, WRITE_ERROR };
 
-    file_.set_data(std::move(encrypted_data));
+    std::string serialized_data = data_.SerializeAsString();
+    SaveResult result = SaveResult::SUCCESS;
 
-    QString path = file_path;
-    if (path.isEmpty())
+    // The encryption and writing are done outside the UI thread. The file is written to a
+    // temporary file which replaces the previous one only if all data has been written.
+    runInBackground(this, tr("Saving address book..."), [&]()
     {
-        Settings settings;
+        std::string encrypted_data;
+        CHECK(cryptor->encrypt(serialized_data, &encrypted_data));
+        base::memZero(&serialized_data);
 
-        path = QFileDialog::getSaveFileName(this,
-                                            tr("Save Address Book"),
-                                            settings.lastDirectory(),
-                                            tr("Aspia Address Book (*.aab)"));
-        if (path.isEmpty())
-            return false;
+        file_.set_data(std::move(encrypted_data));
 
-        settings.setLastDirectory(QFileInfo(path).absolutePath());
-    }
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly))
+        {
+            result = SaveResult::OPEN_ERROR;
+            return;
+        }
+
+        base::ByteArray buffer = base::serialize(file_);
 
-    QFile file(path);
-    if (!file.open(QIODevice::WriteOnly))
+        int64_t bytes_written = file.write(
+            reinterpret_cast<const char*>(buffer.data()), static_cast<qint64>(buffer.size()));
+
+        base::memZero(buffer.data(), buffer.size());
+
+        if (bytes_written != static_cast<int64_t>(buffer.size()) || !file.commit())
+            result = SaveResult::WRITE_ERROR;
+    });
+
+    if (result == SaveResult::OPEN_ERROR)
     {
         showSaveError(this, tr("Unable to create or open address book file."));
         return false;
     }
 
-    base::ByteArray buffer = base::serialize(file_);
-
-    int64_t bytes_written = file.write(
-        reinterpret_cast<const char*>(buffer.data()), static_cast<qint64>(buffer.size()));
-
-    base::memZero(buffer.data(), buffer.size());
-
-    if (bytes_written != static_cast<int64_t>(buffer.size()))
+    if (result == SaveResult::WRITE_ERROR)
     {
         showSaveError(this, tr("Unable to write address book file."));
         return false;
@@ -22,12 +22,15 @@
 #include "base/macros_magic.h"
 #include "client/online_checker.h"
 #include "client/router_config.h"
+#include "console/computer_index.h"
 #include "proto/address_book.pb.h"
 #include "ui_address_book_tab.h"
 
 #include <optional>
 #include <memory>
 
+class QTimer;
+
 namespace console {
 
 class ComputerItem;
@@ -102,6 +105,7 @@ private slots:
     void onComputerItemClicked(QTreeWidgetItem* item, int column);
     void onComputerContextMenu(const QPoint& point);
     void onComputerItemDoubleClicked(QTreeWidgetItem* item, int column);
+    void updateSearchResults();
 
 private:
     AddressBookTab(const QString& file_path,
@@ -113,6 +117,8 @@ private:
     QByteArray saveState();
     void restoreState(const QByteArray& state);
     void updateComputerList(ComputerGroupItem* computer_group);
+    void setComputerItems(const QList<QTreeWidgetItem*>& items);
+    bool isSearchActive() const;
     bool saveToFile(const QString& file_path);
     ComputerGroupItem* rootComputerGroupItem();
 
@@ -131,6 +137,11 @@ private:
     bool is_changed_ = false;
 
     std::unique_ptr<client::OnlineChecker> online_checker_;
+    QHash<int, ComputerItem*> online_check_items_;
+
+    // The index is built on the first search after the address book is changed.
+    ComputerIndex computer_index_;
+    QTimer* search_timer_ = nullptr;
 
     DISALLOW_COPY_AND_ASSIGN(AddressBookTab);
 };
@@ -68,6 +68,7 @@ Application::Application(int& argc, char* argv[])
         settings_.setLocale(QStringLiteral(DEFAULT_LOCALE));
 
     setLocale(settings_.locale());
+    traceStartup("Translations loaded");
 }
 
 // static
@@ -0,0 +1,173 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "console/computer_index.h"
+
+#include "console/computer_group_item.h"
+
+#include <QStringMatcher>
+
+#include <algorithm>
+
+namespace console {
+
+void ComputerIndex::rebuild(ComputerGroupItem* root_item)
+{
+    clear();
+
+    if (!root_item)
+        return;
+
+    std::vector<ComputerGroupItem*> pending_items = { root_item };
+
+    while (!pending_items.empty())
+    {
+        ComputerGroupItem* group_item = pending_items.back();
+        pending_items.pop_back();
+
+        proto::address_book::ComputerGroup* computer_group = group_item->computerGroup();
+        for (int i = 0; i < computer_group->computer_size(); ++i)
+            addComputer(computer_group->mutable_computer(i), group_item);
+
+        for (int i = 0; i < group_item->childCount(); ++i)
+        {
+            ComputerGroupItem* child_item = dynamic_cast<ComputerGroupItem*>(group_item->child(i));
+            if (child_item)
+                pending_items.emplace_back(child_item);
+        }
+    }
+
+    std::sort(words_.begin(), words_.end(), [](const Word& first, const Word& second)
+    {
+        return first.text < second.text;
+    });
+
+    is_valid_ = true;
+}
+
+void ComputerIndex::clear()
+{
+    // The address book is stored encrypted, so its data does not remain in memory.
+    for (auto& record : records_)
+        record.text.fill(QChar());
+
+    for (auto& word : words_)
+        word.text.fill(QChar());
+
+    records_.clear();
+    words_.clear();
+    is_valid_ = false;
+}
+
+std::vector<ComputerIndex::Entry> ComputerIndex::find(const QString& text, size_t max_count) const
+{
+    std::vector<Entry> result;
+
+    const QString folded_text = text.trimmed().toCaseFolded();
+    if (folded_text.isEmpty() || !max_count)
+        return result;
+
+    std::vector<bool> is_found(records_.size(), false);
+
+    auto add_record = [&](size_t record_index)
+    {
+        if (is_found[record_index])
+            return;
+
+        is_found[record_index] = true;
+        result.emplace_back(records_[record_index].entry);
+    };
+
+    auto word = std::lower_bound(words_.cbegin(), words_.cend(), folded_text,
+                                 [](const Word& item, const QString& value)
+    {
+        return item.text < value;
+    });
+
+    for (; word != words_.cend() && word->text.startsWith(folded_text); ++word)
+    {
+        add_record(word->record_index);
+        if (result.size() >= max_count)
+            return result;
+    }
+
+    const QStringMatcher matcher(folded_text);
+
+    for (size_t i = 0; i < records_.size(); ++i)
+    {
+        if (is_found[i] || matcher.indexIn(records_[i].text) == -1)
+            continue;
+
+        add_record(i);
+        if (result.size() >= max_count)
+            break;
+    }
+
+    return result;
+}
+
+void ComputerIndex::addComputer(proto::address_book::Computer* computer,
+                                ComputerGroupItem* group_item)
+{
+    const QString name = QString::fromStdString(computer->name()).toCaseFolded();
+    const QString address = QString::fromStdString(computer->address()).toCaseFolded();
+    const QString comment = QString::fromStdString(computer->comment()).toCaseFolded();
+
+    const size_t record_index = records_.size();
+
+    const QChar separator = QLatin1Char('\n');
+
+    records_.push_back(
+        { { computer, group_item }, name + separator + address + separator + comment });
+
+    addWords(name, record_index);
+    addWords(address, record_index);
+    addWords(comment, record_index);
+}
+
+void ComputerIndex::addWords(const QString& field, size_t record_index)
+{
+    if (field.isEmpty())
+        return;
+
+    // The whole field is added so that the text with separators (for example, a part of an IP
+    // address) is also found by prefix.
+    words_.push_back({ field, record_index });
+
+    int word_start = -1;
+
+    for (int i = 0; i <= field.length(); ++i)
+    {
+        const bool is_word_char = i < field.length() && field[i].isLetterOrNumber();
+
+        if (is_word_char)
+        {
+            if (word_start == -1)
+                word_start = i;
+            continue;
+        }
+
+        // The first word of the field is already added as the prefix of the whole field.
+        if (word_start > 0)
+            words_.push_back({ field.mid(word_start, i - word_start), record_index });
+
+        word_start = -1;
+    }
+}
+
+} // namespace console
@@ -0,0 +1,85 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CONSOLE_COMPUTER_INDEX_H
+#define CONSOLE_COMPUTER_INDEX_H
+
+#include "base/macros_magic.h"
+#include "proto/address_book.pb.h"
+
+#include <QString>
+
+#include <vector>
+
+namespace console {
+
+class ComputerGroupItem;
+
+// Search index of the computers of an address book. The name, address and comment of the
+// computers are searched case-insensitively. The computers in which a word (or the whole field)
+// starts with the text are found through a sorted list of words, the computers which only contain
+// the text are found by a scan of all computers.
+class ComputerIndex
+{
+public:
+    ComputerIndex() = default;
+    ~ComputerIndex() { clear(); }
+
+    struct Entry
+    {
+        proto::address_book::Computer* computer;
+        ComputerGroupItem* group_item;
+    };
+
+    // Builds the index for all computers of |root_item| and its child groups.
+    void rebuild(ComputerGroupItem* root_item);
+    void clear();
+
+    bool isValid() const { return is_valid_; }
+
+    // Returns at most |max_count| computers. The prefix matches go first.
+    std::vector<Entry> find(const QString& text, size_t max_count) const;
+
+private:
+    void addComputer(proto::address_book::Computer* computer, ComputerGroupItem* group_item);
+    void addWords(const QString& field, size_t record_index);
+
+    struct Record
+    {
+        Entry entry;
+
+        // Case folded name, address and comment separated by new lines.
+        QString text;
+    };
+
+    struct Word
+    {
+        QString text;
+        size_t record_index;
+    };
+
+    std::vector<Record> records_;
+    std::vector<Word> words_; // Sorted by text.
+    bool is_valid_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(ComputerIndex);
+};
+
+} // namespace console
+
+#endif // CONSOLE_COMPUTER_INDEX_H
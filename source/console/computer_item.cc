@@ -35,47 +35,13 @@ ComputerItem::ComputerItem(proto::address_book::Computer* computer,
     computer_id_ = computer_id;
     ++computer_id;
 
-    setIcon(0, QIcon(QStringLiteral(":/img/computer.png")));
-    updateItem();
+    setIcon(0, defaultIcon());
 }
 
 void ComputerItem::updateItem()
 {
-    QString address_title = QString::fromStdString(computer_->address());
-    bool host_id_entered = true;
-
-    for (int i = 0; i < address_title.length(); ++i)
-    {
-        if (!address_title[i].isDigit())
-        {
-            host_id_entered = false;
-            break;
-        }
-    }
-
-    if (!host_id_entered)
-    {
-        base::Address address(DEFAULT_HOST_TCP_PORT);
-        address.setHost(base::utf16FromUtf8(computer_->address()));
-        address.setPort(static_cast<uint16_t>(computer_->port()));
-
-        address_title = QString::fromStdU16String(address.toString());
-    }
-
-    setText(COLUMN_INDEX_NAME, QString::fromStdString(computer_->name()));
-    setText(COLUMN_INDEX_ADDRESS, address_title);
-    setText(COLUMN_INDEX_COMMENT, QString::fromStdString(
-        computer_->comment()).replace(QLatin1Char('\n'), QLatin1Char(' ')));
-
-    QLocale system_locale = QLocale::system();
-
-    QString create_time = system_locale.toString(
-        QDateTime::fromSecsSinceEpoch(computer_->create_time()), QLocale::ShortFormat);
-    setText(COLUMN_INDEX_CREATED, create_time);
-
-    QString modify_time = system_locale.toString(
-        QDateTime::fromSecsSinceEpoch(computer_->modify_time()), QLocale::ShortFormat);
-    setText(COLUMN_INDEX_MODIFIED, modify_time);
+    cached_columns_ = 0;
+    emitDataChanged();
 }
 
 proto::address_book::Computer ComputerItem::computerToConnect()
@@ -123,6 +89,31 @@ ComputerGroupItem* ComputerItem::parentComputerGroupItem()
     return parent_group_item_;
 }
 
+// static
+QIcon ComputerItem::defaultIcon()
+{
+    static const QIcon icon(QStringLiteral(":/img/computer.png"));
+    return icon;
+}
+
+QVariant ComputerItem::data(int column, int role) const
+{
+    if (role == Qt::DisplayRole && column >= 0 && column < COLUMN_INDEX_STATUS)
+    {
+        const uint32_t column_bit = 1u << column;
+
+        if (!(cached_columns_ & column_bit))
+        {
+            column_text_[column] = columnText(column);
+            cached_columns_ |= column_bit;
+        }
+
+        return column_text_[column];
+    }
+
+    return QTreeWidgetItem::data(column, role);
+}
+
 bool ComputerItem::operator<(const QTreeWidgetItem& other) const
 {
     switch (treeWidget()->sortColumn())
@@ -150,4 +141,54 @@ bool ComputerItem::operator<(const QTreeWidgetItem& other) const
     return QTreeWidgetItem::operator<(other);
 }
 
+QString ComputerItem::columnText(int column) const
+{
+    switch (column)
+    {
+        case COLUMN_INDEX_NAME:
+            return QString::fromStdString(computer_->name());
+
+        case COLUMN_INDEX_ADDRESS:
+        {
+            QString address_title = QString::fromStdString(computer_->address());
+            bool host_id_entered = true;
+
+            for (int i = 0; i < address_title.length(); ++i)
+            {
+                if (!address_title[i].isDigit())
+                {
+                    host_id_entered = false;
+                    break;
+                }
+            }
+
+            if (!host_id_entered)
+            {
+                base::Address address(DEFAULT_HOST_TCP_PORT);
+                address.setHost(base::utf16FromUtf8(computer_->address()));
+                address.setPort(static_cast<uint16_t>(computer_->port()));
+
+                address_title = QString::fromStdU16String(address.toString());
+            }
+
+            return address_title;
+        }
+
+        case COLUMN_INDEX_COMMENT:
+            return QString::fromStdString(
+                computer_->comment()).replace(QLatin1Char('\n'), QLatin1Char(' '));
+
+        case COLUMN_INDEX_CREATED:
+            return QLocale::system().toString(
+                QDateTime::fromSecsSinceEpoch(computer_->create_time()), QLocale::ShortFormat);
+
+        case COLUMN_INDEX_MODIFIED:
+            return QLocale::system().toString(
+                QDateTime::fromSecsSinceEpoch(computer_->modify_time()), QLocale::ShortFormat);
+
+        default:
+            return QString();
+    }
+}
+
 } // namespace console
@@ -52,16 +52,25 @@ public:
 
     ComputerGroupItem* parentComputerGroupItem();
 
+    static QIcon defaultIcon();
+
     // QTreeWidgetItem implementation.
+    QVariant data(int column, int role) const override;
     bool operator<(const QTreeWidgetItem &other) const override;
 
 private:
     friend class ComputerGroupItem;
 
+    QString columnText(int column) const;
+
     proto::address_book::Computer* computer_;
     ComputerGroupItem* parent_group_item_;
     int computer_id_ = 0;
 
+    // The texts of the columns are created only when they are displayed or compared for sorting.
+    mutable QString column_text_[COLUMN_INDEX_STATUS];
+    mutable uint32_t cached_columns_ = 0;
+
     DISALLOW_COPY_AND_ASSIGN(ComputerItem);
 };
 
@@ -19,6 +19,7 @@
 #include "console/fast_connect_dialog.h"
 
 #include "base/logging.h"
+#include "base/codec/video_decoder.h"
 #include "base/net/address.h"
 #include "build/build_config.h"
 #include "client/config_factory.h"
@@ -29,7 +30,6 @@
 #include "client/ui/qt_file_manager_window.h"
 #include "client/ui/qt_system_info_window.h"
 #include "client/ui/qt_text_chat_window.h"
-#include "common/desktop_session_constants.h"
 #include "common/ui/session_type.h"
 #include "console/application.h"
 #include "console/computer_factory.h"
@@ -176,7 +176,7 @@ void FastConnectDialog::sessionConfigButtonPressed()
         {
             client::DesktopConfigDialog dialog(session_type,
                                                state_.desktop_manage_config,
-                                               common::kSupportedVideoEncodings,
+                                               base::VideoDecoder::supportedEncodings(),
                                                this);
 
             if (dialog.exec() == client::DesktopConfigDialog::Accepted)
@@ -188,7 +188,7 @@ void FastConnectDialog::sessionConfigButtonPressed()
         {
             client::DesktopConfigDialog dialog(session_type,
                                                state_.desktop_view_config,
-                                               common::kSupportedVideoEncodings,
+                                               base::VideoDecoder::supportedEncodings(),
                                                this);
 
             if (dialog.exec() == client::DesktopConfigDialog::Accepted)
@@ -45,6 +45,7 @@
 namespace console {
 
 MainWindow::MainWindow(const QString& file_path)
+    : startup_file_path_(file_path)
 {
     LOG(LS_INFO) << "Ctor";
 
@@ -53,7 +54,6 @@ MainWindow::MainWindow(const QString& file_path)
         Qt::AA_DontShowIconsInMenus, !settings.showIconsInMenus());
 
     ui.setupUi(this);
-    createLanguageMenu(settings.locale());
 
     bool enable_recent_open = settings.isRecentOpenEnabled();
     ui.action_remember_last->setChecked(enable_recent_open);
@@ -183,54 +183,18 @@ MainWindow::MainWindow(const QString& file_path)
             break;
     }
 
-    // Open all pinned files of address books.
-    for (const auto& file : mru_.pinnedFiles())
-    {
-        if (QFile::exists(file))
-        {
-            addAddressBookTab(AddressBookTab::openFromFile(file, ui.tab_widget));
-        }
-        else
-        {
-            QMessageBox::warning(this,
-                                 tr("Warning"),
-                                 tr("Pinned address book file \"%1\" was not found.<br/>"
-                                    "This file will be unpinned.").arg(file),
-                                 QMessageBox::Ok);
-            mru_.unpinFile(file);
-        }
-    }
-
-    QString normalized_path(file_path);
-    normalized_path.replace(QLatin1Char('\\'), QLatin1Char('/'));
-
-    // If the address book is pinned, then it is already open.
-    if (!normalized_path.isEmpty() && !mru_.isPinnedFile(normalized_path))
-        addAddressBookTab(AddressBookTab::openFromFile(normalized_path, ui.tab_widget));
-
-    if (ui.tab_widget->count() > 0)
-        ui.tab_widget->setCurrentIndex(0);
-
 #if defined(OS_WIN)
     connect(ui.action_check_updates, &QAction::triggered, this, &MainWindow::onCheckUpdates);
     connect(ui.action_update_settings, &QAction::triggered, this, [this]()
     {
         UpdateSettingsDialog(this).exec();
     });
-
-    if (settings.checkUpdates())
-    {
-        update_checker_ = std::make_unique<common::UpdateChecker>();
-
-        update_checker_->setUpdateServer(settings.updateServer().toStdString());
-        update_checker_->setPackageName("console");
-
-        update_checker_->start(Application::uiTaskRunner(), this);
-    }
 #else
     ui.action_check_updates->setVisible(false);
     ui.action_update_settings->setVisible(false);
 #endif
+
+    Application::traceStartup("Main window created");
 }
 
 MainWindow::~MainWindow()
@@ -1111,6 +1075,71 @@ void MainWindow::closeEvent(QCloseEvent* event)
     QMainWindow::closeEvent(event);
 }
 
+void MainWindow::showEvent(QShowEvent* event)
+{
+    QMainWindow::showEvent(event);
+
+    if (is_shown_)
+        return;
+
+    is_shown_ = true;
+
+    // A zero timer is triggered after the window system events (including the first paint) are
+    // processed.
+    QTimer::singleShot(0, this, &MainWindow::onFirstShown);
+}
+
+void MainWindow::onFirstShown()
+{
+    Application::traceStartup("Main window shown");
+
+    Settings& settings = Application::instance()->settings();
+    createLanguageMenu(settings.locale());
+
+    // Open all pinned files of address books.
+    for (const auto& file : mru_.pinnedFiles())
+    {
+        if (QFile::exists(file))
+        {
+            addAddressBookTab(AddressBookTab::openFromFile(file, ui.tab_widget));
+        }
+        else
+        {
+            QMessageBox::warning(this,
+                                 tr("Warning"),
+                                 tr("Pinned address book file \"%1\" was not found.<br/>"
+                                    "This file will be unpinned.").arg(file),
+                                 QMessageBox::Ok);
+            mru_.unpinFile(file);
+        }
+    }
+
+    QString normalized_path(startup_file_path_);
+    normalized_path.replace(QLatin1Char('\\'), QLatin1Char('/'));
+    startup_file_path_.clear();
+
+    // If the address book is pinned, then it is already open.
+    if (!normalized_path.isEmpty() && !mru_.isPinnedFile(normalized_path))
+        addAddressBookTab(AddressBookTab::openFromFile(normalized_path, ui.tab_widget));
+
+    if (ui.tab_widget->count() > 0)
+        ui.tab_widget->setCurrentIndex(0);
+
+    Application::traceStartup("Address books opened");
+
+#if defined(OS_WIN)
+    if (settings.checkUpdates())
+    {
+        update_checker_ = std::make_unique<common::UpdateChecker>();
+
+        update_checker_->setUpdateServer(settings.updateServer().toStdString());
+        update_checker_->setPackageName("console");
+
+        update_checker_->start(Application::uiTaskRunner(), this);
+    }
+#endif // defined(OS_WIN)
+}
+
 void MainWindow::onUpdateCheckedFinished(const base::ByteArray& result)
 {
     common::UpdateInfo update_info = common::UpdateInfo::fromXml(result);
@@ -53,6 +53,7 @@ protected:
     // QMainWindow implementation.
     void changeEvent(QEvent* event) override;
     void closeEvent(QCloseEvent* event) override;
+    void showEvent(QShowEvent* event) override;
 
     // common::UpdateChecker::Delegate implementation.
     void onUpdateCheckedFinished(const base::ByteArray& result) override;
@@ -99,6 +100,7 @@ private slots:
     void onShowHideToTray();
 
 private:
+    void onFirstShown();
     void createLanguageMenu(const QString& current_locale);
     void rebuildMruMenu();
     void showTrayIcon(bool show);
@@ -113,6 +115,10 @@ private:
     Ui::ConsoleMainWindow ui;
     Mru mru_;
 
+    // The work which is not needed to show the window is done after the first paint.
+    QString startup_file_path_;
+    bool is_shown_ = false;
+
     std::unique_ptr<QSystemTrayIcon> tray_icon_;
     std::unique_ptr<QMenu> tray_menu_;
     std::unique_ptr<common::UpdateChecker> update_checker_;
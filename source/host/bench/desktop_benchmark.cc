@@ -0,0 +1,443 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "host/bench/desktop_benchmark.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+#include "base/desktop/frame_simple.h"
+#include "base/threading/thread.h"
+#include "client/client_desktop.h"
+#include "client/client_proxy.h"
+#include "client/config_factory.h"
+#include "client/desktop_control_proxy.h"
+#include "client/desktop_window_proxy.h"
+#include "client/frame_factory.h"
+#include "client/status_window_proxy.h"
+
+#include <iomanip>
+#include <iostream>
+
+namespace host {
+
+namespace {
+
+// Time for the connection, the authentication and the measurement reports in addition to the
+// warmup and the duration.
+const std::chrono::seconds kExtraTimeout { 30 };
+
+const std::chrono::seconds kMetricsInterval { 1 };
+
+class FrameFactorySimple : public client::FrameFactory
+{
+public:
+    std::shared_ptr<base::Frame> allocateFrame(const base::Size& size) override
+    {
+        return std::shared_ptr<base::Frame>(
+            base::FrameSimple::create(size, base::PixelFormat::ARGB()).release());
+    }
+};
+
+const char* encodingName(proto::VideoEncoding encoding)
+{
+    switch (encoding)
+    {
+        case proto::VIDEO_ENCODING_ZSTD:
+            return "zstd";
+
+        case proto::VIDEO_ENCODING_VP8:
+            return "vp8";
+
+        case proto::VIDEO_ENCODING_VP9:
+            return "vp9";
+
+        case proto::VIDEO_ENCODING_H264:
+            return "h264";
+
+        case proto::VIDEO_ENCODING_HEVC:
+            return "hevc";
+
+        default:
+            return "unknown";
+    }
+}
+
+double milliseconds(const std::chrono::microseconds& time, int64_t count)
+{
+    return count ? static_cast<double>(time.count()) / 1000 / static_cast<double>(count) : 0;
+}
+
+} // namespace
+
+DesktopBenchmark::DesktopBenchmark(std::shared_ptr<base::TaskRunner> task_runner,
+                                   const Options& options)
+    : task_runner_(std::move(task_runner)),
+      options_(options),
+      warmup_timer_(base::WaitableTimer::Type::SINGLE_SHOT, task_runner_),
+      duration_timer_(base::WaitableTimer::Type::SINGLE_SHOT, task_runner_),
+      metrics_timer_(base::WaitableTimer::Type::REPEATED, task_runner_),
+      timeout_timer_(base::WaitableTimer::Type::SINGLE_SHOT, task_runner_)
+{
+    DCHECK(task_runner_);
+}
+
+DesktopBenchmark::~DesktopBenchmark()
+{
+    finishEncoding();
+
+    if (io_thread_)
+        io_thread_->stop();
+
+    host_.stop();
+}
+
+bool DesktopBenchmark::start()
+{
+    if (options_.encodings.empty())
+    {
+        LOG(LS_ERROR) << "No video encodings";
+        return false;
+    }
+
+    if (!host_.start(options_.host))
+    {
+        LOG(LS_ERROR) << "Unable to start the host";
+        return false;
+    }
+
+    io_thread_ = std::make_unique<base::Thread>();
+    io_thread_->start(base::MessageLoop::Type::ASIO);
+
+    runNextEncoding();
+    return true;
+}
+
+void DesktopBenchmark::showWindow(
+    std::shared_ptr<client::DesktopControlProxy> desktop_control_proxy,
+    const base::Version& /* peer_version */)
+{
+    if (state_ != State::CONNECTING)
+        return;
+
+    desktop_control_proxy_ = std::move(desktop_control_proxy);
+    state_ = State::WARMUP;
+
+    warmup_timer_.start(options_.warmup, std::bind(&DesktopBenchmark::onWarmupFinished, this));
+    metrics_timer_.start(kMetricsInterval, std::bind(&DesktopBenchmark::onMetricsTimer, this));
+}
+
+void DesktopBenchmark::configRequired()
+{
+    onEncodingFailed("the video encoding is not supported by the host");
+}
+
+void DesktopBenchmark::setCapabilities(
+    const std::string& /* extensions */, uint32_t /* video_encodings */)
+{
+    // Nothing
+}
+
+void DesktopBenchmark::setScreenList(const proto::ScreenList& /* screen_list */)
+{
+    // Nothing
+}
+
+void DesktopBenchmark::setCursorPosition(const proto::CursorPosition& /* cursor_position */)
+{
+    // Nothing
+}
+
+void DesktopBenchmark::setSystemInfo(const proto::system_info::SystemInfo& /* system_info */)
+{
+    // Nothing
+}
+
+void DesktopBenchmark::setTaskManager(const proto::task_manager::HostToClient& /* message */)
+{
+    // Nothing
+}
+
+void DesktopBenchmark::setMetrics(const Metrics& metrics)
+{
+    if (results_.empty())
+        return;
+
+    Result& result = results_.back();
+
+    switch (state_)
+    {
+        case State::STARTING:
+        {
+            start_time_ = Clock::now();
+            start_drawn_frames_ = drawn_frames_;
+            start_captured_frames_ = host_.capturedFrames();
+            start_received_bytes_ = metrics.total_rx;
+
+            state_ = State::MEASURING;
+            duration_timer_.start(options_.duration,
+                                  std::bind(&DesktopBenchmark::onDurationFinished, this));
+        }
+        break;
+
+        case State::MEASURING:
+        case State::STOPPING:
+        {
+            using Stage = client::LatencyStats::Stage;
+
+            const auto& stages = metrics.latency.stages;
+
+            ++result.report_count;
+            result.glass_to_glass += metrics.latency.glass_to_glass;
+            result.max_glass_to_glass =
+                std::max(result.max_glass_to_glass, metrics.latency.glass_to_glass);
+            result.encode += stages[static_cast<size_t>(Stage::ENCODE)].avg;
+            result.decode += stages[static_cast<size_t>(Stage::DECODE)].avg;
+
+            if (state_ == State::STOPPING)
+            {
+                result.seconds = std::chrono::duration<double>(Clock::now() - start_time_).count();
+                result.drawn_frames = drawn_frames_ - start_drawn_frames_;
+                result.captured_frames = host_.capturedFrames() - start_captured_frames_;
+                result.received_bytes = metrics.total_rx - start_received_bytes_;
+
+                finishEncoding();
+                task_runner_->postTask(std::bind(&DesktopBenchmark::runNextEncoding, this));
+            }
+        }
+        break;
+
+        default:
+            break;
+    }
+}
+
+std::unique_ptr<client::FrameFactory> DesktopBenchmark::frameFactory()
+{
+    return std::make_unique<FrameFactorySimple>();
+}
+
+void DesktopBenchmark::setFrameError(proto::VideoErrorCode error_code)
+{
+    LOG(LS_WARNING) << "Frame error: " << error_code;
+}
+
+void DesktopBenchmark::setFrame(
+    const base::Size& /* screen_size */, std::shared_ptr<base::Frame> /* frame */)
+{
+    // Nothing
+}
+
+void DesktopBenchmark::drawFrame(std::shared_ptr<base::Frame> /* frame */,
+                                 const base::Region& /* updated_region */)
+{
+    ++drawn_frames_;
+}
+
+void DesktopBenchmark::setMouseCursor(std::shared_ptr<base::MouseCursor> /* mouse_cursor */)
+{
+    // Nothing
+}
+
+void DesktopBenchmark::onStarted(const std::u16string& /* address_or_id */)
+{
+    // Nothing
+}
+
+void DesktopBenchmark::onStopped()
+{
+    // Nothing
+}
+
+void DesktopBenchmark::onConnected()
+{
+    // Nothing
+}
+
+void DesktopBenchmark::onDisconnected(base::TcpChannel::ErrorCode error_code)
+{
+    LOG(LS_WARNING) << "Disconnected: " << base::TcpChannel::errorToString(error_code);
+    onEncodingFailed("the connection is closed");
+}
+
+void DesktopBenchmark::onAccessDenied(base::ClientAuthenticator::ErrorCode error_code)
+{
+    LOG(LS_WARNING) << "Access denied: " << base::ClientAuthenticator::errorToString(error_code);
+    onEncodingFailed("the access is denied");
+}
+
+void DesktopBenchmark::onRouterError(const client::RouterController::Error& /* error */)
+{
+    onEncodingFailed("router error");
+}
+
+void DesktopBenchmark::runNextEncoding()
+{
+    if (encoding_index_ >= options_.encodings.size())
+    {
+        printReport();
+        task_runner_->postQuit();
+        return;
+    }
+
+    const proto::VideoEncoding encoding = options_.encodings[encoding_index_++];
+
+    LOG(LS_INFO) << "Starting session with encoding: " << encodingName(encoding);
+
+    Result result;
+    result.encoding = encoding;
+    results_.emplace_back(result);
+
+    desktop_window_proxy_ = std::make_shared<client::DesktopWindowProxy>(task_runner_, this);
+    status_window_proxy_ = std::make_shared<client::StatusWindowProxy>(task_runner_, this);
+
+    proto::DesktopConfig desktop_config = client::ConfigFactory::defaultDesktopManageConfig();
+    desktop_config.set_video_encoding(encoding);
+
+    std::unique_ptr<client::ClientDesktop> client =
+        std::make_unique<client::ClientDesktop>(io_thread_->taskRunner());
+    client->setDesktopConfig(desktop_config);
+    client->setDesktopWindow(desktop_window_proxy_);
+    client->setStatusWindow(status_window_proxy_);
+
+    client::Config config;
+    config.address_or_id = u"127.0.0.1";
+    config.port = options_.host.port;
+    config.username = options_.host.username;
+    config.password = options_.host.password;
+    config.session_type = proto::SESSION_TYPE_DESKTOP_MANAGE;
+
+    state_ = State::CONNECTING;
+    timeout_timer_.start(options_.warmup + options_.duration + kExtraTimeout,
+                         std::bind(&DesktopBenchmark::onEncodingFailed, this, "timeout"));
+
+    client_proxy_ = std::make_unique<client::ClientProxy>(
+        io_thread_->taskRunner(), std::move(client), config);
+    client_proxy_->start();
+}
+
+void DesktopBenchmark::onWarmupFinished()
+{
+    state_ = State::STARTING;
+
+    if (desktop_control_proxy_)
+        desktop_control_proxy_->onMetricsRequest();
+}
+
+void DesktopBenchmark::onMetricsTimer()
+{
+    // The latency is accumulated from the periodic reports. The baseline and the final reports are
+    // requested separately.
+    if (state_ == State::MEASURING && desktop_control_proxy_)
+        desktop_control_proxy_->onMetricsRequest();
+}
+
+void DesktopBenchmark::onDurationFinished()
+{
+    state_ = State::STOPPING;
+
+    if (desktop_control_proxy_)
+        desktop_control_proxy_->onMetricsRequest();
+}
+
+void DesktopBenchmark::onEncodingFailed(const char* reason)
+{
+    if (state_ == State::FINISHED)
+        return;
+
+    LOG(LS_ERROR) << "Session with encoding "
+                  << encodingName(results_.back().encoding) << " failed: " << reason;
+
+    results_.back().is_failed = true;
+    is_succeeded_ = false;
+
+    finishEncoding();
+    task_runner_->postTask(std::bind(&DesktopBenchmark::runNextEncoding, this));
+}
+
+void DesktopBenchmark::finishEncoding()
+{
+    state_ = State::FINISHED;
+
+    warmup_timer_.stop();
+    duration_timer_.stop();
+    metrics_timer_.stop();
+    timeout_timer_.stop();
+
+    // The late calls of the stopped client are not counted for the next encoding.
+    if (desktop_window_proxy_)
+    {
+        desktop_window_proxy_->dettach();
+        desktop_window_proxy_.reset();
+    }
+
+    if (status_window_proxy_)
+    {
+        status_window_proxy_->dettach();
+        status_window_proxy_.reset();
+    }
+
+    desktop_control_proxy_.reset();
+    client_proxy_.reset();
+}
+
+void DesktopBenchmark::printReport() const
+{
+    const LoopbackHost::Options& host = options_.host;
+
+    std::cout << "Frames:    ";
+    if (host.corpus.empty())
+        std::cout << "synthetic " << host.screen_width << "x" << host.screen_height;
+    else
+        std::cout << host.corpus.u8string();
+    std::cout << std::endl << std::endl;
+
+    std::cout << std::left << std::setw(10) << "Encoding"
+              << std::right
+              << std::setw(10) << "FPS"
+              << std::setw(12) << "Captured"
+              << std::setw(12) << "Mbit/s"
+              << std::setw(14) << "Latency ms"
+              << std::setw(10) << "Max ms"
+              << std::setw(12) << "Encode ms"
+              << std::setw(12) << "Decode ms" << std::endl;
+
+    std::cout << std::fixed << std::setprecision(2);
+
+    for (const Result& result : results_)
+    {
+        std::cout << std::left << std::setw(10) << encodingName(result.encoding) << std::right;
+
+        if (result.is_failed || result.seconds <= 0)
+        {
+            std::cout << std::setw(10) << "failed" << std::endl;
+            continue;
+        }
+
+        const double megabits = static_cast<double>(result.received_bytes) * 8 / 1000000;
+
+        std::cout << std::setw(10) << static_cast<double>(result.drawn_frames) / result.seconds
+                  << std::setw(12) << static_cast<double>(result.captured_frames) / result.seconds
+                  << std::setw(12) << megabits / result.seconds
+                  << std::setw(14) << milliseconds(result.glass_to_glass, result.report_count)
+                  << std::setw(10) << milliseconds(result.max_glass_to_glass, 1)
+                  << std::setw(12) << milliseconds(result.encode, result.report_count)
+                  << std::setw(12) << milliseconds(result.decode, result.report_count)
+                  << std::endl;
+    }
+}
+
+} // namespace host
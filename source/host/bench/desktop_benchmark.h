@@ -0,0 +1,159 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef HOST_BENCH_DESKTOP_BENCHMARK_H
+#define HOST_BENCH_DESKTOP_BENCHMARK_H
+
+#include "base/waitable_timer.h"
+#include "client/desktop_window.h"
+#include "client/status_window.h"
+#include "host/bench/loopback_host.h"
+
+#include <vector>
+
+namespace base {
+class Thread;
+} // namespace base
+
+namespace client {
+class ClientProxy;
+class DesktopWindowProxy;
+class StatusWindowProxy;
+} // namespace client
+
+namespace host {
+
+// Runs a full desktop session for each video encoding: the frames of LoopbackHost are encoded by
+// ClientSessionDesktop, sent over a local TCP connection and decoded by ClientDesktop. The window
+// of the client only counts the drawn frames, so the results do not depend on the UI.
+class DesktopBenchmark
+    : public client::DesktopWindow,
+      public client::StatusWindow
+{
+public:
+    struct Options
+    {
+        LoopbackHost::Options host;
+
+        std::vector<proto::VideoEncoding> encodings =
+        {
+            proto::VIDEO_ENCODING_VP8, proto::VIDEO_ENCODING_VP9, proto::VIDEO_ENCODING_ZSTD
+        };
+
+        std::chrono::seconds duration { 10 };
+        std::chrono::seconds warmup { 2 };
+    };
+
+    DesktopBenchmark(std::shared_ptr<base::TaskRunner> task_runner, const Options& options);
+    ~DesktopBenchmark() override;
+
+    bool start();
+
+    // Returns true if all encodings were measured without errors.
+    bool isSucceeded() const { return is_succeeded_; }
+
+protected:
+    // client::DesktopWindow implementation.
+    void showWindow(std::shared_ptr<client::DesktopControlProxy> desktop_control_proxy,
+                    const base::Version& peer_version) override;
+    void configRequired() override;
+    void setCapabilities(const std::string& extensions, uint32_t video_encodings) override;
+    void setScreenList(const proto::ScreenList& screen_list) override;
+    void setCursorPosition(const proto::CursorPosition& cursor_position) override;
+    void setSystemInfo(const proto::system_info::SystemInfo& system_info) override;
+    void setTaskManager(const proto::task_manager::HostToClient& message) override;
+    void setMetrics(const Metrics& metrics) override;
+    std::unique_ptr<client::FrameFactory> frameFactory() override;
+    void setFrameError(proto::VideoErrorCode error_code) override;
+    void setFrame(const base::Size& screen_size, std::shared_ptr<base::Frame> frame) override;
+    void drawFrame(std::shared_ptr<base::Frame> frame,
+                   const base::Region& updated_region) override;
+    void setMouseCursor(std::shared_ptr<base::MouseCursor> mouse_cursor) override;
+
+    // client::StatusWindow implementation.
+    void onStarted(const std::u16string& address_or_id) override;
+    void onStopped() override;
+    void onConnected() override;
+    void onDisconnected(base::TcpChannel::ErrorCode error_code) override;
+    void onAccessDenied(base::ClientAuthenticator::ErrorCode error_code) override;
+    void onRouterError(const client::RouterController::Error& error) override;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // The measurement starts and ends with the metrics reports of the client, so that the received
+    // bytes are counted for the same time as the frames.
+    enum class State { CONNECTING, WARMUP, STARTING, MEASURING, STOPPING, FINISHED };
+
+    struct Result
+    {
+        proto::VideoEncoding encoding = proto::VIDEO_ENCODING_UNKNOWN;
+        bool is_failed = false;
+        double seconds = 0;
+        int64_t drawn_frames = 0;
+        int64_t captured_frames = 0;
+        int64_t received_bytes = 0;
+
+        // Sums of the averages of the metrics reports.
+        int64_t report_count = 0;
+        std::chrono::microseconds glass_to_glass { 0 };
+        std::chrono::microseconds max_glass_to_glass { 0 };
+        std::chrono::microseconds encode { 0 };
+        std::chrono::microseconds decode { 0 };
+    };
+
+    void runNextEncoding();
+    void onWarmupFinished();
+    void onMetricsTimer();
+    void onDurationFinished();
+    void onEncodingFailed(const char* reason);
+    void finishEncoding();
+    void printReport() const;
+
+    std::shared_ptr<base::TaskRunner> task_runner_;
+    const Options options_;
+
+    LoopbackHost host_;
+    std::unique_ptr<base::Thread> io_thread_;
+
+    std::shared_ptr<client::DesktopWindowProxy> desktop_window_proxy_;
+    std::shared_ptr<client::StatusWindowProxy> status_window_proxy_;
+    std::shared_ptr<client::DesktopControlProxy> desktop_control_proxy_;
+    std::unique_ptr<client::ClientProxy> client_proxy_;
+
+    base::WaitableTimer warmup_timer_;
+    base::WaitableTimer duration_timer_;
+    base::WaitableTimer metrics_timer_;
+    base::WaitableTimer timeout_timer_;
+
+    State state_ = State::FINISHED;
+    size_t encoding_index_ = 0;
+    std::vector<Result> results_;
+    bool is_succeeded_ = true;
+
+    Clock::time_point start_time_;
+    int64_t start_drawn_frames_ = 0;
+    int64_t start_captured_frames_ = 0;
+    int64_t start_received_bytes_ = 0;
+    int64_t drawn_frames_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(DesktopBenchmark);
+};
+
+} // namespace host
+
+#endif // HOST_BENCH_DESKTOP_BENCHMARK_H
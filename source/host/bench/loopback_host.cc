@@ -0,0 +1,555 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "host/bench/loopback_host.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+#include "base/waitable_event.h"
+#include "base/waitable_timer.h"
+#include "base/desktop/frame_corpus.h"
+#include "base/desktop/frame_simple.h"
+#include "base/net/tcp_channel.h"
+#include "base/net/tcp_server.h"
+#include "base/peer/server_authenticator_manager.h"
+#include "base/peer/user_list.h"
+#include "base/threading/thread.h"
+#include "host/client_session_desktop.h"
+#include "host/desktop_session.h"
+#include "host/desktop_session_proxy.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace host {
+
+namespace {
+
+// Width of the synthetic video and the step of its movement.
+const int kVideoWidth = 320;
+const int kVideoHeight = 240;
+const int kVideoStep = 8;
+
+// Replays the frames on a timer with the capture rate of the client sessions.
+class ReplayDesktopSession : public DesktopSession
+{
+public:
+    ReplayDesktopSession(std::shared_ptr<base::TaskRunner> task_runner,
+                         Delegate* delegate,
+                         std::atomic_int64_t* captured_frames)
+        : delegate_(delegate),
+          captured_frames_(captured_frames),
+          timer_(base::WaitableTimer::Type::REPEATED, std::move(task_runner))
+    {
+        DCHECK(delegate_ && captured_frames_);
+    }
+
+    ~ReplayDesktopSession() override = default;
+
+    bool init(const LoopbackHost::Options& options)
+    {
+        base::Size screen_size(options.screen_width, options.screen_height);
+
+        if (!options.corpus.empty())
+        {
+            corpus_ = std::make_unique<base::FrameCorpusReader>();
+            if (!corpus_->open(options.corpus))
+            {
+                LOG(LS_ERROR) << "Unable to open frame corpus: " << options.corpus;
+                return false;
+            }
+
+            screen_size = corpus_->screenSize();
+        }
+
+        frame_ = base::FrameSimple::create(screen_size, base::PixelFormat::ARGB());
+        if (!frame_)
+        {
+            LOG(LS_ERROR) << "Unable to create frame";
+            return false;
+        }
+
+        memset(frame_->frameData(), 0, frame_->memorySize());
+        return true;
+    }
+
+    // DesktopSession implementation.
+    void start() override
+    {
+        if (delegate_)
+            delegate_->onDesktopSessionStarted();
+
+        startTimer();
+    }
+
+    void stop() override
+    {
+        timer_.stop();
+        delegate_ = nullptr;
+    }
+
+    void control(proto::internal::DesktopControl::Action /* action */) override
+    {
+        // Nothing
+    }
+
+    void configure(const Config& /* config */) override
+    {
+        // Nothing
+    }
+
+    void selectScreen(const proto::Screen& /* screen */) override
+    {
+        // Nothing
+    }
+
+    void captureScreen() override
+    {
+        // The next frame contains the whole screen.
+        is_full_frame_ = true;
+    }
+
+    void setScreenCaptureFps(int fps) override
+    {
+        if (fps <= 0 || fps == fps_)
+            return;
+
+        fps_ = fps;
+        startTimer();
+    }
+
+    void injectKeyEvent(const proto::KeyEvent& /* event */) override
+    {
+        // Nothing
+    }
+
+    void injectTextEvent(const proto::TextEvent& /* event */) override
+    {
+        // Nothing
+    }
+
+    void injectMouseEvent(const proto::MouseEvent& /* event */) override
+    {
+        // Nothing
+    }
+
+    void injectClipboardEvent(const proto::ClipboardEvent& /* event */) override
+    {
+        // Nothing
+    }
+
+private:
+    void startTimer()
+    {
+        if (!delegate_)
+            return;
+
+        timer_.stop();
+        timer_.start(std::chrono::milliseconds(1000 / fps_), [this]() { onCaptureTimer(); });
+    }
+
+    void onCaptureTimer()
+    {
+        if (!delegate_)
+            return;
+
+        const auto capture_start_time = std::chrono::steady_clock::now();
+
+        if (!nextFrame())
+        {
+            delegate_->onScreenCaptureError(proto::VIDEO_ERROR_CODE_PERMANENT);
+            return;
+        }
+
+        if (is_full_frame_)
+        {
+            frame_->updatedRegion()->setRect(base::Rect::makeSize(frame_->size()));
+            is_full_frame_ = false;
+        }
+
+        frame_->setCaptureStartTime(capture_start_time);
+        frame_->setCaptureTime(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - capture_start_time));
+
+        captured_frames_->fetch_add(1, std::memory_order_relaxed);
+        delegate_->onScreenCaptured(frame_.get(), nullptr);
+    }
+
+    bool nextFrame()
+    {
+        if (!corpus_)
+        {
+            generateFrame();
+            return true;
+        }
+
+        if (corpus_->readFrame(frame_.get()))
+            return true;
+
+        // The first frame of the corpus contains the whole screen.
+        return corpus_->rewind() && corpus_->readFrame(frame_.get());
+    }
+
+    // A video moves over the screen, the previous position is cleared.
+    void generateFrame()
+    {
+        const base::Rect screen_rect = base::Rect::makeSize(frame_->size());
+        base::Region* updated_region = frame_->updatedRegion();
+        updated_region->clear();
+
+        base::Rect old_rect = video_rect_;
+        old_rect.intersectWith(screen_rect);
+        fillRect(old_rect, 0);
+        updated_region->addRect(old_rect);
+
+        video_x_ = (video_x_ + kVideoStep) % std::max(screen_rect.width() - kVideoWidth, 1);
+        video_rect_ = base::Rect::makeXYWH(
+            video_x_, (screen_rect.height() - kVideoHeight) / 2, kVideoWidth, kVideoHeight);
+        video_rect_.intersectWith(screen_rect);
+
+        for (int y = video_rect_.top(); y < video_rect_.bottom(); ++y)
+        {
+            uint32_t* row = reinterpret_cast<uint32_t*>(frame_->frameDataAtPos(video_rect_.x(), y));
+            for (int x = 0; x < video_rect_.width(); ++x)
+            {
+                seed_ = seed_ * 1103515245 + 12345;
+                row[x] = 0xFF000000 | (seed_ >> 8);
+            }
+        }
+
+        updated_region->addRect(video_rect_);
+
+        if (!is_first_frame_generated_)
+        {
+            updated_region->setRect(screen_rect);
+            is_first_frame_generated_ = true;
+        }
+    }
+
+    void fillRect(const base::Rect& rect, uint32_t color)
+    {
+        for (int y = rect.top(); y < rect.bottom(); ++y)
+        {
+            uint32_t* row = reinterpret_cast<uint32_t*>(frame_->frameDataAtPos(rect.x(), y));
+            std::fill(row, row + rect.width(), color);
+        }
+    }
+
+    Delegate* delegate_;
+    std::atomic_int64_t* captured_frames_;
+    base::WaitableTimer timer_;
+    int fps_ = 30;
+
+    std::unique_ptr<base::FrameCorpusReader> corpus_;
+    std::unique_ptr<base::Frame> frame_;
+    bool is_full_frame_ = false;
+
+    base::Rect video_rect_;
+    int video_x_ = 0;
+    uint32_t seed_ = 1;
+    bool is_first_frame_generated_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(ReplayDesktopSession);
+};
+
+} // namespace
+
+class LoopbackHost::Impl
+    : public base::TcpServer::Delegate,
+      public base::ServerAuthenticatorManager::Delegate,
+      public ClientSession::Delegate,
+      public DesktopSession::Delegate
+{
+public:
+    Impl(std::shared_ptr<base::TaskRunner> task_runner, std::atomic_int64_t* captured_frames);
+    ~Impl() override;
+
+    bool start(const Options& options);
+
+protected:
+    // base::TcpServer::Delegate implementation.
+    void onNewConnection(std::unique_ptr<base::TcpChannel> channel) override;
+
+    // base::ServerAuthenticatorManager::Delegate implementation.
+    void onNewSession(base::ServerAuthenticatorManager::SessionInfo&& session_info) override;
+
+    // ClientSession::Delegate implementation.
+    void onClientSessionConfigured() override;
+    void onClientSessionFinished() override;
+    void onClientSessionVideoRecording(
+        const std::string& computer_name, const std::string& user_name, bool started) override;
+    void onClientSessionVideoPaused() override;
+    void onClientSessionTextChat(uint32_t id, const proto::TextChat& text_chat) override;
+
+    // DesktopSession::Delegate implementation.
+    void onDesktopSessionStarted() override;
+    void onDesktopSessionStopped() override;
+    void onScreenCaptured(const base::Frame* frame, const base::MouseCursor* cursor) override;
+    void onScreenCaptureError(proto::VideoErrorCode error_code) override;
+    void onAudioCaptured(const proto::AudioPacket& audio_packet) override;
+    void onCursorPositionChanged(const proto::CursorPosition& cursor_position) override;
+    void onScreenListChanged(const proto::ScreenList& list) override;
+    void onClipboardEvent(const proto::ClipboardEvent& event) override;
+
+private:
+    std::shared_ptr<base::TaskRunner> task_runner_;
+    std::atomic_int64_t* captured_frames_;
+
+    std::unique_ptr<base::TcpServer> server_;
+    std::unique_ptr<base::ServerAuthenticatorManager> authenticator_manager_;
+    std::unique_ptr<ReplayDesktopSession> desktop_session_;
+    base::local_shared_ptr<DesktopSessionProxy> desktop_session_proxy_;
+    std::vector<std::unique_ptr<ClientSessionDesktop>> clients_;
+
+    DISALLOW_COPY_AND_ASSIGN(Impl);
+};
+
+LoopbackHost::Impl::Impl(std::shared_ptr<base::TaskRunner> task_runner,
+                         std::atomic_int64_t* captured_frames)
+    : task_runner_(std::move(task_runner)),
+      captured_frames_(captured_frames),
+      desktop_session_proxy_(base::make_local_shared<DesktopSessionProxy>())
+{
+    DCHECK(task_runner_ && captured_frames_);
+}
+
+LoopbackHost::Impl::~Impl()
+{
+    server_.reset();
+    authenticator_manager_.reset();
+    clients_.clear();
+
+    if (desktop_session_)
+        desktop_session_proxy_->stopAndDettach();
+}
+
+bool LoopbackHost::Impl::start(const Options& options)
+{
+    desktop_session_ = std::make_unique<ReplayDesktopSession>(
+        task_runner_, this, captured_frames_);
+    if (!desktop_session_->init(options))
+    {
+        desktop_session_.reset();
+        return false;
+    }
+
+    base::User user = base::User::create(options.username, options.password);
+    if (!user.isValid())
+    {
+        LOG(LS_ERROR) << "Invalid user";
+        return false;
+    }
+
+    user.sessions = proto::SESSION_TYPE_DESKTOP_MANAGE | proto::SESSION_TYPE_DESKTOP_VIEW;
+    user.flags = base::User::ENABLED;
+
+    std::unique_ptr<base::UserList> user_list = base::UserList::createEmpty();
+    user_list->add(user);
+
+    authenticator_manager_ =
+        std::make_unique<base::ServerAuthenticatorManager>(task_runner_, this);
+    authenticator_manager_->setUserList(std::move(user_list));
+
+    desktop_session_proxy_->attachAndStart(desktop_session_.get());
+
+    server_ = std::make_unique<base::TcpServer>();
+    server_->start(u"127.0.0.1", options.port, this);
+    return true;
+}
+
+void LoopbackHost::Impl::onNewConnection(std::unique_ptr<base::TcpChannel> channel)
+{
+    static const size_t kReadBufferSize = 1 * 1024 * 1024; // 1 Mb.
+
+    channel->setReadBufferSize(kReadBufferSize);
+    channel->setNoDelay(true);
+
+    authenticator_manager_->addNewChannel(std::move(channel));
+}
+
+void LoopbackHost::Impl::onNewSession(base::ServerAuthenticatorManager::SessionInfo&& session_info)
+{
+    // The client is of the same version, so the same channel options as in the host service are
+    // used.
+    session_info.channel->setChannelIdSupport(true);
+    session_info.channel->setMessageBatching(true);
+
+    std::unique_ptr<ClientSession> session = ClientSession::create(
+        static_cast<proto::SessionType>(session_info.session_type),
+        std::move(session_info.channel),
+        task_runner_);
+    if (!session)
+    {
+        LOG(LS_WARNING) << "Invalid client session";
+        return;
+    }
+
+    session->setVersion(session_info.version);
+    session->setComputerName(session_info.computer_name);
+    session->setUserName(session_info.user_name);
+
+    // The user is allowed only the desktop sessions.
+    std::unique_ptr<ClientSessionDesktop> desktop_session(
+        static_cast<ClientSessionDesktop*>(session.release()));
+    desktop_session->setDesktopSessionProxy(desktop_session_proxy_);
+    desktop_session->start(this);
+
+    clients_.emplace_back(std::move(desktop_session));
+}
+
+void LoopbackHost::Impl::onClientSessionConfigured()
+{
+    // Nothing
+}
+
+void LoopbackHost::Impl::onClientSessionFinished()
+{
+    for (auto it = clients_.begin(); it != clients_.end();)
+    {
+        if ((*it)->state() == ClientSession::State::FINISHED)
+        {
+            task_runner_->deleteSoon(std::move(*it));
+            it = clients_.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void LoopbackHost::Impl::onClientSessionVideoRecording(
+    const std::string& /* computer_name */, const std::string& /* user_name */, bool /* started */)
+{
+    // Nothing
+}
+
+void LoopbackHost::Impl::onClientSessionVideoPaused()
+{
+    // Nothing
+}
+
+void LoopbackHost::Impl::onClientSessionTextChat(
+    uint32_t /* id */, const proto::TextChat& /* text_chat */)
+{
+    // Nothing
+}
+
+void LoopbackHost::Impl::onDesktopSessionStarted()
+{
+    LOG(LS_INFO) << "Replay session started";
+}
+
+void LoopbackHost::Impl::onDesktopSessionStopped()
+{
+    LOG(LS_INFO) << "Replay session stopped";
+}
+
+void LoopbackHost::Impl::onScreenCaptured(
+    const base::Frame* frame, const base::MouseCursor* cursor)
+{
+    for (const auto& client : clients_)
+    {
+        if (client->prepareScreen(frame, cursor))
+            client->postScreen();
+    }
+}
+
+void LoopbackHost::Impl::onScreenCaptureError(proto::VideoErrorCode error_code)
+{
+    for (const auto& client : clients_)
+        client->setVideoErrorCode(error_code);
+}
+
+void LoopbackHost::Impl::onAudioCaptured(const proto::AudioPacket& /* audio_packet */)
+{
+    // Nothing
+}
+
+void LoopbackHost::Impl::onCursorPositionChanged(
+    const proto::CursorPosition& /* cursor_position */)
+{
+    // Nothing
+}
+
+void LoopbackHost::Impl::onScreenListChanged(const proto::ScreenList& /* list */)
+{
+    // Nothing
+}
+
+void LoopbackHost::Impl::onClipboardEvent(const proto::ClipboardEvent& /* event */)
+{
+    // Nothing
+}
+
+LoopbackHost::LoopbackHost() = default;
+
+LoopbackHost::~LoopbackHost()
+{
+    stop();
+}
+
+bool LoopbackHost::start(const Options& options)
+{
+    if (thread_)
+    {
+        LOG(LS_ERROR) << "Host already started";
+        return false;
+    }
+
+    thread_ = std::make_unique<base::Thread>();
+    thread_->start(base::MessageLoop::Type::ASIO);
+
+    bool result = false;
+
+    runAndWait([&]()
+    {
+        impl_ = std::make_unique<Impl>(thread_->taskRunner(), &captured_frames_);
+        result = impl_->start(options);
+    });
+
+    if (!result)
+        stop();
+
+    return result;
+}
+
+void LoopbackHost::stop()
+{
+    if (!thread_)
+        return;
+
+    runAndWait([this]() { impl_.reset(); });
+
+    thread_->stop();
+    thread_.reset();
+}
+
+void LoopbackHost::runAndWait(std::function<void()> task)
+{
+    base::WaitableEvent event;
+
+    thread_->taskRunner()->postTask([&]()
+    {
+        task();
+        event.signal();
+    });
+
+    event.wait();
+}
+
+} // namespace host
@@ -0,0 +1,80 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef HOST_BENCH_LOOPBACK_HOST_H
+#define HOST_BENCH_LOOPBACK_HOST_H
+
+#include "base/macros_magic.h"
+#include "host/host_export.h"
+
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace base {
+class Thread;
+} // namespace base
+
+namespace host {
+
+// Runs the host side of desktop sessions in the current process. The connections are
+// authenticated and served by the same classes as in the host service, but the screen is replaced
+// by a frame corpus or by synthetic frames. All objects of the host live on its own thread, so the
+// class can be used by executables that link the host library dynamically.
+class HOST_EXPORT LoopbackHost
+{
+public:
+    struct Options
+    {
+        uint16_t port = 18091;
+        std::u16string username = u"bench";
+        std::u16string password = u"bench";
+
+        // Frame corpus to replay in a loop. If empty, synthetic frames are generated.
+        std::filesystem::path corpus;
+
+        // Screen size of the synthetic frames.
+        int screen_width = 1920;
+        int screen_height = 1080;
+    };
+
+    LoopbackHost();
+    ~LoopbackHost();
+
+    bool start(const Options& options);
+    void stop();
+
+    // Number of frames passed to the client sessions. Can be called on any thread.
+    int64_t capturedFrames() const { return captured_frames_.load(std::memory_order_relaxed); }
+
+private:
+    class Impl;
+
+    void runAndWait(std::function<void()> task);
+
+    std::unique_ptr<base::Thread> thread_;
+    std::unique_ptr<Impl> impl_; // Used only on |thread_|.
+    std::atomic_int64_t captured_frames_ { 0 };
+
+    DISALLOW_COPY_AND_ASSIGN(LoopbackHost);
+};
+
+} // namespace host
+
+#endif // HOST_BENCH_LOOPBACK_HOST_H
@@ -0,0 +1,173 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/command_line.h"
+#include "base/logging.h"
+#include "base/crypto/scoped_crypto_initializer.h"
+#include "base/message_loop/message_loop.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
+#include "base/strings/unicode.h"
+#include "host/bench/desktop_benchmark.h"
+
+#include <iostream>
+
+namespace {
+
+void showHelp()
+{
+    std::cout << "aspia_desktop_bench [switch]" << std::endl
+        << "Available switches:" << std::endl
+        << '\t' << "--encodings=LIST" << '\t' << "Comma separated list of vp8, vp9, zstd, h264 and "
+        << "hevc (vp8,vp9,zstd)" << std::endl
+        << '\t' << "--corpus=PATH" << '\t' << "Recorded frame corpus, synthetic frames if not set"
+        << std::endl
+        << '\t' << "--width=N" << '\t' << "Width of the synthetic frames (1920)" << std::endl
+        << '\t' << "--height=N" << '\t' << "Height of the synthetic frames (1080)" << std::endl
+        << '\t' << "--duration=S" << '\t' << "Measurement time of each encoding in seconds (10)"
+        << std::endl
+        << '\t' << "--warmup=S" << '\t' << "Time before the measurement in seconds (2)"
+        << std::endl
+        << '\t' << "--port=N" << '\t' << "Port of the loopback host (18091)" << std::endl
+        << '\t' << "--help" << '\t' << "Show help" << std::endl;
+}
+
+bool readSwitch(const base::CommandLine& command_line, std::u16string_view name,
+                unsigned int min_value, unsigned int max_value, unsigned int* value)
+{
+    if (!command_line.hasSwitch(name))
+        return true;
+
+    unsigned int result;
+    if (!base::stringToUint(command_line.switchValue(name), &result) ||
+        result < min_value || result > max_value)
+    {
+        std::cout << "Invalid value of switch --" << base::utf8FromUtf16(name) << std::endl;
+        return false;
+    }
+
+    *value = result;
+    return true;
+}
+
+bool parseEncodings(const std::u16string& value, std::vector<proto::VideoEncoding>* encodings)
+{
+    encodings->clear();
+
+    for (const auto& name : base::splitString(
+             value, u",", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY))
+    {
+        if (name == u"vp8")
+            encodings->emplace_back(proto::VIDEO_ENCODING_VP8);
+        else if (name == u"vp9")
+            encodings->emplace_back(proto::VIDEO_ENCODING_VP9);
+        else if (name == u"zstd")
+            encodings->emplace_back(proto::VIDEO_ENCODING_ZSTD);
+        else if (name == u"h264")
+            encodings->emplace_back(proto::VIDEO_ENCODING_H264);
+        else if (name == u"hevc")
+            encodings->emplace_back(proto::VIDEO_ENCODING_HEVC);
+        else
+        {
+            std::cout << "Unknown encoding: " << base::utf8FromUtf16(name) << std::endl;
+            return false;
+        }
+    }
+
+    return !encodings->empty();
+}
+
+bool parseOptions(const base::CommandLine& command_line, host::DesktopBenchmark::Options* options)
+{
+    unsigned int duration = static_cast<unsigned int>(options->duration.count());
+    unsigned int warmup = static_cast<unsigned int>(options->warmup.count());
+    unsigned int port = options->host.port;
+    unsigned int width = static_cast<unsigned int>(options->host.screen_width);
+    unsigned int height = static_cast<unsigned int>(options->host.screen_height);
+
+    if (!readSwitch(command_line, u"duration", 1, 3600, &duration) ||
+        !readSwitch(command_line, u"warmup", 0, 3600, &warmup) ||
+        !readSwitch(command_line, u"port", 1, 65535, &port) ||
+        !readSwitch(command_line, u"width", 64, 8192, &width) ||
+        !readSwitch(command_line, u"height", 64, 8192, &height))
+    {
+        return false;
+    }
+
+    if (command_line.hasSwitch(u"encodings") &&
+        !parseEncodings(command_line.switchValue(u"encodings"), &options->encodings))
+    {
+        return false;
+    }
+
+    if (command_line.hasSwitch(u"corpus"))
+        options->host.corpus = command_line.switchValuePath(u"corpus");
+
+    options->duration = std::chrono::seconds(duration);
+    options->warmup = std::chrono::seconds(warmup);
+    options->host.port = static_cast<uint16_t>(port);
+    options->host.screen_width = static_cast<int>(width);
+    options->host.screen_height = static_cast<int>(height);
+
+    return true;
+}
+
+} // namespace
+
+int main(int argc, const char* const* argv)
+{
+    base::initLogging();
+
+    base::CommandLine::init(argc, argv);
+    base::CommandLine* command_line = base::CommandLine::forCurrentProcess();
+
+    if (command_line->hasSwitch(u"help"))
+    {
+        showHelp();
+        return 0;
+    }
+
+    host::DesktopBenchmark::Options options;
+    if (!parseOptions(*command_line, &options))
+    {
+        showHelp();
+        return 1;
+    }
+
+    std::unique_ptr<base::ScopedCryptoInitializer> crypto_initializer =
+        std::make_unique<base::ScopedCryptoInitializer>();
+
+    std::unique_ptr<base::MessageLoop> message_loop =
+        std::make_unique<base::MessageLoop>(base::MessageLoop::Type::DEFAULT);
+
+    std::unique_ptr<host::DesktopBenchmark> benchmark =
+        std::make_unique<host::DesktopBenchmark>(message_loop->taskRunner(), options);
+
+    bool succeeded = false;
+    if (benchmark->start())
+    {
+        message_loop->run();
+        succeeded = benchmark->isSucceeded();
+    }
+
+    benchmark.reset();
+    message_loop.reset();
+    crypto_initializer.reset();
+
+    base::shutdownLogging();
+    return succeeded ? 0 : 1;
+}
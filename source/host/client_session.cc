@@ -19,14 +19,38 @@
 #include "host/client_session.h"
 
 #include "base/logging.h"
+#include "base/message_loop/message_loop.h"
+#include "base/metrics/metrics_registry.h"
 #include "base/net/tcp_channel_proxy.h"
 #include "host/client_session_desktop.h"
 #include "host/client_session_file_transfer.h"
 #include "host/client_session_system_info.h"
 #include "host/client_session_text_chat.h"
 
+#include <algorithm>
+
 namespace host {
 
+namespace {
+
+// A client that does not read its data stops the reading of its requests at the soft limit and is
+// disconnected at the hard limit. The video stream keeps its queue much shorter by itself.
+const size_t kWriteQueueSoftLimit = 16 * 1024 * 1024; // 16 MB
+const size_t kWriteQueueHardLimit = 64 * 1024 * 1024; // 64 MB
+
+// The memory usage is checked with this interval and logged if it changed noticeably.
+const base::TimerWheel::Milliseconds kMemoryReportInterval(60 * 1000);
+const size_t kMemoryReportThreshold = 4 * 1024 * 1024; // 4 MB
+
+base::Gauge* sessionGauge()
+{
+    static base::Gauge* gauge = base::MetricsRegistry::global().gauge(
+        "host_client_sessions", "Sessions of connected clients.");
+    return gauge;
+}
+
+} // namespace
+
 ClientSession::ClientSession(
     proto::SessionType session_type, std::unique_ptr<base::TcpChannel> channel)
     : session_type_(session_type),
@@ -40,11 +64,13 @@ ClientSession::ClientSession(
     id_ = ++id_counter;
 
     LOG(LS_INFO) << "Ctor: " << id_;
+    sessionGauge()->increment();
 }
 
 ClientSession::~ClientSession()
 {
-    LOG(LS_INFO) << "Dtor: " << id_;
+    LOG(LS_INFO) << "Dtor: " << id_ << " (peak memory usage: " << peak_memory_ << " bytes)";
+    sessionGauge()->decrement();
 }
 
 // static
@@ -93,8 +119,13 @@ void ClientSession::start(Delegate* delegate)
 
     channel_->setListener(this);
     channel_->setKeepAlive(true);
+    channel_->setWriteQueueLimits(kWriteQueueSoftLimit, kWriteQueueHardLimit);
     channel_->resume();
 
+    base::MessageLoop::current()->startTimer(
+        &memory_report_timer_, kMemoryReportInterval,
+        std::bind(&ClientSession::onMemoryReportTimer, this));
+
     onStarted();
 }
 
@@ -102,6 +133,9 @@ void ClientSession::stop()
 {
     LOG(LS_INFO) << "Stop client session";
 
+    memory_report_timer_.cancel();
+    logMemoryUsage(memoryUsage());
+
     state_ = State::FINISHED;
     delegate_->onClientSessionFinished();
 }
@@ -131,14 +165,31 @@ void ClientSession::setSessionId(base::SessionId session_id)
     session_id_ = session_id;
 }
 
+ClientSession::MemoryUsage ClientSession::memoryUsage()
+{
+    MemoryUsage usage;
+    usage.write_queue = channel_->pendingBytes();
+
+    addMemoryUsage(&usage);
+
+    peak_memory_ = std::max(peak_memory_, usage.total());
+    return usage;
+}
+
+void ClientSession::addMemoryUsage(MemoryUsage* /* usage */)
+{
+    // Nothing
+}
+
 std::shared_ptr<base::TcpChannelProxy> ClientSession::channelProxy()
 {
     return channel_->channelProxy();
 }
 
-void ClientSession::sendMessage(uint8_t channel_id, base::ByteArray&& buffer)
+void ClientSession::sendMessage(uint8_t channel_id, base::ByteArray&& buffer,
+                                base::TcpChannel::Priority priority)
 {
-    channel_->send(channel_id, std::move(buffer));
+    channel_->send(channel_id, std::move(buffer), priority);
 }
 
 void ClientSession::onTcpConnected()
@@ -151,6 +202,9 @@ void ClientSession::onTcpDisconnected(base::NetworkChannel::ErrorCode error_code
     LOG(LS_WARNING) << "Client disconnected with error: "
                     << base::NetworkChannel::errorToString(error_code);
 
+    memory_report_timer_.cancel();
+    logMemoryUsage(memoryUsage());
+
     state_ = State::FINISHED;
     delegate_->onClientSessionFinished();
 }
@@ -192,4 +246,45 @@ size_t ClientSession::pendingMessages() const
     return channel_->pendingMessages();
 }
 
+size_t ClientSession::pendingBytes() const
+{
+    return channel_->pendingBytes();
+}
+
+int64_t ClientSession::totalTx() const
+{
+    return channel_->totalTx();
+}
+
+base::NetworkChannel::Statistics ClientSession::channelStatistics() const
+{
+    return channel_->statistics();
+}
+
+void ClientSession::onMemoryReportTimer()
+{
+    const MemoryUsage usage = memoryUsage();
+    const size_t total = usage.total();
+
+    const size_t change = (total > last_reported_memory_) ?
+        total - last_reported_memory_ : last_reported_memory_ - total;
+    if (change >= kMemoryReportThreshold)
+        logMemoryUsage(usage);
+
+    base::MessageLoop::current()->startTimer(
+        &memory_report_timer_, kMemoryReportInterval,
+        std::bind(&ClientSession::onMemoryReportTimer, this));
+}
+
+void ClientSession::logMemoryUsage(const MemoryUsage& usage)
+{
+    LOG(LS_INFO) << "Memory usage of session " << id_ << ": " << usage.total() << " bytes "
+                 << "(write queue: " << usage.write_queue
+                 << ", video: " << usage.video
+                 << ", file transfer: " << usage.file_transfer
+                 << ", peak: " << peak_memory_ << ")";
+
+    last_reported_memory_ = usage.total();
+}
+
 } // namespace host
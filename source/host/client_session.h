@@ -48,6 +48,7 @@ public:
         virtual void onClientSessionFinished() = 0;
         virtual void onClientSessionVideoRecording(
             const std::string& computer_name, const std::string& user_name, bool started) = 0;
+        virtual void onClientSessionVideoPaused() = 0;
         virtual void onClientSessionTextChat(uint32_t id, const proto::TextChat& text_chat) = 0;
     };
 
@@ -84,6 +85,19 @@ public:
 
     base::HostId hostId() const { return channel_->hostId(); }
 
+    // Approximate amount of memory used by the session in bytes. The messages waiting to be sent
+    // (including the clipboard and the file data) are counted in |write_queue|.
+    struct MemoryUsage
+    {
+        size_t write_queue = 0;
+        size_t video = 0;
+        size_t file_transfer = 0;
+
+        size_t total() const { return write_queue + video + file_transfer; }
+    };
+
+    MemoryUsage memoryUsage();
+
 protected:
     ClientSession(proto::SessionType session_type, std::unique_ptr<base::TcpChannel> channel);
 
@@ -93,8 +107,12 @@ protected:
     virtual void onReceived(uint8_t channel_id, const base::ByteArray& buffer) = 0;
     virtual void onWritten(uint8_t channel_id, size_t pending) = 0;
 
+    // Adds the memory used by the subsystems of the session to |usage|.
+    virtual void addMemoryUsage(MemoryUsage* usage);
+
     std::shared_ptr<base::TcpChannelProxy> channelProxy();
-    void sendMessage(uint8_t channel_id, base::ByteArray&& buffer);
+    void sendMessage(uint8_t channel_id, base::ByteArray&& buffer,
+                     base::TcpChannel::Priority priority = base::TcpChannel::Priority::NORMAL);
 
     // base::TcpChannel::Listener implementation.
     void onTcpConnected() override;
@@ -103,10 +121,16 @@ protected:
     void onTcpMessageWritten(uint8_t channel_id, size_t pending) override;
 
     size_t pendingMessages() const;
+    size_t pendingBytes() const;
+    int64_t totalTx() const;
+    base::NetworkChannel::Statistics channelStatistics() const;
 
     Delegate* delegate_ = nullptr;
 
 private:
+    void onMemoryReportTimer();
+    void logMemoryUsage(const MemoryUsage& usage);
+
     base::SessionId session_id_ = base::kInvalidSessionId;
     State state_ = State::CREATED;
     uint32_t id_;
@@ -116,6 +140,10 @@ private:
     std::string computer_name_;
 
     std::unique_ptr<base::TcpChannel> channel_;
+
+    base::TimerWheel::Timer memory_report_timer_;
+    size_t last_reported_memory_ = 0;
+    size_t peak_memory_ = 0;
 };
 
 } // namespace host
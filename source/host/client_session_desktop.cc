@@ -21,30 +21,84 @@
 #include "base/environment.h"
 #include "base/logging.h"
 #include "base/power_controller.h"
+#include "base/trace_event.h"
+#include "base/strings/unicode.h"
 #include "base/codec/audio_encoder_opus.h"
+#include "base/codec/audio_quality_controller.h"
 #include "base/codec/cursor_encoder.h"
 #include "base/codec/scale_reducer.h"
 #include "base/codec/video_encoder_vpx.h"
 #include "base/codec/video_encoder_zstd.h"
-#include "base/desktop/frame.h"
+#include "base/codec/webm_recorder.h"
+#include "base/desktop/capture_rate_controller.h"
+#include "base/desktop/frame_view.h"
 #include "base/desktop/screen_capturer.h"
+#include "base/net/congestion_controller.h"
+#include "base/threading/worker_pool.h"
 #include "common/desktop_session_constants.h"
 #include "host/desktop_session_proxy.h"
+#include "host/screen_encode_thread.h"
 #include "host/service_constants.h"
+#include "host/system_settings.h"
 #include "proto/desktop_internal.pb.h"
 #include "proto/task_manager.pb.h"
 #include "proto/text_chat.pb.h"
 
 #if defined(OS_WIN)
+#include "base/codec/video_encoder_mf.h"
 #include "base/win/safe_mode_util.h"
+#include "host/process_monitor.h"
 #include "host/system_info.h"
 #include "host/win/updater_launcher.h"
 #endif // defined(OS_WIN)
 
+#include <algorithm>
+#include <limits>
+#include <thread>
+
 namespace host {
 
 namespace {
 
+// Interval for checking the state of the outgoing queue.
+const std::chrono::milliseconds kRateControlInterval(250);
+
+// The bandwidth estimator counts packets of this size.
+const size_t kEstimatorMss = 1400;
+
+// Limits of the target bitrate of the video encoder in kilobits per second.
+const uint32_t kMinVideoBitrate = 100;
+const uint32_t kMaxVideoBitrate = 100000;
+
+// The target bitrate is changed only if it differs from the current one by more than 10%, so
+// that the encoder is not reconfigured on each update.
+const uint32_t kVideoBitrateHysteresis = 10;
+
+// The complexity of the audio encoder is updated on each 8th check of the rate (every 2 seconds),
+// so that the load of the processors is averaged over a longer time.
+const int kAudioComplexityInterval = 8;
+
+// Number of the desktop sessions in the process. The audio of each of them is encoded separately.
+std::atomic<size_t> g_desktop_session_count { 0 };
+
+// Maximum number of threads that encode the streams of the monitors.
+const int kMaxScreenStreamThreads = 8;
+
+// The frames are skipped if the outgoing queue holds more than this amount of data or more than
+// kMaxBacklogTime of transmission at the estimated throughput. Encoding is resumed when the queue
+// drains to a half of the limit.
+const size_t kMinBacklogBytes = 512 * 1024;
+const std::chrono::milliseconds kMaxBacklogTime(300);
+
+// The flags of the configuration that change the video stream. The clients share the encoding of
+// the screen only if these flags are the same.
+const uint32_t kSharedVideoFlags = proto::VP9_MULTITHREADED | proto::VP9_I444;
+
+// Limits of the messages kept by the leader after its last key frame. A follower that joins
+// after the limit is reached waits for a new key frame.
+const size_t kMaxScreenCacheBytes = 8 * 1024 * 1024; // 8 MB
+const size_t kMaxScreenCacheMessages = 300;
+
 base::PixelFormat parsePixelFormat(const proto::PixelFormat& format)
 {
     return base::PixelFormat(
@@ -57,22 +111,138 @@ base::PixelFormat parsePixelFormat(const proto::PixelFormat& format)
         static_cast<uint8_t>(format.blue_shift()));
 }
 
+bool isI420Encoding(proto::VideoEncoding encoding)
+{
+    return encoding == proto::VIDEO_ENCODING_VP8 || encoding == proto::VIDEO_ENCODING_VP9;
+}
+
+// The hardware encoders are used only on the thread that created them.
+bool isHardwareEncoding(proto::VideoEncoding encoding)
+{
+    return encoding == proto::VIDEO_ENCODING_H264 || encoding == proto::VIDEO_ENCODING_HEVC;
+}
+
+std::unique_ptr<base::VideoEncoder> createVideoEncoder(const proto::DesktopConfig& config)
+{
+    std::unique_ptr<base::VideoEncoder> video_encoder;
+
+    switch (config.video_encoding())
+    {
+        case proto::VIDEO_ENCODING_VP8:
+            video_encoder = base::VideoEncoderVPX::createVP8();
+            break;
+
+        case proto::VIDEO_ENCODING_VP9:
+        {
+            std::unique_ptr<base::VideoEncoderVPX> encoder = base::VideoEncoderVPX::createVP9();
+            encoder->setTileColumnsEnabled(config.flags() & proto::VP9_MULTITHREADED);
+            encoder->setI444Mode(config.flags() & proto::VP9_I444);
+
+            if (config.flags() & proto::HYBRID_ENCODING)
+            {
+                // The pixel format of the config is chosen for ZSTD. The text is kept in full
+                // color, it is compressed well anyway.
+                std::unique_ptr<base::VideoEncoderZstd> lossless_encoder =
+                    base::VideoEncoderZstd::create(base::PixelFormat::ARGB(),
+                                                   static_cast<int>(config.compress_ratio()));
+                lossless_encoder->setSliceEncoding(config.flags() & proto::ZSTD_SLICES);
+                lossless_encoder->setPaletteCoding(config.flags() & proto::ZSTD_PALETTE);
+                lossless_encoder->setPackedRects(config.flags() & proto::PACKED_RECTS);
+                encoder->setLosslessEncoder(std::move(lossless_encoder));
+
+                // VP9 gets only the natural content then.
+                encoder->setScreenContentMode(false);
+            }
+
+            video_encoder = std::move(encoder);
+        }
+        break;
+
+        case proto::VIDEO_ENCODING_ZSTD:
+        {
+            std::unique_ptr<base::VideoEncoderZstd> encoder = base::VideoEncoderZstd::create(
+                parsePixelFormat(config.pixel_format()), static_cast<int>(config.compress_ratio()));
+            encoder->setSliceEncoding(config.flags() & proto::ZSTD_SLICES);
+            encoder->setStreamMode(config.flags() & proto::ZSTD_STREAM);
+            encoder->setCopyRects(config.flags() & proto::COPY_RECTS);
+            encoder->setPaletteCoding(config.flags() & proto::ZSTD_PALETTE);
+            video_encoder = std::move(encoder);
+        }
+        break;
+
+#if defined(OS_WIN)
+        case proto::VIDEO_ENCODING_H264:
+        case proto::VIDEO_ENCODING_HEVC:
+        {
+            video_encoder = base::VideoEncoderMF::create(config.video_encoding());
+            if (!video_encoder)
+            {
+                // The client decodes packets according to their encoding, so the session keeps
+                // working after the fallback.
+                LOG(LS_WARNING) << "Hardware encoder not available. Using VP9";
+                video_encoder = base::VideoEncoderVPX::createVP9();
+            }
+        }
+        break;
+#endif // defined(OS_WIN)
+
+        default:
+        {
+            // No supported video encoding.
+            LOG(LS_WARNING) << "Unsupported video encoding: " << config.video_encoding();
+        }
+        break;
+    }
+
+    if (video_encoder)
+        video_encoder->setPackedRects(config.flags() & proto::PACKED_RECTS);
+
+    return video_encoder;
+}
+
+double dirtyFraction(const base::Frame* frame)
+{
+    const int64_t frame_area =
+        static_cast<int64_t>(frame->size().width()) * frame->size().height();
+    if (!frame_area)
+        return 0;
+
+    int64_t dirty_area = 0;
+
+    for (base::Region::Iterator it(frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
+        dirty_area += static_cast<int64_t>(it.rect().width()) * it.rect().height();
+
+    return static_cast<double>(dirty_area) / static_cast<double>(frame_area);
+}
+
 } // namespace
 
 ClientSessionDesktop::ClientSessionDesktop(proto::SessionType session_type,
                                            std::unique_ptr<base::TcpChannel> channel,
                                            std::shared_ptr<base::TaskRunner> task_runner)
     : ClientSession(session_type, std::move(channel)),
-      overflow_detection_timer_(base::WaitableTimer::Type::REPEATED, std::move(task_runner)),
-      incoming_message_(std::make_unique<proto::ClientToHost>()),
-      outgoing_message_(std::make_unique<proto::HostToClient>())
+      task_runner_(task_runner),
+      rate_control_timer_(base::WaitableTimer::Type::REPEATED, task_runner),
+      capture_size_timer_(base::WaitableTimer::Type::SINGLE_SHOT, std::move(task_runner))
 {
     LOG(LS_INFO) << "Ctor";
+    ++g_desktop_session_count;
 }
 
 ClientSessionDesktop::~ClientSessionDesktop()
 {
     LOG(LS_INFO) << "Dtor";
+    --g_desktop_session_count;
+
+    setScreenLeader(nullptr);
+    while (!screen_followers_.empty())
+        screen_followers_.back()->setScreenLeader(nullptr);
+
+    // The encoding thread uses the encoders.
+    encode_thread_.reset();
+
+    // The trace of the ended session is written if tracing is enabled.
+    base::TraceLog::instance().dump();
 }
 
 void ClientSessionDesktop::setDesktopSessionProxy(
@@ -84,23 +254,31 @@ void ClientSessionDesktop::setDesktopSessionProxy(
 
 void ClientSessionDesktop::onStarted()
 {
-    max_fps_ = desktop_session_proxy_->maxScreenCaptureFps();
-
     if (!base::Environment::has("ASPIA_NO_OVERFLOW_DETECTION"))
     {
-        LOG(LS_INFO) << "Overflow detection enabled (current FPS: "
+        rate_controller_ = std::make_unique<base::CaptureRateController>(
+            desktop_session_proxy_->minScreenCaptureFps(),
+            desktop_session_proxy_->maxScreenCaptureFps(),
+            desktop_session_proxy_->screenCaptureFps());
+
+        LOG(LS_INFO) << "Rate control enabled (current FPS: "
                      << desktop_session_proxy_->screenCaptureFps()
-                     << ", max FPS: " << max_fps_ << ")";
+                     << ", min FPS: " << rate_controller_->minFps()
+                     << ", max FPS: " << rate_controller_->maxFps() << ")";
 
-        overflow_detection_timer_.start(std::chrono::milliseconds(1000),
-            std::bind(&ClientSessionDesktop::onOverflowDetectionTimer, this));
+        bandwidth_estimator_ = std::make_unique<base::CongestionController>(kEstimatorMss);
+
+        rate_control_timer_.start(kRateControlInterval,
+            std::bind(&ClientSessionDesktop::onRateControlTimer, this));
     }
     else
     {
-        LOG(LS_INFO) << "Overflow detection disabled by environment variable (current FPS: "
+        LOG(LS_INFO) << "Rate control disabled by environment variable (current FPS: "
                      << desktop_session_proxy_->screenCaptureFps() << ")";
     }
 
+    startSessionRecording();
+
     const char* extensions;
 
     // Supported extensions are different for managing and viewing the desktop.
@@ -119,7 +297,14 @@ void ClientSessionDesktop::onStarted()
 
     // Add supported extensions and video encodings.
     request->set_extensions(extensions);
-    request->set_video_encodings(common::kSupportedVideoEncodings);
+    uint32_t video_encodings = common::kSupportedVideoEncodings;
+
+#if defined(OS_WIN)
+    // H.264 and HEVC are offered only if the video adapter can encode them.
+    video_encodings |= base::VideoEncoderMF::supportedEncodings();
+#endif // defined(OS_WIN)
+
+    request->set_video_encodings(video_encodings);
     request->set_audio_encodings(common::kSupportedAudioEncodings);
 
     LOG(LS_INFO) << "Sending config request";
@@ -133,7 +318,7 @@ void ClientSessionDesktop::onStarted()
 
 void ClientSessionDesktop::onReceived(uint8_t /* channel_id */, const base::ByteArray& buffer)
 {
-    incoming_message_->Clear();
+    incoming_message_.clear();
 
     if (!base::parse(buffer, incoming_message_.get()))
     {
@@ -146,15 +331,16 @@ void ClientSessionDesktop::onReceived(uint8_t /* channel_id */, const base::Byte
         if (sessionType() != proto::SESSION_TYPE_DESKTOP_MANAGE)
             return;
 
-        if (!scale_reducer_)
+        // No frames were sent yet.
+        if (scale_factor_x_ <= 0 || scale_factor_y_ <= 0)
             return;
 
         const proto::MouseEvent& mouse_event = incoming_message_->mouse_event();
 
         int pos_x = static_cast<int>(
-            static_cast<double>(mouse_event.x() * 100) / scale_reducer_->scaleFactorX());
+            static_cast<double>(mouse_event.x() * 100) / scale_factor_x_);
         int pos_y = static_cast<int>(
-            static_cast<double>(mouse_event.y() * 100) / scale_reducer_->scaleFactorY());
+            static_cast<double>(mouse_event.y() * 100) / scale_factor_y_);
 
         proto::MouseEvent out_mouse_event;
         out_mouse_event.set_mask(mouse_event.mask());
@@ -162,6 +348,17 @@ void ClientSessionDesktop::onReceived(uint8_t /* channel_id */, const base::Byte
         out_mouse_event.set_y(pos_y);
 
         desktop_session_proxy_->injectMouseEvent(out_mouse_event);
+
+        if (mouse_event.input_id())
+        {
+            // The event is injected before the next capture starts, so the next frame reflects it.
+            std::scoped_lock lock(updates_lock_);
+            input_probe_id_ = mouse_event.input_id();
+            input_probe_time_ = std::chrono::steady_clock::now();
+        }
+
+        // The client sends the position in the coordinates of the encoded frame.
+        setEncoderCursorPosition(base::Point(mouse_event.x(), mouse_event.y()));
     }
     else if (incoming_message_->has_key_event())
     {
@@ -193,6 +390,28 @@ void ClientSessionDesktop::onReceived(uint8_t /* channel_id */, const base::Byte
     }
 }
 
+void ClientSessionDesktop::addMemoryUsage(MemoryUsage* usage)
+{
+    {
+        std::scoped_lock lock(encode_lock_);
+
+        if (scale_reducer_)
+            usage->video += scale_reducer_->memoryUsage();
+
+        if (video_encoder_)
+            usage->video += video_encoder_->memoryUsage();
+
+        for (const ScreenStream& stream : screen_streams_)
+        {
+            if (stream.encoder)
+                usage->video += stream.encoder->memoryUsage();
+        }
+    }
+
+    if (merged_frame_)
+        usage->video += merged_frame_->memorySize();
+}
+
 void ClientSessionDesktop::onWritten(uint8_t /* channel_id */, size_t /* pending */)
 {
     // Nothing
@@ -201,7 +420,7 @@ void ClientSessionDesktop::onWritten(uint8_t /* channel_id */, size_t /* pending
 #if defined(OS_WIN)
 void ClientSessionDesktop::onTaskManagerMessage(const proto::task_manager::HostToClient& message)
 {
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
 
     proto::DesktopExtension* extension = outgoing_message_->mutable_extension();
     extension->set_name(common::kTaskManagerExtension);
@@ -211,26 +430,63 @@ void ClientSessionDesktop::onTaskManagerMessage(const proto::task_manager::HostT
 }
 #endif // defined(OS_WIN)
 
-void ClientSessionDesktop::encodeScreen(const base::Frame* frame, const base::MouseCursor* cursor)
+bool ClientSessionDesktop::prepareScreen(const base::Frame* frame, const base::MouseCursor* cursor)
 {
+    DCHECK(!prepared_frame_ && !prepared_cursor_);
+
     if (critical_overflow_)
-        return;
+    {
+        skipFrame(frame);
+        return false;
+    }
 
-    outgoing_message_->Clear();
+    if (frame && isBacklogged())
+    {
+        // The cursor is still sent, it is small and shows that the session is alive.
+        skipFrame(frame);
+        frame = nullptr;
+    }
 
-    if (!is_video_paused_ && frame && video_encoder_)
+    if (frame && screen_leader_)
     {
-        DCHECK(scale_reducer_);
+        // The leader encodes the frame. The updated region is kept for the own encoder.
+        skipFrame(frame);
+        frame = nullptr;
+    }
+
+    if (frame && has_skipped_frames_)
+    {
+        merged_frame_ = takeSkippedFrames(frame);
+        if (merged_frame_)
+            frame = merged_frame_.get();
+    }
+
+    if (is_video_paused_ || video_encoding_ == proto::VIDEO_ENCODING_UNKNOWN)
+        frame = nullptr;
+
+    base::Size current_size;
 
-        if (source_size_ != frame->size())
+    if (frame)
+    {
+        if (frame->layout() == base::Frame::Layout::I420 && !isI420Encoding(video_encoding_))
+        {
+            // The agent has not yet applied the new configuration. Once it switches back to the
+            // packed layout, the first frame contains the entire screen.
+            merged_frame_.reset();
+            return false;
+        }
+
+        // The capturer can have scaled the frame down already, the sizes are relative to the
+        // screen.
+        if (source_size_ != frame->screenSize())
         {
             // Every time we change the resolution, we have to reset the preferred size.
-            source_size_ = frame->size();
+            source_size_ = frame->screenSize();
             preferred_size_ = base::Size();
             forced_size_ = base::Size();
         }
 
-        base::Size current_size = preferred_size_;
+        current_size = preferred_size_;
 
         // If the preferred size is larger than the original, then we use the original size.
         if (current_size.width() > source_size_.width() ||
@@ -252,20 +508,128 @@ void ClientSessionDesktop::encodeScreen(const base::Frame* frame, const base::Mo
                 current_size = forced_size_;
         }
 
-        const base::Frame* scaled_frame = scale_reducer_->scaleFrame(frame, current_size);
+        updateCaptureSize(current_size);
+        encode_size_ = current_size;
+    }
+
+    if (!frame && !cursor)
+        return false;
+
+    prepared_frame_ = frame;
+    prepared_cursor_ = cursor;
+    prepared_size_ = current_size;
+
+    // The skipped frames were not copied to the encoding thread.
+    prepared_whole_frame_ = frame && whole_frame_required_;
+    if (frame)
+        whole_frame_required_ = false;
+
+    return true;
+}
+
+void ClientSessionDesktop::postScreen()
+{
+    DCHECK(prepared_frame_ || prepared_cursor_);
+
+    if (encode_thread_)
+    {
+        // A frame that is still waiting for the encoder is replaced with this one.
+        encode_thread_->post(prepared_frame_, prepared_cursor_, prepared_size_,
+                             prepared_whole_frame_);
+    }
+    else
+    {
+        base::TaskRunner::Callback send_callback =
+            encodeFrame(prepared_frame_, prepared_cursor_, prepared_size_);
+        if (send_callback)
+            send_callback();
+    }
+
+    prepared_frame_ = nullptr;
+    prepared_cursor_ = nullptr;
+    merged_frame_.reset();
+}
+
+base::TaskRunner::Callback ClientSessionDesktop::encodeFrame(
+    const base::Frame* frame, const base::MouseCursor* cursor, const base::Size& size)
+{
+    std::scoped_lock lock(encode_lock_);
+
+    applyEncoderUpdates();
+    encode_message_.clear();
+
+    EncodeStats stats;
+
+    if (frame && video_encoder_)
+    {
+        DCHECK(scale_reducer_);
+
+        const base::Frame* scaled_frame = scale_reducer_->scaleFrame(frame, size);
         if (!scaled_frame)
         {
             LOG(LS_ERROR) << "No scaled frame";
-            return;
+            return nullptr;
         }
 
-        proto::VideoPacket* packet = outgoing_message_->mutable_video_packet();
+        proto::VideoPacket* packet = encode_message_->mutable_video_packet();
+
+        const auto encode_start_time = std::chrono::high_resolution_clock::now();
+
+        bool result;
 
         // Encode the frame into a video packet.
-        if (!video_encoder_->encode(scaled_frame, packet))
+        if (useScreenStreams(scaled_frame))
+        {
+            result = encodeScreenStreams(scaled_frame, frame->screenSize(), packet);
+        }
+        else
+        {
+            if (!screen_streams_.empty())
+            {
+                // The single stream is started again with a new format.
+                LOG(LS_INFO) << "Screen streams stopped";
+                screen_streams_.clear();
+                video_encoder_ = createVideoEncoder(desktop_config_);
+            }
+
+            TRACE_EVENT("encode");
+            result = video_encoder_ && video_encoder_->encode(scaled_frame, packet);
+        }
+
+        if (!result)
         {
             LOG(LS_ERROR) << "Unable to encode video packet";
-            return;
+            return nullptr;
+        }
+
+        stats.encode_time = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - encode_start_time);
+        stats.dirty_fraction = dirtyFraction(frame);
+        stats.packet_size = packet->ByteSizeLong();
+        stats.is_key_frame = packet->key_frame();
+
+        // The client shows the latency of each stage. The host time includes the transfer of the
+        // frame from the agent and the waiting for the encoder.
+        packet->set_encode_time(static_cast<uint32_t>(stats.encode_time.count()));
+        packet->set_capture_time(static_cast<uint32_t>(frame->captureTime().count()));
+
+        if (frame->captureStartTime() != base::Frame::TimePoint())
+        {
+            packet->set_host_time(static_cast<uint32_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - frame->captureStartTime()).count()));
+        }
+
+        {
+            std::scoped_lock lock(updates_lock_);
+
+            // Frames without the capture time are sent by the fake session.
+            if (input_probe_id_ && (frame->captureStartTime() >= input_probe_time_ ||
+                                    frame->captureStartTime() == base::Frame::TimePoint()))
+            {
+                packet->set_input_id(input_probe_id_);
+                input_probe_id_ = 0;
+            }
         }
 
         if (packet->has_format())
@@ -275,29 +639,340 @@ void ClientSessionDesktop::encodeScreen(const base::Frame* frame, const base::Mo
             // In video packets that contain the format, we pass the screen capture type.
             format->set_capturer_type(frame->capturerType());
 
-            // Real screen size.
-            proto::Size* screen_size = format->mutable_screen_size();
-            screen_size->set_width(frame->size().width());
-            screen_size->set_height(frame->size().height());
+            // Real screen size.
+            proto::Size* screen_size = format->mutable_screen_size();
+            screen_size->set_width(frame->screenSize().width());
+            screen_size->set_height(frame->screenSize().height());
+
+            LOG(LS_INFO) << "Video packet has format";
+            LOG(LS_INFO) << "Capturer type: " << base::ScreenCapturer::typeToString(
+                static_cast<base::ScreenCapturer::Type>(frame->capturerType()));
+            LOG(LS_INFO) << "Screen size: " << screen_size->width() << "x"
+                         << screen_size->height();
+            LOG(LS_INFO) << "Video size: " << format->video_rect().width() << "x"
+                         << format->video_rect().height();
+
+            stats.video_size.set(format->video_rect().width(), format->video_rect().height());
+        }
+
+        if (webm_recorder_)
+            recordVideoPacket(*packet, scaled_frame->size());
+    }
+
+    if (cursor && cursor_encoder_)
+    {
+        if (!cursor_encoder_->encode(*cursor, encode_message_->mutable_cursor_shape()))
+            encode_message_->clear_cursor_shape();
+    }
+
+    stats.has_video_packet = encode_message_->has_video_packet();
+    if (!stats.has_video_packet && !encode_message_->has_cursor_shape())
+        return nullptr;
+
+    // The followers encode the cursor themselves, the shared message contains only the video. The
+    // VP8 and VP9 messages are split also without followers, so that they can be cached.
+    const bool is_shared_encoding = has_screen_followers_ ||
+        (video_encoder_ && (video_encoder_->encoding() == proto::VIDEO_ENCODING_VP8 ||
+                            video_encoder_->encoding() == proto::VIDEO_ENCODING_VP9));
+
+    base::ByteArray cursor_buffer;
+    if (stats.has_video_packet && encode_message_->has_cursor_shape() && is_shared_encoding)
+    {
+        proto::HostToClient cursor_message;
+        cursor_message.mutable_cursor_shape()->Swap(encode_message_->mutable_cursor_shape());
+        encode_message_->clear_cursor_shape();
+        cursor_buffer = base::serialize(cursor_message);
+    }
+
+    stats.has_cursor_shape = encode_message_->has_cursor_shape();
+
+    // The cursor shape without a video packet is small and should not wait for video.
+    const base::TcpChannel::Priority priority = stats.has_video_packet ?
+        base::TcpChannel::Priority::NORMAL : base::TcpChannel::Priority::HIGH;
+
+    // The input events are scaled with the factors of the frames the client has received.
+    if (scale_reducer_)
+    {
+        stats.scale_factor_x = scale_reducer_->scaleFactorX();
+        stats.scale_factor_y = scale_reducer_->scaleFactorY();
+    }
+
+    return [this, buffer = base::serialize(*encode_message_),
+            cursor_buffer = std::move(cursor_buffer), priority, stats]() mutable
+    {
+        onScreenEncoded(std::move(buffer), std::move(cursor_buffer), priority, stats);
+    };
+}
+
+void ClientSessionDesktop::onScreenEncoded(base::ByteArray&& buffer,
+                                           base::ByteArray&& cursor_buffer,
+                                           base::TcpChannel::Priority priority,
+                                           const EncodeStats& stats)
+{
+    if (stats.has_video_packet)
+    {
+        applyEncodeStats(stats);
+        cacheScreenMessage(buffer, stats);
+
+        for (ClientSessionDesktop* follower : screen_followers_)
+            follower->onSharedScreenEncoded(buffer, stats);
+    }
+
+    sendMessage(proto::HOST_CHANNEL_ID_SESSION, std::move(buffer), priority);
+
+    if (!cursor_buffer.empty())
+    {
+        sendMessage(proto::HOST_CHANNEL_ID_SESSION, std::move(cursor_buffer),
+                    base::TcpChannel::Priority::HIGH);
+    }
+}
+
+void ClientSessionDesktop::onSharedScreenEncoded(
+    const base::ByteArray& buffer, const EncodeStats& stats)
+{
+    if (share_state_ == ShareState::JOINING)
+        return;
+
+    if (stats.has_cursor_shape)
+    {
+        // The message was encoded before this client joined and contains the cursor of the leader.
+        if (share_state_ == ShareState::STARTED)
+        {
+            share_state_ = ShareState::WAITING_KEY_FRAME;
+            screen_leader_->requestKeyFrame();
+        }
+        return;
+    }
+
+    if (share_state_ == ShareState::WAITING_KEY_FRAME)
+    {
+        // The inter frames refer to the frames this client has not received.
+        if (!stats.is_key_frame)
+            return;
+
+        LOG(LS_INFO) << "Shared screen started";
+        share_state_ = ShareState::STARTED;
+    }
+
+    applyEncodeStats(stats);
+    sendMessage(proto::HOST_CHANNEL_ID_SESSION, base::ByteArray(buffer));
+}
+
+void ClientSessionDesktop::applyEncodeStats(const EncodeStats& stats)
+{
+    scale_factor_x_ = stats.scale_factor_x;
+    scale_factor_y_ = stats.scale_factor_y;
+
+    if (!stats.video_size.isEmpty())
+        stream_size_ = stats.video_size;
+
+    if (rate_controller_)
+    {
+        rate_controller_->onFrameEncoded(
+            stats.dirty_fraction, stats.encode_time, stats.packet_size);
+    }
+}
+
+void ClientSessionDesktop::cacheScreenMessage(
+    const base::ByteArray& buffer, const EncodeStats& stats)
+{
+    if (!canShareScreen() || stats.has_cursor_shape)
+    {
+        clearScreenCache();
+        return;
+    }
+
+    if (stats.is_key_frame)
+    {
+        clearScreenCache();
+        is_screen_cache_valid_ = true;
+    }
+
+    if (!is_screen_cache_valid_)
+        return;
+
+    if (screen_cache_.size() >= kMaxScreenCacheMessages ||
+        screen_cache_bytes_ + buffer.size() > kMaxScreenCacheBytes)
+    {
+        LOG(LS_INFO) << "Screen cache is full (messages: " << screen_cache_.size()
+                     << " bytes: " << screen_cache_bytes_ << ")";
+        clearScreenCache();
+        return;
+    }
+
+    screen_cache_.emplace_back(buffer);
+    screen_cache_bytes_ += buffer.size();
+}
+
+void ClientSessionDesktop::clearScreenCache()
+{
+    screen_cache_.clear();
+    screen_cache_bytes_ = 0;
+    is_screen_cache_valid_ = false;
+}
+
+bool ClientSessionDesktop::sendScreenCache(const ClientSessionDesktop& leader)
+{
+    if (!leader.is_screen_cache_valid_ || leader.screen_cache_.empty())
+        return false;
+
+    LOG(LS_INFO) << "Shared screen started from cache (messages: " << leader.screen_cache_.size()
+                 << " bytes: " << leader.screen_cache_bytes_ << ")";
+
+    // The first message is the key frame, the others refer only to the messages before them.
+    for (const auto& buffer : leader.screen_cache_)
+        sendMessage(proto::HOST_CHANNEL_ID_SESSION, base::ByteArray(buffer));
+
+    scale_factor_x_ = leader.scale_factor_x_;
+    scale_factor_y_ = leader.scale_factor_y_;
+    return true;
+}
+
+bool ClientSessionDesktop::canShareScreenWith(const ClientSessionDesktop& leader) const
+{
+    if (&leader == this || leader.screen_leader_ || !canShareScreen() || !leader.canShareScreen())
+        return false;
+
+    const uint32_t flags = desktop_config_.flags() & kSharedVideoFlags;
+    const uint32_t leader_flags = leader.desktop_config_.flags() & kSharedVideoFlags;
+
+    return video_encoding_ == leader.video_encoding_ && flags == leader_flags &&
+           desktop_config_.scale_filter() == leader.desktop_config_.scale_filter() &&
+           encode_size_ == leader.encode_size_ && stream_size_ == leader.stream_size_;
+}
+
+bool ClientSessionDesktop::canShareScreen() const
+{
+    // Only the decoders of VP8 and VP9 can continue another stream from its key frame.
+    if (video_encoding_ != proto::VIDEO_ENCODING_VP8 &&
+        video_encoding_ != proto::VIDEO_ENCODING_VP9)
+    {
+        return false;
+    }
+
+    // A client that skips frames or records its own stream encodes the screen itself.
+    if (is_video_paused_ || is_backlogged_ || critical_overflow_ || webm_recorder_)
+        return false;
+
+    // The lossless blocks and the streams of the monitors are not shared.
+    const uint32_t flags = desktop_config_.flags();
+    if ((flags & proto::HYBRID_ENCODING) ||
+        ((flags & proto::SCREEN_STREAMS) && screen_rects_.size() >= 2))
+    {
+        return false;
+    }
+
+    // The client has received the video of this size already.
+    return !encode_size_.isEmpty() && stream_size_ == encode_size_;
+}
+
+void ClientSessionDesktop::setScreenLeader(ClientSessionDesktop* leader)
+{
+    if (screen_leader_ == leader)
+        return;
+
+    if (screen_leader_)
+    {
+        LOG(LS_INFO) << "Shared screen stopped";
+
+        std::vector<ClientSessionDesktop*>* followers = &screen_leader_->screen_followers_;
+        followers->erase(std::remove(followers->begin(), followers->end(), this), followers->end());
+        screen_leader_->has_screen_followers_ = !followers->empty();
+        screen_leader_ = nullptr;
+
+        // The own encoder continues with the frames skipped while following.
+        requestKeyFrame();
+    }
+
+    if (!leader)
+        return;
+
+    // The followers of this client encode the screen themselves again.
+    while (!screen_followers_.empty())
+        screen_followers_.back()->setScreenLeader(nullptr);
+
+    LOG(LS_INFO) << "Shared screen requested";
+
+    screen_leader_ = leader;
+    screen_leader_->screen_followers_.emplace_back(this);
+    screen_leader_->has_screen_followers_ = true;
+    share_state_ = ShareState::JOINING;
+    ++share_generation_;
+
+    // The packets of the leader are sent after the packets this client has already encoded.
+    base::TaskRunner::Callback on_flushed = [this, generation = share_generation_]()
+    {
+        if (generation != share_generation_ || !screen_leader_)
+            return;
+
+        if (sendScreenCache(*screen_leader_))
+        {
+            share_state_ = ShareState::STARTED;
+            return;
+        }
+
+        share_state_ = ShareState::WAITING_KEY_FRAME;
+        screen_leader_->requestKeyFrame();
+    };
+
+    if (encode_thread_)
+        encode_thread_->flush(std::move(on_flushed));
+    else
+        on_flushed();
+}
+
+void ClientSessionDesktop::applyEncoderUpdates()
+{
+    bool key_frame_required;
+    std::optional<base::Point> cursor_position;
+    uint32_t bitrate;
+
+    {
+        std::scoped_lock lock(updates_lock_);
+
+        key_frame_required = key_frame_required_;
+        key_frame_required_ = false;
+        cursor_position.swap(cursor_position_);
+        bitrate = pending_bitrate_;
+        pending_bitrate_ = 0;
+    }
+
+    if (!video_encoder_)
+        return;
+
+    if (key_frame_required)
+        video_encoder_->setKeyFrameRequired(true);
+
+    const proto::VideoEncoding encoding = video_encoder_->encoding();
+    if (encoding != proto::VIDEO_ENCODING_VP8 && encoding != proto::VIDEO_ENCODING_VP9)
+        return;
+
+    base::VideoEncoderVPX* encoder = static_cast<base::VideoEncoderVPX*>(video_encoder_.get());
 
-            LOG(LS_INFO) << "Video packet has format";
-            LOG(LS_INFO) << "Capturer type: " << base::ScreenCapturer::typeToString(
-                static_cast<base::ScreenCapturer::Type>(frame->capturerType()));
-            LOG(LS_INFO) << "Screen size: " << screen_size->width() << "x"
-                         << screen_size->height();
-            LOG(LS_INFO) << "Video size: " << format->video_rect().width() << "x"
-                         << format->video_rect().height();
-        }
+    if (bitrate)
+    {
+        encoder->setTargetBitrate(bitrate);
+        setScreenStreamBitrate(bitrate);
     }
 
-    if (cursor && cursor_encoder_)
+    if (!cursor_position || encoding != proto::VIDEO_ENCODING_VP9)
+        return;
+
+    encoder->setCursorPosition(*cursor_position);
+
+    // The position outside a monitor is ignored by its encoder.
+    for (const auto& stream : screen_streams_)
     {
-        if (!cursor_encoder_->encode(*cursor, outgoing_message_->mutable_cursor_shape()))
-            outgoing_message_->clear_cursor_shape();
+        static_cast<base::VideoEncoderVPX*>(stream.encoder.get())->setCursorPosition(
+            base::Point(cursor_position->x() - stream.rect.x(),
+                        cursor_position->y() - stream.rect.y()));
     }
+}
 
-    if (outgoing_message_->has_video_packet() || outgoing_message_->has_cursor_shape())
-        sendMessage(proto::HOST_CHANNEL_ID_SESSION, base::serialize(*outgoing_message_));
+void ClientSessionDesktop::requestKeyFrame()
+{
+    std::scoped_lock lock(updates_lock_);
+    key_frame_required_ = true;
 }
 
 void ClientSessionDesktop::encodeAudio(const proto::AudioPacket& audio_packet)
@@ -308,19 +983,24 @@ void ClientSessionDesktop::encodeAudio(const proto::AudioPacket& audio_packet)
     if (is_audio_paused_ || !audio_encoder_)
         return;
 
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
 
     if (!audio_encoder_->encode(audio_packet, outgoing_message_->mutable_audio_packet()))
         return;
 
-    sendMessage(proto::HOST_CHANNEL_ID_SESSION, base::serialize(*outgoing_message_));
+    if (webm_recorder_)
+        webm_recorder_->addAudioPacket(outgoing_message_->audio_packet());
+
+    // Audio packets are written before the queued video so that playback does not stall.
+    sendMessage(proto::HOST_CHANNEL_ID_SESSION, base::serialize(*outgoing_message_),
+                base::TcpChannel::Priority::HIGH);
 }
 
 void ClientSessionDesktop::setVideoErrorCode(proto::VideoErrorCode error_code)
 {
     CHECK_NE(error_code, proto::VIDEO_ERROR_CODE_OK);
 
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
     outgoing_message_->mutable_video_packet()->set_error_code(error_code);
     sendMessage(proto::HOST_CHANNEL_ID_SESSION, base::serialize(*outgoing_message_));
 }
@@ -330,23 +1010,54 @@ void ClientSessionDesktop::setCursorPosition(const proto::CursorPosition& cursor
     if (!desktop_session_config_.cursor_position)
         return;
 
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
 
     int pos_x = static_cast<int>(
-        static_cast<double>(cursor_position.x()) * scale_reducer_->scaleFactorX() / 100.0);
+        static_cast<double>(cursor_position.x()) * scale_factor_x_ / 100.0);
     int pos_y = static_cast<int>(
-        static_cast<double>(cursor_position.y()) * scale_reducer_->scaleFactorY() / 100.0);
+        static_cast<double>(cursor_position.y()) * scale_factor_y_ / 100.0);
 
     proto::CursorPosition* position = outgoing_message_->mutable_cursor_position();
     position->set_x(pos_x);
     position->set_y(pos_y);
 
-    sendMessage(proto::HOST_CHANNEL_ID_SESSION, base::serialize(*outgoing_message_));
+    setEncoderCursorPosition(base::Point(pos_x, pos_y));
+
+    sendMessage(proto::HOST_CHANNEL_ID_SESSION, base::serialize(*outgoing_message_),
+                base::TcpChannel::Priority::HIGH);
 }
 
 void ClientSessionDesktop::setScreenList(const proto::ScreenList& list)
 {
-    outgoing_message_->Clear();
+    std::unique_lock lock(encode_lock_);
+    screen_rects_.clear();
+
+    // The whole desktop is captured, the monitors are placed relative to its top left corner.
+    if (list.current_screen() == base::ScreenCapturer::kFullDesktopScreenId &&
+        list.screen_size() > 1)
+    {
+        int32_t left = std::numeric_limits<int32_t>::max();
+        int32_t top = std::numeric_limits<int32_t>::max();
+
+        for (int i = 0; i < list.screen_size(); ++i)
+        {
+            left = std::min(left, list.screen(i).position().x());
+            top = std::min(top, list.screen(i).position().y());
+        }
+
+        for (int i = 0; i < list.screen_size(); ++i)
+        {
+            const proto::Screen& screen = list.screen(i);
+
+            screen_rects_.emplace_back(base::Rect::makeXYWH(
+                screen.position().x() - left, screen.position().y() - top,
+                screen.resolution().width(), screen.resolution().height()));
+        }
+    }
+
+    lock.unlock();
+
+    outgoing_message_.clear();
     proto::DesktopExtension* extension = outgoing_message_->mutable_extension();
     extension->set_name(common::kSelectScreenExtension);
     extension->set_data(list.SerializeAsString());
@@ -358,9 +1069,12 @@ void ClientSessionDesktop::injectClipboardEvent(const proto::ClipboardEvent& eve
 {
     if (sessionType() == proto::SESSION_TYPE_DESKTOP_MANAGE)
     {
-        outgoing_message_->Clear();
+        outgoing_message_.clear();
         outgoing_message_->mutable_clipboard_event()->CopyFrom(event);
-        sendMessage(proto::HOST_CHANNEL_ID_SESSION, base::serialize(*outgoing_message_));
+
+        // Large clipboard data should not delay the video.
+        sendMessage(proto::HOST_CHANNEL_ID_SESSION, base::serialize(*outgoing_message_),
+                    base::TcpChannel::Priority::LOW);
     }
     else
     {
@@ -390,6 +1104,10 @@ void ClientSessionDesktop::readExtension(const proto::DesktopExtension& extensio
     {
         readAudioPauseExtension(extension.data());
     }
+    else if (extension.name() == common::kKeyFrameExtension)
+    {
+        readKeyFrameExtension();
+    }
     else if (extension.name() == common::kPowerControlExtension)
     {
         readPowerControlExtension(extension.data());
@@ -414,30 +1132,45 @@ void ClientSessionDesktop::readExtension(const proto::DesktopExtension& extensio
 
 void ClientSessionDesktop::readConfig(const proto::DesktopConfig& config)
 {
-    switch (config.video_encoding())
+    updateEncodeThread(config.video_encoding());
+
     {
-        case proto::VIDEO_ENCODING_VP8:
-            video_encoder_ = base::VideoEncoderVPX::createVP8();
-            break;
+        std::scoped_lock lock(encode_lock_);
 
-        case proto::VIDEO_ENCODING_VP9:
-            video_encoder_ = base::VideoEncoderVPX::createVP9();
-            break;
+        desktop_config_ = config;
+        screen_streams_.clear();
 
-        case proto::VIDEO_ENCODING_ZSTD:
-            video_encoder_ = base::VideoEncoderZstd::create(
-                parsePixelFormat(config.pixel_format()), static_cast<int>(config.compress_ratio()));
-            break;
+        video_encoder_ = createVideoEncoder(config);
+        video_encoding_ =
+            video_encoder_ ? video_encoder_->encoding() : proto::VIDEO_ENCODING_UNKNOWN;
 
-        default:
+        video_bitrate_ = 0;
+        if (video_encoding_ == proto::VIDEO_ENCODING_VP8 ||
+            video_encoding_ == proto::VIDEO_ENCODING_VP9)
         {
-            // No supported video encoding.
-            LOG(LS_WARNING) << "Unsupported video encoding: " << config.video_encoding();
+            video_bitrate_ =
+                static_cast<base::VideoEncoderVPX*>(video_encoder_.get())->targetBitrate();
         }
-        break;
+
+        cursor_encoder_.reset();
+        if (config.flags() & proto::ENABLE_CURSOR_SHAPE)
+        {
+            cursor_encoder_ = std::make_unique<base::CursorEncoder>(
+                config.flags() & proto::LARGE_CURSOR_CACHE);
+        }
+
+        scale_reducer_ = std::make_unique<base::ScaleReducer>();
+        scale_reducer_->setFilter(config.scale_filter() == proto::SCALE_FILTER_BILINEAR ?
+            base::ScaleReducer::Filter::BILINEAR : base::ScaleReducer::Filter::BOX);
     }
 
-    if (!video_encoder_)
+    {
+        // The bitrate of the previous encoder is not applied to the new one.
+        std::scoped_lock lock(updates_lock_);
+        pending_bitrate_ = 0;
+    }
+
+    if (video_encoding_ == proto::VIDEO_ENCODING_UNKNOWN)
     {
         LOG(LS_ERROR) << "Video encoder not initialized!";
         return;
@@ -446,8 +1179,19 @@ void ClientSessionDesktop::readConfig(const proto::DesktopConfig& config)
     switch (config.audio_encoding())
     {
         case proto::AUDIO_ENCODING_OPUS:
-            audio_encoder_ = std::make_unique<base::AudioEncoderOpus>();
-            break;
+        {
+            std::unique_ptr<base::AudioEncoderOpus> audio_encoder =
+                std::make_unique<base::AudioEncoderOpus>();
+            audio_encoder->setLowLatency(config.flags() & proto::LOW_LATENCY_AUDIO);
+
+            if (!audio_quality_controller_)
+                audio_quality_controller_ = std::make_unique<base::AudioQualityController>();
+
+            audio_encoder->setBitrate(audio_quality_controller_->bitrate());
+            audio_encoder->setComplexity(audio_quality_controller_->complexity());
+            audio_encoder_ = std::move(audio_encoder);
+        }
+        break;
 
         default:
         {
@@ -457,12 +1201,6 @@ void ClientSessionDesktop::readConfig(const proto::DesktopConfig& config)
         break;
     }
 
-    cursor_encoder_.reset();
-    if (config.flags() & proto::ENABLE_CURSOR_SHAPE)
-        cursor_encoder_ = std::make_unique<base::CursorEncoder>();
-
-    scale_reducer_ = std::make_unique<base::ScaleReducer>();
-
     desktop_session_config_.disable_font_smoothing =
         (config.flags() & proto::DISABLE_FONT_SMOOTHING);
     desktop_session_config_.disable_effects =
@@ -477,6 +1215,14 @@ void ClientSessionDesktop::readConfig(const proto::DesktopConfig& config)
         (config.flags() & proto::CLEAR_CLIPBOARD);
     desktop_session_config_.cursor_position =
         (config.flags() & proto::CURSOR_POSITION);
+    // The blocks of text are classified and compressed in the packed format. The I444 mode needs
+    // the chroma of the packed frames in full resolution.
+    desktop_session_config_.prefer_i420 = isI420Encoding(video_encoding_) &&
+        !(config.flags() & proto::HYBRID_ENCODING) && !(config.flags() & proto::VP9_I444) &&
+        !base::Environment::has("ASPIA_NO_I420_CAPTURE");
+    desktop_session_config_.low_latency_audio =
+        audio_encoder_ && (config.flags() & proto::LOW_LATENCY_AUDIO);
+    desktop_session_config_.capture_audio = audio_encoder_ && !is_audio_paused_;
 
     LOG(LS_INFO) << "Client configuration changed";
     LOG(LS_INFO) << "Video encoding: " << config.video_encoding();
@@ -488,10 +1234,34 @@ void ClientSessionDesktop::readConfig(const proto::DesktopConfig& config)
     LOG(LS_INFO) << "Lock at disconnect: " << desktop_session_config_.lock_at_disconnect;
     LOG(LS_INFO) << "Clear clipboard: " << desktop_session_config_.clear_clipboard;
     LOG(LS_INFO) << "Cursor position: " << desktop_session_config_.cursor_position;
+    LOG(LS_INFO) << "Prefer I420: " << desktop_session_config_.prefer_i420;
+    LOG(LS_INFO) << "Low latency audio: " << desktop_session_config_.low_latency_audio;
+    LOG(LS_INFO) << "Capture audio: " << desktop_session_config_.capture_audio;
+    LOG(LS_INFO) << "Encoding thread: " << (encode_thread_ != nullptr);
 
     delegate_->onClientSessionConfigured();
 }
 
+void ClientSessionDesktop::updateEncodeThread(proto::VideoEncoding encoding)
+{
+    if (isHardwareEncoding(encoding) || base::Environment::has("ASPIA_NO_ENCODE_THREAD"))
+    {
+        // The frame that is waiting for the encoder is dropped. The agent sends the whole screen
+        // after the new configuration.
+        encode_thread_.reset();
+        return;
+    }
+
+    if (encode_thread_)
+        return;
+
+    encode_thread_ = std::make_unique<ScreenEncodeThread>(task_runner_,
+        [this](const base::Frame* frame, const base::MouseCursor* cursor, const base::Size& size)
+    {
+        return encodeFrame(frame, cursor, size);
+    });
+}
+
 void ClientSessionDesktop::readSelectScreenExtension(const std::string& data)
 {
     LOG(LS_INFO) << "Select screen request";
@@ -548,15 +1318,17 @@ void ClientSessionDesktop::readVideoPauseExtension(const std::string& data)
     is_video_paused_ = pause.enable();
     LOG(LS_INFO) << "Video paused: " << is_video_paused_;
 
+    delegate_->onClientSessionVideoPaused();
+
     if (!is_video_paused_)
     {
-        if (!video_encoder_)
+        if (video_encoding_ == proto::VIDEO_ENCODING_UNKNOWN)
         {
             LOG(LS_WARNING) << "Video encoder not initialized";
             return;
         }
 
-        video_encoder_->setKeyFrameRequired(true);
+        requestKeyFrame();
     }
 }
 
@@ -572,6 +1344,27 @@ void ClientSessionDesktop::readAudioPauseExtension(const std::string& data)
 
     is_audio_paused_ = pause.enable();
     LOG(LS_INFO) << "Audio paused: " << is_audio_paused_;
+
+    // The agent stops the audio capture when no client needs it.
+    const bool capture_audio = audio_encoder_ && !is_audio_paused_;
+    if (capture_audio == desktop_session_config_.capture_audio)
+        return;
+
+    desktop_session_config_.capture_audio = capture_audio;
+    delegate_->onClientSessionConfigured();
+}
+
+void ClientSessionDesktop::readKeyFrameExtension()
+{
+    LOG(LS_INFO) << "Key frame requested";
+
+    if (video_encoding_ == proto::VIDEO_ENCODING_UNKNOWN)
+    {
+        LOG(LS_WARNING) << "Video encoder not initialized";
+        return;
+    }
+
+    requestKeyFrame();
 }
 
 void ClientSessionDesktop::readPowerControlExtension(const std::string& data)
@@ -697,7 +1490,7 @@ void ClientSessionDesktop::readSystemInfoExtension(const std::string& data)
     proto::system_info::SystemInfo system_info;
     createSystemInfo(system_info_request, &system_info);
 
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
     proto::DesktopExtension* desktop_extension = outgoing_message_->mutable_extension();
     desktop_extension->set_name(common::kSystemInfoExtension);
     desktop_extension->set_data(system_info.SerializeAsString());
@@ -754,117 +1547,435 @@ void ClientSessionDesktop::readTaskManagerExtension(const std::string& data)
 #endif // defined(OS_WIN)
 }
 
-void ClientSessionDesktop::onOverflowDetectionTimer()
+void ClientSessionDesktop::onRateControlTimer()
 {
-    // Maximum value of messages in the queue for sending.
-    static const size_t kCriticalPendingCount = 12;
+    DCHECK(rate_controller_);
 
-    // Maximum average number of messages in the send queue.
-    static const size_t kWarningPendingCount = 2;
+    const bool was_congested = rate_controller_->isCongested();
 
-    size_t pending = pendingMessages();
-    if (pending > kCriticalPendingCount)
-    {
-        critical_overflow_ = true;
-        write_normal_count_ = 0;
-        ++write_overflow_count_;
+    const bool fps_changed = rate_controller_->update(
+        base::CaptureRateController::Clock::now(), pendingMessages(), pendingBytes(), totalTx());
 
-        LOG(LS_INFO) << "Critical overflow: " << pending << " (" << write_overflow_count_ << ")";
+    critical_overflow_ = rate_controller_->isCongested();
 
-        downStepOverflow();
-    }
-    else if (pending > kWarningPendingCount)
+    if (was_congested && !critical_overflow_)
+        LOG(LS_INFO) << "Congestion is over";
+
+    if (fps_changed)
+        setCaptureFps(rate_controller_->targetFps());
+
+    updateVideoBitrate();
+}
+
+void ClientSessionDesktop::updateVideoBitrate()
+{
+    DCHECK(bandwidth_estimator_);
+
+    const base::NetworkChannel::Statistics statistics = channelStatistics();
+
+    // The data acknowledged by the peer has left the path. Without transport information the
+    // data written to the socket is counted.
+    int64_t delivered_bytes = statistics.bytes_sent;
+    if (statistics.has_transport_info)
+        delivered_bytes -= static_cast<int64_t>(statistics.bytes_in_flight);
+
+    base::CongestionController::Sample sample;
+    sample.time = base::CongestionController::Clock::now();
+    sample.delivered_bytes =
+        static_cast<size_t>(std::max(delivered_bytes - last_delivered_bytes_, int64_t(0)));
+
+    // The outgoing queue grows when the encoder produces more data than the path delivers, so it
+    // is counted as data in flight.
+    sample.inflight_bytes = statistics.bytes_in_flight + statistics.queued_bytes;
+
+    const std::chrono::microseconds rtt =
+        (statistics.has_transport_info && statistics.transport_rtt.count()) ?
+        statistics.transport_rtt : statistics.smoothed_rtt;
+    sample.rtt = std::chrono::duration_cast<base::CongestionController::Milliseconds>(rtt);
+
+    if (statistics.retransmits >= last_retransmits_)
+        sample.lost_packets = statistics.retransmits - last_retransmits_;
+    sample.sent_packets =
+        static_cast<uint32_t>(sample.delivered_bytes / kEstimatorMss) + sample.lost_packets;
+
+    last_delivered_bytes_ = delivered_bytes;
+    last_retransmits_ = statistics.retransmits;
+
+    bandwidth_estimator_->onSample(sample);
+
+    // The audio takes its share of the path first.
+    updateAudioQuality();
+
+    if (video_encoding_ != proto::VIDEO_ENCODING_VP8 &&
+        video_encoding_ != proto::VIDEO_ENCODING_VP9)
     {
-        write_normal_count_ = 0;
-        ++write_overflow_count_;
+        return;
+    }
+
+    // The audio stream shares the path with the video.
+    int64_t available_bitrate = bandwidth_estimator_->pacingRate() * 8 / 1000;
+    if (audio_encoder_ && !is_audio_paused_)
+        available_bitrate -= audio_encoder_->bitrate() / 1000;
+
+    const uint32_t bitrate = static_cast<uint32_t>(std::clamp(
+        available_bitrate, int64_t(kMinVideoBitrate), int64_t(kMaxVideoBitrate)));
+
+    const uint32_t current_bitrate = video_bitrate_;
+
+    const uint32_t difference =
+        bitrate > current_bitrate ? bitrate - current_bitrate : current_bitrate - bitrate;
+    if (difference * 100 <= current_bitrate * kVideoBitrateHysteresis)
+        return;
+
+    LOG(LS_INFO) << "Video bitrate: " << current_bitrate << " to " << bitrate
+                 << " kbps (bandwidth: " << bandwidth_estimator_->bandwidth() << " B/s, min RTT: "
+                 << bandwidth_estimator_->minRtt().count() << " ms)";
+
+    video_bitrate_ = bitrate;
+
+    // The encoder applies the bitrate before the next frame.
+    std::scoped_lock lock(updates_lock_);
+    pending_bitrate_ = bitrate;
+}
+
+void ClientSessionDesktop::updateAudioQuality()
+{
+    if (!audio_encoder_ || !audio_quality_controller_)
+        return;
+
+    if (audio_quality_controller_->updateBitrate(bandwidth_estimator_->pacingRate()))
+        audio_encoder_->setBitrate(audio_quality_controller_->bitrate());
+
+    if (--audio_complexity_countdown_ > 0)
+        return;
+
+    audio_complexity_countdown_ = kAudioComplexityInterval;
+
+    int cpu_usage = 0;
+#if defined(OS_WIN)
+    if (!process_monitor_)
+        process_monitor_ = std::make_unique<ProcessMonitor>();
+    cpu_usage = process_monitor_->calcCpuUsage();
+#endif // defined(OS_WIN)
+
+    if (audio_quality_controller_->updateComplexity(cpu_usage, g_desktop_session_count.load()))
+        audio_encoder_->setComplexity(audio_quality_controller_->complexity());
+}
+
+bool ClientSessionDesktop::useScreenStreams(const base::Frame* frame) const
+{
+    if (!(desktop_config_.flags() & proto::SCREEN_STREAMS) || screen_rects_.size() < 2)
+        return false;
+
+    // The views of the monitors refer to the rows of the packed frame. The hardware encoders are
+    // used only on the thread that created them.
+    if (frame->layout() != base::Frame::Layout::PACKED || !video_encoder_)
+        return false;
 
-        LOG(LS_INFO) << "Overflow: " << pending << " (" << write_overflow_count_ << ")";
+    const proto::VideoEncoding encoding = video_encoder_->encoding();
+    return encoding == proto::VIDEO_ENCODING_VP8 || encoding == proto::VIDEO_ENCODING_VP9 ||
+           encoding == proto::VIDEO_ENCODING_ZSTD;
+}
+
+void ClientSessionDesktop::startSessionRecording()
+{
+    SystemSettings settings;
+    if (!settings.isSessionRecordingEnabled())
+        return;
 
-        if (pending > last_pending_count_ || write_overflow_count_ > 10)
-            downStepOverflow();
+    const std::filesystem::path path = settings.sessionRecordingPath();
+    if (path.empty())
+    {
+        LOG(LS_ERROR) << "No path for the session recording";
+        return;
     }
-    else if (write_overflow_count_ > 0 && pending == 0)
+
+    const int64_t max_file_size =
+        std::max(settings.sessionRecordingMaxFileSize(), int64_t(0)) * 1024 * 1024;
+
+    LOG(LS_INFO) << "Session recording enabled (path: " << path << ")";
+
+    // The files are named after the user of the session.
+    webm_recorder_ = std::make_unique<base::WebmRecorder>(
+        path, base::utf16FromUtf8(userName()), max_file_size);
+}
+
+void ClientSessionDesktop::recordVideoPacket(
+    const proto::VideoPacket& packet, const base::Size& video_size)
+{
+    DCHECK(webm_recorder_);
+
+    // The other encodings would have to be encoded again.
+    if (!base::WebmRecorder::isPassthroughPacket(packet))
     {
-        if (critical_overflow_)
+        if (!recording_unsupported_)
         {
-            if (video_encoder_)
-                video_encoder_->setKeyFrameRequired(true);
+            LOG(LS_WARNING) << "Session recording supports only VP8 and VP9 of one stream "
+                            << "without hybrid encoding (current: " << packet.encoding() << ")";
+            recording_unsupported_ = true;
         }
+        return;
+    }
+
+    recording_unsupported_ = false;
+
+    if (webm_recorder_->addVideoPacket(packet, video_size) && video_encoder_)
+        video_encoder_->setKeyFrameRequired(true);
+}
+
+bool ClientSessionDesktop::isBacklogged()
+{
+    const int64_t throughput = rate_controller_ ? rate_controller_->throughput() : 0;
 
-        critical_overflow_ = false;
-        write_normal_count_ = 1;
-        write_overflow_count_ = 0;
+    const size_t limit = std::max(kMinBacklogBytes, static_cast<size_t>(
+        throughput * kMaxBacklogTime.count() / 1000));
+    const size_t pending_bytes = pendingBytes();
 
-        LOG(LS_INFO) << "Overflow finished: " << pending;
+    if (!is_backlogged_ && pending_bytes > limit)
+    {
+        LOG(LS_INFO) << "Outgoing queue is backlogged (" << pending_bytes << " bytes)";
+        is_backlogged_ = true;
     }
-    else if (write_normal_count_ > 0)
+    else if (is_backlogged_ && pending_bytes <= limit / 2)
     {
-        ++write_normal_count_;
+        LOG(LS_INFO) << "Outgoing queue is drained (" << pending_bytes << " bytes)";
+        is_backlogged_ = false;
+    }
 
-        // Trying to raise the maximum FPS every 30 seconds.
-        if ((write_normal_count_ % 30) == 0)
-        {
-            int new_max_fps = std::min(max_fps_ + 1, desktop_session_proxy_->maxScreenCaptureFps());
-            if (new_max_fps != max_fps_)
-            {
-                LOG(LS_INFO) << "Max FPS: " << max_fps_ << " to " << new_max_fps;
-                max_fps_ = new_max_fps;
-            }
-        }
+    return is_backlogged_;
+}
 
-        // Trying to raise the current FPS every 10 seconds.
-        if ((write_normal_count_ % 10) == 0)
-            upStepOverflow();
+void ClientSessionDesktop::skipFrame(const base::Frame* frame)
+{
+    if (!frame || is_video_paused_ || video_encoding_ == proto::VIDEO_ENCODING_UNKNOWN)
+        return;
+
+    if (has_skipped_frames_ && skipped_frame_size_ != frame->size())
+    {
+        // The previous updates are meaningless in the frame of another size.
+        skipped_region_.clear();
+        skipped_key_frame_required_ = true;
     }
 
-    last_pending_count_ = pending;
+    if (frame->layout() != base::Frame::Layout::PACKED)
+    {
+        // The planes of the I420 frames cannot be viewed with another updated region.
+        skipped_key_frame_required_ = true;
+    }
+
+    has_skipped_frames_ = true;
+    skipped_frame_size_ = frame->size();
+
+    if (!skipped_key_frame_required_)
+        skipped_region_.addRegion(frame->constUpdatedRegion());
 }
 
-void ClientSessionDesktop::downStepOverflow()
+std::unique_ptr<base::Frame> ClientSessionDesktop::takeSkippedFrames(const base::Frame* frame)
 {
-    int fps = desktop_session_proxy_->screenCaptureFps();
-    int new_fps = fps;
-    if (fps > desktop_session_proxy_->minScreenCaptureFps())
+    DCHECK(has_skipped_frames_);
+
+    const bool key_frame_required = skipped_key_frame_required_ ||
+        frame->layout() != base::Frame::Layout::PACKED || skipped_frame_size_ != frame->size();
+
+    has_skipped_frames_ = false;
+    skipped_key_frame_required_ = false;
+
+    base::Region skipped_region;
+    skipped_region.swap(&skipped_region_);
+
+    if (key_frame_required)
     {
-        if (fps >= 25)
-            new_fps = 20;
-        else if (fps >= 20)
-            new_fps = 15;
-        else
-            new_fps = fps - 1;
+        requestKeyFrame();
+        whole_frame_required_ = true;
+        return nullptr;
+    }
+
+    // The frame contains the current image of the whole screen, only its updated region has to be
+    // extended with the regions of the skipped frames.
+    std::unique_ptr<base::FrameView> merged_frame =
+        std::make_unique<base::FrameView>(*frame, base::Rect::makeSize(frame->size()));
+    merged_frame->copyFrameInfoFrom(*frame);
+    merged_frame->updatedRegion()->addRegion(skipped_region);
+
+    return merged_frame;
+}
+
+bool ClientSessionDesktop::encodeScreenStreams(
+    const base::Frame* frame, const base::Size& screen_size, proto::VideoPacket* packet)
+{
+    const base::Rect frame_rect = base::Rect::makeSize(frame->size());
+    std::vector<base::Rect> rects;
+
+    // The monitors are scaled together with the frame.
+    for (const auto& rect : screen_rects_)
+    {
+        base::Rect scaled_rect = base::Rect::makeLTRB(
+            rect.left() * frame->size().width() / screen_size.width(),
+            rect.top() * frame->size().height() / screen_size.height(),
+            rect.right() * frame->size().width() / screen_size.width(),
+            rect.bottom() * frame->size().height() / screen_size.height());
+
+        scaled_rect.intersectWith(frame_rect);
+        if (!scaled_rect.isEmpty())
+            rects.emplace_back(scaled_rect);
+    }
+
+    bool layout_changed = rects.size() != screen_streams_.size();
+    for (size_t i = 0; !layout_changed && i < rects.size(); ++i)
+        layout_changed = rects[i] != screen_streams_[i].rect;
+
+    if (layout_changed)
+    {
+        LOG(LS_INFO) << "Screen streams started: " << rects.size();
+
+        screen_streams_.clear();
 
-        if (critical_overflow_ && new_fps != max_fps_)
+        for (const auto& rect : rects)
         {
-            LOG(LS_INFO) << "Max FPS: " << max_fps_ << " to " << new_fps;
-            max_fps_ = new_fps;
+            ScreenStream stream;
+            stream.rect = rect;
+            stream.encoder = createVideoEncoder(desktop_config_);
+            if (!stream.encoder)
+                return false;
+
+            screen_streams_.emplace_back(std::move(stream));
         }
 
-        if (new_fps != fps)
+        if (video_encoder_->encoding() == proto::VIDEO_ENCODING_VP8 ||
+            video_encoder_->encoding() == proto::VIDEO_ENCODING_VP9)
         {
-            LOG(LS_INFO) << "FPS: " << fps << " to " << new_fps;
-            desktop_session_proxy_->setScreenCaptureFps(new_fps);
+            setScreenStreamBitrate(
+                static_cast<base::VideoEncoderVPX*>(video_encoder_.get())->targetBitrate());
         }
+
+        // The client restarts the decoders of the streams.
+        proto::Rect* video_rect = packet->mutable_format()->mutable_video_rect();
+        video_rect->set_width(frame->size().width());
+        video_rect->set_height(frame->size().height());
+    }
+
+    // The key frames are requested from the main encoder.
+    if (video_encoder_->isKeyFrameRequired())
+    {
+        for (auto& stream : screen_streams_)
+            stream.encoder->setKeyFrameRequired(true);
+
+        video_encoder_->setKeyFrameRequired(false);
     }
 
-    if (new_fps < 25)
+    packet->set_encoding(video_encoder_->encoding());
+
+    const size_t stream_count = screen_streams_.size();
+    std::vector<proto::VideoPacket*> screen_packets;
+
+    for (size_t i = 0; i < stream_count; ++i)
+        screen_packets.emplace_back(packet->add_screen_packet());
+
+    if (!encode_pool_)
+    {
+        const int thread_count = std::clamp(
+            static_cast<int>(std::thread::hardware_concurrency()), 1, kMaxScreenStreamThreads);
+        encode_pool_ = std::make_unique<base::WorkerPool>(thread_count);
+    }
+
+    const size_t thread_count = static_cast<size_t>(encode_pool_->threadCount());
+    std::vector<uint8_t> results(stream_count, 0);
+
+    // Each stream has its own encoder and writes only to its own packet.
+    encode_pool_->run([&](int index)
+    {
+        for (size_t i = static_cast<size_t>(index); i < stream_count; i += thread_count)
+        {
+            ScreenStream& stream = screen_streams_[i];
+
+            base::FrameView view(*frame, stream.rect);
+            view.copyFrameInfoFrom(*frame);
+
+            base::Region* updated_region = view.updatedRegion();
+            updated_region->intersectWith(stream.rect);
+            updated_region->translate(-stream.rect.x(), -stream.rect.y());
+
+            TRACE_EVENT("encode");
+            results[i] = stream.encoder->encode(&view, screen_packets[i]);
+        }
+    });
+
+    bool is_key_frame = true;
+
+    for (size_t i = 0; i < stream_count; ++i)
     {
-        if (audio_encoder_)
+        if (!results[i])
         {
-            static const int k96kbs = 96 * 1024;
-            static const int k64kbs = 64 * 1024;
-            static const int k32kbs = 32 * 1024;
-            static const int k24kbs = 24 * 1024;
+            LOG(LS_ERROR) << "Unable to encode screen stream " << i;
+            return false;
+        }
 
-            int bitrate = audio_encoder_->bitrate();
-            if (bitrate >= k96kbs)
-                audio_encoder_->setBitrate(k64kbs);
-            else if (bitrate >= k64kbs)
-                audio_encoder_->setBitrate(k32kbs);
-            else if (bitrate >= k32kbs)
-                audio_encoder_->setBitrate(k24kbs);
+        proto::VideoPacket* screen_packet = screen_packets[i];
+        if (screen_packet->has_format())
+        {
+            proto::Rect* video_rect = screen_packet->mutable_format()->mutable_video_rect();
+            video_rect->set_x(screen_streams_[i].rect.x());
+            video_rect->set_y(screen_streams_[i].rect.y());
         }
+
+        is_key_frame = is_key_frame && screen_packet->key_frame();
+    }
+
+    packet->set_key_frame(is_key_frame);
+    return true;
+}
+
+void ClientSessionDesktop::setEncoderCursorPosition(const base::Point& position)
+{
+    if (video_encoding_ != proto::VIDEO_ENCODING_VP9)
+        return;
+
+    // The encoder applies the position before the next frame.
+    std::scoped_lock lock(updates_lock_);
+    cursor_position_ = position;
+}
+
+void ClientSessionDesktop::setScreenStreamBitrate(uint32_t bitrate)
+{
+    int64_t total_area = 0;
+    for (const auto& stream : screen_streams_)
+        total_area += static_cast<int64_t>(stream.rect.width()) * stream.rect.height();
+
+    if (!total_area)
+        return;
+
+    // The bitrate is shared in proportion to the size of the monitors.
+    for (const auto& stream : screen_streams_)
+    {
+        const int64_t area = static_cast<int64_t>(stream.rect.width()) * stream.rect.height();
+        const uint32_t stream_bitrate = std::max(
+            static_cast<uint32_t>(static_cast<int64_t>(bitrate) * area / total_area),
+            kMinVideoBitrate);
+
+        static_cast<base::VideoEncoderVPX*>(stream.encoder.get())->setTargetBitrate(stream_bitrate);
     }
+}
+
+void ClientSessionDesktop::setCaptureFps(int new_fps)
+{
+    const int fps = desktop_session_proxy_->screenCaptureFps();
+    if (new_fps == fps)
+        return;
+
+    LOG(LS_INFO) << "FPS: " << fps << " to " << new_fps << " (throughput: "
+                 << rate_controller_->throughput() << " B/s, queue delay: "
+                 << rate_controller_->queueDelay().count() << " ms)";
+
+    desktop_session_proxy_->setScreenCaptureFps(new_fps);
+
+    if (new_fps < fps)
+        downStepQuality(new_fps);
+    else
+        upStepQuality(new_fps);
+}
 
+void ClientSessionDesktop::downStepQuality(int new_fps)
+{
     if (new_fps < 20)
     {
         base::Size new_forced_size;
@@ -884,36 +1995,8 @@ void ClientSessionDesktop::downStepOverflow()
     }
 }
 
-void ClientSessionDesktop::upStepOverflow()
+void ClientSessionDesktop::upStepQuality(int new_fps)
 {
-    int fps = desktop_session_proxy_->screenCaptureFps();
-    int new_fps = fps;
-    if (fps < max_fps_)
-    {
-        new_fps = fps + 1;
-
-        LOG(LS_INFO) << "FPS: " << fps << " to " << new_fps;
-        desktop_session_proxy_->setScreenCaptureFps(new_fps);
-    }
-
-    if (new_fps >= 25)
-    {
-        if (audio_encoder_)
-        {
-            static const int k96kbs = 96 * 1024;
-            static const int k64kbs = 64 * 1024;
-            static const int k32kbs = 32 * 1024;
-
-            int bitrate = audio_encoder_->bitrate();
-            if (bitrate < k32kbs)
-                audio_encoder_->setBitrate(k32kbs);
-            else if (bitrate < k64kbs)
-                audio_encoder_->setBitrate(k64kbs);
-            else if (bitrate < k96kbs)
-                audio_encoder_->setBitrate(k96kbs);
-        }
-    }
-
     if (!forced_size_.isEmpty())
     {
         base::Size new_forced_size;
@@ -935,4 +2018,26 @@ void ClientSessionDesktop::upStepOverflow()
     }
 }
 
+void ClientSessionDesktop::updateCaptureSize(const base::Size& size)
+{
+    const base::Size capture_size = (size == source_size_) ? base::Size() : size;
+
+    if (capture_size.width() == desktop_session_config_.capture_width &&
+        capture_size.height() == desktop_session_config_.capture_height)
+    {
+        return;
+    }
+
+    LOG(LS_INFO) << "Capture size changed: " << capture_size;
+
+    desktop_session_config_.capture_width = capture_size.width();
+    desktop_session_config_.capture_height = capture_size.height();
+
+    // The new configuration resends the last frame, which must not happen while it is encoded.
+    capture_size_timer_.start(std::chrono::milliseconds(0), [this]()
+    {
+        delegate_->onClientSessionConfigured();
+    });
+}
+
 } // namespace host
@@ -21,7 +21,10 @@
 
 #include "build/build_config.h"
 #include "base/macros_magic.h"
+#include "base/task_runner.h"
 #include "base/desktop/geometry.h"
+#include "base/desktop/region.h"
+#include "base/memory/arena_message.h"
 #include "base/memory/local_memory.h"
 #include "base/waitable_timer.h"
 #include "host/client_session.h"
@@ -31,18 +34,30 @@
 #include "host/task_manager.h"
 #endif // defined(OS_WIN)
 
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <optional>
+
 namespace base {
 class AudioEncoder;
+class AudioQualityController;
+class CaptureRateController;
+class CongestionController;
 class CursorEncoder;
 class Frame;
 class MouseCursor;
 class ScaleReducer;
 class VideoEncoder;
+class WebmRecorder;
+class WorkerPool;
 } // namespace base
 
 namespace host {
 
 class DesktopSessionProxy;
+class ProcessMonitor;
+class ScreenEncodeThread;
 
 class ClientSessionDesktop
     : public ClientSession
@@ -58,7 +73,16 @@ public:
 
     void setDesktopSessionProxy(base::local_shared_ptr<DesktopSessionProxy> desktop_session_proxy);
 
-    void encodeScreen(const base::Frame* frame, const base::MouseCursor* cursor);
+    // The frame is scaled and encoded on a separate thread unless the hardware encoder is used or
+    // the environment variable ASPIA_NO_ENCODE_THREAD is set. Only the updated region is copied.
+    // prepareScreen is called on the thread of the session and returns false if there is nothing
+    // to encode. postScreen copies the frame to the encoding thread. If hasEncodeThread() is true,
+    // postScreen can be called on any thread while the thread of the session waits for it, so that
+    // the frames of several clients are copied in parallel. Otherwise the frame is encoded by
+    // postScreen on the thread of the session.
+    bool prepareScreen(const base::Frame* frame, const base::MouseCursor* cursor);
+    void postScreen();
+    bool hasEncodeThread() const { return encode_thread_ != nullptr; }
     void encodeAudio(const proto::AudioPacket& audio_packet);
     void setVideoErrorCode(proto::VideoErrorCode error_code);
     void setCursorPosition(const proto::CursorPosition& cursor_position);
@@ -66,12 +90,23 @@ public:
     void injectClipboardEvent(const proto::ClipboardEvent& event);
 
     const DesktopSession::Config& desktopSessionConfig() const { return desktop_session_config_; }
+    bool isVideoPaused() const { return is_video_paused_; }
+
+    // Returns true if the client can receive the video packets encoded for |leader|. The clients
+    // must have the same encoder configuration and video size.
+    bool canShareScreenWith(const ClientSessionDesktop& leader) const;
+
+    // The leader encodes the screen and sends the video packets also to this client, which only
+    // encodes the cursor. The client joins with the next key frame of the leader. If |leader| is
+    // null, the client encodes the screen itself again.
+    void setScreenLeader(ClientSessionDesktop* leader);
 
 protected:
     // ClientSession implementation.
     void onStarted() override;
     void onReceived(uint8_t channel_id, const base::ByteArray& buffer) override;
     void onWritten(uint8_t channel_id, size_t pending) override;
+    void addMemoryUsage(MemoryUsage* usage) override;
 
 #if defined(OS_WIN)
     // TaskManager::Delegate implementation.
@@ -85,16 +120,93 @@ private:
     void readPreferredSizeExtension(const std::string& data);
     void readVideoPauseExtension(const std::string& data);
     void readAudioPauseExtension(const std::string& data);
+    void readKeyFrameExtension();
     void readPowerControlExtension(const std::string& data);
     void readRemoteUpdateExtension(const std::string& data);
     void readSystemInfoExtension(const std::string& data);
     void readVideoRecordingExtension(const std::string& data);
     void readTaskManagerExtension(const std::string& data);
-    void onOverflowDetectionTimer();
-    void downStepOverflow();
-    void upStepOverflow();
+    void onRateControlTimer();
+    void updateVideoBitrate();
+    void updateAudioQuality();
+    void setCaptureFps(int new_fps);
+    void downStepQuality(int new_fps);
+    void upStepQuality(int new_fps);
+
+    // Asks the capturer to scale the frames down to |size|, so that the full frames are not copied
+    // from the video memory. The configuration is applied after the current frame is encoded.
+    void updateCaptureSize(const base::Size& size);
+
+    // Creates or destroys the encoding thread for |encoding|. Must not be called with
+    // |encode_lock_| held.
+    void updateEncodeThread(proto::VideoEncoding encoding);
+
+    // Scales and encodes |frame| to |size| and the cursor shape. Called on the encoding thread or
+    // on the thread of the session. The returned callback sends the message and is called on the
+    // thread of the session.
+    base::TaskRunner::Callback encodeFrame(
+        const base::Frame* frame, const base::MouseCursor* cursor, const base::Size& size);
+
+    // Applies the changes of the encoders requested by the session. Called with |encode_lock_|
+    // held.
+    void applyEncoderUpdates();
+    void requestKeyFrame();
 
+    struct EncodeStats
+    {
+        bool has_video_packet = false;
+        bool has_cursor_shape = false;
+        bool is_key_frame = false;
+        base::Size video_size; // Not empty if the packet has a format.
+        double scale_factor_x = 0;
+        double scale_factor_y = 0;
+        double dirty_fraction = 0;
+        std::chrono::microseconds encode_time { 0 };
+        size_t packet_size = 0;
+    };
+
+    // Called on the thread of the session. The followers get a copy of |buffer|, because the
+    // channels encrypt the data in place.
+    void onScreenEncoded(base::ByteArray&& buffer, base::ByteArray&& cursor_buffer,
+                         base::TcpChannel::Priority priority, const EncodeStats& stats);
+    void onSharedScreenEncoded(const base::ByteArray& buffer, const EncodeStats& stats);
+    void applyEncodeStats(const EncodeStats& stats);
+    bool canShareScreen() const;
+
+    // The leader keeps the messages since its last key frame. A new follower gets them at once
+    // instead of a key frame that would be forced on all clients of the shared encoder.
+    void cacheScreenMessage(const base::ByteArray& buffer, const EncodeStats& stats);
+    void clearScreenCache();
+    bool sendScreenCache(const ClientSessionDesktop& leader);
+
+    // If the whole desktop of several monitors is captured and the client supports it, each
+    // monitor is encoded as a separate stream in parallel.
+    bool useScreenStreams(const base::Frame* frame) const;
+    bool encodeScreenStreams(const base::Frame* frame, const base::Size& screen_size,
+                             proto::VideoPacket* packet);
+    void setScreenStreamBitrate(uint32_t bitrate);
+    void setEncoderCursorPosition(const base::Point& position);
+
+    // The encoded VP8 and VP9 packets and the audio are written to WebM files if the recording of
+    // the sessions is enabled in the settings of the host.
+    void startSessionRecording();
+    void recordVideoPacket(const proto::VideoPacket& packet, const base::Size& video_size);
+
+    // While the outgoing queue is backlogged the captured frames are not encoded. Their updated
+    // regions are accumulated and sent as one update when the queue drains.
+    bool isBacklogged();
+    void skipFrame(const base::Frame* frame);
+    std::unique_ptr<base::Frame> takeSkippedFrames(const base::Frame* frame);
+
+    std::shared_ptr<base::TaskRunner> task_runner_;
     base::local_shared_ptr<DesktopSessionProxy> desktop_session_proxy_;
+
+    // The encoders are used on the encoding thread while |encode_lock_| is held. The session
+    // changes them only when the configuration is changed.
+    std::unique_ptr<ScreenEncodeThread> encode_thread_;
+    std::mutex encode_lock_;
+    base::ArenaMessage<proto::HostToClient> encode_message_;
+    std::atomic_bool has_screen_followers_ { false };
     std::unique_ptr<base::ScaleReducer> scale_reducer_;
     std::unique_ptr<base::VideoEncoder> video_encoder_;
     std::unique_ptr<base::CursorEncoder> cursor_encoder_;
@@ -106,19 +218,93 @@ private:
     bool is_video_paused_ = false;
     bool is_audio_paused_ = false;
 
-    base::WaitableTimer overflow_detection_timer_;
-    size_t write_overflow_count_ = 0;
-    size_t write_normal_count_ = 1;
-    size_t last_pending_count_ = 0;
+    // Used only on the thread of the session.
+    proto::VideoEncoding video_encoding_ = proto::VIDEO_ENCODING_UNKNOWN;
+    uint32_t video_bitrate_ = 0;
+    double scale_factor_x_ = 0;
+    double scale_factor_y_ = 0;
+    base::Size encode_size_;
+    base::Size stream_size_;
+    bool whole_frame_required_ = false;
+
+    // The frame between prepareScreen and postScreen.
+    const base::Frame* prepared_frame_ = nullptr;
+    const base::MouseCursor* prepared_cursor_ = nullptr;
+    base::Size prepared_size_;
+    bool prepared_whole_frame_ = false;
+    std::unique_ptr<base::Frame> merged_frame_;
+
+    enum class ShareState
+    {
+        JOINING,           // The packets already encoded by this client are being sent.
+        WAITING_KEY_FRAME, // The key frame is requested from the leader.
+        STARTED
+    };
+
+    ClientSessionDesktop* screen_leader_ = nullptr;
+    std::vector<ClientSessionDesktop*> screen_followers_;
+    ShareState share_state_ = ShareState::JOINING;
+    uint64_t share_generation_ = 0;
+    std::vector<base::ByteArray> screen_cache_;
+    size_t screen_cache_bytes_ = 0;
+    bool is_screen_cache_valid_ = false;
+
+    // The changes of the encoders requested by the session. The session does not wait for the
+    // encoder to apply them.
+    std::mutex updates_lock_;
+    bool key_frame_required_ = false;
+    std::optional<base::Point> cursor_position_;
+    uint32_t pending_bitrate_ = 0;
+    uint32_t input_probe_id_ = 0;
+    std::chrono::steady_clock::time_point input_probe_time_;
+
+    proto::DesktopConfig desktop_config_;
+
+    struct ScreenStream
+    {
+        base::Rect rect;
+        std::unique_ptr<base::VideoEncoder> encoder;
+    };
+
+    // Rectangles of the monitors in the whole desktop frame. Empty if one monitor is captured.
+    std::vector<base::Rect> screen_rects_;
+    std::vector<ScreenStream> screen_streams_;
+    std::unique_ptr<base::WorkerPool> encode_pool_;
+
+    base::WaitableTimer rate_control_timer_;
+    base::WaitableTimer capture_size_timer_;
+    std::unique_ptr<base::CaptureRateController> rate_controller_;
     bool critical_overflow_ = false;
-    int max_fps_ = 0;
+
+    std::unique_ptr<base::WebmRecorder> webm_recorder_;
+    bool recording_unsupported_ = false;
+
+    bool is_backlogged_ = false;
+    bool has_skipped_frames_ = false;
+    bool skipped_key_frame_required_ = false;
+    base::Size skipped_frame_size_;
+    base::Region skipped_region_;
+
+    // Estimates the bandwidth of the path from the channel statistics. The target bitrate of the
+    // video encoder follows the estimate.
+    std::unique_ptr<base::CongestionController> bandwidth_estimator_;
+    int64_t last_delivered_bytes_ = 0;
+    uint32_t last_retransmits_ = 0;
+
+    // The bitrate of the audio follows the bandwidth estimate and the complexity follows the load
+    // of the host.
+    std::unique_ptr<base::AudioQualityController> audio_quality_controller_;
+    int audio_complexity_countdown_ = 0;
+#if defined(OS_WIN)
+    std::unique_ptr<ProcessMonitor> process_monitor_;
+#endif // defined(OS_WIN)
 
 #if defined(OS_WIN)
     std::unique_ptr<TaskManager> task_manager_;
 #endif // defined(OS_WIN)
 
-    std::unique_ptr<proto::ClientToHost> incoming_message_;
-    std::unique_ptr<proto::HostToClient> outgoing_message_;
+    base::ArenaMessage<proto::ClientToHost> incoming_message_;
+    base::ArenaMessage<proto::HostToClient> outgoing_message_;
 
     DISALLOW_COPY_AND_ASSIGN(ClientSessionDesktop);
 };
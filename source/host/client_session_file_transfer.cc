@@ -35,6 +35,8 @@
 #include <WtsApi32.h>
 #endif // defined(OS_WIN)
 
+#include <atomic>
+
 namespace host {
 
 namespace {
@@ -107,7 +109,11 @@ public:
     ~Worker() override;
 
     void start();
-    void postRequest(std::unique_ptr<proto::FileRequest> request);
+    void postRequest(std::unique_ptr<proto::FileRequest> request,
+                     base::ByteArray&& request_data = base::ByteArray());
+
+    // Size of the data of the uploaded files which is not yet written.
+    size_t queuedBytes() const { return queued_bytes_.load(std::memory_order_relaxed); }
 
 protected:
     // base::Thread::Delegate implementation.
@@ -123,6 +129,7 @@ private:
     std::shared_ptr<base::TcpChannelProxy> channel_proxy_;
     std::shared_ptr<common::FileTaskProducerProxy> producer_proxy_;
     std::unique_ptr<common::FileWorker> impl_;
+    std::atomic_size_t queued_bytes_ { 0 };
 
 #if defined(OS_WIN)
     std::unique_ptr<base::win::ScopedImpersonator> impersonator_;
@@ -151,12 +158,18 @@ void ClientSessionFileTransfer::Worker::start()
     thread_.start(base::MessageLoop::Type::DEFAULT, this);
 }
 
-void ClientSessionFileTransfer::Worker::postRequest(std::unique_ptr<proto::FileRequest> request)
+void ClientSessionFileTransfer::Worker::postRequest(std::unique_ptr<proto::FileRequest> request,
+                                                    base::ByteArray&& request_data)
 {
     if (impl_)
     {
+        queued_bytes_.fetch_add(request_data.size(), std::memory_order_relaxed);
+
         std::shared_ptr<common::FileTask> task = std::make_shared<common::FileTask>(
-            producer_proxy_, std::move(request), common::FileTask::Target::LOCAL);
+            producer_proxy_,
+            std::move(request),
+            common::FileTask::Target::LOCAL,
+            std::move(request_data));
 
         impl_->doTask(std::move(task));
     }
@@ -164,7 +177,7 @@ void ClientSessionFileTransfer::Worker::postRequest(std::unique_ptr<proto::FileR
     {
         proto::FileReply reply;
         reply.set_error_code(proto::FILE_ERROR_NO_LOGGED_ON_USER);
-        channel_proxy_->send(proto::HOST_CHANNEL_ID_SESSION, base::serialize(reply));
+        channel_proxy_->send(proto::HOST_CHANNEL_ID_SESSION, reply);
     }
 }
 
@@ -215,7 +228,13 @@ void ClientSessionFileTransfer::Worker::onAfterThreadRunning()
 
 void ClientSessionFileTransfer::Worker::onTaskDone(std::shared_ptr<common::FileTask> task)
 {
-    channel_proxy_->send(proto::HOST_CHANNEL_ID_SESSION, base::serialize(task->reply()));
+    queued_bytes_.fetch_sub(task->requestData().size(), std::memory_order_relaxed);
+
+    channel_proxy_->send(proto::HOST_CHANNEL_ID_SESSION, task->reply());
+
+    // The data of the packet follows the reply as is.
+    if (task->reply().packet().flags() & proto::FilePacket::DETACHED_DATA)
+        channel_proxy_->send(proto::HOST_CHANNEL_ID_SESSION, task->takeReplyData());
 }
 
 ClientSessionFileTransfer::ClientSessionFileTransfer(std::unique_ptr<base::TcpChannel> channel)
@@ -236,6 +255,13 @@ void ClientSessionFileTransfer::onStarted()
 
 void ClientSessionFileTransfer::onReceived(uint8_t /* channel_id */, const base::ByteArray& buffer)
 {
+    if (detached_request_)
+    {
+        // The message contains the data of the previous request.
+        worker_->postRequest(std::move(detached_request_), base::ByteArray(buffer));
+        return;
+    }
+
     std::unique_ptr<proto::FileRequest> request = std::make_unique<proto::FileRequest>();
 
     if (!base::parse(buffer, request.get()))
@@ -252,6 +278,13 @@ void ClientSessionFileTransfer::onReceived(uint8_t /* channel_id */, const base:
         worker_->start();
     }
 
+    if (request->packet().flags() & proto::FilePacket::DETACHED_DATA)
+    {
+        // The request is completed by the next message.
+        detached_request_ = std::move(request);
+        return;
+    }
+
     worker_->postRequest(std::move(request));
 }
 
@@ -260,4 +293,13 @@ void ClientSessionFileTransfer::onWritten(uint8_t /* channel_id */, size_t /* pe
     // Nothing
 }
 
+void ClientSessionFileTransfer::addMemoryUsage(MemoryUsage* usage)
+{
+    if (worker_)
+        usage->file_transfer += worker_->queuedBytes();
+
+    if (detached_request_)
+        usage->file_transfer += detached_request_->ByteSizeLong();
+}
+
 } // namespace host
@@ -22,6 +22,10 @@
 #include "base/macros_magic.h"
 #include "host/client_session.h"
 
+namespace proto {
+class FileRequest;
+} // namespace proto
+
 namespace host {
 
 class ClientSessionFileTransfer : public ClientSession
@@ -35,11 +39,15 @@ protected:
     void onStarted() override;
     void onReceived(uint8_t channel_id, const base::ByteArray& buffer) override;
     void onWritten(uint8_t channel_id, size_t pending) override;
+    void addMemoryUsage(MemoryUsage* usage) override;
 
 private:
     class Worker;
     std::unique_ptr<Worker> worker_;
 
+    // Request whose packet data is expected in the next message.
+    std::unique_ptr<proto::FileRequest> detached_request_;
+
     DISALLOW_COPY_AND_ASSIGN(ClientSessionFileTransfer);
 };
 
@@ -20,13 +20,94 @@
 
 #include "base/logging.h"
 #include "base/net/tcp_channel_proxy.h"
+#include "base/threading/thread_pool.h"
 
 #if defined(OS_WIN)
+#include "base/win/scoped_com_initializer.h"
 #include "host/system_info.h"
 #endif // defined(OS_WIN)
 
+#include <deque>
+#include <mutex>
+
 namespace host {
 
+// Collects the requested categories in the shared thread pool, so a slow category (for example,
+// event logs or open files) does not block the network thread. The requests of one session are
+// processed in the order in which they are received.
+class ClientSessionSystemInfo::Worker : public std::enable_shared_from_this<Worker>
+{
+public:
+    explicit Worker(std::shared_ptr<base::TcpChannelProxy> channel_proxy)
+        : channel_proxy_(std::move(channel_proxy))
+    {
+        // Nothing
+    }
+
+    void postRequest(const base::ByteArray& buffer)
+    {
+        std::scoped_lock lock(lock_);
+
+        requests_.emplace_back(buffer);
+        if (is_running_)
+            return;
+
+        is_running_ = true;
+        base::ThreadPool::shared()->postTask(
+            std::bind(&Worker::processRequests, shared_from_this()));
+    }
+
+private:
+    void processRequests()
+    {
+#if defined(OS_WIN)
+        // Some enumerators use COM and the threads of the pool are not initialized for it.
+        base::win::ScopedCOMInitializer com_initializer(base::win::ScopedCOMInitializer::kMTA);
+#endif // defined(OS_WIN)
+
+        while (true)
+        {
+            base::ByteArray buffer;
+
+            {
+                std::scoped_lock lock(lock_);
+
+                if (requests_.empty())
+                {
+                    is_running_ = false;
+                    return;
+                }
+
+                buffer = std::move(requests_.front());
+                requests_.pop_front();
+            }
+
+#if defined(OS_WIN)
+            proto::system_info::SystemInfoRequest request;
+
+            if (!base::parse(buffer, &request))
+            {
+                LOG(LS_WARNING) << "Unable to parse system info request";
+                continue;
+            }
+
+            proto::system_info::SystemInfo system_info;
+            createSystemInfo(request, &system_info);
+
+            channel_proxy_->send(proto::HOST_CHANNEL_ID_SESSION, system_info);
+#endif // defined(OS_WIN)
+        }
+    }
+
+    std::shared_ptr<base::TcpChannelProxy> channel_proxy_;
+
+    std::mutex lock_;
+    std::deque<base::ByteArray> requests_;
+    bool is_running_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(Worker);
+};
+
 ClientSessionSystemInfo::ClientSessionSystemInfo(std::unique_ptr<base::TcpChannel> channel)
     : ClientSession(proto::SESSION_TYPE_SYSTEM_INFO, std::move(channel))
 {
@@ -40,25 +121,13 @@ ClientSessionSystemInfo::~ClientSessionSystemInfo()
 
 void ClientSessionSystemInfo::onStarted()
 {
-    // Nothing
+    worker_ = std::make_shared<Worker>(channelProxy());
 }
 
 void ClientSessionSystemInfo::onReceived(uint8_t /* channel_id */, const base::ByteArray& buffer)
 {
-#if defined(OS_WIN)
-    proto::system_info::SystemInfoRequest request;
-
-    if (!base::parse(buffer, &request))
-    {
-        LOG(LS_WARNING) << "Unable to parse system info request";
-        return;
-    }
-
-    proto::system_info::SystemInfo system_info;
-    createSystemInfo(request, &system_info);
-
-    sendMessage(proto::HOST_CHANNEL_ID_SESSION, base::serialize(system_info));
-#endif // defined(OS_WIN)
+    if (worker_)
+        worker_->postRequest(buffer);
 }
 
 void ClientSessionSystemInfo::onWritten(uint8_t /* channel_id */, size_t /* pending */)
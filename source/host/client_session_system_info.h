@@ -22,6 +22,8 @@
 #include "base/macros_magic.h"
 #include "host/client_session.h"
 
+#include <memory>
+
 namespace host {
 
 class ClientSessionSystemInfo : public ClientSession
@@ -37,6 +39,9 @@ protected:
     void onWritten(uint8_t channel_id, size_t pending) override;
 
 private:
+    class Worker;
+    std::shared_ptr<Worker> worker_;
+
     DISALLOW_COPY_AND_ASSIGN(ClientSessionSystemInfo);
 };
 
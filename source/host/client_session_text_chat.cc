@@ -37,7 +37,15 @@ ClientSessionTextChat::~ClientSessionTextChat()
 
 void ClientSessionTextChat::sendTextChat(const proto::TextChat& text_chat)
 {
-    sendMessage(proto::HOST_CHANNEL_ID_SESSION, base::serialize(text_chat));
+    if (version() < base::Version(2, 7, 0))
+    {
+        sendMessage(proto::HOST_CHANNEL_ID_SESSION, base::serialize(text_chat));
+        return;
+    }
+
+    proto::TextChat message;
+    if (batcher_.add(text_chat, &message))
+        sendMessage(proto::HOST_CHANNEL_ID_SESSION, base::serialize(message));
 }
 
 void ClientSessionTextChat::sendStatus(proto::TextChatStatus::Status status)
@@ -72,10 +80,28 @@ void ClientSessionTextChat::onReceived(uint8_t /* channel_id */, const base::Byt
 
     if (!base::parse(buffer, &text_chat))
     {
-        LOG(LS_WARNING) << "Unable to parse system info request";
+        LOG(LS_WARNING) << "Unable to parse text chat message";
         return;
     }
 
+    common::TextChatBatcher::unpack(text_chat, [this](const proto::TextChat& item)
+    {
+        handleTextChat(item);
+    });
+}
+
+void ClientSessionTextChat::onWritten(uint8_t /* channel_id */, size_t pending)
+{
+    if (pending)
+        return;
+
+    proto::TextChat message;
+    if (batcher_.takeBatch(&message))
+        sendMessage(proto::HOST_CHANNEL_ID_SESSION, base::serialize(message));
+}
+
+void ClientSessionTextChat::handleTextChat(const proto::TextChat& text_chat)
+{
     if (hasUser())
     {
         delegate_->onClientSessionTextChat(id(), text_chat);
@@ -87,9 +113,4 @@ void ClientSessionTextChat::onReceived(uint8_t /* channel_id */, const base::Byt
     }
 }
 
-void ClientSessionTextChat::onWritten(uint8_t /* channel_id */, size_t /* pending */)
-{
-    // Nothing
-}
-
 } // namespace host
@@ -20,6 +20,7 @@
 #define HOST_CLIENT_SESSION_TEXT_CHAT_H
 
 #include "base/macros_magic.h"
+#include "common/text_chat_batcher.h"
 #include "host/client_session.h"
 
 namespace host {
@@ -43,6 +44,9 @@ protected:
     void onWritten(uint8_t channel_id, size_t pending) override;
 
 private:
+    void handleTextChat(const proto::TextChat& text_chat);
+
+    common::TextChatBatcher batcher_;
     bool has_user_ = false;
 
     DISALLOW_COPY_AND_ASSIGN(ClientSessionTextChat);
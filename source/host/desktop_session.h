@@ -57,6 +57,14 @@ public:
         bool lock_at_disconnect = false;
         bool clear_clipboard = true;
         bool cursor_position = false;
+        bool prefer_i420 = false;
+        bool low_latency_audio = false;
+        bool capture_audio = false;
+
+        // Size to which the frames are scaled down by the capturer. Zero values mean the original
+        // size.
+        int capture_width = 0;
+        int capture_height = 0;
 
         bool equals(const Config& other) const
         {
@@ -66,7 +74,12 @@ public:
                    (block_input == other.block_input) &&
                    (lock_at_disconnect == other.lock_at_disconnect) &&
                    (clear_clipboard == other.clear_clipboard) &&
-                   (cursor_position == other.cursor_position);
+                   (cursor_position == other.cursor_position) &&
+                   (prefer_i420 == other.prefer_i420) &&
+                   (low_latency_audio == other.low_latency_audio) &&
+                   (capture_audio == other.capture_audio) &&
+                   (capture_width == other.capture_width) &&
+                   (capture_height == other.capture_height);
         }
     };
 
@@ -20,15 +20,21 @@
 
 #include "base/logging.h"
 #include "base/power_controller.h"
+#include "base/trace_event.h"
+#include "base/waitable_timer.h"
 #include "base/audio/audio_capturer_wrapper.h"
+#include "base/codec/rect_list_codec.h"
 #include "base/desktop/capture_scheduler.h"
 #include "base/desktop/mouse_cursor.h"
 #include "base/desktop/screen_capturer_wrapper.h"
 #include "base/desktop/shared_frame.h"
+#include "base/ipc/shared_frame_ring.h"
 #include "base/ipc/shared_memory.h"
 #include "base/threading/thread.h"
 #include "host/system_settings.h"
 
+#include <cstring>
+
 #if defined(OS_WIN)
 #include "base/desktop/desktop_environment_win.h"
 #include "base/win/message_window.h"
@@ -43,6 +49,32 @@ namespace host {
 
 namespace {
 
+// The cursor is polled at about 60 Hz regardless of the frame rate.
+const std::chrono::minutes kCapturerIdleTimeout { 5 };
+const std::chrono::milliseconds kCursorCaptureInterval { 16 };
+
+// Number of cursor shapes kept in shared buffers. Applications usually switch between a few
+// shapes, so only these are transferred repeatedly.
+const size_t kCursorCacheSize = 16;
+
+// The service can pass mouse moves faster than the clients send them (for example, after a delay
+// in the network). They are injected at most at 200 Hz.
+const std::chrono::milliseconds kMouseMoveInterval { 5 };
+
+// FNV-1a hash of the cursor image. Matches are compared byte by byte, so collisions are harmless.
+uint32_t cursorHash(const base::ByteArray& image)
+{
+    uint32_t hash = 2166136261u;
+
+    for (uint8_t byte : image)
+    {
+        hash ^= byte;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
 const char* controlActionToString(proto::internal::DesktopControl::Action action)
 {
     switch (action)
@@ -59,6 +91,12 @@ const char* controlActionToString(proto::internal::DesktopControl::Action action
         case proto::internal::DesktopControl::LOGOFF:
             return "LOGOFF";
 
+        case proto::internal::DesktopControl::PAUSE_CAPTURE:
+            return "PAUSE_CAPTURE";
+
+        case proto::internal::DesktopControl::RESUME_CAPTURE:
+            return "RESUME_CAPTURE";
+
         default:
             return "Unknown control action";
     }
@@ -68,8 +106,8 @@ const char* controlActionToString(proto::internal::DesktopControl::Action action
 
 DesktopSessionAgent::DesktopSessionAgent(std::shared_ptr<base::TaskRunner> task_runner)
     : io_task_runner_(std::move(task_runner)),
-      incoming_message_(std::make_unique<proto::internal::ServiceToDesktop>()),
-      outgoing_message_(std::make_unique<proto::internal::DesktopToService>())
+      idle_timer_(std::make_unique<base::WaitableTimer>(
+          base::WaitableTimer::Type::SINGLE_SHOT, io_task_runner_))
 {
     LOG(LS_INFO) << "Ctor";
 
@@ -103,6 +141,9 @@ DesktopSessionAgent::~DesktopSessionAgent()
 #if defined(OS_WIN)
     ui_thread_.stop();
 #endif // defined(OS_WIN)
+
+    // The trace of the ended session is written if tracing is enabled.
+    base::TraceLog::instance().dump();
 }
 
 void DesktopSessionAgent::start(std::u16string_view channel_id)
@@ -117,8 +158,15 @@ void DesktopSessionAgent::start(std::u16string_view channel_id)
         return;
     }
 
+    // The service already reads the frames from the shared memory of the agent.
+    channel_->setSharedMemoryEnabled(true);
     channel_->setListener(this);
     channel_->resume();
+
+    // The agent is started before the clients connect. The capturer is initialized now and stays
+    // suspended, so the first frame does not wait for it.
+    createScreenCapturer();
+    setCapturePaused(true);
 }
 
 void DesktopSessionAgent::onDisconnected()
@@ -126,12 +174,18 @@ void DesktopSessionAgent::onDisconnected()
     LOG(LS_INFO) << "IPC channel disconnected";
 
     setEnabled(false);
+
+    idle_timer_->stop();
+    screen_capturer_.reset();
+    cursor_cache_.clear();
+    shared_memory_factory_.reset();
+
     io_task_runner_->postQuit();
 }
 
 void DesktopSessionAgent::onMessageReceived(const base::ByteArray& buffer)
 {
-    incoming_message_->Clear();
+    incoming_message_.clear();
 
     if (!base::parse(buffer, incoming_message_.get()))
     {
@@ -141,13 +195,53 @@ void DesktopSessionAgent::onMessageReceived(const base::ByteArray& buffer)
 
     if (incoming_message_->has_next_screen_capture())
     {
-        captureEnd(std::chrono::milliseconds(
-            incoming_message_->next_screen_capture().update_interval()));
+        if (frame_ring_)
+        {
+            // The service released a frame buffer we are waiting for.
+            if (is_waiting_for_buffer_)
+            {
+                is_waiting_for_buffer_ = false;
+
+                if (!isFrameBufferAvailable())
+                {
+                    // Each release frees the oldest buffer, so the service does not use the ring
+                    // (for example, it could not open it). Wait for the service on each frame.
+                    LOG(LS_WARNING) << "Frame ring is not used by the service";
+                    frame_ring_.reset();
+                    pending_captures_.clear();
+                }
+
+                captureBegin();
+            }
+        }
+        else
+        {
+            const std::chrono::milliseconds update_interval(
+                incoming_message_->next_screen_capture().update_interval());
+
+            // A zero interval is sent when the service has no frame yet. The capture is already
+            // running, so only the messages sent after the frames release buffers.
+            if (update_interval != std::chrono::milliseconds::zero())
+            {
+                // The service processes the frames in order, so each message releases the oldest.
+                if (!pending_captures_.empty())
+                    pending_captures_.pop_front();
+
+                if (capture_scheduler_)
+                    capture_scheduler_->setUpdateInterval(update_interval);
+
+                if (is_waiting_for_buffer_)
+                {
+                    is_waiting_for_buffer_ = false;
+                    captureBegin();
+                }
+            }
+        }
     }
     else if (incoming_message_->has_mouse_event())
     {
-        if (input_injector_)
-            input_injector_->injectMouseEvent(incoming_message_->mouse_event());
+        if (mouse_event_coalescer_)
+            mouse_event_coalescer_->addEvent(incoming_message_->mouse_event());
     }
     else if (incoming_message_->has_key_event())
     {
@@ -193,6 +287,11 @@ void DesktopSessionAgent::onMessageReceived(const base::ByteArray& buffer)
         LOG(LS_INFO) << "Lock at disconnect: " << config.lock_at_disconnect();
         LOG(LS_INFO) << "Clear clipboard: " << config.clear_clipboard();
         LOG(LS_INFO) << "Cursor position: " << config.cursor_position();
+        LOG(LS_INFO) << "Prefer I420: " << config.prefer_i420();
+        LOG(LS_INFO) << "Low latency audio: " << config.low_latency_audio();
+        LOG(LS_INFO) << "Capture audio: " << config.capture_audio();
+        LOG(LS_INFO) << "Capture size: " << config.capture_width() << "x"
+                     << config.capture_height();
 
         if (screen_capturer_)
         {
@@ -200,6 +299,10 @@ void DesktopSessionAgent::onMessageReceived(const base::ByteArray& buffer)
             screen_capturer_->enableEffects(!config.disable_effects());
             screen_capturer_->enableFontSmoothing(!config.disable_font_smoothing());
             screen_capturer_->enableCursorPosition(config.cursor_position());
+            screen_capturer_->setPreferredLayout(config.prefer_i420() ?
+                base::Frame::Layout::I420 : base::Frame::Layout::PACKED);
+            screen_capturer_->setPreferredSize(
+                base::Size(config.capture_width(), config.capture_height()));
         }
         else
         {
@@ -217,6 +320,13 @@ void DesktopSessionAgent::onMessageReceived(const base::ByteArray& buffer)
 
         lock_at_disconnect_ = config.lock_at_disconnect();
         clear_clipboard_ = config.clear_clipboard();
+        low_latency_audio_ = config.low_latency_audio();
+        capture_audio_ = config.capture_audio();
+
+        if (audio_capturer_)
+            audio_capturer_->setLowLatency(low_latency_audio_);
+
+        updateAudioCapturer();
     }
     else if (incoming_message_->has_control())
     {
@@ -233,6 +343,14 @@ void DesktopSessionAgent::onMessageReceived(const base::ByteArray& buffer)
                 setEnabled(false);
                 break;
 
+            case proto::internal::DesktopControl::PAUSE_CAPTURE:
+                setCapturePaused(true);
+                break;
+
+            case proto::internal::DesktopControl::RESUME_CAPTURE:
+                setCapturePaused(false);
+                break;
+
             case proto::internal::DesktopControl::LOGOFF:
             {
                 if (!base::PowerController::logoff())
@@ -267,7 +385,7 @@ void DesktopSessionAgent::onSharedMemoryCreate(int id)
 {
     LOG(LS_INFO) << "Shared memory created: " << id;
 
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
 
     proto::internal::SharedBuffer* shared_buffer = outgoing_message_->mutable_shared_buffer();
     shared_buffer->set_type(proto::internal::SharedBuffer::CREATE);
@@ -280,7 +398,7 @@ void DesktopSessionAgent::onSharedMemoryDestroy(int id)
 {
     LOG(LS_INFO) << "Shared memory destroyed: " << id;
 
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
 
     proto::internal::SharedBuffer* shared_buffer = outgoing_message_->mutable_shared_buffer();
     shared_buffer->set_type(proto::internal::SharedBuffer::RELEASE);
@@ -292,7 +410,7 @@ void DesktopSessionAgent::onSharedMemoryDestroy(int id)
 void DesktopSessionAgent::onScreenListChanged(
     const base::ScreenCapturer::ScreenList& list, base::ScreenCapturer::ScreenId current)
 {
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
 
     proto::ScreenList* screen_list = outgoing_message_->mutable_screen_list();
     screen_list->set_current_screen(current);
@@ -330,10 +448,9 @@ void DesktopSessionAgent::onScreenListChanged(
     channel_->send(base::serialize(*outgoing_message_));
 }
 
-void DesktopSessionAgent::onScreenCaptured(
-    const base::Frame* frame, const base::MouseCursor* mouse_cursor)
+void DesktopSessionAgent::onScreenCaptured(const base::Frame* frame)
 {
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
 
     proto::internal::ScreenCaptured* screen_captured = outgoing_message_->mutable_screen_captured();
 
@@ -352,49 +469,41 @@ void DesktopSessionAgent::onScreenCaptured(
         proto::internal::DesktopFrame* serialized_frame = screen_captured->mutable_frame();
 
         serialized_frame->set_capturer_type(frame->capturerType());
+        serialized_frame->set_layout(static_cast<uint32_t>(frame->layout()));
         serialized_frame->set_shared_buffer_id(shared_memory->id());
         serialized_frame->set_width(frame->size().width());
         serialized_frame->set_height(frame->size().height());
 
-        for (base::Region::Iterator it(frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
+        if (frame->screenSize() != frame->size())
         {
-            proto::Rect* dirty_rect = serialized_frame->add_dirty_rect();
-            base::Rect rect = it.rect();
-
-            dirty_rect->set_x(rect.x());
-            dirty_rect->set_y(rect.y());
-            dirty_rect->set_width(rect.width());
-            dirty_rect->set_height(rect.height());
+            serialized_frame->set_screen_width(frame->screenSize().width());
+            serialized_frame->set_screen_height(frame->screenSize().height());
         }
-    }
 
-    if (mouse_cursor)
-    {
-        proto::internal::MouseCursor* serialized_mouse_cursor =
-            screen_captured->mutable_mouse_cursor();
+        // The capture is synchronous, so it has just finished.
+        serialized_frame->set_capture_start_time(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                capture_start_time_.time_since_epoch()).count());
+        serialized_frame->set_capture_time(static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - capture_start_time_).count()));
 
-        serialized_mouse_cursor->set_width(mouse_cursor->width());
-        serialized_mouse_cursor->set_height(mouse_cursor->height());
-        serialized_mouse_cursor->set_hotspot_x(mouse_cursor->hotSpotX());
-        serialized_mouse_cursor->set_hotspot_y(mouse_cursor->hotSpotY());
-        serialized_mouse_cursor->set_dpi_x(mouse_cursor->constDpi().x());
-        serialized_mouse_cursor->set_dpi_y(mouse_cursor->constDpi().y());
-        serialized_mouse_cursor->set_data(base::toStdString(mouse_cursor->constImage()));
+        base::RectListCodec::encode(
+            frame->constUpdatedRegion(), serialized_frame->mutable_packed_dirty_rect());
     }
 
-    if (screen_captured->has_frame() || screen_captured->has_mouse_cursor())
+    if (screen_captured->has_frame())
     {
+        onFrameSent();
         channel_->send(base::serialize(*outgoing_message_));
     }
-    else
-    {
-        captureEnd(capture_scheduler_->updateInterval());
-    }
+
+    captureEnd(updateInterval());
 }
 
 void DesktopSessionAgent::onScreenCaptureError(base::ScreenCapturer::Error error)
 {
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
     proto::internal::ScreenCaptured* screen_captured = outgoing_message_->mutable_screen_captured();
 
     switch (error)
@@ -412,12 +521,40 @@ void DesktopSessionAgent::onScreenCaptureError(base::ScreenCapturer::Error error
             return;
     }
 
+    onFrameSent();
+    channel_->send(base::serialize(*outgoing_message_));
+    captureEnd(updateInterval());
+}
+
+void DesktopSessionAgent::onCursorCaptured(const base::MouseCursor& mouse_cursor)
+{
+    // Creating and releasing shared buffers sends messages, so it is done before the message is
+    // prepared.
+    const int shared_buffer_id = cursorBuffer(mouse_cursor);
+
+    outgoing_message_.clear();
+
+    proto::internal::MouseCursor* serialized_mouse_cursor =
+        outgoing_message_->mutable_mouse_cursor();
+
+    serialized_mouse_cursor->set_width(mouse_cursor.width());
+    serialized_mouse_cursor->set_height(mouse_cursor.height());
+    serialized_mouse_cursor->set_hotspot_x(mouse_cursor.hotSpotX());
+    serialized_mouse_cursor->set_hotspot_y(mouse_cursor.hotSpotY());
+    serialized_mouse_cursor->set_dpi_x(mouse_cursor.constDpi().x());
+    serialized_mouse_cursor->set_dpi_y(mouse_cursor.constDpi().y());
+
+    if (shared_buffer_id != -1)
+        serialized_mouse_cursor->set_shared_buffer_id(shared_buffer_id);
+    else
+        serialized_mouse_cursor->set_data(base::toStdString(mouse_cursor.constImage()));
+
     channel_->send(base::serialize(*outgoing_message_));
 }
 
 void DesktopSessionAgent::onCursorPositionChanged(const base::Point& position)
 {
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
 
     proto::CursorPosition* cursor_position = outgoing_message_->mutable_cursor_position();
     cursor_position->set_x(position.x());
@@ -450,7 +587,7 @@ void DesktopSessionAgent::onAfterThreadRunning()
 
 void DesktopSessionAgent::onClipboardEvent(const proto::ClipboardEvent& event)
 {
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
     outgoing_message_->mutable_clipboard_event()->CopyFrom(event);
     channel_->send(base::serialize(*outgoing_message_));
 }
@@ -476,24 +613,56 @@ void DesktopSessionAgent::setEnabled(bool enable)
         LOG(LS_WARNING) << "Input injector not supported for platform";
 #endif
 
+        if (input_injector_)
+        {
+            // Consecutive moves are merged, and the remaining events are injected together.
+            mouse_event_coalescer_ = std::make_unique<common::MouseEventCoalescer>(
+                io_task_runner_, kMouseMoveInterval,
+                [this](const std::vector<proto::MouseEvent>& events)
+            {
+                input_injector_->injectMouseEvents(events);
+            });
+        }
+
         // A window is created to monitor the clipboard. We cannot create windows in the current
         // thread. Create a separate thread.
         clipboard_monitor_ = std::make_unique<common::ClipboardMonitor>();
         clipboard_monitor_->start(io_task_runner_, this);
 
-        // Create a shared memory factory.
-        // We will receive notifications of all creations and destruction of shared memory.
-        shared_memory_factory_ = std::make_unique<base::SharedMemoryFactory>(this);
-
         capture_scheduler_ = std::make_unique<base::CaptureScheduler>(
             std::chrono::milliseconds(40));
 
-        screen_capturer_ = std::make_unique<base::ScreenCapturerWrapper>(
-            preferred_video_capturer_, this);
-        screen_capturer_->setSharedMemoryFactory(shared_memory_factory_.get());
+        if (!screen_capturer_)
+            createScreenCapturer();
+
+        screen_capturer_->setSuspended(false);
+
+        idle_timer_->stop();
+        is_capture_paused_ = false;
+        is_capture_stopped_ = false;
+
+        frame_ring_ = base::SharedFrameRing::create();
+        if (frame_ring_)
+        {
+            LOG(LS_INFO) << "Frame ring created: " << frame_ring_->id();
+
+            // The message is sent before the first frame, so the service opens the ring before it
+            // has to release frames.
+            outgoing_message_.clear();
+            outgoing_message_->mutable_frame_ring()->set_shared_buffer_id(frame_ring_->id());
+            channel_->send(base::serialize(*outgoing_message_));
+        }
+        else
+        {
+            LOG(LS_WARNING) << "Frame ring not available. Frames are released by messages";
+        }
+
+        updateAudioCapturer();
 
-        audio_capturer_ = std::make_unique<base::AudioCapturerWrapper>(channel_->channelProxy());
-        audio_capturer_->start();
+        cursor_timer_ = std::make_unique<base::WaitableTimer>(
+            base::WaitableTimer::Type::REPEATED, io_task_runner_);
+        cursor_timer_->start(kCursorCaptureInterval,
+                             std::bind(&DesktopSessionAgent::captureCursor, this));
 
         LOG(LS_INFO) << "Session successfully enabled";
 
@@ -516,12 +685,23 @@ void DesktopSessionAgent::setEnabled(bool enable)
             clear_clipboard_ = false;
         }
 
+        cursor_timer_.reset();
+        mouse_event_coalescer_.reset();
         input_injector_.reset();
         capture_scheduler_.reset();
-        screen_capturer_.reset();
-        shared_memory_factory_.reset();
+
+        // The capturer with its shared buffers is kept for the next client.
+        if (screen_capturer_)
+            screen_capturer_->setSuspended(true);
+
+        setCapturePaused(true);
+
+        frame_ring_.reset();
+        pending_captures_.clear();
+        capture_counter_ = 0;
+        is_waiting_for_buffer_ = false;
         clipboard_monitor_.reset();
-        audio_capturer_.reset();
+        updateAudioCapturer();
 
         if (lock_at_disconnect_)
         {
@@ -539,11 +719,117 @@ void DesktopSessionAgent::setEnabled(bool enable)
     }
 }
 
+void DesktopSessionAgent::updateAudioCapturer()
+{
+    const bool capture_audio = is_session_enabled_ && capture_audio_;
+    if (capture_audio == (audio_capturer_ != nullptr))
+        return;
+
+    LOG(LS_INFO) << "Audio capture: " << capture_audio;
+
+    if (!capture_audio)
+    {
+        // The capture thread and the audio client are released until a client needs the audio.
+        audio_capturer_.reset();
+        return;
+    }
+
+    audio_capturer_ = std::make_unique<base::AudioCapturerWrapper>(channel_->channelProxy());
+    audio_capturer_->start();
+    audio_capturer_->setLowLatency(low_latency_audio_);
+}
+
+void DesktopSessionAgent::createScreenCapturer()
+{
+    // Create a shared memory factory.
+    // We will receive notifications of all creations and destruction of shared memory.
+    shared_memory_factory_ = std::make_unique<base::SharedMemoryFactory>(this);
+
+    screen_capturer_ = std::make_unique<base::ScreenCapturerWrapper>(
+        preferred_video_capturer_, this);
+    screen_capturer_->setSharedMemoryFactory(shared_memory_factory_.get());
+}
+
+void DesktopSessionAgent::setCapturePaused(bool paused)
+{
+    // The capture of a disabled session is resumed only by enabling it.
+    if (is_capture_paused_ == paused || (!paused && !is_session_enabled_))
+        return;
+
+    LOG(LS_INFO) << "Capture " << (paused ? "paused" : "resumed");
+    is_capture_paused_ = paused;
+
+    if (paused)
+    {
+        if (cursor_timer_)
+            cursor_timer_->stop();
+
+        idle_timer_->start(kCapturerIdleTimeout, [this]()
+        {
+            LOG(LS_INFO) << "Capturer is idle for " << kCapturerIdleTimeout.count() << " minutes";
+
+            if (screen_capturer_)
+                screen_capturer_->releaseCapturer();
+
+            // The frame buffers of the released capturer are kept in the pool.
+            if (shared_memory_factory_)
+                shared_memory_factory_->releaseUnused();
+        });
+        return;
+    }
+
+    idle_timer_->stop();
+
+    if (cursor_timer_)
+    {
+        cursor_timer_->start(kCursorCaptureInterval,
+                             std::bind(&DesktopSessionAgent::captureCursor, this));
+    }
+
+    // A capture started before the pause may still be in progress. It continues by itself.
+    if (is_capture_stopped_)
+    {
+        is_capture_stopped_ = false;
+        io_task_runner_->postTask(
+            std::bind(&DesktopSessionAgent::captureBegin, shared_from_this()));
+    }
+}
+
 void DesktopSessionAgent::captureBegin()
 {
     if (!capture_scheduler_ || !screen_capturer_)
         return;
 
+    if (is_capture_paused_)
+    {
+        is_capture_stopped_ = true;
+        return;
+    }
+
+    if (!isFrameBufferAvailable())
+    {
+        if (!frame_ring_)
+        {
+            // The service sends a message when it releases the frame.
+            is_waiting_for_buffer_ = true;
+            return;
+        }
+
+        frame_ring_->setWaiting(true);
+
+        // The service could release the frame before it saw the flag.
+        if (!isFrameBufferAvailable())
+        {
+            is_waiting_for_buffer_ = true;
+            return;
+        }
+
+        frame_ring_->setWaiting(false);
+    }
+
+    current_capture_ = capture_counter_++;
+    capture_start_time_ = std::chrono::steady_clock::now();
+
     capture_scheduler_->beginCapture();
     screen_capturer_->captureFrame();
 }
@@ -574,6 +860,93 @@ void DesktopSessionAgent::captureEnd(const std::chrono::milliseconds& update_int
     }
 }
 
+void DesktopSessionAgent::captureCursor()
+{
+    if (screen_capturer_)
+        screen_capturer_->captureCursor();
+}
+
+void DesktopSessionAgent::onFrameSent()
+{
+    // The counter must be incremented before sending. Otherwise the service can release the frame
+    // before it is counted.
+    if (frame_ring_)
+        frame_ring_->push();
+
+    pending_captures_.push_back(current_capture_);
+}
+
+std::chrono::milliseconds DesktopSessionAgent::updateInterval() const
+{
+    if (frame_ring_)
+    {
+        // The interval is zero until the service opens the ring.
+        std::chrono::milliseconds interval = frame_ring_->updateInterval();
+        if (interval != std::chrono::milliseconds::zero())
+            return interval;
+    }
+
+    return capture_scheduler_->updateInterval();
+}
+
+bool DesktopSessionAgent::isFrameBufferAvailable()
+{
+    // Forget the frames that the service has already released. Without the ring they are removed
+    // when the service's message arrives.
+    if (frame_ring_)
+    {
+        const uint32_t pending_count = frame_ring_->pendingCount();
+        while (pending_captures_.size() > pending_count)
+            pending_captures_.pop_front();
+    }
+
+    if (pending_captures_.empty())
+        return true;
+
+    // The next frame is written to the buffer that was used |frameBufferCount| captures ago. It
+    // must not belong to a frame that the service has not released yet.
+    const uint32_t buffer_count = static_cast<uint32_t>(screen_capturer_->frameBufferCount());
+    return capture_counter_ - pending_captures_.front() < buffer_count;
+}
+
+int DesktopSessionAgent::cursorBuffer(const base::MouseCursor& mouse_cursor)
+{
+    const base::ByteArray& image = mouse_cursor.constImage();
+
+    // The service reads the image with the size of the cursor.
+    const size_t size = static_cast<size_t>(mouse_cursor.width()) *
+        static_cast<size_t>(mouse_cursor.height()) * base::MouseCursor::kBytesPerPixel;
+    if (!shared_memory_factory_ || image.empty() || image.size() != size)
+        return -1;
+
+    const uint32_t hash = cursorHash(image);
+
+    for (auto it = cursor_cache_.begin(); it != cursor_cache_.end(); ++it)
+    {
+        if (it->hash == hash && it->size == size &&
+            memcmp(it->memory->data(), image.data(), size) == 0)
+        {
+            cursor_cache_.splice(cursor_cache_.begin(), cursor_cache_, it);
+            return cursor_cache_.front().memory->id();
+        }
+    }
+
+    std::unique_ptr<base::SharedMemory> memory = shared_memory_factory_->create(size);
+    if (!memory)
+    {
+        LOG(LS_WARNING) << "Unable to create shared memory for the cursor";
+        return -1;
+    }
+
+    memcpy(memory->data(), image.data(), size);
+
+    cursor_cache_.push_front({ hash, std::move(memory), size });
+    if (cursor_cache_.size() > kCursorCacheSize)
+        cursor_cache_.pop_back();
+
+    return cursor_cache_.front().memory->id();
+}
+
 #if defined(OS_WIN)
 bool DesktopSessionAgent::onWindowsMessage(
     UINT message, WPARAM /* wparam */, LPARAM /* lparam */, LRESULT& result)
@@ -23,17 +23,25 @@
 #include "base/desktop/screen_capturer_wrapper.h"
 #include "base/ipc/ipc_channel.h"
 #include "base/ipc/shared_memory_factory.h"
+#include "base/memory/arena_message.h"
 #include "base/threading/thread.h"
 #include "common/clipboard_monitor.h"
+#include "common/mouse_event_coalescer.h"
 #include "proto/desktop_internal.pb.h"
 
+#include <deque>
+#include <list>
+
 namespace base {
 
 class AudioCapturerWrapper;
 class CaptureScheduler;
+class SharedFrameRing;
+class SharedMemory;
 class TaskRunner;
 class Thread;
 class SharedFrame;
+class WaitableTimer;
 
 #if defined(OS_WIN)
 namespace win {
@@ -73,9 +81,9 @@ protected:
     // base::ScreenCapturerWrapper::Delegate implementation.
     void onScreenListChanged(const base::ScreenCapturer::ScreenList& list,
                              base::ScreenCapturer::ScreenId current) override;
-    void onScreenCaptured(const base::Frame* frame,
-                          const base::MouseCursor* mouse_cursor) override;
+    void onScreenCaptured(const base::Frame* frame) override;
     void onScreenCaptureError(base::ScreenCapturer::Error error) override;
+    void onCursorCaptured(const base::MouseCursor& mouse_cursor) override;
     void onCursorPositionChanged(const base::Point& position) override;
 
     // base::Thread::Delegate implementation.
@@ -87,8 +95,16 @@ protected:
 
 private:
     void setEnabled(bool enable);
+    void createScreenCapturer();
+    void setCapturePaused(bool paused);
     void captureBegin();
     void captureEnd(const std::chrono::milliseconds& update_interval);
+    void captureCursor();
+    void onFrameSent();
+    std::chrono::milliseconds updateInterval() const;
+    bool isFrameBufferAvailable();
+    int cursorBuffer(const base::MouseCursor& mouse_cursor);
+    void updateAudioCapturer();
 
 #if defined(OS_WIN)
     bool onWindowsMessage(UINT message, WPARAM wparam, LPARAM lparam, LRESULT& result);
@@ -106,18 +122,52 @@ private:
     std::unique_ptr<base::IpcChannel> channel_;
     std::unique_ptr<common::ClipboardMonitor> clipboard_monitor_;
     std::unique_ptr<InputInjector> input_injector_;
+    std::unique_ptr<common::MouseEventCoalescer> mouse_event_coalescer_;
 
     std::unique_ptr<base::SharedMemoryFactory> shared_memory_factory_;
     std::unique_ptr<base::CaptureScheduler> capture_scheduler_;
     std::unique_ptr<base::ScreenCapturerWrapper> screen_capturer_;
     std::unique_ptr<base::AudioCapturerWrapper> audio_capturer_;
 
+    // The cursor is captured on its own timer, so it stays responsive at a low frame rate.
+    std::unique_ptr<base::WaitableTimer> cursor_timer_;
+
+    // The capture is paused if all clients have paused the video. If the capture is not needed for
+    // a while, the capturer resources are released until the next capture.
+    bool is_capture_paused_ = false;
+    bool is_capture_stopped_ = false;
+    std::unique_ptr<base::WaitableTimer> idle_timer_;
+
+    // The next frame is captured without waiting until the service encodes the previous one.
+    // Frame buffers of the capturer are reused only after the service released them. The service
+    // releases frames through the ring if it is present, or with a message otherwise.
+    std::unique_ptr<base::SharedFrameRing> frame_ring_;
+    std::deque<uint32_t> pending_captures_;
+    uint32_t capture_counter_ = 0;
+    uint32_t current_capture_ = 0;
+    bool is_waiting_for_buffer_ = false;
+    std::chrono::steady_clock::time_point capture_start_time_;
+
+    // Recently sent cursor shapes. Each shape has its own shared buffer, so a cursor that was seen
+    // before is sent as the ID of its buffer. Most recently used first.
+    struct CachedCursor
+    {
+        uint32_t hash;
+        std::unique_ptr<base::SharedMemory> memory;
+        size_t size;
+    };
+    std::list<CachedCursor> cursor_cache_;
+
     base::ScreenCapturer::Type preferred_video_capturer_ = base::ScreenCapturer::Type::DEFAULT;
     bool lock_at_disconnect_ = false;
     bool clear_clipboard_ = false;
+    bool low_latency_audio_ = false;
+
+    // The audio is captured only while the session is enabled and at least one client plays it.
+    bool capture_audio_ = false;
 
-    std::unique_ptr<proto::internal::ServiceToDesktop> incoming_message_;
-    std::unique_ptr<proto::internal::DesktopToService> outgoing_message_;
+    base::ArenaMessage<proto::internal::ServiceToDesktop> incoming_message_;
+    base::ArenaMessage<proto::internal::DesktopToService> outgoing_message_;
 
     DISALLOW_COPY_AND_ASSIGN(DesktopSessionAgent);
 };
@@ -19,9 +19,11 @@
 #include "host/desktop_session_ipc.h"
 
 #include "base/logging.h"
+#include "base/codec/rect_list_codec.h"
 #include "base/desktop/mouse_cursor.h"
 #include "base/desktop/shared_memory_frame.h"
 #include "base/memory/local_memory.h"
+#include "base/ipc/shared_frame_ring.h"
 #include "base/ipc/shared_memory.h"
 
 namespace host {
@@ -72,9 +74,7 @@ private:
 DesktopSessionIpc::DesktopSessionIpc(std::unique_ptr<base::IpcChannel> channel,
                                      Delegate* delegate)
     : channel_(std::move(channel)),
-      delegate_(delegate),
-      outgoing_message_(std::make_unique<proto::internal::ServiceToDesktop>()),
-      incoming_message_(std::make_unique<proto::internal::DesktopToService>())
+      delegate_(delegate)
 {
     LOG(LS_INFO) << "Ctor";
 
@@ -97,6 +97,8 @@ void DesktopSessionIpc::start()
         return;
     }
 
+    // The service can create global shared memory, and the agent opens it in the same way.
+    channel_->setSharedMemoryEnabled(true);
     channel_->setListener(this);
     channel_->resume();
 
@@ -113,7 +115,7 @@ void DesktopSessionIpc::control(proto::internal::DesktopControl::Action action)
 {
     LOG(LS_INFO) << "Send CONTROL with action: " << controlActionToString(action);
 
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
     outgoing_message_->mutable_control()->set_action(action);
     channel_->send(base::serialize(*outgoing_message_));
 }
@@ -122,7 +124,7 @@ void DesktopSessionIpc::configure(const Config& config)
 {
     LOG(LS_INFO) << "Send CONFIGURE";
 
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
 
     proto::internal::Configure* configure = outgoing_message_->mutable_configure();
     configure->set_disable_font_smoothing(config.disable_font_smoothing);
@@ -132,6 +134,11 @@ void DesktopSessionIpc::configure(const Config& config)
     configure->set_lock_at_disconnect(config.lock_at_disconnect);
     configure->set_clear_clipboard(config.clear_clipboard);
     configure->set_cursor_position(config.cursor_position);
+    configure->set_prefer_i420(config.prefer_i420);
+    configure->set_low_latency_audio(config.low_latency_audio);
+    configure->set_capture_audio(config.capture_audio);
+    configure->set_capture_width(config.capture_width);
+    configure->set_capture_height(config.capture_height);
 
     channel_->send(base::serialize(*outgoing_message_));
 }
@@ -140,7 +147,7 @@ void DesktopSessionIpc::selectScreen(const proto::Screen& screen)
 {
     LOG(LS_INFO) << "Send SELECT_SCREEN";
 
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
     outgoing_message_->mutable_select_source()->mutable_screen()->CopyFrom(screen);
     channel_->send(base::serialize(*outgoing_message_));
 }
@@ -172,7 +179,7 @@ void DesktopSessionIpc::captureScreen()
     }
     else
     {
-        outgoing_message_->Clear();
+        outgoing_message_.clear();
         outgoing_message_->mutable_next_screen_capture()->set_update_interval(0);
         channel_->send(base::serialize(*outgoing_message_));
     }
@@ -187,32 +194,35 @@ void DesktopSessionIpc::setScreenCaptureFps(int fps)
     }
 
     update_interval_ = std::chrono::milliseconds(1000 / fps);
+
+    if (frame_ring_)
+        frame_ring_->setUpdateInterval(update_interval_);
 }
 
 void DesktopSessionIpc::injectKeyEvent(const proto::KeyEvent& event)
 {
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
     outgoing_message_->mutable_key_event()->CopyFrom(event);
     channel_->send(base::serialize(*outgoing_message_));
 }
 
 void DesktopSessionIpc::injectTextEvent(const proto::TextEvent& event)
 {
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
     outgoing_message_->mutable_text_event()->CopyFrom(event);
     channel_->send(base::serialize(*outgoing_message_));
 }
 
 void DesktopSessionIpc::injectMouseEvent(const proto::MouseEvent& event)
 {
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
     outgoing_message_->mutable_mouse_event()->CopyFrom(event);
     channel_->send(base::serialize(*outgoing_message_));
 }
 
 void DesktopSessionIpc::injectClipboardEvent(const proto::ClipboardEvent& event)
 {
-    outgoing_message_->Clear();
+    outgoing_message_.clear();
     outgoing_message_->mutable_clipboard_event()->CopyFrom(event);
     channel_->send(base::serialize(*outgoing_message_));
 }
@@ -239,7 +249,7 @@ void DesktopSessionIpc::onMessageReceived(const base::ByteArray& buffer)
         return;
     }
 
-    incoming_message_->Clear();
+    incoming_message_.clear();
 
     if (!base::parse(buffer, incoming_message_.get()))
     {
@@ -255,6 +265,10 @@ void DesktopSessionIpc::onMessageReceived(const base::ByteArray& buffer)
     {
         onAudioCaptured(incoming_message_->audio_packet());
     }
+    else if (incoming_message_->has_mouse_cursor())
+    {
+        onMouseCursor(incoming_message_->mouse_cursor());
+    }
     else if (incoming_message_->has_cursor_position())
     {
         onCursorPositionChanged(incoming_message_->cursor_position());
@@ -285,6 +299,10 @@ void DesktopSessionIpc::onMessageReceived(const base::ByteArray& buffer)
     {
         delegate_->onClipboardEvent(incoming_message_->clipboard_event());
     }
+    else if (incoming_message_->has_frame_ring())
+    {
+        onFrameRing(incoming_message_->frame_ring().shared_buffer_id());
+    }
     else
     {
         LOG(LS_ERROR) << "Unhandled message from desktop";
@@ -295,7 +313,6 @@ void DesktopSessionIpc::onMessageReceived(const base::ByteArray& buffer)
 void DesktopSessionIpc::onScreenCaptured(const proto::internal::ScreenCaptured& screen_captured)
 {
     const base::Frame* frame = nullptr;
-    const base::MouseCursor* mouse_cursor = nullptr;
 
     if (screen_captured.has_frame())
     {
@@ -311,43 +328,36 @@ void DesktopSessionIpc::onScreenCaptured(const proto::internal::ScreenCaptured&
                 std::move(shared_buffer));
 
             last_frame_->setCapturerType(serialized_frame.capturer_type());
+            last_frame_->setLayout(static_cast<base::Frame::Layout>(serialized_frame.layout()));
+            last_frame_->setCaptureStartTime(base::Frame::TimePoint(
+                std::chrono::microseconds(serialized_frame.capture_start_time())));
+            last_frame_->setCaptureTime(
+                std::chrono::microseconds(serialized_frame.capture_time()));
+            last_frame_->setScreenSize(
+                base::Size(serialized_frame.screen_width(), serialized_frame.screen_height()));
 
             base::Region* updated_region = last_frame_->updatedRegion();
 
-            for (int i = 0; i < serialized_frame.dirty_rect_size(); ++i)
+            if (base::RectListCodec::decode(serialized_frame.packed_dirty_rect(), &dirty_rects_))
+            {
+                for (const auto& rect : dirty_rects_)
+                    updated_region->addRect(rect);
+            }
+            else
             {
-                const proto::Rect& dirty_rect = serialized_frame.dirty_rect(i);
-                updated_region->addRect(base::Rect::makeXYWH(
-                    dirty_rect.x(), dirty_rect.y(), dirty_rect.width(), dirty_rect.height()));
+                LOG(LS_ERROR) << "Invalid dirty rectangles";
+                updated_region->addRect(base::Rect::makeSize(last_frame_->size()));
             }
 
             frame = last_frame_.get();
         }
     }
 
-    if (screen_captured.has_mouse_cursor())
-    {
-        const proto::internal::MouseCursor& serialized_mouse_cursor =
-            screen_captured.mouse_cursor();
-
-        base::Size size =
-            base::Size(serialized_mouse_cursor.width(), serialized_mouse_cursor.height());
-        base::Point hotspot =
-            base::Point(serialized_mouse_cursor.hotspot_x(), serialized_mouse_cursor.hotspot_y());
-        base::Point dpi =
-            base::Point(serialized_mouse_cursor.dpi_x(), serialized_mouse_cursor.dpi_y());
-
-        last_mouse_cursor_ = std::make_unique<base::MouseCursor>(
-            base::fromStdString(serialized_mouse_cursor.data()), size, hotspot, dpi);
-
-        mouse_cursor = last_mouse_cursor_.get();
-    }
-
     if (delegate_)
     {
         if (screen_captured.error_code() == proto::VIDEO_ERROR_CODE_OK)
         {
-            delegate_->onScreenCaptured(frame, mouse_cursor);
+            delegate_->onScreenCaptured(frame, nullptr);
         }
         else
         {
@@ -359,11 +369,81 @@ void DesktopSessionIpc::onScreenCaptured(const proto::internal::ScreenCaptured&
         LOG(LS_WARNING) << "Invalid delegate";
     }
 
-    outgoing_message_->Clear();
+    if (frame_ring_)
+    {
+        // The frame is encoded and its buffer can be reused. The agent is already capturing the
+        // next frame and needs a message only if it waits for a free buffer. Without the ring the
+        // message below releases the buffer.
+        if (!frame_ring_->pop())
+            return;
+    }
+
+    outgoing_message_.clear();
     outgoing_message_->mutable_next_screen_capture()->set_update_interval(update_interval_.count());
     channel_->send(base::serialize(*outgoing_message_));
 }
 
+void DesktopSessionIpc::onMouseCursor(const proto::internal::MouseCursor& serialized_mouse_cursor)
+{
+    base::Size size =
+        base::Size(serialized_mouse_cursor.width(), serialized_mouse_cursor.height());
+    base::Point hotspot =
+        base::Point(serialized_mouse_cursor.hotspot_x(), serialized_mouse_cursor.hotspot_y());
+    base::Point dpi =
+        base::Point(serialized_mouse_cursor.dpi_x(), serialized_mouse_cursor.dpi_y());
+
+    if (serialized_mouse_cursor.data().empty())
+    {
+        const int shared_buffer_id = serialized_mouse_cursor.shared_buffer_id();
+
+        auto cached = cursor_cache_.find(shared_buffer_id);
+        if (cached != cursor_cache_.end())
+        {
+            // The image was read before. Only the other parameters can differ.
+            const base::MouseCursor& cursor = *cached->second;
+            if (cursor.size() != size || cursor.hotSpot() != hotspot || cursor.constDpi() != dpi)
+            {
+                base::ByteArray image = cursor.constImage();
+                cached->second = std::make_shared<base::MouseCursor>(
+                    std::move(image), size, hotspot, dpi);
+            }
+        }
+        else
+        {
+            auto shared_buffer = shared_buffers_.find(shared_buffer_id);
+            if (shared_buffer == shared_buffers_.end() || size.width() <= 0 || size.height() <= 0)
+            {
+                LOG(LS_ERROR) << "Invalid cursor buffer " << shared_buffer_id;
+                return;
+            }
+
+            const uint8_t* data = reinterpret_cast<const uint8_t*>(shared_buffer->second->data());
+            const size_t data_size = static_cast<size_t>(size.width()) *
+                static_cast<size_t>(size.height()) * base::MouseCursor::kBytesPerPixel;
+
+            cached = cursor_cache_.emplace(shared_buffer_id, std::make_shared<base::MouseCursor>(
+                base::ByteArray(data, data + data_size), size, hotspot, dpi)).first;
+        }
+
+        last_mouse_cursor_ = cached->second;
+    }
+    else
+    {
+        last_mouse_cursor_ = std::make_shared<base::MouseCursor>(
+            base::fromStdString(serialized_mouse_cursor.data()), size, hotspot, dpi);
+    }
+
+    // The cursor is not tied to a frame, so it is sent to the clients without a video packet.
+    if (delegate_)
+    {
+        delegate_->onScreenCaptured(nullptr, last_mouse_cursor_.get());
+    }
+    else
+    {
+        LOG(LS_WARNING) << "Invalid delegate";
+    }
+}
+
 void DesktopSessionIpc::onCursorPositionChanged(const proto::CursorPosition& cursor_position)
 {
     if (delegate_)
@@ -409,14 +489,30 @@ void DesktopSessionIpc::onReleaseSharedBuffer(int shared_buffer_id)
     LOG(LS_INFO) << "Shared memory destroyed: " << shared_buffer_id;
 
     shared_buffers_.erase(shared_buffer_id);
+    cursor_cache_.erase(shared_buffer_id);
 
-    if (shared_buffers_.empty())
+    // The remaining buffers can hold only cursors.
+    if (shared_buffers_.size() <= cursor_cache_.size())
     {
         LOG(LS_INFO) << "Reset last frame";
         last_frame_.reset();
     }
 }
 
+void DesktopSessionIpc::onFrameRing(int shared_buffer_id)
+{
+    LOG(LS_INFO) << "Frame ring received: " << shared_buffer_id;
+
+    frame_ring_ = base::SharedFrameRing::open(shared_buffer_id);
+    if (!frame_ring_)
+    {
+        LOG(LS_ERROR) << "Failed to open the frame ring " << shared_buffer_id;
+        return;
+    }
+
+    frame_ring_->setUpdateInterval(update_interval_);
+}
+
 std::unique_ptr<DesktopSessionIpc::SharedBuffer> DesktopSessionIpc::sharedBuffer(
     int shared_buffer_id)
 {
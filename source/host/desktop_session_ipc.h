@@ -19,9 +19,17 @@
 #ifndef HOST_DESKTOP_SESSION_IPC_H
 #define HOST_DESKTOP_SESSION_IPC_H
 
+#include "base/desktop/geometry.h"
 #include "base/ipc/ipc_channel.h"
+#include "base/memory/arena_message.h"
 #include "host/desktop_session.h"
 
+#include <vector>
+
+namespace base {
+class SharedFrameRing;
+} // namespace base
+
 namespace host {
 
 class DesktopSessionIpc
@@ -55,23 +63,31 @@ private:
     using SharedBuffers = std::map<int, std::unique_ptr<SharedBuffer>>;
 
     void onScreenCaptured(const proto::internal::ScreenCaptured& screen_captured);
+    void onMouseCursor(const proto::internal::MouseCursor& serialized_mouse_cursor);
     void onCursorPositionChanged(const proto::CursorPosition& cursor_position);
     void onAudioCaptured(const proto::AudioPacket& audio_packet);
     void onCreateSharedBuffer(int shared_buffer_id);
     void onReleaseSharedBuffer(int shared_buffer_id);
+    void onFrameRing(int shared_buffer_id);
     std::unique_ptr<SharedBuffer> sharedBuffer(int shared_buffer_id);
 
     std::unique_ptr<base::IpcChannel> channel_;
     SharedBuffers shared_buffers_;
+    std::unique_ptr<base::SharedFrameRing> frame_ring_;
     std::unique_ptr<base::Frame> last_frame_;
-    std::unique_ptr<base::MouseCursor> last_mouse_cursor_;
+    std::vector<base::Rect> dirty_rects_;
+    std::shared_ptr<base::MouseCursor> last_mouse_cursor_;
+
+    // Cursors read from the shared buffers of the agent. The agent does not change a buffer until
+    // it is released, so the same cursor is not read again.
+    std::map<int, std::shared_ptr<base::MouseCursor>> cursor_cache_;
     std::unique_ptr<proto::ScreenList> last_screen_list_;
     Delegate* delegate_;
 
     std::chrono::milliseconds update_interval_ { 40 }; // 25 fps by default.
 
-    std::unique_ptr<proto::internal::ServiceToDesktop> outgoing_message_;
-    std::unique_ptr<proto::internal::DesktopToService> incoming_message_;
+    base::ArenaMessage<proto::internal::ServiceToDesktop> outgoing_message_;
+    base::ArenaMessage<proto::internal::DesktopToService> incoming_message_;
 
     DISALLOW_COPY_AND_ASSIGN(DesktopSessionIpc);
 };
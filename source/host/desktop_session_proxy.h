@@ -58,6 +58,7 @@ public:
 
 private:
     friend class DesktopSessionManager;
+    friend class LoopbackHost;
 
     void attachAndStart(DesktopSession* desktop_session);
     void stopAndDettach();
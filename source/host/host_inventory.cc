@@ -0,0 +1,120 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "host/host_inventory.h"
+
+#include "build/build_config.h"
+#include "base/sys_info.h"
+
+#if defined(OS_WIN)
+#include "host/system_info.h"
+#endif // defined(OS_WIN)
+
+namespace host {
+
+namespace {
+
+const uint64_t kBytesPerGigabyte = 1024ULL * 1024ULL * 1024ULL;
+
+void addItem(proto::HostInventory* message, const std::string& key, const std::string& value)
+{
+    proto::InventoryItem* item = message->add_item();
+    item->set_key(key);
+    item->set_value(value);
+}
+
+} // namespace
+
+Inventory collectInventory()
+{
+    Inventory inventory;
+
+    inventory["computer.name"] = base::SysInfo::computerName();
+    inventory["computer.domain"] = base::SysInfo::computerDomain();
+    inventory["computer.workgroup"] = base::SysInfo::computerWorkgroup();
+    inventory["os.name"] = base::SysInfo::operatingSystemName();
+    inventory["os.version"] = base::SysInfo::operatingSystemVersion();
+    inventory["os.arch"] = base::SysInfo::operatingSystemArchitecture();
+    inventory["cpu.vendor"] = base::SysInfo::processorVendor();
+    inventory["cpu.model"] = base::SysInfo::processorName();
+    inventory["cpu.cores"] = std::to_string(base::SysInfo::processorCores());
+    inventory["cpu.threads"] = std::to_string(base::SysInfo::processorThreads());
+
+#if defined(OS_WIN)
+    // The hardware part of the summary is collected once per process.
+    proto::system_info::SystemInfo system_info;
+    createSystemInfo(proto::system_info::SystemInfoRequest(), &system_info);
+
+    inventory["bios.vendor"] = system_info.bios().vendor();
+    inventory["bios.version"] = system_info.bios().version();
+    inventory["board.manufacturer"] = system_info.motherboard().manufacturer();
+    inventory["board.model"] = system_info.motherboard().model();
+
+    uint64_t memory_size = 0;
+    for (int i = 0; i < system_info.memory().module_size(); ++i)
+        memory_size += system_info.memory().module(i).size();
+
+    inventory["memory.total"] = std::to_string(memory_size);
+
+    // The free space is rounded to gigabytes, otherwise it would change on every update.
+    for (int i = 0; i < system_info.logical_drives().drive_size(); ++i)
+    {
+        const proto::system_info::LogicalDrives::Drive& drive =
+            system_info.logical_drives().drive(i);
+
+        inventory["drive." + drive.path() + ".total"] = std::to_string(drive.total_size());
+        inventory["drive." + drive.path() + ".free_gb"] =
+            std::to_string(drive.free_size() / kBytesPerGigabyte);
+    }
+#endif // defined(OS_WIN)
+
+    // Empty values are not sent.
+    for (auto it = inventory.begin(); it != inventory.end();)
+    {
+        if (it->second.empty())
+            it = inventory.erase(it);
+        else
+            ++it;
+    }
+
+    return inventory;
+}
+
+bool makeInventoryDelta(const Inventory& previous,
+                        const Inventory& current,
+                        proto::HostInventory* message)
+{
+    message->set_is_delta(!previous.empty());
+
+    for (const auto& item : current)
+    {
+        auto previous_item = previous.find(item.first);
+        if (previous_item == previous.end() || previous_item->second != item.second)
+            addItem(message, item.first, item.second);
+    }
+
+    for (const auto& item : previous)
+    {
+        if (current.find(item.first) == current.end())
+            message->add_removed_key(item.first);
+    }
+
+    return message->item_size() || message->removed_key_size();
+}
+
+} // namespace host
@@ -0,0 +1,44 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef HOST_HOST_INVENTORY_H
+#define HOST_HOST_INVENTORY_H
+
+#include "proto/router_peer.pb.h"
+
+#include <map>
+#include <string>
+
+namespace host {
+
+// Compact inventory of the computer which is sent to the router, so that the administrators can
+// query it for all hosts without connecting to each of them. The keys are grouped by a prefix,
+// for example "os.version" or "drive.C:\.total".
+using Inventory = std::map<std::string, std::string>;
+
+Inventory collectInventory();
+
+// Fills |message| with the values of |current| which differ from |previous| and the keys which
+// are removed. Returns false if there are no differences.
+bool makeInventoryDelta(const Inventory& previous,
+                        const Inventory& current,
+                        proto::HostInventory* message);
+
+} // namespace host
+
+#endif // HOST_HOST_INVENTORY_H
@@ -23,6 +23,8 @@
 #include "base/desktop/geometry.h"
 #include "proto/desktop.pb.h"
 
+#include <vector>
+
 namespace host {
 
 class InputInjector
@@ -35,6 +37,13 @@ public:
     virtual void injectKeyEvent(const proto::KeyEvent& event) = 0;
     virtual void injectTextEvent(const proto::TextEvent& event) = 0;
     virtual void injectMouseEvent(const proto::MouseEvent& event) = 0;
+
+    // Injects the events in the given order, at once if the platform allows it.
+    virtual void injectMouseEvents(const std::vector<proto::MouseEvent>& events)
+    {
+        for (const auto& event : events)
+            injectMouseEvent(event);
+    }
 };
 
 } // namespace host
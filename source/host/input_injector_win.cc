@@ -216,12 +216,49 @@ void InputInjectorWin::injectMouseEvent(const proto::MouseEvent& event)
 {
     beforeInput();
 
+    INPUT input;
+    if (!mouseInput(event, &input))
+        return;
+
+    // Do the mouse event.
+    if (!SendInput(1, &input, sizeof(input)))
+    {
+        PLOG(LS_WARNING) << "SendInput failed";
+    }
+}
+
+void InputInjectorWin::injectMouseEvents(const std::vector<proto::MouseEvent>& events)
+{
+    beforeInput();
+
+    std::vector<INPUT> inputs;
+    inputs.reserve(events.size());
+
+    for (const auto& event : events)
+    {
+        INPUT input;
+        if (mouseInput(event, &input))
+            inputs.emplace_back(input);
+    }
+
+    if (inputs.empty())
+        return;
+
+    // A single call keeps other input from coming between the events.
+    if (!SendInput(static_cast<UINT>(inputs.size()), inputs.data(), sizeof(INPUT)))
+    {
+        PLOG(LS_WARNING) << "SendInput failed";
+    }
+}
+
+bool InputInjectorWin::mouseInput(const proto::MouseEvent& event, INPUT* input)
+{
     base::Size full_size(GetSystemMetrics(SM_CXVIRTUALSCREEN),
                          GetSystemMetrics(SM_CYVIRTUALSCREEN));
     if (full_size.width() <= 1 || full_size.height() <= 1)
     {
         LOG(LS_WARNING) << "Invalid screen size: " << full_size;
-        return;
+        return false;
     }
 
     // Translate the coordinates of the cursor into the coordinates of the virtual screen.
@@ -296,22 +333,16 @@ void InputInjectorWin::injectMouseEvent(const proto::MouseEvent& event)
         mouse_data = static_cast<DWORD>(-WHEEL_DELTA);
     }
 
-    INPUT input;
-    memset(&input, 0, sizeof(input));
+    memset(input, 0, sizeof(INPUT));
 
-    input.type = INPUT_MOUSE;
-    input.mi.dx = pos.x();
-    input.mi.dy = pos.y();
-    input.mi.mouseData = mouse_data;
-    input.mi.dwFlags = flags;
-
-    // Do the mouse event.
-    if (!SendInput(1, &input, sizeof(input)))
-    {
-        PLOG(LS_WARNING) << "SendInput failed";
-    }
+    input->type = INPUT_MOUSE;
+    input->mi.dx = pos.x();
+    input->mi.dy = pos.y();
+    input->mi.mouseData = mouse_data;
+    input->mi.dwFlags = flags;
 
     last_mouse_mask_ = mask;
+    return true;
 }
 
 void InputInjectorWin::beforeInput()
@@ -36,8 +36,10 @@ public:
     void injectKeyEvent(const proto::KeyEvent& event) override;
     void injectTextEvent(const proto::TextEvent& event) override;
     void injectMouseEvent(const proto::MouseEvent& event) override;
+    void injectMouseEvents(const std::vector<proto::MouseEvent>& events) override;
 
 private:
+    bool mouseInput(const proto::MouseEvent& event, INPUT* input);
     void beforeInput();
     bool isCtrlAndAltPressed();
 
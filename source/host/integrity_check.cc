@@ -58,29 +58,31 @@ bool integrityCheck()
         if (file_path == current_file)
             current_file_found = true;
 
+        // The entry reads the attributes of the file once and caches them, so the status and the
+        // size below do not query the file system again.
         std::error_code error_code;
-        std::filesystem::file_status status = std::filesystem::status(file_path, error_code);
-        if (error_code)
+        std::filesystem::directory_entry entry(file_path, error_code);
+        if (error_code && error_code != std::errc::no_such_file_or_directory)
         {
             LOG(LS_ERROR) << "Failed to get file status '" << file_path << "': "
                           << base::utf16FromLocal8Bit(error_code.message());
             return false;
         }
 
-        if (!std::filesystem::exists(status))
+        if (!entry.exists(error_code))
         {
             LOG(LS_ERROR) << "File '" << file_path << "' does not exist";
             return false;
         }
 
-        if (!std::filesystem::is_regular_file(status))
+        if (!entry.is_regular_file(error_code))
         {
             LOG(LS_ERROR) << "File '" << file_path << "' is not a file";
             return false;
         }
 
-        uintmax_t file_size = std::filesystem::file_size(file_path, error_code);
-        if (file_size < kMinFileSize)
+        uintmax_t file_size = entry.file_size(error_code);
+        if (error_code || file_size < kMinFileSize)
         {
             LOG(LS_ERROR) << "File '" << file_path << "' is not the correct size: " << file_size;
             return false;
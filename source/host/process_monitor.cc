@@ -24,6 +24,7 @@
 #include "base/strings/string_util.h"
 #include "base/strings/unicode.h"
 
+#include <algorithm>
 #include <memory>
 
 #pragma warning(push)
@@ -192,7 +193,7 @@ private:
     DISALLOW_COPY_AND_ASSIGN(ScopedPrivilege);
 };
 
-std::string userNameByHandle(HANDLE process)
+std::string userNameByHandle(HANDLE process, std::map<std::string, std::string>* user_names)
 {
     base::win::ScopedHandle token;
     if (!OpenProcessToken(process, TOKEN_QUERY, token.recieve()))
@@ -231,6 +232,15 @@ std::string userNameByHandle(HANDLE process)
         return std::string();
     }
 
+    // The account lookup is slow (it may go to a domain controller) and most processes are
+    // started by a few users, so the names are cached by SID.
+    std::string sid(reinterpret_cast<const char*>(token_user->User.Sid),
+                    GetLengthSid(token_user->User.Sid));
+
+    auto cached = user_names->find(sid);
+    if (cached != user_names->end())
+        return cached->second;
+
     wchar_t domain_buffer[128] = {0};
     wchar_t user_buffer[128] = {0};
     DWORD user_buffer_size = std::size(user_buffer);
@@ -246,7 +256,9 @@ std::string userNameByHandle(HANDLE process)
         return std::string();
     }
 
-    return base::utf8FromWide(user_buffer);
+    std::string user_name = base::utf8FromWide(user_buffer);
+    user_names->emplace(std::move(sid), user_name);
+    return user_name;
 }
 
 std::string filePathByHandle(HANDLE process)
@@ -273,7 +285,8 @@ int32_t calcCpuRatio(int64_t cpu_time_delta, int64_t total_time)
 }
 
 void updateProcess(ProcessMonitor::ProcessEntry* entry, const OWN_SYSTEM_PROCESS_INFORMATION& info,
-                   int64_t total_time, bool update_only)
+                   int64_t total_time, bool update_only,
+                   std::map<std::string, std::string>* user_names)
 {
     int64_t time = info.KernelTime + info.UserTime;
     int64_t time_delta = time - entry->cpu_time;
@@ -311,7 +324,7 @@ void updateProcess(ProcessMonitor::ProcessEntry* entry, const OWN_SYSTEM_PROCESS
             }
             else
             {
-                entry->user_name = userNameByHandle(process);
+                entry->user_name = userNameByHandle(process, user_names);
                 entry->user_name_changed = true;
 
                 entry->file_path = filePathByHandle(process);
@@ -528,27 +541,33 @@ bool ProcessMonitor::endProcess(ProcessId process_id)
 
 bool ProcessMonitor::updateSnapshot()
 {
+    NtQuerySystemInformationFunc nt_query_system_information_func =
+        reinterpret_cast<NtQuerySystemInformationFunc>(nt_query_system_info_func_);
+
+    // The buffer is kept between the updates, so usually one call is enough.
     while (true)
     {
-        if (!snapshot_.empty())
-        {
-            NtQuerySystemInformationFunc nt_query_system_information_func =
-                reinterpret_cast<NtQuerySystemInformationFunc>(nt_query_system_info_func_);
+        ULONG required_size = 0;
 
-            NTSTATUS status = nt_query_system_information_func(
-                SystemProcessInformation, snapshot_.data(), snapshot_.size(), nullptr);
-            if (NT_SUCCESS(status))
-                return true;
+        NTSTATUS status = nt_query_system_information_func(
+            SystemProcessInformation,
+            snapshot_.data(),
+            static_cast<ULONG>(snapshot_.size()),
+            &required_size);
+        if (NT_SUCCESS(status))
+            return true;
 
-            if (status != STATUS_INFO_LENGTH_MISMATCH)
-            {
-                LOG(LS_WARNING) << "NtQuerySystemInformation failed: " << status;
-                return false;
-            }
+        if (status != STATUS_INFO_LENGTH_MISMATCH)
+        {
+            LOG(LS_WARNING) << "NtQuerySystemInformation failed: " << status;
+            return false;
         }
 
-        static const size_t kGrowSize = 4096;
-        snapshot_.resize(snapshot_.size() + kGrowSize);
+        // Processes can be started before the next call, so the buffer is allocated with a margin
+        // instead of growing it in small steps with a system call for each step.
+        static const size_t kGrowSize = 16 * 1024;
+        snapshot_.resize(std::max(snapshot_.size(), static_cast<size_t>(required_size)) +
+                         kGrowSize);
     }
 }
 
@@ -592,7 +611,9 @@ void ProcessMonitor::updateTable()
     while (current->NextEntryOffset);
 
     int64_t time_delta = total_time - last_total_time;
-    std::set<ProcessId> active_pids;
+
+    // The processes which are not in the snapshot have the previous update number.
+    ++update_number_;
 
     // Update process list.
     offset = 0;
@@ -607,16 +628,16 @@ void ProcessMonitor::updateTable()
             auto old_info = table_.find(process_id);
             if (old_info != table_.end())
             {
-                updateProcess(&old_info->second, *current, time_delta, true);
+                updateProcess(&old_info->second, *current, time_delta, true, &user_names_);
+                old_info->second.update_number = update_number_;
             }
             else
             {
                 ProcessEntry entry;
-                updateProcess(&entry, *current, time_delta, false);
+                updateProcess(&entry, *current, time_delta, false, &user_names_);
+                entry.update_number = update_number_;
                 table_.emplace(process_id, std::move(entry));
             }
-
-            active_pids.emplace(process_id);
         }
 
         offset += current->NextEntryOffset;
@@ -626,7 +647,7 @@ void ProcessMonitor::updateTable()
     // Remove obsolete processes.
     for (auto it = table_.begin(); it != table_.end();)
     {
-        if (!base::contains(active_pids, it->first))
+        if (it->second.update_number != update_number_)
             it = table_.erase(it);
         else
             ++it;
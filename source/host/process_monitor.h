@@ -53,6 +53,9 @@ public:
         int64_t mem_peak_working_set = 0;
         int64_t mem_working_set_delta = 0;
         uint32_t thread_count = 0;
+
+        // Number of the last update in which the process was found.
+        uint64_t update_number = 0;
     };
 
     using ProcessId = uint32_t;
@@ -73,6 +76,10 @@ private:
 
     base::ByteArray snapshot_;
     ProcessMap table_;
+    uint64_t update_number_ = 0;
+
+    // User names by SID.
+    std::map<std::string, std::string> user_names_;
 
     static const uint32_t kMaxCpuCount = 64;
 
@@ -20,7 +20,7 @@
 
 #include "base/logging.h"
 #include "base/task_runner.h"
-#include "base/peer/client_authenticator.h"
+#include "base/crypto/random.h"
 #include "base/strings/unicode.h"
 #include "host/host_key_storage.h"
 #include "proto/router_peer.pb.h"
@@ -31,12 +31,22 @@ namespace {
 
 const std::chrono::seconds kReconnectTimeout{ 10 };
 
+// The reconnect delay doubles after each failed attempt up to this limit.
+const std::chrono::minutes kMaxReconnectTimeout{ 5 };
+
+// Limit of the delay which the router can request before it stops.
+const std::chrono::hours kMaxNoticeDelay{ 1 };
+
+// The inventory rarely changes, and the updates contain only the changed values.
+const std::chrono::minutes kInventoryInterval{ 15 };
+
 } // namespace
 
 RouterController::RouterController(std::shared_ptr<base::TaskRunner> task_runner)
     : task_runner_(task_runner),
       peer_manager_(std::make_unique<base::RelayPeerManager>(task_runner, this)),
-      reconnect_timer_(base::WaitableTimer::Type::SINGLE_SHOT, task_runner)
+      reconnect_timer_(base::WaitableTimer::Type::SINGLE_SHOT, task_runner),
+      inventory_timer_(base::WaitableTimer::Type::REPEATED, task_runner)
 {
     LOG(LS_INFO) << "Ctor";
 }
@@ -91,6 +101,15 @@ void RouterController::hostIdRequest(const std::string& session_name)
         LOG(LS_INFO) << "Host key is present. Request for an existing ID";
         host_id_request->set_type(proto::HostIdRequest::EXISTING_ID);
         host_id_request->set_key(base::toStdString(host_key));
+
+        // A ticket is used only once. If the router does not accept it, then it looks up the key.
+        auto ticket = resume_tickets_.find(host_key_storage.lastHostId(session_name));
+        if (ticket != resume_tickets_.end())
+        {
+            LOG(LS_INFO) << "Using resume ticket for host ID " << ticket->first;
+            host_id_request->set_resume_ticket(ticket->second);
+            resume_tickets_.erase(ticket);
+        }
     }
 
     // Send host ID request.
@@ -127,12 +146,18 @@ void RouterController::onTcpConnected()
     authenticator_->setIdentify(proto::IDENTIFY_ANONYMOUS);
     authenticator_->setPeerPublicKey(router_info_.public_key);
     authenticator_->setSessionType(proto::ROUTER_SESSION_HOST);
+    authenticator_->setSessionTicket(session_ticket_);
 
     authenticator_->start(std::move(channel_),
                           [this](base::ClientAuthenticator::ErrorCode error_code)
     {
+        // A ticket can be used only once. The authenticator returns a new one after success.
+        session_ticket_ = authenticator_->sessionTicket();
+
         if (error_code == base::ClientAuthenticator::ErrorCode::SUCCESS)
         {
+            LOG(LS_INFO) << "Session resumed: " << authenticator_->isResumed();
+
             // The authenticator takes the listener on itself, we return the receipt of
             // notifications.
             channel_ = authenticator_->takeChannel();
@@ -145,10 +170,23 @@ void RouterController::onTcpConnected()
             }
 
             LOG(LS_INFO) << "Router connected";
+            reconnect_attempts_ = 0;
             routerStateChanged(proto::internal::RouterState::CONNECTED);
 
             // Now the session will receive incoming messages.
             channel_->resume();
+
+            // The router gets the full inventory in each new session.
+            sent_inventory_.clear();
+
+            if (authenticator_->peerVersion() >= base::Version(2, 7, 0))
+            {
+                sendInventory();
+                inventory_timer_.start(
+                    kInventoryInterval, std::bind(&RouterController::sendInventory, this));
+
+                sendDirectCandidates();
+            }
         }
         else
         {
@@ -164,6 +202,8 @@ void RouterController::onTcpConnected()
 
 void RouterController::onTcpDisconnected(base::NetworkChannel::ErrorCode error_code)
 {
+    inventory_timer_.stop();
+
     LOG(LS_INFO) << "Connection to the router is lost ("
                  << base::NetworkChannel::errorToString(error_code) << ")";
 
@@ -239,6 +279,10 @@ void RouterController::onTcpMessageReceived(uint8_t /* channel_id */, const base
         delegate_->onHostIdAssigned(session_name, host_id);
         pending_id_requests_.pop();
     }
+    else if (in_message.has_reconnect_notice())
+    {
+        readReconnectNotice(in_message.reconnect_notice());
+    }
     else if (in_message.has_connection_offer())
     {
         LOG(LS_INFO) << "New connection offer";
@@ -293,8 +337,86 @@ void RouterController::connectToRouter()
 
 void RouterController::delayedConnectToRouter()
 {
-    LOG(LS_INFO) << "Reconnect after " << kReconnectTimeout.count() << " seconds";
-    reconnect_timer_.start(kReconnectTimeout, std::bind(&RouterController::connectToRouter, this));
+    std::chrono::milliseconds delay = notice_reconnect_delay_;
+    notice_reconnect_delay_ = std::chrono::milliseconds::zero();
+
+    if (delay == std::chrono::milliseconds::zero())
+    {
+        // The hosts that lost the connection at the same time reconnect at random times in the
+        // second half of the interval.
+        const int shift = std::min(reconnect_attempts_, 5);
+        const std::chrono::milliseconds interval = std::min<std::chrono::milliseconds>(
+            kReconnectTimeout * (1 << shift), kMaxReconnectTimeout);
+
+        delay = interval / 2 +
+            std::chrono::milliseconds(base::Random::number32() % (interval.count() / 2 + 1));
+        ++reconnect_attempts_;
+    }
+
+    LOG(LS_INFO) << "Reconnect after " << delay.count() << " ms";
+    reconnect_timer_.start(delay, std::bind(&RouterController::connectToRouter, this));
+}
+
+void RouterController::sendInventory()
+{
+    if (!channel_)
+        return;
+
+    Inventory inventory = collectInventory();
+
+    proto::PeerToRouter message;
+    if (!makeInventoryDelta(sent_inventory_, inventory, message.mutable_host_inventory()))
+        return;
+
+    LOG(LS_INFO) << "Sending inventory (items: " << message.host_inventory().item_size()
+                 << " removed: " << message.host_inventory().removed_key_size() << ")";
+
+    channel_->send(proto::ROUTER_CHANNEL_ID_SESSION, base::serialize(message));
+    sent_inventory_ = std::move(inventory);
+}
+
+void RouterController::sendDirectCandidates()
+{
+    if (!channel_)
+        return;
+
+    // The port is kept for all sessions with the router, so the clients connect to the same port.
+    if (!direct_port_)
+    {
+        direct_port_ = std::make_unique<base::DirectPort>();
+        if (!direct_port_->open())
+        {
+            LOG(LS_WARNING) << "Direct connections are not available";
+            direct_port_.reset();
+            return;
+        }
+
+        peer_manager_->setDirectPort(direct_port_->port());
+    }
+
+    proto::PeerToRouter message;
+    message.mutable_direct_candidates()->CopyFrom(
+        direct_port_->candidates(base::utf8FromUtf16(channel_->localAddress())));
+
+    LOG(LS_INFO) << "Sending direct candidates: "
+                 << message.direct_candidates().endpoint_size();
+    channel_->send(proto::ROUTER_CHANNEL_ID_SESSION, message);
+}
+
+void RouterController::readReconnectNotice(const proto::ReconnectNotice& notice)
+{
+    notice_reconnect_delay_ = std::min<std::chrono::milliseconds>(
+        std::chrono::milliseconds(notice.reconnect_delay()), kMaxNoticeDelay);
+
+    resume_tickets_.clear();
+    for (const auto& ticket : notice.ticket())
+    {
+        if (ticket.host_id() != base::kInvalidHostId && !ticket.ticket().empty())
+            resume_tickets_[ticket.host_id()] = ticket.ticket();
+    }
+
+    LOG(LS_INFO) << "Router is stopping. Reconnect after " << notice_reconnect_delay_.count()
+                 << " ms (tickets: " << resume_tickets_.size() << ")";
 }
 
 void RouterController::routerStateChanged(proto::internal::RouterState::State state)
@@ -21,16 +21,15 @@
 
 #include "base/waitable_timer.h"
 #include "base/net/tcp_channel.h"
+#include "base/peer/client_authenticator.h"
 #include "base/peer/host_id.h"
 #include "base/peer/relay_peer_manager.h"
+#include "host/host_inventory.h"
 #include "proto/host_internal.pb.h"
 
+#include <map>
 #include <queue>
 
-namespace base {
-class ClientAuthenticator;
-} // namespace base
-
 namespace host {
 
 class RouterController
@@ -81,6 +80,9 @@ private:
     void connectToRouter();
     void delayedConnectToRouter();
     void routerStateChanged(proto::internal::RouterState::State state);
+    void sendInventory();
+    void sendDirectCandidates();
+    void readReconnectNotice(const proto::ReconnectNotice& notice);
     static const char* routerStateToString(proto::internal::RouterState::State state);
 
     Delegate* delegate_ = nullptr;
@@ -89,11 +91,26 @@ private:
     std::unique_ptr<base::TcpChannel> channel_;
     std::unique_ptr<base::ClientAuthenticator> authenticator_;
     std::unique_ptr<base::RelayPeerManager> peer_manager_;
+    std::unique_ptr<base::DirectPort> direct_port_;
     base::WaitableTimer reconnect_timer_;
+    base::WaitableTimer inventory_timer_;
     RouterInfo router_info_;
 
+    // The inventory which the router has. Empty until the full inventory is sent.
+    Inventory sent_inventory_;
+
+    // Allows to resume the session after a short loss of the connection to the router.
+    base::ClientAuthenticator::SessionTicket session_ticket_;
+
     std::queue<std::string> pending_id_requests_;
 
+    // The router asked to reconnect after this delay. Zero means the usual delay.
+    std::chrono::milliseconds notice_reconnect_delay_ { 0 };
+    int reconnect_attempts_ = 0;
+
+    // Tickets from the router for getting the IDs again without a database lookup.
+    std::map<base::HostId, std::string> resume_tickets_;
+
     DISALLOW_COPY_AND_ASSIGN(RouterController);
 };
 
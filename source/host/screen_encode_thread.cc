@@ -0,0 +1,207 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "host/screen_encode_thread.h"
+
+#include "base/logging.h"
+#include "base/desktop/frame_simple.h"
+#include "base/desktop/mouse_cursor.h"
+
+#include <algorithm>
+
+namespace host {
+
+namespace {
+
+// The planes of the I420 frames are copied from even coordinates.
+base::Rect alignRect(const base::Rect& rect, const base::Size& size)
+{
+    return base::Rect::makeLTRB(rect.left() & ~1, rect.top() & ~1,
+                                std::min(rect.right() + (rect.right() & 1), size.width()),
+                                std::min(rect.bottom() + (rect.bottom() & 1), size.height()));
+}
+
+} // namespace
+
+ScreenEncodeThread::ScreenEncodeThread(std::shared_ptr<base::TaskRunner> task_runner,
+                                       EncodeCallback encode_callback)
+    : task_runner_(std::move(task_runner)),
+      encode_callback_(std::move(encode_callback)),
+      is_alive_(std::make_shared<bool>(true))
+{
+    LOG(LS_INFO) << "Ctor";
+    DCHECK(task_runner_);
+    DCHECK(encode_callback_);
+
+    thread_.start(std::bind(&ScreenEncodeThread::run, this));
+}
+
+ScreenEncodeThread::~ScreenEncodeThread()
+{
+    LOG(LS_INFO) << "Dtor";
+
+    {
+        std::scoped_lock lock(mailbox_lock_);
+        is_stopping_ = true;
+    }
+
+    mailbox_event_.notify_one();
+    thread_.stop();
+
+    // The results that are already posted are not delivered.
+    *is_alive_ = false;
+}
+
+void ScreenEncodeThread::post(const base::Frame* frame, const base::MouseCursor* cursor,
+                              const base::Size& size, bool whole_frame)
+{
+    if (!frame && !cursor)
+        return;
+
+    {
+        std::scoped_lock lock(mailbox_lock_);
+
+        if (frame)
+        {
+            copyFrame(*frame, whole_frame, &pending_frame_);
+            pending_size_ = size;
+            has_pending_frame_ = pending_frame_ != nullptr;
+        }
+
+        if (cursor)
+            pending_cursor_ = std::make_unique<base::MouseCursor>(*cursor);
+    }
+
+    mailbox_event_.notify_one();
+}
+
+void ScreenEncodeThread::flush(base::TaskRunner::Callback callback)
+{
+    {
+        std::scoped_lock lock(mailbox_lock_);
+        pending_flushes_.emplace_back(std::move(callback));
+    }
+
+    mailbox_event_.notify_one();
+}
+
+void ScreenEncodeThread::run()
+{
+    while (true)
+    {
+        std::unique_ptr<base::MouseCursor> cursor;
+        std::vector<base::TaskRunner::Callback> flushes;
+        base::Size size;
+        bool has_frame = false;
+
+        {
+            std::unique_lock lock(mailbox_lock_);
+            mailbox_event_.wait(lock, [this]()
+            {
+                return is_stopping_ || has_pending_frame_ || pending_cursor_ ||
+                       !pending_flushes_.empty();
+            });
+
+            if (is_stopping_)
+                break;
+
+            if (has_pending_frame_)
+            {
+                // Only the updated region is copied, the rest of the frame is the same already.
+                copyFrame(*pending_frame_, false, &frame_);
+                pending_frame_->updatedRegion()->clear();
+                has_pending_frame_ = false;
+                has_frame = frame_ != nullptr;
+                size = pending_size_;
+            }
+
+            cursor = std::move(pending_cursor_);
+            flushes.swap(pending_flushes_);
+        }
+
+        if (has_frame || cursor)
+        {
+            base::TaskRunner::Callback callback =
+                encode_callback_(has_frame ? frame_.get() : nullptr, cursor.get(), size);
+
+            if (has_frame)
+                frame_->updatedRegion()->clear();
+
+            if (callback)
+                flushes.emplace(flushes.begin(), std::move(callback));
+        }
+
+        // The tasks of the runner are called in the order they are posted.
+        for (auto& callback : flushes)
+        {
+            task_runner_->postTask([is_alive = is_alive_, callback = std::move(callback)]()
+            {
+                if (*is_alive)
+                    callback();
+            });
+        }
+    }
+}
+
+// static
+void ScreenEncodeThread::copyFrame(const base::Frame& source, bool whole_frame,
+                                   std::unique_ptr<base::Frame>* target)
+{
+    base::Region updated_region;
+    base::Region copy_region = source.constUpdatedRegion();
+
+    if (*target && (*target)->size() == source.size() && (*target)->format() == source.format() &&
+        (*target)->layout() == source.layout())
+    {
+        // The regions of the frames that are not encoded yet are kept.
+        updated_region = (*target)->constUpdatedRegion();
+
+        if (whole_frame)
+        {
+            copy_region = base::Region(base::Rect::makeSize(source.size()));
+            updated_region = copy_region;
+        }
+    }
+    else
+    {
+        *target = base::FrameSimple::create(source.size(), source.format());
+        if (!*target)
+        {
+            LOG(LS_ERROR) << "Unable to create frame " << source.size();
+            return;
+        }
+
+        // The target has no image yet.
+        copy_region = base::Region(base::Rect::makeSize(source.size()));
+        updated_region = copy_region;
+    }
+
+    base::Frame* frame = target->get();
+    frame->copyFrameInfoFrom(source);
+
+    const bool is_i420 = source.layout() == base::Frame::Layout::I420;
+
+    for (base::Region::Iterator it(copy_region); !it.isAtEnd(); it.advance())
+    {
+        const base::Rect rect = is_i420 ? alignRect(it.rect(), source.size()) : it.rect();
+        frame->copyPixelsFrom(source, rect.topLeft(), rect);
+    }
+
+    frame->updatedRegion()->addRegion(updated_region);
+}
+
+} // namespace host
@@ -0,0 +1,99 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef HOST_SCREEN_ENCODE_THREAD_H
+#define HOST_SCREEN_ENCODE_THREAD_H
+
+#include "base/macros_magic.h"
+#include "base/task_runner.h"
+#include "base/desktop/geometry.h"
+#include "base/threading/simple_thread.h"
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace base {
+class Frame;
+class MouseCursor;
+} // namespace base
+
+namespace host {
+
+// Encodes the screen for one client on a separate thread, so that a slow encoding of a large
+// frame does not delay the input events and other messages of the session. The mailbox holds one
+// frame: a new capture replaces the frame that is not encoded yet and the updated regions of both
+// are merged, so the encoder always gets the latest image of the screen.
+class ScreenEncodeThread
+{
+public:
+    // Called on the encoding thread. |frame| or |cursor| can be null. The returned callback is
+    // called on the thread of |task_runner|, unless the encoding thread is destroyed before that.
+    using EncodeCallback = std::function<base::TaskRunner::Callback(
+        const base::Frame* frame, const base::MouseCursor* cursor, const base::Size& size)>;
+
+    ScreenEncodeThread(std::shared_ptr<base::TaskRunner> task_runner,
+                       EncodeCallback encode_callback);
+    ~ScreenEncodeThread();
+
+    // Copies the updated region of |frame| and |cursor| to the mailbox. Either can be null. The
+    // frame is scaled to |size| by the encoder.
+    // If |whole_frame| is true, the entire frame is copied, because the previous frames were not
+    // posted.
+    void post(const base::Frame* frame, const base::MouseCursor* cursor, const base::Size& size,
+              bool whole_frame = false);
+
+    // Calls |callback| on the thread of |task_runner| after the results of the frames posted
+    // before.
+    void flush(base::TaskRunner::Callback callback);
+
+private:
+    void run();
+
+    // Copies the updated region of |source| to |*target|. The target is created again if the size
+    // or the layout of the source is different.
+    static void copyFrame(const base::Frame& source, bool whole_frame,
+                          std::unique_ptr<base::Frame>* target);
+
+    std::shared_ptr<base::TaskRunner> task_runner_;
+    EncodeCallback encode_callback_;
+
+    base::SimpleThread thread_;
+
+    // Shared with the callbacks posted to |task_runner_|. Reset on the thread of |task_runner_|.
+    std::shared_ptr<bool> is_alive_;
+
+    std::mutex mailbox_lock_;
+    std::condition_variable mailbox_event_;
+    std::unique_ptr<base::Frame> pending_frame_;
+    std::unique_ptr<base::MouseCursor> pending_cursor_;
+    std::vector<base::TaskRunner::Callback> pending_flushes_;
+    base::Size pending_size_;
+    bool has_pending_frame_ = false;
+    bool is_stopping_ = false;
+
+    // Used only on the encoding thread.
+    std::unique_ptr<base::Frame> frame_;
+
+    DISALLOW_COPY_AND_ASSIGN(ScreenEncodeThread);
+};
+
+} // namespace host
+
+#endif // HOST_SCREEN_ENCODE_THREAD_H
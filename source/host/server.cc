@@ -24,15 +24,17 @@
 #include "base/crypto/random.h"
 #include "base/files/base_paths.h"
 #include "base/files/file_path_watcher.h"
+#include "base/metrics/metrics_registry.h"
 #include "base/net/tcp_channel.h"
+#include "base/threading/thread.h"
 #include "common/update_info.h"
 #include "host/client_session.h"
 #include "host/win/updater_launcher.h"
 
 #if defined(OS_WIN)
-#include "base/files/file_util.h"
 #include "base/net/firewall_manager.h"
 #include "base/win/process_util.h"
+#include "host/system_info.h"
 #endif // defined(OS_WIN)
 
 namespace host {
@@ -42,6 +44,32 @@ namespace {
 const wchar_t kFirewallRuleName[] = L"Aspia Host Service";
 const wchar_t kFirewallRuleDecription[] = L"Allow incoming TCP connections";
 
+const std::chrono::minutes kMetricsLogInterval { 15 };
+
+// Number of connections over which the update package is downloaded.
+const size_t kUpdateDownloadConnections = 4;
+
+// Returns the URL of the package on the mirror of the site: the file name of the package is
+// appended to the base URL of the mirror.
+std::string mirrorUrl(std::string_view mirror, std::string_view url)
+{
+    if (mirror.empty())
+        return std::string();
+
+    url = url.substr(0, url.find_first_of("?#"));
+
+    size_t pos = url.find_last_of('/');
+    if (pos == std::string_view::npos || pos + 1 >= url.size())
+        return std::string();
+
+    std::string result(mirror);
+    if (result.back() != '/')
+        result += '/';
+
+    result += url.substr(pos + 1);
+    return result;
+}
+
 } // namespace
 
 Server::Server(std::shared_ptr<base::TaskRunner> task_runner)
@@ -89,6 +117,11 @@ void Server::start()
         base::WaitableTimer::Type::REPEATED, task_runner_);
     update_timer_->start(std::chrono::minutes(5), std::bind(&Server::checkForUpdates, this));
 
+    // The host service has no endpoint for the metrics, so they are written to the log.
+    metrics_timer_ = std::make_unique<base::WaitableTimer>(
+        base::WaitableTimer::Type::REPEATED, task_runner_);
+    metrics_timer_->start(kMetricsLogInterval, std::bind(&Server::logMetrics, this));
+
     settings_watcher_ = std::make_unique<base::FilePathWatcher>(task_runner_);
     settings_watcher_->watch(settings_file, false,
         std::bind(&Server::updateConfiguration, this, std::placeholders::_1, std::placeholders::_2));
@@ -110,6 +143,10 @@ void Server::start()
         connectToRouter();
     }
 
+#if defined(OS_WIN)
+    prefetchSystemInfo();
+#endif // defined(OS_WIN)
+
     LOG(LS_INFO) << "Host server is started successfully";
 }
 
@@ -192,6 +229,25 @@ void Server::onNewSession(base::ServerAuthenticatorManager::SessionInfo&& sessio
         session_info.channel->setChannelIdSupport(true);
     }
 
+    if (session_info.version >= base::Version(2, 7, 0))
+    {
+        LOG(LS_INFO) << "Using message batching";
+        session_info.channel->setMessageBatching(true);
+    }
+
+    const uint32_t crypto_threshold = settings_.cryptoOffloadThreshold();
+    if (crypto_threshold)
+    {
+        if (!crypto_thread_)
+        {
+            LOG(LS_INFO) << "Starting crypto thread (threshold: " << crypto_threshold << ")";
+            crypto_thread_ = std::make_unique<base::Thread>();
+            crypto_thread_->start(base::MessageLoop::Type::DEFAULT);
+        }
+
+        session_info.channel->setCryptoTaskRunner(crypto_thread_->taskRunner(), crypto_threshold);
+    }
+
     std::unique_ptr<ClientSession> session = ClientSession::create(
         static_cast<proto::SessionType>(session_info.session_type),
         std::move(session_info.channel),
@@ -264,7 +320,37 @@ void Server::onUpdateCheckedFinished(const base::ByteArray& result)
 
         if (new_version > current_version)
         {
+            std::error_code error_code;
+            std::filesystem::path temp_path = std::filesystem::temp_directory_path(error_code);
+            if (error_code)
+            {
+                LOG(LS_WARNING) << "Unable to get temp directory: "
+                                << base::utf16FromLocal8Bit(error_code.message());
+                task_runner_->deleteSoon(std::move(update_checker_));
+                return;
+            }
+
+            // The package is written to the file while it is downloaded.
+            update_file_ = temp_path;
+            update_file_.append("aspia_host_" + base::toHex(base::Random::byteArray(16)) + ".msi");
+
             update_downloader_ = std::make_unique<common::HttpFileDownloader>();
+            update_downloader_->setOutputFile(update_file_);
+            update_downloader_->setParallelConnections(kUpdateDownloadConnections);
+
+            if (!update_info.hash().empty())
+            {
+                update_downloader_->setExpectedHash(update_info.hash());
+
+                // The mirror is trusted only when the package can be verified.
+                std::string mirror = mirrorUrl(settings_.updateMirror(), update_info.url());
+                if (!mirror.empty())
+                {
+                    LOG(LS_INFO) << "Update mirror: " << mirror;
+                    update_downloader_->setMirrorUrl(mirror);
+                }
+            }
+
             update_downloader_->start(update_info.url(), task_runner_, this);
         }
         else
@@ -285,46 +371,28 @@ void Server::onFileDownloaderError(int error_code)
 void Server::onFileDownloaderCompleted()
 {
 #if defined(OS_WIN)
-    std::error_code error_code;
-    std::filesystem::path file_path = std::filesystem::temp_directory_path(error_code);
-    if (error_code)
+    std::u16string arguments;
+
+    arguments += u"/i "; // Normal install.
+    arguments += update_file_.u16string(); // MSI package file.
+    arguments += u" /qn"; // No UI during the installation process.
+
+    if (base::win::createProcess(u"msiexec",
+                                 arguments,
+                                 base::win::ProcessExecuteMode::ELEVATE))
     {
-        LOG(LS_WARNING) << "Unable to get temp directory: "
-                        << base::utf16FromLocal8Bit(error_code.message());
+        LOG(LS_INFO) << "Update process started (cmd: " << arguments << ")";
     }
     else
     {
-        file_path.append("aspia_host_" + base::toHex(base::Random::byteArray(16)) + ".msi");
+        LOG(LS_WARNING) << "Unable to create update process (cmd: " << arguments << ")";
 
-        if (!base::writeFile(file_path, update_downloader_->data()))
+        // If the update fails, delete the temporary file.
+        std::error_code error_code;
+        if (!std::filesystem::remove(update_file_, error_code))
         {
-            LOG(LS_WARNING) << "Unable to write file '" << file_path << "'";
-        }
-        else
-        {
-            std::u16string arguments;
-
-            arguments += u"/i "; // Normal install.
-            arguments += file_path.u16string(); // MSI package file.
-            arguments += u" /qn"; // No UI during the installation process.
-
-            if (base::win::createProcess(u"msiexec",
-                                         arguments,
-                                         base::win::ProcessExecuteMode::ELEVATE))
-            {
-                LOG(LS_INFO) << "Update process started (cmd: " << arguments << ")";
-            }
-            else
-            {
-                LOG(LS_WARNING) << "Unable to create update process (cmd: " << arguments << ")";
-
-                // If the update fails, delete the temporary file.
-                if (!std::filesystem::remove(file_path, error_code))
-                {
-                    LOG(LS_WARNING) << "Unable to remove installer file: "
-                                    << base::utf16FromLocal8Bit(error_code.message());
-                }
-            }
+            LOG(LS_WARNING) << "Unable to remove installer file: "
+                            << base::utf16FromLocal8Bit(error_code.message());
         }
     }
 #endif // defined(OS_WIN)
@@ -427,8 +495,13 @@ void Server::updateConfiguration(const std::filesystem::path& path, bool error)
 
         DCHECK_EQ(path, settings_file_path);
 
-        // Synchronize the parameters from the file.
-        settings_.sync();
+        // Synchronize the parameters from the file. The watcher reports every write to the file,
+        // so several notifications can arrive for a single change of the configuration.
+        if (!settings_.sync())
+        {
+            LOG(LS_INFO) << "Configuration without changes. Configuration update skipped";
+            return;
+        }
 
         // Apply settings for user sessions BEFORE reloading the user list.
         user_session_manager_->onSettingsChanged();
@@ -576,4 +649,9 @@ void Server::checkForUpdates()
 #endif // defined(OS_WIN)
 }
 
+void Server::logMetrics()
+{
+    LOG(LS_INFO) << "Metrics: " << base::MetricsRegistry::global().toJson();
+}
+
 } // namespace host
@@ -31,6 +31,7 @@
 namespace base {
 class FilePathWatcher;
 class TaskRunner;
+class Thread;
 class WaitableTimer;
 } // namespace base
 
@@ -86,9 +87,11 @@ private:
     void connectToRouter();
     void disconnectFromRouter();
     void checkForUpdates();
+    void logMetrics();
 
     std::shared_ptr<base::TaskRunner> task_runner_;
     std::unique_ptr<base::WaitableTimer> update_timer_;
+    std::unique_ptr<base::WaitableTimer> metrics_timer_;
 
     std::unique_ptr<base::FilePathWatcher> settings_watcher_;
     SystemSettings settings_;
@@ -97,10 +100,14 @@ private:
     std::unique_ptr<base::TcpServer> server_;
     std::unique_ptr<RouterController> router_controller_;
     std::unique_ptr<base::ServerAuthenticatorManager> authenticator_manager_;
+
+    // Encrypts large messages of the client sessions. Created on the first use.
+    std::unique_ptr<base::Thread> crypto_thread_;
     std::unique_ptr<UserSessionManager> user_session_manager_;
 
     std::unique_ptr<common::UpdateChecker> update_checker_;
     std::unique_ptr<common::HttpFileDownloader> update_downloader_;
+    std::filesystem::path update_file_;
 
     DISALLOW_COPY_AND_ASSIGN(Server);
 };
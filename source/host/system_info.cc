@@ -25,6 +25,7 @@
 #include "base/smbios_parser.h"
 #include "base/smbios_reader.h"
 #include "base/sys_info.h"
+#include "base/threading/thread_pool.h"
 #include "base/net/adapter_enumerator.h"
 #include "base/net/connect_enumerator.h"
 #include "base/net/route_enumerator.h"
@@ -44,10 +45,32 @@
 #include "common/system_info_constants.h"
 #include "host/process_monitor.h"
 
+#include <chrono>
+#include <map>
+#include <mutex>
+
 namespace host {
 
 namespace {
 
+using Clock = std::chrono::steady_clock;
+
+const std::chrono::seconds kLongCacheTimeout { 30 };
+const std::chrono::seconds kShortCacheTimeout { 5 };
+
+struct CacheEntry
+{
+    Clock::time_point time;
+    proto::system_info::SystemInfo system_info;
+};
+
+// The static hardware information is collected only once. The startup is not delayed by it.
+const std::chrono::seconds kPrefetchDelay { 10 };
+
+// The collected categories are shared by all sessions of the process.
+std::mutex g_cache_lock;
+std::map<std::string, CacheEntry> g_cache;
+
 void fillDevices(proto::system_info::SystemInfo* system_info)
 {
     for (base::win::DeviceEnumerator enumerator; !enumerator.isAtEnd(); enumerator.advance())
@@ -678,9 +701,9 @@ void fillProcessor(proto::system_info::SystemInfo* system_info)
     processor->set_threads(static_cast<uint32_t>(base::SysInfo::processorThreads()));
 }
 
-void fillBios(proto::system_info::SystemInfo* system_info)
+void fillBios(proto::system_info::SystemInfo* system_info, const std::string& smbios_dump)
 {
-    for (base::SmbiosTableEnumerator enumerator(base::readSmbiosDump());
+    for (base::SmbiosTableEnumerator enumerator(smbios_dump);
          !enumerator.isAtEnd(); enumerator.advance())
     {
         const base::SmbiosTable* table = enumerator.table();
@@ -704,9 +727,9 @@ void fillBios(proto::system_info::SystemInfo* system_info)
     }
 }
 
-void fillMotherboard(proto::system_info::SystemInfo* system_info)
+void fillMotherboard(proto::system_info::SystemInfo* system_info, const std::string& smbios_dump)
 {
-    for (base::SmbiosTableEnumerator enumerator(base::readSmbiosDump());
+    for (base::SmbiosTableEnumerator enumerator(smbios_dump);
          !enumerator.isAtEnd(); enumerator.advance())
     {
         const base::SmbiosTable* table = enumerator.table();
@@ -731,9 +754,9 @@ void fillMotherboard(proto::system_info::SystemInfo* system_info)
     }
 }
 
-void fillMemory(proto::system_info::SystemInfo* system_info)
+void fillMemory(proto::system_info::SystemInfo* system_info, const std::string& smbios_dump)
 {
-    for (base::SmbiosTableEnumerator enumerator(base::readSmbiosDump());
+    for (base::SmbiosTableEnumerator enumerator(smbios_dump);
          !enumerator.isAtEnd(); enumerator.advance())
     {
         const base::SmbiosTable* table = enumerator.table();
@@ -950,21 +973,78 @@ void fillProcessesInfo(proto::system_info::SystemInfo* system_info)
     }
 }
 
+const proto::system_info::SystemInfo& hardwareInfo()
+{
+    static std::once_flag once_flag;
+    static proto::system_info::SystemInfo hardware_info;
+
+    // If the prefetch is running, then the request waits for it instead of parsing again.
+    std::call_once(once_flag, []()
+    {
+        LOG(LS_INFO) << "Collecting hardware information";
+
+        const std::string smbios_dump = base::readSmbiosDump();
+
+        fillProcessor(&hardware_info);
+        fillBios(&hardware_info, smbios_dump);
+        fillMotherboard(&hardware_info, smbios_dump);
+        fillMemory(&hardware_info, smbios_dump);
+    });
+
+    return hardware_info;
+}
+
 void fillSummaryInfo(proto::system_info::SystemInfo* system_info)
 {
     fillComputer(system_info);
     fillOperatingSystem(system_info);
-    fillProcessor(system_info);
-    fillBios(system_info);
-    fillMotherboard(system_info);
-    fillMemory(system_info);
+    system_info->MergeFrom(hardwareInfo());
     fillDrives(system_info);
 }
 
-} // namespace
+// Returns the time during which the collected category is given from the cache. The categories
+// which change rarely and take long to collect are kept longer. Zero means no caching.
+std::chrono::seconds cacheTimeout(const std::string& category)
+{
+    if (category == common::kSystemInfo_Devices ||
+        category == common::kSystemInfo_VideoAdapters ||
+        category == common::kSystemInfo_Monitors ||
+        category == common::kSystemInfo_Drivers ||
+        category == common::kSystemInfo_Licenses ||
+        category == common::kSystemInfo_Applications)
+    {
+        return kLongCacheTimeout;
+    }
 
-void createSystemInfo(const proto::system_info::SystemInfoRequest& request,
-                      proto::system_info::SystemInfo* system_info)
+    if (category == common::kSystemInfo_Connections ||
+        category == common::kSystemInfo_OpenFiles ||
+        category == common::kSystemInfo_Processes ||
+        category == common::kSystemInfo_PowerOptions)
+    {
+        return std::chrono::seconds(0);
+    }
+
+    return kShortCacheTimeout;
+}
+
+std::string cacheKey(const proto::system_info::SystemInfoRequest& request)
+{
+    std::string key = request.category();
+
+    if (key == common::kSystemInfo_EventLogs)
+    {
+        // Each page of each log is cached separately.
+        const proto::system_info::EventLogsData& data = request.event_logs_data();
+
+        key += '/' + std::to_string(data.type()) + '/' + std::to_string(data.record_start()) +
+            '/' + std::to_string(data.record_count());
+    }
+
+    return key;
+}
+
+void fillSystemInfo(const proto::system_info::SystemInfoRequest& request,
+                    proto::system_info::SystemInfo* system_info)
 {
     if (request.category().empty())
     {
@@ -1064,4 +1144,59 @@ void createSystemInfo(const proto::system_info::SystemInfoRequest& request,
     }
 }
 
+} // namespace
+
+void createSystemInfo(const proto::system_info::SystemInfoRequest& request,
+                      proto::system_info::SystemInfo* system_info)
+{
+    const std::chrono::seconds timeout = cacheTimeout(request.category());
+    if (timeout == std::chrono::seconds(0))
+    {
+        fillSystemInfo(request, system_info);
+        return;
+    }
+
+    const std::string key = cacheKey(request);
+
+    {
+        std::scoped_lock lock(g_cache_lock);
+
+        auto cached = g_cache.find(key);
+        if (cached != g_cache.end() && Clock::now() - cached->second.time < timeout)
+        {
+            LOG(LS_INFO) << "System info category from cache: " << key;
+            *system_info = cached->second.system_info;
+            return;
+        }
+    }
+
+    // The collection is done without the lock, so the other categories can be collected at the
+    // same time.
+    fillSystemInfo(request, system_info);
+
+    std::scoped_lock lock(g_cache_lock);
+    const Clock::time_point now = Clock::now();
+
+    // Remove the expired entries so that the pages of the event logs do not accumulate.
+    for (auto it = g_cache.begin(); it != g_cache.end();)
+    {
+        if (now - it->second.time >= kLongCacheTimeout)
+            it = g_cache.erase(it);
+        else
+            ++it;
+    }
+
+    CacheEntry& entry = g_cache[key];
+    entry.time = now;
+    entry.system_info = *system_info;
+}
+
+void prefetchSystemInfo()
+{
+    base::ThreadPool::shared()->postDelayedTask([]()
+    {
+        hardwareInfo();
+    }, kPrefetchDelay);
+}
+
 } // namespace host
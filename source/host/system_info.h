@@ -26,6 +26,11 @@ namespace host {
 void createSystemInfo(const proto::system_info::SystemInfoRequest& request,
                       proto::system_info::SystemInfo* system_info);
 
+// Collects the hardware information which does not change while the host is running (processor,
+// BIOS, motherboard and memory modules) in a background thread shortly after startup, so the
+// first request does not wait for it.
+void prefetchSystemInfo();
+
 } // namespace host
 
 #endif // HOST_SYSTEM_INFO_H
@@ -21,6 +21,7 @@
 #include "base/crypto/password_generator.h"
 #include "base/crypto/password_hash.h"
 #include "base/crypto/random.h"
+#include "base/files/base_paths.h"
 #include "base/peer/user_list.h"
 
 namespace host {
@@ -92,9 +93,9 @@ bool SystemSettings::isWritable() const
     return settings_.isWritable();
 }
 
-void SystemSettings::sync()
+bool SystemSettings::sync()
 {
-    settings_.sync();
+    return settings_.sync();
 }
 
 bool SystemSettings::flush()
@@ -222,6 +223,16 @@ void SystemSettings::setPreferredVideoCapturer(uint32_t type)
     settings_.set("PreferredVideoCapturer", type);
 }
 
+uint32_t SystemSettings::cryptoOffloadThreshold() const
+{
+    return settings_.get<uint32_t>("CryptoOffloadThreshold", 0);
+}
+
+void SystemSettings::setCryptoOffloadThreshold(uint32_t size)
+{
+    settings_.set("CryptoOffloadThreshold", size);
+}
+
 bool SystemSettings::passwordProtection() const
 {
     return settings_.get<bool>("PasswordProtection", false);
@@ -410,4 +421,53 @@ void SystemSettings::setLastUpdateCheck(int64_t timepoint)
     settings_.set("LastUpdateCheck", timepoint);
 }
 
+std::string SystemSettings::updateMirror() const
+{
+    return settings_.get<std::string>("UpdateMirror");
+}
+
+void SystemSettings::setUpdateMirror(const std::string& mirror)
+{
+    settings_.set("UpdateMirror", mirror);
+}
+
+bool SystemSettings::isSessionRecordingEnabled() const
+{
+    return settings_.get<bool>("SessionRecordingEnabled", false);
+}
+
+void SystemSettings::setSessionRecordingEnabled(bool enable)
+{
+    settings_.set("SessionRecordingEnabled", enable);
+}
+
+std::filesystem::path SystemSettings::sessionRecordingPath() const
+{
+    std::filesystem::path path(settings_.get<std::u16string>("SessionRecordingPath"));
+    if (!path.empty())
+        return path;
+
+    if (!base::BasePaths::commonAppData(&path))
+        return std::filesystem::path();
+
+    path.append(u"aspia");
+    path.append(u"recordings");
+    return path;
+}
+
+void SystemSettings::setSessionRecordingPath(const std::filesystem::path& path)
+{
+    settings_.set("SessionRecordingPath", path.u16string());
+}
+
+int64_t SystemSettings::sessionRecordingMaxFileSize() const
+{
+    return settings_.get<int64_t>("SessionRecordingMaxFileSize", 512);
+}
+
+void SystemSettings::setSessionRecordingMaxFileSize(int64_t megabytes)
+{
+    settings_.set("SessionRecordingMaxFileSize", megabytes);
+}
+
 } // namespace host
@@ -42,7 +42,7 @@ public:
 
     const std::filesystem::path& filePath() const;
     bool isWritable() const;
-    void sync();
+    bool sync();
     bool flush();
 
     uint16_t tcpPort() const;
@@ -69,6 +69,11 @@ public:
     uint32_t preferredVideoCapturer() const;
     void setPreferredVideoCapturer(uint32_t type);
 
+    // Messages of client sessions of at least this size are encrypted on a separate thread. Zero
+    // means all messages are encrypted on the thread of the service.
+    uint32_t cryptoOffloadThreshold() const;
+    void setCryptoOffloadThreshold(uint32_t size);
+
     bool passwordProtection() const;
     void setPasswordProtection(bool enable);
 
@@ -117,6 +122,21 @@ public:
     int64_t lastUpdateCheck() const;
     void setLastUpdateCheck(int64_t timepoint);
 
+    // Base URL of a server of the site that caches the update packages.
+    std::string updateMirror() const;
+    void setUpdateMirror(const std::string& mirror);
+
+    // If enabled, the desktop sessions are recorded on the host regardless of the client.
+    bool isSessionRecordingEnabled() const;
+    void setSessionRecordingEnabled(bool enable);
+
+    std::filesystem::path sessionRecordingPath() const;
+    void setSessionRecordingPath(const std::filesystem::path& path);
+
+    // Maximum size of one recording file in megabytes. Zero means no limit.
+    int64_t sessionRecordingMaxFileSize() const;
+    void setSessionRecordingMaxFileSize(int64_t megabytes);
+
 private:
     base::JsonSettings settings_;
 
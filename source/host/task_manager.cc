@@ -28,6 +28,48 @@
 
 namespace host {
 
+namespace {
+
+bool hasColumn(uint32_t columns, proto::task_manager::ProcessListRequest::Column column)
+{
+    return columns == proto::task_manager::ProcessListRequest::COLUMN_ALL || (columns & column);
+}
+
+void setProcessValues(const ProcessMonitor::ProcessEntry& entry, uint32_t columns,
+                      proto::task_manager::Process* item)
+{
+    using Request = proto::task_manager::ProcessListRequest;
+
+    if (hasColumn(columns, Request::COLUMN_SESSION_ID))
+        item->set_session_id(entry.session_id);
+    if (hasColumn(columns, Request::COLUMN_CPU_USAGE))
+        item->set_cpu_usage(entry.cpu_ratio);
+    if (hasColumn(columns, Request::COLUMN_MEM_PRIVATE_WORKING_SET))
+        item->set_mem_private_working_set(entry.mem_private_working_set);
+    if (hasColumn(columns, Request::COLUMN_MEM_WORKING_SET))
+        item->set_mem_working_set(entry.mem_working_set);
+    if (hasColumn(columns, Request::COLUMN_MEM_PEAK_WORKING_SET))
+        item->set_mem_peak_working_set(entry.mem_peak_working_set);
+    if (hasColumn(columns, Request::COLUMN_MEM_WORKING_SET_DELTA))
+        item->set_mem_working_set_delta(entry.mem_working_set_delta);
+    if (hasColumn(columns, Request::COLUMN_THREAD_COUNT))
+        item->set_thread_count(entry.thread_count);
+}
+
+bool isEqualValues(const proto::task_manager::Process& first,
+                   const proto::task_manager::Process& second)
+{
+    return first.session_id() == second.session_id() &&
+           first.cpu_usage() == second.cpu_usage() &&
+           first.mem_private_working_set() == second.mem_private_working_set() &&
+           first.mem_working_set() == second.mem_working_set() &&
+           first.mem_peak_working_set() == second.mem_peak_working_set() &&
+           first.mem_working_set_delta() == second.mem_working_set_delta() &&
+           first.thread_count() == second.thread_count();
+}
+
+} // namespace
+
 TaskManager::TaskManager(Delegate* delegate)
     : process_monitor_(std::make_unique<ProcessMonitor>()),
       delegate_(delegate)
@@ -45,7 +87,8 @@ void TaskManager::readMessage(const proto::task_manager::ClientToHost& message)
 {
     if (message.has_process_list_request())
     {
-        sendProcessList(message.process_list_request().flags());
+        sendProcessList(message.process_list_request().flags(),
+                        message.process_list_request().columns());
     }
     else if (message.has_end_process_request())
     {
@@ -165,7 +208,7 @@ void TaskManager::readMessage(const proto::task_manager::ClientToHost& message)
     }
 }
 
-void TaskManager::sendProcessList(uint32_t flags)
+void TaskManager::sendProcessList(uint32_t flags, uint32_t columns)
 {
     proto::task_manager::HostToClient message;
 
@@ -173,18 +216,43 @@ void TaskManager::sendProcessList(uint32_t flags)
     if (flags & proto::task_manager::ProcessListRequest::RESET_CACHE)
         reset_cache = true;
 
+    // After a reset or a change of the columns the client gets the full list.
+    const bool is_delta = (flags & proto::task_manager::ProcessListRequest::DELTA) &&
+        !reset_cache && columns == sent_columns_;
+
+    if (!is_delta)
+        sent_processes_.clear();
+    sent_columns_ = columns;
+
     proto::task_manager::ProcessList* process_list = message.mutable_process_list();
     process_list->set_cpu_usage(process_monitor_->calcCpuUsage());
     process_list->set_memory_usage(process_monitor_->calcMemoryUsage());
+    process_list->set_is_delta(is_delta);
 
     const ProcessMonitor::ProcessMap& processes = process_monitor_->processes(reset_cache);
     for (const auto& process : processes)
     {
-        proto::task_manager::Process* item = process_list->add_process();
-
         ProcessMonitor::ProcessId process_id = process.first;
         const ProcessMonitor::ProcessEntry& process_info = process.second;
 
+        proto::task_manager::Process values;
+        values.set_process_id(process_id);
+        setProcessValues(process_info, columns, &values);
+
+        const bool strings_changed = process_info.process_name_changed ||
+            process_info.user_name_changed || process_info.file_path_changed;
+
+        auto sent = sent_processes_.find(process_id);
+        if (is_delta && sent != sent_processes_.end() && !strings_changed &&
+            isEqualValues(sent->second, values))
+        {
+            // Nothing has changed since the previous list.
+            continue;
+        }
+
+        proto::task_manager::Process* item = process_list->add_process();
+        *item = values;
+
         if (process_info.process_name_changed)
             item->set_process_name(process_info.process_name);
 
@@ -194,15 +262,21 @@ void TaskManager::sendProcessList(uint32_t flags)
         if (process_info.file_path_changed)
             item->set_file_path(process_info.file_path);
 
-        item->set_session_id(process_info.session_id);
-        item->set_process_id(process_id);
-        item->set_session_id(process_info.session_id);
-        item->set_cpu_usage(process_info.cpu_ratio);
-        item->set_mem_private_working_set(process_info.mem_private_working_set);
-        item->set_mem_working_set(process_info.mem_working_set);
-        item->set_mem_peak_working_set(process_info.mem_peak_working_set);
-        item->set_mem_working_set_delta(process_info.mem_working_set_delta);
-        item->set_thread_count(process_info.thread_count);
+        sent_processes_[process_id] = std::move(values);
+    }
+
+    for (auto it = sent_processes_.begin(); it != sent_processes_.end();)
+    {
+        if (processes.find(static_cast<ProcessMonitor::ProcessId>(it->first)) != processes.end())
+        {
+            ++it;
+            continue;
+        }
+
+        if (is_delta)
+            process_list->add_removed_process_id(it->first);
+
+        it = sent_processes_.erase(it);
     }
 
     delegate_->onTaskManagerMessage(message);
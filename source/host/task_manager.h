@@ -22,6 +22,7 @@
 #include "base/macros_magic.h"
 #include "proto/task_manager.pb.h"
 
+#include <map>
 #include <memory>
 
 namespace host {
@@ -45,13 +46,17 @@ public:
     void readMessage(const proto::task_manager::ClientToHost& message);
 
 private:
-    void sendProcessList(uint32_t flags);
+    void sendProcessList(uint32_t flags, uint32_t columns);
     void sendServiceList();
     void sendUserList();
 
     std::unique_ptr<ProcessMonitor> process_monitor_;
     Delegate* delegate_;
 
+    // The last values sent to the client for each process. Used to send only the changes.
+    std::map<uint64_t, proto::task_manager::Process> sent_processes_;
+    uint32_t sent_columns_ = 0;
+
     DISALLOW_COPY_AND_ASSIGN(TaskManager);
 };
 
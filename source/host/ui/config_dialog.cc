@@ -250,6 +250,12 @@ ConfigDialog::ConfigDialog(QWidget* parent)
 #elif defined(OS_LINUX)
     ui.combo_video_capturer->addItem(
         QStringLiteral("X11"), static_cast<uint32_t>(base::ScreenCapturer::Type::LINUX_X11));
+
+#if defined(USE_PIPEWIRE)
+    ui.combo_video_capturer->addItem(
+        QStringLiteral("PipeWire"),
+        static_cast<uint32_t>(base::ScreenCapturer::Type::LINUX_PIPEWIRE));
+#endif // defined(USE_PIPEWIRE)
 #elif defined(OS_MAC)
     ui.combo_video_capturer->addItem(
         QStringLiteral("MACOSX"), static_cast<uint32_t>(base::ScreenCapturer::Type::MACOSX));
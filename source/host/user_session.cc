@@ -18,6 +18,7 @@
 
 #include "host/user_session.h"
 
+#include "base/environment.h"
 #include "base/location.h"
 #include "base/logging.h"
 #include "base/task_runner.h"
@@ -28,6 +29,7 @@
 #include "base/strings/string_number_conversions.h"
 #include "base/strings/string_util.h"
 #include "base/strings/unicode.h"
+#include "base/threading/worker_pool.h"
 #include "host/client_session_desktop.h"
 #include "host/client_session_text_chat.h"
 #include "host/desktop_session_proxy.h"
@@ -38,10 +40,16 @@
 #include "base/win/session_status.h"
 #endif // defined(OS_WIN)
 
+#include <algorithm>
+#include <thread>
+
 namespace host {
 
 namespace {
 
+// Maximum number of threads that copy the captured frame for the clients.
+const int kMaxEncodePoolThreads = 4;
+
 const char* routerStateToString(proto::internal::RouterState::State state)
 {
     switch (state)
@@ -95,6 +103,9 @@ UserSession::UserSession(std::shared_ptr<base::TaskRunner> task_runner,
 
     router_state_.set_state(proto::internal::RouterState::DISABLED);
 
+    screen_sharing_ = !base::Environment::has("ASPIA_NO_SHARED_ENCODING");
+    LOG(LS_INFO) << "Shared encoding of the screen: " << screen_sharing_;
+
     SystemSettings settings;
 
     password_enabled_ = settings.oneTimePassword();
@@ -641,6 +652,9 @@ void UserSession::onMessageReceived(const base::ByteArray& buffer)
                     proto::internal::DesktopControl::DISABLE :
                     proto::internal::DesktopControl::ENABLE);
 
+                is_capture_paused_ = false;
+                updateCapturePause();
+
                 if (is_paused)
                 {
                     scoped_task_runner_->postDelayedTask(std::chrono::milliseconds(500), [this]()
@@ -730,6 +744,10 @@ void UserSession::onDesktopSessionStarted()
     }
 
     desktop_session_proxy_->control(action);
+
+    is_capture_paused_ = false;
+    updateCapturePause();
+
     onClientSessionConfigured();
 }
 
@@ -750,8 +768,54 @@ void UserSession::onDesktopSessionStopped()
 
 void UserSession::onScreenCaptured(const base::Frame* frame, const base::MouseCursor* cursor)
 {
+    if (screen_sharing_ && frame)
+        updateScreenSharing();
+
+    std::vector<ClientSessionDesktop*> threaded_clients;
+    std::vector<ClientSessionDesktop*> other_clients;
+
     for (const auto& client : desktop_clients_)
-        static_cast<ClientSessionDesktop*>(client.get())->encodeScreen(frame, cursor);
+    {
+        ClientSessionDesktop* desktop_client = static_cast<ClientSessionDesktop*>(client.get());
+        if (!desktop_client->prepareScreen(frame, cursor))
+            continue;
+
+        if (desktop_client->hasEncodeThread())
+            threaded_clients.emplace_back(desktop_client);
+        else
+            other_clients.emplace_back(desktop_client);
+    }
+
+    if (threaded_clients.size() > 1)
+    {
+        if (!encode_pool_)
+        {
+            const int thread_count = std::clamp(
+                static_cast<int>(std::thread::hardware_concurrency()), 1, kMaxEncodePoolThreads);
+            encode_pool_ = std::make_unique<base::WorkerPool>(thread_count);
+        }
+
+        const size_t thread_count = static_cast<size_t>(encode_pool_->threadCount());
+
+        // The agent reuses the frame after this method returns, so the copies are waited for.
+        encode_pool_->run([&](int index)
+        {
+            for (size_t i = static_cast<size_t>(index); i < threaded_clients.size();
+                 i += thread_count)
+            {
+                threaded_clients[i]->postScreen();
+            }
+        });
+    }
+    else if (!threaded_clients.empty())
+    {
+        threaded_clients.front()->postScreen();
+    }
+
+    // The hardware encoders are used only on this thread. The encoding threads of the other
+    // clients are already working.
+    for (ClientSessionDesktop* desktop_client : other_clients)
+        desktop_client->postScreen();
 }
 
 void UserSession::onScreenCaptureError(proto::VideoErrorCode error_code)
@@ -887,6 +951,7 @@ void UserSession::onClientSessionFinished()
     {
         LOG(LS_INFO) << "No desktop clients connected. Disabling the desktop agent (sid: " << session_id_ << ")";
         desktop_session_proxy_->control(proto::internal::DesktopControl::DISABLE);
+        is_capture_paused_ = false;
 
         desktop_session_proxy_->setScreenCaptureFps(
             desktop_session_proxy_->defaultScreenCaptureFps());
@@ -894,6 +959,10 @@ void UserSession::onClientSessionFinished()
         desktop_session_proxy_->setKeyboardLock(false);
         desktop_session_proxy_->setPaused(false);
     }
+    else
+    {
+        updateCapturePause();
+    }
 }
 
 void UserSession::onClientSessionVideoRecording(
@@ -916,6 +985,11 @@ void UserSession::onClientSessionVideoRecording(
     channel_->send(base::serialize(outgoing_message_));
 }
 
+void UserSession::onClientSessionVideoPaused()
+{
+    updateCapturePause();
+}
+
 void UserSession::onClientSessionTextChat(uint32_t id, const proto::TextChat& text_chat)
 {
     if (!channel_)
@@ -1189,7 +1263,12 @@ void UserSession::addNewClientSession(std::unique_ptr<ClientSession> client_sess
             desktop_client_session->setDesktopSessionProxy(desktop_session_proxy_);
 
             if (enable_required)
+            {
                 desktop_session_proxy_->control(proto::internal::DesktopControl::ENABLE);
+                is_capture_paused_ = false;
+            }
+
+            updateCapturePause();
         }
         break;
 
@@ -1363,6 +1442,13 @@ void UserSession::mergeAndSendConfiguration()
     DesktopSession::Config system_config;
     memset(&system_config, 0, sizeof(system_config));
 
+    // Frames in the I420 layout can only be used if all clients are able to encode them.
+    system_config.prefer_i420 = !desktop_clients_.empty();
+
+    // The capturer scales the frames down only if all clients need smaller frames, and not below
+    // the largest size of them.
+    bool scale_capture = !desktop_clients_.empty();
+
     for (const auto& client : desktop_clients_)
     {
         const DesktopSession::Config& client_config =
@@ -1395,10 +1481,89 @@ void UserSession::mergeAndSendConfiguration()
 
         system_config.cursor_position =
             system_config.cursor_position || client_config.cursor_position;
+
+        system_config.prefer_i420 = system_config.prefer_i420 && client_config.prefer_i420;
+
+        // The audio is captured once for all clients, so it is captured with the short interval
+        // if at least one client needs it.
+        system_config.low_latency_audio =
+            system_config.low_latency_audio || client_config.low_latency_audio;
+
+        // The audio is not captured if no client encodes it.
+        system_config.capture_audio = system_config.capture_audio || client_config.capture_audio;
+
+        if (client_config.capture_width <= 0 || client_config.capture_height <= 0)
+            scale_capture = false;
+
+        system_config.capture_width =
+            std::max(system_config.capture_width, client_config.capture_width);
+        system_config.capture_height =
+            std::max(system_config.capture_height, client_config.capture_height);
+    }
+
+    if (!scale_capture)
+    {
+        system_config.capture_width = 0;
+        system_config.capture_height = 0;
     }
 
     desktop_session_proxy_->configure(system_config);
     desktop_session_proxy_->captureScreen();
 }
 
+void UserSession::updateScreenSharing()
+{
+    std::vector<ClientSessionDesktop*> leaders;
+
+    for (const auto& client : desktop_clients_)
+    {
+        ClientSessionDesktop* desktop_client = static_cast<ClientSessionDesktop*>(client.get());
+        ClientSessionDesktop* leader = nullptr;
+
+        for (ClientSessionDesktop* candidate : leaders)
+        {
+            if (desktop_client->canShareScreenWith(*candidate))
+            {
+                leader = candidate;
+                break;
+            }
+        }
+
+        // The followers are always after their leader in the list, so the groups are stable.
+        desktop_client->setScreenLeader(leader);
+
+        if (!leader)
+            leaders.emplace_back(desktop_client);
+    }
+}
+
+void UserSession::updateCapturePause()
+{
+    // The session is disabled while it is paused by the user.
+    if (desktop_clients_.empty() || desktop_session_proxy_->isPaused())
+        return;
+
+    bool is_paused = true;
+
+    for (const auto& client : desktop_clients_)
+    {
+        if (!static_cast<ClientSessionDesktop*>(client.get())->isVideoPaused())
+        {
+            is_paused = false;
+            break;
+        }
+    }
+
+    if (is_paused == is_capture_paused_)
+        return;
+
+    LOG(LS_INFO) << "Capture " << (is_paused ? "paused" : "resumed") << " (sid: "
+                 << session_id_ << ")";
+
+    is_capture_paused_ = is_paused;
+    desktop_session_proxy_->control(is_paused ?
+        proto::internal::DesktopControl::PAUSE_CAPTURE :
+        proto::internal::DesktopControl::RESUME_CAPTURE);
+}
+
 } // namespace host
@@ -34,6 +34,7 @@
 
 namespace base {
 class ScopedTaskRunner;
+class WorkerPool;
 } // namespace base
 
 namespace host {
@@ -120,6 +121,7 @@ protected:
     void onClientSessionFinished() override;
     void onClientSessionVideoRecording(
         const std::string& computer_name, const std::string& user_name, bool started) override;
+    void onClientSessionVideoPaused() override;
     void onClientSessionTextChat(uint32_t id, const proto::TextChat& text_chat) override;
 
 private:
@@ -138,6 +140,13 @@ private:
     void onTextChatSessionFinished(uint32_t id);
     void mergeAndSendConfiguration();
 
+    // The desktop clients with the same encoder configuration share one encoding of the screen.
+    // The first compatible client in the list encodes the frames for the others.
+    void updateScreenSharing();
+
+    // The agent does not capture the screen while all desktop clients have paused the video.
+    void updateCapturePause();
+
     std::shared_ptr<base::TaskRunner> task_runner_;
     std::unique_ptr<base::ScopedTaskRunner> scoped_task_runner_;
     std::unique_ptr<base::IpcChannel> channel_;
@@ -159,6 +168,8 @@ private:
     std::string password_;
 
     bool connection_confirmation_ = false;
+    bool screen_sharing_ = true;
+    bool is_capture_paused_ = false;
     SystemSettings::NoUserAction no_user_action_ = SystemSettings::NoUserAction::ACCEPT;
     std::chrono::milliseconds auto_confirmation_interval_ { 0 };
 
@@ -173,6 +184,9 @@ private:
     ClientSessionList system_info_clients_;
     ClientSessionList text_chat_clients_;
 
+    // Copies the captured frame to the encoding threads of the clients in parallel.
+    std::unique_ptr<base::WorkerPool> encode_pool_;
+
     std::unique_ptr<DesktopSessionManager> desktop_session_;
     base::local_shared_ptr<DesktopSessionProxy> desktop_session_proxy_;
 
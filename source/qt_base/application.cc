@@ -37,6 +37,8 @@
 #include <QLockFile>
 #include <QThread>
 
+#include <chrono>
+
 #if defined(OS_WIN)
 #include <Windows.h>
 #include <Psapi.h>
@@ -61,6 +63,12 @@ const int kMaxMessageSize = 1024 * 1024 * 1;
 
 const char kOkMessage[] = "OK";
 
+using Clock = std::chrono::steady_clock;
+
+// Initialized when the executable is loaded.
+const Clock::time_point kProcessStartTime = Clock::now();
+Clock::time_point g_last_startup_phase_time = kProcessStartTime;
+
 #if defined(OS_WIN)
 bool isSameApplication(const QLocalSocket* socket)
 {
@@ -144,6 +152,8 @@ Application::Application(int& argc, char* argv[])
 
     locale_loader_ = std::make_unique<LocaleLoader>();
     ui_task_runner_ = std::make_shared<QtTaskRunner>();
+
+    traceStartup("Application created");
 }
 
 Application::~Application()
@@ -189,6 +199,20 @@ std::shared_ptr<base::TaskRunner> Application::ioTaskRunner()
     return application->io_task_runner_;
 }
 
+// static
+void Application::traceStartup(std::string_view phase)
+{
+    const Clock::time_point current_time = Clock::now();
+
+    LOG(LS_INFO) << "Startup phase '" << phase << "': "
+                 << std::chrono::duration_cast<std::chrono::milliseconds>(
+                        current_time - kProcessStartTime).count() << " ms (+"
+                 << std::chrono::duration_cast<std::chrono::milliseconds>(
+                        current_time - g_last_startup_phase_time).count() << " ms)";
+
+    g_last_startup_phase_time = current_time;
+}
+
 bool Application::isRunning()
 {
     if (!lock_file_->tryLock())
@@ -24,6 +24,8 @@
 
 #include <QApplication>
 
+#include <string_view>
+
 class QLocalServer;
 class QLockFile;
 
@@ -47,6 +49,10 @@ public:
 
     bool isRunning();
 
+    // Writes the time elapsed since the start of the process and since the previous phase to the
+    // log. Must be called on the UI thread.
+    static void traceStartup(std::string_view phase);
+
     using Locale = LocaleLoader::Locale;
     using LocaleList = LocaleLoader::LocaleList;
 
@@ -0,0 +1,557 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "relay/bench/benchmark.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+#include "base/crypto/generic_hash.h"
+#include "base/crypto/key_pair.h"
+#include "base/crypto/message_encryptor_openssl.h"
+#include "base/crypto/random.h"
+#include "base/message_loop/message_loop.h"
+#include "base/message_loop/message_pump_asio.h"
+#include "base/threading/thread.h"
+#include "proto/relay_peer.pb.h"
+#include "relay/sessions_worker.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+#if defined(OS_WIN)
+#include <Windows.h>
+#else
+#include <sys/resource.h>
+#endif // defined(OS_WIN)
+
+namespace relay {
+
+namespace {
+
+const std::chrono::seconds kConnectTimeout { 15 };
+const size_t kBulkMessageSize = 64 * 1024; // 64 kB
+const size_t kBurstyMessageSize = 16 * 1024; // 16 kB
+const size_t kInteractiveMessageSize = 64;
+
+// Creates the authentication message of a peer in the same way as base::RelayPeer does.
+base::ByteArray authenticationMessage(uint32_t key_id,
+                                      const base::ByteArray& relay_public_key,
+                                      const base::ByteArray& iv,
+                                      const base::ByteArray& secret)
+{
+    base::KeyPair key_pair = base::KeyPair::create(base::KeyPair::Type::X25519);
+    if (!key_pair.isValid())
+    {
+        LOG(LS_ERROR) << "KeyPair::create failed";
+        return base::ByteArray();
+    }
+
+    base::ByteArray session_key = base::GenericHash::hash(
+        base::GenericHash::Type::BLAKE2s256, key_pair.sessionKey(relay_public_key));
+
+    std::unique_ptr<base::MessageEncryptor> encryptor =
+        base::MessageEncryptorOpenssl::createForChaCha20Poly1305(session_key, iv);
+    if (!encryptor)
+    {
+        LOG(LS_ERROR) << "createForChaCha20Poly1305 failed";
+        return base::ByteArray();
+    }
+
+    std::string encrypted_secret;
+    encrypted_secret.resize(encryptor->encryptedDataSize(secret.size()));
+    if (!encryptor->encrypt(secret.data(), secret.size(), encrypted_secret.data()))
+    {
+        LOG(LS_ERROR) << "encrypt failed";
+        return base::ByteArray();
+    }
+
+    proto::PeerToRelay message;
+
+    message.set_key_id(key_id);
+    message.set_public_key(base::toStdString(key_pair.publicKey()));
+    message.set_data(std::move(encrypted_secret));
+
+    return base::serialize(message);
+}
+
+// Returns the processor time used by the process, including the synthetic peers.
+std::chrono::microseconds processCpuTime()
+{
+#if defined(OS_WIN)
+    FILETIME creation_time;
+    FILETIME exit_time;
+    FILETIME kernel_time;
+    FILETIME user_time;
+
+    if (!GetProcessTimes(GetCurrentProcess(), &creation_time, &exit_time, &kernel_time, &user_time))
+        return std::chrono::microseconds(0);
+
+    auto toMicroseconds = [](const FILETIME& time)
+    {
+        ULARGE_INTEGER value;
+        value.LowPart = time.dwLowDateTime;
+        value.HighPart = time.dwHighDateTime;
+        return static_cast<int64_t>(value.QuadPart / 10); // 100 ns units.
+    };
+
+    return std::chrono::microseconds(toMicroseconds(kernel_time) + toMicroseconds(user_time));
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return std::chrono::microseconds(0);
+
+    auto toMicroseconds = [](const timeval& time)
+    {
+        return static_cast<int64_t>(time.tv_sec) * 1000000 + time.tv_usec;
+    };
+
+    return std::chrono::microseconds(
+        toMicroseconds(usage.ru_utime) + toMicroseconds(usage.ru_stime));
+#endif // defined(OS_WIN)
+}
+
+uint32_t percentile(const std::vector<uint32_t>& sorted_values, double percent)
+{
+    if (sorted_values.empty())
+        return 0;
+
+    const size_t index = std::min(
+        static_cast<size_t>(static_cast<double>(sorted_values.size()) * percent / 100),
+        sorted_values.size() - 1);
+
+    return sorted_values[index];
+}
+
+const char* patternName(Benchmark::Pattern pattern)
+{
+    switch (pattern)
+    {
+        case Benchmark::Pattern::BULK:
+            return "bulk";
+
+        case Benchmark::Pattern::BURSTY:
+            return "bursty";
+
+        case Benchmark::Pattern::INTERACTIVE:
+            return "interactive";
+
+        case Benchmark::Pattern::MIXED:
+            return "mixed";
+    }
+
+    return "unknown";
+}
+
+} // namespace
+
+// Thread that runs a part of the synthetic peers.
+class Benchmark::ClientThread : public base::Thread::Delegate
+{
+public:
+    struct PairConfig
+    {
+        PeerPair::Options options;
+        base::ByteArray first_message;
+        base::ByteArray second_message;
+    };
+
+    ClientThread(const asio::ip::tcp::endpoint& relay_endpoint, BenchCounters* counters);
+    ~ClientThread() override;
+
+    void addPair(PairConfig&& config) { configs_.emplace_back(std::move(config)); }
+
+    void start();
+    void startTraffic();
+
+    // Stops the thread. After that the latencies of all pairs of the thread are available.
+    void stop();
+    const std::vector<uint32_t>& latencies() const { return latencies_; }
+
+protected:
+    // base::Thread::Delegate implementation.
+    void onBeforeThreadRunning() override;
+    void onAfterThreadRunning() override;
+
+private:
+    const asio::ip::tcp::endpoint relay_endpoint_;
+    BenchCounters* counters_;
+
+    std::unique_ptr<base::Thread> thread_;
+    std::shared_ptr<base::TaskRunner> task_runner_;
+
+    std::vector<PairConfig> configs_;
+    std::vector<std::unique_ptr<PeerPair>> pairs_;
+    std::vector<uint32_t> latencies_;
+
+    DISALLOW_COPY_AND_ASSIGN(ClientThread);
+};
+
+Benchmark::ClientThread::ClientThread(
+    const asio::ip::tcp::endpoint& relay_endpoint, BenchCounters* counters)
+    : relay_endpoint_(relay_endpoint),
+      counters_(counters),
+      thread_(std::make_unique<base::Thread>())
+{
+    // Nothing
+}
+
+Benchmark::ClientThread::~ClientThread()
+{
+    stop();
+}
+
+void Benchmark::ClientThread::start()
+{
+    thread_->start(base::MessageLoop::Type::ASIO, this);
+}
+
+void Benchmark::ClientThread::startTraffic()
+{
+    if (!task_runner_->belongsToCurrentThread())
+    {
+        task_runner_->postTask(std::bind(&ClientThread::startTraffic, this));
+        return;
+    }
+
+    for (const auto& pair : pairs_)
+        pair->startTraffic();
+}
+
+void Benchmark::ClientThread::stop()
+{
+    thread_->stop();
+}
+
+void Benchmark::ClientThread::onBeforeThreadRunning()
+{
+    task_runner_ = thread_->taskRunner();
+    DCHECK(task_runner_);
+
+    asio::io_context& io_context = base::MessageLoop::current()->pumpAsio()->ioContext();
+
+    for (const auto& config : configs_)
+    {
+        pairs_.emplace_back(
+            std::make_unique<PeerPair>(io_context, relay_endpoint_, config.options, counters_));
+        pairs_.back()->connect(config.first_message, config.second_message);
+    }
+
+    configs_.clear();
+}
+
+void Benchmark::ClientThread::onAfterThreadRunning()
+{
+    for (const auto& pair : pairs_)
+    {
+        const std::vector<uint32_t>& latencies = pair->latencies();
+        latencies_.insert(latencies_.end(), latencies.begin(), latencies.end());
+    }
+
+    pairs_.clear();
+}
+
+Benchmark::Benchmark(std::shared_ptr<base::TaskRunner> task_runner, const Options& options)
+    : task_runner_(std::move(task_runner)),
+      options_(options),
+      connect_timer_(base::WaitableTimer::Type::SINGLE_SHOT, task_runner_),
+      warmup_timer_(base::WaitableTimer::Type::SINGLE_SHOT, task_runner_),
+      duration_timer_(base::WaitableTimer::Type::SINGLE_SHOT, task_runner_),
+      report_timer_(base::WaitableTimer::Type::REPEATED, task_runner_)
+{
+    DCHECK(task_runner_);
+}
+
+Benchmark::~Benchmark()
+{
+    // The peers are stopped before the relay sessions.
+    client_threads_.clear();
+    sessions_worker_.reset();
+}
+
+bool Benchmark::start()
+{
+    LOG(LS_INFO) << "Starting benchmark with " << options_.pair_count << " pairs";
+
+    shared_pool_ = std::make_unique<SharedPool>(this);
+
+    sessions_worker_ = std::make_unique<SessionsWorker>(
+        u"127.0.0.1", options_.port, std::chrono::minutes(60), false, std::chrono::seconds(1),
+        options_.zero_copy, options_.worker_count, shared_pool_->share());
+    sessions_worker_->start(task_runner_, this);
+
+    const asio::ip::tcp::endpoint relay_endpoint(asio::ip::make_address_v4("127.0.0.1"),
+                                                 options_.port);
+
+    for (size_t i = 0; i < std::max(options_.client_thread_count, size_t(1)); ++i)
+        client_threads_.emplace_back(std::make_unique<ClientThread>(relay_endpoint, &counters_));
+
+    for (size_t i = 0; i < options_.pair_count; ++i)
+    {
+        SessionKey session_key = SessionKey::create();
+        if (!session_key.isValid())
+        {
+            LOG(LS_ERROR) << "Failed to create session key";
+            return false;
+        }
+
+        const base::ByteArray public_key = session_key.publicKey();
+        const base::ByteArray iv = session_key.iv();
+        const uint32_t key_id = shared_pool_->addKey(std::move(session_key));
+
+        proto::PeerToRelay::Secret secret_message;
+        secret_message.set_random_data(base::Random::string(16));
+        secret_message.set_client_address("127.0.0.1");
+        secret_message.set_client_user_name("benchmark");
+        secret_message.set_host_address("127.0.0.1");
+        secret_message.set_host_id(i + 1);
+
+        const base::ByteArray secret = base::serialize(secret_message);
+
+        ClientThread::PairConfig config;
+        config.options = pairOptions(i);
+        config.first_message = authenticationMessage(key_id, public_key, iv, secret);
+        config.second_message = authenticationMessage(key_id, public_key, iv, secret);
+
+        if (config.first_message.empty() || config.second_message.empty())
+            return false;
+
+        client_threads_[i % client_threads_.size()]->addPair(std::move(config));
+    }
+
+    for (const auto& client_thread : client_threads_)
+        client_thread->start();
+
+    connect_timer_.start(kConnectTimeout, [this]()
+    {
+        std::cout << "Only " << started_sessions_ << " of " << options_.pair_count
+                  << " pairs connected in " << kConnectTimeout.count() << " seconds" << std::endl;
+        finish();
+    });
+
+    return true;
+}
+
+void Benchmark::onSessionStarted()
+{
+    ++started_sessions_;
+
+    if (started_sessions_ == options_.pair_count)
+        onAllConnected();
+}
+
+void Benchmark::onSessionStatistics(const proto::RelayStat& /* relay_stat */)
+{
+    // Nothing
+}
+
+void Benchmark::onSessionFinished()
+{
+    ++finished_sessions_;
+
+    if (is_measuring_)
+        LOG(LS_WARNING) << "Session finished during the measurement";
+}
+
+void Benchmark::onPoolKeyExpired(uint32_t /* key_id */)
+{
+    // Nothing
+}
+
+PeerPair::Options Benchmark::pairOptions(size_t index) const
+{
+    PeerPair::Options options;
+
+    switch (options_.pattern)
+    {
+        case Pattern::BULK:
+            options.pattern = PeerPair::Pattern::BULK;
+            break;
+
+        case Pattern::BURSTY:
+            options.pattern = PeerPair::Pattern::BURSTY;
+            break;
+
+        case Pattern::INTERACTIVE:
+            options.pattern = PeerPair::Pattern::INTERACTIVE;
+            break;
+
+        case Pattern::MIXED:
+        {
+            const PeerPair::Pattern kPatterns[] =
+            {
+                PeerPair::Pattern::BULK, PeerPair::Pattern::BURSTY, PeerPair::Pattern::INTERACTIVE
+            };
+
+            options.pattern = kPatterns[index % std::size(kPatterns)];
+        }
+        break;
+    }
+
+    switch (options.pattern)
+    {
+        case PeerPair::Pattern::BULK:
+            options.message_size = kBulkMessageSize;
+            break;
+
+        case PeerPair::Pattern::BURSTY:
+            options.message_size = kBurstyMessageSize;
+            options.frame_size = options_.frame_size;
+            options.interval = std::chrono::microseconds(
+                1000000 / std::max(options_.frames_per_second, 1U));
+            break;
+
+        case PeerPair::Pattern::INTERACTIVE:
+            options.message_size = kInteractiveMessageSize;
+            options.interval = options_.interactive_interval;
+            break;
+    }
+
+    if (options_.message_size)
+        options.message_size = options_.message_size;
+
+    return options;
+}
+
+void Benchmark::onAllConnected()
+{
+    connect_timer_.stop();
+
+    std::cout << "All " << options_.pair_count << " pairs connected, warming up for "
+              << options_.warmup.count() << " seconds" << std::endl;
+
+    for (const auto& client_thread : client_threads_)
+        client_thread->startTraffic();
+
+    warmup_timer_.start(options_.warmup, std::bind(&Benchmark::onWarmupFinished, this));
+}
+
+void Benchmark::onWarmupFinished()
+{
+    is_measuring_ = true;
+
+    measure_start_time_ = Clock::now();
+    measure_start_cpu_time_ = processCpuTime();
+    last_report_time_ = measure_start_time_;
+
+    counters_.measuring.store(true, std::memory_order_relaxed);
+
+    duration_timer_.start(options_.duration, std::bind(&Benchmark::finish, this));
+
+    if (options_.report_interval.count())
+        report_timer_.start(options_.report_interval, std::bind(&Benchmark::onReportTimer, this));
+}
+
+void Benchmark::onReportTimer()
+{
+    const Clock::time_point now = Clock::now();
+    const int64_t bytes = counters_.bytes_received.load(std::memory_order_relaxed);
+
+    const double elapsed = std::chrono::duration<double>(now - last_report_time_).count();
+    const double total_elapsed = std::chrono::duration<double>(now - measure_start_time_).count();
+    const double mbps = elapsed > 0 ?
+        static_cast<double>(bytes - last_report_bytes_) * 8 / elapsed / 1000000 : 0;
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "[" << total_elapsed << " s] " << mbps << " Mbit/s, active sessions: "
+              << (started_sessions_ - finished_sessions_)
+              << ", errors: " << counters_.errors.load(std::memory_order_relaxed) << std::endl;
+
+    last_report_bytes_ = bytes;
+    last_report_time_ = now;
+}
+
+void Benchmark::finish()
+{
+    if (is_finished_)
+        return;
+
+    is_finished_ = true;
+
+    counters_.measuring.store(false, std::memory_order_relaxed);
+    measure_end_time_ = Clock::now();
+    measure_end_cpu_time_ = processCpuTime();
+
+    connect_timer_.stop();
+    warmup_timer_.stop();
+    duration_timer_.stop();
+    report_timer_.stop();
+
+    std::vector<uint32_t> latencies;
+    for (const auto& client_thread : client_threads_)
+    {
+        client_thread->stop();
+
+        const std::vector<uint32_t>& thread_latencies = client_thread->latencies();
+        latencies.insert(latencies.end(), thread_latencies.begin(), thread_latencies.end());
+    }
+
+    if (is_measuring_)
+    {
+        printReport(latencies);
+
+        is_succeeded_ = counters_.errors.load(std::memory_order_relaxed) == 0 &&
+                        started_sessions_ == options_.pair_count;
+    }
+
+    is_measuring_ = false;
+    task_runner_->postQuit();
+}
+
+void Benchmark::printReport(const std::vector<uint32_t>& latencies) const
+{
+    std::vector<uint32_t> sorted = latencies;
+    std::sort(sorted.begin(), sorted.end());
+
+    const double elapsed =
+        std::chrono::duration<double>(measure_end_time_ - measure_start_time_).count();
+    const double cpu_time =
+        std::chrono::duration<double>(measure_end_cpu_time_ - measure_start_cpu_time_).count();
+    const int64_t bytes = counters_.bytes_received.load(std::memory_order_relaxed);
+    const double gigabits = static_cast<double>(bytes) * 8 / 1000000000;
+
+    std::cout << std::fixed << std::setprecision(2)
+              << "Pattern:          " << patternName(options_.pattern) << std::endl
+              << "Pairs:            " << options_.pair_count << std::endl
+              << "Workers:          " << options_.worker_count << std::endl
+              << "Client threads:   " << client_threads_.size() << std::endl
+              << "Zero-copy:        " << (options_.zero_copy ? "yes" : "no") << std::endl
+              << "Duration:         " << elapsed << " s" << std::endl
+              << "Received:         " << static_cast<double>(bytes) / (1024 * 1024) << " MB in "
+              << counters_.messages_received.load(std::memory_order_relaxed) << " messages"
+              << std::endl
+              << "Throughput:       " << (elapsed > 0 ? gigabits * 1000 / elapsed : 0)
+              << " Mbit/s" << std::endl
+              << "Latency (us):     p50 " << percentile(sorted, 50)
+              << ", p90 " << percentile(sorted, 90)
+              << ", p99 " << percentile(sorted, 99)
+              << ", p99.9 " << percentile(sorted, 99.9)
+              << ", max " << (sorted.empty() ? 0 : sorted.back()) << std::endl
+              << "CPU time:         " << cpu_time << " s ("
+              << (elapsed > 0 ? cpu_time * 100 / elapsed : 0)
+              << "% of one core, including the peers)" << std::endl
+              << "CPU per Gbit:     " << (gigabits > 0 ? cpu_time / gigabits : 0) << " s"
+              << std::endl
+              << "Dropped frames:   " << counters_.dropped_frames.load(std::memory_order_relaxed)
+              << std::endl
+              << "Closed sessions:  " << finished_sessions_ << std::endl
+              << "Errors:           " << counters_.errors.load(std::memory_order_relaxed)
+              << std::endl;
+}
+
+} // namespace relay
@@ -0,0 +1,134 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef RELAY_BENCH_BENCHMARK_H
+#define RELAY_BENCH_BENCHMARK_H
+
+#include "base/waitable_timer.h"
+#include "relay/bench/peer_pair.h"
+#include "relay/session_manager.h"
+#include "relay/shared_pool.h"
+
+namespace base {
+class Thread;
+} // namespace base
+
+namespace relay {
+
+class SessionsWorker;
+
+// Runs the relay sessions in the current process and forwards synthetic traffic between pairs of
+// peers through them. The peers are authenticated by the relay in the same way as real peers.
+class Benchmark
+    : public SessionManager::Delegate,
+      public SharedPool::Delegate
+{
+public:
+    enum class Pattern
+    {
+        BULK,
+        BURSTY,
+        INTERACTIVE,
+        MIXED // The patterns are assigned to the pairs in turn.
+    };
+
+    struct Options
+    {
+        size_t pair_count = 10;
+        Pattern pattern = Pattern::BULK;
+        std::chrono::seconds duration { 10 };
+        std::chrono::seconds warmup { 2 };
+
+        // Interval of the progress reports. Zero means only the final report.
+        std::chrono::seconds report_interval { 0 };
+
+        uint16_t port = 18090;
+        size_t worker_count = 1;
+        size_t client_thread_count = 1;
+        bool zero_copy = false;
+
+        // Zero means the default of the pattern.
+        size_t message_size = 0;
+        size_t frame_size = 64 * 1024;
+        uint32_t frames_per_second = 30;
+        std::chrono::milliseconds interactive_interval { 10 };
+    };
+
+    Benchmark(std::shared_ptr<base::TaskRunner> task_runner, const Options& options);
+    ~Benchmark() override;
+
+    bool start();
+
+    // Returns true if all pairs were connected and no errors occurred.
+    bool isSucceeded() const { return is_succeeded_; }
+
+protected:
+    // SessionManager::Delegate implementation.
+    void onSessionStarted() override;
+    void onSessionStatistics(const proto::RelayStat& relay_stat) override;
+    void onSessionFinished() override;
+
+    // SharedPool::Delegate implementation.
+    void onPoolKeyExpired(uint32_t key_id) override;
+
+private:
+    class ClientThread;
+
+    PeerPair::Options pairOptions(size_t index) const;
+    void onAllConnected();
+    void onWarmupFinished();
+    void onReportTimer();
+    void finish();
+    void printReport(const std::vector<uint32_t>& latencies) const;
+
+    std::shared_ptr<base::TaskRunner> task_runner_;
+    const Options options_;
+
+    std::unique_ptr<SharedPool> shared_pool_;
+    std::unique_ptr<SessionsWorker> sessions_worker_;
+    std::vector<std::unique_ptr<ClientThread>> client_threads_;
+
+    BenchCounters counters_;
+
+    base::WaitableTimer connect_timer_;
+    base::WaitableTimer warmup_timer_;
+    base::WaitableTimer duration_timer_;
+    base::WaitableTimer report_timer_;
+
+    size_t started_sessions_ = 0;
+    size_t finished_sessions_ = 0;
+    bool is_measuring_ = false;
+    bool is_finished_ = false;
+    bool is_succeeded_ = false;
+
+    using Clock = std::chrono::high_resolution_clock;
+
+    Clock::time_point measure_start_time_;
+    Clock::time_point measure_end_time_;
+    std::chrono::microseconds measure_start_cpu_time_ { 0 };
+    std::chrono::microseconds measure_end_cpu_time_ { 0 };
+
+    int64_t last_report_bytes_ = 0;
+    Clock::time_point last_report_time_;
+
+    DISALLOW_COPY_AND_ASSIGN(Benchmark);
+};
+
+} // namespace relay
+
+#endif // RELAY_BENCH_BENCHMARK_H
@@ -0,0 +1,189 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/command_line.h"
+#include "base/logging.h"
+#include "base/crypto/scoped_crypto_initializer.h"
+#include "base/message_loop/message_loop.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/unicode.h"
+#include "relay/bench/benchmark.h"
+
+#include <iostream>
+
+namespace {
+
+const unsigned int kMaxPairCount = 10000;
+const unsigned int kMaxThreadCount = 256;
+const unsigned int kMaxMessageSize = 16 * 1024 * 1024; // 16 MB
+const unsigned int kMinMessageSize = 16;
+
+void showHelp()
+{
+    std::cout << "aspia_relay_bench [switch]" << std::endl
+        << "Available switches:" << std::endl
+        << '\t' << "--pairs=N" << '\t' << "Number of peer pairs (10)" << std::endl
+        << '\t' << "--pattern=NAME" << '\t' << "bulk, bursty, interactive or mixed (bulk)"
+        << std::endl
+        << '\t' << "--duration=S" << '\t' << "Measurement time in seconds (10)" << std::endl
+        << '\t' << "--warmup=S" << '\t' << "Time before the measurement in seconds (2)"
+        << std::endl
+        << '\t' << "--report-interval=S" << '\t' << "Progress report interval for soak tests (0)"
+        << std::endl
+        << '\t' << "--port=N" << '\t' << "Port of the relay sessions (18090)" << std::endl
+        << '\t' << "--workers=N" << '\t' << "Relay worker threads, 0 for one per processor (1)"
+        << std::endl
+        << '\t' << "--client-threads=N" << '\t' << "Threads of the synthetic peers (1)" << std::endl
+        << '\t' << "--zero-copy" << '\t' << "Use zero-copy forwarding if supported" << std::endl
+        << '\t' << "--message-size=N" << '\t' << "Size of messages in bytes" << std::endl
+        << '\t' << "--frame-size=N" << '\t' << "Average frame size of the bursty pattern (65536)"
+        << std::endl
+        << '\t' << "--fps=N" << '\t' << "Frame rate of the bursty pattern (30)" << std::endl
+        << '\t' << "--interval=MS" << '\t' << "Message interval of the interactive pattern (10)"
+        << std::endl
+        << '\t' << "--help" << '\t' << "Show help" << std::endl;
+}
+
+bool readSwitch(const base::CommandLine& command_line, std::u16string_view name,
+                unsigned int min_value, unsigned int max_value, unsigned int* value)
+{
+    if (!command_line.hasSwitch(name))
+        return true;
+
+    unsigned int result;
+    if (!base::stringToUint(command_line.switchValue(name), &result) ||
+        result < min_value || result > max_value)
+    {
+        std::cout << "Invalid value of switch --" << base::utf8FromUtf16(name) << std::endl;
+        return false;
+    }
+
+    *value = result;
+    return true;
+}
+
+bool parseOptions(const base::CommandLine& command_line, relay::Benchmark::Options* options)
+{
+    unsigned int pair_count = static_cast<unsigned int>(options->pair_count);
+    unsigned int duration = static_cast<unsigned int>(options->duration.count());
+    unsigned int warmup = static_cast<unsigned int>(options->warmup.count());
+    unsigned int report_interval = static_cast<unsigned int>(options->report_interval.count());
+    unsigned int port = options->port;
+    unsigned int worker_count = static_cast<unsigned int>(options->worker_count);
+    unsigned int client_thread_count = static_cast<unsigned int>(options->client_thread_count);
+    unsigned int message_size = 0;
+    unsigned int frame_size = static_cast<unsigned int>(options->frame_size);
+    unsigned int fps = options->frames_per_second;
+    unsigned int interval = static_cast<unsigned int>(options->interactive_interval.count());
+
+    if (!readSwitch(command_line, u"pairs", 1, kMaxPairCount, &pair_count) ||
+        !readSwitch(command_line, u"duration", 1, 7 * 24 * 3600, &duration) ||
+        !readSwitch(command_line, u"warmup", 0, 3600, &warmup) ||
+        !readSwitch(command_line, u"report-interval", 0, 3600, &report_interval) ||
+        !readSwitch(command_line, u"port", 1, 65535, &port) ||
+        !readSwitch(command_line, u"workers", 0, kMaxThreadCount, &worker_count) ||
+        !readSwitch(command_line, u"client-threads", 1, kMaxThreadCount, &client_thread_count) ||
+        !readSwitch(command_line, u"message-size", kMinMessageSize, kMaxMessageSize,
+                    &message_size) ||
+        !readSwitch(command_line, u"frame-size", 1, kMaxMessageSize, &frame_size) ||
+        !readSwitch(command_line, u"fps", 1, 1000, &fps) ||
+        !readSwitch(command_line, u"interval", 1, 60000, &interval))
+    {
+        return false;
+    }
+
+    if (command_line.hasSwitch(u"pattern"))
+    {
+        const std::u16string& pattern = command_line.switchValue(u"pattern");
+
+        if (pattern == u"bulk")
+            options->pattern = relay::Benchmark::Pattern::BULK;
+        else if (pattern == u"bursty")
+            options->pattern = relay::Benchmark::Pattern::BURSTY;
+        else if (pattern == u"interactive")
+            options->pattern = relay::Benchmark::Pattern::INTERACTIVE;
+        else if (pattern == u"mixed")
+            options->pattern = relay::Benchmark::Pattern::MIXED;
+        else
+        {
+            std::cout << "Unknown pattern: " << base::utf8FromUtf16(pattern) << std::endl;
+            return false;
+        }
+    }
+
+    options->pair_count = pair_count;
+    options->duration = std::chrono::seconds(duration);
+    options->warmup = std::chrono::seconds(warmup);
+    options->report_interval = std::chrono::seconds(report_interval);
+    options->port = static_cast<uint16_t>(port);
+    options->worker_count = worker_count;
+    options->client_thread_count = client_thread_count;
+    options->zero_copy = command_line.hasSwitch(u"zero-copy");
+    options->message_size = message_size;
+    options->frame_size = frame_size;
+    options->frames_per_second = fps;
+    options->interactive_interval = std::chrono::milliseconds(interval);
+
+    return true;
+}
+
+} // namespace
+
+int main(int argc, const char* const* argv)
+{
+    base::initLogging();
+
+    base::CommandLine::init(argc, argv);
+    base::CommandLine* command_line = base::CommandLine::forCurrentProcess();
+
+    if (command_line->hasSwitch(u"help"))
+    {
+        showHelp();
+        return 0;
+    }
+
+    relay::Benchmark::Options options;
+    if (!parseOptions(*command_line, &options))
+    {
+        showHelp();
+        return 1;
+    }
+
+    std::unique_ptr<base::ScopedCryptoInitializer> crypto_initializer =
+        std::make_unique<base::ScopedCryptoInitializer>();
+
+    std::unique_ptr<base::MessageLoop> message_loop =
+        std::make_unique<base::MessageLoop>(base::MessageLoop::Type::ASIO);
+
+    std::unique_ptr<relay::Benchmark> benchmark =
+        std::make_unique<relay::Benchmark>(message_loop->taskRunner(), options);
+
+    bool succeeded = false;
+    if (benchmark->start())
+    {
+        message_loop->run();
+        succeeded = benchmark->isSucceeded();
+    }
+
+    benchmark.reset();
+    message_loop.reset();
+    crypto_initializer.reset();
+
+    base::shutdownLogging();
+    return succeeded ? 0 : 1;
+}
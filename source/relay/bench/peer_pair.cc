@@ -0,0 +1,355 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "relay/bench/peer_pair.h"
+
+#include "base/endian_util.h"
+#include "base/logging.h"
+#include "base/strings/unicode.h"
+
+#include <asio/read.hpp>
+#include <asio/write.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+
+namespace relay {
+
+namespace {
+
+// Each message starts with a header. Both peers are in the same process, so the send time can be
+// compared with the receive time directly.
+struct MessageHeader
+{
+    uint32_t size; // Including the header.
+    uint32_t sequence;
+    int64_t send_time; // Microseconds.
+};
+
+const size_t kHeaderSize = sizeof(MessageHeader);
+
+// Every kKeyFrameInterval frame of the bursty pattern is kKeyFrameScale times larger.
+const uint64_t kKeyFrameInterval = 60;
+const size_t kKeyFrameScale = 4;
+
+// If the sender is behind by more than this number of frames, then new frames are dropped like a
+// video encoder does on a slow network.
+const size_t kMaxQueuedFrames = 2;
+
+int64_t currentTime()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+PeerPair::PeerPair(asio::io_context& io_context,
+                   const asio::ip::tcp::endpoint& relay_endpoint,
+                   const Options& options,
+                   BenchCounters* counters)
+    : relay_endpoint_(relay_endpoint),
+      options_(options),
+      counters_(counters),
+      socket_{ asio::ip::tcp::socket(io_context), asio::ip::tcp::socket(io_context) },
+      timer_(io_context)
+{
+    DCHECK(counters_);
+    DCHECK_GE(options_.message_size, kHeaderSize);
+
+    send_buffer_.resize(options_.message_size);
+    receive_buffer_.resize(options_.message_size);
+
+    // The content does not matter, but it should not be all zeros.
+    for (size_t i = 0; i < send_buffer_.size(); ++i)
+        send_buffer_[i] = static_cast<uint8_t>(i);
+}
+
+PeerPair::~PeerPair()
+{
+    stop();
+}
+
+void PeerPair::connect(const base::ByteArray& first_message, const base::ByteArray& second_message)
+{
+    auth_message_[SENDER] = first_message;
+    auth_message_[RECEIVER] = second_message;
+
+    for (int side = 0; side < 2; ++side)
+        doConnect(side);
+}
+
+void PeerPair::startTraffic()
+{
+    if (is_stopped_)
+        return;
+
+    if (options_.pattern == Pattern::BULK)
+    {
+        send_queue_.emplace_back(options_.message_size);
+        doWrite();
+        return;
+    }
+
+    next_frame_time_ = std::chrono::high_resolution_clock::now();
+    onFrameTimer();
+}
+
+void PeerPair::stop()
+{
+    if (is_stopped_)
+        return;
+
+    is_stopped_ = true;
+
+    std::error_code ignored_code;
+    for (int side = 0; side < 2; ++side)
+    {
+        socket_[side].cancel(ignored_code);
+        socket_[side].close(ignored_code);
+    }
+
+    timer_.cancel();
+}
+
+void PeerPair::doConnect(int side)
+{
+    socket_[side].async_connect(relay_endpoint_, [this, side](const std::error_code& error_code)
+    {
+        if (error_code == asio::error::operation_aborted)
+            return;
+
+        if (error_code)
+        {
+            onError("connect", error_code);
+            return;
+        }
+
+        std::error_code ignored_code;
+        socket_[side].set_option(asio::ip::tcp::no_delay(true), ignored_code);
+
+        auth_message_size_[side] =
+            base::EndianUtil::toBig(static_cast<uint32_t>(auth_message_[side].size()));
+
+        const std::array<asio::const_buffer, 2> buffers =
+        {
+            asio::const_buffer(&auth_message_size_[side], sizeof(uint32_t)),
+            asio::const_buffer(auth_message_[side].data(), auth_message_[side].size())
+        };
+
+        asio::async_write(socket_[side], buffers,
+            [this, side](const std::error_code& error_code, size_t /* bytes_transferred */)
+        {
+            if (error_code == asio::error::operation_aborted)
+                return;
+
+            if (error_code)
+            {
+                onError("authentication", error_code);
+                return;
+            }
+
+            if (side == RECEIVER)
+                doReadHeader();
+        });
+    });
+}
+
+void PeerPair::scheduleFrame()
+{
+    next_frame_time_ += options_.interval;
+
+    timer_.expires_at(next_frame_time_);
+    timer_.async_wait([this](const std::error_code& error_code)
+    {
+        if (error_code)
+            return;
+
+        onFrameTimer();
+    });
+}
+
+void PeerPair::onFrameTimer()
+{
+    if (is_stopped_)
+        return;
+
+    if (options_.pattern == Pattern::INTERACTIVE)
+    {
+        send_queue_.emplace_back(options_.message_size);
+    }
+    else
+    {
+        size_t frame_size = options_.frame_size;
+        if (frame_number_ % kKeyFrameInterval == 0)
+            frame_size *= kKeyFrameScale;
+
+        ++frame_number_;
+
+        if (send_queue_.size() * options_.message_size > kMaxQueuedFrames * options_.frame_size)
+        {
+            if (counters_->measuring.load(std::memory_order_relaxed))
+                counters_->dropped_frames.fetch_add(1, std::memory_order_relaxed);
+        }
+        else
+        {
+            while (frame_size)
+            {
+                const size_t size =
+                    std::max(std::min(frame_size, options_.message_size), kHeaderSize);
+                send_queue_.emplace_back(size);
+                frame_size -= std::min(frame_size, size);
+            }
+        }
+    }
+
+    doWrite();
+    scheduleFrame();
+}
+
+void PeerPair::doWrite()
+{
+    if (is_writing_ || send_queue_.empty() || is_stopped_)
+        return;
+
+    const size_t size = send_queue_.front();
+    send_queue_.pop_front();
+
+    MessageHeader header;
+    header.size = static_cast<uint32_t>(size);
+    header.sequence = send_sequence_++;
+    header.send_time = currentTime();
+    memcpy(send_buffer_.data(), &header, kHeaderSize);
+
+    is_writing_ = true;
+
+    asio::async_write(socket_[SENDER], asio::const_buffer(send_buffer_.data(), size),
+        [this](const std::error_code& error_code, size_t /* bytes_transferred */)
+    {
+        if (error_code == asio::error::operation_aborted)
+            return;
+
+        if (error_code)
+        {
+            onError("write", error_code);
+            return;
+        }
+
+        is_writing_ = false;
+
+        if (options_.pattern == Pattern::BULK)
+            send_queue_.emplace_back(options_.message_size);
+
+        doWrite();
+    });
+}
+
+void PeerPair::doReadHeader()
+{
+    asio::async_read(socket_[RECEIVER], asio::buffer(receive_buffer_.data(), kHeaderSize),
+        [this](const std::error_code& error_code, size_t /* bytes_transferred */)
+    {
+        if (error_code == asio::error::operation_aborted)
+            return;
+
+        if (error_code)
+        {
+            onError("read", error_code);
+            return;
+        }
+
+        MessageHeader header;
+        memcpy(&header, receive_buffer_.data(), kHeaderSize);
+
+        if (header.size < kHeaderSize || header.size > receive_buffer_.size())
+        {
+            onError("read", asio::error::message_size);
+            return;
+        }
+
+        if (header.size == kHeaderSize)
+        {
+            onMessageReceived();
+            return;
+        }
+
+        doReadBody(header.size);
+    });
+}
+
+void PeerPair::doReadBody(uint32_t size)
+{
+    asio::async_read(socket_[RECEIVER],
+                     asio::buffer(receive_buffer_.data() + kHeaderSize, size - kHeaderSize),
+        [this](const std::error_code& error_code, size_t /* bytes_transferred */)
+    {
+        if (error_code == asio::error::operation_aborted)
+            return;
+
+        if (error_code)
+        {
+            onError("read", error_code);
+            return;
+        }
+
+        onMessageReceived();
+    });
+}
+
+void PeerPair::onMessageReceived()
+{
+    MessageHeader header;
+    memcpy(&header, receive_buffer_.data(), kHeaderSize);
+
+    if (header.sequence != receive_sequence_)
+    {
+        LOG(LS_WARNING) << "Unexpected message sequence: " << header.sequence
+                        << " (expected: " << receive_sequence_ << ")";
+        counters_->errors.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    receive_sequence_ = header.sequence + 1;
+
+    if (counters_->measuring.load(std::memory_order_relaxed))
+    {
+        const int64_t latency = std::max(currentTime() - header.send_time, int64_t(0));
+        latencies_.emplace_back(static_cast<uint32_t>(
+            std::min(latency, int64_t(std::numeric_limits<uint32_t>::max()))));
+
+        counters_->bytes_received.fetch_add(header.size, std::memory_order_relaxed);
+        counters_->messages_received.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    doReadHeader();
+}
+
+void PeerPair::onError(const char* operation, const std::error_code& error_code)
+{
+    if (is_stopped_)
+        return;
+
+    LOG(LS_WARNING) << "Peer " << operation << " error: "
+                    << base::utf16FromLocal8Bit(error_code.message());
+
+    counters_->errors.fetch_add(1, std::memory_order_relaxed);
+    stop();
+}
+
+} // namespace relay
@@ -0,0 +1,120 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef RELAY_BENCH_PEER_PAIR_H
+#define RELAY_BENCH_PEER_PAIR_H
+
+#include "base/macros_magic.h"
+#include "base/memory/byte_array.h"
+
+#include <asio/high_resolution_timer.hpp>
+#include <asio/ip/tcp.hpp>
+
+#include <atomic>
+#include <deque>
+
+namespace relay {
+
+// Counters shared by all peer pairs of the benchmark.
+struct BenchCounters
+{
+    // Data is counted only while this flag is set, so that the connection and warm-up time do not
+    // affect the results.
+    std::atomic<bool> measuring { false };
+
+    std::atomic<int64_t> bytes_received { 0 };
+    std::atomic<int64_t> messages_received { 0 };
+    std::atomic<int64_t> dropped_frames { 0 };
+    std::atomic<int64_t> errors { 0 };
+};
+
+// Two synthetic peers connected through the relay. The first peer sends the traffic of the
+// selected pattern and the second one receives it and measures the latency of each message.
+class PeerPair
+{
+public:
+    enum class Pattern
+    {
+        BULK,       // Messages are sent as fast as possible.
+        BURSTY,     // Frames of a video stream at a fixed rate, split into messages.
+        INTERACTIVE // Small messages at a fixed interval like input events.
+    };
+
+    struct Options
+    {
+        Pattern pattern = Pattern::BULK;
+        size_t message_size = 64 * 1024;
+        size_t frame_size = 64 * 1024;
+        std::chrono::microseconds interval { 33333 };
+    };
+
+    PeerPair(asio::io_context& io_context,
+             const asio::ip::tcp::endpoint& relay_endpoint,
+             const Options& options,
+             BenchCounters* counters);
+    ~PeerPair();
+
+    // Connects both peers to the relay and sends the authentication messages.
+    void connect(const base::ByteArray& first_message, const base::ByteArray& second_message);
+    void startTraffic();
+    void stop();
+
+    // Latencies of the received messages in microseconds.
+    const std::vector<uint32_t>& latencies() const { return latencies_; }
+
+private:
+    enum Side { SENDER = 0, RECEIVER = 1 };
+
+    void doConnect(int side);
+    void scheduleFrame();
+    void onFrameTimer();
+    void doWrite();
+    void doReadHeader();
+    void doReadBody(uint32_t size);
+    void onMessageReceived();
+    void onError(const char* operation, const std::error_code& error_code);
+
+    const asio::ip::tcp::endpoint relay_endpoint_;
+    const Options options_;
+    BenchCounters* counters_;
+
+    asio::ip::tcp::socket socket_[2];
+    base::ByteArray auth_message_[2];
+    uint32_t auth_message_size_[2] = { 0, 0 };
+
+    asio::high_resolution_timer timer_;
+    std::chrono::high_resolution_clock::time_point next_frame_time_;
+    uint64_t frame_number_ = 0;
+
+    // Sizes of the messages waiting to be sent.
+    std::deque<size_t> send_queue_;
+    bool is_writing_ = false;
+    bool is_stopped_ = false;
+    uint32_t send_sequence_ = 0;
+    base::ByteArray send_buffer_;
+
+    uint32_t receive_sequence_ = 0;
+    base::ByteArray receive_buffer_;
+    std::vector<uint32_t> latencies_;
+
+    DISALLOW_COPY_AND_ASSIGN(PeerPair);
+};
+
+} // namespace relay
+
+#endif // RELAY_BENCH_PEER_PAIR_H
@@ -20,46 +20,43 @@
 
 #include "base/logging.h"
 #include "base/task_runner.h"
+#include "base/metrics/metrics_registry.h"
 #include "base/net/tcp_server.h"
 #include "base/peer/client_authenticator.h"
+#include "base/strings/unicode.h"
 #include "proto/router_common.pb.h"
 #include "relay/settings.h"
 
+#include <algorithm>
+
 namespace relay {
 
 namespace {
 
 const std::chrono::seconds kReconnectTimeout{ 15 };
+const uint32_t kMaxWorkerCount = 256;
 
-class KeyDeleter
-{
-public:
-    KeyDeleter(std::unique_ptr<SharedPool> pool, uint32_t key_id)
-        : pool_(std::move(pool)),
-          key_id_(key_id)
-    {
-        DCHECK(pool_);
-    }
+// The router gave the key to the peers. They are required to use it within this time.
+const std::chrono::seconds kUsedKeyTimeout { 30 };
 
-    ~KeyDeleter() = default;
+// Keys that expire within this time after the first one are removed together.
+const std::chrono::seconds kUsedKeyBatchInterval { 1 };
 
-    void deleteKey()
-    {
-        pool_->setKeyExpired(key_id_);
-    }
-
-private:
-    std::unique_ptr<SharedPool> pool_;
-    const uint32_t key_id_;
+const std::chrono::minutes kMinPeerIdleTimeout { 1 };
+const std::chrono::minutes kMaxPeerIdleTimeout { 60 };
 
-    DISALLOW_COPY_AND_ASSIGN(KeyDeleter);
-};
+int64_t bytesPerSecond(uint32_t kbps)
+{
+    return static_cast<int64_t>(kbps) * 1000 / 8;
+}
 
 } // namespace
 
 Controller::Controller(std::shared_ptr<base::TaskRunner> task_runner)
     : task_runner_(task_runner),
       reconnect_timer_(base::WaitableTimer::Type::SINGLE_SHOT, task_runner),
+      used_key_timer_(base::WaitableTimer::Type::SINGLE_SHOT, task_runner),
+      drain_key_timer_(base::WaitableTimer::Type::SINGLE_SHOT, task_runner),
       shared_pool_(std::make_unique<SharedPool>(this)),
       incoming_message_(std::make_unique<proto::RouterToRelay>()),
       outgoing_message_(std::make_unique<proto::RelayToRouter>())
@@ -81,18 +78,40 @@ Controller::Controller(std::shared_ptr<base::TaskRunner> task_runner)
     listen_interface_ = settings.listenInterface();
     peer_address_ = settings.peerAddress();
     peer_port_ = settings.peerPort();
+    peer_udp_port_ = settings.peerUdpPort();
     peer_idle_timeout_ = settings.peerIdleTimeout();
     max_peer_count_ = settings.maxPeerCount();
     statistics_enabled_ = settings.isStatisticsEnabled();
     statistics_interval_ = settings.statisticsInterval();
+    zero_copy_enabled_ = settings.isZeroCopyEnabled();
+    peer_send_buffer_size_ = settings.peerSendBufferSize();
+    peer_receive_buffer_size_ = settings.peerReceiveBufferSize();
+    worker_count_ = settings.workerCount();
+    session_rate_limit_ = settings.sessionRateLimit();
+    total_rate_limit_ = settings.totalRateLimit();
+    max_pending_peers_ = settings.maxPendingPeers();
+    reject_peers_when_saturated_ = settings.isRejectPeersWhenSaturated();
+    metrics_interface_ = settings.metricsInterface();
+    metrics_port_ = settings.metricsPort();
 
     LOG(LS_INFO) << "Listen interface: " << listen_interface_;
     LOG(LS_INFO) << "Peer address: " << peer_address_;
     LOG(LS_INFO) << "Peer port: " << peer_port_;
+    LOG(LS_INFO) << "Peer UDP port: " << peer_udp_port_;
     LOG(LS_INFO) << "Peer idle timeout: " << peer_idle_timeout_.count();
     LOG(LS_INFO) << "Max peer count: " << max_peer_count_;
     LOG(LS_INFO) << "Statistics enabled: " << statistics_enabled_;
     LOG(LS_INFO) << "Statistics interval: " << statistics_interval_.count();
+    LOG(LS_INFO) << "Zero-copy enabled: " << zero_copy_enabled_;
+    LOG(LS_INFO) << "Peer send buffer size: " << peer_send_buffer_size_;
+    LOG(LS_INFO) << "Peer receive buffer size: " << peer_receive_buffer_size_;
+    LOG(LS_INFO) << "Worker count: " << worker_count_;
+    LOG(LS_INFO) << "Session rate limit: " << session_rate_limit_;
+    LOG(LS_INFO) << "Total rate limit: " << total_rate_limit_;
+    LOG(LS_INFO) << "Max pending peers: " << max_pending_peers_;
+    LOG(LS_INFO) << "Reject peers when saturated: " << reject_peers_when_saturated_;
+    LOG(LS_INFO) << "Metrics interface: " << metrics_interface_;
+    LOG(LS_INFO) << "Metrics port: " << metrics_port_;
 }
 
 Controller::~Controller()
@@ -140,7 +159,7 @@ bool Controller::start()
         return false;
     }
 
-    if (peer_idle_timeout_ < std::chrono::minutes(1) || peer_idle_timeout_ > std::chrono::minutes(60))
+    if (peer_idle_timeout_ < kMinPeerIdleTimeout || peer_idle_timeout_ > kMaxPeerIdleTimeout)
     {
         LOG(LS_WARNING) << "Invalid peer idle specified";
         return false;
@@ -152,9 +171,36 @@ bool Controller::start()
         return false;
     }
 
+    if (worker_count_ > kMaxWorkerCount)
+    {
+        LOG(LS_WARNING) << "Invalid worker count";
+        return false;
+    }
+
+    if (metrics_port_ != 0)
+    {
+        std::error_code error_code;
+        asio::ip::address metrics_address =
+            asio::ip::make_address(base::local8BitFromUtf16(metrics_interface_), error_code);
+        if (error_code)
+        {
+            LOG(LS_WARNING) << "Invalid metrics interface";
+            return false;
+        }
+
+        metrics_server_ = std::make_unique<base::MetricsServer>(metrics_address, metrics_port_);
+        if (!metrics_server_->start(this))
+            return false;
+    }
+
+    // The metrics endpoint needs the statistics of sessions even if they are not sent to the
+    // router.
     sessions_worker_ = std::make_unique<SessionsWorker>(
-        listen_interface_, peer_port_, peer_idle_timeout_, statistics_enabled_, statistics_interval_,
-        shared_pool_->share());
+        listen_interface_, peer_port_, peer_idle_timeout_,
+        statistics_enabled_ || metrics_server_ != nullptr, statistics_interval_,
+        zero_copy_enabled_, worker_count_, shared_pool_->share());
+    sessions_worker_->setUdpPort(peer_udp_port_);
+    applyPeerLimits();
     sessions_worker_->start(task_runner_, this);
 
     connectToRouter();
@@ -195,7 +241,14 @@ void Controller::onTcpConnected()
             // Now the session will receive incoming messages.
             channel_->resume();
 
-            sendKeyPool(max_peer_count_ - static_cast<uint32_t>(session_count_));
+            deferred_key_count_ = 0;
+
+            // Newer routers request the keys themselves when their pool runs low.
+            keys_on_request_ = authenticator_->peerVersion() >= base::Version(2, 7, 0);
+            if (is_draining_)
+                sendDrain();
+            else if (!keys_on_request_)
+                sendKeyPool(freeKeyCount());
         }
         else
         {
@@ -216,6 +269,8 @@ void Controller::onTcpDisconnected(base::NetworkChannel::ErrorCode error_code)
 
     // Clearing the key pool.
     shared_pool_->clear();
+    used_key_timer_.stop();
+    used_keys_.clear();
 
     // Retrying a connection at a time interval.
     delayedConnectToRouter();
@@ -233,13 +288,19 @@ void Controller::onTcpMessageReceived(uint8_t /* channel_id */, const base::Byte
 
     if (incoming_message_->has_key_used())
     {
-        std::shared_ptr<KeyDeleter> key_deleter =
-            std::make_shared<KeyDeleter>(shared_pool_->share(), incoming_message_->key_used().key_id());
+        // If the key is not used during the timeout, then it will be removed from the pool.
+        used_keys_.emplace_back(UsedKeyClock::now() + kUsedKeyTimeout,
+                                incoming_message_->key_used().key_id());
 
-        // The router gave the key to the peers. They are required to use it within 30 seconds.
-        // If it is not used during this time, then it will be removed from the pool.
-        task_runner_->postDelayedTask(
-            std::bind(&KeyDeleter::deleteKey, key_deleter), std::chrono::seconds(30));
+        if (!used_key_timer_.isActive())
+        {
+            used_key_timer_.start(kUsedKeyTimeout + kUsedKeyBatchInterval,
+                                  std::bind(&Controller::onUsedKeyTimer, this));
+        }
+    }
+    else if (incoming_message_->has_key_pool_request())
+    {
+        readKeyPoolRequest(incoming_message_->key_pool_request().key_count());
     }
     else if (incoming_message_->has_peer_connection_request())
     {
@@ -274,6 +335,12 @@ void Controller::onSessionStarted()
 
 void Controller::onSessionStatistics(const proto::RelayStat& relay_stat)
 {
+    last_relay_stat_.CopyFrom(relay_stat);
+
+    // The channel is missing while the relay is connecting to the router.
+    if (!statistics_enabled_ || !channel_)
+        return;
+
     outgoing_message_->Clear();
     outgoing_message_->mutable_relay_stat()->CopyFrom(relay_stat);
 
@@ -291,16 +358,123 @@ void Controller::onSessionFinished()
         session_count_ = 0;
     }
 
+    if (is_draining_)
+    {
+        checkDrainFinished();
+        return;
+    }
+
     // After disconnecting the peer, one key is released.
     // Add a new key to the pool and send it to the router.
-    sendKeyPool(1);
+    if (!keys_on_request_)
+    {
+        sendKeyPool(1);
+    }
+    else if (deferred_key_count_)
+    {
+        --deferred_key_count_;
+        sendKeyPool(1);
+    }
 }
 
 void Controller::onPoolKeyExpired(uint32_t /* key_id */)
 {
+    if (is_draining_)
+        return;
+
     // The key has expired and has been removed from the pool.
     // Add a new key to the pool and send it to the router.
-    sendKeyPool(1);
+    if (!keys_on_request_)
+    {
+        sendKeyPool(1);
+    }
+    else if (deferred_key_count_)
+    {
+        --deferred_key_count_;
+        sendKeyPool(1);
+    }
+}
+
+void Controller::drain(DrainCallback callback)
+{
+    if (is_draining_)
+        return;
+
+    LOG(LS_INFO) << "Draining (session count: " << session_count_ << ")";
+
+    is_draining_ = true;
+    drain_callback_ = std::move(callback);
+    deferred_key_count_ = 0;
+
+    sendDrain();
+
+    // The router could give out keys just before it received the notice. The peers use them
+    // within the same time as any other given keys.
+    drain_key_timer_.start(kUsedKeyTimeout + kUsedKeyBatchInterval,
+                           std::bind(&Controller::onDrainKeyTimer, this));
+}
+
+void Controller::reloadSettings()
+{
+    LOG(LS_INFO) << "Reloading settings";
+
+    Settings settings;
+
+    const std::chrono::minutes peer_idle_timeout = settings.peerIdleTimeout();
+    if (peer_idle_timeout < kMinPeerIdleTimeout || peer_idle_timeout > kMaxPeerIdleTimeout)
+    {
+        LOG(LS_WARNING) << "Invalid peer idle timeout: " << peer_idle_timeout.count()
+                        << " (previous value is kept)";
+    }
+    else
+    {
+        peer_idle_timeout_ = peer_idle_timeout;
+    }
+
+    max_peer_count_ = settings.maxPeerCount();
+    peer_send_buffer_size_ = settings.peerSendBufferSize();
+    peer_receive_buffer_size_ = settings.peerReceiveBufferSize();
+    session_rate_limit_ = settings.sessionRateLimit();
+    total_rate_limit_ = settings.totalRateLimit();
+    max_pending_peers_ = settings.maxPendingPeers();
+    reject_peers_when_saturated_ = settings.isRejectPeersWhenSaturated();
+
+    LOG(LS_INFO) << "Peer idle timeout: " << peer_idle_timeout_.count();
+    LOG(LS_INFO) << "Max peer count: " << max_peer_count_;
+    LOG(LS_INFO) << "Peer send buffer size: " << peer_send_buffer_size_;
+    LOG(LS_INFO) << "Peer receive buffer size: " << peer_receive_buffer_size_;
+    LOG(LS_INFO) << "Session rate limit: " << session_rate_limit_;
+    LOG(LS_INFO) << "Total rate limit: " << total_rate_limit_;
+    LOG(LS_INFO) << "Max pending peers: " << max_pending_peers_;
+    LOG(LS_INFO) << "Reject peers when saturated: " << reject_peers_when_saturated_;
+
+    if (!sessions_worker_)
+        return;
+
+    applyPeerLimits();
+
+    if (is_draining_ || !channel_ || !channel_->isConnected())
+        return;
+
+    // A higher peer limit gives keys which could not be sent before.
+    uint32_t key_count = freeKeyCount();
+    if (keys_on_request_)
+    {
+        key_count = std::min(key_count, deferred_key_count_);
+        deferred_key_count_ -= key_count;
+    }
+
+    if (key_count)
+        sendKeyPool(key_count);
+}
+
+std::string Controller::onMetricsRequest()
+{
+    if (!sessions_worker_)
+        return std::string();
+
+    return sessions_worker_->metrics().toPrometheusText(last_relay_stat_, session_count_) +
+        base::MetricsRegistry::global().toPrometheusText();
 }
 
 void Controller::connectToRouter()
@@ -315,12 +489,120 @@ void Controller::connectToRouter()
     channel_->connect(router_address_, router_port_);
 }
 
+void Controller::onUsedKeyTimer()
+{
+    const UsedKeyClock::time_point now = UsedKeyClock::now();
+    std::vector<uint32_t> expired_keys;
+
+    while (!used_keys_.empty() && used_keys_.front().first <= now)
+    {
+        expired_keys.emplace_back(used_keys_.front().second);
+        used_keys_.pop_front();
+    }
+
+    if (!used_keys_.empty())
+    {
+        used_key_timer_.start(
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                used_keys_.front().first - now) + kUsedKeyBatchInterval,
+            std::bind(&Controller::onUsedKeyTimer, this));
+    }
+
+    // Removing the keys can add new keys to the pool through the delegate.
+    shared_pool_->setKeysExpired(expired_keys);
+}
+
+void Controller::sendDrain()
+{
+    // The notice is sent after reconnecting if the router is not available now.
+    if (!channel_ || !channel_->isConnected())
+        return;
+
+    outgoing_message_->Clear();
+    outgoing_message_->mutable_relay_drain()->set_session_count(
+        static_cast<uint32_t>(session_count_));
+
+    // Send a message to the router.
+    channel_->send(proto::ROUTER_CHANNEL_ID_SESSION, base::serialize(*outgoing_message_));
+}
+
+void Controller::onDrainKeyTimer()
+{
+    LOG(LS_INFO) << "Removing unused keys (session count: " << session_count_ << ")";
+
+    is_drain_key_timeout_ = true;
+
+    used_key_timer_.stop();
+    used_keys_.clear();
+    shared_pool_->clear();
+
+    checkDrainFinished();
+}
+
+void Controller::checkDrainFinished()
+{
+    if (!is_drain_key_timeout_ || session_count_ > 0 || !drain_callback_)
+        return;
+
+    LOG(LS_INFO) << "All sessions are finished";
+
+    DrainCallback callback = std::move(drain_callback_);
+    drain_callback_ = nullptr;
+    callback();
+}
+
+void Controller::applyPeerLimits()
+{
+    sessions_worker_->setPeerIdleTimeout(peer_idle_timeout_);
+    sessions_worker_->setSocketBufferSizes(peer_send_buffer_size_, peer_receive_buffer_size_);
+    sessions_worker_->setAdmissionLimits(max_pending_peers_, reject_peers_when_saturated_);
+    sessions_worker_->setRateLimits(bytesPerSecond(session_rate_limit_),
+                                    bytesPerSecond(total_rate_limit_));
+}
+
 void Controller::delayedConnectToRouter()
 {
     LOG(LS_INFO) << "Reconnect after " << kReconnectTimeout.count() << " seconds";
     reconnect_timer_.start(kReconnectTimeout, std::bind(&Controller::connectToRouter, this));
 }
 
+void Controller::readKeyPoolRequest(uint32_t key_count)
+{
+    if (!keys_on_request_)
+    {
+        LOG(LS_WARNING) << "Unexpected key pool request";
+        return;
+    }
+
+    if (is_draining_)
+    {
+        LOG(LS_INFO) << "Key pool request ignored while draining: " << key_count;
+        return;
+    }
+
+    const uint32_t count = std::min(key_count, freeKeyCount());
+
+    LOG(LS_INFO) << "Key pool request: " << key_count << " (available: " << count << ")";
+
+    // The rest of the keys are sent when sessions finish or unused keys expire.
+    deferred_key_count_ += key_count - count;
+
+    if (count)
+        sendKeyPool(count);
+}
+
+uint32_t Controller::freeKeyCount() const
+{
+    // Keys in the pool are removed when a session starts, so the pool and the sessions together
+    // must not exceed the peer limit.
+    const uint64_t used_count =
+        static_cast<uint64_t>(session_count_) + shared_pool_->count();
+    if (used_count >= max_peer_count_)
+        return 0;
+
+    return max_peer_count_ - static_cast<uint32_t>(used_count);
+}
+
 void Controller::sendKeyPool(uint32_t key_count)
 {
     outgoing_message_->Clear();
@@ -329,6 +611,7 @@ void Controller::sendKeyPool(uint32_t key_count)
 
     relay_key_pool->set_peer_host(base::utf8FromUtf16(peer_address_));
     relay_key_pool->set_peer_port(peer_port_);
+    relay_key_pool->set_peer_udp_port(peer_udp_port_);
 
     // Add the requested number of keys to the pool.
     for (uint32_t i = 0; i < key_count; ++i)
@@ -20,12 +20,15 @@
 #define RELAY_CONTROLLER_H
 
 #include "base/waitable_timer.h"
+#include "base/net/metrics_server.h"
 #include "base/net/tcp_channel.h"
 #include "build/build_config.h"
 #include "proto/router_relay.pb.h"
 #include "relay/sessions_worker.h"
 #include "relay/shared_pool.h"
 
+#include <deque>
+
 namespace base {
 class ClientAuthenticator;
 } // namespace base
@@ -35,7 +38,8 @@ namespace relay {
 class Controller
     : public base::TcpChannel::Listener,
       public SessionManager::Delegate,
-      public SharedPool::Delegate
+      public SharedPool::Delegate,
+      public base::MetricsServer::Delegate
 {
 public:
     explicit Controller(std::shared_ptr<base::TaskRunner> task_runner);
@@ -43,6 +47,19 @@ public:
 
     bool start();
 
+    using DrainCallback = std::function<void()>;
+
+    // Stops taking new peers before the relay is stopped. The router is told to give out no more
+    // keys of the relay and the unused keys are removed after the peers had time to use the given
+    // ones. |callback| is called when the last session finishes.
+    void drain(DrainCallback callback);
+    bool isDraining() const { return is_draining_; }
+
+    // Reads the settings again and applies those which do not need a restart: the peer idle
+    // timeout, the maximum number of peers, the socket buffer sizes and the rate and admission
+    // limits.
+    void reloadSettings();
+
 protected:
     // base::TcpChannel::Listener implementation.
     void onTcpConnected() override;
@@ -58,10 +75,20 @@ protected:
     // SharedPool::Delegate implementation.
     void onPoolKeyExpired(uint32_t key_id) override;
 
+    // base::MetricsServer::Delegate implementation.
+    std::string onMetricsRequest() override;
+
 private:
     void connectToRouter();
     void delayedConnectToRouter();
     void sendKeyPool(uint32_t key_count);
+    void readKeyPoolRequest(uint32_t key_count);
+    uint32_t freeKeyCount() const;
+    void onUsedKeyTimer();
+    void sendDrain();
+    void onDrainKeyTimer();
+    void checkDrainFinished();
+    void applyPeerLimits();
 
     // Router settings.
     std::u16string router_address_;
@@ -72,23 +99,54 @@ private:
     std::u16string listen_interface_;
     std::u16string peer_address_;
     uint16_t peer_port_ = 0;
+    uint16_t peer_udp_port_ = 0;
     std::chrono::minutes peer_idle_timeout_;
     uint32_t max_peer_count_ = 0;
     bool statistics_enabled_ = false;
     std::chrono::seconds statistics_interval_;
+    bool zero_copy_enabled_ = false;
+    uint32_t peer_send_buffer_size_ = 0;
+    uint32_t peer_receive_buffer_size_ = 0;
+    uint32_t worker_count_ = 1;
+    uint32_t session_rate_limit_ = 0; // kbps
+    uint32_t total_rate_limit_ = 0; // kbps
+    uint32_t max_pending_peers_ = 0;
+    bool reject_peers_when_saturated_ = false;
+    std::u16string metrics_interface_;
+    uint16_t metrics_port_ = 0;
 
     std::shared_ptr<base::TaskRunner> task_runner_;
     base::WaitableTimer reconnect_timer_;
+    base::WaitableTimer used_key_timer_;
+    base::WaitableTimer drain_key_timer_;
     std::unique_ptr<base::TcpChannel> channel_;
     std::unique_ptr<base::ClientAuthenticator> authenticator_;
     std::unique_ptr<SharedPool> shared_pool_;
     std::unique_ptr<SessionsWorker> sessions_worker_;
+    std::unique_ptr<base::MetricsServer> metrics_server_;
+
+    // The last statistics of sessions for the metrics endpoint.
+    proto::RelayStat last_relay_stat_;
 
     std::unique_ptr<proto::RouterToRelay> incoming_message_;
     std::unique_ptr<proto::RelayToRouter> outgoing_message_;
 
     int session_count_ = 0;
 
+    // The router requests keys itself instead of receiving all of them after connecting.
+    bool keys_on_request_ = false;
+
+    // Keys requested by the router that could not be sent because of the peer limit.
+    uint32_t deferred_key_count_ = 0;
+
+    // Keys given to the peers by the router in the order of their expiry time.
+    using UsedKeyClock = std::chrono::steady_clock;
+    std::deque<std::pair<UsedKeyClock::time_point, uint32_t>> used_keys_;
+
+    bool is_draining_ = false;
+    bool is_drain_key_timeout_ = false;
+    DrainCallback drain_callback_;
+
     DISALLOW_COPY_AND_ASSIGN(Controller);
 };
 
@@ -29,7 +29,10 @@
 #else
 #include "base/crypto/scoped_crypto_initializer.h"
 #include "base/message_loop/message_loop.h"
+#include "base/message_loop/message_pump_asio.h"
 #include "relay/controller.h"
+
+#include <asio/signal_set.hpp>
 #endif
 
 #include <iostream>
@@ -146,6 +149,39 @@ int main(int argc, const char* const* argv)
             std::make_unique<relay::Controller>(message_loop->taskRunner());
 
         controller->start();
+
+        // On a stop signal the relay takes no new peers and quits when its sessions finish. The
+        // second stop signal quits at once. The settings are reloaded on SIGHUP.
+        std::shared_ptr<base::TaskRunner> task_runner = message_loop->taskRunner();
+        asio::signal_set signals(
+            message_loop->pumpAsio()->ioContext(), SIGINT, SIGTERM, SIGHUP);
+
+        std::function<void(const std::error_code&, int)> on_signal =
+            [&](const std::error_code& error_code, int signal)
+        {
+            if (error_code)
+                return;
+
+            if (signal == SIGHUP)
+            {
+                LOG(LS_INFO) << "Reload signal received";
+                controller->reloadSettings();
+            }
+            else if (!controller->isDraining())
+            {
+                LOG(LS_INFO) << "Stop signal received: " << signal;
+                controller->drain([task_runner]() { task_runner->postQuit(); });
+            }
+            else
+            {
+                LOG(LS_INFO) << "Second stop signal received: " << signal;
+                task_runner->postQuit();
+            }
+
+            signals.async_wait(on_signal);
+        };
+
+        signals.async_wait(on_signal);
         message_loop->run();
 
         controller.reset();
@@ -0,0 +1,171 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "relay/metrics.h"
+
+#include "base/metrics/prometheus_text.h"
+
+namespace relay {
+
+namespace {
+
+std::vector<uint64_t> latencyBounds()
+{
+    // From 50 microseconds to 5 seconds.
+    return { 50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+             1000000, 2500000, 5000000 };
+}
+
+std::vector<uint64_t> waitBounds()
+{
+    // From 10 milliseconds to 30 seconds, the timeout of pending sessions.
+    return { 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 20000, 30000 };
+}
+
+std::vector<uint64_t> occupancyBounds()
+{
+    return { 10, 20, 30, 40, 50, 60, 70, 80, 90, 100 };
+}
+
+void appendHeader(std::string* text, const char* name, const char* type, const char* help)
+{
+    base::appendPrometheusHeader(text, name, type, help);
+}
+
+void appendValue(std::string* text, const std::string& name, const std::string& labels,
+                 double value)
+{
+    base::appendPrometheusValue(text, name, labels, value);
+}
+
+// |scale| converts the values of the histogram to the unit of the metric.
+void appendHistogram(std::string* text, const char* name, const char* help,
+                     const Histogram& histogram, double scale)
+{
+    appendHeader(text, name, "histogram", help);
+    base::appendPrometheusHistogram(text, name, std::string_view(), histogram, scale);
+}
+
+} // namespace
+
+Metrics::Metrics()
+    : forward_latency_(latencyBounds()),
+      buffer_occupancy_(occupancyBounds()),
+      pairing_latency_(latencyBounds()),
+      peer_wait_time_(waitBounds())
+{
+    // Nothing
+}
+
+std::string Metrics::toPrometheusText(const proto::RelayStat& relay_stat, int session_count) const
+{
+    std::string text;
+
+    appendHeader(&text, "relay_uptime_seconds", "gauge", "Time since the sessions were started.");
+    appendValue(&text, "relay_uptime_seconds", std::string(),
+                static_cast<double>(relay_stat.uptime()));
+
+    appendHeader(&text, "relay_sessions", "gauge", "Number of active sessions.");
+    appendValue(&text, "relay_sessions", std::string(), static_cast<double>(session_count));
+
+    appendHeader(&text, "relay_total_rate_limit_bytes_per_second", "gauge",
+                 "Limit of the forwarding speed of all sessions, zero if not limited.");
+    appendValue(&text, "relay_total_rate_limit_bytes_per_second", std::string(),
+                static_cast<double>(relay_stat.total_rate_limit()));
+
+    appendHistogram(&text, "relay_forward_latency_seconds",
+                    "Time from reading data from one peer to writing it to the other.",
+                    forward_latency_, 0.000001);
+    appendHistogram(&text, "relay_buffer_occupancy_ratio",
+                    "Fill level of the forwarding buffer after a read.",
+                    buffer_occupancy_, 0.01);
+    appendHistogram(&text, "relay_pairing_latency_seconds",
+                    "Time from the connection of the second peer to the start of the session.",
+                    pairing_latency_, 0.000001);
+    appendHistogram(&text, "relay_peer_wait_seconds",
+                    "Time during which the first peer waited for the second one.",
+                    peer_wait_time_, 0.001);
+
+    struct SessionMetric
+    {
+        const char* name;
+        const char* type;
+        const char* help;
+        double (*value)(const proto::PeerConnection& peer_connection);
+    };
+
+    static const SessionMetric kSessionMetrics[] =
+    {
+        { "relay_session_transferred_bytes_total", "counter", "Bytes forwarded by the session.",
+          [](const proto::PeerConnection& peer_connection)
+          {
+              return static_cast<double>(peer_connection.bytes_transferred());
+          }
+        },
+        { "relay_session_throughput_bytes_per_second", "gauge",
+          "Forwarding speed over the last statistics interval.",
+          [](const proto::PeerConnection& peer_connection)
+          {
+              return static_cast<double>(peer_connection.throughput());
+          }
+        },
+        { "relay_session_read_stall_seconds_total", "counter",
+          "Time during which read data waited for the previous write to the opposite peer.",
+          [](const proto::PeerConnection& peer_connection)
+          {
+              return static_cast<double>(peer_connection.read_stall_time()) / 1000;
+          }
+        },
+        { "relay_session_write_stall_seconds_total", "counter",
+          "Time during which writes waited for the opposite peer to receive data.",
+          [](const proto::PeerConnection& peer_connection)
+          {
+              return static_cast<double>(peer_connection.write_stall_time()) / 1000;
+          }
+        },
+        { "relay_session_throttle_seconds_total", "counter",
+          "Time during which reads were delayed by the rate limit.",
+          [](const proto::PeerConnection& peer_connection)
+          {
+              return static_cast<double>(peer_connection.throttle_time()) / 1000;
+          }
+        },
+        { "relay_session_idle_seconds", "gauge", "Time since the last data transfer.",
+          [](const proto::PeerConnection& peer_connection)
+          {
+              return static_cast<double>(peer_connection.idle_time());
+          }
+        }
+    };
+
+    for (const SessionMetric& metric : kSessionMetrics)
+    {
+        appendHeader(&text, metric.name, metric.type, metric.help);
+
+        for (const auto& peer_connection : relay_stat.peer_connection())
+        {
+            appendValue(&text, metric.name,
+                        "session_id=\"" + std::to_string(peer_connection.session_id()) + "\"",
+                        metric.value(peer_connection));
+        }
+    }
+
+    return text;
+}
+
+} // namespace relay
@@ -0,0 +1,70 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef RELAY_METRICS_H
+#define RELAY_METRICS_H
+
+#include "base/macros_magic.h"
+#include "base/metrics/metrics.h"
+#include "proto/router_relay.pb.h"
+
+#include <string>
+
+namespace relay {
+
+using base::Histogram;
+
+// Measurements shared by the sessions of all workers.
+class Metrics
+{
+public:
+    Metrics();
+    ~Metrics() = default;
+
+    // Time from the end of a read from one peer to the end of the write to the other peer in
+    // microseconds.
+    Histogram& forwardLatency() { return forward_latency_; }
+    const Histogram& forwardLatency() const { return forward_latency_; }
+
+    // Fill level of the buffer after each read in percent.
+    Histogram& bufferOccupancy() { return buffer_occupancy_; }
+    const Histogram& bufferOccupancy() const { return buffer_occupancy_; }
+
+    // Time from the connection of the second peer to the start of the session in microseconds.
+    Histogram& pairingLatency() { return pairing_latency_; }
+    const Histogram& pairingLatency() const { return pairing_latency_; }
+
+    // Time during which the first peer waited for the second one in milliseconds.
+    Histogram& peerWaitTime() { return peer_wait_time_; }
+    const Histogram& peerWaitTime() const { return peer_wait_time_; }
+
+    // Formats the metrics and the statistics of sessions in the Prometheus text format.
+    std::string toPrometheusText(const proto::RelayStat& relay_stat, int session_count) const;
+
+private:
+    Histogram forward_latency_;
+    Histogram buffer_occupancy_;
+    Histogram pairing_latency_;
+    Histogram peer_wait_time_;
+
+    DISALLOW_COPY_AND_ASSIGN(Metrics);
+};
+
+} // namespace relay
+
+#endif // RELAY_METRICS_H
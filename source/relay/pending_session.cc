@@ -85,8 +85,15 @@ void PendingSession::stop()
 
 void PendingSession::setIdentify(uint32_t key_id, const base::ByteArray& secret)
 {
-    secret_ = secret;
     key_id_ = key_id;
+    pair_key_.clear();
+
+    if (secret.empty())
+        return;
+
+    pair_key_.reserve(sizeof(key_id) + secret.size());
+    pair_key_.append(reinterpret_cast<const char*>(&key_id), sizeof(key_id));
+    pair_key_.append(reinterpret_cast<const char*>(secret.data()), secret.size());
 }
 
 bool PendingSession::isPeerFor(const PendingSession& other) const
@@ -94,10 +101,10 @@ bool PendingSession::isPeerFor(const PendingSession& other) const
     if (&other == this)
         return false;
 
-    if (secret_.empty() || other.secret_.empty())
+    if (pair_key_.empty() || other.pair_key_.empty())
         return false;
 
-    return key_id_ == other.key_id_ && base::equals(secret_, other.secret_);
+    return pair_key_ == other.pair_key_;
 }
 
 asio::ip::tcp::socket PendingSession::takeSocket()
@@ -71,11 +71,16 @@ public:
     // Returns true if the other session is a pair and false otherwise.
     bool isPeerFor(const PendingSession& other) const;
 
+    // Returns the key by which the sessions of both peers are matched: the key identifier and the
+    // secret together. Empty if the credentials are not set.
+    const std::string& pairKey() const { return pair_key_; }
+
     // Releases a socket from a class.
     asio::ip::tcp::socket takeSocket();
 
     const std::string& address() const;
     std::chrono::seconds duration(const TimePoint& now) const;
+    const TimePoint& startTime() const { return start_time_; }
     uint32_t keyId() const;
 
 private:
@@ -93,7 +98,7 @@ private:
     uint32_t buffer_size_ = 0;
     base::ByteArray buffer_;
 
-    base::ByteArray secret_;
+    std::string pair_key_;
     uint32_t key_id_ = static_cast<uint32_t>(-1);
 
     DISALLOW_COPY_AND_ASSIGN(PendingSession);
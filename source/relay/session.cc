@@ -22,18 +22,51 @@
 #include "base/logging.h"
 #include "base/strings/unicode.h"
 #include "proto/relay_peer.pb.h"
+#include "relay/metrics.h"
 
 #include <asio/write.hpp>
 
+#include <algorithm>
+#include <atomic>
+
+#if defined(OS_LINUX)
+#include <fcntl.h>
+#include <unistd.h>
+#endif // defined(OS_LINUX)
+
 namespace relay {
 
+namespace {
+
+const size_t kMinBufferSize = 8 * 1024; // 8 kB
+const size_t kMaxBufferSize = 256 * 1024; // 256 kB
+
+// Size of the token bucket in time at the limited rate. The bucket is never smaller than
+// kMinBurstSize.
+const std::chrono::milliseconds kBurstTime { 100 };
+const int64_t kMinBurstSize = 64 * 1024; // 64 kB
+
+#if defined(OS_LINUX)
+const int kPipeSize = 256 * 1024; // 256 kB
+const unsigned int kSpliceFlags = SPLICE_F_MOVE | SPLICE_F_NONBLOCK;
+
+std::error_code lastError()
+{
+    return std::error_code(errno, std::system_category());
+}
+#endif // defined(OS_LINUX)
+
+} // namespace
+
 Session::Session(std::pair<asio::ip::tcp::socket, asio::ip::tcp::socket>&& sockets,
                  const base::ByteArray& secret)
-    : socket_{ std::move(sockets.first), std::move(sockets.second) }
+    : socket_{ std::move(sockets.first), std::move(sockets.second) },
+      throttle_timer_{ asio::high_resolution_timer(socket_[0].get_executor()),
+                       asio::high_resolution_timer(socket_[1].get_executor()) }
 {
-    static uint64_t session_id = 0;
-    ++session_id;
-    session_id_ = session_id;
+    // Sessions are created on several threads.
+    static std::atomic<uint64_t> session_id { 0 };
+    session_id_ = ++session_id;
 
     proto::PeerToRelay::Secret secret_message;
     if (secret_message.ParseFromArray(secret.data(), static_cast<int>(secret.size())))
@@ -42,24 +75,42 @@ Session::Session(std::pair<asio::ip::tcp::socket, asio::ip::tcp::socket>&& socke
         client_user_name_ = secret_message.client_user_name();
         host_address_ = secret_message.host_address();
         host_id_ = secret_message.host_id();
+        trace_id_ = secret_message.trace_id();
     }
 
     for (size_t i = 0; i < kNumberOfSides; ++i)
-        std::fill(buffer_[i].begin(), buffer_[i].end(), 0);
+        direction_[i].buffer_size = kMinBufferSize;
 }
 
 Session::~Session()
 {
     stop();
+
+#if defined(OS_LINUX)
+    closePipes();
+#endif // defined(OS_LINUX)
 }
 
-void Session::start(Delegate* delegate)
+void Session::start(Delegate* delegate, bool zero_copy)
 {
-    LOG(LS_INFO) << "Starting peers session";
+    LOG(LS_INFO) << "Starting peers session (trace: " << trace_id_ << ")";
 
     start_time_ = Clock::now();
+    throughput_time_ = start_time_;
+    last_activity_time_ = start_time_;
     delegate_ = delegate;
 
+#if defined(OS_LINUX)
+    if (zero_copy && initZeroCopy())
+    {
+        for (int i = 0; i < kNumberOfSides; ++i)
+            Session::doWaitRead(this, i);
+        return;
+    }
+#else
+    (void)zero_copy;
+#endif // defined(OS_LINUX)
+
     for (int i = 0; i < kNumberOfSides; ++i)
         Session::doReadSome(this, i);
 }
@@ -83,6 +134,7 @@ void Session::disconnect()
     {
         socket_[i].cancel(ignored_code);
         socket_[i].close(ignored_code);
+        throttle_timer_[i].cancel();
     }
 
     if (delegate_)
@@ -91,13 +143,10 @@ void Session::disconnect()
 
 std::chrono::seconds Session::idleTime(const TimePoint& current_time) const
 {
-    if (start_idle_time_ == TimePoint())
-    {
-        start_idle_time_ = current_time;
+    if (current_time <= last_activity_time_)
         return std::chrono::seconds(0);
-    }
 
-    return std::chrono::duration_cast<std::chrono::seconds>(current_time - start_idle_time_);
+    return std::chrono::duration_cast<std::chrono::seconds>(current_time - last_activity_time_);
 }
 
 std::chrono::seconds Session::duration(const TimePoint& current_time) const
@@ -105,40 +154,224 @@ std::chrono::seconds Session::duration(const TimePoint& current_time) const
     return std::chrono::duration_cast<std::chrono::seconds>(current_time - start_time_);
 }
 
+void Session::setRateLimit(int64_t bytes_per_second)
+{
+    if (bytes_per_second == rate_limit_)
+        return;
+
+    if (!rate_limit_)
+    {
+        // The bucket starts full.
+        tokens_ = 0;
+        tokens_time_ = TimePoint();
+    }
+
+    rate_limit_ = bytes_per_second;
+}
+
+std::chrono::milliseconds Session::throttleTime() const
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(throttle_time_);
+}
+
+int64_t Session::takePeriodBytes(bool* was_throttled)
+{
+    const int64_t bytes = period_bytes_;
+
+    if (was_throttled)
+        *was_throttled = period_throttled_;
+
+    period_bytes_ = 0;
+    period_throttled_ = false;
+    return bytes;
+}
+
+std::chrono::milliseconds Session::readStallTime() const
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(read_stall_time_);
+}
+
+std::chrono::milliseconds Session::writeStallTime() const
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(write_stall_time_);
+}
+
+int64_t Session::takeThroughput(const TimePoint& current_time)
+{
+    const double elapsed = std::chrono::duration<double>(current_time - throughput_time_).count();
+    const int64_t bytes = bytes_transferred_ - throughput_bytes_;
+
+    throughput_bytes_ = bytes_transferred_;
+    throughput_time_ = current_time;
+
+    if (elapsed <= 0)
+        return 0;
+
+    return static_cast<int64_t>(static_cast<double>(bytes) / elapsed);
+}
+
+bool Session::throttleRead(int source, ReadFunction resume)
+{
+    if (!rate_limit_)
+        return false;
+
+    const TimePoint now = Clock::now();
+    const double burst_size = std::max(
+        static_cast<double>(rate_limit_) * kBurstTime.count() / 1000, double(kMinBurstSize));
+
+    if (tokens_time_ == TimePoint())
+    {
+        tokens_ = burst_size;
+    }
+    else
+    {
+        const double elapsed = std::chrono::duration<double>(now - tokens_time_).count();
+        tokens_ = std::min(tokens_ + elapsed * static_cast<double>(rate_limit_), burst_size);
+    }
+
+    tokens_time_ = now;
+
+    if (tokens_ > 0)
+        return false;
+
+    // Wait until the balance becomes positive.
+    const std::chrono::microseconds delay(
+        static_cast<int64_t>(-tokens_ * 1000000 / static_cast<double>(rate_limit_)) + 1);
+
+    throttle_time_ += delay;
+    period_throttled_ = true;
+
+    throttle_timer_[source].expires_after(delay);
+    throttle_timer_[source].async_wait([this, source, resume](const std::error_code& error_code)
+    {
+        if (error_code)
+            return;
+
+        resume(this, source);
+    });
+
+    return true;
+}
+
+void Session::consumeTokens(size_t bytes)
+{
+    period_bytes_ += static_cast<int64_t>(bytes);
+
+    if (rate_limit_)
+        tokens_ -= static_cast<double>(bytes);
+}
+
 // static
 void Session::doReadSome(Session* session, int source)
 {
-    session->socket_[source].async_read_some(
-        asio::buffer(session->buffer_[source].data(), session->buffer_[source].size()),
+    if (session->throttleRead(source, &Session::doReadSome))
+        return;
+
+    Direction& direction = session->direction_[source];
+    base::ByteArray& buffer = direction.buffer[direction.read_index];
+
+    // The buffer being read is never being written, so it can be resized.
+    if (buffer.size() != direction.buffer_size)
+        buffer.resize(direction.buffer_size);
+
+    session->socket_[source].async_read_some(asio::buffer(buffer.data(), buffer.size()),
         [session, source](const std::error_code& error_code, size_t bytes_transferred)
     {
         if (error_code)
         {
             if (error_code != asio::error::operation_aborted)
                 session->onErrorOccurred(FROM_HERE, error_code);
+            return;
         }
-        else
-        {
-            session->bytes_transferred_ += bytes_transferred;
-            session->start_idle_time_ = TimePoint();
 
-            asio::async_write(
-                session->socket_[(source + kNumberOfSides - 1) % kNumberOfSides],
-                asio::const_buffer(session->buffer_[source].data(), bytes_transferred),
-                [session, source](const std::error_code& error_code, size_t /* bytes_transferred */)
-            {
-                if (error_code)
-                {
-                    if (error_code != asio::error::operation_aborted)
-                        session->onErrorOccurred(FROM_HERE, error_code);
-                }
-                else
-                {
-                    doReadSome(session, source);
-                }
-            });
+        session->onReadSome(source, bytes_transferred);
+    });
+}
+
+void Session::onReadSome(int source, size_t bytes_transferred)
+{
+    Direction& direction = direction_[source];
+    const size_t buffer_size = direction.buffer[direction.read_index].size();
+
+    bytes_transferred_ += bytes_transferred;
+    consumeTokens(bytes_transferred);
+
+    last_activity_time_ = Clock::now();
+    direction.read_time[direction.read_index] = last_activity_time_;
+
+    if (metrics_ && buffer_size)
+        metrics_->bufferOccupancy().add(bytes_transferred * 100 / buffer_size);
+
+    // If the read filled the whole buffer, then the peer sends faster than we read. The next
+    // reads use a larger buffer.
+    if (bytes_transferred == buffer_size)
+        direction.buffer_size = std::min(direction.buffer_size * 2, kMaxBufferSize);
+
+    if (direction.is_writing)
+    {
+        // The previous buffer is still being written. The data waits until the write completes
+        // and no new read is started until then.
+        direction.held_size = bytes_transferred;
+        return;
+    }
+
+    doWrite(source, bytes_transferred);
+}
+
+void Session::doWrite(int source, size_t size)
+{
+    Direction& direction = direction_[source];
+    const base::ByteArray& buffer = direction.buffer[direction.read_index];
+    const TimePoint read_time = direction.read_time[direction.read_index];
+
+    direction.is_writing = true;
+    direction.write_time = Clock::now();
+    direction.read_index ^= 1;
+
+    asio::async_write(socket_[(source + kNumberOfSides - 1) % kNumberOfSides],
+                      asio::const_buffer(buffer.data(), size),
+        [this, source, read_time](const std::error_code& error_code, size_t /* bytes_transferred */)
+    {
+        if (error_code)
+        {
+            if (error_code != asio::error::operation_aborted)
+                onErrorOccurred(FROM_HERE, error_code);
+            return;
         }
+
+        onWrite(source, read_time);
     });
+
+    // The next data is read into the other buffer while this one is written.
+    doReadSome(this, source);
+}
+
+void Session::onWrite(int source, const TimePoint& read_time)
+{
+    Direction& direction = direction_[source];
+    const TimePoint now = Clock::now();
+
+    direction.is_writing = false;
+    write_stall_time_ +=
+        std::chrono::duration_cast<std::chrono::microseconds>(now - direction.write_time);
+
+    if (metrics_)
+    {
+        metrics_->forwardLatency().add(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(now - read_time).count()));
+    }
+
+    if (!direction.held_size)
+        return;
+
+    // The held data was read into the buffer that is written next.
+    read_stall_time_ += std::chrono::duration_cast<std::chrono::microseconds>(
+        now - direction.read_time[direction.read_index]);
+
+    const size_t size = direction.held_size;
+    direction.held_size = 0;
+
+    doWrite(source, size);
 }
 
 void Session::onErrorOccurred(const base::Location& location, const std::error_code& error_code)
@@ -151,4 +384,173 @@ void Session::onErrorOccurred(const base::Location& location, const std::error_c
     stop();
 }
 
+#if defined(OS_LINUX)
+bool Session::initZeroCopy()
+{
+    for (int i = 0; i < kNumberOfSides; ++i)
+    {
+        int fds[2];
+        if (pipe2(fds, O_NONBLOCK | O_CLOEXEC) != 0)
+        {
+            LOG(LS_WARNING) << "pipe2 failed: " << base::utf16FromLocal8Bit(lastError().message());
+            closePipes();
+            return false;
+        }
+
+        pipe_[i].read_fd = fds[0];
+        pipe_[i].write_fd = fds[1];
+
+        // A larger pipe allows to move more data with one call. The default size is used if the
+        // system limit is lower.
+        fcntl(pipe_[i].write_fd, F_SETPIPE_SZ, kPipeSize);
+
+        // splice() blocks on the sockets unless they are in non-blocking mode.
+        std::error_code error_code;
+        socket_[i].native_non_blocking(true, error_code);
+        if (error_code)
+        {
+            LOG(LS_WARNING) << "Failed to set non-blocking mode: "
+                            << base::utf16FromLocal8Bit(error_code.message());
+            closePipes();
+            return false;
+        }
+    }
+
+    LOG(LS_INFO) << "Zero-copy forwarding enabled";
+    return true;
+}
+
+void Session::closePipes()
+{
+    for (int i = 0; i < kNumberOfSides; ++i)
+    {
+        if (pipe_[i].read_fd != -1)
+            close(pipe_[i].read_fd);
+        if (pipe_[i].write_fd != -1)
+            close(pipe_[i].write_fd);
+
+        pipe_[i] = Pipe();
+    }
+}
+
+// static
+void Session::doWaitRead(Session* session, int source)
+{
+    if (session->throttleRead(source, &Session::doWaitRead))
+        return;
+
+    session->socket_[source].async_wait(asio::ip::tcp::socket::wait_read,
+        [session, source](const std::error_code& error_code)
+    {
+        if (error_code)
+        {
+            if (error_code != asio::error::operation_aborted)
+                session->onErrorOccurred(FROM_HERE, error_code);
+            return;
+        }
+
+        session->onSpliceRead(source);
+    });
+}
+
+void Session::onSpliceRead(int source)
+{
+    Pipe& pipe = pipe_[source];
+    DCHECK_EQ(pipe.pending, 0U);
+
+    ssize_t result = splice(socket_[source].native_handle(), nullptr, pipe.write_fd, nullptr,
+                            kPipeSize, kSpliceFlags);
+    if (result < 0)
+    {
+        if (errno == EAGAIN || errno == EINTR)
+        {
+            doWaitRead(this, source);
+            return;
+        }
+
+        if (errno == EINVAL)
+        {
+            // The socket does not support splice(). The pipe is empty, so this direction can
+            // continue with the buffered forwarding.
+            LOG(LS_WARNING) << "splice is not supported, using buffered forwarding";
+            doReadSome(this, source);
+            return;
+        }
+
+        onErrorOccurred(FROM_HERE, lastError());
+        return;
+    }
+
+    if (result == 0)
+    {
+        onErrorOccurred(FROM_HERE, asio::error::eof);
+        return;
+    }
+
+    bytes_transferred_ += result;
+    consumeTokens(static_cast<size_t>(result));
+
+    if (metrics_)
+        metrics_->bufferOccupancy().add(static_cast<uint64_t>(result) * 100 / kPipeSize);
+
+    last_activity_time_ = Clock::now();
+    pipe.read_time = last_activity_time_;
+    pipe.pending = static_cast<size_t>(result);
+    doSpliceWrite(source);
+}
+
+void Session::doSpliceWrite(int source)
+{
+    Pipe& pipe = pipe_[source];
+    const int target = (source + kNumberOfSides - 1) % kNumberOfSides;
+
+    while (pipe.pending)
+    {
+        ssize_t result = splice(pipe.read_fd, nullptr, socket_[target].native_handle(), nullptr,
+                                pipe.pending, kSpliceFlags);
+        if (result < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            if (errno != EAGAIN)
+            {
+                onErrorOccurred(FROM_HERE, lastError());
+                return;
+            }
+
+            // The send buffer of the opposite socket is full.
+            pipe.wait_time = Clock::now();
+            socket_[target].async_wait(asio::ip::tcp::socket::wait_write,
+                [this, source](const std::error_code& error_code)
+            {
+                if (error_code)
+                {
+                    if (error_code != asio::error::operation_aborted)
+                        onErrorOccurred(FROM_HERE, error_code);
+                    return;
+                }
+
+                write_stall_time_ += std::chrono::duration_cast<std::chrono::microseconds>(
+                    Clock::now() - pipe_[source].wait_time);
+
+                doSpliceWrite(source);
+            });
+            return;
+        }
+
+        pipe.pending -= static_cast<size_t>(result);
+    }
+
+    if (metrics_)
+    {
+        metrics_->forwardLatency().add(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                Clock::now() - pipe.read_time).count()));
+    }
+
+    doWaitRead(this, source);
+}
+#endif // defined(OS_LINUX)
+
 } // namespace relay
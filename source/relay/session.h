@@ -22,7 +22,9 @@
 #include "base/macros_magic.h"
 #include "base/memory/byte_array.h"
 #include "base/peer/host_id.h"
+#include "build/build_config.h"
 
+#include <asio/high_resolution_timer.hpp>
 #include <asio/ip/tcp.hpp>
 
 namespace base {
@@ -31,6 +33,8 @@ class Location;
 
 namespace relay {
 
+class Metrics;
+
 class Session
 {
 public:
@@ -49,7 +53,14 @@ public:
         virtual void onSessionFinished(Session* session) = 0;
     };
 
-    void start(Delegate* delegate);
+    // If |zero_copy| is true and the platform supports it, then the data is forwarded between the
+    // sockets inside the kernel. Otherwise the data is copied through the buffers of the session.
+    void start(Delegate* delegate, bool zero_copy = false);
+
+    // The forwarding latency and the buffer occupancy are added to |metrics| if it is set. Must be
+    // called before start().
+    void setMetrics(Metrics* metrics) { metrics_ = metrics; }
+
     void stop();
     void disconnect();
 
@@ -58,29 +69,117 @@ public:
     const std::string& clientUserName() const { return client_user_name_; }
     const std::string& hostAddress() const { return host_address_; }
     base::HostId hostId() const { return host_id_; }
+    uint64_t traceId() const { return trace_id_; }
     std::chrono::seconds idleTime(const TimePoint& current_time) const;
+
+    // Time of the last data read from any of the peers or the start time of the session.
+    const TimePoint& lastActivityTime() const { return last_activity_time_; }
     std::chrono::seconds duration(const TimePoint& current_time) const;
     int64_t bytesTransferred() const { return bytes_transferred_; }
 
+    // Limits the forwarding speed of the session in both directions together. Zero means no
+    // limit.
+    void setRateLimit(int64_t bytes_per_second);
+    int64_t rateLimit() const { return rate_limit_; }
+
+    // Total time during which reads were delayed by the rate limit.
+    std::chrono::milliseconds throttleTime() const;
+
+    // Returns the number of bytes transferred since the previous call and whether the session was
+    // delayed by the rate limit during this time.
+    int64_t takePeriodBytes(bool* was_throttled);
+
+    // Total time during which read data waited for the previous write to the opposite peer.
+    std::chrono::milliseconds readStallTime() const;
+
+    // Total time during which writes waited for the opposite peer to receive data.
+    std::chrono::milliseconds writeStallTime() const;
+
+    // Returns the average forwarding speed in bytes per second since the previous call or since
+    // the start of the session.
+    int64_t takeThroughput(const TimePoint& current_time);
+
 private:
+    using ReadFunction = void(*)(Session* session, int source);
+
+    bool throttleRead(int source, ReadFunction resume);
+    void consumeTokens(size_t bytes);
+
     static void doReadSome(Session* session, int source);
+    void onReadSome(int source, size_t bytes_transferred);
+    void doWrite(int source, size_t size);
+    void onWrite(int source, const TimePoint& read_time);
     void onErrorOccurred(const base::Location& location, const std::error_code& error_code);
 
+#if defined(OS_LINUX)
+    bool initZeroCopy();
+    void closePipes();
+    static void doWaitRead(Session* session, int source);
+    void onSpliceRead(int source);
+    void doSpliceWrite(int source);
+#endif // defined(OS_LINUX)
+
     uint64_t session_id_ = 0;
     std::string client_address_;
     std::string client_user_name_;
     std::string host_address_;
     base::HostId host_id_ = base::kInvalidHostId;
+    uint64_t trace_id_ = 0;
 
     TimePoint start_time_;
-    mutable TimePoint start_idle_time_;
+    TimePoint last_activity_time_;
     int64_t bytes_transferred_ = 0;
 
     static const int kNumberOfSides = 2;
-    static const int kBufferSize = 8192;
 
     asio::ip::tcp::socket socket_[kNumberOfSides];
-    std::array<uint8_t, kBufferSize> buffer_[kNumberOfSides];
+
+    // Token bucket of the rate limit. Tokens are bytes, the balance can become negative after a
+    // large read. A read is delayed until the balance is positive again.
+    asio::high_resolution_timer throttle_timer_[kNumberOfSides];
+    int64_t rate_limit_ = 0;
+    double tokens_ = 0;
+    TimePoint tokens_time_;
+    std::chrono::microseconds throttle_time_ { 0 };
+    int64_t period_bytes_ = 0;
+    bool period_throttled_ = false;
+
+    Metrics* metrics_ = nullptr;
+    std::chrono::microseconds read_stall_time_ { 0 };
+    std::chrono::microseconds write_stall_time_ { 0 };
+    int64_t throughput_bytes_ = 0;
+    TimePoint throughput_time_;
+
+    // Data read from the socket of the side is forwarded to the opposite socket. While one buffer
+    // is being written, the next data is read into the other one. The buffers grow when reads
+    // fill them completely.
+    struct Direction
+    {
+        base::ByteArray buffer[2];
+        int read_index = 0;
+        size_t buffer_size = 0;
+        bool is_writing = false;
+        size_t held_size = 0;
+        TimePoint read_time[2];
+        TimePoint write_time;
+    };
+
+    Direction direction_[kNumberOfSides];
+
+#if defined(OS_LINUX)
+    // Pipe for each direction. The data read from the socket of the side is kept in the pipe until
+    // it is written to the opposite socket.
+    struct Pipe
+    {
+        int read_fd = -1;
+        int write_fd = -1;
+        size_t pending = 0;
+        TimePoint read_time;
+        TimePoint wait_time;
+    };
+
+    Pipe pipe_[kNumberOfSides];
+#endif // defined(OS_LINUX)
 
     Delegate* delegate_ = nullptr;
 
@@ -24,12 +24,17 @@
 #include "base/message_loop/message_pump_asio.h"
 #include "base/crypto/message_decryptor_openssl.h"
 #include "base/strings/unicode.h"
+#include "relay/metrics.h"
+
+#include <algorithm>
+#include <limits>
 
 namespace relay {
 
 namespace {
 
 const std::chrono::minutes kIdleTimerInterval { 1 };
+const std::chrono::seconds kRateTimerInterval { 1 };
 
 // Decrypts an encrypted pair of peer identifiers using key |session_key|.
 base::ByteArray decryptSecret(const proto::PeerToRelay& message, const SharedPool::Key& key)
@@ -67,31 +72,6 @@ base::ByteArray decryptSecret(const proto::PeerToRelay& message, const SharedPoo
     return target;
 }
 
-// Removes a session from the list and returns a pointer to it.
-template<class T>
-std::unique_ptr<T> removeSessionT(std::vector<std::unique_ptr<T>>* session_list, T* session)
-{
-    session->stop();
-
-    auto it = session_list->begin();
-    while (it != session_list->end())
-    {
-        if (it->get() == session)
-            break;
-
-        ++it;
-    }
-
-    if (it != session_list->end())
-    {
-        std::unique_ptr<T> result = std::move(*it);
-        session_list->erase(it);
-        return result;
-    }
-
-    return nullptr;
-}
-
 } // namespace
 
 SessionManager::SessionManager(std::shared_ptr<base::TaskRunner> task_runner,
@@ -99,18 +79,34 @@ SessionManager::SessionManager(std::shared_ptr<base::TaskRunner> task_runner,
                                uint16_t port,
                                const std::chrono::minutes& idle_timeout,
                                bool statistics_enabled,
-                               const std::chrono::seconds& statistics_interval)
+                               const std::chrono::seconds& statistics_interval,
+                               bool zero_copy)
     : task_runner_(std::move(task_runner)),
-      acceptor_(base::MessageLoop::current()->pumpAsio()->ioContext(),
-                asio::ip::tcp::endpoint(listen_address, port)),
+      listen_address_(listen_address),
+      acceptor_(base::MessageLoop::current()->pumpAsio()->ioContext()),
       idle_timeout_(idle_timeout),
       idle_timer_(base::MessageLoop::current()->pumpAsio()->ioContext()),
       stat_timer_(base::MessageLoop::current()->pumpAsio()->ioContext()),
+      rate_timer_(base::MessageLoop::current()->pumpAsio()->ioContext()),
       statistics_enabled_(statistics_enabled),
-      statistics_interval_(statistics_interval)
+      statistics_interval_(statistics_interval),
+      zero_copy_(zero_copy)
 {
     DCHECK(task_runner_);
 
+    if (!port)
+    {
+        LOG(LS_INFO) << "Session manager without listening";
+        return;
+    }
+
+    asio::ip::tcp::endpoint endpoint(listen_address, port);
+
+    acceptor_.open(endpoint.protocol());
+    acceptor_.set_option(asio::ip::tcp::acceptor::reuse_address(true));
+    acceptor_.bind(endpoint);
+    acceptor_.listen();
+
     LOG(LS_INFO) << "Session manager port: " << port;
 }
 
@@ -120,6 +116,7 @@ SessionManager::~SessionManager()
     acceptor_.cancel(ignored_code);
     acceptor_.close(ignored_code);
     idle_timer_.cancel();
+    rate_timer_.cancel();
 }
 
 void SessionManager::start(std::unique_ptr<SharedPool> shared_pool, Delegate* delegate)
@@ -142,23 +139,110 @@ void SessionManager::start(std::unique_ptr<SharedPool> shared_pool, Delegate* de
         stat_timer_.async_wait(std::bind(&SessionManager::doStatTimeout, this, std::placeholders::_1));
     }
 
-    SessionManager::doAccept(this);
+    if (total_rate_limit_)
+        startRateTimer();
+
+    if (acceptor_.is_open())
+        SessionManager::doAccept(this);
+
+    if (udp_port_)
+    {
+        udp_relay_ = std::make_unique<UdpRelay>(listen_address_, udp_port_, idle_timeout_);
+        if (!udp_relay_->start(this))
+            udp_relay_.reset();
+    }
 }
 
-void SessionManager::disconnectSession(uint64_t session_id)
+void SessionManager::setIdleTimeout(const std::chrono::minutes& idle_timeout)
 {
-    LOG(LS_INFO) << "Disconnect session by session id: " << session_id;
+    idle_timeout_ = idle_timeout;
 
-    for (const auto& session : active_sessions_)
+    // The sessions are checked against the new timeout at the next run of the idle timer.
+    if (udp_relay_)
+        udp_relay_->setIdleTimeout(idle_timeout_);
+}
+
+void SessionManager::setSocketBufferSizes(uint32_t send_size, uint32_t receive_size)
+{
+    send_buffer_size_ = send_size;
+    receive_buffer_size_ = receive_size;
+}
+
+void SessionManager::setRateLimits(int64_t session_limit, int64_t total_limit)
+{
+    session_rate_limit_ = std::max(session_limit, int64_t(0));
+    total_rate_limit_ = std::max(total_limit, int64_t(0));
+
+    // Not started yet.
+    if (!delegate_)
+        return;
+
+    if (total_rate_limit_)
     {
-        if (session->sessionId() == session_id)
-        {
-            session->disconnect();
-            return;
-        }
+        // The shares of the running sessions are recalculated at once.
+        distributeRateLimit();
+
+        if (!is_rate_timer_active_)
+            startRateTimer();
+        return;
     }
 
-    LOG(LS_WARNING) << "Session with id " << session_id << " not found";
+    // The rate timer stops by itself without the total limit.
+    is_rate_saturated_ = false;
+
+    for (auto& active_session : active_sessions_)
+        active_session.second.session->setRateLimit(session_rate_limit_);
+}
+
+void SessionManager::setAdmissionLimits(size_t max_pending_sessions, bool reject_when_saturated)
+{
+    max_pending_sessions_ = max_pending_sessions;
+    reject_when_saturated_ = reject_when_saturated;
+}
+
+void SessionManager::setMetrics(Metrics* metrics)
+{
+    metrics_ = metrics;
+}
+
+void SessionManager::setUdpPort(uint16_t port)
+{
+    udp_port_ = port;
+}
+
+void SessionManager::startSession(SocketPair&& sockets, const base::ByteArray& secret)
+{
+    for (asio::ip::tcp::socket* socket : { &sockets.first, &sockets.second })
+        applySocketBufferSizes(socket);
+
+    const int64_t rate_limit = initialRateLimit();
+
+    std::unique_ptr<Session> session = std::make_unique<Session>(std::move(sockets), secret);
+    Session* session_ptr = session.get();
+    const uint64_t session_id = session->sessionId();
+
+    session->setRateLimit(rate_limit);
+    session->setMetrics(metrics_);
+
+    ActiveSession& active_session = active_sessions_[session_id];
+    active_session.session = std::move(session);
+    active_session.idle_entry = idle_queue_.emplace(Session::Clock::now(), session_id);
+
+    session_ptr->start(this, zero_copy_);
+
+    if (delegate_)
+        delegate_->onSessionStarted();
+}
+
+bool SessionManager::disconnectSession(uint64_t session_id)
+{
+    auto it = active_sessions_.find(session_id);
+    if (it == active_sessions_.end())
+        return false;
+
+    LOG(LS_INFO) << "Disconnect session by session id: " << session_id;
+    it->second.session->disconnect();
+    return true;
 }
 
 void SessionManager::onPendingSessionReady(
@@ -177,32 +261,47 @@ void SessionManager::onPendingSessionReady(
             // Save the identifiers of peers and the identifier of their shared key.
             session->setIdentify(message.key_id(), secret);
 
+            const PendingSession::TimePoint now = PendingSession::Clock::now();
+
             // Trying to find a peer that wants to be connected.
-            for (auto& other_session : pending_sessions_)
+            auto waiting_peer = waiting_peers_.find(session->pairKey());
+            if (waiting_peer == waiting_peers_.end())
+            {
+                LOG(LS_INFO) << "Second peer has not connected yet";
+                waiting_peers_.emplace(session->pairKey(), WaitingPeer{ session, now });
+                return;
+            }
+
+            PendingSession* other_session = waiting_peer->second.session;
+            DCHECK(session->isPeerFor(*other_session));
+
+            const int64_t peer_wait_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+                now - waiting_peer->second.ready_time).count();
+
+            LOG(LS_INFO) << "Both peers are connected with key " << message.key_id()
+                         << " (peer wait: " << peer_wait_time << "ms)";
+
+            if (metrics_)
             {
-                if (session->isPeerFor(*other_session))
-                {
-                    LOG(LS_INFO) << "Both peers are connected with key " << message.key_id();
-
-                    // Delete the key from the pool. It can no longer be used.
-                    shared_pool_->removeKey(message.key_id());
-
-                    // Now the opposite peer is found, start the data transfer between them.
-                    active_sessions_.emplace_back(std::make_unique<Session>(
-                        std::make_pair(session->takeSocket(), other_session->takeSocket()), secret));
-                    active_sessions_.back()->start(this);
-
-                    if (delegate_)
-                        delegate_->onSessionStarted();
-
-                    // Pending sessions are no longer needed, remove them.
-                    removePendingSession(other_session.get());
-                    removePendingSession(session);
-                    return;
-                }
+                metrics_->pairingLatency().add(static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::microseconds>(
+                        now - session->startTime()).count()));
+                metrics_->peerWaitTime().add(static_cast<uint64_t>(peer_wait_time));
             }
 
-            LOG(LS_INFO) << "Second peer has not connected yet";
+            // Delete the key from the pool. It can no longer be used.
+            shared_pool_->removeKey(message.key_id());
+
+            // Now the opposite peer is found, start the data transfer between them.
+            SocketPair sockets =
+                std::make_pair(session->takeSocket(), other_session->takeSocket());
+
+            if (!delegate_ || !delegate_->dispatchSession(&sockets, secret))
+                startSession(std::move(sockets), secret);
+
+            // Pending sessions are no longer needed, remove them.
+            removePendingSession(other_session);
+            removePendingSession(session);
             return;
         }
         else
@@ -229,21 +328,62 @@ void SessionManager::onSessionFinished(Session* session)
     removeSession(session);
 }
 
+base::ByteArray SessionManager::udpPeerSecret(const proto::PeerToRelay& message)
+{
+    std::optional<SharedPool::Key> key = shared_pool_->key(message.key_id(), message.public_key());
+    if (!key.has_value())
+    {
+        LOG(LS_WARNING) << "Key with id " << message.key_id() << " NOT found!";
+        return base::ByteArray();
+    }
+
+    return decryptSecret(message, *key);
+}
+
+void SessionManager::onUdpSessionStarted(uint32_t key_id)
+{
+    // Delete the key from the pool. It can no longer be used.
+    shared_pool_->removeKey(key_id);
+
+    if (delegate_)
+        delegate_->onSessionStarted();
+}
+
+void SessionManager::onUdpSessionFinished()
+{
+    if (delegate_)
+        delegate_->onSessionFinished();
+}
+
 // static
 void SessionManager::doAccept(SessionManager* self)
 {
     self->acceptor_.async_accept(
         [self](const std::error_code& error_code, asio::ip::tcp::socket socket)
     {
-        if (!error_code)
+        if (!error_code && self->admissionError())
+        {
+            LOG(LS_WARNING) << "Connection rejected: " << self->admissionError();
+
+            // The peer gets a reset at once instead of waiting for the timeout of authentication.
+            std::error_code ignored_code;
+            socket.set_option(asio::socket_base::linger(true, 0), ignored_code);
+            socket.close(ignored_code);
+
+            ++self->rejected_peers_;
+        }
+        else if (!error_code)
         {
             LOG(LS_INFO) << "New accepted connection: " << base::utf16FromLocal8Bit(
                 socket.remote_endpoint().address().to_string());
 
             // A new peer is connected. Create and start the pending session.
-            self->pending_sessions_.emplace_back(std::make_unique<PendingSession>(
-                self->task_runner_, std::move(socket), self));
-            self->pending_sessions_.back()->start();
+            std::unique_ptr<PendingSession> session = std::make_unique<PendingSession>(
+                self->task_runner_, std::move(socket), self);
+            PendingSession* session_ptr = session.get();
+
+            self->pending_sessions_.emplace(session_ptr, std::move(session));
+            session_ptr->start();
         }
         else
         {
@@ -272,20 +412,32 @@ void SessionManager::doIdleTimeoutImpl(const std::error_code& error_code)
 {
     if (!error_code)
     {
-        auto current_time = Session::Clock::now();
-        auto it = active_sessions_.begin();
+        const Session::TimePoint current_time = Session::Clock::now();
+        const Session::TimePoint expire_time = current_time - idle_timeout_;
         int count = 0;
 
-        while (it != active_sessions_.end())
+        // Sessions with entries after |expire_time| were active recently and are not checked.
+        while (!idle_queue_.empty() && idle_queue_.begin()->first <= expire_time)
         {
-            if ((*it)->idleTime(current_time) >= idle_timeout_)
+            const uint64_t session_id = idle_queue_.begin()->second;
+            idle_queue_.erase(idle_queue_.begin());
+
+            auto it = active_sessions_.find(session_id);
+            if (it == active_sessions_.end())
+                continue;
+
+            Session* session = it->second.session.get();
+            if (session->lastActivityTime() <= expire_time)
             {
-                it = active_sessions_.erase(it);
+                it->second.idle_entry = idle_queue_.end();
+                removeSession(session);
                 ++count;
             }
             else
             {
-                ++it;
+                // The session was active since the previous check.
+                it->second.idle_entry =
+                    idle_queue_.emplace(session->lastActivityTime(), session_id);
             }
         }
 
@@ -332,8 +484,9 @@ void SessionManager::collectAndSendStatistics()
     relay_stat.set_uptime(
         std::chrono::duration_cast<std::chrono::seconds>(now - start_time_).count());
 
-    for (const auto& session : active_sessions_)
+    for (const auto& active_session : active_sessions_)
     {
+        Session* session = active_session.second.session.get();
         proto::PeerConnection* peer_connection = relay_stat.add_peer_connection();
 
         peer_connection->set_session_id(session->sessionId());
@@ -345,20 +498,219 @@ void SessionManager::collectAndSendStatistics()
         peer_connection->set_bytes_transferred(session->bytesTransferred());
         peer_connection->set_idle_time(session->idleTime(now).count());
         peer_connection->set_duration(session->duration(now).count());
+        peer_connection->set_rate_limit(session->rateLimit());
+        peer_connection->set_throttle_time(session->throttleTime().count());
+        peer_connection->set_throughput(session->takeThroughput(now));
+        peer_connection->set_read_stall_time(session->readStallTime().count());
+        peer_connection->set_write_stall_time(session->writeStallTime().count());
     }
 
+    relay_stat.set_total_rate_limit(total_rate_limit_);
+    relay_stat.set_rejected_peers(rejected_peers_);
+    rejected_peers_ = 0;
+
     if (delegate_)
         delegate_->onSessionStatistics(relay_stat);
 }
 
+// static
+void SessionManager::doRateTimeout(SessionManager* self, const std::error_code& error_code)
+{
+    if (error_code == asio::error::operation_aborted)
+        return;
+
+    // The total limit was removed.
+    if (!self->total_rate_limit_)
+    {
+        self->is_rate_timer_active_ = false;
+        return;
+    }
+
+    if (!error_code)
+    {
+        self->distributeRateLimit();
+    }
+    else
+    {
+        LOG(LS_ERROR) << "Error in rate timer: " << base::utf16FromLocal8Bit(error_code.message());
+    }
+
+    self->startRateTimer();
+}
+
+void SessionManager::startRateTimer()
+{
+    is_rate_timer_active_ = true;
+
+    rate_timer_.expires_after(kRateTimerInterval);
+    rate_timer_.async_wait(
+        std::bind(&SessionManager::doRateTimeout, this, std::placeholders::_1));
+}
+
+void SessionManager::distributeRateLimit()
+{
+    is_rate_saturated_ = false;
+
+    if (active_sessions_.empty())
+        return;
+
+    struct Demand
+    {
+        Session* session;
+        int64_t rate; // Bytes per second, std::numeric_limits<int64_t>::max() if unknown.
+    };
+
+    const double interval = std::chrono::duration<double>(kRateTimerInterval).count();
+    const int64_t kUnlimited = std::numeric_limits<int64_t>::max();
+
+    std::vector<Demand> demands;
+    demands.reserve(active_sessions_.size());
+
+    for (const auto& active_session : active_sessions_)
+    {
+        Session* session = active_session.second.session.get();
+        bool was_throttled = false;
+        int64_t rate = static_cast<int64_t>(
+            static_cast<double>(session->takePeriodBytes(&was_throttled)) / interval);
+
+        // A throttled session could use more than it got.
+        if (was_throttled)
+            rate = kUnlimited;
+
+        if (session_rate_limit_)
+            rate = std::min(rate, session_rate_limit_);
+
+        demands.push_back({ session, rate });
+    }
+
+    // Max-min fair share: sessions with the smallest demand are satisfied first, the remaining
+    // capacity is divided equally between the others.
+    std::sort(demands.begin(), demands.end(), [](const Demand& first, const Demand& second)
+    {
+        return first.rate < second.rate;
+    });
+
+    // The new peers can be rejected while the sessions would use all of the limit.
+    int64_t total_demand = 0;
+    for (const Demand& demand : demands)
+    {
+        if (demand.rate >= kUnlimited - total_demand)
+            total_demand = kUnlimited;
+        else
+            total_demand += demand.rate;
+    }
+
+    is_rate_saturated_ = total_demand >= total_rate_limit_;
+
+    int64_t remaining = total_rate_limit_;
+    size_t count = demands.size();
+
+    for (const Demand& demand : demands)
+    {
+        const int64_t equal_share = remaining / static_cast<int64_t>(count);
+        int64_t share = std::min(demand.rate, equal_share);
+
+        remaining -= share;
+        --count;
+
+        // Idle sessions keep a part of the equal share so that they can start sending without
+        // waiting for the next distribution. The unused capacity is given to the last sessions.
+        if (count)
+            share = std::max(share, equal_share / static_cast<int64_t>(demands.size()));
+        else
+            share += remaining;
+
+        if (session_rate_limit_)
+            share = std::min(share, session_rate_limit_);
+
+        demand.session->setRateLimit(std::max(share, int64_t(1)));
+    }
+}
+
+int64_t SessionManager::initialRateLimit() const
+{
+    if (!total_rate_limit_)
+        return session_rate_limit_;
+
+    const int64_t share = std::max(
+        total_rate_limit_ / static_cast<int64_t>(active_sessions_.size() + 1), int64_t(1));
+
+    if (!session_rate_limit_)
+        return share;
+
+    return std::min(share, session_rate_limit_);
+}
+
+const char* SessionManager::admissionError() const
+{
+    if (max_pending_sessions_ && pending_sessions_.size() >= max_pending_sessions_)
+        return "too many pending peers";
+
+    if (reject_when_saturated_ && is_rate_saturated_)
+        return "total rate limit is reached";
+
+    return nullptr;
+}
+
+void SessionManager::applySocketBufferSizes(asio::ip::tcp::socket* socket) const
+{
+    std::error_code error_code;
+
+    if (send_buffer_size_)
+    {
+        socket->set_option(asio::socket_base::send_buffer_size(
+            static_cast<int>(send_buffer_size_)), error_code);
+        if (error_code)
+        {
+            LOG(LS_WARNING) << "Failed to set send buffer size: "
+                            << base::utf16FromLocal8Bit(error_code.message());
+        }
+    }
+
+    if (receive_buffer_size_)
+    {
+        socket->set_option(asio::socket_base::receive_buffer_size(
+            static_cast<int>(receive_buffer_size_)), error_code);
+        if (error_code)
+        {
+            LOG(LS_WARNING) << "Failed to set receive buffer size: "
+                            << base::utf16FromLocal8Bit(error_code.message());
+        }
+    }
+}
+
 void SessionManager::removePendingSession(PendingSession* session)
 {
-    task_runner_->deleteSoon(removeSessionT(&pending_sessions_, session));
+    session->stop();
+
+    if (!session->pairKey().empty())
+    {
+        auto waiting_peer = waiting_peers_.find(session->pairKey());
+        if (waiting_peer != waiting_peers_.end() && waiting_peer->second.session == session)
+            waiting_peers_.erase(waiting_peer);
+    }
+
+    auto it = pending_sessions_.find(session);
+    if (it == pending_sessions_.end())
+        return;
+
+    task_runner_->deleteSoon(std::move(it->second));
+    pending_sessions_.erase(it);
 }
 
 void SessionManager::removeSession(Session* session)
 {
-    task_runner_->deleteSoon(removeSessionT(&active_sessions_, session));
+    session->stop();
+
+    auto it = active_sessions_.find(session->sessionId());
+    if (it == active_sessions_.end())
+        return;
+
+    if (it->second.idle_entry != idle_queue_.end())
+        idle_queue_.erase(it->second.idle_entry);
+
+    task_runner_->deleteSoon(std::move(it->second.session));
+    active_sessions_.erase(it);
 
     if (delegate_)
         delegate_->onSessionFinished();
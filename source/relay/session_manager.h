@@ -24,20 +24,29 @@
 #include "relay/pending_session.h"
 #include "relay/session.h"
 #include "relay/shared_pool.h"
+#include "relay/udp_relay.h"
 
 #include <asio/high_resolution_timer.hpp>
 
+#include <map>
+#include <unordered_map>
+
 namespace base {
 class TaskRunner;
 } // namespace base
 
 namespace relay {
 
+class Metrics;
+
 class SessionManager
     : public PendingSession::Delegate,
-      public Session::Delegate
+      public Session::Delegate,
+      public UdpRelay::Delegate
 {
 public:
+    using SocketPair = std::pair<asio::ip::tcp::socket, asio::ip::tcp::socket>;
+
     class Delegate
     {
     public:
@@ -46,18 +55,63 @@ public:
         virtual void onSessionStarted() = 0;
         virtual void onSessionStatistics(const proto::RelayStat& relay_stat) = 0;
         virtual void onSessionFinished() = 0;
+
+        // Called when both peers of a session are connected. If the delegate takes the sockets to
+        // run the session elsewhere, it returns true. Otherwise the session is started by this
+        // manager.
+        virtual bool dispatchSession(SocketPair* /* sockets */, const base::ByteArray& /* secret */)
+        {
+            return false;
+        }
     };
 
+    // If |port| is zero, then the manager does not accept connections and only runs the sessions
+    // passed to startSession().
     SessionManager(std::shared_ptr<base::TaskRunner> task_runner,
                    const asio::ip::address& listen_address,
                    uint16_t port,
                    const std::chrono::minutes& idle_timeout,
                    bool statistics_enabled,
-                   const std::chrono::seconds& statistics_interval);
+                   const std::chrono::seconds& statistics_interval,
+                   bool zero_copy);
     ~SessionManager() override;
 
+    // The idle timeout and the limits can also be changed after start(). The new values apply to
+    // the running sessions where it is possible and to all new ones.
+
+    // Sets the time after which inactive sessions are closed.
+    void setIdleTimeout(const std::chrono::minutes& idle_timeout);
+
+    // Sets the sizes of the socket buffers for new sessions. Zero leaves the system default.
+    void setSocketBufferSizes(uint32_t send_size, uint32_t receive_size);
+
+    // Sets the limits of the forwarding speed in bytes per second. |session_limit| applies to each
+    // session and |total_limit| to all sessions of the manager together. The total limit is shared
+    // between the sessions fairly: sessions that use less than an equal share give the rest to the
+    // others. Zero means no limit.
+    void setRateLimits(int64_t session_limit, int64_t total_limit);
+
+    // Sets the limits of admission for new peers. The peers beyond |max_pending_sessions| peers
+    // which wait for the authentication or for the opposite peer are closed at once. If
+    // |reject_when_saturated| is true, then the new peers are also closed while the sessions use
+    // all of the total rate limit. The rejected peers are reported in the statistics, so that the
+    // router uses other relays. Zero means no limit.
+    void setAdmissionLimits(size_t max_pending_sessions, bool reject_when_saturated);
+
+    // Sets the metrics that are updated by the sessions. |metrics| must outlive the manager.
+    void setMetrics(Metrics* metrics);
+
+    // Sets the port on which the datagrams of peers are relayed. Zero disables the UDP relay.
+    // Must be called before start().
+    void setUdpPort(uint16_t port);
+
     void start(std::unique_ptr<SharedPool> shared_pool, Delegate* delegate);
-    void disconnectSession(uint64_t session_id);
+
+    // Starts the data transfer between the peers of a session.
+    void startSession(SocketPair&& sockets, const base::ByteArray& secret);
+
+    // Returns false if the session is not found.
+    bool disconnectSession(uint64_t session_id);
 
 protected:
     // PendingSession::Delegate implementation.
@@ -68,6 +122,11 @@ protected:
     // Session::Delegate implementation.
     void onSessionFinished(Session* session) override;
 
+    // UdpRelay::Delegate implementation.
+    base::ByteArray udpPeerSecret(const proto::PeerToRelay& message) override;
+    void onUdpSessionStarted(uint32_t key_id) override;
+    void onUdpSessionFinished() override;
+
 private:
     static void doAccept(SessionManager* self);
     static void doIdleTimeout(SessionManager* self, const std::error_code& error_code);
@@ -75,20 +134,53 @@ private:
     static void doStatTimeout(SessionManager* self, const std::error_code& error_code);
     void doStatTimeoutImpl(const std::error_code& error_code);
     void collectAndSendStatistics();
+    static void doRateTimeout(SessionManager* self, const std::error_code& error_code);
+    void startRateTimer();
+    void distributeRateLimit();
+    int64_t initialRateLimit() const;
+    const char* admissionError() const;
 
+    void applySocketBufferSizes(asio::ip::tcp::socket* socket) const;
     void removePendingSession(PendingSession* sessions);
     void removeSession(Session* session);
 
     std::shared_ptr<base::TaskRunner> task_runner_;
 
+    const asio::ip::address listen_address_;
     asio::ip::tcp::acceptor acceptor_;
-    std::vector<std::unique_ptr<PendingSession>> pending_sessions_;
-    std::vector<std::unique_ptr<Session>> active_sessions_;
+    uint16_t udp_port_ = 0;
+    std::unique_ptr<UdpRelay> udp_relay_;
+    std::unordered_map<PendingSession*, std::unique_ptr<PendingSession>> pending_sessions_;
+
+    // Pending sessions waiting for the opposite peer by PendingSession::pairKey().
+    struct WaitingPeer
+    {
+        PendingSession* session;
+        PendingSession::TimePoint ready_time;
+    };
+
+    std::unordered_map<std::string, WaitingPeer> waiting_peers_;
+
+    // Active sessions by their identifiers. Each session has an entry in |idle_queue_| ordered by
+    // the last activity time known at the previous check, so the idle check looks only at the
+    // sessions that may have expired.
+    using IdleQueue = std::multimap<Session::TimePoint, uint64_t>;
+
+    struct ActiveSession
+    {
+        std::unique_ptr<Session> session;
+        IdleQueue::iterator idle_entry;
+    };
+
+    std::unordered_map<uint64_t, ActiveSession> active_sessions_;
+    IdleQueue idle_queue_;
 
-    const std::chrono::minutes idle_timeout_;
+    std::chrono::minutes idle_timeout_;
     asio::high_resolution_timer idle_timer_;
 
     asio::high_resolution_timer stat_timer_;
+    asio::high_resolution_timer rate_timer_;
+    bool is_rate_timer_active_ = false;
 
     std::unique_ptr<SharedPool> shared_pool_;
     Delegate* delegate_ = nullptr;
@@ -100,6 +192,17 @@ private:
 
     bool statistics_enabled_ = false;
     std::chrono::seconds statistics_interval_;
+    const bool zero_copy_;
+    uint32_t send_buffer_size_ = 0;
+    uint32_t receive_buffer_size_ = 0;
+    int64_t session_rate_limit_ = 0;
+    int64_t total_rate_limit_ = 0;
+    Metrics* metrics_ = nullptr;
+
+    size_t max_pending_sessions_ = 0;
+    bool reject_when_saturated_ = false;
+    bool is_rate_saturated_ = false;
+    uint32_t rejected_peers_ = 0; // Since the previous statistics.
 
     DISALLOW_COPY_AND_ASSIGN(SessionManager);
 };
@@ -19,30 +19,377 @@
 #include "relay/sessions_worker.h"
 
 #include "base/logging.h"
+#include "base/message_loop/message_loop.h"
+#include "base/message_loop/message_pump_asio.h"
 #include "base/strings/unicode.h"
+#include "base/threading/thread.h"
+#include "build/build_config.h"
+#include "relay/shared_pool.h"
+
+#include <algorithm>
+
+#if defined(OS_POSIX)
+#include <unistd.h>
+#endif // defined(OS_POSIX)
 
 namespace relay {
 
+namespace {
+
+// Closes a socket which is not owned by any asio object.
+void closeNativeSocket(asio::ip::tcp::socket::native_handle_type handle)
+{
+#if defined(OS_WIN)
+    ::closesocket(handle);
+#else
+    ::close(handle);
+#endif
+}
+
+} // namespace
+
+class SessionsWorker::Worker
+    : public base::Thread::Delegate,
+      public SessionManager::Delegate
+{
+public:
+    Worker(SessionsWorker* owner, size_t index);
+    ~Worker() override;
+
+    void start();
+    void stop();
+
+    void startSession(asio::ip::tcp::socket::protocol_type protocol,
+                      asio::ip::tcp::socket::native_handle_type first,
+                      asio::ip::tcp::socket::native_handle_type second,
+                      const base::ByteArray& secret);
+    void disconnectSession(uint64_t session_id);
+
+    // Calls |callback| with the session manager on the thread of the worker.
+    void postToSessionManager(std::function<void(SessionManager*)> callback);
+
+protected:
+    // base::Thread::Delegate implementation.
+    void onBeforeThreadRunning() override;
+    void onAfterThreadRunning() override;
+
+    // SessionManager::Delegate implementation.
+    void onSessionStarted() override;
+    void onSessionStatistics(const proto::RelayStat& relay_stat) override;
+    void onSessionFinished() override;
+    bool dispatchSession(SessionManager::SocketPair* sockets,
+                         const base::ByteArray& secret) override;
+
+private:
+    SessionsWorker* owner_;
+    const size_t index_;
+
+    std::unique_ptr<SharedPool> shared_pool_;
+    std::unique_ptr<base::Thread> thread_;
+    std::shared_ptr<base::TaskRunner> task_runner_;
+    std::unique_ptr<SessionManager> session_manager_;
+
+    DISALLOW_COPY_AND_ASSIGN(Worker);
+};
+
+SessionsWorker::Worker::Worker(SessionsWorker* owner, size_t index)
+    : owner_(owner),
+      index_(index),
+      shared_pool_(owner->shared_pool_->share()),
+      thread_(std::make_unique<base::Thread>())
+{
+    // Nothing
+}
+
+SessionsWorker::Worker::~Worker()
+{
+    stop();
+}
+
+void SessionsWorker::Worker::start()
+{
+    thread_->start(base::MessageLoop::Type::ASIO, this);
+}
+
+void SessionsWorker::Worker::stop()
+{
+    thread_->stop();
+}
+
+void SessionsWorker::Worker::startSession(asio::ip::tcp::socket::protocol_type protocol,
+                                          asio::ip::tcp::socket::native_handle_type first,
+                                          asio::ip::tcp::socket::native_handle_type second,
+                                          const base::ByteArray& secret)
+{
+    if (!task_runner_->belongsToCurrentThread())
+    {
+        task_runner_->postTask(std::bind(
+            &Worker::startSession, this, protocol, first, second, secret));
+        return;
+    }
+
+    asio::io_context& io_context = base::MessageLoop::current()->pumpAsio()->ioContext();
+
+    SessionManager::SocketPair sockets =
+        std::make_pair(asio::ip::tcp::socket(io_context), asio::ip::tcp::socket(io_context));
+
+    std::error_code first_error_code;
+    std::error_code second_error_code;
+
+    sockets.first.assign(protocol, first, first_error_code);
+    sockets.second.assign(protocol, second, second_error_code);
+
+    if (first_error_code || second_error_code)
+    {
+        LOG(LS_ERROR) << "Failed to assign sockets of session in worker " << index_;
+
+        // The assigned socket is closed by its destructor. The other one is not owned by anyone.
+        if (first_error_code)
+            closeNativeSocket(first);
+        if (second_error_code)
+            closeNativeSocket(second);
+        return;
+    }
+
+    session_manager_->startSession(std::move(sockets), secret);
+}
+
+void SessionsWorker::Worker::disconnectSession(uint64_t session_id)
+{
+    if (!task_runner_->belongsToCurrentThread())
+    {
+        task_runner_->postTask(std::bind(&Worker::disconnectSession, this, session_id));
+        return;
+    }
+
+    if (!session_manager_->disconnectSession(session_id))
+        LOG(LS_INFO) << "Session with id " << session_id << " not found in worker " << index_;
+}
+
+void SessionsWorker::Worker::postToSessionManager(std::function<void(SessionManager*)> callback)
+{
+    if (!task_runner_->belongsToCurrentThread())
+    {
+        task_runner_->postTask(std::bind(&Worker::postToSessionManager, this, std::move(callback)));
+        return;
+    }
+
+    if (session_manager_)
+        callback(session_manager_.get());
+}
+
+void SessionsWorker::Worker::onBeforeThreadRunning()
+{
+    task_runner_ = thread_->taskRunner();
+    DCHECK(task_runner_);
+
+    asio::ip::address listen_address =
+        asio::ip::make_address_v4(base::local8BitFromUtf16(owner_->listen_interface_));
+
+    // Only the first worker accepts connections.
+    const uint16_t port = index_ == 0 ? owner_->peer_port_ : 0;
+
+    session_manager_ = std::make_unique<SessionManager>(
+        task_runner_, listen_address, port, owner_->peer_idle_timeout_,
+        owner_->statistics_enabled_, owner_->statistics_interval_, owner_->zero_copy_);
+    session_manager_->setSocketBufferSizes(
+        owner_->send_buffer_size_, owner_->receive_buffer_size_);
+
+    session_manager_->setRateLimits(owner_->session_rate_limit_, owner_->workerRateLimit());
+    session_manager_->setMetrics(&owner_->metrics_);
+
+    // The datagrams of a session are forwarded in the thread where their peers were paired.
+    if (index_ == 0)
+    {
+        session_manager_->setUdpPort(owner_->udp_port_);
+        session_manager_->setAdmissionLimits(
+            owner_->max_pending_sessions_, owner_->reject_when_saturated_);
+    }
+
+    session_manager_->start(std::move(shared_pool_), this);
+}
+
+void SessionsWorker::Worker::onAfterThreadRunning()
+{
+    session_manager_.reset();
+}
+
+void SessionsWorker::Worker::onSessionStarted()
+{
+    owner_->onSessionStarted();
+}
+
+void SessionsWorker::Worker::onSessionStatistics(const proto::RelayStat& relay_stat)
+{
+    owner_->onSessionStatistics(index_, relay_stat);
+}
+
+void SessionsWorker::Worker::onSessionFinished()
+{
+    owner_->onSessionFinished();
+}
+
+bool SessionsWorker::Worker::dispatchSession(SessionManager::SocketPair* sockets,
+                                             const base::ByteArray& secret)
+{
+    Worker* worker = owner_->nextWorker();
+    if (worker == this)
+        return false;
+
+    // The sockets are bound to the I/O context of this thread. They are released and assigned
+    // again in the thread of the other worker.
+    std::error_code error_code;
+
+    asio::ip::tcp::socket::protocol_type protocol =
+        sockets->first.local_endpoint(error_code).protocol();
+    if (error_code)
+        return false;
+
+    asio::ip::tcp::socket::native_handle_type first = sockets->first.release(error_code);
+    if (error_code)
+    {
+        LOG(LS_WARNING) << "Failed to release socket: "
+                        << base::utf16FromLocal8Bit(error_code.message());
+        return false;
+    }
+
+    asio::ip::tcp::socket::native_handle_type second = sockets->second.release(error_code);
+    if (error_code)
+    {
+        LOG(LS_WARNING) << "Failed to release socket: "
+                        << base::utf16FromLocal8Bit(error_code.message());
+
+        // Return the first socket to this thread and start the session here.
+        sockets->first.assign(protocol, first, error_code);
+        if (error_code)
+            closeNativeSocket(first);
+        return false;
+    }
+
+    worker->startSession(protocol, first, second, secret);
+    return true;
+}
+
 SessionsWorker::SessionsWorker(std::u16string_view listen_interface,
                                uint16_t peer_port,
                                const std::chrono::minutes& peer_idle_timeout,
                                bool statistics_enabled,
                                const std::chrono::seconds& statistics_interval,
+                               bool zero_copy,
+                               size_t worker_count,
                                std::unique_ptr<SharedPool> shared_pool)
     : listen_interface_(listen_interface),
       peer_port_(peer_port),
       peer_idle_timeout_(peer_idle_timeout),
       statistics_enabled_(statistics_enabled),
       statistics_interval_(statistics_interval),
-      shared_pool_(std::move(shared_pool)),
-      thread_(std::make_unique<base::Thread>())
+      zero_copy_(zero_copy),
+      shared_pool_(std::move(shared_pool))
 {
     DCHECK(peer_port_ && shared_pool_);
+
+    if (!worker_count)
+        worker_count = std::max(std::thread::hardware_concurrency(), 1U);
+
+#if defined(OS_WIN)
+    // On Windows an accepted socket stays bound to the I/O completion port of the worker which
+    // accepted it and can't be assigned to the I/O context of another worker.
+    if (worker_count > 1)
+    {
+        LOG(LS_WARNING) << "Sessions can't be moved between threads on Windows. Only one worker "
+                        << "is used instead of " << worker_count;
+        worker_count = 1;
+    }
+#endif // defined(OS_WIN)
+
+    LOG(LS_INFO) << "Sessions workers: " << worker_count;
+
+    for (size_t i = 0; i < worker_count; ++i)
+        workers_.emplace_back(std::make_unique<Worker>(this, i));
+
+    worker_statistics_.resize(worker_count);
 }
 
 SessionsWorker::~SessionsWorker()
 {
-    thread_->stop();
+    // All threads are stopped before the workers are destroyed because the first worker passes
+    // sessions to the others.
+    for (auto& worker : workers_)
+        worker->stop();
+
+    workers_.clear();
+}
+
+void SessionsWorker::setPeerIdleTimeout(const std::chrono::minutes& peer_idle_timeout)
+{
+    peer_idle_timeout_ = peer_idle_timeout;
+
+    if (!caller_task_runner_)
+        return;
+
+    for (auto& worker : workers_)
+    {
+        worker->postToSessionManager([peer_idle_timeout](SessionManager* session_manager)
+        {
+            session_manager->setIdleTimeout(peer_idle_timeout);
+        });
+    }
+}
+
+void SessionsWorker::setSocketBufferSizes(uint32_t send_size, uint32_t receive_size)
+{
+    send_buffer_size_ = send_size;
+    receive_buffer_size_ = receive_size;
+
+    if (!caller_task_runner_)
+        return;
+
+    for (auto& worker : workers_)
+    {
+        worker->postToSessionManager([send_size, receive_size](SessionManager* session_manager)
+        {
+            session_manager->setSocketBufferSizes(send_size, receive_size);
+        });
+    }
+}
+
+void SessionsWorker::setAdmissionLimits(size_t max_pending_sessions, bool reject_when_saturated)
+{
+    max_pending_sessions_ = max_pending_sessions;
+    reject_when_saturated_ = reject_when_saturated;
+
+    if (!caller_task_runner_)
+        return;
+
+    workers_.front()->postToSessionManager(
+        [max_pending_sessions, reject_when_saturated](SessionManager* session_manager)
+    {
+        session_manager->setAdmissionLimits(max_pending_sessions, reject_when_saturated);
+    });
+}
+
+void SessionsWorker::setUdpPort(uint16_t port)
+{
+    udp_port_ = port;
+}
+
+void SessionsWorker::setRateLimits(int64_t session_limit, int64_t total_limit)
+{
+    session_rate_limit_ = session_limit;
+    total_rate_limit_ = total_limit;
+
+    if (!caller_task_runner_)
+        return;
+
+    const int64_t worker_limit = workerRateLimit();
+
+    for (auto& worker : workers_)
+    {
+        worker->postToSessionManager([session_limit, worker_limit](SessionManager* session_manager)
+        {
+            session_manager->setRateLimits(session_limit, worker_limit);
+        });
+    }
 }
 
 void SessionsWorker::start(std::shared_ptr<base::TaskRunner> caller_task_runner,
@@ -54,37 +401,29 @@ void SessionsWorker::start(std::shared_ptr<base::TaskRunner> caller_task_runner,
     DCHECK(caller_task_runner_);
     DCHECK(delegate_);
 
-    thread_->start(base::MessageLoop::Type::ASIO, this);
+    // The other workers are started first so that they are ready to receive sessions.
+    for (size_t i = workers_.size(); i > 0; --i)
+        workers_[i - 1]->start();
 }
 
 void SessionsWorker::disconnectSession(uint64_t session_id)
 {
-    if (!self_task_runner_->belongsToCurrentThread())
-    {
-        self_task_runner_->postTask(std::bind(&SessionsWorker::disconnectSession, this, session_id));
-        return;
-    }
-
-    session_manager_->disconnectSession(session_id);
+    // The session can be in any worker.
+    for (auto& worker : workers_)
+        worker->disconnectSession(session_id);
 }
 
-void SessionsWorker::onBeforeThreadRunning()
+SessionsWorker::Worker* SessionsWorker::nextWorker()
 {
-    self_task_runner_ = thread_->taskRunner();
-    DCHECK(self_task_runner_);
-
-    asio::ip::address listen_address =
-        asio::ip::make_address_v4(base::local8BitFromUtf16(listen_interface_));
-
-    session_manager_ = std::make_unique<SessionManager>(
-        self_task_runner_, listen_address, peer_port_, peer_idle_timeout_, statistics_enabled_,
-        statistics_interval_);
-    session_manager_->start(std::move(shared_pool_), this);
+    return workers_[next_worker_++ % workers_.size()].get();
 }
 
-void SessionsWorker::onAfterThreadRunning()
+int64_t SessionsWorker::workerRateLimit() const
 {
-    session_manager_.reset();
+    if (!total_rate_limit_)
+        return 0;
+
+    return std::max(total_rate_limit_ / static_cast<int64_t>(workers_.size()), int64_t(1));
 }
 
 void SessionsWorker::onSessionStarted()
@@ -99,17 +438,33 @@ void SessionsWorker::onSessionStarted()
         delegate_->onSessionStarted();
 }
 
-void SessionsWorker::onSessionStatistics(const proto::RelayStat& relay_stat)
+void SessionsWorker::onSessionStatistics(size_t worker_index, const proto::RelayStat& relay_stat)
 {
     if (!caller_task_runner_->belongsToCurrentThread())
     {
         caller_task_runner_->postTask(
-            std::bind(&SessionsWorker::onSessionStatistics, this, relay_stat));
+            std::bind(&SessionsWorker::onSessionStatistics, this, worker_index, relay_stat));
+        return;
+    }
+
+    worker_statistics_[worker_index] = relay_stat;
+
+    // The statistics of all workers are sent together when the first worker reports.
+    if (worker_index != 0)
         return;
+
+    proto::RelayStat total_stat = worker_statistics_[0];
+
+    for (size_t i = 1; i < worker_statistics_.size(); ++i)
+    {
+        for (const auto& peer_connection : worker_statistics_[i].peer_connection())
+            total_stat.add_peer_connection()->CopyFrom(peer_connection);
     }
 
+    total_stat.set_total_rate_limit(total_rate_limit_);
+
     if (delegate_)
-        delegate_->onSessionStatistics(relay_stat);
+        delegate_->onSessionStatistics(total_stat);
 }
 
 void SessionsWorker::onSessionFinished()
@@ -19,53 +19,92 @@
 #ifndef RELAY_SESSIONS_WORKER_H
 #define RELAY_SESSIONS_WORKER_H
 
-#include "base/threading/thread.h"
+#include "relay/metrics.h"
 #include "relay/session_manager.h"
 
+#include <atomic>
+
 namespace relay {
 
 class SharedPool;
 
+// Runs the sessions of peers on several threads. The first worker accepts connections and pairs
+// the peers. The paired sessions are distributed between all workers in turn.
 class SessionsWorker
-    : public base::Thread::Delegate,
-      public SessionManager::Delegate
 {
 public:
+    // If |worker_count| is zero, then one worker is started for each processor. On Windows only one
+    // worker is used.
     SessionsWorker(std::u16string_view listen_interface,
                    uint16_t peer_port,
                    const std::chrono::minutes& peer_idle_timeout,
                    bool statistics_enabled,
                    const std::chrono::seconds& statistics_interval,
+                   bool zero_copy,
+                   size_t worker_count,
                    std::unique_ptr<SharedPool> shared_pool);
-    ~SessionsWorker() override;
+    ~SessionsWorker();
+
+    // The idle timeout, the socket buffer sizes and the limits can be changed at any time. After
+    // start() the new values are passed to the threads of workers.
+    void setPeerIdleTimeout(const std::chrono::minutes& peer_idle_timeout);
+    void setSocketBufferSizes(uint32_t send_size, uint32_t receive_size);
+
+    // Admission limits of new peers (see SessionManager::setAdmissionLimits). They apply to the
+    // first worker, which accepts the peers.
+    void setAdmissionLimits(size_t max_pending_sessions, bool reject_when_saturated);
+
+    // Port of the UDP relay, which runs in the first worker. Zero disables it. Must be called
+    // before start().
+    void setUdpPort(uint16_t port);
+
+    // Limits in bytes per second. The total limit is divided equally between the workers.
+    void setRateLimits(int64_t session_limit, int64_t total_limit);
 
     void start(std::shared_ptr<base::TaskRunner> caller_task_runner,
                SessionManager::Delegate* delegate);
     void disconnectSession(uint64_t session_id);
 
-protected:
-    // base::Thread::Delegate implementation.
-    void onBeforeThreadRunning() override;
-    void onAfterThreadRunning() override;
-
-    // SessionManager::Delegate implementation.
-    void onSessionStarted() override;
-    void onSessionStatistics(const proto::RelayStat& relay_stat) override;
-    void onSessionFinished() override;
+    // Metrics of the sessions of all workers. Can be read on any thread.
+    const Metrics& metrics() const { return metrics_; }
 
 private:
+    class Worker;
+
+    Worker* nextWorker();
+    int64_t workerRateLimit() const;
+
+    // Called from the threads of workers.
+    void onSessionStarted();
+    void onSessionStatistics(size_t worker_index, const proto::RelayStat& relay_stat);
+    void onSessionFinished();
+
     const std::u16string listen_interface_;
     const uint16_t peer_port_;
-    const std::chrono::minutes peer_idle_timeout_;
+    std::chrono::minutes peer_idle_timeout_;
     const bool statistics_enabled_;
     const std::chrono::seconds statistics_interval_;
+    const bool zero_copy_;
+    uint32_t send_buffer_size_ = 0;
+    uint32_t receive_buffer_size_ = 0;
+    uint16_t udp_port_ = 0;
+    size_t max_pending_sessions_ = 0;
+    bool reject_when_saturated_ = false;
+    int64_t session_rate_limit_ = 0;
+    int64_t total_rate_limit_ = 0;
 
     std::unique_ptr<SharedPool> shared_pool_;
 
-    std::unique_ptr<base::Thread> thread_;
+    // Declared before the workers, so that it is destroyed after them.
+    Metrics metrics_;
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<size_t> next_worker_ { 0 };
+
+    // The last statistics of each worker. Accessed only on the caller thread.
+    std::vector<proto::RelayStat> worker_statistics_;
+
     std::shared_ptr<base::TaskRunner> caller_task_runner_;
-    std::shared_ptr<base::TaskRunner> self_task_runner_;
-    std::unique_ptr<SessionManager> session_manager_;
     SessionManager::Delegate* delegate_ = nullptr;
 
     DISALLOW_COPY_AND_ASSIGN(SessionsWorker);
@@ -52,10 +52,21 @@ void Settings::reset()
     setRouterPublicKey(base::ByteArray());
     setPeerAddress(std::u16string());
     setPeerPort(DEFAULT_RELAY_PEER_TCP_PORT);
+    setPeerUdpPort(0);
     setPeerIdleTimeout(std::chrono::minutes(5));
     setMaxPeerCount(100);
     setStatisticsEnabled(false);
     setStatisticsInterval(std::chrono::seconds(5));
+    setZeroCopyEnabled(false);
+    setPeerSendBufferSize(0);
+    setPeerReceiveBufferSize(0);
+    setWorkerCount(1);
+    setSessionRateLimit(0);
+    setTotalRateLimit(0);
+    setMaxPendingPeers(0);
+    setRejectPeersWhenSaturated(false);
+    setMetricsInterface(u"127.0.0.1");
+    setMetricsPort(0);
 }
 
 void Settings::flush()
@@ -127,6 +138,16 @@ uint16_t Settings::peerPort() const
     return impl_.get<uint16_t>("PeerPort", DEFAULT_RELAY_PEER_TCP_PORT);
 }
 
+void Settings::setPeerUdpPort(uint16_t port)
+{
+    impl_.set<uint16_t>("PeerUdpPort", port);
+}
+
+uint16_t Settings::peerUdpPort() const
+{
+    return impl_.get<uint16_t>("PeerUdpPort", 0);
+}
+
 void Settings::setPeerIdleTimeout(const std::chrono::minutes& timeout)
 {
     impl_.set<int>("PeerIdleTimeout", timeout.count());
@@ -167,4 +188,108 @@ std::chrono::seconds Settings::statisticsInterval() const
     return std::chrono::seconds(impl_.get<int>("StatisticsInterval", 5));
 }
 
+void Settings::setZeroCopyEnabled(bool enable)
+{
+    impl_.set<bool>("ZeroCopyEnabled", enable);
+}
+
+bool Settings::isZeroCopyEnabled() const
+{
+    return impl_.get<bool>("ZeroCopyEnabled", false);
+}
+
+void Settings::setPeerSendBufferSize(uint32_t size)
+{
+    impl_.set<uint32_t>("PeerSendBufferSize", size);
+}
+
+uint32_t Settings::peerSendBufferSize() const
+{
+    return impl_.get<uint32_t>("PeerSendBufferSize", 0);
+}
+
+void Settings::setPeerReceiveBufferSize(uint32_t size)
+{
+    impl_.set<uint32_t>("PeerReceiveBufferSize", size);
+}
+
+uint32_t Settings::peerReceiveBufferSize() const
+{
+    return impl_.get<uint32_t>("PeerReceiveBufferSize", 0);
+}
+
+void Settings::setWorkerCount(uint32_t count)
+{
+    impl_.set<uint32_t>("WorkerCount", count);
+}
+
+uint32_t Settings::workerCount() const
+{
+    return impl_.get<uint32_t>("WorkerCount", 1);
+}
+
+void Settings::setSessionRateLimit(uint32_t kbps)
+{
+    impl_.set<uint32_t>("SessionRateLimit", kbps);
+}
+
+uint32_t Settings::sessionRateLimit() const
+{
+    return impl_.get<uint32_t>("SessionRateLimit", 0);
+}
+
+void Settings::setTotalRateLimit(uint32_t kbps)
+{
+    impl_.set<uint32_t>("TotalRateLimit", kbps);
+}
+
+uint32_t Settings::totalRateLimit() const
+{
+    return impl_.get<uint32_t>("TotalRateLimit", 0);
+}
+
+void Settings::setMaxPendingPeers(uint32_t count)
+{
+    impl_.set<uint32_t>("MaxPendingPeers", count);
+}
+
+uint32_t Settings::maxPendingPeers() const
+{
+    return impl_.get<uint32_t>("MaxPendingPeers", 0);
+}
+
+void Settings::setRejectPeersWhenSaturated(bool enable)
+{
+    impl_.set<bool>("RejectPeersWhenSaturated", enable);
+}
+
+bool Settings::isRejectPeersWhenSaturated() const
+{
+    return impl_.get<bool>("RejectPeersWhenSaturated", false);
+}
+
+void Settings::setMetricsInterface(const std::u16string& interface)
+{
+    impl_.set<std::u16string>("MetricsInterface", interface);
+}
+
+std::u16string Settings::metricsInterface() const
+{
+    std::u16string interface = impl_.get<std::u16string>("MetricsInterface", u"127.0.0.1");
+    if (interface.empty())
+        return u"127.0.0.1";
+
+    return interface;
+}
+
+void Settings::setMetricsPort(uint16_t port)
+{
+    impl_.set<uint16_t>("MetricsPort", port);
+}
+
+uint16_t Settings::metricsPort() const
+{
+    return impl_.get<uint16_t>("MetricsPort", 0);
+}
+
 } // namespace relay
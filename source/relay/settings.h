@@ -54,6 +54,10 @@ public:
     void setPeerPort(uint16_t port);
     uint16_t peerPort() const;
 
+    // Port for the peers whose sessions use a transport over UDP. Zero disables the UDP relay.
+    void setPeerUdpPort(uint16_t port);
+    uint16_t peerUdpPort() const;
+
     void setPeerIdleTimeout(const std::chrono::minutes& timeout);
     std::chrono::minutes peerIdleTimeout() const;
 
@@ -66,6 +70,45 @@ public:
     void setStatisticsInterval(const std::chrono::seconds& interval);
     std::chrono::seconds statisticsInterval() const;
 
+    // Forwarding of data between peers inside the kernel (Linux only).
+    void setZeroCopyEnabled(bool enable);
+    bool isZeroCopyEnabled() const;
+
+    // Sizes of the socket buffers for peers in bytes. Zero means the system default.
+    void setPeerSendBufferSize(uint32_t size);
+    uint32_t peerSendBufferSize() const;
+
+    void setPeerReceiveBufferSize(uint32_t size);
+    uint32_t peerReceiveBufferSize() const;
+
+    // Number of threads that transfer data between peers. Zero means one thread per processor.
+    void setWorkerCount(uint32_t count);
+    uint32_t workerCount() const;
+
+    // Limits of the forwarding speed in kilobits per second for each session and for all sessions
+    // together. Zero means no limit.
+    void setSessionRateLimit(uint32_t kbps);
+    uint32_t sessionRateLimit() const;
+
+    void setTotalRateLimit(uint32_t kbps);
+    uint32_t totalRateLimit() const;
+
+    // Maximum number of peers which wait for the authentication or for the opposite peer. Beyond it
+    // new peers are closed at once. Zero means no limit.
+    void setMaxPendingPeers(uint32_t count);
+    uint32_t maxPendingPeers() const;
+
+    // If enabled, new peers are closed while the sessions use all of the total rate limit.
+    void setRejectPeersWhenSaturated(bool enable);
+    bool isRejectPeersWhenSaturated() const;
+
+    // HTTP endpoint that exports the metrics of sessions at /metrics. Zero port means disabled.
+    void setMetricsInterface(const std::u16string& interface);
+    std::u16string metricsInterface() const;
+
+    void setMetricsPort(uint16_t port);
+    uint16_t metricsPort() const;
+
 private:
     base::JsonSettings impl_;
 };
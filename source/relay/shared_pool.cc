@@ -20,10 +20,19 @@
 
 #include "base/logging.h"
 
+#include <array>
+#include <atomic>
 #include <mutex>
+#include <unordered_map>
 
 namespace relay {
 
+namespace {
+
+const size_t kShardCount = 16;
+
+} // namespace
+
 class SharedPool::Pool
 {
 public:
@@ -34,16 +43,31 @@ public:
 
     uint32_t addKey(SessionKey&& session_key);
     bool removeKey(uint32_t key_id);
-    void setKeyExpired(uint32_t key_id);
+    void setKeysExpired(const std::vector<uint32_t>& key_ids);
     std::optional<Key> key(uint32_t key_id, std::string_view peer_public_key) const;
     void clear();
+    size_t count() const;
 
 private:
+    // A lookup holds the key while the session key is computed, even if the key is removed at
+    // the same time.
+    using KeyPtr = std::shared_ptr<const SessionKey>;
+
+    struct Shard
+    {
+        mutable std::mutex lock;
+        std::unordered_map<uint32_t, KeyPtr> map;
+    };
+
+    // Key IDs are sequential, so the keys are spread evenly.
+    Shard& shard(uint32_t key_id) { return shards_[key_id % kShardCount]; }
+    const Shard& shard(uint32_t key_id) const { return shards_[key_id % kShardCount]; }
+
     Delegate* delegate_;
 
-    mutable std::mutex pool_lock_;
-    std::map<uint32_t, SessionKey> map_;
-    uint32_t current_key_id_ = 0;
+    std::array<Shard, kShardCount> shards_;
+    std::atomic_uint32_t current_key_id_ { 0 };
+    std::atomic_size_t count_ { 0 };
 
     DISALLOW_COPY_AND_ASSIGN(Pool);
 };
@@ -61,10 +85,16 @@ void SharedPool::Pool::dettach()
 
 uint32_t SharedPool::Pool::addKey(SessionKey&& session_key)
 {
-    std::scoped_lock lock(pool_lock_);
+    const uint32_t key_id = current_key_id_++;
+    KeyPtr key = std::make_shared<const SessionKey>(std::move(session_key));
+
+    {
+        Shard& key_shard = shard(key_id);
+        std::scoped_lock lock(key_shard.lock);
+        key_shard.map.emplace(key_id, std::move(key));
+    }
 
-    uint32_t key_id = current_key_id_++;
-    map_.emplace(key_id, std::move(session_key));
+    ++count_;
 
     LOG(LS_INFO) << "Key with id " << key_id << " added to pool";
     return key_id;
@@ -72,50 +102,91 @@ uint32_t SharedPool::Pool::addKey(SessionKey&& session_key)
 
 bool SharedPool::Pool::removeKey(uint32_t key_id)
 {
-    std::scoped_lock lock(pool_lock_);
+    KeyPtr key;
 
-    auto result = map_.find(key_id);
-    if (result != map_.end())
     {
-        map_.erase(result);
+        Shard& key_shard = shard(key_id);
+        std::scoped_lock lock(key_shard.lock);
 
-        LOG(LS_INFO) << "Key with id " << key_id << " removed from pool";
-        return true;
+        auto result = key_shard.map.find(key_id);
+        if (result == key_shard.map.end())
+            return false;
+
+        // The key is destroyed outside the lock.
+        key = std::move(result->second);
+        key_shard.map.erase(result);
     }
 
-    return false;
+    --count_;
+
+    LOG(LS_INFO) << "Key with id " << key_id << " removed from pool";
+    return true;
 }
 
-void SharedPool::Pool::setKeyExpired(uint32_t key_id)
+void SharedPool::Pool::setKeysExpired(const std::vector<uint32_t>& key_ids)
 {
-    if (removeKey(key_id))
-    {
-        LOG(LS_INFO) << "Key with ID " << key_id << " expired. It has been removed";
+    std::vector<uint32_t> expired_keys;
+    expired_keys.reserve(key_ids.size());
 
-        if (delegate_)
-            delegate_->onPoolKeyExpired(key_id);
+    for (const auto& key_id : key_ids)
+    {
+        if (removeKey(key_id))
+            expired_keys.emplace_back(key_id);
     }
+
+    if (expired_keys.empty())
+        return;
+
+    LOG(LS_INFO) << expired_keys.size() << " of " << key_ids.size()
+                 << " used keys expired. They have been removed";
+
+    if (!delegate_)
+        return;
+
+    for (const auto& key_id : expired_keys)
+        delegate_->onPoolKeyExpired(key_id);
 }
 
 std::optional<SharedPool::Key> SharedPool::Pool::key(
     uint32_t key_id, std::string_view peer_public_key) const
 {
-    std::scoped_lock lock(pool_lock_);
+    KeyPtr key;
+
+    {
+        const Shard& key_shard = shard(key_id);
+        std::scoped_lock lock(key_shard.lock);
 
-    auto result = map_.find(key_id);
-    if (result == map_.end())
-        return std::nullopt;
+        auto result = key_shard.map.find(key_id);
+        if (result == key_shard.map.end())
+            return std::nullopt;
 
-    const SessionKey& session_key = result->second;
-    return std::make_pair(session_key.sessionKey(peer_public_key), session_key.iv());
+        key = result->second;
+    }
+
+    // Computing the session key is the expensive part of the lookup.
+    return std::make_pair(key->sessionKey(peer_public_key), key->iv());
 }
 
 void SharedPool::Pool::clear()
 {
-    std::scoped_lock lock(pool_lock_);
+    for (Shard& key_shard : shards_)
+    {
+        std::unordered_map<uint32_t, KeyPtr> map;
+
+        {
+            std::scoped_lock lock(key_shard.lock);
+            map.swap(key_shard.map);
+        }
+
+        count_ -= map.size();
+    }
 
     LOG(LS_INFO) << "Key pool cleared";
-    map_.clear();
+}
+
+size_t SharedPool::Pool::count() const
+{
+    return count_.load(std::memory_order_relaxed);
 }
 
 SharedPool::SharedPool(Delegate* delegate)
@@ -153,9 +224,9 @@ bool SharedPool::removeKey(uint32_t key_id)
     return pool_->removeKey(key_id);
 }
 
-void SharedPool::setKeyExpired(uint32_t key_id)
+void SharedPool::setKeysExpired(const std::vector<uint32_t>& key_ids)
 {
-    return pool_->setKeyExpired(key_id);
+    pool_->setKeysExpired(key_ids);
 }
 
 std::optional<SharedPool::Key> SharedPool::key(
@@ -169,4 +240,9 @@ void SharedPool::clear()
     pool_->clear();
 }
 
+size_t SharedPool::count() const
+{
+    return pool_->count();
+}
+
 } // namespace relay
@@ -22,9 +22,13 @@
 #include "relay/session_key.h"
 
 #include <optional>
+#include <vector>
 
 namespace relay {
 
+// Keys of the relay, shared by the controller and the session workers. The keys are spread over
+// shards with separate locks, and the session key is computed without holding a lock, so that
+// the lookups of the workers do not wait for each other.
 class SharedPool
 {
 public:
@@ -45,9 +49,11 @@ public:
 
     uint32_t addKey(SessionKey&& session_key);
     bool removeKey(uint32_t key_id);
-    void setKeyExpired(uint32_t key_id);
+    // Removes the keys and notifies the delegate about each key that was in the pool.
+    void setKeysExpired(const std::vector<uint32_t>& key_ids);
     std::optional<Key> key(uint32_t key_id, std::string_view peer_public_key) const;
     void clear();
+    size_t count() const;
 
 private:
     class Pool;
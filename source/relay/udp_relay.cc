@@ -0,0 +1,456 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "relay/udp_relay.h"
+
+#include "base/logging.h"
+#include "base/message_loop/message_loop.h"
+#include "base/message_loop/message_pump_asio.h"
+#include "base/strings/unicode.h"
+
+#include <array>
+#include <cstring>
+
+#if defined(OS_LINUX)
+#include <sys/socket.h>
+#endif // defined(OS_LINUX)
+
+namespace relay {
+
+namespace {
+
+// Number of datagrams received and sent with one system call.
+const size_t kBatchSize = 32;
+
+// Batches handled in one wakeup, so that the timers of the thread are not delayed.
+const size_t kMaxBatchesPerWakeup = 8;
+
+// The transports over UDP keep their datagrams below the path MTU. Larger datagrams are dropped.
+const size_t kMaxDatagramSize = 2048;
+
+const std::chrono::seconds kPeerWaitTimeout { 30 };
+const std::chrono::seconds kSweepInterval { 10 };
+
+std::string makePairKey(uint32_t key_id, const base::ByteArray& secret)
+{
+    std::string pair_key;
+    pair_key.reserve(sizeof(key_id) + secret.size());
+    pair_key.append(reinterpret_cast<const char*>(&key_id), sizeof(key_id));
+    pair_key.append(reinterpret_cast<const char*>(secret.data()), secret.size());
+    return pair_key;
+}
+
+} // namespace
+
+const uint8_t UdpRelay::kHelloMarker[kHelloMarkerSize] = { 'A', 'S', 'P', 'I', 'A', 'U', 'R', '1' };
+
+size_t UdpRelay::EndpointHash::operator()(const Endpoint& endpoint) const
+{
+    size_t hash = std::hash<uint16_t>()(endpoint.port());
+
+    const asio::ip::address& address = endpoint.address();
+    if (address.is_v4())
+    {
+        hash ^= std::hash<uint32_t>()(address.to_v4().to_uint()) + 0x9E3779B9 + (hash << 6);
+    }
+    else
+    {
+        for (uint8_t byte : address.to_v6().to_bytes())
+            hash ^= std::hash<uint8_t>()(byte) + 0x9E3779B9 + (hash << 6) + (hash >> 2);
+    }
+
+    return hash;
+}
+
+UdpRelay::UdpRelay(const asio::ip::address& listen_address,
+                   uint16_t port,
+                   const std::chrono::minutes& idle_timeout)
+    : socket_(base::MessageLoop::current()->pumpAsio()->ioContext()),
+      sweep_timer_(base::MessageLoop::current()->pumpAsio()->ioContext()),
+      listen_address_(listen_address),
+      port_(port),
+      idle_timeout_(idle_timeout)
+{
+    LOG(LS_INFO) << "Ctor";
+}
+
+UdpRelay::~UdpRelay()
+{
+    LOG(LS_INFO) << "Dtor";
+
+    std::error_code ignored_code;
+    socket_.cancel(ignored_code);
+    socket_.close(ignored_code);
+    sweep_timer_.cancel();
+}
+
+bool UdpRelay::start(Delegate* delegate)
+{
+    delegate_ = delegate;
+    DCHECK(delegate_);
+
+    Endpoint endpoint(listen_address_, port_);
+    std::error_code error_code;
+
+    socket_.open(endpoint.protocol(), error_code);
+    if (!error_code)
+        socket_.set_option(asio::ip::udp::socket::reuse_address(true), error_code);
+    if (!error_code)
+        socket_.bind(endpoint, error_code);
+    if (!error_code)
+        socket_.non_blocking(true, error_code);
+
+    if (error_code)
+    {
+        LOG(LS_ERROR) << "Unable to start UDP relay on port " << port_ << ": "
+                      << base::utf16FromLocal8Bit(error_code.message());
+        return false;
+    }
+
+    receive_buffer_.resize(kBatchSize * kMaxDatagramSize);
+    received_.resize(kBatchSize);
+    outgoing_.reserve(kBatchSize);
+
+    LOG(LS_INFO) << "UDP relay port: " << port_;
+
+    doWait();
+    doSweep();
+    return true;
+}
+
+void UdpRelay::doWait()
+{
+    socket_.async_wait(asio::ip::udp::socket::wait_read, [this](const std::error_code& error_code)
+    {
+        if (error_code == asio::error::operation_aborted)
+            return;
+
+        if (error_code)
+        {
+            LOG(LS_ERROR) << "Error while waiting for datagrams: "
+                          << base::utf16FromLocal8Bit(error_code.message());
+            return;
+        }
+
+        onReadable();
+        doWait();
+    });
+}
+
+void UdpRelay::onReadable()
+{
+    now_ = Clock::now();
+
+    for (size_t i = 0; i < kMaxBatchesPerWakeup; ++i)
+    {
+        const size_t count = receiveBatch();
+        if (!count)
+            break;
+
+        outgoing_.clear();
+
+        for (size_t index = 0; index < count; ++index)
+            onDatagram(index);
+
+        sendBatch();
+
+        if (count < kBatchSize)
+            break;
+    }
+}
+
+size_t UdpRelay::receiveBatch()
+{
+#if defined(OS_LINUX)
+    std::array<mmsghdr, kBatchSize> headers;
+    std::array<iovec, kBatchSize> vectors;
+    memset(headers.data(), 0, sizeof(headers));
+
+    for (size_t i = 0; i < kBatchSize; ++i)
+    {
+        vectors[i].iov_base = receive_buffer_.data() + i * kMaxDatagramSize;
+        vectors[i].iov_len = kMaxDatagramSize;
+
+        headers[i].msg_hdr.msg_iov = &vectors[i];
+        headers[i].msg_hdr.msg_iovlen = 1;
+        headers[i].msg_hdr.msg_name = received_[i].endpoint.data();
+        headers[i].msg_hdr.msg_namelen = static_cast<socklen_t>(received_[i].endpoint.capacity());
+    }
+
+    int count = recvmmsg(socket_.native_handle(), headers.data(), kBatchSize, MSG_DONTWAIT,
+                         nullptr);
+    if (count <= 0)
+    {
+        if (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+            PLOG(LS_ERROR) << "recvmmsg failed";
+        return 0;
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        Datagram& datagram = received_[i];
+
+        datagram.endpoint.resize(headers[i].msg_hdr.msg_namelen);
+        datagram.data = static_cast<uint8_t*>(vectors[i].iov_base);
+        datagram.size = headers[i].msg_len;
+
+        if (headers[i].msg_hdr.msg_flags & MSG_TRUNC)
+            datagram.data = nullptr;
+    }
+
+    return static_cast<size_t>(count);
+#else
+    size_t count = 0;
+
+    for (size_t i = 0; i < kBatchSize; ++i)
+    {
+        Datagram& datagram = received_[count];
+        datagram.data = receive_buffer_.data() + count * kMaxDatagramSize;
+
+        std::error_code error_code;
+        datagram.size = socket_.receive_from(
+            asio::buffer(datagram.data, kMaxDatagramSize), datagram.endpoint, 0, error_code);
+        if (error_code == asio::error::would_block)
+            break;
+
+        // Too large datagrams and the errors about unreachable peers are skipped.
+        if (error_code)
+            continue;
+
+        ++count;
+    }
+
+    return count;
+#endif // defined(OS_LINUX)
+}
+
+void UdpRelay::sendBatch()
+{
+    if (outgoing_.empty())
+        return;
+
+#if defined(OS_LINUX)
+    std::array<mmsghdr, kBatchSize> headers;
+    std::array<iovec, kBatchSize> vectors;
+    memset(headers.data(), 0, sizeof(headers));
+
+    for (size_t i = 0; i < outgoing_.size(); ++i)
+    {
+        const Datagram& datagram = received_[outgoing_[i].first];
+
+        vectors[i].iov_base = datagram.data;
+        vectors[i].iov_len = datagram.size;
+
+        headers[i].msg_hdr.msg_iov = &vectors[i];
+        headers[i].msg_hdr.msg_iovlen = 1;
+        headers[i].msg_hdr.msg_name = outgoing_[i].second.data();
+        headers[i].msg_hdr.msg_namelen = static_cast<socklen_t>(outgoing_[i].second.size());
+    }
+
+    size_t sent = 0;
+    while (sent < outgoing_.size())
+    {
+        int count = sendmmsg(socket_.native_handle(), headers.data() + sent,
+                             static_cast<unsigned int>(outgoing_.size() - sent), MSG_DONTWAIT);
+        if (count < 0)
+        {
+            // The socket buffer is full. The rest of the batch is dropped like by a congested
+            // router, the transport of the peers sends it again.
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+
+            // The datagram can not be sent to its target. Skip it.
+            ++sent;
+            continue;
+        }
+
+        sent += static_cast<size_t>(count);
+    }
+#else
+    for (const auto& outgoing : outgoing_)
+    {
+        const Datagram& datagram = received_[outgoing.first];
+
+        std::error_code ignored_code;
+        socket_.send_to(asio::buffer(datagram.data, datagram.size), outgoing.second, 0,
+                        ignored_code);
+    }
+#endif // defined(OS_LINUX)
+}
+
+void UdpRelay::onDatagram(size_t index)
+{
+    const Datagram& datagram = received_[index];
+    if (!datagram.data)
+        return;
+
+    const bool is_hello = datagram.size >= kHelloMarkerSize &&
+        memcmp(datagram.data, kHelloMarker, kHelloMarkerSize) == 0;
+
+    auto it = endpoints_.find(datagram.endpoint);
+    if (it == endpoints_.end())
+    {
+        if (is_hello)
+            onHello(datagram);
+        return;
+    }
+
+    Binding* binding = it->second;
+
+    if (is_hello)
+    {
+        // The peer has not received the answer yet.
+        sendStatus(datagram.endpoint, binding->peer_count == 2 ? PAIRED : WAITING);
+        return;
+    }
+
+    if (binding->peer_count != 2)
+        return;
+
+    binding->last_activity = now_;
+    bytes_transferred_ += static_cast<int64_t>(datagram.size);
+
+    outgoing_.emplace_back(index, binding->endpoint[0] == datagram.endpoint ?
+        binding->endpoint[1] : binding->endpoint[0]);
+}
+
+void UdpRelay::onHello(const Datagram& datagram)
+{
+    proto::PeerToRelay message;
+    if (!message.ParseFromArray(datagram.data + kHelloMarkerSize,
+                                static_cast<int>(datagram.size - kHelloMarkerSize)))
+    {
+        LOG(LS_WARNING) << "Invalid hello from " << datagram.endpoint.address().to_string();
+        return;
+    }
+
+    LOG(LS_INFO) << "UDP peer ready for key_id: " << message.key_id();
+
+    base::ByteArray secret = delegate_->udpPeerSecret(message);
+    if (secret.empty())
+        return;
+
+    std::string pair_key = makePairKey(message.key_id(), secret);
+
+    auto result = bindings_.try_emplace(pair_key);
+    Binding& binding = result.first->second;
+
+    if (result.second)
+    {
+        LOG(LS_INFO) << "Second UDP peer has not connected yet";
+
+        binding.pair_key = std::move(pair_key);
+        binding.key_id = message.key_id();
+        binding.endpoint[0] = datagram.endpoint;
+        binding.peer_count = 1;
+        binding.start_time = now_;
+        binding.last_activity = now_;
+
+        endpoints_.emplace(datagram.endpoint, &binding);
+        sendStatus(datagram.endpoint, WAITING);
+        return;
+    }
+
+    if (binding.peer_count != 1)
+    {
+        LOG(LS_WARNING) << "Key " << message.key_id() << " is already used";
+        return;
+    }
+
+    binding.endpoint[1] = datagram.endpoint;
+    binding.peer_count = 2;
+    binding.last_activity = now_;
+    ++session_count_;
+
+    endpoints_.emplace(datagram.endpoint, &binding);
+
+    LOG(LS_INFO) << "Both UDP peers are connected with key " << binding.key_id << " (peer wait: "
+                 << std::chrono::duration_cast<std::chrono::milliseconds>(
+                        now_ - binding.start_time).count() << "ms)";
+
+    sendStatus(binding.endpoint[0], PAIRED);
+    sendStatus(binding.endpoint[1], PAIRED);
+
+    delegate_->onUdpSessionStarted(binding.key_id);
+}
+
+void UdpRelay::sendStatus(const Endpoint& endpoint, Status status)
+{
+    std::array<uint8_t, kHelloMarkerSize + 1> buffer;
+    memcpy(buffer.data(), kHelloMarker, kHelloMarkerSize);
+    buffer[kHelloMarkerSize] = status;
+
+    // The peer repeats the hello until it gets the answer, so errors are ignored.
+    std::error_code ignored_code;
+    socket_.send_to(asio::buffer(buffer), endpoint, 0, ignored_code);
+}
+
+void UdpRelay::doSweep()
+{
+    sweep_timer_.expires_after(kSweepInterval);
+    sweep_timer_.async_wait([this](const std::error_code& error_code)
+    {
+        if (error_code == asio::error::operation_aborted)
+            return;
+
+        now_ = Clock::now();
+
+        std::vector<Binding*> expired;
+
+        for (auto& binding : bindings_)
+        {
+            if (binding.second.peer_count == 1)
+            {
+                if (now_ - binding.second.start_time >= kPeerWaitTimeout)
+                    expired.emplace_back(&binding.second);
+            }
+            else if (now_ - binding.second.last_activity >= idle_timeout_)
+            {
+                expired.emplace_back(&binding.second);
+            }
+        }
+
+        if (!expired.empty())
+            LOG(LS_INFO) << "UDP bindings ended by timeout: " << expired.size();
+
+        for (Binding* binding : expired)
+            removeBinding(binding);
+
+        doSweep();
+    });
+}
+
+void UdpRelay::removeBinding(Binding* binding)
+{
+    const bool was_paired = binding->peer_count == 2;
+
+    for (size_t i = 0; i < binding->peer_count; ++i)
+        endpoints_.erase(binding->endpoint[i]);
+
+    // The key is copied because it is erased together with the binding.
+    const std::string pair_key = binding->pair_key;
+    bindings_.erase(pair_key);
+
+    if (!was_paired)
+        return;
+
+    --session_count_;
+    delegate_->onUdpSessionFinished();
+}
+
+} // namespace relay
@@ -0,0 +1,146 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef RELAY_UDP_RELAY_H
+#define RELAY_UDP_RELAY_H
+
+#include "base/macros_magic.h"
+#include "base/memory/byte_array.h"
+#include "build/build_config.h"
+#include "proto/relay_peer.pb.h"
+
+#include <asio/high_resolution_timer.hpp>
+#include <asio/ip/udp.hpp>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace relay {
+
+// Forwards datagrams between pairs of peers, for the sessions that use a transport over UDP. The
+// peers are paired by the same one-time keys as the TCP sessions.
+//
+// A peer starts by sending the hello datagram: kHelloMarker followed by a serialized
+// PeerToRelay message. It repeats the datagram until the relay answers with kHelloMarker and the
+// status byte (WAITING or PAIRED). After both peers are paired, all other datagrams from one peer
+// are sent to the other one without changes.
+class UdpRelay
+{
+public:
+    class Delegate
+    {
+    public:
+        virtual ~Delegate() = default;
+
+        // Returns the decrypted secret of the peer or an empty array if the key is not valid.
+        virtual base::ByteArray udpPeerSecret(const proto::PeerToRelay& message) = 0;
+
+        virtual void onUdpSessionStarted(uint32_t key_id) = 0;
+        virtual void onUdpSessionFinished() = 0;
+    };
+
+    enum Status : uint8_t
+    {
+        WAITING = 0,
+        PAIRED = 1
+    };
+
+    static constexpr size_t kHelloMarkerSize = 8;
+    static const uint8_t kHelloMarker[kHelloMarkerSize];
+
+    UdpRelay(const asio::ip::address& listen_address,
+             uint16_t port,
+             const std::chrono::minutes& idle_timeout);
+    ~UdpRelay();
+
+    // Returns false if the port can not be bound.
+    bool start(Delegate* delegate);
+
+    // Bindings without datagrams for this time are removed.
+    void setIdleTimeout(const std::chrono::minutes& idle_timeout) { idle_timeout_ = idle_timeout; }
+
+    size_t sessionCount() const { return session_count_; }
+    int64_t bytesTransferred() const { return bytes_transferred_; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    using TimePoint = std::chrono::time_point<Clock>;
+    using Endpoint = asio::ip::udp::endpoint;
+
+    struct Binding
+    {
+        std::string pair_key;
+        uint32_t key_id = 0;
+        Endpoint endpoint[2];
+        size_t peer_count = 0;
+        TimePoint start_time;
+        TimePoint last_activity;
+    };
+
+    struct EndpointHash
+    {
+        size_t operator()(const Endpoint& endpoint) const;
+    };
+
+    // A received datagram. |data| points to the receive buffer, it is null for a truncated one.
+    struct Datagram
+    {
+        Endpoint endpoint;
+        uint8_t* data = nullptr;
+        size_t size = 0;
+    };
+
+    void doWait();
+    void onReadable();
+    size_t receiveBatch();
+    void sendBatch();
+    void onDatagram(size_t index);
+    void onHello(const Datagram& datagram);
+    void sendStatus(const Endpoint& endpoint, Status status);
+    void doSweep();
+    void removeBinding(Binding* binding);
+
+    asio::ip::udp::socket socket_;
+    asio::high_resolution_timer sweep_timer_;
+    const asio::ip::address listen_address_;
+    const uint16_t port_;
+    std::chrono::minutes idle_timeout_;
+    Delegate* delegate_ = nullptr;
+
+    // Bindings by the pair key and by the endpoints of their peers.
+    std::unordered_map<std::string, Binding> bindings_;
+    std::unordered_map<Endpoint, Binding*, EndpointHash> endpoints_;
+
+    // Receive buffers of one batch. The datagrams are forwarded from them without copying.
+    base::ByteArray receive_buffer_;
+    std::vector<Datagram> received_;
+
+    // Datagrams of the current batch which are sent: the index in |received_| and the target.
+    std::vector<std::pair<size_t, Endpoint>> outgoing_;
+
+    TimePoint now_;
+    size_t session_count_ = 0;
+    int64_t bytes_transferred_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(UdpRelay);
+};
+
+} // namespace relay
+
+#endif // RELAY_UDP_RELAY_H
@@ -0,0 +1,217 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/command_line.h"
+#include "base/logging.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/unicode.h"
+#include "router/session_host.h"
+#include "router/session_map.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+const unsigned int kDefaultMaxHosts = 100000;
+const unsigned int kDefaultRequests = 100000;
+const unsigned int kMinHosts = 1000;
+const unsigned int kMaxHosts = 10000000;
+
+// The linear scan is slow for large maps, so it is measured with fewer requests.
+const unsigned int kMaxLinearRequests = 1000;
+
+void showHelp()
+{
+    std::cout << "aspia_router_bench [switch]" << std::endl
+        << "Available switches:" << std::endl
+        << '\t' << "--max-hosts=N" << '\t' << "Maximum number of online hosts (100000)"
+        << std::endl
+        << '\t' << "--requests=N" << '\t' << "Number of requests for each measurement (100000)"
+        << std::endl
+        << '\t' << "--help" << '\t' << "Show help" << std::endl;
+}
+
+bool readSwitch(const base::CommandLine& command_line, std::u16string_view name,
+                unsigned int min_value, unsigned int max_value, unsigned int* value)
+{
+    if (!command_line.hasSwitch(name))
+        return true;
+
+    unsigned int result;
+    if (!base::stringToUint(command_line.switchValue(name), &result) ||
+        result < min_value || result > max_value)
+    {
+        std::cout << "Invalid value of switch --" << base::utf8FromUtf16(name) << std::endl;
+        return false;
+    }
+
+    *value = result;
+    return true;
+}
+
+template <class Function>
+double measure(unsigned int requests, Function function)
+{
+    Clock::time_point start_time = Clock::now();
+
+    for (unsigned int i = 0; i < requests; ++i)
+        function();
+
+    std::chrono::nanoseconds time = Clock::now() - start_time;
+    return static_cast<double>(time.count()) / static_cast<double>(requests);
+}
+
+// The lookup that the server used before the sessions were indexed.
+router::SessionHost* linearHostSession(const std::vector<router::Session*>& sessions,
+                                       base::HostId host_id)
+{
+    for (router::Session* session : sessions)
+    {
+        if (session->sessionType() == proto::ROUTER_SESSION_HOST &&
+            static_cast<router::SessionHost*>(session)->hasHostId(host_id))
+        {
+            return static_cast<router::SessionHost*>(session);
+        }
+    }
+
+    return nullptr;
+}
+
+void runBenchmark(unsigned int host_count, unsigned int requests, std::mt19937* random)
+{
+    router::SessionMap sessions;
+    std::vector<router::Session*> linear_sessions;
+    std::vector<router::Session::SessionId> session_ids;
+
+    linear_sessions.reserve(host_count);
+    session_ids.reserve(host_count);
+
+    base::HostId last_host_id = 0;
+
+    auto add_host = [&]()
+    {
+        std::unique_ptr<router::SessionHost> session = std::make_unique<router::SessionHost>();
+        router::SessionHost* session_ptr = session.get();
+        base::HostId host_id = ++last_host_id;
+
+        session_ptr->addHostId(host_id);
+        sessions.add(std::move(session));
+        sessions.addHostId(session_ptr, host_id);
+
+        return session_ptr;
+    };
+
+    for (unsigned int i = 0; i < host_count; ++i)
+    {
+        router::SessionHost* session = add_host();
+        linear_sessions.emplace_back(session);
+        session_ids.emplace_back(session->sessionId());
+    }
+
+    std::uniform_int_distribution<size_t> index(0, host_count - 1);
+    size_t found = 0;
+
+    // Connection offers of clients look up a host by its ID.
+    double host_lookup = measure(requests, [&]()
+    {
+        found += sessions.hostSession(static_cast<base::HostId>(index(*random)) + 1) != nullptr;
+    });
+
+    // Finished sessions, admin requests and the relay keys look up a session by its ID.
+    double session_lookup = measure(requests, [&]()
+    {
+        found += sessions.session(session_ids[index(*random)]) != nullptr;
+    });
+
+    const unsigned int linear_requests = std::min(requests, kMaxLinearRequests);
+    double linear_lookup = measure(linear_requests, [&]()
+    {
+        found += linearHostSession(
+            linear_sessions, static_cast<base::HostId>(index(*random)) + 1) != nullptr;
+    });
+
+    // Hosts disconnect and reconnect with new sessions.
+    double churn = measure(requests, [&]()
+    {
+        size_t i = index(*random);
+        sessions.take(session_ids[i]);
+        session_ids[i] = add_host()->sessionId();
+    });
+
+    if (found != requests * 2 + linear_requests)
+        std::cout << "Some lookups failed" << std::endl;
+
+    std::cout << std::setw(10) << host_count
+              << std::setw(16) << host_lookup
+              << std::setw(16) << session_lookup
+              << std::setw(16) << churn
+              << std::setw(16) << linear_lookup << std::endl;
+}
+
+} // namespace
+
+int main(int argc, const char* const* argv)
+{
+    base::initLogging();
+
+    base::CommandLine::init(argc, argv);
+    base::CommandLine* command_line = base::CommandLine::forCurrentProcess();
+
+    if (command_line->hasSwitch(u"help"))
+    {
+        showHelp();
+        return 0;
+    }
+
+    unsigned int max_hosts = kDefaultMaxHosts;
+    unsigned int requests = kDefaultRequests;
+
+    if (!readSwitch(*command_line, u"max-hosts", kMinHosts, kMaxHosts, &max_hosts) ||
+        !readSwitch(*command_line, u"requests", 1, kMaxHosts, &requests))
+    {
+        showHelp();
+        return 1;
+    }
+
+    std::mt19937 random(12345);
+
+    std::cout << "Average time of a request in nanoseconds" << std::endl
+              << std::setw(10) << "Hosts"
+              << std::setw(16) << "Host lookup"
+              << std::setw(16) << "Session lookup"
+              << std::setw(16) << "Reconnect"
+              << std::setw(16) << "Linear lookup" << std::endl;
+
+    std::cout << std::fixed << std::setprecision(1);
+
+    for (unsigned int host_count = kMinHosts; host_count <= max_hosts; host_count *= 10)
+    {
+        runBenchmark(host_count, requests, &random);
+
+        if (host_count > max_hosts / 10 && host_count != max_hosts)
+            runBenchmark(max_hosts, requests, &random);
+    }
+
+    base::shutdownLogging();
+    return 0;
+}
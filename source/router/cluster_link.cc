@@ -0,0 +1,221 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "router/cluster_link.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+#include "base/peer/client_authenticator.h"
+#include "base/strings/unicode.h"
+#include "proto/router_common.pb.h"
+
+namespace router {
+
+namespace {
+
+const std::chrono::seconds kReconnectTimeout { 15 };
+
+// Host changes that come during this time are sent in one message.
+const std::chrono::seconds kPresenceDelay { 1 };
+
+} // namespace
+
+ClusterLink::ClusterLink(std::shared_ptr<base::TaskRunner> task_runner,
+                         const base::Address& address,
+                         const std::u16string& user_name,
+                         const std::u16string& password,
+                         Delegate* delegate)
+    : task_runner_(task_runner),
+      address_(address),
+      user_name_(user_name),
+      password_(password),
+      delegate_(delegate),
+      reconnect_timer_(base::WaitableTimer::Type::SINGLE_SHOT, task_runner),
+      presence_timer_(base::WaitableTimer::Type::SINGLE_SHOT, task_runner)
+{
+    LOG(LS_INFO) << "Ctor (" << address_.toString() << ")";
+    DCHECK(task_runner_ && delegate_);
+}
+
+ClusterLink::~ClusterLink()
+{
+    LOG(LS_INFO) << "Dtor (" << address_.toString() << ")";
+}
+
+void ClusterLink::start()
+{
+    connect();
+}
+
+void ClusterLink::addHost(base::HostId host_id, const std::string& address)
+{
+    if (!is_connected_)
+        return;
+
+    pending_offline_.erase(host_id);
+    pending_online_[host_id] = address;
+
+    if (!presence_timer_.isActive())
+        presence_timer_.start(kPresenceDelay, std::bind(&ClusterLink::sendPresence, this));
+}
+
+void ClusterLink::removeHost(base::HostId host_id)
+{
+    if (!is_connected_)
+        return;
+
+    pending_online_.erase(host_id);
+    pending_offline_.insert(host_id);
+
+    if (!presence_timer_.isActive())
+        presence_timer_.start(kPresenceDelay, std::bind(&ClusterLink::sendPresence, this));
+}
+
+void ClusterLink::onTcpConnected()
+{
+    LOG(LS_INFO) << "Connection to the router " << address_.toString() << " is established";
+
+    channel_->setKeepAlive(true);
+    channel_->setNoDelay(true);
+
+    authenticator_ = std::make_unique<base::ClientAuthenticator>(task_runner_);
+
+    authenticator_->setIdentify(proto::IDENTIFY_SRP);
+    authenticator_->setUserName(user_name_);
+    authenticator_->setPassword(password_);
+    authenticator_->setSessionType(proto::ROUTER_SESSION_CLUSTER);
+
+    authenticator_->start(std::move(channel_),
+                          [this](base::ClientAuthenticator::ErrorCode error_code)
+    {
+        if (error_code == base::ClientAuthenticator::ErrorCode::SUCCESS)
+        {
+            // The authenticator takes the listener on itself, we return the receipt of
+            // notifications.
+            channel_ = authenticator_->takeChannel();
+            channel_->setListener(this);
+            channel_->setChannelIdSupport(true);
+
+            LOG(LS_INFO) << "Authentication on the router " << address_.toString()
+                         << " complete";
+
+            // Now the session will receive incoming messages.
+            channel_->resume();
+            is_connected_ = true;
+
+            // The other router replaces the hosts of this router with the full list.
+            proto::ClusterMessage message;
+            proto::HostPresence* presence = message.mutable_host_presence();
+            presence->set_is_full(true);
+            delegate_->onClusterLinkHosts(presence);
+
+            LOG(LS_INFO) << "Sending " << presence->online_size() << " hosts to the router "
+                         << address_.toString();
+            channel_->send(proto::ROUTER_CHANNEL_ID_SESSION, base::serialize(message));
+        }
+        else
+        {
+            LOG(LS_WARNING) << "Authentication on the router " << address_.toString()
+                            << " failed: " << base::ClientAuthenticator::errorToString(error_code);
+            delayedConnect();
+        }
+
+        // Authenticator is no longer needed.
+        task_runner_->deleteSoon(std::move(authenticator_));
+    });
+}
+
+void ClusterLink::onTcpDisconnected(base::NetworkChannel::ErrorCode error_code)
+{
+    LOG(LS_INFO) << "The connection to the router " << address_.toString() << " has been lost: "
+                 << base::NetworkChannel::errorToString(error_code);
+
+    is_connected_ = false;
+    presence_timer_.stop();
+    pending_online_.clear();
+    pending_offline_.clear();
+
+    delayedConnect();
+}
+
+void ClusterLink::onTcpMessageReceived(uint8_t /* channel_id */, const base::ByteArray& buffer)
+{
+    proto::ClusterMessage message;
+    if (!base::parse(buffer, &message))
+    {
+        LOG(LS_ERROR) << "Invalid message from router " << address_.toString();
+        return;
+    }
+
+    if (message.has_connection_offer())
+    {
+        delegate_->onClusterLinkOffer(message.connection_offer());
+    }
+    else
+    {
+        LOG(LS_WARNING) << "Unhandled message from router " << address_.toString();
+    }
+}
+
+void ClusterLink::onTcpMessageWritten(uint8_t /* channel_id */, size_t /* pending */)
+{
+    // Nothing
+}
+
+void ClusterLink::connect()
+{
+    LOG(LS_INFO) << "Connecting to router " << address_.toString() << "...";
+
+    channel_ = std::make_unique<base::TcpChannel>();
+    channel_->setListener(this);
+    channel_->connect(address_.host(), address_.port());
+}
+
+void ClusterLink::delayedConnect()
+{
+    LOG(LS_INFO) << "Reconnect after " << kReconnectTimeout.count() << " seconds";
+    reconnect_timer_.start(kReconnectTimeout, std::bind(&ClusterLink::connect, this));
+}
+
+void ClusterLink::sendPresence()
+{
+    if (!is_connected_ || !channel_)
+        return;
+
+    proto::ClusterMessage message;
+    proto::HostPresence* presence = message.mutable_host_presence();
+
+    for (const auto& host_id : pending_offline_)
+        presence->add_offline_host_id(host_id);
+
+    for (const auto& host : pending_online_)
+    {
+        proto::ClusterHost* item = presence->add_online();
+        item->set_host_id(host.first);
+        item->set_address(host.second);
+    }
+
+    LOG(LS_INFO) << "Sending host changes to the router " << address_.toString() << " (online: "
+                 << pending_online_.size() << ", offline: " << pending_offline_.size() << ")";
+
+    pending_online_.clear();
+    pending_offline_.clear();
+
+    channel_->send(proto::ROUTER_CHANNEL_ID_SESSION, base::serialize(message));
+}
+
+} // namespace router
@@ -0,0 +1,99 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef ROUTER_CLUSTER_LINK_H
+#define ROUTER_CLUSTER_LINK_H
+
+#include "base/waitable_timer.h"
+#include "base/net/address.h"
+#include "base/net/tcp_channel.h"
+#include "base/peer/host_id.h"
+#include "proto/router_cluster.pb.h"
+
+#include <map>
+#include <set>
+
+namespace base {
+class ClientAuthenticator;
+} // namespace base
+
+namespace router {
+
+// Connection to another router of the cluster. Announces the hosts of this router to it and
+// receives the connection offers for these hosts. The connection is restored after errors.
+class ClusterLink : public base::TcpChannel::Listener
+{
+public:
+    class Delegate
+    {
+    public:
+        virtual ~Delegate() = default;
+
+        // Adds all hosts of this router to |presence|.
+        virtual void onClusterLinkHosts(proto::HostPresence* presence) = 0;
+
+        virtual void onClusterLinkOffer(const proto::ConnectionOffer& offer) = 0;
+    };
+
+    ClusterLink(std::shared_ptr<base::TaskRunner> task_runner,
+                const base::Address& address,
+                const std::u16string& user_name,
+                const std::u16string& password,
+                Delegate* delegate);
+    ~ClusterLink() override;
+
+    void start();
+
+    // Changes are sent in batches. While there is no connection they are not needed, because all
+    // hosts are sent after connecting.
+    void addHost(base::HostId host_id, const std::string& address);
+    void removeHost(base::HostId host_id);
+
+protected:
+    // base::TcpChannel::Listener implementation.
+    void onTcpConnected() override;
+    void onTcpDisconnected(base::NetworkChannel::ErrorCode error_code) override;
+    void onTcpMessageReceived(uint8_t channel_id, const base::ByteArray& buffer) override;
+    void onTcpMessageWritten(uint8_t channel_id, size_t pending) override;
+
+private:
+    void connect();
+    void delayedConnect();
+    void sendPresence();
+
+    std::shared_ptr<base::TaskRunner> task_runner_;
+    const base::Address address_;
+    const std::u16string user_name_;
+    const std::u16string password_;
+    Delegate* delegate_;
+
+    std::unique_ptr<base::TcpChannel> channel_;
+    std::unique_ptr<base::ClientAuthenticator> authenticator_;
+    base::WaitableTimer reconnect_timer_;
+    base::WaitableTimer presence_timer_;
+    bool is_connected_ = false;
+
+    // Changes that are not sent yet. A host is in one of the lists only.
+    std::map<base::HostId, std::string> pending_online_;
+    std::set<base::HostId> pending_offline_;
+
+    DISALLOW_COPY_AND_ASSIGN(ClusterLink);
+};
+
+} // namespace router
+
+#endif // ROUTER_CLUSTER_LINK_H
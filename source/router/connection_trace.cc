@@ -0,0 +1,137 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "router/connection_trace.h"
+
+#include "base/logging.h"
+#include "base/crypto/random.h"
+#include "proto/router_admin.pb.h"
+
+#include <algorithm>
+
+namespace router {
+
+ConnectionTrace::ConnectionTrace()
+    : trace_id_(base::Random::number64()),
+      start_time_(Clock::now()),
+      last_time_(start_time_)
+{
+    // Nothing
+}
+
+void ConnectionTrace::endSpan(Span span)
+{
+    const size_t index = static_cast<size_t>(span);
+    DCHECK_LT(index, kSpanCount);
+
+    const Clock::time_point now = Clock::now();
+    durations_[index] = std::chrono::duration_cast<Duration>(now - last_time_);
+    last_time_ = now;
+}
+
+std::optional<ConnectionTrace::Duration> ConnectionTrace::duration(Span span) const
+{
+    return durations_[static_cast<size_t>(span)];
+}
+
+ConnectionTrace::Duration ConnectionTrace::total() const
+{
+    return std::chrono::duration_cast<Duration>(last_time_ - start_time_);
+}
+
+std::string ConnectionTrace::toString() const
+{
+    std::string result;
+
+    for (size_t i = 0; i < kSpanCount; ++i)
+    {
+        if (!durations_[i].has_value())
+            continue;
+
+        result += spanName(static_cast<Span>(i));
+        result += ": " + std::to_string(durations_[i]->count()) + "us, ";
+    }
+
+    result += "total: " + std::to_string(total().count()) + "us";
+    return result;
+}
+
+// static
+const char* ConnectionTrace::spanName(Span span)
+{
+    switch (span)
+    {
+        case Span::HOST_LOOKUP:
+            return "host_lookup";
+
+        case Span::RELAY_CREDENTIALS:
+            return "relay_credentials";
+
+        case Span::HOST_OFFER:
+            return "host_offer";
+
+        case Span::CLIENT_OFFER:
+            return "client_offer";
+
+        default:
+            return "unknown";
+    }
+}
+
+void ConnectionTraceStats::SpanStats::add(ConnectionTrace::Duration duration)
+{
+    ++count;
+    total_time += duration;
+    max_time = std::max(max_time, duration);
+}
+
+void ConnectionTraceStats::add(const ConnectionTrace& trace)
+{
+    ++request_count_;
+
+    for (size_t i = 0; i < ConnectionTrace::kSpanCount; ++i)
+    {
+        std::optional<ConnectionTrace::Duration> duration =
+            trace.duration(static_cast<ConnectionTrace::Span>(i));
+        if (duration.has_value())
+            spans_[i].add(*duration);
+    }
+
+    total_.add(trace.total());
+}
+
+void ConnectionTraceStats::toProto(proto::ConnectionStats* stats) const
+{
+    stats->set_request_count(request_count_);
+
+    auto add_span = [stats](const char* name, const SpanStats& span_stats)
+    {
+        proto::ConnectionStats::Span* span = stats->add_span();
+        span->set_name(name);
+        span->set_count(span_stats.count);
+        span->set_total_time(static_cast<uint64_t>(span_stats.total_time.count()));
+        span->set_max_time(static_cast<uint64_t>(span_stats.max_time.count()));
+    };
+
+    for (size_t i = 0; i < ConnectionTrace::kSpanCount; ++i)
+        add_span(ConnectionTrace::spanName(static_cast<ConnectionTrace::Span>(i)), spans_[i]);
+
+    add_span("total", total_);
+}
+
+} // namespace router
@@ -0,0 +1,101 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef ROUTER_CONNECTION_TRACE_H
+#define ROUTER_CONNECTION_TRACE_H
+
+#include <array>
+#include <chrono>
+#include <optional>
+#include <string>
+
+namespace proto {
+class ConnectionStats;
+} // namespace proto
+
+namespace router {
+
+// Times of the steps of one connection request. The steps follow each other, so each span starts
+// where the previous one ended. The trace ID is sent in the offer and in the relay secret, so the
+// logs of the relay and the peers can be matched with the log of the router.
+class ConnectionTrace
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using Duration = std::chrono::microseconds;
+
+    enum class Span
+    {
+        HOST_LOOKUP,       // Search for the host session.
+        RELAY_CREDENTIALS, // Credentials from the key pool.
+        HOST_OFFER,        // Offer to the host or to the router of the host.
+        CLIENT_OFFER       // Offer to the client.
+    };
+
+    static const size_t kSpanCount = 4;
+
+    ConnectionTrace();
+
+    uint64_t traceId() const { return trace_id_; }
+
+    // Ends |span| at the current time.
+    void endSpan(Span span);
+
+    // Returns std::nullopt if the span was not reached.
+    std::optional<Duration> duration(Span span) const;
+    Duration total() const;
+
+    // Returns the durations of the reached spans for the log.
+    std::string toString() const;
+
+    static const char* spanName(Span span);
+
+private:
+    const uint64_t trace_id_;
+    const Clock::time_point start_time_;
+    Clock::time_point last_time_;
+    std::array<std::optional<Duration>, kSpanCount> durations_;
+};
+
+// Summary of the connection traces for the admin sessions.
+class ConnectionTraceStats
+{
+public:
+    ConnectionTraceStats() = default;
+
+    void add(const ConnectionTrace& trace);
+    void toProto(proto::ConnectionStats* stats) const;
+
+private:
+    struct SpanStats
+    {
+        uint64_t count = 0;
+        ConnectionTrace::Duration total_time { 0 };
+        ConnectionTrace::Duration max_time { 0 };
+
+        void add(ConnectionTrace::Duration duration);
+    };
+
+    uint64_t request_count_ = 0;
+    std::array<SpanStats, ConnectionTrace::kSpanCount> spans_;
+    SpanStats total_;
+};
+
+} // namespace router
+
+#endif // ROUTER_CONNECTION_TRACE_H
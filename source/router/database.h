@@ -22,6 +22,8 @@
 #include "base/peer/host_id.h"
 #include "base/peer/user_list.h"
 
+#include <optional>
+
 namespace router {
 
 class Database
@@ -43,6 +45,27 @@ public:
     virtual base::User findUser(std::u16string_view username) = 0;
     virtual ErrorCode hostId(const base::ByteArray& key_hash, base::HostId* host_id) const = 0;
     virtual bool addHost(const base::ByteArray& key_hash) = 0;
+
+    struct Host
+    {
+        base::HostId host_id;
+        base::ByteArray key_hash;
+    };
+
+    // Adds hosts with the specified IDs in one transaction.
+    virtual bool addHosts(const std::vector<Host>& hosts) = 0;
+
+    // Returns the largest ID of the added hosts or zero if there are no hosts.
+    virtual std::optional<base::HostId> lastHostId() const = 0;
+
+    // Reserves |count| IDs for the hosts that are added later with addHosts(). The reservation is
+    // stored in the database before the IDs are returned, so they are not given out again after a
+    // restart or by another router. The IDs that are not used are skipped. Returns false if the
+    // database cannot reserve IDs, then the hosts must be added with addHost().
+    virtual bool reserveHostIds(size_t /* count */, std::vector<base::HostId>* /* host_ids */)
+    {
+        return false;
+    }
 };
 
 } // namespace router
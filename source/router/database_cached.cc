@@ -0,0 +1,304 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "router/database_cached.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+
+#include <algorithm>
+
+namespace router {
+
+namespace {
+
+// New hosts are written at most after this delay. During a reconnect storm, many hosts get their
+// IDs with one transaction instead of one transaction per host.
+const std::chrono::seconds kFlushDelay { 1 };
+const size_t kMaxPendingHosts = 256;
+
+// The index is not filled by lookups beyond this size. About 150 bytes per entry.
+const size_t kMaxIndexSize = 1000000;
+
+// Writes the hosts in one transaction. If it fails, the hosts are written one by one, so that a
+// host whose ID or key is already in the database does not block the others. Returns the hosts
+// that are not written.
+std::vector<Database::Host> writeHosts(Database* database, const std::vector<Database::Host>& hosts)
+{
+    if (database->addHosts(hosts))
+        return {};
+
+    if (hosts.size() == 1)
+        return hosts;
+
+    std::vector<Database::Host> failed_hosts;
+
+    for (const Database::Host& host : hosts)
+    {
+        if (!database->addHosts({ host }))
+            failed_hosts.push_back(host);
+    }
+
+    return failed_hosts;
+}
+
+} // namespace
+
+DatabaseCached::DatabaseCached(std::shared_ptr<base::TaskRunner> task_runner,
+                               std::unique_ptr<Database> database,
+                               std::shared_ptr<Database> writer,
+                               std::shared_ptr<base::TaskRunner> writer_task_runner)
+    : task_runner_(task_runner),
+      database_(std::move(database)),
+      writer_(std::move(writer)),
+      writer_task_runner_(std::move(writer_task_runner)),
+      self_(std::make_shared<DatabaseCached*>(this)),
+      flush_timer_(base::WaitableTimer::Type::SINGLE_SHOT, std::move(task_runner))
+{
+    DCHECK(database_);
+    DCHECK(!writer_ || writer_task_runner_);
+}
+
+DatabaseCached::~DatabaseCached()
+{
+    *self_ = nullptr;
+
+    // A batch that is being written is finished by the writer. The rest is written here.
+    writePendingHosts();
+}
+
+bool DatabaseCached::flush()
+{
+    if (!writer_)
+        return writePendingHosts();
+
+    flush_timer_.stop();
+
+    // The hosts added during the write are written after it.
+    if (!pending_hosts_.empty() && !is_writing_)
+        startWriting();
+
+    return true;
+}
+
+bool DatabaseCached::writePendingHosts()
+{
+    flush_timer_.stop();
+
+    if (pending_hosts_.empty())
+        return true;
+
+    std::vector<Host> failed_hosts = writeHosts(database_.get(), pending_hosts_);
+
+    LOG(LS_INFO) << "Written hosts: " << pending_hosts_.size() - failed_hosts.size();
+    pending_hosts_.clear();
+
+    removeFailedHosts(failed_hosts);
+    return failed_hosts.empty();
+}
+
+void DatabaseCached::startWriting()
+{
+    is_writing_ = true;
+
+    std::vector<Host> hosts;
+    hosts.swap(pending_hosts_);
+
+    writer_task_runner_->postTask(
+        [writer = writer_, task_runner = task_runner_, self = self_, hosts = std::move(hosts)]()
+    {
+        std::vector<Host> failed_hosts = writeHosts(writer.get(), hosts);
+
+        task_runner->postTask(
+            [self, count = hosts.size(), failed_hosts = std::move(failed_hosts)]() mutable
+        {
+            if (*self)
+                (*self)->onHostsWritten(count, std::move(failed_hosts));
+        });
+    });
+}
+
+void DatabaseCached::onHostsWritten(size_t count, std::vector<Host> failed_hosts)
+{
+    is_writing_ = false;
+
+    LOG(LS_INFO) << "Written hosts: " << count - failed_hosts.size();
+    removeFailedHosts(failed_hosts);
+
+    if (pending_hosts_.size() >= kMaxPendingHosts)
+        startWriting();
+    else if (!pending_hosts_.empty() && !flush_timer_.isActive())
+        flush_timer_.start(kFlushDelay, std::bind(&DatabaseCached::flush, this));
+}
+
+void DatabaseCached::removeFailedHosts(const std::vector<Host>& failed_hosts)
+{
+    if (failed_hosts.empty())
+        return;
+
+    LOG(LS_ERROR) << "Failed to write " << failed_hosts.size() << " hosts";
+
+    // The hosts are not retried. The next lookup goes to the database, which either finds the
+    // host added by someone else or lets it be added again with a new ID.
+    for (const Host& host : failed_hosts)
+    {
+        auto it = host_index_.find(base::toStdString(host.key_hash));
+        if (it != host_index_.end() && it->second == host.host_id)
+            host_index_.erase(it);
+    }
+}
+
+void DatabaseCached::setUserCacheEnabled(bool enable)
+{
+    user_cache_enabled_ = enable;
+    users_.clear();
+}
+
+std::vector<base::User> DatabaseCached::userList() const
+{
+    return database_->userList();
+}
+
+bool DatabaseCached::addUser(const base::User& user)
+{
+    users_.clear();
+    return database_->addUser(user);
+}
+
+bool DatabaseCached::modifyUser(const base::User& user)
+{
+    // The name of the user may be changed, so the whole cache is dropped.
+    users_.clear();
+    return database_->modifyUser(user);
+}
+
+bool DatabaseCached::removeUser(int64_t entry_id)
+{
+    users_.clear();
+    return database_->removeUser(entry_id);
+}
+
+base::User DatabaseCached::findUser(std::u16string_view username)
+{
+    if (!user_cache_enabled_)
+        return database_->findUser(username);
+
+    auto it = users_.find(username);
+    if (it != users_.end())
+        return it->second;
+
+    base::User user = database_->findUser(username);
+
+    // Unknown users are not cached. Otherwise, every mistyped name would stay in memory.
+    if (user.isValid())
+        users_.emplace(std::u16string(username), user);
+
+    return user;
+}
+
+Database::ErrorCode DatabaseCached::hostId(
+    const base::ByteArray& key_hash, base::HostId* host_id) const
+{
+    if (key_hash.empty() || !host_id)
+        return database_->hostId(key_hash, host_id);
+
+    auto it = host_index_.find(base::toStdString(key_hash));
+    if (it != host_index_.end())
+    {
+        *host_id = it->second;
+        return ErrorCode::SUCCESS;
+    }
+
+    ErrorCode error_code = database_->hostId(key_hash, host_id);
+    if (error_code == ErrorCode::SUCCESS)
+        addToIndex(key_hash, *host_id);
+
+    return error_code;
+}
+
+bool DatabaseCached::addHost(const base::ByteArray& key_hash)
+{
+    if (key_hash.empty())
+        return database_->addHost(key_hash);
+
+    if (reserved_host_ids_.empty())
+    {
+        std::vector<base::HostId> host_ids;
+
+        // Without the reserved IDs, new IDs cannot be assigned here.
+        if (!database_->reserveHostIds(kMaxPendingHosts, &host_ids) || host_ids.empty())
+            return database_->addHost(key_hash);
+
+        reserved_host_ids_.assign(host_ids.begin(), host_ids.end());
+    }
+
+    const base::HostId host_id = reserved_host_ids_.front();
+    reserved_host_ids_.pop_front();
+
+    // The new host must always be found, even if the index is full.
+    host_index_.emplace(base::toStdString(key_hash), host_id);
+    pending_hosts_.push_back({ host_id, key_hash });
+
+    if (pending_hosts_.size() >= kMaxPendingHosts)
+        flush();
+    else if (!flush_timer_.isActive())
+        flush_timer_.start(kFlushDelay, std::bind(&DatabaseCached::flush, this));
+
+    return true;
+}
+
+bool DatabaseCached::addHosts(const std::vector<Host>& hosts)
+{
+    if (!flush() || !database_->addHosts(hosts))
+        return false;
+
+    for (const Host& host : hosts)
+        addToIndex(host.key_hash, host.host_id);
+
+    // The added IDs can be in the reserved block. The next block is reserved after them.
+    reserved_host_ids_.clear();
+    return true;
+}
+
+std::optional<base::HostId> DatabaseCached::lastHostId() const
+{
+    std::optional<base::HostId> host_id = database_->lastHostId();
+    if (!host_id.has_value())
+        return std::nullopt;
+
+    // The pending hosts are not in the database yet.
+    for (const Host& host : pending_hosts_)
+        host_id = std::max(*host_id, host.host_id);
+
+    return host_id;
+}
+
+bool DatabaseCached::reserveHostIds(size_t count, std::vector<base::HostId>* host_ids)
+{
+    return database_->reserveHostIds(count, host_ids);
+}
+
+void DatabaseCached::addToIndex(const base::ByteArray& key_hash, base::HostId host_id) const
+{
+    if (host_index_.size() >= kMaxIndexSize)
+        return;
+
+    host_index_.emplace(base::toStdString(key_hash), host_id);
+}
+
+} // namespace router
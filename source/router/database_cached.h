@@ -0,0 +1,102 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef ROUTER_DATABASE_CACHED_H
+#define ROUTER_DATABASE_CACHED_H
+
+#include "base/macros_magic.h"
+#include "base/waitable_timer.h"
+#include "router/database.h"
+
+#include <deque>
+#include <map>
+#include <unordered_map>
+
+namespace router {
+
+// Database decorator that keeps the host IDs and users in memory. New hosts get their IDs
+// immediately from a block reserved in the underlying database and are written to it in batches.
+// A host that cannot be written is dropped from the cache and gets a new ID when it connects again.
+// All methods must be called on the thread of |task_runner|.
+class DatabaseCached : public Database
+{
+public:
+    // If |writer| is set, then the batches of new hosts are written with it on the thread of
+    // |writer_task_runner| and the thread of |task_runner| does not wait for the database.
+    DatabaseCached(std::shared_ptr<base::TaskRunner> task_runner,
+                   std::unique_ptr<Database> database,
+                   std::shared_ptr<Database> writer = nullptr,
+                   std::shared_ptr<base::TaskRunner> writer_task_runner = nullptr);
+    ~DatabaseCached() override;
+
+    // Writes the pending hosts to the underlying database. With the writer, only starts the
+    // write and returns true.
+    bool flush();
+
+    // The users can be cached only if they are changed through this instance. If the database is
+    // shared with other routers, the cache must be disabled. By default, it is enabled.
+    void setUserCacheEnabled(bool enable);
+
+    // Database implementation.
+    std::vector<base::User> userList() const override;
+    bool addUser(const base::User& user) override;
+    bool modifyUser(const base::User& user) override;
+    bool removeUser(int64_t entry_id) override;
+    base::User findUser(std::u16string_view username) override;
+    ErrorCode hostId(const base::ByteArray& key_hash, base::HostId* host_id) const override;
+    bool addHost(const base::ByteArray& key_hash) override;
+    bool addHosts(const std::vector<Host>& hosts) override;
+    std::optional<base::HostId> lastHostId() const override;
+    bool reserveHostIds(size_t count, std::vector<base::HostId>* host_ids) override;
+
+private:
+    bool writePendingHosts();
+    void startWriting();
+    void onHostsWritten(size_t count, std::vector<Host> failed_hosts);
+    void removeFailedHosts(const std::vector<Host>& failed_hosts);
+    void addToIndex(const base::ByteArray& key_hash, base::HostId host_id) const;
+
+    std::shared_ptr<base::TaskRunner> task_runner_;
+    std::unique_ptr<Database> database_;
+
+    std::shared_ptr<Database> writer_;
+    std::shared_ptr<base::TaskRunner> writer_task_runner_;
+    bool is_writing_ = false;
+
+    // Reset in the destructor. The results of the writes that finish later are ignored.
+    std::shared_ptr<DatabaseCached*> self_;
+
+    // Key hash to host ID. The index is filled by lookups and new hosts.
+    mutable std::unordered_map<std::string, base::HostId> host_index_;
+
+    // Hosts that are in the index but not yet in the underlying database.
+    std::vector<Host> pending_hosts_;
+    base::WaitableTimer flush_timer_;
+
+    // IDs reserved in the underlying database and not given to hosts yet.
+    std::deque<base::HostId> reserved_host_ids_;
+
+    bool user_cache_enabled_ = true;
+    std::map<std::u16string, base::User, std::less<>> users_;
+
+    DISALLOW_COPY_AND_ASSIGN(DatabaseCached);
+};
+
+} // namespace router
+
+#endif // ROUTER_DATABASE_CACHED_H
@@ -0,0 +1,72 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "router/database_factory.h"
+
+#include "base/logging.h"
+#include "base/strings/unicode.h"
+#include "router/database_factory_sqlite.h"
+#include "router/settings.h"
+
+#if defined(USE_POSTGRESQL)
+#include "router/database_factory_postgresql.h"
+#endif // defined(USE_POSTGRESQL)
+
+namespace router {
+
+// static
+std::unique_ptr<DatabaseFactory> DatabaseFactory::create(const Settings& settings)
+{
+    const std::u16string type = settings.databaseType();
+
+    LOG(LS_INFO) << "Database type: " << type;
+
+    if (type == u"sqlite")
+    {
+        DatabaseSqlite::Synchronous synchronous;
+        if (!DatabaseSqlite::parseSynchronous(settings.databaseSynchronous(), &synchronous))
+        {
+            LOG(LS_ERROR) << "Invalid database synchronous mode";
+            return nullptr;
+        }
+
+        return std::make_unique<DatabaseFactorySqlite>(synchronous);
+    }
+
+    if (type == u"postgresql")
+    {
+#if defined(USE_POSTGRESQL)
+        const std::u16string connection = settings.databaseConnection();
+        if (connection.empty())
+        {
+            LOG(LS_ERROR) << "Empty database connection string";
+            return nullptr;
+        }
+
+        return std::make_unique<DatabaseFactoryPostgresql>(
+            base::utf8FromUtf16(connection), settings.databasePoolSize());
+#else
+        LOG(LS_ERROR) << "The router is built without PostgreSQL support";
+        return nullptr;
+#endif // defined(USE_POSTGRESQL)
+    }
+
+    LOG(LS_ERROR) << "Unknown database type: " << type;
+    return nullptr;
+}
+
+} // namespace router
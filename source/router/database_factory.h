@@ -24,14 +24,23 @@
 namespace router {
 
 class Database;
+class Settings;
 
 class DatabaseFactory
 {
 public:
     virtual ~DatabaseFactory() = default;
 
+    // Creates the factory of the backend selected in the settings. Returns nullptr if the
+    // settings are not valid.
+    static std::unique_ptr<DatabaseFactory> create(const Settings& settings);
+
     virtual std::unique_ptr<Database> createDatabase() const = 0;
     virtual std::unique_ptr<Database> openDatabase() const = 0;
+
+    // Returns true if the databases opened by the factory can be used on different threads at
+    // the same time.
+    virtual bool isConcurrent() const { return false; }
 };
 
 } // namespace router
@@ -0,0 +1,162 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "router/database_factory_cached.h"
+
+#include "base/logging.h"
+#include "base/threading/thread.h"
+#include "router/database_cached.h"
+
+namespace router {
+
+namespace {
+
+// Handle to the shared database. The callers own the returned database, but the connection and
+// the cache must outlive them.
+class DatabaseRef : public Database
+{
+public:
+    explicit DatabaseRef(std::shared_ptr<DatabaseCached> database)
+        : database_(std::move(database))
+    {
+        DCHECK(database_);
+    }
+
+    ~DatabaseRef() override = default;
+
+    std::vector<base::User> userList() const override
+    {
+        return database_->userList();
+    }
+
+    bool addUser(const base::User& user) override
+    {
+        return database_->addUser(user);
+    }
+
+    bool modifyUser(const base::User& user) override
+    {
+        return database_->modifyUser(user);
+    }
+
+    bool removeUser(int64_t entry_id) override
+    {
+        return database_->removeUser(entry_id);
+    }
+
+    base::User findUser(std::u16string_view username) override
+    {
+        return database_->findUser(username);
+    }
+
+    ErrorCode hostId(const base::ByteArray& key_hash, base::HostId* host_id) const override
+    {
+        return database_->hostId(key_hash, host_id);
+    }
+
+    bool addHost(const base::ByteArray& key_hash) override
+    {
+        return database_->addHost(key_hash);
+    }
+
+    bool addHosts(const std::vector<Host>& hosts) override
+    {
+        return database_->addHosts(hosts);
+    }
+
+    std::optional<base::HostId> lastHostId() const override
+    {
+        return database_->lastHostId();
+    }
+
+    bool reserveHostIds(size_t count, std::vector<base::HostId>* host_ids) override
+    {
+        return database_->reserveHostIds(count, host_ids);
+    }
+
+private:
+    std::shared_ptr<DatabaseCached> database_;
+
+    DISALLOW_COPY_AND_ASSIGN(DatabaseRef);
+};
+
+} // namespace
+
+DatabaseFactoryCached::DatabaseFactoryCached(std::shared_ptr<base::TaskRunner> task_runner,
+                                             std::unique_ptr<DatabaseFactory> factory)
+    : task_runner_(std::move(task_runner)),
+      factory_(std::move(factory))
+{
+    DCHECK(task_runner_ && factory_);
+}
+
+DatabaseFactoryCached::~DatabaseFactoryCached()
+{
+    database_.reset();
+
+    // The writes in progress are finished before the thread exits.
+    if (writer_thread_)
+        writer_thread_->stop();
+}
+
+std::unique_ptr<Database> DatabaseFactoryCached::createDatabase() const
+{
+    return factory_->createDatabase();
+}
+
+std::unique_ptr<Database> DatabaseFactoryCached::openDatabase() const
+{
+    if (!database_)
+    {
+        std::unique_ptr<Database> database = factory_->openDatabase();
+        if (!database)
+            return nullptr;
+
+        std::shared_ptr<Database> writer;
+        std::shared_ptr<base::TaskRunner> writer_task_runner;
+
+        if (factory_->isConcurrent())
+        {
+            writer = factory_->openDatabase();
+            if (!writer)
+            {
+                LOG(LS_WARNING) << "Unable to open the database for writing, hosts are written "
+                                   "synchronously";
+            }
+            else if (!writer_thread_)
+            {
+                writer_thread_ = std::make_unique<base::Thread>();
+                writer_thread_->start(base::MessageLoop::Type::DEFAULT);
+            }
+
+            if (writer)
+                writer_task_runner = writer_thread_->taskRunner();
+        }
+
+        database_ = std::make_shared<DatabaseCached>(
+            task_runner_, std::move(database), std::move(writer), std::move(writer_task_runner));
+
+        // The users of a concurrent database can be changed by other routers at any time.
+        if (factory_->isConcurrent())
+            database_->setUserCacheEnabled(false);
+    }
+
+    return std::make_unique<DatabaseRef>(database_);
+}
+
+} // namespace router
@@ -0,0 +1,58 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef ROUTER_DATABASE_FACTORY_CACHED_H
+#define ROUTER_DATABASE_FACTORY_CACHED_H
+
+#include "base/macros_magic.h"
+#include "router/database_factory.h"
+
+namespace base {
+class TaskRunner;
+class Thread;
+} // namespace base
+
+namespace router {
+
+class DatabaseCached;
+
+// Opens the database of |factory| once and returns handles to the same DatabaseCached instance,
+// so all sessions share one connection and one cache. If the factory is concurrent, then the
+// new hosts are written with a second database on a separate thread and the users are not cached.
+class DatabaseFactoryCached : public DatabaseFactory
+{
+public:
+    DatabaseFactoryCached(std::shared_ptr<base::TaskRunner> task_runner,
+                          std::unique_ptr<DatabaseFactory> factory);
+    ~DatabaseFactoryCached() override;
+
+    std::unique_ptr<Database> createDatabase() const override;
+    std::unique_ptr<Database> openDatabase() const override;
+
+private:
+    std::shared_ptr<base::TaskRunner> task_runner_;
+    std::unique_ptr<DatabaseFactory> factory_;
+    mutable std::unique_ptr<base::Thread> writer_thread_;
+    mutable std::shared_ptr<DatabaseCached> database_;
+
+    DISALLOW_COPY_AND_ASSIGN(DatabaseFactoryCached);
+};
+
+} // namespace router
+
+#endif // ROUTER_DATABASE_FACTORY_CACHED_H
@@ -0,0 +1,41 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "router/database_factory_postgresql.h"
+
+namespace router {
+
+DatabaseFactoryPostgresql::DatabaseFactoryPostgresql(
+    const std::string& connection_string, size_t pool_size)
+    : pool_(std::make_shared<DatabasePostgresql::Pool>(connection_string, pool_size))
+{
+    // Nothing
+}
+
+DatabaseFactoryPostgresql::~DatabaseFactoryPostgresql() = default;
+
+std::unique_ptr<Database> DatabaseFactoryPostgresql::createDatabase() const
+{
+    return DatabasePostgresql::create(pool_);
+}
+
+std::unique_ptr<Database> DatabaseFactoryPostgresql::openDatabase() const
+{
+    return DatabasePostgresql::open(pool_);
+}
+
+} // namespace router
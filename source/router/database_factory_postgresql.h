@@ -0,0 +1,46 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef ROUTER_DATABASE_FACTORY_POSTGRESQL_H
+#define ROUTER_DATABASE_FACTORY_POSTGRESQL_H
+
+#include "base/macros_magic.h"
+#include "router/database_factory.h"
+#include "router/database_postgresql.h"
+
+namespace router {
+
+// The databases opened by the factory share a pool of connections to the server.
+class DatabaseFactoryPostgresql : public DatabaseFactory
+{
+public:
+    DatabaseFactoryPostgresql(const std::string& connection_string, size_t pool_size);
+    ~DatabaseFactoryPostgresql() override;
+
+    std::unique_ptr<Database> createDatabase() const override;
+    std::unique_ptr<Database> openDatabase() const override;
+    bool isConcurrent() const override { return true; }
+
+private:
+    std::shared_ptr<DatabasePostgresql::Pool> pool_;
+
+    DISALLOW_COPY_AND_ASSIGN(DatabaseFactoryPostgresql);
+};
+
+} // namespace router
+
+#endif // ROUTER_DATABASE_FACTORY_POSTGRESQL_H
@@ -18,22 +18,24 @@
 
 #include "router/database_factory_sqlite.h"
 
-#include "router/database_sqlite.h"
-
 namespace router {
 
-DatabaseFactorySqlite::DatabaseFactorySqlite() = default;
+DatabaseFactorySqlite::DatabaseFactorySqlite(DatabaseSqlite::Synchronous synchronous)
+    : synchronous_(synchronous)
+{
+    // Nothing
+}
 
 DatabaseFactorySqlite::~DatabaseFactorySqlite() = default;
 
 std::unique_ptr<Database> DatabaseFactorySqlite::createDatabase() const
 {
-    return DatabaseSqlite::create();
+    return DatabaseSqlite::create(synchronous_);
 }
 
 std::unique_ptr<Database> DatabaseFactorySqlite::openDatabase() const
 {
-    return DatabaseSqlite::open();
+    return DatabaseSqlite::open(synchronous_);
 }
 
 } // namespace router
@@ -21,19 +21,23 @@
 
 #include "base/macros_magic.h"
 #include "router/database_factory.h"
+#include "router/database_sqlite.h"
 
 namespace router {
 
 class DatabaseFactorySqlite : public DatabaseFactory
 {
 public:
-    DatabaseFactorySqlite();
+    explicit DatabaseFactorySqlite(
+        DatabaseSqlite::Synchronous synchronous = DatabaseSqlite::Synchronous::NORMAL);
     ~DatabaseFactorySqlite() override;
 
     std::unique_ptr<Database> createDatabase() const override;
     std::unique_ptr<Database> openDatabase() const override;
 
 private:
+    const DatabaseSqlite::Synchronous synchronous_;
+
     DISALLOW_COPY_AND_ASSIGN(DatabaseFactorySqlite);
 };
 
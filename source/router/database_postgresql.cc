@@ -0,0 +1,665 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "router/database_postgresql.h"
+
+#include "base/endian_util.h"
+#include "base/logging.h"
+#include "base/strings/unicode.h"
+
+#include <algorithm>
+#include <cstring>
+#include <optional>
+
+namespace router {
+
+namespace {
+
+// Type identifiers of the parameters from the "pg_type" catalog.
+const Oid kByteaOid = 17;
+const Oid kInt8Oid = 20;
+const Oid kInt4Oid = 23;
+const Oid kTextOid = 25;
+
+// Parameters and results are transferred in the binary format.
+const int kBinaryFormat = 1;
+
+const char kUserColumns[] = "id, name, \"group\", salt, verifier, sessions, flags";
+
+template <typename T>
+std::optional<T> readInteger(const PGresult* result, int row, int column)
+{
+    if (PQgetisnull(result, row, column) || PQgetlength(result, row, column) != sizeof(T))
+    {
+        LOG(LS_ERROR) << "Field is not an integer of " << sizeof(T) << " bytes";
+        return std::nullopt;
+    }
+
+    T value;
+    memcpy(&value, PQgetvalue(result, row, column), sizeof(T));
+    return base::EndianUtil::fromBig(value);
+}
+
+std::optional<std::string> readData(const PGresult* result, int row, int column)
+{
+    if (PQgetisnull(result, row, column))
+    {
+        LOG(LS_ERROR) << "Field is NULL";
+        return std::nullopt;
+    }
+
+    int size = PQgetlength(result, row, column);
+    if (size <= 0)
+    {
+        LOG(LS_ERROR) << "Field has an invalid size: " << size;
+        return std::nullopt;
+    }
+
+    return std::string(PQgetvalue(result, row, column), static_cast<size_t>(size));
+}
+
+std::optional<base::User> readUser(const PGresult* result, int row)
+{
+    std::optional<uint64_t> entry_id = readInteger<uint64_t>(result, row, 0);
+    if (!entry_id.has_value())
+    {
+        LOG(LS_ERROR) << "Failed to get field 'id'";
+        return std::nullopt;
+    }
+
+    std::optional<std::string> name = readData(result, row, 1);
+    if (!name.has_value())
+    {
+        LOG(LS_ERROR) << "Failed to get field 'name'";
+        return std::nullopt;
+    }
+
+    std::optional<std::string> group = readData(result, row, 2);
+    if (!group.has_value())
+    {
+        LOG(LS_ERROR) << "Failed to get field 'group'";
+        return std::nullopt;
+    }
+
+    std::optional<std::string> salt = readData(result, row, 3);
+    if (!salt.has_value())
+    {
+        LOG(LS_ERROR) << "Failed to get field 'salt'";
+        return std::nullopt;
+    }
+
+    std::optional<std::string> verifier = readData(result, row, 4);
+    if (!verifier.has_value())
+    {
+        LOG(LS_ERROR) << "Failed to get field 'verifier'";
+        return std::nullopt;
+    }
+
+    std::optional<uint32_t> sessions = readInteger<uint32_t>(result, row, 5);
+    if (!sessions.has_value())
+    {
+        LOG(LS_ERROR) << "Failed to get field 'sessions'";
+        return std::nullopt;
+    }
+
+    std::optional<uint32_t> flags = readInteger<uint32_t>(result, row, 6);
+    if (!flags.has_value())
+    {
+        LOG(LS_ERROR) << "Failed to get field 'flags'";
+        return std::nullopt;
+    }
+
+    base::User user;
+
+    user.entry_id  = static_cast<int64_t>(*entry_id);
+    user.name      = base::utf16FromUtf8(*name);
+    user.group     = std::move(*group);
+    user.salt      = base::fromStdString(*salt);
+    user.verifier  = base::fromStdString(*verifier);
+    user.sessions  = *sessions;
+    user.flags     = *flags;
+
+    return std::move(user);
+}
+
+} // namespace
+
+class DatabasePostgresql::Params
+{
+public:
+    Params() = default;
+
+    void addText(std::string_view text)
+    {
+        add(kTextOid, std::string(text));
+    }
+
+    void addBytes(const base::ByteArray& bytes)
+    {
+        add(kByteaOid, base::toStdString(bytes));
+    }
+
+    void addInt32(int32_t number)
+    {
+        addInteger(kInt4Oid, static_cast<uint32_t>(number));
+    }
+
+    void addInt64(int64_t number)
+    {
+        addInteger(kInt8Oid, static_cast<uint64_t>(number));
+    }
+
+    int count() const { return static_cast<int>(values_.size()); }
+    const Oid* types() const { return types_.data(); }
+    const int* lengths() const { return lengths_.data(); }
+    const int* formats() const { return formats_.data(); }
+
+    std::vector<const char*> values() const
+    {
+        std::vector<const char*> result;
+        result.reserve(values_.size());
+
+        for (const auto& value : values_)
+            result.emplace_back(value.data());
+
+        return result;
+    }
+
+private:
+    template <typename T>
+    void addInteger(Oid type, T number)
+    {
+        number = base::EndianUtil::toBig(number);
+        add(type, std::string(reinterpret_cast<const char*>(&number), sizeof(number)));
+    }
+
+    void add(Oid type, std::string value)
+    {
+        types_.emplace_back(type);
+        lengths_.emplace_back(static_cast<int>(value.size()));
+        formats_.emplace_back(kBinaryFormat);
+        values_.emplace_back(std::move(value));
+    }
+
+    std::vector<Oid> types_;
+    std::vector<int> lengths_;
+    std::vector<int> formats_;
+    std::vector<std::string> values_;
+
+    DISALLOW_COPY_AND_ASSIGN(Params);
+};
+
+DatabasePostgresql::Connection::~Connection()
+{
+    if (conn)
+        PQfinish(conn);
+}
+
+DatabasePostgresql::Pool::Pool(const std::string& connection_string, size_t max_idle_count)
+    : connection_string_(connection_string),
+      max_idle_count_(max_idle_count)
+{
+    // Nothing
+}
+
+DatabasePostgresql::Pool::~Pool() = default;
+
+std::unique_ptr<DatabasePostgresql::Connection> DatabasePostgresql::Pool::take()
+{
+    {
+        std::scoped_lock lock(lock_);
+
+        if (!idle_.empty())
+        {
+            std::unique_ptr<Connection> connection = std::move(idle_.back());
+            idle_.pop_back();
+            return connection;
+        }
+    }
+
+    std::unique_ptr<Connection> connection = std::make_unique<Connection>();
+
+    connection->conn = PQconnectdb(connection_string_.c_str());
+    if (!connection->conn)
+    {
+        LOG(LS_ERROR) << "PQconnectdb failed";
+        return nullptr;
+    }
+
+    if (PQstatus(connection->conn) != CONNECTION_OK)
+    {
+        LOG(LS_ERROR) << "Unable to connect to the database server: "
+                      << PQerrorMessage(connection->conn);
+        return nullptr;
+    }
+
+    LOG(LS_INFO) << "Connected to the database server (version: "
+                 << PQserverVersion(connection->conn) << ")";
+    return connection;
+}
+
+void DatabasePostgresql::Pool::release(std::unique_ptr<Connection> connection)
+{
+    if (!connection || PQstatus(connection->conn) != CONNECTION_OK ||
+        PQtransactionStatus(connection->conn) != PQTRANS_IDLE)
+    {
+        return;
+    }
+
+    std::scoped_lock lock(lock_);
+
+    if (idle_.size() < max_idle_count_)
+        idle_.emplace_back(std::move(connection));
+}
+
+DatabasePostgresql::DatabasePostgresql(std::shared_ptr<Pool> pool,
+                                       std::unique_ptr<Connection> connection)
+    : pool_(std::move(pool)),
+      connection_(std::move(connection))
+{
+    DCHECK(pool_ && connection_);
+}
+
+DatabasePostgresql::~DatabasePostgresql()
+{
+    pool_->release(std::move(connection_));
+}
+
+// static
+std::unique_ptr<DatabasePostgresql> DatabasePostgresql::create(std::shared_ptr<Pool> pool)
+{
+    std::unique_ptr<DatabasePostgresql> db = open(std::move(pool));
+    if (!db)
+        return nullptr;
+
+    const char kSql[] = "BEGIN;"
+        "CREATE TABLE IF NOT EXISTS users ("
+            "id BIGSERIAL PRIMARY KEY,"
+            "name TEXT NOT NULL UNIQUE,"
+            "\"group\" TEXT NOT NULL,"
+            "salt BYTEA NOT NULL,"
+            "verifier BYTEA NOT NULL,"
+            "sessions INTEGER NOT NULL DEFAULT 0,"
+            "flags INTEGER NOT NULL DEFAULT 0);"
+        "CREATE TABLE IF NOT EXISTS hosts ("
+            "id BIGSERIAL PRIMARY KEY,"
+            "key BYTEA NOT NULL UNIQUE);"
+        "COMMIT;";
+
+    if (!db->executeCommand(kSql))
+        return nullptr;
+
+    return db;
+}
+
+// static
+std::unique_ptr<DatabasePostgresql> DatabasePostgresql::open(std::shared_ptr<Pool> pool)
+{
+    if (!pool)
+    {
+        LOG(LS_ERROR) << "Invalid connection pool";
+        return nullptr;
+    }
+
+    std::unique_ptr<Connection> connection = pool->take();
+    if (!connection)
+        return nullptr;
+
+    return std::unique_ptr<DatabasePostgresql>(
+        new DatabasePostgresql(std::move(pool), std::move(connection)));
+}
+
+std::vector<base::User> DatabasePostgresql::userList() const
+{
+    static const std::string kQuery = std::string("SELECT ") + kUserColumns + " FROM users";
+
+    ResultPtr result = execute(kQuery, Params(), PGRES_TUPLES_OK);
+    if (!result)
+        return {};
+
+    std::vector<base::User> users;
+    const int count = PQntuples(result.get());
+
+    users.reserve(static_cast<size_t>(count));
+
+    for (int row = 0; row < count; ++row)
+    {
+        std::optional<base::User> user = readUser(result.get(), row);
+        if (user.has_value())
+            users.emplace_back(std::move(*user));
+    }
+
+    return users;
+}
+
+bool DatabasePostgresql::addUser(const base::User& user)
+{
+    if (!user.isValid())
+    {
+        LOG(LS_ERROR) << "Not valid user";
+        return false;
+    }
+
+    static const char kQuery[] =
+        "INSERT INTO users (name, \"group\", salt, verifier, sessions, flags) "
+        "VALUES ($1, $2, $3, $4, $5, $6)";
+
+    Params params;
+    params.addText(base::utf8FromUtf16(user.name));
+    params.addText(user.group);
+    params.addBytes(user.salt);
+    params.addBytes(user.verifier);
+    params.addInt32(static_cast<int32_t>(user.sessions));
+    params.addInt32(static_cast<int32_t>(user.flags));
+
+    return execute(kQuery, params, PGRES_COMMAND_OK) != nullptr;
+}
+
+bool DatabasePostgresql::modifyUser(const base::User& user)
+{
+    if (!user.isValid())
+    {
+        LOG(LS_ERROR) << "Not valid user";
+        return false;
+    }
+
+    static const char kQuery[] =
+        "UPDATE users SET name=$1, \"group\"=$2, salt=$3, verifier=$4, sessions=$5, flags=$6 "
+        "WHERE id=$7";
+
+    Params params;
+    params.addText(base::utf8FromUtf16(user.name));
+    params.addText(user.group);
+    params.addBytes(user.salt);
+    params.addBytes(user.verifier);
+    params.addInt32(static_cast<int32_t>(user.sessions));
+    params.addInt32(static_cast<int32_t>(user.flags));
+    params.addInt64(user.entry_id);
+
+    return execute(kQuery, params, PGRES_COMMAND_OK) != nullptr;
+}
+
+bool DatabasePostgresql::removeUser(int64_t entry_id)
+{
+    static const char kQuery[] = "DELETE FROM users WHERE id=$1";
+
+    Params params;
+    params.addInt64(entry_id);
+
+    return execute(kQuery, params, PGRES_COMMAND_OK) != nullptr;
+}
+
+base::User DatabasePostgresql::findUser(std::u16string_view username)
+{
+    static const std::string kQuery =
+        std::string("SELECT ") + kUserColumns + " FROM users WHERE name=$1";
+
+    Params params;
+    params.addText(base::utf8FromUtf16(username));
+
+    ResultPtr result = execute(kQuery, params, PGRES_TUPLES_OK);
+    if (!result || PQntuples(result.get()) < 1)
+        return base::User::kInvalidUser;
+
+    return readUser(result.get(), 0).value_or(base::User::kInvalidUser);
+}
+
+Database::ErrorCode DatabasePostgresql::hostId(
+    const base::ByteArray& key_hash, base::HostId* host_id) const
+{
+    if (key_hash.empty())
+    {
+        LOG(LS_ERROR) << "Invalid key hash";
+        return ErrorCode::UNKNOWN;
+    }
+
+    if (!host_id)
+    {
+        LOG(LS_ERROR) << "Invalid host id";
+        return ErrorCode::UNKNOWN;
+    }
+
+    *host_id = base::kInvalidHostId;
+
+    static const char kQuery[] = "SELECT id FROM hosts WHERE key=$1";
+
+    Params params;
+    params.addBytes(key_hash);
+
+    ResultPtr result = execute(kQuery, params, PGRES_TUPLES_OK);
+    if (!result)
+        return ErrorCode::UNKNOWN;
+
+    if (PQntuples(result.get()) < 1)
+        return ErrorCode::NO_HOST_FOUND;
+
+    std::optional<uint64_t> entry_id = readInteger<uint64_t>(result.get(), 0, 0);
+    if (!entry_id.has_value())
+    {
+        LOG(LS_ERROR) << "Failed to get field 'id'";
+        return ErrorCode::UNKNOWN;
+    }
+
+    *host_id = static_cast<base::HostId>(*entry_id);
+    return ErrorCode::SUCCESS;
+}
+
+bool DatabasePostgresql::addHost(const base::ByteArray& key_hash)
+{
+    if (key_hash.empty())
+    {
+        LOG(LS_ERROR) << "Invalid parameters";
+        return false;
+    }
+
+    static const char kQuery[] = "INSERT INTO hosts (key) VALUES ($1)";
+
+    Params params;
+    params.addBytes(key_hash);
+
+    return execute(kQuery, params, PGRES_COMMAND_OK) != nullptr;
+}
+
+bool DatabasePostgresql::addHosts(const std::vector<Host>& hosts)
+{
+    if (hosts.empty())
+        return true;
+
+    static const char kQuery[] = "INSERT INTO hosts (id, key) VALUES ($1, $2)";
+
+    // The hosts are added with explicit IDs, so the sequence must be moved past them for the
+    // hosts added by addHost(). It is never moved back: the IDs reserved by the routers, which are
+    // not written yet, are below its value.
+    static const char kSequenceQuery[] =
+        "SELECT setval(pg_get_serial_sequence('hosts', 'id'), $1) WHERE $1 > COALESCE("
+        "pg_sequence_last_value(pg_get_serial_sequence('hosts', 'id')::regclass), 0)";
+
+    if (!executeCommand("BEGIN"))
+        return false;
+
+    in_transaction_ = true;
+    bool result = true;
+    base::HostId last_host_id = 0;
+
+    for (const Host& host : hosts)
+    {
+        Params params;
+        params.addInt64(static_cast<int64_t>(host.host_id));
+        params.addBytes(host.key_hash);
+
+        if (!execute(kQuery, params, PGRES_COMMAND_OK))
+        {
+            result = false;
+            break;
+        }
+
+        last_host_id = std::max(last_host_id, host.host_id);
+    }
+
+    if (result)
+    {
+        Params params;
+        params.addInt64(static_cast<int64_t>(last_host_id));
+
+        result = execute(kSequenceQuery, params, PGRES_TUPLES_OK) != nullptr;
+    }
+
+    in_transaction_ = false;
+
+    if (!executeCommand(result ? "COMMIT" : "ROLLBACK"))
+        return false;
+
+    return result;
+}
+
+std::optional<base::HostId> DatabasePostgresql::lastHostId() const
+{
+    static const char kQuery[] = "SELECT COALESCE(MAX(id), 0) FROM hosts";
+
+    ResultPtr result = execute(kQuery, Params(), PGRES_TUPLES_OK);
+    if (!result || PQntuples(result.get()) < 1)
+        return std::nullopt;
+
+    std::optional<uint64_t> host_id = readInteger<uint64_t>(result.get(), 0, 0);
+    if (!host_id.has_value())
+        return std::nullopt;
+
+    return static_cast<base::HostId>(*host_id);
+}
+
+bool DatabasePostgresql::reserveHostIds(size_t count, std::vector<base::HostId>* host_ids)
+{
+    if (!count || !host_ids)
+    {
+        LOG(LS_ERROR) << "Invalid parameters";
+        return false;
+    }
+
+    // The IDs are taken from the sequence, which is shared by all routers of the server. They are
+    // unique, but not always consecutive.
+    static const char kQuery[] =
+        "SELECT nextval(pg_get_serial_sequence('hosts', 'id')) FROM generate_series(1, $1)";
+
+    Params params;
+    params.addInt64(static_cast<int64_t>(count));
+
+    ResultPtr result = execute(kQuery, params, PGRES_TUPLES_OK);
+    if (!result)
+        return false;
+
+    const int rows = PQntuples(result.get());
+
+    host_ids->clear();
+    host_ids->reserve(static_cast<size_t>(rows));
+
+    for (int row = 0; row < rows; ++row)
+    {
+        std::optional<uint64_t> host_id = readInteger<uint64_t>(result.get(), row, 0);
+        if (!host_id.has_value())
+        {
+            LOG(LS_ERROR) << "Failed to get the reserved ID";
+            return false;
+        }
+
+        host_ids->emplace_back(static_cast<base::HostId>(*host_id));
+    }
+
+    return !host_ids->empty();
+}
+
+DatabasePostgresql::ResultPtr DatabasePostgresql::execute(
+    std::string_view query, const Params& params, ExecStatusType expected_status) const
+{
+    // Inside a transaction, the query cannot be repeated on a new connection.
+    const int max_attempts = in_transaction_ ? 1 : 2;
+
+    for (int attempt = 1; attempt <= max_attempts; ++attempt)
+    {
+        PGconn* conn = connection_->conn;
+
+        auto statement = connection_->statements.find(query);
+        if (statement == connection_->statements.end())
+        {
+            std::string name = "s" + std::to_string(connection_->statements.size());
+
+            ResultPtr result(PQprepare(conn, name.c_str(), std::string(query).c_str(),
+                                       params.count(), params.types()));
+            if (PQresultStatus(result.get()) != PGRES_COMMAND_OK)
+            {
+                if (attempt < max_attempts && resetConnection())
+                    continue;
+
+                LOG(LS_ERROR) << "PQprepare failed: " << PQerrorMessage(conn);
+                return nullptr;
+            }
+
+            statement = connection_->statements.emplace(std::string(query), std::move(name)).first;
+        }
+
+        std::vector<const char*> values = params.values();
+
+        ResultPtr result(PQexecPrepared(conn, statement->second.c_str(), params.count(),
+                                        values.data(), params.lengths(), params.formats(),
+                                        kBinaryFormat));
+        if (PQresultStatus(result.get()) == expected_status)
+            return result;
+
+        if (attempt < max_attempts && resetConnection())
+            continue;
+
+        LOG(LS_ERROR) << "PQexecPrepared failed: " << PQerrorMessage(conn);
+        return nullptr;
+    }
+
+    return nullptr;
+}
+
+bool DatabasePostgresql::executeCommand(const char* command) const
+{
+    ResultPtr result(PQexec(connection_->conn, command));
+    if (PQresultStatus(result.get()) != PGRES_COMMAND_OK)
+    {
+        LOG(LS_ERROR) << "PQexec failed: " << PQerrorMessage(connection_->conn);
+        return false;
+    }
+
+    return true;
+}
+
+bool DatabasePostgresql::resetConnection() const
+{
+    // Only a lost connection is restored. Other errors, such as a constraint violation, are
+    // returned to the caller.
+    if (PQstatus(connection_->conn) != CONNECTION_BAD)
+        return false;
+
+    LOG(LS_WARNING) << "Connection to the database server lost, reconnecting";
+
+    // The prepared statements are lost with the connection.
+    connection_->statements.clear();
+    PQreset(connection_->conn);
+
+    if (PQstatus(connection_->conn) != CONNECTION_OK)
+    {
+        LOG(LS_ERROR) << "Unable to reconnect: " << PQerrorMessage(connection_->conn);
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace router
@@ -0,0 +1,125 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef ROUTER_DATABASE_POSTGRESQL_H
+#define ROUTER_DATABASE_POSTGRESQL_H
+
+#include "base/macros_magic.h"
+#include "router/database.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <libpq-fe.h>
+
+namespace router {
+
+// Database on a PostgreSQL server. Several routers can share the server, and the connections of
+// one router can be used on different threads at the same time.
+class DatabasePostgresql : public Database
+{
+public:
+    // Connection to the server with the statements prepared on it.
+    struct Connection
+    {
+        ~Connection();
+
+        PGconn* conn = nullptr;
+
+        // Query to the name of the prepared statement.
+        std::map<std::string, std::string, std::less<>> statements;
+    };
+
+    // Keeps the idle connections for reuse. Can be used from any thread.
+    class Pool
+    {
+    public:
+        Pool(const std::string& connection_string, size_t max_idle_count);
+        ~Pool();
+
+        // Returns an idle connection or a new one. Returns nullptr if the connection failed.
+        std::unique_ptr<Connection> take();
+
+        // Keeps the connection for reuse if it is healthy and the pool is not full.
+        void release(std::unique_ptr<Connection> connection);
+
+    private:
+        const std::string connection_string_;
+        const size_t max_idle_count_;
+
+        std::mutex lock_;
+        std::vector<std::unique_ptr<Connection>> idle_;
+
+        DISALLOW_COPY_AND_ASSIGN(Pool);
+    };
+
+    ~DatabasePostgresql() override;
+
+    // Creates the tables if they do not exist yet.
+    static std::unique_ptr<DatabasePostgresql> create(std::shared_ptr<Pool> pool);
+    static std::unique_ptr<DatabasePostgresql> open(std::shared_ptr<Pool> pool);
+
+    // Database implementation.
+    std::vector<base::User> userList() const override;
+    bool addUser(const base::User& user) override;
+    bool modifyUser(const base::User& user) override;
+    bool removeUser(int64_t entry_id) override;
+    base::User findUser(std::u16string_view username) override;
+    ErrorCode hostId(const base::ByteArray& key_hash, base::HostId* host_id) const override;
+    bool addHost(const base::ByteArray& key_hash) override;
+    bool addHosts(const std::vector<Host>& hosts) override;
+    std::optional<base::HostId> lastHostId() const override;
+    bool reserveHostIds(size_t count, std::vector<base::HostId>* host_ids) override;
+
+private:
+    class Params;
+
+    struct ResultDeleter
+    {
+        void operator()(PGresult* result) const { PQclear(result); }
+    };
+
+    using ResultPtr = std::unique_ptr<PGresult, ResultDeleter>;
+
+    DatabasePostgresql(std::shared_ptr<Pool> pool, std::unique_ptr<Connection> connection);
+
+    // Executes a prepared statement of |query| with binary parameters and results. The statement
+    // is prepared at the first call. If the connection is lost, it is reset and the query is
+    // repeated once. Returns nullptr if the status of the result is not |expected_status|.
+    ResultPtr execute(std::string_view query, const Params& params,
+                      ExecStatusType expected_status) const;
+
+    // Executes a command without parameters, such as "BEGIN".
+    bool executeCommand(const char* command) const;
+
+    // Restores a lost connection. Returns false if the connection was not lost or cannot be
+    // restored.
+    bool resetConnection() const;
+
+    std::shared_ptr<Pool> pool_;
+    std::unique_ptr<Connection> connection_;
+    bool in_transaction_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(DatabasePostgresql);
+};
+
+} // namespace router
+
+#endif // ROUTER_DATABASE_POSTGRESQL_H
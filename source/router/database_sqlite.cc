@@ -29,6 +29,8 @@ namespace router {
 
 namespace {
 
+const int kBusyTimeout = 5000; // ms
+
 const char* columnTypeToString(int type)
 {
     switch (type)
@@ -257,11 +259,14 @@ DatabaseSqlite::DatabaseSqlite(sqlite3* db)
 
 DatabaseSqlite::~DatabaseSqlite()
 {
+    for (const auto& statement : statements_)
+        sqlite3_finalize(statement.second);
+
     sqlite3_close(db_);
 }
 
 // static
-std::unique_ptr<DatabaseSqlite> DatabaseSqlite::create()
+std::unique_ptr<DatabaseSqlite> DatabaseSqlite::create(Synchronous synchronous)
 {
     std::filesystem::path dir_path = databaseDirectory();
     if (dir_path.empty())
@@ -304,7 +309,7 @@ std::unique_ptr<DatabaseSqlite> DatabaseSqlite::create()
         return nullptr;
     }
 
-    std::unique_ptr<DatabaseSqlite> db = open();
+    std::unique_ptr<DatabaseSqlite> db = open(synchronous);
     if (!db)
         return nullptr;
 
@@ -336,7 +341,7 @@ std::unique_ptr<DatabaseSqlite> DatabaseSqlite::create()
 }
 
 // static
-std::unique_ptr<DatabaseSqlite> DatabaseSqlite::open()
+std::unique_ptr<DatabaseSqlite> DatabaseSqlite::open(Synchronous synchronous)
 {
     std::filesystem::path file_path = filePath();
     if (file_path.empty())
@@ -355,10 +360,34 @@ std::unique_ptr<DatabaseSqlite> DatabaseSqlite::open()
     {
         LOG(LS_WARNING) << "sqlite3_open failed: " << sqlite3_errstr(error_code)
                         << " (" << error_code << ")";
+        sqlite3_close(db);
         return nullptr;
     }
 
-    return std::unique_ptr<DatabaseSqlite>(new DatabaseSqlite(db));
+    std::unique_ptr<DatabaseSqlite> result(new DatabaseSqlite(db));
+    if (!result->configure(synchronous))
+        return nullptr;
+
+    return result;
+}
+
+// static
+bool DatabaseSqlite::parseSynchronous(std::u16string_view name, Synchronous* synchronous)
+{
+    DCHECK(synchronous);
+
+    if (name == u"off")
+        *synchronous = Synchronous::OFF;
+    else if (name == u"normal")
+        *synchronous = Synchronous::NORMAL;
+    else if (name == u"full")
+        *synchronous = Synchronous::FULL;
+    else if (name == u"extra")
+        *synchronous = Synchronous::EXTRA;
+    else
+        return false;
+
+    return true;
 }
 
 // static
@@ -372,15 +401,55 @@ std::filesystem::path DatabaseSqlite::filePath()
     return file_path;
 }
 
+bool DatabaseSqlite::configure(Synchronous synchronous)
+{
+    // The host registration scripts can write to the database while the router is running.
+    sqlite3_busy_timeout(db_, kBusyTimeout);
+
+    const char* synchronous_sql;
+    switch (synchronous)
+    {
+        case Synchronous::OFF:
+            synchronous_sql = "PRAGMA synchronous=OFF";
+            break;
+
+        case Synchronous::FULL:
+            synchronous_sql = "PRAGMA synchronous=FULL";
+            break;
+
+        case Synchronous::EXTRA:
+            synchronous_sql = "PRAGMA synchronous=EXTRA";
+            break;
+
+        default:
+            synchronous_sql = "PRAGMA synchronous=NORMAL";
+            break;
+    }
+
+    for (const char* sql : { "PRAGMA journal_mode=WAL", synchronous_sql })
+    {
+        char* error_string = nullptr;
+        int error_code = sqlite3_exec(db_, sql, nullptr, nullptr, &error_string);
+        if (error_code != SQLITE_OK)
+        {
+            LOG(LS_ERROR) << "sqlite3_exec failed: " << error_string << " (" << sql << ")";
+            sqlite3_free(error_string);
+            return false;
+        }
+    }
+
+    return true;
+}
+
 std::vector<base::User> DatabaseSqlite::userList() const
 {
     const char kQuery[] = "SELECT * FROM users";
 
     sqlite3_stmt* statement;
-    int error_code = sqlite3_prepare(db_, kQuery, std::size(kQuery), &statement, nullptr);
+    int error_code = prepareStatement(kQuery, &statement);
     if (error_code != SQLITE_OK)
     {
-        LOG(LS_ERROR) << "sqlite3_prepare failed: " << sqlite3_errstr(error_code)
+        LOG(LS_ERROR) << "sqlite3_prepare_v2 failed: " << sqlite3_errstr(error_code)
                       << " (" << error_code << ")";
         return {};
     }
@@ -397,7 +466,7 @@ std::vector<base::User> DatabaseSqlite::userList() const
             users.emplace_back(std::move(*user));
     }
 
-    sqlite3_finalize(statement);
+    releaseStatement(statement);
     return users;
 }
 
@@ -414,10 +483,10 @@ bool DatabaseSqlite::addUser(const base::User& user)
         "VALUES (NULL, ?, ?, ?, ?, ?, ?)";
 
     sqlite3_stmt* statement = nullptr;
-    int error_code = sqlite3_prepare(db_, kQuery, std::size(kQuery), &statement, nullptr);
+    int error_code = prepareStatement(kQuery, &statement);
     if (error_code != SQLITE_OK)
     {
-        LOG(LS_ERROR) << "sqlite3_prepare failed: " << sqlite3_errstr(error_code)
+        LOG(LS_ERROR) << "sqlite3_prepare_v2 failed: " << sqlite3_errstr(error_code)
                       << " (" << error_code << ")";
         return false;
     }
@@ -457,7 +526,7 @@ bool DatabaseSqlite::addUser(const base::User& user)
     }
     while (false);
 
-    sqlite3_finalize(statement);
+    releaseStatement(statement);
     return result;
 }
 
@@ -474,10 +543,10 @@ bool DatabaseSqlite::modifyUser(const base::User& user)
         "(?, ?, ?, ?, ?, ?) WHERE id=?";
 
     sqlite3_stmt* statement = nullptr;
-    int error_code = sqlite3_prepare(db_, kQuery, std::size(kQuery), &statement, nullptr);
+    int error_code = prepareStatement(kQuery, &statement);
     if (error_code != SQLITE_OK)
     {
-        LOG(LS_ERROR) << "sqlite3_prepare failed: " << sqlite3_errstr(error_code)
+        LOG(LS_ERROR) << "sqlite3_prepare_v2 failed: " << sqlite3_errstr(error_code)
                       << " (" << error_code << ")";
         return false;
     }
@@ -520,7 +589,7 @@ bool DatabaseSqlite::modifyUser(const base::User& user)
     }
     while (false);
 
-    sqlite3_finalize(statement);
+    releaseStatement(statement);
     return result;
 }
 
@@ -529,10 +598,10 @@ bool DatabaseSqlite::removeUser(int64_t entry_id)
     static const char kQuery[] = "DELETE FROM users WHERE id=?";
 
     sqlite3_stmt* statement = nullptr;
-    int error_code = sqlite3_prepare(db_, kQuery, std::size(kQuery), &statement, nullptr);
+    int error_code = prepareStatement(kQuery, &statement);
     if (error_code != SQLITE_OK)
     {
-        LOG(LS_ERROR) << "sqlite3_prepare failed: " << sqlite3_errstr(error_code);
+        LOG(LS_ERROR) << "sqlite3_prepare_v2 failed: " << sqlite3_errstr(error_code);
         return false;
     }
 
@@ -555,7 +624,7 @@ bool DatabaseSqlite::removeUser(int64_t entry_id)
     }
     while (false);
 
-    sqlite3_finalize(statement);
+    releaseStatement(statement);
     return result;
 }
 
@@ -564,10 +633,10 @@ base::User DatabaseSqlite::findUser(std::u16string_view username)
     const char kQuery[] = "SELECT * FROM users WHERE name=?";
 
     sqlite3_stmt* statement = nullptr;
-    int error_code = sqlite3_prepare(db_, kQuery, std::size(kQuery), &statement, nullptr);
+    int error_code = prepareStatement(kQuery, &statement);
     if (error_code != SQLITE_OK)
     {
-        LOG(LS_ERROR) << "sqlite3_prepare failed: " << sqlite3_errstr(error_code)
+        LOG(LS_ERROR) << "sqlite3_prepare_v2 failed: " << sqlite3_errstr(error_code)
                       << " (" << error_code << ")";
         return base::User::kInvalidUser;
     }
@@ -587,7 +656,7 @@ base::User DatabaseSqlite::findUser(std::u16string_view username)
     }
     while (false);
 
-    sqlite3_finalize(statement);
+    releaseStatement(statement);
     return user.value_or(base::User::kInvalidUser);
 }
 
@@ -611,10 +680,10 @@ Database::ErrorCode DatabaseSqlite::hostId(
     const char kQuery[] = "SELECT * FROM hosts WHERE key=?";
 
     sqlite3_stmt* statement;
-    int error_code = sqlite3_prepare(db_, kQuery, std::size(kQuery), &statement, nullptr);
+    int error_code = prepareStatement(kQuery, &statement);
     if (error_code != SQLITE_OK)
     {
-        LOG(LS_ERROR) << "sqlite3_prepare failed: " << sqlite3_errstr(error_code)
+        LOG(LS_ERROR) << "sqlite3_prepare_v2 failed: " << sqlite3_errstr(error_code)
                       << " (" << error_code << ")";
         return ErrorCode::UNKNOWN;
     }
@@ -647,7 +716,7 @@ Database::ErrorCode DatabaseSqlite::hostId(
     }
     while (false);
 
-    sqlite3_finalize(statement);
+    releaseStatement(statement);
     return result;
 }
 
@@ -662,10 +731,10 @@ bool DatabaseSqlite::addHost(const base::ByteArray& keyHash)
     const char kQuery[] = "INSERT INTO hosts ('id', 'key') VALUES (NULL, ?)";
 
     sqlite3_stmt* statement = nullptr;
-    int error_code = sqlite3_prepare(db_, kQuery, std::size(kQuery), &statement, nullptr);
+    int error_code = prepareStatement(kQuery, &statement);
     if (error_code != SQLITE_OK)
     {
-        LOG(LS_ERROR) << "sqlite3_prepare failed: " << sqlite3_errstr(error_code)
+        LOG(LS_ERROR) << "sqlite3_prepare_v2 failed: " << sqlite3_errstr(error_code)
                       << " (" << error_code << ")";
         return false;
     }
@@ -689,10 +758,253 @@ bool DatabaseSqlite::addHost(const base::ByteArray& keyHash)
     }
     while (false);
 
-    sqlite3_finalize(statement);
+    releaseStatement(statement);
+    return result;
+}
+
+bool DatabaseSqlite::addHosts(const std::vector<Host>& hosts)
+{
+    if (hosts.empty())
+        return true;
+
+    const char kQuery[] = "INSERT INTO hosts ('id', 'key') VALUES (?, ?)";
+
+    sqlite3_stmt* statement = nullptr;
+    int error_code = prepareStatement(kQuery, &statement);
+    if (error_code != SQLITE_OK)
+    {
+        LOG(LS_ERROR) << "sqlite3_prepare_v2 failed: " << sqlite3_errstr(error_code)
+                      << " (" << error_code << ")";
+        return false;
+    }
+
+    char* error_string = nullptr;
+    error_code = sqlite3_exec(db_, "BEGIN TRANSACTION", nullptr, nullptr, &error_string);
+    if (error_code != SQLITE_OK)
+    {
+        LOG(LS_ERROR) << "sqlite3_exec failed: " << error_string;
+        sqlite3_free(error_string);
+        releaseStatement(statement);
+        return false;
+    }
+
+    bool result = true;
+
+    for (const Host& host : hosts)
+    {
+        if (!writeInt64(statement, static_cast<int64_t>(host.host_id), 1) ||
+            !writeBlob(statement, host.key_hash, 2))
+        {
+            result = false;
+            break;
+        }
+
+        error_code = sqlite3_step(statement);
+        if (error_code != SQLITE_DONE)
+        {
+            LOG(LS_ERROR) << "sqlite3_step failed: " << sqlite3_errstr(error_code)
+                          << " (" << error_code << ")";
+            result = false;
+            break;
+        }
+
+        sqlite3_reset(statement);
+    }
+
+    releaseStatement(statement);
+
+    error_code = sqlite3_exec(
+        db_, result ? "COMMIT" : "ROLLBACK", nullptr, nullptr, &error_string);
+    if (error_code != SQLITE_OK)
+    {
+        LOG(LS_ERROR) << "sqlite3_exec failed: " << error_string;
+        sqlite3_free(error_string);
+        return false;
+    }
+
     return result;
 }
 
+std::optional<base::HostId> DatabaseSqlite::lastHostId() const
+{
+    const char kQuery[] = "SELECT MAX(id) FROM hosts";
+
+    sqlite3_stmt* statement = nullptr;
+    int error_code = prepareStatement(kQuery, &statement);
+    if (error_code != SQLITE_OK)
+    {
+        LOG(LS_ERROR) << "sqlite3_prepare_v2 failed: " << sqlite3_errstr(error_code)
+                      << " (" << error_code << ")";
+        return std::nullopt;
+    }
+
+    std::optional<base::HostId> host_id;
+
+    error_code = sqlite3_step(statement);
+    if (error_code == SQLITE_ROW)
+    {
+        // MAX() returns NULL for an empty table.
+        if (sqlite3_column_type(statement, 0) == SQLITE_NULL)
+            host_id = 0;
+        else
+            host_id = static_cast<base::HostId>(sqlite3_column_int64(statement, 0));
+    }
+    else
+    {
+        LOG(LS_ERROR) << "sqlite3_step failed: " << sqlite3_errstr(error_code)
+                      << " (" << error_code << ")";
+    }
+
+    releaseStatement(statement);
+    return host_id;
+}
+
+bool DatabaseSqlite::reserveHostIds(size_t count, std::vector<base::HostId>* host_ids)
+{
+    if (!count || !host_ids)
+    {
+        LOG(LS_ERROR) << "Invalid parameters";
+        return false;
+    }
+
+    // The registration scripts can add hosts at the same time, so the database is locked for
+    // writing before the counter is read.
+    char* error_string = nullptr;
+    int error_code = sqlite3_exec(
+        db_, "BEGIN IMMEDIATE TRANSACTION", nullptr, nullptr, &error_string);
+    if (error_code != SQLITE_OK)
+    {
+        LOG(LS_ERROR) << "sqlite3_exec failed: " << error_string;
+        sqlite3_free(error_string);
+        return false;
+    }
+
+    std::optional<int64_t> last_id = hostSequence();
+
+    // The hosts added with NULL ID get the IDs after the reserved ones.
+    const bool result =
+        last_id.has_value() && setHostSequence(*last_id + static_cast<int64_t>(count));
+
+    error_code = sqlite3_exec(
+        db_, result ? "COMMIT" : "ROLLBACK", nullptr, nullptr, &error_string);
+    if (error_code != SQLITE_OK)
+    {
+        LOG(LS_ERROR) << "sqlite3_exec failed: " << error_string;
+        sqlite3_free(error_string);
+        return false;
+    }
+
+    if (!result)
+        return false;
+
+    host_ids->clear();
+    for (size_t i = 1; i <= count; ++i)
+        host_ids->emplace_back(static_cast<base::HostId>(*last_id + static_cast<int64_t>(i)));
+
+    return true;
+}
+
+std::optional<int64_t> DatabaseSqlite::hostSequence() const
+{
+    // The row of the counter appears only after the first host is added.
+    const char kQuery[] = "SELECT MAX("
+        "COALESCE((SELECT seq FROM sqlite_sequence WHERE name='hosts'), 0),"
+        "COALESCE((SELECT MAX(id) FROM hosts), 0))";
+
+    sqlite3_stmt* statement = nullptr;
+    int error_code = prepareStatement(kQuery, &statement);
+    if (error_code != SQLITE_OK)
+    {
+        LOG(LS_ERROR) << "sqlite3_prepare_v2 failed: " << sqlite3_errstr(error_code)
+                      << " (" << error_code << ")";
+        return std::nullopt;
+    }
+
+    std::optional<int64_t> value;
+
+    error_code = sqlite3_step(statement);
+    if (error_code == SQLITE_ROW)
+    {
+        value = sqlite3_column_int64(statement, 0);
+    }
+    else
+    {
+        LOG(LS_ERROR) << "sqlite3_step failed: " << sqlite3_errstr(error_code)
+                      << " (" << error_code << ")";
+    }
+
+    releaseStatement(statement);
+    return value;
+}
+
+bool DatabaseSqlite::setHostSequence(int64_t value)
+{
+    auto execute = [this, value](std::string_view query)
+    {
+        sqlite3_stmt* statement = nullptr;
+        int error_code = prepareStatement(query, &statement);
+        if (error_code != SQLITE_OK)
+        {
+            LOG(LS_ERROR) << "sqlite3_prepare_v2 failed: " << sqlite3_errstr(error_code)
+                          << " (" << error_code << ")";
+            return false;
+        }
+
+        if (!writeInt64(statement, value, 1))
+        {
+            releaseStatement(statement);
+            return false;
+        }
+
+        error_code = sqlite3_step(statement);
+        releaseStatement(statement);
+
+        if (error_code != SQLITE_DONE)
+        {
+            LOG(LS_ERROR) << "sqlite3_step failed: " << sqlite3_errstr(error_code)
+                          << " (" << error_code << ")";
+            return false;
+        }
+
+        return true;
+    };
+
+    if (!execute("UPDATE sqlite_sequence SET seq=? WHERE name='hosts'"))
+        return false;
+
+    // The row does not exist until the first host is added.
+    if (sqlite3_changes(db_) > 0)
+        return true;
+
+    return execute("INSERT INTO sqlite_sequence (name, seq) VALUES ('hosts', ?)");
+}
+
+int DatabaseSqlite::prepareStatement(std::string_view query, sqlite3_stmt** statement) const
+{
+    auto it = statements_.find(query);
+    if (it != statements_.end())
+    {
+        *statement = it->second;
+        return SQLITE_OK;
+    }
+
+    int error_code = sqlite3_prepare_v2(
+        db_, query.data(), static_cast<int>(query.size()), statement, nullptr);
+    if (error_code != SQLITE_OK)
+        return error_code;
+
+    statements_.emplace(std::string(query), *statement);
+    return SQLITE_OK;
+}
+
+void DatabaseSqlite::releaseStatement(sqlite3_stmt* statement) const
+{
+    // The statement stays prepared for the next call. Resetting it ends the implicit transaction
+    // of a read that was not stepped to the end.
+    sqlite3_reset(statement);
+    sqlite3_clear_bindings(statement);
+}
+
 // static
 std::filesystem::path DatabaseSqlite::databaseDirectory()
 {
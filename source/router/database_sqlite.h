@@ -23,6 +23,8 @@
 #include "router/database.h"
 
 #include <filesystem>
+#include <map>
+#include <string>
 
 #include <sqlite3.h>
 
@@ -33,10 +35,17 @@ class DatabaseSqlite : public Database
 public:
     ~DatabaseSqlite() override;
 
-    static std::unique_ptr<DatabaseSqlite> create();
-    static std::unique_ptr<DatabaseSqlite> open();
+    // The database is used in WAL mode. This is the value of "PRAGMA synchronous". With NORMAL
+    // a power loss can roll back the last transactions, but the database is never corrupted.
+    enum class Synchronous { OFF, NORMAL, FULL, EXTRA };
+
+    static std::unique_ptr<DatabaseSqlite> create(Synchronous synchronous);
+    static std::unique_ptr<DatabaseSqlite> open(Synchronous synchronous);
     static std::filesystem::path filePath();
 
+    // Parses "off", "normal", "full" or "extra".
+    static bool parseSynchronous(std::u16string_view name, Synchronous* synchronous);
+
     // Database implementation.
     std::vector<base::User> userList() const override;
     bool addUser(const base::User& user) override;
@@ -45,12 +54,26 @@ public:
     base::User findUser(std::u16string_view username) override;
     ErrorCode hostId(const base::ByteArray& key_hash, base::HostId* host_id) const override;
     bool addHost(const base::ByteArray& key_hash) override;
+    bool addHosts(const std::vector<Host>& hosts) override;
+    std::optional<base::HostId> lastHostId() const override;
+    bool reserveHostIds(size_t count, std::vector<base::HostId>* host_ids) override;
 
 private:
     explicit DatabaseSqlite(sqlite3* db);
     static std::filesystem::path databaseDirectory();
+    bool configure(Synchronous synchronous);
+
+    // Reads and moves the AUTOINCREMENT counter of the hosts. Must be called in a transaction.
+    std::optional<int64_t> hostSequence() const;
+    bool setHostSequence(int64_t value);
+
+    // Returns a prepared statement for |query|. The statements are prepared once and reused while
+    // the database is open. After use, the statement must be passed to releaseStatement().
+    int prepareStatement(std::string_view query, sqlite3_stmt** statement) const;
+    void releaseStatement(sqlite3_stmt* statement) const;
 
     sqlite3* db_;
+    mutable std::map<std::string, sqlite3_stmt*, std::less<>> statements_;
 
     DISALLOW_COPY_AND_ASSIGN(DatabaseSqlite);
 };
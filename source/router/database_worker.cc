@@ -0,0 +1,188 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "router/database_worker.h"
+
+#include "base/logging.h"
+#include "base/waitable_event.h"
+#include "base/threading/thread.h"
+#include "router/database_factory_cached.h"
+
+namespace router {
+
+namespace {
+
+// Database that waits for the worker for each call.
+class DatabaseProxy : public Database
+{
+public:
+    explicit DatabaseProxy(std::shared_ptr<const DatabaseWorker> worker)
+        : worker_(std::move(worker))
+    {
+        DCHECK(worker_);
+    }
+
+    ~DatabaseProxy() override = default;
+
+    std::vector<base::User> userList() const override
+    {
+        return worker_->wait([](Database* database) { return database->userList(); });
+    }
+
+    bool addUser(const base::User& user) override
+    {
+        return worker_->wait([&](Database* database) { return database->addUser(user); });
+    }
+
+    bool modifyUser(const base::User& user) override
+    {
+        return worker_->wait([&](Database* database) { return database->modifyUser(user); });
+    }
+
+    bool removeUser(int64_t entry_id) override
+    {
+        return worker_->wait([&](Database* database) { return database->removeUser(entry_id); });
+    }
+
+    base::User findUser(std::u16string_view username) override
+    {
+        return worker_->wait([&](Database* database) { return database->findUser(username); });
+    }
+
+    ErrorCode hostId(const base::ByteArray& key_hash, base::HostId* host_id) const override
+    {
+        return worker_->wait([&](Database* database)
+        {
+            return database->hostId(key_hash, host_id);
+        });
+    }
+
+    bool addHost(const base::ByteArray& key_hash) override
+    {
+        return worker_->wait([&](Database* database) { return database->addHost(key_hash); });
+    }
+
+    bool addHosts(const std::vector<Host>& hosts) override
+    {
+        return worker_->wait([&](Database* database) { return database->addHosts(hosts); });
+    }
+
+    std::optional<base::HostId> lastHostId() const override
+    {
+        return worker_->wait([](Database* database) { return database->lastHostId(); });
+    }
+
+    bool reserveHostIds(size_t count, std::vector<base::HostId>* host_ids) override
+    {
+        return worker_->wait([&](Database* database)
+        {
+            return database->reserveHostIds(count, host_ids);
+        });
+    }
+
+private:
+    std::shared_ptr<const DatabaseWorker> worker_;
+
+    DISALLOW_COPY_AND_ASSIGN(DatabaseProxy);
+};
+
+} // namespace
+
+DatabaseWorker::DatabaseWorker(std::shared_ptr<base::TaskRunner> task_runner,
+                               std::unique_ptr<DatabaseFactory> factory)
+    : task_runner_(std::move(task_runner)),
+      factory_(std::move(factory))
+{
+    DCHECK(task_runner_ && factory_);
+}
+
+DatabaseWorker::~DatabaseWorker()
+{
+    if (!thread_)
+        return;
+
+    // The queries that are already posted are finished before the database is closed. The
+    // database is closed on its thread because its timers belong to that thread.
+    db_task_runner_->postTask([this]()
+    {
+        database_.reset();
+        factory_.reset();
+    });
+
+    thread_->stop();
+}
+
+bool DatabaseWorker::start()
+{
+    if (thread_)
+    {
+        LOG(LS_WARNING) << "Database worker already started";
+        return database_ != nullptr;
+    }
+
+    thread_ = std::make_unique<base::Thread>();
+    thread_->start(base::MessageLoop::Type::DEFAULT);
+    db_task_runner_ = thread_->taskRunner();
+
+    runAndWait([this]()
+    {
+        factory_ = std::make_unique<DatabaseFactoryCached>(db_task_runner_, std::move(factory_));
+        database_ = factory_->openDatabase();
+    });
+
+    if (!database_)
+    {
+        LOG(LS_ERROR) << "Failed to open the database";
+        return false;
+    }
+
+    return true;
+}
+
+std::unique_ptr<Database> DatabaseWorker::createDatabase() const
+{
+    std::unique_ptr<Database> database;
+    runAndWait([&]() { database = factory_->createDatabase(); });
+    return database;
+}
+
+std::unique_ptr<Database> DatabaseWorker::openDatabase() const
+{
+    if (!database_)
+        return nullptr;
+
+    return std::make_unique<DatabaseProxy>(shared_from_this());
+}
+
+void DatabaseWorker::runAndWait(base::TaskRunner::Callback task) const
+{
+    DCHECK(db_task_runner_);
+    DCHECK(!db_task_runner_->belongsToCurrentThread());
+
+    base::WaitableEvent event;
+
+    db_task_runner_->postTask([&]()
+    {
+        task();
+        event.signal();
+    });
+
+    event.wait();
+}
+
+} // namespace router
@@ -0,0 +1,99 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef ROUTER_DATABASE_WORKER_H
+#define ROUTER_DATABASE_WORKER_H
+
+#include "base/macros_magic.h"
+#include "base/task_runner.h"
+#include "router/database.h"
+#include "router/database_factory.h"
+
+#include <type_traits>
+
+namespace base {
+class Thread;
+} // namespace base
+
+namespace router {
+
+// Runs the database calls on a dedicated thread, so a slow database does not stall the sessions.
+// The database of |factory| is opened once on that thread and is shared by all callers.
+// All methods must be called on the thread of |task_runner|.
+class DatabaseWorker
+    : public DatabaseFactory,
+      public std::enable_shared_from_this<DatabaseWorker>
+{
+public:
+    DatabaseWorker(std::shared_ptr<base::TaskRunner> task_runner,
+                   std::unique_ptr<DatabaseFactory> factory);
+    ~DatabaseWorker() override;
+
+    // Starts the thread and opens the database. Returns false if the database cannot be opened.
+    bool start();
+
+    // Calls |query| with the database on the database thread. Then |reply| is called with the
+    // result on the thread of |task_runner|. The caller must check in |reply| that it still exists.
+    template <typename QueryT, typename ReplyT>
+    void post(QueryT query, ReplyT reply) const
+    {
+        db_task_runner_->postTask([this,
+                                   task_runner = task_runner_,
+                                   query = std::move(query),
+                                   reply = std::move(reply)]()
+        {
+            auto result = query(database_.get());
+
+            task_runner->postTask([reply, result = std::move(result)]() mutable
+            {
+                reply(std::move(result));
+            });
+        });
+    }
+
+    // Calls |query| with the database on the database thread and waits for the result.
+    template <typename QueryT>
+    std::invoke_result_t<QueryT, Database*> wait(QueryT query) const
+    {
+        std::invoke_result_t<QueryT, Database*> result;
+        runAndWait([&]() { result = query(database_.get()); });
+        return result;
+    }
+
+    // DatabaseFactory implementation. The opened databases wait for each call, so they are only
+    // used where the result is required immediately.
+    std::unique_ptr<Database> createDatabase() const override;
+    std::unique_ptr<Database> openDatabase() const override;
+
+private:
+    void runAndWait(base::TaskRunner::Callback task) const;
+
+    std::shared_ptr<base::TaskRunner> task_runner_;
+    std::unique_ptr<base::Thread> thread_;
+    std::shared_ptr<base::TaskRunner> db_task_runner_;
+
+    // Used only on the database thread after start().
+    std::unique_ptr<DatabaseFactory> factory_;
+    std::unique_ptr<Database> database_;
+
+    DISALLOW_COPY_AND_ASSIGN(DatabaseWorker);
+};
+
+} // namespace router
+
+#endif // ROUTER_DATABASE_WORKER_H
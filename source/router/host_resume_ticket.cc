@@ -0,0 +1,120 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "router/host_resume_ticket.h"
+
+#include "base/endian_util.h"
+#include "base/crypto/generic_hash.h"
+
+#include <cstring>
+#include <ctime>
+
+namespace router {
+
+namespace {
+
+// The secret is derived from the private key for this use only.
+const char kSecretLabel[] = "aspia router host resume ticket";
+
+// Host ID, expiration time and the truncated signature.
+const size_t kSignatureSize = 32;
+const size_t kTicketSize = sizeof(uint64_t) + sizeof(int64_t) + kSignatureSize;
+
+// The comparison time does not depend on the position of the first difference.
+bool isEqualSignature(const uint8_t* first, const uint8_t* second)
+{
+    uint8_t difference = 0;
+    for (size_t i = 0; i < kSignatureSize; ++i)
+        difference |= first[i] ^ second[i];
+    return difference == 0;
+}
+
+} // namespace
+
+HostResumeTicket::HostResumeTicket(const base::ByteArray& private_key)
+{
+    base::GenericHash hash(base::GenericHash::BLAKE2b512);
+    hash.addData(kSecretLabel, sizeof(kSecretLabel));
+    hash.addData(private_key);
+    secret_ = hash.result();
+}
+
+HostResumeTicket::~HostResumeTicket() = default;
+
+std::string HostResumeTicket::issue(base::HostId host_id,
+                                    const base::ByteArray& key_hash,
+                                    std::chrono::seconds lifetime) const
+{
+    const int64_t expire_time = static_cast<int64_t>(time(nullptr)) + lifetime.count();
+
+    const uint64_t host_id_big = base::EndianUtil::toBig(static_cast<uint64_t>(host_id));
+    const uint64_t expire_time_big = base::EndianUtil::toBig(static_cast<uint64_t>(expire_time));
+
+    const base::ByteArray signature_data = signature(host_id, expire_time, key_hash);
+
+    std::string ticket;
+    ticket.reserve(kTicketSize);
+    ticket.append(reinterpret_cast<const char*>(&host_id_big), sizeof(host_id_big));
+    ticket.append(reinterpret_cast<const char*>(&expire_time_big), sizeof(expire_time_big));
+    ticket.append(reinterpret_cast<const char*>(signature_data.data()), kSignatureSize);
+    return ticket;
+}
+
+base::HostId HostResumeTicket::verify(
+    std::string_view ticket, const base::ByteArray& key_hash) const
+{
+    if (ticket.size() != kTicketSize)
+        return base::kInvalidHostId;
+
+    uint64_t host_id_big;
+    uint64_t expire_time_big;
+    memcpy(&host_id_big, ticket.data(), sizeof(host_id_big));
+    memcpy(&expire_time_big, ticket.data() + sizeof(host_id_big), sizeof(expire_time_big));
+
+    const base::HostId host_id = static_cast<base::HostId>(base::EndianUtil::fromBig(host_id_big));
+    const int64_t expire_time = static_cast<int64_t>(base::EndianUtil::fromBig(expire_time_big));
+
+    if (host_id == base::kInvalidHostId || expire_time < static_cast<int64_t>(time(nullptr)))
+        return base::kInvalidHostId;
+
+    const base::ByteArray expected = signature(host_id, expire_time, key_hash);
+    const uint8_t* actual =
+        reinterpret_cast<const uint8_t*>(ticket.data()) + kTicketSize - kSignatureSize;
+    if (!isEqualSignature(expected.data(), actual))
+        return base::kInvalidHostId;
+
+    return host_id;
+}
+
+base::ByteArray HostResumeTicket::signature(base::HostId host_id,
+                                            int64_t expire_time,
+                                            const base::ByteArray& key_hash) const
+{
+    const uint64_t host_id_big = base::EndianUtil::toBig(static_cast<uint64_t>(host_id));
+    const uint64_t expire_time_big = base::EndianUtil::toBig(static_cast<uint64_t>(expire_time));
+
+    // BLAKE2 is not prone to length extension, so the secret prefix makes a MAC.
+    base::GenericHash hash(base::GenericHash::BLAKE2b512);
+    hash.addData(secret_);
+    hash.addData(&host_id_big, sizeof(host_id_big));
+    hash.addData(&expire_time_big, sizeof(expire_time_big));
+    hash.addData(key_hash);
+    return hash.result();
+}
+
+} // namespace router
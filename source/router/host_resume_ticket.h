@@ -0,0 +1,60 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef ROUTER_HOST_RESUME_TICKET_H
+#define ROUTER_HOST_RESUME_TICKET_H
+
+#include "base/macros_magic.h"
+#include "base/memory/byte_array.h"
+#include "base/peer/host_id.h"
+
+#include <chrono>
+#include <string>
+
+namespace router {
+
+// Issues and checks the tickets with which a host gets its ID again without a lookup in the
+// database. The ticket is bound to the hash of the host key and is signed with a secret derived
+// from the private key of the router, so that it is accepted by a restarted router as well.
+class HostResumeTicket
+{
+public:
+    explicit HostResumeTicket(const base::ByteArray& private_key);
+    ~HostResumeTicket();
+
+    std::string issue(base::HostId host_id,
+                      const base::ByteArray& key_hash,
+                      std::chrono::seconds lifetime) const;
+
+    // Returns the host ID from the ticket or base::kInvalidHostId if the ticket is invalid,
+    // expired or issued for another key.
+    base::HostId verify(std::string_view ticket, const base::ByteArray& key_hash) const;
+
+private:
+    base::ByteArray signature(base::HostId host_id,
+                              int64_t expire_time,
+                              const base::ByteArray& key_hash) const;
+
+    base::ByteArray secret_;
+
+    DISALLOW_COPY_AND_ASSIGN(HostResumeTicket);
+};
+
+} // namespace router
+
+#endif // ROUTER_HOST_RESUME_TICKET_H
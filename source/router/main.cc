@@ -18,10 +18,14 @@
 
 #include "base/command_line.h"
 #include "base/logging.h"
+#include "base/crypto/generic_hash.h"
 #include "base/crypto/key_pair.h"
 #include "base/files/base_paths.h"
 #include "base/files/file_util.h"
+#include "base/peer/host_id.h"
 #include "base/peer/user.h"
+#include "base/strings/string_split.h"
+#include "base/strings/string_util.h"
 #include "build/version.h"
 #include "router/database_factory_sqlite.h"
 #include "router/database.h"
@@ -32,15 +36,23 @@
 #include "router/service.h"
 #include "router/win/service_util.h"
 #else
+#include "base/task_runner.h"
 #include "base/crypto/scoped_crypto_initializer.h"
 #include "base/message_loop/message_loop.h"
+#include "base/message_loop/message_pump_asio.h"
 #include "router/server.h"
+
+#include <asio/signal_set.hpp>
 #endif
 
+#include <fstream>
 #include <iostream>
 
 namespace {
 
+// Hosts are written to the database in transactions of this size.
+const size_t kImportBatchSize = 10000;
+
 bool generateKeys(base::ByteArray* private_key, base::ByteArray* public_key)
 {
     base::KeyPair key_pair = base::KeyPair::create(base::KeyPair::Type::X25519);
@@ -206,6 +218,96 @@ void createConfig()
     std::cout << "Public key file: " << public_key_file << std::endl;
 }
 
+bool addHosts(router::Database* database, std::vector<router::Database::Host>* hosts)
+{
+    if (!database->addHosts(*hosts))
+    {
+        std::cout << "Failed to add hosts to the database. Hosts in the failed batch are not added."
+                  << std::endl;
+        return false;
+    }
+
+    hosts->clear();
+    return true;
+}
+
+// Imports hosts from a file with lines "<host id> <key in hex>". The keys are those the hosts send
+// to the router. Empty lines and lines starting with '#' are ignored.
+void importHosts(const std::filesystem::path& file_path)
+{
+    std::ifstream stream(file_path);
+    if (!stream.is_open())
+    {
+        std::cout << "Unable to open file " << file_path << std::endl;
+        return;
+    }
+
+    std::unique_ptr<router::DatabaseFactory> factory =
+        router::DatabaseFactory::create(router::Settings());
+    if (!factory)
+    {
+        std::cout << "Invalid database settings in the configuration." << std::endl;
+        return;
+    }
+
+    std::unique_ptr<router::Database> database = factory->openDatabase();
+    if (!database)
+    {
+        std::cout << "Failed to open the database." << std::endl;
+        return;
+    }
+
+    std::vector<router::Database::Host> hosts;
+    hosts.reserve(kImportBatchSize);
+
+    size_t line_number = 0;
+    size_t imported_count = 0;
+    std::string line;
+
+    while (std::getline(stream, line))
+    {
+        ++line_number;
+
+        std::string_view trimmed = base::trimWhitespaceASCII(line, base::TRIM_ALL);
+        if (trimmed.empty() || trimmed.front() == '#')
+            continue;
+
+        std::vector<std::string_view> parts = base::splitStringView(
+            trimmed, " \t", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
+
+        router::Database::Host host;
+        host.host_id = parts.size() == 2 ? base::stringToHostId(parts[0]) : base::kInvalidHostId;
+
+        base::ByteArray key = parts.size() == 2 ? base::fromHex(parts[1]) : base::ByteArray();
+        if (host.host_id == base::kInvalidHostId || key.empty())
+        {
+            std::cout << "Invalid line " << line_number << ". Import stopped." << std::endl;
+            break;
+        }
+
+        host.key_hash = base::GenericHash::hash(base::GenericHash::Type::BLAKE2b512, key);
+        hosts.emplace_back(std::move(host));
+
+        if (hosts.size() >= kImportBatchSize)
+        {
+            if (!addHosts(database.get(), &hosts))
+                break;
+
+            imported_count += kImportBatchSize;
+            std::cout << "Imported hosts: " << imported_count << std::endl;
+        }
+    }
+
+    if (!hosts.empty())
+    {
+        const size_t count = hosts.size();
+        if (addHosts(database.get(), &hosts))
+            imported_count += count;
+    }
+
+    std::cout << "Total imported hosts: " << imported_count << std::endl;
+}
+
 void showHelp()
 {
     std::cout << "aspia_router [switch]" << std::endl
@@ -218,6 +320,8 @@ void showHelp()
 #endif // defined(OS_WIN)
         << '\t' << "--create-config" << '\t' << "Creates a configuration" << std::endl
         << '\t' << "--keygen" << '\t' << "Generating public and private keys" << std::endl
+        << '\t' << "--import-hosts=FILE" << '\t' << "Imports lines \"<host id> <key in hex>\""
+        << std::endl
         << '\t' << "--help" << '\t' << "Show help" << std::endl;
 }
 
@@ -259,6 +363,10 @@ int wmain()
     {
         createConfig();
     }
+    else if (command_line->hasSwitch(u"import-hosts"))
+    {
+        importHosts(command_line->switchValuePath(u"import-hosts"));
+    }
     else if (command_line->hasSwitch(u"help"))
     {
         showHelp();
@@ -293,6 +401,10 @@ int main(int argc, const char* const* argv)
     {
         createConfig();
     }
+    else if (command_line->hasSwitch(u"import-hosts"))
+    {
+        importHosts(command_line->switchValuePath(u"import-hosts"));
+    }
     else if (command_line->hasSwitch(u"help"))
     {
         showHelp();
@@ -306,6 +418,34 @@ int main(int argc, const char* const* argv)
             std::make_unique<router::Server>(message_loop->taskRunner());
 
         server->start();
+
+        // On a stop signal the hosts are asked to reconnect at different times, so that the
+        // restarted router does not get all of them at once. The second stop signal quits at
+        // once.
+        std::shared_ptr<base::TaskRunner> task_runner = message_loop->taskRunner();
+        asio::signal_set signals(message_loop->pumpAsio()->ioContext(), SIGINT, SIGTERM);
+
+        std::function<void(const std::error_code&, int)> on_signal =
+            [&](const std::error_code& error_code, int signal)
+        {
+            if (error_code)
+                return;
+
+            if (!server->isDraining())
+            {
+                LOG(LS_INFO) << "Stop signal received: " << signal;
+                server->drain([task_runner]() { task_runner->postQuit(); });
+            }
+            else
+            {
+                LOG(LS_INFO) << "Second stop signal received: " << signal;
+                task_runner->postQuit();
+            }
+
+            signals.async_wait(on_signal);
+        };
+
+        signals.async_wait(on_signal);
         message_loop->run();
 
         server.reset();
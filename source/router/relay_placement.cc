@@ -0,0 +1,168 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "router/relay_placement.h"
+
+#include "base/logging.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
+#include "base/strings/string_util.h"
+#include "base/strings/unicode.h"
+
+#include <asio/ip/address.hpp>
+
+#include <algorithm>
+
+namespace router {
+
+namespace {
+
+const int kIpV4MappedOffset = 96;
+
+bool parseAddress(std::string_view address, std::array<uint8_t, 16>* bytes, bool* is_v4)
+{
+    std::error_code error_code;
+    asio::ip::address ip_address = asio::ip::make_address(std::string(address), error_code);
+    if (error_code)
+        return false;
+
+    if (ip_address.is_v4())
+    {
+        *bytes = asio::ip::make_address_v6(
+            asio::ip::v4_mapped, ip_address.to_v4()).to_bytes();
+        *is_v4 = true;
+    }
+    else
+    {
+        *bytes = ip_address.to_v6().to_bytes();
+        *is_v4 = false;
+    }
+
+    return true;
+}
+
+bool isPrefixEqual(const std::array<uint8_t, 16>& first,
+                   const std::array<uint8_t, 16>& second,
+                   int prefix_length)
+{
+    const int full_bytes = prefix_length / 8;
+
+    if (!std::equal(first.begin(), first.begin() + full_bytes, second.begin()))
+        return false;
+
+    const int remaining_bits = prefix_length % 8;
+    if (!remaining_bits)
+        return true;
+
+    const uint8_t mask = static_cast<uint8_t>(0xFF << (8 - remaining_bits));
+    return (first[full_bytes] & mask) == (second[full_bytes] & mask);
+}
+
+} // namespace
+
+RelayPlacement::RelayPlacement() = default;
+
+RelayPlacement::~RelayPlacement() = default;
+
+bool RelayPlacement::addRules(std::u16string_view rules)
+{
+    bool result = true;
+
+    for (const auto& rule : base::splitStringView(
+             rules, u";", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY))
+    {
+        const size_t separator = rule.find(u'=');
+        if (separator == std::u16string_view::npos ||
+            !addRule(rule.substr(0, separator), rule.substr(separator + 1)))
+        {
+            LOG(LS_ERROR) << "Invalid region rule: " << std::u16string(rule);
+            result = false;
+        }
+    }
+
+    // The longest prefix is checked first.
+    std::stable_sort(rules_.begin(), rules_.end(), [](const Rule& first, const Rule& second)
+    {
+        return first.prefix_length > second.prefix_length;
+    });
+
+    return result;
+}
+
+std::string RelayPlacement::region(std::string_view address) const
+{
+    if (rules_.empty())
+        return std::string();
+
+    std::array<uint8_t, 16> bytes;
+    bool is_v4;
+
+    if (!parseAddress(address, &bytes, &is_v4))
+        return std::string();
+
+    for (const auto& rule : rules_)
+    {
+        if (isPrefixEqual(rule.network, bytes, rule.prefix_length))
+            return rule.region;
+    }
+
+    return std::string();
+}
+
+bool RelayPlacement::addRule(std::u16string_view rule_network, std::u16string_view rule_region)
+{
+    const std::u16string network = base::collapseWhitespace(rule_network, true);
+    std::u16string_view address = network;
+    std::u16string_view prefix;
+
+    const size_t slash = network.find(u'/');
+    if (slash != std::u16string::npos)
+    {
+        prefix = address.substr(slash + 1);
+        address = address.substr(0, slash);
+    }
+
+    Rule rule;
+    bool is_v4;
+
+    if (!parseAddress(base::utf8FromUtf16(address), &rule.network, &is_v4))
+        return false;
+
+    const int max_prefix_length = is_v4 ? 32 : 128;
+
+    rule.prefix_length = max_prefix_length;
+    if (!prefix.empty())
+    {
+        if (!base::stringToInt(prefix, &rule.prefix_length) ||
+            rule.prefix_length < 0 || rule.prefix_length > max_prefix_length)
+        {
+            return false;
+        }
+    }
+
+    if (is_v4)
+        rule.prefix_length += kIpV4MappedOffset;
+
+    rule.region = base::utf8FromUtf16(base::collapseWhitespace(rule_region, true));
+    if (rule.region.empty())
+        return false;
+
+    rules_.emplace_back(std::move(rule));
+    return true;
+}
+
+} // namespace router
@@ -0,0 +1,65 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef ROUTER_RELAY_PLACEMENT_H
+#define ROUTER_RELAY_PLACEMENT_H
+
+#include "base/macros_magic.h"
+
+#include <array>
+#include <string>
+#include <vector>
+
+namespace router {
+
+// Maps peer and relay addresses to regions. The relay for a connection is preferably taken from
+// the region of the client or the host.
+class RelayPlacement
+{
+public:
+    RelayPlacement();
+    ~RelayPlacement();
+
+    // Adds rules in the format "network=region;network=region". A network is an IPv4 or IPv6
+    // address with an optional prefix length, for example "10.1.0.0/16". Returns false if any of
+    // the rules is invalid. Valid rules are added anyway.
+    bool addRules(std::u16string_view rules);
+
+    // Returns the region of the longest matching rule or an empty string.
+    std::string region(std::string_view address) const;
+
+    size_t ruleCount() const { return rules_.size(); }
+
+private:
+    struct Rule
+    {
+        std::array<uint8_t, 16> network; // IPv4 addresses are stored as IPv4-mapped IPv6.
+        int prefix_length;
+        std::string region;
+    };
+
+    bool addRule(std::u16string_view rule_network, std::u16string_view rule_region);
+
+    // Rules sorted by prefix length in descending order.
+    std::vector<Rule> rules_;
+
+    DISALLOW_COPY_AND_ASSIGN(RelayPlacement);
+};
+
+} // namespace router
+
+#endif // ROUTER_RELAY_PLACEMENT_H
@@ -22,22 +22,53 @@
 #include "base/stl_util.h"
 #include "base/task_runner.h"
 #include "base/crypto/key_pair.h"
+#include "base/crypto/random.h"
 #include "base/files/base_paths.h"
 #include "base/files/file_util.h"
+#include "base/metrics/metrics_registry.h"
 #include "base/net/tcp_channel.h"
-#include "router/database_factory_sqlite.h"
-#include "router/database_sqlite.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
+#include "base/strings/unicode.h"
+#include "base/threading/thread.h"
+#include "router/database_worker.h"
+#include "router/host_resume_ticket.h"
 #include "router/session_admin.h"
 #include "router/session_client.h"
+#include "router/session_cluster.h"
 #include "router/session_host.h"
 #include "router/session_relay.h"
 #include "router/settings.h"
 #include "router/user_list_db.h"
 
+#include <algorithm>
+#include <set>
+
 namespace router {
 
 namespace {
 
+const uint32_t kMaxAcceptOperations = 256;
+const uint32_t kMaxAcceptThreads = 64;
+const uint32_t kMaxAuthWorkerThreads = 64;
+const uint32_t kMaxCryptoWorkerThreads = 64;
+const uint32_t kMaxRelayKeyPoolWatermark = 10000;
+
+// Hosts send their own pings to the router, so the router pings only hosts that are silent for
+// this interval. Dead connections of idle hosts are detected by the keep alive of the OS.
+const std::chrono::seconds kHostKeepAliveInterval { 180 };
+const std::chrono::seconds kHostKeepAliveTimeout { 30 };
+const std::chrono::seconds kHostTcpKeepAliveIdle { 120 };
+const std::chrono::seconds kHostTcpKeepAliveInterval { 15 };
+
+// The hosts do not reconnect earlier, so that the new process of the router has time to start.
+const std::chrono::seconds kMinReconnectDelay { 5 };
+
+const std::chrono::seconds kMaxDrainWindow { 3600 };
+
+// Time for sending the reconnect notices before the router stops.
+const std::chrono::seconds kDrainFlushTime { 2 };
+
 const char* sessionTypeToString(proto::RouterSession session_type)
 {
     switch (session_type)
@@ -54,16 +85,80 @@ const char* sessionTypeToString(proto::RouterSession session_type)
         case proto::ROUTER_SESSION_RELAY:
             return "ROUTER_SESSION_RELAY";
 
+        case proto::ROUTER_SESSION_CLUSTER:
+            return "ROUTER_SESSION_CLUSTER";
+
         default:
             return "ROUTER_SESSION_UNKNOWN";
     }
 }
 
+bool isSessionMatched(const Session& session, const proto::SessionListRequest& request)
+{
+    if (request.session_types() && !(request.session_types() & session.sessionType()))
+        return false;
+
+    const std::string& filter = request.filter();
+    if (filter.empty())
+        return true;
+
+    if (session.address().find(filter) != std::string::npos ||
+        session.computerName().find(filter) != std::string::npos ||
+        session.userName().find(filter) != std::string::npos)
+    {
+        return true;
+    }
+
+    if (session.sessionType() == proto::ROUTER_SESSION_HOST)
+    {
+        for (const auto& host_id : static_cast<const SessionHost&>(session).hostIdList())
+        {
+            if (base::numberToString(host_id).find(filter) != std::string::npos)
+                return true;
+        }
+    }
+
+    return false;
+}
+
+bool isInventoryMatched(const SessionHost& session, const std::string& filter)
+{
+    if (session.inventory().empty())
+        return false;
+
+    if (filter.empty())
+        return true;
+
+    for (const auto& item : session.inventory())
+    {
+        if (item.second.find(filter) != std::string::npos)
+            return true;
+    }
+
+    return false;
+}
+
+void inventoryToProto(const SessionHost& session, proto::InventoryList::Host* item)
+{
+    item->set_session_id(session.sessionId());
+    item->set_timepoint(static_cast<uint64_t>(session.inventoryTime()));
+
+    for (const auto& host_id : session.hostIdList())
+        item->add_host_id(host_id);
+
+    for (const auto& value : session.inventory())
+    {
+        proto::InventoryItem* inventory_item = item->add_item();
+        inventory_item->set_key(value.first);
+        inventory_item->set_value(value.second);
+    }
+}
+
 } // namespace
 
 Server::Server(std::shared_ptr<base::TaskRunner> task_runner)
     : task_runner_(std::move(task_runner)),
-      database_factory_(base::make_local_shared<DatabaseFactorySqlite>())
+      drain_timer_(base::WaitableTimer::Type::SINGLE_SHOT, task_runner_)
 {
     LOG(LS_INFO) << "Ctor";
     DCHECK(task_runner_);
@@ -82,14 +177,21 @@ bool Server::start()
         return false;
     }
 
-    std::unique_ptr<Database> database = database_factory_->openDatabase();
-    if (!database)
+    Settings settings;
+
+    std::unique_ptr<DatabaseFactory> database_factory = DatabaseFactory::create(settings);
+    if (!database_factory)
     {
-        LOG(LS_ERROR) << "Failed to open the database";
+        LOG(LS_ERROR) << "Invalid database settings";
         return false;
     }
 
-    Settings settings;
+    database_worker_ = std::make_shared<DatabaseWorker>(task_runner_, std::move(database_factory));
+    if (!database_worker_->start())
+    {
+        LOG(LS_ERROR) << "Failed to open the database";
+        return false;
+    }
 
     base::ByteArray private_key = settings.privateKey();
     if (private_key.empty())
@@ -98,6 +200,8 @@ bool Server::start()
         return false;
     }
 
+    host_resume_ticket_ = std::make_unique<HostResumeTicket>(private_key);
+
     std::u16string listen_interface = settings.listenInterface();
     if (!base::TcpServer::isValidListenInterface(listen_interface))
     {
@@ -164,7 +268,7 @@ bool Server::start()
             LOG(LS_INFO) << "#" << (i + 1) << ": " << relay_white_list_[i];
     }
 
-    std::unique_ptr<base::UserListBase> user_list = UserListDb::open(*database_factory_);
+    std::unique_ptr<base::UserListBase> user_list = UserListDb::open(database_worker_);
 
     authenticator_manager_ =
         std::make_unique<base::ServerAuthenticatorManager>(task_runner_, this);
@@ -173,146 +277,286 @@ bool Server::start()
     authenticator_manager_->setAnonymousAccess(
         base::ServerAuthenticator::AnonymousAccess::ENABLE,
         proto::ROUTER_SESSION_HOST | proto::ROUTER_SESSION_RELAY);
+    authenticator_manager_->setWorkerThreadCount(
+        std::min(settings.authWorkerThreads(), kMaxAuthWorkerThreads));
+    authenticator_manager_->setMaxPendingCount(settings.maxPendingAuthentications());
+    authenticator_manager_->setMaxWaitingCount(settings.maxWaitingAuthentications());
+    authenticator_manager_->setRateLimits(
+        settings.authRatePerAddress(), settings.authRatePerUser());
+
+    max_sessions_ = settings.maxSessions();
+    LOG(LS_INFO) << "Max sessions: " << max_sessions_;
+
+    drain_window_ = std::min(std::chrono::seconds(settings.drainWindow()), kMaxDrainWindow);
+    LOG(LS_INFO) << "Drain window: " << drain_window_.count() << " s";
+
+    const uint32_t crypto_thread_count =
+        std::min(settings.cryptoWorkerThreads(), kMaxCryptoWorkerThreads);
+    crypto_threshold_ = settings.cryptoOffloadThreshold();
+
+    LOG(LS_INFO) << "Crypto worker threads: " << crypto_thread_count
+                 << " (threshold: " << crypto_threshold_ << ")";
+
+    for (uint32_t i = 0; i < crypto_thread_count; ++i)
+    {
+        std::unique_ptr<base::Thread> thread = std::make_unique<base::Thread>();
+        thread->start(base::MessageLoop::Type::DEFAULT);
+        crypto_threads_.emplace_back(std::move(thread));
+    }
 
     relay_key_pool_ = std::make_unique<SharedKeyPool>(this);
+    relay_key_pool_->setWatermarks(
+        std::min(settings.relayKeyPoolLowWatermark(), kMaxRelayKeyPoolWatermark),
+        std::min(settings.relayKeyPoolHighWatermark(), kMaxRelayKeyPoolWatermark));
+
+    if (!relay_placement_.addRules(settings.relayRegions()))
+        LOG(LS_WARNING) << "Some relay regions are ignored";
+    LOG(LS_INFO) << "Relay region rules: " << relay_placement_.ruleCount();
 
     server_ = std::make_unique<base::TcpServer>();
+
+    if (settings.acceptBacklog())
+        server_->setBacklog(static_cast<int>(std::min(settings.acceptBacklog(), 65535u)));
+    server_->setAcceptCount(std::min(settings.acceptOperations(), kMaxAcceptOperations));
+    server_->setIoThreadCount(std::min(settings.acceptThreads(), kMaxAcceptThreads));
+
     server_->start(listen_interface, port, this);
 
+    if (!startMetricsServer(settings))
+        return false;
+
+    startCluster(settings, port);
+
     LOG(LS_INFO) << "Server started";
     return true;
 }
 
-std::unique_ptr<proto::SessionList> Server::sessionList() const
+void Server::drain(base::WaitableTimer::TimeoutCallback callback)
 {
-    std::unique_ptr<proto::SessionList> result = std::make_unique<proto::SessionList>();
+    if (is_draining_)
+        return;
 
-    for (const auto& session : sessions_)
-    {
-        proto::Session* item = result->add_session();
+    LOG(LS_INFO) << "Draining the router (reconnect window: " << drain_window_.count() << " s)";
+    is_draining_ = true;
 
-        item->set_session_id(session->sessionId());
-        item->set_session_type(session->sessionType());
-        item->set_timepoint(static_cast<uint64_t>(session->startTime()));
-        item->set_ip_address(session->address());
-        item->mutable_version()->CopyFrom(session->version().toProto());
-        item->set_os_name(session->osName());
-        item->set_computer_name(session->computerName());
+    // The listening socket is released for the new process.
+    server_.reset();
 
-        switch (session->sessionType())
-        {
-            case proto::ROUTER_SESSION_HOST:
-            {
-                proto::HostSessionData session_data;
+    if (drain_window_ == std::chrono::seconds::zero())
+    {
+        task_runner_->postTask(std::move(callback));
+        return;
+    }
 
-                for (const auto& host_id : static_cast<SessionHost*>(session.get())->hostIdList())
-                    session_data.add_host_id(host_id);
+    const uint64_t window_ms =
+        static_cast<uint64_t>(std::chrono::milliseconds(drain_window_).count()) + 1;
+    size_t host_count = 0;
 
-                item->set_session_data(session_data.SerializeAsString());
-            }
-            break;
+    for (const auto& session : sessions_.sessions())
+    {
+        if (session.second->sessionType() != proto::ROUTER_SESSION_HOST || !host_resume_ticket_)
+            continue;
 
-            case proto::ROUTER_SESSION_RELAY:
-            {
-                proto::RelaySessionData session_data;
-                session_data.set_pool_size(relay_key_pool_->countForRelay(session->sessionId()));
-
-                const std::optional<proto::RelayStat>& in_relay_stat =
-                    static_cast<SessionRelay*>(session.get())->relayStat();
-                if (in_relay_stat.has_value())
-                {
-                    proto::RelaySessionData::RelayStat* out_relay_stat =
-                        session_data.mutable_relay_stat();
-
-                    out_relay_stat->set_uptime(in_relay_stat->uptime());
-                    out_relay_stat->mutable_peer_connection()->CopyFrom(
-                        in_relay_stat->peer_connection());
-                }
-
-                item->set_session_data(session_data.SerializeAsString());
-            }
-            break;
+        // Hosts that do not support the notice ignore it and reconnect when the connection is
+        // lost.
+        const std::chrono::milliseconds delay = kMinReconnectDelay +
+            std::chrono::milliseconds(base::Random::number64() % window_ms);
 
-            default:
-                break;
-        }
+        static_cast<SessionHost*>(session.second.get())->sendReconnectNotice(
+            delay, *host_resume_ticket_);
+        ++host_count;
     }
 
-    result->set_error_code(proto::SessionList::SUCCESS);
-    return result;
+    LOG(LS_INFO) << "Reconnect notices sent to " << host_count << " hosts";
+    drain_timer_.start(kDrainFlushTime, std::move(callback));
 }
 
-bool Server::stopSession(Session::SessionId session_id)
+void Server::addSessionObserver(SessionObserver* observer)
 {
-    for (auto it = sessions_.begin(); it != sessions_.end(); ++it)
+    DCHECK(observer);
+
+    if (std::find(session_observers_.begin(), session_observers_.end(), observer) ==
+        session_observers_.end())
     {
-        if (it->get()->sessionId() == session_id)
-        {
-            sessions_.erase(it);
-            return true;
-        }
+        session_observers_.emplace_back(observer);
     }
+}
 
-    return false;
+void Server::removeSessionObserver(SessionObserver* observer)
+{
+    session_observers_.erase(
+        std::remove(session_observers_.begin(), session_observers_.end(), observer),
+        session_observers_.end());
 }
 
-void Server::onHostSessionWithId(SessionHost* session)
+void Server::notifySessionChanged(const Session& session)
 {
-    for (auto it = sessions_.begin(); it != sessions_.end();)
+    for (SessionObserver* observer : session_observers_)
+        observer->onSessionChanged(session.sessionId(), session.sessionType());
+}
+
+std::unique_ptr<proto::SessionList> Server::sessionList(
+    const proto::SessionListRequest& request) const
+{
+    std::unique_ptr<proto::SessionList> result = std::make_unique<proto::SessionList>();
+
+    const SessionMap::Sessions& sessions = sessions_.sessions();
+    const uint32_t max_count = request.max_count();
+
+    for (auto it = sessions.upper_bound(request.start_session_id()); it != sessions.end(); ++it)
     {
-        if (it->get()->sessionType() == proto::ROUTER_SESSION_HOST)
+        const Session& session = *it->second;
+        if (!isSessionMatched(session, request))
+            continue;
+
+        if (max_count && static_cast<uint32_t>(result->session_size()) >= max_count)
         {
-            SessionHost* other_session = reinterpret_cast<SessionHost*>(it->get());
-            if (other_session != session)
-            {
-                for (const auto& host_id : session->hostIdList())
-                {
-                    if (other_session->hasHostId(host_id))
-                    {
-                        LOG(LS_INFO) << "Detected previous connection with ID " << host_id;
-
-                        it = sessions_.erase(it);
-                        continue;
-                    }
-                }
-            }
+            result->set_has_more(true);
+            result->set_next_session_id(
+                result->session(result->session_size() - 1).session_id());
+            break;
         }
 
-        ++it;
+        sessionToProto(session, result->add_session());
     }
+
+    result->set_error_code(proto::SessionList::SUCCESS);
+    return result;
 }
 
-SessionHost* Server::hostSessionById(base::HostId host_id)
+bool Server::sessionInfo(Session::SessionId session_id,
+                         const proto::SessionListRequest& request,
+                         proto::Session* item) const
+{
+    const Session* session = sessions_.session(session_id);
+    if (!session || !isSessionMatched(*session, request))
+        return false;
+
+    sessionToProto(*session, item);
+    return true;
+}
+
+std::unique_ptr<proto::InventoryList> Server::inventoryList(
+    const proto::InventoryRequest& request) const
 {
-    for (auto it = sessions_.begin(); it != sessions_.end(); ++it)
+    std::unique_ptr<proto::InventoryList> result = std::make_unique<proto::InventoryList>();
+
+    if (request.host_id_size())
     {
-        Session* entry = it->get();
+        std::set<Session::SessionId> added_sessions;
 
-        if (entry->sessionType() == proto::ROUTER_SESSION_HOST &&
-            static_cast<SessionHost*>(entry)->hasHostId(host_id))
+        // One session can have several host IDs.
+        for (int i = 0; i < request.host_id_size(); ++i)
         {
-            return static_cast<SessionHost*>(entry);
+            const SessionHost* session = sessions_.hostSession(request.host_id(i));
+            if (!session || !isInventoryMatched(*session, request.filter()))
+                continue;
+
+            if (added_sessions.insert(session->sessionId()).second)
+                inventoryToProto(*session, result->add_host());
         }
+
+        return result;
+    }
+
+    for (const auto& session : sessions_.sessions())
+    {
+        if (session.second->sessionType() != proto::ROUTER_SESSION_HOST)
+            continue;
+
+        const SessionHost& host_session = static_cast<const SessionHost&>(*session.second);
+        if (isInventoryMatched(host_session, request.filter()))
+            inventoryToProto(host_session, result->add_host());
     }
 
-    return nullptr;
+    return result;
+}
+
+void Server::addConnectionTrace(const ConnectionTrace& trace)
+{
+    connection_trace_stats_.add(trace);
+}
+
+std::unique_ptr<proto::ConnectionStats> Server::connectionStats() const
+{
+    std::unique_ptr<proto::ConnectionStats> result = std::make_unique<proto::ConnectionStats>();
+    connection_trace_stats_.toProto(result.get());
+    return result;
+}
+
+bool Server::stopSession(Session::SessionId session_id)
+{
+    return takeSession(session_id) != nullptr;
+}
+
+void Server::onHostIdAdded(SessionHost* session, base::HostId host_id)
+{
+    SessionHost* previous_session = sessions_.addHostId(session, host_id);
+    notifySessionChanged(*session);
+
+    for (const auto& cluster_link : cluster_links_)
+        cluster_link->addHost(host_id, session->address());
+
+    if (!previous_session)
+        return;
+
+    LOG(LS_INFO) << "Detected previous connection with ID " << host_id;
+    takeSession(previous_session->sessionId());
+}
+
+void Server::onHostIdRemoved(SessionHost* session, base::HostId host_id)
+{
+    sessions_.removeHostId(session, host_id);
+    notifySessionChanged(*session);
+
+    if (sessions_.hostSession(host_id))
+        return;
+
+    for (const auto& cluster_link : cluster_links_)
+        cluster_link->removeHost(host_id);
+}
+
+SessionHost* Server::hostSessionById(base::HostId host_id)
+{
+    return sessions_.hostSession(host_id);
 }
 
 Session* Server::sessionById(Session::SessionId session_id)
 {
-    for (auto& session : sessions_)
-    {
-        if (session->sessionId() == session_id)
-            return session.get();
-    }
+    return sessions_.session(session_id);
+}
+
+void Server::onClusterHostAdded(SessionCluster* session, base::HostId host_id)
+{
+    sessions_.addClusterHostId(session, host_id);
+}
+
+void Server::onClusterHostRemoved(SessionCluster* session, base::HostId host_id)
+{
+    sessions_.removeClusterHostId(session, host_id);
+}
 
-    return nullptr;
+SessionCluster* Server::clusterSessionByHostId(base::HostId host_id)
+{
+    return sessions_.clusterSession(host_id);
 }
 
 void Server::onNewConnection(std::unique_ptr<base::TcpChannel> channel)
 {
     LOG(LS_INFO) << "New connection: " << channel->peerAddress();
 
+    if (max_sessions_ && sessions_.sessions().size() >= max_sessions_)
+    {
+        // The channel is closed when it is destroyed. The existing sessions keep their resources.
+        LOG(LS_WARNING) << "Session limit reached. Connection rejected";
+
+        static base::Counter* rejected_counter = base::MetricsRegistry::global().counter(
+            "router_rejected_connections_total",
+            "Connections closed because of the session limit.");
+        rejected_counter->add();
+        return;
+    }
+
     channel->setKeepAlive(true);
     channel->setNoDelay(true);
 
@@ -322,12 +566,16 @@ void Server::onNewConnection(std::unique_ptr<base::TcpChannel> channel)
 
 void Server::onPoolKeyUsed(Session::SessionId session_id, uint32_t key_id)
 {
-    for (const auto& session : sessions_)
-    {
-        SessionRelay* relay_session = static_cast<SessionRelay*>(session.get());
-        if (relay_session->sessionId() == session_id)
-            relay_session->sendKeyUsed(key_id);
-    }
+    Session* session = sessions_.session(session_id);
+    if (session && session->sessionType() == proto::ROUTER_SESSION_RELAY)
+        static_cast<SessionRelay*>(session)->sendKeyUsed(key_id);
+}
+
+void Server::onPoolKeysRequired(Session::SessionId session_id, uint32_t key_count)
+{
+    Session* session = sessions_.session(session_id);
+    if (session && session->sessionType() == proto::ROUTER_SESSION_RELAY)
+        static_cast<SessionRelay*>(session)->sendKeyPoolRequest(key_count);
 }
 
 void Server::onNewSession(base::ServerAuthenticatorManager::SessionInfo&& session_info)
@@ -338,12 +586,26 @@ void Server::onNewSession(base::ServerAuthenticatorManager::SessionInfo&& sessio
 
     LOG(LS_INFO) << "New session: " << sessionTypeToString(session_type) << " (" << address << ")";
 
+    // The peer connects to the new process of the router instead.
+    if (is_draining_)
+    {
+        LOG(LS_INFO) << "Router is draining. Connection rejected for '" << address << "'";
+        return;
+    }
+
     if (session_info.version >= base::Version(2, 6, 0))
     {
         LOG(LS_INFO) << "Using channel id support";
         session_info.channel->setChannelIdSupport(true);
     }
 
+    if (!crypto_threads_.empty())
+    {
+        session_info.channel->setCryptoTaskRunner(
+            crypto_threads_[next_crypto_thread_]->taskRunner(), crypto_threshold_);
+        next_crypto_thread_ = (next_crypto_thread_ + 1) % crypto_threads_.size();
+    }
+
     std::unique_ptr<Session> session;
 
     switch (session_info.session_type)
@@ -362,6 +624,11 @@ void Server::onNewSession(base::ServerAuthenticatorManager::SessionInfo&& sessio
             if (!host_white_list_.empty() && !base::contains(host_white_list_, address))
                 break;
 
+            session_info.channel->setKeepAlive(
+                true, kHostKeepAliveInterval, kHostKeepAliveTimeout, true);
+            session_info.channel->setTcpKeepAlive(
+                true, kHostTcpKeepAliveIdle, kHostTcpKeepAliveInterval);
+
             session = std::make_unique<SessionHost>();
         }
         break;
@@ -384,6 +651,10 @@ void Server::onNewSession(base::ServerAuthenticatorManager::SessionInfo&& sessio
         }
         break;
 
+        case proto::ROUTER_SESSION_CLUSTER:
+            session = std::make_unique<SessionCluster>();
+            break;
+
         default:
         {
             LOG(LS_ERROR) << "Unsupported session type: "
@@ -399,7 +670,7 @@ void Server::onNewSession(base::ServerAuthenticatorManager::SessionInfo&& sessio
     }
 
     session->setChannel(std::move(session_info.channel));
-    session->setDatabaseFactory(database_factory_);
+    session->setDatabaseWorker(database_worker_);
     session->setServer(this);
     session->setRelayKeyPool(relay_key_pool_->share());
     session->setVersion(session_info.version);
@@ -407,23 +678,197 @@ void Server::onNewSession(base::ServerAuthenticatorManager::SessionInfo&& sessio
     session->setComputerName(session_info.computer_name);
     session->setUserName(session_info.user_name);
 
-    sessions_.emplace_back(std::move(session));
-    sessions_.back()->start(this);
+    Session* session_ptr = session.get();
+
+    sessions_.add(std::move(session));
+    session_ptr->start(this);
+
+    notifySessionChanged(*session_ptr);
 }
 
 void Server::onSessionFinished(Session::SessionId session_id, proto::RouterSession /* session_type */)
 {
-    for (auto it = sessions_.begin(); it != sessions_.end(); ++it)
+    // Delete a session from the list.
+    std::unique_ptr<Session> session = takeSession(session_id);
+    if (session)
     {
-        if (it->get()->sessionId() == session_id)
+        // Session will be destroyed after completion of the current call.
+        task_runner_->deleteSoon(std::move(session));
+    }
+}
+
+std::unique_ptr<Session> Server::takeSession(Session::SessionId session_id)
+{
+    std::unique_ptr<Session> session = sessions_.take(session_id);
+    if (!session)
+        return nullptr;
+
+    // The session can be destroyed later, so it stops receiving notifications right away.
+    if (session->sessionType() == proto::ROUTER_SESSION_ADMIN)
+        removeSessionObserver(static_cast<SessionAdmin*>(session.get()));
+
+    if (session->sessionType() == proto::ROUTER_SESSION_HOST && !cluster_links_.empty())
+    {
+        for (const auto& host_id : static_cast<SessionHost*>(session.get())->hostIdList())
         {
-            // Session will be destroyed after completion of the current call.
-            task_runner_->deleteSoon(std::move(*it));
+            // The host may be connected again already.
+            if (sessions_.hostSession(host_id))
+                continue;
 
-            // Delete a session from the list.
-            sessions_.erase(it);
-            break;
+            for (const auto& cluster_link : cluster_links_)
+                cluster_link->removeHost(host_id);
+        }
+    }
+
+    notifySessionChanged(*session);
+    return session;
+}
+
+void Server::onClusterLinkHosts(proto::HostPresence* presence)
+{
+    for (const auto& session : sessions_.sessions())
+    {
+        if (session.second->sessionType() != proto::ROUTER_SESSION_HOST)
+            continue;
+
+        const SessionHost* host_session = static_cast<const SessionHost*>(session.second.get());
+
+        for (const auto& host_id : host_session->hostIdList())
+        {
+            // Only the current connection of the host is announced.
+            if (sessions_.hostSession(host_id) != host_session)
+                continue;
+
+            proto::ClusterHost* host = presence->add_online();
+            host->set_host_id(host_id);
+            host->set_address(host_session->address());
+        }
+    }
+}
+
+void Server::onClusterLinkOffer(const proto::ConnectionOffer& offer)
+{
+    const base::HostId host_id = offer.host_data().host_id();
+
+    SessionHost* host = sessions_.hostSession(host_id);
+    if (!host)
+    {
+        LOG(LS_WARNING) << "Host with id " << host_id << " for the forwarded offer NOT found";
+        return;
+    }
+
+    LOG(LS_INFO) << "Sending forwarded connection offer to host " << host_id
+                 << " (trace: " << offer.trace_id() << ")";
+    host->sendConnectionOffer(offer);
+}
+
+std::string Server::onMetricsRequest()
+{
+    return base::MetricsRegistry::global().toPrometheusText();
+}
+
+bool Server::startMetricsServer(const Settings& settings)
+{
+    const uint16_t metrics_port = settings.metricsPort();
+    if (!metrics_port)
+        return true;
+
+    const std::u16string metrics_interface = settings.metricsInterface();
+    LOG(LS_INFO) << "Metrics interface: " << metrics_interface << " (port: " << metrics_port << ")";
+
+    std::error_code error_code;
+    asio::ip::address metrics_address =
+        asio::ip::make_address(base::local8BitFromUtf16(metrics_interface), error_code);
+    if (error_code)
+    {
+        LOG(LS_ERROR) << "Invalid metrics interface";
+        return false;
+    }
+
+    metrics_server_ = std::make_unique<base::MetricsServer>(metrics_address, metrics_port);
+    return metrics_server_->start(this);
+}
+
+void Server::startCluster(const Settings& settings, uint16_t default_port)
+{
+    std::vector<std::u16string> peers = base::splitString(
+        settings.clusterPeers(), u";", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
+    if (peers.empty())
+        return;
+
+    std::u16string user_name = settings.clusterUserName();
+    std::u16string password = settings.clusterPassword();
+    if (user_name.empty() || password.empty())
+    {
+        LOG(LS_ERROR) << "Cluster peers are specified without user name or password";
+        return;
+    }
+
+    for (const auto& peer : peers)
+    {
+        base::Address address = base::Address::fromString(peer, default_port);
+        if (!address.isValid())
+        {
+            LOG(LS_ERROR) << "Invalid address of cluster peer: " << peer;
+            continue;
+        }
+
+        LOG(LS_INFO) << "Cluster peer: " << address.toString();
+
+        std::unique_ptr<ClusterLink> cluster_link = std::make_unique<ClusterLink>(
+            task_runner_, address, user_name, password, this);
+        cluster_link->start();
+
+        cluster_links_.emplace_back(std::move(cluster_link));
+    }
+}
+
+void Server::sessionToProto(const Session& session, proto::Session* item) const
+{
+    item->set_session_id(session.sessionId());
+    item->set_session_type(session.sessionType());
+    item->set_timepoint(static_cast<uint64_t>(session.startTime()));
+    item->set_ip_address(session.address());
+    item->mutable_version()->CopyFrom(session.version().toProto());
+    item->set_os_name(session.osName());
+    item->set_computer_name(session.computerName());
+
+    switch (session.sessionType())
+    {
+        case proto::ROUTER_SESSION_HOST:
+        {
+            proto::HostSessionData session_data;
+
+            for (const auto& host_id : static_cast<const SessionHost&>(session).hostIdList())
+                session_data.add_host_id(host_id);
+
+            item->set_session_data(session_data.SerializeAsString());
+        }
+        break;
+
+        case proto::ROUTER_SESSION_RELAY:
+        {
+            proto::RelaySessionData session_data;
+            session_data.set_pool_size(relay_key_pool_->countForRelay(session.sessionId()));
+
+            const std::optional<proto::RelayStat>& in_relay_stat =
+                static_cast<const SessionRelay&>(session).relayStat();
+            if (in_relay_stat.has_value())
+            {
+                proto::RelaySessionData::RelayStat* out_relay_stat =
+                    session_data.mutable_relay_stat();
+
+                out_relay_stat->set_uptime(in_relay_stat->uptime());
+                out_relay_stat->mutable_peer_connection()->CopyFrom(
+                    in_relay_stat->peer_connection());
+            }
+
+            item->set_session_data(session_data.SerializeAsString());
         }
+        break;
+
+        default:
+            break;
     }
 }
 
@@ -19,25 +19,40 @@
 #ifndef ROUTER_SERVER_H
 #define ROUTER_SERVER_H
 
+#include "base/net/metrics_server.h"
 #include "base/net/tcp_server.h"
 #include "base/peer/host_id.h"
+#include "base/waitable_timer.h"
 #include "base/peer/server_authenticator_manager.h"
 #include "build/build_config.h"
 #include "proto/router_admin.pb.h"
+#include "router/cluster_link.h"
+#include "router/connection_trace.h"
+#include "router/relay_placement.h"
 #include "router/session.h"
+#include "router/session_map.h"
 #include "router/shared_key_pool.h"
 
+namespace base {
+class Thread;
+} // namespace base
+
 namespace router {
 
-class DatabaseFactory;
+class DatabaseWorker;
+class HostResumeTicket;
+class SessionCluster;
 class SessionHost;
 class SessionRelay;
+class Settings;
 
 class Server
     : public base::TcpServer::Delegate,
       public SharedKeyPool::Delegate,
       public base::ServerAuthenticatorManager::Delegate,
-      public Session::Delegate
+      public Session::Delegate,
+      public ClusterLink::Delegate,
+      public base::MetricsServer::Delegate
 {
 public:
     explicit Server(std::shared_ptr<base::TaskRunner> task_runner);
@@ -45,19 +60,69 @@ public:
 
     bool start();
 
-    std::unique_ptr<proto::SessionList> sessionList() const;
+    // Prepares the router to stop: stops accepting connections and asks the hosts to reconnect
+    // after delays spread over the drain window. |callback| is called when the notices are sent.
+    void drain(base::WaitableTimer::TimeoutCallback callback);
+    bool isDraining() const { return is_draining_; }
+
+    // Issues the tickets with which the hosts get their IDs after the restart of the router.
+    const HostResumeTicket* hostResumeTicket() const { return host_resume_ticket_.get(); }
+
+    class SessionObserver
+    {
+    public:
+        virtual ~SessionObserver() = default;
+
+        // Called when a session is added, changed or removed.
+        virtual void onSessionChanged(Session::SessionId session_id,
+                                      proto::RouterSession session_type) = 0;
+    };
+
+    void addSessionObserver(SessionObserver* observer);
+    void removeSessionObserver(SessionObserver* observer);
+    void notifySessionChanged(const Session& session);
+
+    std::shared_ptr<base::TaskRunner> taskRunner() const { return task_runner_; }
+
+    std::unique_ptr<proto::SessionList> sessionList(const proto::SessionListRequest& request) const;
+
+    // Returns false if there is no such session or it does not match the filter of |request|.
+    bool sessionInfo(Session::SessionId session_id,
+                     const proto::SessionListRequest& request,
+                     proto::Session* item) const;
+
+    // Returns the inventory of the connected hosts which sent it.
+    std::unique_ptr<proto::InventoryList> inventoryList(
+        const proto::InventoryRequest& request) const;
+
+    // Adds the trace of a finished connection request to the statistics.
+    void addConnectionTrace(const ConnectionTrace& trace);
+    std::unique_ptr<proto::ConnectionStats> connectionStats() const;
+
     bool stopSession(Session::SessionId session_id);
-    void onHostSessionWithId(SessionHost* session);
+    void onHostIdAdded(SessionHost* session, base::HostId host_id);
+    void onHostIdRemoved(SessionHost* session, base::HostId host_id);
 
     SessionHost* hostSessionById(base::HostId host_id);
     Session* sessionById(Session::SessionId session_id);
 
+    // Hosts connected to other routers of the cluster.
+    void onClusterHostAdded(SessionCluster* session, base::HostId host_id);
+    void onClusterHostRemoved(SessionCluster* session, base::HostId host_id);
+
+    // Returns the router of the cluster to which the host is connected or nullptr. Hosts that are
+    // connected to this router are not looked up.
+    SessionCluster* clusterSessionByHostId(base::HostId host_id);
+
+    const RelayPlacement& relayPlacement() const { return relay_placement_; }
+
 protected:
     // base::TcpServer::Delegate implementation.
     void onNewConnection(std::unique_ptr<base::TcpChannel> channel) override;
 
     // SharedKeyPool::Delegate implementation.
     void onPoolKeyUsed(Session::SessionId session_id, uint32_t key_id) override;
+    void onPoolKeysRequired(Session::SessionId session_id, uint32_t key_count) override;
 
     // base::ServerAuthenticatorManager::Delegate implementation.
     void onNewSession(base::ServerAuthenticatorManager::SessionInfo&& session_info) override;
@@ -66,13 +131,44 @@ protected:
     void onSessionFinished(Session::SessionId session_id,
                            proto::RouterSession session_type) override;
 
+    // ClusterLink::Delegate implementation.
+    void onClusterLinkHosts(proto::HostPresence* presence) override;
+    void onClusterLinkOffer(const proto::ConnectionOffer& offer) override;
+
+    // base::MetricsServer::Delegate implementation.
+    std::string onMetricsRequest() override;
+
 private:
+    void startCluster(const Settings& settings, uint16_t default_port);
+    bool startMetricsServer(const Settings& settings);
+    std::unique_ptr<Session> takeSession(Session::SessionId session_id);
+    void sessionToProto(const Session& session, proto::Session* item) const;
+
     std::shared_ptr<base::TaskRunner> task_runner_;
-    base::local_shared_ptr<DatabaseFactory> database_factory_;
+
+    // Destroyed after the sessions, whose channels may still use them.
+    std::vector<std::unique_ptr<base::Thread>> crypto_threads_;
+    size_t next_crypto_thread_ = 0;
+    size_t crypto_threshold_ = 0;
+
+    // New connections are closed when the number of sessions reaches it. Zero means no limit.
+    size_t max_sessions_ = 0;
+
+    std::shared_ptr<DatabaseWorker> database_worker_;
     std::unique_ptr<base::TcpServer> server_;
+    std::unique_ptr<base::MetricsServer> metrics_server_;
     std::unique_ptr<base::ServerAuthenticatorManager> authenticator_manager_;
     std::unique_ptr<SharedKeyPool> relay_key_pool_;
-    std::vector<std::unique_ptr<Session>> sessions_;
+    RelayPlacement relay_placement_;
+    SessionMap sessions_;
+    std::vector<SessionObserver*> session_observers_;
+    std::vector<std::unique_ptr<ClusterLink>> cluster_links_;
+    ConnectionTraceStats connection_trace_stats_;
+    std::unique_ptr<HostResumeTicket> host_resume_ticket_;
+
+    std::chrono::seconds drain_window_ { 0 };
+    base::WaitableTimer drain_timer_;
+    bool is_draining_ = false;
 
     std::vector<std::u16string> client_white_list_;
     std::vector<std::u16string> host_white_list_;
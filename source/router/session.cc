@@ -19,14 +19,53 @@
 #include "router/session.h"
 
 #include "base/logging.h"
+#include "base/metrics/metrics_registry.h"
 #include "base/net/tcp_channel.h"
 #include "base/strings/unicode.h"
 #include "router/database.h"
-#include "router/database_factory.h"
+#include "router/database_worker.h"
 #include "router/shared_key_pool.h"
 
 namespace router {
 
+namespace {
+
+base::Gauge* sessionGauge(proto::RouterSession session_type)
+{
+    const char* type = "unknown";
+
+    switch (session_type)
+    {
+        case proto::ROUTER_SESSION_CLIENT:
+            type = "client";
+            break;
+
+        case proto::ROUTER_SESSION_HOST:
+            type = "host";
+            break;
+
+        case proto::ROUTER_SESSION_ADMIN:
+            type = "admin";
+            break;
+
+        case proto::ROUTER_SESSION_RELAY:
+            type = "relay";
+            break;
+
+        case proto::ROUTER_SESSION_CLUSTER:
+            type = "cluster";
+            break;
+
+        default:
+            break;
+    }
+
+    return base::MetricsRegistry::global().gauge(
+        "router_sessions", "Connected sessions.", std::string("type=\"") + type + "\"");
+}
+
+} // namespace
+
 Session::SessionId createSessionId()
 {
     static Session::SessionId last_session_id = 0;
@@ -38,10 +77,13 @@ Session::Session(proto::RouterSession session_type)
     : session_type_(session_type),
       session_id_(createSessionId())
 {
-    // Nothing
+    sessionGauge(session_type_)->increment();
 }
 
-Session::~Session() = default;
+Session::~Session()
+{
+    sessionGauge(session_type_)->decrement();
+}
 
 void Session::setChannel(std::unique_ptr<base::TcpChannel> channel)
 {
@@ -53,9 +95,9 @@ void Session::setRelayKeyPool(std::unique_ptr<SharedKeyPool> relay_key_pool)
     relay_key_pool_ = std::move(relay_key_pool);
 }
 
-void Session::setDatabaseFactory(base::local_shared_ptr<DatabaseFactory> database_factory)
+void Session::setDatabaseWorker(std::shared_ptr<DatabaseWorker> database_worker)
 {
-    database_factory_ = std::move(database_factory);
+    database_worker_ = std::move(database_worker);
 }
 
 void Session::setServer(Server* server)
@@ -77,9 +119,9 @@ void Session::start(Delegate* delegate)
         return;
     }
 
-    if (!database_factory_)
+    if (!database_worker_)
     {
-        LOG(LS_FATAL) << "Invalid database factory";
+        LOG(LS_FATAL) << "Invalid database worker";
         return;
     }
 
@@ -105,7 +147,7 @@ void Session::start(Delegate* delegate)
 
 std::unique_ptr<Database> Session::openDatabase() const
 {
-    return database_factory_->openDatabase();
+    return database_worker_->openDatabase();
 }
 
 void Session::setVersion(const base::Version& version)
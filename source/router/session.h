@@ -27,7 +27,7 @@
 namespace router {
 
 class Database;
-class DatabaseFactory;
+class DatabaseWorker;
 class Server;
 class SharedKeyPool;
 
@@ -50,7 +50,7 @@ public:
 
     void setChannel(std::unique_ptr<base::TcpChannel> channel);
     void setRelayKeyPool(std::unique_ptr<SharedKeyPool> relay_key_pool);
-    void setDatabaseFactory(base::local_shared_ptr<DatabaseFactory> database_factory);
+    void setDatabaseWorker(std::shared_ptr<DatabaseWorker> database_worker);
     void setServer(Server* server);
 
     void start(Delegate* delegate);
@@ -72,7 +72,11 @@ public:
 
 protected:
     void sendMessage(uint8_t channel_id, const google::protobuf::MessageLite& message);
+
+    // The returned database waits for each call. The sessions that can continue later use
+    // databaseWorker() instead.
     std::unique_ptr<Database> openDatabase() const;
+    const DatabaseWorker& databaseWorker() const { return *database_worker_; }
 
     virtual void onSessionReady() = 0;
     virtual void onSessionMessageReceived(uint8_t channel_id, const base::ByteArray& buffer) = 0;
@@ -96,7 +100,7 @@ private:
     time_t start_time_ = 0;
 
     std::unique_ptr<base::TcpChannel> channel_;
-    base::local_shared_ptr<DatabaseFactory> database_factory_;
+    std::shared_ptr<DatabaseWorker> database_worker_;
     std::unique_ptr<SharedKeyPool> relay_key_pool_;
     Server* server_ = nullptr;
 
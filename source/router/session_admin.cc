@@ -26,6 +26,13 @@
 
 namespace router {
 
+namespace {
+
+// Changes of sessions are collected during this interval and sent in one message.
+const std::chrono::milliseconds kUpdateInterval{ 1000 };
+
+} // namespace
+
 SessionAdmin::SessionAdmin()
     : Session(proto::ROUTER_SESSION_ADMIN)
 {
@@ -69,6 +76,14 @@ void SessionAdmin::onSessionMessageReceived(uint8_t /* channel_id */, const base
     {
         doPeerConnectionRequest(message->peer_connection_request());
     }
+    else if (message->has_inventory_request())
+    {
+        doInventoryRequest(message->inventory_request());
+    }
+    else if (message->has_connection_stats_request())
+    {
+        doConnectionStatsRequest();
+    }
     else
     {
         LOG(LS_WARNING) << "Unhandled message from manager";
@@ -80,6 +95,24 @@ void SessionAdmin::onSessionMessageWritten(uint8_t /* channel_id */, size_t /* p
     // Nothing
 }
 
+void SessionAdmin::onSessionChanged(SessionId session_id, proto::RouterSession session_type)
+{
+    if (!subscription_.has_value())
+        return;
+
+    const uint32_t session_types = subscription_->session_types();
+    if (session_types && !(session_types & session_type))
+        return;
+
+    changed_sessions_.insert(session_id);
+
+    if (!update_timer_->isActive())
+    {
+        update_timer_->start(
+            kUpdateInterval, std::bind(&SessionAdmin::sendSessionListUpdate, this));
+    }
+}
+
 void SessionAdmin::doUserListRequest()
 {
     std::unique_ptr<Database> database = openDatabase();
@@ -127,15 +160,67 @@ void SessionAdmin::doUserRequest(const proto::UserRequest& request)
     sendMessage(proto::ROUTER_CHANNEL_ID_SESSION, *message);
 }
 
-void SessionAdmin::doSessionListRequest(const proto::SessionListRequest& /* request */)
+void SessionAdmin::doSessionListRequest(const proto::SessionListRequest& request)
 {
     std::unique_ptr<proto::RouterToAdmin> message = std::make_unique<proto::RouterToAdmin>();
 
-    message->set_allocated_session_list(server().sessionList().release());
+    message->set_allocated_session_list(server().sessionList(request).release());
     if (!message->has_session_list())
         message->mutable_session_list()->set_error_code(proto::SessionList::UNKNOWN_ERROR);
 
     sendMessage(proto::ROUTER_CHANNEL_ID_SESSION, *message);
+
+    if (!request.subscribe())
+    {
+        if (subscription_.has_value())
+        {
+            LOG(LS_INFO) << "Subscription to session changes cancelled";
+            server().removeSessionObserver(this);
+            subscription_.reset();
+            changed_sessions_.clear();
+            update_timer_.reset();
+        }
+        return;
+    }
+
+    if (!subscription_.has_value())
+    {
+        LOG(LS_INFO) << "Subscribed to session changes";
+        update_timer_ = std::make_unique<base::WaitableTimer>(
+            base::WaitableTimer::Type::SINGLE_SHOT, server().taskRunner());
+        server().addSessionObserver(this);
+    }
+
+    // Pages of the list are not tracked. Changes of all matching sessions are sent.
+    subscription_ = request;
+    subscription_->clear_start_session_id();
+    subscription_->clear_max_count();
+}
+
+void SessionAdmin::sendSessionListUpdate()
+{
+    if (!subscription_.has_value() || changed_sessions_.empty())
+        return;
+
+    std::unique_ptr<proto::RouterToAdmin> message = std::make_unique<proto::RouterToAdmin>();
+    proto::SessionListUpdate* update = message->mutable_session_list_update();
+
+    proto::Session session;
+
+    for (const auto& session_id : changed_sessions_)
+    {
+        // Sessions that are gone or no longer match the filter are reported as removed.
+        if (server().sessionInfo(session_id, *subscription_, &session))
+            update->add_session()->Swap(&session);
+        else
+            update->add_removed_session_id(session_id);
+
+        session.Clear();
+    }
+
+    changed_sessions_.clear();
+
+    sendMessage(proto::ROUTER_CHANNEL_ID_SESSION, *message);
 }
 
 void SessionAdmin::doSessionRequest(const proto::SessionRequest& request)
@@ -181,6 +266,24 @@ void SessionAdmin::doPeerConnectionRequest(const proto::PeerConnectionRequest& r
     relay_session->disconnectPeerSession(request);
 }
 
+void SessionAdmin::doInventoryRequest(const proto::InventoryRequest& request)
+{
+    std::unique_ptr<proto::RouterToAdmin> message = std::make_unique<proto::RouterToAdmin>();
+    message->set_allocated_inventory_list(server().inventoryList(request).release());
+
+    LOG(LS_INFO) << "Sending inventory of " << message->inventory_list().host_size() << " hosts";
+    sendMessage(proto::ROUTER_CHANNEL_ID_SESSION, *message);
+}
+
+void SessionAdmin::doConnectionStatsRequest()
+{
+    std::unique_ptr<proto::RouterToAdmin> message = std::make_unique<proto::RouterToAdmin>();
+    message->set_allocated_connection_stats(server().connectionStats().release());
+
+    LOG(LS_INFO) << "Sending connection stats";
+    sendMessage(proto::ROUTER_CHANNEL_ID_SESSION, *message);
+}
+
 proto::UserResult::ErrorCode SessionAdmin::addUser(const proto::User& user)
 {
     LOG(LS_INFO) << "User add request: " << user.name();
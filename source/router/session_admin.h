@@ -19,14 +19,21 @@
 #ifndef ROUTER_SESSION_ADMIN_H
 #define ROUTER_SESSION_ADMIN_H
 
+#include "base/waitable_timer.h"
 #include "proto/router_admin.pb.h"
+#include "router/server.h"
 #include "router/session.h"
 
+#include <optional>
+#include <set>
+
 namespace router {
 
 class ServerProxy;
 
-class SessionAdmin : public Session
+class SessionAdmin
+    : public Session,
+      public Server::SessionObserver
 {
 public:
     SessionAdmin();
@@ -38,17 +45,28 @@ protected:
     void onSessionMessageReceived(uint8_t channel_id, const base::ByteArray& buffer) override;
     void onSessionMessageWritten(uint8_t channel_id, size_t pending) override;
 
+    // Server::SessionObserver implementation.
+    void onSessionChanged(SessionId session_id, proto::RouterSession session_type) override;
+
 private:
     void doUserListRequest();
     void doUserRequest(const proto::UserRequest& request);
     void doSessionListRequest(const proto::SessionListRequest& request);
     void doSessionRequest(const proto::SessionRequest& request);
     void doPeerConnectionRequest(const proto::PeerConnectionRequest& request);
+    void doInventoryRequest(const proto::InventoryRequest& request);
+    void doConnectionStatsRequest();
+    void sendSessionListUpdate();
 
     proto::UserResult::ErrorCode addUser(const proto::User& user);
     proto::UserResult::ErrorCode modifyUser(const proto::User& user);
     proto::UserResult::ErrorCode deleteUser(const proto::User& user);
 
+    // The filter of the subscription to session changes.
+    std::optional<proto::SessionListRequest> subscription_;
+    std::set<SessionId> changed_sessions_;
+    std::unique_ptr<base::WaitableTimer> update_timer_;
+
     DISALLOW_COPY_AND_ASSIGN(SessionAdmin);
 };
 
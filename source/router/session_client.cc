@@ -20,14 +20,75 @@
 
 #include "base/logging.h"
 #include "base/crypto/random.h"
+#include "base/metrics/metrics_registry.h"
 #include "base/strings/unicode.h"
 #include "proto/relay_peer.pb.h"
+#include "router/connection_trace.h"
 #include "router/server.h"
+#include "router/session_cluster.h"
 #include "router/session_host.h"
 #include "router/session_relay.h"
 
 namespace router {
 
+namespace {
+
+// Host IDs beyond this number in one request get the unknown status.
+const int kMaxHostStatusListSize = 4096;
+
+// Limits of the direct connection candidates sent to a peer.
+const int kMaxDirectCandidates = 4;
+const size_t kMaxDirectAddressSize = 64;
+
+// The candidates sent by a peer and the address from which the router sees it. The port of the
+// peer is usually kept by its NAT, so the announced port is used with the public address.
+proto::DirectCandidates directCandidates(
+    const proto::DirectCandidates& announced, const std::string& address)
+{
+    proto::DirectCandidates candidates;
+
+    for (const auto& endpoint : announced.endpoint())
+    {
+        if (candidates.endpoint_size() >= kMaxDirectCandidates - 1)
+            break;
+
+        if (endpoint.address().empty() || endpoint.address().size() > kMaxDirectAddressSize ||
+            !endpoint.port() || endpoint.port() > 65535)
+        {
+            continue;
+        }
+
+        candidates.add_endpoint()->CopyFrom(endpoint);
+    }
+
+    if (candidates.endpoint_size() && !address.empty())
+    {
+        proto::DirectEndpoint* endpoint = candidates.add_endpoint();
+        endpoint->set_address(address);
+        endpoint->set_port(candidates.endpoint(0).port());
+    }
+
+    return candidates;
+}
+
+base::Counter* connectionRequestCounter(proto::ConnectionOffer::ErrorCode error_code)
+{
+    return base::MetricsRegistry::global().counter(
+        "router_connection_requests_total", "Connection requests of clients.",
+        error_code == proto::ConnectionOffer::SUCCESS ?
+            "result=\"success\"" : "result=\"failure\"");
+}
+
+base::Histogram* connectionRequestTime()
+{
+    static base::Histogram* histogram = base::MetricsRegistry::global().histogram(
+        "router_connection_request_seconds", "Time the router spends on a connection request.",
+        { 50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000 }, 0.000001);
+    return histogram;
+}
+
+} // namespace
+
 SessionClient::SessionClient()
     : Session(proto::ROUTER_SESSION_CLIENT)
 {
@@ -58,6 +119,10 @@ void SessionClient::onSessionMessageReceived(uint8_t /* channel_id */, const bas
     {
         readCheckHostStatus(message->check_host_status());
     }
+    else if (message->has_check_host_status_list())
+    {
+        readCheckHostStatusList(message->check_host_status_list());
+    }
     else
     {
         LOG(LS_WARNING) << "Unhandled message from client";
@@ -71,22 +136,50 @@ void SessionClient::onSessionMessageWritten(uint8_t /* channel_id */, size_t /*
 
 void SessionClient::readConnectionRequest(const proto::ConnectionRequest& request)
 {
-    LOG(LS_INFO) << "New connection request (host_id: " << request.host_id() << ")";
+    ConnectionTrace trace;
+
+    LOG(LS_INFO) << "New connection request (host_id: " << request.host_id()
+                 << ", trace: " << trace.traceId() << ")";
 
     std::unique_ptr<proto::RouterToPeer> message = std::make_unique<proto::RouterToPeer>();
     proto::ConnectionOffer* offer = message->mutable_connection_offer();
+    offer->set_trace_id(trace.traceId());
 
+    // The host can be connected to another router of the cluster. The relay is taken from the
+    // pool of this router and the offer for the host is forwarded to the other router.
     SessionHost* host = server().hostSessionById(request.host_id());
-    if (!host)
+    SessionCluster* cluster = host ? nullptr : server().clusterSessionByHostId(request.host_id());
+
+    std::string host_address;
+    proto::DirectCandidates host_candidates;
+    if (host)
+    {
+        host_address = host->address();
+    }
+    else if (cluster)
+    {
+        auto it = cluster->hosts().find(request.host_id());
+        DCHECK(it != cluster->hosts().end());
+        host_address = it->second;
+    }
+
+    trace.endSpan(ConnectionTrace::Span::HOST_LOOKUP);
+
+    if (!host && !cluster)
     {
         LOG(LS_WARNING) << "Host with id " << request.host_id() << " NOT found!";
         offer->set_error_code(proto::ConnectionOffer::PEER_NOT_FOUND);
     }
     else
     {
-        LOG(LS_INFO) << "Host with id " << request.host_id() << " found";
+        LOG(LS_INFO) << "Host with id " << request.host_id() << " found"
+                     << (cluster ? " on another router" : "");
+
+        const RelayPlacement& placement = server().relayPlacement();
 
-        std::optional<SharedKeyPool::Credentials> credentials = relayKeyPool().takeCredentials();
+        std::optional<SharedKeyPool::Credentials> credentials = relayKeyPool().takeCredentials(
+            placement.region(address()), placement.region(host_address));
+        trace.endSpan(ConnectionTrace::Span::RELAY_CREDENTIALS);
         if (!credentials.has_value())
         {
             LOG(LS_WARNING) << "Empty key pool";
@@ -121,20 +214,41 @@ void SessionClient::readConnectionRequest(const proto::ConnectionRequest& reques
 
                     offer_credentials->set_host(relay->peerData()->first);
                     offer_credentials->set_port(relay->peerData()->second);
+                    offer_credentials->set_udp_port(relay->peerUdpPort());
                     offer_credentials->mutable_key()->Swap(&credentials->key);
 
                     proto::PeerToRelay::Secret secret;
                     secret.set_random_data(base::Random::string(16));
                     secret.set_client_address(address());
                     secret.set_client_user_name(userName());
-                    secret.set_host_address(host->address());
+                    secret.set_host_address(host_address);
                     secret.set_host_id(request.host_id());
+                    secret.set_trace_id(trace.traceId());
 
                     offer_credentials->set_secret(secret.SerializeAsString());
 
+                    // The direct connection is tried only with the hosts of this router,
+                    // because the public address of other hosts is not known here.
+                    if (host && request.has_direct())
+                    {
+                        host_candidates =
+                            directCandidates(host->directCandidates(), host_address);
+                        if (host_candidates.endpoint_size())
+                        {
+                            offer->mutable_direct()->CopyFrom(
+                                directCandidates(request.direct(), address()));
+                        }
+                    }
+
                     LOG(LS_INFO) << "Sending connection offer to host";
                     offer->set_peer_role(proto::ConnectionOffer::HOST);
-                    host->sendConnectionOffer(*offer);
+
+                    if (host)
+                        host->sendConnectionOffer(*offer);
+                    else
+                        cluster->sendConnectionOffer(*offer);
+
+                    trace.endSpan(ConnectionTrace::Span::HOST_OFFER);
                 }
             }
         }
@@ -142,8 +256,21 @@ void SessionClient::readConnectionRequest(const proto::ConnectionRequest& reques
 
     LOG(LS_INFO) << "Sending connection offer to client";
     offer->clear_host_data(); // Host data is only needed by the host.
+
+    if (offer->has_direct())
+        offer->mutable_direct()->Swap(&host_candidates);
+
     offer->set_peer_role(proto::ConnectionOffer::CLIENT);
     sendMessage(proto::ROUTER_CHANNEL_ID_SESSION, *message);
+    trace.endSpan(ConnectionTrace::Span::CLIENT_OFFER);
+
+    // The offers are only queued for sending, so the spans do not include the network.
+    LOG(LS_INFO) << "Connection request trace " << trace.traceId() << " ("
+                 << trace.toString() << ")";
+    server().addConnectionTrace(trace);
+
+    connectionRequestCounter(offer->error_code())->add();
+    connectionRequestTime()->add(static_cast<uint64_t>(trace.total().count()));
 }
 
 void SessionClient::readCheckHostStatus(const proto::CheckHostStatus& check_host_status)
@@ -151,7 +278,7 @@ void SessionClient::readCheckHostStatus(const proto::CheckHostStatus& check_host
     std::unique_ptr<proto::RouterToPeer> message = std::make_unique<proto::RouterToPeer>();
     proto::HostStatus* host_status = message->mutable_host_status();
 
-    if (server().hostSessionById(check_host_status.host_id()))
+    if (isHostOnline(check_host_status.host_id()))
         host_status->set_status(proto::HostStatus::STATUS_ONLINE);
     else
         host_status->set_status(proto::HostStatus::STATUS_OFFLINE);
@@ -161,4 +288,47 @@ void SessionClient::readCheckHostStatus(const proto::CheckHostStatus& check_host
     sendMessage(proto::ROUTER_CHANNEL_ID_SESSION, *message);
 }
 
+void SessionClient::readCheckHostStatusList(
+    const proto::CheckHostStatusList& check_host_status_list)
+{
+    std::unique_ptr<proto::RouterToPeer> message = std::make_unique<proto::RouterToPeer>();
+    proto::HostStatusList* host_status_list = message->mutable_host_status_list();
+
+    host_status_list->set_request_id(check_host_status_list.request_id());
+
+    const int count = check_host_status_list.host_id_size();
+    host_status_list->mutable_status()->Reserve(count);
+
+    int online_count = 0;
+
+    for (int i = 0; i < count; ++i)
+    {
+        proto::HostStatus::Status status = proto::HostStatus::STATUS_UNKNOWN;
+
+        if (i < kMaxHostStatusListSize)
+        {
+            if (isHostOnline(check_host_status_list.host_id(i)))
+            {
+                status = proto::HostStatus::STATUS_ONLINE;
+                ++online_count;
+            }
+            else
+            {
+                status = proto::HostStatus::STATUS_OFFLINE;
+            }
+        }
+
+        host_status_list->add_status(status);
+    }
+
+    LOG(LS_INFO) << "Sending host status list " << check_host_status_list.request_id()
+                 << " (hosts: " << count << ", online: " << online_count << ")";
+    sendMessage(proto::ROUTER_CHANNEL_ID_SESSION, *message);
+}
+
+bool SessionClient::isHostOnline(base::HostId host_id)
+{
+    return server().hostSessionById(host_id) || server().clusterSessionByHostId(host_id);
+}
+
 } // namespace router
@@ -19,6 +19,7 @@
 #ifndef ROUTER_SESSION_CLIENT_H
 #define ROUTER_SESSION_CLIENT_H
 
+#include "base/peer/host_id.h"
 #include "proto/router_peer.pb.h"
 #include "router/session.h"
 
@@ -42,6 +43,10 @@ protected:
 private:
     void readConnectionRequest(const proto::ConnectionRequest& request);
     void readCheckHostStatus(const proto::CheckHostStatus& check_host_status);
+    void readCheckHostStatusList(const proto::CheckHostStatusList& check_host_status_list);
+
+    // The host is connected to this router or to another router of the cluster.
+    bool isHostOnline(base::HostId host_id);
 
     DISALLOW_COPY_AND_ASSIGN(SessionClient);
 };
@@ -0,0 +1,126 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "router/session_cluster.h"
+
+#include "base/logging.h"
+#include "router/server.h"
+
+namespace router {
+
+namespace {
+
+// One router of the cluster can not announce more hosts.
+const size_t kMaxHostCount = 1000000;
+const size_t kMaxAddressLength = 64;
+
+} // namespace
+
+SessionCluster::SessionCluster()
+    : Session(proto::ROUTER_SESSION_CLUSTER)
+{
+    // Nothing
+}
+
+SessionCluster::~SessionCluster() = default;
+
+void SessionCluster::sendConnectionOffer(const proto::ConnectionOffer& offer)
+{
+    proto::ClusterMessage message;
+    message.mutable_connection_offer()->CopyFrom(offer);
+    sendMessage(proto::ROUTER_CHANNEL_ID_SESSION, message);
+}
+
+void SessionCluster::onSessionReady()
+{
+    // Nothing
+}
+
+void SessionCluster::onSessionMessageReceived(
+    uint8_t /* channel_id */, const base::ByteArray& buffer)
+{
+    proto::ClusterMessage message;
+    if (!base::parse(buffer, &message))
+    {
+        LOG(LS_ERROR) << "Could not read message from router";
+        return;
+    }
+
+    if (message.has_host_presence())
+    {
+        readHostPresence(message.host_presence());
+    }
+    else
+    {
+        LOG(LS_WARNING) << "Unhandled message from router";
+    }
+}
+
+void SessionCluster::onSessionMessageWritten(uint8_t /* channel_id */, size_t /* pending */)
+{
+    // Nothing
+}
+
+void SessionCluster::readHostPresence(const proto::HostPresence& presence)
+{
+    if (presence.is_full())
+    {
+        LOG(LS_INFO) << "Full host list from router (previous: " << hosts_.size()
+                     << ", new: " << presence.online_size() << ")";
+
+        while (!hosts_.empty())
+            removeHost(hosts_.begin()->first);
+    }
+
+    for (int i = 0; i < presence.offline_host_id_size(); ++i)
+        removeHost(presence.offline_host_id(i));
+
+    for (int i = 0; i < presence.online_size(); ++i)
+    {
+        const proto::ClusterHost& host = presence.online(i);
+
+        if (host.address().size() > kMaxAddressLength)
+        {
+            LOG(LS_WARNING) << "Too long address of host " << host.host_id();
+            continue;
+        }
+
+        auto result = hosts_.try_emplace(host.host_id(), host.address());
+        if (!result.second)
+        {
+            result.first->second = host.address();
+            continue;
+        }
+
+        if (hosts_.size() > kMaxHostCount)
+        {
+            LOG(LS_WARNING) << "Too many hosts from router";
+            hosts_.erase(result.first);
+            break;
+        }
+
+        server().onClusterHostAdded(this, host.host_id());
+    }
+}
+
+void SessionCluster::removeHost(base::HostId host_id)
+{
+    if (hosts_.erase(host_id))
+        server().onClusterHostRemoved(this, host_id);
+}
+
+} // namespace router
@@ -0,0 +1,61 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef ROUTER_SESSION_CLUSTER_H
+#define ROUTER_SESSION_CLUSTER_H
+
+#include "base/peer/host_id.h"
+#include "proto/router_cluster.pb.h"
+#include "router/session.h"
+
+#include <unordered_map>
+
+namespace router {
+
+// Connection from another router of the cluster. Keeps the hosts which the router announced and
+// forwards the connection offers for them.
+class SessionCluster : public Session
+{
+public:
+    SessionCluster();
+    ~SessionCluster() override;
+
+    // Host ID and the address of the host.
+    using Hosts = std::unordered_map<base::HostId, std::string>;
+
+    const Hosts& hosts() const { return hosts_; }
+
+    void sendConnectionOffer(const proto::ConnectionOffer& offer);
+
+protected:
+    // Session implementation.
+    void onSessionReady() override;
+    void onSessionMessageReceived(uint8_t channel_id, const base::ByteArray& buffer) override;
+    void onSessionMessageWritten(uint8_t channel_id, size_t pending) override;
+
+private:
+    void readHostPresence(const proto::HostPresence& presence);
+    void removeHost(base::HostId host_id);
+
+    Hosts hosts_;
+
+    DISALLOW_COPY_AND_ASSIGN(SessionCluster);
+};
+
+} // namespace router
+
+#endif // ROUTER_SESSION_CLUSTER_H
@@ -23,6 +23,8 @@
 #include "base/crypto/generic_hash.h"
 #include "base/crypto/random.h"
 #include "router/database.h"
+#include "router/database_worker.h"
+#include "router/host_resume_ticket.h"
 #include "router/server.h"
 
 namespace router {
@@ -31,21 +33,68 @@ namespace {
 
 const size_t kHostKeySize = 512;
 
+// Limits of the inventory which is kept for each host.
+const size_t kMaxInventoryItems = 512;
+const size_t kMaxInventoryKeySize = 128;
+const size_t kMaxInventoryValueSize = 1024;
+
+// Limits of the direct connection candidates of a host.
+const int kMaxDirectCandidates = 4;
+const size_t kMaxDirectAddressSize = 64;
+
+// The tickets are valid long enough for the hosts to reconnect to the restarted router.
+const std::chrono::minutes kResumeTicketLifetime{ 30 };
+
 } // namespace
 
+struct SessionHost::HostIdResult
+{
+    bool is_added = true;
+    Database::ErrorCode error_code = Database::ErrorCode::UNKNOWN;
+    base::HostId host_id = base::kInvalidHostId;
+};
+
 SessionHost::SessionHost()
-    : Session(proto::ROUTER_SESSION_HOST)
+    : Session(proto::ROUTER_SESSION_HOST),
+      self_(std::make_shared<SessionHost*>(this))
 {
     // Nothing
 }
 
-SessionHost::~SessionHost() = default;
+SessionHost::~SessionHost()
+{
+    *self_ = nullptr;
+}
 
 bool SessionHost::hasHostId(base::HostId host_id) const
 {
     return base::contains(host_id_list_, host_id);
 }
 
+bool SessionHost::addHostId(base::HostId host_id)
+{
+    if (hasHostId(host_id))
+        return false;
+
+    host_id_list_.emplace_back(host_id);
+    return true;
+}
+
+bool SessionHost::removeHostId(base::HostId host_id)
+{
+    for (auto it = host_id_list_.begin(); it != host_id_list_.end(); ++it)
+    {
+        if (*it == host_id)
+        {
+            host_id_list_.erase(it);
+            key_hashes_.erase(host_id);
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void SessionHost::sendConnectionOffer(const proto::ConnectionOffer& offer)
 {
     std::unique_ptr<proto::RouterToPeer> message = std::make_unique<proto::RouterToPeer>();
@@ -53,6 +102,23 @@ void SessionHost::sendConnectionOffer(const proto::ConnectionOffer& offer)
     sendMessage(proto::ROUTER_CHANNEL_ID_SESSION, *message);
 }
 
+void SessionHost::sendReconnectNotice(
+    std::chrono::milliseconds delay, const HostResumeTicket& tickets)
+{
+    std::unique_ptr<proto::RouterToPeer> message = std::make_unique<proto::RouterToPeer>();
+    proto::ReconnectNotice* notice = message->mutable_reconnect_notice();
+    notice->set_reconnect_delay(static_cast<uint32_t>(delay.count()));
+
+    for (const auto& [host_id, key_hash] : key_hashes_)
+    {
+        proto::ReconnectNotice::Ticket* ticket = notice->add_ticket();
+        ticket->set_host_id(host_id);
+        ticket->set_ticket(tickets.issue(host_id, key_hash, kResumeTicketLifetime));
+    }
+
+    sendMessage(proto::ROUTER_CHANNEL_ID_SESSION, *message);
+}
+
 void SessionHost::onSessionReady()
 {
     // Nothing
@@ -75,6 +141,14 @@ void SessionHost::onSessionMessageReceived(uint8_t /* channel_id */, const base:
     {
         readResetHostId(message->reset_host_id());
     }
+    else if (message->has_host_inventory())
+    {
+        readHostInventory(message->host_inventory());
+    }
+    else if (message->has_direct_candidates())
+    {
+        readDirectCandidates(message->direct_candidates());
+    }
     else
     {
         LOG(LS_WARNING) << "Unhandled message from host";
@@ -88,32 +162,16 @@ void SessionHost::onSessionMessageWritten(uint8_t /* channel_id */, size_t /* pe
 
 void SessionHost::readHostIdRequest(const proto::HostIdRequest& host_id_request)
 {
-    std::unique_ptr<Database> database = openDatabase();
-    if (!database)
-    {
-        LOG(LS_ERROR) << "Failed to connect to database";
-        return;
-    }
-
-    std::unique_ptr<proto::RouterToPeer> message = std::make_unique<proto::RouterToPeer>();
-    proto::HostIdResponse* host_id_response = message->mutable_host_id_response();
+    std::string key;
     base::ByteArray key_hash;
 
     if (host_id_request.type() == proto::HostIdRequest::NEW_ID)
     {
         // Generate new key.
-        std::string key = base::Random::string(kHostKeySize);
+        key = base::Random::string(kHostKeySize);
 
         // Calculate hash for key.
         key_hash = base::GenericHash::hash(base::GenericHash::Type::BLAKE2b512, key);
-
-        if (!database->addHost(key_hash))
-        {
-            LOG(LS_ERROR) << "Unable to add host";
-            return;
-        }
-
-        host_id_response->set_key(std::move(key));
     }
     else if (host_id_request.type() == proto::HostIdRequest::EXISTING_ID)
     {
@@ -127,23 +185,81 @@ void SessionHost::readHostIdRequest(const proto::HostIdRequest& host_id_request)
         return;
     }
 
-    base::HostId host_id = base::kInvalidHostId;
+    // The key is not empty only for a new host.
+    const bool is_new = !key.empty();
 
-    switch (database->hostId(key_hash, &host_id))
+    // A host that reconnects after the restart of the router has a ticket for its ID, so the
+    // database is not queried by all hosts at once.
+    if (!is_new && !host_id_request.resume_ticket().empty())
+    {
+        const HostResumeTicket* tickets = server().hostResumeTicket();
+
+        HostIdResult result;
+        if (tickets)
+            result.host_id = tickets->verify(host_id_request.resume_ticket(), key_hash);
+
+        if (result.host_id != base::kInvalidHostId)
+        {
+            LOG(LS_INFO) << "Host ID " << result.host_id << " resumed with ticket";
+            result.error_code = Database::ErrorCode::SUCCESS;
+            onHostIdResult(key, key_hash, result);
+            return;
+        }
+
+        LOG(LS_INFO) << "Resume ticket is not accepted";
+    }
+
+    databaseWorker().post([key_hash, is_new](Database* database)
+    {
+        HostIdResult result;
+
+        if (is_new && !database->addHost(key_hash))
+        {
+            result.is_added = false;
+            return result;
+        }
+
+        result.error_code = database->hostId(key_hash, &result.host_id);
+        return result;
+    },
+    [self = self_, key = std::move(key), key_hash](const HostIdResult& result)
+    {
+        if (*self)
+            (*self)->onHostIdResult(key, key_hash, result);
+    });
+}
+
+void SessionHost::onHostIdResult(const std::string& key,
+                                 const base::ByteArray& key_hash,
+                                 const HostIdResult& result)
+{
+    if (!result.is_added)
+    {
+        LOG(LS_ERROR) << "Unable to add host";
+        return;
+    }
+
+    std::unique_ptr<proto::RouterToPeer> message = std::make_unique<proto::RouterToPeer>();
+    proto::HostIdResponse* host_id_response = message->mutable_host_id_response();
+
+    if (!key.empty())
+        host_id_response->set_key(key);
+
+    switch (result.error_code)
     {
         case Database::ErrorCode::SUCCESS:
         {
-            if (host_id != base::kInvalidHostId)
+            if (result.host_id != base::kInvalidHostId)
             {
                 host_id_response->set_error_code(proto::HostIdResponse::SUCCESS);
-                host_id_response->set_host_id(host_id);
+                host_id_response->set_host_id(result.host_id);
 
-                if (!base::contains(host_id_list_, host_id))
-                {
-                    host_id_list_.emplace_back(host_id);
+                key_hashes_[result.host_id] = key_hash;
 
+                if (addHostId(result.host_id))
+                {
                     // Notify the server that the ID has been assigned.
-                    server().onHostSessionWithId(this);
+                    server().onHostIdAdded(this, result.host_id);
                 }
             }
             else
@@ -181,17 +297,68 @@ void SessionHost::readResetHostId(const proto::ResetHostId& reset_host_id)
         return;
     }
 
-    for (auto it = host_id_list_.begin(); it != host_id_list_.end(); ++it)
+    if (removeHostId(host_id))
     {
-        if (*it == host_id)
+        LOG(LS_INFO) << "Host ID " << host_id << " remove from list";
+        server().onHostIdRemoved(this, host_id);
+        return;
+    }
+
+    LOG(LS_WARNING) << "Host ID " << host_id << " NOT found in list";
+}
+
+void SessionHost::readHostInventory(const proto::HostInventory& host_inventory)
+{
+    if (!host_inventory.is_delta())
+        inventory_.clear();
+
+    for (int i = 0; i < host_inventory.removed_key_size(); ++i)
+        inventory_.erase(host_inventory.removed_key(i));
+
+    for (int i = 0; i < host_inventory.item_size(); ++i)
+    {
+        const proto::InventoryItem& item = host_inventory.item(i);
+
+        if (item.key().empty() || item.key().size() > kMaxInventoryKeySize ||
+            item.value().size() > kMaxInventoryValueSize)
         {
-            LOG(LS_INFO) << "Host ID " << host_id << " remove from list";
-            host_id_list_.erase(it);
-            return;
+            LOG(LS_WARNING) << "Invalid inventory item (key size: " << item.key().size()
+                            << " value size: " << item.value().size() << ")";
+            continue;
         }
+
+        if (inventory_.size() >= kMaxInventoryItems && !base::contains(inventory_, item.key()))
+        {
+            LOG(LS_WARNING) << "Too many inventory items";
+            break;
+        }
+
+        inventory_[item.key()] = item.value();
     }
 
-    LOG(LS_WARNING) << "Host ID " << host_id << " NOT found in list";
+    inventory_time_ = time(nullptr);
+}
+
+void SessionHost::readDirectCandidates(const proto::DirectCandidates& direct_candidates)
+{
+    direct_candidates_.Clear();
+
+    for (const auto& endpoint : direct_candidates.endpoint())
+    {
+        if (direct_candidates_.endpoint_size() >= kMaxDirectCandidates)
+            break;
+
+        if (endpoint.address().empty() || endpoint.address().size() > kMaxDirectAddressSize ||
+            !endpoint.port() || endpoint.port() > 65535)
+        {
+            LOG(LS_WARNING) << "Invalid direct candidate from host";
+            continue;
+        }
+
+        direct_candidates_.add_endpoint()->CopyFrom(endpoint);
+    }
+
+    LOG(LS_INFO) << "Direct candidates of host: " << direct_candidates_.endpoint_size();
 }
 
 } // namespace router
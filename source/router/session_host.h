@@ -23,8 +23,12 @@
 #include "proto/router_peer.pb.h"
 #include "router/session.h"
 
+#include <chrono>
+#include <map>
+
 namespace router {
 
+class HostResumeTicket;
 class ServerProxy;
 
 class SessionHost : public Session
@@ -34,12 +38,30 @@ public:
     ~SessionHost() override;
 
     using HostIdList = std::vector<base::HostId>;
+    using Inventory = std::map<std::string, std::string>;
 
     const HostIdList& hostIdList() const { return host_id_list_; }
     bool hasHostId(base::HostId host_id) const;
 
+    // Adds |host_id| to the list. Returns false if the ID is already in the list.
+    bool addHostId(base::HostId host_id);
+
+    // Removes |host_id| from the list. Returns false if the ID is not in the list.
+    bool removeHostId(base::HostId host_id);
+
     void sendConnectionOffer(const proto::ConnectionOffer& offer);
 
+    // Asks the host to reconnect after |delay| and gives it the tickets for its IDs.
+    void sendReconnectNotice(std::chrono::milliseconds delay, const HostResumeTicket& tickets);
+
+    // The inventory which the host sent. Empty if the host does not send it.
+    const Inventory& inventory() const { return inventory_; }
+    time_t inventoryTime() const { return inventory_time_; }
+
+    // The candidates for the direct connections which the host announced. Empty if the host does
+    // not support them.
+    const proto::DirectCandidates& directCandidates() const { return direct_candidates_; }
+
 protected:
     // Session implementation.
     void onSessionReady() override;
@@ -47,11 +69,27 @@ protected:
     void onSessionMessageWritten(uint8_t channel_id, size_t pending) override;
 
 private:
+    struct HostIdResult;
+
     void readHostIdRequest(const proto::HostIdRequest& host_id_request);
+    void onHostIdResult(const std::string& key,
+                        const base::ByteArray& key_hash,
+                        const HostIdResult& result);
     void readResetHostId(const proto::ResetHostId& reset_host_id);
+    void readHostInventory(const proto::HostInventory& host_inventory);
+    void readDirectCandidates(const proto::DirectCandidates& direct_candidates);
 
     HostIdList host_id_list_;
 
+    // Hashes of the keys of the assigned IDs. The resume tickets are bound to them.
+    std::map<base::HostId, base::ByteArray> key_hashes_;
+    Inventory inventory_;
+    time_t inventory_time_ = 0;
+    proto::DirectCandidates direct_candidates_;
+
+    // Reset in the destructor. The database results that come later are ignored.
+    std::shared_ptr<SessionHost*> self_;
+
     DISALLOW_COPY_AND_ASSIGN(SessionHost);
 };
 
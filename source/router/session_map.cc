@@ -0,0 +1,126 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "router/session_map.h"
+
+#include "base/logging.h"
+#include "router/session_cluster.h"
+#include "router/session_host.h"
+
+namespace router {
+
+SessionMap::SessionMap() = default;
+
+SessionMap::~SessionMap() = default;
+
+void SessionMap::add(std::unique_ptr<Session> session)
+{
+    DCHECK(session);
+
+    const Session::SessionId session_id = session->sessionId();
+    DCHECK(!sessions_.count(session_id));
+
+    sessions_.emplace(session_id, std::move(session));
+}
+
+std::unique_ptr<Session> SessionMap::take(Session::SessionId session_id)
+{
+    auto it = sessions_.find(session_id);
+    if (it == sessions_.end())
+        return nullptr;
+
+    std::unique_ptr<Session> session = std::move(it->second);
+    sessions_.erase(it);
+
+    if (session->sessionType() == proto::ROUTER_SESSION_HOST)
+    {
+        SessionHost* host_session = static_cast<SessionHost*>(session.get());
+
+        for (const auto& host_id : host_session->hostIdList())
+            removeHostId(host_session, host_id);
+    }
+    else if (session->sessionType() == proto::ROUTER_SESSION_CLUSTER)
+    {
+        SessionCluster* cluster_session = static_cast<SessionCluster*>(session.get());
+
+        for (const auto& host : cluster_session->hosts())
+            removeClusterHostId(cluster_session, host.first);
+    }
+
+    return session;
+}
+
+Session* SessionMap::session(Session::SessionId session_id) const
+{
+    auto it = sessions_.find(session_id);
+    if (it == sessions_.end())
+        return nullptr;
+
+    return it->second.get();
+}
+
+SessionHost* SessionMap::hostSession(base::HostId host_id) const
+{
+    auto it = hosts_.find(host_id);
+    if (it == hosts_.end())
+        return nullptr;
+
+    return it->second;
+}
+
+SessionHost* SessionMap::addHostId(SessionHost* session, base::HostId host_id)
+{
+    DCHECK(session);
+
+    SessionHost*& entry = hosts_[host_id];
+    SessionHost* previous = entry;
+    entry = session;
+
+    return previous != session ? previous : nullptr;
+}
+
+void SessionMap::removeHostId(SessionHost* session, base::HostId host_id)
+{
+    auto it = hosts_.find(host_id);
+    if (it != hosts_.end() && it->second == session)
+        hosts_.erase(it);
+}
+
+SessionCluster* SessionMap::clusterSession(base::HostId host_id) const
+{
+    auto it = cluster_hosts_.find(host_id);
+    if (it == cluster_hosts_.end())
+        return nullptr;
+
+    return it->second;
+}
+
+void SessionMap::addClusterHostId(SessionCluster* session, base::HostId host_id)
+{
+    DCHECK(session);
+    cluster_hosts_[host_id] = session;
+}
+
+void SessionMap::removeClusterHostId(SessionCluster* session, base::HostId host_id)
+{
+    auto it = cluster_hosts_.find(host_id);
+    if (it != cluster_hosts_.end() && it->second == session)
+        cluster_hosts_.erase(it);
+}
+
+} // namespace router
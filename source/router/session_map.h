@@ -0,0 +1,83 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2023 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef ROUTER_SESSION_MAP_H
+#define ROUTER_SESSION_MAP_H
+
+#include "base/macros_magic.h"
+#include "base/peer/host_id.h"
+#include "router/session.h"
+
+#include <map>
+#include <unordered_map>
+
+namespace router {
+
+class SessionCluster;
+class SessionHost;
+
+// Owns the sessions of the router and indexes them by session ID and by host ID, so that the
+// lookups do not depend on the number of sessions.
+class SessionMap
+{
+public:
+    // Sorted by session ID, which is also the order in which the sessions were created.
+    using Sessions = std::map<Session::SessionId, std::unique_ptr<Session>>;
+
+    SessionMap();
+    ~SessionMap();
+
+    void add(std::unique_ptr<Session> session);
+
+    // Removes the session and its host IDs (or the host IDs announced by it) from the map.
+    // Returns nullptr if there is no session with |session_id|.
+    std::unique_ptr<Session> take(Session::SessionId session_id);
+
+    Session* session(Session::SessionId session_id) const;
+    SessionHost* hostSession(base::HostId host_id) const;
+
+    // Binds |host_id| to |session|. Returns the session to which the ID was bound before or
+    // nullptr.
+    SessionHost* addHostId(SessionHost* session, base::HostId host_id);
+
+    // Removes |host_id| if it is bound to |session|.
+    void removeHostId(SessionHost* session, base::HostId host_id);
+
+    // Returns the router of the cluster which announced |host_id| last or nullptr.
+    SessionCluster* clusterSession(base::HostId host_id) const;
+
+    void addClusterHostId(SessionCluster* session, base::HostId host_id);
+
+    // Removes |host_id| if it is bound to |session|.
+    void removeClusterHostId(SessionCluster* session, base::HostId host_id);
+
+    const Sessions& sessions() const { return sessions_; }
+    size_t hostIdCount() const { return hosts_.size(); }
+    size_t clusterHostIdCount() const { return cluster_hosts_.size(); }
+
+private:
+    Sessions sessions_;
+    std::unordered_map<base::HostId, SessionHost*> hosts_;
+    std::unordered_map<base::HostId, SessionCluster*> cluster_hosts_;
+
+    DISALLOW_COPY_AND_ASSIGN(SessionMap);
+};
+
+} // namespace router
+
+#endif // ROUTER_SESSION_MAP_H
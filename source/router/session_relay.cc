@@ -19,6 +19,7 @@
 #include "router/session_relay.h"
 
 #include "base/logging.h"
+#include "router/server.h"
 #include "router/shared_key_pool.h"
 
 namespace router {
@@ -43,6 +44,13 @@ void SessionRelay::sendKeyUsed(uint32_t key_id)
     sendMessage(proto::ROUTER_CHANNEL_ID_SESSION, *outgoing_message_);
 }
 
+void SessionRelay::sendKeyPoolRequest(uint32_t key_count)
+{
+    outgoing_message_->Clear();
+    outgoing_message_->mutable_key_pool_request()->set_key_count(key_count);
+    sendMessage(proto::ROUTER_CHANNEL_ID_SESSION, *outgoing_message_);
+}
+
 void SessionRelay::disconnectPeerSession(const proto::PeerConnectionRequest& request)
 {
     outgoing_message_->Clear();
@@ -52,7 +60,12 @@ void SessionRelay::disconnectPeerSession(const proto::PeerConnectionRequest& req
 
 void SessionRelay::onSessionReady()
 {
-    // Nothing
+    // Older relays send all their keys after connecting.
+    if (version() >= base::Version(2, 7, 0))
+        relayKeyPool().addRelay(sessionId());
+
+    // The region is refined by the peer address from the key pool.
+    relayKeyPool().setRelayRegion(sessionId(), server().relayPlacement().region(address()));
 }
 
 void SessionRelay::onSessionMessageReceived(uint8_t /* channel_id */, const base::ByteArray& buffer)
@@ -72,6 +85,11 @@ void SessionRelay::onSessionMessageReceived(uint8_t /* channel_id */, const base
     else if (incoming_message_->has_relay_stat())
     {
         relay_stat_ = std::move(*incoming_message_->mutable_relay_stat());
+        readRelayStat(*relay_stat_);
+    }
+    else if (incoming_message_->has_relay_drain())
+    {
+        readRelayDrain(incoming_message_->relay_drain());
     }
     else
     {
@@ -92,9 +110,58 @@ void SessionRelay::readKeyPool(const proto::RelayKeyPool& key_pool)
 
     peer_data_.emplace(std::make_pair(
         key_pool.peer_host(), static_cast<uint16_t>(key_pool.peer_port())));
+    peer_udp_port_ = static_cast<uint16_t>(key_pool.peer_udp_port());
+
+    // Peers connect to the relay by this address, so it is more accurate than the address of the
+    // session with the router.
+    std::string region = server().relayPlacement().region(key_pool.peer_host());
+    if (!region.empty())
+        pool.setRelayRegion(sessionId(), region);
+
+    // A draining relay does not take new peers, so its keys are never given out.
+    if (is_draining_)
+    {
+        LOG(LS_INFO) << "Keys of draining relay ignored (" << address() << ")";
+        return;
+    }
 
     for (int i = 0; i < key_pool.key_size(); ++i)
         pool.addKey(sessionId(), key_pool.key(i));
 }
 
+void SessionRelay::readRelayStat(const proto::RelayStat& relay_stat)
+{
+    SharedKeyPool::RelayLoad load;
+    load.total_rate_limit = relay_stat.total_rate_limit();
+    load.is_overloaded = relay_stat.rejected_peers() != 0;
+
+    for (int i = 0; i < relay_stat.peer_connection_size(); ++i)
+    {
+        const proto::PeerConnection& connection = relay_stat.peer_connection(i);
+        if (connection.status() != proto::PeerConnection::PEER_STATUS_ACTIVE)
+            continue;
+
+        ++load.session_count;
+        load.throughput += connection.throughput();
+    }
+
+    if (load.is_overloaded)
+        LOG(LS_WARNING) << "Relay rejected peers: " << relay_stat.rejected_peers();
+
+    relayKeyPool().setRelayLoad(sessionId(), load);
+    server().notifySessionChanged(*this);
+}
+
+void SessionRelay::readRelayDrain(const proto::RelayDrain& relay_drain)
+{
+    LOG(LS_INFO) << "Relay is draining (sessions: " << relay_drain.session_count() << ", "
+                 << address() << ")";
+
+    // Peers that already received the keys of the relay can still connect to it. No more keys
+    // are given out and the relay is not asked for new ones.
+    is_draining_ = true;
+    relayKeyPool().removeKeysForRelay(sessionId());
+    server().notifySessionChanged(*this);
+}
+
 } // namespace router
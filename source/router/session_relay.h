@@ -34,10 +34,17 @@ public:
     using PeerData = std::pair<std::string, uint16_t>;
 
     const std::optional<PeerData>& peerData() const { return peer_data_; }
+
+    // Port of the UDP relay for the peers. Zero if the relay does not forward datagrams.
+    uint16_t peerUdpPort() const { return peer_udp_port_; }
     const std::optional<proto::RelayStat>& relayStat() const { return relay_stat_; }
     void sendKeyUsed(uint32_t key_id);
+    void sendKeyPoolRequest(uint32_t key_count);
     void disconnectPeerSession(const proto::PeerConnectionRequest& request);
 
+    // The relay is going to stop and takes no new peers.
+    bool isDraining() const { return is_draining_; }
+
 protected:
     // Session implementation.
     void onSessionReady() override;
@@ -46,9 +53,13 @@ protected:
 
 private:
     void readKeyPool(const proto::RelayKeyPool& key_pool);
+    void readRelayStat(const proto::RelayStat& relay_stat);
+    void readRelayDrain(const proto::RelayDrain& relay_drain);
 
     std::optional<PeerData> peer_data_;
+    uint16_t peer_udp_port_ = 0;
     std::optional<proto::RelayStat> relay_stat_;
+    bool is_draining_ = false;
 
     std::unique_ptr<proto::RelayToRouter> incoming_message_;
     std::unique_ptr<proto::RouterToRelay> outgoing_message_;
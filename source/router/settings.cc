@@ -30,6 +30,7 @@ namespace {
 const base::JsonSettings::Scope kScope = base::JsonSettings::Scope::SYSTEM;
 const char kApplicationName[] = "aspia";
 const char kFileName[] = "router";
+const uint32_t kDefaultCryptoOffloadThreshold = 256 * 1024;
 
 } // namespace
 
@@ -55,6 +56,30 @@ void Settings::reset()
     setHostWhiteList(WhiteList());
     setAdminWhiteList(WhiteList());
     setRelayWhiteList(WhiteList());
+    setAcceptBacklog(0);
+    setAcceptOperations(1);
+    setAcceptThreads(0);
+    setAuthWorkerThreads(0);
+    setMaxPendingAuthentications(0);
+    setMaxWaitingAuthentications(0);
+    setAuthRatePerAddress(0);
+    setAuthRatePerUser(0);
+    setMaxSessions(0);
+    setCryptoWorkerThreads(0);
+    setCryptoOffloadThreshold(kDefaultCryptoOffloadThreshold);
+    setRelayKeyPoolLowWatermark(16);
+    setRelayKeyPoolHighWatermark(64);
+    setRelayRegions(std::u16string());
+    setClusterPeers(std::u16string());
+    setClusterUserName(std::u16string());
+    setClusterPassword(std::u16string());
+    setDatabaseSynchronous(u"normal");
+    setDatabaseType(u"sqlite");
+    setDatabaseConnection(std::u16string());
+    setDatabasePoolSize(4);
+    setMetricsInterface(u"127.0.0.1");
+    setMetricsPort(0);
+    setDrainWindow(60);
 }
 
 void Settings::flush()
@@ -136,6 +161,250 @@ Settings::WhiteList Settings::relayWhiteList() const
     return whiteList("RelayWhiteList");
 }
 
+void Settings::setAcceptBacklog(uint32_t backlog)
+{
+    impl_.set<uint32_t>("AcceptBacklog", backlog);
+}
+
+uint32_t Settings::acceptBacklog() const
+{
+    return impl_.get<uint32_t>("AcceptBacklog", 0);
+}
+
+void Settings::setAcceptOperations(uint32_t count)
+{
+    impl_.set<uint32_t>("AcceptOperations", count);
+}
+
+uint32_t Settings::acceptOperations() const
+{
+    return impl_.get<uint32_t>("AcceptOperations", 1);
+}
+
+void Settings::setAcceptThreads(uint32_t count)
+{
+    impl_.set<uint32_t>("AcceptThreads", count);
+}
+
+uint32_t Settings::acceptThreads() const
+{
+    return impl_.get<uint32_t>("AcceptThreads", 0);
+}
+
+void Settings::setAuthWorkerThreads(uint32_t count)
+{
+    impl_.set<uint32_t>("AuthWorkerThreads", count);
+}
+
+uint32_t Settings::authWorkerThreads() const
+{
+    return impl_.get<uint32_t>("AuthWorkerThreads", 0);
+}
+
+void Settings::setMaxPendingAuthentications(uint32_t count)
+{
+    impl_.set<uint32_t>("MaxPendingAuthentications", count);
+}
+
+uint32_t Settings::maxPendingAuthentications() const
+{
+    return impl_.get<uint32_t>("MaxPendingAuthentications", 0);
+}
+
+void Settings::setMaxWaitingAuthentications(uint32_t count)
+{
+    impl_.set<uint32_t>("MaxWaitingAuthentications", count);
+}
+
+uint32_t Settings::maxWaitingAuthentications() const
+{
+    return impl_.get<uint32_t>("MaxWaitingAuthentications", 0);
+}
+
+void Settings::setAuthRatePerAddress(uint32_t count)
+{
+    impl_.set<uint32_t>("AuthRatePerAddress", count);
+}
+
+uint32_t Settings::authRatePerAddress() const
+{
+    return impl_.get<uint32_t>("AuthRatePerAddress", 0);
+}
+
+void Settings::setAuthRatePerUser(uint32_t count)
+{
+    impl_.set<uint32_t>("AuthRatePerUser", count);
+}
+
+uint32_t Settings::authRatePerUser() const
+{
+    return impl_.get<uint32_t>("AuthRatePerUser", 0);
+}
+
+void Settings::setMaxSessions(uint32_t count)
+{
+    impl_.set<uint32_t>("MaxSessions", count);
+}
+
+uint32_t Settings::maxSessions() const
+{
+    return impl_.get<uint32_t>("MaxSessions", 0);
+}
+
+void Settings::setCryptoWorkerThreads(uint32_t count)
+{
+    impl_.set<uint32_t>("CryptoWorkerThreads", count);
+}
+
+uint32_t Settings::cryptoWorkerThreads() const
+{
+    return impl_.get<uint32_t>("CryptoWorkerThreads", 0);
+}
+
+void Settings::setCryptoOffloadThreshold(uint32_t size)
+{
+    impl_.set<uint32_t>("CryptoOffloadThreshold", size);
+}
+
+uint32_t Settings::cryptoOffloadThreshold() const
+{
+    return impl_.get<uint32_t>("CryptoOffloadThreshold", kDefaultCryptoOffloadThreshold);
+}
+
+void Settings::setRelayKeyPoolLowWatermark(uint32_t count)
+{
+    impl_.set<uint32_t>("RelayKeyPoolLowWatermark", count);
+}
+
+uint32_t Settings::relayKeyPoolLowWatermark() const
+{
+    return impl_.get<uint32_t>("RelayKeyPoolLowWatermark", 16);
+}
+
+void Settings::setRelayKeyPoolHighWatermark(uint32_t count)
+{
+    impl_.set<uint32_t>("RelayKeyPoolHighWatermark", count);
+}
+
+uint32_t Settings::relayKeyPoolHighWatermark() const
+{
+    return impl_.get<uint32_t>("RelayKeyPoolHighWatermark", 64);
+}
+
+void Settings::setRelayRegions(const std::u16string& rules)
+{
+    impl_.set<std::u16string>("RelayRegions", rules);
+}
+
+std::u16string Settings::relayRegions() const
+{
+    return impl_.get<std::u16string>("RelayRegions");
+}
+
+void Settings::setClusterPeers(const std::u16string& peers)
+{
+    impl_.set<std::u16string>("ClusterPeers", peers);
+}
+
+std::u16string Settings::clusterPeers() const
+{
+    return impl_.get<std::u16string>("ClusterPeers");
+}
+
+void Settings::setClusterUserName(const std::u16string& user_name)
+{
+    impl_.set<std::u16string>("ClusterUserName", user_name);
+}
+
+std::u16string Settings::clusterUserName() const
+{
+    return impl_.get<std::u16string>("ClusterUserName");
+}
+
+void Settings::setClusterPassword(const std::u16string& password)
+{
+    impl_.set<std::u16string>("ClusterPassword", password);
+}
+
+std::u16string Settings::clusterPassword() const
+{
+    return impl_.get<std::u16string>("ClusterPassword");
+}
+
+void Settings::setDatabaseSynchronous(const std::u16string& mode)
+{
+    impl_.set<std::u16string>("DatabaseSynchronous", mode);
+}
+
+std::u16string Settings::databaseSynchronous() const
+{
+    return impl_.get<std::u16string>("DatabaseSynchronous", u"normal");
+}
+
+void Settings::setDatabaseType(const std::u16string& type)
+{
+    impl_.set<std::u16string>("DatabaseType", type);
+}
+
+std::u16string Settings::databaseType() const
+{
+    return impl_.get<std::u16string>("DatabaseType", u"sqlite");
+}
+
+void Settings::setDatabaseConnection(const std::u16string& connection)
+{
+    impl_.set<std::u16string>("DatabaseConnection", connection);
+}
+
+std::u16string Settings::databaseConnection() const
+{
+    return impl_.get<std::u16string>("DatabaseConnection");
+}
+
+void Settings::setDatabasePoolSize(uint32_t size)
+{
+    impl_.set<uint32_t>("DatabasePoolSize", size);
+}
+
+uint32_t Settings::databasePoolSize() const
+{
+    return impl_.get<uint32_t>("DatabasePoolSize", 4);
+}
+
+void Settings::setMetricsInterface(const std::u16string& interface)
+{
+    impl_.set<std::u16string>("MetricsInterface", interface);
+}
+
+std::u16string Settings::metricsInterface() const
+{
+    std::u16string interface = impl_.get<std::u16string>("MetricsInterface", u"127.0.0.1");
+    if (interface.empty())
+        return u"127.0.0.1";
+
+    return interface;
+}
+
+void Settings::setMetricsPort(uint16_t port)
+{
+    impl_.set<uint16_t>("MetricsPort", port);
+}
+
+uint16_t Settings::metricsPort() const
+{
+    return impl_.get<uint16_t>("MetricsPort", 0);
+}
+
+void Settings::setDrainWindow(uint32_t seconds)
+{
+    impl_.set<uint32_t>("DrainWindow", seconds);
+}
+
+uint32_t Settings::drainWindow() const
+{
+    return impl_.get<uint32_t>("DrainWindow", 60);
+}
+
 void Settings::setWhiteList(std::string_view key, const WhiteList& value)
 {
     std::u16string result;
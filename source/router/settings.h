@@ -57,6 +57,109 @@ public:
     void setRelayWhiteList(const WhiteList& list);
     WhiteList relayWhiteList() const;
 
+    // Length of the queue of connections that are not accepted yet. Zero means the system maximum.
+    void setAcceptBacklog(uint32_t backlog);
+    uint32_t acceptBacklog() const;
+
+    // Number of accept operations in progress at a time.
+    void setAcceptOperations(uint32_t count);
+    uint32_t acceptOperations() const;
+
+    // Threads that accept the connections. Zero means the main thread.
+    void setAcceptThreads(uint32_t count);
+    uint32_t acceptThreads() const;
+
+    // Threads for the authentication math. Zero means the main thread.
+    void setAuthWorkerThreads(uint32_t count);
+    uint32_t authWorkerThreads() const;
+
+    // Maximum number of authentications in progress. Zero means no limit.
+    void setMaxPendingAuthentications(uint32_t count);
+    uint32_t maxPendingAuthentications() const;
+
+    // Maximum number of connections waiting for the start of authentication. Connections beyond it
+    // are closed at once. Zero means no limit.
+    void setMaxWaitingAuthentications(uint32_t count);
+    uint32_t maxWaitingAuthentications() const;
+
+    // Authentication attempts per minute for each address of a peer and for each user name.
+    // Hosts behind one NAT share the address, so the limit of addresses must allow for them. Zero
+    // means no limit.
+    void setAuthRatePerAddress(uint32_t count);
+    uint32_t authRatePerAddress() const;
+
+    void setAuthRatePerUser(uint32_t count);
+    uint32_t authRatePerUser() const;
+
+    // Maximum number of sessions of all types. New connections beyond it are closed at once. Zero
+    // means no limit.
+    void setMaxSessions(uint32_t count);
+    uint32_t maxSessions() const;
+
+    // Threads for the encryption of large session messages and the size from which a message is
+    // encrypted on them. Zero threads means the main thread.
+    void setCryptoWorkerThreads(uint32_t count);
+    uint32_t cryptoWorkerThreads() const;
+
+    void setCryptoOffloadThreshold(uint32_t size);
+    uint32_t cryptoOffloadThreshold() const;
+
+    // Relays that support key requests are asked for new keys when their keys in the pool drop
+    // below the low watermark. The pool is topped up to the high watermark.
+    void setRelayKeyPoolLowWatermark(uint32_t count);
+    uint32_t relayKeyPoolLowWatermark() const;
+
+    void setRelayKeyPoolHighWatermark(uint32_t count);
+    uint32_t relayKeyPoolHighWatermark() const;
+
+    // Rules in the format "network=region;network=region", for example
+    // "10.1.0.0/16=eu;2001:db8::/32=us". Connections get a relay from the region of the client or
+    // the host if there is one.
+    void setRelayRegions(const std::u16string& rules);
+    std::u16string relayRegions() const;
+
+    // Other routers of the cluster in the format "address:port;address:port". If the list is not
+    // empty, then the router announces its hosts to these routers and forwards connection offers
+    // for their hosts to them. The routers authenticate with the user name and password, the user
+    // must be allowed the cluster session type on the other routers.
+    void setClusterPeers(const std::u16string& peers);
+    std::u16string clusterPeers() const;
+
+    void setClusterUserName(const std::u16string& user_name);
+    std::u16string clusterUserName() const;
+
+    void setClusterPassword(const std::u16string& password);
+    std::u16string clusterPassword() const;
+
+    // Value of "PRAGMA synchronous" for the database: "off", "normal", "full" or "extra".
+    void setDatabaseSynchronous(const std::u16string& mode);
+    std::u16string databaseSynchronous() const;
+
+    // Database backend: "sqlite" or "postgresql". PostgreSQL is available if the router is built
+    // with it.
+    void setDatabaseType(const std::u16string& type);
+    std::u16string databaseType() const;
+
+    // Connection string of the PostgreSQL server, for example "host=db dbname=aspia user=router".
+    void setDatabaseConnection(const std::u16string& connection);
+    std::u16string databaseConnection() const;
+
+    // Maximum number of idle connections to the PostgreSQL server that are kept for reuse.
+    void setDatabasePoolSize(uint32_t size);
+    uint32_t databasePoolSize() const;
+
+    // HTTP endpoint that exports the metrics at /metrics. Zero port means disabled.
+    void setMetricsInterface(const std::u16string& interface);
+    std::u16string metricsInterface() const;
+
+    void setMetricsPort(uint16_t port);
+    uint16_t metricsPort() const;
+
+    // When the router is stopped, the hosts are asked to reconnect at random times within this
+    // window in seconds. Zero means that the router stops at once.
+    void setDrainWindow(uint32_t seconds);
+    uint32_t drainWindow() const;
+
 private:
     void setWhiteList(std::string_view key, const WhiteList& value);
     WhiteList whiteList(std::string_view key) const;
@@ -20,8 +20,25 @@
 
 #include "base/logging.h"
 
+#include <algorithm>
+#include <limits>
+#include <tuple>
+
 namespace router {
 
+namespace {
+
+const size_t kDefaultLowWatermark = 16;
+const size_t kDefaultHighWatermark = 64;
+
+// Throughput that counts as one session when comparing the load of relays.
+const int64_t kThroughputPerSession = 256 * 1024; // 256 kB/s
+
+// A relay is saturated when its throughput reaches this percentage of its total rate limit.
+const int64_t kSaturationPercent = 90;
+
+} // namespace
+
 class SharedKeyPool::Impl
 {
 public:
@@ -30,8 +47,13 @@ public:
 
     void dettach();
 
+    void setWatermarks(size_t low, size_t high);
+    void addRelay(Session::SessionId session_id);
+    void setRelayLoad(Session::SessionId session_id, const RelayLoad& load);
+    void setRelayRegion(Session::SessionId session_id, const std::string& region);
     void addKey(Session::SessionId session_id, const proto::RelayKey& key);
-    std::optional<Credentials> takeCredentials();
+    std::optional<Credentials> takeCredentials(std::string_view client_region,
+                                               std::string_view host_region);
     void removeKeysForRelay(Session::SessionId session_id);
     void clear();
     size_t countForRelay(Session::SessionId session_id) const;
@@ -41,9 +63,34 @@ public:
 private:
     using Keys = std::vector<proto::RelayKey>;
 
-    std::map<Session::SessionId, Keys> pool_;
+    struct Relay
+    {
+        Keys keys;
+
+        // The relay sends keys on request.
+        bool refill = false;
+
+        // Number of keys requested but not yet received.
+        size_t requested = 0;
+
+        // Load reported by the relay. Keys taken since the report are counted as sessions.
+        RelayLoad load;
+
+        std::string region;
+    };
+
+    // Returns the position of the relay in the order of preference. Lower is better.
+    static std::tuple<bool, int, int64_t, size_t> rank(
+        const Relay& relay, std::string_view client_region, std::string_view host_region);
+
+    void refill(Session::SessionId session_id, Relay& relay);
+
+    std::map<Session::SessionId, Relay> pool_;
     Delegate* delegate_;
 
+    size_t low_watermark_ = kDefaultLowWatermark;
+    size_t high_watermark_ = kDefaultHighWatermark;
+
     DISALLOW_COPY_AND_ASSIGN(Impl);
 };
 
@@ -58,37 +105,78 @@ void SharedKeyPool::Impl::dettach()
     delegate_ = nullptr;
 }
 
+void SharedKeyPool::Impl::setWatermarks(size_t low, size_t high)
+{
+    low_watermark_ = std::max(low, size_t(1));
+    high_watermark_ = std::max(high, low_watermark_);
+
+    LOG(LS_INFO) << "Key pool watermarks: " << low_watermark_ << '/' << high_watermark_;
+}
+
+void SharedKeyPool::Impl::addRelay(Session::SessionId session_id)
+{
+    Relay& relay = pool_[session_id];
+    relay.refill = true;
+
+    LOG(LS_INFO) << "Relay '" << session_id << "' sends keys on request";
+    refill(session_id, relay);
+}
+
+void SharedKeyPool::Impl::setRelayLoad(Session::SessionId session_id, const RelayLoad& load)
+{
+    auto relay = pool_.find(session_id);
+    if (relay == pool_.end())
+        return;
+
+    relay->second.load = load;
+}
+
+void SharedKeyPool::Impl::setRelayRegion(Session::SessionId session_id, const std::string& region)
+{
+    Relay& relay = pool_[session_id];
+    if (relay.region == region)
+        return;
+
+    LOG(LS_INFO) << "Region of relay '" << session_id << "': "
+                 << (region.empty() ? "unknown" : region);
+    relay.region = region;
+}
+
 void SharedKeyPool::Impl::addKey(Session::SessionId session_id, const proto::RelayKey& key)
 {
     auto relay = pool_.find(session_id);
     if (relay == pool_.end())
     {
         LOG(LS_INFO) << "Host not found in pool. It will be added";
-        relay = pool_.emplace(session_id, Keys()).first;
+        relay = pool_.emplace(session_id, Relay()).first;
     }
 
     LOG(LS_INFO) << "Added key with id " << key.key_id() << " for host '" << session_id << "'";
-    relay->second.emplace_back(key);
+    relay->second.keys.emplace_back(key);
+
+    if (relay->second.requested)
+        --relay->second.requested;
 }
 
-std::optional<SharedKeyPool::Credentials> SharedKeyPool::Impl::takeCredentials()
+std::optional<SharedKeyPool::Credentials> SharedKeyPool::Impl::takeCredentials(
+    std::string_view client_region, std::string_view host_region)
 {
-    if (pool_.empty())
-    {
-        LOG(LS_WARNING) << "Empty key pool";
-        return std::nullopt;
-    }
-
     auto preffered_relay = pool_.end();
-    size_t max_count = 0;
+    std::tuple<bool, int, int64_t, size_t> preffered_rank;
 
     for (auto it = pool_.begin(); it != pool_.end(); ++it)
     {
-        size_t count = it->second.size();
-        if (count > max_count)
+        const Relay& relay = it->second;
+        if (relay.keys.empty())
+            continue;
+
+        std::tuple<bool, int, int64_t, size_t> relay_rank =
+            rank(relay, client_region, host_region);
+
+        if (preffered_relay == pool_.end() || relay_rank < preffered_rank)
         {
             preffered_relay = it;
-            max_count = count;
+            preffered_rank = relay_rank;
         }
     }
 
@@ -98,27 +186,25 @@ std::optional<SharedKeyPool::Credentials> SharedKeyPool::Impl::takeCredentials()
         return std::nullopt;
     }
 
-    LOG(LS_INFO) << "Preffered relay: " << preffered_relay->first;
+    Relay& relay = preffered_relay->second;
 
-    std::vector<proto::RelayKey>& keys = preffered_relay->second;
-    if (keys.empty())
-    {
-        LOG(LS_ERROR) << "Empty key pool for relay";
-        return std::nullopt;
-    }
+    LOG(LS_INFO) << "Preffered relay: " << preffered_relay->first << " (region: "
+                 << (relay.region.empty() ? "unknown" : relay.region)
+                 << ", sessions: " << relay.load.session_count << ")";
 
     Credentials credentials;
     credentials.session_id = preffered_relay->first;
-    credentials.key = std::move(keys.back());
+    credentials.key = std::move(relay.keys.back());
 
     // Removing the key from the pool.
-    keys.pop_back();
+    relay.keys.pop_back();
 
-    if (keys.empty())
-    {
-        LOG(LS_INFO) << "Last key in the pool for relay. The relay will be removed from the pool";
-        pool_.erase(preffered_relay->first);
-    }
+    // The session will appear in the statistics of the relay later. Until then the key counts as
+    // a session so that a burst of requests is spread across the relays.
+    ++relay.load.session_count;
+
+    // The relay stays in the pool with its load and region until its session is finished.
+    refill(credentials.session_id, relay);
 
     if (delegate_)
         delegate_->onPoolKeyUsed(credentials.session_id, credentials.key.key_id());
@@ -144,7 +230,7 @@ size_t SharedKeyPool::Impl::countForRelay(Session::SessionId session_id) const
     if (result == pool_.end())
         return 0;
 
-    return result->second.size();
+    return result->second.keys.size();
 }
 
 size_t SharedKeyPool::Impl::count() const
@@ -152,14 +238,63 @@ size_t SharedKeyPool::Impl::count() const
     size_t result = 0;
 
     for (const auto& relay : pool_)
-        result += relay.second.size();
+        result += relay.second.keys.size();
 
     return result;
 }
 
 bool SharedKeyPool::Impl::isEmpty() const
 {
-    return pool_.empty();
+    for (const auto& relay : pool_)
+    {
+        if (!relay.second.keys.empty())
+            return false;
+    }
+
+    return true;
+}
+
+// static
+std::tuple<bool, int, int64_t, size_t> SharedKeyPool::Impl::rank(
+    const Relay& relay, std::string_view client_region, std::string_view host_region)
+{
+    const RelayLoad& load = relay.load;
+
+    // An overloaded relay would reject the peers, so it is used only if no other relay has keys.
+    const bool is_saturated = load.is_overloaded || (load.total_rate_limit > 0 &&
+        load.throughput * 100 >= load.total_rate_limit * kSaturationPercent);
+
+    int distance = 2;
+    if (!relay.region.empty())
+    {
+        if (relay.region == client_region)
+            --distance;
+        if (relay.region == host_region)
+            --distance;
+    }
+
+    const int64_t weighted_load =
+        static_cast<int64_t>(load.session_count) + load.throughput / kThroughputPerSession;
+
+    // With equal load the relay with more keys wins.
+    return std::make_tuple(is_saturated, distance, weighted_load,
+                           std::numeric_limits<size_t>::max() - relay.keys.size());
+}
+
+void SharedKeyPool::Impl::refill(Session::SessionId session_id, Relay& relay)
+{
+    if (!relay.refill || !delegate_ || relay.keys.size() >= low_watermark_)
+        return;
+
+    const size_t count = relay.keys.size() + relay.requested;
+    if (count >= high_watermark_)
+        return;
+
+    const size_t key_count = high_watermark_ - count;
+    relay.requested += key_count;
+
+    LOG(LS_INFO) << "Requesting " << key_count << " keys from relay '" << session_id << "'";
+    delegate_->onPoolKeysRequired(session_id, static_cast<uint32_t>(key_count));
 }
 
 SharedKeyPool::SharedKeyPool(Delegate* delegate)
@@ -187,14 +322,35 @@ std::unique_ptr<SharedKeyPool> SharedKeyPool::share()
     return std::unique_ptr<SharedKeyPool>(new SharedKeyPool(impl_));
 }
 
+void SharedKeyPool::setWatermarks(size_t low, size_t high)
+{
+    impl_->setWatermarks(low, high);
+}
+
+void SharedKeyPool::addRelay(Session::SessionId session_id)
+{
+    impl_->addRelay(session_id);
+}
+
+void SharedKeyPool::setRelayLoad(Session::SessionId session_id, const RelayLoad& load)
+{
+    impl_->setRelayLoad(session_id, load);
+}
+
+void SharedKeyPool::setRelayRegion(Session::SessionId session_id, const std::string& region)
+{
+    impl_->setRelayRegion(session_id, region);
+}
+
 void SharedKeyPool::addKey(Session::SessionId session_id, const proto::RelayKey& key)
 {
     impl_->addKey(session_id, key);
 }
 
-std::optional<SharedKeyPool::Credentials> SharedKeyPool::takeCredentials()
+std::optional<SharedKeyPool::Credentials> SharedKeyPool::takeCredentials(
+    std::string_view client_region, std::string_view host_region)
 {
-    return impl_->takeCredentials();
+    return impl_->takeCredentials(client_region, host_region);
 }
 
 void SharedKeyPool::removeKeysForRelay(Session::SessionId session_id)
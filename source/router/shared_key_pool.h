@@ -27,6 +27,7 @@
 #include <cstdint>
 #include <optional>
 #include <memory>
+#include <string>
 
 namespace router {
 
@@ -39,6 +40,10 @@ public:
         virtual ~Delegate() = default;
 
         virtual void onPoolKeyUsed(Session::SessionId session_id, uint32_t key_id) = 0;
+
+        // Called when the keys of a relay that supports key requests drop below the low
+        // watermark.
+        virtual void onPoolKeysRequired(Session::SessionId session_id, uint32_t key_count) = 0;
     };
 
     explicit SharedKeyPool(Delegate* delegate);
@@ -52,8 +57,31 @@ public:
         proto::RelayKey key;
     };
 
+    // When the keys of a relay drop below |low| the relay is asked to top them up to |high|.
+    void setWatermarks(size_t low, size_t high);
+
+    // Adds a relay that sends keys on request. The initial keys are requested immediately.
+    void addRelay(Session::SessionId session_id);
+
+    struct RelayLoad
+    {
+        size_t session_count = 0;
+        int64_t throughput = 0; // Bytes per second.
+        int64_t total_rate_limit = 0; // Bytes per second, zero if not limited.
+        bool is_overloaded = false; // The relay rejected peers recently.
+    };
+
+    // Sets the load reported by the relay. Credentials are taken from the least loaded relay.
+    void setRelayLoad(Session::SessionId session_id, const RelayLoad& load);
+
+    // Sets the region of the relay (see RelayPlacement).
+    void setRelayRegion(Session::SessionId session_id, const std::string& region);
+
     void addKey(Session::SessionId session_id, const proto::RelayKey& key);
-    std::optional<Credentials> takeCredentials();
+    // Relays in the region of the client or the host are preferred unless they are saturated.
+    // Empty regions are unknown.
+    std::optional<Credentials> takeCredentials(std::string_view client_region,
+                                               std::string_view host_region);
     void removeKeysForRelay(Session::SessionId session_id);
     void clear();
     size_t countForRelay(Session::SessionId session_id) const;
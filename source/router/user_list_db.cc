@@ -20,12 +20,13 @@
 
 #include "base/logging.h"
 #include "router/database.h"
-#include "router/database_factory.h"
+#include "router/database_worker.h"
 
 namespace router {
 
-UserListDb::UserListDb(std::unique_ptr<Database> db)
-    : db_(std::move(db))
+UserListDb::UserListDb(std::shared_ptr<DatabaseWorker> worker, std::unique_ptr<Database> db)
+    : worker_(std::move(worker)),
+      db_(std::move(db))
 {
     // Nothing
 }
@@ -33,16 +34,18 @@ UserListDb::UserListDb(std::unique_ptr<Database> db)
 UserListDb::~UserListDb() = default;
 
 // static
-std::unique_ptr<UserListDb> UserListDb::open(const DatabaseFactory& factory)
+std::unique_ptr<UserListDb> UserListDb::open(std::shared_ptr<DatabaseWorker> worker)
 {
-    std::unique_ptr<Database> db = factory.openDatabase();
+    DCHECK(worker);
+
+    std::unique_ptr<Database> db = worker->openDatabase();
     if (!db)
     {
         LOG(LS_WARNING) << "Unable to open database";
         return nullptr;
     }
 
-    return std::unique_ptr<UserListDb>(new UserListDb(std::move(db)));
+    return std::unique_ptr<UserListDb>(new UserListDb(std::move(worker), std::move(db)));
 }
 
 void UserListDb::add(const base::User& user)
@@ -55,6 +58,15 @@ base::User UserListDb::find(std::u16string_view username) const
     return db_->findUser(username);
 }
 
+void UserListDb::findAsync(std::u16string_view username, FindCallback callback) const
+{
+    worker_->post([username = std::u16string(username)](Database* database)
+    {
+        return database->findUser(username);
+    },
+    std::move(callback));
+}
+
 const base::ByteArray& UserListDb::seedKey() const
 {
     return seed_key_;
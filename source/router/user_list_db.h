@@ -25,25 +25,27 @@
 namespace router {
 
 class Database;
-class DatabaseFactory;
+class DatabaseWorker;
 
 class UserListDb : public base::UserListBase
 {
 public:
     ~UserListDb() override;
 
-    static std::unique_ptr<UserListDb> open(const DatabaseFactory& factory);
+    static std::unique_ptr<UserListDb> open(std::shared_ptr<DatabaseWorker> worker);
 
     // base::UserListBase implementation.
     void add(const base::User& user) override;
     base::User find(std::u16string_view username) const override;
+    void findAsync(std::u16string_view username, FindCallback callback) const override;
     const base::ByteArray& seedKey() const override;
     void setSeedKey(const base::ByteArray& seed_key) override;
     std::vector<base::User> list() const override;
 
 private:
-    explicit UserListDb(std::unique_ptr<Database> db);
+    UserListDb(std::shared_ptr<DatabaseWorker> worker, std::unique_ptr<Database> db);
 
+    std::shared_ptr<DatabaseWorker> worker_;
     std::unique_ptr<Database> db_;
     base::ByteArray seed_key_;
 